@@ -28,6 +28,9 @@
 #include <juce_graphics/juce_graphics.h>
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_gui_extra/juce_gui_extra.h>
+#if EL_USE_OPENGL
+ #include <juce_opengl/juce_opengl.h>
+#endif
 #include <juce_osc/juce_osc.h>
 #include <kv_core/kv_core.h>
 #include <kv_engines/kv_engines.h>
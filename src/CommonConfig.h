@@ -35,6 +35,10 @@
  #define EL_USE_SUBGRAPHS 1
 #endif
 
+#ifndef EL_USE_ABLETON_LINK
+ #define EL_USE_ABLETON_LINK 0
+#endif
+
 #ifndef EL_ROOT_MIDI_CHANNEL
  #define EL_ROOT_MIDI_CHANNEL 1
 #endif
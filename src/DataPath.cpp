@@ -95,10 +95,11 @@ namespace Element
         if (! presetsDir.exists() || ! presetsDir.isDirectory())
             return;
 
-        DirectoryIterator iter (presetsDir, true, EL_PRESET_FILE_EXTENSIONS);
-        while (iter.next())
+        Array<File> files;
+        index->findFiles (presetsDir, true, EL_PRESET_FILE_EXTENSIONS, files);
+        for (const auto& file : files)
         {
-            Node node (Node::parse (iter.getFile()));
+            Node node (Node::parse (file));
             if (node.isValid() && 
                 node.getFileOrIdentifier() == identifier && 
                 node.getFormat() == format)
@@ -113,9 +114,15 @@ namespace Element
         const auto presetsDir = getRootDir().getChildFile ("Presets");
         if (! presetsDir.exists() || ! presetsDir.isDirectory())
             return;
-        DirectoryIterator iter (presetsDir, true, EL_PRESET_FILE_EXTENSIONS);
-        while (iter.next())
-            results.add (iter.getFile().getFullPathName());
+        Array<File> files;
+        index->findFiles (presetsDir, true, EL_PRESET_FILE_EXTENSIONS, files);
+        for (const auto& file : files)
+            results.add (file.getFullPathName());
+    }
+
+    void DataPath::rescanPresets() const
+    {
+        index->rescan (getRootDir().getChildFile ("Presets"));
     }
 
     const File DataPath::workspacesDir()
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "FileIndex.h"
 
 #define EL_PRESET_FILE_EXTENSIONS "*.elp;*.elpreset"
 
@@ -48,9 +49,13 @@ public:
     File createNewPresetFile (const Node& node, const String& name = String()) const;
     void findPresetsFor (const String& format, const String& identifier, NodeArray& nodes) const;
     void findPresetFiles (StringArray& results) const;
+
+    /** Picks up presets saved since the presets directory was indexed */
+    void rescanPresets() const;
     
 private:
     File root;
+    SharedResourcePointer<FileIndex> index;
 };
 
 class DataSearchPath { };
@@ -39,6 +39,7 @@ namespace Tags
     const Identifier active             = "active";
     const Identifier arc                = "arc";
     const Identifier arcs               = "arcs";
+    const Identifier bridge             = "bridge";
     const Identifier bypass             = "bypass";
     const Identifier control            = "control";
     const Identifier controller         = "controller";
@@ -48,15 +49,18 @@ namespace Tags
     const Identifier gain               = "gain";
     const Identifier graph              = "graph";
     const Identifier graphs             = "graphs";
+    const Identifier loadPriority       = "loadPriority";
     const Identifier mappingData        = "mappingData";
     const Identifier map                = "map";
     const Identifier maps               = "maps";
+    const Identifier memoryBudget       = "memoryBudget";
     const Identifier missing            = "missing";
     const Identifier mute               = "mute";
     const Identifier node               = "node";
     const Identifier nodes              = "nodes";
     const Identifier notes              = "notes";
     const Identifier oversamplingFactor = "oversamplingFactor";
+    const Identifier oversamplingMode   = "oversamplingMode";
     const Identifier persistent         = "persistent";
     const Identifier placeholder        = "placeholder";
     const Identifier port               = "port";
@@ -80,6 +84,11 @@ namespace Tags
     const Identifier session            = "session";
     const Identifier state              = "state";
 	const Identifier programState		= "programState";
+    const Identifier stateChunk         = "stateChunk";
+    const Identifier programStateChunk  = "programStateChunk";
+    const Identifier archive            = "archive";
+    const Identifier batch              = "batch";
+    const Identifier sessionIndex       = "sessionIndex";
     const Identifier beatsPerBar        = "beatsPerBar";
     const Identifier beatDivisor        = "beatDivisor";
     const Identifier midiChannel        = "midiChannel";
@@ -89,6 +98,12 @@ namespace Tags
     const Identifier globalMidiPrograms = "globalMidiPrograms";
     const Identifier midiProgramsState  = "midiProgramsState";
     const Identifier renderMode         = "renderMode";
+    const Identifier parallelRender     = "parallelRender";
+    const Identifier pipelineStages     = "pipelineStages";
+    const Identifier inlineSubGraphs    = "inlineSubGraphs";
+    const Identifier renderDivision     = "renderDivision";
+    const Identifier innerBlockSize     = "innerBlockSize";
+    const Identifier renderAhead        = "renderAhead";
 
     const Identifier vertical           = "vertical";
     const Identifier staticPos          = "staticPos";
@@ -117,9 +132,11 @@ namespace Tags
     const Identifier keyEnd             = "keyEnd";
 
     const Identifier velocityCurveMode  = "velocityCurveMode";
+    const Identifier velocityCurveTable = "velocityCurveTable";
     const Identifier workspace          = "workspace";
 
     const Identifier externalSync       = "externalSync";
+    const Identifier doublePrecision    = "doublePrecision";
 
     const Identifier updater            = "updater";
 }
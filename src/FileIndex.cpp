@@ -0,0 +1,411 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "FileIndex.h"
+
+#if JUCE_LINUX
+ #include <poll.h>
+ #include <sys/inotify.h>
+ #include <unistd.h>
+#endif
+
+namespace Element {
+
+static const int pollIntervalMs = 2000;
+
+static bool isInside (const String& path, const String& directory)
+{
+    return path == directory || path.startsWith (directory + File::getSeparatorString());
+}
+
+FileIndex::FileIndex()
+    : Thread ("el.fileIndex")
+{
+   #if JUCE_LINUX
+    notifier = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    polling = notifier < 0;
+   #endif
+    startThread (2);
+}
+
+FileIndex::~FileIndex()
+{
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+
+   #if JUCE_LINUX
+    if (notifier >= 0)
+        ::close (notifier);
+   #endif
+}
+
+void FileIndex::addDirectory (const File& directory)
+{
+    const auto path = directory.getFullPathName();
+    const ScopedLock sl (lock);
+    if (roots.contains (path))
+        return;
+
+    roots.add (path);
+    pending.add (path);
+    idle.reset();
+    notify();
+}
+
+void FileIndex::removeDirectory (const File& directory)
+{
+    const auto path = directory.getFullPathName();
+    const ScopedLock sl (lock);
+    roots.removeString (path);
+    pending.removeString (path);
+
+    for (const auto& root : roots)
+        if (isInside (path, root))
+            return;
+
+    forget (path);
+
+    // directories added below this one have to be read again
+    for (const auto& root : roots)
+    {
+        if (isInside (root, path))
+        {
+            pending.addIfNotAlreadyThere (root);
+            idle.reset();
+            notify();
+        }
+    }
+}
+
+bool FileIndex::isIndexed (const File& directory) const
+{
+    const ScopedLock sl (lock);
+    return folders.find (directory.getFullPathName()) != folders.end();
+}
+
+void FileIndex::findFiles (const File& directory, bool recursive, const String& wildcard,
+                           Array<File>& results)
+{
+    const auto path = directory.getFullPathName();
+    if (! isIndexed (directory))
+    {
+        if (! directory.isDirectory())
+            return;
+
+        addDirectory (directory);
+        {
+            const ScopedLock sl (lock);
+            pending.removeString (path);
+        }
+        update (directory);
+    }
+
+    StringArray patterns;
+    patterns.addTokens (wildcard, ";,", "\"'");
+    patterns.trim();
+    patterns.removeEmptyStrings();
+    if (patterns.isEmpty())
+        patterns.add ("*");
+
+    const bool ignoreCase = ! File::areFileNamesCaseSensitive();
+    auto addMatches = [&] (const Folder& folder)
+    {
+        for (const auto& file : folder.files)
+        {
+            const auto name = file.getFileName();
+            for (const auto& pattern : patterns)
+            {
+                if (name.matchesWildcard (pattern, ignoreCase))
+                {
+                    results.add (file);
+                    break;
+                }
+            }
+        }
+    };
+
+    const ScopedLock sl (lock);
+    if (! recursive)
+    {
+        const auto iter = folders.find (path);
+        if (iter != folders.end())
+            addMatches (iter->second);
+        return;
+    }
+
+    // folders below a path sort right after it
+    for (auto iter = folders.lower_bound (path); iter != folders.end() && iter->first.startsWith (path); ++iter)
+        if (isInside (iter->first, path))
+            addMatches (iter->second);
+}
+
+void FileIndex::findFolders (const File& directory, Array<File>& results)
+{
+    if (! isIndexed (directory))
+    {
+        Array<File> files;
+        findFiles (directory, false, "*", files);
+    }
+
+    const ScopedLock sl (lock);
+    const auto iter = folders.find (directory.getFullPathName());
+    if (iter != folders.end())
+        for (const auto& path : iter->second.folders)
+            results.add (File (path));
+}
+
+int FileIndex::getNumFiles() const
+{
+    const ScopedLock sl (lock);
+    int numFiles = 0;
+    for (const auto& folder : folders)
+        numFiles += folder.second.files.size();
+    return numFiles;
+}
+
+void FileIndex::rescan (const File& directory)
+{
+    if (update (directory))
+        sendChangeMessage();
+}
+
+void FileIndex::refresh()
+{
+    {
+        const ScopedLock sl (lock);
+        sweep = true;
+        idle.reset();
+    }
+
+    notify();
+}
+
+bool FileIndex::waitUntilIdle (int timeoutMs)
+{
+    return idle.wait (timeoutMs);
+}
+
+bool FileIndex::update (const File& directory)
+{
+    const auto path = directory.getFullPathName();
+    if (! directory.isDirectory())
+    {
+        const ScopedLock sl (lock);
+        if (folders.find (path) == folders.end())
+            return false;
+        forget (path);
+        return true;
+    }
+
+    Folder folder;
+    folder.modified = directory.getLastModificationTime();
+
+    bool isFolder = false, isHidden = false;
+    for (DirectoryIterator iter (directory, false, "*", File::findFilesAndDirectories);
+         iter.next (&isFolder, &isHidden, nullptr, nullptr, nullptr, nullptr);)
+    {
+        const auto file = iter.getFile();
+        if (isHidden || file.getFileName().startsWithChar ('.'))
+            continue;
+
+        if (isFolder)
+            folder.folders.add (file.getFullPathName());
+        else
+            folder.files.add (file);
+    }
+
+    folder.files.sort();
+    folder.folders.sort (false);
+
+    StringArray added;
+    {
+        const ScopedLock sl (lock);
+        auto& existing = folders [path];
+        if (existing.modified == folder.modified && existing.files == folder.files
+            && existing.folders == folder.folders)
+            return false;
+
+        for (const auto& child : existing.folders)
+            if (! folder.folders.contains (child))
+                forget (child);
+        for (const auto& child : folder.folders)
+            if (! existing.folders.contains (child))
+                added.add (child);
+
+        folder.watch = existing.watch;
+        existing = folder;
+        if (existing.watch < 0)
+            watch (path, existing);
+    }
+
+    for (const auto& child : added)
+    {
+        if (threadShouldExit())
+            break;
+        update (File (child));
+    }
+
+    return true;
+}
+
+void FileIndex::forget (const String& path)
+{
+    auto iter = folders.lower_bound (path);
+    while (iter != folders.end() && iter->first.startsWith (path))
+    {
+        if (! isInside (iter->first, path))
+        {
+            ++iter;
+            continue;
+        }
+
+       #if JUCE_LINUX
+        if (iter->second.watch >= 0)
+        {
+            inotify_rm_watch (notifier, iter->second.watch);
+            watches.remove (iter->second.watch);
+        }
+       #endif
+
+        iter = folders.erase (iter);
+    }
+}
+
+bool FileIndex::checkForChanges()
+{
+    StringArray paths;
+    Array<int64> times;
+    {
+        const ScopedLock sl (lock);
+        for (const auto& folder : folders)
+        {
+            paths.add (folder.first);
+            times.add (folder.second.modified.toMilliseconds());
+        }
+    }
+
+    // one stat per folder; only the ones that changed are read again
+    bool changed = false;
+    for (int i = 0; i < paths.size() && ! threadShouldExit(); ++i)
+    {
+        const File directory (paths [i]);
+        if (! directory.isDirectory() || directory.getLastModificationTime().toMilliseconds() != times [i])
+            changed = update (directory) || changed;
+    }
+
+    return changed;
+}
+
+void FileIndex::watch (const String& path, Folder& folder)
+{
+   #if JUCE_LINUX
+    if (notifier < 0)
+        return;
+
+    folder.watch = inotify_add_watch (notifier, path.toRawUTF8(),
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (folder.watch >= 0)
+        watches.set (folder.watch, path);
+    else
+        polling = true; // probably out of watches, so fall back to polling
+   #else
+    ignoreUnused (path, folder);
+   #endif
+}
+
+void FileIndex::readNotifications (int timeoutMs)
+{
+   #if JUCE_LINUX
+    if (notifier < 0)
+    {
+        wait (timeoutMs);
+        return;
+    }
+
+    pollfd fd = { notifier, POLLIN, 0 };
+    if (::poll (&fd, 1, timeoutMs) <= 0)
+        return;
+
+    alignas (inotify_event) char buffer [8192];
+    for (;;)
+    {
+        const auto numRead = ::read (notifier, buffer, sizeof (buffer));
+        if (numRead <= 0)
+            break;
+
+        const ScopedLock sl (lock);
+        for (const char* ptr = buffer; ptr < buffer + numRead;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*> (ptr);
+            ptr += sizeof (inotify_event) + event->len;
+
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+                sweep = true;
+            else if (watches.contains (event->wd))
+                dirty.addIfNotAlreadyThere (watches [event->wd]);
+            idle.reset();
+        }
+    }
+   #else
+    wait (timeoutMs);
+   #endif
+}
+
+void FileIndex::run()
+{
+    while (! threadShouldExit())
+    {
+        StringArray toScan, toUpdate;
+        bool shouldSweep = false;
+        {
+            const ScopedLock sl (lock);
+            toScan.swapWith (pending);
+            toUpdate.swapWith (dirty);
+            const auto now = Time::getMillisecondCounter();
+            shouldSweep = sweep || (polling && now - lastSweep >= (uint32) pollIntervalMs);
+            if (shouldSweep)
+                lastSweep = now;
+            sweep = false;
+        }
+
+        bool changed = false;
+        for (const auto& path : toScan)
+            changed = update (File (path)) || changed;
+        for (const auto& path : toUpdate)
+            changed = update (File (path)) || changed;
+        if (shouldSweep)
+            changed = checkForChanges() || changed;
+
+        if (changed && ! threadShouldExit())
+            sendChangeMessage();
+
+        {
+            const ScopedLock sl (lock);
+            if (pending.isEmpty() && dirty.isEmpty() && ! sweep)
+                idle.signal();
+        }
+
+        readNotifications (notifier >= 0 ? 250 : pollIntervalMs);
+    }
+
+    idle.signal();
+}
+
+}
@@ -0,0 +1,103 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** An in-memory index of the files below a set of directories.
+
+    Directories are scanned on a background thread and kept up to date from
+    then on, so asking for the files in them doesn't touch the disk. On Linux
+    changes are picked up from inotify as they happen. Elsewhere folders are
+    polled, one stat each, and only the ones that changed are read again.
+    A change message is sent whenever the index changes.
+
+    There is one index for the app, shared through a SharedResourcePointer.
+ */
+class FileIndex : public ChangeBroadcaster,
+                  private Thread
+{
+public:
+    FileIndex();
+    ~FileIndex();
+
+    /** Adds a directory, and everything below it, to the index */
+    void addDirectory (const File& directory);
+
+    /** Stops indexing a directory that was added */
+    void removeDirectory (const File& directory);
+
+    /** Returns true once a directory is in the index */
+    bool isIndexed (const File& directory) const;
+
+    /** Finds indexed files matching a list of wildcards like "*.wav;*.aif".
+        A directory not indexed yet is added and scanned on the calling thread
+        first */
+    void findFiles (const File& directory, bool recursive, const String& wildcard,
+                    Array<File>& results);
+
+    /** Finds the indexed folders directly inside a directory */
+    void findFolders (const File& directory, Array<File>& results);
+
+    /** Returns the number of files in the index */
+    int getNumFiles() const;
+
+    /** Reads a directory again on the calling thread, for when a file was
+        just written to it and has to be found straight away */
+    void rescan (const File& directory);
+
+    /** Checks for changes now instead of at the next poll */
+    void refresh();
+
+    /** Blocks until the background thread has nothing left to do. Returns false
+        if that didn't happen in time */
+    bool waitUntilIdle (int timeoutMs = -1);
+
+private:
+    struct Folder
+    {
+        Time modified;
+        Array<File> files;
+        StringArray folders;
+        int watch = -1;
+    };
+
+    mutable CriticalSection lock;
+    std::map<String, Folder> folders;
+    StringArray roots, pending, dirty;
+    HashMap<int, String> watches;
+    int notifier = -1;
+    bool polling = true, sweep = false;
+    uint32 lastSweep = 0;
+    WaitableEvent idle { true };
+
+    bool update (const File& directory);
+    void forget (const String& path);
+    bool checkForChanges();
+    void watch (const String& path, Folder& folder);
+    void readNotifications (int timeoutMs);
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (FileIndex)
+};
+
+}
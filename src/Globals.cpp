@@ -17,7 +17,11 @@
 */
 
 #include "ElementApp.h"
+#include "db/Database.h"
+#include "engine/AudioCache.h"
 #include "engine/InternalFormat.h"
+#include "engine/JackEngineClient.h"
+#include "scripting/LuaBytecodeCache.h"
 #include "scripting/LuaEngine.h"
 #include "session/DeviceManager.h"
 #include "session/MediaManager.h"
@@ -25,6 +29,7 @@
 #include "session/Presets.h"
 #include "session/Session.h"
 #include "Settings.h"
+#include "StartupTimeline.h"
 #include "URIs.h"
 #include "session/CommandManager.h"
 #include "Globals.h"
@@ -34,6 +39,9 @@ namespace Element {
 static void buildCommandLine (CommandLine& cli, const String& c)
 {
     cli.fullScreen = c.contains ("--full-screen");
+    cli.jackTransport = c.contains ("--jack-transport");
+    cli.nativeJack = cli.jackTransport || c.contains ("--jack");
+    cli.headless = c.contains ("--headless");
     const var port = c.fromFirstOccurrenceOf("--port=", false, false)
                       .upToFirstOccurrenceOf(" ", false, false);
     if (port.isInt() || port.isInt64())
@@ -43,6 +51,9 @@ static void buildCommandLine (CommandLine& cli, const String& c)
 CommandLine::CommandLine (const String& c)
     : fullScreen (false),
       port (3123),
+      nativeJack (false),
+      jackTransport (false),
+      headless (false),
       commandLine (c)
 {
     if (c.isNotEmpty())
@@ -58,6 +69,7 @@ public:
     ~Impl() { }
 
     Globals& owner;
+    StartupTimeline               startup;
     AudioEnginePtr                engine;
     SessionPtr                    session;
     
@@ -67,30 +79,65 @@ public:
     ScopedPointer<PluginManager>  plugins;
     ScopedPointer<Settings>       settings;
     std::unique_ptr<MappingEngine> mapping;
+    std::unique_ptr<Database>     database;
     std::unique_ptr<PresetCollection> presets;
     std::unique_ptr<MidiEngine>   midi;
     std::unique_ptr<LuaEngine>    lua;
+    SharedResourcePointer<AudioCache> audioCache;
+    SharedResourcePointer<LuaBytecodeCache> luaCache;
+   #if EL_USE_JACK
+    std::unique_ptr<JackEngineClient> jack;
+   #endif
    
 private:
     friend class Globals;
     
     void init()
     {
+        StartupTimeline::ScopedPhase phase (startup, "globals");
+
         plugins  = new PluginManager();
         devices  = new DeviceManager();
         media    = new MediaManager();
         settings = new Settings();
+        audioCache->setBudget ((int64) settings->getAudioCacheBudget() * 1024 * 1024);
         commands = new CommandManager();
         session  = new Session();
         mapping.reset (new MappingEngine());
         midi.reset (new MidiEngine());
-        presets.reset (new PresetCollection());
+        database.reset (new Database());
+        // the catalog and compiled scripts are read while the rest starts,
+        // the database is waited for when it's first asked for
+        auto* const db = database.get();
+        startup.launch ("catalog", [db]() { db->load (Database::getDefaultFile()); });
+        auto* const cache = luaCache.get();
+        startup.launch ("scripts", [cache]() { cache->preload(); });
         lua.reset (new LuaEngine());
         lua->setWorld (owner);
     }
     
+    Database& getDatabase()
+    {
+        startup.waitFor ("catalog");
+        return *database;
+    }
+
+    PresetCollection& getPresets()
+    {
+        if (presets == nullptr)
+            presets.reset (new PresetCollection (getDatabase()));
+        return *presets;
+    }
+
     void freeAll()
     {
+        startup.waitForAll();
+
+        // script tasks listen to the MIDI engine and hold the session
+        lua      = nullptr;
+       #if EL_USE_JACK
+        jack     = nullptr;
+       #endif
         commands = nullptr;
         plugins  = nullptr;
         settings = nullptr;
@@ -100,7 +147,7 @@ private:
         devices  = nullptr;
         midi     = nullptr;
         presets  = nullptr;
-        lua      = nullptr;
+        database = nullptr;
     }
 };
 
@@ -162,10 +209,20 @@ PluginManager& Globals::getPluginManager()
     return *impl->plugins;
 }
 
+Database& Globals::getDatabase()
+{
+    jassert (impl->database != nullptr);
+    return impl->getDatabase();
+}
+
 PresetCollection& Globals::getPresetCollection() 
 {
-    jassert (impl->presets != nullptr);
-    return *impl->presets;
+    return impl->getPresets();
+}
+
+StartupTimeline& Globals::getStartupTimeline()
+{
+    return impl->startup;
 }
 
 Settings& Globals::getSettings()
@@ -183,8 +240,28 @@ void Globals::setEngine (AudioEnginePtr engine)
 {
     if (impl->engine)
         impl->engine->deactivate();
+   #if EL_USE_JACK
+    impl->jack = nullptr;
+   #endif
     impl->engine = engine;
-    
+
+   #if EL_USE_JACK
+    if (cli.nativeJack && engine != nullptr)
+    {
+        impl->jack.reset (new JackEngineClient (*engine));
+        impl->jack->setFollowTransport (cli.jackTransport);
+        const auto result = impl->jack->open();
+        if (result.wasOk())
+        {
+            getDeviceManager().closeAudioDevice();
+            return;
+        }
+
+        Logger::writeToLog ("[EL] " + result.getErrorMessage() + ", using the audio device instead");
+        impl->jack = nullptr;
+    }
+   #endif
+
     getDeviceManager().attach (engine);
 }
 
@@ -29,12 +29,14 @@
 namespace Element {
 
 class CommandManager;
+class Database;
 class DeviceManager;
 class LuaEngine;
 class MediaManager;
 class PluginManager;
 class PresetCollection;
 class Settings;
+class StartupTimeline;
 class Writer;
 
 struct CommandLine
@@ -42,6 +44,9 @@ struct CommandLine
     explicit CommandLine (const String& cli = String());
     bool fullScreen;
     int port;
+    bool nativeJack;        ///< run as a JACK client instead of through a device
+    bool jackTransport;     ///< follow JACK transport when running as a client
+    bool headless;          ///< run without the main window, controlled over OSC and Lua
     
     const String commandLine;
 };
@@ -56,6 +61,7 @@ public:
 
     AudioEnginePtr getAudioEngine() const;
     CommandManager& getCommandManager();
+    Database& getDatabase();
     DeviceManager& getDeviceManager();
     MappingEngine& getMappingEngine();
     MidiEngine& getMidiEngine();
@@ -66,6 +72,9 @@ public:
     LuaEngine& getLuaEngine();
     SessionPtr getSession();
 
+    /** Returns the timeline startup phases are reported on */
+    StartupTimeline& getStartupTimeline();
+
     const String& getAppName() const { return appName; }
     void setEngine (AudioEnginePtr engine);
 
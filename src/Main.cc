@@ -25,6 +25,7 @@
 #include "engine/InternalFormat.h"
 #include "engine/GraphProcessor.h"
 #include "session/DeviceManager.h"
+#include "session/PluginBridge.h"
 #include "session/PluginManager.h"
 #include "Commands.h"
 #include "DataPath.h"
@@ -32,6 +33,7 @@
 #include "Messages.h"
 #include "Version.h"
 #include "Settings.h"
+#include "StartupTimeline.h"
 #include "Utils.h"
 
 namespace Element {
@@ -57,21 +59,8 @@ public:
         ignoreUnused (path);
         
         updateSettingsIfNeeded();
+        openDevices();
 
-        DeviceManager& devices (world.getDeviceManager());
-        auto* props = settings.getUserSettings();
-        if (auto dxml = props->getXmlValue ("devices"))
-        {
-            devices.initialise (DeviceManager::maxAudioChannels,
-                                DeviceManager::maxAudioChannels, 
-                                dxml.get(), true, "default", nullptr);
-        }
-        else
-        {
-            devices.initialiseWithDefaultDevices (DeviceManager::maxAudioChannels,
-                                                  DeviceManager::maxAudioChannels);
-        }
-        
         if (usingThread)
         {
             startThread();
@@ -96,6 +85,31 @@ private:
     const bool usingThread;
     const bool showSplash;
     bool isFirstRun;
+
+    void openDevices()
+    {
+        // devices open while the catalog and scripts load on the pool
+        StartupTimeline::ScopedPhase phase (world.getStartupTimeline(), "devices");
+        Settings& settings (world.getSettings());
+        DeviceManager& devices (world.getDeviceManager());
+        auto* props = settings.getUserSettings();
+        if (auto dxml = props->getXmlValue ("devices"))
+        {
+            // only the last used driver is probed now, the rest after launch
+            devices.setInitialDeviceType (dxml->getStringAttribute ("deviceType"));
+            devices.initialise (DeviceManager::maxAudioChannels,
+                                DeviceManager::maxAudioChannels, 
+                                dxml.get(), true, "default", nullptr);
+        }
+        else
+        {
+            devices.initialiseWithDefaultDevices (DeviceManager::maxAudioChannels,
+                                                  DeviceManager::maxAudioChannels);
+        }
+
+        devices.setAggregateDevices (settings.getAggregateDevices());
+        devices.scanDeferredDeviceTypes();
+    }
     
     class StartupScreen :  public SplashScreen
     {
@@ -143,15 +157,37 @@ private:
     void run() override
     {
         Settings& settings (world.getSettings());
-        AudioEnginePtr engine = new AudioEngine (world);
-        engine->applySettings (settings);
-        world.setEngine (engine); // this will also instantiate the session
-        controller = new AppController (world);
+        auto& timeline (world.getStartupTimeline());
+
+        {
+            StartupTimeline::ScopedPhase phase (timeline, "engine");
+            AudioEnginePtr engine = new AudioEngine (world);
+            engine->applySettings (settings);
+            world.setEngine (engine); // this will also instantiate the session
+        }
 
-        setupPlugins();
-        setupKeyMappings();
-        setupAudioEngine();
-        setupMidiEngine();
+        {
+            StartupTimeline::ScopedPhase phase (timeline, "controllers");
+            controller = new AppController (world);
+        }
+
+        {
+            StartupTimeline::ScopedPhase phase (timeline, "plugins");
+            setupPlugins();
+        }
+
+        {
+            StartupTimeline::ScopedPhase phase (timeline, "midi");
+            setupKeyMappings();
+            setupAudioEngine();
+            setupMidiEngine();
+        }
+
+        {
+            // usually loaded by now, presets are kept in the database
+            StartupTimeline::ScopedPhase phase (timeline, "catalog wait");
+            world.getPresetCollection();
+        }
 
         sendActionMessage ("finishedLaunching");
     }
@@ -222,6 +258,10 @@ public:
 
         initializeModulePath();
         printCopyNotice();
+       #if JUCE_MAC
+        if (world->cli.headless)
+            Process::setDockIconVisible (false);
+       #endif
         launchApplication();
     }
     
@@ -247,6 +287,8 @@ public:
 
         controller->saveSettings();
         controller->deactivate();
+        plugins.clearInstancePool();
+        plugins.shutdownPluginHosts();
         
         plugins.saveUserPlugins (settings);
         midi.writeSettings (settings);
@@ -270,6 +312,22 @@ public:
             Application::quit();
             return;
         }
+
+        if (world->cli.headless)
+        {
+            // nobody to ask, keep what has somewhere to go
+           #if defined (EL_PRO)
+            auto* sc = controller->findChild<SessionController>();
+            if (sc->getSessionFile().existsAsFile())
+                sc->saveSession (false, false, false);
+           #else
+            auto* gc = controller->findChild<GraphController>();
+            if (gc->hasGraphChanged() && gc->getGraphFile().existsAsFile())
+                gc->saveGraph (false);
+           #endif
+            Application::quit();
+            return;
+        }
         
        #if defined (EL_PRO)
         auto* sc = controller->findChild<SessionController>();
@@ -378,6 +436,10 @@ public:
         
         controller->run();
 
+        auto& timeline (world->getStartupTimeline());
+        timeline.waitForAll();
+        Logger::writeToLog ("[EL] " + timeline.toString());
+
        #ifndef EL_FREE
         if (world->getSettings().checkForUpdates())
             CurrentVersion::checkAfterDelay (12 * 1000, false);
@@ -417,19 +479,17 @@ private:
     {
         slaves.clearQuick (true);
         slaves.add (world->getPluginManager().createAudioPluginScannerSlave());
-        StringArray processIds = { EL_PLUGIN_SCANNER_PROCESS_ID };
-        for (auto* slave : slaves)
+        slaves.add (world->getPluginManager().createPluginHostSlave());
+        StringArray processIds = { EL_PLUGIN_SCANNER_PROCESS_ID, EL_PLUGIN_HOST_PROCESS_ID };
+        for (int i = 0; i < slaves.size(); ++i)
         {
-            for (const auto& pid : processIds)
+            if (slaves.getUnchecked(i)->initialiseFromCommandLine (commandLine, processIds [i]))
             {
-                if (slave->initialiseFromCommandLine (commandLine, pid))
-                {
-				   #if JUCE_MAC
-                    Process::setDockIconVisible (false);
-				   #endif
-                    juce::shutdownJuce_GUI();
-                    return true;
-                }
+			   #if JUCE_MAC
+                Process::setDockIconVisible (false);
+			   #endif
+                juce::shutdownJuce_GUI();
+                return true;
             }
         }
         
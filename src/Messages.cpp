@@ -73,8 +73,12 @@ public:
         Node mutableNode (node);
         mutableNode.savePluginState();
         node.getRelativePosition (x, y);
-        nodeData = node.getValueTree().createCopy();
-        Node::sanitizeRuntimeProperties (nodeData);
+        nodeData = app.getUndoStateStore().store (node.getValueTree());
+    }
+
+    int getSizeInUnits() override
+    {
+        return jmax (10, nodeData.getSizeInBytes());
     }
     
     bool perform() override
@@ -89,7 +93,7 @@ public:
         auto& ec = *app.findChild<EngineController>();
         bool handled = true;
 
-        const Node newNode (nodeData, false);
+        const Node newNode (nodeData.restore(), false);
         auto createdNode (ec.addNode (newNode, targetGraph, builder));
         createdNode.setRelativePosition (x, y); // TODO: GraphManager should handle this
 
@@ -102,7 +106,7 @@ public:
 
 private:
     AppController& app;
-    ValueTree nodeData;
+    UndoStateStore::Snapshot nodeData;
     const Node targetGraph;
     const Uuid nodeUuid;
     ConnectionBuilder builder;
@@ -21,6 +21,7 @@
 #include "ElementApp.h"
 #include "session/ControllerDevice.h"
 #include "session/Node.h"
+#include "session/Presets.h"
 
 namespace Element {
 
@@ -72,6 +73,16 @@ struct AddPresetMessage : public AppMessage
     const String name;
 };
 
+/** Send this to load a preset into a node */
+struct LoadPresetMessage : public AppMessage
+{
+    LoadPresetMessage (const Node& n, const PresetDescription& p)
+        : node (n), preset (p) { }
+    ~LoadPresetMessage() noexcept { }
+    const Node node;
+    const PresetDescription preset;
+};
+
 /** Send this to remove a node from the current graph */
 struct RemoveNodeMessage : public AppMessage
 {
@@ -231,6 +242,16 @@ public:
     const bool audio, midi;
 };
 
+/** Moves a node's plugin to another process, or back into the engine */
+class BridgeNodeMessage : public Message
+{
+public:
+    BridgeNodeMessage (const Node& n, const String& g)
+        : Message(), node (n), group (g) { }
+    const Node node;
+    const String group;
+};
+
 struct FinishedLaunchingMessage : public AppMessage
 {
     FinishedLaunchingMessage() { }
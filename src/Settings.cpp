@@ -16,13 +16,19 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "engine/RenderThreadPool.h"
 #include "gui/Workspace.h"
 #include "session/DeviceManager.h"
+#include "session/PluginInstancePool.h"
+#include "session/PluginManager.h"
 #include "Globals.h"
 #include "Settings.h"
 
 namespace Element {
 
+/** How long changes wait for more before they're written */
+static const int saveDelayMs = 1000;
+
 const char* Settings::checkForUpdatesKey        = "checkForUpdates";
 const char* Settings::pluginFormatsKey          = "pluginFormatsKey";
 const char* Settings::pluginWindowOnTopDefault  = "pluginWindowOnTopDefault";
@@ -41,6 +47,30 @@ const char* Settings::midiEngineKey             = "midiEngine";
 const char* Settings::oscHostPortKey            = "oscHostPortKey";
 const char* Settings::oscHostEnabledKey         = "oscHostEnabledKey";
 const char* Settings::systrayKey                = "systrayKey";
+const char* Settings::renderThreadsKey          = "renderThreadsKey";
+const char* Settings::meterRefreshRateKey       = "meterRefreshRateKey";
+const char* Settings::xrunTracingKey            = "xrunTracingKey";
+const char* Settings::timelineTracingKey        = "timelineTracingKey";
+const char* Settings::idleSuspendTimeKey        = "idleSuspendTimeKey";
+const char* Settings::warmUpBlocksKey           = "warmUpBlocksKey";
+const char* Settings::preloadGraphsKey          = "preloadGraphsKey";
+const char* Settings::midiEventBudgetKey        = "midiEventBudgetKey";
+const char* Settings::audioCacheBudgetKey       = "audioCacheBudgetKey";
+const char* Settings::realtimeRenderThreadsKey  = "realtimeRenderThreadsKey";
+const char* Settings::pinRenderThreadsKey       = "pinRenderThreadsKey";
+const char* Settings::lockMemoryKey             = "lockMemoryKey";
+const char* Settings::isolateBackgroundThreadsKey = "isolateBackgroundThreadsKey";
+const char* Settings::pluginScanProcessesKey    = "pluginScanProcessesKey";
+const char* Settings::pluginPoolBudgetKey       = "pluginPoolBudgetKey";
+const char* Settings::lazyNodeLoadingKey        = "lazyNodeLoadingKey";
+const char* Settings::autosaveIntervalKey       = "autosaveIntervalKey";
+const char* Settings::undoMemoryBudgetKey       = "undoMemoryBudgetKey";
+const char* Settings::openGLKey                 = "openGLKey";
+const char* Settings::aggregateDevicesKey       = "aggregateDevicesKey";
+const char* Settings::metricsPortKey            = "metricsPortKey";
+const char* Settings::internalPluginsVersionKey = "internalPluginsVersion";
+const char* Settings::overloadProtectionKey     = "overloadProtection";
+const char* Settings::measuredLatencyKey        = "measuredLatency";
 
 //=============================================================================
 
@@ -106,10 +136,64 @@ Settings::Settings()
     opts.folderName          = "Element";
    #endif
 
+    // the properties never save themselves on the message thread, changes
+    // are handed to the writer instead
+    opts.millisecondsBeforeSaving = -1;
+
     setStorageParameters (opts);
+    if (auto* p = getProps())
+        p->addChangeListener (this);
 }
 
-Settings::~Settings() { }
+Settings::~Settings()
+{
+    const int failures = writer->getNumFailures();
+    flush();
+
+    if (auto* p = getProps())
+    {
+        p->removeChangeListener (this);
+        // closing the file saves it the old way if the last write failed
+        if (writer->getNumFailures() > failures)
+            p->setNeedsToBeSaved (true);
+    }
+}
+
+void Settings::saveIfNeeded()
+{
+    if (auto* p = getProps())
+        if (p->needsToBeSaved() && ! isTimerRunning())
+            startTimer (saveDelayMs);
+}
+
+void Settings::flush()
+{
+    if (auto* p = getProps())
+        if (isTimerRunning() || p->needsToBeSaved())
+            writeChanges();
+    writer->flush();
+}
+
+void Settings::writeChanges()
+{
+    stopTimer();
+    if (auto* p = getProps())
+    {
+        writer->write (*p, getStorageParameters());
+        p->setNeedsToBeSaved (false);
+    }
+}
+
+void Settings::changeListenerCallback (ChangeBroadcaster*)
+{
+    if (! isTimerRunning())
+        startTimer (saveDelayMs);
+}
+
+void Settings::timerCallback()
+{
+    writeChanges();
+}
 
 //=============================================================================
 
@@ -382,6 +466,397 @@ void Settings::setSystrayEnabled (bool enabled)
         p->setValue (systrayKey, enabled);
 }
 
+bool Settings::isOpenGLEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (openGLKey, false);
+    return false;
+}
+
+void Settings::setOpenGLEnabled (bool enabled)
+{
+    if (isOpenGLEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (openGLKey, enabled);
+}
+
+//=============================================================================
+
+int Settings::getNumRenderThreads() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (renderThreadsKey, RenderThreadPool::getDefaultNumWorkers());
+    return RenderThreadPool::getDefaultNumWorkers();
+}
+
+void Settings::setNumRenderThreads (int numThreads)
+{
+    numThreads = jmax (0, numThreads);
+    if (getNumRenderThreads() == numThreads)
+        return;
+    if (auto* p = getProps())
+        p->setValue (renderThreadsKey, numThreads);
+}
+
+int Settings::getNumPluginScanProcesses() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (pluginScanProcessesKey, PluginScanner::getDefaultNumProcesses());
+    return PluginScanner::getDefaultNumProcesses();
+}
+
+void Settings::setNumPluginScanProcesses (int numProcesses)
+{
+    numProcesses = jmax (1, numProcesses);
+    if (getNumPluginScanProcesses() == numProcesses)
+        return;
+    if (auto* p = getProps())
+        p->setValue (pluginScanProcessesKey, numProcesses);
+}
+
+int Settings::getPluginPoolBudget() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (pluginPoolBudgetKey, PluginInstancePool::getDefaultMemoryBudget());
+    return PluginInstancePool::getDefaultMemoryBudget();
+}
+
+void Settings::setPluginPoolBudget (int megabytes)
+{
+    megabytes = jmax (0, megabytes);
+    if (getPluginPoolBudget() == megabytes)
+        return;
+    if (auto* p = getProps())
+        p->setValue (pluginPoolBudgetKey, megabytes);
+}
+
+bool Settings::isLazyNodeLoadingEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (lazyNodeLoadingKey, false);
+    return false;
+}
+
+void Settings::setLazyNodeLoadingEnabled (bool enabled)
+{
+    if (isLazyNodeLoadingEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (lazyNodeLoadingKey, enabled);
+}
+
+int Settings::getAutosaveInterval() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (autosaveIntervalKey, 0);
+    return 0;
+}
+
+void Settings::setAutosaveInterval (int minutes)
+{
+    minutes = jlimit (0, 120, minutes);
+    if (getAutosaveInterval() == minutes)
+        return;
+    if (auto* p = getProps())
+        p->setValue (autosaveIntervalKey, minutes);
+}
+
+int Settings::getUndoMemoryBudget() const
+{
+    if (auto* p = getProps())
+        return jlimit (8, 1024, p->getIntValue (undoMemoryBudgetKey, 64));
+    return 64;
+}
+
+void Settings::setUndoMemoryBudget (int megabytes)
+{
+    megabytes = jlimit (8, 1024, megabytes);
+    if (getUndoMemoryBudget() == megabytes)
+        return;
+    if (auto* p = getProps())
+        p->setValue (undoMemoryBudgetKey, megabytes);
+}
+
+int Settings::getMeterRefreshRate() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (meterRefreshRateKey, 30);
+    return 30;
+}
+
+void Settings::setMeterRefreshRate (int hz)
+{
+    hz = jlimit (1, 120, hz);
+    if (getMeterRefreshRate() == hz)
+        return;
+    if (auto* p = getProps())
+        p->setValue (meterRefreshRateKey, hz);
+}
+
+double Settings::getIdleSuspendTime() const
+{
+    if (auto* p = getProps())
+        return p->getDoubleValue (idleSuspendTimeKey, 0.0);
+    return 0.0;
+}
+
+void Settings::setIdleSuspendTime (double seconds)
+{
+    seconds = jlimit (0.0, 600.0, seconds);
+    if (getIdleSuspendTime() == seconds)
+        return;
+    if (auto* p = getProps())
+        p->setValue (idleSuspendTimeKey, seconds);
+}
+
+int Settings::getNumWarmUpBlocks() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (warmUpBlocksKey, 16);
+    return 16;
+}
+
+void Settings::setNumWarmUpBlocks (int numBlocks)
+{
+    numBlocks = jlimit (0, 256, numBlocks);
+    if (getNumWarmUpBlocks() == numBlocks)
+        return;
+    if (auto* p = getProps())
+        p->setValue (warmUpBlocksKey, numBlocks);
+}
+
+int Settings::getNumPreloadedGraphs() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (preloadGraphsKey, 0);
+    return 0;
+}
+
+void Settings::setNumPreloadedGraphs (int numGraphs)
+{
+    numGraphs = jlimit (0, 32, numGraphs);
+    if (getNumPreloadedGraphs() == numGraphs)
+        return;
+    if (auto* p = getProps())
+        p->setValue (preloadGraphsKey, numGraphs);
+}
+
+int Settings::getMidiEventBudget() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (midiEventBudgetKey, 2048);
+    return 2048;
+}
+
+void Settings::setMidiEventBudget (int maxEvents)
+{
+    maxEvents = jlimit (64, 65536, maxEvents);
+    if (getMidiEventBudget() == maxEvents)
+        return;
+    if (auto* p = getProps())
+        p->setValue (midiEventBudgetKey, maxEvents);
+}
+
+int Settings::getAudioCacheBudget() const
+{
+    if (auto* p = getProps())
+        return p->getIntValue (audioCacheBudgetKey, 256);
+    return 256;
+}
+
+void Settings::setAudioCacheBudget (int megabytes)
+{
+    megabytes = jlimit (0, 8192, megabytes);
+    if (getAudioCacheBudget() == megabytes)
+        return;
+    if (auto* p = getProps())
+        p->setValue (audioCacheBudgetKey, megabytes);
+}
+
+bool Settings::isRealtimeRenderThreadsEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (realtimeRenderThreadsKey, false);
+    return false;
+}
+
+void Settings::setRealtimeRenderThreadsEnabled (bool enabled)
+{
+    if (isRealtimeRenderThreadsEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (realtimeRenderThreadsKey, enabled);
+}
+
+bool Settings::isRenderThreadPinningEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (pinRenderThreadsKey, false);
+    return false;
+}
+
+void Settings::setRenderThreadPinningEnabled (bool enabled)
+{
+    if (isRenderThreadPinningEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (pinRenderThreadsKey, enabled);
+}
+
+bool Settings::isMemoryLockingEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (lockMemoryKey, false);
+    return false;
+}
+
+void Settings::setMemoryLockingEnabled (bool enabled)
+{
+    if (isMemoryLockingEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (lockMemoryKey, enabled);
+}
+
+bool Settings::isBackgroundIsolationEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (isolateBackgroundThreadsKey, false);
+    return false;
+}
+
+void Settings::setBackgroundIsolationEnabled (bool enabled)
+{
+    if (isBackgroundIsolationEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (isolateBackgroundThreadsKey, enabled);
+}
+
+bool Settings::isXrunTracingEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (xrunTracingKey, false);
+    return false;
+}
+
+void Settings::setXrunTracingEnabled (bool enabled)
+{
+    if (isXrunTracingEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (xrunTracingKey, enabled);
+}
+
+bool Settings::isTimelineTracingEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (timelineTracingKey, false);
+    return false;
+}
+
+void Settings::setTimelineTracingEnabled (bool enabled)
+{
+    if (isTimelineTracingEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (timelineTracingKey, enabled);
+}
+
+StringArray Settings::getAggregateDevices() const
+{
+    if (auto* p = getProps())
+        return StringArray::fromLines (p->getValue (aggregateDevicesKey));
+    return {};
+}
+
+void Settings::setAggregateDevices (const StringArray& names)
+{
+    if (getAggregateDevices() == names)
+        return;
+    if (auto* p = getProps())
+        p->setValue (aggregateDevicesKey, names.joinIntoString ("\n"));
+}
+
+//=============================================================================
+
+int Settings::getMetricsPort() const
+{
+    if (auto* p = getProps())
+        return jlimit (0, 65535, p->getIntValue (metricsPortKey, 0));
+    return 0;
+}
+
+void Settings::setMetricsPort (int port)
+{
+    port = jlimit (0, 65535, port);
+    if (getMetricsPort() == port)
+        return;
+    if (auto* p = getProps())
+        p->setValue (metricsPortKey, port);
+}
+
+bool Settings::isOverloadProtectionEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (overloadProtectionKey, false);
+    return false;
+}
+
+void Settings::setOverloadProtectionEnabled (bool enabled)
+{
+    if (isOverloadProtectionEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (overloadProtectionKey, enabled);
+}
+
+//=============================================================================
+
+static bool isMeasurementOf (const XmlElement& e, const String& deviceName, double sampleRate, int bufferSize)
+{
+    return e.getStringAttribute ("name") == deviceName
+        && e.getDoubleAttribute ("sampleRate") == sampleRate
+        && e.getIntAttribute ("bufferSize") == bufferSize;
+}
+
+int Settings::getMeasuredRoundTrip (const String& deviceName, double sampleRate, int bufferSize) const
+{
+    if (auto* p = getProps())
+        if (auto xml = p->getXmlValue (measuredLatencyKey))
+            forEachXmlChildElementWithTagName (*xml, e, "device")
+                if (isMeasurementOf (*e, deviceName, sampleRate, bufferSize))
+                    return e->getIntAttribute ("roundTrip", -1);
+    return -1;
+}
+
+void Settings::setMeasuredRoundTrip (const String& deviceName, double sampleRate, int bufferSize, int samples)
+{
+    auto* p = getProps();
+    if (p == nullptr || deviceName.isEmpty())
+        return;
+
+    std::unique_ptr<XmlElement> xml (p->getXmlValue (measuredLatencyKey));
+    if (xml == nullptr)
+        xml.reset (new XmlElement ("latency"));
+
+    for (int i = xml->getNumChildElements(); --i >= 0;)
+        if (isMeasurementOf (*xml->getChildElement (i), deviceName, sampleRate, bufferSize))
+            xml->removeChildElement (xml->getChildElement (i), true);
+
+    if (samples >= 0)
+    {
+        auto* e = xml->createNewChildElement ("device");
+        e->setAttribute ("name", deviceName);
+        e->setAttribute ("sampleRate", sampleRate);
+        e->setAttribute ("bufferSize", bufferSize);
+        e->setAttribute ("roundTrip", samples);
+    }
+
+    p->setValue (measuredLatencyKey, xml.get());
+}
+
 //=============================================================================
 
 void Settings::addItemsToMenu (Globals& world, PopupMenu& menu)
@@ -19,17 +19,29 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "SettingsWriter.h"
 
 namespace Element {
 
 class Globals;
 
-class Settings :  public ApplicationProperties
+/** The user's settings. Changes are written in the background a moment
+    after they're made, so a burst of them costs a single write. */
+class Settings :  public ApplicationProperties,
+                  private ChangeListener,
+                  private Timer
 {
 public:
     Settings();
     ~Settings();
 
+    /** Queues the user settings to be written in the background. This hides
+        the synchronous ApplicationProperties version */
+    void saveIfNeeded();
+
+    /** Writes changes that are still waiting and blocks until they're on disk */
+    void flush();
+
     static const char* checkForUpdatesKey;
     static const char* pluginListKey;
     static const char* pluginFormatsKey;
@@ -50,6 +62,30 @@ public:
     static const char* oscHostPortKey;
     static const char* oscHostEnabledKey;
     static const char* systrayKey;
+    static const char* renderThreadsKey;
+    static const char* meterRefreshRateKey;
+    static const char* xrunTracingKey;
+    static const char* timelineTracingKey;
+    static const char* idleSuspendTimeKey;
+    static const char* warmUpBlocksKey;
+    static const char* preloadGraphsKey;
+    static const char* midiEventBudgetKey;
+    static const char* audioCacheBudgetKey;
+    static const char* realtimeRenderThreadsKey;
+    static const char* pinRenderThreadsKey;
+    static const char* lockMemoryKey;
+    static const char* isolateBackgroundThreadsKey;
+    static const char* pluginScanProcessesKey;
+    static const char* pluginPoolBudgetKey;
+    static const char* lazyNodeLoadingKey;
+    static const char* autosaveIntervalKey;
+    static const char* undoMemoryBudgetKey;
+    static const char* openGLKey;
+    static const char* aggregateDevicesKey;
+    static const char* metricsPortKey;
+    static const char* internalPluginsVersionKey;
+    static const char* overloadProtectionKey;
+    static const char* measuredLatencyKey;
 
     std::unique_ptr<XmlElement> getLastGraph() const;
     void setLastGraph (const ValueTree& data);
@@ -114,9 +150,115 @@ public:
 
     bool isSystrayEnabled() const;
     void setSystrayEnabled (bool);
+
+    /** The main window is drawn with OpenGL instead of the software renderer */
+    bool isOpenGLEnabled() const;
+    void setOpenGLEnabled (bool);
+
+    /** Number of worker threads used by graphs that render in parallel */
+    int getNumRenderThreads() const;
+    void setNumRenderThreads (int);
+
+    /** Number of level meter readings the engine publishes per second */
+    int getMeterRefreshRate() const;
+    void setMeterRefreshRate (int);
+
+    /** Seconds without input before instruments stop processing, 0 for never */
+    double getIdleSuspendTime() const;
+    void setIdleSuspendTime (double);
+
+    /** Silent blocks rendered through each plugin after a session loads */
+    int getNumWarmUpBlocks() const;
+    void setNumWarmUpBlocks (int);
+
+    /** Graphs after the active one kept loaded for program changes, the rest
+        are unloaded until they come close. 0 keeps every graph loaded */
+    int getNumPreloadedGraphs() const;
+    void setNumPreloadedGraphs (int);
+
+    /** Most MIDI events a buffer carries in one block before the rest are dropped */
+    int getMidiEventBudget() const;
+    void setMidiEventBudget (int);
+
+    /** Megabytes of decoded audio files kept for players to share, 0 to keep only files in use */
+    int getAudioCacheBudget() const;
+    void setAudioCacheBudget (int);
+
+    /** Render workers ask for realtime priority */
+    bool isRealtimeRenderThreadsEnabled() const;
+    void setRealtimeRenderThreadsEnabled (bool);
+
+    /** Render workers are pinned to a core each */
+    bool isRenderThreadPinningEnabled() const;
+    void setRenderThreadPinningEnabled (bool);
+
+    /** The engine's memory is locked in RAM so it can't be paged out */
+    bool isMemoryLockingEnabled() const;
+    void setMemoryLockingEnabled (bool);
+
+    /** Background threads are kept off the render workers' cores */
+    bool isBackgroundIsolationEnabled() const;
+    void setBackgroundIsolationEnabled (bool);
+
+    /** Number of child processes plugin scans are shared between */
+    int getNumPluginScanProcesses() const;
+    void setNumPluginScanProcesses (int);
+
+    /** Megabytes removed plugins may hold while kept for reuse. Zero deletes
+        them straight away */
+    int getPluginPoolBudget() const;
+    void setPluginPoolBudget (int);
+
+    /** Disabled and bypassed plugins aren't loaded with a session until
+        they're switched on */
+    bool isLazyNodeLoadingEnabled() const;
+    void setLazyNodeLoadingEnabled (bool);
+
+    /** Minutes between autosaves of a changed session. Zero disables it */
+    int getAutosaveInterval() const;
+    void setAutosaveInterval (int);
+
+    /** Megabytes the undo history may hold before its oldest steps are dropped */
+    int getUndoMemoryBudget() const;
+    void setUndoMemoryBudget (int);
+
+    /** When enabled, recent audio callback timings are written to the Traces
+        folder whenever a callback overruns */
+    bool isXrunTracingEnabled() const;
+    void setXrunTracingEnabled (bool);
+
+    /** When enabled, the engine's threads record a timeline that can be
+        exported as a Chrome trace */
+    bool isTimelineTracingEnabled() const;
+    void setTimelineTracingEnabled (bool);
+
+    /** Names of the audio devices opened alongside the selected one, their
+        channels following its own */
+    StringArray getAggregateDevices() const;
+    void setAggregateDevices (const StringArray& names);
+
+    /** The port engine metrics are served on over HTTP, zero when off */
+    int getMetricsPort() const;
+    void setMetricsPort (int port);
+
+    /** When enabled, oversampling is lowered and low priority nodes are
+        bypassed while the engine can't keep up */
+    bool isOverloadProtectionEnabled() const;
+    void setOverloadProtectionEnabled (bool);
+
+    /** The round trip measured through a loopback on an audio device, in
+        samples. -1 when it hasn't been measured at this sample rate and
+        buffer size */
+    int getMeasuredRoundTrip (const String& deviceName, double sampleRate, int bufferSize) const;
+    /** Stores a measured round trip, a negative one forgets it */
+    void setMeasuredRoundTrip (const String& deviceName, double sampleRate, int bufferSize, int samples);
     
 private:
+    SharedResourcePointer<SettingsWriter> writer;
     PropertiesFile* getProps() const;
+    void writeChanges();
+    void changeListenerCallback (ChangeBroadcaster*) override;
+    void timerCallback() override;
 };
 
 }
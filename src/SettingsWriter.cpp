@@ -0,0 +1,152 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "SettingsWriter.h"
+
+namespace Element {
+
+SettingsWriter::SettingsWriter()
+    : Thread ("el.settingsWriter")
+{
+    idle.signal();
+}
+
+SettingsWriter::~SettingsWriter()
+{
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+}
+
+void SettingsWriter::write (const File& file, WriteFunction function)
+{
+    {
+        const ScopedLock sl (lock);
+        bool replaced = false;
+        for (auto& job : jobs)
+        {
+            if (job.file == file)
+            {
+                job.function = function;
+                replaced = true;
+                break;
+            }
+        }
+
+        if (! replaced)
+            jobs.add ({ file, function });
+        idle.reset();
+    }
+
+    if (! isThreadRunning())
+        startThread (3);
+    notify();
+}
+
+void SettingsWriter::write (const PropertiesFile& props, const PropertiesFile::Options& options)
+{
+    const auto values = props.getAllProperties();
+    write (props.getFile(), [values, options] (const File& file) {
+        return writeProperties (values, file, options);
+    });
+}
+
+bool SettingsWriter::isWriting() const
+{
+    const ScopedLock sl (lock);
+    return busy || jobs.size() > 0;
+}
+
+bool SettingsWriter::flush (int timeoutMs)
+{
+    return idle.wait (timeoutMs);
+}
+
+int SettingsWriter::getNumFailures() const
+{
+    const ScopedLock sl (lock);
+    return numFailures;
+}
+
+bool SettingsWriter::writeProperties (const StringPairArray& values, const File& file,
+                                      const PropertiesFile::Options& options)
+{
+    // encoded by a PropertiesFile of its own so the layout always matches
+    // what it reads back. It points at a sibling that doesn't exist yet so
+    // the old file isn't read for nothing
+    const auto pending = file.getSiblingFile (file.getFileName() + ".pending");
+    if (pending.exists() && ! pending.deleteFile())
+        return false;
+
+    auto opts = options;
+    opts.millisecondsBeforeSaving = -1;
+    opts.processLock = nullptr;
+
+    bool saved = false;
+    {
+        PropertiesFile props (pending, opts);
+        props.addAllPropertiesFrom (values);
+        saved = props.save();
+    }
+
+    if (saved && pending.moveFileTo (file))
+        return true;
+
+    pending.deleteFile();
+    return false;
+}
+
+void SettingsWriter::run()
+{
+    for (;;)
+    {
+        Job job;
+        bool haveJob = false;
+
+        {
+            const ScopedLock sl (lock);
+            haveJob = jobs.size() > 0;
+            busy = haveJob;
+            if (haveJob)
+            {
+                job = jobs.removeAndReturn (0);
+            }
+            else
+            {
+                idle.signal();
+                if (threadShouldExit())
+                    break;
+            }
+        }
+
+        if (! haveJob)
+        {
+            wait (-1);
+            continue;
+        }
+
+        if (! job.function (job.file))
+        {
+            Logger::writeToLog ("[EL] couldn't write " + job.file.getFullPathName());
+            const ScopedLock sl (lock);
+            ++numFailures;
+        }
+    }
+}
+
+}
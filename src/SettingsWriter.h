@@ -0,0 +1,83 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Writes settings, key mappings and workspaces to disk on a background thread.
+
+    Callers take a cheap snapshot on the message thread and hand it over with
+    a function that encodes and writes it. A write queued for a file that's
+    still waiting replaces the older one, so a burst of changes costs a single
+    write. Files are written next to their target and then moved over it, and
+    queued writes are always finished before this is deleted.
+ */
+class SettingsWriter : private Thread
+{
+public:
+    /** Encodes a snapshot and writes it to the file it's given, returning
+        true if that worked. Called on the writer's thread */
+    using WriteFunction = std::function<bool (const File&)>;
+
+    SettingsWriter();
+    ~SettingsWriter();
+
+    /** Queues a write to a file */
+    void write (const File& file, WriteFunction function);
+
+    /** Queues a copy of a properties file's values to be written to it */
+    void write (const PropertiesFile& props, const PropertiesFile::Options& options);
+
+    /** Returns true while writes are waiting or being done */
+    bool isWriting() const;
+
+    /** Blocks until every queued write has finished. Returns false if that
+        didn't happen in time */
+    bool flush (int timeoutMs = -1);
+
+    /** Returns the number of writes that failed since this was created */
+    int getNumFailures() const;
+
+    /** Writes property values to a file straight away, on the calling thread.
+        The format is whatever the options ask for, so a PropertiesFile opened
+        with them reads it back */
+    static bool writeProperties (const StringPairArray& values, const File& file,
+                                 const PropertiesFile::Options& options);
+
+private:
+    struct Job
+    {
+        File file;
+        WriteFunction function;
+    };
+
+    CriticalSection lock;
+    Array<Job> jobs;
+    bool busy = false;
+    int numFailures = 0;
+    WaitableEvent idle { true };
+
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (SettingsWriter)
+};
+
+}
@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "StartupTimeline.h"
+
+namespace Element {
+
+class StartupTimeline::Task : public ThreadPoolJob
+{
+public:
+    Task (StartupTimeline& t, const String& name, std::function<void()> fn)
+        : ThreadPoolJob (name), timeline (t), task (std::move (fn)) { }
+
+    JobStatus runJob() override
+    {
+        const auto start = Time::getMillisecondCounterHiRes();
+        task();
+        timeline.add (getJobName(), start, Time::getMillisecondCounterHiRes(), true);
+        return jobHasFinished;
+    }
+
+private:
+    StartupTimeline& timeline;
+    std::function<void()> task;
+};
+
+StartupTimeline::StartupTimeline()
+    : origin (Time::getMillisecondCounterHiRes()),
+      pool (jlimit (2, 4, SystemStats::getNumCpus()))
+{ }
+
+StartupTimeline::~StartupTimeline()
+{
+    waitForAll();
+}
+
+void StartupTimeline::launch (const String& name, std::function<void()> task)
+{
+    pool.addJob (tasks.add (new Task (*this, name, std::move (task))), false);
+}
+
+void StartupTimeline::waitFor (const String& name)
+{
+    for (auto* task : tasks)
+        if (task->getJobName() == name)
+            pool.waitForJobToFinish (task, -1);
+}
+
+void StartupTimeline::waitForAll()
+{
+    for (auto* task : tasks)
+        pool.waitForJobToFinish (task, -1);
+}
+
+void StartupTimeline::add (const String& name, double startMs, double endMs, bool parallel)
+{
+    Phase phase;
+    phase.name = name;
+    phase.startMs = startMs - origin;
+    phase.durationMs = jmax (0.0, endMs - startMs);
+    phase.parallel = parallel;
+
+    const ScopedLock sl (lock);
+    int index = phases.size();
+    while (index > 0 && phases.getReference (index - 1).startMs > phase.startMs)
+        --index;
+    phases.insert (index, phase);
+}
+
+Array<StartupTimeline::Phase> StartupTimeline::getPhases() const
+{
+    const ScopedLock sl (lock);
+    return phases;
+}
+
+double StartupTimeline::getTotalMs() const
+{
+    double total = 0.0;
+    for (const auto& phase : getPhases())
+        total = jmax (total, phase.startMs + phase.durationMs);
+    return total;
+}
+
+String StartupTimeline::toString() const
+{
+    String text;
+    text << "startup took " << String (getTotalMs(), 1) << " ms";
+    for (const auto& phase : getPhases())
+    {
+        text << newLine << "    " << phase.name.paddedRight (' ', 14)
+             << String (phase.startMs, 1).paddedLeft (' ', 8) << " ms +"
+             << String (phase.durationMs, 1).paddedLeft (' ', 7) << " ms";
+        if (phase.parallel)
+            text << "  (parallel)";
+    }
+    return text;
+}
+
+}
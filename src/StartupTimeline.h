@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Times the phases of startup and runs the independent ones in parallel.
+
+    Phases on the message thread are timed with a ScopedPhase. Work that
+    needs nothing from the rest of startup is handed to launch(), which
+    runs it on a pool thread while startup carries on, and is waited for by
+    name where its result is first needed. The timeline is reported to the
+    log once the app is running.
+ */
+class StartupTimeline
+{
+public:
+    struct Phase
+    {
+        String name;
+        double startMs = 0.0;       ///< since the timeline was created
+        double durationMs = 0.0;
+        bool parallel = false;      ///< true if it ran on a pool thread
+    };
+
+    StartupTimeline();
+    ~StartupTimeline();
+
+    /** Times a phase for as long as it's in scope */
+    class ScopedPhase
+    {
+    public:
+        ScopedPhase (StartupTimeline& t, const String& n)
+            : timeline (t), name (n), start (Time::getMillisecondCounterHiRes()) { }
+        ~ScopedPhase()      { timeline.add (name, start, Time::getMillisecondCounterHiRes(), false); }
+
+    private:
+        StartupTimeline& timeline;
+        const String name;
+        const double start;
+        JUCE_DECLARE_NON_COPYABLE (ScopedPhase)
+    };
+
+    /** Runs a task on a pool thread. Tasks must not touch anything the
+        message thread may be using */
+    void launch (const String& name, std::function<void()> task);
+
+    /** Blocks until the named task has run. Returns straight away if it
+        has or was never launched. Call this from the message thread */
+    void waitFor (const String& name);
+
+    /** Blocks until every launched task has run */
+    void waitForAll();
+
+    /** Records a phase timed elsewhere */
+    void add (const String& name, double startMs, double endMs, bool parallel);
+
+    /** Returns the phases in the order they started */
+    Array<Phase> getPhases() const;
+
+    /** Returns the milliseconds from the timeline's creation to the end of
+        the last phase */
+    double getTotalMs() const;
+
+    /** Returns a report of every phase, one per line */
+    String toString() const;
+
+private:
+    const double origin;
+    CriticalSection lock;
+    Array<Phase> phases;
+
+    // declared first so the pool is done with the tasks before they go
+    class Task;
+    OwnedArray<Task> tasks;
+    ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE (StartupTimeline)
+};
+
+}
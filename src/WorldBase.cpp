@@ -119,29 +119,35 @@ public:
         return nullptr;
     }
 
+    /** Modules are looked for by name in each directory of the path, so
+        nothing is listed and a module's library is only opened the first
+        time it's asked for */
     Module* loadModule (const char* name)
     {
-        FileSearchPath emodPath (getenv ("ELEMENT_MODULE_PATH"));
-
-        if (! (emodPath.getNumPaths() > 0))
+        if (modulePath.getNumPaths() <= 0)
         {
-            Logger::writeToLog ("[element] setting module paths");
-            File p = String("/usr/local/lib/element/modules");
-            emodPath.add (p);
+            modulePath = FileSearchPath (getenv ("ELEMENT_MODULE_PATH"));
+            if (modulePath.getNumPaths() <= 0)
+            {
+                Logger::writeToLog ("[element] setting module paths");
+                modulePath.add (File (String ("/usr/local/lib/element/modules")));
+            }
         }
 
-        Array<File> modules;
-        String module = name; module << ".element";
-        emodPath.findChildFiles (modules, File::findDirectories, false, module);
-
-        if (modules.size() > 0)
-            return loadModule (name, modules.getFirst());
+        const String module = String (name) + ".element";
+        for (int i = 0; i < modulePath.getNumPaths(); ++i)
+        {
+            const auto dir = modulePath[i].getChildFile (module);
+            if (dir.isDirectory())
+                return loadModule (name, dir);
+        }
 
         return nullptr;
     }
 
     ModuleMap mods;
     ModuleHost host;
+    FileSearchPath modulePath;
 };
 
 
@@ -24,6 +24,8 @@
 #include "controllers/GraphManager.h"
 #include "controllers/GraphController.h"
 #include "controllers/MappingController.h"
+#include "controllers/MetricsController.h"
+#include "controllers/OverloadController.h"
 #include "controllers/OSCController.h"
 #include "controllers/SessionController.h"
 #include "controllers/PresetsController.h"
@@ -38,6 +40,7 @@
 #include "Globals.h"
 #include "Messages.h"
 #include "Settings.h"
+#include "StartupTimeline.h"
 #include "Version.h"
 
 namespace Element {
@@ -56,8 +59,12 @@ AppController::AppController (Globals& g)
     addChild (new SessionController());
     addChild (new GraphController());
     addChild (new ScriptingController());
-    addChild (new WorkspacesController());
+    // workspaces only arrange the main window's views
+    if (! g.cli.headless)
+        addChild (new WorkspacesController());
     addChild (new OSCController());
+    addChild (new MetricsController());
+    addChild (new OverloadController());
 
     lastExportedGraph = DataPath::defaultGraphDir();
 
@@ -88,9 +95,18 @@ void AppController::activate()
         recentFiles.restoreFromString (stream.readEntireStreamAsString());
     }
 
+    updateUndoBudget();
     Controller::activate();
 }
 
+void AppController::updateUndoBudget()
+{
+    // actions report their size in bytes, the oldest transactions beyond the
+    // budget are dropped though a few recent ones are always kept
+    const int megabytes = world.getSettings().getUndoMemoryBudget();
+    undo.setMaxNumberOfStoredUnits (megabytes * 1024 * 1024, 4);
+}
+
 void AppController::deactivate()
 {
     licenseRefreshedConnection.disconnect();
@@ -106,15 +122,24 @@ void AppController::deactivate()
 
 void AppController::run()
 {
-    activate();
+    auto& timeline (world.getStartupTimeline());
+    {
+        StartupTimeline::ScopedPhase phase (timeline, "activate");
+        activate();
+    }
     
     // need content component parented for the following init routines
     // TODO: better controlled startup procedure
     if (auto* gui = findChild<GuiController>())
+    {
+        StartupTimeline::ScopedPhase phase (timeline, "gui");
         gui->run();
+    }
 
     auto session = getWorld().getSession();
     Session::ScopedFrozenLock freeze (*session);
+    std::unique_ptr<StartupTimeline::ScopedPhase> loading (
+        new StartupTimeline::ScopedPhase (timeline, "session"));
     
    #if EL_PRO
     if (auto* sc = findChild<SessionController>())
@@ -152,8 +177,11 @@ void AppController::run()
     }
    #endif
 
+    loading.reset();
+
     if (auto* gui = findChild<GuiController>())
     {
+        StartupTimeline::ScopedPhase phase (timeline, "views");
         gui->stabilizeContent();
         const Node graph (session->getCurrentGraph());
         auto* const props = getGlobals().getSettings().getUserSettings();
@@ -163,7 +191,7 @@ void AppController::run()
             // don't show plugin windows on load if the UI was hidden
             // TODO: cleanup the boot up process for UI visibility
             if (props->getBoolValue ("mainWindowVisible", true))
-                gui->showPluginWindowsFor (graph);
+                gui->showPluginWindowsWhenRunning (graph);
         }
     }
 }
@@ -186,6 +214,9 @@ void AppController::handleMessage (const Message& msg)
         message->createActions (*this, actions);
         if (! actions.isEmpty())
         {
+            // several edits reach the engine in one go
+            Session::ScopedBatch batch (*getWorld().getSession());
+            updateUndoBudget();
             undo.beginNewTransaction();
             for (auto* action : actions)
                 undo.perform (action);
@@ -235,6 +266,10 @@ void AppController::handleMessage (const Message& msg)
         ec->disconnectNode (dnm2->node, dnm2->inputs, dnm2->outputs,
                                         dnm2->audio, dnm2->midi);
     }
+    else if (const auto* bnm = dynamic_cast<const BridgeNodeMessage*> (&msg))
+    {
+        ec->setNodeBridgeGroup (bnm->node, bnm->group);
+    }
     else if (const auto* aps = dynamic_cast<const AddPresetMessage*> (&msg))
     {
         String name = aps->name;
@@ -257,6 +292,10 @@ void AppController::handleMessage (const Message& msg)
             node.setProperty (Tags::name, name);
         }
     }
+    else if (const auto* lpm = dynamic_cast<const LoadPresetMessage*> (&msg))
+    {
+        presets->load (lpm->node, lpm->preset);
+    }
     else if (const auto* anm = dynamic_cast<const AddNodeMessage*> (&msg))
     {
         if (anm->target.isValid ())
@@ -598,7 +637,7 @@ void AppController::checkForegroundStatus()
             }
             else if (! foreground)
             {
-                gui.closeAllPluginWindows();
+                gui.hideAllPluginWindows();
             }
             
             sIsForeground = foreground;
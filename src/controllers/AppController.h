@@ -21,6 +21,7 @@
 
 #include "controllers/Controller.h"
 #include "session/CommandManager.h"
+#include "session/UndoStateStore.h"
 
 namespace Element {
 
@@ -50,6 +51,9 @@ public:
     /** Returns the undo manager */
     inline UndoManager& getUndoManager() { return undo; }
 
+    /** Returns where undo actions keep node data */
+    inline UndoStateStore& getUndoStateStore() { return undoStates; }
+
     /** Child controllers should use this when files are opened and need
         to be saved in recent files.
     */
@@ -111,7 +115,9 @@ private:
     Globals& world;
     CommandManager commands;
     RecentlyOpenedFilesList recentFiles;
+    UndoStateStore undoStates;
     UndoManager undo;
+    void updateUndoBudget();
     boost::signals2::connection licenseRefreshedConnection;
     void licenseRefreshed();
     void run();
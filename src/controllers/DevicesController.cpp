@@ -18,21 +18,143 @@
 */
 
 #include "controllers/DevicesController.h"
+#include "engine/LatencyProbe.h"
 #include "engine/MappingEngine.h"
 #include "engine/MidiEngine.h"
+#include "session/DeviceManager.h"
 #include "session/Session.h"
 #include "Globals.h"
+#include "Settings.h"
 
 namespace Element {
 
-class DevicesController::Impl
+/** Gives up on a measurement that hasn't finished in this long, e.g. when
+    the device isn't running */
+static const double latencyTimeoutMs = 15000.0;
+
+class DevicesController::Impl : private Timer
 {
 public:
     Impl (DevicesController& o) : owner (o) { }
-    ~Impl() { }
+    ~Impl()
+    {
+        audioCallback = nullptr;
+        midiCallback = nullptr;
+        finishAudio();
+        finishMidi();
+    }
+
+    void measureAudio (int outputChannel, int inputChannel, std::function<void (int)> callback)
+    {
+        finishAudio();
+
+        auto& devices = owner.getWorld().getDeviceManager();
+        LatencyProbe::Options options;
+        options.outputChannel = outputChannel;
+        options.inputChannel = inputChannel;
+        audioProbe.reset (new LatencyProbe (options));
+        audioCallback = callback;
+        audioStartMs = Time::getMillisecondCounterHiRes();
+        devices.addAudioCallback (audioProbe.get());
+        startTimer (50);
+    }
+
+    void measureMidi (const String& inputName, std::function<void (double)> callback)
+    {
+        finishMidi();
+
+        auto& midi = owner.getWorld().getMidiEngine();
+        midiProbe.reset (new MidiLatencyProbe());
+        midiInputName = inputName;
+        midiCallback = callback;
+        midiStartMs = Time::getMillisecondCounterHiRes();
+        midi.addMidiInputCallback (midiInputName, midiProbe.get());
+        startTimer (50);
+    }
+
+    bool isMeasuring() const { return audioProbe != nullptr || midiProbe != nullptr; }
 
 private:
     DevicesController& owner;
+
+    std::unique_ptr<LatencyProbe> audioProbe;
+    std::function<void (int)> audioCallback;
+    double audioStartMs = 0.0;
+
+    std::unique_ptr<MidiLatencyProbe> midiProbe;
+    String midiInputName;
+    std::function<void (double)> midiCallback;
+    double midiStartMs = 0.0;
+
+    void timerCallback() override
+    {
+        const auto now = Time::getMillisecondCounterHiRes();
+        if (audioProbe != nullptr && (audioProbe->isFinished() || now - audioStartMs >= latencyTimeoutMs))
+            finishAudio();
+
+        if (midiProbe != nullptr)
+        {
+            auto& midi = owner.getWorld().getMidiEngine();
+            bool pinging = false;
+            {
+                const ScopedLock sl (midi.getMidiOutputLock());
+                if (auto* output = midi.getDefaultMidiOutput())
+                    pinging = midiProbe->ping (*output);
+            }
+
+            if (! pinging || now - midiStartMs >= latencyTimeoutMs)
+                finishMidi();
+        }
+
+        if (! isMeasuring())
+            stopTimer();
+    }
+
+    void finishAudio()
+    {
+        if (audioProbe == nullptr)
+            return;
+
+        auto& world = owner.getWorld();
+        auto& devices = world.getDeviceManager();
+        devices.removeAudioCallback (audioProbe.get());
+
+        const int roundTrip = audioProbe->getRoundTripSamples();
+        auto* device = devices.getCurrentAudioDevice();
+        if (roundTrip >= 0 && device != nullptr)
+        {
+            world.getSettings().setMeasuredRoundTrip (device->getName(), device->getCurrentSampleRate(),
+                                                      device->getCurrentBufferSizeSamples(), roundTrip);
+            if (auto engine = world.getAudioEngine())
+                engine->updateDeviceLatency();
+        }
+
+        audioProbe.reset();
+        auto callback = std::move (audioCallback);
+        audioCallback = nullptr;
+        if (callback)
+            callback (roundTrip);
+    }
+
+    void finishMidi()
+    {
+        if (midiProbe == nullptr)
+            return;
+
+        auto& midi = owner.getWorld().getMidiEngine();
+        midi.removeMidiInputCallback (midiInputName, midiProbe.get());
+
+        // the loopback is the output there and the input back, taken as equal
+        const double roundTrip = midiProbe->getRoundTripMs();
+        if (roundTrip >= 0.0)
+            midi.setMidiOutputLatency (midi.getDefaultMidiOutputName(), roundTrip * 0.5);
+
+        midiProbe.reset();
+        auto callback = std::move (midiCallback);
+        midiCallback = nullptr;
+        if (callback)
+            callback (roundTrip);
+    }
 };
 
 DevicesController::DevicesController()
@@ -55,6 +177,22 @@ void DevicesController::deactivate()
     Controller::deactivate();
 }
 
+void DevicesController::measureAudioLatency (int outputChannel, int inputChannel,
+                                             std::function<void (int)> callback)
+{
+    impl->measureAudio (outputChannel, inputChannel, callback);
+}
+
+void DevicesController::measureMidiLatency (const String& inputName, std::function<void (double)> callback)
+{
+    impl->measureMidi (inputName, callback);
+}
+
+bool DevicesController::isMeasuringLatency() const
+{
+    return impl->isMeasuring();
+}
+
 void DevicesController::add (const ControllerDevice& device)
 {
     auto& mapping (getWorld().getMappingEngine());
@@ -184,7 +322,7 @@ void DevicesController::refresh()
         ControllerDevice::Control control = device.findControlById (
             Uuid (child.getProperty (Tags::control).toString()));
                 
-        if (mapping.addHandler (control, node, parameter))
+        if (mapping.addHandler (control, node, parameter, child))
         {
             DBG("[EL] added handler in refresh: " << control.getName().toString());
         }
@@ -40,6 +40,22 @@ public:
     void remove (const ControllerDevice&, const ControllerDevice::Control&);
     void refresh (const ControllerDevice&);
     void refresh();
+
+    /** Plays impulses from an output channel to an input channel looped back
+        to it and measures the round trip. The result is stored for the device
+        at its current sample rate and buffer size, and the engine's output
+        latency follows it. The callback gets the round trip in samples, or
+        -1 if nothing came back */
+    void measureAudioLatency (int outputChannel, int inputChannel, std::function<void (int)> callback);
+
+    /** Sends notes from the default MIDI output to an input looped back to
+        it and measures the round trip. Half of it becomes the output's
+        latency, which its MIDI is sent ahead by. The callback gets the round
+        trip in milliseconds, or -1 if nothing came back */
+    void measureMidiLatency (const String& inputName, std::function<void (double)> callback);
+
+    /** Returns true while audio or MIDI latency is being measured */
+    bool isMeasuringLatency() const;
     
 private:
     class Impl; friend class Impl;
@@ -19,6 +19,7 @@
 
 #include "ElementApp.h"
 #include "controllers/AppController.h"
+#include "controllers/DevicesController.h"
 #include "controllers/GuiController.h"
 #include "controllers/GraphManager.h"
 #include "engine/nodes/MidiDeviceProcessor.h"
@@ -45,6 +46,7 @@ struct RootGraphHolder
     ~RootGraphHolder()
     {
         jassert(! attached());
+        loadedConnection.disconnect();
         controller = nullptr;
         model.getValueTree().removeProperty (Tags::object, 0);
         node = nullptr;
@@ -55,8 +57,9 @@ struct RootGraphHolder
 
     /** This will create a root graph processor/controller and load it if not
         done already. Properties are set from the model, so make sure they are
-        correct before calling this */
-    bool attach (AudioEnginePtr engine)
+        correct before calling this. Graphs attached without their nodes are
+        loaded later with load() */
+    bool attach (AudioEnginePtr engine, const bool loadNodes = true)
     {
         jassert (engine);
         if (! engine)
@@ -79,18 +82,50 @@ struct RootGraphHolder
             root->setRenderMode (mode);
             root->setMidiChannels (channels);
             root->setMidiProgram (program);
+            root->setParallelRenderingEnabled ((bool) model.getProperty (Tags::parallelRender, false));
+            root->setPipelineStages ((int) model.getProperty (Tags::pipelineStages, 1));
+            root->setSubGraphInliningEnabled ((bool) model.getProperty (Tags::inlineSubGraphs, false));
 
             if (engine->addGraph (root))
             {
                 controller = new RootGraphManager (*root, plugins);
+                loadedConnection = controller->nodesLoaded.connect ([this]() {
+                    if (onNodesLoaded)
+                        onNodesLoaded();
+                });
                 model.setProperty (Tags::object, node.get());
-                controller->setNodeModel (model);
-                resetIONodePorts();
+                if (loadNodes)
+                {
+                    controller->setNodeModel (model);
+                    resetIONodePorts();
+                }
             }
         }
         
         return attached();
     }
+
+    bool isLoaded() const { return attached() && controller->isLoaded(); }
+
+    /** Loads the nodes of an attached graph that isn't loaded */
+    void load()
+    {
+        if (! attached() || controller->isLoaded())
+            return;
+        getRootGraph()->setPlayConfigFor (devices);
+        controller->setNodeModel (model);
+        resetIONodePorts();
+    }
+
+    /** Saves the plugin states of an attached graph and releases its nodes.
+        The graph stays in the engine, so engine indexes don't move */
+    void unload()
+    {
+        if (! isLoaded())
+            return;
+        controller->savePluginStates();
+        controller->unloadGraph();
+    }
     
     bool detach (AudioEnginePtr engine)
     {
@@ -106,6 +141,7 @@ struct RootGraphHolder
         
         if (wasRemoved)
         {
+            loadedConnection.disconnect();
             controller = nullptr;
             node = nullptr;
         }
@@ -118,6 +154,9 @@ struct RootGraphHolder
     
     bool hasController()    const { return nullptr != controller; }
 
+    /** Called when plugins that were loading in the background are ready */
+    std::function<void()> onNodesLoaded;
+
     void resetIONodePorts()
     {
         const ValueTree nodes = model.getNodesValueTree();
@@ -133,11 +172,13 @@ struct RootGraphHolder
 private:
     friend class EngineController;
     friend class EngineController::RootGraphs;
+    friend class EngineController::GraphPreloader;
     PluginManager&                      plugins;
     DeviceManager&                      devices;
     ScopedPointer<RootGraphManager>  controller;
     Node                                model;
     GraphNodePtr                        node;
+    SignalConnection                    loadedConnection;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RootGraphHolder);
 };
@@ -151,6 +192,12 @@ public:
     RootGraphHolder* add (RootGraphHolder* item)
     {
         jassert (! graphs.contains (item));
+        // mappings made while plugins were still placeholders point at the
+        // wrong parameters
+        item->onNodesLoaded = [this]() {
+            if (auto* devices = owner.findSibling<DevicesController>())
+                devices->refresh();
+        };
         return graphs.add (item);
     }
     
@@ -301,14 +348,173 @@ private:
     OwnedArray<RootGraphHolder> graphs;
 };
 
+static void warmUpGraph (RootGraph& root, const int numBlocks)
+{
+    if (numBlocks <= 0)
+        return;
+
+    // kept off the device until its plugins have settled in
+    const bool wasSuspended = root.isSuspended();
+    root.suspendProcessing (true);
+    root.warmUp (numBlocks);
+    root.suspendProcessing (wasSuspended);
+}
+
+/** Keeps the graphs around the active one loaded, so a program change to
+    the next few songs of a set list doesn't wait on plugins, and unloads the
+    rest. Works one graph at a time on the message thread */
+class EngineController::GraphPreloader : private Timer,
+                                         private ValueTree::Listener
+{
+public:
+    GraphPreloader (EngineController& e) : owner (e) { }
+    ~GraphPreloader()
+    {
+        setSession (nullptr);
+    }
+
+    /** Follows the active graph of a session, or stops with nullptr */
+    void setSession (SessionPtr newSession)
+    {
+        stopTimer();
+        graphsData.removeListener (this);
+        graphsData = newSession != nullptr ? newSession->getGraphsValueTree() : ValueTree();
+        graphsData.addListener (this);
+        update();
+    }
+
+    /** Checks which graphs should be loaded shortly */
+    void update()
+    {
+        if (graphsData.isValid())
+            startTimer (loadInterval);
+    }
+
+    /** True if graph index of a session should be loaded, with active being
+        the active graph and ahead the number of graphs after it to keep */
+    static bool shouldBeLoaded (const Node& graph, const int index, const int active, const int ahead)
+    {
+        if (ahead <= 0 || index == active || (bool) graph.getProperty (Tags::persistent, false))
+            return true;
+
+        // parallel graphs render alongside the active one
+        const auto mode = graph.getProperty (Tags::renderMode, "single").toString().trim().toLowerCase();
+        if (mode != "single")
+            return true;
+
+        return index == active - 1 || (index > active && index <= active + ahead);
+    }
+
+private:
+    enum { loadInterval = 250 };
+    EngineController& owner;
+    ValueTree graphsData;
+
+    void timerCallback() override
+    {
+        auto session = owner.getWorld().getSession();
+        if (session == nullptr)
+            return stopTimer();
+
+        const int ahead  = owner.getWorld().getSettings().getNumPreloadedGraphs();
+        const int active = session->getActiveGraphIndex();
+        RootGraphHolder* toLoad = nullptr;
+        RootGraphHolder* toUnload = nullptr;
+        int nearest = std::numeric_limits<int>::max();
+
+        for (int i = 0; i < session->getNumGraphs(); ++i)
+        {
+            const Node graph (session->getGraph (i));
+            auto* holder = owner.graphs->findFor (graph);
+            if (holder == nullptr || ! holder->attached())
+                continue;
+
+            if (shouldBeLoaded (graph, i, active, ahead))
+            {
+                // the closest to the active graph first
+                if (! holder->isLoaded() && std::abs (i - active) < nearest)
+                {
+                    toLoad = holder;
+                    nearest = std::abs (i - active);
+                }
+            }
+            else if (toUnload == nullptr && holder->isLoaded()
+                && holder->getController()->getNumPendingNodes() == 0)
+            {
+                toUnload = holder;
+            }
+        }
+
+        if (toLoad != nullptr)
+            load (*toLoad);
+        else if (toUnload != nullptr)
+            unload (*toUnload);
+        else
+            stopTimer();
+    }
+
+    void load (RootGraphHolder& holder)
+    {
+        holder.load();
+        if (auto* root = holder.getRootGraph())
+            warmUpGraph (*root, owner.getWorld().getSettings().getNumWarmUpBlocks());
+        DBG("[EL] graph preloaded: " << holder.model.getName());
+    }
+
+    void unload (RootGraphHolder& holder)
+    {
+        if (auto* gui = owner.findSibling<GuiController>())
+            for (int i = 0; i < holder.model.getNumNodes(); ++i)
+                gui->closePluginWindowsFor (holder.model.getNode (i), true);
+        holder.unload();
+        DBG("[EL] graph unloaded: " << holder.model.getName());
+    }
+
+    void valueTreePropertyChanged (ValueTree& tree, const Identifier& property) override
+    {
+        if (tree != graphsData || property != Tags::active)
+            return;
+
+        // a program change switched to a graph that wasn't preloaded
+        if (auto session = owner.getWorld().getSession())
+            if (auto* holder = owner.graphs->findFor (session->getActiveGraph()))
+                if (holder->attached() && ! holder->isLoaded())
+                    load (*holder);
+        update();
+    }
+
+    void valueTreeChildAdded (ValueTree& parent, ValueTree&) override
+    {
+        if (parent == graphsData)
+            update();
+    }
+
+    void valueTreeChildRemoved (ValueTree& parent, ValueTree&, int) override
+    {
+        if (parent == graphsData)
+            update();
+    }
+
+    void valueTreeChildOrderChanged (ValueTree& parent, int, int) override
+    {
+        if (parent == graphsData)
+            update();
+    }
+
+    void valueTreeParentChanged (ValueTree&) override { }
+    void valueTreeRedirected (ValueTree&) override { }
+};
+
 EngineController::EngineController()
     : AppController::Child()
 {
     graphs = new RootGraphs (*this);
+    preloader = new GraphPreloader (*this);
 }
 
 EngineController::~EngineController()
 {
+    preloader = nullptr;
     graphs = nullptr;
 }
 
@@ -340,11 +546,11 @@ void EngineController::addGraph()
     findSibling<GuiController>()->stabilizeContent();
 }
 
-void EngineController::addGraph (const Node& newGraph)
+void EngineController::addGraph (const Node& newGraph, const bool copyData)
 {
     jassert(newGraph.isGraph());
 
-    Node node       = newGraph.getValueTree().getParent().isValid() ? newGraph
+    Node node       = newGraph.getValueTree().getParent().isValid() || ! copyData ? newGraph
                     : Node (newGraph.getValueTree().createCopy(), false);
     auto engine     = getWorld().getAudioEngine();
     auto session    = getWorld().getSession();
@@ -384,7 +590,8 @@ void EngineController::addGraph (const Node& newGraph)
 void EngineController::duplicateGraph (const Node& graph)
 {
     Node duplicate (graph.getValueTree().createCopy());
-    duplicate.savePluginState(); // need objects present to update processor states
+    // states go across in binary, need objects present to read them
+    duplicate.savePluginStateForCopy();
     Node::sanitizeRuntimeProperties (duplicate.getValueTree());
     // reset UUIDs to avoid compilcations with undoable actions
     duplicate.forEach ([](const ValueTree& tree)
@@ -547,13 +754,12 @@ void EngineController::addPlugin (const PluginDescription& desc, const bool veri
     
     if (plugs.size() > 0)
     {
-        const auto nodeId = root->addNode (plugs.getFirst(), rx, ry);
-        if (KV_INVALID_NODE != nodeId)
+        // big plugins take a while, so the UI keeps going until it's ready
+        root->addNodeAsync (*plugs.getFirst(), rx, ry, [this] (const Node& node)
         {
-            const Node node (root->getNodeModelForId (nodeId));
-            if (getWorld().getSettings().showPluginWindowsWhenAdded())
+            if (node.isValid() && getWorld().getSettings().showPluginWindowsWhenAdded())
                 findSibling<GuiController>()->presentPluginWindow (node);
-        }
+        });
     }
     else
     {
@@ -612,6 +818,23 @@ void EngineController::disconnectNode (const Node& node, const bool inputs, cons
         controller->disconnectNode (node.getNodeId(), inputs, outputs, audio, midi);
 }
 
+void EngineController::setNodeBridgeGroup (const Node& node, const String& group)
+{
+    const auto graph (node.getParentGraph());
+    auto* const manager = graphs->findGraphManagerFor (graph);
+    if (manager == nullptr)
+        return;
+
+    // editors belong to the instance being replaced
+    if (auto* gui = findSibling<GuiController>())
+        gui->closePluginWindowsFor (node, true);
+
+    if (! manager->setNodeBridgeGroup (node.getNodeId(), group))
+        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Plugin Process",
+            String ("Couldn't move ") + node.getName() + " to "
+                + (group.isEmpty() ? "the engine" : "a separate process") + ".");
+}
+
 void EngineController::activate()
 {
     Controller::activate();
@@ -643,6 +866,7 @@ void EngineController::deactivate()
         gui->closeAllPluginWindows();
     }
     
+    preloader->setSession (nullptr);
     session->saveGraphState();
     graphs->clear();
     
@@ -709,8 +933,18 @@ void EngineController::setRootNode (const Node& newRootNode)
     if (auto* proc = holder->getRootGraph())
     {
         proc->setMidiChannels (newRootNode.getMidiChannels().get());
-        proc->setVelocityCurveMode ((VelocityCurve::Mode)(int) newRootNode.getProperty (
-            Tags::velocityCurveMode, (int) VelocityCurve::Linear));
+        const int curveMode = newRootNode.getProperty (Tags::velocityCurveMode, (int) VelocityCurve::Linear);
+        MemoryBlock curveTable;
+        if (curveMode == VelocityCurve::Custom
+            && curveTable.fromBase64Encoding (newRootNode.getProperty (Tags::velocityCurveTable).toString())
+            && curveTable.getSize() == 128)
+        {
+            proc->setCustomVelocityCurve (static_cast<const uint8*> (curveTable.getData()));
+        }
+        else
+        {
+            proc->setVelocityCurveMode ((VelocityCurve::Mode) jlimit (0, (int) VelocityCurve::numModes - 1, curveMode));
+        }
     }
     else
     {
@@ -733,6 +967,7 @@ void EngineController::setRootNode (const Node& newRootNode)
     }
     
     engine->refreshSession();
+    preloader->update();
 }
 
 void EngineController::changeListenerCallback (ChangeBroadcaster* cb)
@@ -751,6 +986,8 @@ void EngineController::changeListenerCallback (ChangeBroadcaster* cb)
             auto nodes = session->getActiveGraph().getValueTree().getChildWithName (Tags::nodes);
             processor.suspendProcessing (true);
             processor.setPlayConfigFor (devices);
+            plugins.setPlayConfig (device->getCurrentSampleRate(),
+                                   device->getCurrentBufferSizeSamples());
             
             for (int i = nodes.getNumChildren(); --i >= 0;)
             {
@@ -838,6 +1075,7 @@ Node EngineController::addPlugin (const Node& graph, const PluginDescription& de
 
 void EngineController::sessionReloaded()
 {
+    preloader->setSession (nullptr);
     graphs->clear();
 
     auto session = getWorld().getSession();
@@ -845,21 +1083,49 @@ void EngineController::sessionReloaded()
 
     if (session->getNumGraphs() > 0)
     {
+        const double started = Time::getMillisecondCounterHiRes();
+        const int active = session->getActiveGraphIndex();
+        const int ahead  = getWorld().getSettings().getNumPreloadedGraphs();
         for (int i = 0; i < session->getNumGraphs(); ++i)
         {
             Node rootGraph (session->getGraph (i));
             if (auto* holder = graphs->add (new RootGraphHolder (rootGraph, getWorld())))
             {
-                holder->attach (engine);
+                // graphs far from the active one go in empty, the preloader
+                // loads them when they come near
+                holder->attach (engine, GraphPreloader::shouldBeLoaded (rootGraph, i, active, ahead));
                 if (auto* const controller = holder->getController())
                 {
-                    // noop: saving this logical block
+                    const auto& times = controller->getLoadTimes();
+                    DBG("[EL] graph " << rootGraph.getName() << " set up: " << times.nodes << " ms, restore "
+                        << times.restore << " ms, " << times.numRenderBuilds << " builds, "
+                        << controller->getNumPendingNodes() << " plugins loading");
+                    ignoreUnused (times);
                 }
             }
         }
 
         setRootNode (session->getCurrentGraph());
+        const double attached = Time::getMillisecondCounterHiRes();
+        warmUpGraphs();
+        DBG("[EL] session graphs attached: " << (attached - started) << " ms, warm up "
+            << (Time::getMillisecondCounterHiRes() - attached) << " ms");
+        ignoreUnused (started, attached);
     }
+
+    preloader->setSession (session);
+}
+
+void EngineController::warmUpGraphs()
+{
+    const int numBlocks = getWorld().getSettings().getNumWarmUpBlocks();
+    if (numBlocks <= 0)
+        return;
+
+    for (auto* holder : graphs->getGraphs())
+        if (auto* root = holder->getRootGraph())
+            if (holder->isLoaded())
+                warmUpGraph (*root, numBlocks);
 }
 
 Node EngineController::addPlugin (GraphManager& c, const PluginDescription& desc)
@@ -75,8 +75,9 @@ public:
     /** Adds a new root graph */
     void addGraph();
     
-    /** adds a specific graph */
-    void addGraph (const Node& n);
+    /** adds a specific graph. A graph that isn't part of a session is copied
+        first, unless the caller knows nothing else holds its data */
+    void addGraph (const Node& n, bool copyData = true);
 
     /** Remove a root graph by index */
     void removeGraph (int index = -1);
@@ -118,6 +119,10 @@ public:
     
     /** replace a node with a given plugin */
     void replace (const Node&, const PluginDescription&);
+
+    /** Moves a node's plugin to the host process of a group, or back into the
+        engine with an empty group */
+    void setNodeBridgeGroup (const Node& node, const String& group);
     
     void changeBusesLayout (const Node& node, const AudioProcessor::BusesLayout& layout);
     
@@ -127,10 +132,13 @@ private:
     friend struct RootGraphHolder;
     class RootGraphs; friend class RootGraphs;
     ScopedPointer<RootGraphs> graphs;
+    class GraphPreloader; friend class GraphPreloader;
+    ScopedPointer<GraphPreloader> preloader;
     
     friend class ChangeBroadcaster;
     void changeListenerCallback (ChangeBroadcaster*) override;
     Node addPlugin (GraphManager& controller, const PluginDescription& desc);
+    void warmUpGraphs();
 };
     
 }
@@ -24,6 +24,7 @@
 #include "engine/nodes/MidiProgramMapNode.h"
 #include "engine/nodes/PlaceholderProcessor.h"
 #include "engine/nodes/SubGraphProcessor.h"
+#include "engine/HeapMeter.h"
 
 #include "session/PluginManager.h"
 #include "Globals.h"
@@ -44,6 +45,13 @@ static String denyPluginMessage (const PluginDescription& desc)
     return message;
 }
 
+/** Plugins from these formats are quick to create and may need the graph
+    while they're being set up, so sessions create them straight away */
+static bool isInternalFormat (const PluginDescription& desc)
+{
+    return desc.pluginFormatName == EL_INTERNAL_FORMAT_NAME || desc.pluginFormatName == "Internal";
+}
+
 static void showFailedInstantiationAlert (const PluginDescription& desc, const bool async = false)
 {
     String header = "Plugin Instantiation Failed";
@@ -94,6 +102,55 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NodeModelUpdater);
 };
 
+/** Watches a node left as a placeholder while it was disabled or bypassed,
+    and has the real plugin created the first time it's switched on */
+class DeferredNodeLoader : public ReferenceCountedObject,
+                           private ValueTree::Listener
+{
+public:
+    DeferredNodeLoader (GraphManager& m, const ValueTree& d, GraphNode* p)
+        : manager (&m), data (d), placeholder (p)
+    {
+        data.addListener (this);
+    }
+
+    ~DeferredNodeLoader()
+    {
+        data.removeListener (this);
+    }
+
+private:
+    WeakReference<GraphManager> manager;
+    ValueTree data;
+    GraphNodePtr placeholder;
+
+    void valueTreePropertyChanged (ValueTree& tree, const Identifier& property) override
+    {
+        if (tree != data || placeholder == nullptr || (property != Tags::enabled && property != Tags::bypass))
+            return;
+
+        const Node node (data, false);
+        if (! node.isEnabled() || node.isBypassed())
+            return;
+
+        // the model drops this loader once the plugin is swapped in
+        ReferenceCountedObjectPtr<DeferredNodeLoader> keepAlive (this);
+        data.removeListener (this);
+        GraphNodePtr ph = placeholder;
+        placeholder = nullptr;
+        if (auto* m = manager.get())
+            m->loadDeferredNode (node, ph);
+    }
+
+    void valueTreeChildAdded (ValueTree&, ValueTree&) override { }
+    void valueTreeChildRemoved (ValueTree&, ValueTree&, int) override { }
+    void valueTreeChildOrderChanged (ValueTree&, int, int) override { }
+    void valueTreeParentChanged (ValueTree&) override { }
+    void valueTreeRedirected (ValueTree&) override { }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeferredNodeLoader);
+};
+
 /** This enforces correct IO nodes based on the graph processor's settings
     in virtual methods like 'acceptsMidi' and 'getTotalNumInputChannels'
     It uses the controller for all node operations so the model will
@@ -196,6 +253,9 @@ GraphManager::GraphManager (GraphProcessor& pg, PluginManager& pm)
 
 GraphManager::~GraphManager()
 {
+    masterReference.clear();
+    releaseRebuilds();
+
     // Make sure to dereference GraphNode's so we don't leak memory
     // If you get warnings by juce's leak detector about graph related
     // objects, then there's probably "object" properties lingering that
@@ -225,33 +285,40 @@ bool GraphManager::contains (const uint32 nodeId) const {
     return processor.getNodeForId (nodeId) != nullptr;
 }
 
-GraphNode* GraphManager::createFilter (const PluginDescription* desc, double x, double y, uint32 nodeId)
+GraphNode* GraphManager::createFilter (const PluginDescription* desc, double x, double y, uint32 nodeId,
+                                       const String& bridgeGroup)
 {
     String errorMessage;
+    // what the plugin allocates as it's created is put down to the node
+    HeapMeter::Scope heap;
 
     if (desc->pluginFormatName == "Element")
     {
         if (auto* const object = pluginManager.createGraphNode (*desc, errorMessage))
         {
+            object->setPluginMemoryBytes (heap.getGrowth());
             return processor.addNode (object, nodeId);
         }
     }
 
     errorMessage.clear();
-    auto* instance = pluginManager.createAudioPlugin (*desc, errorMessage);
+    auto* instance = bridgeGroup.isNotEmpty() && ! isInternalFormat (*desc)
+        ? pluginManager.createBridgedPlugin (*desc, bridgeGroup, errorMessage)
+        : pluginManager.createAudioPlugin (*desc, errorMessage);
     GraphNode* node = nullptr;
     
     if (instance != nullptr)
     {
-        if (auto* sub = dynamic_cast<SubGraphProcessor*> (instance))
-            sub->initController (pluginManager);
-        instance->enableAllBuses();
+        const auto pluginBytes = heap.getGrowth();
+        prepareInstance (*instance);
         node = processor.addNode (instance, nodeId);
+        if (node != nullptr)
+            node->setPluginMemoryBytes (pluginBytes);
     }
     
     if (node != nullptr)
     {
-        // noop
+        pluginManager.makeReusable (*node);
     }
 
     if (errorMessage.isNotEmpty())
@@ -262,11 +329,106 @@ GraphNode* GraphManager::createFilter (const PluginDescription* desc, double x,
     return node;
 }
 
+void GraphManager::prepareInstance (AudioPluginInstance& instance)
+{
+    if (auto* sub = dynamic_cast<SubGraphProcessor*> (&instance))
+        sub->initController (pluginManager);
+    instance.enableAllBuses();
+}
+
+void GraphManager::createFilterAsync (const Node& node, GraphNodePtr placeholder)
+{
+    ++numPendingNodes;
+    const ValueTree data = node.getValueTree();
+    const PluginDescription desc (pluginManager.findDescriptionFor (node));
+    WeakReference<GraphManager> manager (this);
+
+    pluginManager.createAudioPluginAsync (desc,
+        [manager, data, placeholder] (std::unique_ptr<AudioPluginInstance> instance, const String& error)
+        {
+            if (auto* self = manager.get())
+                self->placeholderReady (data, placeholder, std::move (instance), error);
+        }, node.getBridgeGroup());
+}
+
+void GraphManager::placeholderReady (ValueTree data, GraphNodePtr placeholder,
+                                     std::unique_ptr<AudioPluginInstance> instance, const String& error)
+{
+    numPendingNodes = jmax (0, numPendingNodes - 1);
+    const bool swapped = swapInPlaceholder (data, placeholder, std::move (instance), error);
+    if (numPendingNodes > 0)
+        return;
+
+    // everything that arrived in the background goes into one rebuild
+    if (holdingRebuilds)
+    {
+        releaseRebuilds();
+        loadTimes.background = Time::getMillisecondCounterHiRes() - loadStarted;
+        loadTimes.numRenderBuilds = processor.getNumRenderBuilds() - loadStartBuilds;
+        DBG("[EL] " << processor.getName() << " plugins loaded: " << loadTimes.background
+            << " ms, restore " << loadTimes.restore << " ms, " << loadTimes.numRenderBuilds << " builds");
+    }
+
+    if (swapped)
+        nodesLoaded();
+}
+
+bool GraphManager::swapInPlaceholder (ValueTree data, GraphNodePtr placeholder,
+                                      std::unique_ptr<AudioPluginInstance> instance, const String& error)
+{
+    // the graph was cleared, reloaded or the node removed meanwhile
+    Node node (data, false);
+    if (! nodes.isValid() || nodes.indexOf (data) < 0
+        || processor.getNodeForId (node.getNodeId()) != placeholder.get())
+        return false;
+
+    data.removeProperty (Tags::placeholder, nullptr);
+
+    if (instance == nullptr)
+    {
+        DBG("[EL] couldn't create node: " << node.getName() << ". Keeping offline placeholder: " << error);
+        data.setProperty (Tags::missing, true, nullptr);
+        changed();
+        return true;
+    }
+
+    prepareInstance (*instance);
+    GraphNodePtr obj = processor.replaceNode (placeholder.get(), instance.get());
+    if (obj == nullptr)
+        return false;
+    instance.release(); // owned by the node now
+
+    pluginManager.makeReusable (*obj);
+    setupNode (data, obj);
+    obj->setEnabled (node.isEnabled());
+    node.setProperty (Tags::enabled, obj->isEnabled());
+
+    // connections which didn't fit the placeholder get another try
+    processorArcsChanged();
+    return true;
+}
+
+void GraphManager::releaseRebuilds()
+{
+    if (! holdingRebuilds)
+        return;
+    holdingRebuilds = false;
+    processor.endBatchUpdate();
+}
+
+void GraphManager::loadDeferredNode (const Node& node, GraphNodePtr placeholder)
+{
+    if (! nodes.isValid() || nodes.indexOf (node.getValueTree()) < 0
+        || processor.getNodeForId (node.getNodeId()) != placeholder.get())
+        return;
+    createFilterAsync (node, placeholder);
+}
+
 GraphNode* GraphManager::createPlaceholder (const Node& node)
 {
     PluginDescription desc; node.getPluginDescription (desc);
     auto* ph = new PlaceholderProcessor ();
-    ph->setupFor (node, processor.getSampleRate(), processor.getBlockSize());
+    ph->setupFor (node, processor.getRenderSampleRate(), processor.getRenderBlockSize());
     return processor.addNode (ph, node.getNodeId());
 }
 
@@ -282,7 +444,7 @@ uint32 GraphManager::addNode (const Node& newNode)
     uint32 nodeId = KV_INVALID_NODE;
     const PluginDescription desc (pluginManager.findDescriptionFor (newNode));
     if (auto* node = createFilter (&desc, 0, 0,
-        newNode.hasProperty(Tags::id) ? newNode.getNodeId() : 0))
+        newNode.hasProperty(Tags::id) ? newNode.getNodeId() : 0, newNode.getBridgeGroup()))
     {
         nodeId = node->nodeId;
         ValueTree data = newNode.getValueTree().createCopy();
@@ -322,18 +484,107 @@ uint32 GraphManager::addNode (const PluginDescription* desc, double rx, double r
         return KV_INVALID_NODE;
     }
 
-    if (auto* node = createFilter (desc, rx, ry, nodeId))
+    return addNodeModel (*desc, createFilter (desc, rx, ry, nodeId), rx, ry);
+}
+
+bool GraphManager::setNodeBridgeGroup (const uint32 nodeId, const String& group)
+{
+    Node node (getNodeModelForId (nodeId));
+    GraphNodePtr old = processor.getNodeForId (nodeId);
+    if (! node.isValid() || old == nullptr || node.getBridgeGroup() == group)
+        return false;
+
+    const PluginDescription desc (pluginManager.findDescriptionFor (node));
+    if (isInternalFormat (desc))
+        return false;
+
+    node.savePluginState();
+
+    String error;
+    std::unique_ptr<AudioPluginInstance> instance (group.isNotEmpty()
+        ? pluginManager.createBridgedPlugin (desc, group, error)
+        : pluginManager.createAudioPlugin (desc, error));
+    if (instance == nullptr)
+    {
+        DBG("[EL] couldn't move " << node.getName() << " to another process: " << error);
+        return false;
+    }
+
+    prepareInstance (*instance);
+    GraphNodePtr obj = processor.replaceNode (old.get(), instance.get());
+    if (obj == nullptr)
+        return false;
+    instance.release(); // owned by the node now
+
+    ValueTree data = node.getValueTree();
+    if (group.isNotEmpty())
+        data.setProperty (Tags::bridge, group, nullptr);
+    else
+        data.removeProperty (Tags::bridge, nullptr);
+
+    pluginManager.makeReusable (*obj);
+    setupNode (data, obj);
+    obj->setEnabled (node.isEnabled());
+    node.setProperty (Tags::enabled, obj->isEnabled());
+    processorArcsChanged();
+    changed();
+    return true;
+}
+
+void GraphManager::addNodeAsync (const PluginDescription& desc, double rx, double ry,
+                                 std::function<void (const Node&)> callback)
+{
+    if (isInternalFormat (desc))
+    {
+        const auto nodeId = addNode (&desc, rx, ry);
+        if (callback)
+            callback (getNodeModelForId (nodeId));
+        return;
+    }
+
+    WeakReference<GraphManager> manager (this);
+    pluginManager.createAudioPluginAsync (desc,
+        [manager, desc, rx, ry, callback] (std::unique_ptr<AudioPluginInstance> instance, const String& error)
+        {
+            auto* self = manager.get();
+            if (self == nullptr)
+                return;
+
+            GraphNode* node = nullptr;
+            if (instance != nullptr)
+            {
+                self->prepareInstance (*instance);
+                node = self->processor.addNode (instance.release());
+                if (node != nullptr)
+                    self->pluginManager.makeReusable (*node);
+            }
+            else
+            {
+                DBG("[EL] error creating audio plugin: " << error);
+            }
+
+            const auto nodeId = self->addNodeModel (desc, node, rx, ry);
+            if (callback)
+                callback (self->getNodeModelForId (nodeId));
+        });
+}
+
+uint32 GraphManager::addNodeModel (const PluginDescription& desc, GraphNode* node, double rx, double ry)
+{
+    uint32 nodeId = KV_INVALID_NODE;
+
+    if (node != nullptr)
     {
         nodeId = node->nodeId;
         ValueTree model = node->getMetadata().createCopy();
         model.setProperty (Tags::id, static_cast<int64> (nodeId), nullptr)
-             .setProperty (Tags::name,   desc->name, nullptr)
+             .setProperty (Tags::name,   desc.name, nullptr)
              .setProperty (Tags::object, node, nullptr)
              .setProperty (Tags::updater,    new NodeModelUpdater (*this, model, node), nullptr)
              .setProperty (Tags::relativeX, rx, nullptr)
              .setProperty (Tags::relativeY, ry, nullptr)
              .setProperty (Tags::pluginIdentifierString, 
-                           desc->createIdentifierString(), nullptr);
+                           desc.createIdentifierString(), nullptr);
         
         Node n (model, true);
 
@@ -370,7 +621,7 @@ uint32 GraphManager::addNode (const PluginDescription* desc, double rx, double r
             {
                 proc->suspendProcessing (true);
                 proc->releaseResources();
-                proc->prepareToPlay (processor.getSampleRate(), processor.getBlockSize());
+                proc->prepareToPlay (processor.getRenderSampleRate(), processor.getRenderBlockSize());
                 proc->suspendProcessing (false);
             }
         }
@@ -383,8 +634,7 @@ uint32 GraphManager::addNode (const PluginDescription* desc, double rx, double r
     }
     else
     {
-        nodeId = KV_INVALID_NODE;
-        showFailedInstantiationAlert (*desc, true);
+        showFailedInstantiationAlert (desc, true);
     }
 
     return nodeId;
@@ -507,16 +757,51 @@ void GraphManager::setNodeModel (const Node& node)
 {
     loaded = false;
 
+    releaseRebuilds();
     processor.clear();
+    loadTimes = LoadTimes();
+    loadStarted = Time::getMillisecondCounterHiRes();
+    loadStartBuilds = processor.getNumRenderBuilds();
+
+    // nodes and connections go into a single rebuild at the end, instead of
+    // one for each node swapped in or connected
+    processor.beginBatchUpdate();
     graph   = node.getValueTree();
     arcs    = node.getArcsValueTree();
     nodes   = node.getNodesValueTree();
     
+    const bool lazy = pluginManager.isLazyNodeLoadingEnabled();
     Array<ValueTree> failed;
     for (int i = 0; i < nodes.getNumChildren(); ++i)
     {
         Node node (nodes.getChild (i), false);
         const PluginDescription desc (pluginManager.findDescriptionFor (node));
+
+        // third party plugins load in the background, a placeholder with the
+        // saved ports keeps their place and connections until they're ready
+        if (! isInternalFormat (desc) && pluginManager.getAudioPluginFormat (desc.pluginFormatName) != nullptr)
+        {
+            if (GraphNodePtr ph = createPlaceholder (node))
+            {
+                node.getValueTree().setProperty (Tags::object, ph.get(), nullptr);
+                node.getValueTree().setProperty (Tags::placeholder, true, nullptr);
+
+                // nodes that are switched off keep their saved state in the
+                // model and aren't created until they're switched on
+                if (lazy && (! node.isEnabled() || node.isBypassed()))
+                {
+                    ph->suspendProcessing (node.isBypassed());
+                    ph->setEnabled (node.isEnabled());
+                    node.getValueTree().setProperty (Tags::updater,
+                        new DeferredNodeLoader (*this, node.getValueTree(), ph.get()), nullptr);
+                    continue;
+                }
+
+                createFilterAsync (node, ph);
+                continue;
+            }
+        }
+
         if (GraphNodePtr obj = createFilter (&desc, 0.0, 0.0, node.getNodeId()))
         {
             setupNode (node.getValueTree(), obj);
@@ -546,10 +831,6 @@ void GraphManager::setNodeModel (const Node& node)
     // If you hit this, then failed nodes didn't get handled properly
     jassert (nodes.getNumChildren() == processor.getNumNodes());
     
-    // Cheap way to refresh engine-side nodes
-    processor.triggerAsyncUpdate();
-    processor.handleUpdateNowIfNeeded();
-
     for (int i = 0; i < arcs.getNumChildren(); ++i)
     {
         ValueTree arc (arcs.getChild (i));
@@ -594,6 +875,20 @@ void GraphManager::setNodeModel (const Node& node)
 
     IONodeEnforcer enforceIONodes (*this);
     processorArcsChanged();
+
+    processor.endBatchUpdate();
+    const double now = Time::getMillisecondCounterHiRes();
+    loadTimes.nodes = now - loadStarted;
+    loadTimes.numRenderBuilds = processor.getNumRenderBuilds() - loadStartBuilds;
+
+    // plugins still loading in the background are swapped in under one more
+    // hold, released by the last of them
+    if (numPendingNodes > 0)
+    {
+        loadStarted = now;
+        holdingRebuilds = true;
+        processor.beginBatchUpdate();
+    }
 }
 
 void GraphManager::savePluginStates()
@@ -620,6 +915,17 @@ void GraphManager::clear()
         graph.addChild (arcs, -1, nullptr);
     }
     
+    releaseRebuilds();
+    processor.clear();
+    changed();
+}
+
+void GraphManager::unloadNodes()
+{
+    loaded = false;
+    releaseRebuilds();
+    if (nodes.isValid())
+        Node::sanitizeRuntimeProperties (nodes, true);
     processor.clear();
     changed();
 }
@@ -682,7 +988,7 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
                 proc->suspendProcessing (true);
                 proc->releaseResources();
                 proc->setBusesLayoutWithoutEnabling (layout);
-                proc->prepareToPlay (processor.getSampleRate(), processor.getBlockSize());
+                proc->prepareToPlay (processor.getRenderSampleRate(), processor.getRenderBlockSize());
                 proc->suspendProcessing (false);
             }
             
@@ -693,10 +999,18 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
     if (auto* sub = obj->processor<SubGraphProcessor>())
     {
         sub->getController().setNodeModel (node);
+        WeakReference<GraphManager> parent (this);
+        sub->getController().nodesLoaded.connect ([parent]() {
+            if (auto* manager = parent.get())
+                if (manager->numPendingNodes == 0)
+                    manager->nodesLoaded();
+        });
         resetPorts = true;
     }
 
+    const double restoreStarted = Time::getMillisecondCounterHiRes();
     node.restorePluginState();
+    loadTimes.restore += Time::getMillisecondCounterHiRes() - restoreStarted;
 
     if (resetPorts || node.getNumPorts() != static_cast<int> (obj->getNumPorts()))
         node.resetPorts();
@@ -707,7 +1021,7 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
 // MARK: Root Graph Controller
 void RootGraphManager::unloadGraph()
 {
-    getRootGraph().clear();
+    unloadNodes();
 }
 
 }
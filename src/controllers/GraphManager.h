@@ -65,9 +65,20 @@ public:
     /** Adss a node with a plugin description */
     uint32 addNode (const PluginDescription* desc, double x = 0.0f, double y = 0.0f, uint32 nodeId = 0);
 
+    /** Adds a node with a plugin description once the plugin has been
+        instantiated in the background. The callback gets the new node's model,
+        which is invalid if it couldn't be created */
+    void addNodeAsync (const PluginDescription& desc, double x, double y,
+                       std::function<void (const Node&)> callback = nullptr);
+
     /** Remove a node by ID */
     void removeNode (const uint32 nodeId);
 
+    /** Moves a node's plugin to the host process of a group, or back into the
+        engine with an empty group. The plugin is reloaded with its state and
+        keeps its connections. Returns false if it couldn't be moved */
+    bool setNodeBridgeGroup (const uint32 nodeId, const String& group);
+
     /** Disconnect a node from other nodes */
     void disconnectNode (const uint32 nodeId, const bool inputs = true, const bool outputs = true,
                                               const bool audio = true, const bool midi = true);
@@ -111,22 +122,71 @@ public:
     
     inline bool isLoaded() const { return loaded; }
 
+    /** Returns the number of plugins still being instantiated in the background */
+    int getNumPendingNodes() const noexcept { return numPendingNodes; }
+
+    /** Emitted when the last plugin loading in the background has been swapped
+        in, here or in a subgraph */
+    Signal<void()> nodesLoaded;
+
+    /** Starts creating the plugin of a node that was left as a placeholder
+        because it was switched off when the graph loaded */
+    void loadDeferredNode (const Node& node, GraphNodePtr placeholder);
+
+    /** Where the time went the last time a graph model was set, in
+        milliseconds. Subgraphs count towards the nodes of their parent */
+    struct LoadTimes
+    {
+        /** Creating nodes and connecting them, in setNodeModel */
+        double nodes = 0.0;
+        /** Restoring plugin states, part of the above and of background */
+        double restore = 0.0;
+        /** From the end of setNodeModel until the last background plugin was
+            swapped in */
+        double background = 0.0;
+        /** Rendering sequence rebuilds of the graph during the load */
+        int numRenderBuilds = 0;
+    };
+
+    /** Returns the timings of the last load */
+    const LoadTimes& getLoadTimes() const noexcept { return loadTimes; }
+
+protected:
+    /** Releases the nodes and their plugins but leaves them in the model, so
+        setNodeModel can load them again */
+    void unloadNodes();
+
 private:
     PluginManager& pluginManager;
     GraphProcessor& processor;
     ValueTree graph, arcs, nodes;
     bool loaded = false;
+    int numPendingNodes = 0;
+    bool holdingRebuilds = false;
+    LoadTimes loadTimes;
+    double loadStarted = 0.0;
+    int loadStartBuilds = 0;
     
     uint32 lastUID;
     uint32 getNextUID() noexcept;
     inline void changed() { sendChangeMessage(); }
     GraphNode* createFilter (const PluginDescription* desc, double x = 0.0f, double y = 0.0f,
-                             uint32 nodeId = 0);
+                             uint32 nodeId = 0, const String& bridgeGroup = String());
     GraphNode* createPlaceholder (const Node& node);
+    void prepareInstance (AudioPluginInstance& instance);
+    uint32 addNodeModel (const PluginDescription& desc, GraphNode* node, double rx, double ry);
+    void createFilterAsync (const Node& node, GraphNodePtr placeholder);
+    void placeholderReady (ValueTree data, GraphNodePtr placeholder,
+                           std::unique_ptr<AudioPluginInstance> instance, const String& error);
+    bool swapInPlaceholder (ValueTree data, GraphNodePtr placeholder,
+                            std::unique_ptr<AudioPluginInstance> instance, const String& error);
+    void releaseRebuilds();
     void setupNode (const ValueTree& data, GraphNodePtr object);
     
     void processorArcsChanged();
 
+    WeakReference<GraphManager>::Master masterReference;
+    friend class WeakReference<GraphManager>;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphManager)
 };
     
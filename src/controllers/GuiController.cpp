@@ -39,7 +39,12 @@ namespace Element {
 
 struct GlobalLookAndFeel
 {
-    GlobalLookAndFeel()     { LookAndFeel::setDefaultLookAndFeel (&look); }
+    GlobalLookAndFeel()
+    {
+        LookAndFeel::setDefaultLookAndFeel (&look);
+        getIcons().clearImageCache();
+    }
+
     ~GlobalLookAndFeel()    { LookAndFeel::setDefaultLookAndFeel (nullptr); }
     Element::LookAndFeel look;
 };
@@ -100,15 +105,50 @@ private:
 static ScopedPointer<GlobalLookAndFeel> sGlobalLookAndFeel;
 static Array<GuiController*> sGuiControllerInstances;
 
+static void createGlobalLookAndFeel()
+{
+    if (sGlobalLookAndFeel == nullptr)
+        sGlobalLookAndFeel = new GlobalLookAndFeel();
+}
+
+/** Waits for the audio device to start before opening a graph's windows, so
+    creating heavy editors doesn't hold up the engine */
+class GuiController::DeferredPluginWindows : private Timer
+{
+public:
+    DeferredPluginWindows (GuiController& g, const Node& n)
+        : gui (g), graph (n)
+    {
+        startTimer (50);
+    }
+
+private:
+    GuiController& gui;
+    Node graph;
+    int polls = 0;
+
+    void timerCallback() override
+    {
+        // give up waiting after a few seconds, a device may never start
+        auto* device = gui.getWorld().getDeviceManager().getCurrentAudioDevice();
+        if (device != nullptr && ! device->isPlaying() && ++polls < 100)
+            return;
+        stopTimer();
+        gui.showPluginWindowsFor (graph);
+    }
+};
+
 GuiController::GuiController (Globals& w, AppController& a)
     : AppController::Child(),
       controller(a), world(w),
+      headless (w.cli.headless),
       windowManager (nullptr),
       mainWindow (nullptr)
 {
     keys = new KeyPressManager (*this);
-    if (sGuiControllerInstances.size() <= 0)
-        sGlobalLookAndFeel = new GlobalLookAndFeel();
+    // headless, the look and feel waits for the first window
+    if (! headless)
+        createGlobalLookAndFeel();
     sGuiControllerInstances.add (this);
     windowManager = new WindowManager (*this);
 }
@@ -122,10 +162,20 @@ GuiController::~GuiController()
 
 Element::LookAndFeel& GuiController::getLookAndFeel()
 { 
-    jassert (sGlobalLookAndFeel);
+    createGlobalLookAndFeel();
     return sGlobalLookAndFeel->look;
 }
 
+bool GuiController::canShowWindows()
+{
+    if (! headless)
+        return true;
+    if (Desktop::getInstance().getDisplays().displays.size() <= 0)
+        return false;
+    createGlobalLookAndFeel();
+    return true;
+}
+
 void GuiController::saveProperties (PropertiesFile* props)
 {
     jassert(props);
@@ -200,6 +250,9 @@ CommandManager& GuiController::commander() { return world.getCommandManager(); }
 
 void GuiController::runDialog (const String& uri)
 {
+    if (! canShowWindows())
+        return;
+
     if (uri == ELEMENT_PREFERENCES)
     {
         if (auto* const dialog = windowManager->findDialogByName ("Preferences"))
@@ -230,7 +283,14 @@ void GuiController::runDialog (const String& uri)
 
 void GuiController::closePluginWindow (PluginWindow* w) { if (windowManager) windowManager->closePluginWindow (w); }
 void GuiController::closePluginWindowsFor (uint32 nodeId, const bool visible) { if (windowManager) windowManager->closeOpenPluginWindowsFor (nodeId, visible); }
-void GuiController::closeAllPluginWindows (const bool visible) { if (windowManager) windowManager->closeAllPluginWindows (visible); }
+void GuiController::hideAllPluginWindows (const bool visible) { if (windowManager) windowManager->hideAllPluginWindows (visible); }
+
+void GuiController::closeAllPluginWindows (const bool visible)
+{
+    deferredWindows = nullptr;
+    if (windowManager)
+        windowManager->closeAllPluginWindows (visible);
+}
 
 void GuiController::closePluginWindowsFor (const Node& node, const bool visible)
 {
@@ -244,7 +304,7 @@ void GuiController::runDialog (Component* c, const String& title)
     opts.content.set (c, true);
     opts.dialogTitle = title.isNotEmpty() ? title : c->getName();
     opts.componentToCentreAround = (Component*) mainWindow.get();
-    if (windowManager)
+    if (windowManager && canShowWindows())
         if (DialogWindow* dw = opts.create())
             windowManager->push (dw);
 }
@@ -253,7 +313,7 @@ void GuiController::showSplash() { }
 
 ContentComponent* GuiController::getContentComponent()
 {
-    if (! content)
+    if (! content && ! headless)
     {
         content = ContentComponent::create (controller);
         content->setSize (760, 480);
@@ -298,9 +358,14 @@ void GuiController::showPluginWindowsFor (const Node& node, const bool recursive
             showPluginWindowsFor (node.getNode (i), recursive, force, focus);
 }
 
+void GuiController::showPluginWindowsWhenRunning (const Node& graph)
+{
+    deferredWindows.reset (new DeferredPluginWindows (*this, graph));
+}
+
 void GuiController::presentPluginWindow (const Node& node, const bool focus)
 {
-    if (! windowManager)
+    if (! windowManager || ! canShowWindows())
         return;
 
     if (node.isIONode() || node.isGraph())
@@ -310,6 +375,8 @@ void GuiController::presentPluginWindow (const Node& node, const bool focus)
     }
     
     auto* window = windowManager->getPluginWindowFor (node);
+    if (! window)
+        window = windowManager->unparkPluginWindowFor (node);
     if (! window)
         window = windowManager->createPluginWindowFor (node);
 
@@ -341,6 +408,13 @@ void GuiController::run()
     auto& settings = getWorld().getSettings();
     PropertiesFile* const pf = settings.getUserSettings();
 
+    if (headless)
+    {
+        Logger::writeToLog ("[EL] running headless");
+        findSibling<SessionController>()->resetChanges();
+        return;
+    }
+
     mainWindow = new MainWindow (world);
     mainWindow->setContentNonOwned (getContentComponent(), true);
     mainWindow->centreWithSize (content->getWidth(), content->getHeight());
@@ -727,6 +801,28 @@ void GuiController::getCommandInfo (CommandID commandID, ApplicationCommandInfo&
 
 bool GuiController::perform (const InvocationInfo& info)
 {
+    switch (info.commandID)
+    {
+        case Commands::showControllerDevices:
+        case Commands::showKeymapEditor:
+        case Commands::showPluginManager:
+        case Commands::showSessionConfig:
+        case Commands::showGraphConfig:
+        case Commands::showPatchBay:
+        case Commands::showGraphEditor:
+        case Commands::showGraphMixer:
+        case Commands::showConsole:
+        case Commands::toggleVirtualKeyboard:
+        case Commands::toggleChannelStrip:
+        case Commands::showLastContentView:
+        case Commands::rotateContentView:
+            if (content == nullptr)
+                return false;
+            break;
+        default:
+            break;
+    }
+
     bool result = true;
     switch (info.commandID)
     {
@@ -805,7 +901,7 @@ bool GuiController::perform (const InvocationInfo& info)
         } break;
 
         case Commands::hideAllPluginWindows: {
-                closeAllPluginWindows (false);
+                hideAllPluginWindows (false);
         } break;
 
         case Commands::toggleUserInterface: {
@@ -815,7 +911,7 @@ bool GuiController::perform (const InvocationInfo& info)
                 if (window->isOnDesktop())
                 {
                     window->removeFromDesktop();
-                    closeAllPluginWindows (true);
+                    hideAllPluginWindows (true);
                 }
                 else
                 {
@@ -866,6 +962,9 @@ void GuiController::stabilizeViews()
 
 void GuiController::refreshSystemTray()
 {
+    if (headless)
+        return;
+
     // stabilize systray
     auto& settings = getWorld().getSettings();
     SystemTray::setEnabled (settings.isSystrayEnabled());
@@ -879,6 +978,9 @@ void GuiController::refreshMainMenu()
 
 void GuiController::toggleAboutScreen()
 {
+    if (! canShowWindows())
+        return;
+
     if (! about)
     {
         about = new AboutDialog (*this);
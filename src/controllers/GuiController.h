@@ -53,6 +53,10 @@ public:
     
     void run();
     CommandManager& commander();
+
+    /** Returns true if the app was started without its main window. Plugin
+        windows and dialogs still open when a display is attached */
+    bool isHeadless() const noexcept { return headless; }
     
     AppController& getAppController() const { return controller; }
     KeyListener* getKeyListener() const;
@@ -74,6 +78,9 @@ public:
                                 const bool force = false,
                                 const bool focus = false);
     
+    /** Show plugin windows for a graph once the audio device is running */
+    void showPluginWindowsWhenRunning (const Node& graph);
+
     /** present a plugin window */
     void presentPluginWindow (const Node& node, const bool focus = false);
     
@@ -103,6 +110,10 @@ public:
     
     /** Close all plugin windows housed by this controller */
     void closeAllPluginWindows (const bool windowVisible = true);
+
+    /** Hide all plugin windows. Their editors are kept and shown again
+        without being recreated when the windows are next presented */
+    void hideAllPluginWindows (const bool windowVisible = true);
     
     /** Close plugin windows for a Node ID
      
@@ -139,6 +150,7 @@ public:
 private:
     AppController& controller;
     Globals& world;
+    const bool headless;
     SessionRef sessionRef;
     OwnedArray<PluginWindow>         pluginWindows;
     ScopedPointer<WindowManager>     windowManager;
@@ -148,6 +160,9 @@ private:
     std::unique_ptr<Component>       activation;
     Node selectedNode; // TODO: content manager
 
+    class DeferredPluginWindows;
+    std::unique_ptr<DeferredPluginWindows> deferredWindows;
+
     struct KeyPressManager;
     ScopedPointer<KeyPressManager> keys;
 
@@ -156,6 +171,7 @@ private:
     
     void showSplash();
     void toggleAboutScreen();
+    bool canShowWindows();
 
     void saveProperties (PropertiesFile* props);
 };
@@ -0,0 +1,121 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "controllers/MetricsController.h"
+#include "engine/EngineMetrics.h"
+#include "engine/MetricsServer.h"
+#include "Globals.h"
+#include "Settings.h"
+
+namespace Element {
+
+/** Snapshots are taken this often when nothing is served, for budget checks */
+static const int budgetCheckIntervalMs = 5000;
+
+class MetricsController::Impl
+{
+public:
+    Impl (Globals& world)
+        : collector (world)
+    { }
+
+    EngineMetrics::Collector collector;
+    MetricsServer server;
+    StringArray overBudget;
+
+    void update()
+    {
+        const auto metrics = collector.collect();
+        if (server.isRunning())
+            server.publish (metrics);
+
+        StringArray nowOver;
+        for (const auto& graph : metrics.graphs)
+        {
+            if (! graph.isOverBudget())
+                continue;
+            nowOver.add (graph.name);
+            if (! overBudget.contains (graph.name))
+                Logger::writeToLog ("[EL] graph " + graph.name + " holds "
+                    + File::descriptionOfSizeInBytes (graph.memoryBytes) + ", over its budget of "
+                    + File::descriptionOfSizeInBytes (graph.memoryBudget));
+        }
+
+        overBudget.swapWith (nowOver);
+    }
+};
+
+MetricsController::MetricsController() { }
+
+MetricsController::~MetricsController()
+{
+    stopTimer();
+    impl.reset();
+}
+
+void MetricsController::refreshWithSettings()
+{
+    if (impl == nullptr)
+        impl.reset (new Impl (getWorld()));
+
+    const auto port = getSettings().getMetricsPort();
+    if (port <= 0)
+    {
+        impl->server.stop();
+        startTimer (budgetCheckIntervalMs);
+        return;
+    }
+
+    if (impl->server.isRunning() && impl->server.getPort() == port)
+        return;
+
+    if (! impl->server.start (port))
+    {
+        Logger::writeToLog ("[EL] could not serve metrics on port " + String (port));
+        startTimer (budgetCheckIntervalMs);
+        return;
+    }
+
+    impl->update();
+    startTimer (1000);
+}
+
+StringArray MetricsController::getGraphsOverBudget() const
+{
+    return impl != nullptr ? impl->overBudget : StringArray();
+}
+
+void MetricsController::activate()
+{
+    refreshWithSettings();
+}
+
+void MetricsController::deactivate()
+{
+    stopTimer();
+    impl.reset();
+}
+
+void MetricsController::timerCallback()
+{
+    if (impl != nullptr)
+        impl->update();
+}
+
+}
@@ -0,0 +1,58 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "controllers/AppController.h"
+
+namespace Element {
+
+/** Serves engine metrics while a port is set in Settings, and warns about
+    graphs going over their memory budgets.
+
+    A snapshot is taken on the message thread, once a second while serving,
+    and handed to a MetricsServer, which answers Prometheus scrapes and feeds
+    WebSocket clients from its own thread. See EngineMetrics for what's
+    measured. A graph going over its budget is logged once, and again if it
+    comes back under and goes over again.
+ */
+class MetricsController : public AppController::Child,
+                          private Timer
+{
+public:
+    MetricsController();
+    ~MetricsController();
+
+    /** Starts or stops the server according to Settings */
+    void refreshWithSettings();
+
+    /** Returns the names of the graphs which were over budget at the last
+        snapshot */
+    StringArray getGraphsOverBudget() const;
+
+    void activate() override;
+    void deactivate() override;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+    void timerCallback() override;
+};
+
+}
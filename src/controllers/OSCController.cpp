@@ -18,12 +18,21 @@
 */
 
 #include "controllers/OSCController.h"
+#include "engine/EngineMetrics.h"
+#include "engine/GraphNode.h"
+#include "engine/OSCParameterRouter.h"
 #include "session/CommandManager.h"
+#include "session/Session.h"
+#include "scripting/LuaEngine.h"
+#include "scripting/LuaScheduler.h"
 #include "Commands.h"
 #include "Globals.h"
 #include "Settings.h"
 
-#define EL_OSC_ADDRESS_COMMAND "/element/command"
+#define EL_OSC_ADDRESS_COMMAND      "/element/command"
+#define EL_OSC_ADDRESS_PROFILE      "/element/profile"
+#define EL_OSC_ADDRESS_PROFILE_NODE "/element/profile/node"
+#define EL_OSC_ADDRESS_METRICS      "/element/metrics"
 
 namespace Element {
 
@@ -51,6 +60,135 @@ private:
     Globals& world;
 };
 
+/** Answers render time queries.
+
+    /element/profile <int>              enables (1) or disables (0) profiling of every node
+    /element/profile <string> <int>     sends the active graph's render times to a host and port,
+                                        one /element/profile/node message per node with its name,
+                                        id, last, average and maximum milliseconds and load
+ */
+struct ProfileOSCListener final : OSCReceiver::ListenerWithOSCAddress<>
+{
+    ProfileOSCListener (Globals& w, OSCSender& s)
+        : world (w), sender (s)
+    { }
+
+    void oscMessageReceived (const OSCMessage& message) override
+    {
+        if (message.size() == 1 && message[0].isInt32())
+        {
+            GraphNode::setProfilingEnabled (message[0].getInt32() != 0);
+        }
+        else if (message.size() == 2 && message[0].isString() && message[1].isInt32())
+        {
+            auto session = world.getSession();
+            if (session == nullptr || ! sender.connect (message[0].getString(), message[1].getInt32()))
+                return;
+            sendNodes (session->getActiveGraph());
+            sender.disconnect();
+        }
+    }
+
+private:
+    Globals& world;
+    OSCSender& sender;
+
+    void sendNodes (const Node& graph)
+    {
+        for (int i = 0; i < graph.getNumNodes(); ++i)
+        {
+            const auto node = graph.getNode (i);
+            if (GraphNodePtr graphNode = node.getGraphNode())
+            {
+                const auto time = graphNode->getProcessTime();
+                sender.send (EL_OSC_ADDRESS_PROFILE_NODE, node.getName(), (int) node.getNodeId(),
+                             (float) time.lastMs, (float) time.averageMs,
+                             (float) time.maximumMs, (float) time.load);
+            }
+
+            if (node.isGraph())
+                sendNodes (node);
+        }
+    }
+};
+
+/** Answers metrics queries.
+
+    /element/metrics <string> <int>     sends an engine snapshot to a host and port:
+                                        /element/metrics/engine with the callback load,
+                                        average and maximum callback milliseconds, xruns,
+                                        MIDI in and out per second and dropped MIDI,
+                                        /element/metrics/disk with the number of streams,
+                                        the lowest fill level and underruns, then one
+                                        /element/metrics/graph per graph with its name,
+                                        nodes and render memory in bytes and, while
+                                        profiling, one /element/metrics/node per node like
+                                        /element/profile/node
+ */
+struct MetricsOSCListener final : OSCReceiver::ListenerWithOSCAddress<>
+{
+    MetricsOSCListener (Globals& w, OSCSender& s)
+        : collector (w), sender (s)
+    { }
+
+    void oscMessageReceived (const OSCMessage& message) override
+    {
+        if (message.size() != 2 || ! message[0].isString() || ! message[1].isInt32())
+            return;
+        if (! sender.connect (message[0].getString(), message[1].getInt32()))
+            return;
+
+        const auto metrics = collector.collect();
+        sender.send (EL_OSC_ADDRESS_METRICS "/engine", (float) metrics.cpuLoad,
+                     (float) metrics.callbackAverageMs, (float) metrics.callbackMaximumMs,
+                     metrics.numOverruns, (float) metrics.midiInPerSecond,
+                     (float) metrics.midiOutPerSecond, (int) metrics.midiDropped);
+        sender.send (EL_OSC_ADDRESS_METRICS "/disk", metrics.numStreams,
+                     metrics.minStreamFill, metrics.streamUnderruns);
+        for (const auto& graph : metrics.graphs)
+            sender.send (EL_OSC_ADDRESS_METRICS "/graph", graph.name, graph.numNodes,
+                         (int) jmin ((int64) std::numeric_limits<int>::max(), graph.memoryBytes),
+                         (int) jmin ((int64) std::numeric_limits<int>::max(), graph.memoryBudget));
+        for (const auto& node : metrics.nodes)
+            sender.send (EL_OSC_ADDRESS_METRICS "/node", node.name, (int) node.nodeId,
+                         (float) node.time.lastMs, (float) node.time.averageMs,
+                         (float) node.time.maximumMs, (float) node.time.load,
+                         (int) jmin ((int64) std::numeric_limits<int>::max(), node.memory.getTotal()));
+        sender.disconnect();
+    }
+
+private:
+    EngineMetrics::Collector collector;
+    OSCSender& sender;
+};
+
+/** Hands every message to Lua tasks waiting with element.waitosc */
+struct ScriptOSCListener final : OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>
+{
+    ScriptOSCListener (Globals& w)
+        : world (w)
+    { }
+
+    void oscMessageReceived (const OSCMessage& message) override
+    {
+        world.getLuaEngine().getScheduler().deliver (message);
+    }
+
+    void oscBundleReceived (const OSCBundle& bundle) override
+    {
+        for (const auto& element : bundle)
+        {
+            if (element.isMessage())
+                oscMessageReceived (element.getMessage());
+            else if (element.isBundle())
+                oscBundleReceived (element.getBundle());
+        }
+    }
+
+private:
+    Globals& world;
+};
+
 //=============================================================================
 
 class OSCController::Impl
@@ -98,6 +236,21 @@ public:
         
         application.reset (new CommandOSCListener (owner.getWorld()));
         receiver.addListener (application.get(), EL_OSC_ADDRESS_COMMAND);
+        profile.reset (new ProfileOSCListener (owner.getWorld(), sender));
+        receiver.addListener (profile.get(), EL_OSC_ADDRESS_PROFILE);
+        metrics.reset (new MetricsOSCListener (owner.getWorld(), sender));
+        receiver.addListener (metrics.get(), EL_OSC_ADDRESS_METRICS);
+        scripts.reset (new ScriptOSCListener (owner.getWorld()));
+        receiver.addListener (scripts.get());
+
+        // parameters skip the message thread, see OSCParameterRouter
+        parameters.reset (new OSCParameterRouter());
+        auto& world = owner.getWorld();
+        parameters->setGraphSource ([&world]() -> Node {
+            auto session = world.getSession();
+            return session != nullptr ? session->getActiveGraph() : Node();
+        });
+        receiver.addListener (parameters.get());
 
         listenersReady = true;
     }
@@ -110,6 +263,14 @@ public:
 
         receiver.removeListener (application.get());
         application.reset();
+        receiver.removeListener (profile.get());
+        profile.reset();
+        receiver.removeListener (metrics.get());
+        metrics.reset();
+        receiver.removeListener (scripts.get());
+        scripts.reset();
+        receiver.removeListener (parameters.get());
+        parameters.reset();
     }
 
     int getHostPort() const { return serverPort; }
@@ -124,6 +285,10 @@ private:
     int serverPort { 9000 };
 
     std::unique_ptr<CommandOSCListener> application;
+    std::unique_ptr<ProfileOSCListener> profile;
+    std::unique_ptr<MetricsOSCListener> metrics;
+    std::unique_ptr<ScriptOSCListener> scripts;
+    std::unique_ptr<OSCParameterRouter> parameters;
 };
 
 //=============================================================================
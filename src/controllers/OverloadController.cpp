@@ -0,0 +1,92 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "controllers/OverloadController.h"
+#include "engine/OverloadGovernor.h"
+#include "session/DeviceManager.h"
+#include "session/Node.h"
+#include "session/Session.h"
+#include "Globals.h"
+#include "Settings.h"
+
+namespace Element {
+
+/** Load readings are taken this often */
+static const int readingIntervalMs = 250;
+
+static void addNodes (ReferenceCountedArray<GraphNode>& nodes, const Node& graph)
+{
+    for (int i = 0; i < graph.getNumNodes(); ++i)
+    {
+        const auto node = graph.getNode (i);
+        if (GraphNodePtr object = node.getGraphNode())
+            nodes.add (object);
+        if (node.isGraph())
+            addNodes (nodes, node);
+    }
+}
+
+class OverloadController::Impl
+{
+public:
+    OverloadGovernor governor;
+    ReferenceCountedArray<GraphNode> nodes;
+};
+
+OverloadController::OverloadController() { }
+
+OverloadController::~OverloadController()
+{
+    stopTimer();
+    impl.reset();
+}
+
+void OverloadController::activate()
+{
+    startTimer (readingIntervalMs);
+}
+
+void OverloadController::deactivate()
+{
+    stopTimer();
+    impl.reset();
+}
+
+void OverloadController::timerCallback()
+{
+    // the setting is checked as it goes, so it applies without a restart
+    if (! getSettings().isOverloadProtectionEnabled())
+    {
+        impl.reset();
+        return;
+    }
+
+    if (impl == nullptr)
+        impl.reset (new Impl());
+
+    auto& nodes = impl->nodes;
+    nodes.clearQuick();
+    if (auto session = getWorld().getSession())
+        for (int i = 0; i < session->getNumGraphs(); ++i)
+            addNodes (nodes, session->getGraph (i));
+
+    impl->governor.update (getWorld().getDeviceManager().getCpuUsage(), nodes);
+}
+
+}
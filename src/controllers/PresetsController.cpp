@@ -20,20 +20,228 @@
 #include "controllers/PresetsController.h"
 #include "controllers/GuiController.h"
 #include "gui/ContentComponent.h"
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/GraphNode.h"
 #include "session/Session.h"
+#include "session/SessionArchive.h"
 #include "session/Presets.h"
 #include "Globals.h"
 #include "DataPath.h"
 
 namespace Element {
 
-struct PresetsController::Pimpl
+/** Decoded presets kept around for stepping back and forth */
+static const int maxCachedPresets = 16;
+
+struct PresetsController::Pimpl : private Thread,
+                                  private AsyncUpdater
 {
-    Pimpl() { }
-    ~Pimpl() { }
+    Pimpl() : Thread ("el.presets") { }
+
+    ~Pimpl()
+    {
+        cancelPendingUpdate();
+        {
+            const ScopedLock sl (lock);
+            toDecode.clearQuick();
+        }
+        signalThreadShouldExit();
+        notify();
+        stopThread (-1);
+    }
+
+    void load (const Node& node, const File& file, bool syncToBlocks)
+    {
+        {
+            const ScopedLock sl (lock);
+            // a newer preset for the same node replaces one still decoding
+            for (int i = pending.size(); --i >= 0;)
+                if (pending.getReference(i).node == node.getValueTree())
+                    pending.remove (i);
+            pending.add ({ node.getValueTree(), file, syncToBlocks });
+        }
+
+        request (file, true);
+        triggerAsyncUpdate();
+    }
 
-    void refresh()
+    void request (const File& file, bool urgent)
     {
+        if (file == File())
+            return;
+
+        {
+            const ScopedLock sl (lock);
+            for (auto& entry : decoded)
+            {
+                if (entry.file == file)
+                {
+                    entry.lastUsed = ++useCounter;
+                    return;
+                }
+            }
+
+            const int index = toDecode.indexOf (file);
+            if (index >= 0)
+            {
+                if (urgent)
+                    toDecode.move (index, 0);
+                return;
+            }
+
+            if (urgent)
+                toDecode.insert (0, file);
+            else
+                toDecode.add (file);
+        }
+
+        if (! isThreadRunning())
+            startThread (3);
+        notify();
+    }
+
+    bool findDecoded (const File& file, ValueTree& data)
+    {
+        const ScopedLock sl (lock);
+        for (auto& entry : decoded)
+        {
+            if (entry.file == file)
+            {
+                entry.lastUsed = ++useCounter;
+                data = entry.data;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Load
+    {
+        ValueTree node;
+        File file;
+        bool syncToBlocks;
+    };
+
+    struct Entry
+    {
+        File file;
+        ValueTree data;
+        uint32 lastUsed;
+    };
+
+    CriticalSection lock;
+    Array<File> toDecode;
+    Array<Entry> decoded;
+    Array<Load> pending;
+    uint32 useCounter = 0;
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            File file;
+            {
+                const ScopedLock sl (lock);
+                if (! toDecode.isEmpty())
+                    file = toDecode.removeAndReturn (0);
+            }
+
+            if (file == File())
+            {
+                wait (-1);
+                continue;
+            }
+
+            // a preset that fails to decode is cached invalid so it isn't retried
+            const auto data = PresetsController::decode (file);
+
+            {
+                const ScopedLock sl (lock);
+                if (decoded.size() >= maxCachedPresets)
+                {
+                    int oldest = 0;
+                    for (int i = 1; i < decoded.size(); ++i)
+                        if (decoded.getReference(i).lastUsed < decoded.getReference(oldest).lastUsed)
+                            oldest = i;
+                    decoded.remove (oldest);
+                }
+
+                decoded.add ({ file, data, ++useCounter });
+            }
+
+            triggerAsyncUpdate();
+        }
+    }
+
+    void handleAsyncUpdate() override
+    {
+        Array<Load> ready;
+        Array<ValueTree> readyData;
+
+        {
+            const ScopedLock sl (lock);
+            for (int i = 0; i < pending.size();)
+            {
+                ValueTree data;
+                if (findDecoded (pending.getReference(i).file, data))
+                {
+                    ready.add (pending.removeAndReturn (i));
+                    readyData.add (data);
+                    continue;
+                }
+                ++i;
+            }
+        }
+
+        for (int i = 0; i < ready.size(); ++i)
+            apply (Node (ready.getReference(i).node, false), readyData.getReference(i),
+                   ready.getReference(i).syncToBlocks);
+    }
+
+    /** Returns the lock the root graph renders under, for nodes whose state
+        should change between blocks */
+    static const CriticalSection* getRenderLock (const Node& node)
+    {
+        const auto format = node.getFormat().toString();
+        if (format != EL_INTERNAL_FORMAT_NAME && format != "Internal")
+            return nullptr;
+
+        auto graph = node.getParentGraph();
+        while (graph.isValid() && ! graph.isRootGraph())
+            graph = graph.getParentGraph();
+
+        if (GraphNodePtr object = graph.getGraphNode())
+            if (auto* proc = object->getAudioProcessor())
+                return &proc->getCallbackLock();
+        return nullptr;
+    }
+
+    static void apply (Node node, const ValueTree& data, bool syncToBlocks)
+    {
+        if (! node.isValid() || ! data.isValid())
+            return;
+
+        if (data.hasProperty (Tags::state))
+        {
+            auto tree = node.getValueTree();
+            tree.setProperty (Tags::state, data.getProperty (Tags::state), nullptr);
+            if (data.hasProperty (Tags::programState))
+                tree.setProperty (Tags::programState, data.getProperty (Tags::programState), nullptr);
+
+            if (auto* renderLock = syncToBlocks ? getRenderLock (node) : nullptr)
+            {
+                const ScopedLock sl (*renderLock);
+                node.restorePluginState();
+            }
+            else
+            {
+                node.restorePluginState();
+            }
+        }
+
+        if (data[Tags::name].toString().isNotEmpty())
+            node.setProperty (Tags::name, data[Tags::name]);
     }
 };
 
@@ -47,6 +255,27 @@ PresetsController::~PresetsController()
     pimpl.reset (nullptr);
 }
 
+ValueTree PresetsController::decode (const File& presetFile)
+{
+    auto data = Node::parse (presetFile);
+    if (! data.isValid())
+        return {};
+
+    for (const auto& property : { Tags::state, Tags::programState })
+    {
+        if (! data.hasProperty (property))
+            continue;
+
+        MemoryBlock state;
+        if (SessionArchive::readStateValue (data.getProperty (property), state))
+            data.setProperty (property, var (state), nullptr);
+        else
+            data.removeProperty (property, nullptr);
+    }
+
+    return data;
+}
+
 void PresetsController::activate()
 { 
 }
@@ -57,7 +286,7 @@ void PresetsController::deactivate()
 
 void PresetsController::refresh()
 {
-    getWorld().getPresetCollection().refresh();
+    getWorld().getPresetCollection().refreshInBackground();
 }
 
 void PresetsController::add (const Node& node, const String& presetName)
@@ -70,6 +299,7 @@ void PresetsController::add (const Node& node, const String& presetName)
     }
     else
     {
+        path.rescanPresets();
         getWorld().getPresetCollection().refresh();
     }
 
@@ -78,4 +308,27 @@ void PresetsController::add (const Node& node, const String& presetName)
             cc->stabilize (true);
 }
 
+void PresetsController::load (const Node& node, const PresetDescription& preset, bool syncToBlocks)
+{
+    pimpl->load (node, preset.file, syncToBlocks);
+
+    OwnedArray<PresetDescription> presets;
+    getWorld().getPresetCollection().getPresetsFor (node, presets);
+    for (int i = 0; i < presets.size(); ++i)
+    {
+        if (presets.getUnchecked(i)->file != preset.file)
+            continue;
+        if (auto* previous = presets [i - 1])
+            prefetch (previous->file);
+        if (auto* next = presets [i + 1])
+            prefetch (next->file);
+        break;
+    }
+}
+
+void PresetsController::prefetch (const File& presetFile)
+{
+    pimpl->request (presetFile, false);
+}
+
 }
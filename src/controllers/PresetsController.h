@@ -21,6 +21,7 @@
 
 #include "controllers/AppController.h"
 #include "documents/SessionDocument.h"
+#include "session/Presets.h"
 #include "session/Session.h"
 
 namespace Element {
@@ -36,6 +37,24 @@ public:
     void refresh();
     void add (const Node& Node, const String& presetName = String());
 
+    /** Loads a preset into a node. Presets are decoded on a background thread
+        and applied once they're ready, so only the plugin's own state restore
+        runs on the message thread. The presets either side of this one are
+        decoded ahead of time so stepping through them is immediate.
+
+        When the node is an internal one and syncToBlocks is true, its state is
+        applied between audio blocks. If another preset is asked for the same
+        node before this one is ready, only the latest is loaded.
+     */
+    void load (const Node& node, const PresetDescription& preset, bool syncToBlocks = true);
+
+    /** Decodes a preset ahead of time without loading it */
+    void prefetch (const File& presetFile);
+
+    /** Decodes a preset file, with its state properties as binary data so
+        restoring them needs no further decoding. Safe to call from any thread */
+    static ValueTree decode (const File& presetFile);
+
 private:
     friend struct Pimpl; struct Pimpl;
     std::unique_ptr<Pimpl> pimpl;
@@ -18,12 +18,20 @@
 */
 
 #include "controllers/ScriptingController.h"
+#include "scripting/LuaEngine.h"
+#include "scripting/LuaScheduler.h"
+#include "Globals.h"
 
 namespace Element {
 
 ScriptingController::ScriptingController() {}
 ScriptingController::~ScriptingController() {}
 void ScriptingController::activate() {}
-void ScriptingController::deactivate() {}
+
+void ScriptingController::deactivate()
+{
+    // tasks shouldn't outlive the controllers they automate
+    getWorld().getLuaEngine().getScheduler().cancelAll();
+}
 
 }
@@ -28,6 +28,7 @@
 #include "gui/ContentComponent.h"
 
 #include "session/Node.h"
+#include "DataPath.h"
 #include "Globals.h"
 #include "Settings.h"
 
@@ -37,7 +38,9 @@ void SessionController::activate()
 {
     auto* app = dynamic_cast<AppController*> (getRoot());
     currentSession = app->getWorld().getSession();
-    document = new SessionDocument (currentSession);
+    document = new SessionDocument (currentSession, &writer);
+    lastAutosaveTime = Time::getMillisecondCounter();
+    startTimer (10 * 1000);
 }
 
 void SessionController::deactivate()
@@ -45,6 +48,10 @@ void SessionController::deactivate()
     auto& world = getWorld();
     auto& settings (world.getSettings());
     auto* props = settings.getUserSettings();
+
+    // saves still being written must land before the app goes away
+    stopTimer();
+    writer.waitUntilIdle();
     
     if (document)
     {
@@ -74,24 +81,14 @@ void SessionController::openFile (const File& file)
     
     if (file.hasFileExtension ("elg"))
     {
-        const ValueTree node (Node::parse (file));
-        if (Node::isProbablyGraphNode (node))
-        {
-            const Node model (node, true);
-            model.forEach ([](const ValueTree& tree)
-            {
-                if (! tree.hasType (Tags::node))
-                    return;
-                auto nodeRef = tree;
-                nodeRef.setProperty (Tags::uuid, Uuid().toString(), nullptr);
-            });
-            if (auto* ec = findSibling<EngineController>())
-                ec->addGraph (model);
-        }
+        // the graph's added when it's read, the engine loads its plugins from there
+        importGraph (file);
+        didSomething = false;
     }
     else if (file.hasFileExtension ("els"))
     {
         document->saveIfNeededAndUserAgrees();
+        writer.waitUntilIdle();
         Session::ScopedFrozenLock freeze (*currentSession);
         Result result = document->loadFrom (file, true);
         
@@ -137,7 +134,18 @@ void SessionController::exportGraph (const Node& node, const File& targetFile)
 
 void SessionController::importGraph (const File& file)
 {
-    openFile (file);
+    importer.import (file, [this] (const File& source, const ValueTree& graph, const String& error)
+    {
+        if (! graph.isValid())
+        {
+            Logger::writeToLog ("[EL] couldn't import " + source.getFullPathName() + ": " + error);
+            return;
+        }
+
+        // the importer's tree has new ids and nothing else holds it
+        if (auto* ec = findSibling<EngineController>())
+            ec->addGraph (Node (graph, true), false);
+    });
 }
 
 void SessionController::closeSession()
@@ -186,6 +194,52 @@ void SessionController::saveSession (const bool saveAs, const bool askForFile, c
     }
 }
 
+File SessionController::getAutosaveFile() const
+{
+    const auto file = getSessionFile();
+    if (file == File())
+        return DataPath::applicationDataDir().getChildFile ("Autosave.els");
+    return file.getSiblingFile (file.getFileNameWithoutExtension() + " (Autosave).els");
+}
+
+void SessionController::autosave()
+{
+    if (document == nullptr || currentSession == nullptr)
+        return;
+
+    currentSession->saveGraphState();
+    // state changes written just now shouldn't trigger the next autosave
+    currentSession->dispatchPendingMessages();
+    numAutosavedChanges = document->getNumChanges();
+    lastAutosaveTime = Time::getMillisecondCounter();
+
+    auto snapshot = currentSession->createSnapshot();
+    if (auto* cc = findSibling<GuiController>()->getContentComponent())
+    {
+        String state; cc->getSessionState (state);
+        snapshot.getOrCreateChildWithName (Tags::ui, nullptr)
+                .setProperty ("content", state, nullptr);
+    }
+
+    writer.write (snapshot, getAutosaveFile(), [](const File& file, const Result& result)
+    {
+        if (result.failed())
+            DBG("[EL] autosave to " << file.getFullPathName() << " failed: " << result.getErrorMessage());
+    });
+}
+
+void SessionController::timerCallback()
+{
+    const int minutes = getSettings().getAutosaveInterval();
+    if (minutes <= 0 || document == nullptr || writer.isWriting())
+        return;
+    if (! document->hasChangedSinceSaved() || document->getNumChanges() == numAutosavedChanges)
+        return;
+    if (Time::getMillisecondCounter() - lastAutosaveTime < (uint32) minutes * 60 * 1000)
+        return;
+    autosave();
+}
+
 void SessionController::newSession()
 {
     jassert (document && currentSession);
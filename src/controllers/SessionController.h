@@ -21,11 +21,14 @@
 
 #include "controllers/AppController.h"
 #include "documents/SessionDocument.h"
+#include "session/GraphImporter.h"
 #include "session/Session.h"
+#include "session/SessionWriter.h"
 #include "Signals.h"
 
 namespace Element {
-class SessionController : public AppController::Child
+class SessionController : public AppController::Child,
+                          private Timer
 {
 public:
     SessionController() { }
@@ -47,14 +50,29 @@ public:
     void resetChanges (const bool clearDocumentFile = false);
     
     void exportGraph (const Node& node, const File& targetFile);
+
+    /** Reads a graph file in the background and adds the graph to the
+        session once it's read */
     void importGraph (const File& file);
+
+    /** Writes a copy of the session next to its file, or to the application
+        data folder while it's untitled. The session itself stays unsaved */
+    void autosave();
+
+    /** Returns where autosave writes the current session */
+    File getAutosaveFile() const;
     
     Signal<void()> sessionLoaded;
 private:
     SessionPtr currentSession;
+    SessionWriter writer;
+    GraphImporter importer;
     ScopedPointer<SessionDocument> document;
+    int numAutosavedChanges = 0;
+    uint32 lastAutosaveTime = 0;
     void loadNewSessionData();
     void refreshOtherControllers();
+    void timerCallback() override;
 };
 
 }
@@ -32,6 +32,7 @@ void WorkspacesController::activate()
 void WorkspacesController::deactivate()
 {
     content = nullptr;
+    writer->flush();
 }
 
 void WorkspacesController::saveSettings()
@@ -45,6 +46,7 @@ bool WorkspacesController::handleMessage (const AppMessage& msg)
     if (const auto* wofm = dynamic_cast<const WorkspaceOpenFileMessage*> (&msg))
     {
         saveCurrentWorkspace();
+        writer->flush();
         const auto state = WorkspaceState::fromFile (wofm->file, true);
         content->applyWorkspaceState (state);
     }
@@ -163,10 +165,7 @@ bool WorkspacesController::perform (const InvocationInfo& info)
 
         case Commands::workspaceEditing:
         {
-            saveCurrentWorkspace();
-            auto state = WorkspaceState::loadByFileOrName ("Editing");
-            if (state.isValid() && content)
-                content->applyWorkspaceState (state);
+            saveCurrentAndLoadWorkspace ("Editing");
         } break;
 
         default: 
@@ -194,13 +193,19 @@ void WorkspacesController::saveCurrentWorkspace()
         auto name = content->getWorkspaceName();
         getWorld().getSettings().setWorkspace (name);
         name << ".elw";
-        state.writeToXmlFile (DataPath::workspacesDir().getChildFile (name));
+        const auto copy = state.createCopy();
+        writer->write (DataPath::workspacesDir().getChildFile (name),
+            [copy] (const File& file) { return copy.writeToXmlFile (file); });
     }
 }
 
 void WorkspacesController::saveCurrentAndLoadWorkspace (const String& name)
 {
+    // reloading the active workspace reads what was just queued
+    const bool reloading = content && content->getWorkspaceName() == name;
     saveCurrentWorkspace();
+    if (reloading)
+        writer->flush();
     auto state = WorkspaceState::loadByFileOrName (name);
     if (state.isValid() && content)
         content->applyWorkspaceState (state);
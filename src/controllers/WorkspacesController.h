@@ -20,6 +20,7 @@
 #pragma once
 
 #include "controllers/AppController.h"
+#include "SettingsWriter.h"
 
 namespace Element {
 
@@ -44,6 +45,7 @@ protected:
 
 private:
     Component::SafePointer<ContentComponent> content;
+    SharedResourcePointer<SettingsWriter> writer;
     void saveCurrentWorkspace();
     void saveCurrentAndLoadWorkspace (const String& name);
 };
@@ -18,12 +18,494 @@
 */
 
 #include "db/Database.h"
+#include "session/Node.h"
+#include "DataPath.h"
 
 namespace Element {
 
-Database::Database() {}
-Database::~Database() {}
+namespace DatabaseTags
+{
+    static const Identifier catalog       ("catalog");
+    static const Identifier record        ("record");
+    static const Identifier version       ("version");
+    static const Identifier kind          ("kind");
+    static const Identifier uid           ("uid");
+    static const Identifier name          ("name");
+    static const Identifier format        ("format");
+    static const Identifier identifier    ("identifier");
+    static const Identifier manufacturer  ("manufacturer");
+    static const Identifier category      ("category");
+    static const Identifier file          ("file");
+    static const Identifier modified      ("modified");
+}
+
+static const int catalogVersion = 1;
+
+static String getOwnerKey (Database::Kind kind, const String& format, const String& identifier)
+{
+    return String ((int) kind) + ":" + format + ":" + identifier;
+}
+
+/** Splits text into lower case words of letters and digits */
+static StringArray getWords (const String& text)
+{
+    StringArray words;
+    String word;
+    for (auto ptr = text.getCharPointer(); ! ptr.isEmpty(); ++ptr)
+    {
+        const auto c = *ptr;
+        if (CharacterFunctions::isLetterOrDigit (c))
+        {
+            word += CharacterFunctions::toLowerCase (c);
+        }
+        else if (word.isNotEmpty())
+        {
+            words.addIfNotAlreadyThere (word);
+            word.clear();
+        }
+    }
+
+    if (word.isNotEmpty())
+        words.addIfNotAlreadyThere (word);
+    return words;
+}
+
+/** Returns the words a record is found by */
+static StringArray getRecordWords (const Database::Record& record)
+{
+    StringArray text;
+    text.add (record.name);
+    text.add (record.manufacturer);
+    text.add (record.category);
+    text.add (record.format);
+    if (record.file != File())
+        text.add (record.file.getFileNameWithoutExtension());
+    return getWords (text.joinIntoString (" "));
+}
+
+static bool isSameRecord (const Database::Record& a, const Database::Record& b)
+{
+    return a.kind == b.kind && a.uid == b.uid && a.name == b.name && a.format == b.format
+        && a.identifier == b.identifier && a.manufacturer == b.manufacturer
+        && a.category == b.category && a.file == b.file && a.modified == b.modified;
+}
+
+//=============================================================================
+Database::Database() { }
+Database::~Database() { }
+
+File Database::getDefaultFile()
+{
+    return DataPath::applicationDataDir().getChildFile ("Catalog.eldb");
+}
+
+void Database::clear()
+{
+    records.clear();
+    numRecords = 0;
+    indexed = false;
+}
+
+int Database::add (const Record& record)
+{
+    records.add (new Record (record));
+    ++numRecords;
+    indexed = false;
+    return records.size() - 1;
+}
+
+void Database::remove (int id)
+{
+    if (records [id] == nullptr)
+        return;
+
+    // IDs stay put, so the slot is only emptied
+    records.set (id, nullptr);
+    --numRecords;
+    indexed = false;
+}
+
+bool Database::updatePlugins (const KnownPluginList& list)
+{
+    HashMap<String, int> existing;
+    for (int id = 0; id < records.size(); ++id)
+        if (auto* record = records.getUnchecked (id))
+            if (record->kind == plugin)
+                existing.set (record->uid, id);
+
+    bool changed = false;
+    for (int i = 0; i < list.getNumTypes(); ++i)
+    {
+        const auto* type = list.getType (i);
+        Record record;
+        record.kind         = plugin;
+        record.uid          = type->createIdentifierString();
+        record.name         = type->name;
+        record.format       = type->pluginFormatName;
+        record.identifier   = type->fileOrIdentifier;
+        record.manufacturer = type->manufacturerName;
+        record.category     = type->category;
+
+        if (existing.contains (record.uid))
+        {
+            const int id = existing [record.uid];
+            existing.remove (record.uid);
+            if (isSameRecord (*records.getUnchecked (id), record))
+                continue;
+            *records.getUnchecked (id) = record;
+            indexed = false;
+        }
+        else
+        {
+            add (record);
+        }
+
+        changed = true;
+    }
+
+    for (HashMap<String, int>::Iterator iter (existing); iter.next();)
+    {
+        remove (iter.getValue());
+        changed = true;
+    }
+
+    return changed;
+}
+
+bool Database::updateFiles (Kind kind, const Array<File>& files)
+{
+    bool changed = removeMissingFiles (kind, files);
+    Array<Record> changedRecords;
+    for (const auto& file : findChangedFiles (kind, files))
+    {
+        Record record;
+        readFile (kind, file, record);
+        changedRecords.add (record);
+    }
+
+    update (changedRecords);
+    return changed || ! changedRecords.isEmpty();
+}
+
+Array<File> Database::findChangedFiles (Kind kind, const Array<File>& files) const
+{
+    HashMap<String, int64> times;
+    for (const auto* record : records)
+        if (record != nullptr && record->kind == kind)
+            times.set (record->file.getFullPathName(), record->modified);
+
+    Array<File> changed;
+    for (const auto& file : files)
+    {
+        const auto path = file.getFullPathName();
+        if (! times.contains (path) || times [path] != file.getLastModificationTime().toMilliseconds())
+            changed.add (file);
+    }
+
+    return changed;
+}
+
+bool Database::removeMissingFiles (Kind kind, const Array<File>& files)
+{
+    HashMap<String, int> present;
+    for (const auto& file : files)
+        present.set (file.getFullPathName(), 0);
+
+    bool removed = false;
+    for (int id = 0; id < records.size(); ++id)
+    {
+        const auto* record = records.getUnchecked (id);
+        if (record != nullptr && record->kind == kind && ! present.contains (record->file.getFullPathName()))
+        {
+            remove (id);
+            removed = true;
+        }
+    }
+
+    return removed;
+}
+
+void Database::update (const Array<Record>& fileRecords)
+{
+    HashMap<String, int> existing;
+    for (int id = 0; id < records.size(); ++id)
+        if (const auto* record = records.getUnchecked (id))
+            existing.set (String ((int) record->kind) + record->file.getFullPathName(), id);
+
+    for (const auto& record : fileRecords)
+    {
+        const auto key = String ((int) record.kind) + record.file.getFullPathName();
+        if (! existing.contains (key))
+        {
+            existing.set (key, add (record));
+            continue;
+        }
+
+        auto* const target = records.getUnchecked (existing [key]);
+        if (! isSameRecord (*target, record))
+        {
+            *target = record;
+            indexed = false;
+        }
+    }
+}
+
+Array<int> Database::find (Kind kind) const
+{
+    Array<int> results;
+    for (int id = 0; id < records.size(); ++id)
+        if (auto* record = records.getUnchecked (id))
+            if (record->kind == kind)
+                results.add (id);
+    return results;
+}
 
-void Database::exec (const String& sql) {}
+Array<int> Database::find (Kind kind, const String& format, const String& identifier) const
+{
+    updateIndices();
+    const auto iter = owners.find (getOwnerKey (kind, format, identifier));
+    return iter != owners.end() ? iter->second : Array<int>();
+}
+
+struct RecordSorterByName
+{
+    RecordSorterByName (const OwnedArray<Database::Record>& r) : records (r) { }
+
+    int compareElements (int first, int second) const
+    {
+        const int result = records.getUnchecked (first)->name.compareIgnoreCase (
+                           records.getUnchecked (second)->name);
+        return result != 0 ? result : first - second;
+    }
+
+    const OwnedArray<Database::Record>& records;
+};
+
+Array<int> Database::search (const String& text, Kind kind, int maxResults) const
+{
+    const auto queries = getWords (text);
+    if (queries.isEmpty())
+        return {};
+
+    updateIndices();
+    SortedSet<int> matches;
+    for (int i = 0; i < queries.size(); ++i)
+    {
+        // words starting with the query sort right after it
+        const auto& query = queries [i];
+        SortedSet<int> found;
+        for (auto iter = words.lower_bound (query); iter != words.end() && iter->first.startsWith (query); ++iter)
+            for (const auto id : iter->second)
+                found.add (id);
+
+        if (i == 0)
+            matches.swapWith (found);
+        else
+            matches.removeValuesNotIn (found);
+
+        if (matches.isEmpty())
+            return {};
+    }
+
+    Array<int> results;
+    for (const auto id : matches)
+        if (kind == numKinds || records.getUnchecked (id)->kind == kind)
+            results.add (id);
+
+    RecordSorterByName sorter (records);
+    results.sort (sorter);
+    if (maxResults >= 0 && results.size() > maxResults)
+        results.removeRange (maxResults, results.size() - maxResults);
+    return results;
+}
+
+Array<int> Database::search (const String& text, const Array<int>& within) const
+{
+    const auto queries = getWords (text);
+    if (queries.isEmpty())
+        return {};
+
+    Array<int> results;
+    for (const auto id : within)
+    {
+        const auto* record = records [id];
+        if (record == nullptr)
+            continue;
+
+        const auto recordWords = getRecordWords (*record);
+        auto hasWordStartingWith = [&recordWords] (const String& query)
+        {
+            for (const auto& word : recordWords)
+                if (word.startsWith (query))
+                    return true;
+            return false;
+        };
+
+        bool matched = true;
+        for (const auto& query : queries)
+        {
+            if (! hasWordStartingWith (query))
+            {
+                matched = false;
+                break;
+            }
+        }
+
+        if (matched)
+            results.add (id);
+    }
+
+    return results;
+}
+
+bool Database::save (const File& file) const
+{
+    ValueTree catalog (DatabaseTags::catalog);
+    catalog.setProperty (DatabaseTags::version, catalogVersion, nullptr);
+    for (const auto* record : records)
+    {
+        if (record == nullptr)
+            continue;
+
+        ValueTree item (DatabaseTags::record);
+        item.setProperty (DatabaseTags::kind,           (int) record->kind, nullptr)
+            .setProperty (DatabaseTags::uid,            record->uid, nullptr)
+            .setProperty (DatabaseTags::name,           record->name, nullptr)
+            .setProperty (DatabaseTags::format,         record->format, nullptr)
+            .setProperty (DatabaseTags::identifier,     record->identifier, nullptr)
+            .setProperty (DatabaseTags::manufacturer,   record->manufacturer, nullptr)
+            .setProperty (DatabaseTags::category,       record->category, nullptr)
+            .setProperty (DatabaseTags::file,           record->file.getFullPathName(), nullptr)
+            .setProperty (DatabaseTags::modified,       record->modified, nullptr);
+        catalog.appendChild (item, nullptr);
+    }
+
+    file.getParentDirectory().createDirectory();
+    TemporaryFile temp (file);
+    {
+        FileOutputStream out (temp.getFile());
+        if (out.failedToOpen())
+            return false;
+
+        {
+            GZIPCompressorOutputStream gzip (out, 6);
+            catalog.writeToStream (gzip);
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool Database::load (const File& file)
+{
+    FileInputStream in (file);
+    if (in.failedToOpen())
+        return false;
+
+    GZIPDecompressorInputStream gzip (in);
+    const auto catalog = ValueTree::readFromStream (gzip);
+    if (! catalog.hasType (DatabaseTags::catalog)
+        || (int) catalog.getProperty (DatabaseTags::version) != catalogVersion)
+        return false;
+
+    clear();
+    for (int i = 0; i < catalog.getNumChildren(); ++i)
+    {
+        const auto item = catalog.getChild (i);
+        const int kind = item [DatabaseTags::kind];
+        if (kind < 0 || kind >= numKinds)
+            continue;
+
+        Record record;
+        record.kind         = (Kind) kind;
+        record.uid          = item [DatabaseTags::uid].toString();
+        record.name         = item [DatabaseTags::name].toString();
+        record.format       = item [DatabaseTags::format].toString();
+        record.identifier   = item [DatabaseTags::identifier].toString();
+        record.manufacturer = item [DatabaseTags::manufacturer].toString();
+        record.category     = item [DatabaseTags::category].toString();
+        record.modified     = (int64) item [DatabaseTags::modified];
+        const auto path     = item [DatabaseTags::file].toString();
+        if (File::isAbsolutePath (path))
+            record.file = File (path);
+        add (record);
+    }
+
+    return true;
+}
+
+void Database::updateIndices() const
+{
+    if (indexed)
+        return;
+
+    owners.clear();
+    words.clear();
+    for (int id = 0; id < records.size(); ++id)
+    {
+        const auto* record = records.getUnchecked (id);
+        if (record == nullptr)
+            continue;
+
+        if (record->identifier.isNotEmpty())
+            owners[getOwnerKey (record->kind, record->format, record->identifier)].add (id);
+
+        for (const auto& word : getRecordWords (*record))
+            words[word].add (id);
+    }
+
+    indexed = true;
+}
+
+bool Database::readFile (Kind kind, const File& file, Record& record)
+{
+    record = Record();
+    record.kind = kind;
+    record.file = file;
+    record.name = file.getFileNameWithoutExtension();
+    record.modified = file.getLastModificationTime().toMilliseconds();
+
+    if (kind != preset && kind != graph)
+        return file.existsAsFile();
+
+    if (kind == preset)
+    {
+        // the header is the outer element, so the state after it isn't read
+        MemoryBlock head;
+        FileInputStream in (file);
+        if (in.openedOk() && in.readIntoMemoryBlock (head, 4096) > 0)
+        {
+            XmlDocument doc (head.toString());
+            std::unique_ptr<XmlElement> e (doc.getDocumentElement (true));
+            if (e != nullptr && e->hasTagName (Tags::preset.toString())
+                && e->hasAttribute (Tags::format.toString())
+                && e->hasAttribute (Tags::identifier.toString()))
+            {
+                record.name       = e->getStringAttribute (Tags::name.toString(), record.name);
+                record.format     = e->getStringAttribute (Tags::format.toString());
+                record.identifier = e->getStringAttribute (Tags::identifier.toString());
+                return true;
+            }
+        }
+    }
+
+    const Node node (Node::parse (file), false);
+    if (! node.isValid())
+        return false;
+
+    if (node.getName().isNotEmpty())
+        record.name = node.getName();
+    if (kind == preset)
+    {
+        record.format     = node.getFormat().toString();
+        record.identifier = node.getIdentifier().toString();
+    }
+
+    return true;
+}
 
 }
@@ -23,13 +23,119 @@
 
 namespace Element {
 
+/** The catalog of plugins, presets, graphs and assets on this machine.
+
+    Records are indexed by kind, by the plugin they belong to and by the words
+    in their names, so lookups and searches don't walk lists or disks. File
+    records remember when their file was last modified, and only files that
+    changed are read again when a directory's records are updated. The catalog
+    is kept between runs in a single compressed file.
+ */
 class Database
 {
 public:
+    enum Kind
+    {
+        plugin = 0,
+        preset,
+        graph,
+        asset,
+        numKinds
+    };
+
+    struct Record
+    {
+        Kind kind = asset;
+        String uid;             // the identifier string of a plugin's description
+        String name;
+        String format;
+        String identifier;
+        String manufacturer;
+        String category;
+        File file;
+        int64 modified = 0;
+    };
+
     Database();
     virtual ~Database();
 
-    void exec (const String& sql);
+    /** Returns where the user's catalog is kept */
+    static File getDefaultFile();
+
+    /** Removes every record */
+    void clear();
+
+    /** Returns the number of records */
+    int getNumRecords() const noexcept { return numRecords; }
+
+    /** Adds a record and returns its ID */
+    int add (const Record& record);
+
+    /** Removes a record */
+    void remove (int id);
+
+    /** Returns a record, or nullptr if there isn't one with the ID */
+    const Record* getRecord (int id) const noexcept { return records [id]; }
+
+    /** Replaces the plugin records with the types in a list. Returns true if
+        anything changed */
+    bool updatePlugins (const KnownPluginList& list);
+
+    /** Brings the records of a kind in line with a set of files. Files that
+        are new or were modified are read again, those that are gone are
+        removed. Returns true if anything changed */
+    bool updateFiles (Kind kind, const Array<File>& files);
+
+    /** Returns the files in a set that are new or were modified since their
+        records were read */
+    Array<File> findChangedFiles (Kind kind, const Array<File>& files) const;
+
+    /** Removes the records of a kind whose files aren't in a set. Returns true
+        if any were removed */
+    bool removeMissingFiles (Kind kind, const Array<File>& files);
+
+    /** Adds file records, replacing those of the same kind read from the same
+        files */
+    void update (const Array<Record>& fileRecords);
+
+    /** Reads the record of a file. Presets saved with a header are read from
+        it without parsing their plugin state. This can be called from any
+        thread. Files that can't be read still get a bare record, so they
+        aren't read again until they change */
+    static bool readFile (Kind kind, const File& file, Record& record);
+
+    /** Returns the records of a kind */
+    Array<int> find (Kind kind) const;
+
+    /** Returns the records of a kind belonging to a plugin */
+    Array<int> find (Kind kind, const String& format, const String& identifier) const;
+
+    /** Returns the records with a word starting with each word in the text,
+        sorted by name. Pass numKinds to search every kind */
+    Array<int> search (const String& text, Kind kind = numKinds, int maxResults = -1) const;
+
+    /** Returns the records in a set that match the text, in the set's order.
+        Text typed after a search only narrows it, so its results can be
+        searched again instead of the whole catalog */
+    Array<int> search (const String& text, const Array<int>& within) const;
+
+    /** Writes the catalog to a file */
+    bool save (const File& file) const;
+
+    /** Replaces the catalog with one saved to a file */
+    bool load (const File& file);
+
+private:
+    OwnedArray<Record> records;
+    int numRecords = 0;
+
+    mutable bool indexed = false;
+    mutable std::map<String, Array<int>> owners;
+    mutable std::map<String, Array<int>> words;
+
+    void updateIndices() const;
+
+    JUCE_DECLARE_NON_COPYABLE (Database)
 };
 
-}
\ No newline at end of file
+}
@@ -18,6 +18,7 @@
 */
 
 #include "session/Session.h"
+#include "session/SessionArchive.h"
 #include "documents/SessionDocument.h"
 
 namespace Element {
@@ -36,9 +37,9 @@ namespace Element {
         }
     }
 
-    SessionDocument::SessionDocument (SessionPtr s)
+    SessionDocument::SessionDocument (SessionPtr s, SessionWriter* w)
         : FileBasedDocument (".els", "*.els", "Open Session", "Save Session"),
-          session (s)
+          session (s), writer (w)
     {
         if (session)
             session->addChangeListener (this);
@@ -61,24 +62,46 @@ namespace Element {
             return Result::fail ("No session data target");
 
         String error;
-        if (auto e = XmlDocument::parse (file))
+        ValueTree newData;
+        SessionArchive::Ptr archive;
+        const double started = Time::getMillisecondCounterHiRes();
+
+        if (SessionArchive::isArchive (file))
+        {
+            // plugin states are decoded together on several threads, nodes
+            // restoring them later only copy them out
+            archive = new SessionArchive();
+            if (archive->open (file))
+            {
+                newData = archive->readSession();
+                archive->decodeChunks();
+            }
+        }
+        else if (auto e = XmlDocument::parse (file))
         {
-            ValueTree newData (ValueTree::fromXml (*e));
-            if (! newData.isValid() && newData.hasType ("session"))
-                error = "Not a valid session file";
-            if (error.isEmpty() && !session->loadData (newData))
-                error = "Could not load session data";
+            newData = ValueTree::fromXml (*e);
         }
         else
         {
-            error = "Not a valid session file";
+            newData = Session::readFromFile (file);
         }
 
+        if (! newData.isValid() || ! newData.hasType (Tags::session))
+            error = "Not a valid session file";
+        else if (! session->loadData (newData))
+            error = "Could not load session data";
+        else if (archive != nullptr)
+            session->getValueTree().setProperty (Tags::archive, archive.get(), nullptr);
+
         if (error.isEmpty())
         {
             session->forEach (setMissingNodeProperties);
         }
 
+        DBG("[EL] session decoded: " << (Time::getMillisecondCounterHiRes() - started) << " ms, "
+            << (archive != nullptr ? archive->getNumChunks() : 0) << " state chunks");
+        ignoreUnused (started);
+
         return (error.isNotEmpty()) ? Result::fail (error) : Result::ok();
     }
 
@@ -88,14 +111,26 @@ namespace Element {
             return Result::fail ("Nil session");
         
         session->saveGraphState();
-        if (auto e = session->createXml())
+        // every state is back in the model, the old file can be replaced
+        session->getValueTree().removeProperty (Tags::archive, nullptr);
+        const auto snapshot = session->createSnapshot();
+        if (writer == nullptr)
+            return SessionWriter::writeSnapshot (snapshot, file);
+
+        // encoding and writing happen in the background, a failure puts the
+        // changes back so they aren't lost
+        WeakReference<SessionDocument> document (this);
+        writer->write (snapshot, file, [document] (const File& target, const Result& result)
         {
-            Result res (e->writeToFile (file, String())
-                    ? Result::ok() : Result::fail ("Error writing session file"));
-            return res;
-        }
-
-        return Result::fail ("Could not create session data");
+            if (result.wasOk())
+                return;
+            if (auto* doc = document.get())
+                doc->changed();
+            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Couldn't save session",
+                target.getFileName() + ": " + result.getErrorMessage());
+        });
+
+        return Result::ok();
     }
 
     File SessionDocument::getLastDocumentOpened() { return lastSession; }
@@ -104,7 +139,10 @@ namespace Element {
     void SessionDocument::onSessionChanged()
     {
         if (! session->notificationsFrozen())
+        {
+            ++numChanges;
             changed();
+        }
         else
             setChangedFlag (false);
     }
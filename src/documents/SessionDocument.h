@@ -21,15 +21,21 @@
 
 #include "ElementApp.h"
 #include "session/Session.h"
+#include "session/SessionWriter.h"
 
 namespace Element {
     class SessionDocument :  public FileBasedDocument,
                              public ChangeListener
     {
     public:
-        SessionDocument (SessionPtr);
+        /** Creates a document for a session. Saves are written in the
+            background when a writer is given */
+        SessionDocument (SessionPtr, SessionWriter* writer = nullptr);
         ~SessionDocument();
 
+        /** Returns the number of changes made to the session so far */
+        int getNumChanges() const noexcept { return numChanges; }
+
         String getDocumentTitle() override;
         Result loadDocument (const File& file) override;
         Result saveDocument (const File& file) override;
@@ -40,8 +46,11 @@ namespace Element {
 
     private:
         SessionPtr session;
+        SessionWriter* writer = nullptr;
         File lastSession;
+        int numChanges = 0;
         friend class Session;
         void onSessionChanged();
+        JUCE_DECLARE_WEAK_REFERENCEABLE (SessionDocument)
     };
 }
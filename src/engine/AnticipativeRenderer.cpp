@@ -0,0 +1,349 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AnticipativeRenderer.h"
+#include "engine/GraphProcessor.h"
+#include "engine/RealtimeThreads.h"
+
+namespace Element {
+
+/* How long the workers wait before looking again when every ring is full,
+   and how long a renderer goes unread before they leave it alone */
+static const int idleWaitMs = 1;
+static const uint32 idleAfterMs = 250;
+
+static void copyToRing (float* dest, const float* src, int numSamples) noexcept
+{
+    FloatVectorOperations::copy (dest, src, numSamples);
+}
+
+static void copyToRing (float* dest, const double* src, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] = (float) src[i];
+}
+
+//=============================================================================
+AnticipativeRenderer::AnticipativeRenderer (GraphProcessor& g, const GraphNodePtr& n,
+                                            int total, int outs, int maxBlock)
+    : graph (g), node (n),
+      totalChans (jmax (1, total)),
+      numOutputs (jlimit (1, jmax (1, total), outs)),
+      maxBlockSize (jmax (1, maxBlock)),
+      blockSize (jlimit (1, maxBlockSize, g.getRenderBlockSize())),
+      sampleRate (g.getRenderSampleRate() > 0.0 ? g.getRenderSampleRate() : 44100.0),
+      fifo (jmax (numBlocksAhead * blockSize, maxBlockSize) + 1)
+{
+    ring.setSize (numOutputs, fifo.getTotalSize());
+    ring.clear();
+    scratch.setSize (totalChans, maxBlockSize);
+    doubleScratch.setSize (totalChans, maxBlockSize);
+    midi.ensureSize (2048);
+    paramChanges.calloc ((size_t) GraphNode::maxParameterChanges);
+    basis.resetToDefault();
+    service->addRenderer (this);
+}
+
+AnticipativeRenderer::~AnticipativeRenderer()
+{
+    service->removeRenderer (this);
+
+    if (auto* const proc = node->getAudioProcessor())
+        if (proc->getPlayHead() == this)
+            proc->setPlayHead (graph.getPlayHead());
+}
+
+void AnticipativeRenderer::read (AudioSampleBuffer& buffer, const int numSamples) noexcept
+{
+    jassert (numSamples <= maxBlockSize);
+    lastReadMs.store (Time::getMillisecondCounter(), std::memory_order_relaxed);
+
+    CurrentPositionInfo live;
+    if (! getLivePosition (live))
+        live.resetToDefault();
+
+    const int numChans = jmin (numOutputs, buffer.getNumChannels());
+
+    if (! isInSync (live, numSamples))
+    {
+        numMisses.fetch_add (1, std::memory_order_relaxed);
+
+        // a worker is in the middle of a block, or the program's gone
+        const SpinLock::ScopedTryLockType sl (renderLock);
+        if (! sl.isLocked() || retired.load())
+        {
+            for (int ch = 0; ch < numChans; ++ch)
+                buffer.clear (ch, 0, numSamples);
+            return;
+        }
+
+        // start over from where the transport is now
+        fifo.reset();
+        basis = live;
+        writeTime = readTime = 0;
+        renderBlock (numSamples);
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < numChans; ++ch)
+    {
+        if (size1 > 0)
+            buffer.copyFrom (ch, 0, ring, ch, start1, size1);
+        if (size2 > 0)
+            buffer.copyFrom (ch, size1, ring, ch, start2, size2);
+    }
+    fifo.finishedRead (size1 + size2);
+    readTime += numSamples;
+}
+
+void AnticipativeRenderer::setRetired (const bool shouldRetire)
+{
+    retired.store (shouldRetire);
+
+    if (shouldRetire)
+    {
+        // waits out a block a worker might be rendering
+        const SpinLock::ScopedLockType sl (renderLock);
+    }
+}
+
+bool AnticipativeRenderer::getCurrentPosition (CurrentPositionInfo& result)
+{
+    if (renderThread.load() != Thread::getCurrentThreadId())
+        return getLivePosition (result);
+
+    result = basis;
+    if (basis.isPlaying)
+    {
+        result.timeInSamples += writeTime;
+        result.timeInSeconds = (double) result.timeInSamples / sampleRate;
+        result.ppqPosition += ((double) writeTime / sampleRate) * (basis.bpm / 60.0);
+    }
+
+    return true;
+}
+
+bool AnticipativeRenderer::getLivePosition (CurrentPositionInfo& result) const
+{
+    auto* const playHead = graph.getPlayHead();
+    return playHead != nullptr && playHead != this && playHead->getCurrentPosition (result);
+}
+
+bool AnticipativeRenderer::isInSync (const CurrentPositionInfo& live, const int numSamples) const noexcept
+{
+    if (fifo.getNumReady() < numSamples
+        || live.isPlaying != basis.isPlaying
+        || live.bpm != basis.bpm)
+        return false;
+
+    return ! live.isPlaying || live.timeInSamples == basis.timeInSamples + readTime;
+}
+
+double AnticipativeRenderer::getSecondsAhead() const noexcept
+{
+    if (retired.load()
+        || Time::getMillisecondCounter() - lastReadMs.load (std::memory_order_relaxed) > idleAfterMs
+        || fifo.getFreeSpace() < blockSize)
+        return -1.0;
+
+    return (double) fifo.getNumReady() / sampleRate;
+}
+
+bool AnticipativeRenderer::renderNextBlock()
+{
+    const SpinLock::ScopedLockType sl (renderLock);
+    if (retired.load() || fifo.getFreeSpace() < blockSize)
+        return false;
+
+    renderBlock (blockSize);
+    return true;
+}
+
+void AnticipativeRenderer::renderBlock (const int numSamples) noexcept
+{
+    auto* const proc = node->getAudioProcessor();
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+    if (proc == nullptr || size1 + size2 < numSamples)
+        return;
+
+    // the processor sees the position of the block it's rendering
+    renderThread.store (Thread::getCurrentThreadId());
+    if (proc->getPlayHead() != this)
+        proc->setPlayHead (this);
+
+    midi.clear();
+    if (proc->isUsingDoublePrecision())
+    {
+        AudioBuffer<double> buffer (doubleScratch.getArrayOfWritePointers(), totalChans, numSamples);
+        callProcessor (*proc, buffer);
+        for (int ch = 0; ch < numOutputs; ++ch)
+        {
+            copyToRing (ring.getWritePointer (ch, start1), buffer.getReadPointer (ch), size1);
+            copyToRing (ring.getWritePointer (ch, start2), buffer.getReadPointer (ch, size1), size2);
+        }
+    }
+    else
+    {
+        AudioSampleBuffer buffer (scratch.getArrayOfWritePointers(), totalChans, numSamples);
+        callProcessor (*proc, buffer);
+        for (int ch = 0; ch < numOutputs; ++ch)
+        {
+            copyToRing (ring.getWritePointer (ch, start1), buffer.getReadPointer (ch), size1);
+            copyToRing (ring.getWritePointer (ch, start2), buffer.getReadPointer (ch, size1), size2);
+        }
+    }
+
+    renderThread.store (nullptr);
+    fifo.finishedWrite (size1 + size2);
+    writeTime += numSamples;
+}
+
+void AnticipativeRenderer::applyParameterChanges() noexcept
+{
+    if (! node->hasPendingParameterChanges())
+        return;
+
+    const int numChanges = node->readParameterChanges (paramChanges, GraphNode::maxParameterChanges);
+    for (int i = 0; i < numChanges; ++i)
+        if (auto* param = node->getParameters().getObjectPointer (paramChanges[i].parameter))
+            param->setValueNotifyingHost (paramChanges[i].value);
+}
+
+template<typename SampleType>
+void AnticipativeRenderer::callProcessor (AudioProcessor& proc, AudioBuffer<SampleType>& buffer) noexcept
+{
+    // nothing feeds the node, so its inputs are silent
+    buffer.clear();
+    applyParameterChanges();
+    if (! node->isEnabled())
+        return;
+
+    if (proc.isSuspended())
+        proc.processBlockBypassed (buffer, midi);
+    else
+        proc.processBlock (buffer, midi);
+}
+
+//=============================================================================
+class RenderAheadService::Worker : public Thread
+{
+public:
+    Worker (RenderAheadService& s, int index)
+        : Thread ("el.renderAhead." + String (index)),
+          service (s) { }
+
+    void run() override
+    {
+        RealtimeThreads::applyBackgroundAffinity();
+        while (! threadShouldExit())
+        {
+            if (auto* renderer = service.claimMostUrgent())
+            {
+                renderer->renderNextBlock();
+                service.release (renderer);
+            }
+            else
+            {
+                wait (idleWaitMs);
+            }
+        }
+    }
+
+private:
+    RenderAheadService& service;
+};
+
+RenderAheadService::RenderAheadService()
+{
+    // the callback never waits on a worker, so a few cover plenty of nodes
+    const int numThreads = jlimit (1, 4, SystemStats::getNumCpus() / 2);
+    for (int i = 0; i < numThreads; ++i)
+        threads.add (new Worker (*this, i))->startThread (8);
+}
+
+RenderAheadService::~RenderAheadService()
+{
+    jassert (renderers.isEmpty());
+    for (auto* thread : threads)
+        thread->signalThreadShouldExit();
+    for (auto* thread : threads)
+        thread->notify();
+    for (auto* thread : threads)
+        thread->waitForThreadToExit (-1);
+    threads.clear();
+}
+
+int RenderAheadService::getNumRenderers() const
+{
+    const ScopedLock sl (lock);
+    return renderers.size();
+}
+
+void RenderAheadService::addRenderer (AnticipativeRenderer* renderer)
+{
+    const ScopedLock sl (lock);
+    renderers.addIfNotAlreadyThere (renderer);
+}
+
+void RenderAheadService::removeRenderer (AnticipativeRenderer* renderer)
+{
+    const ScopedLock sl (lock);
+    renderers.removeFirstMatchingValue (renderer);
+
+    // a worker might be rendering it right now
+    while (busy.contains (renderer))
+    {
+        const ScopedUnlock sul (lock);
+        Thread::sleep (1);
+    }
+}
+
+AnticipativeRenderer* RenderAheadService::claimMostUrgent()
+{
+    const ScopedLock sl (lock);
+    AnticipativeRenderer* best = nullptr;
+    double bestAhead = 0.0;
+
+    for (auto* renderer : renderers)
+    {
+        if (busy.contains (renderer))
+            continue;
+
+        const auto ahead = renderer->getSecondsAhead();
+        if (ahead >= 0.0 && (best == nullptr || ahead < bestAhead))
+        {
+            best = renderer;
+            bestAhead = ahead;
+        }
+    }
+
+    if (best != nullptr)
+        busy.add (best);
+    return best;
+}
+
+void RenderAheadService::release (AnticipativeRenderer* renderer)
+{
+    const ScopedLock sl (lock);
+    busy.removeFirstMatchingValue (renderer);
+}
+
+}
@@ -0,0 +1,160 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/GraphNode.h"
+
+namespace Element {
+
+class AnticipativeRenderer;
+class GraphProcessor;
+
+/** The workers rendering ahead for every AnticipativeRenderer in the process.
+
+    Like the DiskStreamer, each pass goes to the renderer with the least
+    audio ahead, so the one closest to running dry is served first however
+    many there are. There is one for the app, shared through a
+    SharedResourcePointer.
+ */
+class RenderAheadService
+{
+public:
+    RenderAheadService();
+    ~RenderAheadService();
+
+    /** Returns the number of worker threads */
+    int getNumThreads() const noexcept { return threads.size(); }
+
+    /** Returns the number of renderers being served */
+    int getNumRenderers() const;
+
+private:
+    friend class AnticipativeRenderer;
+    class Worker;
+    OwnedArray<Worker> threads;
+    CriticalSection lock;
+    Array<AnticipativeRenderer*> renderers;
+    Array<AnticipativeRenderer*> busy;
+
+    void addRenderer (AnticipativeRenderer*);
+    void removeRenderer (AnticipativeRenderer*);
+    AnticipativeRenderer* claimMostUrgent();
+    void release (AnticipativeRenderer*);
+
+    JUCE_DECLARE_NON_COPYABLE (RenderAheadService)
+};
+
+/** Renders a node ahead of the audio thread.
+
+    A node nothing live feeds, like a synth playing a sequence or a looper,
+    doesn't need the audio callback to run it. Background workers render a
+    few blocks of it into a lock-free ring, and the callback only copies the
+    next block out. The blocks are rendered against a play head extrapolated
+    from the transport, so when the transport jumps, stops, starts or changes
+    tempo the ring no longer matches. The callback then throws it away and
+    renders that block itself, and the workers carry on from there.
+
+    Parameter changes are heard once the blocks already rendered have played.
+ */
+class AnticipativeRenderer : public AudioPlayHead
+{
+public:
+    /** How many blocks the workers keep rendered */
+    static constexpr int numBlocksAhead = 4;
+
+    /** Creates a renderer for a node of a graph. The node's processor is
+        rendered with a buffer of totalChans channels, of which the first
+        numOutputs are kept. Workers render at the graph's block size, the
+        callback reads blocks of up to maxBlockSize. Call from the message
+        thread */
+    AnticipativeRenderer (GraphProcessor& graph, const GraphNodePtr& node,
+                          int totalChans, int numOutputs, int maxBlockSize);
+    ~AnticipativeRenderer();
+
+    /** Fills the first numOutputs channels of the buffer with the node's next
+        block. Call from the audio thread */
+    void read (AudioSampleBuffer& buffer, int numSamples) noexcept;
+
+    /** Stops the workers rendering, waiting for any render in progress to
+        finish, or lets them start again. A renderer whose program has been
+        replaced is stopped so the processor is never run from two places */
+    void setRetired (bool retired);
+
+    /** Returns the number of samples rendered ahead */
+    int getNumSamplesAhead() const noexcept { return fifo.getNumReady(); }
+
+    /** Returns the number of blocks the callback had to render itself */
+    int getNumMisses() const noexcept { return numMisses.load (std::memory_order_relaxed); }
+
+    /** Returns the position being rendered to the processor while it renders,
+        and the transport's to anyone else */
+    bool getCurrentPosition (CurrentPositionInfo& result) override;
+
+private:
+    friend class RenderAheadService;
+    SharedResourcePointer<RenderAheadService> service;
+    GraphProcessor& graph;
+    const GraphNodePtr node;
+    const int totalChans, numOutputs, maxBlockSize, blockSize;
+    const double sampleRate;
+
+    AbstractFifo fifo;
+    AudioSampleBuffer ring;
+    AudioSampleBuffer scratch;
+    AudioBuffer<double> doubleScratch;
+    MidiBuffer midi;
+    HeapBlock<GraphNode::ParameterChange> paramChanges;
+
+    // rendering happens under this lock, the audio thread only ever tries it
+    SpinLock renderLock;
+    std::atomic<Thread::ThreadID> renderThread { nullptr };
+    std::atomic<bool> retired { false };
+    std::atomic<uint32> lastReadMs { 0 };
+    std::atomic<int> numMisses { 0 };
+
+    // where the ring starts on the transport, and how far it has been
+    // rendered and read from there. the basis and write time only change
+    // under the render lock, the read time belongs to the audio thread
+    CurrentPositionInfo basis;
+    int64 writeTime = 0, readTime = 0;
+
+    bool getLivePosition (CurrentPositionInfo&) const;
+    bool isInSync (const CurrentPositionInfo& live, int numSamples) const noexcept;
+
+    /** Returns how many seconds are rendered ahead, or a negative value if
+        there's nothing for a worker to do */
+    double getSecondsAhead() const noexcept;
+
+    /** Renders the next block into the ring, if there's room. Called by workers */
+    bool renderNextBlock();
+
+    /** Renders a block into the ring. Call with the render lock held */
+    void renderBlock (int numSamples) noexcept;
+
+    /** Applies queued parameter changes. They jump, there's no block split */
+    void applyParameterChanges() noexcept;
+
+    template<typename SampleType>
+    void callProcessor (AudioProcessor&, AudioBuffer<SampleType>&) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnticipativeRenderer)
+};
+
+}
@@ -0,0 +1,190 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AudioCache.h"
+
+namespace Element {
+
+AudioCache::AudioCache() { }
+AudioCache::~AudioCache() { }
+
+int AudioCache::indexOf (const File& file) const
+{
+    for (int i = entries.size(); --i >= 0;)
+        if (entries.getUnchecked(i)->file == file)
+            return i;
+    return -1;
+}
+
+void AudioCache::touch (int index)
+{
+    entries.move (index, -1);
+}
+
+void AudioCache::evict()
+{
+    // entries a player holds stay, the cache's own reference is the only other
+    for (int i = 0; i < entries.size() && size > budget;)
+    {
+        auto* entry = entries.getUnchecked (i);
+        if (entry->getReferenceCount() > 1)
+        {
+            ++i;
+            continue;
+        }
+
+        size -= entry->getSizeInBytes();
+        entries.remove (i);
+    }
+}
+
+AudioCache::Entry::Ptr AudioCache::find (const File& file)
+{
+    const auto modified = file.getLastModificationTime();
+    const ScopedLock sl (lock);
+    const int index = indexOf (file);
+    if (index < 0)
+        return nullptr;
+
+    Entry::Ptr entry = entries.getUnchecked (index);
+    if (entry->modified != modified)
+    {
+        // players that still hold the old audio keep it, it just isn't shared anymore
+        size -= entry->getSizeInBytes();
+        entries.remove (index);
+        return nullptr;
+    }
+
+    touch (index);
+    return entry;
+}
+
+AudioCache::Entry::Ptr AudioCache::load (const File& file, AudioFormatManager& formats, int64 maxFrames)
+{
+    if (auto entry = find (file))
+        return entry;
+
+    std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->lengthInSamples > maxFrames)
+        return nullptr;
+
+    // decoded without the lock held, other files can be found meanwhile
+    Entry::Ptr entry = new Entry (file, file.getLastModificationTime());
+    entry->sampleRate = reader->sampleRate;
+    entry->audio.setSize (2, (int) reader->lengthInSamples);
+    // mono files are read into both channels, as they are when streamed
+    reader->read (&entry->audio, 0, entry->audio.getNumSamples(), 0, true, true);
+
+    const ScopedLock sl (lock);
+    const int index = indexOf (file);
+    if (index >= 0)
+    {
+        auto* other = entries.getUnchecked (index);
+        if (other->modified == entry->modified)
+        {
+            touch (index);
+            return other;
+        }
+
+        size -= other->getSizeInBytes();
+        entries.remove (index);
+    }
+
+    entries.add (entry);
+    size += entry->getSizeInBytes();
+    evict();
+    return entry;
+}
+
+void AudioCache::setBudget (int64 bytes)
+{
+    const ScopedLock sl (lock);
+    budget = jmax ((int64) 0, bytes);
+    evict();
+}
+
+int64 AudioCache::getBudget() const
+{
+    const ScopedLock sl (lock);
+    return budget;
+}
+
+int64 AudioCache::getSizeInBytes() const
+{
+    const ScopedLock sl (lock);
+    return size;
+}
+
+int AudioCache::getNumEntries() const
+{
+    const ScopedLock sl (lock);
+    return entries.size();
+}
+
+void AudioCache::purge()
+{
+    const ScopedLock sl (lock);
+    const auto oldBudget = budget;
+    budget = 0;
+    evict();
+    budget = oldBudget;
+}
+
+//=============================================================================
+CachedAudioSource::CachedAudioSource (AudioCache::Entry::Ptr e, bool shouldLoop)
+    : entry (e), looping (shouldLoop)
+{
+    jassert (entry != nullptr);
+}
+
+CachedAudioSource::~CachedAudioSource() { }
+
+void CachedAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    auto& dest = *info.buffer;
+    const auto& audio = entry->audio;
+    const int length = audio.getNumSamples();
+    const int numChannels = jmin (dest.getNumChannels(), audio.getNumChannels());
+
+    for (int c = numChannels; c < dest.getNumChannels(); ++c)
+        dest.clear (c, info.startSample, info.numSamples);
+
+    int done = 0;
+    while (done < info.numSamples)
+    {
+        if (position >= length)
+        {
+            if (! looping || length <= 0)
+                break;
+            position = 0;
+        }
+
+        const int n = (int) jmin ((int64) (info.numSamples - done), (int64) length - position);
+        for (int c = 0; c < numChannels; ++c)
+            dest.copyFrom (c, info.startSample + done, audio, c, (int) position, n);
+        done += n;
+        position += n;
+    }
+
+    if (done < info.numSamples)
+        for (int c = 0; c < numChannels; ++c)
+            dest.clear (c, info.startSample + done, info.numSamples - done);
+}
+
+}
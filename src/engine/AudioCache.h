@@ -0,0 +1,119 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Decoded audio files, shared by every player that has them open.
+
+    Entries are keyed by file and modification time, so an edited file is
+    decoded again. They're reference counted: players hold the entries they
+    play, and the cache keeps the rest, least recently used first, until
+    they'd take it over its budget. Since it outlives sessions and graphs,
+    files that were already decoded open again without reading the disk.
+ */
+class AudioCache
+{
+public:
+    /** A decoded file */
+    class Entry : public ReferenceCountedObject
+    {
+    public:
+        using Ptr = ReferenceCountedObjectPtr<Entry>;
+
+        Entry (const File& f, Time m) : file (f), modified (m) { }
+
+        const File file;
+        const Time modified;
+        double sampleRate = 44100.0;
+        AudioBuffer<float> audio;
+
+        /** Returns the memory the decoded audio takes */
+        int64 getSizeInBytes() const noexcept
+        {
+            return (int64) audio.getNumChannels() * audio.getNumSamples() * (int64) sizeof (float);
+        }
+    };
+
+    AudioCache();
+    ~AudioCache();
+
+    /** Returns the entry of a file only if it's already decoded and the file
+        hasn't changed since */
+    Entry::Ptr find (const File& file);
+
+    /** Returns the entry of a file, decoding it first if needed. Files longer
+        than maxFrames, or that can't be read, return nullptr */
+    Entry::Ptr load (const File& file, AudioFormatManager& formats, int64 maxFrames);
+
+    /** Sets the bytes that entries no player holds may take */
+    void setBudget (int64 bytes);
+    int64 getBudget() const;
+
+    /** Returns the bytes every entry takes, held or not */
+    int64 getSizeInBytes() const;
+    int getNumEntries() const;
+
+    /** Drops every entry no player holds */
+    void purge();
+
+private:
+    CriticalSection lock;
+    ReferenceCountedArray<Entry> entries; // least recently used first
+    int64 budget = 256 * 1024 * 1024;
+    int64 size = 0;
+
+    int indexOf (const File& file) const;
+    void touch (int index);
+    void evict();
+
+    JUCE_DECLARE_NON_COPYABLE (AudioCache)
+};
+
+/** Plays an entry of the AudioCache without copying it */
+class CachedAudioSource : public PositionableAudioSource
+{
+public:
+    CachedAudioSource (AudioCache::Entry::Ptr entry, bool shouldLoop);
+    ~CachedAudioSource();
+
+    AudioCache::Entry* getEntry() const noexcept { return entry.get(); }
+
+    /** @internal */
+    void prepareToPlay (int, double) override { }
+    void releaseResources() override { }
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+    void setNextReadPosition (int64 newPosition) override { position = jmax ((int64) 0, newPosition); }
+    int64 getNextReadPosition() const override  { return position; }
+    int64 getTotalLength() const override       { return entry->audio.getNumSamples(); }
+    bool isLooping() const override             { return looping; }
+    void setLooping (bool shouldLoop) override  { looping = shouldLoop; }
+
+private:
+    AudioCache::Entry::Ptr entry;
+    int64 position = 0;
+    bool looping = false;
+
+    JUCE_DECLARE_NON_COPYABLE (CachedAudioSource)
+};
+
+}
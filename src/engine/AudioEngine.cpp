@@ -18,20 +18,53 @@
 */
 
 #include "engine/AudioEngine.h"
+#include "engine/CallbackTracer.h"
+#include "engine/DirectMonitor.h"
 #include "engine/GraphProcessor.h"
 #include "engine/InternalFormat.h"
+#include "engine/MidiBudget.h"
+#include "engine/LinkSync.h"
 #include "engine/MidiClock.h"
 #include "engine/MidiChannelMap.h"
 #include "engine/MidiEngine.h"
+#include "engine/MidiInjectionQueue.h"
+#include "engine/MidiInputQueue.h"
+#include "engine/MidiOutputScheduler.h"
 #include "engine/MidiTranspose.h"
+#include "engine/RealtimeSanitizer.h"
+#include "engine/RealtimeThreads.h"
+#include "engine/RenderThreadPool.h"
+#include "engine/SampleConversion.h"
+#include "engine/TempoTable.h"
+#include "engine/TimelineTrace.h"
 #include "engine/Transport.h"
 #include "Globals.h"
 #include "Settings.h"
 
 namespace Element {
 
+Atomic<int> RootGraph::programRoutingSerial;
+
 RootGraph::RootGraph() { }
 
+void RootGraph::setMidiChannel (const int channel) noexcept
+{
+    GraphProcessor::setMidiChannel (channel);
+    ++programRoutingSerial;
+}
+
+void RootGraph::setMidiChannels (const BigInteger channels) noexcept
+{
+    GraphProcessor::setMidiChannels (channels);
+    ++programRoutingSerial;
+}
+
+void RootGraph::setMidiChannels (const kv::MidiChannels channels) noexcept
+{
+    GraphProcessor::setMidiChannels (channels);
+    ++programRoutingSerial;
+}
+
 void RootGraph::setPlayConfigFor (DeviceManager& devices)
 {
    #if EL_RUNNING_AS_PLUGIN
@@ -100,10 +133,14 @@ struct RootGraphRender : public AsyncUpdater
     std::function<void()> onActiveGraphChanged;
 
     RootGraphRender()
+        : parallelGraphs (*this)
     {
         graphs.ensureStorageAllocated (32);
     }
 
+    /** Set the pool used to render parallel mode graphs concurrently */
+    void setRenderThreadPool (RenderThreadPool* newPool) { pool = newPool; }
+
     void handleAsyncUpdate() override
     {
         if (onActiveGraphChanged)
@@ -131,23 +168,90 @@ struct RootGraphRender : public AsyncUpdater
     {
         numInputChans   = numIns;
         numOutputChans  = numOuts;
+        maxBlockSize    = jmax (1, numSamples);
+        MidiBudget::reserve (chunkMidi);
+        MidiBudget::reserve (chunkMidiOut);
+        MidiBudget::reserve (midiOut);
+        MidiBudget::reserve (midiTemp);
         audioTemp.setSize (jmax (numIns, numOuts), numSamples);
         audioOut.setSize (audioTemp.getNumChannels(), audioTemp.getNumSamples());
+        audioTempDouble.setSize (audioTemp.getNumChannels(), audioTemp.getNumSamples());
+        for (auto* scratch : scratches)
+            scratch->prepare (audioTemp.getNumChannels(), audioTemp.getNumSamples());
+
+        inputRouted.calloc ((size_t) jmax (1, numIns));
+        outputRouted.calloc ((size_t) jmax (1, numOuts));
+        numInputFlags = numIns;
+        numOutputFlags = numOuts;
+        updateRouting();
+    }
+
+    /** Sets which device channels the graphs read from and write to. The
+        rest aren't copied into the graphs or mixed, and those outputs are
+        only cleared. Until this is called every channel counts as routed.
+        Call with the engine locked */
+    void setRoutedChannels (const BigInteger& inputs, const BigInteger& outputs)
+    {
+        routedInputs  = inputs;
+        routedOutputs = outputs;
+        routingKnown  = true;
+        updateRouting();
+    }
+
+    /** Returns true if a graph reads the device input */
+    bool isInputRouted (const int channel) const noexcept
+    {
+        return ! isPositiveAndBelow (channel, numInputFlags) || inputRouted[channel].get() != 0;
+    }
+
+    /** Returns true if a graph writes the device output */
+    bool isOutputRouted (const int channel) const noexcept
+    {
+        return ! isPositiveAndBelow (channel, numOutputFlags) || outputRouted[channel].get() != 0;
     }
 
     void releaseBuffers()
     {
+        numInputFlags = numOutputFlags = 0;
         numInputChans = numOutputChans = 0;
+        maxBlockSize = 0;
         midiOut.clear();
         midiTemp.clear();
         audioTemp.setSize (1, 1);
         audioOut.setSize (1, 1);
-    }
-    void dumpGraphs() {
-        
+        audioTempDouble.setSize (1, 1);
+        for (auto* scratch : scratches)
+            scratch->prepare (1, 1);
     }
 
     void renderGraphs (AudioSampleBuffer& buffer, MidiBuffer& midi)
+    {
+        const int numSamples = buffer.getNumSamples();
+        if (maxBlockSize <= 0 || numSamples <= maxBlockSize)
+        {
+            renderBlock (buffer, midi);
+            return;
+        }
+
+        // hosts can send more than they prepared for. render it in pieces
+        // so none of the buffers need to grow on this thread
+        chunkMidiOut.clear();
+        MidiBudget::Writer chunkOut (chunkMidiOut);
+        for (int start = 0; start < numSamples; start += maxBlockSize)
+        {
+            const int numChunkSamples = jmin (maxBlockSize, numSamples - start);
+            AudioSampleBuffer chunk (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                     start, numChunkSamples);
+            chunkMidi.clear();
+            MidiBudget::Writer (chunkMidi).addEvents (midi, start, numChunkSamples, -start);
+            renderBlock (chunk, chunkMidi);
+            chunkOut.addEvents (chunkMidi, 0, numChunkSamples, start);
+        }
+
+        midi.swapWith (chunkMidiOut);
+    }
+
+    void renderBlock (AudioSampleBuffer& buffer, MidiBuffer& midi)
     {
        #if defined (EL_PRO)
         if (program.wasRequested())
@@ -182,6 +286,14 @@ struct RootGraphRender : public AsyncUpdater
         const int numSamples = buffer.getNumSamples();
         const int numChans   = buffer.getNumChannels();
         const bool graphChanged = lastGraph != currentGraph;
+
+        if (canRenderInPlace (current, graphChanged))
+        {
+            renderInPlace (*current, buffer, midi);
+            lastGraph = currentGraph;
+            return;
+        }
+
         const bool shouldProcess = true;
         const RootGraph::RenderMode mode = current->getRenderMode();
         const bool modeChanged = graphChanged && mode != last->getRenderMode();
@@ -193,57 +305,75 @@ struct RootGraphRender : public AsyncUpdater
 			audioTemp.setSize (buffer.getNumChannels(), buffer.getNumSamples(),
 							  false, false, true);
 
-            // clear the mixing area
+            // clear the mixing area, outputs nothing writes to stay out of it
             for (int i = numChans; --i >= 0;)
-                audioOut.clear (i, 0, numSamples);
+                if (isOutputRouted (i))
+                    audioOut.clear (i, 0, numSamples);
             midiOut.clear();
+
+            // device inputs are at the front of the buffer and it isn't written
+            // to until every graph is done, so they share a view of it
+            const AudioSampleBuffer input (buffer.getArrayOfWritePointers(),
+                                           jlimit (0, numChans, numInputChans), numSamples);
+
+            // steady parallel graphs go to the workers first, then get summed
+            // below in engine order like the rest
+            const bool renderedConcurrently = ! graphChanged
+                && renderParallelGraphs (input, numChans, midi, current);
             
             for (auto* const graph : graphs)
             {
-                // copy inputs, clear outs if more than input count
-                for (int i = 0; i < numInputChans; ++i)
-                    audioTemp.copyFrom (i, 0, buffer, i, 0, numSamples);
-                for (int i = numInputChans; i < numChans; ++i)
-                    audioTemp.clear (i, 0, numSamples);
-                
-                // clear so messages: avoids feedback loop when IO node ins are 
-                // connected to IO node outs
-                midiTemp.clear (0, numSamples);
-                
-                if ((last == graph && graphChanged && last->isSingle())
-                    || (graphChanged && current != nullptr && current->isSingle() && graph != current))
+                // inactive single graphs are suspended, the one losing focus
+                // keeps going until its fade out and tails have finished
+                if (graph->isSingle() && graph != current)
                 {
-                    // send kill messages to the last graph(s) when the graph changes
-                    // see http://nickfever.com/music/midi-cc-list
-                    for (int i = 0; i < 16; ++i)
-                    {
-                        // sustain pedal off
-                        midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 64, 0), 0);
-                        // Sostenuto off
-                        midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 66, 0), 0);
-                        // Hold off
-                        midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 69, 0), 0);
-
-                        midiTemp.addEvent (MidiMessage::allNotesOff (i + 1), 0);
-                    }
+                    if (graphChanged && graph == last)
+                        graph->drainSamples = getTailSamples (*graph) + numSamples;
+                    if (graph->drainSamples <= 0)
+                        continue;
+                    graph->drainSamples -= numSamples;
                 }
-                else if ((current == graph && graph->isSingle()) 
-                            || (current != nullptr && !current->isSingle() && !graph->isSingle()))
+                else
                 {
-                    // current single graph or parallel graphs get MIDI always
-                    midiTemp.addEvents (midi, 0, numSamples, 0);
+                    graph->drainSamples = 0;
                 }
 
+                auto* const scratch = renderedConcurrently && ! graph->isSingle()
+                    ? scratches.getUnchecked (graph->engineIndex) : nullptr;
+                const AudioSampleBuffer& rendered = scratch != nullptr ? scratch->audio : audioTemp;
+                const MidiBuffer& renderedMidi    = scratch != nullptr ? scratch->midi : midiTemp;
+
+                if (scratch == nullptr)
                 {
-                    const ScopedLock sl (graph->getCallbackLock());
-                    if (graph->isSuspended())
+                    // clear so messages: avoids feedback loop when IO node ins are 
+                    // connected to IO node outs
+                    midiTemp.clear (0, numSamples);
+                
+                    if ((last == graph && graphChanged && last->isSingle())
+                        || (graphChanged && current != nullptr && current->isSingle() && graph != current))
                     {
-                        graph->processBlockBypassed (audioTemp, midiTemp);
+                        // send kill messages to the last graph(s) when the graph changes
+                        // see http://nickfever.com/music/midi-cc-list
+                        for (int i = 0; i < 16; ++i)
+                        {
+                            // sustain pedal off
+                            midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 64, 0), 0);
+                            // Sostenuto off
+                            midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 66, 0), 0);
+                            // Hold off
+                            midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 69, 0), 0);
+
+                            midiTemp.addEvent (MidiMessage::allNotesOff (i + 1), 0);
+                        }
                     }
-                    else
+                    else if ((current == graph && graph->isSingle()) 
+                                || (current != nullptr && !current->isSingle() && !graph->isSingle()))
                     {
-                        graph->processBlock (audioTemp, midiTemp);
+                        // current single graph or parallel graphs get MIDI always
+                        MidiBudget::addEvents (midiTemp, midi, numSamples);
                     }
+
+                    renderGraph (*graph, input, audioTemp, audioTempDouble, midiTemp);
                 }
                 
                 if (graphChanged && ((current->isSingle() && current != graph) ||
@@ -252,7 +382,8 @@ struct RootGraphRender : public AsyncUpdater
                 {
                     // DBG("  FADE OUT LAST GRAPH: " << graph->engineIndex);
                     for (int i = 0; i < numOutputChans; ++i)
-                            audioOut.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
+                        if (isOutputRouted (i))
+                            audioOut.addFromWithRamp (i, 0, rendered.getReadPointer (i), 
                                                       numSamples, 1.f, 0.f);
                 }
                 else if ((graph == current && graph->isSingle()) ||
@@ -264,35 +395,31 @@ struct RootGraphRender : public AsyncUpdater
                     {
                         // DBG("  FADE IN NEW GRAPH: " << graph->engineIndex);
                         for (int i = 0; i < numOutputChans; ++i)
-                            audioOut.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
-                                                      numSamples, 0.f, 1.f);
+                            if (isOutputRouted (i))
+                                audioOut.addFromWithRamp (i, 0, rendered.getReadPointer (i), 
+                                                          numSamples, 0.f, 1.f);
                     }
                     else
                     {
                         for (int i = 0; i < numOutputChans; ++i)
-                            audioOut.addFrom (i, 0, audioTemp, i, 0, numSamples);
+                            if (isOutputRouted (i))
+                                audioOut.addFrom (i, 0, rendered, i, 0, numSamples);
                     }
                     
-                    midiOut.addEvents (midiTemp, 0, numSamples, 0);
+                    MidiBudget::addEvents (midiOut, renderedMidi, numSamples);
                 }
             }
 
+            // the rest may still hold the device input
             for (int i = 0; i < numChans; ++i)
-                buffer.copyFrom (i, 0, audioOut, i, 0, numSamples);
-
-            MidiBuffer::Iterator iter (midi);
-            MidiMessage msg; int frame = 0;
-            
-            // setup a program change if present
-           #if defined (EL_PRO)
-            while (iter.getNextEvent (msg, frame) && frame < numSamples)
             {
-                if (! msg.isProgramChange())
-                    continue;
-                program.program = msg.getProgramChangeNumber();
-                program.channel = msg.getChannel();
+                if (isOutputRouted (i))
+                    buffer.copyFrom (i, 0, audioOut, i, 0, numSamples);
+                else
+                    buffer.clear (i, 0, numSamples);
             }
-           #endif // EL_PRO
+
+            requestProgramChange (midi, numSamples);
 
             // done with input, swap it with the rendered output
             midi.swapWith (midiOut);
@@ -314,6 +441,8 @@ struct RootGraphRender : public AsyncUpdater
         graph->setLocked (locked);
         graphs.add (graph);
         graph->engineIndex = graphs.size() - 1;
+        updateScratches();
+        programMapDirty = true;
 
         if (graph->engineIndex == 0)
         {
@@ -328,9 +457,18 @@ struct RootGraphRender : public AsyncUpdater
     void removeGraph (RootGraph* graph)
     {
         jassert (graphs.contains (graph));
+        const int index = graphs.indexOf (graph);
         graphs.removeFirstMatchingValue (graph);
         graph->engineIndex = -1;
         updateIndexes();
+        updateScratches();
+        programMapDirty = true;
+
+        // graphs after the removed one moved down a slot
+        if (currentGraph > index)
+            --currentGraph;
+        if (lastGraph > index)
+            --lastGraph;
         if (currentGraph >= graphs.size())
             currentGraph = graphs.size() - 1;
         if (lastGraph >= graphs.size())
@@ -370,37 +508,270 @@ private:
 
     } program;
 
+    /** Engine indexes by MIDI channel and program, so a program change is a
+        lookup instead of a scan of every graph. -1 where no graph takes it */
+    int16 programMap [16][128];
+    bool programMapDirty = true;
+    uint32 programMapSerial = 0;
+
     int numInputChans       = -1;
     int numOutputChans      = -1;
     AudioSampleBuffer   audioOut, audioTemp;
+    AudioBuffer<double> audioTempDouble;
 
     MidiBuffer midiOut, midiTemp;
 
+    // the largest block rendered in one go, bigger ones are split
+    int maxBlockSize = 0;
+
+    // device channels the graphs use, read by the audio thread one flag at
+    // a time. a channel changing mid block is only copied or mixed late
+    BigInteger routedInputs, routedOutputs;
+    bool routingKnown = false;
+    HeapBlock<Atomic<int>> inputRouted, outputRouted;
+    int numInputFlags = 0, numOutputFlags = 0;
+
+    void updateRouting() noexcept
+    {
+        for (int i = 0; i < numInputFlags; ++i)
+            inputRouted[i].set (! routingKnown || routedInputs[i] ? 1 : 0);
+        for (int i = 0; i < numOutputFlags; ++i)
+            outputRouted[i].set (! routingKnown || routedOutputs[i] ? 1 : 0);
+    }
+    MidiBuffer chunkMidi, chunkMidiOut;
+
+    /** Buffers a graph renders into when run on a worker */
+    struct Scratch
+    {
+        AudioSampleBuffer audio;
+        AudioBuffer<double> audioDouble;
+        MidiBuffer midi;
+
+        void prepare (const int numChannels, const int numSamples)
+        {
+            audio.setSize (numChannels, numSamples);
+            audioDouble.setSize (numChannels, numSamples);
+            MidiBudget::reserve (midi);
+        }
+    };
+
+    /** One stage per graph, none depending on another. Stages of single mode
+        graphs do nothing */
+    struct ParallelGraphs : public RenderJob
+    {
+        ParallelGraphs (RootGraphRender& r) : owner (r) { }
+
+        void prepare (const int numGraphs) { setNumStages (numGraphs); }
+
+        void renderStage (int stage) noexcept override
+        {
+            auto* const graph = owner.graphs.getUnchecked (stage);
+            if (graph->isSingle())
+                return;
+
+            auto& scratch = *owner.scratches.getUnchecked (stage);
+            scratch.midi.clear();
+            if (midiWanted)
+                MidiBudget::addEvents (scratch.midi, *midiIn, audioIn->getNumSamples());
+            owner.renderGraph (*graph, *audioIn, scratch.audio, scratch.audioDouble, scratch.midi);
+        }
+
+        RootGraphRender& owner;
+        const AudioSampleBuffer* audioIn = nullptr;
+        const MidiBuffer* midiIn = nullptr;
+        bool midiWanted = false;
+    };
+
+    RenderThreadPool* pool = nullptr;
+    OwnedArray<Scratch> scratches;
+    ParallelGraphs parallelGraphs;
+
+    /** not realtime safe! keeps a scratch and job stage per graph */
+    void updateScratches()
+    {
+        while (scratches.size() < graphs.size())
+            scratches.add (new Scratch())->prepare (audioTemp.getNumChannels(), audioTemp.getNumSamples());
+        scratches.removeLast (scratches.size() - graphs.size());
+        parallelGraphs.prepare (graphs.size());
+    }
+
+    /** Renders parallel mode graphs on the pool. Returns false if there
+        weren't enough of them to be worth it, or no workers to run them */
+    bool renderParallelGraphs (const AudioSampleBuffer& input, const int numChans, const MidiBuffer& midi,
+                               const RootGraph* current) noexcept
+    {
+        if (pool == nullptr || pool->getNumWorkers() <= 0 || pool->isRenderingThread()
+            || parallelGraphs.getNumStages() != graphs.size())
+            return false;
+
+        int numParallel = 0;
+        for (const auto* graph : graphs)
+            if (! graph->isSingle())
+                ++numParallel;
+        if (numParallel < 2)
+            return false;
+
+        for (auto* scratch : scratches)
+        {
+            scratch->audio.setSize (numChans, input.getNumSamples(), false, false, true);
+            scratch->audioDouble.setSize (numChans, input.getNumSamples(), false, false, true);
+        }
+
+        parallelGraphs.audioIn = &input;
+        parallelGraphs.midiIn = &midi;
+        parallelGraphs.midiWanted = ! current->isSingle();
+        pool->render (parallelGraphs);
+        return true;
+    }
+
+    /** Returns true if the current graph is the only one that'd be heard or
+        rendered this block, so it can render into the buffer itself */
+    bool canRenderInPlace (const RootGraph* current, const bool graphChanged) const noexcept
+    {
+        if (graphChanged)
+            return false;
+        for (const auto* graph : graphs)
+            if (graph != current && (! graph->isSingle() || graph->drainSamples > 0))
+                return false;
+        return true;
+    }
+
+    /** Renders one graph straight into the device or host buffer. Its output
+        is the buffer's, so there's nothing to mix or copy back, which is
+        all that ever happens in the plugins */
+    void renderInPlace (RootGraph& graph, AudioSampleBuffer& buffer, MidiBuffer& midi) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        const int numChans   = buffer.getNumChannels();
+
+        // program changes are read from the input, before it's rendered over
+        requestProgramChange (midi, numSamples);
+
+        graph.drainSamples = 0;
+        const AudioSampleBuffer input (buffer.getArrayOfWritePointers(),
+                                       jlimit (0, numChans, numInputChans), numSamples);
+        renderGraph (graph, input, buffer, audioTempDouble, midi);
+
+        // the mix only ever held the device outputs
+        for (int i = jmax (0, numOutputChans); i < numChans; ++i)
+            buffer.clear (i, 0, numSamples);
+    }
+
+    /** Sets up a program change if one's in the input */
+    void requestProgramChange (const MidiBuffer& midi, const int numSamples) noexcept
+    {
+       #if defined (EL_PRO)
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame) && frame < numSamples)
+        {
+            if (! msg.isProgramChange())
+                continue;
+            program.program = msg.getProgramChangeNumber();
+            program.channel = msg.getChannel();
+        }
+       #else
+        ignoreUnused (midi, numSamples);
+       #endif
+    }
+
+    /** Renders a graph from the shared device input into audio. The input can
+        be a view of audio itself */
+    void renderGraph (RootGraph& graph, const AudioSampleBuffer& input, AudioSampleBuffer& audio,
+                      AudioBuffer<double>& audioDouble, MidiBuffer& midiBuffer) noexcept
+    {
+        const int numChans   = audio.getNumChannels();
+        const int numSamples = input.getNumSamples();
+        const ScopedLock sl (graph.getCallbackLock());
+
+        if (! graph.isUsingDoublePrecision() && ! graph.isSuspended())
+        {
+            // reads straight from the shared input
+            graph.processBlock (input, audio, midiBuffer);
+            return;
+        }
+
+        // bypassing and converting work in place, so these need a copy
+        const int numIns = jmin (input.getNumChannels(), numChans);
+        for (int i = 0; i < numIns; ++i)
+            if (audio.getReadPointer (i) != input.getReadPointer (i))
+                audio.copyFrom (i, 0, input, i, 0, numSamples);
+        for (int i = numIns; i < numChans; ++i)
+            audio.clear (i, 0, numSamples);
+
+        if (graph.isUsingDoublePrecision())
+        {
+            // 64-bit graphs only convert at the device boundary
+            audioDouble.setSize (numChans, numSamples, false, false, true);
+            SampleConversion::convert (audio, audioDouble, numChans, numSamples);
+            if (graph.isSuspended())
+                graph.processBlockBypassed (audioDouble, midiBuffer);
+            else
+                graph.processBlock (audioDouble, midiBuffer);
+            SampleConversion::convert (audioDouble, audio, numChans, numSamples);
+        }
+        else
+        {
+            graph.processBlockBypassed (audio, midiBuffer);
+        }
+    }
+
+    // upper limit on how long a graph is drained after losing focus
+    static constexpr double maxTailSeconds = 10.0;
+
+    static int64 getTailSamples (const RootGraph& graph)
+    {
+        const double tail = jlimit (0.0, maxTailSeconds, graph.getTailLengthSeconds());
+        return (int64) std::ceil (tail * graph.getSampleRate());
+    }
+
     void updateIndexes()
     {
         for (int i = 0 ; i < graphs.size(); ++i)
             graphs.getUnchecked(i)->engineIndex = i;
     }
 
-    int findGraphForProgram (const ProgramRequest& r) const
+    /** Fills the program table from the graphs. Only done after a graph was
+        added, removed or had its program or channels changed */
+    void rebuildProgramMap()
     {
-        if (isPositiveAndBelow (program.program, 128))
+        programMapSerial = RootGraph::getProgramRoutingSerial();
+        programMapDirty = false;
+
+        for (auto& channel : programMap)
+            for (auto& index : channel)
+                index = -1;
+
+        // backwards so the first graph with a program keeps it, as before
+        for (int i = graphs.size(); --i >= 0;)
         {
-            for (int i = 0; i < graphs.size(); ++i)
-            {
-                auto* const g = graphs.getUnchecked (i);
-                if (g->midiProgram == r.program && g->acceptsMidiChannel (program.channel))
-                    return g->engineIndex;
-            }
+            auto* const g = graphs.getUnchecked (i);
+            if (! isPositiveAndBelow (g->midiProgram, 128))
+                continue;
+            for (int channel = 1; channel <= 16; ++channel)
+                if (g->acceptsMidiChannel (channel))
+                    programMap [channel - 1][g->midiProgram] = (int16) i;
         }
+    }
 
-        return currentGraph;
+    int findGraphForProgram (const ProgramRequest& r)
+    {
+        if (! isPositiveAndBelow (r.program, 128) || ! isPositiveAndBelow (r.channel - 1, 16))
+            return currentGraph;
+
+        if (programMapDirty || programMapSerial != RootGraph::getProgramRoutingSerial())
+            rebuildProgramMap();
+
+        const int index = programMap [r.channel - 1][r.program];
+        return index >= 0 ? index : currentGraph;
     }
 };
 
 class AudioEngine::Private : public AudioIODeviceCallback,
                              public MidiInputCallback,
+                             public MidiKeyboardStateListener,
                              public Value::Listener,
+                             public ValueTree::Listener,
                              public MidiClock::Listener,
                              public Timer
 {
@@ -408,29 +779,39 @@ public:
     Private (AudioEngine& e)
         : engine (e),sampleRate (0), blockSize (0), isPrepared (false),
           numInputChans (0), numOutputChans (0),
-          tempBuffer (1, 1)
+          tempBuffer (1, 1),
+          midiOutScheduler (e.world.getMidiEngine())
     {
         tempoValue.addListener (this);
         externalClockValue.addListener (this);
+        doublePrecisionValue.addListener (this);
         currentGraph.set (-1);
         processMidiClock.set (0);
         sessionWantsExternalClock.set (0);
         midiClock.addListener (this);
         graphs.onActiveGraphChanged = std::bind (&AudioEngine::Private::onCurrentGraphChanged, this);
+        graphs.setRenderThreadPool (&renderPool);
         midiIOMonitor = new MidiIOMonitor();
+        MidiBudget::reserve (incomingMidi);
+        keyboardState.addListener (this);
         startTimerHz (90);
     }
 
     ~Private()
     {
+        midiOutScheduler.stop();
         graphs.onActiveGraphChanged = nullptr;
         midiClock.removeListener (this);
+        keyboardState.removeListener (this);
         tempoValue.removeListener (this);
         externalClockValue.removeListener (this);
+        doublePrecisionValue.removeListener (this);
+        sessionData.removeListener (this);
         
         if (isPrepared)
         {
-            jassertfalse;
+            // only a stopped device's release should still be waiting
+            jassert (releaseWanted.get() == 1);
             releaseResources();
             isPrepared = false;
         }
@@ -439,12 +820,40 @@ public:
     void timerCallback() override
     {
         midiIOMonitor->notify();
+
+        if (tempoTableWanted.compareAndSetBool (0, 1))
+            updateTempoTable();
+
+        if (releaseWanted.compareAndSetBool (0, 1))
+            audioStopped();
+
+        if (latencyNotifyWanted.get() == 1
+            && Time::getMillisecondCounter() - latencyChangedAt.get() >= latencySettleMs
+            && latencyNotifyWanted.compareAndSetBool (0, 1))
+            engine.sampleLatencyChanged();
+
+        if (tracer.checkOverrun() && dumpTraces.get() == 1)
+        {
+            // the history around a dropout is only useful once, keep dumps
+            // from piling up while the engine struggles
+            const uint32 now = Time::getMillisecondCounter();
+            if (now - lastTraceDump >= 5000)
+            {
+                lastTraceDump = now;
+                const auto dir = DataPath::applicationDataDir().getChildFile ("Traces");
+                dir.createDirectory();
+                tracer.writeToFile (dir.getNonexistentChildFile (
+                    "xrun-" + Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S"), ".csv", false));
+            }
+        }
     }
 
     RootGraph* getCurrentGraph() const { return graphs.getCurrentGraph(); }
     
     void onCurrentGraphChanged()
     {
+        engine.updateExternalLatencySamples();
+
         int currentGraph = -1;
         {
             ScopedLock sl (lock);
@@ -467,6 +876,13 @@ public:
                                 const int numSamples) override
     {
         jassert (sampleRate > 0 && blockSize > 0);
+        RealtimeSanitizer::ScopedRealtime realtime;
+        TimelineTrace::nameThread ("Audio Callback");
+        const TimelineTrace::Zone zone ("callback");
+        CallbackTracer::Record trace;
+        trace.startTicks = Time::getHighResolutionTicks();
+        trace.numSamples = numSamples;
+
         int totalNumChans = 0;
         ScopedNoDenormals denormals;
         if (numInputChannels > numOutputChannels)
@@ -474,20 +890,23 @@ public:
             // if there aren't enough output channels for the number of
             // inputs, we need to create some temporary extra ones (can't
             // use the input data in case it gets written to)
+            // inputs no graph reads are skipped. the graphs clear every
+            // channel past the outputs, so those left out stay silent
             tempBuffer.setSize (numInputChannels - numOutputChannels, numSamples,
-                                false, false, true);
+                                false, true, true);
             
             for (int i = 0; i < numOutputChannels; ++i)
             {
                 channels[totalNumChans] = outputChannelData[i];
-                memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
+                copyDeviceInput (channels[totalNumChans], inputChannelData[i], i, numSamples);
                 ++totalNumChans;
             }
             
             for (int i = numOutputChannels; i < numInputChannels; ++i)
             {
                 channels[totalNumChans] = tempBuffer.getWritePointer (i - numOutputChannels, 0);
-                memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
+                if (graphs.isInputRouted (i))
+                    memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
                 ++totalNumChans;
             }
         }
@@ -496,7 +915,7 @@ public:
             for (int i = 0; i < numInputChannels; ++i)
             {
                 channels[totalNumChans] = outputChannelData[i];
-                memcpy (channels[totalNumChans], inputChannelData[i], sizeof (float) * (size_t) numSamples);
+                copyDeviceInput (channels[totalNumChans], inputChannelData[i], i, numSamples);
                 ++totalNumChans;
             }
             
@@ -510,53 +929,83 @@ public:
 
         const bool wasPlaying = transport.isPlaying();
         AudioSampleBuffer buffer (channels, totalNumChans, numSamples);
+        trace.numMidiIn = incomingMidi.getNumEvents();
+        const int64 graphStart = Time::getHighResolutionTicks();
         processCurrentGraph (buffer, incomingMidi);
-
+        // the graph has written the outputs, the device inputs are untouched
+        monitor.process (inputChannelData, numInputChannels,
+                         outputChannelData, numOutputChannels, numSamples);
+        const int64 midiOutStart = Time::getHighResolutionTicks();
+        trace.graphMs = CallbackTracer::ticksToMs (midiOutStart - graphStart);
+        trace.graphIndex = currentGraph.get();
+
+        if (engine.world.getMidiEngine().hasDefaultMidiOutput())
         {
-            ScopedLock lockMidiOut (engine.world.getMidiEngine().getMidiOutputLock());
-            if (auto* const midiOut = engine.world.getMidiEngine().getDefaultMidiOutput())
+           #if defined (EL_PRO)
+            if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
             {
-               #if defined (EL_PRO)
-                if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
+                if (wasPlaying != transport.isPlaying())
                 {
-                    if (wasPlaying != transport.isPlaying())
+                    if (transport.isPlaying())
                     {
-                        if (transport.isPlaying())
-                        {
-                            incomingMidi.addEvent (transport.getPositionFrames() <= 0 
-                                ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
-                        }
-                        else
-                        {
-                            incomingMidi.addEvent (MidiMessage::midiStop(), 0);
-                        }
+                        incomingMidi.addEvent (transport.getPositionFrames() <= 0 
+                            ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
+                    }
+                    else
+                    {
+                        incomingMidi.addEvent (MidiMessage::midiStop(), 0);
                     }
-
-                    midiClockMaster.setTempo (transport.getTempo());
-                    midiClockMaster.render (incomingMidi, numSamples);
                 }
-               #endif
 
-                const double delayMs = 6.0;
-                if (! incomingMidi.isEmpty())
-                {
-                    midiIOMonitor->sent();
-                    midiOut->sendBlockOfMessages (incomingMidi, delayMs + Time::getMillisecondCounterHiRes(), sampleRate);
-                }
+                midiClockMaster.setTempo (transport.getTempo());
+                midiClockMaster.render (incomingMidi, numSamples);
+            }
+           #endif
+
+            if (! incomingMidi.isEmpty())
+            {
+                // this block is heard once the device's output latency has passed
+                const double blockTime = (Time::getMillisecondCounterHiRes()
+                    + outputLatencyMs.load (std::memory_order_relaxed)) * 0.001;
+                trace.numMidiOut = midiOutScheduler.push (incomingMidi, blockTime, sampleRate);
+                midiIOMonitor->sent();
             }
         }
         
         incomingMidi.clear();
+
+        const int64 endTicks = Time::getHighResolutionTicks();
+        trace.midiOutMs = CallbackTracer::ticksToMs (endTicks - midiOutStart);
+        trace.totalMs = CallbackTracer::ticksToMs (endTicks - trace.startTicks);
+        tracer.push (trace);
     }
     
+    /** Copies a device input into the output buffer sharing its channel, or
+        clears it if no graph reads the input. Device outputs can't be assumed
+        silent, so every one is written either way */
+    void copyDeviceInput (float* const dest, const float* const input, const int channel,
+                          const int numSamples) noexcept
+    {
+        if (graphs.isInputRouted (channel))
+            memcpy (dest, input, sizeof (float) * (size_t) numSamples);
+        else
+            zeromem (dest, sizeof (float) * (size_t) numSamples);
+    }
+
     void processCurrentGraph (AudioBuffer<float>& buffer, MidiBuffer& midi)
     {
         const int numSamples = buffer.getNumSamples();
-        messageCollector.removeNextBlockOfMessages (midi, numSamples);
+        drainMidiInput (midi, numSamples);
         
         const ScopedLock sl (lock);
         const bool shouldProcess = shouldBeLocked.get() == 0;
         const bool wasPlaying = transport.isPlaying();
+        if (isUsingExternalClock() && midiClock.isLocked())
+            transport.requestClockSync (midiClock.getTempo(),
+                                        midiClock.getBeatPosition (Time::getMillisecondCounterHiRes() * 0.001),
+                                        sampleRate);
+        else if (isFollowingLink())
+            link.sync (transport, sampleRate, outputLatencyMs.load (std::memory_order_relaxed));
         transport.preProcess (numSamples);
 
         if (shouldProcess)
@@ -613,13 +1062,44 @@ public:
         const int newBlockSize     = device->getCurrentBufferSizeSamples();
         const int numChansIn       = device->getActiveInputChannels().countNumberOfSetBits();
         const int numChansOut      = device->getActiveOutputChannels().countNumberOfSetBits();
+        updateOutputLatency (device);
+        if (newSampleRate > 0.0)
+            monitor.prepare (newSampleRate);
         audioAboutToStart (newSampleRate, newBlockSize, numChansIn, numChansOut);
     }
     
+    /** Works out how long after a block it's heard. A round trip measured
+        on the device replaces what the driver reports, half of the
+        difference going to the output */
+    void updateOutputLatency (AudioIODevice* device)
+    {
+        const double newSampleRate = device->getCurrentSampleRate();
+        const int newBlockSize = device->getCurrentBufferSizeSamples();
+        int latency = device->getOutputLatencyInSamples() + newBlockSize;
+
+        const int measured = engine.getWorld().getSettings().getMeasuredRoundTrip (
+            device->getName(), newSampleRate, newBlockSize);
+        if (measured >= 0)
+        {
+            // a block each way, on top of whatever the driver adds
+            const int reported = device->getInputLatencyInSamples()
+                + device->getOutputLatencyInSamples() + 2 * newBlockSize;
+            latency = jmax (0, latency + (measured - reported) / 2);
+        }
+
+        outputLatencyMs = newSampleRate > 0.0 ? 1000.0 * latency / newSampleRate : 0.0;
+    }
+
     void audioAboutToStart (const double newSampleRate, const int newBlockSize,
                             const int numChansIn, const int numChansOut)
     {
         const ScopedLock sl (lock);
+        releaseWanted.set (0);
+
+        // a new buffer size alone keeps the graphs running, only nodes that
+        // can't take the bigger blocks are prepared again
+        const bool onlyBlockSizeChanged = isPrepared && newSampleRate == sampleRate
+            && numChansIn == numInputChans && numChansOut == numOutputChans;
         
         sampleRate      = newSampleRate;
         blockSize       = newBlockSize;
@@ -627,12 +1107,21 @@ public:
         numOutputChans  = numChansOut;
         
         midiClock.reset (sampleRate, blockSize);
-        messageCollector.reset (sampleRate);
-        keyboardState.addListener (&messageCollector);
+        discardPendingMidi.store (true);
+        MidiBudget::reserve (incomingMidi);
+        tracer.prepare (sampleRate);
         channels.calloc ((size_t) jmax (numChansIn, numChansOut) + 2);
         
         graphs.prepareBuffers (numInputChans, numOutputChans, blockSize);
 
+        if (onlyBlockSizeChanged)
+        {
+            for (int i = 0; i < graphs.size(); ++i)
+                graphs.getGraph(i)->setBlockSize (blockSize);
+            midiOutScheduler.start();
+            return;
+        }
+
         if (isPrepared)
         {
             isPrepared = false;
@@ -641,17 +1130,20 @@ public:
 
         prepareToPlay (sampleRate, blockSize);
         isPrepared = true;
+        midiOutScheduler.start();
     }
     
     void audioDeviceStopped() override
     {
-        audioStopped();
+        // devices restart straight after stopping to change their settings,
+        // the graphs are only released if this one stays stopped
+        releaseWanted.set (1);
     }
     
     void audioStopped()
     {
         const ScopedLock sl (lock);
-        keyboardState.removeListener (&messageCollector);
+        releaseWanted.set (0);
         if (isPrepared)
             releaseResources();
         isPrepared  = false;
@@ -661,18 +1153,94 @@ public:
         graphs.releaseBuffers();
     }
     
-    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message) override
+    void handleNoteOn (MidiKeyboardState*, int channel, int note, float velocity) override
+    {
+        injectMidi (MidiMessage::noteOn (channel, note, velocity));
+    }
+
+    void handleNoteOff (MidiKeyboardState*, int channel, int note, float velocity) override
+    {
+        injectMidi (MidiMessage::noteOff (channel, note, velocity));
+    }
+
+    /** Queues a message made inside the app. Anything the injection queue
+        can't take goes through the host queue instead */
+    void injectMidi (const MidiMessage& message, int64 sampleTime = MidiInjectionQueue::asSoonAsPossible)
+    {
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+        if (! injectionQueue.post (message, sampleTime, now))
+            queueMidiInput (nullptr, message);
+    }
+
+    /** Copies a message into the queue of the input it came from. Each device
+        gets a queue of its own so its callback thread is the only producer.
+        Everything else, and devices beyond the last slot, share the host queue */
+    void queueMidiInput (MidiInput* source, const MidiMessage& message)
+    {
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+
+        if (source != nullptr)
+        {
+            for (auto& slot : deviceQueues)
+            {
+                // on failure another device claimed the slot and current holds it
+                MidiInput* current = slot.source.load();
+                if (current == nullptr && slot.source.compare_exchange_strong (current, source))
+                    current = source;
+
+                if (current == source)
+                {
+                    slot.queue.push (message, now);
+                    return;
+                }
+            }
+        }
+
+        const SpinLock::ScopedLockType sl (hostQueueLock);
+        hostQueue.queue.push (message, now);
+    }
+
+    void drainMidiInput (MidiBuffer& midi, int numSamples)
+    {
+        const TimelineTrace::Zone zone ("midi drain");
+        const bool discard = discardPendingMidi.exchange (false);
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+
+        auto drain = [&] (MidiInputQueue& queue)
+        {
+            if (discard)
+                queue.discard();
+            else
+                queue.drain (midi, numSamples, sampleRate, now);
+        };
+
+        for (auto& slot : deviceQueues)
+        {
+            if (slot.source.load() == nullptr)
+                break;
+            drain (slot.queue);
+        }
+
+        drain (hostQueue.queue);
+
+        if (discard)
+            injectionQueue.discard();
+        injectionQueue.drain (midi, numSamples, sampleRate, now);
+    }
+
+    void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override
     {
         if (! message.isActiveSense() && ! message.isMidiClock())
             midiIOMonitor->received();
-        messageCollector.addMessageToQueue (message);
+        queueMidiInput (source, message);
         const bool clockWanted = processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0;
-        if (clockWanted && message.isMidiClock())
+        if (clockWanted && (message.isMidiClock() || message.isSongPositionPointer()))
         {
             midiClock.process (message);
         }
         else if (clockWanted && message.isMidiStart())
         {
+            midiClock.process (message);
             transport.requestPlayState (true);
             transport.requestAudioFrame (0);
         }
@@ -692,11 +1260,16 @@ public:
         if (isPrepared)
             prepareGraph (graph, sampleRate, blockSize);
         ScopedLock sl (lock);
+        graph->setRenderThreadPool (&renderPool);
         if (graphs.addGraph (graph))
         {
             graph->renderingSequenceChanged.connect (
                 std::bind (&AudioEngine::updateExternalLatencySamples, &engine));
+            graph->renderingSequenceChanged.connect (
+                std::bind (&Private::updateRoutedChannels, this));
         }
+
+        updateRoutedChannels();
     }
     
     void removeGraph (RootGraph* graph)
@@ -706,10 +1279,109 @@ public:
             graphs.removeGraph (graph);
         }
         
+        updateRoutedChannels();
         graph->renderingSequenceChanged.disconnect_all_slots();
+        graph->setRenderThreadPool (nullptr);
         if (isPrepared)
             graph->releaseResources();
     }
+
+    /** Works out which device channels any graph reads or writes, so the
+        callback only copies and mixes those */
+    void updateRoutedChannels()
+    {
+        BigInteger inputs, outputs;
+        for (int i = 0; i < graphs.size(); ++i)
+        {
+            BigInteger graphInputs, graphOutputs;
+            graphs.getGraph(i)->getRoutedAudioChannels (graphInputs, graphOutputs);
+            inputs  |= graphInputs;
+            outputs |= graphOutputs;
+        }
+
+        ScopedLock sl (lock);
+        graphs.setRoutedChannels (inputs, outputs);
+    }
+
+    /** Switches every graph between 32 and 64-bit rendering. Graphs which
+        are playing are prepared again in the new precision */
+    void setDoublePrecision (const bool useDouble)
+    {
+        if (doublePrecision == useDouble)
+            return;
+
+        ScopedLock sl (lock);
+        doublePrecision = useDouble;
+        for (int i = 0; i < graphs.size(); ++i)
+        {
+            auto* const graph = graphs.getGraph (i);
+            if (isPrepared)
+            {
+                graph->releaseResources();
+                prepareGraph (graph, sampleRate, blockSize);
+            }
+            else
+            {
+                graph->setProcessingPrecision (getProcessingPrecision());
+            }
+        }
+    }
+
+    AudioProcessor::ProcessingPrecision getProcessingPrecision() const noexcept
+    {
+        return doublePrecision ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision;
+    }
+
+    void setNumRenderThreads (const int numThreads)
+    {
+        if (renderPool.getNumWorkers() == numThreads)
+            return;
+        ScopedLock sl (lock);
+        renderPool.setNumWorkers (numThreads);
+    }
+
+    void applyRealtimeSettings (const Settings& settings)
+    {
+        {
+            ScopedLock sl (lock);
+            renderPool.setThreadOptions (settings.isRealtimeRenderThreadsEnabled(),
+                                         settings.isRenderThreadPinningEnabled());
+        }
+
+        const bool shouldLock = settings.isMemoryLockingEnabled();
+        if (shouldLock != memoryLockRequested)
+        {
+            memoryLockRequested = shouldLock;
+            memoryLocked = RealtimeThreads::lockMemory (shouldLock) && shouldLock;
+        }
+
+        // called on the message thread, which moves along with the others
+        isolationRequested = settings.isBackgroundIsolationEnabled();
+        const auto mask = isolationRequested ? RealtimeThreads::getBackgroundMask (renderPool.getNumWorkers()) : 0;
+        RealtimeThreads::setBackgroundIsolation (mask);
+        const bool applied = mask != 0 ? RealtimeThreads::applyBackgroundAffinity()
+                                       : RealtimeThreads::setCurrentThreadAffinity (RealtimeThreads::getBackgroundMask (0));
+        isolated = isolationRequested && applied;
+    }
+
+    String getRealtimeStatus() const
+    {
+        auto describe = [](bool requested, bool succeeded) -> String {
+            return ! requested ? "off" : succeeded ? "yes" : "refused by the system";
+        };
+
+        const int numWorkers = renderPool.getNumWorkers();
+        StringArray lines;
+        lines.add ("Realtime priority: " + String (renderPool.getNumRealtimeWorkers()) + " of "
+                    + String (numWorkers) + " workers");
+        lines.add ("Pinned to cores: " + String (renderPool.getNumPinnedWorkers()) + " of "
+                    + String (numWorkers) + " workers");
+        lines.add ("Memory locked: " + describe (memoryLockRequested, memoryLocked));
+        lines.add ("Background threads isolated: " + describe (isolationRequested, isolated));
+        lines.add ("MIDI events dropped: " + String (MidiBudget::getNumDropped())
+                   + ", " + String (midiOutScheduler.getNumDropped()) + " at the output");
+        return lines.joinIntoString ("\n");
+    }
     
     void connectSessionValues()
     {
@@ -717,6 +1389,7 @@ public:
         {
             tempoValue.referTo (session->getPropertyAsValue (Tags::tempo));
             externalClockValue.referTo (session->getPropertyAsValue ("externalSync"));
+            doublePrecisionValue.referTo (session->getPropertyAsValue (Tags::doublePrecision));
             transport.requestMeter (session->getProperty (Tags::beatsPerBar, 4),
                                     session->getProperty (Tags::beatDivisor, 2));
         }
@@ -724,14 +1397,63 @@ public:
         {
             tempoValue = tempoValue.getValue();
             externalClockValue = externalClockValue.getValue();
+            doublePrecisionValue = doublePrecisionValue.getValue();
         }
     }
     
     void setSession (SessionPtr s)
     {
+        sessionData.removeListener (this);
         session = s;
+        sessionData = session != nullptr ? session->getValueTree() : ValueTree();
+        sessionData.addListener (this);
         connectSessionValues();
+        updateTempoTable();
+    }
+
+    /** Compiles the session's tempo map for the transport. Sessions without
+        one, and those following a MIDI clock or a host, keep a single tempo */
+    void updateTempoTable()
+    {
+       #if ! EL_RUNNING_AS_PLUGIN
+        const auto tempoMap = sessionData.getChildWithName ("tempoMap");
+        if (tempoMap.getNumChildren() > 0 && sampleRate > 0.0 && sessionWantsExternalClock.get() <= 0)
+            transport.setTempoTable (TempoTable::fromTempoMap (tempoMap, sampleRate, (double) tempoValue.getValue()));
+        else
+            transport.setTempoTable (nullptr);
+       #endif
+    }
+
+    static bool isTempoMapTree (const ValueTree& tree)
+    {
+        return tree.hasType ("tempoMap") || tree.getParent().hasType ("tempoMap");
     }
+
+    void valueTreePropertyChanged (ValueTree& tree, const Identifier&) override
+    {
+        if (isTempoMapTree (tree))
+            updateTempoTable();
+    }
+
+    void valueTreeChildAdded (ValueTree& parent, ValueTree& child) override
+    {
+        if (isTempoMapTree (parent) || child.hasType ("tempoMap"))
+            updateTempoTable();
+    }
+
+    void valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int) override
+    {
+        if (isTempoMapTree (parent) || child.hasType ("tempoMap"))
+            updateTempoTable();
+    }
+
+    void valueTreeChildOrderChanged (ValueTree& parent, int, int) override
+    {
+        if (parent.hasType ("tempoMap"))
+            updateTempoTable();
+    }
+
+    void valueTreeParentChanged (ValueTree&) override { }
     
     void valueChanged (Value& value) override
     {
@@ -740,6 +1462,9 @@ public:
             const float tempo = (float) tempoValue.getValue();
             if (sessionWantsExternalClock.get() <= 0 || processMidiClock.get() <= 0)
                 transport.requestTempo (tempo);
+            if (useLink.get() > 0)
+                link.setTempo (tempo);
+            updateTempoTable();
         }
         else if (externalClockValue.refersToSameSourceAs (value))
         {
@@ -754,6 +1479,11 @@ public:
             }
             
             sessionWantsExternalClock.set (wantsClock ? 1 : 0);
+            updateTempoTable();
+        }
+        else if (doublePrecisionValue.refersToSameSourceAs (value))
+        {
+            setDoublePrecision ((bool) value.getValue());
         }
     }
     
@@ -768,6 +1498,21 @@ public:
             transport.requestTempo (bpm);
     }
     
+    /** Joins or leaves the Link session */
+    void setUsingLink (bool shouldUseLink)
+    {
+        shouldUseLink = shouldUseLink && LinkSync::isAvailable();
+        link.setEnabled (shouldUseLink);
+        useLink.set (shouldUseLink ? 1 : 0);
+        if (shouldUseLink)
+            link.setTempo ((double) tempoValue.getValue());
+    }
+
+    bool isFollowingLink() const
+    {
+        return sessionWantsExternalClock.get() > 0 && useLink.get() > 0;
+    }
+
     void midiClockSignalAcquired()  override { }
     void midiClockSignalDropped()   override { }
     
@@ -784,8 +1529,12 @@ private:
     friend class AudioEngine;
     AudioEngine&        engine;
     Transport           transport;
+    RenderThreadPool    renderPool;
     RootGraphRender     graphs;
     SessionPtr          session;
+    ValueTree           sessionData;
+    Atomic<int>         tempoTableWanted { 0 };
+    Atomic<int>         releaseWanted { 0 };
     
     Value tempoValue;
     Atomic<float> nextTempo;
@@ -800,35 +1549,70 @@ private:
     HeapBlock<float*> channels;
     AudioSampleBuffer tempBuffer;
     MidiBuffer incomingMidi;
-    MidiMessageCollector messageCollector;
     MidiKeyboardState keyboardState;
 
+    /** Device callbacks never wait on the audio thread: each input pushes to
+        its own queue, drained at the top of every block */
+    struct DeviceQueue
+    {
+        std::atomic<MidiInput*> source { nullptr };
+        MidiInputQueue queue;
+    };
+
+    DeviceQueue deviceQueues [16];
+    DeviceQueue hostQueue;
+    SpinLock hostQueueLock;     // only held between producers
+    MidiInjectionQueue injectionQueue;
+    std::atomic<bool> discardPendingMidi { true };
+
     AudioSampleBuffer graphBuffer;
     AudioSampleBuffer graphMixBuffer;
 
     Value externalClockValue;
+    Value doublePrecisionValue;
+    bool doublePrecision = false;
     Atomic<int> sessionWantsExternalClock;
     Atomic<int> processMidiClock;
     Atomic<int> generateMidiClock { 0 };
     Atomic<int> sendMidiClockToInput { 0 };
 
     MidiClock midiClock;
+    LinkSync link;
+    Atomic<int> useLink { 0 };
     MidiClockMaster midiClockMaster;
     
     AudioPlayHead::CurrentPositionInfo hostPos, lastHostPos;
     
     int latencySamples = 0;
 
+    // latency changes are passed on once they've stopped for a while, so a
+    // session loading only has the host compensate once
+    Atomic<int> latencyNotifyWanted { 0 };
+    Atomic<uint32> latencyChangedAt { 0 };
+    static constexpr uint32 latencySettleMs = 250;
+
     // GraphRender::locked must match this default value
     Atomic<int> shouldBeLocked { 0 };
 
     MidiIOMonitorPtr midiIOMonitor;
+    MidiOutputScheduler midiOutScheduler;
+    std::atomic<double> outputLatencyMs { 0.0 };
+
+    CallbackTracer tracer;
+    DirectMonitor monitor;
+    Atomic<int> dumpTraces { 0 };
+    uint32 lastTraceDump = 0;
+
+    // realtime thread settings and whether they took
+    bool memoryLockRequested = false, memoryLocked = false;
+    bool isolationRequested = false, isolated = false;
 
     void prepareGraph (RootGraph* graph, double sampleRate, int estimatedBlockSize)
     {
         graph->setPlayConfigDetails (numInputChans, numOutputChans,
                                      sampleRate, blockSize);
         graph->setPlayHead (&transport);
+        graph->setProcessingPrecision (getProcessingPrecision());
         graph->prepareToPlay (sampleRate, estimatedBlockSize);
     }
     
@@ -836,8 +1620,12 @@ private:
     {
         midiClockMaster.setSampleRate (sampleRate);
         midiClockMaster.setTempo (transport.getTempo());
+        transport.prepareToPlay (sampleRate);
         for (int i = 0; i < graphs.size(); ++i)
             prepareGraph (graphs.getGraph(i), sampleRate, estimatedBlockSize);
+
+        // tables are built for a rate, the timer makes a new one on the message thread
+        tempoTableWanted.set (1);
     }
     
     void releaseResources()
@@ -893,8 +1681,58 @@ void AudioEngine::applySettings (Settings& settings)
     if (useMidiClock)
         priv->resetMidiClock();
     priv->processMidiClock.set (useMidiClock ? 1 : 0);
+    priv->setUsingLink (settings.getUserSettings()->getValue("clockSource") == "abletonLink");
     priv->generateMidiClock.set (settings.generateMidiClock() ? 1 : 0);
     priv->sendMidiClockToInput.set (settings.sendMidiClockToInput() ? 1 : 0);
+    priv->setNumRenderThreads (settings.getNumRenderThreads());
+    GraphNode::setMeterRefreshRate (settings.getMeterRefreshRate());
+    GraphNode::setIdleSuspendTime (settings.getIdleSuspendTime());
+    MidiBudget::setMaxEventsPerBlock (settings.getMidiEventBudget());
+    priv->dumpTraces.set (settings.isXrunTracingEnabled() ? 1 : 0);
+    TimelineTrace::setEnabled (settings.isTimelineTracingEnabled());
+    priv->applyRealtimeSettings (settings);
+}
+
+String AudioEngine::getRealtimeStatus() const
+{
+    return priv->getRealtimeStatus();
+}
+
+void AudioEngine::updateDeviceLatency()
+{
+    if (auto* device = world.getDeviceManager().getCurrentAudioDevice())
+        priv->updateOutputLatency (device);
+}
+
+double AudioEngine::getOutputLatencyMs() const
+{
+    return priv->outputLatencyMs.load();
+}
+
+int AudioEngine::getNumOverruns() const
+{
+    return priv->tracer.getNumOverruns();
+}
+
+bool AudioEngine::writeCallbackTrace (const File& file) const
+{
+    return priv->tracer.writeToFile (file);
+}
+
+void AudioEngine::getCallbackHistory (Array<CallbackTracer::Record>& records) const
+{
+    priv->tracer.getHistory (records);
+}
+
+DirectMonitor& AudioEngine::getDirectMonitor() const
+{
+    return priv->monitor;
+}
+
+SysExTransfer::Ptr AudioEngine::sendSysEx (const Array<MidiMessage>& messages,
+                                           const SysExTransfer::Options& options)
+{
+    return priv->midiOutScheduler.sendSysEx (messages, options);
 }
 
 bool AudioEngine::removeGraph (RootGraph* graph)
@@ -919,7 +1757,18 @@ void AudioEngine::addMidiMessage (const MidiMessage msg, bool handleOnDeviceQueu
     if (handleOnDeviceQueue)
         priv->handleIncomingMidiMessage (nullptr, msg);
     else
-        priv->messageCollector.addMessageToQueue (msg);
+        priv->injectMidi (msg);
+}
+
+void AudioEngine::scheduleMidiMessage (const MidiMessage& msg, int64 samplePosition)
+{
+    if (priv != nullptr)
+        priv->injectMidi (msg, jmax ((int64) 0, samplePosition));
+}
+
+int64 AudioEngine::getMidiInjectionPosition() const
+{
+    return priv != nullptr ? priv->injectionQueue.getNextBlockPosition() : 0;
 }
     
 void AudioEngine::setActiveGraph (const int index)
@@ -995,6 +1844,7 @@ void AudioEngine::processExternalBuffers (AudioBuffer<float>& buffer, MidiBuffer
 {
     if (priv)
     {
+        RealtimeSanitizer::ScopedRealtime realtime;
        #if EL_RUNNING_AS_PLUGIN
         world.getMidiEngine().processMidiBuffer (midi, buffer.getNumSamples(), priv->sampleRate);
        #endif
@@ -1052,8 +1902,14 @@ void AudioEngine::updateExternalLatencySamples()
         }
     }
 
+    // graphs keep the latency of each program, this only picks the right one.
+    // Rebuilds that leave it alone aren't passed on at all
+    if (latencySamples == priv->latencySamples)
+        return;
+
     priv->latencySamples = latencySamples;
-    sampleLatencyChanged();
+    priv->latencyChangedAt.set (Time::getMillisecondCounter());
+    priv->latencyNotifyWanted.set (1);
 }
 
 int AudioEngine::getExternalLatencySamples() const
@@ -20,9 +20,11 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/CallbackTracer.h"
 #include "engine/Engine.h"
 #include "engine/GraphProcessor.h"
 #include "engine/MidiIOMonitor.h"
+#include "engine/MidiOutputScheduler.h"
 #include "engine/Transport.h"
 #include "session/DeviceManager.h"
 #include "session/Session.h"
@@ -31,6 +33,7 @@ namespace Element {
 
 class Globals;
 class ClipFactory;
+class DirectMonitor;
 class EngineControl;
 class Settings;
 
@@ -93,7 +96,21 @@ public:
             return;
         ScopedLock sl (getCallbackLock());
         midiProgram = program;
+        ++programRoutingSerial;
     }
+
+    /** Set the allowed MIDI channel of this graph */
+    void setMidiChannel (const int channel) noexcept;
+
+    /** Set the allowed MIDI channels of this graph */
+    void setMidiChannels (const BigInteger channels) noexcept;
+
+    /** Set the allowed MIDI channels of this graph */
+    void setMidiChannels (const kv::MidiChannels channels) noexcept;
+
+    /** Changes each time any root graph's program or channels change, so the
+        engine knows when to rebuild its program change table */
+    static uint32 getProgramRoutingSerial() noexcept { return (uint32) programRoutingSerial.get(); }
     
     const String getName() const override;
     const String getInputChannelName (int channelIndex) const override;
@@ -117,9 +134,12 @@ private:
     int midiChannel = 0;
     int midiProgram = -1;
     int engineIndex = -1;
+    // samples left to render after losing focus in single mode
+    int64 drainSamples = 0;
     RenderMode renderMode = Parallel;
     
     bool locked = true;
+    static Atomic<int> programRoutingSerial;
 
     void updateChannelNames (AudioIODevice* device);
 };
@@ -127,6 +147,8 @@ private:
 class AudioEngine : public Engine
 {
 public:
+    /** Emitted on the message thread once the latency has settled after
+        changing, however many times it changed */
     Signal<void()> sampleLatencyChanged;
 
     AudioEngine (Globals&);
@@ -144,6 +166,15 @@ public:
                                         MidiInputDevice callback (don't use except for debugging)
      */
     void addMidiMessage (const MidiMessage msg, bool handleOnDeviceQueue = false);
+
+    /** Queues a message to land on an exact sample. Positions count the
+        samples the engine has processed, see getMidiInjectionPosition();
+        ones already past land at the start of the next block */
+    void scheduleMidiMessage (const MidiMessage& msg, int64 samplePosition);
+
+    /** Returns the sample position the next block starts on, for use with
+        scheduleMidiMessage() */
+    int64 getMidiInjectionPosition() const;
     
     void applySettings (Settings&);
     
@@ -187,6 +218,37 @@ public:
     Globals& getWorld() const;
     MidiIOMonitorPtr getMidiIOMonitor() const;
 
+    /** Works out the device's output latency again, e.g. after a round trip
+        has been measured on it */
+    void updateDeviceLatency();
+
+    /** Returns how long after a block is rendered it's heard, in milliseconds */
+    double getOutputLatencyMs() const;
+
+    /** Returns the number of audio callbacks that missed their deadline since
+        the device started */
+    int getNumOverruns() const;
+
+    /** Writes the timings of recent audio callbacks to a CSV file */
+    bool writeCallbackTrace (const File& file) const;
+
+    /** Copies the timings of recent audio callbacks, oldest first. This
+        doesn't lock anything the audio thread uses */
+    void getCallbackHistory (Array<CallbackTracer::Record>& records) const;
+
+    /** Returns the input to output routes mixed in after the graph, which
+        monitor with no more latency than the device's */
+    DirectMonitor& getDirectMonitor() const;
+
+    /** Sends a SysEx dump to the default MIDI output, paced so the device
+        can keep up. Messages that aren't SysEx are left out */
+    SysExTransfer::Ptr sendSysEx (const Array<MidiMessage>& messages,
+                                  const SysExTransfer::Options& options = {});
+
+    /** Describes which of the realtime thread settings the system accepted,
+        one per line */
+    String getRealtimeStatus() const;
+
 private:
     class Private;
     ScopedPointer<Private> priv;
@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AuxBus.h"
+
+namespace Element {
+
+//=============================================================================
+void AuxBuses::Bus::add (const float* const* source, const int numSourceChannels,
+                         const float gain, int numSamples) noexcept
+{
+    numSamples = jmin (numSamples, buffer.getNumSamples());
+    if (numSourceChannels <= 0 || numSamples <= 0)
+        return;
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* const dest = buffer.getWritePointer (c);
+        const auto* const src = source [jmin (c, numSourceChannels - 1)];
+        if (written)
+            FloatVectorOperations::addWithMultiply (dest, src, gain, numSamples);
+        else
+            FloatVectorOperations::copyWithMultiply (dest, src, gain, numSamples);
+    }
+
+    written = true;
+}
+
+void AuxBuses::Bus::add (const float* const* source, const int numSourceChannels,
+                         const float* gains, int numSamples) noexcept
+{
+    numSamples = jmin (numSamples, buffer.getNumSamples());
+    if (numSourceChannels <= 0 || numSamples <= 0)
+        return;
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* const dest = buffer.getWritePointer (c);
+        const auto* const src = source [jmin (c, numSourceChannels - 1)];
+        if (! written)
+            FloatVectorOperations::clear (dest, numSamples);
+        FloatVectorOperations::addWithMultiply (dest, src, gains, numSamples);
+    }
+
+    written = true;
+}
+
+//=============================================================================
+AuxBuses::AuxBuses() { }
+AuxBuses::~AuxBuses() { }
+
+AuxBuses::Bus* AuxBuses::getBus (const String& name)
+{
+    if (name.isEmpty())
+        return nullptr;
+    if (auto* const existing = findBus (name))
+        return existing;
+
+    const int index = numBuses.load();
+    if (index >= maxBuses)
+        return nullptr;
+
+    std::unique_ptr<Bus> bus (new Bus (name));
+    bus->buffer.setSize (numChannels, jmax (1, blockSize));
+    bus->buffer.clear();
+    buses [index].reset (bus.release());
+
+    // the slot is filled before the audio thread can count it
+    numBuses.store (index + 1, std::memory_order_release);
+    return buses [index].get();
+}
+
+AuxBuses::Bus* AuxBuses::findBus (const String& name) const
+{
+    for (int i = 0; i < getNumBuses(); ++i)
+        if (buses[i]->name == name)
+            return buses[i].get();
+    return nullptr;
+}
+
+StringArray AuxBuses::getBusNames() const
+{
+    StringArray names;
+    for (int i = 0; i < getNumBuses(); ++i)
+        names.add (buses[i]->name);
+    return names;
+}
+
+void AuxBuses::prepare (const int maxBlockSize)
+{
+    blockSize = jmax (1, maxBlockSize);
+    for (int i = 0; i < getNumBuses(); ++i)
+    {
+        buses[i]->buffer.setSize (numChannels, blockSize, false, false, true);
+        buses[i]->written = false;
+    }
+}
+
+void AuxBuses::beginBlock() noexcept
+{
+    const int count = getNumBuses();
+    for (int i = 0; i < count; ++i)
+        buses[i]->written = false;
+}
+
+}
@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** The named stereo buses aux sends mix into and aux returns read from.
+
+    Each graph has a set, shared by every node it renders including those of
+    racks inlined into it. Buses are created on the message thread as nodes
+    ask for them and live as long as the graph, so the audio thread can keep
+    plain pointers to them. A bus is cleared lazily: the first send of a
+    block overwrites it and later ones add to it, so an unused bus costs
+    nothing and a return of one that nothing was sent to renders silence.
+ */
+class AuxBuses
+{
+public:
+    enum { numChannels = 2, maxBuses = 64 };
+
+    class Bus
+    {
+    public:
+        const String& getName() const noexcept { return name; }
+
+        /** Mixes channels into the bus at a fixed gain. Mono sources feed
+            both sides. Audio thread */
+        void add (const float* const* source, int numSourceChannels,
+                  float gain, int numSamples) noexcept;
+
+        /** Mixes channels into the bus at a gain per sample */
+        void add (const float* const* source, int numSourceChannels,
+                  const float* gains, int numSamples) noexcept;
+
+        /** Returns true if something was sent to the bus this block */
+        bool hasSignal() const noexcept { return written; }
+
+        /** Returns the most samples a block can send */
+        int getNumSamples() const noexcept { return buffer.getNumSamples(); }
+
+        /** Returns a channel of the bus. Only valid when hasSignal is true */
+        const float* getReadPointer (int channel) const noexcept { return buffer.getReadPointer (channel); }
+
+    private:
+        friend class AuxBuses;
+        explicit Bus (const String& n) : name (n) { }
+
+        const String name;
+        AudioBuffer<float> buffer;
+        bool written = false;
+    };
+
+    AuxBuses();
+    ~AuxBuses();
+
+    /** Returns the bus with a name, creating it if needed. Returns nullptr
+        for an empty name or when there are already maxBuses. Message thread */
+    Bus* getBus (const String& name);
+
+    /** Returns the bus with a name if it exists */
+    Bus* findBus (const String& name) const;
+
+    /** Returns the names of the buses, in the order they were made */
+    StringArray getBusNames() const;
+
+    int getNumBuses() const noexcept { return numBuses.load (std::memory_order_acquire); }
+
+    /** Sizes the buses for the largest block. Call while the graph isn't
+        rendering */
+    void prepare (int maxBlockSize);
+
+    /** Marks every bus empty for the next block. Audio thread */
+    void beginBlock() noexcept;
+
+    /** Called on the message thread when a node changes the bus it uses, so
+        the graph can order the nodes of the bus again */
+    std::function<void()> onRoutingChanged;
+
+private:
+    std::unique_ptr<Bus> buses [maxBuses];
+    std::atomic<int> numBuses { 0 };
+    int blockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (AuxBuses)
+};
+
+}
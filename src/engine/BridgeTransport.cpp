@@ -0,0 +1,694 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/BridgeTransport.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <semaphore.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+#define EL_BRIDGE_CHANNEL_MAGIC     0x454c4243  // "ELBC"
+#define EL_BRIDGE_CHANNEL_VERSION   1
+
+namespace Element {
+
+static String getSystemName (const String& name)
+{
+   #if JUCE_WINDOWS
+    return "Local\\" + name;
+   #else
+    return "/" + name;
+   #endif
+}
+
+//=============================================================================
+SharedMemory::~SharedMemory()
+{
+    close();
+}
+
+bool SharedMemory::create (const String& newName, size_t numBytes)
+{
+    close();
+    const auto sysName = getSystemName (newName);
+
+   #if JUCE_WINDOWS
+    handle = CreateFileMappingW (INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                 (DWORD) ((uint64) numBytes >> 32), (DWORD) (numBytes & 0xffffffff),
+                                 sysName.toWideCharPointer());
+    if (handle == nullptr)
+        return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle (handle);
+        handle = nullptr;
+        return false;
+    }
+
+    data = MapViewOfFile (handle, FILE_MAP_ALL_ACCESS, 0, 0, numBytes);
+    if (data == nullptr)
+    {
+        CloseHandle (handle);
+        handle = nullptr;
+        return false;
+    }
+   #else
+    const int fd = shm_open (sysName.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+
+    void* mapped = MAP_FAILED;
+    if (ftruncate (fd, (off_t) numBytes) == 0)
+        mapped = mmap (nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close (fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        shm_unlink (sysName.toRawUTF8());
+        return false;
+    }
+
+    data = mapped;
+   #endif
+
+    name  = newName;
+    size  = numBytes;
+    owner = true;
+    zeromem (data, size);
+    return true;
+}
+
+bool SharedMemory::open (const String& newName)
+{
+    close();
+    const auto sysName = getSystemName (newName);
+
+   #if JUCE_WINDOWS
+    handle = OpenFileMappingW (FILE_MAP_ALL_ACCESS, FALSE, sysName.toWideCharPointer());
+    if (handle == nullptr)
+        return false;
+
+    data = MapViewOfFile (handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (data == nullptr || VirtualQuery (data, &info, sizeof (info)) == 0)
+    {
+        if (data != nullptr)
+            UnmapViewOfFile (data);
+        data = nullptr;
+        CloseHandle (handle);
+        handle = nullptr;
+        return false;
+    }
+
+    size = (size_t) info.RegionSize;
+   #else
+    const int fd = shm_open (sysName.toRawUTF8(), O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat (fd, &info) == 0 && info.st_size > 0)
+        mapped = mmap (nullptr, (size_t) info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close (fd);
+
+    if (mapped == MAP_FAILED)
+        return false;
+
+    data = mapped;
+    size = (size_t) info.st_size;
+   #endif
+
+    name  = newName;
+    owner = false;
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (data == nullptr)
+        return;
+
+   #if JUCE_WINDOWS
+    UnmapViewOfFile (data);
+    CloseHandle (handle);
+    handle = nullptr;
+   #else
+    munmap (data, size);
+    if (owner)
+        shm_unlink (getSystemName (name).toRawUTF8());
+   #endif
+
+    data  = nullptr;
+    size  = 0;
+    owner = false;
+    name  = String();
+}
+
+//=============================================================================
+InterProcessSemaphore::~InterProcessSemaphore()
+{
+    close();
+}
+
+bool InterProcessSemaphore::create (const String& newName)
+{
+    close();
+    const auto sysName = getSystemName (newName);
+
+   #if JUCE_WINDOWS
+    handle = CreateSemaphoreW (nullptr, 0, 0x7fffffff, sysName.toWideCharPointer());
+    if (handle != nullptr && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle (handle);
+        handle = nullptr;
+    }
+   #else
+    auto* sem = sem_open (sysName.toRawUTF8(), O_CREAT | O_EXCL, 0600, 0);
+    handle = sem != SEM_FAILED ? (void*) sem : nullptr;
+   #endif
+
+    if (handle == nullptr)
+        return false;
+
+    name  = newName;
+    owner = true;
+    return true;
+}
+
+bool InterProcessSemaphore::open (const String& newName)
+{
+    close();
+    const auto sysName = getSystemName (newName);
+
+   #if JUCE_WINDOWS
+    handle = OpenSemaphoreW (SEMAPHORE_ALL_ACCESS, FALSE, sysName.toWideCharPointer());
+   #else
+    auto* sem = sem_open (sysName.toRawUTF8(), 0);
+    handle = sem != SEM_FAILED ? (void*) sem : nullptr;
+   #endif
+
+    if (handle == nullptr)
+        return false;
+
+    name  = newName;
+    owner = false;
+    return true;
+}
+
+void InterProcessSemaphore::close()
+{
+    if (handle == nullptr)
+        return;
+
+   #if JUCE_WINDOWS
+    CloseHandle (handle);
+   #else
+    sem_close ((sem_t*) handle);
+    if (owner)
+        sem_unlink (getSystemName (name).toRawUTF8());
+   #endif
+
+    handle = nullptr;
+    owner  = false;
+    name   = String();
+}
+
+void InterProcessSemaphore::signal() noexcept
+{
+    jassert (handle != nullptr);
+   #if JUCE_WINDOWS
+    ReleaseSemaphore (handle, 1, nullptr);
+   #else
+    sem_post ((sem_t*) handle);
+   #endif
+}
+
+bool InterProcessSemaphore::wait (double timeoutMs) noexcept
+{
+    jassert (handle != nullptr);
+
+   #if JUCE_WINDOWS
+    const DWORD ms = timeoutMs < 0.0 ? INFINITE : (DWORD) std::ceil (timeoutMs);
+    return WaitForSingleObject (handle, ms) == WAIT_OBJECT_0;
+
+   #elif JUCE_LINUX
+    auto* sem = (sem_t*) handle;
+    if (timeoutMs < 0.0)
+    {
+        while (sem_wait (sem) != 0)
+            if (errno != EINTR)
+                return false;
+        return true;
+    }
+
+    struct timespec deadline;
+    clock_gettime (CLOCK_REALTIME, &deadline);
+    const auto ns = (int64) deadline.tv_nsec + (int64) (timeoutMs * 1000000.0);
+    deadline.tv_sec  += (time_t) (ns / 1000000000);
+    deadline.tv_nsec  = (long) (ns % 1000000000);
+
+    while (sem_timedwait (sem, &deadline) != 0)
+        if (errno != EINTR)
+            return false;
+    return true;
+
+   #else
+    // no timed waits on macOS' named semaphores, so poll up to the deadline,
+    // yielding rather than sleeping to keep the wake up latency low
+    auto* sem = (sem_t*) handle;
+    if (timeoutMs < 0.0)
+    {
+        while (sem_wait (sem) != 0)
+            if (errno != EINTR)
+                return false;
+        return true;
+    }
+
+    const auto deadline = Time::getMillisecondCounterHiRes() + timeoutMs;
+    while (sem_trywait (sem) != 0)
+    {
+        if (Time::getMillisecondCounterHiRes() >= deadline)
+            return false;
+        Thread::yield();
+    }
+    return true;
+   #endif
+}
+
+//=============================================================================
+struct SharedRingBuffer::Header
+{
+    std::atomic<uint32> readPosition;
+    std::atomic<uint32> writePosition;
+    uint32 capacity;
+    uint32 reserved;
+};
+
+static_assert (std::atomic<uint32>::is_always_lock_free,
+               "Ring positions must be lock free to be shared between processes");
+
+/* timestamp and size ahead of each message */
+static const uint32 messageHeaderSize = sizeof (int32) + sizeof (uint16);
+
+size_t SharedRingBuffer::getRequiredSize (uint32 capacity) noexcept
+{
+    return sizeof (Header) + capacity;
+}
+
+void SharedRingBuffer::initialise (void* memory, uint32 capacity) noexcept
+{
+    jassert (isPowerOfTwo (capacity));
+    auto* h = new (memory) Header();
+    h->readPosition.store (0);
+    h->writePosition.store (0);
+    h->capacity = capacity;
+    h->reserved = 0;
+}
+
+void SharedRingBuffer::attach (void* memory) noexcept
+{
+    header = static_cast<Header*> (memory);
+    buffer = static_cast<uint8*> (memory) + sizeof (Header);
+}
+
+uint32 SharedRingBuffer::getNumReady() const noexcept
+{
+    return header->writePosition.load (std::memory_order_acquire)
+        - header->readPosition.load (std::memory_order_acquire);
+}
+
+bool SharedRingBuffer::write (int32 timestamp, const void* data, uint16 size) noexcept
+{
+    const uint32 position = header->writePosition.load (std::memory_order_relaxed);
+    const uint32 used = position - header->readPosition.load (std::memory_order_acquire);
+    if (header->capacity - used < messageHeaderSize + size)
+        return false;
+
+    copyIn (position, &timestamp, sizeof (timestamp));
+    copyIn (position + sizeof (timestamp), &size, sizeof (size));
+    copyIn (position + messageHeaderSize, data, size);
+    header->writePosition.store (position + messageHeaderSize + size, std::memory_order_release);
+    return true;
+}
+
+bool SharedRingBuffer::read (int32& timestamp, void* dest, uint16& size, uint16 maxSize) noexcept
+{
+    for (;;)
+    {
+        const uint32 position = header->readPosition.load (std::memory_order_relaxed);
+        const uint32 ready = header->writePosition.load (std::memory_order_acquire) - position;
+        if (ready < messageHeaderSize)
+            return false;
+
+        copyOut (position, &timestamp, sizeof (timestamp));
+        copyOut (position + sizeof (timestamp), &size, sizeof (size));
+        const uint32 next = position + messageHeaderSize + size;
+
+        if (size <= maxSize)
+        {
+            copyOut (position + messageHeaderSize, dest, size);
+            header->readPosition.store (next, std::memory_order_release);
+            return true;
+        }
+
+        header->readPosition.store (next, std::memory_order_release);
+    }
+}
+
+void SharedRingBuffer::copyIn (uint32 position, const void* data, uint32 size) noexcept
+{
+    const uint32 mask = header->capacity - 1;
+    const uint32 start = position & mask;
+    const uint32 first = jmin (size, header->capacity - start);
+    memcpy (buffer + start, data, first);
+    memcpy (buffer, static_cast<const uint8*> (data) + first, size - first);
+}
+
+void SharedRingBuffer::copyOut (uint32 position, void* data, uint32 size) const noexcept
+{
+    const uint32 mask = header->capacity - 1;
+    const uint32 start = position & mask;
+    const uint32 first = jmin (size, header->capacity - start);
+    memcpy (data, buffer + start, first);
+    memcpy (static_cast<uint8*> (data) + first, buffer, size - first);
+}
+
+//=============================================================================
+struct BridgeChannel::Header
+{
+    uint32 magic;
+    uint32 version;
+    int32 numInputs;
+    int32 numOutputs;
+    int32 maxBlockSize;
+    uint32 ringSize;
+
+    // the block, written by the engine before the plugin's process wakes
+    int32 numSamples;
+    int32 isPlaying;
+    int32 isRecording;
+    int32 isLooping;
+    int32 timeSigNumerator;
+    int32 timeSigDenominator;
+    double bpm;
+    double timeInSeconds;
+    double ppqPosition;
+    double ppqPositionOfLastBarStart;
+    int64 timeInSamples;
+};
+
+static size_t alignToCacheLine (size_t size) noexcept
+{
+    return (size + 63) & ~(size_t) 63;
+}
+
+size_t BridgeChannel::getRingOffset (const Layout& layout, int ring) noexcept
+{
+    return alignToCacheLine (sizeof (Header))
+        + (size_t) ring * alignToCacheLine (SharedRingBuffer::getRequiredSize (layout.ringSize));
+}
+
+size_t BridgeChannel::getRequiredSize (const Layout& layout) noexcept
+{
+    return getRingOffset (layout, 3)
+        + (size_t) (layout.numInputs + layout.numOutputs) * (size_t) layout.maxBlockSize * sizeof (float);
+}
+
+BridgeChannel::BridgeChannel() { }
+
+BridgeChannel::~BridgeChannel()
+{
+    close();
+}
+
+String BridgeChannel::createUniqueName()
+{
+    return "elb" + String::toHexString (Random::getSystemRandom().nextInt64()).paddedLeft ('0', 16);
+}
+
+bool BridgeChannel::create (const String& name, const Layout& newLayout)
+{
+    close();
+    layout = newLayout;
+    jassert (isPowerOfTwo (layout.ringSize) && layout.maxBlockSize > 0);
+
+    if (! memory.create (name, getRequiredSize (layout))
+        || ! requested.create (name + "q") || ! replied.create (name + "r"))
+    {
+        close();
+        return false;
+    }
+
+    header = new (memory.getData()) Header();
+    header->magic           = EL_BRIDGE_CHANNEL_MAGIC;
+    header->version         = EL_BRIDGE_CHANNEL_VERSION;
+    header->numInputs       = layout.numInputs;
+    header->numOutputs      = layout.numOutputs;
+    header->maxBlockSize    = layout.maxBlockSize;
+    header->ringSize        = layout.ringSize;
+
+    auto* const base = static_cast<uint8*> (memory.getData());
+    for (int i = 0; i < 3; ++i)
+        SharedRingBuffer::initialise (base + getRingOffset (layout, i), layout.ringSize);
+
+    return attach();
+}
+
+bool BridgeChannel::open (const String& name)
+{
+    close();
+    if (! memory.open (name) || memory.getSize() < sizeof (Header))
+    {
+        close();
+        return false;
+    }
+
+    header = static_cast<Header*> (memory.getData());
+    if (header->magic != EL_BRIDGE_CHANNEL_MAGIC || header->version != EL_BRIDGE_CHANNEL_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    layout.numInputs    = header->numInputs;
+    layout.numOutputs   = header->numOutputs;
+    layout.maxBlockSize = header->maxBlockSize;
+    layout.ringSize     = header->ringSize;
+
+    if (! isPowerOfTwo (layout.ringSize) || memory.getSize() < getRequiredSize (layout)
+        || ! requested.open (name + "q") || ! replied.open (name + "r"))
+    {
+        close();
+        return false;
+    }
+
+    return attach();
+}
+
+bool BridgeChannel::attach()
+{
+    auto* const base = static_cast<uint8*> (memory.getData());
+    midiIn.attach     (base + getRingOffset (layout, 0));
+    midiOut.attach    (base + getRingOffset (layout, 1));
+    parameters.attach (base + getRingOffset (layout, 2));
+    audio = reinterpret_cast<float*> (base + getRingOffset (layout, 3));
+    scratch.allocate (layout.ringSize, true);
+    waitingForReply = false;
+    numLateBlocks = 0;
+    return true;
+}
+
+void BridgeChannel::close()
+{
+    requested.close();
+    replied.close();
+    memory.close();
+    header = nullptr;
+    audio = nullptr;
+}
+
+float* BridgeChannel::getChannel (bool input, int channel) const noexcept
+{
+    const int index = input ? channel : layout.numInputs + channel;
+    return audio + (size_t) index * (size_t) layout.maxBlockSize;
+}
+
+void BridgeChannel::readMidi (SharedRingBuffer& ring, MidiBuffer& midi, int numSamples)
+{
+    int32 timestamp = 0;
+    uint16 size = 0;
+    const auto maxSize = (uint16) jmin ((uint32) 0xffff, layout.ringSize);
+    while (ring.read (timestamp, scratch.get(), size, maxSize))
+        midi.addEvent (scratch.get(), (int) size, jlimit (0, jmax (0, numSamples - 1), (int) timestamp));
+}
+
+bool BridgeChannel::process (AudioBuffer<float>& buffer, MidiBuffer& midi,
+                             const AudioPlayHead::CurrentPositionInfo& position, double timeoutMs)
+{
+    jassert (header != nullptr);
+    jassert (buffer.getNumSamples() <= layout.maxBlockSize);
+    const int numSamples = jmin (buffer.getNumSamples(), layout.maxBlockSize);
+
+    // MIDI goes in even if the last block's still out, so none is lost
+    {
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data = nullptr;
+        int size = 0, frame = 0;
+        while (iter.getNextEvent (data, size, frame))
+            if (size <= 0xffff)
+                midiIn.write (frame, data, (uint16) size);
+    }
+    midi.clear();
+
+    if (waitingForReply)
+    {
+        if (! replied.wait (0.0))
+        {
+            ++numLateBlocks;
+            buffer.clear();
+            return false;
+        }
+
+        waitingForReply = false;
+        readMidi (midiOut, midi, numSamples);
+    }
+
+    header->numSamples                  = numSamples;
+    header->isPlaying                   = position.isPlaying ? 1 : 0;
+    header->isRecording                 = position.isRecording ? 1 : 0;
+    header->isLooping                   = position.isLooping ? 1 : 0;
+    header->timeSigNumerator            = position.timeSigNumerator;
+    header->timeSigDenominator          = position.timeSigDenominator;
+    header->bpm                         = position.bpm;
+    header->timeInSeconds               = position.timeInSeconds;
+    header->ppqPosition                 = position.ppqPosition;
+    header->ppqPositionOfLastBarStart   = position.ppqPositionOfLastBarStart;
+    header->timeInSamples               = position.timeInSamples;
+
+    for (int c = 0; c < layout.numInputs; ++c)
+    {
+        if (c < buffer.getNumChannels())
+            memcpy (getChannel (true, c), buffer.getReadPointer (c), sizeof (float) * (size_t) numSamples);
+        else
+            zeromem (getChannel (true, c), sizeof (float) * (size_t) numSamples);
+    }
+
+    requested.signal();
+
+    if (! replied.wait (timeoutMs))
+    {
+        waitingForReply = true;
+        ++numLateBlocks;
+        buffer.clear();
+        return false;
+    }
+
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+    {
+        if (c < layout.numOutputs)
+            memcpy (buffer.getWritePointer (c), getChannel (false, c), sizeof (float) * (size_t) numSamples);
+        else
+            buffer.clear (c, 0, numSamples);
+    }
+
+    readMidi (midiOut, midi, numSamples);
+    return true;
+}
+
+bool BridgeChannel::pushParameter (int index, float value) noexcept
+{
+    return parameters.write ((int32) index, &value, sizeof (value));
+}
+
+bool BridgeChannel::receive (AudioBuffer<float>& buffer, MidiBuffer& midi,
+                             AudioPlayHead::CurrentPositionInfo& position, double timeoutMs)
+{
+    jassert (header != nullptr);
+    if (! requested.wait (timeoutMs))
+        return false;
+
+    const int numSamples = jlimit (0, layout.maxBlockSize, (int) header->numSamples);
+    buffer.setSize (jmax (1, layout.numInputs, layout.numOutputs), numSamples, false, false, true);
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+    {
+        if (c < layout.numInputs)
+            memcpy (buffer.getWritePointer (c), getChannel (true, c), sizeof (float) * (size_t) numSamples);
+        else
+            buffer.clear (c, 0, numSamples);
+    }
+
+    midi.clear();
+    readMidi (midiIn, midi, numSamples);
+
+    position.resetToDefault();
+    position.isPlaying                  = header->isPlaying != 0;
+    position.isRecording                = header->isRecording != 0;
+    position.isLooping                  = header->isLooping != 0;
+    position.timeSigNumerator           = header->timeSigNumerator;
+    position.timeSigDenominator         = header->timeSigDenominator;
+    position.bpm                        = header->bpm;
+    position.timeInSeconds              = header->timeInSeconds;
+    position.ppqPosition                = header->ppqPosition;
+    position.ppqPositionOfLastBarStart  = header->ppqPositionOfLastBarStart;
+    position.timeInSamples              = header->timeInSamples;
+    return true;
+}
+
+bool BridgeChannel::popParameter (int& index, float& value) noexcept
+{
+    int32 timestamp = 0;
+    uint16 size = 0;
+    if (! parameters.read (timestamp, &value, size, sizeof (value)))
+        return false;
+    index = (int) timestamp;
+    return size == sizeof (value);
+}
+
+void BridgeChannel::reply (const AudioBuffer<float>& buffer, const MidiBuffer& midi)
+{
+    jassert (header != nullptr);
+    const int numSamples = jlimit (0, layout.maxBlockSize, (int) header->numSamples);
+    for (int c = 0; c < layout.numOutputs; ++c)
+    {
+        if (c < buffer.getNumChannels() && numSamples <= buffer.getNumSamples())
+            memcpy (getChannel (false, c), buffer.getReadPointer (c), sizeof (float) * (size_t) numSamples);
+        else
+            zeromem (getChannel (false, c), sizeof (float) * (size_t) numSamples);
+    }
+
+    MidiBuffer::Iterator iter (midi);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+    while (iter.getNextEvent (data, size, frame))
+        if (size <= 0xffff)
+            midiOut.write (frame, data, (uint16) size);
+
+    replied.signal();
+}
+
+}
@@ -0,0 +1,215 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A named block of memory other processes can map */
+class SharedMemory
+{
+public:
+    SharedMemory() = default;
+    ~SharedMemory();
+
+    /** Creates a zeroed segment. The name is removed again when this closes it */
+    bool create (const String& name, size_t numBytes);
+
+    /** Maps a segment another process created */
+    bool open (const String& name);
+
+    /** Unmaps the segment */
+    void close();
+
+    bool isOpen() const noexcept        { return data != nullptr; }
+    void* getData() const noexcept      { return data; }
+    size_t getSize() const noexcept     { return size; }
+    const String& getName() const noexcept { return name; }
+
+private:
+    String name;
+    void* data = nullptr;
+    size_t size = 0;
+    bool owner = false;
+   #if JUCE_WINDOWS
+    void* handle = nullptr;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (SharedMemory)
+};
+
+/** A counting semaphore that can be signalled from another process */
+class InterProcessSemaphore
+{
+public:
+    InterProcessSemaphore() = default;
+    ~InterProcessSemaphore();
+
+    /** Creates a semaphore with a count of zero. The name is removed again
+        when this closes it */
+    bool create (const String& name);
+
+    /** Opens a semaphore another process created */
+    bool open (const String& name);
+
+    void close();
+    bool isOpen() const noexcept { return handle != nullptr; }
+
+    /** Wakes one waiter, or the next one to wait */
+    void signal() noexcept;
+
+    /** Waits for a signal. A negative timeout waits forever. Returns false if
+        the time ran out first */
+    bool wait (double timeoutMs) noexcept;
+
+private:
+    String name;
+    void* handle = nullptr;
+    bool owner = false;
+
+    JUCE_DECLARE_NON_COPYABLE (InterProcessSemaphore)
+};
+
+/** A single producer, single consumer queue of small timestamped messages,
+    kept in memory that may be shared with another process. Neither side
+    ever blocks or locks */
+class SharedRingBuffer
+{
+public:
+    /** Returns the bytes needed for a buffer. The capacity must be a power of two */
+    static size_t getRequiredSize (uint32 capacity) noexcept;
+
+    /** Formats memory as an empty buffer */
+    static void initialise (void* memory, uint32 capacity) noexcept;
+
+    SharedRingBuffer() = default;
+
+    /** Uses memory formatted by initialise, maybe by another process */
+    void attach (void* memory) noexcept;
+
+    /** Returns the number of bytes waiting to be read */
+    uint32 getNumReady() const noexcept;
+
+    /** Adds a message. Returns false, writing nothing, if it doesn't fit */
+    bool write (int32 timestamp, const void* data, uint16 size) noexcept;
+
+    /** Takes the next message. Messages bigger than the destination are skipped.
+        Returns false if there's nothing left */
+    bool read (int32& timestamp, void* dest, uint16& size, uint16 maxSize) noexcept;
+
+private:
+    struct Header;
+    Header* header = nullptr;
+    uint8* buffer = nullptr;
+
+    void copyIn (uint32 position, const void* data, uint32 size) noexcept;
+    void copyOut (uint32 position, void* data, uint32 size) const noexcept;
+};
+
+/** Carries one plugin's audio and MIDI between the engine and the process
+    hosting it.
+
+    Everything lives in one shared memory segment: a header with the block's
+    length and transport position, lock-free rings for MIDI each way and for
+    parameter changes, and a buffer for each input and output channel. The
+    engine writes a block, wakes the plugin's process and waits for the result
+    until the block's deadline. A block that doesn't make it comes back silent
+    and blocks are skipped until the late one is in; MIDI is queued in the
+    meantime, never dropped.
+ */
+class BridgeChannel
+{
+public:
+    struct Layout
+    {
+        int numInputs       = 2;
+        int numOutputs      = 2;
+        int maxBlockSize    = 2048;
+        uint32 ringSize     = 16384;
+    };
+
+    BridgeChannel();
+    ~BridgeChannel();
+
+    /** Returns the size of a channel's shared memory */
+    static size_t getRequiredSize (const Layout& layout) noexcept;
+
+    /** Returns a name no other channel is using */
+    static String createUniqueName();
+
+    /** Creates the channel, on the engine's side */
+    bool create (const String& name, const Layout& layout);
+
+    /** Opens a channel in the plugin's process */
+    bool open (const String& name);
+
+    void close();
+
+    bool isOpen() const noexcept { return memory.isOpen(); }
+    const String& getName() const noexcept { return memory.getName(); }
+    const Layout& getLayout() const noexcept { return layout; }
+
+    //=========================================================================
+    /** Hands a block to the plugin's process and waits up to the timeout for
+        it to come back. Returns false with the buffer cleared if it didn't.
+        Blocks can't be longer than the layout's maximum */
+    bool process (AudioBuffer<float>& buffer, MidiBuffer& midi,
+                  const AudioPlayHead::CurrentPositionInfo& position, double timeoutMs);
+
+    /** Queues a parameter change for the next block */
+    bool pushParameter (int index, float value) noexcept;
+
+    /** Returns how many blocks were late or skipped */
+    int getNumLateBlocks() const noexcept { return numLateBlocks; }
+
+    //=========================================================================
+    /** Waits for the next block in the plugin's process. The buffer gets the
+        inputs, with room for the outputs. Returns false if nothing came */
+    bool receive (AudioBuffer<float>& buffer, MidiBuffer& midi,
+                  AudioPlayHead::CurrentPositionInfo& position, double timeoutMs);
+
+    /** Takes the next parameter change. Returns false if there's none */
+    bool popParameter (int& index, float& value) noexcept;
+
+    /** Sends a processed block back to the engine */
+    void reply (const AudioBuffer<float>& buffer, const MidiBuffer& midi);
+
+private:
+    struct Header;
+    SharedMemory memory;
+    InterProcessSemaphore requested, replied;
+    Layout layout;
+    Header* header = nullptr;
+    SharedRingBuffer midiIn, midiOut, parameters;
+    float* audio = nullptr;
+    bool waitingForReply = false;
+    int numLateBlocks = 0;
+    HeapBlock<uint8> scratch;
+
+    static size_t getRingOffset (const Layout&, int ring) noexcept;
+    bool attach();
+    float* getChannel (bool input, int channel) const noexcept;
+    void readMidi (SharedRingBuffer& ring, MidiBuffer& midi, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE (BridgeChannel)
+};
+
+}
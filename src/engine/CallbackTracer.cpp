@@ -0,0 +1,107 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/CallbackTracer.h"
+
+namespace Element {
+
+void CallbackTracer::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    lastDeadline = 0;
+    numOverruns.store (0, std::memory_order_relaxed);
+    overrunPending.store (false, std::memory_order_relaxed);
+}
+
+void CallbackTracer::push (Record& record) noexcept
+{
+    const double durationSeconds = (double) jmax (1, record.numSamples) / sampleRate;
+    const float durationMs = (float) (durationSeconds * 1000.0);
+
+    // each callback should start by the time the previous block's audio ran out
+    record.jitterMs = lastDeadline > 0 ? ticksToMs (record.startTicks - lastDeadline) : 0.f;
+    lastDeadline = record.startTicks + Time::secondsToHighResolutionTicks (durationSeconds);
+
+    record.overrun = record.totalMs > durationMs || record.jitterMs > durationMs;
+    if (record.overrun)
+    {
+        numOverruns.fetch_add (1, std::memory_order_relaxed);
+        overrunPending.store (true, std::memory_order_relaxed);
+    }
+
+    // odd sequence numbers mark a slot being written
+    const uint32 count = writeCount.load (std::memory_order_relaxed);
+    auto& slot = slots [count % capacity];
+    const uint32 sequence = slot.sequence.load (std::memory_order_relaxed);
+    slot.sequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    slot.record = record;
+    slot.sequence.store (sequence + 2, std::memory_order_release);
+    writeCount.store (count + 1, std::memory_order_release);
+}
+
+void CallbackTracer::getHistory (Array<Record>& records) const
+{
+    records.clearQuick();
+    const uint32 count = writeCount.load (std::memory_order_acquire);
+    const uint32 numRecords = jmin (count, (uint32) capacity);
+    records.ensureStorageAllocated ((int) numRecords);
+
+    for (uint32 i = count - numRecords; i != count; ++i)
+    {
+        const auto& slot = slots [i % capacity];
+        const uint32 before = slot.sequence.load (std::memory_order_acquire);
+        if ((before & 1) != 0)
+            continue;
+
+        const Record record = slot.record;
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (slot.sequence.load (std::memory_order_relaxed) == before)
+            records.add (record);
+    }
+}
+
+bool CallbackTracer::writeToFile (const File& file) const
+{
+    Array<Record> records;
+    getHistory (records);
+
+    FileOutputStream stream (file);
+    if (! stream.openedOk())
+        return false;
+    stream.setPosition (0);
+    stream.truncate();
+
+    const int64 firstTicks = records.isEmpty() ? 0 : records.getReference(0).startTicks;
+    stream << "time_ms,jitter_ms,total_ms,graph_ms,midi_out_ms,samples,graph,midi_in,midi_out,overrun\n";
+    for (const auto& r : records)
+    {
+        stream << String (ticksToMs (r.startTicks - firstTicks), 3) << ","
+               << String (r.jitterMs, 3) << "," << String (r.totalMs, 3) << ","
+               << String (r.graphMs, 3) << "," << String (r.midiOutMs, 3) << ","
+               << r.numSamples << "," << r.graphIndex << ","
+               << r.numMidiIn << "," << r.numMidiOut << ","
+               << (r.overrun ? 1 : 0) << "\n";
+    }
+
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Keeps a history of audio callback timings so dropouts can be examined
+    after the fact.
+
+    The audio thread fills in a Record per callback and pushes it into a
+    fixed ring, nothing is allocated or locked doing so. When a callback
+    overruns its deadline the tracer flags it, and the message thread can
+    then write the recent history out to a file.
+ */
+class CallbackTracer
+{
+public:
+    /** Timings of one callback. Times are in milliseconds */
+    struct Record
+    {
+        int64 startTicks    = 0;    ///< high resolution ticks when the callback started
+        float jitterMs      = 0.f;  ///< how late the callback started compared to the previous one's deadline
+        float totalMs       = 0.f;  ///< time spent in the whole callback
+        float graphMs       = 0.f;  ///< time spent rendering graphs
+        float midiOutMs     = 0.f;  ///< time spent sending MIDI to the output device
+        int numSamples      = 0;
+        int graphIndex      = -1;   ///< the active graph
+        int numMidiIn       = 0;    ///< MIDI events going into the graphs
+        int numMidiOut      = 0;    ///< MIDI events sent to the output device
+        bool overrun        = false;
+    };
+
+    enum { capacity = 2048 };
+
+    CallbackTracer() = default;
+    ~CallbackTracer() = default;
+
+    /** Call before the device starts */
+    void prepare (double sampleRate);
+
+    /** Converts a tick interval to milliseconds */
+    static float ticksToMs (int64 ticks) noexcept
+    {
+        return (float) (Time::highResolutionTicksToSeconds (ticks) * 1000.0);
+    }
+
+    /** Fills in jitter and overrun state and adds the record to the ring.
+        Called from the audio thread at the end of each callback */
+    void push (Record& record) noexcept;
+
+    /** Returns the number of overruns since preparing */
+    int getNumOverruns() const noexcept { return numOverruns.load (std::memory_order_relaxed); }
+
+    /** Returns true once if an overrun happened since the last call */
+    bool checkOverrun() noexcept { return overrunPending.exchange (false, std::memory_order_relaxed); }
+
+    /** Copies the recorded history, oldest first. Records the audio thread
+        was overwriting while copying are left out */
+    void getHistory (Array<Record>& records) const;
+
+    /** Writes the recorded history to a CSV file */
+    bool writeToFile (const File& file) const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32> sequence { 0 };
+        Record record;
+    };
+
+    Slot slots [capacity];
+    std::atomic<uint32> writeCount { 0 };
+    std::atomic<int> numOverruns { 0 };
+    std::atomic<bool> overrunPending { false };
+    double sampleRate = 44100.0;
+    int64 lastDeadline = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (CallbackTracer)
+};
+
+}
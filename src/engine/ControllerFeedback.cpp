@@ -0,0 +1,203 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/ControllerFeedback.h"
+#include "engine/MidiEngine.h"
+
+namespace Element {
+
+MidiMessage ControllerFeedback::Slot::createMessage (int value) const
+{
+    if (isNote)
+        return value > 0 ? MidiMessage::noteOn (channel, number, (uint8) value)
+                         : MidiMessage::noteOff (channel, number);
+    return MidiMessage::controllerEvent (channel, number, value);
+}
+
+//=============================================================================
+
+ControllerFeedback::ControllerFeedback (MidiEngine& e)
+    : Thread ("Element Controller Feedback"), engine (e) { }
+
+ControllerFeedback::~ControllerFeedback()
+{
+    stop();
+    clear();
+}
+
+void ControllerFeedback::start()
+{
+    if (! isThreadRunning())
+        startThread (4);
+}
+
+void ControllerFeedback::stop()
+{
+    stopThread (500);
+}
+
+void ControllerFeedback::setFlushRate (int timesPerSecond)
+{
+    flushRate.store (jlimit (1, 1000, timesPerSecond));
+    notify();
+}
+
+ControllerFeedback::Device* ControllerFeedback::findDevice (const String& deviceId) const
+{
+    for (auto* device : devices)
+        if (device->deviceId == deviceId)
+            return device;
+    return nullptr;
+}
+
+void ControllerFeedback::addDevice (const String& deviceId, const String& outputName,
+                                    int maxMessagesPerSecond)
+{
+    const ScopedLock sl (lock);
+    auto* device = findDevice (deviceId);
+    if (device == nullptr)
+    {
+        device = devices.add (new Device());
+        device->deviceId = deviceId;
+    }
+
+    device->maxMessagesPerSecond = jmax (1, maxMessagesPerSecond);
+    if (device->outputName == outputName)
+        return;
+
+    device->outputName = outputName;
+    device->output.reset();
+    // the default output is already open, feedback for it goes through the engine
+    if (outputName.isNotEmpty() && outputName != engine.getDefaultMidiOutputName())
+        device->output = MidiOutput::openDevice (MidiOutput::getDevices().indexOf (outputName));
+
+    for (auto* slot : device->slots)
+        slot->sent.store (-1); // a new output hasn't seen anything yet
+}
+
+void ControllerFeedback::removeDevice (const String& deviceId)
+{
+    const ScopedLock sl (lock);
+    if (auto* device = findDevice (deviceId))
+        devices.removeObject (device);
+}
+
+ControllerFeedback::Slot* ControllerFeedback::addSlot (const String& deviceId, bool isNote,
+                                                       int channel, int number)
+{
+    const ScopedLock sl (lock);
+    auto* device = findDevice (deviceId);
+    if (device == nullptr || device->outputName.isEmpty()
+        || ! isPositiveAndBelow (number, 128))
+        return nullptr;
+    return device->slots.add (new Slot (isNote, jlimit (1, 16, channel), number));
+}
+
+void ControllerFeedback::clear()
+{
+    const ScopedLock sl (lock);
+    devices.clear();
+}
+
+void ControllerFeedback::collectChanges (const String& deviceId, double elapsedSeconds,
+                                         MidiBuffer& messages)
+{
+    const ScopedLock sl (lock);
+    if (auto* device = findDevice (deviceId))
+        collect (*device, elapsedSeconds, messages);
+}
+
+void ControllerFeedback::collect (Device& device, double elapsedSeconds, MidiBuffer& messages)
+{
+    const int numSlots = device.slots.size();
+    if (numSlots <= 0)
+        return;
+
+    // a quiet spell can't bank more than a tenth of a second of sends
+    const double maxCredit = jmax (1.0, device.maxMessagesPerSecond * 0.1);
+    device.credit = jmin (maxCredit, device.credit + elapsedSeconds * device.maxMessagesPerSecond);
+
+    // start where the last flush ran out of budget so every slot gets a turn
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto* const slot = device.slots.getUnchecked ((device.cursor + i) % numSlots);
+        const int value = slot->latest.load (std::memory_order_relaxed);
+        if (value < 0 || value == slot->sent.load (std::memory_order_relaxed))
+            continue;
+
+        if (device.credit < 1.0)
+        {
+            device.cursor = (device.cursor + i) % numSlots;
+            numDeferred.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        messages.addEvent (slot->createMessage (value), messages.getNumEvents());
+        slot->sent.store (value, std::memory_order_relaxed);
+        device.credit -= 1.0;
+    }
+}
+
+void ControllerFeedback::flush (Device& device, double elapsedSeconds)
+{
+    pending.clear();
+    collect (device, elapsedSeconds, pending);
+    if (pending.isEmpty())
+        return;
+
+    MidiOutput* output = device.output.get();
+    std::unique_ptr<ScopedLock> engineLock;
+    if (output == nullptr)
+    {
+        engineLock.reset (new ScopedLock (engine.getMidiOutputLock()));
+        if (engine.getDefaultMidiOutputName() == device.outputName)
+            output = engine.getDefaultMidiOutput();
+    }
+
+    if (output == nullptr)
+        return;
+
+    MidiBuffer::Iterator iter (pending);
+    MidiMessage message;
+    int frame = 0;
+    while (iter.getNextEvent (message, frame))
+        output->sendMessageNow (message);
+}
+
+void ControllerFeedback::run()
+{
+    double lastFlush = Time::getMillisecondCounterHiRes();
+
+    while (! threadShouldExit())
+    {
+        wait (jmax (1, 1000 / flushRate.load()));
+        if (threadShouldExit())
+            break;
+
+        const double now = Time::getMillisecondCounterHiRes();
+        const double elapsed = (now - lastFlush) * 0.001;
+        lastFlush = now;
+
+        const ScopedLock sl (lock);
+        for (auto* device : devices)
+            flush (*device, elapsed);
+    }
+}
+
+}
@@ -0,0 +1,121 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class MidiEngine;
+
+/** Echoes mapped parameter values back to controllers, for motorised
+    faders and LED rings.
+
+    Each mapped control gets a slot holding its latest value, which can be
+    written from any thread, the audio thread included. A flush thread wakes
+    at a fixed rate and sends only the slots that changed since they were
+    last sent, never more per second than the device's budget allows, so a
+    slow USB link can't be flooded. Slots over budget keep their latest value
+    and go out on a later flush.
+ */
+class ControllerFeedback : private Thread
+{
+public:
+    /** One control's latest value and what was last sent for it */
+    class Slot
+    {
+    public:
+        /** Sets the value to send, 0 to 127. Lock free, any thread */
+        void post (int value) noexcept      { latest.store (jlimit (0, 127, value), std::memory_order_relaxed); }
+
+        /** Notes the controller already shows a value, so it isn't echoed
+            back when the parameter follows it */
+        void markSent (int value) noexcept  { sent.store (jlimit (0, 127, value), std::memory_order_relaxed); }
+
+    private:
+        friend class ControllerFeedback;
+        Slot (bool n, int c, int num) : isNote (n), channel (c), number (num) { }
+        const bool isNote;
+        const int channel, number;
+        std::atomic<int> latest { -1 }, sent { -1 };
+        MidiMessage createMessage (int value) const;
+    };
+
+    explicit ControllerFeedback (MidiEngine& engine);
+    ~ControllerFeedback();
+
+    /** Adds or updates a device by its ID. Feedback for it goes to the named
+        output, at most maxMessagesPerSecond of them */
+    void addDevice (const String& deviceId, const String& outputName, int maxMessagesPerSecond);
+
+    /** Removes a device and all its slots. Handlers using them must be gone */
+    void removeDevice (const String& deviceId);
+
+    /** Returns a slot sending a controller or note, on channel 1 to 16,
+        to a device's output. Returns nullptr if the device has no output set.
+        The slot belongs to this object and lives until its device is removed */
+    Slot* addSlot (const String& deviceId, bool isNote, int channel, int number);
+
+    /** Removes every device and slot */
+    void clear();
+
+    /** Sets how many times per second changed values are flushed */
+    void setFlushRate (int timesPerSecond);
+    int getFlushRate() const noexcept { return flushRate.load(); }
+
+    /** Takes the changes a device's next flush would send, as though
+        elapsedSeconds had passed since the last one. The flush thread does
+        this itself, it's public for testing */
+    void collectChanges (const String& deviceId, double elapsedSeconds, MidiBuffer& messages);
+
+    /** Returns the number of sends held back by a device budget */
+    int getNumDeferred() const noexcept { return numDeferred.load (std::memory_order_relaxed); }
+
+    /** Starts and stops the flush thread */
+    void start();
+    void stop();
+
+private:
+    struct Device
+    {
+        String deviceId, outputName;
+        int maxMessagesPerSecond = 0;
+        double credit = 0.0;
+        int cursor = 0;
+        std::unique_ptr<MidiOutput> output;
+        OwnedArray<Slot> slots;
+    };
+
+    MidiEngine& engine;
+    CriticalSection lock;
+    OwnedArray<Device> devices;
+    std::atomic<int> flushRate { 30 };
+    std::atomic<int> numDeferred { 0 };
+    MidiBuffer pending;
+
+    Device* findDevice (const String& deviceId) const;
+    void collect (Device& device, double elapsedSeconds, MidiBuffer& messages);
+    void flush (Device& device, double elapsedSeconds);
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (ControllerFeedback)
+};
+
+}
@@ -0,0 +1,282 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "engine/Convolver.h"
+#include "engine/RealtimeThreads.h"
+
+namespace Element {
+
+/** Adds the product of two spectra of interleaved complex bins */
+static void multiplyAdd (float* result, const float* a, const float* b, int numBins) noexcept
+{
+    for (int i = 0; i < numBins * 2; i += 2)
+    {
+        result[i]     += a[i] * b[i]     - a[i + 1] * b[i + 1];
+        result[i + 1] += a[i] * b[i + 1] + a[i + 1] * b[i];
+    }
+}
+
+//=============================================================================
+void UniformConvolver::prepare (int newBlockSize, const float* impulse, int impulseLength)
+{
+    blockSize = nextPowerOfTwo (jmax (1, newBlockSize));
+    fftSize = blockSize * 2;
+    numBins = blockSize + 1;
+    numPartitions = impulse != nullptr ? (jmax (0, impulseLength) + blockSize - 1) / blockSize : 0;
+    fft.reset (new dsp::FFT (roundToInt (std::log2 ((double) fftSize))));
+
+    const auto spectrumSize = (size_t) numBins * 2;
+    impulseSpectra.calloc (jmax ((size_t) 1, (size_t) numPartitions * spectrumSize));
+    inputSpectra.calloc (jmax ((size_t) 1, (size_t) numPartitions * spectrumSize));
+    history.calloc (spectrumSize);
+    work.calloc ((size_t) fftSize * 2);
+    overlap.calloc ((size_t) blockSize);
+    input.calloc ((size_t) blockSize);
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        const int offset = p * blockSize;
+        FloatVectorOperations::clear (work, fftSize * 2);
+        FloatVectorOperations::copy (work, impulse + offset, jmin (blockSize, impulseLength - offset));
+        fft->performRealOnlyForwardTransform (work, true);
+        FloatVectorOperations::copy (impulseSpectrum (p), work, (int) spectrumSize);
+    }
+
+    reset();
+}
+
+void UniformConvolver::reset() noexcept
+{
+    if (numPartitions > 0)
+        FloatVectorOperations::clear (inputSpectra, numPartitions * numBins * 2);
+    if (overlap != nullptr)
+    {
+        FloatVectorOperations::clear (overlap, blockSize);
+        FloatVectorOperations::clear (input, blockSize);
+    }
+    current = filled = 0;
+}
+
+void UniformConvolver::process (const float* in, float* out, int numSamples) noexcept
+{
+    if (numPartitions <= 0)
+    {
+        FloatVectorOperations::clear (out, numSamples);
+        return;
+    }
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int position = filled;
+        const int numThisTime = jmin (numSamples - done, blockSize - filled);
+        FloatVectorOperations::copy (input + filled, in + done, numThisTime);
+
+        FloatVectorOperations::copy (work, input, blockSize);
+        FloatVectorOperations::clear (work + blockSize, fftSize * 2 - blockSize);
+        fft->performRealOnlyForwardTransform (work, true);
+        FloatVectorOperations::copy (inputSpectrum (current), work, numBins * 2);
+
+        // the older blocks don't change until this one is full
+        if (position == 0)
+        {
+            FloatVectorOperations::clear (history, numBins * 2);
+            for (int p = 1; p < numPartitions; ++p)
+                multiplyAdd (history, impulseSpectrum (p), inputSpectrum ((current + p) % numPartitions), numBins);
+        }
+
+        FloatVectorOperations::copy (work, history, numBins * 2);
+        multiplyAdd (work, impulseSpectrum (0), inputSpectrum (current), numBins);
+        fft->performRealOnlyInverseTransform (work);
+
+        FloatVectorOperations::add (out + done, work + position, overlap + position, numThisTime);
+
+        filled += numThisTime;
+        done += numThisTime;
+
+        if (filled == blockSize)
+        {
+            FloatVectorOperations::copy (overlap, work + blockSize, blockSize);
+            FloatVectorOperations::clear (input, blockSize);
+            current = current > 0 ? current - 1 : numPartitions - 1;
+            filled = 0;
+        }
+    }
+}
+
+//=============================================================================
+class Convolver::TailThread : public Thread
+{
+public:
+    TailThread (Convolver& c)
+        : Thread ("el.convolutionTail"), owner (c) { }
+
+    ~TailThread()
+    {
+        signalThreadShouldExit();
+        start.signal();
+        waitForThreadToExit (-1);
+    }
+
+    void run() override
+    {
+        RealtimeThreads::applyBackgroundAffinity();
+        for (;;)
+        {
+            start.wait (-1);
+            if (threadShouldExit())
+                break;
+            owner.renderTail();
+            done.signal();
+        }
+    }
+
+    WaitableEvent start, done;
+
+private:
+    Convolver& owner;
+};
+
+//=============================================================================
+Convolver::Convolver() { }
+
+Convolver::~Convolver()
+{
+    thread.reset();
+}
+
+void Convolver::prepare (const AudioBuffer<float>& impulse, int newNumChannels, int headBlockSize)
+{
+    thread.reset();
+    channels.clear();
+
+    numChannels = jlimit (1, (int) maxChannels, newNumChannels);
+    impulseLength = impulse.getNumChannels() > 0 ? impulse.getNumSamples() : 0;
+    headSize = nextPowerOfTwo (jlimit (16, 1024, headBlockSize));
+    tailSize = headSize * 8;
+
+    // the tail starts two of its blocks in, so it has one to render each in
+    const int headLength = jmin (impulseLength, tailSize * 2);
+    const int tailLength = impulseLength - headLength;
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* channel = channels.add (new Channel());
+        const float* data = impulseLength > 0
+            ? impulse.getReadPointer (jmin (c, impulse.getNumChannels() - 1)) : nullptr;
+        channel->head.prepare (headSize, data, headLength);
+
+        if (tailLength > 0)
+        {
+            channel->tail.prepare (tailSize, data + headLength, tailLength);
+            channel->tailInput.calloc ((size_t) tailSize);
+            channel->tailJob.calloc ((size_t) tailSize);
+            channel->tailOutput.calloc ((size_t) tailSize);
+            channel->tailPlay.calloc ((size_t) tailSize);
+        }
+    }
+
+    tailPos = 0;
+    tailPending = false;
+    numTailWaits.store (0);
+
+    if (tailLength > 0)
+    {
+        thread.reset (new TailThread (*this));
+        thread->startThread (8);
+    }
+}
+
+void Convolver::reset()
+{
+    if (thread != nullptr && tailPending)
+        thread->done.wait (-1);
+    tailPending = false;
+    tailPos = 0;
+
+    for (auto* channel : channels)
+    {
+        channel->head.reset();
+        channel->tail.reset();
+        if (thread != nullptr)
+        {
+            FloatVectorOperations::clear (channel->tailInput, tailSize);
+            FloatVectorOperations::clear (channel->tailOutput, tailSize);
+            FloatVectorOperations::clear (channel->tailPlay, tailSize);
+        }
+    }
+}
+
+void Convolver::renderTail() noexcept
+{
+    ScopedNoDenormals noDenormals;
+    for (auto* channel : channels)
+        channel->tail.process (channel->tailJob, channel->tailOutput, tailSize);
+}
+
+void Convolver::swapTail() noexcept
+{
+    if (tailPending && ! thread->done.wait (0))
+    {
+        ++numTailWaits;
+        thread->done.wait (-1);
+    }
+
+    for (auto* channel : channels)
+    {
+        channel->tailOutput.swapWith (channel->tailPlay);
+        channel->tailInput.swapWith (channel->tailJob);
+    }
+
+    tailPending = true;
+    thread->start.signal();
+}
+
+void Convolver::process (float* const* data, int numDataChannels, int numSamples) noexcept
+{
+    ScopedNoDenormals noDenormals;
+    const int numToProcess = jmin (numChannels, numDataChannels);
+    const bool tail = thread != nullptr;
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numThisTime = tail ? jmin (numSamples - done, tailSize - tailPos) : numSamples - done;
+
+        for (int c = 0; c < numToProcess; ++c)
+        {
+            auto* channel = channels.getUnchecked (c);
+            auto* samples = data[c] + done;
+
+            if (tail)
+                FloatVectorOperations::copy (channel->tailInput + tailPos, samples, numThisTime);
+            channel->head.process (samples, samples, numThisTime);
+            if (tail)
+                FloatVectorOperations::add (samples, channel->tailPlay + tailPos, numThisTime);
+        }
+
+        done += numThisTime;
+        if (tail && (tailPos += numThisTime) == tailSize)
+        {
+            tailPos = 0;
+            swapTail();
+        }
+    }
+}
+
+}
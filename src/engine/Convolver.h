@@ -0,0 +1,127 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Uniformly partitioned convolution with no latency.
+
+    The impulse response is cut into partitions of the block size, each held
+    as a spectrum, and past input blocks are kept the same way. The older
+    partitions are summed once per block; the current, partly filled block is
+    transformed again on every call and only its own partition is applied, so
+    output is available for each sample as soon as it's in.
+ */
+class UniformConvolver
+{
+public:
+    UniformConvolver() = default;
+
+    /** Divides an impulse response into partitions. The block size is
+        rounded up to a power of two. Allocates */
+    void prepare (int blockSize, const float* impulse, int impulseLength);
+
+    /** Clears the input history */
+    void reset() noexcept;
+
+    /** Convolves any number of samples. The input and output can be the
+        same buffer */
+    void process (const float* input, float* output, int numSamples) noexcept;
+
+    int getBlockSize() const noexcept   { return blockSize; }
+    int getNumPartitions() const noexcept { return numPartitions; }
+
+private:
+    std::unique_ptr<dsp::FFT> fft;
+    int blockSize = 0, fftSize = 0, numBins = 0;
+    int numPartitions = 0, current = 0, filled = 0;
+    HeapBlock<float> impulseSpectra, inputSpectra;
+    HeapBlock<float> history, work, overlap, input;
+
+    float* impulseSpectrum (int partition) const noexcept { return impulseSpectra + (size_t) partition * (size_t) numBins * 2; }
+    float* inputSpectrum (int partition) const noexcept   { return inputSpectra + (size_t) partition * (size_t) numBins * 2; }
+
+    JUCE_DECLARE_NON_COPYABLE (UniformConvolver)
+};
+
+/** Convolution with long impulse responses, split over two threads.
+
+    The head of the response runs on the rendering thread in small blocks
+    with no latency. The tail is partitioned in larger blocks and rendered
+    on a thread of its own: each full block of input is handed over as it
+    completes and its result is needed a block later, which the tail starts
+    late enough to allow for. The rendering thread only waits if the tail
+    thread falls behind that.
+ */
+class Convolver
+{
+public:
+    enum { maxChannels = 2 };
+
+    Convolver();
+    ~Convolver();
+
+    /** Loads an impulse response, with one channel for every channel or a
+        single one for all of them. The head block is rounded up to a power
+        of two, and the tail block to the next one at least eight times as
+        large. Allocates and starts the tail thread when there's a tail */
+    void prepare (const AudioBuffer<float>& impulse, int numChannels, int headBlockSize);
+
+    /** Clears the input history. Not while rendering */
+    void reset();
+
+    /** Convolves the channels in place */
+    void process (float* const* channels, int numChannels, int numSamples) noexcept;
+
+    int getNumChannels() const noexcept     { return numChannels; }
+    int getImpulseLength() const noexcept   { return impulseLength; }
+    int getHeadBlockSize() const noexcept   { return headSize; }
+    int getTailBlockSize() const noexcept   { return tailSize; }
+    bool hasTail() const noexcept           { return thread != nullptr; }
+
+    /** Returns how many times rendering had to wait for the tail thread */
+    int getNumTailWaits() const noexcept    { return numTailWaits.load(); }
+
+private:
+    struct Channel
+    {
+        UniformConvolver head, tail;
+        HeapBlock<float> tailInput, tailJob, tailOutput, tailPlay;
+    };
+
+    class TailThread;
+    friend class TailThread;
+    OwnedArray<Channel> channels;
+    std::unique_ptr<TailThread> thread;
+    int numChannels = 0, impulseLength = 0;
+    int headSize = 0, tailSize = 0, tailPos = 0;
+    bool tailPending = false;
+    std::atomic<int> numTailWaits { 0 };
+
+    void renderTail() noexcept;
+    void swapTail() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (Convolver)
+};
+
+}
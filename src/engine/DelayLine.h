@@ -0,0 +1,225 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A fixed delay applied to whole blocks in place.
+
+    The ring holds the delay plus one block, so each block is written in
+    and read back out with at most two copies in either direction instead
+    of stepping through the ring sample by sample.
+ */
+template<typename SampleType>
+class DelayLine
+{
+public:
+    DelayLine (const int delaySamples, const int maxBlockSize)
+        : delay (jmax (0, delaySamples)),
+          blockSize (jmax (1, maxBlockSize)),
+          size (delay + blockSize)
+    {
+        ring.calloc ((size_t) size);
+    }
+
+    ~DelayLine() = default;
+
+    /** Returns the delay in samples */
+    int getDelay() const noexcept { return delay; }
+
+    /** Delays a block of samples in place. Blocks longer than the size
+        this line was created for are handled in several passes */
+    void process (SampleType* data, int numSamples) noexcept
+    {
+        if (delay <= 0)
+            return;
+
+        while (numSamples > 0)
+        {
+            const int n = jmin (numSamples, blockSize);
+            write (data, n);
+            read (data, n);
+            data += n;
+            numSamples -= n;
+        }
+    }
+
+    /** Zeros the line */
+    void clear() noexcept
+    {
+        zeromem (ring.getData(), sizeof (SampleType) * (size_t) size);
+        writeIndex = 0;
+    }
+
+private:
+    HeapBlock<SampleType> ring;
+    const int delay, blockSize, size;
+    int writeIndex = 0;
+
+    void write (const SampleType* data, const int numSamples) noexcept
+    {
+        const int first = jmin (numSamples, size - writeIndex);
+        memcpy (ring + writeIndex, data, sizeof (SampleType) * (size_t) first);
+        if (first < numSamples)
+            memcpy (ring.getData(), data + first, sizeof (SampleType) * (size_t) (numSamples - first));
+
+        writeIndex += numSamples;
+        if (writeIndex >= size)
+            writeIndex -= size;
+    }
+
+    void read (SampleType* data, const int numSamples) const noexcept
+    {
+        // the block just written ends at writeIndex, read it back delay samples earlier
+        int readIndex = writeIndex - numSamples - delay;
+        if (readIndex < 0)
+            readIndex += size;
+
+        const int first = jmin (numSamples, size - readIndex);
+        memcpy (data, ring + readIndex, sizeof (SampleType) * (size_t) first);
+        if (first < numSamples)
+            memcpy (data + first, ring.getData(), sizeof (SampleType) * (size_t) (numSamples - first));
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (DelayLine)
+};
+
+/** A multichannel ring for feedback networks such as combs and all-passes.
+
+    Channels are interleaved so a step through every channel touches
+    adjacent memory, and the ring is allocated up front for the longest
+    delay it will be given. Delay changes glide over a short ramp with
+    interpolated reads instead of jumping, so the length can be moved or
+    modulated on the audio thread without clicks or allocating.
+ */
+class FeedbackDelay
+{
+public:
+    enum { maxChannels = 8 };
+
+    FeedbackDelay() = default;
+    ~FeedbackDelay() = default;
+
+    /** Allocates and clears the ring. Not realtime safe */
+    void prepare (const int maxDelaySamples, const int numChannelsToUse, const int rampSamples)
+    {
+        numChannels = jlimit (1, (int) maxChannels, numChannelsToUse);
+        maxDelay    = jmax (1, maxDelaySamples);
+        size        = nextPowerOfTwo (maxDelay + 2);
+        mask        = size - 1;
+        ring.calloc ((size_t) (size * numChannels));
+        writeIndex  = 0;
+
+        delay.reset (jmax (1, rampSamples));
+        delay.setCurrentAndTargetValue ((float) jlimit (1, maxDelay, roundToInt (delay.getTargetValue())));
+    }
+
+    /** Frees the ring */
+    void free()
+    {
+        ring.free();
+        size = mask = writeIndex = 0;
+    }
+
+    /** Zeros the ring */
+    void clear() noexcept
+    {
+        if (ring != nullptr)
+            zeromem (ring.getData(), sizeof (float) * (size_t) (size * numChannels));
+        writeIndex = 0;
+    }
+
+    /** Returns true if the ring has been allocated */
+    bool isPrepared() const noexcept        { return size > 0; }
+
+    /** Returns the number of interleaved channels */
+    int getNumChannels() const noexcept     { return numChannels; }
+
+    /** Returns the longest delay this was prepared for */
+    int getMaxDelay() const noexcept        { return maxDelay; }
+
+    /** Sets the delay, rounded to whole samples and clamped to the prepared
+        maximum. It glides there from the current delay unless glide is false */
+    void setDelay (const float samples, const bool glide = true) noexcept
+    {
+        const auto newDelay = (float) jlimit (1, maxDelay, roundToInt (samples));
+        if (glide)
+            delay.setTargetValue (newDelay);
+        else
+            delay.setCurrentAndTargetValue (newDelay);
+    }
+
+    /** Returns the delay being glided to */
+    float getDelay() const noexcept         { return delay.getTargetValue(); }
+
+    /** Sets extra delay for one channel, e.g. to spread a stereo pair */
+    void setChannelOffset (const int channel, const int samples) noexcept
+    {
+        if (isPositiveAndBelow (channel, (int) maxChannels))
+            offsets[channel] = jmax (0, samples);
+    }
+
+    /** Reads a frame of every channel delayed from the write position */
+    inline void read (float* frame) noexcept
+    {
+        const auto* const line = ring.getData();
+        const int limit = size - 2;
+
+        if (delay.isSmoothing())
+        {
+            const float d = delay.getNextValue();
+            for (int c = 0; c < numChannels; ++c)
+            {
+                const float pos = jmin ((float) limit, d + (float) offsets[c]);
+                const int whole = (int) pos;
+                const float frac = pos - (float) whole;
+                const float a = line[((writeIndex - whole) & mask) * numChannels + c];
+                const float b = line[((writeIndex - whole - 1) & mask) * numChannels + c];
+                frame[c] = a + frac * (b - a);
+            }
+            return;
+        }
+
+        const int d = (int) delay.getTargetValue();
+        for (int c = 0; c < numChannels; ++c)
+            frame[c] = line[((writeIndex - jmin (limit, d + offsets[c])) & mask) * numChannels + c];
+    }
+
+    /** Writes a frame of every channel and steps forward */
+    inline void write (const float* frame) noexcept
+    {
+        auto* const dest = ring.getData() + writeIndex * numChannels;
+        for (int c = 0; c < numChannels; ++c)
+            dest[c] = frame[c];
+        writeIndex = (writeIndex + 1) & mask;
+    }
+
+private:
+    HeapBlock<float> ring;
+    int numChannels = 1, maxDelay = 1, size = 0, mask = 0, writeIndex = 0;
+    int offsets [maxChannels] = {};
+    SmoothedValue<float, ValueSmoothingTypes::Linear> delay { 1.f };
+
+    JUCE_DECLARE_NON_COPYABLE (FeedbackDelay)
+};
+
+}
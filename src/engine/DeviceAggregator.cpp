@@ -0,0 +1,426 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/DeviceAggregator.h"
+
+namespace Element {
+
+//=============================================================================
+/** A device opened alongside the master, running its own callback */
+class DeviceAggregator::Slave : public AudioIODeviceCallback
+{
+public:
+    Slave (AudioIODeviceType& t, const String& n)
+        : type (t), name (n) { }
+
+    ~Slave()
+    {
+        close();
+    }
+
+    /** Opens the device with all its channels as close to the master's rate
+        as it goes, and prepares the resamplers for it */
+    bool open (double masterRate, int masterBlockSize)
+    {
+        close();
+        const auto outputNames = type.getDeviceNames (false);
+        const auto inputNames  = type.getDeviceNames (true);
+        device.reset (type.createDevice (outputNames.contains (name) ? name : String(),
+                                         inputNames.contains (name) ? name : String()));
+        if (device == nullptr)
+        {
+            Logger::writeToLog ("[EL] couldn't create aggregated device " + name);
+            return false;
+        }
+
+        double rate = 0.0;
+        for (const auto available : device->getAvailableSampleRates())
+            if (rate == 0.0 || std::abs (available - masterRate) < std::abs (rate - masterRate))
+                rate = available;
+        if (rate == 0.0)
+            rate = masterRate;
+
+        BigInteger ins, outs;
+        ins.setRange (0, device->getInputChannelNames().size(), true);
+        outs.setRange (0, device->getOutputChannelNames().size(), true);
+        const auto error = device->open (ins, outs, rate, device->getDefaultBufferSize());
+        if (error.isNotEmpty())
+        {
+            Logger::writeToLog ("[EL] couldn't open aggregated device " + name + ": " + error);
+            device = nullptr;
+            return false;
+        }
+
+        sampleRate = device->getCurrentSampleRate();
+        const int slaveBlockSize = device->getCurrentBufferSizeSamples();
+        numInputs  = device->getActiveInputChannels().countNumberOfSetBits();
+        numOutputs = device->getActiveOutputChannels().countNumberOfSetBits();
+
+        if (numInputs > 0)
+            input.prepare (numInputs, sampleRate, masterRate, slaveBlockSize, masterBlockSize);
+        else
+            input.release();
+        if (numOutputs > 0)
+            output.prepare (numOutputs, masterRate, sampleRate, masterBlockSize, slaveBlockSize);
+        else
+            output.release();
+
+        masterSampleRate = masterRate;
+        return true;
+    }
+
+    void close()
+    {
+        if (device == nullptr)
+            return;
+        device->stop();
+        device->close();
+        device = nullptr;
+        numInputs = numOutputs = 0;
+    }
+
+    void start()
+    {
+        if (device != nullptr)
+            device->start (this);
+    }
+
+    void stop()
+    {
+        if (device != nullptr)
+            device->stop();
+    }
+
+    bool isOpen() const noexcept { return device != nullptr; }
+
+    /** Returns the delay each way, in master frames */
+    int getInputLatency() const noexcept
+    {
+        return input.getLatencySamples();
+    }
+
+    int getOutputLatency() const noexcept
+    {
+        return sampleRate > 0.0 ? roundToInt (output.getLatencySamples() * masterSampleRate / sampleRate) : 0;
+    }
+
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels,
+                                int numSamples) override
+    {
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+        input.push (inputChannelData, numInputChannels, numSamples, now);
+        output.pull (outputChannelData, numOutputChannels, numSamples, now);
+    }
+
+    void audioDeviceAboutToStart (AudioIODevice*) override { }
+    void audioDeviceStopped() override { }
+
+    AudioIODeviceType& type;
+    const String name;
+    std::unique_ptr<AudioIODevice> device;
+    double sampleRate = 0.0;
+    double masterSampleRate = 0.0;
+    int numInputs = 0;
+    int numOutputs = 0;
+
+    // slave to master, and master to slave
+    DriftResampler input, output;
+
+    JUCE_DECLARE_NON_COPYABLE (Slave)
+};
+
+//=============================================================================
+/** What the callback is started with: the master with every channel */
+class DeviceAggregator::Proxy : public AudioIODevice
+{
+public:
+    Proxy (AudioIODevice& m, const OwnedArray<Slave>& slaves)
+        : AudioIODevice (m.getName(), m.getTypeName()),
+          master (m)
+    {
+        const auto masterIns  = master.getInputChannelNames();
+        const auto masterOuts = master.getOutputChannelNames();
+        const auto activeIns  = master.getActiveInputChannels();
+        const auto activeOuts = master.getActiveOutputChannels();
+        for (int i = 0; i < masterIns.size(); ++i)
+            if (activeIns [i])
+                inputNames.add (masterIns [i]);
+        for (int i = 0; i < masterOuts.size(); ++i)
+            if (activeOuts [i])
+                outputNames.add (masterOuts [i]);
+
+        for (auto* slave : slaves)
+        {
+            if (! slave->isOpen())
+                continue;
+            for (int i = 0; i < slave->numInputs; ++i)
+                inputNames.add (slave->name + " " + String (i + 1));
+            for (int i = 0; i < slave->numOutputs; ++i)
+                outputNames.add (slave->name + " " + String (i + 1));
+        }
+    }
+
+    StringArray getOutputChannelNames() override        { return outputNames; }
+    StringArray getInputChannelNames() override         { return inputNames; }
+    Array<double> getAvailableSampleRates() override    { return master.getAvailableSampleRates(); }
+    Array<int> getAvailableBufferSizes() override       { return master.getAvailableBufferSizes(); }
+    int getDefaultBufferSize() override                 { return master.getDefaultBufferSize(); }
+
+    String open (const BigInteger&, const BigInteger&, double, int) override
+    {
+        return "aggregated devices open with their master";
+    }
+
+    void close() override { }
+    bool isOpen() override                              { return master.isOpen(); }
+    void start (AudioIODeviceCallback*) override { }
+    void stop() override { }
+    bool isPlaying() override                           { return master.isPlaying(); }
+    String getLastError() override                      { return master.getLastError(); }
+    int getCurrentBufferSizeSamples() override          { return master.getCurrentBufferSizeSamples(); }
+    double getCurrentSampleRate() override              { return master.getCurrentSampleRate(); }
+    int getCurrentBitDepth() override                   { return master.getCurrentBitDepth(); }
+    int getOutputLatencyInSamples() override            { return master.getOutputLatencyInSamples(); }
+    int getInputLatencyInSamples() override             { return master.getInputLatencyInSamples(); }
+
+    BigInteger getActiveOutputChannels() const override
+    {
+        BigInteger channels;
+        channels.setRange (0, outputNames.size(), true);
+        return channels;
+    }
+
+    BigInteger getActiveInputChannels() const override
+    {
+        BigInteger channels;
+        channels.setRange (0, inputNames.size(), true);
+        return channels;
+    }
+
+private:
+    AudioIODevice& master;
+    StringArray inputNames, outputNames;
+};
+
+//=============================================================================
+DeviceAggregator::DeviceAggregator() { }
+
+DeviceAggregator::~DeviceAggregator()
+{
+    slaves.clear();
+}
+
+void DeviceAggregator::setCallback (AudioIODeviceCallback* newCallback)
+{
+    callback = newCallback;
+}
+
+void DeviceAggregator::setSlaves (AudioIODeviceType* type, const StringArray& names)
+{
+    slaves.clear();
+    if (type == nullptr)
+        return;
+
+    for (const auto& name : names)
+        if (name.isNotEmpty())
+            slaves.add (new Slave (*type, name));
+}
+
+StringArray DeviceAggregator::getSlaveNames() const
+{
+    StringArray names;
+    for (auto* slave : slaves)
+        names.add (slave->name);
+    return names;
+}
+
+int DeviceAggregator::getAddedLatencySamples() const
+{
+    int latency = 0;
+    for (auto* slave : slaves)
+        if (slave->isOpen())
+            latency = jmax (latency, slave->getInputLatency(), slave->getOutputLatency());
+    return latency;
+}
+
+Array<DeviceAggregator::SlaveStats> DeviceAggregator::getStats() const
+{
+    Array<SlaveStats> stats;
+    for (auto* slave : slaves)
+    {
+        if (! slave->isOpen())
+            continue;
+
+        SlaveStats s;
+        s.name          = slave->name;
+        s.sampleRate    = slave->sampleRate;
+        s.numInputs     = slave->numInputs;
+        s.numOutputs    = slave->numOutputs;
+        s.inputLatency  = slave->getInputLatency();
+        s.outputLatency = slave->getOutputLatency();
+        s.input         = slave->input.getStats();
+        s.output        = slave->output.getStats();
+        stats.add (s);
+    }
+
+    return stats;
+}
+
+String DeviceAggregator::getStatus() const
+{
+    StringArray lines;
+    for (const auto& s : getStats())
+    {
+        // whichever side is running measures the same clocks
+        const auto& measured = s.numInputs > 0 ? s.input : s.output;
+        lines.add (s.name + ": " + String (roundToInt (s.sampleRate)) + " Hz, "
+            + String (s.numInputs) + " in, " + String (s.numOutputs) + " out, "
+            + "+" + String (jmax (s.inputLatency, s.outputLatency)) + " samples, drift "
+            + String (s.numInputs > 0 ? measured.driftPpm : -measured.driftPpm, 1) + " ppm, "
+            + String (s.input.underruns + s.output.underruns) + " underruns");
+    }
+
+    return lines.isEmpty() ? String ("No aggregated devices") : lines.joinIntoString ("\n");
+}
+
+//=============================================================================
+void DeviceAggregator::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    const double sampleRate = device->getCurrentSampleRate();
+    blockSize    = device->getCurrentBufferSizeSamples();
+    numMasterIns  = device->getActiveInputChannels().countNumberOfSetBits();
+    numMasterOuts = device->getActiveOutputChannels().countNumberOfSetBits();
+
+    int numSlaveIns = 0, numSlaveOuts = 0;
+    for (auto* slave : slaves)
+    {
+        // the master can't be its own slave
+        if (slave->name == device->getName())
+        {
+            slave->close();
+            continue;
+        }
+
+        if (! slave->open (sampleRate, blockSize))
+            continue;
+        numSlaveIns  += slave->numInputs;
+        numSlaveOuts += slave->numOutputs;
+    }
+
+    aggregating = numSlaveIns + numSlaveOuts > 0;
+    if (aggregating)
+    {
+        slaveInputs.setSize (jmax (1, numSlaveIns), blockSize);
+        slaveOutputs.setSize (jmax (1, numSlaveOuts), blockSize);
+        inputs.calloc ((size_t) (numMasterIns + numSlaveIns));
+        outputs.calloc ((size_t) (numMasterOuts + numSlaveOuts));
+        proxy.reset (new Proxy (*device, slaves));
+    }
+    else
+    {
+        proxy = nullptr;
+    }
+
+    if (callback != nullptr)
+        callback->audioDeviceAboutToStart (aggregating ? proxy.get() : device);
+
+    for (auto* slave : slaves)
+        slave->start();
+}
+
+void DeviceAggregator::audioDeviceStopped()
+{
+    for (auto* slave : slaves)
+        slave->stop();
+    if (callback != nullptr)
+        callback->audioDeviceStopped();
+}
+
+void DeviceAggregator::audioDeviceError (const String& errorMessage)
+{
+    if (callback != nullptr)
+        callback->audioDeviceError (errorMessage);
+}
+
+void DeviceAggregator::audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                              float** outputChannelData, int numOutputChannels,
+                                              int numSamples)
+{
+    if (callback == nullptr)
+    {
+        for (int i = 0; i < numOutputChannels; ++i)
+            FloatVectorOperations::clear (outputChannelData[i], numSamples);
+        return;
+    }
+
+    if (! aggregating)
+    {
+        callback->audioDeviceIOCallback (inputChannelData, numInputChannels,
+                                         outputChannelData, numOutputChannels, numSamples);
+        return;
+    }
+
+    jassert (numInputChannels == numMasterIns && numOutputChannels == numMasterOuts);
+    for (int done = 0; done < numSamples; done += blockSize)
+    {
+        const int numFrames = jmin (blockSize, numSamples - done);
+        for (int i = 0; i < numMasterIns; ++i)
+            inputs[i] = inputChannelData[i] + done;
+        for (int i = 0; i < numMasterOuts; ++i)
+            outputs[i] = outputChannelData[i] + done;
+        process (numFrames);
+    }
+}
+
+void DeviceAggregator::process (int numFrames) noexcept
+{
+    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+    int numIns = numMasterIns, numOuts = numMasterOuts;
+    int slaveIn = 0, slaveOut = 0;
+    for (auto* slave : slaves)
+    {
+        if (! slave->isOpen())
+            continue;
+
+        if (slave->numInputs > 0)
+        {
+            slave->input.pull (slaveInputs.getArrayOfWritePointers() + slaveIn, slave->numInputs, numFrames, now);
+            for (int i = 0; i < slave->numInputs; ++i)
+                inputs[numIns++] = slaveInputs.getReadPointer (slaveIn++);
+        }
+
+        for (int i = 0; i < slave->numOutputs; ++i)
+            outputs[numOuts++] = slaveOutputs.getWritePointer (slaveOut + i);
+        slaveOut += slave->numOutputs;
+    }
+
+    callback->audioDeviceIOCallback (inputs.getData(), numIns, outputs.getData(), numOuts, numFrames);
+
+    slaveOut = 0;
+    for (auto* slave : slaves)
+    {
+        if (! slave->isOpen() || slave->numOutputs <= 0)
+            continue;
+        slave->output.push (slaveOutputs.getArrayOfReadPointers() + slaveOut, slave->numOutputs, numFrames, now);
+        slaveOut += slave->numOutputs;
+    }
+}
+
+}
@@ -0,0 +1,106 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/DriftResampler.h"
+
+namespace Element {
+
+/** Runs more than one audio device as if they were one.
+
+    The device the manager opens is the master: it clocks the engine, and
+    its callback goes through here. Any number of slave devices, of the same
+    type, are opened alongside it on their own threads. Their inputs are
+    resampled onto the master's clock and added after its inputs, and the
+    outputs after the master's go the other way, each through a
+    DriftResampler. The engine sees a single device with all the channels.
+
+    Slave channels arrive later than the master's by the resamplers'
+    latency, which is reported along with how far each slave drifts.
+    Without slaves the master's callback is passed straight through.
+ */
+class DeviceAggregator : public AudioIODeviceCallback
+{
+public:
+    struct SlaveStats
+    {
+        String name;
+        double sampleRate = 0.0;
+        int numInputs = 0;
+        int numOutputs = 0;
+        /** Delay on the slave's inputs and outputs, in master frames */
+        int inputLatency = 0;
+        int outputLatency = 0;
+        DriftResampler::Stats input, output;
+    };
+
+    DeviceAggregator();
+    ~DeviceAggregator();
+
+    /** Sets the callback given the combined channels. Call while the
+        master is stopped */
+    void setCallback (AudioIODeviceCallback* callback);
+
+    /** Replaces the slave devices, by name, from a device type. They open
+        when the master next starts, so call this while it's stopped */
+    void setSlaves (AudioIODeviceType* type, const StringArray& names);
+
+    /** Returns the names of the slave devices */
+    StringArray getSlaveNames() const;
+
+    int getNumSlaves() const noexcept           { return slaves.size(); }
+
+    /** Returns the most any slave channel lags the master, in master frames */
+    int getAddedLatencySamples() const;
+
+    /** Returns the state of each slave that's running */
+    Array<SlaveStats> getStats() const;
+
+    /** Returns the stats as lines of text, for display */
+    String getStatus() const;
+
+    /** @internal */
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels,
+                                int numSamples) override;
+    void audioDeviceAboutToStart (AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+    void audioDeviceError (const String& errorMessage) override;
+
+private:
+    class Slave;
+    class Proxy;
+    OwnedArray<Slave> slaves;
+    AudioIODeviceCallback* callback = nullptr;
+    std::unique_ptr<Proxy> proxy;
+    bool aggregating = false;
+
+    int numMasterIns = 0, numMasterOuts = 0;
+    int blockSize = 0;
+    AudioBuffer<float> slaveInputs, slaveOutputs;
+    HeapBlock<const float*> inputs;
+    HeapBlock<float*> outputs;
+
+    void process (int numFrames) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (DeviceAggregator)
+};
+
+}
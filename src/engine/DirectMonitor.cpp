@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/DirectMonitor.h"
+
+namespace Element {
+
+DirectMonitor::DirectMonitor() { }
+DirectMonitor::~DirectMonitor() { }
+
+void DirectMonitor::setRoutes (const Array<Route>& newRoutes)
+{
+    const ScopedLock sl (writeLock);
+    routes = newRoutes;
+    routes.removeRange (maxRoutes, routes.size());
+
+    auto& config = configs [back];
+    config.numRoutes = routes.size();
+    for (int i = 0; i < routes.size(); ++i)
+        config.routes[i] = routes.getUnchecked (i);
+    back = middle.exchange (back | dirty) & indexMask;
+}
+
+Array<DirectMonitor::Route> DirectMonitor::getRoutes() const
+{
+    const ScopedLock sl (writeLock);
+    return routes;
+}
+
+void DirectMonitor::prepare (double newSampleRate)
+{
+    jassert (newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+    for (auto& state : states)
+        state = State();
+}
+
+void DirectMonitor::process (const float* const* inputs, int numInputs,
+                             float* const* outputs, int numOutputs, int numSamples) noexcept
+{
+    if ((middle.load() & dirty) != 0)
+        front = middle.exchange (front) & indexMask;
+
+    const auto& config = configs [front];
+    const bool isOn = enabled.load();
+
+    for (int r = 0; r < maxRoutes; ++r)
+    {
+        auto& state = states [r];
+        if (r >= config.numRoutes)
+        {
+            state = State();
+            continue;
+        }
+
+        const auto& route = config.routes[r];
+        if (route.input != state.input || route.output != state.output)
+        {
+            // a new route ramps in from silence
+            state = State();
+            state.input  = route.input;
+            state.output = route.output;
+        }
+
+        if (! isPositiveAndBelow (route.input, numInputs) || ! isPositiveAndBelow (route.output, numOutputs)
+            || inputs[route.input] == nullptr || outputs[route.output] == nullptr)
+            continue;
+
+        const float* const in = inputs [route.input];
+        float* const out = outputs [route.output];
+        const float target = isOn ? route.gain : 0.f;
+        const float step = (target - state.gain) / (float) jmax (1, numSamples);
+        float gain = state.gain;
+
+        if (route.highPassHz > 0.f)
+        {
+            const auto coeff = (float) std::exp (-MathConstants<double>::twoPi * route.highPassHz / sampleRate);
+            float lastIn = state.lastIn, lastOut = state.lastOut;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                lastOut = coeff * (lastOut + in[i] - lastIn);
+                lastIn = in[i];
+                gain += step;
+                out[i] += lastOut * gain;
+            }
+            state.lastIn = lastIn;
+            state.lastOut = lastOut;
+        }
+        else if (step != 0.f)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                gain += step;
+                out[i] += in[i] * gain;
+            }
+        }
+        else if (gain != 0.f)
+        {
+            FloatVectorOperations::addWithMultiply (out, in, gain, numSamples);
+        }
+
+        state.gain = target;
+    }
+}
+
+}
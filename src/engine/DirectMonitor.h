@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Routes device inputs straight to device outputs, outside the graph.
+
+    The audio callback mixes these after the graph has rendered, reading the
+    device's own input buffers. Monitoring then costs no plugin latency and
+    keeps going while the graph is locked, suspended or overloaded. Each route
+    has a gain and an optional high pass to take rumble out of a microphone.
+
+    Routes are set from any thread other than the audio thread and are
+    published to it through a triple buffer, so the callback never locks.
+ */
+class DirectMonitor
+{
+public:
+    enum { maxRoutes = 16 };
+
+    struct Route
+    {
+        int input = 0;              ///< device input channel
+        int output = 0;             ///< device output channel
+        float gain = 1.f;           ///< linear, ramped over a block when changed
+        float highPassHz = 0.f;     ///< one pole high pass cutoff, off when 0
+
+        bool operator== (const Route& o) const noexcept
+        {
+            return input == o.input && output == o.output
+                && gain == o.gain && highPassHz == o.highPassHz;
+        }
+        bool operator!= (const Route& o) const noexcept { return ! operator== (o); }
+    };
+
+    DirectMonitor();
+    ~DirectMonitor();
+
+    /** Replaces the routes. Ones past maxRoutes are ignored */
+    void setRoutes (const Array<Route>& routes);
+
+    /** Returns the routes last set */
+    Array<Route> getRoutes() const;
+
+    /** Turns the whole path on or off without losing the routes */
+    void setEnabled (bool shouldBeEnabled) noexcept { enabled.store (shouldBeEnabled); }
+    bool isEnabled() const noexcept                 { return enabled.load(); }
+
+    /** Sets the rate filters run at. Call while the device is stopped */
+    void prepare (double sampleRate);
+
+    /** Mixes the routed inputs into the outputs. Realtime safe */
+    void process (const float* const* inputs, int numInputs,
+                  float* const* outputs, int numOutputs, int numSamples) noexcept;
+
+private:
+    struct Config
+    {
+        int numRoutes = 0;
+        Route routes [maxRoutes];
+    };
+
+    // triple buffered: the audio thread reads 'front', setRoutes fills 'back'
+    // and the two swap through the shared middle slot
+    enum { indexMask = 3, dirty = 4 };
+    Config configs [3];
+    std::atomic<int> middle { 1 };
+    int front = 0, back = 2;
+    CriticalSection writeLock;
+    Array<Route> routes;
+    std::atomic<bool> enabled { true };
+
+    // per route render state, only touched by the audio thread
+    struct State
+    {
+        int input = -1, output = -1;
+        float gain = 0.f;
+        float lastIn = 0.f, lastOut = 0.f;
+    };
+    State states [maxRoutes];
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DirectMonitor)
+};
+
+}
@@ -0,0 +1,470 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/DiskStreamer.h"
+#include "engine/RealtimeThreads.h"
+#include "engine/TimelineTrace.h"
+
+namespace Element {
+
+/* How long the I/O threads wait before looking again when every buffer is
+   full enough, and the most one pass reads for a stream */
+static const int idleWaitMs = 5;
+static const int maxChunkFrames = 2048;
+
+//=============================================================================
+StreamingAudioSource::StreamingAudioSource (PositionableAudioSource* s, bool deleteSourceWhenDeleted,
+                                            DiskStreamer& d, int numFrames, int channels)
+    : source (s, deleteSourceWhenDeleted),
+      streamer (d),
+      numFramesToBuffer (jmax (1024, numFrames)),
+      numChannels (jmax (1, channels))
+{
+    jassert (source != nullptr);
+}
+
+StreamingAudioSource::~StreamingAudioSource()
+{
+    releaseResources();
+}
+
+void StreamingAudioSource::prepareToPlay (int samplesPerBlockExpected, double newSampleRate)
+{
+    streamer.removeStream (this);
+
+    const auto bufferSize = jmax (samplesPerBlockExpected * 2, numFramesToBuffer);
+    sampleRate = newSampleRate;
+    source->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+    {
+        const ScopedLock sl (bufferLock);
+        buffer.setSize (numChannels, bufferSize);
+        bufferValidStart = bufferValidEnd = 0;
+        wasSourceLooping = isLooping();
+    }
+
+    prepared = true;
+    streamer.addStream (this);
+
+    // get a head start, as BufferingAudioSource does
+    waitUntilReady (jmin ((int) newSampleRate / 4, bufferSize / 2), 500);
+}
+
+void StreamingAudioSource::releaseResources()
+{
+    prepared = false;
+    streamer.removeStream (this);
+
+    {
+        const ScopedLock sl (bufferLock);
+        buffer.setSize (numChannels, 0);
+        bufferValidStart = bufferValidEnd = 0;
+    }
+
+    source->releaseResources();
+}
+
+void StreamingAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    const ScopedLock sl (bufferLock);
+    const auto pos = nextPlayPos.load();
+    const auto validStart = (int) (jlimit (bufferValidStart, bufferValidEnd, pos) - pos);
+    const auto validEnd   = (int) (jlimit (bufferValidStart, bufferValidEnd, pos + info.numSamples) - pos);
+
+    // until the buffer has caught up with a cue, the cue plays
+    if ((validStart > 0 || validEnd < info.numSamples) && readFromCue (info, pos))
+    {
+        nextPlayPos += info.numSamples;
+        return;
+    }
+
+    if (validStart == validEnd)
+    {
+        info.clearActiveBufferRegion();
+    }
+    else
+    {
+        if (validStart > 0)
+            info.buffer->clear (info.startSample, validStart);
+        if (validEnd < info.numSamples)
+            info.buffer->clear (info.startSample + validEnd, info.numSamples - validEnd);
+
+        const int size = buffer.getNumSamples();
+        const auto startIndex = (int) ((validStart + pos) % size);
+        const auto endIndex   = (int) ((validEnd + pos) % size);
+
+        for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan)
+        {
+            const int sourceChan = jmin (chan, buffer.getNumChannels() - 1);
+            if (startIndex < endIndex)
+            {
+                info.buffer->copyFrom (chan, info.startSample + validStart, buffer, sourceChan,
+                                       startIndex, validEnd - validStart);
+            }
+            else
+            {
+                const int initialSize = size - startIndex;
+                info.buffer->copyFrom (chan, info.startSample + validStart, buffer, sourceChan,
+                                       startIndex, initialSize);
+                info.buffer->copyFrom (chan, info.startSample + validStart + initialSize, buffer, sourceChan,
+                                       0, (validEnd - validStart) - initialSize);
+            }
+        }
+    }
+
+    // running off the end of a file that doesn't loop isn't an underrun
+    if (validEnd - validStart < info.numSamples && (isLooping() || pos < getTotalLength()))
+        ++numUnderruns;
+
+    nextPlayPos += info.numSamples;
+}
+
+bool StreamingAudioSource::readFromCue (const AudioSourceChannelInfo& info, int64 position) const
+{
+    const auto length = source->getTotalLength();
+    if (isLooping() && length > 0)
+        position %= length;
+
+    for (const auto* cue : cues)
+    {
+        if (position < cue->start || position + info.numSamples > cue->start + cue->audio.getNumSamples())
+            continue;
+
+        const auto offset = (int) (position - cue->start);
+        for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan)
+            info.buffer->copyFrom (chan, info.startSample, cue->audio,
+                                   jmin (chan, cue->audio.getNumChannels() - 1), offset, info.numSamples);
+        return true;
+    }
+
+    return false;
+}
+
+void StreamingAudioSource::setCues (const Array<int64>& positions, int numFrames)
+{
+    OwnedArray<Cue> newCues;
+    if (numFrames > 0)
+    {
+        // the I/O threads read the source too
+        const ScopedLock sl (sourceLock);
+        const auto lastPosition = source->getNextReadPosition();
+
+        for (auto position : positions)
+        {
+            auto* cue = newCues.add (new Cue());
+            cue->start = jmax ((int64) 0, position - cuePreroll);
+            cue->audio.setSize (numChannels, numFrames + (int) (position - cue->start));
+            source->setNextReadPosition (cue->start);
+            source->getNextAudioBlock (AudioSourceChannelInfo (cue->audio));
+        }
+
+        source->setNextReadPosition (lastPosition);
+    }
+
+    const ScopedLock sl (bufferLock);
+    cues.swapWith (newCues);
+}
+
+int StreamingAudioSource::getNumCues() const
+{
+    const ScopedLock sl (bufferLock);
+    return cues.size();
+}
+
+void StreamingAudioSource::setNextReadPosition (int64 newPosition)
+{
+    {
+        const ScopedLock sl (bufferLock);
+        nextPlayPos = newPosition;
+    }
+
+    streamer.wake();
+}
+
+void StreamingAudioSource::restart (int64 position)
+{
+    {
+        const ScopedLock sl (bufferLock);
+        ++generation;
+        bufferValidStart = bufferValidEnd = 0;
+        nextPlayPos = position;
+    }
+
+    streamer.wake();
+}
+
+int64 StreamingAudioSource::getNextReadPosition() const
+{
+    const auto pos = nextPlayPos.load();
+    const auto length = source->getTotalLength();
+    return (source->isLooping() && pos > 0 && length > 0) ? pos % length : pos;
+}
+
+StreamingAudioSource::Health StreamingAudioSource::getHealth() const
+{
+    const ScopedLock sl (bufferLock);
+    const auto pos = nextPlayPos.load();
+
+    Health health;
+    health.capacity = buffer.getNumSamples();
+    health.framesAhead = (pos >= bufferValidStart && pos < bufferValidEnd) ? bufferValidEnd - pos : 0;
+    health.numUnderruns = numUnderruns.load();
+    return health;
+}
+
+bool StreamingAudioSource::waitUntilReady (int numFrames, int timeoutMs)
+{
+    const auto started = Time::getMillisecondCounter();
+    for (;;)
+    {
+        {
+            const ScopedLock sl (bufferLock);
+            const auto pos = nextPlayPos.load();
+            if (buffer.getNumSamples() > 0 && bufferValidStart <= pos && pos + numFrames <= bufferValidEnd)
+                return true;
+        }
+
+        if (! prepared || Time::getMillisecondCounter() - started >= (uint32) timeoutMs)
+            return false;
+
+        streamer.wake();
+        Thread::sleep (1);
+    }
+}
+
+double StreamingAudioSource::getSecondsAhead() const
+{
+    const ScopedLock sl (bufferLock);
+    if (! prepared || buffer.getNumSamples() <= 0 || sampleRate <= 0.0)
+        return -1.0;
+
+    const auto pos = nextPlayPos.load();
+    const bool inRange = pos >= bufferValidStart && pos < bufferValidEnd;
+    const auto framesAhead = inRange ? bufferValidEnd - pos : (int64) 0;
+
+    // readNextChunk skips gaps this small, so they aren't worth a pass
+    if (inRange && wasSourceLooping == isLooping()
+        && framesAhead >= (int64) buffer.getNumSamples() - 4 - 512)
+        return -1.0;
+
+    // nothing is left to read past the end of a file that doesn't loop
+    if (inRange && ! isLooping() && bufferValidEnd >= getTotalLength())
+        return -1.0;
+
+    return (double) framesAhead / sampleRate;
+}
+
+bool StreamingAudioSource::readNextChunk()
+{
+    int64 newStart, newEnd, sectionStart = 0, sectionEnd = 0;
+    uint32 readGeneration;
+    {
+        const ScopedLock sl (bufferLock);
+        readGeneration = generation;
+        if (wasSourceLooping != isLooping())
+        {
+            wasSourceLooping = isLooping();
+            bufferValidStart = bufferValidEnd = 0;
+        }
+
+        newStart = jmax ((int64) 0, nextPlayPos.load());
+        newEnd = newStart + buffer.getNumSamples() - 4;
+
+        if (newStart < bufferValidStart || newStart >= bufferValidEnd)
+        {
+            newEnd = jmin (newEnd, newStart + maxChunkFrames);
+            sectionStart = newStart;
+            sectionEnd = newEnd;
+            bufferValidStart = bufferValidEnd = 0;
+        }
+        else if (std::abs ((int) (newStart - bufferValidStart)) > 512
+                 || std::abs ((int) (newEnd - bufferValidEnd)) > 512)
+        {
+            newEnd = jmin (newEnd, bufferValidEnd + maxChunkFrames);
+            sectionStart = bufferValidEnd;
+            sectionEnd = newEnd;
+            bufferValidStart = newStart;
+            bufferValidEnd = jmin (bufferValidEnd, newEnd);
+        }
+    }
+
+    if (sectionStart == sectionEnd)
+        return false;
+
+    // the section being read lies outside the valid part, so the audio
+    // thread can keep reading the rest of the buffer meanwhile
+    const ScopedLock readLock (sourceLock);
+    const int size = buffer.getNumSamples();
+    const auto startIndex = (int) (sectionStart % size);
+    const auto endIndex   = (int) (sectionEnd % size);
+    if (startIndex < endIndex)
+    {
+        readSection (sectionStart, (int) (sectionEnd - sectionStart), startIndex);
+    }
+    else
+    {
+        const int initialSize = size - startIndex;
+        readSection (sectionStart, initialSize, startIndex);
+        readSection (sectionStart + initialSize, (int) (sectionEnd - sectionStart) - initialSize, 0);
+    }
+
+    {
+        const ScopedLock sl (bufferLock);
+        // a restart meanwhile means this was read from the old source
+        if (readGeneration != generation)
+            return true;
+        bufferValidStart = newStart;
+        bufferValidEnd = newEnd;
+    }
+
+    return true;
+}
+
+void StreamingAudioSource::readSection (int64 start, int length, int bufferOffset)
+{
+    if (source->getNextReadPosition() != start)
+        source->setNextReadPosition (start);
+
+    AudioSourceChannelInfo info (&buffer, bufferOffset, length);
+    source->getNextAudioBlock (info);
+}
+
+//=============================================================================
+class DiskStreamer::IOThread : public Thread
+{
+public:
+    IOThread (DiskStreamer& s, int index)
+        : Thread ("el.diskStreamer." + String (index)),
+          streamer (s) { }
+
+    void run() override
+    {
+        RealtimeThreads::applyBackgroundAffinity();
+        while (! threadShouldExit())
+        {
+            if (auto* stream = streamer.claimMostUrgent())
+            {
+                const TimelineTrace::Zone zone ("disk fill");
+                stream->readNextChunk();
+                streamer.release (stream);
+            }
+            else
+            {
+                wait (idleWaitMs);
+            }
+        }
+    }
+
+private:
+    DiskStreamer& streamer;
+};
+
+DiskStreamer::DiskStreamer()
+{
+    // a couple of threads keep a disk busy, more only fight over it
+    const int numThreads = jlimit (1, 4, SystemStats::getNumCpus() / 4);
+    for (int i = 0; i < numThreads; ++i)
+        threads.add (new IOThread (*this, i))->startThread (6);
+}
+
+DiskStreamer::~DiskStreamer()
+{
+    jassert (streams.isEmpty());
+    for (auto* thread : threads)
+        thread->signalThreadShouldExit();
+    wake();
+    for (auto* thread : threads)
+        thread->waitForThreadToExit (-1);
+    threads.clear();
+}
+
+int DiskStreamer::getNumStreams() const
+{
+    const ScopedLock sl (lock);
+    return streams.size();
+}
+
+Array<StreamingAudioSource::Health> DiskStreamer::getHealth() const
+{
+    const ScopedLock sl (lock);
+    Array<StreamingAudioSource::Health> health;
+    for (const auto* stream : streams)
+        health.add (stream->getHealth());
+    return health;
+}
+
+void DiskStreamer::addStream (StreamingAudioSource* stream)
+{
+    {
+        const ScopedLock sl (lock);
+        streams.addIfNotAlreadyThere (stream);
+    }
+
+    wake();
+}
+
+void DiskStreamer::removeStream (StreamingAudioSource* stream)
+{
+    const ScopedLock sl (lock);
+    streams.removeFirstMatchingValue (stream);
+
+    // a thread might be reading into it right now
+    while (busy.contains (stream))
+    {
+        const ScopedUnlock sul (lock);
+        Thread::sleep (1);
+    }
+}
+
+void DiskStreamer::wake()
+{
+    for (auto* thread : threads)
+        thread->notify();
+}
+
+StreamingAudioSource* DiskStreamer::claimMostUrgent()
+{
+    const ScopedLock sl (lock);
+    StreamingAudioSource* best = nullptr;
+    double bestAhead = 0.0;
+
+    for (auto* stream : streams)
+    {
+        if (busy.contains (stream))
+            continue;
+
+        const auto ahead = stream->getSecondsAhead();
+        if (ahead >= 0.0 && (best == nullptr || ahead < bestAhead))
+        {
+            best = stream;
+            bestAhead = ahead;
+        }
+    }
+
+    if (best != nullptr)
+        busy.add (best);
+    return best;
+}
+
+void DiskStreamer::release (StreamingAudioSource* stream)
+{
+    const ScopedLock sl (lock);
+    busy.removeFirstMatchingValue (stream);
+}
+
+}
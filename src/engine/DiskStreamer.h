@@ -0,0 +1,162 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class DiskStreamer;
+
+/** Buffers a source ahead of its playhead, filled by the DiskStreamer's threads.
+
+    It works like JUCE's BufferingAudioSource, but instead of each player
+    having a thread of its own, every stream is filled by a small shared pool
+    that serves the stream closest to running dry first.
+ */
+class StreamingAudioSource : public PositionableAudioSource
+{
+public:
+    /** How full a stream's buffer is */
+    struct Health
+    {
+        /** Frames buffered ahead of the playhead */
+        int64 framesAhead = 0;
+        /** Frames the buffer holds */
+        int capacity = 0;
+        /** Blocks that were played before all of their audio had been read */
+        int numUnderruns = 0;
+
+        /** Returns how full the buffer is, from 0 to 1 */
+        float getFillLevel() const noexcept { return capacity > 0 ? (float) framesAhead / (float) capacity : 0.f; }
+    };
+
+    StreamingAudioSource (PositionableAudioSource* source, bool deleteSourceWhenDeleted,
+                          DiskStreamer& streamer, int numFramesToBuffer, int numChannels);
+    ~StreamingAudioSource();
+
+    /** Returns how full the buffer is right now */
+    Health getHealth() const;
+
+    /** Blocks until the audio for a block starting at the playhead has been
+        read, or the timeout passes. Returns false if it timed out */
+    bool waitUntilReady (int numFrames, int timeoutMs);
+
+    /** Decodes the audio after each position into memory, and keeps it.
+        Playing from a cue starts straight from memory while the buffer fills,
+        then carries on from the buffer. The frames just before a cue are kept
+        too, for resamplers that read behind the playhead. Call this on the
+        message thread */
+    void setCues (const Array<int64>& positions, int numFrames);
+
+    /** Returns the number of cues held in memory */
+    int getNumCues() const;
+
+    /** Forgets what's buffered and plays on from a position. Call this once
+        the source reads something else, reads already under way are then
+        thrown away instead of played. Safe to call from the audio thread */
+    void restart (int64 position);
+
+    /** Frames kept before each cue */
+    static const int cuePreroll = 256;
+
+    /** @internal */
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+    void setNextReadPosition (int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override      { return source->getTotalLength(); }
+    bool isLooping() const override             { return source->isLooping(); }
+    void setLooping (bool shouldLoop) override  { source->setLooping (shouldLoop); }
+
+private:
+    friend class DiskStreamer;
+    OptionalScopedPointer<PositionableAudioSource> source;
+    DiskStreamer& streamer;
+    const int numFramesToBuffer, numChannels;
+    AudioBuffer<float> buffer;
+    CriticalSection bufferLock, sourceLock;
+    int64 bufferValidStart = 0, bufferValidEnd = 0;
+    uint32 generation = 0;
+    std::atomic<int64> nextPlayPos { 0 };
+    std::atomic<int> numUnderruns { 0 };
+    std::atomic<bool> prepared { false };
+    bool wasSourceLooping = false;
+    double sampleRate = 0.0;
+
+    struct Cue
+    {
+        int64 start;
+        AudioBuffer<float> audio;
+    };
+    OwnedArray<Cue> cues;
+    bool readFromCue (const AudioSourceChannelInfo&, int64 position) const;
+
+    /** Returns how many seconds of audio are buffered, or a negative value
+        if there's nothing to read */
+    double getSecondsAhead() const;
+    bool readNextChunk();
+    void readSection (int64 start, int length, int bufferOffset);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StreamingAudioSource)
+};
+
+/** The engine's disk streaming service.
+
+    A few I/O threads fill the buffers of every StreamingAudioSource in the
+    process. Each pass goes to the stream with the least audio buffered
+    ahead of its playhead, so the one closest to an underrun is read first
+    however many streams there are. There is one for the app, shared
+    through a SharedResourcePointer.
+ */
+class DiskStreamer
+{
+public:
+    DiskStreamer();
+    ~DiskStreamer();
+
+    /** Returns the number of I/O threads */
+    int getNumThreads() const noexcept { return threads.size(); }
+
+    /** Returns the number of streams being filled */
+    int getNumStreams() const;
+
+    /** Returns the health of every stream being filled */
+    Array<StreamingAudioSource::Health> getHealth() const;
+
+private:
+    friend class StreamingAudioSource;
+    class IOThread;
+    OwnedArray<IOThread> threads;
+    CriticalSection lock;
+    Array<StreamingAudioSource*> streams;
+    Array<StreamingAudioSource*> busy;
+
+    void addStream (StreamingAudioSource*);
+    void removeStream (StreamingAudioSource*);
+    void wake();
+    StreamingAudioSource* claimMostUrgent();
+    void release (StreamingAudioSource*);
+
+    JUCE_DECLARE_NON_COPYABLE (DiskStreamer)
+};
+
+}
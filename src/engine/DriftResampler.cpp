@@ -0,0 +1,253 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/DriftResampler.h"
+
+namespace Element {
+
+/** How long the loop takes to pull the fill back to its target, and how
+    long the fill is averaged over. The average is well inside the loop so
+    block sized bursts don't wobble the ratio */
+static const double loopSeconds         = 4.0;
+static const double smoothingSeconds    = 0.5;
+
+void DriftResampler::prepare (int channels, double rate, double newDestRate,
+                              int sourceBlockSize, int destBlockSize)
+{
+    jassert (channels > 0 && rate > 0.0 && newDestRate > 0.0);
+    numChannels = jmax (1, channels);
+    sourceRate = rate;
+    destRate = newDestRate;
+    nominal = sourceRate / destRate;
+    maxDestBlock = jmax (1, destBlockSize);
+    table = filters->get (SincResamplingAudioSource::Good, nominal);
+
+    const int halfTaps = table->numTaps / 2;
+    const double maxStep = nominal * (1.0 + maxCorrectionPpm * 1.0e-6);
+    // a block from the source, the filter's look ahead, and two blocks
+    // taken by the destination so its callbacks have room to wander
+    targetFill = jmax (1, sourceBlockSize) + 2 * (int) std::ceil (maxDestBlock * nominal) + halfTaps + 1;
+    maxInFlight = 2.0 * jmax (1, sourceBlockSize) / sourceRate;
+
+    fifo.setTotalSize (targetFill * 4 + 1);
+    fifo.reset();
+    storage.setSize (numChannels, fifo.getTotalSize(), false, true);
+    history.setSize (numChannels, (int) std::ceil (maxDestBlock * maxStep) + table->numTaps + 4, false, true);
+    chunk.calloc ((size_t) numChannels);
+
+    // proportional gain for the loop time, integral for critical damping
+    kp = 1.0 / (destRate * loopSeconds * nominal);
+    ki = nominal * kp * kp * 0.25;
+    integral = 0.0;
+    running = false;
+
+    pushTime.store (0.0);
+    ratio.store (nominal);
+    drift.store (0.0);
+    averageFill.store (0.0);
+    underruns.store (0);
+    overruns.store (0);
+}
+
+void DriftResampler::release()
+{
+    table = nullptr;
+    numChannels = maxDestBlock = targetFill = 0;
+    storage.setSize (1, 1);
+    history.setSize (1, 1);
+    chunk.free();
+    running = false;
+}
+
+int DriftResampler::getLatencySamples() const noexcept
+{
+    return table != nullptr ? roundToInt ((double) targetFill / nominal) : 0;
+}
+
+void DriftResampler::push (const float* const* input, int numInputChannels, int numFrames, double time) noexcept
+{
+    if (table == nullptr || numFrames <= 0)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numFrames, start1, size1, start2, size2);
+    if (size1 + size2 < numFrames)
+        overruns.fetch_add (1);
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        const float* src = c < numInputChannels ? input[c] : nullptr;
+        if (src != nullptr)
+        {
+            storage.copyFrom (c, start1, src, size1);
+            storage.copyFrom (c, start2, src + size1, size2);
+        }
+        else
+        {
+            storage.clear (c, start1, size1);
+            storage.clear (c, start2, size2);
+        }
+    }
+
+    fifo.finishedWrite (size1 + size2);
+    pushTime.store (time);
+}
+
+void DriftResampler::restart() noexcept
+{
+    // start at the target, whatever piled up while nothing was pulled
+    const int excess = fifo.getNumReady() - targetFill;
+    if (excess > 0)
+        fifo.finishedRead (excess);
+
+    const int halfTaps = table->numTaps / 2;
+    history.clear();
+    numValid = halfTaps - 1;
+    readPos = (double) (halfTaps - 1);
+    error = 0.0;
+    running = true;
+}
+
+void DriftResampler::read (int numFrames) noexcept
+{
+    if (numFrames <= 0)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numFrames, start1, size1, start2, size2);
+    for (int c = 0; c < numChannels; ++c)
+    {
+        history.copyFrom (c, numValid, storage, c, start1, size1);
+        history.copyFrom (c, numValid + size1, storage, c, start2, size2);
+    }
+
+    fifo.finishedRead (size1 + size2);
+    numValid += size1 + size2;
+}
+
+void DriftResampler::updateRatio (int numFrames, double time) noexcept
+{
+    // frames read from the FIFO but not yet passed count as waiting too, and
+    // so do the ones the source has made since it last pushed
+    const double inFlight = jlimit (0.0, maxInFlight, time - pushTime.load());
+    const double fill = (double) fifo.getNumReady() + ((double) numValid - readPos) + inFlight * sourceRate;
+    const double alpha = jmin (1.0, numFrames / (destRate * smoothingSeconds));
+    error += alpha * (fill - (double) targetFill - error);
+
+    const double limit = maxCorrectionPpm * 1.0e-6;
+    integral = jlimit (-limit, limit, integral + ki * error * numFrames);
+    const double correction = jlimit (-limit, limit, kp * error + integral);
+
+    ratio.store (nominal * (1.0 + correction));
+    drift.store (integral * 1.0e6);
+    averageFill.store ((double) targetFill + error);
+}
+
+void DriftResampler::pull (float* const* output, int numOutputChannels, int numFrames, double time) noexcept
+{
+    const int numOut = jmin (numChannels, numOutputChannels);
+    for (int c = numOut; c < numOutputChannels; ++c)
+        FloatVectorOperations::clear (output[c], numFrames);
+    if (table == nullptr || numFrames <= 0)
+        return;
+
+    if (numFrames > maxDestBlock)
+    {
+        // larger blocks than prepared for go through in pieces
+        for (int done = 0; done < numFrames; done += maxDestBlock)
+        {
+            for (int c = 0; c < numOut; ++c)
+                chunk[c] = output[c] + done;
+            pull (chunk, numOut, jmin (maxDestBlock, numFrames - done), time + done / destRate);
+        }
+        return;
+    }
+
+    const int halfTaps = table->numTaps / 2;
+    if (! running)
+    {
+        if (fifo.getNumReady() < targetFill)
+        {
+            for (int c = 0; c < numOut; ++c)
+                FloatVectorOperations::clear (output[c], numFrames);
+            return;
+        }
+
+        restart();
+    }
+
+    updateRatio (numFrames, time);
+    const double step = ratio.load();
+    const int needed = (int) (readPos + (numFrames - 1) * step) + halfTaps + 1;
+    if (needed - numValid > fifo.getNumReady())
+    {
+        // the source stalled, fill up to the target again
+        underruns.fetch_add (1);
+        running = false;
+        for (int c = 0; c < numOut; ++c)
+            FloatVectorOperations::clear (output[c], numFrames);
+        return;
+    }
+
+    read (needed - numValid);
+
+    for (int c = 0; c < numOut; ++c)
+    {
+        const float* in = history.getReadPointer (c);
+        float* out = output[c];
+        double pos = readPos;
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const int n = (int) pos;
+            out[i] = table->interpolate (in + n - (halfTaps - 1), pos - (double) n);
+            pos += step;
+        }
+    }
+
+    readPos += numFrames * step;
+
+    // keep only the frames the next window reaches back to
+    const int discard = jmin (numValid, (int) readPos - (halfTaps - 1));
+    if (discard > 0)
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto* data = history.getWritePointer (c);
+            std::memmove (data, data + discard, sizeof (float) * (size_t) (numValid - discard));
+        }
+
+        numValid -= discard;
+        readPos -= discard;
+    }
+}
+
+DriftResampler::Stats DriftResampler::getStats() const noexcept
+{
+    Stats stats;
+    stats.ratio      = ratio.load();
+    stats.driftPpm   = drift.load();
+    stats.fill       = averageFill.load();
+    stats.targetFill = targetFill;
+    stats.underruns  = underruns.load();
+    stats.overruns   = overruns.load();
+    return stats;
+}
+
+}
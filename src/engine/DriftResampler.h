@@ -0,0 +1,128 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/SincResampler.h"
+
+namespace Element {
+
+/** Carries audio between two devices whose clocks drift apart.
+
+    One thread pushes frames at the source rate into a lock free FIFO, the
+    other pulls them out at its own rate through a sinc resampler. The
+    ratio starts at the nominal one and is corrected by a PI loop that holds
+    the FIFO at a target fill, so over time the correction settles on the
+    clocks' actual drift. Both sides say when they run, so the frames the
+    source has produced since it last pushed are counted in the fill too,
+    which keeps its bursts from beating against the loop. Until the FIFO first reaches the target, and after
+    any underrun, silence is pulled while it fills again.
+
+    Push and pull are realtime safe, each from one thread only.
+ */
+class DriftResampler
+{
+public:
+    struct Stats
+    {
+        /** Source frames read per destination frame */
+        double ratio = 1.0;
+        /** How far the source clock runs from nominal, in parts per million */
+        double driftPpm = 0.0;
+        /** Frames waiting in the FIFO, averaged, and the fill being held */
+        double fill = 0.0;
+        int targetFill = 0;
+        int underruns = 0;
+        int overruns = 0;
+    };
+
+    enum
+    {
+        /** The correction never strays further than this, in parts per million */
+        maxCorrectionPpm = 2000
+    };
+
+    DriftResampler() = default;
+
+    /** Sizes the FIFO and history for the rates and the largest blocks each
+        side will use. Not realtime safe, and neither side may be running */
+    void prepare (int numChannels, double sourceRate, double destRate,
+                  int sourceBlockSize, int destBlockSize);
+
+    /** Frees everything allocated when prepared */
+    void release();
+
+    bool isPrepared() const noexcept            { return table != nullptr; }
+    int getNumChannels() const noexcept         { return numChannels; }
+
+    /** Returns the delay through the FIFO and filter, in destination frames */
+    int getLatencySamples() const noexcept;
+
+    /** Writes frames from the source side, at a time in seconds on a clock
+        both sides share. Frames that don't fit are dropped and counted as
+        an overrun */
+    void push (const float* const* input, int numInputChannels, int numFrames, double time) noexcept;
+
+    /** Reads resampled frames from the destination side, at a time on the
+        same clock as the source's */
+    void pull (float* const* output, int numOutputChannels, int numFrames, double time) noexcept;
+
+    /** Returns the current ratio and health. This can be called from any thread */
+    Stats getStats() const noexcept;
+
+private:
+    SharedResourcePointer<SincResamplingAudioSource::FilterCache> filters;
+    SincResamplingAudioSource::FilterTable::Ptr table;
+    int numChannels = 0;
+    int maxDestBlock = 0;
+    double nominal = 1.0;
+    double sourceRate = 0.0;
+    double destRate = 0.0;
+    double maxInFlight = 0.0;
+    int targetFill = 0;
+
+    AbstractFifo fifo { 1 };
+    AudioBuffer<float> storage;
+    HeapBlock<float*> chunk;
+
+    // destination side only
+    AudioBuffer<float> history;
+    int numValid = 0;
+    double readPos = 0.0;
+    bool running = false;
+    double error = 0.0;
+    double integral = 0.0;
+    double kp = 0.0;
+    double ki = 0.0;
+
+    std::atomic<double> pushTime { 0.0 };
+    std::atomic<double> ratio { 1.0 };
+    std::atomic<double> drift { 0.0 };
+    std::atomic<double> averageFill { 0.0 };
+    std::atomic<int> underruns { 0 };
+    std::atomic<int> overruns { 0 };
+
+    void restart() noexcept;
+    void read (int numFrames) noexcept;
+    void updateRatio (int numFrames, double time) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (DriftResampler)
+};
+
+}
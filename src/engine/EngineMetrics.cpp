@@ -0,0 +1,297 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AudioEngine.h"
+#include "engine/DiskStreamer.h"
+#include "engine/EngineMetrics.h"
+#include "engine/MidiBudget.h"
+#include "session/DeviceManager.h"
+#include "session/Node.h"
+#include "session/Session.h"
+#include "Globals.h"
+
+namespace Element {
+
+static int64 getMemoryBytes (const Element::Node& node)
+{
+    GraphNodePtr object = node.getGraphNode();
+    auto* graph = object != nullptr ? dynamic_cast<GraphProcessor*> (object->getAudioProcessor()) : nullptr;
+    return graph != nullptr ? graph->getRenderMemoryBytes() : 0;
+}
+
+static void addNodes (EngineMetrics& metrics, EngineMetrics::Graph& graph, const Element::Node& parent)
+{
+    for (int i = 0; i < parent.getNumNodes(); ++i)
+    {
+        const auto node = parent.getNode (i);
+        if (GraphNodePtr object = node.getGraphNode())
+        {
+            EngineMetrics::Node entry;
+            entry.graph = graph.name;
+            entry.name = node.getName();
+            entry.nodeId = node.getNodeId();
+            if (metrics.profiling)
+                entry.time = object->getProcessTime();
+            entry.memory = object->getMemoryUsage();
+            graph.memoryBytes += entry.memory.getTotal();
+            metrics.nodes.add (entry);
+        }
+
+        if (node.isGraph())
+        {
+            graph.memoryBytes += getMemoryBytes (node);
+            addNodes (metrics, graph, node);
+        }
+    }
+}
+
+//=============================================================================
+static String escapeLabel (const String& value)
+{
+    return value.replace ("\\", "\\\\").replace ("\"", "\\\"").replace ("\n", "\\n");
+}
+
+static void addMetric (String& text, const char* name, const char* type, const char* help)
+{
+    text << "# HELP " << name << " " << help << "\n"
+         << "# TYPE " << name << " " << type << "\n";
+}
+
+static void addSample (String& text, const char* name, const String& labels, double value)
+{
+    text << name;
+    if (labels.isNotEmpty())
+        text << "{" << labels << "}";
+    text << " " << String (value, 6).trimCharactersAtEnd ("0").trimCharactersAtEnd (".") << "\n";
+}
+
+static String nodeLabels (const EngineMetrics::Node& node)
+{
+    return "graph=\"" + escapeLabel (node.graph) + "\",node=\"" + escapeLabel (node.name)
+        + "\",id=\"" + String (node.nodeId) + "\"";
+}
+
+String EngineMetrics::toPrometheus() const
+{
+    String text;
+    addMetric (text, "element_callback_load", "gauge", "Audio callback load, from 0 to 1.");
+    addSample (text, "element_callback_load", {}, cpuLoad);
+    addMetric (text, "element_sample_rate", "gauge", "Device sample rate.");
+    addSample (text, "element_sample_rate", {}, sampleRate);
+    addMetric (text, "element_buffer_size", "gauge", "Device buffer size in samples.");
+    addSample (text, "element_buffer_size", {}, bufferSize);
+    addMetric (text, "element_callback_average_ms", "gauge", "Average audio callback time since the previous snapshot.");
+    addSample (text, "element_callback_average_ms", {}, callbackAverageMs);
+    addMetric (text, "element_callback_max_ms", "gauge", "Longest audio callback since the previous snapshot.");
+    addSample (text, "element_callback_max_ms", {}, callbackMaximumMs);
+    addMetric (text, "element_xruns_total", "counter", "Audio callbacks that missed their deadline.");
+    addSample (text, "element_xruns_total", {}, numOverruns);
+    addMetric (text, "element_midi_in_per_second", "gauge", "MIDI events going into the graphs.");
+    addSample (text, "element_midi_in_per_second", {}, midiInPerSecond);
+    addMetric (text, "element_midi_out_per_second", "gauge", "MIDI events sent to the output device.");
+    addSample (text, "element_midi_out_per_second", {}, midiOutPerSecond);
+    addMetric (text, "element_midi_dropped_total", "counter", "MIDI events dropped for going over the budget.");
+    addSample (text, "element_midi_dropped_total", {}, (double) midiDropped);
+    addMetric (text, "element_disk_streams", "gauge", "Disk streams being filled.");
+    addSample (text, "element_disk_streams", {}, numStreams);
+    addMetric (text, "element_disk_stream_min_fill", "gauge", "Fill level of the emptiest disk stream buffer, from 0 to 1.");
+    addSample (text, "element_disk_stream_min_fill", {}, minStreamFill);
+    addMetric (text, "element_disk_stream_underruns_total", "counter", "Blocks played before their audio was read from disk.");
+    addSample (text, "element_disk_stream_underruns_total", {}, streamUnderruns);
+    addMetric (text, "element_profiling", "gauge", "1 while node render times are measured.");
+    addSample (text, "element_profiling", {}, profiling ? 1.0 : 0.0);
+
+    addMetric (text, "element_graph_nodes", "gauge", "Nodes in a graph, not counting those of its subgraphs.");
+    for (const auto& graph : graphs)
+        addSample (text, "element_graph_nodes", "graph=\"" + escapeLabel (graph.name) + "\"", graph.numNodes);
+    addMetric (text, "element_graph_memory_bytes", "gauge", "Bytes held by the render buffers of a graph and its subgraphs.");
+    for (const auto& graph : graphs)
+        addSample (text, "element_graph_memory_bytes", "graph=\"" + escapeLabel (graph.name) + "\"", (double) graph.memoryBytes);
+    addMetric (text, "element_graph_memory_budget_bytes", "gauge", "Bytes a graph should stay under, 0 when unlimited.");
+    for (const auto& graph : graphs)
+        addSample (text, "element_graph_memory_budget_bytes", "graph=\"" + escapeLabel (graph.name) + "\"", (double) graph.memoryBudget);
+
+    if (nodes.isEmpty())
+        return text;
+
+    addMetric (text, "element_node_memory_bytes", "gauge", "Bytes a node holds, by what holds them.");
+    for (const auto& node : nodes)
+    {
+        const auto labels = nodeLabels (node);
+        addSample (text, "element_node_memory_bytes", labels + ",kind=\"render\"", (double) node.memory.renderBytes);
+        addSample (text, "element_node_memory_bytes", labels + ",kind=\"midi\"", (double) node.memory.midiBytes);
+        addSample (text, "element_node_memory_bytes", labels + ",kind=\"oversampling\"", (double) node.memory.oversamplingBytes);
+        addSample (text, "element_node_memory_bytes", labels + ",kind=\"content\"", (double) node.memory.contentBytes);
+        addSample (text, "element_node_memory_bytes", labels + ",kind=\"plugin\"", (double) node.memory.pluginBytes);
+    }
+
+    if (! profiling)
+        return text;
+
+    addMetric (text, "element_node_average_ms", "gauge", "Average render time of a node.");
+    for (const auto& node : nodes)
+        addSample (text, "element_node_average_ms", nodeLabels (node), node.time.averageMs);
+    addMetric (text, "element_node_max_ms", "gauge", "Longest render time of a node.");
+    for (const auto& node : nodes)
+        addSample (text, "element_node_max_ms", nodeLabels (node), node.time.maximumMs);
+    addMetric (text, "element_node_load", "gauge", "Average render time of a node as a fraction of the block.");
+    for (const auto& node : nodes)
+        addSample (text, "element_node_load", nodeLabels (node), node.time.load);
+    return text;
+}
+
+String EngineMetrics::toJSON() const
+{
+    DynamicObject::Ptr root = new DynamicObject();
+    root->setProperty ("load", cpuLoad);
+    root->setProperty ("sampleRate", sampleRate);
+    root->setProperty ("bufferSize", bufferSize);
+    root->setProperty ("callbacks", numCallbacks);
+    root->setProperty ("callbackAverageMs", callbackAverageMs);
+    root->setProperty ("callbackMaximumMs", callbackMaximumMs);
+    root->setProperty ("xruns", numOverruns);
+    root->setProperty ("midiInPerSecond", midiInPerSecond);
+    root->setProperty ("midiOutPerSecond", midiOutPerSecond);
+    root->setProperty ("midiDropped", midiDropped);
+    root->setProperty ("diskStreams", numStreams);
+    root->setProperty ("diskStreamMinFill", minStreamFill);
+    root->setProperty ("diskStreamUnderruns", streamUnderruns);
+    root->setProperty ("profiling", profiling);
+
+    Array<var> graphList;
+    for (const auto& graph : graphs)
+    {
+        DynamicObject::Ptr object = new DynamicObject();
+        object->setProperty ("name", graph.name);
+        object->setProperty ("nodes", graph.numNodes);
+        object->setProperty ("memoryBytes", graph.memoryBytes);
+        object->setProperty ("memoryBudget", graph.memoryBudget);
+        graphList.add (var (object.get()));
+    }
+    root->setProperty ("graphs", graphList);
+
+    Array<var> nodeList;
+    for (const auto& node : nodes)
+    {
+        DynamicObject::Ptr object = new DynamicObject();
+        object->setProperty ("graph", node.graph);
+        object->setProperty ("name", node.name);
+        object->setProperty ("id", (int64) node.nodeId);
+        object->setProperty ("lastMs", node.time.lastMs);
+        object->setProperty ("averageMs", node.time.averageMs);
+        object->setProperty ("maximumMs", node.time.maximumMs);
+        object->setProperty ("load", node.time.load);
+
+        DynamicObject::Ptr memory = new DynamicObject();
+        memory->setProperty ("render", node.memory.renderBytes);
+        memory->setProperty ("midi", node.memory.midiBytes);
+        memory->setProperty ("oversampling", node.memory.oversamplingBytes);
+        memory->setProperty ("content", node.memory.contentBytes);
+        memory->setProperty ("plugin", node.memory.pluginBytes);
+        memory->setProperty ("total", node.memory.getTotal());
+        object->setProperty ("memory", var (memory.get()));
+        nodeList.add (var (object.get()));
+    }
+    root->setProperty ("nodes", nodeList);
+
+    return JSON::toString (var (root.get()), true);
+}
+
+//=============================================================================
+EngineMetrics::Collector::Collector (Globals& w)
+    : world (w)
+{ }
+
+EngineMetrics::Collector::~Collector() { }
+
+EngineMetrics EngineMetrics::Collector::collect()
+{
+    EngineMetrics metrics;
+    const auto now = Time::getHighResolutionTicks();
+
+    auto& devices = world.getDeviceManager();
+    metrics.cpuLoad = devices.getCpuUsage();
+    if (auto* device = devices.getCurrentAudioDevice())
+    {
+        metrics.sampleRate = device->getCurrentSampleRate();
+        metrics.bufferSize = device->getCurrentBufferSizeSamples();
+    }
+
+    if (auto engine = world.getAudioEngine())
+    {
+        metrics.numOverruns = engine->getNumOverruns();
+
+        Array<CallbackTracer::Record> records;
+        engine->getCallbackHistory (records);
+        const int64 since = lastTicks > 0 ? lastTicks
+                          : records.isEmpty() ? now : records.getReference(0).startTicks;
+
+        double totalMs = 0.0;
+        int midiIn = 0, midiOut = 0;
+        for (const auto& record : records)
+        {
+            if (record.startTicks < since)
+                continue;
+            ++metrics.numCallbacks;
+            totalMs += record.totalMs;
+            metrics.callbackMaximumMs = jmax (metrics.callbackMaximumMs, (double) record.totalMs);
+            midiIn += record.numMidiIn;
+            midiOut += record.numMidiOut;
+        }
+
+        const auto seconds = Time::highResolutionTicksToSeconds (now - since);
+        if (metrics.numCallbacks > 0)
+            metrics.callbackAverageMs = totalMs / (double) metrics.numCallbacks;
+        if (seconds > 0.0)
+        {
+            metrics.midiInPerSecond = (double) midiIn / seconds;
+            metrics.midiOutPerSecond = (double) midiOut / seconds;
+        }
+    }
+
+    lastTicks = now;
+    metrics.midiDropped = MidiBudget::getNumDropped();
+
+    for (const auto& health : streamer->getHealth())
+    {
+        ++metrics.numStreams;
+        metrics.minStreamFill = jmin (metrics.minStreamFill, health.getFillLevel());
+        metrics.streamUnderruns += health.numUnderruns;
+    }
+
+    metrics.profiling = GraphNode::isProfilingEnabled();
+    if (auto session = world.getSession())
+    {
+        for (int i = 0; i < session->getNumGraphs(); ++i)
+        {
+            const auto node = session->getGraph (i);
+            Graph graph;
+            graph.name = node.getName();
+            graph.numNodes = node.getNumNodes();
+            graph.memoryBytes = getMemoryBytes (node);
+            graph.memoryBudget = (int64) (int) node.getProperty (Tags::memoryBudget, 0) * 1024 * 1024;
+            addNodes (metrics, graph, node);
+            metrics.graphs.add (graph);
+        }
+    }
+
+    return metrics;
+}
+
+}
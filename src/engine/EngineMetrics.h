@@ -0,0 +1,99 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/GraphNode.h"
+
+namespace Element {
+
+class DiskStreamer;
+class Globals;
+
+/** A snapshot of what the engine is doing, for monitoring.
+
+    Everything is read from counters and rings the audio thread already
+    keeps for profiling, none of it locks or waits on the audio thread.
+    Node render times are only measured while profiling is enabled, see
+    GraphNode::setProfilingEnabled. Memory is always accounted.
+ */
+struct EngineMetrics
+{
+    struct Graph
+    {
+        String name;
+        int numNodes            = 0;
+        int64 memoryBytes       = 0;    ///< held by the graph's render program and its nodes
+        int64 memoryBudget      = 0;    ///< bytes the graph should stay under, zero when unlimited
+
+        bool isOverBudget() const noexcept { return memoryBudget > 0 && memoryBytes > memoryBudget; }
+    };
+
+    struct Node
+    {
+        String graph;
+        String name;
+        uint32 nodeId           = 0;
+        ProcessTimer::Reading time;
+        GraphNode::MemoryUsage memory;
+    };
+
+    double cpuLoad              = 0.0;  ///< the device's callback load, from 0 to 1
+    double sampleRate           = 0.0;
+    int bufferSize              = 0;
+    int numCallbacks            = 0;    ///< callbacks since the previous snapshot, as are the times below
+    double callbackAverageMs    = 0.0;
+    double callbackMaximumMs    = 0.0;
+    int numOverruns             = 0;    ///< since the device started
+    double midiInPerSecond      = 0.0;
+    double midiOutPerSecond     = 0.0;
+    int64 midiDropped           = 0;    ///< events over the MIDI budget
+    int numStreams              = 0;    ///< disk streams being filled
+    float minStreamFill         = 1.f;  ///< the emptiest stream's buffer, from 0 to 1
+    int streamUnderruns         = 0;
+    bool profiling              = false;
+    Array<Graph> graphs;
+    Array<Node> nodes;
+
+    /** Formats the snapshot in the Prometheus text exposition format */
+    String toPrometheus() const;
+
+    /** Formats the snapshot as a single line of JSON */
+    String toJSON() const;
+
+    /** Takes snapshots. MIDI rates and callback times cover the time since
+        the previous snapshot. Use from the message thread */
+    class Collector
+    {
+    public:
+        explicit Collector (Globals&);
+        ~Collector();
+
+        EngineMetrics collect();
+
+    private:
+        Globals& world;
+        SharedResourcePointer<DiskStreamer> streamer;
+        int64 lastTicks = 0;
+
+        JUCE_DECLARE_NON_COPYABLE (Collector)
+    };
+};
+
+}
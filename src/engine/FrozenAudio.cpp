@@ -0,0 +1,64 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/FrozenAudio.h"
+
+namespace Element {
+
+FrozenAudio::FrozenAudio (const File& f, MemoryMappedAudioFormatReader* r, int64 start)
+    : file (f), reader (r), startFrame (start) { }
+
+FrozenAudio::~FrozenAudio() { }
+
+FrozenAudio::Ptr FrozenAudio::open (const File& file, int64 startFrame)
+{
+    WavAudioFormat wav;
+    std::unique_ptr<MemoryMappedAudioFormatReader> reader (wav.createMemoryMappedReader (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || ! reader->mapEntireFile())
+        return nullptr;
+
+    // fault the pages in now instead of on the audio thread
+    for (int64 i = 0; i < reader->lengthInSamples; i += 1024)
+        reader->touchSample (i);
+
+    return new FrozenAudio (file, reader.release(), startFrame);
+}
+
+void FrozenAudio::read (AudioSampleBuffer& buffer, int numChannels, int64 position, int numSamples) const noexcept
+{
+    const int64 length = reader->lengthInSamples;
+    const int numRendered = jmin (numChannels, getNumChannels());
+    position %= length;
+    if (position < 0)
+        position += length;
+
+    for (int done = 0; numRendered > 0 && done < numSamples;)
+    {
+        const int chunk = (int) jmin ((int64) (numSamples - done), length - position);
+        AudioSampleBuffer dest (buffer.getArrayOfWritePointers(), numRendered, done, chunk);
+        reader->read (&dest, 0, chunk, position, true, numRendered > 1);
+        done += chunk;
+        position = 0;
+    }
+
+    for (int i = numRendered; i < numChannels; ++i)
+        buffer.clear (i, 0, numSamples);
+}
+
+}
@@ -0,0 +1,71 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** The rendered output of a frozen node, memory mapped for playback.
+
+    Render ops hold a reference while they play it, so a node can be
+    unfrozen without waiting for the audio thread to let go.
+ */
+class FrozenAudio : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<FrozenAudio>;
+
+    ~FrozenAudio();
+
+    /** Maps a WAV file written by the offline renderer. Returns nullptr if
+        it couldn't be read */
+    static Ptr open (const File& file, int64 startFrame);
+
+    /** Returns the file being played */
+    const File& getFile() const noexcept            { return file; }
+
+    /** Returns the number of channels rendered */
+    int getNumChannels() const noexcept             { return (int) reader->numChannels; }
+
+    /** Returns the length in samples */
+    int64 getLengthInSamples() const noexcept       { return reader->lengthInSamples; }
+
+    /** Returns the sample rate it was rendered at */
+    double getSampleRate() const noexcept           { return reader->sampleRate; }
+
+    /** Returns the transport position the render started from */
+    int64 getStartFrame() const noexcept            { return startFrame; }
+
+    /** Reads a block starting at the given position, wrapping around at the
+        end. Channels beyond the rendered ones are cleared. Realtime safe
+        once the pages are resident */
+    void read (AudioSampleBuffer& buffer, int numChannels, int64 position, int numSamples) const noexcept;
+
+private:
+    FrozenAudio (const File&, MemoryMappedAudioFormatReader*, int64);
+    const File file;
+    std::unique_ptr<MemoryMappedAudioFormatReader> reader;
+    const int64 startFrame;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrozenAudio)
+};
+
+}
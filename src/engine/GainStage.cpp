@@ -0,0 +1,161 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/GainStage.h"
+#include "engine/LevelMeter.h"
+
+namespace Element {
+
+void GainStage::getRamp (bool handlesMute, bool muted, bool wasMuted,
+                         float lastGain, float gain,
+                         float& startGain, float& endGain) noexcept
+{
+    if (handlesMute && muted)
+    {
+        // ramp down when just muted, otherwise stay silent
+        startGain = wasMuted ? 0.f : lastGain;
+        endGain = 0.f;
+    }
+    else if (handlesMute && wasMuted)
+    {
+        // just became unmuted
+        startGain = 0.f;
+        endGain = gain;
+    }
+    else
+    {
+        startGain = lastGain;
+        endGain = gain;
+    }
+}
+
+void GainStage::process (float* const* channels, int numChannels, int numSamples,
+                         float startGain, float endGain, LevelMeter* meter) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    if (startGain == endGain)
+    {
+        if (startGain == 1.f)
+        {
+            if (meter != nullptr)
+                for (int ch = jmin (numChannels, meter->getNumChannels()); --ch >= 0;)
+                    meter->measure (ch, channels[ch], numSamples);
+            return;
+        }
+
+        if (startGain == 0.f)
+        {
+            // silence adds nothing to the meter besides elapsed time
+            for (int ch = 0; ch < numChannels; ++ch)
+                FloatVectorOperations::clear (channels[ch], numSamples);
+            return;
+        }
+
+        if (meter == nullptr)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                FloatVectorOperations::multiply (channels[ch], startGain, numSamples);
+            return;
+        }
+    }
+
+    if (meter != nullptr)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            meter->applyGainAndMeasure (ch, channels[ch], numSamples, startGain, endGain);
+        return;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        applyRamp (channels[ch], numSamples, startGain, endGain);
+}
+
+void GainStage::process (double* const* channels, int numChannels, int numSamples,
+                         float startGain, float endGain, LevelMeter* meter) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    if (startGain == endGain && startGain == 0.f)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            FloatVectorOperations::clear (channels[ch], numSamples);
+        return;
+    }
+
+    if (startGain == endGain)
+    {
+        if (startGain != 1.f)
+            for (int ch = 0; ch < numChannels; ++ch)
+                FloatVectorOperations::multiply (channels[ch], (double) startGain, numSamples);
+    }
+    else
+    {
+        const double increment = ((double) endGain - (double) startGain) / (double) numSamples;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            double* const samples = channels[ch];
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] *= (double) startGain + increment * (double) i;
+        }
+    }
+
+    if (meter != nullptr)
+        for (int ch = jmin (numChannels, meter->getNumChannels()); --ch >= 0;)
+            meter->measure (ch, channels[ch], numSamples);
+}
+
+void GainStage::applyRamp (float* samples, int numSamples, float startGain, float endGain) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const float increment = (endGain - startGain) / (float) numSamples;
+    int i = 0;
+
+   #if JUCE_USE_SIMD
+    using Vec = dsp::SIMDRegister<float>;
+    const int vecSize = (int) Vec::size();
+
+    for (; i < numSamples && ! Vec::isSIMDAligned (samples + i); ++i)
+        samples[i] *= startGain + increment * (float) i;
+
+    if (i + vecSize <= numSamples)
+    {
+        alignas (sizeof (Vec)) float lanes [Vec::SIMDNumElements];
+        for (int l = 0; l < vecSize; ++l)
+            lanes[l] = startGain + increment * (float) (i + l);
+
+        auto gains = Vec::fromRawArray (lanes);
+        const auto step = Vec::expand (increment * (float) vecSize);
+        for (; i + vecSize <= numSamples; i += vecSize)
+        {
+            (Vec::fromRawArray (samples + i) * gains).copyToRawArray (samples + i);
+            gains += step;
+        }
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        samples[i] *= startGain + increment * (float) i;
+}
+
+}
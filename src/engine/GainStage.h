@@ -0,0 +1,58 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class LevelMeter;
+
+/** The gain, mute and ramp stage applied before and after a node processes */
+struct GainStage
+{
+    /** Works out the gain ramp of a stage for the current block.
+
+        @param handlesMute  true if this stage is the one that mutes the node
+        @param muted        whether the node is muted now
+        @param wasMuted     whether the node was muted last block
+        @param lastGain     gain at the end of the previous block
+        @param gain         the target gain
+     */
+    static void getRamp (bool handlesMute, bool muted, bool wasMuted,
+                         float lastGain, float gain,
+                         float& startGain, float& endGain) noexcept;
+
+    /** Applies a gain ramp to a set of channels, measuring the result when
+        a meter is given. Unity gain leaves the samples untouched, zero gain
+        clears them and a constant gain is applied without ramping. */
+    static void process (float* const* channels, int numChannels, int numSamples,
+                         float startGain, float endGain, LevelMeter* meter) noexcept;
+
+    /** Double precision version of process(). Levels are measured after the
+        gain has been applied */
+    static void process (double* const* channels, int numChannels, int numSamples,
+                         float startGain, float endGain, LevelMeter* meter) noexcept;
+
+    /** Applies a linear gain ramp to a block of samples */
+    static void applyRamp (float* samples, int numSamples, float startGain, float endGain) noexcept;
+};
+
+}
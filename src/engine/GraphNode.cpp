@@ -29,11 +29,59 @@
 #include "engine/GraphNode.h"
 #include "engine/GraphProcessor.h"
 #include "engine/MidiPipe.h"
+#include "engine/OfflineRenderer.h"
 
 #include "session/Node.h"
 
 namespace Element {
 
+/** Renders a node being frozen. It keeps the node referenced while it runs,
+    and hands the result back to the message thread when it's done */
+class GraphNode::Freezer : public Thread
+{
+public:
+    Freezer (GraphNode& n, const OfflineRenderer::Options& o, int id,
+             std::function<void (const Result&)> callback)
+        : Thread ("Node Freeze"), node (&n), options (o), freezeId (id),
+          onFinished (std::move (callback)) { }
+
+    ~Freezer()
+    {
+        stopThread (-1);
+    }
+
+    void run() override
+    {
+        auto* const proc = node->getAudioProcessor();
+        result = OfflineRenderer (*proc, options).render ([this] (double) {
+            return ! threadShouldExit();
+        });
+
+        if (result.wasOk())
+        {
+            audio = FrozenAudio::open (options.file, options.startFrame);
+            if (audio == nullptr)
+                result = Result::fail ("Could not read " + options.file.getFullPathName());
+        }
+
+        if (threadShouldExit())
+            return;
+
+        GraphNodePtr ref = node;
+        const int id = freezeId;
+        MessageManager::callAsync ([ref, id]() { ref->finishFreeze (id); });
+    }
+
+    GraphNodePtr node;
+    const OfflineRenderer::Options options;
+    const int freezeId;
+    std::function<void (const Result&)> onFinished;
+    Result result { Result::ok() };
+    FrozenAudio::Ptr audio;
+};
+
+//=============================================================================
+
 GraphNode::GraphNode (const uint32 nodeId_) noexcept
     : nodeId (nodeId_),
       metadata (Tags::node),
@@ -56,6 +104,28 @@ GraphNode::~GraphNode()
     parent = nullptr;
 }
 
+const GraphNode::MidiFilterSettings& GraphNode::getMidiFilterSettings() noexcept
+{
+    if ((midiFilterMiddle.load() & midiFilterDirty) != 0)
+        midiFilterFront = midiFilterMiddle.exchange (midiFilterFront) & midiFilterIndexMask;
+    return midiFilterSettings [midiFilterFront];
+}
+
+void GraphNode::publishMidiFilterSettings()
+{
+    ScopedLock sl (propertyLock);
+    auto& settings = midiFilterSettings [midiFilterBack];
+    settings.transposeOffset = transposeOffset.get();
+    settings.keyRange        = getKeyRange();
+    settings.channels        = midiChannels;
+    settings.programsEnabled = areMidiProgramsEnabled();
+    settings.table.compile (settings.keyRange, settings.channels,
+                            settings.transposeOffset, settings.programsEnabled);
+    midiFilterBack = midiFilterMiddle.exchange (midiFilterBack | midiFilterDirty) & midiFilterIndexMask;
+    renderConfigChanged();
+    updateInlining();
+}
+
 void GraphNode::clearParameters()
 {
    #if JUCE_DEBUG
@@ -106,10 +176,21 @@ GraphNode* GraphNode::createForRoot (GraphProcessor* g)
 
 void GraphNode::setInputGain (const float f) {
     inputGain.set(f);
+    renderConfigChanged();
+    updateInlining();
 }
 
 void GraphNode::setGain (const float f) {
     gain.set(f);
+    renderConfigChanged();
+    updateInlining();
+}
+
+void GraphNode::updateInlining()
+{
+    // whether a subgraph can be inlined depends on this node being neutral
+    if (parent != nullptr && parent->isInliningSubGraphs() && isGraph())
+        parent->triggerAsyncUpdate();
 }
 
 void GraphNode::getPluginDescription (PluginDescription& desc) const
@@ -190,6 +271,151 @@ bool GraphNode::isMidiDeviceNode() const
 int GraphNode::getNumAudioInputs()      const { return ports.size (PortType::Audio, true); }
 int GraphNode::getNumAudioOutputs()     const { return ports.size (PortType::Audio, false); }
 
+void GraphNode::scheduleParameterChange (int parameter, float value, double timestamp,
+                                         int smoothing, float smoothingTime)
+{
+    if (! isPositiveAndBelow (parameter, parameters.size()))
+        return;
+
+    {
+        SpinLock::ScopedLockType sl (parameterChangeLock);
+        int start1, size1, start2, size2;
+        parameterChanges.prepareToWrite (1, start1, size1, start2, size2);
+        if (size1 + size2 > 0)
+        {
+            auto& change = parameterChangeData [size1 > 0 ? start1 : start2];
+            change.parameter = parameter;
+            change.value = value;
+            change.timestamp = timestamp;
+            change.smoothing = smoothing;
+            change.smoothingTime = smoothingTime;
+            parameterChanges.finishedWrite (1);
+            return;
+        }
+    }
+
+    // the render program isn't keeping up, don't lose the change
+    if (auto* param = parameters.getObjectPointer (parameter))
+        param->setValueNotifyingHost (value);
+}
+
+int GraphNode::readParameterChanges (ParameterChange* changes, int maxChanges) noexcept
+{
+    int start1, size1, start2, size2;
+    parameterChanges.prepareToRead (maxChanges, start1, size1, start2, size2);
+    for (int i = 0; i < size1; ++i)
+        changes[i] = parameterChangeData [start1 + i];
+    for (int i = 0; i < size2; ++i)
+        changes[size1 + i] = parameterChangeData [start2 + i];
+    parameterChanges.finishedRead (size1 + size2);
+    return size1 + size2;
+}
+
+static std::atomic<int> sMeterRefreshRate { 30 };
+
+void GraphNode::setMeterRefreshRate (int hz)
+{
+    sMeterRefreshRate.store (jlimit (1, 120, hz), std::memory_order_relaxed);
+}
+
+int GraphNode::getMeterRefreshRate()
+{
+    return sMeterRefreshRate.load (std::memory_order_relaxed);
+}
+
+static std::atomic<double> sIdleSuspendTime { 0.0 };
+
+void GraphNode::setIdleSuspendTime (double seconds)
+{
+    sIdleSuspendTime.store (jmax (0.0, seconds), std::memory_order_relaxed);
+}
+
+double GraphNode::getIdleSuspendTime()
+{
+    return sIdleSuspendTime.load (std::memory_order_relaxed);
+}
+
+static std::atomic<bool> sProfilingEnabled { false };
+
+void GraphNode::setProfilingEnabled (bool enabled)
+{
+    sProfilingEnabled.store (enabled, std::memory_order_relaxed);
+}
+
+bool GraphNode::isProfilingEnabled()
+{
+    return sProfilingEnabled.load (std::memory_order_relaxed);
+}
+
+void GraphNode::addProfileSubscriber() noexcept
+{
+    profileSubscribers.fetch_add (1, std::memory_order_relaxed);
+}
+
+void GraphNode::removeProfileSubscriber() noexcept
+{
+    const int previous = profileSubscribers.fetch_sub (1, std::memory_order_relaxed);
+    jassert (previous > 0);
+    ignoreUnused (previous);
+}
+
+bool GraphNode::isProfiling() const noexcept
+{
+    return profileSubscribers.load (std::memory_order_relaxed) > 0
+        || sProfilingEnabled.load (std::memory_order_relaxed);
+}
+
+void GraphNode::addMeterSubscriber() noexcept
+{
+    meterSubscribers.fetch_add (1, std::memory_order_relaxed);
+    renderConfigChanged();
+}
+
+void GraphNode::removeMeterSubscriber() noexcept
+{
+    const int previous = meterSubscribers.fetch_sub (1, std::memory_order_relaxed);
+    renderConfigChanged();
+    jassert (previous > 0);
+    ignoreUnused (previous);
+}
+
+int GraphNode::getMeterWindowSize() const noexcept
+{
+    return jmax (1, roundToInt (meterSampleRate / (double) getMeterRefreshRate()));
+}
+
+void GraphNode::publishInputLevels() noexcept
+{
+    for (int i = jmin (inRMS.size(), inputMeter.getNumChannels()); --i >= 0;)
+    {
+        inRMS.getUnchecked(i)->set (inputMeter.getRMS (i));
+        inPeak.getUnchecked(i)->set (inputMeter.getPeak (i));
+    }
+
+    inputMeter.reset();
+}
+
+void GraphNode::publishOutputLevels() noexcept
+{
+    for (int i = jmin (outRMS.size(), outputMeter.getNumChannels()); --i >= 0;)
+    {
+        outRMS.getUnchecked(i)->set (outputMeter.getRMS (i));
+        outPeak.getUnchecked(i)->set (outputMeter.getPeak (i));
+    }
+
+    outputMeter.reset();
+}
+
+void GraphNode::clearLevels() noexcept
+{
+    for (auto* level : inRMS)   level->set (0.f);
+    for (auto* level : outRMS)  level->set (0.f);
+    for (auto* level : inPeak)  level->set (0.f);
+    for (auto* level : outPeak) level->set (0.f);
+    inputMeter.reset();
+    outputMeter.reset();
+}
+
 void GraphNode::setInputRMS (int chan, float val)
 {
     if (chan < inRMS.size())
@@ -226,7 +452,10 @@ void GraphNode::suspendProcessing (const bool shouldBeSuspended)
     }
 
     if (isSuspended() != wasSuspeneded)
+    {
+        updateInlining();
         bypassChanged (this);
+    }
 }
 
 bool GraphNode::isGraph() const noexcept        { return nullptr != dynamic_cast<GraphProcessor*> (getAudioProcessor()); }
@@ -298,44 +527,81 @@ uint32 GraphNode::getMidiOutputPort() const { return getPortForChannel (PortType
 void GraphNode::prepare (const double sampleRate, const int blockSize,
                          GraphProcessor* const parentGraph,
                          bool willBeEnabled)
+{
+    if (! beginPrepare (blockSize, parentGraph, willBeEnabled))
+        return;
+
+    const int osFactor = getOversamplingFactor();
+    prepareToRender (sampleRate * osFactor, blockSize * osFactor);
+    endPrepare (sampleRate);
+}
+
+bool GraphNode::beginPrepare (const int blockSize, GraphProcessor* const parentGraph,
+                              bool willBeEnabled)
 {
     parent = parentGraph;
-    if ((willBeEnabled || enabled.get() == 1) && !isPrepared)
-    {
-        isPrepared = true;
-        setParentGraph (parentGraph); //<< ensures io nodes get setup
+    if ((! willBeEnabled && enabled.get() != 1) || isPrepared)
+        return false;
 
-        initOversampling (jmax (getNumPorts (PortType::Audio, true), getNumPorts (PortType::Audio, false)), blockSize);
+    isPrepared = true;
+    preparedBlockSize = blockSize;
+    setParentGraph (parentGraph); //<< ensures io nodes get setup
 
-        const int osFactor = getOversamplingFactor();
-        prepareToRender (sampleRate * osFactor, blockSize * osFactor);
+    // nodes follow their graph's precision when they can. oversampling
+    // and MIDI pipes only run in single precision
+    if (auto* proc = getAudioPluginInstance())
+        proc->setProcessingPrecision (parentGraph != nullptr && parentGraph->isUsingDoublePrecision()
+                                        && proc->supportsDoublePrecisionProcessing()
+                                        && osPow == 0 && ! wantsMidiPipe()
+                                            ? AudioProcessor::doublePrecision
+                                            : AudioProcessor::singlePrecision);
 
-        // TODO: move model code out of engine code
-        // VERIFY: this portion is actually needed. This was here to ensure
-        // port information is available before setting up the RMS buffers
-        if (! isAudioIONode() && ! isMidiIONode())
-            resetPorts();
+    initOversampling (jmax (getNumPorts (PortType::Audio, true), getNumPorts (PortType::Audio, false)), blockSize);
 
-        // VERIFY: this is needed.  GraphManager should be setting this
-        if (metadata.getProperty (Tags::bypass, false))
-            suspendProcessing (true);
+    return true;
+}
 
-        inRMS.clearQuick (true);
-        for (int i = 0; i < getNumAudioInputs(); ++i)
-        {
-            AtomicValue<float>* avf = new AtomicValue<float>();
-            avf->set(0);
-            inRMS.add (avf);
-        }
+void GraphNode::endPrepare (const double sampleRate)
+{
+    // TODO: move model code out of engine code
+    // VERIFY: this portion is actually needed. This was here to ensure
+    // port information is available before setting up the RMS buffers
+    if (! isAudioIONode() && ! isMidiIONode())
+        resetPorts();
 
-        outRMS.clearQuick (true);
-        for (int i = 0; i < getNumAudioOutputs(); ++i)
-        {
-            AtomicValue<float>* avf = new AtomicValue<float>();
-            avf->set(0);
-            outRMS.add(avf);
-        }
+    // VERIFY: this is needed.  GraphManager should be setting this
+    if (metadata.getProperty (Tags::bypass, false))
+        suspendProcessing (true);
+
+    inRMS.clearQuick (true);
+    inPeak.clearQuick (true);
+    for (int i = 0; i < getNumAudioInputs(); ++i)
+    {
+        AtomicValue<float>* avf = new AtomicValue<float>();
+        avf->set(0);
+        inRMS.add (avf);
+        avf = new AtomicValue<float>();
+        avf->set(0);
+        inPeak.add (avf);
     }
+
+    outRMS.clearQuick (true);
+    outPeak.clearQuick (true);
+    for (int i = 0; i < getNumAudioOutputs(); ++i)
+    {
+        AtomicValue<float>* avf = new AtomicValue<float>();
+        avf->set(0);
+        outRMS.add(avf);
+        avf = new AtomicValue<float>();
+        avf->set(0);
+        outPeak.add (avf);
+    }
+
+    meterSampleRate = sampleRate;
+    processTimer.prepare (sampleRate);
+    metersActive = false;
+    inputMeter.prepare (getNumAudioInputs());
+    outputMeter.prepare (getNumAudioOutputs());
 }
 
 void GraphNode::unprepare()
@@ -345,6 +611,8 @@ void GraphNode::unprepare()
         isPrepared = false;
         inRMS.clear (true);
         outRMS.clear (true);
+        inPeak.clear (true);
+        outPeak.clear (true);
         resetOversampling();
         releaseResources();
     }
@@ -352,7 +620,8 @@ void GraphNode::unprepare()
 
 void GraphNode::setEnabled (const bool shouldBeEnabled)
 {
-    if (shouldBeEnabled == isEnabled())
+    // frozen nodes stay unloaded until thawed
+    if (shouldBeEnabled == isEnabled() || isFrozen() || isFreezing())
         return;
 
     if (! MessageManager::getInstance()->isThisTheMessageThread())
@@ -366,7 +635,7 @@ void GraphNode::setEnabled (const bool shouldBeEnabled)
     {
         if (parent)
         {
-            prepare (parent->getSampleRate(), parent->getBlockSize(), parent, true);
+            prepare (parent->getRenderSampleRate(), parent->getRenderBlockSize(), parent, true);
             enabled.set (1);
         }
         else
@@ -380,6 +649,8 @@ void GraphNode::setEnabled (const bool shouldBeEnabled)
         unprepare();
     }
 
+    renderConfigChanged();
+    updateInlining();
     enablementChanged (this);
 }
 
@@ -390,6 +661,105 @@ void GraphNode::EnablementUpdater::handleAsyncUpdate()
 
 //=============================================================================
 
+Result GraphNode::freeze (const File& file, const double seconds,
+                          std::function<void (const Result&)> onFinished)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    auto* const proc = getAudioProcessor();
+    if (proc == nullptr || parent == nullptr || isAudioIONode() || isMidiIONode()
+        || isMidiDeviceNode() || getNumAudioOutputs() <= 0)
+        return Result::fail ("This node can't be frozen");
+    if (parent->getRenderSampleRate() <= 0.0 || seconds <= 0.0)
+        return Result::fail ("Nothing to render");
+
+    unfreeze();
+
+    OfflineRenderer::Options options;
+    options.sampleRate      = parent->getRenderSampleRate();
+    options.blockSize       = jmax (32, parent->getRenderBlockSize());
+    options.numChannels     = getNumAudioOutputs();
+    options.lengthInSamples = (int64) (seconds * options.sampleRate);
+    options.file            = file;
+
+    AudioPlayHead::CurrentPositionInfo position;
+    if (auto* const playHead = proc->getPlayHead())
+    {
+        if (playHead->getCurrentPosition (position))
+        {
+            options.startFrame = position.timeInSamples;
+            if (position.bpm > 0.0)
+                options.tempo = position.bpm;
+        }
+    }
+
+    // the graph leaves disabled nodes alone, so it can render offline
+    enabledBeforeFreezing = isEnabled();
+    setEnabled (false);
+
+    freezer.reset (new Freezer (*this, options, ++lastFreezeId, std::move (onFinished)));
+    freezer->startThread();
+    return Result::ok();
+}
+
+void GraphNode::finishFreeze (const int freezeId)
+{
+    // a render that was cancelled may still have posted its result
+    if (freezer == nullptr || freezer->freezeId != freezeId)
+        return;
+
+    GraphNodePtr keepAlive (this);
+    std::unique_ptr<Freezer> done (std::move (freezer));
+    done->stopThread (-1);
+
+    auto result = done->result;
+    if (result.wasOk() && parent == nullptr)
+        result = Result::fail ("The node was removed while freezing");
+
+    if (result.wasOk())
+    {
+        frozen = done->audio;
+        parent->triggerAsyncUpdate();
+    }
+    else
+    {
+        setEnabled (enabledBeforeFreezing);
+    }
+
+    if (done->onFinished)
+        done->onFinished (result);
+}
+
+void GraphNode::unfreeze()
+{
+    if (freezer != nullptr)
+    {
+        GraphNodePtr keepAlive (this);
+        freezer.reset();
+        setEnabled (enabledBeforeFreezing);
+        return;
+    }
+
+    if (frozen == nullptr)
+        return;
+
+    // playback ops keep their own reference until the audio thread is done
+    frozen = nullptr;
+    setEnabled (enabledBeforeFreezing);
+    if (parent != nullptr)
+        parent->triggerAsyncUpdate();
+}
+
+//=============================================================================
+
+void GraphNode::setRenderAhead (const bool shouldRenderAhead)
+{
+    if (renderAhead == shouldRenderAhead)
+        return;
+    renderAhead = shouldRenderAhead;
+    if (parent != nullptr)
+        parent->triggerAsyncUpdate();
+}
+
 void GraphNode::reloadMidiProgram()
 {
     midiProgramLoader.triggerAsyncUpdate();
@@ -701,26 +1071,78 @@ void GraphNode::setParentGraph (GraphProcessor* const graph)
 
 void GraphNode::setMuted (bool muted)
 {
-    bool wasMuted = isMuted();
+    // compared with what listeners last heard, the render thread may be ahead
+    const bool wasMuted = notifiedMute;
     mute.set (muted ? 1 : 0);
-    if (wasMuted != isMuted())
+    renderConfigChanged();
+    notifiedMute = isMuted();
+    if (wasMuted != notifiedMute)
+    {
+        updateInlining();
         muteChanged (this);
+    }
 }
 
 void GraphNode::initOversampling (int numChannels, int blockSize)
 {
     osProcessors.clear();
     numChannels = jmax (1, numChannels); // avoid assertion on nodes that don't have audio
+    osNumChannels = numChannels;
     for (int pow = 1; pow <= maxOsPow; ++pow)
-        osProcessors.add (new dsp::Oversampling<float> (numChannels, pow, dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR));
+        osProcessors.add (createOversampling (numChannels, pow, osMode));
 
     prepareOversampling (blockSize);
+    updateOversamplingLatency();
+}
+
+dsp::Oversampling<float>* GraphNode::createOversampling (int numChannels, int osPow, OversamplingMode mode)
+{
+    using Oversampling = dsp::Oversampling<float>;
+    const bool linearPhase = mode == OversampleLinearPhase || mode == OversampleLinearPhaseLowOrder;
+    const bool lowOrder = mode == OversampleMinimumPhaseLowOrder || mode == OversampleLinearPhaseLowOrder;
+    return new Oversampling ((size_t) jmax (1, numChannels), (size_t) osPow,
+                             linearPhase ? Oversampling::filterHalfBandFIREquiripple
+                                         : Oversampling::filterHalfBandPolyphaseIIR,
+                             ! lowOrder);
+}
+
+String GraphNode::getOversamplingModeName (OversamplingMode mode)
+{
+    switch (mode)
+    {
+        case OversampleMinimumPhase:            return "Minimum phase";
+        case OversampleMinimumPhaseLowOrder:    return "Minimum phase, low latency";
+        case OversampleLinearPhase:             return "Linear phase";
+        case OversampleLinearPhaseLowOrder:     return "Linear phase, low latency";
+        default: break;
+    }
+
+    return {};
 }
 
 void GraphNode::prepareOversampling (int blockSize)
 {
     for (auto* osProcessor : osProcessors)
         osProcessor->initProcessing (blockSize);
+    osChannels.calloc ((size_t) jmax (1, osNumChannels));
+
+    // each stage of a processor buffers its channels at the stage's rate,
+    // so one of 2^n holds 2 + 4 + ... + 2^n blocks
+    int64 numBlocks = 0;
+    for (int pow = 1; pow <= osProcessors.size(); ++pow)
+        numBlocks += (int64) (1 << (pow + 1)) - 2;
+    oversamplingMemoryBytes = numBlocks * osNumChannels * blockSize * (int64) sizeof (float);
+}
+
+GraphNode::MemoryUsage GraphNode::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.renderBytes = renderMemoryBytes.load (std::memory_order_relaxed);
+    usage.midiBytes = midiMemoryBytes.load (std::memory_order_relaxed);
+    usage.oversamplingBytes = oversamplingMemoryBytes;
+    usage.contentBytes = getContentMemoryBytes();
+    usage.pluginBytes = pluginMemoryBytes;
+    return usage;
 }
 
 void GraphNode::resetOversampling()
@@ -731,19 +1153,62 @@ void GraphNode::resetOversampling()
 
 dsp::Oversampling<float>* GraphNode::getOversamplingProcessor()
 {
-    return osProcessors[osPow-1];
+    return osProcessors[getOversamplingPow() - 1];
+}
+
+float* const* GraphNode::getOversamplingChannels (const dsp::AudioBlock<float>& block) noexcept
+{
+    const int numChannels = jmin (osNumChannels, (int) block.getNumChannels());
+    for (int ch = 0; ch < numChannels; ++ch)
+        osChannels[ch] = block.getChannelPointer ((size_t) ch);
+    return osChannels.getData();
+}
+
+void GraphNode::updateOversamplingLatency()
+{
+    auto* osProc = getOversamplingPow() > 0 ? getOversamplingProcessor() : nullptr;
+    osLatency = osProc != nullptr ? osProc->getLatencyInSamples() : 0.0f;
 }
 
 void GraphNode::setOversamplingFactor (int osFactor)
 {
-    osPow = (int) log2f ((float) osFactor);
-    if (auto* osProc = getOversamplingProcessor())
-        osLatency = osProc->getLatencyInSamples();
+    osPow = jlimit (0, maxOsPow, (int) log2f ((float) osFactor));
+    renderConfigChanged();
+    updateOversamplingLatency();
+    updateInlining();
+}
+
+void GraphNode::setOversamplingReduction (int halvings)
+{
+    osReduction = jlimit (0, maxOsPow, halvings);
+    renderConfigChanged();
+    updateOversamplingLatency();
+    updateInlining();
+}
+
+void GraphNode::setOversamplingMode (OversamplingMode mode)
+{
+    if (mode < 0 || mode >= NumOversamplingModes || mode == osMode)
+        return;
+
+    osMode = mode;
+    renderConfigChanged();
+
+    // the filters are rebuilt when the node is prepared, which is when a
+    // running node picks this up. otherwise do it now so the latency is
+    // known before the graph builds its render sequence
+    if (! isPrepared && osProcessors.size() > 0)
+    {
+        for (int pow = 1; pow <= osProcessors.size(); ++pow)
+            osProcessors.set (pow - 1, createOversampling (osNumChannels, pow, osMode));
+    }
+
+    updateOversamplingLatency();
 }
 
 int GraphNode::getOversamplingFactor()
 {
-    if (osPow > 0)
+    if (getOversamplingPow() > 0)
         if (auto* osProc = getOversamplingProcessor())
             return static_cast<int> (osProc->getOversamplingFactor());
 
@@ -831,6 +1296,7 @@ Parameter::Ptr GraphNode::getOrCreateParameter (const PortDescription& port)
     if (param != nullptr)
     {
         param->parameterIndex = port.channel;
+        param->setChanges (*changedParameters);
     }
 
     jassert(param != nullptr);
@@ -20,7 +20,11 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/FrozenAudio.h"
+#include "engine/LevelMeter.h"
+#include "engine/MidiFilterTable.h"
 #include "engine/Parameter.h"
+#include "engine/ProcessTimer.h"
 
 namespace Element {
 
@@ -29,6 +33,7 @@ namespace GraphRender {
 class ProcessBufferOp;
 }
 
+class AnticipativeRenderer;
 class GraphProcessor;
 class MidiPipe;
 
@@ -46,6 +51,21 @@ public:
         SpecialParameterEnd     = NoParameter
     };
 
+    /** How a node's oversampling filters trade latency against aliasing.
+        Minimum phase filters are polyphase IIR half-bands with a few samples
+        of latency. Linear phase ones are equiripple FIR half-bands, which
+        keep the phase intact but add latency in the tens of samples. The low
+        order variants have wider transition bands and less stop band
+        rejection: less latency and CPU for more aliasing. */
+    enum OversamplingMode
+    {
+        OversampleMinimumPhase = 0,
+        OversampleMinimumPhaseLowOrder,
+        OversampleLinearPhase,
+        OversampleLinearPhaseLowOrder,
+        NumOversamplingModes
+    };
+
     /** The ID number assigned to this node. This is assigned by the graph
         that owns it, and can't be changed. */
     const uint32 nodeId;
@@ -81,6 +101,29 @@ public:
     virtual bool wantsMidiPipe() const { return false; }
     virtual void render (AudioSampleBuffer&, MidiPipe&) { }
     virtual void renderBypassed (AudioSampleBuffer&, MidiPipe&);
+
+    /** Returns the samples arriving at a CV input, for nodes that render
+        themselves to read straight from their loops. CV ports carry one
+        value per sample and are routed through the same shared buffers as
+        audio, so nothing is converted on the way. Unconnected inputs read
+        zeros. Only valid inside render(), and nullptr when the graph renders
+        in double precision */
+    const float* getCVInput (int index) const noexcept
+    {
+        return isPositiveAndBelow (index, numCVChannels) ? cvChannels[index] : nullptr;
+    }
+
+    /** Returns where a CV output is written. Like audio, an output shares
+        its buffer with the input of the same index, so read that input
+        before writing. Only valid inside render() */
+    float* getCVOutput (int index) const noexcept
+    {
+        return isPositiveAndBelow (index, numCVChannels) ? cvChannels[index] : nullptr;
+    }
+
+    /** Override to report memory the node holds beyond its render buffers,
+        see getMemoryUsage */
+    virtual int64 getContentMemoryBytes() const { return 0; }
     
     /** Returns the total number of audio inputs */
     int getNumAudioInputs() const;
@@ -91,6 +134,36 @@ public:
     //=========================================================================
     const ParameterArray& getParameters() const    { return parameters; }
 
+    /** A parameter change waiting for the render program */
+    struct ParameterChange
+    {
+        int parameter       = 0;
+        float value         = 0.f;
+        double timestamp    = 0.0;
+        int smoothing       = 0;        ///< a ParameterRamps::Shape
+        float smoothingTime = 0.f;      ///< seconds to glide to the value
+    };
+
+    /** Maximum number of parameter changes queued between two blocks */
+    enum { maxParameterChanges = 256 };
+
+    /** Queues a change to one of this node's parameters. The node's next
+        block is split so the change lands on the sample matching its
+        timestamp, given in seconds on the Time::getMillisecondCounterHiRes()
+        clock like incoming MIDI. Changes are heard one block after they
+        happened, those without a timestamp at the start of the block.
+
+        The parameter can glide to its value instead of jumping, given one of
+        ParameterRamps::Shape and a time in seconds.
+
+        Safe to call from any thread. When the queue is full the change is
+        applied straight away */
+    void scheduleParameterChange (int parameter, float value, double timestamp = 0.0,
+                                  int smoothing = 0, float smoothingTime = 0.f);
+
+    /** Returns true if parameter changes are waiting to be rendered */
+    bool hasPendingParameterChanges() const noexcept { return parameterChanges.getNumReady() > 0; }
+
     //=========================================================================
     /** Returns the type of port
         
@@ -204,6 +277,148 @@ public:
     void setOutputRMS (int chan, float val);
     float getOutputRMS (int chan) const { return (chan < outRMS.size()) ? outRMS.getUnchecked(chan)->get() : 0.0f; }
 
+    /** Returns the latest input peak level of a channel */
+    float getInputPeak (int chan) const { return (chan < inPeak.size()) ? inPeak.getUnchecked(chan)->get() : 0.0f; }
+    /** Returns the latest output peak level of a channel */
+    float getOutputPeak (int chan) const { return (chan < outPeak.size()) ? outPeak.getUnchecked(chan)->get() : 0.0f; }
+
+    //=========================================================================
+    /** Registers interest in this node's level meters. Peak and RMS levels
+        are only measured while at least one subscriber is registered, every
+        call must be balanced with removeMeterSubscriber() */
+    void addMeterSubscriber() noexcept;
+
+    /** Unregisters a meter subscriber */
+    void removeMeterSubscriber() noexcept;
+
+    /** Returns true if anything is displaying this node's levels */
+    bool isMeterSubscribed() const noexcept { return meterSubscribers.load (std::memory_order_relaxed) > 0; }
+
+    /** Returns a count which moves on whenever a setting changes that decides
+        how the node is rendered: enablement, mute, gains, shedding, oversampling,
+        metering and MIDI filters. Render ops compare it to notice changes */
+    uint32 getRenderConfig() const noexcept { return renderConfig.load (std::memory_order_acquire); }
+
+    /** Sets how many times per second meters publish new readings. This
+        applies to every node */
+    static void setMeterRefreshRate (int hz);
+
+    /** Returns the number of meter readings published per second */
+    static int getMeterRefreshRate();
+
+    /** Sets how long instruments may go without MIDI or audio input before
+        they stop being processed. They're only put to sleep once their output
+        has decayed and wake up in the block input arrives. Zero disables it */
+    static void setIdleSuspendTime (double seconds);
+
+    /** Returns the idle time before instruments are suspended, in seconds */
+    static double getIdleSuspendTime();
+
+    //=========================================================================
+    /** Registers interest in how long this node takes to render. Blocks are
+        only timed while profiling is enabled globally or at least one
+        subscriber is registered, calls must be balanced with
+        removeProfileSubscriber() */
+    void addProfileSubscriber() noexcept;
+
+    /** Unregisters a profile subscriber */
+    void removeProfileSubscriber() noexcept;
+
+    /** Returns true if this node's render time is being measured */
+    bool isProfiling() const noexcept;
+
+    /** Returns the latest render times of this node */
+    ProcessTimer::Reading getProcessTime() const noexcept { return processTimer.getReading(); }
+
+    /** Clears the measured render times, including the maximum */
+    void resetProcessTime() noexcept { processTimer.reset(); }
+
+    /** Enables render time measurement of every node */
+    static void setProfilingEnabled (bool enabled);
+
+    /** Returns true if every node's render time is being measured */
+    static bool isProfilingEnabled();
+
+    //=========================================================================
+    /** How readily load is taken off a node when the engine can't keep up,
+        see OverloadGovernor */
+    enum LoadPriority
+    {
+        EssentialPriority = 0,  ///< never touched
+        NormalPriority,         ///< may have its oversampling lowered
+        LowPriority,            ///< may have its oversampling lowered, then be bypassed
+        NumLoadPriorities
+    };
+
+    void setLoadPriority (LoadPriority priority) noexcept   { loadPriority.set ((int) priority); }
+    LoadPriority getLoadPriority() const noexcept           { return (LoadPriority) loadPriority.get(); }
+
+    /** Bypasses the node to take load off the engine. The render fades
+        between its output and its inputs over a block either way. Unlike
+        suspendProcessing this isn't saved or signalled. Safe from any thread */
+    void setShed (bool shed) noexcept                       { shedding.set (shed ? 1 : 0); renderConfigChanged(); }
+    bool isShed() const noexcept                            { return shedding.get() == 1; }
+
+    //=========================================================================
+    /** Memory a node holds, as far as it can be told */
+    struct MemoryUsage
+    {
+        int64 renderBytes       = 0;    ///< scratch buffers of the node's render op
+        int64 midiBytes         = 0;    ///< MIDI buffers reserved for its render op
+        int64 oversamplingBytes = 0;    ///< oversampling filter buffers
+        int64 contentBytes      = 0;    ///< what the node reports, e.g. script heaps and decoded files
+        int64 pluginBytes       = 0;    ///< heap growth measured while its plugin was created
+
+        int64 getTotal() const noexcept
+        {
+            return renderBytes + midiBytes + oversamplingBytes + contentBytes + pluginBytes;
+        }
+    };
+
+    /** Returns the memory this node holds. Content is asked for, so call
+        this from the message thread */
+    MemoryUsage getMemoryUsage() const;
+
+    /** Records the heap growth measured around creating the node's plugin */
+    void setPluginMemoryBytes (int64 bytes) noexcept        { pluginMemoryBytes = bytes; }
+
+    //=========================================================================
+    /** Renders this node to a file and plays the file back in its place. The
+        node stays disabled while frozen, so its processor releases its
+        resources and isn't run. Rendering starts at the transport position
+        with silent inputs and no MIDI, which suits generators and racks
+        that make sound on their own.
+
+        The render runs on a thread of its own, with the node disabled
+        meanwhile. It becomes frozen once the render has finished, then the
+        callback is given the outcome. A failure returned here means nothing
+        was started. Call from the message thread */
+    Result freeze (const File& file, double seconds,
+                   std::function<void (const Result&)> onFinished = nullptr);
+
+    /** Goes back to rendering with the processor, cancelling a freeze that's
+        still rendering */
+    void unfreeze();
+
+    /** Returns true if a render is being played in place of the processor */
+    bool isFrozen() const noexcept { return frozen != nullptr; }
+
+    /** Returns true while a freeze is rendering */
+    bool isFreezing() const noexcept { return freezer != nullptr; }
+
+    /** Returns the render being played, if frozen */
+    FrozenAudio::Ptr getFrozenAudio() const noexcept { return frozen; }
+
+    /** Lets the node render on background workers ahead of the audio thread,
+        which then only plays back what they made. Only nodes with nothing
+        connected to their inputs or MIDI outputs are rendered this way, the
+        rest render as usual. Parameter changes are heard a few blocks late.
+        Call from the message thread */
+    void setRenderAhead (bool shouldRenderAhead);
+
+    /** Returns true if the node was asked to render ahead */
+    bool isRenderingAhead() const noexcept { return renderAhead; }
+
     //=========================================================================
     /** Connect this node's output audio to another node's input audio */
     void connectAudioTo (const GraphNode* other);
@@ -222,6 +437,7 @@ public:
         jassert (isPositiveAndBelow (low, 128));
         jassert (isPositiveAndBelow (high, 128));
         keyRangeLow.set (low); keyRangeHigh.set (high);
+        publishMidiFilterSettings();
     }
 
     inline void setKeyRange (const Range<int>& range) { setKeyRange (range.getStart(), range.getEnd()); }
@@ -233,12 +449,29 @@ public:
     {
         jassert (value >= -24 && value <= 24);
         transposeOffset.set (value);
+        publishMidiFilterSettings();
     }
 
     inline int getTransposeOffset() const { return transposeOffset.get(); }
 
     const CriticalSection& getPropertyLock() const { return propertyLock; }
 
+    //=========================================================================
+    /** A consistent copy of the settings used by the MIDI filter stage */
+    struct MidiFilterSettings
+    {
+        int transposeOffset = 0;
+        Range<int> keyRange { 0, 127 };
+        MidiChannels channels;
+        bool programsEnabled = false;
+        MidiFilterTable table;  ///< all of the above, compiled
+    };
+
+    /** Returns the most recently published MIDI filter settings.  This never
+        locks or allocates, but must only be called by the thread currently
+        rendering this node. */
+    const MidiFilterSettings& getMidiFilterSettings() noexcept;
+
     //=========================================================================
     /** Returns the file used for the current global MIDI Program */
     File getMidiProgramFile (int program = -1) const;
@@ -254,7 +487,11 @@ public:
     inline bool areMidiProgramsEnabled() const         { return midiProgramsEnabled.get() == 1; }
 
     /** Enable or disable changing midi programs */
-    inline void setMidiProgramsEnabled (bool enabled)  { midiProgramsEnabled.set (enabled ? 1 : 0); }
+    inline void setMidiProgramsEnabled (bool enabled)
+    {
+        midiProgramsEnabled.set (enabled ? 1 : 0);
+        publishMidiFilterSettings();
+    }
 
     /** Returns the active midi program */
     inline int getMidiProgram() const                  { return midiProgram.get(); }
@@ -290,8 +527,12 @@ public:
     //=========================================================================
     inline void setMidiChannels (const BigInteger& ch)
     {
-        ScopedLock sl (propertyLock);
-        midiChannels.setChannels (ch);
+        {
+            ScopedLock sl (propertyLock);
+            midiChannels.setChannels (ch);
+        }
+
+        publishMidiFilterSettings();
     }
 
     inline const MidiChannels& getMidiChannels() const { return midiChannels; }
@@ -327,17 +568,53 @@ public:
     //=========================================================================
     void setMuted (bool muted);
     bool isMuted() const        { return mute.get() == 1; }
-    void setMuteInput (bool shouldMuteInput) { muteInput.set (shouldMuteInput ? 1 : 0); }
+
+    /** Changes the mute the render program reads without notifying anyone,
+        so it is heard on the next block. Safe to call from any thread, call
+        setMuted() on the message thread afterwards to let listeners know */
+    void setMutedFromAnyThread (bool muted) noexcept { mute.set (muted ? 1 : 0); renderConfigChanged(); }
+    void setMuteInput (bool shouldMuteInput) { muteInput.set (shouldMuteInput ? 1 : 0); renderConfigChanged(); }
     bool isMutingInputs() const { return muteInput.get() == 1; }
 
     //=========================================================================
     virtual void getState (MemoryBlock&) = 0;
     virtual void setState (const void*, int sizeInBytes) = 0;
 
+    /** Marks the state as changed since it was last saved. Safe to call from
+        any thread, e.g. when a parameter moves or the plugin reports an edit */
+    void markStateChanged() noexcept { stateChanged.set (1); }
+
+    /** Returns true if the state may differ from what was last saved */
+    bool hasStateChanged() const noexcept { return stateChanged.get() == 1; }
+
     //=========================================================================
     void setOversamplingFactor (int osFactor);
     int getOversamplingFactor();
 
+    /** Returns the factor set with setOversamplingFactor, before any
+        reduction. This is the one that gets saved */
+    int getRequestedOversamplingFactor() const noexcept { return 1 << osPow; }
+
+    /** Renders at a factor halved this many times below the requested one,
+        to take load off the engine. Like the factor, set it while the node is
+        released */
+    void setOversamplingReduction (int halvings);
+    int getOversamplingReduction() const noexcept { return osReduction; }
+
+    /** Returns the latency added by the oversampling filters */
+    int getOversamplingLatencySamples() const { return roundFloatToInt (osLatency); }
+
+    /** Changes the oversampling filters. Like the factor, this should be
+        set while the graph is released, the node's latency changes with it */
+    void setOversamplingMode (OversamplingMode mode);
+    OversamplingMode getOversamplingMode() const noexcept { return osMode; }
+
+    /** Returns a name for an oversampling mode, for menus */
+    static String getOversamplingModeName (OversamplingMode mode);
+
+    /** Creates the oversampling processor a mode uses at a power of two */
+    static dsp::Oversampling<float>* createOversampling (int numChannels, int osPow, OversamplingMode mode);
+
     //=========================================================================
     /** Triggered when the enabled state changes */
     Signal<void(GraphNode*)> enablementChanged;
@@ -392,24 +669,70 @@ protected:
 private:
     friend class GraphProcessor;
     friend class GraphRender::ProcessBufferOp;
+    friend class AnticipativeRenderer;
     friend class GraphManager;
     friend class EngineController;
     friend class Node;
     
     GraphProcessor* parent = nullptr;
     bool isPrepared = false;
+    int preparedBlockSize = 0;
+    Atomic<int> stateChanged { 1 };
+    int64 savedStateHash = 0;
+    int64 savedProgramStateHash = 0;
     Atomic<int> enabled { 1 };
     Atomic<int> bypassed { 0 };
     Atomic<int> mute { 0 };
+    bool notifiedMute = false;
     Atomic<int> muteInput { 0 };
+    Atomic<int> loadPriority { (int) NormalPriority };
+    Atomic<int> shedding { 0 };
+
+    // memory accounting, render figures are set by the graph as it builds
+    std::atomic<int64> renderMemoryBytes { 0 }, midiMemoryBytes { 0 };
+    float* const* cvChannels = nullptr;
+    int numCVChannels = 0;
+    int64 oversamplingMemoryBytes = 0;
+    int64 pluginMemoryBytes = 0;
 
     int latencySamples = 0;
     String name;
 
     ParameterArray parameters;
+    // which parameters were set since the dispatcher last looked
+    ParameterChanges::Ptr changedParameters { new ParameterChanges() };
+
+    // parameter changes, written by any thread and read by the render thread
+    AbstractFifo parameterChanges { maxParameterChanges };
+    ParameterChange parameterChangeData [maxParameterChanges];
+    SpinLock parameterChangeLock;
+    int readParameterChanges (ParameterChange* changes, int maxChanges) noexcept;
 
     Atomic<float> gain, lastGain, inputGain, lastInputGain;
-    OwnedArray<AtomicValue<float> > inRMS, outRMS;
+    OwnedArray<AtomicValue<float> > inRMS, outRMS, inPeak, outPeak;
+
+    // level meters, measured on the render thread while subscribed
+    std::atomic<int> meterSubscribers { 0 };
+    LevelMeter inputMeter, outputMeter;
+    double meterSampleRate = 44100.0;
+    bool metersActive = false;
+    int getMeterWindowSize() const noexcept;
+    void publishInputLevels() noexcept;
+    void publishOutputLevels() noexcept;
+    void clearLevels() noexcept;
+
+    // render time, measured while profiled
+    std::atomic<int> profileSubscribers { 0 };
+    ProcessTimer processTimer;
+
+    // only read when building rendering sequences
+    FrozenAudio::Ptr frozen;
+    bool enabledBeforeFreezing = true;
+    class Freezer;
+    std::unique_ptr<Freezer> freezer;
+    int lastFreezeId = 0;
+    void finishFreeze (int freezeId);
+    bool renderAhead = false;
     
     Atomic<int> keyRangeLow { 0 };
     Atomic<int> keyRangeHigh { 127 };
@@ -422,6 +745,18 @@ private:
     Atomic<int> globalMidiPrograms { 0 };
 
     CriticalSection propertyLock;
+
+    // triple buffered MIDI filter settings: the render thread reads 'front',
+    // writers fill 'back' and the two swap through the shared middle slot
+    enum { midiFilterIndexMask = 3, midiFilterDirty = 4 };
+    MidiFilterSettings midiFilterSettings [3];
+    std::atomic<int> midiFilterMiddle { 1 };
+    int midiFilterFront = 0;
+    int midiFilterBack = 2;
+    void publishMidiFilterSettings();
+    void updateInlining();
+    std::atomic<uint32> renderConfig { 0 };
+    void renderConfigChanged() noexcept { renderConfig.fetch_add (1, std::memory_order_acq_rel); }
     struct EnablementUpdater : public AsyncUpdater
     {
         EnablementUpdater (GraphNode& g) : graph (g) { }
@@ -458,18 +793,30 @@ private:
 
     void setParentGraph (GraphProcessor*);
     void prepare (double sampleRate, int blockSize, GraphProcessor*, bool willBeEnabled = false);
+    /** prepare() in steps: the model side around prepareToRender(), which
+        may run on another thread in between. Returns false if the node
+        wasn't due to be prepared */
+    bool beginPrepare (int blockSize, GraphProcessor*, bool willBeEnabled);
+    void endPrepare (double sampleRate);
     void unprepare();
     void resetPorts();
     void initOversampling (int numChannels, int blockSize);
     void prepareOversampling (int blockSize);
     void resetOversampling();
+    void updateOversamplingLatency();
     dsp::Oversampling<float>* getOversamplingProcessor();
+    float* const* getOversamplingChannels (const dsp::AudioBlock<float>&) noexcept;
 
     Parameter::Ptr getOrCreateParameter (const PortDescription&);
 
     int osPow = 0;
+    int osReduction = 0;
+    int getOversamplingPow() const noexcept { return jmax (0, osPow - osReduction); }
     float osLatency = 0.0f;
+    OversamplingMode osMode = OversampleMinimumPhase;
     OwnedArray<dsp::Oversampling<float>> osProcessors;
+    HeapBlock<float*> osChannels;
+    int osNumChannels = 0;
     const int maxOsPow = 3;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphNode)
@@ -17,11 +17,23 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include <unordered_map>
 #include "engine/nodes/AudioProcessorNode.h"
+#include "engine/nodes/AuxBusNodes.h"
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/AnticipativeRenderer.h"
 #include "engine/AudioEngine.h"
+#include "engine/DelayLine.h"
+#include "engine/GainStage.h"
 #include "engine/GraphProcessor.h"
+#include "engine/MidiBudget.h"
 #include "engine/MidiPipe.h"
-#include "engine/MidiTranspose.h"
+#include "engine/ParameterRamps.h"
+#include "engine/ProcessTimer.h"
+#include "engine/RenderInstruction.h"
+#include "engine/RenderThreadPool.h"
+#include "engine/SampleConversion.h"
+#include "engine/TimelineTrace.h"
 #include "engine/nodes/SubGraphProcessor.h"
 #include "session/Node.h"
 
@@ -32,7 +44,12 @@ const int GraphProcessor::midiChannelIndex = 0x1000;
 namespace GraphRender
 {
 
-class Task
+/** Length of the shared buffers, the most samples rendered in one go */
+static const int renderBufferSize = 4096;
+
+/** A step of a rendering sequence. Stateful tasks can be shared by several
+    programs, each one holding a reference while it lists the task */
+class Task : public ReferenceCountedObject
 {
 public:
     Task() { }
@@ -42,9 +59,115 @@ public:
                           const OwnedArray <MidiBuffer>& sharedMidiBuffers,
                           const int numSamples) = 0;
 
+    /** Renders like perform() while keeping the silence flag of each shared
+        audio buffer up to date. Only tasks which compile to performTask are
+        called this way, so the default simply renders. */
+    virtual void performWithSilence (AudioSampleBuffer& sharedBufferChans,
+                                     const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                                     const int numSamples, uint8* silentBuffers)
+    {
+        ignoreUnused (silentBuffers);
+        perform (sharedBufferChans, sharedMidiBuffers, numSamples);
+    }
+
+    /** Double precision counterpart of performWithSilence(), called when the
+        graph renders with 64-bit shared buffers */
+    virtual void performDouble (AudioBuffer<double>& sharedBufferChans,
+                                const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                                const int numSamples, uint8* silentBuffers)
+    {
+        // tasks compiled to performTask need to handle double precision
+        ignoreUnused (sharedBufferChans, sharedMidiBuffers, numSamples, silentBuffers);
+        jassertfalse;
+    }
+
+    /** Adds the shared audio and midi buffer indexes this task reads or writes */
+    virtual void getBuffersUsed (Array<int>& audio, Array<int>& midi) const = 0;
+
+    /** Returns true if this task touches the graph's own IO buffers or devices */
+    virtual bool touchesGraphIO() const { return false; }
+
+    /** What a task touching the graph's IO does with it, which decides
+        where a pipeline can be cut */
+    enum class GraphIO { none, input, output, other };
+
+    virtual GraphIO getGraphIO() const { return touchesGraphIO() ? GraphIO::other : GraphIO::none; }
+
+    /** Returns true if this task picks up state the task before it left, so
+        the two have to render on the same thread */
+    virtual bool continuesPrevious() const { return false; }
+
+    /** Returns how much of a block's work this task is, where processing a
+        node counts as one and buffer ops count as nothing */
+    virtual int getRenderCost() const { return 0; }
+
+    /** Fills in the compiled form of this task. Tasks without state override
+        this to inline their operands, everything else is called through. */
+    virtual void compile (Instruction& instruction)
+    {
+        instruction.opcode = Instruction::performTask;
+        instruction.task   = this;
+    }
+
+    /** Adds what this does to its entry in the render inspector. Only tasks
+        compiled to performTask are asked, inlined ones are described from
+        their instruction */
+    virtual void describe (DynamicObject& info) const
+    {
+        info.setProperty ("op", "task");
+    }
+
+    /** Called on the message thread when the program this task is in is
+        replaced by one without it, or published again. Tasks with work going
+        on away from the audio thread stop it while retired */
+    virtual void setRetired (bool retired)
+    {
+        ignoreUnused (retired);
+    }
+
+    /** What a rebuild looks a task up by when carrying it into the next
+        sequence. Tasks that aren't carried over return noReuse */
+    enum ReuseKind { noReuse = 0, processReuse, anticipatedReuse, delayReuse };
+
+    static int64 makeReuseKey (const ReuseKind kind, const uint32 id) noexcept
+    {
+        return (int64) (((uint64) kind << 32) | (uint64) id);
+    }
+
+    virtual int64 getReuseKey() const { return makeReuseKey (noReuse, 0); }
+
     JUCE_LEAK_DETECTOR (Task);
 };
 
+/** Adds a node's id, name, latency and, while it's profiled, timings */
+static void describeNode (DynamicObject& info, GraphNode& node)
+{
+    info.setProperty ("node", (int) node.nodeId);
+    info.setProperty ("name", node.getName());
+    info.setProperty ("latency", node.getLatencySamples());
+    if (node.getOversamplingFactor() > 1)
+        info.setProperty ("oversampling", node.getOversamplingFactor());
+
+    if (node.isProfiling())
+    {
+        const auto time = node.getProcessTime();
+        DynamicObject::Ptr timing (new DynamicObject());
+        timing->setProperty ("last", time.lastMs);
+        timing->setProperty ("average", time.averageMs);
+        timing->setProperty ("maximum", time.maximumMs);
+        timing->setProperty ("load", time.load);
+        info.setProperty ("timing", var (timing.get()));
+    }
+}
+
+static var toVar (const Array<int>& values)
+{
+    Array<var> items;
+    for (const auto value : values)
+        items.add (value);
+    return items;
+}
+
 class ClearChannelOp : public Task
 {
 public:
@@ -57,6 +180,17 @@ public:
         sharedBufferChans.clear (channelNum, 0, numSamples);
     }
 
+    void getBuffersUsed (Array<int>& audio, Array<int>&) const override
+    {
+        audio.add (channelNum);
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::clearAudio;
+        instruction.dest   = channelNum;
+    }
+
 private:
     const int channelNum;
 
@@ -77,6 +211,19 @@ public:
         sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    void getBuffersUsed (Array<int>& audio, Array<int>&) const override
+    {
+        audio.add (srcChannelNum);
+        audio.add (dstChannelNum);
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::copyAudio;
+        instruction.source = srcChannelNum;
+        instruction.dest   = dstChannelNum;
+    }
+
 private:
     const int srcChannelNum, dstChannelNum;
 
@@ -97,6 +244,19 @@ public:
         sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    void getBuffersUsed (Array<int>& audio, Array<int>&) const override
+    {
+        audio.add (srcChannelNum);
+        audio.add (dstChannelNum);
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::addAudio;
+        instruction.source = srcChannelNum;
+        instruction.dest   = dstChannelNum;
+    }
+
 private:
     const int srcChannelNum, dstChannelNum;
 
@@ -116,6 +276,17 @@ public:
         sharedMidiBuffers.getUnchecked (bufferNum)->clear();
     }
 
+    void getBuffersUsed (Array<int>&, Array<int>& midi) const override
+    {
+        midi.add (bufferNum);
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::clearMidi;
+        instruction.dest   = bufferNum;
+    }
+
 private:
     const int bufferNum;
 
@@ -133,7 +304,21 @@ public:
 
     void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
     {
-        *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
+        MidiBudget::copyEvents (*sharedMidiBuffers.getUnchecked (dstBufferNum),
+                                *sharedMidiBuffers.getUnchecked (srcBufferNum));
+    }
+
+    void getBuffersUsed (Array<int>&, Array<int>& midi) const override
+    {
+        midi.add (srcBufferNum);
+        midi.add (dstBufferNum);
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::copyMidi;
+        instruction.source = srcBufferNum;
+        instruction.dest   = dstBufferNum;
     }
 
 private:
@@ -153,8 +338,21 @@ public:
 
     void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
-        sharedMidiBuffers.getUnchecked (dstBufferNum)
-            ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
+        MidiBudget::addEvents (*sharedMidiBuffers.getUnchecked (dstBufferNum),
+                               *sharedMidiBuffers.getUnchecked (srcBufferNum), numSamples);
+    }
+
+    void getBuffersUsed (Array<int>&, Array<int>& midi) const override
+    {
+        midi.add (srcBufferNum);
+        midi.add (dstBufferNum);
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::addMidi;
+        instruction.source = srcBufferNum;
+        instruction.dest   = dstBufferNum;
     }
 
 private:
@@ -163,37 +361,168 @@ private:
     JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
 };
 
-class DelayChannelOp : public Task
+/** Merges every MIDI buffer feeding one input into a buffer of its own, in
+    a single pass over them rather than adding each to the next */
+class MergeMidiBuffersOp : public Task
 {
 public:
-    DelayChannelOp (const int channel_, const int numSamplesDelay_)
-        : channel (channel_),
-          bufferSize (numSamplesDelay_ + 1),
-          readIndex (0), writeIndex (numSamplesDelay_)
+    MergeMidiBuffersOp (const Array<int>& srcBufferNums_, const int dstBufferNum_)
+        : srcBufferNums (srcBufferNums_),
+          dstBufferNum (dstBufferNum_),
+          merger (srcBufferNums_.size())
     {
-        buffer.calloc ((size_t) bufferSize);
+        sources.calloc ((size_t) jmax (1, srcBufferNums.size()));
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        for (int i = 0; i < srcBufferNums.size(); ++i)
+            sources[i] = sharedMidiBuffers.getUnchecked (srcBufferNums.getUnchecked (i));
+        merger.merge (*sharedMidiBuffers.getUnchecked (dstBufferNum), sources,
+                      srcBufferNums.size(), numSamples);
+    }
+
+    void performDouble (AudioBuffer<double>&, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                        const int numSamples, uint8*) override
     {
-        float* data = sharedBufferChans.getWritePointer (channel, 0);
+        AudioSampleBuffer none;
+        perform (none, sharedMidiBuffers, numSamples);
+    }
 
-        for (int i = numSamples; --i >= 0;)
-        {
-            buffer [writeIndex] = *data;
-            *data++ = buffer [readIndex];
+    void getBuffersUsed (Array<int>&, Array<int>& midi) const override
+    {
+        midi.addArray (srcBufferNums);
+        midi.add (dstBufferNum);
+    }
+
+    void describe (DynamicObject& info) const override
+    {
+        info.setProperty ("op", "mergeMidi");
+        info.setProperty ("sources", toVar (srcBufferNums));
+        info.setProperty ("dest", dstBufferNum);
+    }
+
+private:
+    const Array<int> srcBufferNums;
+    const int dstBufferNum;
+    MidiBudget::Merger merger;
+    HeapBlock<const MidiBuffer*> sources;
+
+    JUCE_DECLARE_NON_COPYABLE (MergeMidiBuffersOp)
+};
+
+/** Delays a set of a node's input channels to compensate latency. The
+    builder groups every delay added for one node into a single op */
+class DelayChannelsOp : public Task
+{
+public:
+    DelayChannelsOp (const Array<int>& channels_, const Array<int>& delays_,
+                     const bool doublePrecision_ = false)
+        : channels (channels_),
+          delays (delays_),
+          doublePrecision (doublePrecision_)
+    {
+        jassert (channels.size() == delays.size());
+        numSilentSamples.calloc ((size_t) jmax (1, channels.size()));
 
-            if (++readIndex  >= bufferSize) readIndex = 0;
-            if (++writeIndex >= bufferSize) writeIndex = 0;
+        for (int i = 0; i < channels.size(); ++i)
+        {
+            if (doublePrecision)
+                doubleLines.add (new DelayLine<double> (delays.getUnchecked (i), renderBufferSize));
+            else
+                lines.add (new DelayLine<float> (delays.getUnchecked (i), renderBufferSize));
         }
     }
 
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    {
+        for (int i = 0; i < lines.size(); ++i)
+            lines.getUnchecked(i)->process (sharedBufferChans.getWritePointer (channels.getUnchecked (i), 0), numSamples);
+    }
+
+    void performWithSilence (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&,
+                             const int numSamples, uint8* silentBuffers) override
+    {
+        for (int i = 0; i < lines.size(); ++i)
+            if (! isDelayingSilence (i, numSamples, silentBuffers))
+                lines.getUnchecked(i)->process (sharedBufferChans.getWritePointer (channels.getUnchecked (i), 0), numSamples);
+    }
+
+    void performDouble (AudioBuffer<double>& sharedBufferChans, const OwnedArray <MidiBuffer>&,
+                        const int numSamples, uint8* silentBuffers) override
+    {
+        for (int i = 0; i < doubleLines.size(); ++i)
+            if (! isDelayingSilence (i, numSamples, silentBuffers))
+                doubleLines.getUnchecked(i)->process (sharedBufferChans.getWritePointer (channels.getUnchecked (i), 0), numSamples);
+    }
+
+    void getBuffersUsed (Array<int>& audio, Array<int>&) const override
+    {
+        audio.addArray (channels);
+    }
+
+    void describe (DynamicObject& info) const override
+    {
+        info.setProperty ("op", "delay");
+        info.setProperty ("delays", toVar (delays));
+    }
+
+    /** Returns the reuse key of a delay op created with these arguments */
+    static int64 getReuseKeyFor (const Array<int>& otherChannels, const Array<int>& otherDelays,
+                                 const bool otherDoublePrecision) noexcept
+    {
+        uint32 hash = otherDoublePrecision ? 1u : 0u;
+        for (int i = 0; i < otherChannels.size(); ++i)
+            hash = (hash * 31u + (uint32) otherChannels.getUnchecked (i)) * 31u
+                 + (uint32) otherDelays.getUnchecked (i);
+        return makeReuseKey (delayReuse, hash);
+    }
+
+    int64 getReuseKey() const override { return getReuseKeyFor (channels, delays, doublePrecision); }
+
+    /** Returns true if this op delays the same channels by the same amounts */
+    bool canBeReusedFor (const Array<int>& otherChannels, const Array<int>& otherDelays,
+                         const bool otherDoublePrecision) const noexcept
+    {
+        return channels == otherChannels && delays == otherDelays
+            && doublePrecision == otherDoublePrecision;
+    }
+
+    void compile (Instruction& instruction) override
+    {
+        instruction.opcode = Instruction::performTask;
+        instruction.dest   = channels.getFirst();
+        instruction.task   = this;
+    }
+
 private:
-    HeapBlock<float> buffer;
-    const int channel, bufferSize;
-    int readIndex, writeIndex;
+    const Array<int> channels, delays;
+    const bool doublePrecision;
+    OwnedArray<DelayLine<float>> lines;
+    OwnedArray<DelayLine<double>> doubleLines;
+    HeapBlock<int> numSilentSamples;
+
+    /** Returns true once a line only holds zeros, silence then passes
+        straight through. Otherwise the channel is flagged audible */
+    bool isDelayingSilence (const int index, const int numSamples, uint8* silentBuffers) noexcept
+    {
+        const int channel = channels.getUnchecked (index);
+        if (silentBuffers [channel] != 0)
+        {
+            if (numSilentSamples [index] >= delays.getUnchecked (index))
+                return true;
+            numSilentSamples [index] += numSamples;
+        }
+        else
+        {
+            numSilentSamples [index] = 0;
+        }
 
-    JUCE_DECLARE_NON_COPYABLE (DelayChannelOp)
+        silentBuffers [channel] = 0;
+        return false;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (DelayChannelsOp)
 };
 
 
@@ -207,14 +536,22 @@ public:
                      const Array <int> chans [PortType::Unknown])
         : node (node_),
           processor (node_->getAudioPluginInstance()),
+          eventProcessor (dynamic_cast<BaseProcessor*> (processor)),
           audioChannelsToUse (audioChannelsToUse_),
           midiChannelsToUse (chans[PortType::Midi]),
+          cvChannelsToUse (chans[PortType::CV]),
           totalChans (jmax (1, totalChans_)),
           numAudioIns (node_->getNumPorts (PortType::Audio, true)),
           numAudioOuts (node_->getNumPorts (PortType::Audio, false)),
           midiBufferToUse (midiBufferToUse_)
     {
         channels.calloc ((size_t) totalChans);
+        cvChannels.calloc ((size_t) jmax (1, cvChannelsToUse.size()));
+        silentOutputs.calloc ((size_t) jmax (1, numAudioOuts));
+        paramChanges.calloc ((size_t) GraphNode::maxParameterChanges);
+        MidiBudget::reserve (tempMidi);
+        MidiBudget::reserve (splitMidiIn);
+        MidiBudget::reserve (splitMidiOut);
 
         while (audioChannelsToUse.size() < totalChans)
             audioChannelsToUse.add (0);
@@ -223,235 +560,1482 @@ public:
             midiBufferToUse = chans[PortType::Midi].getFirst();
 
         lastMute = node->isMuted();
+        graphIO = node->isAudioIONode() || node->isMidiIONode() || node->isMidiDeviceNode();
+        // aux buses are shared like the graph's IO, so those nodes run in turn
+        graphIO |= dynamic_cast<AuxBusNode*> (processor) != nullptr;
+        initSilenceMode();
+        initMidiPipe();
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    void performWithSilence (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                             const int numSamples, uint8* silentBuffers) override
     {
-        for (int i = totalChans; --i >= 0;) {
-            channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        const ProcessTimer::Scope timing (getProcessTimer(), numSamples);
+        const TimelineTrace::Zone zone ("render op", (int64) node->nodeId);
+
+        if (canSkip (sharedMidiBuffers, numSamples, silentBuffers))
+        {
+            renderSilence (sharedBufferChans, numSamples, silentBuffers);
+            return;
         }
 
-        AudioSampleBuffer buffer (channels, totalChans, numSamples);
-        
-        if (! node->isEnabled())
+        perform (sharedBufferChans, sharedMidiBuffers, numSamples);
+        updateSilenceFlags (silentBuffers);
+    }
+
+    void performDouble (AudioBuffer<double>& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                        const int numSamples, uint8* silentBuffers) override
+    {
+        const ProcessTimer::Scope timing (getProcessTimer(), numSamples);
+        const TimelineTrace::Zone zone ("render op", (int64) node->nodeId);
+
+        if (canSkip (sharedMidiBuffers, numSamples, silentBuffers))
         {
-            for (int ch = numAudioIns; ch < numAudioOuts; ++ch)
-                buffer.clear (ch, 0, buffer.getNumSamples());
+            renderSilence (sharedBufferChans, numSamples, silentBuffers);
             return;
         }
 
-        const bool muted = node->isMuted();
-        const bool muteInput = node->isMutingInputs();
+        for (int i = totalChans; --i >= 0;)
+            doubleChannels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        AudioBuffer<double> buffer (doubleChannels, totalChans, numSamples);
 
-        if (muted && muteInput)
+        if (processor != nullptr && processor->isUsingDoublePrecision())
         {
-            if (lastMute != muted)
-            {
-                // just became muted
-                buffer.applyGainRamp (0, numSamples, node->getLastInputGain(), 0.0);
-            }
-            else
-            {
-                // normal mute processing
-                buffer.applyGain (0, numSamples, 0.0);
-            }
+            processDouble (buffer, sharedMidiBuffers, numSamples);
+        }
+        else
+        {
+            // the processor only handles floats, convert at its boundary
+            jassert (numSamples <= floatScratch.getNumSamples());
+            AudioSampleBuffer scratch (floatScratch.getArrayOfWritePointers(), totalChans, numSamples);
+            SampleConversion::convert (buffer, scratch, totalChans, numSamples);
+            process (scratch, sharedMidiBuffers, numSamples);
+            SampleConversion::convert (scratch, buffer, totalChans, numSamples);
         }
-        else if (!muted && muteInput && muted != lastMute)
+
+        updateSilenceFlags (silentBuffers);
+    }
+
+    /** Prepares this op for graphs rendering 64-bit buffers. Not realtime safe */
+    void setDoublePrecision (const bool shouldUseDouble, const int maxBlockSize)
+    {
+        doublePrecision = shouldUseDouble;
+        if (doublePrecision)
         {
-            // just became unmuted
-            buffer.applyGainRamp (0, numSamples, 0.0, node->getInputGain());
+            doubleChannels.calloc ((size_t) totalChans);
+            floatScratch.setSize (totalChans, maxBlockSize);
         }
-        else if (node->getInputGain() != node->getLastInputGain())
+        else
         {
-            buffer.applyGainRamp (0, numSamples, node->getLastInputGain(), node->getInputGain());
-        } 
-        else 
+            doubleChannels.free();
+            floatScratch.setSize (0, 0);
+        }
+    }
+
+    bool isUsingDoublePrecision() const noexcept { return doublePrecision; }
+
+    /** Makes room for the inputs kept while fading in and out of being shed.
+        Not realtime safe */
+    void prepareShedding (const int maxBlockSize)
+    {
+        dryScratch.setSize (jmax (1, numAudioOuts), maxBlockSize);
+    }
+
+    /** Tells the node how much memory its rendering holds here */
+    void publishMemory() const noexcept
+    {
+        const int64 scratchSamples = (int64) floatScratch.getNumChannels() * floatScratch.getNumSamples()
+                                   + (int64) dryScratch.getNumChannels() * dryScratch.getNumSamples();
+        const int64 bytes = scratchSamples * (int64) sizeof (float)
+            + (int64) totalChans * (int64) (doublePrecision ? sizeof (float*) + sizeof (double*) : sizeof (float*))
+            + (int64) GraphNode::maxParameterChanges * (int64) sizeof (GraphNode::ParameterChange);
+        node->renderMemoryBytes.store (bytes, std::memory_order_relaxed);
+        // the filtered, split input and split output buffers
+        node->midiMemoryBytes.store (3 * (int64) MidiBudget::getMaxBytesPerBlock(), std::memory_order_relaxed);
+    }
+
+    void updateSilenceFlags (uint8* silentBuffers) noexcept
+    {
+        for (const auto index : cvChannelsToUse)
+            if (index != 0)
+                silentBuffers [index] = 0;
+
+        if (renderedDisabled)
         {
-            buffer.applyGain (0, numSamples, node->getInputGain());
+            // inputs passed through untouched, remaining outputs were cleared
+            for (int i = numAudioIns; i < numAudioOuts; ++i)
+                silentBuffers [audioChannelsToUse.getUnchecked (i)] = 1;
+            return;
         }
 
-        for (int i = numAudioIns; --i >= 0;)
-            node->setInputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+        // outputs are audible unless they came out as digital silence. other
+        // channels handed to the processor might have been written to.
+        for (int i = 0; i < totalChans; ++i)
+        {
+            const int index = audioChannelsToUse.getUnchecked (i);
+            if (index != 0)
+                silentBuffers [index] = (i < numAudioOuts && ! holdsOversampled
+                                            && silentOutputs[i] != 0) ? 1 : 0;
+        }
+    }
 
-       #ifndef EL_FREE
-        // Begin MIDI filters
-        {
-            jassert (tempMidi.getNumEvents() == 0);
-            ScopedLock spl (node->getPropertyLock());
-            transpose.setNoteOffset (node->getTransposeOffset());
-            const auto keyRange (node->getKeyRange());
-            const auto midiChans (node->getMidiChannels());
-            const auto useMidiProgram (node->areMidiProgramsEnabled());
- 
-            if (keyRange.getLength() > 0 || !midiChans.isOmni() || useMidiProgram)
-            {
-                auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
-                MidiBuffer::Iterator iter (midi);
-                int frame = 0; MidiMessage msg;
-                while (iter.getNextEvent (msg, frame))
-                {
-                    if (msg.isNoteOnOrOff())
-                    {
-                        // out of range 
-                        if (keyRange.getLength() > 0 && (msg.getNoteNumber() < keyRange.getStart() || msg.getNoteNumber() > keyRange.getEnd()))
-                            continue;
-                    }
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        for (int i = totalChans; --i >= 0;) {
+            channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        }
 
-                    if (msg.getChannel() > 0 && midiChans.isOff (msg.getChannel()))
-                        continue;
+        // CV lives in the shared audio channels, the node reads them in place
+        for (int i = cvChannelsToUse.size(); --i >= 0;)
+            cvChannels[i] = sharedBufferChans.getWritePointer (cvChannelsToUse.getUnchecked (i), 0);
+        node->cvChannels = cvChannels;
+        node->numCVChannels = cvChannelsToUse.size();
 
-                    if (useMidiProgram && msg.isProgramChange())
-                    {
-                        node->setMidiProgram (msg.getProgramChangeNumber());
-                        node->reloadMidiProgram();
-                        continue;
-                    }
+        AudioSampleBuffer buffer (channels, totalChans, numSamples);
+        process (buffer, sharedMidiBuffers, numSamples);
 
-                    transpose.process (msg);
-                    tempMidi.addEvent (msg, frame);
-                }
+        node->cvChannels = nullptr;
+        node->numCVChannels = 0;
+    }
 
-                midi.swapWith (tempMidi);
+    /** Runs the node on buffers referring to its shared channels */
+    void process (AudioSampleBuffer& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        if (path == directPath && pathConfig == node->getRenderConfig())
+        {
+            processDirect (buffer, sharedMidiBuffers, numSamples);
+            return;
+        }
+
+        processGeneral (buffer, sharedMidiBuffers, numSamples);
+        selectPath();
+    }
+
+    /** Renders a node which is nothing but its processor at the moment */
+    void processDirect (AudioSampleBuffer& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        holdsOversampled = false;
+        renderedDisabled = false;
+
+        processPlugin (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse),
+                       numSamples, processor->isSuspended());
+
+        for (int i = 0; i < numAudioOuts; ++i)
+            silentOutputs[i] = isDigitalSilence (buffer.getReadPointer (i), numSamples) ? 1 : 0;
+        updateOutputsQuiet (buffer);
+    }
+
+    /** Renders through every stage a node can have, checking each as it goes */
+    void processGeneral (AudioSampleBuffer& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        holdsOversampled = false;
+        renderedDisabled = false;
+
+        // a shed node is bypassed, the blocks it's shed or restored in fade
+        // between its output and its inputs at the graph's rate
+        const bool shed = node->isShed();
+        const bool shedFading = shed != lastShed && numSamples <= dryScratch.getNumSamples();
+        const bool shedBypassed = shed && ! shedFading;
+
+        // continue from the previous node's oversampled output when it was left
+        // up-sampled for us, otherwise bring it back to the shared buffers first
+        dsp::Oversampling<float>* os = nullptr;
+        dsp::AudioBlock<float> osBlock;
+        AudioSampleBuffer osBuffer;
+        AudioSampleBuffer* work = &buffer;
+
+        if (upstream != nullptr && upstream->holdsOversampled)
+        {
+            upstream->holdsOversampled = false;
+            auto* const upstreamOs = upstream->chainOs;
+
+            if (node->isEnabled() && ! node->wantsMidiPipe() && ! shed && ! lastShed
+                && node->getOversamplingFactor() == (int) upstreamOs->getOversamplingFactor())
+            {
+                os = upstreamOs;
+                osBlock = upstream->chainBlock;
+                osBuffer.setDataToReferTo (node->getOversamplingChannels (osBlock),
+                                           totalChans, (int) osBlock.getNumSamples());
+                work = &osBuffer;
             }
             else
             {
-                transpose.process (*sharedMidiBuffers.getUnchecked (midiBufferToUse), numSamples);
+                dsp::AudioBlock<float> block (buffer);
+                upstreamOs->processSamplesDown (block);
             }
         }
-        tempMidi.clear();
-        // End MIDI filters
-       #endif
+        
+        if (! node->isEnabled())
+        {
+            for (int ch = numAudioIns; ch < numAudioOuts; ++ch)
+                buffer.clear (ch, 0, buffer.getNumSamples());
+            renderedDisabled = true;
+            lastShed = shed;
+            applyParameterChanges();
+            return;
+        }
+
+        const bool muted = node->isMuted();
+        const bool muteInput = node->isMutingInputs();
+        const bool metering = beginMetering();
+        const int meterWindow = node->getMeterWindowSize();
+
+        {
+            float startGain, endGain;
+            GainStage::getRamp (muteInput, muted, lastMute, node->getLastInputGain(), node->getInputGain(),
+                                startGain, endGain);
+            GainStage::process (work->getArrayOfWritePointers(), work->getNumChannels(), work->getNumSamples(),
+                                startGain, endGain, metering ? &node->inputMeter : nullptr);
+            if (metering && node->inputMeter.advance (work->getNumSamples(), numSamples, meterWindow))
+                node->publishInputLevels();
+        }
+
+        filterMidi (sharedMidiBuffers, numSamples);
+
+        if (shedFading)
+            keepDry (buffer, numSamples);
         
         if (node->wantsMidiPipe())
         {
-            MidiPipe midiPipe (sharedMidiBuffers, midiChannelsToUse);
-            if (! node->isSuspended())
+            applyParameterChanges();
+            midiPipe.bind (sharedMidiBuffers);
+            if (! node->isSuspended() && ! shedBypassed)
                 node->render (buffer, midiPipe);
             else
                 node->renderBypassed (buffer, midiPipe);
         }
         else
         {
-            auto pluginProcessBlock = [=, &sharedMidiBuffers] (AudioSampleBuffer& buffer, bool isSuspended)
+            if (os == nullptr && ! shedBypassed && node->getOversamplingFactor() > 1)
+            {
+                os = node->getOversamplingProcessor();
+                dsp::AudioBlock<float> block (buffer);
+                osBlock = os->processSamplesUp (block);
+                osBuffer.setDataToReferTo (node->getOversamplingChannels (osBlock),
+                                           totalChans, (int) osBlock.getNumSamples());
+                work = &osBuffer;
+            }
+
+            processPlugin (*work, *sharedMidiBuffers.getUnchecked (midiBufferToUse),
+                           numSamples, processor->isSuspended() || shedBypassed);
+
+            if (os != nullptr)
             {
-                if (! isSuspended)
+                if (feedsDownstream && ! shed && ! lastShed)
                 {
-                    processor->processBlock (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+                    // the next node runs at the same rate, leave it up-sampled
+                    chainOs = os;
+                    chainBlock = osBlock;
+                    holdsOversampled = true;
                 }
                 else
                 {
-                    processor->processBlockBypassed (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+                    dsp::AudioBlock<float> block (buffer);
+                    os->processSamplesDown (block);
+                    work = &buffer;
                 }
-            };
-
-            if (node->getOversamplingFactor() > 1)
-            {
-                auto osProcessor = node->getOversamplingProcessor();
-
-                dsp::AudioBlock<float> block (buffer);
-                dsp::AudioBlock<float> osBlock = osProcessor->processSamplesUp (block);
-
-                std::unique_ptr<float*> ptrArray;
-                ptrArray.reset (new float* [buffer.getNumChannels()]);
-                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-                    ptrArray.get()[ch] = osBlock.getChannelPointer (ch);
-
-                AudioBuffer<float> osBuffer (ptrArray.get(), buffer.getNumChannels(), static_cast<int> (osBlock.getNumSamples()));
-                pluginProcessBlock (osBuffer, processor->isSuspended());
-
-                osProcessor->processSamplesDown (block);
-            }
-            else
-            {
-                pluginProcessBlock (buffer, processor->isSuspended());
             }
-            
         }
+
+        if (shedFading)
+            fadeDry (buffer, numSamples, shed);
+        lastShed = shed;
         
-        if (muted && !muteInput)
-        {
-            if (lastMute != muted)
-            {
-                // just became muted
-                buffer.applyGainRamp (0, numSamples, node->getLastGain(), 0.0);
-            }
-            else
-            {
-                // normal mute processing
-                buffer.applyGain (0, numSamples, 0.0);
-            }
-        }
-        else if (!muted && !muteInput && muted != lastMute)
-        {
-            // just became unmuted
-            buffer.applyGainRamp (0, numSamples, 0.0, node->getGain());
-        }
-        else if (node->getGain() != node->getLastGain())
-        {
-            buffer.applyGainRamp (0, numSamples, node->getLastGain(), node->getGain());
-        }
-        else 
         {
-            buffer.applyGain (0, numSamples, node->getGain());
+            float startGain, endGain;
+            GainStage::getRamp (! muteInput, muted, lastMute, node->getLastGain(), node->getGain(),
+                                startGain, endGain);
+            GainStage::process (work->getArrayOfWritePointers(), work->getNumChannels(), work->getNumSamples(),
+                                startGain, endGain, metering ? &node->outputMeter : nullptr);
+            if (metering && node->outputMeter.advance (work->getNumSamples(), numSamples, meterWindow))
+                node->publishOutputLevels();
         }
 
         node->updateGain();
         lastMute = muted;
 
         for (int i = 0; i < numAudioOuts; ++i)
-            node->setOutputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+            silentOutputs[i] = isDigitalSilence (work->getReadPointer (i), work->getNumSamples()) ? 1 : 0;
+        updateOutputsQuiet (*work);
     }
 
-    const GraphNodePtr node;
-    AudioProcessor* const processor;
-
+    void getBuffersUsed (Array<int>& audio, Array<int>& midi) const override
+    {
+        for (int i = 0; i < totalChans; ++i)
+            audio.add (audioChannelsToUse.getUnchecked (i));
+        audio.addArray (cvChannelsToUse);
+        midi.add (midiBufferToUse);
+        midi.addArray (midiChannelsToUse);
+    }
+
+    bool touchesGraphIO() const override { return graphIO; }
+
+    GraphIO getGraphIO() const override
+    {
+        if (! graphIO)
+            return GraphIO::none;
+        if (auto* const io = dynamic_cast<GraphProcessor::AudioGraphIOProcessor*> (processor))
+            return io->isInput() ? GraphIO::input : GraphIO::output;
+        return GraphIO::other;
+    }
+
+    bool continuesPrevious() const override { return upstream != nullptr; }
+    int getRenderCost() const override      { return 1; }
+
+    void describe (DynamicObject& info) const override
+    {
+        info.setProperty ("op", "process");
+        describeNode (info, *node);
+        if (upstream != nullptr)
+            info.setProperty ("sharesOversampling", (int) upstream->node->nodeId);
+    }
+
+    int64 getReuseKey() const override { return makeReuseKey (processReuse, node->nodeId); }
+
+    /** Returns true if this op would be identical to a new one created with
+        the given arguments. Reusing it keeps mute, transpose and oversampling
+        state intact across rebuilds. */
+    bool canBeReusedFor (const GraphNode* otherNode,
+                         const Array<int>& otherAudioChannels,
+                         const int otherTotalChans,
+                         const Array<int> chans [PortType::Unknown],
+                         const ProcessBufferOp* otherUpstream) const noexcept
+    {
+        if (node.get() != otherNode || upstream != otherUpstream
+            || ! usesAudioChannels (otherAudioChannels, otherTotalChans)
+            || numAudioIns  != (int) otherNode->getNumPorts (PortType::Audio, true)
+            || numAudioOuts != (int) otherNode->getNumPorts (PortType::Audio, false)
+            || midiChannelsToUse != chans[PortType::Midi]
+            || cvChannelsToUse != chans[PortType::CV])
+            return false;
+
+        return true;
+    }
+
+    /** Marks MIDI outputs nothing is connected to, by channel, so nodes that
+        render with a pipe can leave them out. Set before the op renders */
+    void setUnusedMidiOutputs (const BigInteger& unused)
+    {
+        if (unusedMidiOutputs == unused)
+            return;
+        unusedMidiOutputs = unused;
+        initMidiPipe();
+    }
+
+    const BigInteger& getUnusedMidiOutputs() const noexcept { return unusedMidiOutputs; }
+
+    /** Returns true if this op processes exactly the given shared buffers */
+    bool usesAudioChannels (const Array<int>& otherAudioChannels, const int otherTotalChans) const noexcept
+    {
+        if (totalChans != jmax (1, otherTotalChans))
+            return false;
+
+        for (int i = 0; i < totalChans; ++i)
+            if (audioChannelsToUse.getUnchecked (i) != otherAudioChannels [i])
+                return false;
+
+        return true;
+    }
+
+    /** Returns true if the next node can pick up this node's oversampled
+        output directly instead of down and up-sampling in between */
+    bool canShareOversamplingWith (GraphNode* nextNode,
+                                   const Array<int>& nextAudioChannels,
+                                   const int nextTotalChans) const noexcept
+    {
+        const int factor = node->getOversamplingFactor();
+        return factor > 1 && factor == nextNode->getOversamplingFactor()
+            && node->getOversamplingMode() == nextNode->getOversamplingMode()
+            && ! node->wantsMidiPipe() && ! nextNode->wantsMidiPipe()
+            && usesAudioChannels (nextAudioChannels, nextTotalChans);
+    }
+
+    /** The op whose oversampled output this one continues from */
+    void setUpstream (ProcessBufferOp* op) noexcept      { upstream = op; path = generalPath; }
+    ProcessBufferOp* getUpstream() const noexcept       { return upstream; }
+
+    /** When true, oversampled output is left for the next op to down-sample */
+    void setFeedsDownstream (bool feeds) noexcept       { feedsDownstream = feeds; path = generalPath; }
+    bool isFeedingDownstream() const noexcept           { return feedsDownstream; }
+
+    const GraphNodePtr node;
+    AudioProcessor* const processor;
+    BaseProcessor* const eventProcessor; // internal nodes, which may smooth parameters themselves
+
 private:
     Array <int> audioChannelsToUse;
     Array <int> midiChannelsToUse;
-    HeapBlock <float*> channels;
+    BigInteger unusedMidiOutputs;
+    Array <int> cvChannelsToUse;
+    HeapBlock <float*> channels, cvChannels;
+    HeapBlock <double*> doubleChannels;
+    AudioSampleBuffer floatScratch;
+    bool doublePrecision = false;
+    AudioSampleBuffer dryScratch;
+    bool lastShed = false;
     int totalChans, numAudioIns, numAudioOuts;
     int midiBufferToUse;
     bool lastMute = false;
-    MidiTranspose transpose;
+    bool graphIO = false;
     MidiBuffer tempMidi;
+    MidiPipe midiPipe;
+
+    // sample accurate parameter changes
+    HeapBlock<GraphNode::ParameterChange> paramChanges;
+    ParameterRamps paramRamps;
+    MidiBuffer splitMidiIn, splitMidiOut;
+
+    // skipping processing while idle
+    enum SilenceMode { neverSkip = 0, skipWhenSilent, skipAfterTail, skipWhenIdle };
+    SilenceMode silenceMode = neverSkip;
+    HeapBlock<uint8> silentOutputs;
+    bool renderedDisabled = false;
+    int64 tailSamples = 0;
+    int64 numSilentSamples = 0;
+    bool outputsQuiet = false;
+    static constexpr float idleThreshold = 1.0e-6f; // about -120 dB
+
+    void initSilenceMode()
+    {
+        if (graphIO || processor == nullptr || node->wantsMidiPipe() || ! cvChannelsToUse.isEmpty())
+        {
+            silenceMode = neverSkip;
+        }
+        else if (processor->silenceInProducesSilenceOut())
+        {
+            silenceMode = skipWhenSilent;
+        }
+        else if (numAudioIns > 0 && dynamic_cast<BaseProcessor*> (processor) == nullptr
+                    && dynamic_cast<GraphProcessor*> (processor) == nullptr)
+        {
+            // third party effects are skipped once their reported tail has rung out
+            const double tail = processor->getTailLengthSeconds();
+            if (tail >= 0.0 && tail < std::numeric_limits<double>::infinity())
+            {
+                silenceMode = skipAfterTail;
+                tailSamples = (int64) std::ceil (tail * jmax (1.0, processor->getSampleRate()));
+            }
+        }
+        else if (processor->acceptsMidi() && ! processor->producesMidi()
+                    && dynamic_cast<GraphProcessor*> (processor) == nullptr)
+        {
+            // instruments are suspended after a while without input, see
+            // GraphNode::setIdleSuspendTime
+            silenceMode = skipWhenIdle;
+        }
+    }
+
+    /** Lays out the pipe for nodes that render with one, so nothing but
+        pointers change from block to block */
+    void initMidiPipe()
+    {
+        if (! node->wantsMidiPipe())
+            return;
+
+        const int numMidiIns  = node->getNumPorts (PortType::Midi, true);
+        const int numMidiOuts = node->getNumPorts (PortType::Midi, false);
+        Array<MidiPipe::Port> ports;
+        ports.ensureStorageAllocated (midiChannelsToUse.size());
+
+        for (int channel = 0; channel < midiChannelsToUse.size(); ++channel)
+        {
+            MidiPipe::Port port;
+            port.bufferIndex = midiChannelsToUse.getUnchecked (channel);
+            if (channel < numMidiIns)
+                port.inputPort = (int) node->getPortForChannel (PortType::Midi, channel, true);
+            if (channel < numMidiOuts)
+            {
+                port.outputPort = (int) node->getPortForChannel (PortType::Midi, channel, false);
+                port.outputUsed = ! unusedMidiOutputs [channel];
+            }
+            ports.add (port);
+        }
+
+        midiPipe.setPorts (ports);
+    }
+
+    bool canSkip (const OwnedArray<MidiBuffer>& sharedMidiBuffers, const int numSamples,
+                  const uint8* silentBuffers) noexcept
+    {
+        if (silenceMode == neverSkip || ! node->isEnabled())
+            return false;
+
+        bool silent = sharedMidiBuffers.getUnchecked (midiBufferToUse)->isEmpty()
+            && (upstream == nullptr || ! upstream->holdsOversampled);
+        for (int i = 0; silent && i < numAudioIns; ++i)
+            silent = silentBuffers [audioChannelsToUse.getUnchecked (i)] != 0;
+
+        if (! silent)
+        {
+            numSilentSamples = 0;
+            return false;
+        }
+
+        if (silenceMode == skipWhenSilent)
+            return true;
+
+        if (silenceMode == skipWhenIdle)
+        {
+            // asleep until input arrives once the output has decayed and
+            // nothing was played for the idle time
+            const double idleTime = GraphNode::getIdleSuspendTime();
+            if (idleTime <= 0.0)
+                return false;
+            const auto idleSamples = (int64) (idleTime * jmax (1.0, processor->getSampleRate()));
+            if (numSilentSamples < idleSamples || ! outputsQuiet)
+            {
+                numSilentSamples += numSamples;
+                return false;
+            }
+            return true;
+        }
+
+        // keep rendering until the tail has been heard in full
+        const bool tailElapsed = numSilentSamples >= tailSamples + numSamples;
+        if (! tailElapsed)
+            numSilentSamples += numSamples;
+        return tailElapsed;
+    }
+
+    template<typename SampleType>
+    void renderSilence (AudioBuffer<SampleType>& sharedBufferChans, const int numSamples, uint8* silentBuffers) noexcept
+    {
+        holdsOversampled = false;
+        applyParameterChanges();
+
+        for (int i = 0; i < numAudioOuts; ++i)
+        {
+            const int index = audioChannelsToUse.getUnchecked (i);
+            if (silentBuffers [index] == 0)
+            {
+                FloatVectorOperations::clear (sharedBufferChans.getWritePointer (index), numSamples);
+                silentBuffers [index] = 1;
+            }
+        }
+
+        // skipped blocks count as silence towards the next meter reading
+        if (node->metersActive)
+        {
+            const int meterWindow = node->getMeterWindowSize();
+            if (node->inputMeter.advance (numSamples, numSamples, meterWindow))
+                node->publishInputLevels();
+            if (node->outputMeter.advance (numSamples, numSamples, meterWindow))
+                node->publishOutputLevels();
+        }
+
+        node->updateGain();
+        lastMute = node->isMuted();
+        lastShed = node->isShed();
+    }
+
+    /** Applies the node's key range, channel, program and transpose filters
+        in one pass over its MIDI buffer */
+    void filterMidi (const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        ignoreUnused (numSamples);
+       #ifndef EL_FREE
+        const auto& table = node->getMidiFilterSettings().table;
+        if (! table.isActive())
+            return;
+
+        jassert (tempMidi.getNumEvents() == 0);
+        const int program = table.process (*sharedMidiBuffers.getUnchecked (midiBufferToUse), tempMidi);
+        if (program >= 0)
+        {
+            node->setMidiProgram (program);
+            node->reloadMidiProgram();
+        }
+       #else
+        ignoreUnused (sharedMidiBuffers);
+       #endif
+    }
+
+    /** Keeps what a shed node passes through, its inputs on the channels it
+        has both an input and an output for and silence on the rest */
+    void keepDry (const AudioSampleBuffer& buffer, const int numSamples) noexcept
+    {
+        for (int ch = 0; ch < numAudioOuts; ++ch)
+        {
+            if (ch < numAudioIns)
+                dryScratch.copyFrom (ch, 0, buffer, ch, 0, numSamples);
+            else
+                dryScratch.clear (ch, 0, numSamples);
+        }
+    }
+
+    /** Fades the block from the node's output to what it passes through
+        when shed, or back again when restored */
+    void fadeDry (AudioSampleBuffer& buffer, const int numSamples, const bool toDry) noexcept
+    {
+        const float wetStart = toDry ? 1.f : 0.f;
+        for (int ch = 0; ch < numAudioOuts; ++ch)
+        {
+            buffer.applyGainRamp (ch, 0, numSamples, wetStart, 1.f - wetStart);
+            buffer.addFromWithRamp (ch, 0, dryScratch.getReadPointer (ch), numSamples,
+                                    1.f - wetStart, wetStart);
+        }
+    }
+
+    /** Returns the node's timer when its render time is being measured */
+    ProcessTimer* getProcessTimer() const noexcept
+    {
+        return node->isProfiling() ? &node->processTimer : nullptr;
+    }
+
+    /** Starts or stops measuring levels to match the node's subscribers */
+    bool beginMetering() noexcept
+    {
+        const bool metering = node->isMeterSubscribed();
+        if (metering != node->metersActive)
+        {
+            node->metersActive = metering;
+            node->clearLevels();
+        }
+        return metering;
+    }
+
+    /** Renders a processor which handles doubles directly on the shared buffers */
+    void processDouble (AudioBuffer<double>& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                        const int numSamples)
+    {
+        // nodes rendering doubles never oversample, so nothing can be left
+        // up-sampled for them
+        jassert (upstream == nullptr || ! upstream->holdsOversampled);
+        holdsOversampled = false;
+        renderedDisabled = false;
+        // there's no room for doubles to fade with, shedding is immediate
+        lastShed = node->isShed();
+
+        if (! node->isEnabled())
+        {
+            for (int ch = numAudioIns; ch < numAudioOuts; ++ch)
+                buffer.clear (ch, 0, buffer.getNumSamples());
+            renderedDisabled = true;
+            applyParameterChanges();
+            return;
+        }
+
+        const bool muted = node->isMuted();
+        const bool muteInput = node->isMutingInputs();
+        const bool metering = beginMetering();
+        const int meterWindow = node->getMeterWindowSize();
+        float startGain, endGain;
+
+        GainStage::getRamp (muteInput, muted, lastMute, node->getLastInputGain(), node->getInputGain(),
+                            startGain, endGain);
+        GainStage::process (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples,
+                            startGain, endGain, metering ? &node->inputMeter : nullptr);
+        if (metering && node->inputMeter.advance (numSamples, numSamples, meterWindow))
+            node->publishInputLevels();
+
+        filterMidi (sharedMidiBuffers, numSamples);
+
+        processPlugin (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse),
+                       numSamples, processor->isSuspended() || lastShed);
+
+        GainStage::getRamp (! muteInput, muted, lastMute, node->getLastGain(), node->getGain(),
+                            startGain, endGain);
+        GainStage::process (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples,
+                            startGain, endGain, metering ? &node->outputMeter : nullptr);
+        if (metering && node->outputMeter.advance (numSamples, numSamples, meterWindow))
+            node->publishOutputLevels();
+
+        node->updateGain();
+        lastMute = muted;
+
+        for (int i = 0; i < numAudioOuts; ++i)
+            silentOutputs[i] = isDigitalSilence (buffer.getReadPointer (i), numSamples) ? 1 : 0;
+        updateOutputsQuiet (buffer);
+    }
+
+    template<typename SampleType>
+    void callPlugin (AudioBuffer<SampleType>& buffer, MidiBuffer& midi, const bool suspended)
+    {
+        if (! suspended)
+            processor->processBlock (buffer, midi);
+        else
+            processor->processBlockBypassed (buffer, midi);
+    }
+
+    /** Runs the processor, splitting the block where queued parameter changes
+        land and where smoothed ones step along. The buffer may be oversampled,
+        MIDI is at the graph's rate */
+    template<typename SampleType>
+    void processPlugin (AudioBuffer<SampleType>& buffer, MidiBuffer& midi,
+                        const int numSamples, const bool suspended)
+    {
+        if (! node->hasPendingParameterChanges() && ! paramRamps.isActive())
+        {
+            callPlugin (buffer, midi, suspended);
+            return;
+        }
+
+        const int numChanges = node->hasPendingParameterChanges()
+            ? node->readParameterChanges (paramChanges, GraphNode::maxParameterChanges) : 0;
+        const double now  = Time::getMillisecondCounterHiRes() * 0.001;
+        const double rate = jmax (1.0, node->meterSampleRate); // the graph rate, even when oversampled
+        const int factor  = jmax (1, buffer.getNumSamples() / jmax (1, numSamples));
+
+        // as far from the end of this block as it was from now
+        auto getOffset = [&] (const GraphNode::ParameterChange& change) -> int
+        {
+            return change.timestamp > 0.0
+                ? jlimit (0, numSamples, numSamples - roundToInt ((now - change.timestamp) * rate)) : 0;
+        };
+
+        if (eventProcessor != nullptr && eventProcessor->acceptsParameterEvents() && ! paramRamps.isActive())
+        {
+            processWithParameterEvents (buffer, midi, numChanges, getOffset, rate, factor, suspended);
+            return;
+        }
+
+        splitMidiOut.clear();
+        MidiBudget::Writer splitOut (splitMidiOut);
+        int start = 0, next = 0;
+
+        for (;;)
+        {
+            while (next < numChanges && getOffset (paramChanges[next]) <= start)
+                applyParameterChange (paramChanges[next++], rate);
+            if (start >= numSamples)
+                break;
+
+            int end = next < numChanges ? getOffset (paramChanges[next]) : numSamples;
+            if (paramRamps.isActive())
+            {
+                end = jmin (end, start + (int) ParameterRamps::interval);
+                paramRamps.advance (end - start, [this] (int parameter, float value)
+                {
+                    if (auto* param = node->getParameters().getObjectPointer (parameter))
+                        param->setValueNotifyingHost (value);
+                });
+            }
+
+            AudioBuffer<SampleType> part (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                          start * factor, (end - start) * factor);
+            splitMidiIn.clear();
+            MidiBudget::Writer (splitMidiIn).addEvents (midi, start, end - start, -start);
+            callPlugin (part, splitMidiIn, suspended);
+            splitOut.addEvents (splitMidiIn, 0, -1, start);
+            start = end;
+        }
+
+        midi.swapWith (splitMidiOut);
+    }
+
+    /** Hands queued changes to an internal node that smooths its parameters
+        itself, so the block isn't split. Its smoothing is linear, whatever
+        shape a change asked for. The parameters are set afterwards so hosts
+        and editors see where they ended up */
+    template<typename SampleType, typename OffsetFunction>
+    void processWithParameterEvents (AudioBuffer<SampleType>& buffer, MidiBuffer& midi, const int numChanges,
+                                     OffsetFunction&& getOffset, const double rate, const int factor,
+                                     const bool suspended)
+    {
+        for (int i = 0; i < numChanges; ++i)
+        {
+            auto& change = paramChanges[i];
+            const int rampSamples = change.smoothing != ParameterRamps::none
+                ? roundToInt (change.smoothingTime * rate) * factor : -1;
+            if (eventProcessor->addParameterEvent (change.parameter, change.value,
+                                                   getOffset (change) * factor, rampSamples))
+                continue;
+
+            if (auto* param = node->getParameters().getObjectPointer (change.parameter))
+                param->setValueNotifyingHost (change.value);
+            change.parameter = -1;
+        }
+
+        callPlugin (buffer, midi, suspended);
+
+        for (int i = 0; i < numChanges; ++i)
+            if (auto* param = node->getParameters().getObjectPointer (paramChanges[i].parameter))
+                param->setValueNotifyingHost (paramChanges[i].value);
+    }
+
+    /** Sets a parameter, or starts it gliding when the change is smoothed */
+    void applyParameterChange (const GraphNode::ParameterChange& change, double rate) noexcept
+    {
+        auto* param = node->getParameters().getObjectPointer (change.parameter);
+        if (param == nullptr)
+            return;
+
+        const int numSamples = roundToInt (change.smoothingTime * rate);
+        if (! paramRamps.start (change.parameter, param->getValue(), change.value,
+                                change.smoothing, numSamples))
+            param->setValueNotifyingHost (change.value);
+    }
+
+    /** Applies queued parameter changes when the processor isn't run */
+    void applyParameterChanges() noexcept
+    {
+        if (! node->hasPendingParameterChanges())
+            return;
+        // nothing to glide through, smoothed changes jump too
+        const int numChanges = node->readParameterChanges (paramChanges, GraphNode::maxParameterChanges);
+        for (int i = 0; i < numChanges; ++i)
+            applyParameterChange (paramChanges[i], 0.0);
+    }
+
+    /** Notes whether an idle instrument's output has decayed below hearing */
+    template<typename SampleType>
+    void updateOutputsQuiet (const AudioBuffer<SampleType>& buffer) noexcept
+    {
+        if (silenceMode != skipWhenIdle)
+            return;
+
+        outputsQuiet = true;
+        for (int i = 0; outputsQuiet && i < numAudioOuts; ++i)
+            outputsQuiet = silentOutputs[i] != 0
+                || buffer.getMagnitude (i, 0, buffer.getNumSamples()) < (SampleType) idleThreshold;
+    }
+
+    /** Returns true if every sample is zero, bailing out at the first that isn't */
+    template<typename SampleType>
+    static bool isDigitalSilence (const SampleType* samples, const int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            if (samples[i] != 0.f)
+                return false;
+        return true;
+    }
+
+    // while gains are at unity and nothing is muted, metered, filtered, shed or
+    // oversampled the stages are skipped until the node's settings change
+    enum RenderPath { generalPath = 0, directPath };
+    RenderPath path = generalPath;
+    uint32 pathConfig = 0;
+
+    /** Picks the path of the next block once the general one has settled
+        whatever it was ramping or fading */
+    void selectPath() noexcept
+    {
+        // read first, a setting changed meanwhile moves it on again
+        pathConfig = node->getRenderConfig();
+
+        const bool direct = upstream == nullptr && ! holdsOversampled && ! renderedDisabled
+            && node->isEnabled() && ! node->wantsMidiPipe()
+            && ! node->isShed() && ! lastShed
+            && ! node->isMuted() && ! lastMute
+            && node->getGain() == 1.f && node->getLastGain() == 1.f
+            && node->getInputGain() == 1.f && node->getLastInputGain() == 1.f
+            && ! node->isMeterSubscribed() && ! node->metersActive
+            && node->getOversamplingFactor() == 1
+            && ! node->getMidiFilterSettings().table.isActive();
+
+        path = direct ? directPath : generalPath;
+    }
+
+    // oversampling shared with neighbouring nodes
+    ProcessBufferOp* upstream = nullptr;
+    bool feedsDownstream = false;
+    bool holdsOversampled = false;
+    dsp::Oversampling<float>* chainOs = nullptr;
+    dsp::AudioBlock<float> chainBlock;
+
     JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
 };
 
+//=============================================================================
+/** Plays back the render of a frozen node in place of processing it. The
+    position follows the transport while it plays and runs freely otherwise,
+    wrapping at the end of the render. */
+class FrozenPlaybackOp : public Task
+{
+public:
+    FrozenPlaybackOp (const GraphNodePtr& node_, const FrozenAudio::Ptr& audio_,
+                      const Array<int>& audioChannelsToUse_, const int totalChans_,
+                      const Array<int> chans [PortType::Unknown])
+        : node (node_), audio (audio_),
+          audioChannelsToUse (audioChannelsToUse_),
+          midiChannelsToUse (chans[PortType::Midi]),
+          totalChans (jmax (1, totalChans_)),
+          numAudioOuts (node_->getNumPorts (PortType::Audio, false))
+    {
+        while (audioChannelsToUse.size() < totalChans)
+            audioChannelsToUse.add (0);
+        channels.calloc ((size_t) totalChans);
+        doubleChannels.calloc ((size_t) totalChans);
+        scratch.setSize (jmax (1, numAudioOuts), renderBufferSize);
+        lastMute = node->isMuted();
+    }
+
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                  const int numSamples) override
+    {
+        for (int i = totalChans; --i >= 0;)
+            channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        AudioSampleBuffer buffer (channels, totalChans, numSamples);
+        render (buffer, sharedMidiBuffers, numSamples);
+    }
+
+    void performWithSilence (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                             const int numSamples, uint8* silentBuffers) override
+    {
+        perform (sharedBufferChans, sharedMidiBuffers, numSamples);
+        markOutputsAudible (silentBuffers);
+    }
+
+    void performDouble (AudioBuffer<double>& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                        const int numSamples, uint8* silentBuffers) override
+    {
+        jassert (numSamples <= scratch.getNumSamples());
+        AudioSampleBuffer buffer (scratch.getArrayOfWritePointers(), scratch.getNumChannels(), numSamples);
+        render (buffer, sharedMidiBuffers, numSamples);
+
+        const int numOuts = jmin (numAudioOuts, totalChans);
+        for (int i = numOuts; --i >= 0;)
+            doubleChannels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        AudioBuffer<double> outputs (doubleChannels, numOuts, numSamples);
+        SampleConversion::convert (buffer, outputs, numOuts, numSamples);
+        markOutputsAudible (silentBuffers);
+    }
+
+    void getBuffersUsed (Array<int>& audioBuffers, Array<int>& midiBuffers) const override
+    {
+        for (int i = 0; i < totalChans; ++i)
+            audioBuffers.add (audioChannelsToUse.getUnchecked (i));
+        midiBuffers.addArray (midiChannelsToUse);
+    }
+
+    int getRenderCost() const override { return 1; }
+
+    void describe (DynamicObject& info) const override
+    {
+        info.setProperty ("op", "frozen");
+        describeNode (info, *node);
+    }
+
+private:
+    const GraphNodePtr node;
+    const FrozenAudio::Ptr audio;
+    Array<int> audioChannelsToUse;
+    Array<int> midiChannelsToUse;
+    const int totalChans, numAudioOuts;
+    HeapBlock<float*> channels;
+    HeapBlock<double*> doubleChannels;
+    AudioSampleBuffer scratch;
+    int64 freePosition = 0;
+    bool lastMute = false;
+
+    void render (AudioSampleBuffer& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                 const int numSamples) noexcept
+    {
+        audio->read (buffer, jmin (numAudioOuts, buffer.getNumChannels()), getPosition (numSamples), numSamples);
+
+        const bool muted = node->isMuted();
+        float startGain, endGain;
+        GainStage::getRamp (true, muted, lastMute, node->getLastGain(), node->getGain(),
+                            startGain, endGain);
+        GainStage::process (buffer.getArrayOfWritePointers(), jmin (numAudioOuts, buffer.getNumChannels()),
+                            numSamples, startGain, endGain, nullptr);
+        node->updateGain();
+        lastMute = muted;
+
+        // the processor isn't there to pass MIDI through or produce any
+        for (const auto index : midiChannelsToUse)
+            sharedMidiBuffers.getUnchecked (index)->clear();
+    }
+
+    int64 getPosition (const int numSamples) noexcept
+    {
+        int64 position = freePosition;
+        AudioPlayHead::CurrentPositionInfo info;
+        if (auto* const proc = node->getAudioProcessor())
+            if (auto* const playHead = proc->getPlayHead())
+                if (playHead->getCurrentPosition (info) && info.isPlaying)
+                    position = info.timeInSamples - audio->getStartFrame();
+
+        freePosition = position + numSamples;
+        return position;
+    }
+
+    void markOutputsAudible (uint8* silentBuffers) const noexcept
+    {
+        for (int i = 0; i < jmin (numAudioOuts, totalChans); ++i)
+        {
+            const int index = audioChannelsToUse.getUnchecked (i);
+            if (index != 0)
+                silentBuffers [index] = 0;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (FrozenPlaybackOp)
+};
+
+/** Plays back a node rendered ahead on the render-ahead workers in place of
+    processing it on the audio thread. */
+class AnticipatedPlaybackOp : public Task
+{
+public:
+    AnticipatedPlaybackOp (GraphProcessor& graph, const GraphNodePtr& node_,
+                           const Array<int>& audioChannelsToUse_, const int totalChans_,
+                           const Array<int> chans [PortType::Unknown])
+        : node (node_),
+          audioChannelsToUse (audioChannelsToUse_),
+          midiChannelsToUse (chans[PortType::Midi]),
+          totalChans (jmax (1, totalChans_)),
+          numAudioOuts (node_->getNumPorts (PortType::Audio, false)),
+          renderer (graph, node_, totalChans, numAudioOuts, renderBufferSize)
+    {
+        while (audioChannelsToUse.size() < totalChans)
+            audioChannelsToUse.add (0);
+        channels.calloc ((size_t) totalChans);
+        doubleChannels.calloc ((size_t) totalChans);
+        scratch.setSize (jmax (1, numAudioOuts), renderBufferSize);
+        lastMute = node->isMuted();
+    }
+
+    int64 getReuseKey() const override { return makeReuseKey (anticipatedReuse, node->nodeId); }
+
+    bool canBeReusedFor (const GraphNode* const otherNode, const Array<int>& otherAudioChannels,
+                         const int otherTotalChans, const Array<int> otherChans [PortType::Unknown]) const
+    {
+        Array<int> audio (otherAudioChannels);
+        while (audio.size() < jmax (1, otherTotalChans))
+            audio.add (0);
+
+        return node.get() == otherNode
+            && totalChans == jmax (1, otherTotalChans)
+            && numAudioOuts == (int) otherNode->getNumPorts (PortType::Audio, false)
+            && audioChannelsToUse == audio
+            && midiChannelsToUse == otherChans[PortType::Midi];
+    }
+
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                  const int numSamples) override
+    {
+        for (int i = totalChans; --i >= 0;)
+            channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        AudioSampleBuffer buffer (channels, totalChans, numSamples);
+        render (buffer, sharedMidiBuffers, numSamples);
+    }
+
+    void performWithSilence (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                             const int numSamples, uint8* silentBuffers) override
+    {
+        perform (sharedBufferChans, sharedMidiBuffers, numSamples);
+        markOutputsAudible (silentBuffers);
+    }
+
+    void performDouble (AudioBuffer<double>& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                        const int numSamples, uint8* silentBuffers) override
+    {
+        jassert (numSamples <= scratch.getNumSamples());
+        AudioSampleBuffer buffer (scratch.getArrayOfWritePointers(), scratch.getNumChannels(), numSamples);
+        render (buffer, sharedMidiBuffers, numSamples);
+
+        const int numOuts = jmin (numAudioOuts, totalChans);
+        for (int i = numOuts; --i >= 0;)
+            doubleChannels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+        AudioBuffer<double> outputs (doubleChannels, numOuts, numSamples);
+        SampleConversion::convert (buffer, outputs, numOuts, numSamples);
+        markOutputsAudible (silentBuffers);
+    }
+
+    void getBuffersUsed (Array<int>& audioBuffers, Array<int>& midiBuffers) const override
+    {
+        for (int i = 0; i < totalChans; ++i)
+            audioBuffers.add (audioChannelsToUse.getUnchecked (i));
+        midiBuffers.addArray (midiChannelsToUse);
+    }
+
+    int getRenderCost() const override { return 1; }
+
+    void describe (DynamicObject& info) const override
+    {
+        info.setProperty ("op", "ahead");
+        describeNode (info, *node);
+        info.setProperty ("misses", renderer.getNumMisses());
+    }
+
+    void setRetired (bool retired) override
+    {
+        renderer.setRetired (retired);
+    }
+
+private:
+    const GraphNodePtr node;
+    Array<int> audioChannelsToUse;
+    Array<int> midiChannelsToUse;
+    const int totalChans, numAudioOuts;
+    AnticipativeRenderer renderer;
+    HeapBlock<float*> channels;
+    HeapBlock<double*> doubleChannels;
+    AudioSampleBuffer scratch;
+    bool lastMute = false;
+
+    void render (AudioSampleBuffer& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                 const int numSamples) noexcept
+    {
+        renderer.read (buffer, numSamples);
+
+        const bool muted = node->isMuted();
+        float startGain, endGain;
+        GainStage::getRamp (true, muted, lastMute, node->getLastGain(), node->getGain(),
+                            startGain, endGain);
+        GainStage::process (buffer.getArrayOfWritePointers(), jmin (numAudioOuts, buffer.getNumChannels()),
+                            numSamples, startGain, endGain, nullptr);
+        node->updateGain();
+        lastMute = muted;
+
+        // nothing takes MIDI from the node, what it makes stays with the workers
+        for (const auto index : midiChannelsToUse)
+            sharedMidiBuffers.getUnchecked (index)->clear();
+    }
+
+    void markOutputsAudible (uint8* silentBuffers) const noexcept
+    {
+        for (int i = 0; i < jmin (numAudioOuts, totalChans); ++i)
+        {
+            const int index = audioChannelsToUse.getUnchecked (i);
+            if (index != 0)
+                silentBuffers [index] = 0;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (AnticipatedPlaybackOp)
+};
+
+
+/** Returns true if a subgraph node can be flattened into the graph rendering
+    it. Only racks whose own node leaves audio and MIDI untouched qualify,
+    the node's gain, mute, bypass, oversampling and MIDI filters would be
+    skipped otherwise. */
+static bool canInlineSubGraph (GraphNode& node, const GraphProcessor& parent)
+{
+    auto* const sub = dynamic_cast<SubGraphProcessor*> (node.getAudioProcessor());
+    return sub != nullptr
+        && node.isEnabled() && ! node.isSuspended() && ! node.isMuted()
+        && node.getGain() == 1.f && node.getInputGain() == 1.f
+        && node.getOversamplingFactor() == 1 && ! node.wantsMidiPipe()
+        && node.getTransposeOffset() == 0 && node.getKeyRange() == Range<int> (0, 127)
+        && node.getMidiChannels().isOmni() && ! node.areMidiProgramsEnabled()
+        && ! sub->isFilteringMidi()
+        && sub->isUsingDoublePrecision() == parent.isUsingDoublePrecision()
+        && ! sub->isMultiRate();
+}
+
+/** The nodes and connections a program is built from. Nodes are referred
+    to by their index in this topology rather than their id, since inlined
+    subgraphs add nodes numbered independently of their parent's.
+
+    When inlining, subgraph nodes and the IO nodes inside them are removed
+    and every connection through them is replaced by a direct one, so
+    nested racks render as part of the outer program.
+ */
+struct RenderTopology
+{
+    struct Link
+    {
+        uint32 sourceNode, sourcePort, destNode, destPort;
+    };
+
+    Array<GraphNode*> nodes;
+    Array<Link> links;
+
+    // orders the nodes of aux buses, see orderAuxBuses. Only sort reads these
+    Array<Link> orderings;
+
+    RenderTopology (GraphProcessor& graph, const bool inlineSubGraphs)
+    {
+        addGraph (graph, inlineSubGraphs, true);
+        if (removed.contains (true))
+            flatten();
+        orderAuxBuses();
+    }
+
+    /** Orders the nodes so that sources come before their destinations.
+        Cycles are broken at the earliest unplaced node. This is Kahn's
+        algorithm, ties are resolved by the order nodes were added. */
+    void sort (Array<int>& order) const
+    {
+        const int numNodes = nodes.size();
+        order.clearQuick();
+        order.ensureStorageAllocated (numNodes);
+
+        Array<Link> edges (links);
+        edges.addArray (orderings);
+
+        // compressed adjacency: edges for node i are targets[offsets[i] .. offsets[i + 1])
+        HeapBlock<int> inDegree, offsets, targets, fill, queue;
+        inDegree.calloc ((size_t) numNodes + 1);
+        offsets.calloc ((size_t) numNodes + 2);
+        fill.calloc ((size_t) numNodes + 1);
+        queue.calloc ((size_t) numNodes + 1);
+        targets.calloc ((size_t) edges.size() + 1);
+
+        for (const auto& l : edges)
+            if (l.sourceNode != l.destNode)
+                ++offsets [l.sourceNode + 1];
+
+        for (int i = 0; i < numNodes; ++i)
+            offsets[i + 1] += offsets[i];
+
+        for (const auto& l : edges)
+        {
+            if (l.sourceNode == l.destNode)
+                continue;
+            const int src = (int) l.sourceNode;
+            targets [offsets[src] + fill[src]++] = (int) l.destNode;
+            ++inDegree [l.destNode];
+        }
+
+        int head = 0, tail = 0, nextUnvisited = 0;
+
+        for (int i = 0; i < numNodes; ++i)
+            if (inDegree[i] == 0)
+                queue[tail++] = i;
+
+        while (order.size() < numNodes)
+        {
+            if (head == tail)
+            {
+                // only cycles remain: release the earliest node which hasn't been placed
+                while (inDegree [nextUnvisited] <= 0)
+                    ++nextUnvisited;
+                inDegree [nextUnvisited] = 0;
+                queue[tail++] = nextUnvisited;
+            }
+
+            const int index = queue[head++];
+            inDegree[index] = -1; // visited
+            order.add (index);
+
+            for (int e = offsets[index]; e < offsets[index + 1]; ++e)
+            {
+                const int dst = targets[e];
+                if (inDegree[dst] > 0 && --inDegree[dst] == 0)
+                    queue[tail++] = dst;
+            }
+        }
+    }
+
+private:
+    typedef GraphProcessor::AudioGraphIOProcessor IOProc;
+
+    // per node: removed by inlining, and for IO nodes of an inlined
+    // subgraph the index of the subgraph node they belong to
+    Array<bool> removed;
+    Array<int> owners;
+    std::unordered_map<uint64, Array<int>> linksInto;
+
+    static uint64 getPortKey (const uint32 node, const uint32 port) noexcept
+    {
+        return ((uint64) node << 32) | (uint64) port;
+    }
+
+    void addGraph (GraphProcessor& graph, const bool inlineSubGraphs, const bool isRoot,
+                   const int owner = -1)
+    {
+        HashMap<uint32, int> indexes;
+
+        for (auto* const node : graph.nodes)
+        {
+            const int index = nodes.size();
+            indexes.set (node->nodeId, index);
+            nodes.add (node);
+            owners.add (-1);
+
+            const bool isInnerIO = ! isRoot && dynamic_cast<IOProc*> (node->getAudioProcessor()) != nullptr;
+            if (isInnerIO)
+                owners.set (index, owner);
+
+            auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor());
+            const bool expand = sub != nullptr && inlineSubGraphs && canInlineSubGraph (*node, graph);
+            removed.add (isInnerIO || expand);
+
+            if (sub != nullptr && inlineSubGraphs)
+                sub->inlinedInto = expand ? &graph : nullptr;
+            if (expand)
+                addGraph (*sub, true, false, index);
+        }
+
+        for (const auto* c : graph.connections)
+            if (indexes.contains (c->sourceNode) && indexes.contains (c->destNode))
+                links.add ({ (uint32) indexes [c->sourceNode], c->sourcePort,
+                             (uint32) indexes [c->destNode], c->destPort });
+    }
+
+    /** Replaces every link through removed nodes with direct ones */
+    void flatten()
+    {
+        for (int i = 0; i < links.size(); ++i)
+        {
+            const auto& l = links.getReference (i);
+            linksInto [getPortKey (l.destNode, l.destPort)].add (i);
+        }
+
+        Array<Link> flat;
+        Array<Link> sources;
+        for (const auto& l : links)
+        {
+            if (removed [(int) l.destNode])
+                continue;
+
+            sources.clearQuick();
+            resolve (l.sourceNode, l.sourcePort, sources, 0);
+            for (const auto& s : sources)
+                flat.add ({ s.sourceNode, s.sourcePort, l.destNode, l.destPort });
+        }
+
+        Array<int> remap;
+        Array<GraphNode*> kept;
+        for (int i = 0; i < nodes.size(); ++i)
+        {
+            remap.add (removed[i] ? -1 : kept.size());
+            if (! removed[i])
+                kept.add (nodes.getUnchecked (i));
+        }
+
+        for (auto& l : flat)
+        {
+            l.sourceNode = (uint32) remap [(int) l.sourceNode];
+            l.destNode   = (uint32) remap [(int) l.destNode];
+        }
+
+        nodes.swapWith (kept);
+        links.swapWith (flat);
+    }
+
+    void resolveInputs (const int node, const uint32 port, Array<Link>& sources, const int depth)
+    {
+        const auto iter = linksInto.find (getPortKey ((uint32) node, port));
+        if (iter == linksInto.end())
+            return;
+        for (const int i : iter->second)
+            resolve (links.getReference (i).sourceNode, links.getReference (i).sourcePort, sources, depth + 1);
+    }
+
+    /** Finds the real outputs feeding a node output, looking through
+        inlined subgraphs and their IO nodes */
+    void resolve (const uint32 node, const uint32 port, Array<Link>& sources, const int depth)
+    {
+        // a loop made only of passthrough racks carries nothing
+        if (depth > 64)
+            return;
+
+        if (! removed [(int) node])
+        {
+            sources.add ({ node, port, 0, 0 });
+            return;
+        }
+
+        GraphNode* const graphNode = nodes.getUnchecked ((int) node);
+        const PortType type = graphNode->getPortType (port);
+        const int channel = graphNode->getChannelPort (port);
+        const int owner = owners [(int) node];
+
+        if (owner < 0)
+        {
+            // a subgraph output is whatever reaches the matching output node inside it
+            const auto outputType = type == PortType::Midi ? IOProc::midiOutputNode : IOProc::audioOutputNode;
+            for (int i = (int) node + 1; i < nodes.size(); ++i)
+            {
+                if (owners[i] != (int) node)
+                    continue;
+                auto* const io = dynamic_cast<IOProc*> (nodes.getUnchecked(i)->getAudioProcessor());
+                if (io != nullptr && io->getType() == outputType)
+                    resolveInputs (i, nodes.getUnchecked(i)->getPortForChannel (type, channel, true), sources, depth);
+            }
+        }
+        else
+        {
+            // an input node inside a subgraph carries what feeds the subgraph
+            GraphNode* const subNode = nodes.getUnchecked (owner);
+            resolveInputs (owner, subNode->getPortForChannel (type, channel, true), sources, depth);
+        }
+    }
+
+    /** Puts every send of a bus before its returns, and sends of the same
+        bus after one another, without making them share any buffers */
+    void orderAuxBuses()
+    {
+        struct AuxNode { int index; String bus; bool send; };
+        Array<AuxNode> aux;
+        for (int i = 0; i < nodes.size(); ++i)
+            if (auto* const node = dynamic_cast<AuxBusNode*> (nodes.getUnchecked(i)->getAudioProcessor()))
+                aux.add ({ i, node->getBusName(), node->isSend() });
+
+        HashMap<String, int> lastSend;
+        for (const auto& a : aux)
+        {
+            if (! a.send)
+                continue;
+            if (lastSend.contains (a.bus))
+                orderings.add ({ (uint32) lastSend [a.bus], 0, (uint32) a.index, 0 });
+            lastSend.set (a.bus, a.index);
+        }
+
+        for (const auto& a : aux)
+            if (! a.send && lastSend.contains (a.bus))
+                orderings.add ({ (uint32) lastSend [a.bus], 0, (uint32) a.index, 0 });
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (RenderTopology)
+};
 
 /** Used to calculate the correct sequence of rendering ops needed, based on
     the best re-use of shared buffers at each stage. */
 class ProcessorGraphBuilder
 {
 public:
-    ProcessorGraphBuilder (GraphProcessor& graph_, 
-                           const Array<void*>& orderedNodes_,
-                           Array<void*>& renderingOps)
+    ProcessorGraphBuilder (GraphProcessor& graph_,
+                           const RenderTopology& topology_,
+                           const Array<int>& order_,
+                           Array<void*>& renderingOps,
+                           const bool reuseBuffers_ = true,
+                           Array<void*>* reusableOps_ = nullptr)
         : graph (graph_),
-          orderedNodes (orderedNodes_),
-          totalLatency (0)
+          topology (topology_),
+          order (order_),
+          totalLatency (0),
+          reuseBuffers (reuseBuffers_),
+          doublePrecision (graph_.isUsingDoublePrecision())
     {
+        if (reusableOps_ != nullptr)
+            for (auto* op : *reusableOps_)
+                addReusableOp (static_cast<Task*> (op));
+
         for (int i = 0; i < PortType::Unknown; ++i)
         {
             allNodes[i].add ((uint32) zeroNodeID);  // first buffer is read-only zeros
             allPorts[i].add (KV_INVALID_PORT);
         }
 
-        for (int i = 0; i < orderedNodes.size(); ++i)
+        analyseLiveness();
+
+        for (int i = 0; i < order.size(); ++i)
         {
-            createRenderingOpsForNode ((GraphNode*) orderedNodes.getUnchecked (i),
+            const int numOpsBefore = renderingOps.size();
+            const int index = order.getUnchecked (i);
+            createRenderingOpsForNode (topology.nodes.getUnchecked (index), (uint32) index,
                                        renderingOps, i);
-            markUnusedBuffersFree (i);
+            if (renderingOps.size() > numOpsBefore)
+                stageEnds.add (renderingOps.size());
+
+            // when rendering in parallel, buffers are not recycled so that
+            // independent branches never share storage
+            if (reuseBuffers)
+                markUnusedBuffersFree (i);
         }
 
-        graph.setLatencySamples (totalLatency);
+        settleLastProcessOp (renderingOps, false);
     }
 
     int32 buffersNeeded (PortType type)     { return allNodes[type.id()].size(); }
 
+    /** Returns the longest path's latency through the graph */
+    int getTotalLatency() const noexcept    { return totalLatency; }
+
+    /** Returns the end index of each node's ops in the rendering sequence */
+    const Array<int>& getStageEnds() const noexcept { return stageEnds; }
+
 private:
     //==============================================================================
     GraphProcessor& graph;
-    const Array<void*>& orderedNodes;
+    const RenderTopology& topology;
+    const Array<int>& order;
     Array <uint32> allNodes [PortType::Unknown];
     Array <uint32> allPorts [PortType::Unknown];
 
@@ -459,43 +2043,259 @@ private:
 
     static bool isNodeBusy (uint32 nodeID) noexcept { return nodeID != freeNodeID && nodeID != zeroNodeID; }
 
-    Array <uint32> nodeDelayIDs;
-    Array <int> nodeDelays;
-    int totalLatency;
+    static int64 getPortKey (const uint32 nodeId, const uint32 port) noexcept
+    {
+        return (int64) (((uint64) nodeId << 32) | (uint64) port);
+    }
+
+    /** When a node output is read for the last time. Its buffer is live from
+        the step that writes it until lastStep, and can be recycled after */
+    struct Liveness
+    {
+        int lastStep = -1;
+        uint32 lastPort = KV_INVALID_PORT;
+        bool manyLastPorts = false;
+    };
+
+    /** The sources connected to one input port, in connection order */
+    struct PortInputs
+    {
+        Array<uint32> nodes, ports;
+    };
+
+    HashMap<int64, Liveness> liveness;
+    HashMap<int64, int> inputIndexes;
+    OwnedArray<PortInputs> inputs;
+    PortInputs noInputs;
+
+    // buffer slot holding each live node output, and the free slots of each
+    // type. slots are assigned lowest first, which colours the live
+    // intervals with as few buffers as there are overlapping outputs.
+    HashMap<int64, int> bufferContaining [PortType::Unknown];
+    SortedSet<int> freeBuffers [PortType::Unknown];
+
+    HashMap<uint32, int> nodeDelays;
+    int totalLatency;
+    const bool reuseBuffers;
+    const bool doublePrecision;
+    Array<int> stageEnds;
+
+    // ops from the previous sequence which may be moved into the new one,
+    // grouped by reuse key. anything taken is removed from its group.
+    HashMap<int64, int> reusableIndexes;
+    OwnedArray<Array<Task*>> reusableOps;
+
+    void addReusableOp (Task* const op)
+    {
+        const auto key = op->getReuseKey();
+        if (key == Task::makeReuseKey (Task::noReuse, 0))
+            return;
+
+        if (! reusableIndexes.contains (key))
+        {
+            reusableIndexes.set (key, reusableOps.size());
+            reusableOps.add (new Array<Task*>());
+        }
+
+        reusableOps.getUnchecked (reusableIndexes [key])->add (op);
+    }
+
+    template<class OpType, class Predicate>
+    OpType* takeReusableOp (const int64 key, Predicate&& matches)
+    {
+        if (! reusableIndexes.contains (key))
+            return nullptr;
+
+        auto& candidates = *reusableOps.getUnchecked (reusableIndexes [key]);
+        for (int i = 0; i < candidates.size(); ++i)
+        {
+            if (auto* const op = dynamic_cast<OpType*> (candidates.getUnchecked (i)))
+            {
+                if (matches (*op))
+                {
+                    candidates.remove (i);
+                    return op;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    // delays added for the current node which are not in the sequence yet
+    Array<int> pendingDelayChannels, pendingDelays;
+
+    void addDelayOp (Array<void*>&, const int channel, const int numSamplesDelay)
+    {
+        pendingDelayChannels.add (channel);
+        pendingDelays.add (numSamplesDelay);
+    }
+
+    /** Adds the node's pending delays to the sequence as one op */
+    void flushDelayOps (Array<void*>& renderingOps)
+    {
+        if (pendingDelayChannels.isEmpty())
+            return;
+
+        const auto key = DelayChannelsOp::getReuseKeyFor (pendingDelayChannels, pendingDelays, doublePrecision);
+        if (auto* op = takeReusableOp<DelayChannelsOp> (key, [this] (const DelayChannelsOp& o) {
+                return o.canBeReusedFor (pendingDelayChannels, pendingDelays, doublePrecision); }))
+            renderingOps.add (op);
+        else
+            renderingOps.add (new DelayChannelsOp (pendingDelayChannels, pendingDelays, doublePrecision));
+
+        pendingDelayChannels.clearQuick();
+        pendingDelays.clearQuick();
+    }
+
+    /** Adds a buffer op for the current node. Pending delays only touch
+        their own channels, so they keep collecting until an op uses one */
+    void addOp (Array<void*>& renderingOps, Task* const op)
+    {
+        Array<int> audio, midi;
+        op->getBuffersUsed (audio, midi);
+        for (const auto channel : audio)
+        {
+            if (pendingDelayChannels.contains (channel))
+            {
+                flushDelayOps (renderingOps);
+                break;
+            }
+        }
+
+        renderingOps.add (op);
+    }
+
+    // the most recent process op and what it was created with. whether it
+    // feeds an oversampled signal forward is only known at the next node.
+    ProcessBufferOp* lastProcessOp = nullptr;
+    GraphNode* lastProcessNode = nullptr;
+    Array<int> lastAudioChannels;
+    int lastTotalChans = 0;
+    Array<int> lastChans [PortType::Unknown];
+    Array<void*> createdProcessOps;
+
+    void addProcessOp (Array<void*>& renderingOps, GraphNode* const node,
+                       const Array<int>& audioChannels, const int totalChans,
+                       const Array<int> chans [PortType::Unknown],
+                       ProcessBufferOp* const upstream)
+    {
+        const BigInteger unusedMidiOutputs (findUnusedMidiOutputs (*node));
+        const auto key = Task::makeReuseKey (Task::processReuse, node->nodeId);
+        ProcessBufferOp* op = takeReusableOp<ProcessBufferOp> (key, [&] (const ProcessBufferOp& o) {
+            return o.canBeReusedFor (node, audioChannels, totalChans, chans, upstream)
+                && o.getUnusedMidiOutputs() == unusedMidiOutputs
+                && o.isUsingDoublePrecision() == doublePrecision; });
+
+        if (op == nullptr)
+        {
+            op = new ProcessBufferOp (node, audioChannels, totalChans, 0, chans);
+            op->setUnusedMidiOutputs (unusedMidiOutputs);
+            op->setUpstream (upstream);
+            op->setDoublePrecision (doublePrecision, renderBufferSize);
+            op->prepareShedding (renderBufferSize);
+            createdProcessOps.add (op);
+        }
+
+        renderingOps.add (op);
+        op->publishMemory();
+
+        lastProcessOp     = op;
+        lastProcessNode   = node;
+        lastAudioChannels = audioChannels;
+        lastTotalChans    = totalChans;
+        for (int i = 0; i < PortType::Unknown; ++i)
+            lastChans[i] = chans[i];
+    }
 
-    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
+    /** Finds the MIDI outputs of a pipe node that nobody reads */
+    BigInteger findUnusedMidiOutputs (const GraphNode& node) const
+    {
+        BigInteger unused;
+        if (! node.wantsMidiPipe())
+            return unused;
+
+        for (int channel = (int) node.getNumPorts (PortType::Midi, false); --channel >= 0;)
+            if (! graph.hasConnectionFrom (node.nodeId, node.getPortForChannel (PortType::Midi, channel, false)))
+                unused.setBit (channel);
+        return unused;
+    }
 
-    void setNodeDelay (const uint32 nodeID, const int latency)
+    /** Decide whether the last process op leaves its output oversampled. An
+        op carried over from the previous sequence may still be rendering, so
+        it is swapped for a new one instead of being changed in place. */
+    ProcessBufferOp* settleLastProcessOp (Array<void*>& renderingOps, const bool feedsDownstream)
     {
-        const int index = nodeDelayIDs.indexOf (nodeID);
+        if (lastProcessOp == nullptr || lastProcessOp->isFeedingDownstream() == feedsDownstream)
+            return lastProcessOp;
 
-        if (index >= 0)
-        {
-            nodeDelays.set (index, latency);
-        }
-        else
+        if (! createdProcessOps.contains (lastProcessOp))
         {
-            nodeDelayIDs.add (nodeID);
-            nodeDelays.add (latency);
+            auto* const replacement = new ProcessBufferOp (lastProcessNode, lastAudioChannels,
+                                                           lastTotalChans, 0, lastChans);
+            replacement->setUnusedMidiOutputs (lastProcessOp->getUnusedMidiOutputs());
+            replacement->setUpstream (lastProcessOp->getUpstream());
+            replacement->setDoublePrecision (doublePrecision, renderBufferSize);
+            replacement->prepareShedding (renderBufferSize);
+            replacement->publishMemory();
+            renderingOps.set (renderingOps.indexOf (lastProcessOp), replacement);
+            addReusableOp (lastProcessOp);
+            createdProcessOps.add (replacement);
+            lastProcessOp = replacement;
         }
+
+        lastProcessOp->setFeedsDownstream (feedsDownstream);
+        return lastProcessOp;
+    }
+
+    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeID]; }
+
+    void setNodeDelay (const uint32 nodeID, const int latency)
+    {
+        nodeDelays.set (nodeID, latency);
     }
 
-    int getInputLatency (const uint32 nodeID) const
+    int getInputLatency (const GraphNode* const node, const uint32 nodeKey) const
     {
         int maxLatency = 0;
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
+        for (uint32 port = 0; port < node->getNumPorts(); ++port)
+            for (const auto sourceNode : getInputs (nodeKey, port).nodes)
+                maxLatency = jmax (maxLatency, getNodeDelay (sourceNode));
+
+        return maxLatency;
+    }
+
+    /** Returns true if a node can be rendered ahead of the callback. It has
+        to make audio without anything live reaching it, so nothing may be
+        connected to its inputs, and since its MIDI stays on the workers none
+        of its MIDI outputs may be connected either. Nodes with CV outputs
+        don't qualify, only audio is kept ahead */
+    bool canRenderAhead (GraphNode* const node, const uint32 nodeKey) const
+    {
+        auto* const proc = node->getAudioProcessor();
+        if (! node->isRenderingAhead() || proc == nullptr
+            || node->getNumPorts (PortType::Audio, false) <= 0
+            || node->getNumPorts (PortType::CV, false) > 0
+            || node->getOversamplingFactor() > 1 || node->wantsMidiPipe()
+            || dynamic_cast<GraphProcessor*> (proc) != nullptr
+            || dynamic_cast<GraphProcessor::AudioGraphIOProcessor*> (proc) != nullptr
+            || dynamic_cast<AuxBusNode*> (proc) != nullptr)
+            return false;
+
+        for (const auto& link : topology.links)
         {
-            const auto* const c = graph.getConnection (i);
-            if (c->destNode == nodeID)
-                maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNode));
+            if (link.destNode == nodeKey)
+                return false;
+            if (link.sourceNode == nodeKey && node->getPortType (link.sourcePort) == PortType::Midi)
+                return false;
         }
 
-        return maxLatency;
+        return true;
     }
 
-    void createRenderingOpsForNode (GraphNode* const node, Array<void*>& renderingOps,
-                                    const int ourRenderingIndex)
+    void createRenderingOpsForNode (GraphNode* const node, const uint32 nodeKey,
+                                    Array<void*>& renderingOps, const int ourRenderingIndex)
     {
         AudioProcessor* const proc (node->getAudioProcessor());
 
@@ -512,15 +2312,19 @@ private:
         }
         
         Array <int> channelsToUse [PortType::Unknown];
-        int maxLatency = getInputLatency (node->nodeId);
+        int maxLatency = getInputLatency (node, nodeKey);
+        const int numOpsBeforeNode = renderingOps.size();
 
         const uint32 numPorts (node->getNumPorts());
         for (uint32 port = 0; port < numPorts; ++port)
         {
             const PortType portType (node->getPortType (port));
-            if (portType != PortType::Audio && portType != PortType::Midi)
+            if (portType != PortType::Audio && portType != PortType::Midi && portType != PortType::CV)
                 continue;
 
+            // CV is sample rate data, its buffers come from the audio pool
+            const PortType bufferType (portType == PortType::CV ? PortType::Audio : portType);
+
             const uint32 numIns    = node->getNumPorts (portType, true);
             const uint32 numOuts   = node->getNumPorts (portType, false);
 
@@ -531,7 +2335,7 @@ private:
                 const int outputChan = node->getChannelPort (port);
                 if (outputChan >= (int)numIns && outputChan < (int)numOuts)
                 {
-                    const int bufIndex = getFreeBuffer (portType);
+                    const int bufIndex = getFreeBuffer (bufferType);
                     channelsToUse [portType.id()].add (bufIndex);
                     const uint32 outPort = node->getNthPort (portType, outputChan, false, false);
 
@@ -539,7 +2343,7 @@ private:
                     jassert (outPort == port);
                     jassert (outPort < node->getNumPorts());
 
-                    markBufferAsContaining (bufIndex, portType, node->nodeId, outPort);
+                    markBufferAsContaining (bufIndex, bufferType, nodeKey, outPort);
                 }
                 continue;
             }
@@ -549,38 +2353,29 @@ private:
             const int inputChan = node->getChannelPort (port);
 
             // get a list of all the inputs to this node
-            Array <uint32> sourceNodes;
-            Array <uint32> sourcePorts;
-            for (int i = graph.getNumConnections(); --i >= 0;)
-            {
-                const GraphProcessor::Connection* const c = graph.getConnection (i);
-
-                if (c->destNode == node->nodeId && c->destPort == port)
-                {
-                    sourceNodes.add (c->sourceNode);
-                    sourcePorts.add (c->sourcePort);
-                }
-            }
+            const PortInputs& portInputs = getInputs (nodeKey, port);
+            const Array <uint32>& sourceNodes = portInputs.nodes;
+            const Array <uint32>& sourcePorts = portInputs.ports;
 
             int bufIndex = -1;
             if (sourceNodes.size() == 0)
             {
                 // unconnected input channel
-                if (portType == PortType::Audio && inputChan >= (int)numOuts)
+                if (bufferType == PortType::Audio && inputChan >= (int)numOuts)
                 {
                     bufIndex = getReadOnlyEmptyBuffer();
                     jassert (bufIndex >= 0);
                 }
                 else
                 {
-                    bufIndex = getFreeBuffer (portType);
-                    switch (portType.id())
+                    bufIndex = getFreeBuffer (bufferType);
+                    switch (bufferType.id())
                     {
                         case PortType::Audio:
-                            renderingOps.add (new ClearChannelOp (bufIndex));
+                            addOp (renderingOps, new ClearChannelOp (bufIndex));
                             break;
                         case PortType::Midi:
-                            renderingOps.add (new ClearMidiBufferOp (bufIndex));
+                            addOp (renderingOps, new ClearMidiBufferOp (bufIndex));
                             break;
                         default:
                             break;
@@ -593,7 +2388,7 @@ private:
                 const uint32 srcNode = sourceNodes.getUnchecked (0);
                 const uint32 srcPort = sourcePorts.getUnchecked (0);
 
-                bufIndex = getBufferContaining (portType, srcNode, srcPort);
+                bufIndex = getBufferContaining (bufferType, srcNode, srcPort);
 
                 if (bufIndex < 0)
                 {
@@ -607,15 +2402,15 @@ private:
                 {
                     // can't mess up this channel because it's needed later by another node, so we
                     // need to use a copy of it..
-                    const int newFreeBuffer = getFreeBuffer (portType);
+                    const int newFreeBuffer = getFreeBuffer (bufferType);
 
-                    switch (portType.id())
+                    switch (bufferType.id())
                     {
                         case PortType::Audio:
-                            renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
+                            addOp (renderingOps, new CopyChannelOp (bufIndex, newFreeBuffer));
                             break;
                         case PortType::Midi:
-                            renderingOps.add (new CopyMidiBufferOp (bufIndex, newFreeBuffer));
+                            addOp (renderingOps, new CopyMidiBufferOp (bufIndex, newFreeBuffer));
                             break;
                         default:
                             break;
@@ -627,7 +2422,29 @@ private:
                 const int nodeDelay = getNodeDelay (srcNode);
 
                 if (nodeDelay < maxLatency)
-                    renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                    addDelayOp (renderingOps, bufIndex, maxLatency - nodeDelay);
+            }
+            else if (portType == PortType::Midi)
+            {
+                // several MIDI sources are merged into a buffer of their own
+                Array<int> srcIndexes;
+                for (int i = 0; i < sourceNodes.size(); ++i)
+                {
+                    const int srcIndex = getBufferContaining (bufferType, sourceNodes.getUnchecked (i),
+                                                                        sourcePorts.getUnchecked (i));
+                    if (srcIndex >= 0)
+                        srcIndexes.add (srcIndex);
+                }
+
+                bufIndex = getFreeBuffer (bufferType);
+                jassert (bufIndex != 0);
+                markBufferAsContaining (bufIndex, bufferType, anonymousNodeID, 0);
+
+                // sources not found are probably feedback loops
+                if (srcIndexes.isEmpty())
+                    addOp (renderingOps, new ClearMidiBufferOp (bufIndex));
+                else
+                    addOp (renderingOps, new MergeMidiBuffersOp (srcIndexes, bufIndex));
             }
             else
             {
@@ -637,7 +2454,7 @@ private:
 
                 for (int i = 0; i < sourceNodes.size(); ++i)
                 {
-                    const int sourceBufIndex = getBufferContaining (portType, sourceNodes.getUnchecked(i),
+                    const int sourceBufIndex = getBufferContaining (bufferType, sourceNodes.getUnchecked(i),
                                                                               sourcePorts.getUnchecked(i));
 
                     if (sourceBufIndex >= 0
@@ -650,11 +2467,11 @@ private:
                         reusableInputIndex = i;
                         bufIndex = sourceBufIndex;
 
-                        if (portType == PortType::Audio)
+                        if (bufferType == PortType::Audio)
                         {
                             const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (i));
                             if (nodeDelay < maxLatency)
-                                renderingOps.add (new DelayChannelOp (sourceBufIndex, maxLatency - nodeDelay));
+                                addDelayOp (renderingOps, sourceBufIndex, maxLatency - nodeDelay);
                         }
 
                         break;
@@ -664,36 +2481,36 @@ private:
                 if (reusableInputIndex < 0)
                 {
                     // can't re-use any of our input chans, so get a new one and copy everything into it..
-                    bufIndex = getFreeBuffer (portType);
+                    bufIndex = getFreeBuffer (bufferType);
                     jassert (bufIndex != 0);
                     
-                    markBufferAsContaining (bufIndex, portType, anonymousNodeID, 0);
+                    markBufferAsContaining (bufIndex, bufferType, anonymousNodeID, 0);
                     
-                    const int srcIndex = getBufferContaining (portType, sourceNodes.getUnchecked (0),
+                    const int srcIndex = getBufferContaining (bufferType, sourceNodes.getUnchecked (0),
                                                                         sourcePorts.getUnchecked (0));
                     if (srcIndex < 0)
                     {
                         // if not found, this is probably a feedback loop
-                        if (portType == PortType::Audio)
-                            renderingOps.add (new ClearChannelOp (bufIndex));
+                        if (bufferType == PortType::Audio)
+                            addOp (renderingOps, new ClearChannelOp (bufIndex));
                         else if (portType == PortType::Midi)
-                            renderingOps.add (new ClearMidiBufferOp (bufIndex));
+                            addOp (renderingOps, new ClearMidiBufferOp (bufIndex));
                     }
                     else
                     {
-                        if (portType == PortType::Audio)
-                            renderingOps.add (new CopyChannelOp (srcIndex, bufIndex));
+                        if (bufferType == PortType::Audio)
+                            addOp (renderingOps, new CopyChannelOp (srcIndex, bufIndex));
                         else if (portType == PortType::Midi)
-                            renderingOps.add (new CopyMidiBufferOp (srcIndex, bufIndex));
+                            addOp (renderingOps, new CopyMidiBufferOp (srcIndex, bufIndex));
                     }
 
                     reusableInputIndex = 0;
 
-                    if (portType == PortType::Audio)
+                    if (bufferType == PortType::Audio)
                     {
                         const int nodeDelay = getNodeDelay (sourceNodes.getFirst());
                         if (nodeDelay < maxLatency)
-                            renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                            addDelayOp (renderingOps, bufIndex, maxLatency - nodeDelay);
                     }
                 }
 
@@ -701,11 +2518,11 @@ private:
                 {
                     if (j != reusableInputIndex)
                     {
-                        int srcIndex = getBufferContaining (portType, sourceNodes.getUnchecked(j),
+                        int srcIndex = getBufferContaining (bufferType, sourceNodes.getUnchecked(j),
                                                                       sourcePorts.getUnchecked(j));
                         if (srcIndex >= 0)
                         {
-                            if (portType == PortType::Audio)
+                            if (bufferType == PortType::Audio)
                             {
                                 const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (j));
 
@@ -715,22 +2532,22 @@ private:
                                                                sourceNodes.getUnchecked(j),
                                                                sourcePorts.getUnchecked(j)))
                                     {
-                                        renderingOps.add (new DelayChannelOp (srcIndex, maxLatency - nodeDelay));
+                                        addDelayOp (renderingOps, srcIndex, maxLatency - nodeDelay);
                                     }
                                     else // buffer is reused elsewhere, can't be delayed
                                     {
                                         const int bufferToDelay = getFreeBuffer (PortType::Audio);
-                                        renderingOps.add (new CopyChannelOp (srcIndex, bufferToDelay));
-                                        renderingOps.add (new DelayChannelOp (bufferToDelay, maxLatency - nodeDelay));
+                                        addOp (renderingOps, new CopyChannelOp (srcIndex, bufferToDelay));
+                                        addDelayOp (renderingOps, bufferToDelay, maxLatency - nodeDelay);
                                         srcIndex = bufferToDelay;
                                     }
                                 }
 
-                                renderingOps.add (new AddChannelOp (srcIndex, bufIndex));
+                                addOp (renderingOps, new AddChannelOp (srcIndex, bufIndex));
                             }
                             else if (portType == PortType::Midi)
                             {
-                                renderingOps.add (new AddMidiBufferOp (srcIndex, bufIndex));
+                                addOp (renderingOps, new AddMidiBufferOp (srcIndex, bufIndex));
                             }
                         }
                     }
@@ -743,31 +2560,124 @@ private:
             if (inputChan < (int) numOuts)
             {
                 const int outputPort = node->getNthPort (portType, inputChan, false, false);
-                markBufferAsContaining (bufIndex, portType, node->nodeId, outputPort);
+                markBufferAsContaining (bufIndex, bufferType, nodeKey, outputPort);
             }
         } /* foreach port */
 
-        setNodeDelay (node->nodeId, maxLatency + node->getLatencySamples());
+        flushDelayOps (renderingOps);
+
+        int totalChans = jmax (node->getNumPorts (PortType::Audio, true),
+                               node->getNumPorts (PortType::Audio, false));
+
+        if (auto frozen = node->getFrozenAudio())
+        {
+            settleLastProcessOp (renderingOps, false);
+            lastProcessOp = nullptr;
+            setNodeDelay (nodeKey, maxLatency + node->getLatencySamples());
+            renderingOps.add (new FrozenPlaybackOp (node, frozen, channelsToUse [PortType::Audio],
+                                                    totalChans, channelsToUse));
+            return;
+        }
+
+        if (canRenderAhead (node, nodeKey))
+        {
+            settleLastProcessOp (renderingOps, false);
+            lastProcessOp = nullptr;
+            setNodeDelay (nodeKey, maxLatency + node->getLatencySamples());
+
+            const auto key = Task::makeReuseKey (Task::anticipatedReuse, node->nodeId);
+            auto* op = takeReusableOp<AnticipatedPlaybackOp> (key, [&] (const AnticipatedPlaybackOp& o) {
+                return o.canBeReusedFor (node, channelsToUse [PortType::Audio], totalChans, channelsToUse); });
+            if (op == nullptr)
+                op = new AnticipatedPlaybackOp (graph, node, channelsToUse [PortType::Audio],
+                                                totalChans, channelsToUse);
+            renderingOps.add (op);
+            return;
+        }
+
+        // a node processing the previous node's output in place at the same
+        // oversampling factor can share its up and down-sampling stages
+        const bool sharesOversampling = lastProcessOp != nullptr
+            && renderingOps.size() == numOpsBeforeNode
+            && renderingOps.getLast() == lastProcessOp
+            && lastProcessOp->canShareOversamplingWith (node, channelsToUse [PortType::Audio], totalChans);
+
+        ProcessBufferOp* const upstream = settleLastProcessOp (renderingOps, sharesOversampling);
+
+        // only one pair of conversion filters is in the chain
+        const int latency = node->getLatencySamples()
+            - (sharesOversampling ? node->getOversamplingLatencySamples() : 0);
+        setNodeDelay (nodeKey, maxLatency + latency);
         
         if (node->isAudioIONode() && node->getNumPorts (PortType::Audio, false) == 0)
             totalLatency = maxLatency;
 
-        int totalChans = jmax (node->getNumPorts (PortType::Audio, true),
-                               node->getNumPorts (PortType::Audio, false));
-        renderingOps.add (new ProcessBufferOp (node, channelsToUse [PortType::Audio],
-                                               totalChans, 0, channelsToUse));
+        addProcessOp (renderingOps, node, channelsToUse [PortType::Audio],
+                      totalChans, channelsToUse, sharesOversampling ? upstream : nullptr);
+    }
+
+    /** Walks the connections once to find the inputs of every port and the
+        last step reading each node output */
+    void analyseLiveness()
+    {
+        HeapBlock<int> steps;
+        steps.calloc ((size_t) jmax (1, topology.nodes.size()));
+        for (int i = 0; i < order.size(); ++i)
+            steps [order.getUnchecked (i)] = i;
+
+        for (int i = topology.links.size(); --i >= 0;)
+        {
+            const RenderTopology::Link* const c = &topology.links.getReference (i);
+
+            const int64 destKey = getPortKey (c->destNode, c->destPort);
+            if (! inputIndexes.contains (destKey))
+            {
+                inputIndexes.set (destKey, inputs.size());
+                inputs.add (new PortInputs());
+            }
+
+            auto* const portInputs = inputs.getUnchecked (inputIndexes [destKey]);
+            portInputs->nodes.add (c->sourceNode);
+            portInputs->ports.add (c->sourcePort);
+
+            const int step = steps [(int) c->destNode];
+            const int64 sourceKey = getPortKey (c->sourceNode, c->sourcePort);
+            Liveness live = liveness [sourceKey];
+
+            if (step > live.lastStep)
+            {
+                live.lastStep = step;
+                live.lastPort = c->destPort;
+                live.manyLastPorts = false;
+            }
+            else if (step == live.lastStep && c->destPort != live.lastPort)
+            {
+                live.manyLastPorts = true;
+            }
+
+            liveness.set (sourceKey, live);
+        }
+    }
+
+    const PortInputs& getInputs (const uint32 nodeId, const uint32 port) const
+    {
+        const int64 key = getPortKey (nodeId, port);
+        return inputIndexes.contains (key) ? *inputs.getUnchecked (inputIndexes [key]) : noInputs;
     }
 
     int getFreeBuffer (PortType type)
     {
         jassert (type.id() < PortType::Unknown);
 
-        Array<uint32>& nodes = allNodes [type.id()];
-        for (int i = 1; i < nodes.size(); ++i)
-            if (nodes.getUnchecked(i) == freeNodeID)
-                return i;
+        // a free buffer stays free until something is marked as being in it
+        SortedSet<int>& freeSlots = freeBuffers [type.id()];
+        if (! freeSlots.isEmpty())
+            return freeSlots.getFirst();
 
+        Array<uint32>& nodes = allNodes [type.id()];
         nodes.add ((uint32) freeNodeID);
+        allPorts [type.id()].add (KV_INVALID_PORT);
+        freeSlots.add (nodes.size() - 1);
         return nodes.size() - 1;
     }
 
@@ -777,76 +2687,728 @@ private:
     }
 
     int32 getBufferContaining (const PortType type, const uint32 nodeId, const uint32 outputPort) noexcept
+    {
+        const int64 key = getPortKey (nodeId, outputPort);
+        const HashMap<int64, int>& containing = bufferContaining [type.id()];
+        return containing.contains (key) ? containing [key] : -1;
+    }
+
+    void markUnusedBuffersFree (const int stepIndex)
+    {
+        for (uint32 type = 0; type < PortType::Unknown; ++type)
+        {
+            Array<uint32>& nodes = allNodes [type];
+            Array<uint32>& ports = allPorts [type];
+
+            for (int i = 1; i < nodes.size(); ++i)
+            {
+                const uint32 nodeId = nodes.getUnchecked (i);
+                if (! isNodeBusy (nodeId))
+                    continue;
+
+                // the interval of an output ends at the last step reading it
+                const int64 key = getPortKey (nodeId, ports.getUnchecked (i));
+                if (nodeId == anonymousNodeID || liveness [key].lastStep <= stepIndex)
+                    setBufferFree (type, i);
+            }
+        }
+    }
+
+    bool isBufferNeededLater (int stepIndexToSearchFrom, uint32 inputChannelOfIndexToIgnore,
+                              const uint32 sourceNode, const uint32 outputPortIndex) const
+    {
+        const int64 key = getPortKey (sourceNode, outputPortIndex);
+        if (! liveness.contains (key))
+            return false;
+
+        const Liveness live = liveness [key];
+        if (live.lastStep != stepIndexToSearchFrom)
+            return live.lastStep > stepIndexToSearchFrom;
+
+        // the last reader is the node being built, some other port of it
+        // still needs the buffer
+        return live.manyLastPorts || live.lastPort != inputChannelOfIndexToIgnore;
+    }
+
+    void markBufferAsContaining (int bufferNum, PortType type, uint32 nodeId, uint32 portIndex)
     {
         Array<uint32>& nodes = allNodes [type.id()];
         Array<uint32>& ports = allPorts [type.id()];
 
-        for (int i = nodes.size(); --i >= 0;)
-            if (nodes.getUnchecked(i) == nodeId
-                 && ports.getUnchecked(i) == outputPort)
-                return i;
+        jassert (bufferNum >= 0 && bufferNum < nodes.size());
+        forgetContents (type.id(), bufferNum);
+
+        nodes.set (bufferNum, nodeId);
+        ports.set (bufferNum, portIndex);
+        freeBuffers[type.id()].removeValue (bufferNum);
+        if (nodeId != anonymousNodeID && isNodeBusy (nodeId))
+            bufferContaining[type.id()].set (getPortKey (nodeId, portIndex), bufferNum);
+    }
+
+    void setBufferFree (const uint32 type, const int bufferNum)
+    {
+        forgetContents (type, bufferNum);
+        allNodes[type].set (bufferNum, (uint32) freeNodeID);
+        freeBuffers[type].add (bufferNum);
+    }
+
+    void forgetContents (const uint32 type, const int bufferNum)
+    {
+        const uint32 nodeId = allNodes[type].getUnchecked (bufferNum);
+        if (nodeId == anonymousNodeID || ! isNodeBusy (nodeId))
+            return;
+
+        const int64 key = getPortKey (nodeId, allPorts[type].getUnchecked (bufferNum));
+        HashMap<int64, int>& containing = bufferContaining [type];
+        if (containing.contains (key) && containing [key] == bufferNum)
+            containing.remove (key);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessorGraphBuilder)
+};
+
+/** Splits a rendering sequence into one stage per node and works out which
+    stages can run at the same time.  Two stages depend on each other if they
+    touch the same shared buffer, so running them in dependency order gives
+    exactly the same result as the serial sequence. */
+class ParallelRender : public RenderJob
+{
+public:
+    ParallelRender (const Array<void*>& ops, const Instruction* compiledCode,
+                    const Array<int>& stageEnds)
+        : code (compiledCode)
+    {
+        setNumStages (stageEnds.size());
+
+        HashMap<int, int> lastAudioStage, lastMidiStage;
+        int lastIOStage = -1;
+        int begin = 0;
+
+        for (int stage = 0; stage < stageEnds.size(); ++stage)
+        {
+            const int end = stageEnds.getUnchecked (stage);
+            Array<int> audio, midi;
+            bool graphIO = false;
+
+            for (int i = begin; i < end; ++i)
+            {
+                const auto* const task = static_cast<const Task*> (ops.getUnchecked (i));
+                task->getBuffersUsed (audio, midi);
+                graphIO |= task->touchesGraphIO();
+            }
+
+            for (const auto index : audio)
+            {
+                // audio buffer zero is read-only silence
+                if (index == 0)
+                    continue;
+                if (lastAudioStage.contains (index))
+                    addDependency (lastAudioStage [index], stage);
+                lastAudioStage.set (index, stage);
+            }
+
+            for (const auto index : midi)
+            {
+                if (lastMidiStage.contains (index))
+                    addDependency (lastMidiStage [index], stage);
+                lastMidiStage.set (index, stage);
+            }
+
+            if (graphIO)
+            {
+                if (lastIOStage >= 0)
+                    addDependency (lastIOStage, stage);
+                lastIOStage = stage;
+            }
+
+            stageBegins.add (begin);
+            begin = end;
+        }
+
+        stageEndIndexes = stageEnds;
+    }
+
+    /** Returns the stage the op at this index renders in */
+    int findStage (const int index) const noexcept
+    {
+        for (int stage = 0; stage < stageEndIndexes.size(); ++stage)
+            if (index < stageEndIndexes.getUnchecked (stage))
+                return stage;
+        return stageEndIndexes.size() - 1;
+    }
+
+    void setBuffers (AudioSampleBuffer& audio, const OwnedArray<MidiBuffer>& midi,
+                     uint8* silence, const int samples) noexcept
+    {
+        silentBuffers = silence;
+        sharedAudio = &audio;
+        sharedDoubleAudio = nullptr;
+        sharedMidi  = &midi;
+        numSamples  = samples;
+    }
+
+    void setBuffers (AudioBuffer<double>& audio, const OwnedArray<MidiBuffer>& midi,
+                     uint8* silence, const int samples) noexcept
+    {
+        silentBuffers = silence;
+        sharedAudio = nullptr;
+        sharedDoubleAudio = &audio;
+        sharedMidi  = &midi;
+        numSamples  = samples;
+    }
+
+protected:
+    void renderStage (int stage) noexcept override
+    {
+        if (sharedDoubleAudio != nullptr)
+            renderInstructions (code + stageBegins.getUnchecked (stage),
+                                code + stageEndIndexes.getUnchecked (stage),
+                                *sharedDoubleAudio, *sharedMidi, numSamples, silentBuffers);
+        else
+            renderInstructions (code + stageBegins.getUnchecked (stage),
+                                code + stageEndIndexes.getUnchecked (stage),
+                                *sharedAudio, *sharedMidi, numSamples, silentBuffers);
+    }
+
+private:
+    const Instruction* const code;
+    Array<int> stageBegins, stageEndIndexes;
+    AudioSampleBuffer* sharedAudio = nullptr;
+    AudioBuffer<double>* sharedDoubleAudio = nullptr;
+    uint8* silentBuffers = nullptr;
+    const OwnedArray<MidiBuffer>* sharedMidi = nullptr;
+    int numSamples = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ParallelRender)
+};
+
+/** Cuts a rendering sequence into stages that each render a block behind the
+    one before, so all of them can run at the same time on different cores.
+
+    Every stage after the first has its own copy of the shared buffers. Once
+    a block is rendered, the buffers a stage picks up from the earlier ones
+    are handed down to it, ready for the next block. Graph inputs are only
+    read in the first stage and outputs only written in the last, so the
+    whole graph is late by one block per cut and stays lined up. Nodes
+    sharing other IO, such as aux buses and devices, stay in one stage. */
+class PipelineRender : public RenderJob
+{
+public:
+    /** Returns where to cut the ops into at most numStages stages with about
+        the same number of nodes in each, or nothing if it can't be cut */
+    static Array<int> findStageEnds (const Array<void*>& ops, const int numStages)
+    {
+        const int numOps = ops.size();
+        int lastInput = -1, firstOutput = numOps, firstOther = numOps, lastOther = -1, totalCost = 0;
+
+        for (int i = 0; i < numOps; ++i)
+        {
+            const auto* const task = static_cast<const Task*> (ops.getUnchecked (i));
+            totalCost += task->getRenderCost();
+            switch (task->getGraphIO())
+            {
+                case Task::GraphIO::input:  lastInput = i; break;
+                case Task::GraphIO::output: firstOutput = jmin (firstOutput, i); break;
+                case Task::GraphIO::other:  firstOther = jmin (firstOther, i); lastOther = i; break;
+                default: break;
+            }
+        }
+
+        Array<int> stageEnds;
+        if (numStages < 2 || totalCost < 2)
+            return stageEnds;
+
+        // a stage starting at index begins there, after every input and no later than the first output
+        auto canCut = [&] (const int index)
+        {
+            return index > lastInput && index <= firstOutput
+                && (index <= firstOther || index > lastOther)
+                && ! static_cast<const Task*> (ops.getUnchecked (index))->continuesPrevious();
+        };
+
+        int cost = 0;
+        for (int i = 0; i < numOps && stageEnds.size() < numStages - 1; ++i)
+        {
+            if (cost * numStages >= totalCost * (stageEnds.size() + 1) && i > 0 && canCut (i))
+                stageEnds.add (i);
+            cost += static_cast<const Task*> (ops.getUnchecked (i))->getRenderCost();
+        }
+
+        if (stageEnds.isEmpty())
+            return stageEnds;
+        stageEnds.add (numOps);
+        return stageEnds;
+    }
+
+    PipelineRender (const Array<void*>& ops, const Instruction* compiledCode, const Array<int>& stageEnds)
+        : code (compiledCode), stageEndIndexes (stageEnds)
+    {
+        setNumStages (stageEnds.size());
+
+        // what each stage touches, to work out what it picks up from the ones before
+        Array<Array<int>> audioUsed, midiUsed;
+        int begin = 0;
+        for (const auto end : stageEnds)
+        {
+            Array<int> audio, midi;
+            for (int i = begin; i < end; ++i)
+                static_cast<const Task*> (ops.getUnchecked (i))->getBuffersUsed (audio, midi);
+            audioUsed.add (audio);
+            midiUsed.add (midi);
+            stageBegins.add (begin);
+            begin = end;
+        }
+
+        // a buffer is handed down into a stage if one before it used it and
+        // it or one after still does. audio zero is always silent
+        handedAudio.resize (stageEnds.size());
+        handedMidi.resize (stageEnds.size());
+        for (int stage = 1; stage < stageEnds.size(); ++stage)
+        {
+            Array<int> before, beforeMidi;
+            for (int s = 0; s < stage; ++s)
+            {
+                before.addArray (audioUsed.getReference (s));
+                beforeMidi.addArray (midiUsed.getReference (s));
+            }
+
+            for (int s = stage; s < stageEnds.size(); ++s)
+            {
+                for (const auto index : audioUsed.getReference (s))
+                    if (index != 0 && before.contains (index))
+                        handedAudio.getReference (stage).addIfNotAlreadyThere (index);
+                for (const auto index : midiUsed.getReference (s))
+                    if (beforeMidi.contains (index))
+                        handedMidi.getReference (stage).addIfNotAlreadyThere (index);
+            }
+        }
+    }
+
+    /** Allocates the buffers of every stage after the first, which renders
+        into the program's own. Returns the bytes they hold */
+    int64 prepareBuffers (const int numAudioBuffers, const int numMidiBuffers, const bool useDouble)
+    {
+        const int numChannels = jmax (1, numAudioBuffers);
+        doublePrecision = useDouble;
+        stages.clear();
+        stages.add (nullptr);
+
+        for (int stage = 1; stage < getNumStages(); ++stage)
+        {
+            auto* const buffers = stages.add (new Buffers());
+            if (doublePrecision)
+                buffers->doubleAudio.setSize (numChannels, renderBufferSize);
+            else
+                buffers->audio.setSize (numChannels, renderBufferSize);
+            buffers->doubleAudio.clear();
+            buffers->audio.clear();
+            buffers->silence.allocate ((size_t) numChannels, false);
+            memset (buffers->silence.getData(), 1, (size_t) numChannels);
+            for (int i = 0; i < numMidiBuffers; ++i)
+                MidiBudget::reserve (*buffers->midi.add (new MidiBuffer()));
+        }
+
+        return (int64) (getNumStages() - 1)
+            * ((int64) numChannels * renderBufferSize * (int64) (useDouble ? sizeof (double) : sizeof (float))
+                + (int64) numChannels + (int64) numMidiBuffers * MidiBudget::getMaxBytesPerBlock());
+    }
+
+    /** Returns the stage the op at this index renders in */
+    int findStage (const int index) const noexcept
+    {
+        for (int stage = 0; stage < stageEndIndexes.size(); ++stage)
+            if (index < stageEndIndexes.getUnchecked (stage))
+                return stage;
+        return stageEndIndexes.size() - 1;
+    }
+
+    /** Renders each stage a block behind the one before it, then hands the
+        buffers down for the next block */
+    template<typename SampleType>
+    void render (AudioBuffer<SampleType>& firstAudio, const OwnedArray<MidiBuffer>& firstMidi,
+                 uint8* firstSilence, RenderThreadPool* pool, const int samples) noexcept
+    {
+        first.set (firstAudio, firstMidi, firstSilence);
+        numSamples = samples;
+
+        if (pool != nullptr && pool->getNumWorkers() > 0 && ! pool->isRenderingThread())
+            pool->render (*this);
+        else
+            for (int stage = 0; stage < getNumStages(); ++stage)
+                renderStage (stage);
+
+        // from the back, so nothing is overwritten before it's passed on
+        for (int stage = getNumStages(); --stage > 0;)
+            handDown (stage);
+    }
+
+protected:
+    void renderStage (int stage) noexcept override
+    {
+        const auto& buffers = getBuffers (stage);
+        const auto* const begin = code + stageBegins.getUnchecked (stage);
+        const auto* const end   = code + stageEndIndexes.getUnchecked (stage);
+        if (doublePrecision)
+            renderInstructions (begin, end, *buffers.doubleAudio, *buffers.midi, numSamples, buffers.silence);
+        else
+            renderInstructions (begin, end, *buffers.audio, *buffers.midi, numSamples, buffers.silence);
+    }
+
+private:
+    struct Buffers
+    {
+        Buffers() : audio (1, 1), doubleAudio (1, 1) { }
+        AudioSampleBuffer audio;
+        AudioBuffer<double> doubleAudio;
+        OwnedArray<MidiBuffer> midi;
+        HeapBlock<uint8> silence;
+    };
+
+    /** The buffers a stage renders into */
+    struct View
+    {
+        AudioSampleBuffer* audio = nullptr;
+        AudioBuffer<double>* doubleAudio = nullptr;
+        const OwnedArray<MidiBuffer>* midi = nullptr;
+        uint8* silence = nullptr;
+
+        void set (AudioSampleBuffer& a, const OwnedArray<MidiBuffer>& m, uint8* s) noexcept
+        {
+            audio = &a; midi = &m; silence = s;
+        }
+
+        void set (AudioBuffer<double>& a, const OwnedArray<MidiBuffer>& m, uint8* s) noexcept
+        {
+            doubleAudio = &a; midi = &m; silence = s;
+        }
+    };
+
+    const Instruction* const code;
+    Array<int> stageBegins, stageEndIndexes;
+    Array<Array<int>> handedAudio, handedMidi;
+    OwnedArray<Buffers> stages;
+    View first;
+    int numSamples = 0;
+    bool doublePrecision = false;
+
+    View getBuffers (const int stage) const noexcept
+    {
+        if (stage == 0)
+            return first;
+
+        auto* const buffers = stages.getUnchecked (stage);
+        View view;
+        view.audio = &buffers->audio;
+        view.doubleAudio = &buffers->doubleAudio;
+        view.midi = &buffers->midi;
+        view.silence = buffers->silence.getData();
+        return view;
+    }
+
+    void copyChannel (const View& to, const View& from, const int index, const bool clear) noexcept
+    {
+        if (doublePrecision)
+        {
+            if (clear)
+                FloatVectorOperations::clear (to.doubleAudio->getWritePointer (index), numSamples);
+            else
+                FloatVectorOperations::copy (to.doubleAudio->getWritePointer (index), from.doubleAudio->getReadPointer (index), numSamples);
+        }
+        else
+        {
+            if (clear)
+                FloatVectorOperations::clear (to.audio->getWritePointer (index), numSamples);
+            else
+                FloatVectorOperations::copy (to.audio->getWritePointer (index), from.audio->getReadPointer (index), numSamples);
+        }
+    }
+
+    void handDown (const int stage) noexcept
+    {
+        const auto from = getBuffers (stage - 1);
+        const auto to   = getBuffers (stage);
+
+        // like copyAudio, silence just needs clearing once
+        for (const auto index : handedAudio.getReference (stage))
+        {
+            if (from.silence[index] == 0)
+                copyChannel (to, from, index, false);
+            else if (to.silence[index] == 0)
+                copyChannel (to, from, index, true);
+            to.silence[index] = from.silence[index];
+        }
+
+        for (const auto index : handedMidi.getReference (stage))
+            MidiBudget::copyEvents (*to.midi->getUnchecked (index), *from.midi->getUnchecked (index));
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (PipelineRender)
+};
+
+/** A fully prepared rendering sequence along with the buffers it renders
+    into.  Programs are immutable once published to the audio thread. */
+class RenderProgram
+{
+public:
+    RenderProgram() : audio (1, 1), doubleAudio (1, 1) { }
+
+    ~RenderProgram()
+    {
+        parallel.reset();
+        pipeline.reset();
+        for (int i = ops.size(); --i >= 0;)
+            static_cast<Task*> (ops.getUnchecked (i))->decReferenceCount();
+    }
+
+    /** Takes a reference to every op in the sequence. Call once after building */
+    void retainOps()
+    {
+        for (auto* const op : ops)
+            static_cast<Task*> (op)->incReferenceCount();
+    }
+
+    /** Retires every op, or brings them back. Ops the other program shares
+        are left alone */
+    void setOpsRetired (const bool retired, const RenderProgram* const other = nullptr)
+    {
+        for (auto* const op : ops)
+            if (other == nullptr || ! other->ops.contains (op))
+                static_cast<Task*> (op)->setRetired (retired);
+    }
+
+    /** Flattens the ops into a single instruction array. Call before publishing */
+    void compile()
+    {
+        numInstructions = ops.size();
+        code.calloc ((size_t) jmax (1, numInstructions));
+        for (int i = 0; i < numInstructions; ++i)
+            static_cast<Task*> (ops.getUnchecked (i))->compile (code[i]);
+    }
+
+    const Instruction* getCode() const noexcept { return code.getData(); }
+
+    /** Allocate and clear the shared buffers in the given precision. Call
+        before publishing */
+    void prepareBuffers (const int numAudioBuffers, const int numMidiBuffers, const bool useDouble)
+    {
+        doublePrecision = useDouble;
+        const int numChannels = jmax (1, numAudioBuffers);
+        if (doublePrecision)
+        {
+            doubleAudio.setSize (numChannels, renderBufferSize);
+            doubleAudio.clear();
+        }
+        else
+        {
+            audio.setSize (numChannels, renderBufferSize);
+            audio.clear();
+        }
 
-        return -1;
+        silence.allocate ((size_t) numChannels, false);
+        memset (silence.getData(), 1, (size_t) numChannels);
+        while (midi.size() < numMidiBuffers)
+            midi.add (new MidiBuffer());
+        for (auto* buffer : midi)
+            MidiBudget::reserve (*buffer);
+
+        memoryBytes = (int64) numChannels * renderBufferSize
+                        * (int64) (doublePrecision ? sizeof (double) : sizeof (float))
+                    + (int64) numChannels
+                    + (int64) midi.size() * MidiBudget::getMaxBytesPerBlock();
     }
 
-    void markUnusedBuffersFree (const int stepIndex)
+    bool isUsingDoublePrecision() const noexcept { return doublePrecision; }
+
+    /** Returns the compiled sequence, in render order, as an array with one
+        object per instruction, along with the shared buffers it uses. Call
+        this on the message thread while the program is published */
+    var describe() const
     {
-        for (uint32 type = 0; type < PortType::Unknown; ++type)
+        static const char* const bufferOps[] = {
+            "clearAudio", "copyAudio", "addAudio", "clearMidi", "copyMidi", "addMidi"
+        };
+
+        Array<var> items;
+        for (int i = 0; i < numInstructions; ++i)
         {
-            Array<uint32>& nodes = allNodes [type];
-            Array<uint32>& ports = allPorts [type];
+            const auto& instruction = code[i];
+            DynamicObject::Ptr info (new DynamicObject());
 
-            for (int i = 0; i < nodes.size(); ++i)
+            if (instruction.opcode == Instruction::performTask)
             {
-                if (isNodeBusy (nodes.getUnchecked (i))
-                     && ! isBufferNeededLater (stepIndex, KV_INVALID_PORT,
-                                                          nodes.getUnchecked(i),
-                                                          ports.getUnchecked(i)))
-                {
-                    nodes.set (i, (uint32) freeNodeID);
-                }
+                Array<int> audioUsed, midiUsed;
+                instruction.task->getBuffersUsed (audioUsed, midiUsed);
+                instruction.task->describe (*info);
+                info->setProperty ("audio", toVar (audioUsed));
+                info->setProperty ("midi", toVar (midiUsed));
+            }
+            else
+            {
+                info->setProperty ("op", bufferOps [instruction.opcode]);
+                if (instruction.opcode != Instruction::clearAudio && instruction.opcode != Instruction::clearMidi)
+                    info->setProperty ("source", instruction.source);
+                info->setProperty ("dest", instruction.dest);
             }
+
+            if (parallel != nullptr)
+                info->setProperty ("stage", parallel->findStage (i));
+            else if (pipeline != nullptr)
+                info->setProperty ("stage", pipeline->findStage (i));
+            items.add (var (info.get()));
         }
+
+        DynamicObject::Ptr result (new DynamicObject());
+        result->setProperty ("audioBuffers", doublePrecision ? doubleAudio.getNumChannels() : audio.getNumChannels());
+        result->setProperty ("midiBuffers", midi.size());
+        result->setProperty ("doublePrecision", doublePrecision);
+        result->setProperty ("parallel", parallel != nullptr);
+        result->setProperty ("pipelineStages", pipeline != nullptr ? pipeline->getNumStages() : 1);
+        result->setProperty ("latency", latencySamples);
+        result->setProperty ("memoryBytes", memoryBytes);
+        result->setProperty ("ops", items);
+        return var (result.get());
     }
 
-    bool isBufferNeededLater (int stepIndexToSearchFrom, uint32 inputChannelOfIndexToIgnore,
-                              const uint32 sourceNode, const uint32 outputPortIndex) const
+    template<typename SampleType>
+    void render (AudioBuffer<SampleType>& sharedAudio, RenderThreadPool* pool, const int numSamples) noexcept
     {
-        while (stepIndexToSearchFrom < orderedNodes.size())
+        if (pipeline != nullptr)
         {
-            const GraphNode* const node = (const GraphNode*) orderedNodes.getUnchecked (stepIndexToSearchFrom);
-
-            {
-                for (uint32 port = 0; port < node->getNumPorts(); ++port)
-                {
-                    if (port != inputChannelOfIndexToIgnore &&
-                          graph.getConnectionBetween (sourceNode, outputPortIndex, node->nodeId, port) != nullptr)
-                    {
-                        return true;
-                    }
-                }
-            }
+            pipeline->render (sharedAudio, midi, silence, pool, numSamples);
+            return;
+        }
 
-            inputChannelOfIndexToIgnore = KV_INVALID_PORT;
-            ++stepIndexToSearchFrom;
+        if (parallel != nullptr && pool != nullptr
+            && pool->getNumWorkers() > 0 && ! pool->isRenderingThread())
+        {
+            parallel->setBuffers (sharedAudio, midi, silence, numSamples);
+            pool->render (*parallel);
+            return;
         }
 
-        return false;
+        renderInstructions (code.getData(), code.getData() + numInstructions,
+                            sharedAudio, midi, numSamples, silence);
     }
 
-    void markBufferAsContaining (int bufferNum, PortType type, uint32 nodeId, uint32 portIndex)
+    /** Renders a block. Returns false if the program was built for the other precision */
+    bool render (RenderThreadPool* pool, const int numSamples, const bool useDouble) noexcept
     {
-        Array<uint32>& nodes = allNodes [type.id()];
-        Array<uint32>& ports = allPorts [type.id()];
+        if (useDouble != doublePrecision)
+            return false;
 
-        jassert (bufferNum >= 0 && bufferNum < nodes.size());
-        nodes.set (bufferNum, nodeId);
-        ports.set (bufferNum, portIndex);
+        if (doublePrecision)
+            render (doubleAudio, pool, numSamples);
+        else
+            render (audio, pool, numSamples);
+        return true;
     }
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessorGraphBuilder)
+    Array<void*> ops;
+    std::unique_ptr<ParallelRender> parallel;
+    std::unique_ptr<PipelineRender> pipeline;
+
+    // hash of the graph topology this program was built for
+    int64 topologyHash = 0;
+
+    // what the graph reports while this program renders, so a cached one
+    // coming back doesn't need its latency worked out again
+    int latencySamples = 0;
+
+    // bytes held by the shared buffers, as of preparing them
+    int64 memoryBytes = 0;
+
+private:
+    HeapBlock<Instruction> code;
+    int numInstructions = 0;
+    bool doublePrecision = false;
+    AudioSampleBuffer audio;
+    AudioBuffer<double> doubleAudio;
+    HeapBlock<uint8> silence;
+    OwnedArray<MidiBuffer> midi;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderProgram)
 };
 
+static inline void runTask (Task* task, AudioSampleBuffer& audio, const OwnedArray<MidiBuffer>& midi,
+                                const int numSamples, uint8* silentBuffers) noexcept
+{
+    task->performWithSilence (audio, midi, numSamples, silentBuffers);
+}
+
+static inline void runTask (Task* task, AudioBuffer<double>& audio, const OwnedArray<MidiBuffer>& midi,
+                                const int numSamples, uint8* silentBuffers) noexcept
+{
+    task->performDouble (audio, midi, numSamples, silentBuffers);
+}
+
+template<typename SampleType>
+static void renderInstructionsT (const Instruction* begin, const Instruction* end,
+                                 AudioBuffer<SampleType>& audio, const OwnedArray<MidiBuffer>& midi,
+                                 const int numSamples, uint8* silentBuffers) noexcept
+{
+    SampleType* const* const chans = audio.getArrayOfWritePointers();
+
+    for (const auto* i = begin; i != end; ++i)
+    {
+        switch (i->opcode)
+        {
+            case Instruction::clearAudio:
+                if (silentBuffers [i->dest] == 0)
+                {
+                    FloatVectorOperations::clear (chans [i->dest], numSamples);
+                    silentBuffers [i->dest] = 1;
+                }
+                break;
+            case Instruction::copyAudio:
+                if (silentBuffers [i->source] != 0)
+                {
+                    if (silentBuffers [i->dest] == 0)
+                        FloatVectorOperations::clear (chans [i->dest], numSamples);
+                }
+                else
+                {
+                    FloatVectorOperations::copy (chans [i->dest], chans [i->source], numSamples);
+                }
+                silentBuffers [i->dest] = silentBuffers [i->source];
+                break;
+            case Instruction::addAudio:
+                if (silentBuffers [i->source] == 0)
+                {
+                    FloatVectorOperations::add (chans [i->dest], chans [i->source], numSamples);
+                    silentBuffers [i->dest] = 0;
+                }
+                break;
+            case Instruction::clearMidi:
+                midi.getUnchecked (i->dest)->clear();
+                break;
+            case Instruction::copyMidi:
+                MidiBudget::copyEvents (*midi.getUnchecked (i->dest), *midi.getUnchecked (i->source));
+                break;
+            case Instruction::addMidi:
+                MidiBudget::addEvents (*midi.getUnchecked (i->dest), *midi.getUnchecked (i->source), numSamples);
+                break;
+            case Instruction::performTask:
+            default:
+                runTask (i->task, audio, midi, numSamples, silentBuffers);
+                break;
+        }
+    }
+}
+
+void renderInstructions (const Instruction* begin, const Instruction* end,
+                         AudioSampleBuffer& audio, const OwnedArray<MidiBuffer>& midi,
+                         const int numSamples, uint8* silentBuffers) noexcept
+{
+    renderInstructionsT (begin, end, audio, midi, numSamples, silentBuffers);
+}
+
+void renderInstructions (const Instruction* begin, const Instruction* end,
+                         AudioBuffer<double>& audio, const OwnedArray<MidiBuffer>& midi,
+                         const int numSamples, uint8* silentBuffers) noexcept
+{
+    renderInstructionsT (begin, end, audio, midi, numSamples, silentBuffers);
+}
+
 }
 
 GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 sourcePort_,
@@ -860,22 +3422,107 @@ GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 s
        .setProperty (Tags::destPort, (int) destPort, nullptr);
 }
     
+/** Connections grouped by the pair of nodes they join and by the node at
+    each end, kept in step with the sorted connection list so queries don't
+    have to walk every connection in the graph */
+class GraphProcessor::ConnectionIndex
+{
+public:
+    ConnectionIndex() = default;
+
+    void add (const Connection* const c)
+    {
+        pairs [getPairKey (c->sourceNode, c->destNode)].add (c);
+        outputs [c->sourceNode].add (c);
+        inputs [c->destNode].add (c);
+    }
+
+    void remove (const Connection* const c)
+    {
+        removeFrom (pairs, getPairKey (c->sourceNode, c->destNode), c);
+        removeFrom (outputs, c->sourceNode, c);
+        removeFrom (inputs, c->destNode, c);
+    }
+
+    void clear()
+    {
+        pairs.clear();
+        outputs.clear();
+        inputs.clear();
+    }
+
+    const Connection* find (const uint32 sourceNode, const uint32 sourcePort,
+                            const uint32 destNode, const uint32 destPort) const
+    {
+        for (const auto* c : getBetween (sourceNode, destNode))
+            if (c->sourcePort == sourcePort && c->destPort == destPort)
+                return c;
+        return nullptr;
+    }
+
+    /** Returns the connections from one node to another */
+    const Array<const Connection*>& getBetween (const uint32 sourceNode, const uint32 destNode) const
+    {
+        return get (pairs, getPairKey (sourceNode, destNode));
+    }
+
+    /** Returns the connections feeding a node */
+    const Array<const Connection*>& getInputs (const uint32 nodeId) const    { return get (inputs, nodeId); }
+
+    /** Returns the connections leaving a node */
+    const Array<const Connection*>& getOutputs (const uint32 nodeId) const   { return get (outputs, nodeId); }
+
+private:
+    using List = Array<const Connection*>;
+    std::unordered_map<uint64, List> pairs;
+    std::unordered_map<uint32, List> outputs, inputs;
+    const List empty;
+
+    static uint64 getPairKey (const uint32 sourceNode, const uint32 destNode) noexcept
+    {
+        return ((uint64) sourceNode << 32) | (uint64) destNode;
+    }
+
+    template<typename Key>
+    const List& get (const std::unordered_map<Key, List>& map, const Key key) const
+    {
+        const auto iter = map.find (key);
+        return iter != map.end() ? iter->second : empty;
+    }
+
+    template<typename Key>
+    static void removeFrom (std::unordered_map<Key, List>& map, const Key key, const Connection* const c)
+    {
+        const auto iter = map.find (key);
+        if (iter == map.end())
+            return;
+        iter->second.removeFirstMatchingValue (c);
+        if (iter->second.isEmpty())
+            map.erase (iter);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ConnectionIndex)
+};
+
 GraphProcessor::GraphProcessor()
-    : lastNodeId (0),
-      renderingBuffers (1, 1),
+    : connectionIndex (new ConnectionIndex()),
+      lastNodeId (0),
       currentAudioInputBuffer (nullptr),
       currentAudioOutputBuffer (1, 1),
       currentMidiInputBuffer (nullptr)
 {
     for (int i = 0; i < AudioGraphIOProcessor::numDeviceTypes; ++i)
         ioNodes[i] = KV_INVALID_PORT;
+    auxBuses.onRoutingChanged = [this]() { triggerAsyncUpdate(); };
 }
 
 GraphProcessor::~GraphProcessor()
 {
     renderingSequenceChanged.disconnect_all_slots();
-    clearRenderingSequence();
     clear();
+    clearRenderingSequence();
+    jassert (programInUse.load() == nullptr);
+    retiredPrograms.clear();
 }
 
 const String GraphProcessor::getName() const
@@ -885,10 +3532,56 @@ const String GraphProcessor::getName() const
 
 void GraphProcessor::clear()
 {
+    for (auto* const node : nodes)
+    {
+        if (auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+            sub->inlinedInto = nullptr;
+        else if (auto* const aux = dynamic_cast<AuxBusNode*> (node->getAudioProcessor()))
+            aux->attach (nullptr);
+    }
+
     nodes.clear();
+    connectionIndex->clear();
     connections.clear();
     //triggerAsyncUpdate();
-    handleAsyncUpdate();
+    rebuildPending = false;
+    buildRenderingSequence();
+    clearCachedPrograms();
+    releaseDetachedNodes();
+}
+
+void GraphProcessor::beginBatchUpdate()
+{
+    ++batchDepth;
+}
+
+void GraphProcessor::endBatchUpdate()
+{
+    jassert (batchDepth > 0);
+    if (batchDepth <= 0 || --batchDepth > 0)
+        return;
+
+    if (rebuildPending)
+    {
+        rebuildPending = false;
+        buildRenderingSequence();
+    }
+
+    if (! detachedNodes.isEmpty())
+    {
+        clearCachedPrograms();
+        for (auto* graph = inlinedInto; graph != nullptr; graph = graph->inlinedInto)
+            graph->clearCachedPrograms();
+        releaseDetachedNodes();
+    }
+}
+
+void GraphProcessor::releaseDetachedNodes()
+{
+    for (auto* const node : detachedNodes)
+        if (! nodes.contains (node))
+            node->setParentGraph (nullptr);
+    detachedNodes.clear();
 }
 
 GraphNode* GraphProcessor::getNodeForId (const uint32 nodeId) const
@@ -944,7 +3637,7 @@ GraphNode* GraphProcessor::addNode (AudioProcessor* const newProcessor, uint32 n
     {
         node->setParentGraph (this);
         node->resetPorts();
-        node->prepare (getSampleRate(), getBlockSize(), this);
+        node->prepare (getRenderSampleRate(), getRenderBlockSize(), this);
         nodes.add (node);
         triggerAsyncUpdate();
         return node;
@@ -995,7 +3688,7 @@ GraphNode* GraphProcessor::addNode (GraphNode* newNode, uint32 nodeId)
     
     newNode->setParentGraph (this);
     newNode->resetPorts();
-    newNode->prepare (getSampleRate(), getBlockSize(), this);
+    newNode->prepare (getRenderSampleRate(), getRenderBlockSize(), this);
     triggerAsyncUpdate();
     return nodes.add (newNode);
 }
@@ -1010,17 +3703,35 @@ bool GraphProcessor::removeNode (const uint32 nodeId)
         if (nodes.getUnchecked(i)->nodeId == nodeId)
         {
             nodes.remove (i);
-         
-            // triggerAsyncUpdate();
-            // do this syncronoously so it wont try processing with a null graph
-            handleAsyncUpdate();
-            n->setParentGraph (nullptr);
 
             if (auto* sub = dynamic_cast<SubGraphProcessor*> (n->getAudioProcessor()))
             {
                 DBG("[EL] sub graph removed");
+                sub->inlinedInto = nullptr;
+            }
+            else if (auto* aux = dynamic_cast<AuxBusNode*> (n->getAudioProcessor()))
+            {
+                aux->attach (nullptr);
+            }
+
+            // while batching the current sequence keeps rendering the node
+            // until it's rebuilt, like a replaced one
+            if (batchDepth > 0)
+            {
+                rebuildPending = true;
+                detachedNodes.add (n.get());
+                return true;
             }
 
+            // triggerAsyncUpdate();
+            // do this syncronoously so it wont try processing with a null graph
+            buildRenderingSequence();
+            // cached programs would keep the removed node alive, that includes
+            // those of graphs this one is inlined into
+            clearCachedPrograms();
+            for (auto* graph = inlinedInto; graph != nullptr; graph = graph->inlinedInto)
+                graph->clearCachedPrograms();
+            n->setParentGraph (nullptr);
             return true;
         }
     }
@@ -1028,34 +3739,91 @@ bool GraphProcessor::removeNode (const uint32 nodeId)
     return false;
 }
 
+GraphNode* GraphProcessor::replaceNode (GraphNode* existing, AudioProcessor* newProcessor)
+{
+    const int index = nodes.indexOf (existing);
+    if (index < 0 || newProcessor == nullptr)
+        return nullptr;
+
+    GraphNodePtr old = existing;
+    newProcessor->setPlayHead (getPlayHead());
+    GraphNodePtr node = createNode (old->nodeId, newProcessor);
+    if (node == nullptr)
+        return nullptr;
+
+    node->setParentGraph (this);
+    node->resetPorts();
+    node->prepare (getRenderSampleRate(), getRenderBlockSize(), this);
+    nodes.set (index, node.get());
+    removeIllegalConnections();
+
+    // while batching the current sequence keeps rendering the old node
+    // until it's rebuilt, so it stays attached until then
+    if (batchDepth > 0)
+    {
+        rebuildPending = true;
+        detachedNodes.add (old.get());
+        return node.get();
+    }
+
+    // like removing a node, the old one can't be rendered once it's gone
+    handleAsyncUpdate();
+    clearCachedPrograms();
+    for (auto* graph = inlinedInto; graph != nullptr; graph = graph->inlinedInto)
+        graph->clearCachedPrograms();
+
+    old->setParentGraph (nullptr);
+    return node.get();
+}
+
 const GraphProcessor::Connection*
 GraphProcessor::getConnectionBetween (const uint32 sourceNode,
                                       const uint32 sourcePort,
                                       const uint32 destNode,
                                       const uint32 destPort) const
 {
-    const Connection c (sourceNode, sourcePort, destNode, destPort);
-    ArcSorter sorter;
-    return connections [connections.indexOfSorted (sorter, &c)];
+    return connectionIndex->find (sourceNode, sourcePort, destNode, destPort);
 }
 
 bool GraphProcessor::isConnected (const uint32 sourceNode,
                                   const uint32 destNode) const
 {
-    for (int i = connections.size(); --i >= 0;)
-    {
-        const Connection* const c = connections.getUnchecked(i);
+    return ! connectionIndex->getBetween (sourceNode, destNode).isEmpty();
+}
 
-        if (c->sourceNode == sourceNode
-             && c->destNode == destNode)
-        {
+bool GraphProcessor::hasConnectionFrom (const uint32 sourceNode, const uint32 sourcePort) const
+{
+    for (const auto* c : connectionIndex->getOutputs (sourceNode))
+        if (c->sourcePort == sourcePort)
             return true;
-        }
-    }
-
     return false;
 }
 
+void GraphProcessor::getRoutedAudioChannels (BigInteger& inputs, BigInteger& outputs) const
+{
+    inputs.clear();
+    outputs.clear();
+
+    auto isIONode = [] (const GraphNode* node, const AudioGraphIOProcessor::IODeviceType type)
+    {
+        auto* const io = node != nullptr ? dynamic_cast<AudioGraphIOProcessor*> (node->getAudioProcessor()) : nullptr;
+        return io != nullptr && io->getType() == type;
+    };
+
+    for (const auto* const c : connections)
+    {
+        const auto* const source = getNodeForId (c->sourceNode);
+        if (isIONode (source, AudioGraphIOProcessor::audioInputNode)
+            && source->getPortType (c->sourcePort) == PortType::Audio)
+            inputs.setBit (source->getChannelPort (c->sourcePort));
+
+        const auto* const dest = getNodeForId (c->destNode);
+        if (isIONode (dest, AudioGraphIOProcessor::audioOutputNode)
+            && dest->getPortType (c->destPort) == PortType::Audio)
+            outputs.setBit (dest->getChannelPort (c->destPort));
+    }
+}
+
 bool GraphProcessor::canConnect (const uint32 sourceNode, const uint32 sourcePort,
                                  const uint32 destNode, const uint32 destPort) const
 {
@@ -1110,6 +3878,7 @@ bool GraphProcessor::addConnection (const uint32 sourceNode, const uint32 source
     ArcSorter sorter;
     Connection* c = new Connection (sourceNode, sourcePort, destNode, destPort);
     connections.addSorted (sorter, c);
+    connectionIndex->add (c);
     triggerAsyncUpdate();
     return true;
 }
@@ -1127,6 +3896,8 @@ bool GraphProcessor::connectChannels (PortType type, uint32 sourceNode, int32 so
 
 void GraphProcessor::removeConnection (const int index)
 {
+    if (const auto* const c = connections [index])
+        connectionIndex->remove (c);
     connections.remove (index);
     triggerAsyncUpdate();
 }
@@ -1134,41 +3905,32 @@ void GraphProcessor::removeConnection (const int index)
 bool GraphProcessor::removeConnection (const uint32 sourceNode, const uint32 sourcePort,
                                        const uint32 destNode, const uint32 destPort)
 {
-    bool doneAnything = false;
-
-    for (int i = connections.size(); --i >= 0;)
-    {
-        const Connection* const c = connections.getUnchecked (i);
+    const Connection* const c = connectionIndex->find (sourceNode, sourcePort, destNode, destPort);
+    if (c == nullptr)
+        return false;
 
-        if (c->sourceNode == sourceNode
-             && c->destNode == destNode
-             && c->sourcePort == sourcePort
-             && c->destPort == destPort)
-        {
-            removeConnection (i);
-            doneAnything = true;
-        }
-    }
-    
-    return doneAnything;
+    ArcSorter sorter;
+    removeConnection (connections.indexOfSorted (sorter, c));
+    return true;
 }
 
 bool GraphProcessor::disconnectNode (const uint32 nodeId)
 {
-    bool doneAnything = false;
+    // copies, the index changes as connections are removed
+    Array<const Connection*> attached (connectionIndex->getInputs (nodeId));
+    attached.addArray (connectionIndex->getOutputs (nodeId));
+    if (attached.isEmpty())
+        return false;
 
-    for (int i = connections.size(); --i >= 0;)
+    ArcSorter sorter;
+    for (const auto* c : attached)
     {
-        const Connection* const c = connections.getUnchecked(i);
-
-        if (c->sourceNode == nodeId || c->destNode == nodeId)
-        {
-            removeConnection (i);
-            doneAnything = true;
-        }
+        const int index = connections.indexOfSorted (sorter, c);
+        if (index >= 0)
+            removeConnection (index);
     }
-    
-    return doneAnything;
+
+    return true;
 }
 
 bool GraphProcessor::isConnectionLegal (const Connection* const c) const
@@ -1208,49 +3970,173 @@ void GraphProcessor::setMidiChannel (const int channel) noexcept
         midiChannels.setOmni (true);
     else
         midiChannels.setChannel (channel);
+    updateMidiFilter();
 }
 
 void GraphProcessor::setMidiChannels (const BigInteger channels) noexcept
 {
     ScopedLock sl (getCallbackLock());
     midiChannels.setChannels (channels);
+    updateMidiFilter();
+}
+
+void GraphProcessor::setMidiChannels (const kv::MidiChannels channels) noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    midiChannels = channels;
+    updateMidiFilter();
+}
+
+bool GraphProcessor::acceptsMidiChannel (const int channel) const noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    return midiChannels.isOn (channel);
+}
+
+void GraphProcessor::setVelocityCurveMode (const VelocityCurve::Mode mode) noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    velocityCurve.setMode (mode);
+    updateMidiFilter();
+}
+
+void GraphProcessor::setCustomVelocityCurve (const uint8* values) noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    velocityCurve.setCustomCurve (values);
+    updateMidiFilter();
+}
+
+void GraphProcessor::updateMidiFilter()
+{
+   #ifndef EL_FREE
+    midiFilter.compile ({}, midiChannels, 0, false, &velocityCurve);
+   #else
+    midiFilter.compile ({}, midiChannels, 0, false);
+   #endif
+}
+
+void GraphProcessor::clearRenderingSequence()
+{
+    publishProgram (nullptr);
+}
+
+var GraphProcessor::getRenderProgramInfo() const
+{
+    // programs are only replaced on the message thread
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    auto* const current = program.load();
+    var info = current != nullptr ? current->describe() : var (new DynamicObject());
+
+    Array<var> order;
+    if (auto* const ops = info["ops"].getArray())
+        for (const auto& op : *ops)
+            if (op.hasProperty ("node") && ! order.contains (op["node"]))
+                order.add (op["node"]);
+
+    if (auto* const object = info.getDynamicObject())
+    {
+        object->setProperty ("graph", getName());
+        object->setProperty ("sampleRate", getSampleRate());
+        object->setProperty ("blockSize", getBlockSize());
+        object->setProperty ("order", order);
+    }
+
+    return info;
 }
 
-void GraphProcessor::setMidiChannels (const kv::MidiChannels channels) noexcept
-{
-    ScopedLock sl (getCallbackLock());
-    midiChannels = channels;
-}
+void GraphProcessor::publishProgram (GraphRender::RenderProgram* newProgram)
+{
+    if (newProgram != nullptr)
+        setLatencySamples (newProgram->latencySamples);
+    renderMemoryBytes.store (newProgram != nullptr ? newProgram->memoryBytes : 0, std::memory_order_relaxed);
+
+    if (newProgram != nullptr)
+        newProgram->setOpsRetired (false);
+
+    if (auto* const oldProgram = program.exchange (newProgram))
+    {
+        // ops working off the audio thread stop before anything else runs
+        // their nodes
+        oldProgram->setOpsRetired (true, newProgram);
+
+        // the program being replaced may still be rendering, whatever happens
+        // to it later goes through the retired list
+        if (newProgram != nullptr)
+        {
+            cachedPrograms.add (oldProgram);
+            if (cachedPrograms.size() > maxCachedPrograms)
+                retiredPrograms.add (cachedPrograms.removeAndReturn (0));
+        }
+        else
+        {
+            retiredPrograms.add (oldProgram);
+        }
+    }
+
+    if (newProgram == nullptr)
+        clearCachedPrograms();
 
-bool GraphProcessor::acceptsMidiChannel (const int channel) const noexcept
-{
-    ScopedLock sl (getCallbackLock());
-    return midiChannels.isOn (channel);
+    reclaimRetiredPrograms();
 }
 
-void GraphProcessor::setVelocityCurveMode (const VelocityCurve::Mode mode) noexcept
+void GraphProcessor::clearCachedPrograms()
 {
-    ScopedLock sl (getCallbackLock());
-    velocityCurve.setMode (mode);
+    while (! cachedPrograms.isEmpty())
+        retiredPrograms.add (cachedPrograms.removeAndReturn (0));
+    reclaimRetiredPrograms();
 }
 
-static void deleteRenderOpArray (Array<void*>& ops)
+void GraphProcessor::reclaimRetiredPrograms()
 {
-    for (int i = ops.size(); --i >= 0;)
-        delete static_cast<GraphRender::Task*> (ops.getUnchecked (i));
-    ops.clearQuick();
+    // the audio thread is done with a program as soon as it stops advertising
+    // it. give it a few blocks to finish, otherwise try again next time.
+    // programs are freed oldest first since newer ones may own ops which an
+    // older one still renders.
+    const uint32 deadline = Time::getMillisecondCounter() + 250;
+
+    while (! retiredPrograms.isEmpty())
+    {
+        auto* const oldProgram = retiredPrograms.getFirst();
+        while (programInUse.load() == oldProgram && Time::getMillisecondCounter() < deadline)
+            Thread::sleep (1);
+
+        if (programInUse.load() == oldProgram)
+            break;
+
+        retiredPrograms.remove (0);
+    }
 }
 
-void GraphProcessor::clearRenderingSequence()
+void GraphProcessor::setRenderThreadPool (RenderThreadPool* pool)
 {
-    Array<void*> oldOps;
+    if (renderPool == pool)
+        return;
 
     {
         const ScopedLock sl (getCallbackLock());
-        renderingOps.swapWith (oldOps);
+        renderPool = pool;
     }
 
-    deleteRenderOpArray (oldOps);
+    if (parallelRender)
+        triggerAsyncUpdate();
+}
+
+void GraphProcessor::setParallelRenderingEnabled (const bool enabled)
+{
+    if (parallelRender == enabled)
+        return;
+    parallelRender = enabled;
+    triggerAsyncUpdate();
+}
+
+void GraphProcessor::setPipelineStages (const int numStages)
+{
+    const int newNumStages = jlimit (1, maxPipelineStages, numStages);
+    if (pipelineStages == newNumStages)
+        return;
+    pipelineStages = newNumStages;
+    triggerAsyncUpdate();
 }
 
 bool GraphProcessor::isAnInputTo (const uint32 possibleInputId,
@@ -1259,13 +4145,10 @@ bool GraphProcessor::isAnInputTo (const uint32 possibleInputId,
 {
     if (recursionCheck > 0)
     {
-        for (int i = connections.size(); --i >= 0;)
+        for (const auto* c : connectionIndex->getInputs (possibleDestinationId))
         {
-            const GraphProcessor::Connection* const c = connections.getUnchecked (i);
-
-            if (c->destNode == possibleDestinationId
-                 && (c->sourceNode == possibleInputId
-                      || isAnInputTo (possibleInputId, c->sourceNode, recursionCheck - 1)))
+            if (c->sourceNode == possibleInputId
+                 || isAnInputTo (possibleInputId, c->sourceNode, recursionCheck - 1))
                 return true;
         }
     }
@@ -1275,88 +4158,221 @@ bool GraphProcessor::isAnInputTo (const uint32 possibleInputId,
 
 void GraphProcessor::buildRenderingSequence()
 {
-    Array<void*> newRenderingOps;
-    int numRenderingBuffersNeeded = 2;
-    int numMidiBuffersNeeded = 1;
+    // a graph inlined into another renders in that graph's pipeline
+    const bool buildPipeline = pipelineStages > 1 && inlinedInto == nullptr;
+    const bool buildParallel = parallelRender && renderPool != nullptr && ! buildPipeline;
 
-    {
-        //XXX:
-        MessageManagerLock mml;
+    //XXX:
+    MessageManagerLock mml;
 
-        Array<void*> orderedNodes;
+    // preparing an inlined subgraph rebuilds it, which would otherwise
+    // come straight back here to rebuild this graph as well
+    const ScopedValueSetter<bool> svs (building, true);
+    const TimelineTrace::Zone zone ("graph rebuild");
+    ++numRenderBuilds;
 
+    double longestTail = 0.0;
+    for (auto* const node : nodes)
+    {
+        node->prepare (getRenderSampleRate(), getRenderBlockSize(), this);
+        if (auto* const proc = node->getAudioProcessor())
+            longestTail = jmax (longestTail, proc->getTailLengthSeconds());
+    }
+    tailLength.store (longestTail, std::memory_order_relaxed);
+
+    // programs are only published from here and clearRenderingSequence, so
+    // the current one can be read without involving the audio thread
+    auto* const oldProgram = program.load();
+
+    // a graph inlined into another flattens its own subgraphs too, so that
+    // their changes reach the graph actually rendering them
+    const bool inlining = isInliningSubGraphs();
+    if (! inlining)
+        for (auto* const node : nodes)
+            if (auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+                sub->inlinedInto = nullptr;
+
+    const GraphRender::RenderTopology topology (*this, inlining);
+    const int64 topologyHash = getTopologyHash (buildParallel);
+
+    // sends and returns use the buses of the graph rendering them, which
+    // for those of inlined racks is this one
+    if (inlinedInto == nullptr)
+        for (auto* const node : topology.nodes)
+            if (auto* const aux = dynamic_cast<AuxBusNode*> (node->getAudioProcessor()))
+                aux->attach (&auxBuses);
+
+    if (oldProgram != nullptr && oldProgram->topologyHash == topologyHash)
+        return;
+
+    for (int i = cachedPrograms.size(); --i >= 0;)
+    {
+        if (cachedPrograms.getUnchecked(i)->topologyHash == topologyHash)
         {
-            const LookupTable table (connections);
+            publishProgram (cachedPrograms.removeAndReturn (i));
+            programChanged();
+            return;
+        }
+    }
 
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                GraphNode* const node = nodes.getUnchecked(i);
-                node->prepare (getSampleRate(), getBlockSize(), this);
+    std::unique_ptr<GraphRender::RenderProgram> newProgram (new GraphRender::RenderProgram());
+    newProgram->topologyHash = topologyHash;
 
-                int j = 0;
-                for (; j < orderedNodes.size(); ++j)
-                    if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                      break;
+    // stateful ops (node processing and latency delays) from the current
+    // sequence are shared with the new one when nothing about them changed
+    Array<void*> reusableOps;
+    if (oldProgram != nullptr)
+        reusableOps.addArray (oldProgram->ops);
 
-                orderedNodes.insert (j, node);
-            }
-        }
+    {
+        Array<int> order;
+        topology.sort (order);
+
+        GraphRender::ProcessorGraphBuilder calculator (*this, topology, order, newProgram->ops,
+                                                      ! buildParallel, &reusableOps);
+        newProgram->retainOps();
+        newProgram->latencySamples = getReportedLatency (calculator.getTotalLatency());
+
+        newProgram->prepareBuffers (calculator.buffersNeeded (PortType::Audio),
+                                    calculator.buffersNeeded (PortType::Midi),
+                                    isUsingDoublePrecision());
 
-        GraphRender::ProcessorGraphBuilder calculator (*this, orderedNodes, newRenderingOps);
+        newProgram->compile();
 
-        numRenderingBuffersNeeded = calculator.buffersNeeded (PortType::Audio);
-        numMidiBuffersNeeded      = calculator.buffersNeeded (PortType::Midi);
+        const auto pipelineEnds = buildPipeline ? GraphRender::PipelineRender::findStageEnds (newProgram->ops, pipelineStages)
+                                                : Array<int>();
+        if (pipelineEnds.size() > 1)
+        {
+            newProgram->pipeline.reset (new GraphRender::PipelineRender (
+                newProgram->ops, newProgram->getCode(), pipelineEnds));
+            newProgram->memoryBytes += newProgram->pipeline->prepareBuffers (
+                calculator.buffersNeeded (PortType::Audio), calculator.buffersNeeded (PortType::Midi),
+                isUsingDoublePrecision());
+
+            // a block late for every cut
+            newProgram->latencySamples = getReportedLatency (calculator.getTotalLatency()
+                + (pipelineEnds.size() - 1) * getMaxChunkSize());
+        }
+        else if (buildParallel)
+        {
+            newProgram->parallel.reset (new GraphRender::ParallelRender (
+                newProgram->ops, newProgram->getCode(), calculator.getStageEnds()));
+        }
     }
 
+    publishProgram (newProgram.release());
+    programChanged();
+}
+
+void GraphProcessor::programChanged()
+{
+    renderingSequenceChanged();
+
+    // a graph inlined into another renders as part of that graph's program
+    if (inlinedInto != nullptr && ! inlinedInto->building)
+        inlinedInto->handleAsyncUpdate();
+}
+
+int64 GraphProcessor::getTopologyHash (const bool buildParallel) const
+{
+    // FNV-1a over everything the builder reads from the graph
+    uint64 hash = 14695981039346656037ULL;
+    auto add = [&hash] (const uint64 value)
     {
-        // swap over to the new rendering sequence..
-        const ScopedLock sl (getCallbackLock());
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
 
-        renderingBuffers.setSize (numRenderingBuffersNeeded, 4096);
-        renderingBuffers.clear();
+    add (buildParallel ? 1 : 0);
+    add ((uint64) pipelineStages);
+    add (isUsingDoublePrecision() ? 1 : 0);
+    add ((uint64) roundToInt (getSampleRate()));
+    add ((uint64) getBlockSize());
 
-        for (int i = midiBuffers.size(); --i >= 0;)
-            midiBuffers.getUnchecked(i)->clear();
+    // subgraphs flattened into this graph or one it is inlined into are
+    // part of the topology too
+    const bool inlining = isInliningSubGraphs();
 
-        while (midiBuffers.size() < numMidiBuffersNeeded)
-            midiBuffers.add (new MidiBuffer());
+    for (auto* const node : nodes)
+    {
+        add ((uint64) (pointer_sized_uint) node);
+        add (node->nodeId);
+        add ((uint64) node->getLatencySamples());
+        add ((uint64) node->getOversamplingLatencySamples());
+        add ((uint64) node->getOversamplingFactor());
+        add ((uint64) node->getOversamplingMode());
+        add (node->wantsMidiPipe() ? 1 : 0);
+        add ((uint64) (pointer_sized_uint) node->getFrozenAudio().get());
+        add (node->isRenderingAhead() ? 1 : 0);
+
+        if (auto* const aux = dynamic_cast<AuxBusNode*> (node->getAudioProcessor()))
+            add ((uint64) aux->getBusName().hashCode64());
+
+        if (inlining)
+        {
+            if (auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+            {
+                const bool inlined = GraphRender::canInlineSubGraph (*node, *this);
+                add (inlined ? 1 : 0);
+                if (inlined)
+                    add ((uint64) sub->getTopologyHash (false));
+            }
+        }
 
-        renderingOps.swapWith (newRenderingOps);
+        const uint32 numPorts = node->getNumPorts();
+        add (numPorts);
+        for (uint32 port = 0; port < numPorts; ++port)
+        {
+            add ((uint64) node->getPortType (port).id());
+            add (node->isPortInput (port) ? 1 : 0);
+            add ((uint64) node->getChannelPort (port));
+        }
     }
 
-    // delete the old ones..
-    deleteRenderOpArray (newRenderingOps);
+    for (const auto* const c : connections)
+    {
+        add (c->sourceNode); add (c->sourcePort);
+        add (c->destNode);   add (c->destPort);
+    }
 
-    renderingSequenceChanged();
+    return (int64) hash;
 }
 
 void GraphProcessor::getOrderedNodes (ReferenceCountedArray<GraphNode>& orderedNodes)
 {
-    const LookupTable table (connections);
-    for (int i = 0; i < nodes.size(); ++i)
-    {
-        GraphNode* const node = nodes.getUnchecked(i);
-        
-        int j = 0;
-        for (; j < orderedNodes.size(); ++j)
-            if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                break;
-        
-        orderedNodes.insert (j, node);
-    }
+    const GraphRender::RenderTopology topology (*this, false);
+    Array<int> order;
+    topology.sort (order);
+    for (const int index : order)
+        orderedNodes.add (topology.nodes.getUnchecked (index));
+}
+
+void GraphProcessor::setSubGraphInliningEnabled (const bool enabled)
+{
+    if (inlineSubGraphs == enabled)
+        return;
+    inlineSubGraphs = enabled;
+    triggerAsyncUpdate();
+}
+
+bool GraphProcessor::isFilteringMidi() const noexcept
+{
+    return midiFilter.isActive();
 }
 
 void GraphProcessor::handleAsyncUpdate()
 {
+    if (batchDepth > 0)
+    {
+        rebuildPending = true;
+        return;
+    }
+
     buildRenderingSequence();
 }
 
 void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
 {
-    currentAudioInputBuffer = nullptr;
-    currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), estimatedSamplesPerBlock);
-    currentMidiInputBuffer = nullptr;
-    currentMidiOutputBuffer.clear();
     clearRenderingSequence();
 
     if (getSampleRate() != sampleRate || getBlockSize() != estimatedSamplesPerBlock)
@@ -1365,22 +4381,79 @@ void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBl
             sampleRate, estimatedSamplesPerBlock);
     }
 
-    for (int i = 0; i < nodes.size(); ++i)
-        nodes.getUnchecked(i)->prepare (sampleRate, estimatedSamplesPerBlock, this);
+    // sized once for the largest chunk, blocks only ever shrink them
+    const int maxChunkSize = getMaxChunkSize();
+    currentAudioInputBuffer = nullptr;
+    currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), maxChunkSize);
+    currentDoubleInputBuffer = nullptr;
+    if (isUsingDoublePrecision())
+        currentDoubleOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), maxChunkSize);
+    else
+        currentDoubleOutputBuffer.setSize (1, 1);
+    currentMidiInputBuffer = nullptr;
+    currentMidiOutputBuffer.clear();
+    MidiBudget::reserve (currentMidiOutputBuffer);
+    MidiBudget::reserve (filteredMidi);
+    MidiBudget::reserve (chunkMidi);
+    MidiBudget::reserve (chunkMidiOut);
+    auxBuses.prepare (jmax (maxChunkSize, getRenderBlockSize()));
+
+    prepareNodes();
+    buildRenderingSequence();
+}
+
+void GraphProcessor::setBlockSize (int blockSize)
+{
+    if (blockSize <= 0 || blockSize == getBlockSize())
+        return;
+
+    setPlayConfigDetails (getTotalNumInputChannels(), getTotalNumOutputChannels(),
+                          getSampleRate(), blockSize);
+
+    const int maxChunkSize = getMaxChunkSize();
+    currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), maxChunkSize, false, false, true);
+    if (isUsingDoublePrecision())
+        currentDoubleOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), maxChunkSize, false, false, true);
+    auxBuses.prepare (jmax (maxChunkSize, getRenderBlockSize()));
+
+    // render programs are sized for the largest chunk already, so only nodes
+    // prepared for less than they'll now be given start over
+    const int renderBlockSize = getRenderBlockSize();
+    for (auto* const node : nodes)
+    {
+        if (! node->isPrepared || node->preparedBlockSize >= renderBlockSize)
+            continue;
+
+        auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor());
+        if (sub != nullptr && sub->getRenderBlockSize() == sub->getBlockSize())
+        {
+            sub->setBlockSize (renderBlockSize * node->getOversamplingFactor());
+            node->preparedBlockSize = renderBlockSize;
+            continue;
+        }
+
+        node->unprepare();
+    }
 
+    prepareNodes();
     buildRenderingSequence();
 }
 
 void GraphProcessor::releaseResources()
 {
+    // nodes rendered ahead may be running on a worker
+    if (auto* const current = program.load())
+        current->setOpsRetired (true);
+
     for (int i = 0; i < nodes.size(); ++i)
         nodes.getUnchecked(i)->unprepare();
 
-    renderingBuffers.setSize (1, 1);
-    midiBuffers.clear();
+    clearRenderingSequence();
 
     currentAudioInputBuffer = nullptr;
     currentAudioOutputBuffer.setSize (1, 1);
+    currentDoubleInputBuffer = nullptr;
+    currentDoubleOutputBuffer.setSize (1, 1);
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
 }
@@ -1393,60 +4466,344 @@ void GraphProcessor::reset()
             proc->reset();
 }
 
+void GraphProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+    for (auto node : nodes)
+        if (auto* const proc = node->getAudioProcessor())
+            proc->setNonRealtime (isNonRealtime);
+}
+
 // MARK: Process Graph
 
 void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    // the input is only read while rendering, so in place is fine
+    processBlock (buffer, buffer, midiMessages);
+}
+
+void GraphProcessor::processBlock (const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                                   MidiBuffer& midiMessages)
+{
+    const int32 numSamples = output.getNumSamples();
+    jassert (input.getNumSamples() >= numSamples);
+
+    const int maxChunkSize = getMaxChunkSize();
+    if (numSamples <= maxChunkSize)
+    {
+        renderBlock (input, output, midiMessages);
+        return;
+    }
+
+    // more than the graph was prepared for, render it in pieces so nothing
+    // has to grow on the audio thread. the input is only read from.
+    auto* const inputChannels = const_cast<float* const*> (input.getArrayOfReadPointers());
+    chunkMidiOut.clear();
+    MidiBudget::Writer chunkOut (chunkMidiOut);
+
+    for (int start = 0; start < numSamples; start += maxChunkSize)
+    {
+        const int numChunkSamples = jmin (maxChunkSize, numSamples - start);
+        const AudioSampleBuffer inputChunk (inputChannels, input.getNumChannels(), start, numChunkSamples);
+        AudioSampleBuffer outputChunk (output.getArrayOfWritePointers(), output.getNumChannels(),
+                                       start, numChunkSamples);
+        chunkMidi.clear();
+        MidiBudget::Writer (chunkMidi).addEvents (midiMessages, start, numChunkSamples, -start);
+        renderBlock (inputChunk, outputChunk, chunkMidi);
+        chunkOut.addEvents (chunkMidi, 0, numChunkSamples, start);
+    }
+
+    midiMessages.swapWith (chunkMidiOut);
+}
+
+void GraphProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
 {
     const int32 numSamples = buffer.getNumSamples();
+    const int maxChunkSize = getMaxChunkSize();
+    if (numSamples <= maxChunkSize)
+    {
+        renderBlock (buffer, midiMessages);
+        return;
+    }
 
-    currentAudioInputBuffer = &buffer;
-    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples);
-    currentAudioOutputBuffer.clear();
-    
-    if (midiChannels.isOmni() && velocityCurve.getMode() == VelocityCurve::Linear)
+    chunkMidiOut.clear();
+    MidiBudget::Writer chunkOut (chunkMidiOut);
+    for (int start = 0; start < numSamples; start += maxChunkSize)
     {
-        currentMidiInputBuffer = &midiMessages;
+        const int numChunkSamples = jmin (maxChunkSize, numSamples - start);
+        AudioBuffer<double> chunk (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                   start, numChunkSamples);
+        chunkMidi.clear();
+        MidiBudget::Writer (chunkMidi).addEvents (midiMessages, start, numChunkSamples, -start);
+        renderBlock (chunk, chunkMidi);
+        chunkOut.addEvents (chunkMidi, 0, numChunkSamples, start);
+    }
+
+    midiMessages.swapWith (chunkMidiOut);
+}
+
+//=============================================================================
+
+class NodePrepareJob : public ThreadPoolJob
+{
+public:
+    NodePrepareJob (GraphNode& n, double rate, int size)
+        : ThreadPoolJob ("Node Prepare"), node (n), sampleRate (rate), blockSize (size) { }
+
+    JobStatus runJob() override
+    {
+        const int osFactor = node.getOversamplingFactor();
+        node.prepareToRender (sampleRate * osFactor, blockSize * osFactor);
+        return jobHasFinished;
+    }
+
+private:
+    GraphNode& node;
+    const double sampleRate;
+    const int blockSize;
+};
+
+/** Workers shared by every graph for preparing nodes that allow it */
+struct NodePreparePool : public ThreadPool
+{
+    NodePreparePool() : ThreadPool (jmax (1, SystemStats::getNumCpus() - 1)) { }
+};
+
+/** Returns true if the node's prepareToPlay() may run on a pool worker while
+    others prepare. Plugin formats whose hosts already prepare them on the
+    audio device thread qualify, that is VST2 and LADSPA. Left to the calling
+    thread are VST3 and AU, which may need the message thread, LV2, whose
+    instances share one world and URID map, sub graphs, which prepare their
+    own nodes through the pool, and internal nodes that don't opt in with
+    BaseProcessor::canPrepareConcurrently(), since many open devices or files */
+static bool canPrepareOnWorker (GraphNode& node)
+{
+    auto* const proc = node.getAudioProcessor();
+    if (proc == nullptr || dynamic_cast<GraphProcessor*> (proc) != nullptr)
+        return false;
+
+    if (auto* const base = dynamic_cast<BaseProcessor*> (proc))
+        return base->canPrepareConcurrently();
+
+    auto* const plugin = dynamic_cast<AudioPluginInstance*> (proc);
+    if (plugin == nullptr)
+        return false;
+
+    PluginDescription desc;
+    plugin->fillInPluginDescription (desc);
+    return desc.pluginFormatName == "VST" || desc.pluginFormatName == "LADSPA";
+}
+
+void GraphProcessor::prepareNodes()
+{
+    const double sampleRate = getRenderSampleRate();
+    const int blockSize = getRenderBlockSize();
+
+    // nodes safe off the message thread are prepared several at a time,
+    // the rest here meanwhile. see canPrepareOnWorker() for which are which
+    Array<GraphNode*> prepared, concurrent, others;
+    for (auto* const node : nodes)
+    {
+        if (! node->beginPrepare (blockSize, this, false))
+            continue;
+
+        prepared.add (node);
+        if (canPrepareOnWorker (*node))
+            concurrent.add (node);
+        else
+            others.add (node);
+    }
+
+    if (concurrent.size() > 1)
+    {
+        SharedResourcePointer<NodePreparePool> pool;
+        // declared after the pool, so the jobs are deleted before it might be
+        OwnedArray<NodePrepareJob> jobs;
+
+        for (auto* const node : concurrent)
+            pool->addJob (jobs.add (new NodePrepareJob (*node, sampleRate, blockSize)), false);
+
+        for (auto* const node : others)
+            NodePrepareJob (*node, sampleRate, blockSize).runJob();
+
+        for (auto* job : jobs)
+            pool->waitForJobToFinish (job, -1);
     }
     else
     {
-        filteredMidi.clear();
-        MidiBuffer::Iterator iter (midiMessages);
-        MidiMessage msg; int frame = 0, chan = 0;
-        
-        while (iter.getNextEvent (msg, frame))
-        {
-            chan = msg.getChannel();
-            if (chan > 0 && midiChannels.isOff (chan))
-                continue;
+        others.addArray (concurrent);
+        for (auto* const node : others)
+            NodePrepareJob (*node, sampleRate, blockSize).runJob();
+    }
 
-            if (msg.isNoteOn())
-            {
-               #ifndef EL_FREE
-                msg.setVelocity (velocityCurve.process (msg.getFloatVelocity()));
-               #endif
-            }
+    for (auto* const node : prepared)
+        node->endPrepare (sampleRate);
+}
+
+//=============================================================================
+
+class NodeWarmUpJob : public ThreadPoolJob
+{
+public:
+    NodeWarmUpJob (AudioProcessor& p, int blocks, int size)
+        : ThreadPoolJob ("Node Warm Up"), processor (p), numBlocks (blocks), blockSize (size) { }
 
-            filteredMidi.addEvent (msg, frame);
+    JobStatus runJob() override
+    {
+        const int numChannels = jmax (1, processor.getTotalNumInputChannels(),
+                                      processor.getTotalNumOutputChannels());
+        MidiBuffer midi;
+
+        if (processor.isUsingDoublePrecision())
+            render (AudioBuffer<double> (numChannels, blockSize), midi);
+        else
+            render (AudioSampleBuffer (numChannels, blockSize), midi);
+
+        return jobHasFinished;
+    }
+
+private:
+    AudioProcessor& processor;
+    const int numBlocks, blockSize;
+
+    template<typename SampleType>
+    void render (AudioBuffer<SampleType>&& audio, MidiBuffer& midi)
+    {
+        for (int i = 0; i < numBlocks && ! shouldExit(); ++i)
+        {
+            audio.clear();
+            midi.clear();
+            processor.processBlock (audio, midi);
         }
-        
-        currentMidiInputBuffer = &filteredMidi;
     }
-    
-    currentMidiOutputBuffer.clear();
+};
+
+void GraphProcessor::warmUp (int numBlocks)
+{
+    if (numBlocks <= 0)
+        return;
+
+    Array<AudioProcessor*> processors;
+    collectNodesToWarmUp (processors);
+    if (processors.isEmpty())
+        return;
+
+    // declared first so the pool is done with the jobs before they go
+    OwnedArray<NodeWarmUpJob> jobs;
+    ThreadPool pool (jlimit (1, processors.size(), SystemStats::getNumCpus()));
+
+    for (auto* processor : processors)
+        pool.addJob (jobs.add (new NodeWarmUpJob (*processor, numBlocks, jmax (1, getRenderBlockSize()))), false);
 
-    for (int i = 0; i < renderingOps.size(); ++i)
+    for (auto* job : jobs)
+        pool.waitForJobToFinish (job, -1);
+}
+
+void GraphProcessor::collectNodesToWarmUp (Array<AudioProcessor*>& processors) const
+{
+    for (auto* node : nodes)
     {
-        GraphRender::Task* const op = static_cast<GraphRender::Task*> (renderingOps.getUnchecked (i));
-        op->perform (renderingBuffers, midiBuffers, numSamples);
+        auto* const proc = node->getAudioProcessor();
+        if (proc == nullptr || ! node->isPrepared || ! node->isEnabled() || node->isFrozen()
+            || node->isAudioIONode() || node->isMidiIONode() || node->isMidiDeviceNode()
+            || node->wantsMidiPipe())
+            continue;
+
+        if (auto* const subGraph = dynamic_cast<GraphProcessor*> (proc))
+            subGraph->collectNodesToWarmUp (processors);
+        else
+            processors.add (proc);
     }
+}
+
+//=============================================================================
+
+int GraphProcessor::getMaxChunkSize() const noexcept
+{
+    return jlimit (1, renderBufferSize, getRenderBlockSize());
+}
+
+void GraphProcessor::renderBlock (const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                                  MidiBuffer& midiMessages)
+{
+    const int32 numSamples = output.getNumSamples();
+    // channels past the graph's outputs are only ever silent
+    const int numChannels = jmin (output.getNumChannels(), jmax (1, getTotalNumOutputChannels()));
+
+    currentAudioInputBuffer = &input;
+    currentAudioOutputBuffer.setSize (numChannels, numSamples, false, false, true);
+    currentAudioOutputBuffer.clear();
+
+    renderProgram (midiMessages, numSamples, false);
 
-    for (int i = 0; i < buffer.getNumChannels(); ++i)
-        buffer.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
+    for (int i = 0; i < numChannels; ++i)
+        output.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
+    for (int i = numChannels; i < output.getNumChannels(); ++i)
+        output.clear (i, 0, numSamples);
     
     midiMessages.clear();
     midiMessages.addEvents (currentMidiOutputBuffer, 0, numSamples, 0);
 }
 
+void GraphProcessor::renderBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    const int32 numSamples = buffer.getNumSamples();
+    const int numChannels = jmin (buffer.getNumChannels(), jmax (1, getTotalNumOutputChannels()));
+
+    currentDoubleInputBuffer = &buffer;
+    currentDoubleOutputBuffer.setSize (numChannels, numSamples, false, false, true);
+    currentDoubleOutputBuffer.clear();
+
+    renderProgram (midiMessages, numSamples, true);
+
+    for (int i = 0; i < numChannels; ++i)
+        buffer.copyFrom (i, 0, currentDoubleOutputBuffer, i, 0, numSamples);
+    for (int i = numChannels; i < buffer.getNumChannels(); ++i)
+        buffer.clear (i, 0, numSamples);
+
+    midiMessages.clear();
+    midiMessages.addEvents (currentMidiOutputBuffer, 0, numSamples, 0);
+}
+
+void GraphProcessor::renderProgram (MidiBuffer& midiMessages, const int numSamples, const bool useDouble)
+{
+    if (! midiFilter.canDropEvents())
+    {
+        // velocities are rewritten in place, the input isn't needed after this
+        if (midiFilter.isActive())
+            midiFilter.rewrite (midiMessages);
+        currentMidiInputBuffer = &midiMessages;
+    }
+    else
+    {
+        midiFilter.filter (midiMessages, filteredMidi);
+        currentMidiInputBuffer = &filteredMidi;
+    }
+    
+    currentMidiOutputBuffer.clear();
+
+    // advertise the program before rendering it, then make sure it wasn't
+    // replaced in the meantime. the message thread won't free a program
+    // while it is advertised here.
+    auto* current = program.load();
+    programInUse.store (current);
+    for (auto* latest = program.load(); latest != current; latest = program.load())
+    {
+        current = latest;
+        programInUse.store (current);
+    }
+
+    // sends overwrite a bus the first time they write to it in a block
+    auxBuses.beginBlock();
+
+    // a program built for the other precision renders nothing until the
+    // graph is prepared again
+    if (current != nullptr)
+        current->render (renderPool, numSamples, useDouble);
+
+    programInUse.store (nullptr);
+}
+
 const String GraphProcessor::getInputChannelName (int channelIndex) const
 {
     return "Input " + String (channelIndex + 1);
@@ -1459,8 +4816,24 @@ const String GraphProcessor::getOutputChannelName (int channelIndex) const
 
 bool GraphProcessor::isInputChannelStereoPair (int /*index*/) const    { return true; }
 bool GraphProcessor::isOutputChannelStereoPair (int /*index*/) const   { return true; }
-bool GraphProcessor::silenceInProducesSilenceOut() const               { return false; }
-double GraphProcessor::getTailLengthSeconds() const                    { return 0; }
+bool GraphProcessor::silenceInProducesSilenceOut() const
+{
+    // a graph is silent when idle if everything inside it is
+    for (const auto* node : nodes)
+    {
+        auto* const proc = node->getAudioProcessor();
+        if (proc == nullptr)
+            return false;
+        if (dynamic_cast<AudioGraphIOProcessor*> (proc) != nullptr)
+            continue;
+        if (node->wantsMidiPipe() || ! proc->silenceInProducesSilenceOut())
+            return false;
+    }
+
+    return true;
+}
+
+double GraphProcessor::getTailLengthSeconds() const                    { return tailLength.load (std::memory_order_relaxed); }
 bool GraphProcessor::acceptsMidi() const   { return true; }
 bool GraphProcessor::producesMidi() const  { return true; }
 void GraphProcessor::getStateInformation (MemoryBlock& /*destData*/) { }
@@ -1557,15 +4930,30 @@ void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buf
                                                           MidiBuffer& midiMessages)
 {
     jassert (graph != nullptr);
+    processIO (buffer, graph->currentAudioInputBuffer, graph->currentAudioOutputBuffer, midiMessages);
+}
+
+void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioBuffer<double>& buffer,
+                                                          MidiBuffer& midiMessages)
+{
+    jassert (graph != nullptr);
+    processIO (buffer, graph->currentDoubleInputBuffer, graph->currentDoubleOutputBuffer, midiMessages);
+}
 
+template<typename SampleType>
+void GraphProcessor::AudioGraphIOProcessor::processIO (AudioBuffer<SampleType>& buffer,
+                                                       const AudioBuffer<SampleType>* graphInput,
+                                                       AudioBuffer<SampleType>& graphOutput,
+                                                       MidiBuffer& midiMessages)
+{
     switch (type)
     {
         case audioOutputNode:
         {
-            for (int i = jmin (graph->currentAudioOutputBuffer.getNumChannels(),
+            for (int i = jmin (graphOutput.getNumChannels(),
                                buffer.getNumChannels()); --i >= 0;)
             {
-                graph->currentAudioOutputBuffer.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
+                graphOutput.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
             }
 
             break;
@@ -1573,18 +4961,18 @@ void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buf
 
         case audioInputNode:
         {
-            for (int i = jmin (graph->currentAudioInputBuffer->getNumChannels(),
-                               buffer.getNumChannels()); --i >= 0;)
-            {
-                buffer.copyFrom (i, 0, *graph->currentAudioInputBuffer, i, 0, buffer.getNumSamples());
-            }
-
+            const int numInputs = jmin (graphInput->getNumChannels(), buffer.getNumChannels());
+            for (int i = numInputs; --i >= 0;)
+                buffer.copyFrom (i, 0, *graphInput, i, 0, buffer.getNumSamples());
+            // shared inputs can have fewer channels than the graph
+            for (int i = numInputs; i < buffer.getNumChannels(); ++i)
+                buffer.clear (i, 0, buffer.getNumSamples());
             break;
         }
 
         case midiOutputNode:
             graph->currentMidiOutputBuffer.clear();
-            graph->currentMidiOutputBuffer.addEvents (midiMessages, 0, buffer.getNumSamples(), 0);
+            MidiBudget::addEvents (graph->currentMidiOutputBuffer, midiMessages, buffer.getNumSamples());
             midiMessages.clear();
             break;
 
@@ -1683,7 +5071,7 @@ void GraphProcessor::AudioGraphIOProcessor::setParentGraph (GraphProcessor* cons
     {
         setPlayConfigDetails (type == audioOutputNode ? graph->getTotalNumOutputChannels() : 0,
                               type == audioInputNode ? graph->getTotalNumInputChannels() : 0,
-                              graph->getSampleRate(), graph->getBlockSize());
+                              graph->getRenderSampleRate(), graph->getRenderBlockSize());
         updateHostDisplay();
     }
 }
@@ -20,12 +20,21 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/AuxBus.h"
 #include "engine/GraphNode.h"
+#include "engine/MidiFilterTable.h"
 #include "engine/VelocityCurve.h"
 #include "Signals.h"
 
 namespace Element {
 
+class RenderThreadPool;
+
+namespace GraphRender {
+class RenderProgram;
+struct RenderTopology;
+}
+
 /**
     A type of AudioProcessor which plays back a graph of other AudioProcessors.
 
@@ -110,6 +119,14 @@ public:
     */
     bool removeNode (uint32 nodeId);
 
+    /** Puts a new processor in the place of an existing node, keeping its ID
+        and every connection the new ports still allow. The render program is
+        rebuilt around it, reusing the ops of all the other nodes.
+
+        Returns the new node, or nullptr if the existing one isn't in this graph.
+    */
+    GraphNode* replaceNode (GraphNode* existing, AudioProcessor* newProcessor);
+
     /** Builds an array of ordered nodes */
     void getOrderedNodes (ReferenceCountedArray<GraphNode>& res);
     
@@ -130,6 +147,14 @@ public:
     */
     bool isConnected (uint32 sourceNode, uint32 destNode) const;
 
+    /** Returns true if anything is connected to an output port of a node */
+    bool hasConnectionFrom (uint32 sourceNode, uint32 sourcePort) const;
+
+    /** Finds which of the graph's audio inputs and outputs are connected
+        to anything, as bits set by channel. Channels that aren't can be
+        left out when feeding the graph and reading back what it rendered */
+    void getRoutedAudioChannels (BigInteger& inputs, BigInteger& outputs) const;
+
     /** Returns true if it would be legal to connect the specified points. */
     bool canConnect (uint32 sourceNode, uint32 sourcePort,
                      uint32 destNode, uint32 destPort) const;
@@ -187,6 +212,88 @@ public:
     /** Set the MIDI curve of this graph */
     void setVelocityCurveMode (const VelocityCurve::Mode) noexcept;
 
+    /** Set a user defined MIDI curve, 128 output velocities indexed by input */
+    void setCustomVelocityCurve (const uint8* values) noexcept;
+
+    /** Set the thread pool used when rendering in parallel. The pool must
+        outlive this graph or be unset before it is deleted */
+    void setRenderThreadPool (RenderThreadPool* pool);
+
+    /** Enable or disable multi-core rendering of independent branches */
+    void setParallelRenderingEnabled (const bool enabled);
+
+    /** Returns true if multi-core rendering is enabled on this graph */
+    bool isParallelRenderingEnabled() const noexcept { return parallelRender; }
+
+    /** The most stages a pipelined graph renders in */
+    static constexpr int maxPipelineStages = 8;
+
+    /** Renders the graph in up to this many stages, one per core, each a
+        block behind the one before. This takes over from multi-core
+        rendering and puts the graph a block later for every stage after the
+        first, in return for running long chains in parallel too. The graph
+        may end up with fewer stages than asked for, since inputs have to go
+        in the first, outputs in the last and nodes sharing other IO in the
+        same one. Pass 1 to render without a pipeline */
+    void setPipelineStages (int numStages);
+
+    /** Returns the number of stages asked for with setPipelineStages */
+    int getPipelineStages() const noexcept { return pipelineStages; }
+
+    /** Enable or disable flattening of subgraphs into this graph's program.
+        Only subgraphs whose node leaves audio and MIDI untouched are inlined */
+    void setSubGraphInliningEnabled (const bool enabled);
+
+    /** Returns true if subgraphs are inlined when rendering */
+    bool isSubGraphInliningEnabled() const noexcept { return inlineSubGraphs; }
+
+    /** Returns true if subgraphs are flattened into this graph, either because
+        it inlines them or because it is itself inlined into another graph */
+    bool isInliningSubGraphs() const noexcept { return inlineSubGraphs || inlinedInto != nullptr; }
+
+    /** Returns the sample rate nodes inside this graph are prepared at. The
+        graph's own, unless it renders at its own rate */
+    virtual double getRenderSampleRate() const      { return getSampleRate(); }
+
+    /** Returns the block size nodes inside this graph are prepared for */
+    virtual int getRenderBlockSize() const          { return getBlockSize(); }
+
+    /** Returns the latency this graph reports for that of its rendering
+        sequence, which is in samples of the render rate */
+    virtual int getReportedLatency (int renderLatency) const    { return renderLatency; }
+
+    /** Holds off rebuilding the rendering sequence. Nodes added, replaced
+        connected and removed meanwhile keep rendering through the current
+        sequence, which is rebuilt once when the last hold is released.
+        Clearing the graph still rebuilds straight away */
+    void beginBatchUpdate();
+
+    /** Releases a hold taken with beginBatchUpdate */
+    void endBatchUpdate();
+
+    /** Returns true while rebuilds are being held */
+    bool isBatchUpdating() const noexcept { return batchDepth > 0; }
+
+    /** Returns the aux buses of this graph. Sends and returns inside racks
+        inlined into it use these too */
+    AuxBuses& getAuxBuses() noexcept { return auxBuses; }
+
+    /** Returns how many times the rendering sequence has been rebuilt */
+    int getNumRenderBuilds() const noexcept { return numRenderBuilds; }
+
+    /** Returns the bytes the current render program holds for its shared
+        audio and MIDI buffers. Safe to call from any thread */
+    int64 getRenderMemoryBytes() const noexcept { return renderMemoryBytes.load (std::memory_order_relaxed); }
+
+    /** Describes the current render program for inspecting: its ops in render
+        order with the buffers each one uses, latency delays, the order nodes
+        process in and, for profiled nodes, their timings. Call this from the
+        message thread. @see RenderInspector */
+    var getRenderProgramInfo() const;
+
+    /** Returns true if this graph filters or reshapes its MIDI input */
+    bool isFilteringMidi() const noexcept;
+
     /** A special number that represents the midi channel of a node.
 
         This is used as a channel index value if you want to refer to the midi input
@@ -255,6 +362,8 @@ public:
         void prepareToPlay (double sampleRate, int estimatedSamplesPerBlock);
         void releaseResources();
         void processBlock (AudioSampleBuffer&, MidiBuffer&);
+        void processBlock (AudioBuffer<double>&, MidiBuffer&);
+        bool supportsDoublePrecisionProcessing() const { return true; }
 
         bool isInputChannelStereoPair (int index) const;
         bool isOutputChannelStereoPair (int index) const;
@@ -286,6 +395,10 @@ public:
         const IODeviceType type;
         GraphProcessor* graph;
 
+        template<typename SampleType>
+        void processIO (AudioBuffer<SampleType>&, const AudioBuffer<SampleType>* graphInput,
+                        AudioBuffer<SampleType>& graphOutput, MidiBuffer&);
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioGraphIOProcessor)
     };
 
@@ -296,14 +409,44 @@ public:
     virtual void prepareToPlay (double sampleRate, int estimatedBlockSize) override;
     virtual void releaseResources() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+
+    /** Renders a block reading audio from an input that is never written to,
+        so several graphs can share one without copying it */
+    void processBlock (const AudioSampleBuffer& input, AudioSampleBuffer& output, MidiBuffer&);
+
+    /** Renders silent blocks through every prepared node, including those in
+        sub-graphs, several nodes at a time on background threads. Plugins
+        tend to allocate and page in their data on the first few blocks, this
+        gets that done before the graph is heard.
+
+        Not realtime safe! Nothing else may be rendering the graph meanwhile,
+        suspend it first if it's attached to the engine.
+     */
+    void warmUp (int numBlocks);
+
+    /** Changes the block size of a prepared graph without releasing it.
+        Nodes prepared for at least the new size keep running as they are,
+        the rest are prepared again. Call where prepareToPlay() would be */
+    void setBlockSize (int blockSize);
+
+    /** Graphs render in 64-bit when set to double precision. Nodes which
+        support it process doubles directly, everything else is converted
+        at its boundary */
+    bool supportsDoublePrecisionProcessing() const override          { return true; }
     
     void reset() override;
+
+    /** Passes the realtime state on to every node, including nested graphs */
+    void setNonRealtime (bool isNonRealtime) noexcept override;
     
     virtual const String getInputChannelName (int channelIndex) const override;
     virtual const String getOutputChannelName (int channelIndex) const override;
     virtual bool isInputChannelStereoPair (int index) const override;
     virtual bool isOutputChannelStereoPair (int index) const override;
     virtual bool silenceInProducesSilenceOut() const override;
+    /** Returns the longest tail reported by a node, as of the last
+        rendering sequence build */
     virtual double getTailLengthSeconds() const override;
 
     virtual bool acceptsMidi() const override;
@@ -338,28 +481,69 @@ private:
     typedef ArcTable<Connection> LookupTable;
     ReferenceCountedArray<GraphNode> nodes;
     OwnedArray<Connection> connections;
+    class ConnectionIndex; std::unique_ptr<ConnectionIndex> connectionIndex;
     uint32 ioNodes [AudioGraphIOProcessor::numDeviceTypes];
     
     uint32 lastNodeId;
-    AudioSampleBuffer renderingBuffers;
-    OwnedArray <MidiBuffer> midiBuffers;
-    Array<void*> renderingOps;
+    std::atomic<GraphRender::RenderProgram*> program { nullptr };
+    std::atomic<GraphRender::RenderProgram*> programInUse { nullptr };
+    OwnedArray<GraphRender::RenderProgram> retiredPrograms;
+    // recently replaced programs, kept so a graph going back to an earlier
+    // topology doesn't have to rebuild
+    OwnedArray<GraphRender::RenderProgram> cachedPrograms;
+    static constexpr int maxCachedPrograms = 8;
+    RenderThreadPool* renderPool = nullptr;
+    bool parallelRender = false;
+    int pipelineStages = 1;
+    bool inlineSubGraphs = false;
+    // the graph rendering this one as part of its own program, if any
+    GraphProcessor* inlinedInto = nullptr;
+    AuxBuses auxBuses;
+    bool building = false;
+    int batchDepth = 0;
+    bool rebuildPending = false;
+    int numRenderBuilds = 0;
+    // nodes replaced or removed during a batch, still rendered until it ends
+    ReferenceCountedArray<GraphNode> detachedNodes;
+    void releaseDetachedNodes();
+    // longest tail of the nodes, updated when the sequence is built
+    std::atomic<double> tailLength { 0.0 };
+    std::atomic<int64> renderMemoryBytes { 0 };
 
     friend class AudioGraphIOProcessor;
     friend class GraphPort;
+    friend struct GraphRender::RenderTopology;
 
-    AudioSampleBuffer* currentAudioInputBuffer;
+    const AudioSampleBuffer* currentAudioInputBuffer;
     AudioSampleBuffer currentAudioOutputBuffer;
+    const AudioBuffer<double>* currentDoubleInputBuffer = nullptr;
+    AudioBuffer<double> currentDoubleOutputBuffer;
     MidiBuffer* currentMidiInputBuffer;
     MidiBuffer currentMidiOutputBuffer;
     
     kv::MidiChannels midiChannels;
     VelocityCurve velocityCurve;
+    MidiFilterTable midiFilter;
     MidiBuffer filteredMidi;
+    void updateMidiFilter();
+
+    // blocks larger than the prepared size are rendered in pieces
+    MidiBuffer chunkMidi, chunkMidiOut;
+    int getMaxChunkSize() const noexcept;
     
     void handleAsyncUpdate() override;
+    void collectNodesToWarmUp (Array<AudioProcessor*>& processors) const;
+    void prepareNodes();
+    void renderBlock (const AudioSampleBuffer& input, AudioSampleBuffer& output, MidiBuffer& midi);
+    void renderBlock (AudioBuffer<double>& buffer, MidiBuffer& midi);
+    void renderProgram (MidiBuffer& midiMessages, int numSamples, bool useDouble);
     void clearRenderingSequence();
     void buildRenderingSequence();
+    void programChanged();
+    void publishProgram (GraphRender::RenderProgram*);
+    void reclaimRetiredPrograms();
+    void clearCachedPrograms();
+    int64 getTopologyHash (bool buildParallel) const;
     bool isAnInputTo (uint32 possibleInputId, uint32 possibleDestinationId, int recursionCheck) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphProcessor)
@@ -0,0 +1,47 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/HeapMeter.h"
+
+#if JUCE_LINUX
+ #include <malloc.h>
+#elif JUCE_MAC
+ #include <malloc/malloc.h>
+#endif
+
+namespace Element {
+
+int64 HeapMeter::getAllocatedBytes()
+{
+   #if JUCE_LINUX && defined (__GLIBC__)
+    #if __GLIBC_PREREQ (2, 33)
+     const auto info = mallinfo2();
+    #else
+     const auto info = mallinfo();
+    #endif
+    // small blocks plus those mapped on their own
+    return (int64) info.uordblks + (int64) info.hblkhd;
+   #elif JUCE_MAC
+    return (int64) mstats().bytes_used;
+   #else
+    return -1;
+   #endif
+}
+
+}
@@ -0,0 +1,55 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Reads how much the process has allocated from the heap, for measuring
+    what creating something costs. Other threads allocate meanwhile, so the
+    growth is only a close guess.
+ */
+struct HeapMeter
+{
+    /** Returns the bytes allocated from the heap, or -1 where the platform
+        can't tell */
+    static int64 getAllocatedBytes();
+
+    /** Measures the heap's growth over its lifetime */
+    class Scope
+    {
+    public:
+        Scope() : start (getAllocatedBytes()) { }
+
+        /** Returns the bytes allocated since the scope began. Zero if the heap
+            shrank or can't be read */
+        int64 getGrowth() const
+        {
+            const auto now = getAllocatedBytes();
+            return start >= 0 && now > start ? now - start : 0;
+        }
+
+    private:
+        const int64 start;
+    };
+};
+
+}
@@ -22,22 +22,29 @@
 #include "engine/nodes/AllPassFilterNode.h"
 #include "engine/nodes/AudioFilePlayerNode.h"
 #include "engine/nodes/AudioMixerProcessor.h"
+#include "engine/nodes/AuxBusNodes.h"
 #include "engine/nodes/ChannelizeProcessor.h"
 #include "engine/nodes/CombFilterProcessor.h"
 #include "engine/nodes/CompressorProcessor.h"
+#include "engine/nodes/ConvolutionProcessor.h"
 #include "engine/nodes/EQFilterProcessor.h"
 #include "engine/nodes/FreqSplitterProcessor.h"
 #include "engine/nodes/LuaNode.h"
+#include "engine/nodes/AudioRecorderNode.h"
 #include "engine/nodes/MediaPlayerProcessor.h"
 #include "engine/nodes/MidiChannelMapProcessor.h"
 #include "engine/nodes/MidiChannelSplitterNode.h"
 #include "engine/nodes/MidiDeviceProcessor.h"
 #include "engine/nodes/MidiMonitorNode.h"
 #include "engine/nodes/MidiRouterNode.h"
+#include "engine/nodes/MidiFilePlayerNode.h"
+#include "engine/nodes/MidiSequencerProcessor.h"
+#include "engine/nodes/NetworkAudioNodes.h"
 #include "engine/nodes/PlaceholderProcessor.h"
 #include "engine/nodes/OSCReceiverNode.h"
 #include "engine/nodes/OSCSenderNode.h"
 #include "engine/nodes/ReverbProcessor.h"
+#include "engine/nodes/SamplerNode.h"
 #include "engine/nodes/SubGraphProcessor.h"
 #include "engine/nodes/VolumeProcessor.h"
 #include "engine/nodes/WetDryProcessor.h"
@@ -170,9 +177,29 @@ bool InternalFormat::requiresUnblockedMessageThreadDuringCreation (const PluginD
 
 // MARK: Element Format
 
+/** Bump this when a node's description changes but its identifier doesn't */
+static const int internalTypesRevision = 1;
+
 ElementAudioPluginFormat::ElementAudioPluginFormat (Globals& g)
     : world (g) { }
 
+const OwnedArray<PluginDescription>& ElementAudioPluginFormat::getTypes()
+{
+    if (types.isEmpty())
+        for (const auto& identifier : searchPathsForPlugins (FileSearchPath(), false, false))
+            findAllTypesForFile (types, identifier);
+    return types;
+}
+
+String ElementAudioPluginFormat::getTypesVersion()
+{
+    const auto identifiers = searchPathsForPlugins (FileSearchPath(), false, false);
+    String version (ProjectInfo::versionString);
+    version << "." << internalTypesRevision << "."
+            << String::toHexString (identifiers.joinIntoString (",").hashCode64());
+    return version;
+}
+
 void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescription>& ds, const String& fileOrId)
 {
     if (fileOrId == "element.comb")
@@ -252,6 +279,11 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* desc = ds.add (new PluginDescription());
         CompressorProcessor().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_CONVOLUTION)
+    {
+        auto* desc = ds.add (new PluginDescription());
+        ConvolutionProcessor().fillInPluginDescription (*desc);
+    }
 
    #if defined (EL_PRO)
     else if (fileOrId == EL_INTERNAL_ID_GRAPH)
@@ -274,6 +306,13 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* const desc = ds.add (new PluginDescription());
         MidiChannelMapProcessor().fillInPluginDescription (*desc);
     }
+   #if EL_USE_MIDI_SEQUENCER
+    else if (fileOrId == EL_INTERNAL_ID_MIDI_SEQUENCER)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        MidiSequencerProcessor().fillInPluginDescription (*desc);
+    }
+   #endif
     else if (fileOrId == EL_INTERNAL_ID_MIDI_CHANNEL_SPLITTER)
     {
         auto* const desc = ds.add (new PluginDescription());
@@ -322,6 +361,41 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* const desc = ds.add (new PluginDescription());
         MediaPlayerProcessor().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_AUDIO_RECORDER)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        AudioRecorderNode().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_SAMPLER)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        SamplerNode().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_MIDI_FILE_PLAYER)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        MidiFilePlayerNode().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_NETWORK_SEND)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        NetworkAudioSendNode().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_NETWORK_RECEIVE)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        NetworkAudioReceiveNode().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_AUX_SEND)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        AuxSendNode().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_AUX_RETURN)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        AuxReturnNode().fillInPluginDescription (*desc);
+    }
     else if (fileOrId == EL_INTERNAL_ID_MIDI_PROGRAM_MAP)
     {
         auto* const desc = ds.add (new PluginDescription());
@@ -372,6 +446,7 @@ StringArray ElementAudioPluginFormat::searchPathsForPlugins (const FileSearchPat
     StringArray results;
     results.add (EL_INTERNAL_ID_COMB_FILTER);
     results.add (EL_INTERNAL_ID_COMPRESSOR);
+    results.add (EL_INTERNAL_ID_CONVOLUTION);
     results.add (EL_INTERNAL_ID_EQ_FILTER);
     results.add (EL_INTERNAL_ID_FREQ_SPLITTER);
     results.add ("element.allPass");
@@ -393,12 +468,19 @@ StringArray ElementAudioPluginFormat::searchPathsForPlugins (const FileSearchPat
 
    #if defined (EL_SOLO) || defined (EL_PRO)
     results.add (EL_INTERNAL_ID_AUDIO_FILE_PLAYER);
+    results.add (EL_INTERNAL_ID_AUDIO_RECORDER);
+    results.add (EL_INTERNAL_ID_SAMPLER);
+    results.add (EL_INTERNAL_ID_MIDI_FILE_PLAYER);
     results.add (EL_INTERNAL_ID_AUDIO_ROUTER);
     results.add (EL_INTERNAL_ID_MIDI_ROUTER);
     results.add (EL_INTERNAL_ID_MIDI_PROGRAM_MAP);
     results.add (EL_INTERNAL_ID_MIDI_MONITOR);
     results.add (EL_INTERNAL_ID_OSC_RECEIVER);
     results.add (EL_INTERNAL_ID_OSC_SENDER);
+    results.add (EL_INTERNAL_ID_NETWORK_SEND);
+    results.add (EL_INTERNAL_ID_NETWORK_RECEIVE);
+    results.add (EL_INTERNAL_ID_AUX_SEND);
+    results.add (EL_INTERNAL_ID_AUX_RETURN);
    #if EL_USE_LUA
     results.add (EL_INTERNAL_ID_LUA);
    #endif
@@ -434,6 +516,8 @@ AudioPluginInstance* ElementAudioPluginFormat::instantiatePlugin (const PluginDe
         base = new FreqSplitterProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_COMPRESSOR)
         base = new CompressorProcessor();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_CONVOLUTION)
+        base = new ConvolutionProcessor();
 
    #if defined (EL_PRO)
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_GRAPH)
@@ -444,6 +528,10 @@ AudioPluginInstance* ElementAudioPluginFormat::instantiatePlugin (const PluginDe
         base = new ChannelizeProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_MIDI_CHANNEL_MAP)
         base = new MidiChannelMapProcessor();
+   #if EL_USE_MIDI_SEQUENCER
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_MIDI_SEQUENCER)
+        base = new MidiSequencerProcessor();
+   #endif
    #endif // EL_PRO
 
    #if defined (EL_PRO) || defined (EL_SOLO)
@@ -451,6 +539,20 @@ AudioPluginInstance* ElementAudioPluginFormat::instantiatePlugin (const PluginDe
         base = new AudioFilePlayerNode();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_MEDIA_PLAYER)
         base = new MediaPlayerProcessor();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_AUDIO_RECORDER)
+        base = new AudioRecorderNode();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_SAMPLER)
+        base = new SamplerNode();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_MIDI_FILE_PLAYER)
+        base = new MidiFilePlayerNode();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_NETWORK_SEND)
+        base = new NetworkAudioSendNode();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_NETWORK_RECEIVE)
+        base = new NetworkAudioReceiveNode();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_AUX_SEND)
+        base = new AuxSendNode();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_AUX_RETURN)
+        base = new AuxReturnNode();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_PLACEHOLDER)
         base = new PlaceholderProcessor();
    #endif // EL_PRO || EL_SOLO
@@ -117,6 +117,15 @@ public:
     bool pluginNeedsRescanning (const PluginDescription&)       override { return false; }
     StringArray searchPathsForPlugins (const FileSearchPath&, bool /*recursive*/, bool /*allowAsync*/) override;
     bool isTrivialToScan() const override { return true; }
+
+    /** Returns the descriptions of every node this format makes. They're
+        built the first time they're asked for and kept */
+    const OwnedArray<PluginDescription>& getTypes();
+
+    /** Returns a key that changes with the set of nodes and the app's
+        version, without building any descriptions. Plugin lists stamped
+        with it hold the current nodes */
+    String getTypesVersion();
     
 protected:
     void createPluginInstance (const PluginDescription&,
@@ -127,6 +136,7 @@ protected:
     
 private:
     Globals& world;
+    OwnedArray<PluginDescription> types;
     PluginDescription reverbDesc;
     PluginDescription combFilterDesc;
     PluginDescription allPassFilterDesc;
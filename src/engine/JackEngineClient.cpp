@@ -0,0 +1,317 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/JackEngineClient.h"
+
+#if EL_USE_JACK
+
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include "engine/AudioEngine.h"
+#include "engine/MidiBudget.h"
+
+namespace Element {
+
+struct JackEngineClient::Callbacks
+{
+    static JackEngineClient& get (void* arg) { return *static_cast<JackEngineClient*> (arg); }
+
+    static int process (jack_nframes_t nframes, void* arg)
+    {
+        return get (arg).process ((uint32) nframes);
+    }
+
+    static int bufferSize (jack_nframes_t nframes, void* arg)
+    {
+        auto& self = get (arg);
+        self.blockSize = (int) nframes;
+        self.prepare();
+        return 0;
+    }
+
+    static int sampleRate (jack_nframes_t nframes, void* arg)
+    {
+        auto& self = get (arg);
+        self.sampleRate = (double) nframes;
+        self.prepare();
+        return 0;
+    }
+
+    static void latency (jack_latency_callback_mode_t mode, void* arg)
+    {
+        get (arg).reportLatency (mode == JackCaptureLatency);
+    }
+
+    static void shutdown (void* arg)
+    {
+        // the server's gone, the client can only be closed now
+        get (arg).serverGone.store (true);
+    }
+};
+
+//=============================================================================
+JackEngineClient::JackEngineClient (AudioEngine& e)
+    : engine (e)
+{ }
+
+JackEngineClient::~JackEngineClient()
+{
+    close();
+}
+
+Result JackEngineClient::open (const String& clientName)
+{
+    if (client != nullptr)
+        return Result::ok();
+
+    jack_status_t status;
+    client = jack_client_open (clientName.toRawUTF8(), JackNoStartServer, &status);
+    if (client == nullptr)
+        return Result::fail ("Could not connect to the JACK server");
+
+    serverGone.store (false);
+    sampleRate = (double) jack_get_sample_rate (client);
+    blockSize  = (int) jack_get_buffer_size (client);
+
+    jack_set_process_callback (client, Callbacks::process, this);
+    jack_set_buffer_size_callback (client, Callbacks::bufferSize, this);
+    jack_set_sample_rate_callback (client, Callbacks::sampleRate, this);
+    jack_set_latency_callback (client, Callbacks::latency, this);
+    jack_on_shutdown (client, Callbacks::shutdown, this);
+
+    midiIn  = jack_port_register (client, "midi_in",  JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+    midiOut = jack_port_register (client, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+    setNumPorts (2, 2);
+
+    latencyChangedConnection = engine.sampleLatencyChanged.connect ([this]()
+    {
+        if (client != nullptr && ! serverGone.load())
+            jack_recompute_total_latencies (client);
+    });
+
+    if (jack_activate (client) != 0)
+    {
+        close();
+        return Result::fail ("Could not activate the JACK client");
+    }
+
+    return Result::ok();
+}
+
+void JackEngineClient::close()
+{
+    if (client == nullptr)
+        return;
+
+    latencyChangedConnection.disconnect();
+    if (! serverGone.load())
+        jack_deactivate (client);
+    jack_client_close (client);
+    client = nullptr;
+    inputs.clearQuick();
+    outputs.clearQuick();
+    midiIn = midiOut = nullptr;
+    engine.releaseExternalResources();
+}
+
+void JackEngineClient::setNumPorts (int numInputs, int numOutputs)
+{
+    if (client == nullptr || serverGone.load())
+        return;
+
+    numInputs  = jlimit (0, DeviceManager::maxAudioChannels, numInputs);
+    numOutputs = jlimit (0, DeviceManager::maxAudioChannels, numOutputs);
+
+    {
+        const SpinLock::ScopedLockType sl (portLock);
+        registerPorts (inputs, numInputs, true);
+        registerPorts (outputs, numOutputs, false);
+        channels.calloc ((size_t) jmax (numInputs, numOutputs) + 1);
+        spare.setSize (jmax (1, numInputs - numOutputs), jmax (1, blockSize));
+    }
+
+    prepare();
+    jack_recompute_total_latencies (client);
+}
+
+void JackEngineClient::registerPorts (Array<jack_port_t*>& ports, int numPorts, bool isInput)
+{
+    while (ports.size() > numPorts)
+        jack_port_unregister (client, ports.removeAndReturn (ports.size() - 1));
+
+    while (ports.size() < numPorts)
+    {
+        const String name = String (isInput ? "main_in_" : "main_out_") + String (ports.size() + 1);
+        auto* port = jack_port_register (client, name.toRawUTF8(), JACK_DEFAULT_AUDIO_TYPE,
+                                         isInput ? JackPortIsInput : JackPortIsOutput, 0);
+        if (port == nullptr)
+            break;
+        ports.add (port);
+    }
+}
+
+void JackEngineClient::prepare()
+{
+    if (sampleRate <= 0.0 || blockSize <= 0)
+        return;
+
+    // graphs take the port counts like they'd take a device's channels
+    for (int i = 0;; ++i)
+    {
+        auto* graph = engine.getGraph (i);
+        if (graph == nullptr)
+            break;
+        graph->setPlayConfigDetails (inputs.size(), outputs.size(), sampleRate, blockSize);
+    }
+
+    {
+        const SpinLock::ScopedLockType sl (portLock);
+        spare.setSize (jmax (1, inputs.size() - outputs.size()), blockSize);
+        MidiBudget::reserve (midi);
+    }
+
+    engine.prepareExternalPlayback (sampleRate, blockSize, inputs.size(), outputs.size());
+}
+
+int JackEngineClient::process (uint32 nframes)
+{
+    const int numSamples = (int) nframes;
+    void* const midiOutBuffer = midiOut != nullptr ? jack_port_get_buffer (midiOut, nframes) : nullptr;
+    if (midiOutBuffer != nullptr)
+        jack_midi_clear_buffer (midiOutBuffer);
+
+    const SpinLock::ScopedTryLockType sl (portLock);
+    if (! sl.isLocked() || numSamples > blockSize)
+    {
+        for (auto* port : outputs)
+            zeromem (jack_port_get_buffer (port, nframes), sizeof (float) * (size_t) numSamples);
+        return 0;
+    }
+
+    // outputs are rendered into directly, inputs are copied onto them once
+    const int numIns  = inputs.size();
+    const int numOuts = outputs.size();
+    int numChans = 0;
+    for (int i = 0; i < numOuts; ++i)
+    {
+        auto* out = static_cast<float*> (jack_port_get_buffer (outputs.getUnchecked (i), nframes));
+        if (i < numIns)
+            memcpy (out, jack_port_get_buffer (inputs.getUnchecked (i), nframes), sizeof (float) * (size_t) numSamples);
+        else
+            zeromem (out, sizeof (float) * (size_t) numSamples);
+        channels[numChans++] = out;
+    }
+
+    for (int i = numOuts; i < numIns; ++i)
+    {
+        auto* extra = spare.getWritePointer (i - numOuts);
+        memcpy (extra, jack_port_get_buffer (inputs.getUnchecked (i), nframes), sizeof (float) * (size_t) numSamples);
+        channels[numChans++] = extra;
+    }
+
+    midi.clear();
+    if (midiIn != nullptr)
+    {
+        auto* const midiInBuffer = jack_port_get_buffer (midiIn, nframes);
+        const auto numEvents = jack_midi_get_event_count (midiInBuffer);
+        for (uint32 i = 0; i < numEvents; ++i)
+        {
+            jack_midi_event_t event;
+            if (jack_midi_event_get (&event, midiInBuffer, i) == 0)
+                midi.addEvent (event.buffer, (int) event.size, (int) event.time);
+        }
+    }
+
+    if (followTransport.load())
+        engine.processExternalPlayhead (this, numSamples);
+
+    AudioBuffer<float> buffer (channels.get(), numChans, numSamples);
+    engine.processExternalBuffers (buffer, midi);
+
+    if (midiOutBuffer != nullptr)
+    {
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data; int size, frame;
+        while (iter.getNextEvent (data, size, frame))
+            if (isPositiveAndBelow (frame, numSamples))
+                jack_midi_event_write (midiOutBuffer, (jack_nframes_t) frame, data, (size_t) size);
+    }
+
+    return 0;
+}
+
+void JackEngineClient::reportLatency (bool capture)
+{
+    // whatever reaches the inputs is heard the graph's latency later on the outputs
+    const auto latency = (jack_nframes_t) jmax (0, engine.getExternalLatencySamples());
+    const auto mode = capture ? JackCaptureLatency : JackPlaybackLatency;
+    const auto& from = capture ? inputs : outputs;
+    const auto& to   = capture ? outputs : inputs;
+
+    jack_latency_range_t range { 0, 0 };
+    for (auto* port : from)
+    {
+        jack_latency_range_t portRange;
+        jack_port_get_latency_range (port, mode, &portRange);
+        range.min = port == from.getFirst() ? portRange.min : jmin (range.min, portRange.min);
+        range.max = jmax (range.max, portRange.max);
+    }
+
+    range.min += latency;
+    range.max += latency;
+    for (auto* port : to)
+        jack_port_set_latency_range (port, mode, &range);
+}
+
+bool JackEngineClient::getCurrentPosition (CurrentPositionInfo& result)
+{
+    jack_position_t pos;
+    const auto state = jack_transport_query (client, &pos);
+
+    result.resetToDefault();
+    result.timeInSamples = (int64) pos.frame;
+    result.timeInSeconds = pos.frame_rate > 0 ? (double) pos.frame / (double) pos.frame_rate : 0.0;
+    result.isPlaying     = state == JackTransportRolling;
+
+    if ((pos.valid & JackPositionBBT) != 0 && pos.beats_per_minute > 0.0)
+    {
+        const double quartersPerBeat = pos.beat_type > 0.0f ? 4.0 / (double) pos.beat_type : 1.0;
+        const double barBeats = (double) (pos.bar - 1) * (double) pos.beats_per_bar;
+        const double beat     = (double) (pos.beat - 1)
+            + (pos.ticks_per_beat > 0.0 ? (double) pos.tick / pos.ticks_per_beat : 0.0);
+        result.bpm                  = pos.beats_per_minute;
+        result.timeSigNumerator     = roundToInt (pos.beats_per_bar);
+        result.timeSigDenominator   = roundToInt (pos.beat_type);
+        result.ppqPositionOfLastBarStart = barBeats * quartersPerBeat;
+        result.ppqPosition          = (barBeats + beat) * quartersPerBeat;
+    }
+    else
+    {
+        // no timebase master, keep the engine's own tempo and meter
+        const auto snapshot = engine.getTransportMonitor()->read();
+        result.bpm = snapshot.tempo;
+        result.timeSigNumerator = snapshot.beatsPerBar;
+    }
+
+    return true;
+}
+
+}
+
+#endif
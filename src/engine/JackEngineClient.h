@@ -0,0 +1,99 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+#if EL_USE_JACK
+
+typedef struct _jack_client jack_client_t;
+typedef struct _jack_port jack_port_t;
+
+namespace Element {
+
+class AudioEngine;
+
+/** Runs the engine as its own JACK client, bypassing the device layer.
+
+    JACK calls the engine directly with its port buffers: output ports are
+    rendered into in place and inputs are copied once onto them, which is the
+    least the engine's in place processing allows. Ports can be added and
+    removed while running, and the engine's latency is reported on them.
+    Optionally the transport follows JACK's.
+ */
+class JackEngineClient : private AudioPlayHead
+{
+public:
+    explicit JackEngineClient (AudioEngine& engine);
+    ~JackEngineClient();
+
+    /** Connects to the JACK server, never starting one, and starts
+        rendering. Returns an error if there's no server */
+    Result open (const String& clientName = "Element");
+
+    /** Stops rendering and disconnects */
+    void close();
+
+    bool isOpen() const noexcept { return client != nullptr; }
+
+    /** Changes the number of audio ports and prepares the engine's graphs
+        for them. Call from the message thread */
+    void setNumPorts (int numInputs, int numOutputs);
+
+    int getNumInputPorts() const noexcept   { return inputs.size(); }
+    int getNumOutputPorts() const noexcept  { return outputs.size(); }
+
+    /** Follows JACK transport's play state, position and tempo */
+    void setFollowTransport (bool shouldFollow) noexcept   { followTransport.store (shouldFollow); }
+    bool isFollowingTransport() const noexcept             { return followTransport.load(); }
+
+private:
+    AudioEngine& engine;
+    jack_client_t* client = nullptr;
+    Array<jack_port_t*> inputs, outputs;
+    jack_port_t* midiIn = nullptr;
+    jack_port_t* midiOut = nullptr;
+
+    // ports only change while the callback is locked out
+    SpinLock portLock;
+    HeapBlock<float*> channels;
+    AudioBuffer<float> spare;
+    MidiBuffer midi;
+    double sampleRate = 0.0;
+    int blockSize = 0;
+    std::atomic<bool> followTransport { false };
+    std::atomic<bool> serverGone { false };
+    SignalConnection latencyChangedConnection;
+
+    void prepare();
+    void registerPorts (Array<jack_port_t*>& ports, int numPorts, bool isInput);
+    int process (uint32 nframes);
+    void reportLatency (bool capture);
+    bool getCurrentPosition (CurrentPositionInfo& result) override;
+
+    struct Callbacks;
+    friend struct Callbacks;
+
+    JUCE_DECLARE_NON_COPYABLE (JackEngineClient)
+};
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/JobService.h"
+
+namespace Element {
+
+/** How many jobs can wait for the service's thread across every client */
+static const int maxQueuedJobs = 1024;
+
+//=============================================================================
+/** A bounded queue of jobs. Any number of threads can push, each with one
+    compare and swap, and one thread pops */
+class JobService::Queue
+{
+public:
+    explicit Queue (int capacity)
+        : mask (nextPowerOfTwo (jmax (2, capacity)) - 1)
+    {
+        slots.calloc ((size_t) mask + 1);
+        for (size_t i = 0; i <= mask; ++i)
+            slots[i].sequence.store (i, std::memory_order_relaxed);
+    }
+
+    bool push (Job* job) noexcept
+    {
+        size_t position = writePosition.load (std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        for (;;)
+        {
+            slot = &slots [position & mask];
+            const size_t sequence = slot->sequence.load (std::memory_order_acquire);
+            const auto diff = (intptr_t) sequence - (intptr_t) position;
+
+            if (diff == 0)
+            {
+                if (writePosition.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = writePosition.load (std::memory_order_relaxed);
+            }
+        }
+
+        slot->job = job;
+        slot->sequence.store (position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop (Job*& job) noexcept
+    {
+        auto& slot = slots [readPosition & mask];
+        if (slot.sequence.load (std::memory_order_acquire) != readPosition + 1)
+            return false;
+
+        job = slot.job;
+        slot.sequence.store (readPosition + mask + 1, std::memory_order_release);
+        ++readPosition;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        Job* job;
+    };
+
+    const size_t mask;
+    HeapBlock<Slot> slots;
+    std::atomic<size_t> writePosition { 0 };
+    size_t readPosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (Queue)
+};
+
+//=============================================================================
+JobService::Client::Client()
+    : responses (new JobService::Queue (maxPendingJobs)),
+      retired (new JobService::Queue (maxPendingJobs))
+{
+    service->attach (*this);
+}
+
+JobService::Client::~Client()
+{
+    // once detached the service drops the jobs it still has queued for us
+    service->detach (*this);
+
+    Job* job = nullptr;
+    while (responses->pop (job))
+        delete job;
+    while (retired->pop (job))
+        delete job;
+}
+
+bool JobService::Client::schedule (Job* job) noexcept
+{
+    jassert (job != nullptr);
+    if (numPending.fetch_add (1) >= (int) maxPendingJobs)
+    {
+        numPending.fetch_sub (1);
+        return false;
+    }
+
+    job->client = this;
+    job->clientId = id;
+    numWaiting.fetch_add (1);
+
+    if (! service->requests->push (job))
+    {
+        numWaiting.fetch_sub (1);
+        numPending.fetch_sub (1);
+        return false;
+    }
+
+    service->notify();
+    return true;
+}
+
+int JobService::Client::deliverResponses() noexcept
+{
+    int numDelivered = 0;
+    Job* job = nullptr;
+
+    while (responses->pop (job))
+    {
+        job->respond();
+        // can't fail, there's never more pending than it holds
+        retired->push (job);
+        ++numDelivered;
+    }
+
+    if (numDelivered > 0)
+        service->notify();
+    return numDelivered;
+}
+
+bool JobService::Client::waitUntilReady (int timeoutMs)
+{
+    const auto timeout = Time::getMillisecondCounter() + (uint32) jmax (0, timeoutMs);
+    while (numWaiting.load() > 0)
+    {
+        if (Time::getMillisecondCounter() >= timeout)
+            return false;
+        Thread::sleep (1);
+    }
+
+    return true;
+}
+
+//=============================================================================
+JobService::JobService()
+    : Thread ("el.jobService"),
+      requests (new Queue (maxQueuedJobs))
+{
+    startThread (3);
+}
+
+JobService::~JobService()
+{
+    jassert (clients.isEmpty());
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+
+    Job* job = nullptr;
+    while (requests->pop (job))
+        delete job;
+}
+
+void JobService::attach (Client& client)
+{
+    const ScopedLock sl (clientLock);
+    client.id = ++lastClientId;
+    clients.add (&client);
+}
+
+void JobService::detach (Client& client)
+{
+    // waits for a job the client has running
+    const ScopedLock sl (clientLock);
+    clients.removeFirstMatchingValue (&client);
+}
+
+void JobService::runJob (Job* job)
+{
+    const ScopedLock sl (clientLock);
+    auto* const client = job->client;
+
+    // the client went away while this was queued
+    if (! clients.contains (client) || client->id != job->clientId)
+    {
+        delete job;
+        return;
+    }
+
+    job->run();
+    client->responses->push (job);
+    client->numWaiting.fetch_sub (1);
+}
+
+void JobService::retireJobs()
+{
+    const ScopedLock sl (clientLock);
+    for (auto* client : clients)
+    {
+        Job* job = nullptr;
+        while (client->retired->pop (job))
+        {
+            delete job;
+            client->numPending.fetch_sub (1);
+        }
+    }
+}
+
+void JobService::run()
+{
+    while (! threadShouldExit())
+    {
+        retireJobs();
+
+        Job* job = nullptr;
+        while (! threadShouldExit() && requests->pop (job))
+            runJob (job);
+
+        wait (250);
+    }
+}
+
+}
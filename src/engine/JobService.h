@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** The engine's service for work nodes shouldn't do while rendering.
+
+    It works like the LV2 worker. A node schedules a job through its Client
+    from any thread, the job runs on the service's thread, then its response
+    waits in a lock-free queue until the node drains it on the render thread
+    at the start of a block. Scheduling and draining never allocate or wait
+    on a lock, so the render callback can schedule jobs too. Jobs are deleted
+    back on the service's thread after they've responded.
+
+    There is one for the app, shared through a SharedResourcePointer.
+ */
+class JobService : private Thread
+{
+public:
+    class Client;
+
+    /** A piece of work and what to do with its result */
+    class Job
+    {
+    public:
+        virtual ~Job() { }
+
+        /** Does the work. Called on the service's thread */
+        virtual void run() = 0;
+
+        /** Applies the result. Called on the thread draining the client,
+            normally the render thread */
+        virtual void respond() { }
+
+    private:
+        friend class JobService;
+        Client* client = nullptr;
+        uint32 clientId = 0;
+    };
+
+    /** Schedules jobs for one node and holds their responses until they're
+        drained. Deleting it drops anything it has waiting. A job that's
+        running is let finish first */
+    class Client
+    {
+    public:
+        /** The most jobs a client can have scheduled, waiting or not yet deleted */
+        enum { maxPendingJobs = 64 };
+
+        Client();
+        ~Client();
+
+        /** Queues a job to run on the service's thread. Returns false if too
+            many are pending, in which case the caller still owns the job.
+            Any thread may schedule */
+        bool schedule (Job* job) noexcept;
+
+        /** Calls respond() on every job that has run, in the order they were
+            scheduled, and returns how many did. Only one thread at a time
+            may drain, normally the render thread at the start of a block */
+        int deliverResponses() noexcept;
+
+        /** Returns the number of jobs scheduled that haven't run yet */
+        int getNumWaiting() const noexcept { return numWaiting.load(); }
+
+        /** Blocks until every job scheduled has run and is ready to be
+            delivered, or the timeout passes. Don't call this on the render
+            thread */
+        bool waitUntilReady (int timeoutMs);
+
+    private:
+        friend class JobService;
+        SharedResourcePointer<JobService> service;
+        uint32 id = 0;
+        std::atomic<int> numPending { 0 }, numWaiting { 0 };
+
+        std::unique_ptr<JobService::Queue> responses, retired;
+
+        JUCE_DECLARE_NON_COPYABLE (Client)
+    };
+
+    JobService();
+    ~JobService();
+
+private:
+    friend class Client;
+    class Queue;
+    std::unique_ptr<Queue> requests;
+    CriticalSection clientLock;
+    Array<Client*> clients;
+    uint32 lastClientId = 0;
+
+    void attach (Client&);
+    void detach (Client&);
+    void runJob (Job*);
+    void retireJobs();
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (JobService)
+};
+
+}
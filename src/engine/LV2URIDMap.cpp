@@ -0,0 +1,125 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/LV2URIDMap.h"
+
+#if JLV2_PLUGINHOST_LV2
+
+namespace Element {
+
+LV2URIDMap::LV2URIDMap (int capacity)
+    : mask ((uint32) nextPowerOfTwo (jmax (2, capacity)) - 1)
+{
+    // URIDs index the entries, 0 is never mapped
+    slots.calloc ((size_t) mask + 1);
+    entries.calloc ((size_t) mask + 2);
+    for (uint32 i = 0; i <= mask; ++i)
+        slots[i].store (nullptr, std::memory_order_relaxed);
+    for (uint32 i = 0; i <= mask + 1; ++i)
+        entries[i].store (nullptr, std::memory_order_relaxed);
+
+    mapData.handle = this;
+    mapData.map = mapURI;
+    unmapData.handle = this;
+    unmapData.unmap = unmapURID;
+    mapFeature.URI = LV2_URID__map;
+    mapFeature.data = &mapData;
+    unmapFeature.URI = LV2_URID__unmap;
+    unmapFeature.data = &unmapData;
+}
+
+LV2URIDMap::~LV2URIDMap()
+{
+    for (uint32 i = 0; i <= mask; ++i)
+        delete slots[i].load();
+}
+
+uint32 LV2URIDMap::map (const char* uri)
+{
+    if (uri == nullptr)
+        return 0;
+
+    const auto hash = hashOf (uri);
+    std::unique_ptr<Entry> newEntry;
+
+    for (uint32 probe = 0; probe <= mask; ++probe)
+    {
+        auto& slot = slots [(hash + probe) & mask];
+        auto* entry = slot.load (std::memory_order_acquire);
+
+        if (entry == nullptr)
+        {
+            if (newEntry == nullptr)
+                newEntry.reset (new Entry (uri, hash));
+
+            if (slot.compare_exchange_strong (entry, newEntry.get(), std::memory_order_acq_rel))
+            {
+                auto* const added = newEntry.release();
+                const auto urid = numMapped.fetch_add (1) + 1;
+                entries[urid].store (added, std::memory_order_release);
+                added->urid.store (urid, std::memory_order_release);
+                return urid;
+            }
+
+            // on failure entry holds what another thread put here
+        }
+
+        if (entry->hash == hash && entry->uri == uri)
+        {
+            // the thread that added it may not have numbered it yet
+            uint32 urid = 0;
+            while ((urid = entry->urid.load (std::memory_order_acquire)) == 0)
+                Thread::yield();
+            return urid;
+        }
+    }
+
+    return 0;
+}
+
+const char* LV2URIDMap::unmap (uint32 urid) const noexcept
+{
+    if (urid == 0 || urid > mask + 1)
+        return nullptr;
+    auto* entry = entries[urid].load (std::memory_order_acquire);
+    return entry != nullptr ? entry->uri.c_str() : nullptr;
+}
+
+uint32 LV2URIDMap::hashOf (const char* uri) noexcept
+{
+    // FNV-1a
+    uint32 hash = 2166136261u;
+    for (auto* c = reinterpret_cast<const uint8*> (uri); *c != 0; ++c)
+        hash = (hash ^ *c) * 16777619u;
+    return hash;
+}
+
+LV2_URID LV2URIDMap::mapURI (LV2_URID_Map_Handle handle, const char* uri)
+{
+    return static_cast<LV2URIDMap*> (handle)->map (uri);
+}
+
+const char* LV2URIDMap::unmapURID (LV2_URID_Unmap_Handle handle, LV2_URID urid)
+{
+    return static_cast<LV2URIDMap*> (handle)->unmap (urid);
+}
+
+}
+
+#endif
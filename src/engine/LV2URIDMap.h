@@ -0,0 +1,88 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+#if JLV2_PLUGINHOST_LV2
+
+#include <lv2/lv2plug.in/ns/ext/urid/urid.h>
+
+namespace Element {
+
+/** The URID map and unmap features for every LV2 instance in the process.
+
+    URIs are interned in a fixed size open addressed table. Mapping a URI
+    that's already there only reads the table, so it never locks or
+    allocates. A new URI allocates its entry and claims a slot with one
+    compare and swap, so any number of threads can map at once. URIDs start
+    at 1, and 0 is returned once the table is full. There is one for the
+    app, shared through a SharedResourcePointer.
+ */
+class LV2URIDMap
+{
+public:
+    /** Creates a map that holds up to this many URIs */
+    explicit LV2URIDMap (int capacity = 8192);
+    ~LV2URIDMap();
+
+    /** Returns the URID of a URI, mapping it the first time. Any thread
+        may map */
+    uint32 map (const char* uri);
+
+    /** Returns the URI of a URID, or nullptr if it isn't mapped */
+    const char* unmap (uint32 urid) const noexcept;
+
+    /** Returns the number of URIs mapped */
+    int getNumMapped() const noexcept { return (int) numMapped.load(); }
+
+    /** Returns the urid:map feature */
+    const LV2_Feature* getMapFeature() const noexcept     { return &mapFeature; }
+
+    /** Returns the urid:unmap feature */
+    const LV2_Feature* getUnmapFeature() const noexcept   { return &unmapFeature; }
+
+private:
+    struct Entry
+    {
+        Entry (const char* u, uint32 h) : hash (h), uri (u) { }
+        const uint32 hash;
+        const std::string uri;
+        std::atomic<uint32> urid { 0 };
+    };
+
+    const uint32 mask;
+    HeapBlock<std::atomic<Entry*>> slots, entries;
+    std::atomic<uint32> numMapped { 0 };
+
+    LV2_URID_Map mapData;
+    LV2_URID_Unmap unmapData;
+    LV2_Feature mapFeature, unmapFeature;
+
+    static uint32 hashOf (const char* uri) noexcept;
+    static LV2_URID mapURI (LV2_URID_Map_Handle, const char* uri);
+    static const char* unmapURID (LV2_URID_Unmap_Handle, LV2_URID urid);
+
+    JUCE_DECLARE_NON_COPYABLE (LV2URIDMap)
+};
+
+}
+
+#endif
@@ -0,0 +1,315 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/LV2Worker.h"
+
+#if JLV2_PLUGINHOST_LV2
+
+#include "engine/RealtimeThreads.h"
+
+namespace Element {
+
+static const int idleWaitMs = 50;
+
+//=============================================================================
+/** A single producer, single consumer ring of sized messages. Each carries
+    the ticket it was queued with, which the pool orders instances by */
+class LV2Worker::Ring
+{
+public:
+    struct Header
+    {
+        uint64 ticket;
+        uint32 size;
+    };
+
+    explicit Ring (int numBytes)
+        : fifo (numBytes)
+    {
+        ring.calloc ((size_t) numBytes);
+    }
+
+    bool write (uint64 ticket, const void* data, uint32 size) noexcept
+    {
+        const Header header { ticket, size };
+        const int total = (int) sizeof (Header) + (int) size;
+        if (fifo.getFreeSpace() < total)
+            return false;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (total, start1, size1, start2, size2);
+        copyIn (&header, (int) sizeof (Header), 0, start1, size1, start2);
+        copyIn (data, (int) size, (int) sizeof (Header), start1, size1, start2);
+        fifo.finishedWrite (total);
+        return true;
+    }
+
+    bool peek (Header& header) noexcept
+    {
+        if (fifo.getNumReady() < (int) sizeof (Header))
+            return false;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead ((int) sizeof (Header), start1, size1, start2, size2);
+        copyOut (&header, (int) sizeof (Header), 0, start1, size1, start2);
+        return true;
+    }
+
+    /** Reads the next message into data, which must hold its size */
+    bool read (Header& header, uint8* data) noexcept
+    {
+        if (! peek (header))
+            return false;
+
+        const int total = (int) sizeof (Header) + (int) header.size;
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (total, start1, size1, start2, size2);
+        copyOut (data, (int) header.size, (int) sizeof (Header), start1, size1, start2);
+        fifo.finishedRead (total);
+        return true;
+    }
+
+private:
+    AbstractFifo fifo;
+    HeapBlock<uint8> ring;
+
+    void copyIn (const void* source, int numBytes, int offset, int start1, int size1, int start2) noexcept
+    {
+        auto* src = static_cast<const uint8*> (source);
+        for (int i = 0; i < numBytes; ++i, ++offset)
+            ring [offset < size1 ? start1 + offset : start2 + offset - size1] = src[i];
+    }
+
+    void copyOut (void* dest, int numBytes, int offset, int start1, int size1, int start2) const noexcept
+    {
+        auto* dst = static_cast<uint8*> (dest);
+        for (int i = 0; i < numBytes; ++i, ++offset)
+            dst[i] = ring [offset < size1 ? start1 + offset : start2 + offset - size1];
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Ring)
+};
+
+//=============================================================================
+LV2Worker::LV2Worker (const LV2_Worker_Interface* i, LV2_Handle h, int ringBytes)
+    : workerInterface (i),
+      instance (h),
+      requests (new Ring (ringBytes)),
+      responses (new Ring (ringBytes)),
+      maxMessageBytes ((uint32) (ringBytes - (int) sizeof (Ring::Header) - 1))
+{
+    jassert (workerInterface != nullptr && ringBytes > (int) sizeof (Ring::Header) + 1);
+    workData.calloc ((size_t) ringBytes);
+    responseData.calloc ((size_t) ringBytes);
+
+    schedule.handle = this;
+    schedule.schedule_work = scheduleWork;
+    feature.URI = LV2_WORKER__schedule;
+    feature.data = &schedule;
+
+    pool->addWorker (this);
+}
+
+LV2Worker::~LV2Worker()
+{
+    pool->removeWorker (this);
+}
+
+void LV2Worker::deliverResponses() noexcept
+{
+    Ring::Header header;
+    while (responses->read (header, responseData))
+        if (workerInterface->work_response != nullptr)
+            workerInterface->work_response (instance, header.size, responseData);
+
+    if (workerInterface->end_run != nullptr)
+        workerInterface->end_run (instance);
+}
+
+bool LV2Worker::waitUntilIdle (int timeoutMs)
+{
+    const auto timeout = Time::getMillisecondCounter() + (uint32) jmax (0, timeoutMs);
+    while (numWaiting.load() > 0)
+    {
+        if (Time::getMillisecondCounter() >= timeout)
+            return false;
+        Thread::sleep (1);
+    }
+
+    return true;
+}
+
+bool LV2Worker::getOldestTicket (uint64& ticket) const noexcept
+{
+    Ring::Header header;
+    if (! requests->peek (header))
+        return false;
+    ticket = header.ticket;
+    return true;
+}
+
+void LV2Worker::workNext()
+{
+    Ring::Header header;
+    if (! requests->read (header, workData))
+        return;
+
+    if (workerInterface->work != nullptr)
+        workerInterface->work (instance, respond, this, header.size, workData);
+    numWaiting.fetch_sub (1);
+}
+
+LV2_Worker_Status LV2Worker::scheduleWork (LV2_Worker_Schedule_Handle handle, uint32_t size, const void* data)
+{
+    auto& worker = *static_cast<LV2Worker*> (handle);
+    if (size > worker.maxMessageBytes)
+        return LV2_WORKER_ERR_NO_SPACE;
+
+    const auto ticket = worker.pool->nextTicket.fetch_add (1);
+    worker.numWaiting.fetch_add (1);
+    if (! worker.requests->write (ticket, data, size))
+    {
+        worker.numWaiting.fetch_sub (1);
+        return LV2_WORKER_ERR_NO_SPACE;
+    }
+
+    worker.pool->wake();
+    return LV2_WORKER_SUCCESS;
+}
+
+LV2_Worker_Status LV2Worker::respond (LV2_Worker_Respond_Handle handle, uint32_t size, const void* data)
+{
+    auto& worker = *static_cast<LV2Worker*> (handle);
+    if (size > worker.maxMessageBytes || ! worker.responses->write (0, data, size))
+        return LV2_WORKER_ERR_NO_SPACE;
+    return LV2_WORKER_SUCCESS;
+}
+
+//=============================================================================
+class LV2WorkerPool::WorkThread : public Thread
+{
+public:
+    WorkThread (LV2WorkerPool& p, int index)
+        : Thread ("el.lv2Worker." + String (index)),
+          pool (p) { }
+
+    void run() override
+    {
+        RealtimeThreads::applyBackgroundAffinity();
+        while (! threadShouldExit())
+        {
+            if (auto* worker = pool.claimMostUrgent())
+            {
+                worker->workNext();
+                pool.release (worker);
+            }
+            else
+            {
+                wait (idleWaitMs);
+            }
+        }
+    }
+
+private:
+    LV2WorkerPool& pool;
+};
+
+LV2WorkerPool::LV2WorkerPool()
+{
+    // work is mostly loading files, so this many is plenty for any session
+    const int numThreads = jlimit (1, 4, SystemStats::getNumCpus() / 4);
+    for (int i = 0; i < numThreads; ++i)
+        threads.add (new WorkThread (*this, i))->startThread (4);
+}
+
+LV2WorkerPool::~LV2WorkerPool()
+{
+    jassert (workers.isEmpty());
+    for (auto* thread : threads)
+        thread->signalThreadShouldExit();
+    wake();
+    for (auto* thread : threads)
+        thread->waitForThreadToExit (-1);
+    threads.clear();
+}
+
+int LV2WorkerPool::getNumWorkers() const
+{
+    const ScopedLock sl (lock);
+    return workers.size();
+}
+
+void LV2WorkerPool::addWorker (LV2Worker* worker)
+{
+    const ScopedLock sl (lock);
+    workers.addIfNotAlreadyThere (worker);
+}
+
+void LV2WorkerPool::removeWorker (LV2Worker* worker)
+{
+    const ScopedLock sl (lock);
+    workers.removeFirstMatchingValue (worker);
+
+    // a thread might be working one of its requests right now
+    while (busy.contains (worker))
+    {
+        const ScopedUnlock sul (lock);
+        Thread::sleep (1);
+    }
+}
+
+void LV2WorkerPool::wake()
+{
+    for (auto* thread : threads)
+        thread->notify();
+}
+
+LV2Worker* LV2WorkerPool::claimMostUrgent()
+{
+    const ScopedLock sl (lock);
+    LV2Worker* best = nullptr;
+    uint64 bestTicket = 0;
+
+    for (auto* worker : workers)
+    {
+        uint64 ticket = 0;
+        if (busy.contains (worker) || ! worker->getOldestTicket (ticket))
+            continue;
+
+        if (best == nullptr || ticket < bestTicket)
+        {
+            best = worker;
+            bestTicket = ticket;
+        }
+    }
+
+    if (best != nullptr)
+        busy.add (best);
+    return best;
+}
+
+void LV2WorkerPool::release (LV2Worker* worker)
+{
+    const ScopedLock sl (lock);
+    busy.removeFirstMatchingValue (worker);
+}
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+#if JLV2_PLUGINHOST_LV2
+
+#include <lv2/lv2plug.in/ns/ext/worker/worker.h>
+
+namespace Element {
+
+class LV2WorkerPool;
+
+/** Services one LV2 instance's worker extension through the shared pool.
+
+    Give the instance getFeature() when it's instantiated. Requests it makes
+    from run() are copied into a lock-free ring, worked by the pool, and the
+    responses are written to a second ring deliverResponses() drains after
+    run(). Neither side allocates or takes a lock on the render thread.
+ */
+class LV2Worker
+{
+public:
+    /** Creates the worker for an instance. Rings hold this many bytes of
+        requests and of responses */
+    LV2Worker (const LV2_Worker_Interface* workerInterface, LV2_Handle instance, int ringBytes = 8192);
+
+    /** Stops servicing the instance. Waits for a request being worked */
+    ~LV2Worker();
+
+    /** Returns the worker:schedule feature to instantiate the plugin with */
+    const LV2_Feature* getFeature() const noexcept { return &feature; }
+
+    /** Passes the responses that are ready to the instance, then calls its
+        end_run. Call this on the render thread after every run() */
+    void deliverResponses() noexcept;
+
+    /** Returns the number of requests that haven't been worked yet */
+    int getNumWaiting() const noexcept { return numWaiting.load(); }
+
+    /** Blocks until every request so far has been worked, or the timeout
+        passes. Don't call this on the render thread */
+    bool waitUntilIdle (int timeoutMs);
+
+private:
+    friend class LV2WorkerPool;
+    class Ring;
+
+    SharedResourcePointer<LV2WorkerPool> pool;
+    const LV2_Worker_Interface* const workerInterface;
+    const LV2_Handle instance;
+    std::unique_ptr<Ring> requests, responses;
+    HeapBlock<uint8> workData, responseData;
+    const uint32 maxMessageBytes;
+    std::atomic<int> numWaiting { 0 };
+
+    LV2_Worker_Schedule schedule;
+    LV2_Feature feature;
+
+    bool getOldestTicket (uint64& ticket) const noexcept;
+    void workNext();
+
+    static LV2_Worker_Status scheduleWork (LV2_Worker_Schedule_Handle, uint32_t size, const void* data);
+    static LV2_Worker_Status respond (LV2_Worker_Respond_Handle, uint32_t size, const void* data);
+
+    JUCE_DECLARE_NON_COPYABLE (LV2Worker)
+};
+
+/** The LV2 worker service for every plugin instance in the process.
+
+    A few threads work the requests of every LV2Worker. Each pass goes to the
+    instance whose oldest request has waited longest, so a busy sampler can't
+    starve the others, and an instance is only ever worked by one thread at a
+    time as the extension requires. A session full of samplers shares these
+    threads instead of each instance running its own. There is one for the
+    app, shared through a SharedResourcePointer.
+ */
+class LV2WorkerPool
+{
+public:
+    LV2WorkerPool();
+    ~LV2WorkerPool();
+
+    /** Returns the number of threads working requests */
+    int getNumThreads() const noexcept { return threads.size(); }
+
+    /** Returns the number of instances being serviced */
+    int getNumWorkers() const;
+
+private:
+    friend class LV2Worker;
+    class WorkThread;
+    OwnedArray<WorkThread> threads;
+    CriticalSection lock;
+    Array<LV2Worker*> workers;
+    Array<LV2Worker*> busy;
+    std::atomic<uint64> nextTicket { 0 };
+
+    void addWorker (LV2Worker*);
+    void removeWorker (LV2Worker*);
+    void wake();
+    LV2Worker* claimMostUrgent();
+    void release (LV2Worker*);
+
+    JUCE_DECLARE_NON_COPYABLE (LV2WorkerPool)
+};
+
+}
+
+#endif
@@ -0,0 +1,206 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/LatencyProbe.h"
+
+namespace Element {
+
+/** Silence between impulses, so one's tail has gone before the next */
+static const double quietSeconds = 0.1;
+
+/** Median of the first count values, which get sorted */
+template<typename T>
+static T median (T* values, int count)
+{
+    std::sort (values, values + count);
+    return (count % 2) == 1 ? values [count / 2]
+                            : (values [count / 2 - 1] + values [count / 2]) / (T) 2;
+}
+
+//=============================================================================
+LatencyProbe::LatencyProbe (const Options& o)
+    : options (o)
+{
+    jassert (options.numPings > 0 && options.numPings <= (int) maxPings);
+    prepare (48000.0);
+}
+
+void LatencyProbe::prepare (double sampleRate) noexcept
+{
+    quietSamples = jmax (1, roundToInt (sampleRate * quietSeconds));
+    timeoutSamples = jmax (1, roundToInt (sampleRate * options.timeoutSeconds));
+    phase = Phase::quiet;
+    phaseSamples = 0;
+    numSent = numHeard = 0;
+    finished.store (false);
+}
+
+int LatencyProbe::getRoundTripSamples() const noexcept
+{
+    if (! isFinished() || numHeard <= 0)
+        return -1;
+
+    int sorted [maxPings];
+    std::copy (roundTrips, roundTrips + numHeard, sorted);
+    return median (sorted, numHeard);
+}
+
+void LatencyProbe::process (const float* input, float* output, int numSamples) noexcept
+{
+    if (output != nullptr)
+        FloatVectorOperations::clear (output, numSamples);
+    if (finished.load (std::memory_order_relaxed))
+        return;
+
+    const int numPings = jlimit (1, (int) maxPings, options.numPings);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (phase == Phase::quiet)
+        {
+            if (++phaseSamples < quietSamples)
+                continue;
+
+            if (output != nullptr)
+                output[i] = options.level;
+            phase = Phase::listening;
+            phaseSamples = 0;
+            ++numSent;
+            continue;
+        }
+
+        // the impulse can't come back in the frame it was sent
+        ++phaseSamples;
+        if (input != nullptr && std::abs (input[i]) >= options.threshold)
+            endPing ((int) phaseSamples);
+        else if (phaseSamples >= timeoutSamples)
+            endPing (-1);
+
+        if (phase == Phase::quiet && numSent >= numPings)
+        {
+            finished.store (true);
+            return;
+        }
+    }
+}
+
+void LatencyProbe::endPing (int roundTrip) noexcept
+{
+    if (roundTrip > 0)
+        roundTrips [numHeard++] = roundTrip;
+    phase = Phase::quiet;
+    phaseSamples = 0;
+}
+
+void LatencyProbe::audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                          float** outputChannelData, int numOutputChannels,
+                                          int numSamples)
+{
+    for (int c = 0; c < numOutputChannels; ++c)
+        if (c != options.outputChannel && outputChannelData[c] != nullptr)
+            FloatVectorOperations::clear (outputChannelData[c], numSamples);
+
+    const auto* input = isPositiveAndBelow (options.inputChannel, numInputChannels)
+        ? inputChannelData [options.inputChannel] : nullptr;
+    auto* output = isPositiveAndBelow (options.outputChannel, numOutputChannels)
+        ? outputChannelData [options.outputChannel] : nullptr;
+    process (input, output, numSamples);
+}
+
+void LatencyProbe::audioDeviceAboutToStart (AudioIODevice* device)
+{
+    prepare (device->getCurrentSampleRate());
+}
+
+//=============================================================================
+MidiLatencyProbe::MidiLatencyProbe (int n, double timeout)
+    : numPings (jmax (1, n)),
+      timeoutMs (timeout)
+{
+}
+
+bool MidiLatencyProbe::ping (MidiOutput& output)
+{
+    MidiMessage message;
+    {
+        const ScopedLock sl (lock);
+        expireLocked (Time::getMillisecondCounterHiRes());
+        if (note >= 0)
+            return true;
+        if (numSent >= numPings)
+            return false;
+    }
+
+    message = createPing (Time::getMillisecondCounterHiRes());
+    output.sendMessageNow (message);
+    output.sendMessageNow (MidiMessage::noteOff (message.getChannel(), message.getNoteNumber()));
+    return true;
+}
+
+bool MidiLatencyProbe::isFinished() const noexcept
+{
+    const ScopedLock sl (lock);
+    return numSent >= numPings && note < 0;
+}
+
+double MidiLatencyProbe::getRoundTripMs() const noexcept
+{
+    const ScopedLock sl (lock);
+    if (roundTrips.isEmpty())
+        return -1.0;
+    Array<double> sorted (roundTrips);
+    return median (sorted.getRawDataPointer(), sorted.size());
+}
+
+int MidiLatencyProbe::getNumPingsHeard() const noexcept
+{
+    const ScopedLock sl (lock);
+    return roundTrips.size();
+}
+
+MidiMessage MidiLatencyProbe::createPing (double timeMs)
+{
+    const ScopedLock sl (lock);
+    // each ping is its own note so a late one isn't taken for the next
+    note = 60 + (numSent % 24);
+    sentMs = timeMs;
+    ++numSent;
+    return MidiMessage::noteOn (16, note, (uint8) 64);
+}
+
+void MidiLatencyProbe::handleIncomingMidiMessage (MidiInput*, const MidiMessage& message)
+{
+    const auto nowMs = Time::getMillisecondCounterHiRes();
+    if (! message.isNoteOn())
+        return;
+
+    const ScopedLock sl (lock);
+    if (message.getNoteNumber() != note)
+        return;
+
+    roundTrips.add (nowMs - sentMs);
+    note = -1;
+}
+
+void MidiLatencyProbe::expireLocked (double nowMs)
+{
+    if (note >= 0 && nowMs - sentMs >= timeoutMs)
+        note = -1;
+}
+
+}
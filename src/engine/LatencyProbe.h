@@ -0,0 +1,146 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Measures the audio round trip through a physical loopback from an output
+    to an input.
+
+    An impulse is played on the output channel and listened for on the input
+    channel. The samples counted between the two are the round trip on the
+    device's own clock, so it's exact to the sample whatever the driver says
+    its latency is. The impulse is sent a few times with silence between and
+    the median is kept, so one stray click can't skew the result.
+
+    Add it to the device manager as a callback of its own while it measures.
+    It plays silence on every other output.
+ */
+class LatencyProbe : public AudioIODeviceCallback
+{
+public:
+    struct Options
+    {
+        int outputChannel = 0;
+        int inputChannel = 0;
+        /** The number of impulses sent, up to maxPings */
+        int numPings = 5;
+        float level = 0.5f;
+        /** How loud the input must get to count as the impulse coming back */
+        float threshold = 0.1f;
+        /** How long to listen for each impulse */
+        double timeoutSeconds = 1.0;
+    };
+
+    enum { maxPings = 16 };
+
+    explicit LatencyProbe (const Options& options);
+
+    /** Plays and listens for one block. Either buffer may be null when the
+        device doesn't have the channel */
+    void process (const float* input, float* output, int numSamples) noexcept;
+
+    /** Returns true once every impulse has come back or timed out */
+    bool isFinished() const noexcept { return finished.load(); }
+
+    /** Returns the median round trip in samples, or -1 if no impulse came back */
+    int getRoundTripSamples() const noexcept;
+
+    /** Returns how many of the impulses came back */
+    int getNumPingsHeard() const noexcept { return isFinished() ? numHeard : 0; }
+
+    /** Resets the probe to measure at a sample rate. Called when the device starts */
+    void prepare (double sampleRate) noexcept;
+
+    /** @internal */
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels,
+                                int numSamples) override;
+    /** @internal */
+    void audioDeviceAboutToStart (AudioIODevice*) override;
+    /** @internal */
+    void audioDeviceStopped() override { }
+
+private:
+    enum class Phase { quiet, listening };
+
+    const Options options;
+    Phase phase = Phase::quiet;
+    int64 phaseSamples = 0;
+    int quietSamples = 4800, timeoutSamples = 48000;
+    int numSent = 0, numHeard = 0;
+    int roundTrips [maxPings];
+    std::atomic<bool> finished { false };
+
+    void endPing (int roundTrip) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (LatencyProbe)
+};
+
+/** Measures the round trip of a note sent from a MIDI output looped back to
+    an input.
+
+    Call ping() to send the next note, then deliver what the input receives.
+    The time between sending and hearing it back is measured on the
+    Time::getMillisecondCounterHiRes() clock. Notes that don't come back
+    within the timeout count as missed.
+ */
+class MidiLatencyProbe : public MidiInputCallback
+{
+public:
+    explicit MidiLatencyProbe (int numPings = 5, double timeoutMs = 500.0);
+
+    /** Sends the next note if the last one came back or timed out. Returns
+        false once every note has been sent and settled */
+    bool ping (MidiOutput& output);
+
+    /** Returns true once every note has come back or timed out */
+    bool isFinished() const noexcept;
+
+    /** Returns the median round trip in milliseconds, or -1 if no note came back */
+    double getRoundTripMs() const noexcept;
+
+    /** Returns how many of the notes came back */
+    int getNumPingsHeard() const noexcept;
+
+    /** Marks the note being waited on as sent at a time. Used to measure
+        without a device */
+    MidiMessage createPing (double timeMs);
+
+    /** @internal */
+    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message) override;
+
+private:
+    const int numPings;
+    const double timeoutMs;
+    CriticalSection lock;
+    int numSent = 0;
+    int note = -1;
+    double sentMs = 0.0;
+    Array<double> roundTrips;
+
+    void expireLocked (double nowMs);
+
+    JUCE_DECLARE_NON_COPYABLE (MidiLatencyProbe)
+};
+
+}
@@ -0,0 +1,211 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/LevelMeter.h"
+
+namespace Element {
+
+void LevelMeter::prepare (int newNumChannels)
+{
+    numChannels = jmax (0, newNumChannels);
+    peaks.calloc ((size_t) jmax (1, numChannels));
+    sums.calloc ((size_t) jmax (1, numChannels));
+    reset();
+}
+
+void LevelMeter::reset() noexcept
+{
+    if (numChannels > 0)
+    {
+        FloatVectorOperations::clear (peaks.getData(), numChannels);
+        FloatVectorOperations::clear (sums.getData(), numChannels);
+    }
+
+    numMeasuredSamples = numElapsedSamples = 0;
+}
+
+void LevelMeter::measure (int channel, const float* samples, int numSamples) noexcept
+{
+    if (isPositiveAndBelow (channel, numChannels))
+        measureSamples (samples, numSamples, peaks[channel], sums[channel]);
+}
+
+void LevelMeter::measure (int channel, const double* samples, int numSamples) noexcept
+{
+    if (! isPositiveAndBelow (channel, numChannels))
+        return;
+
+    double high = 0.0, low = 0.0, sum = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double s = samples[i];
+        high = jmax (high, s); low = jmin (low, s); sum += s * s;
+    }
+
+    peaks[channel] = jmax (peaks[channel], (float) high, (float) -low);
+    sums[channel] += (float) sum;
+}
+
+void LevelMeter::applyGainAndMeasure (int channel, float* samples, int numSamples,
+                                      float startGain, float endGain) noexcept
+{
+    if (isPositiveAndBelow (channel, numChannels))
+    {
+        applyGainRampAndMeasure (samples, numSamples, startGain, endGain, peaks[channel], sums[channel]);
+    }
+    else
+    {
+        float unusedPeak = 0.f, unusedSum = 0.f;
+        applyGainRampAndMeasure (samples, numSamples, startGain, endGain, unusedPeak, unusedSum);
+    }
+}
+
+bool LevelMeter::advance (int numMeasured, int numSamples, int windowSize) noexcept
+{
+    numMeasuredSamples += numMeasured;
+    numElapsedSamples += numSamples;
+    return numElapsedSamples >= windowSize;
+}
+
+float LevelMeter::getPeak (int channel) const noexcept
+{
+    return isPositiveAndBelow (channel, numChannels) ? peaks[channel] : 0.f;
+}
+
+float LevelMeter::getRMS (int channel) const noexcept
+{
+    if (! isPositiveAndBelow (channel, numChannels) || numMeasuredSamples <= 0)
+        return 0.f;
+    return std::sqrt (sums[channel] / (float) numMeasuredSamples);
+}
+
+//=============================================================================
+
+void LevelMeter::measureSamples (const float* samples, int numSamples,
+                                 float& peak, float& sumOfSquares) noexcept
+{
+    float high = 0.f, low = 0.f, sum = 0.f;
+    int i = 0;
+
+   #if JUCE_USE_SIMD
+    using Vec = dsp::SIMDRegister<float>;
+    const int vecSize = (int) Vec::size();
+
+    // scalar head until the pointer is aligned for vector loads
+    for (; i < numSamples && ! Vec::isSIMDAligned (samples + i); ++i)
+    {
+        const float s = samples[i];
+        high = jmax (high, s); low = jmin (low, s); sum += s * s;
+    }
+
+    if (i + vecSize <= numSamples)
+    {
+        auto vhigh = Vec::expand (0.f), vlow = Vec::expand (0.f), vsum = Vec::expand (0.f);
+        for (; i + vecSize <= numSamples; i += vecSize)
+        {
+            const auto v = Vec::fromRawArray (samples + i);
+            vhigh = Vec::max (vhigh, v);
+            vlow  = Vec::min (vlow, v);
+            vsum += v * v;
+        }
+
+        alignas (sizeof (Vec)) float lanes [Vec::SIMDNumElements];
+        vhigh.copyToRawArray (lanes);
+        for (int l = 0; l < vecSize; ++l)
+            high = jmax (high, lanes[l]);
+        vlow.copyToRawArray (lanes);
+        for (int l = 0; l < vecSize; ++l)
+            low = jmin (low, lanes[l]);
+        sum += vsum.sum();
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        const float s = samples[i];
+        high = jmax (high, s); low = jmin (low, s); sum += s * s;
+    }
+
+    peak = jmax (peak, high, -low);
+    sumOfSquares += sum;
+}
+
+void LevelMeter::applyGainRampAndMeasure (float* samples, int numSamples, float startGain, float endGain,
+                                          float& peak, float& sumOfSquares) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const float increment = (endGain - startGain) / (float) numSamples;
+    float high = 0.f, low = 0.f, sum = 0.f;
+    int i = 0;
+
+   #if JUCE_USE_SIMD
+    using Vec = dsp::SIMDRegister<float>;
+    const int vecSize = (int) Vec::size();
+
+    for (; i < numSamples && ! Vec::isSIMDAligned (samples + i); ++i)
+    {
+        const float s = samples[i] * (startGain + increment * (float) i);
+        samples[i] = s;
+        high = jmax (high, s); low = jmin (low, s); sum += s * s;
+    }
+
+    if (i + vecSize <= numSamples)
+    {
+        alignas (sizeof (Vec)) float lanes [Vec::SIMDNumElements];
+        for (int l = 0; l < vecSize; ++l)
+            lanes[l] = startGain + increment * (float) (i + l);
+
+        auto gains = Vec::fromRawArray (lanes);
+        const auto step = Vec::expand (increment * (float) vecSize);
+        auto vhigh = Vec::expand (0.f), vlow = Vec::expand (0.f), vsum = Vec::expand (0.f);
+
+        for (; i + vecSize <= numSamples; i += vecSize)
+        {
+            const auto v = Vec::fromRawArray (samples + i) * gains;
+            v.copyToRawArray (samples + i);
+            vhigh = Vec::max (vhigh, v);
+            vlow  = Vec::min (vlow, v);
+            vsum += v * v;
+            gains += step;
+        }
+
+        vhigh.copyToRawArray (lanes);
+        for (int l = 0; l < vecSize; ++l)
+            high = jmax (high, lanes[l]);
+        vlow.copyToRawArray (lanes);
+        for (int l = 0; l < vecSize; ++l)
+            low = jmin (low, lanes[l]);
+        sum += vsum.sum();
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        const float s = samples[i] * (startGain + increment * (float) i);
+        samples[i] = s;
+        high = jmax (high, s); low = jmin (low, s); sum += s * s;
+    }
+
+    peak = jmax (peak, high, -low);
+    sumOfSquares += sum;
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Accumulates peak and RMS levels of a set of channels over a window of
+    samples. Levels are gathered by the render thread block by block and
+    read back once a full window has been measured.
+ */
+class LevelMeter
+{
+public:
+    LevelMeter() = default;
+    ~LevelMeter() = default;
+
+    /** Allocates accumulators for the given number of channels. Not realtime safe */
+    void prepare (int numChannels);
+
+    /** Returns the number of channels being measured */
+    int getNumChannels() const noexcept { return numChannels; }
+
+    /** Clears the accumulated levels and starts a new window */
+    void reset() noexcept;
+
+    /** Measures samples of a channel without changing them */
+    void measure (int channel, const float* samples, int numSamples) noexcept;
+
+    /** Measures double precision samples of a channel */
+    void measure (int channel, const double* samples, int numSamples) noexcept;
+
+    /** Applies a linear gain ramp to a channel and measures the result in
+        the same pass */
+    void applyGainAndMeasure (int channel, float* samples, int numSamples,
+                              float startGain, float endGain) noexcept;
+
+    /** Call once per block after all channels were measured. numMeasured is
+        the number of samples per channel that went into the meter, which can
+        differ from numSamples when oversampling.
+
+        @returns true once windowSize samples have elapsed and a reading is due
+     */
+    bool advance (int numMeasured, int numSamples, int windowSize) noexcept;
+
+    /** Returns the peak magnitude of a channel in the current window */
+    float getPeak (int channel) const noexcept;
+
+    /** Returns the RMS level of a channel in the current window */
+    float getRMS (int channel) const noexcept;
+
+    //=========================================================================
+    /** Finds the peak magnitude and sum of squares of a block of samples,
+        adding to the values passed in */
+    static void measureSamples (const float* samples, int numSamples,
+                                float& peak, float& sumOfSquares) noexcept;
+
+    /** Applies a linear gain ramp to a block of samples and measures the
+        result, adding to the values passed in */
+    static void applyGainRampAndMeasure (float* samples, int numSamples, float startGain, float endGain,
+                                         float& peak, float& sumOfSquares) noexcept;
+
+private:
+    HeapBlock<float> peaks, sums;
+    int numChannels = 0;
+    int numMeasuredSamples = 0;
+    int numElapsedSamples = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (LevelMeter)
+};
+
+}
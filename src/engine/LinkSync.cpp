@@ -0,0 +1,99 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/LinkSync.h"
+#include "engine/Transport.h"
+
+#if EL_USE_ABLETON_LINK
+ #include <ableton/Link.hpp>
+#endif
+
+namespace Element {
+
+/** The transport is moved when it drifts more than this from Link */
+static const double maxLinkDriftSeconds = 0.0005;
+
+#if EL_USE_ABLETON_LINK
+
+struct LinkSync::Impl
+{
+    ableton::Link link { 120.0 };
+};
+
+LinkSync::LinkSync() : impl (new Impl()) { }
+LinkSync::~LinkSync()
+{
+    impl->link.enable (false);
+}
+
+bool LinkSync::isAvailable() noexcept           { return true; }
+void LinkSync::setEnabled (bool shouldBeEnabled) { impl->link.enable (shouldBeEnabled); }
+bool LinkSync::isEnabled() const noexcept       { return impl->link.isEnabled(); }
+int LinkSync::getNumPeers() const               { return (int) impl->link.numPeers(); }
+
+void LinkSync::setTempo (double bpm)
+{
+    auto& link = impl->link;
+    if (! link.isEnabled() || bpm <= 0.0)
+        return;
+    auto state = link.captureAppSessionState();
+    state.setTempo (bpm, link.clock().micros());
+    link.commitAppSessionState (state);
+}
+
+void LinkSync::sync (Transport& transport, double sampleRate, double outputLatencyMs)
+{
+    auto& link = impl->link;
+    if (! link.isEnabled() || sampleRate <= 0.0)
+        return;
+
+    const auto heardAt = link.clock().micros()
+        + std::chrono::microseconds (llround (outputLatencyMs * 1000.0));
+    const auto state   = link.captureAudioSessionState();
+    const double tempo = state.tempo();
+    const double quantum = (double) jmax (1, transport.getBeatsPerBar());
+
+    // keep the song position and line up the bar, the nearest way round
+    const double localTempo = transport.getTempo() > 0.0 ? transport.getTempo() : tempo;
+    const double beat  = (double) transport.getPositionFrames() * localTempo / (60.0 * sampleRate);
+    double offset = std::fmod (state.beatAtTime (heardAt, quantum) - beat, quantum);
+    if (offset > quantum * 0.5)         offset -= quantum;
+    else if (offset < -quantum * 0.5)   offset += quantum;
+
+    transport.requestClockSync (tempo, jmax (0.0, beat + offset), sampleRate,
+                                maxLinkDriftSeconds * tempo / 60.0);
+}
+
+#else
+
+struct LinkSync::Impl { };
+
+LinkSync::LinkSync() { }
+LinkSync::~LinkSync() { }
+
+bool LinkSync::isAvailable() noexcept           { return false; }
+void LinkSync::setEnabled (bool)                { }
+bool LinkSync::isEnabled() const noexcept       { return false; }
+int LinkSync::getNumPeers() const               { return 0; }
+void LinkSync::setTempo (double)                { }
+void LinkSync::sync (Transport&, double, double) { ignoreUnused (maxLinkDriftSeconds); }
+
+#endif
+
+}
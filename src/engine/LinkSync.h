@@ -0,0 +1,68 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class Transport;
+
+/** Shares tempo and phase with other Link apps on the network.
+
+    The session state is captured once per audio callback for the time the
+    block will be heard, that is now plus the device's output latency, and
+    the transport is pulled onto the beat Link says is playing then. Bars
+    line up with the peers' bars while the song position is kept, so the
+    transport only jumps by less than half a bar when it joins.
+
+    Builds without Link (EL_USE_ABLETON_LINK off) get a sync that's never
+    available and does nothing.
+ */
+class LinkSync
+{
+public:
+    LinkSync();
+    ~LinkSync();
+
+    /** True if Element was built with Link */
+    static bool isAvailable() noexcept;
+
+    /** Joins or leaves the Link session. Call from the message thread */
+    void setEnabled (bool shouldBeEnabled);
+    bool isEnabled() const noexcept;
+
+    /** Returns the number of other apps in the session */
+    int getNumPeers() const;
+
+    /** Proposes a tempo to the session. Call from the message thread */
+    void setTempo (double bpm);
+
+    /** Captures the session for the next block and requests the transport
+        follow it. Call on the audio thread before Transport::preProcess() */
+    void sync (Transport& transport, double sampleRate, double outputLatencyMs);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+    JUCE_DECLARE_NON_COPYABLE (LinkSync)
+};
+
+}
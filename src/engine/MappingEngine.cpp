@@ -17,22 +17,71 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "engine/ControllerFeedback.h"
 #include "engine/GraphNode.h"
 #include "engine/MappingEngine.h"
+#include "engine/MidiDispatchTable.h"
 #include "engine/MidiEngine.h"
+#include "engine/ParameterRamps.h"
 #include "session/ControllerDevice.h"
 #include "session/Node.h"
 
 namespace Element {
 
-class ControllerMapHandler
+class ControllerMapHandler : private Parameter::Listener
 {
 public:
+    using DispatchTable = MidiDispatchTable<ControllerMapHandler>;
+
     ControllerMapHandler() { }
-    virtual ~ControllerMapHandler() { }
+    virtual ~ControllerMapHandler()
+    {
+        if (feedbackParameter != nullptr)
+            feedbackParameter->removeListener (this);
+    }
 
     virtual bool wants (const MidiMessage& message) const =0;
     virtual void perform (const MidiMessage& message) =0;
+
+    /** The type, channel and number of the messages this handler wants */
+    virtual DispatchTable::Key getDispatchKey() const =0;
+
+    /** Called when the dispatch key changes so the input can re-index */
+    std::function<void()> onDispatchKeyChanged;
+
+    /** Echoes the mapped parameter's value to the controller through a
+        feedback slot, which must outlive this handler */
+    void setFeedbackSlot (ControllerFeedback::Slot* slot)
+    {
+        feedbackSlot = slot;
+        if (feedbackSlot == nullptr || feedbackParameter != nullptr)
+            return;
+        if ((feedbackParameter = getFeedbackParameter()) == nullptr)
+            return;
+        feedbackParameter->addListener (this);
+        feedbackSlot->post (getFeedbackValue (feedbackParameter->getValue()));
+    }
+
+protected:
+    ControllerFeedback::Slot* feedbackSlot = nullptr;
+
+    /** The parameter whose changes are echoed, if any */
+    virtual Parameter* getFeedbackParameter() const { return nullptr; }
+
+    /** Converts a normalized parameter value to what the controller shows */
+    virtual int getFeedbackValue (float value) const { return roundToInt (value * 127.f); }
+
+private:
+    Parameter::Ptr feedbackParameter;
+
+    // from any thread the parameter changes on, the render thread included
+    void controlValueChanged (int, float value) override
+    {
+        if (auto* slot = feedbackSlot)
+            slot->post (getFeedbackValue (value));
+    }
+
+    void controlTouched (int, bool) override { }
 };
 
 struct MidiNoteControllerMap : public ControllerMapHandler,
@@ -82,6 +131,11 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
             (channel.get() == 0 || (channel.get() > 0 && message.getChannel() == channel.get()));
     }
 
+    DispatchTable::Key getDispatchKey() const override
+    {
+        return { DispatchTable::note, channel.get(), noteNumber };
+    }
+
     bool wants (const MidiMessage& message) const override
     {
         bool wants = momentary.get() == 0
@@ -106,19 +160,29 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
             parameter->beginChangeGesture();
             if (momentary.get() == 0)
             {
-                parameter->setValueNotifyingHost (parameter->getValue() < 0.5 ? 1.f : 0.f);
+                // toggles still waiting for the render program haven't reached the parameter
+                const float current = node->hasPendingParameterChanges() ? lastToggle : parameter->getValue();
+                lastToggle = current < 0.5f ? 1.f : 0.f;
+                node->scheduleParameterChange (parameterIndex, lastToggle, message.getTimeStamp());
             }
             else
             {
                 const bool onOrOff = isInverse ? message.isNoteOff() : message.isNoteOn();
-                parameter->setValueNotifyingHost (onOrOff ? 1.f : 0.f);
+                node->scheduleParameterChange (parameterIndex, onOrOff ? 1.f : 0.f,
+                                               message.getTimeStamp());
             }
 
             parameter->endChangeGesture();
         }
+        else if (parameterIndex == GraphNode::MuteParameter)
+        {
+            // heard on the next block, the model catches up on the message thread
+            node->setMutedFromAnyThread (momentary.get() == 0 ? ! node->isMuted()
+                : (isInverse ? message.isNoteOff() : message.isNoteOn()));
+            triggerAsyncUpdate();
+        }
         else if (parameterIndex == GraphNode::EnabledParameter ||
-                 parameterIndex == GraphNode::BypassParameter ||
-                 parameterIndex == GraphNode::MuteParameter)
+                 parameterIndex == GraphNode::BypassParameter)
         {
             triggerAsyncUpdate();
         }
@@ -147,7 +211,7 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
             }
             else if (parameterIndex == GraphNode::MuteParameter)
             {
-                model.setMuted (! model.isMuted());
+                model.setMuted (node->isMuted());
             }
         }
         else
@@ -168,11 +232,15 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
             }
             else if (parameterIndex == GraphNode::MuteParameter)
             {
-                model.setMuted (isInverse ? event.isNoteOff() : event.isNoteOn());
+                model.setMuted (node->isMuted());
             }
         }
     }
 
+protected:
+    Parameter* getFeedbackParameter() const override { return parameter.get(); }
+    int getFeedbackValue (float value) const override { return value >= 0.5f ? 127 : 0; }
+
 private:
     ControllerDevice::Control control;
     Node model;
@@ -190,6 +258,7 @@ private:
     Atomic<int> inverse { 0 };
 
     const int noteNumber;
+    float lastToggle = 0.f;
 
     SpinLock eventLock;
     MidiMessage lastEvent;
@@ -199,6 +268,8 @@ private:
         if (channelObject.refersToSameSourceAs (value))
         {
             channel.set (jlimit (0, 16, (int) channelObject.getValue()));
+            if (onDispatchKeyChanged)
+                onDispatchKeyChanged();
         }
         else if (momentaryObject.refersToSameSourceAs (value))
         {
@@ -218,11 +289,16 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
     MidiCCControllerMapHandler (const ControllerDevice::Control& ctl, 
                                 const MidiMessage& message,
                                 const Node& _node,
-                                const int _parameter)
+                                const int _parameter,
+                                const ControllerMap& map)
         : control (ctl), model (_node), node (_node.getGraphNode()),
           parameter (nullptr),
           controllerNumber (message.getControllerNumber()),
-          parameterIndex (_parameter)
+          lsbControllerNumber (map.isHighResolution() && message.getControllerNumber() < 32
+                                ? message.getControllerNumber() + 32 : -1),
+          parameterIndex (_parameter),
+          smoothing (getSmoothingShape (map.getSmoothing())),
+          smoothingTime ((float) jmax (0.0, map.getSmoothingTime() * 0.001))
     {
         jassert (message.isController());
         jassert (node != nullptr);
@@ -262,22 +338,42 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         channelObject.removeListener (this);
     }
 
+    DispatchTable::Key getDispatchKey() const override
+    {
+        return { DispatchTable::controller, channel.get(), controllerNumber, lsbControllerNumber };
+    }
+
     bool wants (const MidiMessage& message) const override
     {
         return message.isController() && 
-            message.getControllerNumber() == controllerNumber &&
+            (message.getControllerNumber() == controllerNumber ||
+                (lsbControllerNumber >= 0 && message.getControllerNumber() == lsbControllerNumber)) &&
             (channel.get() == 0 || (channel.get() > 0 && message.getChannel() == channel.get()));
     }
 
     void perform (const MidiMessage& message) override
     {
+        if (message.getControllerNumber() == lsbControllerNumber)
+        {
+            // the LSB refines the last MSB, it never toggles anything
+            if (nullptr != parameter)
+                scheduleValue (static_cast<float> ((lastControllerValue << 7) | message.getControllerValue()) / 16383.f,
+                               message.getTimeStamp());
+            return;
+        }
+
         const auto ccValue = message.getControllerValue();
 
         if (nullptr != parameter)
         {
-            parameter->beginChangeGesture();
-            parameter->setValueNotifyingHost (static_cast<float> (ccValue) / 127.f);
-            parameter->endChangeGesture();
+            // the controller already shows this, don't echo it back
+            if (feedbackSlot != nullptr)
+                feedbackSlot->markSent (ccValue);
+
+            // a new MSB starts the fine value over, as the LSB may not follow
+            scheduleValue (lsbControllerNumber >= 0 ? static_cast<float> (ccValue << 7) / 16383.f
+                                                    : static_cast<float> (ccValue) / 127.f,
+                           message.getTimeStamp());
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
@@ -336,7 +432,12 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
             }
 
             if (currentToggleState != desiredToggleState.get())
+            {
+                // heard on the next block, the model catches up on the message thread
+                if (parameterIndex == GraphNode::MuteParameter)
+                    node->setMutedFromAnyThread (desiredToggleState.get() == getStateToCompare());
                 triggerAsyncUpdate();
+            }
         }
 
         lastControllerValue = ccValue;
@@ -344,10 +445,7 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
 
     void handleAsyncUpdate() override
     {
-        const auto mode = toggleMode.get();
-        const int stateToCompare = mode != ControllerDevice::Equals 
-            ? (inverseToggle.get() == 1 ? 0 : 1) // inverse on, then compare false
-            : 1;                                 // equals mode always compare true
+        const int stateToCompare = getStateToCompare();
 
         if (parameterIndex == GraphNode::EnabledParameter)
         {
@@ -368,14 +466,43 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         }
     }
 
+protected:
+    Parameter* getFeedbackParameter() const override { return parameter.get(); }
+
 private:
+    static int getSmoothingShape (const String& name)
+    {
+        if (name == "linear")
+            return ParameterRamps::linear;
+        if (name == "onePole")
+            return ParameterRamps::onePole;
+        return ParameterRamps::none;
+    }
+
+    void scheduleValue (float value, double timestamp)
+    {
+        parameter->beginChangeGesture();
+        node->scheduleParameterChange (parameterIndex, value, timestamp, smoothing, smoothingTime);
+        parameter->endChangeGesture();
+    }
+
+    int getStateToCompare() const
+    {
+        return toggleMode.get() != ControllerDevice::Equals
+            ? (inverseToggle.get() == 1 ? 0 : 1) // inverse on, then compare false
+            : 1;                                 // equals mode always compare true
+    }
+
     ControllerDevice::Control control;
     Node model;
     GraphNodePtr node { nullptr };
     Parameter::Ptr parameter { nullptr };
     
     const int controllerNumber { -1 };
+    const int lsbControllerNumber { -1 };
     const int parameterIndex { -1 };
+    const int smoothing { ParameterRamps::none };
+    const float smoothingTime { 0.f };
     int lastControllerValue = 0;
 
     Value toggleValueObject;
@@ -410,6 +537,8 @@ private:
         else if (channelObject.refersToSameSourceAs (value))
         {
             channel.set (jlimit (0, 16, (int) channelObject.getValue()));
+            if (onDispatchKeyChanged)
+                onDispatchKeyChanged();
         }
     }
 };
@@ -438,18 +567,20 @@ public:
         //     << " : " << message.getControllerValue());
         if (message.isNoteOn())
             mapping.captureNextEvent (*this, notes[message.getNoteNumber()], message);
-        else if (message.isController())
+        else if (message.isController() && controls.contains (message.getControllerNumber()))
             mapping.captureNextEvent (*this, controls[message.getControllerNumber()], message);
 
-        for (auto* handler : handlers)
-            if (handler->wants (message))
-                handler->perform (message);
+        dispatchTable.dispatch (message, [&message] (ControllerMapHandler& handler)
+        {
+            if (handler.wants (message))
+                handler.perform (message);
+        });
     }
 
     bool close()
     {
-        const auto deviceName = controllerDevice.getInputDevice().toString();
         midi.removeMidiInputCallback (this);
+        opened = false;
         return true;
     }
 
@@ -457,6 +588,16 @@ public:
     {
         close();
 
+        // the callback is removed, so the MIDI thread isn't reading the table
+        dispatchTable.build (handlers);
+        for (auto* handler : handlers)
+        {
+            const auto key = handler->getDispatchKey();
+            if (key.type == ControllerMapHandler::DispatchTable::controller
+                && isPositiveAndBelow (key.pairedNumber, 128))
+                controllerNumbers.setBit (key.pairedNumber, true);
+        }
+
         for (int i = controllerDevice.getNumControls(); --i >= 0;)
         {
             const auto control (controllerDevice.getControl (i));
@@ -475,7 +616,7 @@ public:
 
         const auto deviceName = controllerDevice.getInputDevice().toString();
         midi.addMidiInputCallback (deviceName, this, true);
-        
+        opened = true;
         return true;
     }
 
@@ -502,6 +643,11 @@ public:
     void addHandler (ControllerMapHandler* handler)
     {
         stop();
+        handler->onDispatchKeyChanged = [this]()
+        {
+            if (opened)
+                open();
+        };
         handlers.add (handler);
         start();
     }
@@ -512,6 +658,8 @@ private:
     ControllerDevice controllerDevice;
     std::unique_ptr<MidiInput> midiInput;
     OwnedArray<ControllerMapHandler> handlers;
+    ControllerMapHandler::DispatchTable dispatchTable;
+    bool opened = false;
     BigInteger controllerNumbers, noteNumbers;
     HashMap<int, ControllerDevice::Control> controls, notes;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControllerMapInput)
@@ -608,6 +756,7 @@ MappingEngine::~MappingEngine()
 {
     inputs->clear();
     inputs = nullptr;
+    feedback = nullptr;
 }
 
 bool MappingEngine::addInput (const ControllerDevice& controller, MidiEngine& midi)
@@ -618,12 +767,18 @@ bool MappingEngine::addInput (const ControllerDevice& controller, MidiEngine& mi
     std::unique_ptr<ControllerMapInput> input;
     input.reset (new ControllerMapInput (*this, midi, controller));
 
+    if (feedback == nullptr)
+        feedback.reset (new ControllerFeedback (midi));
+    feedback->addDevice (controller.getUuidString(), controller.getOutputDevice().toString(),
+                         controller.getFeedbackBudget());
+
     DBG("[EL] MappingEngine: added input handler for controller: " << controller.getName().toString());
     return inputs->add (input.release());
 }
 
 bool MappingEngine::addHandler (const ControllerDevice::Control& control, 
-                                const Node& node, const int parameter)
+                                const Node& node, const int parameter,
+                                const ControllerMap& map)
 {
     if (! control.isValid() || ! node.isValid())
         return false;
@@ -638,10 +793,18 @@ bool MappingEngine::addHandler (const ControllerDevice::Control& control,
             std::unique_ptr<ControllerMapHandler> handler;
 
             if (message.isController())
-                handler.reset (new MidiCCControllerMapHandler (control, message, node, parameter));
+                handler.reset (new MidiCCControllerMapHandler (control, message, node, parameter, map));
             else if (message.isNoteOn())
                 handler.reset (new MidiNoteControllerMap (control, message, node, parameter));
 
+            if (nullptr != handler && feedback != nullptr)
+            {
+                const auto channel = (int) control.getProperty (Tags::midiChannel, 0);
+                const bool isNote = message.isNoteOn();
+                handler->setFeedbackSlot (feedback->addSlot (control.getControllerDevice().getUuidString(),
+                    isNote, jmax (1, channel), isNote ? message.getNoteNumber() : message.getControllerNumber()));
+            }
+
             if (nullptr != handler)
             {
                 input->addHandler (handler.release());
@@ -656,7 +819,10 @@ bool MappingEngine::removeInput (const ControllerDevice& controller)
 {
     if (! inputs->containsInputFor (controller))
         return true;
-    return inputs->remove (controller);
+    const bool removed = inputs->remove (controller);
+    if (removed && feedback != nullptr)
+        feedback->removeDevice (controller.getUuidString());
+    return removed;
 }
 
 bool MappingEngine::refreshInput (const ControllerDevice& device)
@@ -677,17 +843,23 @@ void MappingEngine::clear()
 {
     stopMapping();
     inputs->clear();
+    if (feedback != nullptr)
+        feedback->clear();
 }
 
 void MappingEngine::startMapping()
 {
     stopMapping();
     inputs->start();
+    if (feedback != nullptr)
+        feedback->start();
 }
 
 void MappingEngine::stopMapping()
 {
     inputs->stop();
+    if (feedback != nullptr)
+        feedback->stop();
 }
 
 bool MappingEngine::captureNextEvent (ControllerMapInput& input, 
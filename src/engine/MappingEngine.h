@@ -25,6 +25,7 @@
 
 namespace Element {
 
+class ControllerFeedback;
 class ControllerMapHandler;
 class ControllerMapInput;
 class GraphNode;
@@ -39,7 +40,10 @@ public:
     ~MappingEngine();
 
     bool addInput (const ControllerDevice&, MidiEngine&);
-    bool addHandler (const ControllerDevice::Control&, const Node&, const int);
+    /** Maps a control to a node's parameter. The map, when given, says how
+        values are smoothed and whether 14-bit controller pairs are combined */
+    bool addHandler (const ControllerDevice::Control&, const Node&, const int,
+                     const ControllerMap& map = ControllerMap());
 
     bool removeInput (const ControllerDevice&);
     bool refreshInput (const ControllerDevice&);
@@ -55,6 +59,7 @@ public:
 private:
     friend class ControllerMapInput;
     class Inputs; std::unique_ptr<Inputs> inputs;
+    std::unique_ptr<ControllerFeedback> feedback;
 
     class CapturedEvent : public AsyncUpdater
     {
@@ -0,0 +1,308 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/EngineMetrics.h"
+#include "engine/MetricsServer.h"
+
+namespace Element {
+
+/** Streams beyond this are turned away */
+static const int maxStreams = 16;
+
+/** Requests are read up to this many bytes */
+static const int maxRequestSize = 8192;
+
+/** SHA-1 is only used for the WebSocket handshake, which requires it */
+static void sha1 (const void* data, size_t size, uint8 digest[20])
+{
+    uint32 h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+    MemoryBlock message (data, size);
+    const uint64 bits = (uint64) size * 8;
+    message.append ("\x80", 1);
+    while (message.getSize() % 64 != 56)
+        message.append ("\0", 1);
+    for (int i = 7; i >= 0; --i)
+    {
+        const uint8 byte = (uint8) (bits >> (i * 8));
+        message.append (&byte, 1);
+    }
+
+    auto rotate = [] (uint32 value, int amount) { return (value << amount) | (value >> (32 - amount)); };
+    const auto* bytes = static_cast<const uint8*> (message.getData());
+
+    for (size_t chunk = 0; chunk < message.getSize(); chunk += 64)
+    {
+        uint32 w[80];
+        for (int i = 0; i < 16; ++i)
+            w[i] = ((uint32) bytes[chunk + i * 4] << 24) | ((uint32) bytes[chunk + i * 4 + 1] << 16)
+                 | ((uint32) bytes[chunk + i * 4 + 2] << 8) | (uint32) bytes[chunk + i * 4 + 3];
+        for (int i = 16; i < 80; ++i)
+            w[i] = rotate (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32 f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);            k = 0x5a827999; }
+            else if (i < 40) { f = b ^ c ^ d;                     k = 0x6ed9eba1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d);   k = 0x8f1bbcdc; }
+            else             { f = b ^ c ^ d;                     k = 0xca62c1d6; }
+
+            const uint32 temp = rotate (a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotate (b, 30); b = a; a = temp;
+        }
+
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 20; ++i)
+        digest[i] = (uint8) (h[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static String getHeader (const StringArray& lines, const String& name)
+{
+    for (int i = 1; i < lines.size(); ++i)
+        if (lines[i].upToFirstOccurrenceOf (":", false, false).trim().equalsIgnoreCase (name))
+            return lines[i].fromFirstOccurrenceOf (":", false, false).trim();
+    return {};
+}
+
+static void writeString (StreamingSocket& socket, const String& text)
+{
+    socket.write (text.toRawUTF8(), (int) text.getNumBytesAsUTF8());
+}
+
+static void respond (StreamingSocket& socket, const String& status, const String& type, const String& body)
+{
+    String response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: " << type << "\r\n"
+             << "Content-Length: " << (int) body.getNumBytesAsUTF8() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    writeString (socket, response);
+}
+
+//=============================================================================
+MetricsServer::MetricsServer()
+    : Thread ("elmetrics")
+{ }
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start (int newPort)
+{
+    stop();
+    if (! listener.createListener (newPort))
+        return false;
+    port = newPort;
+    startThread();
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    signalThreadShouldExit();
+    stopThread (2000);
+    listener.close();
+    streams.clear();
+    numStreams.set (0);
+    port = 0;
+}
+
+void MetricsServer::publish (const EngineMetrics& metrics)
+{
+    auto text = metrics.toPrometheus();
+    auto line = metrics.toJSON();
+    const ScopedLock sl (lock);
+    prometheus.swapWith (text);
+    json.swapWith (line);
+    ++version;
+}
+
+String MetricsServer::getWebSocketAccept (const String& key)
+{
+    const auto challenge = key.trim() + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8 digest[20];
+    sha1 (challenge.toRawUTF8(), challenge.getNumBytesAsUTF8(), digest);
+    return Base64::toBase64 (digest, sizeof (digest));
+}
+
+MemoryBlock MetricsServer::makeTextFrame (const String& text)
+{
+    const auto size = (uint64) text.getNumBytesAsUTF8();
+    MemoryBlock frame;
+    const uint8 opcode = 0x81; // final fragment of a text message
+    frame.append (&opcode, 1);
+
+    if (size < 126)
+    {
+        const uint8 length = (uint8) size;
+        frame.append (&length, 1);
+    }
+    else
+    {
+        const int numBytes = size < 65536 ? 2 : 8;
+        const uint8 marker = numBytes == 2 ? 126 : 127;
+        frame.append (&marker, 1);
+        for (int i = numBytes; --i >= 0;)
+        {
+            const uint8 byte = (uint8) (size >> (i * 8));
+            frame.append (&byte, 1);
+        }
+    }
+
+    frame.append (text.toRawUTF8(), (size_t) size);
+    return frame;
+}
+
+//=============================================================================
+void MetricsServer::run()
+{
+    while (! threadShouldExit())
+    {
+        if (listener.waitUntilReady (true, 100) == 1)
+            if (auto* client = listener.waitForNextConnection())
+                serve (std::unique_ptr<StreamingSocket> (client));
+
+        sendToStreams();
+    }
+}
+
+void MetricsServer::serve (std::unique_ptr<StreamingSocket> client)
+{
+    // read the request line and headers, the body of a GET is ignored
+    MemoryBlock request;
+    const auto deadline = Time::getMillisecondCounter() + 1000;
+    char buffer [1024];
+    while (request.getSize() < (size_t) maxRequestSize
+        && request.toString().indexOf ("\r\n\r\n") < 0)
+    {
+        if (Time::getMillisecondCounter() > deadline || threadShouldExit())
+            return;
+        if (client->waitUntilReady (true, 50) != 1)
+            continue;
+        const int numRead = client->read (buffer, sizeof (buffer), false);
+        if (numRead <= 0)
+            return;
+        request.append (buffer, (size_t) numRead);
+    }
+
+    const auto lines = StringArray::fromLines (request.toString());
+    const auto tokens = StringArray::fromTokens (lines[0], " ", {});
+    const auto path = tokens[1].upToFirstOccurrenceOf ("?", false, false);
+
+    if (tokens[0] != "GET")
+    {
+        respond (*client, "405 Method Not Allowed", "text/plain", "GET only\n");
+        return;
+    }
+
+    String body;
+    if (path == "/metrics" || path == "/metrics.json")
+    {
+        {
+            const ScopedLock sl (lock);
+            body = path == "/metrics" ? prometheus : json;
+        }
+
+        respond (*client, "200 OK", path == "/metrics" ? "text/plain; version=0.0.4; charset=utf-8"
+                                                       : "application/json", body);
+        return;
+    }
+
+    if (path == "/stream")
+    {
+        const auto key = getHeader (lines, "Sec-WebSocket-Key");
+        if (key.isEmpty() || ! getHeader (lines, "Upgrade").equalsIgnoreCase ("websocket"))
+        {
+            respond (*client, "400 Bad Request", "text/plain", "WebSocket upgrade expected\n");
+            return;
+        }
+
+        if (streams.size() >= maxStreams)
+        {
+            respond (*client, "503 Service Unavailable", "text/plain", "Too many streams\n");
+            return;
+        }
+
+        String response;
+        response << "HTTP/1.1 101 Switching Protocols\r\n"
+                 << "Upgrade: websocket\r\n"
+                 << "Connection: Upgrade\r\n"
+                 << "Sec-WebSocket-Accept: " << getWebSocketAccept (key) << "\r\n\r\n";
+        writeString (*client, response);
+
+        {
+            const ScopedLock sl (lock);
+            body = json;
+        }
+
+        if (body.isNotEmpty())
+        {
+            const auto frame = makeTextFrame (body);
+            client->write (frame.getData(), (int) frame.getSize());
+        }
+        streams.add (client.release());
+        numStreams.set (streams.size());
+        return;
+    }
+
+    respond (*client, "404 Not Found", "text/plain", "Try /metrics, /metrics.json or /stream\n");
+}
+
+void MetricsServer::sendToStreams()
+{
+    // clients only ever send a close, or pings nobody needs answering
+    for (int i = streams.size(); --i >= 0;)
+    {
+        auto* stream = streams.getUnchecked (i);
+        if (stream->waitUntilReady (true, 0) != 1)
+            continue;
+
+        uint8 buffer [256];
+        const int numRead = stream->read (buffer, sizeof (buffer), false);
+        if (numRead <= 0 || (buffer[0] & 0x0f) == 0x08)
+            streams.remove (i);
+    }
+
+    String body;
+    {
+        const ScopedLock sl (lock);
+        if (version == lastVersionSent)
+        {
+            numStreams.set (streams.size());
+            return;
+        }
+        lastVersionSent = version;
+        body = json;
+    }
+
+    const auto frame = makeTextFrame (body);
+    for (int i = streams.size(); --i >= 0;)
+        if (streams.getUnchecked(i)->write (frame.getData(), (int) frame.getSize()) != (int) frame.getSize())
+            streams.remove (i);
+    numStreams.set (streams.size());
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+struct EngineMetrics;
+
+/** Serves engine metrics over HTTP from its own thread.
+
+        GET /metrics            the latest snapshot for Prometheus to scrape
+        GET /metrics.json       the latest snapshot as JSON
+        GET /stream             a WebSocket sending the JSON of every snapshot
+                                as a text message
+
+    Snapshots are taken elsewhere and handed over with publish(), so
+    requests never wait on the engine or the message thread.
+ */
+class MetricsServer : private Thread
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    /** Starts listening, stopping first if already running. Returns false
+        if the port couldn't be opened */
+    bool start (int port);
+
+    /** Closes the port and every stream */
+    void stop();
+
+    bool isRunning() const { return isThreadRunning(); }
+    int getPort() const noexcept { return port; }
+
+    /** Replaces the snapshot requests are answered with and queues it for
+        every stream */
+    void publish (const EngineMetrics& metrics);
+
+    /** Returns the number of WebSocket clients connected */
+    int getNumStreams() const noexcept { return numStreams.get(); }
+
+    /** Returns the Sec-WebSocket-Accept value answering a client key */
+    static String getWebSocketAccept (const String& key);
+
+    /** Wraps text in an unmasked WebSocket text frame */
+    static MemoryBlock makeTextFrame (const String& text);
+
+private:
+    StreamingSocket listener;
+    OwnedArray<StreamingSocket> streams;
+    int port = 0;
+    Atomic<int> numStreams { 0 };
+
+    CriticalSection lock;
+    String prometheus, json;
+    int version = 0;
+    int lastVersionSent = 0;
+
+    void run() override;
+    void serve (std::unique_ptr<StreamingSocket> client);
+    void sendToStreams();
+
+    JUCE_DECLARE_NON_COPYABLE (MetricsServer)
+};
+
+}
@@ -0,0 +1,189 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiBudget.h"
+
+namespace Element {
+
+// MidiBuffer stores a timestamp and a size ahead of each message
+static constexpr int eventHeaderBytes = (int) (sizeof (int32) + sizeof (uint16));
+
+static std::atomic<int> sMaxEvents { (int) MidiBudget::defaultMaxEvents };
+static std::atomic<int64> sNumDropped { 0 };
+
+void MidiBudget::setMaxEventsPerBlock (int maxEvents)
+{
+    sMaxEvents.store (jlimit ((int) minMaxEvents, (int) maxMaxEvents, maxEvents),
+                      std::memory_order_relaxed);
+}
+
+int MidiBudget::getMaxEventsPerBlock() noexcept
+{
+    return sMaxEvents.load (std::memory_order_relaxed);
+}
+
+int MidiBudget::getMaxBytesPerBlock() noexcept
+{
+    return getMaxEventsPerBlock() * (int) bytesPerEvent;
+}
+
+void MidiBudget::reserve (MidiBuffer& buffer)
+{
+    buffer.ensureSize ((size_t) getMaxBytesPerBlock());
+}
+
+int64 MidiBudget::getNumDropped() noexcept
+{
+    return sNumDropped.load (std::memory_order_relaxed);
+}
+
+void MidiBudget::resetNumDropped() noexcept
+{
+    sNumDropped.store (0, std::memory_order_relaxed);
+}
+
+void MidiBudget::copyEvents (MidiBuffer& dest, const MidiBuffer& source) noexcept
+{
+    dest.clear();
+    Writer (dest).addEvents (source, 0, -1, 0);
+}
+
+void MidiBudget::addEvents (MidiBuffer& dest, const MidiBuffer& source, int numSamples) noexcept
+{
+    Writer (dest).addEvents (source, 0, numSamples, 0);
+}
+
+//=============================================================================
+
+MidiBudget::Merger::Merger (int numSources)
+    : maxSources (jmax (1, numSources))
+{
+    heads.calloc ((size_t) maxSources);
+    ends.calloc ((size_t) maxSources);
+}
+
+void MidiBudget::Merger::merge (MidiBuffer& dest, const MidiBuffer* const* sources,
+                                int numSources, int numSamples) noexcept
+{
+    jassert (numSources <= maxSources);
+    numSources = jmin (numSources, maxSources);
+    dest.clear();
+
+    for (int i = 0; i < numSources; ++i)
+    {
+        jassert (sources[i] != &dest);
+        heads[i] = sources[i]->data.begin();
+        ends[i]  = sources[i]->data.end();
+    }
+
+    const int maxEvents = getMaxEventsPerBlock();
+    const int maxBytes  = getMaxBytesPerBlock();
+    int numEvents = 0, numBytes = 0;
+
+    for (;;)
+    {
+        int next = -1;
+        int32 nextFrame = 0;
+        for (int i = 0; i < numSources; ++i)
+        {
+            if (heads[i] == ends[i])
+                continue;
+            const auto frame = readUnaligned<int32> (heads[i]);
+            if (next < 0 || frame < nextFrame)
+            {
+                next = i;
+                nextFrame = frame;
+            }
+        }
+
+        if (next < 0 || (numSamples >= 0 && nextFrame >= numSamples))
+            break;
+
+        const uint8* const event = heads[next];
+        const int eventBytes = (int) readUnaligned<uint16> (event + sizeof (int32)) + eventHeaderBytes;
+        heads[next] += eventBytes;
+
+        if (numEvents >= maxEvents || numBytes + eventBytes > maxBytes)
+        {
+            sNumDropped.fetch_add (1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // reserved buffers have room for the budget, appending won't allocate
+        dest.data.addArray (event, eventBytes);
+        ++numEvents;
+        numBytes += eventBytes;
+    }
+}
+
+//=============================================================================
+
+MidiBudget::Writer::Writer (MidiBuffer& b) noexcept
+{
+    reset (b);
+}
+
+MidiBudget::Writer::Writer() noexcept { }
+
+void MidiBudget::Writer::reset (MidiBuffer& b) noexcept
+{
+    buffer    = &b;
+    numEvents = numBytes = 0;
+    maxEvents = getMaxEventsPerBlock();
+    maxBytes  = getMaxBytesPerBlock();
+
+    MidiBuffer::Iterator iter (b);
+    const uint8* data; int size, frame;
+    while (iter.getNextEvent (data, size, frame))
+    {
+        ++numEvents;
+        numBytes += size + eventHeaderBytes;
+    }
+}
+
+bool MidiBudget::Writer::add (const uint8* data, int size, int frame) noexcept
+{
+    const int eventBytes = size + eventHeaderBytes;
+    jassert (buffer != nullptr);
+    if (numEvents >= maxEvents || numBytes + eventBytes > maxBytes)
+    {
+        sNumDropped.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    buffer->addEvent (data, size, frame);
+    ++numEvents;
+    numBytes += eventBytes;
+    return true;
+}
+
+void MidiBudget::Writer::addEvents (const MidiBuffer& source, int start, int numSamples, int offset) noexcept
+{
+    MidiBuffer::Iterator iter (source);
+    iter.setNextSamplePosition (start);
+    const uint8* data; int size, frame;
+    while (iter.getNextEvent (data, size, frame))
+    {
+        if (numSamples >= 0 && frame >= start + numSamples)
+            break;
+        add (data, size, frame + offset);
+    }
+}
+
+}
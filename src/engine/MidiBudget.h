@@ -0,0 +1,121 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Caps how much MIDI a single block may carry.
+
+    Buffers used on the audio thread are reserved for the budget when the
+    engine prepares, and writes go through a Writer which drops and counts
+    whatever doesn't fit, so a burst of sysex or dense controller data can't
+    make a buffer grow mid-block.
+ */
+struct MidiBudget
+{
+    enum
+    {
+        defaultMaxEvents    = 2048,
+        minMaxEvents        = 64,
+        maxMaxEvents        = 65536,
+        bytesPerEvent       = 16    ///< reserved per event, a short message and its header with room to spare
+    };
+
+    /** Sets the most events one buffer takes in a block. Buffers reserved
+        before the change keep their size until they are prepared again */
+    static void setMaxEventsPerBlock (int maxEvents);
+
+    /** Returns the most events one buffer takes in a block */
+    static int getMaxEventsPerBlock() noexcept;
+
+    /** Returns the bytes reserved for each buffer */
+    static int getMaxBytesPerBlock() noexcept;
+
+    /** Reserves a buffer for the current budget. Call while preparing */
+    static void reserve (MidiBuffer& buffer);
+
+    /** Returns the number of events dropped since the last reset */
+    static int64 getNumDropped() noexcept;
+
+    /** Zeroes the dropped event count */
+    static void resetNumDropped() noexcept;
+
+    /** Replaces the contents of a buffer with another, within budget */
+    static void copyEvents (MidiBuffer& dest, const MidiBuffer& source) noexcept;
+
+    /** Appends the first numSamples of another buffer, within budget */
+    static void addEvents (MidiBuffer& dest, const MidiBuffer& source, int numSamples) noexcept;
+
+    /** Merges buffers into another in one pass, within budget.
+
+        Sources are already in time order, so the earliest of their next
+        events always goes next and is appended, instead of each event
+        being searched into place. Events on the same sample keep the order
+        of their sources. The destination can't be one of the sources.
+     */
+    class Merger
+    {
+    public:
+        /** Allocates for merging up to this many buffers at once */
+        explicit Merger (int maxSources);
+
+        /** Replaces dest with the first numSamples of every source */
+        void merge (MidiBuffer& dest, const MidiBuffer* const* sources,
+                    int numSources, int numSamples) noexcept;
+
+    private:
+        HeapBlock<const uint8*> heads, ends;
+        const int maxSources;
+    };
+
+    /** Adds events to a buffer for as long as the budget allows */
+    class Writer
+    {
+    public:
+        /** Writes to the buffer, counting what it already holds against the budget */
+        explicit Writer (MidiBuffer& buffer) noexcept;
+
+        /** A writer for arrays of them, reset() before adding anything */
+        Writer() noexcept;
+
+        /** Starts writing to a buffer, as if newly constructed for it */
+        void reset (MidiBuffer& buffer) noexcept;
+
+        /** Adds an event, or drops and counts it if over budget */
+        bool add (const uint8* data, int numBytes, int frame) noexcept;
+        bool add (const MidiMessage& message, int frame) noexcept
+        {
+            return add (message.getRawData(), message.getRawDataSize(), frame);
+        }
+
+        /** Adds the events of another buffer between start and start +
+            numSamples, moving them by the offset */
+        void addEvents (const MidiBuffer& source, int start, int numSamples, int offset) noexcept;
+
+    private:
+        MidiBuffer* buffer = nullptr;
+        int numEvents = 0, numBytes = 0;
+        int maxEvents = 0, maxBytes = 0;
+    };
+};
+
+}
@@ -23,12 +23,17 @@
 
 namespace Element {
 
+/** Moves channel messages to other channels.
+
+    Only the low bits of status bytes change, so buffers are rewritten where
+    they are in one pass. A map that leaves every channel alone doesn't
+    touch the buffer at all.
+ */
 class MidiChannelMap
 {
 public:
     MidiChannelMap()
     {
-        tempMidi.ensureSize (sizeof(uint8) * 3 * 16);
         reset();
     }
 
@@ -36,61 +41,76 @@ public:
 
     inline void reset()
     {
-        if (channelMap.size() <= 0)
-            while (channelMap.size() <= 16)
-                channelMap.add (0);
         for (int ch = 0; ch <= 16; ++ch)
-            channelMap.getReference(ch) = ch;
+            channelMap[ch] = ch;
+        updateIdentity();
     }
 
     inline void set (const int outputChan) noexcept
     {
         jassert (outputChan >= 1 && outputChan <= 16);
         for (int ch = 1; ch <= 16; ++ch)
-            channelMap.getReference (ch) = outputChan;
+            channelMap[ch] = outputChan;
+        updateIdentity();
     }
 
     inline void set (const int inputChan, const int outputChan) noexcept
     {
         jassert (inputChan >= 1 && inputChan <= 16 &&
                  outputChan >= 1 && outputChan <= 16);
-        channelMap.getReference (inputChan) = outputChan;
+        channelMap[inputChan] = outputChan;
+        updateIdentity();
     }
 
     inline int get (const int channel) const
     {
         jassert (channel >= 1 && channel <= 16);
-        return channelMap.getUnchecked (channel);
+        return channelMap[channel];
     }
 
+    /** Returns true if every channel maps to itself */
+    inline bool isIdentity() const noexcept { return identity; }
+
     inline void process (MidiMessage& message) const
     {
         if (message.getChannel() > 0)
-            message.setChannel (channelMap.getUnchecked (message.getChannel()));
+            message.setChannel (channelMap[message.getChannel()]);
     }
 
-    inline void render (MidiBuffer& midi)
+    inline void render (MidiBuffer& midi) noexcept
     {
-        MidiBuffer::Iterator iter (midi);
-        MidiMessage msg; int frame = 0;
-        
-        while (iter.getNextEvent (msg, frame))
+        if (identity)
+            return;
+
+        // MidiBuffer stores a timestamp and a size ahead of each message
+        constexpr int headerBytes = (int) (sizeof (int32) + sizeof (uint16));
+        uint8* event = midi.data.begin();
+        uint8* const end = midi.data.end();
+
+        while (event < end)
         {
-            process (msg);
-            tempMidi.addEvent (msg, frame);
+            const int size = (int) readUnaligned<uint16> (event + sizeof (int32));
+            uint8& status = event [headerBytes];
+            if (size > 0 && status >= 0x80 && status < 0xf0)
+                status = (uint8) ((status & 0xf0) | statusChannel [status & 0x0f]);
+            event += headerBytes + size;
         }
-
-        midi.swapWith (tempMidi);
-        tempMidi.clear();
     }
 
-    const Array<int>& getMap() const { return channelMap; }
-
 private:
-    // TODO: optimize: use plain C array
-    Array<int> channelMap;
-    int channels [17];
-    MidiBuffer tempMidi;
+    int channelMap [17];
+    uint8 statusChannel [16];   ///< status byte channel bits in, out
+    bool identity = true;
+
+    inline void updateIdentity() noexcept
+    {
+        identity = true;
+        for (int ch = 1; ch <= 16; ++ch)
+        {
+            statusChannel [ch - 1] = (uint8) (channelMap[ch] - 1);
+            identity &= channelMap[ch] == ch;
+        }
+    }
 };
 
 }
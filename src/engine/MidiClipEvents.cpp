@@ -0,0 +1,267 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiClipEvents.h"
+
+namespace Element {
+
+/** Sorts by beat, note offs ahead of note ons so a note ending where
+    another starts is released first */
+static bool eventPrecedes (const MidiClipEvents::Event& a, const MidiClipEvents::Event& b) noexcept
+{
+    if (a.beat != b.beat)
+        return a.beat < b.beat;
+    return (a.data[0] & 0xf0) == 0x80 && (b.data[0] & 0xf0) == 0x90;
+}
+
+static bool isNoteProperty (const Identifier& property)
+{
+    return property == Slugs::id || property == Slugs::channel || property == Slugs::start
+        || property == Slugs::length || property == Slugs::velocity;
+}
+
+MidiClipEvents::MidiClipEvents (const NoteSequence& sequence)
+    : notes (sequence.node())
+{
+    notes.addListener (this);
+    rebuild();
+    publish();
+}
+
+MidiClipEvents::~MidiClipEvents()
+{
+    cancelPendingUpdate();
+    notes.removeListener (this);
+    retired.add (compiled.exchange (nullptr));
+    reclaimRetired (true);
+}
+
+void MidiClipEvents::update()
+{
+    if (isUpdatePending())
+    {
+        cancelPendingUpdate();
+        publish();
+    }
+}
+
+int MidiClipEvents::getNumEvents() const noexcept
+{
+    auto* const current = compiled.load();
+    return current != nullptr ? current->events.size() : 0;
+}
+
+int MidiClipEvents::seek (const Event* events, int numEvents, double beat) noexcept
+{
+    int start = 0, end = numEvents;
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (events[middle].beat < beat)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return start;
+}
+
+int MidiClipEvents::render (MidiBudget::Writer& midi, Range<double> beats, double samplesPerBeat,
+                            int frameOffset) const noexcept
+{
+    const Reader events (*this);
+    int numAdded = 0;
+    for (int i = events.seek (beats.getStart()); i < events.size(); ++i)
+    {
+        const auto& event = events[i];
+        if (event.beat >= beats.getEnd())
+            break;
+        const int frame = frameOffset + (int) ((event.beat - beats.getStart()) * samplesPerBeat);
+        if (midi.add (event.data, 3, frame))
+            ++numAdded;
+    }
+
+    return numAdded;
+}
+
+//=============================================================================
+MidiClipEvents::Reader::Reader (const MidiClipEvents& e) noexcept
+    : owner (e)
+{
+    // advertise the array before reading it, then make sure it wasn't
+    // replaced in the meantime
+    auto* current = owner.compiled.load();
+    owner.compiledInUse.store (current);
+    for (auto* latest = owner.compiled.load(); latest != current; latest = owner.compiled.load())
+    {
+        current = latest;
+        owner.compiledInUse.store (current);
+    }
+
+    if (current != nullptr)
+    {
+        events = current->events.getRawDataPointer();
+        numEvents = current->events.size();
+    }
+}
+
+MidiClipEvents::Reader::~Reader() noexcept
+{
+    owner.compiledInUse.store (nullptr);
+}
+
+//=============================================================================
+void MidiClipEvents::addNote (const ValueTree& tree)
+{
+    if (! tree.hasType (Slugs::note))
+        return;
+
+    const Note note (tree);
+    MidiMessage on, off;
+    note.getMidi (on, off);
+
+    const int noteId = ++lastNoteId;
+    noteTrees.add (tree);
+    noteIds.add (noteId);
+
+    for (const auto* message : { &on, &off })
+    {
+        Entry entry;
+        entry.note = noteId;
+        entry.event.beat = message->getTimeStamp();
+        memcpy (entry.event.data, message->getRawData(), 3);
+
+        // insert after everything that sorts with or ahead of it
+        int start = 0, end = entries.size();
+        while (start < end)
+        {
+            const int middle = (start + end) / 2;
+            if (eventPrecedes (entry.event, entries.getReference (middle).event))
+                end = middle;
+            else
+                start = middle + 1;
+        }
+        entries.insert (start, entry);
+    }
+}
+
+void MidiClipEvents::removeEntries (int noteId)
+{
+    for (int i = entries.size(); --i >= 0;)
+        if (entries.getReference (i).note == noteId)
+            entries.remove (i);
+}
+
+int MidiClipEvents::indexOfNote (const ValueTree& tree) const
+{
+    for (int i = noteTrees.size(); --i >= 0;)
+        if (noteTrees.getReference (i) == tree)
+            return i;
+    return -1;
+}
+
+void MidiClipEvents::rebuild()
+{
+    entries.clearQuick();
+    noteTrees.clearQuick();
+    noteIds.clearQuick();
+    entries.ensureStorageAllocated (notes.getNumChildren() * 2);
+    for (int i = 0; i < notes.getNumChildren(); ++i)
+        addNote (notes.getChild (i));
+}
+
+void MidiClipEvents::publish()
+{
+    auto* const next = new Compiled();
+    next->events.ensureStorageAllocated (entries.size());
+    for (const auto& entry : entries)
+        next->events.add (entry.event);
+
+    if (auto* const previous = compiled.exchange (next))
+        retired.add (previous);
+    reclaimRetired (false);
+}
+
+void MidiClipEvents::reclaimRetired (bool wait)
+{
+    // an array stops being read as soon as the audio thread stops advertising
+    // it. anything still in use is tried again on the next publish
+    const uint32 deadline = Time::getMillisecondCounter() + 250;
+    for (int i = retired.size(); --i >= 0;)
+    {
+        auto* const old = retired.getUnchecked (i);
+        while (wait && compiledInUse.load() == old && Time::getMillisecondCounter() < deadline)
+            Thread::sleep (1);
+        if (compiledInUse.load() != old)
+            retired.remove (i);
+    }
+}
+
+void MidiClipEvents::handleAsyncUpdate()
+{
+    publish();
+}
+
+//=============================================================================
+void MidiClipEvents::valueTreePropertyChanged (ValueTree& tree, const Identifier& property)
+{
+    if (tree.getParent() != notes || ! isNoteProperty (property))
+        return;
+
+    const int index = indexOfNote (tree);
+    if (index >= 0)
+    {
+        removeEntries (noteIds [index]);
+        noteTrees.remove (index);
+        noteIds.remove (index);
+    }
+
+    addNote (tree);
+    triggerAsyncUpdate();
+}
+
+void MidiClipEvents::valueTreeChildAdded (ValueTree& parent, ValueTree& child)
+{
+    if (parent != notes)
+        return;
+    addNote (child);
+    triggerAsyncUpdate();
+}
+
+void MidiClipEvents::valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int)
+{
+    if (parent != notes)
+        return;
+
+    const int index = indexOfNote (child);
+    if (index < 0)
+        return;
+
+    removeEntries (noteIds [index]);
+    noteTrees.remove (index);
+    noteIds.remove (index);
+    triggerAsyncUpdate();
+}
+
+void MidiClipEvents::valueTreeRedirected (ValueTree&)
+{
+    rebuild();
+    triggerAsyncUpdate();
+}
+
+}
@@ -0,0 +1,132 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/MidiBudget.h"
+#include "session/NoteSequence.h"
+
+namespace Element {
+
+/** A note sequence compiled for playback.
+
+    Notes are kept as a flat array of note on and off events sorted by beat,
+    which the audio thread seeks with a binary search instead of walking the
+    sequence's ValueTree. Edits to the notes update a working copy event by
+    event on the message thread, and the result is published as a new
+    immutable array once per message loop. The audio thread swaps to the
+    newest array at the start of a block, so a block always plays one
+    consistent set of events.
+
+    One thread at a time may render or hold a Reader.
+ */
+class MidiClipEvents : private ValueTree::Listener,
+                       private AsyncUpdater
+{
+public:
+    struct Event
+    {
+        double beat;
+        uint8 data [3];
+    };
+
+    /** Pins the published events while the audio thread reads them */
+    class Reader
+    {
+    public:
+        explicit Reader (const MidiClipEvents&) noexcept;
+        ~Reader() noexcept;
+
+        int size() const noexcept                           { return numEvents; }
+        const Event& operator[] (int index) const noexcept  { return events[index]; }
+
+        /** Returns the index of the first event at or after a beat */
+        int seek (double beat) const noexcept { return MidiClipEvents::seek (events, numEvents, beat); }
+
+    private:
+        const MidiClipEvents& owner;
+        const Event* events = nullptr;
+        int numEvents = 0;
+        JUCE_DECLARE_NON_COPYABLE (Reader)
+    };
+
+    /** Compiles a sequence and follows its edits */
+    explicit MidiClipEvents (const NoteSequence& notes);
+    ~MidiClipEvents();
+
+    /** Publishes pending edits now instead of on the next message loop.
+        Call from the message thread */
+    void update();
+
+    /** Returns the number of events in the published array */
+    int getNumEvents() const noexcept;
+
+    /** Adds the events in a range of beats to a buffer, each positioned by its
+        distance from the start of the range plus an offset. Realtime safe,
+        returns the number of events added */
+    int render (MidiBudget::Writer& midi, Range<double> beats, double samplesPerBeat,
+                int frameOffset = 0) const noexcept;
+
+    /** Returns the index of the first event at or after a beat in a sorted
+        array of events */
+    static int seek (const Event* events, int numEvents, double beat) noexcept;
+
+private:
+    struct Compiled
+    {
+        Array<Event> events;
+    };
+
+    /** An event in the working copy, with the note it belongs to */
+    struct Entry
+    {
+        Event event;
+        int note;
+    };
+
+    ValueTree notes;
+    Array<Entry> entries;
+    Array<ValueTree> noteTrees;
+    Array<int> noteIds;
+    int lastNoteId = 0;
+
+    std::atomic<Compiled*> compiled { nullptr };
+    mutable std::atomic<Compiled*> compiledInUse { nullptr };
+    OwnedArray<Compiled> retired;
+
+    void addNote (const ValueTree& note);
+    void removeEntries (int noteId);
+    int indexOfNote (const ValueTree& note) const;
+    void rebuild();
+    void publish();
+    void reclaimRetired (bool wait);
+
+    void handleAsyncUpdate() override;
+    void valueTreePropertyChanged (ValueTree&, const Identifier&) override;
+    void valueTreeChildAdded (ValueTree&, ValueTree&) override;
+    void valueTreeChildRemoved (ValueTree&, ValueTree&, int) override;
+    void valueTreeChildOrderChanged (ValueTree&, int, int) override { }
+    void valueTreeParentChanged (ValueTree&) override { }
+    void valueTreeRedirected (ValueTree&) override;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiClipEvents)
+};
+
+}
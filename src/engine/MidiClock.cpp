@@ -22,46 +22,165 @@
 namespace Element
 {
     
+// the loop locks with a wide bandwidth over the first couple of beats,
+// then narrows to filter out jitter
+static constexpr double lockBandwidth   = 2.0;      // Hz
+static constexpr double trackBandwidth  = 0.1;      // Hz
+static constexpr int64 ticksToLock      = 48;
+static constexpr double tempoTolerance  = 0.1;      // BPM change worth reporting
+static constexpr double maxTickGap      = 0.5;      // seconds, slower than 5 BPM is a dropout
+
 void MidiClock::process (const MidiMessage& msg)
 {
     jassert (sampleRate > 0.0 && blockSize > 0);
-    jassert (msg.isMidiClock() || msg.isSongPositionPointer());
-    
-    if (midiClockTicks <= 0)
+
+    if (msg.isMidiStart())
     {
-        dll.reset (msg.getTimeStamp(), (double)blockSize / sampleRate, 1.0);
-        dll.setParams ((double)blockSize / sampleRate, 1.0);
+        // the next tick is the first of beat zero
+        position = -1;
+        publish (ticksFollowed >= ticksToLock);
+        return;
     }
-    else
+
+    if (msg.isSongPositionPointer())
     {
-        dll.update (msg.getTimeStamp());
+        // sixteenths, six ticks each
+        position = (int64) msg.getSongPositionPointerMidiBeat() * 6 - 1;
+        publish (ticksFollowed >= ticksToLock);
+        return;
     }
-    
-    if (midiClockTicks == syncPeriodTicks)
+
+    if (msg.isMidiClock())
+        tick (msg.getTimeStamp());
+}
+
+void MidiClock::tick (const double time)
+{
+    ++position;
+
+    if (ticksFollowed > 0 && time - loopTime > maxTickGap)
+    {
+        const bool wasLocked = ticksFollowed >= ticksToLock;
+        ticksFollowed = 0;
+        if (wasLocked)
+            for (auto* listener : listeners)
+                listener->midiClockSignalDropped();
+    }
+
+    if (ticksFollowed <= 1)
+    {
+        acquire (time);
+        return;
+    }
+
+    const double error = time - nextTime;
+    loopTime  = nextTime;
+    nextTime += b * error + period;
+    period   += c * error;
+    ++ticksFollowed;
+
+    if (ticksFollowed == ticksToLock)
+    {
+        setBandwidth (trackBandwidth);
         for (auto* listener : listeners)
             listener->midiClockSignalAcquired();
-    
-    if (midiClockTicks >= syncPeriodTicks && msg.getTimeStamp() - timeOfLastUpdate >= 1.0)
+    }
+
+    const bool locked = ticksFollowed >= ticksToLock;
+    publish (locked);
+
+    const double bpm = 60.0 / (period * 24.0);
+    if (locked && std::abs (bpm - reportedTempo) >= tempoTolerance && bpm >= 20.0 && bpm <= 999.0)
     {
-        lastKnownTimeDiff   = dll.timeDiff();
-        const double bpm    = 60.0 / (lastKnownTimeDiff * 24.0);
-        timeOfLastUpdate    = msg.getTimeStamp();
-        
-        if (bpm >= 20.0 && bpm <= 999.0)
-            for (auto* listener : listeners)
-                listener->midiClockTempoChanged (bpm);
+        reportedTempo = bpm;
+        for (auto* listener : listeners)
+            listener->midiClockTempoChanged ((float) bpm);
     }
-    
-    ++midiClockTicks;
+}
+
+void MidiClock::acquire (const double time)
+{
+    // the first two ticks seed the period for the loop to refine
+    if (ticksFollowed == 1 && time > loopTime)
+        period = time - loopTime;
+    else if (period <= 0.0)
+        period = 60.0 / (120.0 * 24.0);
+
+    loopTime = time;
+    nextTime = time + period;
+    ++ticksFollowed;
+    reportedTempo = 0.0;
+    setBandwidth (lockBandwidth);
+    publish (false);
+}
+
+void MidiClock::setBandwidth (const double hz)
+{
+    bandwidth = hz;
+    const double omega = MathConstants<double>::twoPi * bandwidth * jmax (1.0e-4, period);
+    b = std::sqrt (2.0) * omega;
+    c = omega * omega;
+}
+
+void MidiClock::publish (const bool locked)
+{
+    sequence.fetch_add (1, std::memory_order_acq_rel);
+    publishedTime.store (loopTime, std::memory_order_relaxed);
+    publishedPeriod.store (period, std::memory_order_relaxed);
+    publishedPosition.store (position, std::memory_order_relaxed);
+    publishedLocked.store (locked, std::memory_order_relaxed);
+    sequence.fetch_add (1, std::memory_order_release);
+}
+
+MidiClock::Snapshot MidiClock::read() const noexcept
+{
+    Snapshot snap;
+    for (;;)
+    {
+        const uint32 before = sequence.load (std::memory_order_acquire);
+        if ((before & 1u) != 0)
+            continue;
+        snap.tickTime = publishedTime.load (std::memory_order_relaxed);
+        snap.period   = publishedPeriod.load (std::memory_order_relaxed);
+        snap.position = publishedPosition.load (std::memory_order_relaxed);
+        snap.locked   = publishedLocked.load (std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (sequence.load (std::memory_order_relaxed) == before)
+            return snap;
+    }
+}
+
+bool MidiClock::isLocked() const noexcept
+{
+    return read().locked;
+}
+
+double MidiClock::getTempo() const noexcept
+{
+    const auto snap = read();
+    return snap.locked && snap.period > 0.0 ? 60.0 / (snap.period * 24.0) : 0.0;
+}
+
+double MidiClock::getBeatPosition (const double time) const noexcept
+{
+    const auto snap = read();
+    if (snap.period <= 0.0)
+        return 0.0;
+    // never run more than a tick past the last one that arrived
+    const double fraction = jlimit (0.0, 1.0, (time - snap.tickTime) / snap.period);
+    return ((double) snap.position + fraction) / 24.0;
 }
 
 void MidiClock::reset (const double sr, const int bs)
 {
-    sampleRate          = sr;
-    blockSize           = bs;
-    timeOfLastUpdate    = 0.0;
-    lastKnownTimeDiff   = 0.0;
-    midiClockTicks      = 0;
+    sampleRate      = sr;
+    blockSize       = bs;
+    loopTime        = nextTime = 0.0;
+    period          = 0.0;
+    ticksFollowed   = 0;
+    position        = -1;
+    reportedTempo   = 0.0;
+    publish (false);
 }
 
 void MidiClock::addListener (Listener* listener)
@@ -23,6 +23,14 @@
 
 namespace Element {
     
+/** Follows an external MIDI clock.
+
+    Clock ticks are run through a second order delay-locked loop, so the
+    tempo and beat position it reports are free of the jitter cheap
+    interfaces add to each tick. The loop starts out wide to lock within
+    a couple of beats and then narrows. process() is called on the MIDI
+    thread, the getters can be called from any thread.
+ */
 class MidiClock
 {
 public:
@@ -40,22 +48,57 @@ public:
     MidiClock() = default;
     ~MidiClock() { }
     
+    /** Handles clock, start, continue and song position messages, stamped
+        in seconds on the Time::getMillisecondCounterHiRes() clock */
     void process (const MidiMessage& msg);
     void reset (const double sampleRate, const int blockSize);
     
+    /** True once enough ticks have arrived for the tempo to be trusted */
+    bool isLocked() const noexcept;
+
+    /** Returns the filtered tempo in BPM, or 0 if not locked */
+    double getTempo() const noexcept;
+
+    /** Returns the position in beats at the given time, counted from the
+        last start or song position. Includes the fraction between ticks */
+    double getBeatPosition (double time) const noexcept;
+
     void addListener (Listener*);
     void removeListener (Listener*);
     
 private:
     double sampleRate = 0.0;
     int blockSize = 0;
-    DelayLockedLoop dll;
-    double timeOfLastUpdate = 0.0;
-    double lastKnownTimeDiff = 0.0;
-    int midiClockTicks = 0;
-    int syncPeriodTicks = 48;
-    double bpmUpdateSeconds = 1.0;
-    
+
+    // loop state, only touched by process()
+    double loopTime = 0.0;          // filtered time of the last tick
+    double nextTime = 0.0;          // predicted time of the next tick
+    double period = 0.0;            // filtered seconds per tick
+    double bandwidth = 0.0;
+    double b = 0.0, c = 0.0;
+    int64 ticksFollowed = 0;        // since the signal was acquired
+    int64 position = -1;            // ticks since start or song position
+    double reportedTempo = 0.0;
+
+    // what readers see, odd sequence counts mean a write is under way
+    struct Snapshot
+    {
+        double tickTime = 0.0;
+        double period = 0.0;
+        int64 position = 0;
+        bool locked = false;
+    };
+    std::atomic<uint32> sequence { 0 };
+    std::atomic<double> publishedTime { 0.0 }, publishedPeriod { 0.0 };
+    std::atomic<int64> publishedPosition { 0 };
+    std::atomic<bool> publishedLocked { false };
+
+    void tick (double time);
+    void acquire (double time);
+    void setBandwidth (double hz);
+    void publish (bool locked);
+    Snapshot read() const noexcept;
+
     Array<Listener*> listeners;
 };
 
@@ -0,0 +1,266 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// platform headers go first, some declare names that clash with JUCE's
+#if JUCE_LINUX && JUCE_ALSA
+ #include <alsa/asoundlib.h>
+#elif JUCE_MAC
+ #include <CoreMIDI/CoreMIDI.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <dbt.h>
+#endif
+
+#include "engine/MidiDeviceWatcher.h"
+
+namespace Element {
+
+/** How long to wait after a notification before listing devices */
+static const int settleMillis = 250;
+
+/** How often devices are listed when the OS can't say */
+static const int pollMillis = 3000;
+
+//=============================================================================
+#if JUCE_LINUX && JUCE_ALSA
+
+/** Listens on the sequencer's announce port from its own thread */
+class MidiDeviceWatcher::Native : private Thread
+{
+public:
+    explicit Native (MidiDeviceWatcher& w)
+        : Thread ("el.midi.hotplug"), owner (w)
+    {
+        if (snd_seq_open (&seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0)
+        {
+            seq = nullptr;
+            return;
+        }
+
+        snd_seq_set_client_name (seq, "Element Hotplug");
+        port = snd_seq_create_simple_port (seq, "Announce",
+            SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_NO_EXPORT,
+            SND_SEQ_PORT_TYPE_APPLICATION);
+
+        if (port < 0 || snd_seq_connect_from (seq, port, SND_SEQ_CLIENT_SYSTEM,
+                                              SND_SEQ_PORT_SYSTEM_ANNOUNCE) < 0)
+        {
+            snd_seq_close (seq);
+            seq = nullptr;
+            return;
+        }
+
+        startThread();
+    }
+
+    ~Native()
+    {
+        stopThread (1000);
+        if (seq != nullptr)
+            snd_seq_close (seq);
+    }
+
+    bool isValid() const noexcept { return seq != nullptr; }
+
+private:
+    MidiDeviceWatcher& owner;
+    snd_seq_t* seq = nullptr;
+    int port = -1;
+
+    void run() override
+    {
+        HeapBlock<pollfd> fds;
+        const int numFds = snd_seq_poll_descriptors_count (seq, POLLIN);
+        fds.calloc ((size_t) numFds);
+        snd_seq_poll_descriptors (seq, fds, (unsigned int) numFds, POLLIN);
+
+        while (! threadShouldExit())
+        {
+            if (poll (fds, (nfds_t) numFds, 200) <= 0)
+                continue;
+
+            bool changed = false;
+            snd_seq_event_t* event = nullptr;
+            while (snd_seq_event_input (seq, &event) >= 0 && event != nullptr)
+            {
+                switch (event->type)
+                {
+                    case SND_SEQ_EVENT_CLIENT_START:
+                    case SND_SEQ_EVENT_CLIENT_EXIT:
+                    case SND_SEQ_EVENT_PORT_START:
+                    case SND_SEQ_EVENT_PORT_EXIT:
+                    case SND_SEQ_EVENT_PORT_CHANGE:
+                        changed = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            if (changed)
+                owner.devicesChanged();
+        }
+    }
+};
+
+#elif JUCE_MAC
+
+/** A CoreMIDI client whose notifications arrive on the main run loop */
+class MidiDeviceWatcher::Native
+{
+public:
+    explicit Native (MidiDeviceWatcher& w)
+        : owner (w)
+    {
+        if (MIDIClientCreate (CFSTR ("Element Hotplug"), notify, this, &client) != noErr)
+            client = 0;
+    }
+
+    ~Native()
+    {
+        if (client != 0)
+            MIDIClientDispose (client);
+    }
+
+    bool isValid() const noexcept { return client != 0; }
+
+private:
+    MidiDeviceWatcher& owner;
+    MIDIClientRef client = 0;
+
+    static void notify (const MIDINotification* message, void* context)
+    {
+        if (message != nullptr && message->messageID == kMIDIMsgSetupChanged)
+            static_cast<Native*> (context)->owner.devicesChanged();
+    }
+};
+
+#elif JUCE_WINDOWS
+
+/** A hidden top level window, which is what WM_DEVICECHANGE is broadcast to */
+class MidiDeviceWatcher::Native
+{
+public:
+    explicit Native (MidiDeviceWatcher& w)
+        : owner (w)
+    {
+        WNDCLASSEXW wc;
+        zerostruct (wc);
+        wc.cbSize        = sizeof (wc);
+        wc.lpfnWndProc   = windowProc;
+        wc.hInstance     = (HINSTANCE) Process::getCurrentModuleInstanceHandle();
+        wc.lpszClassName = className;
+        RegisterClassExW (&wc);
+
+        hwnd = CreateWindowExW (0, className, L"", WS_POPUP, 0, 0, 0, 0,
+                                nullptr, nullptr, wc.hInstance, nullptr);
+        if (hwnd != nullptr)
+            SetWindowLongPtrW (hwnd, GWLP_USERDATA, (LONG_PTR) this);
+    }
+
+    ~Native()
+    {
+        if (hwnd != nullptr)
+            DestroyWindow (hwnd);
+    }
+
+    bool isValid() const noexcept { return hwnd != nullptr; }
+
+private:
+    MidiDeviceWatcher& owner;
+    HWND hwnd = nullptr;
+    static constexpr const wchar_t* className = L"ElementMidiHotplug";
+
+    static LRESULT CALLBACK windowProc (HWND h, UINT message, WPARAM wParam, LPARAM lParam)
+    {
+        if (message == WM_DEVICECHANGE && wParam == DBT_DEVNODES_CHANGED)
+            if (auto* self = (Native*) GetWindowLongPtrW (h, GWLP_USERDATA))
+                self->owner.devicesChanged();
+        return DefWindowProcW (h, message, wParam, lParam);
+    }
+};
+
+#else
+
+class MidiDeviceWatcher::Native
+{
+public:
+    explicit Native (MidiDeviceWatcher&) { }
+    bool isValid() const noexcept { return false; }
+};
+
+#endif
+
+//=============================================================================
+MidiDeviceWatcher::MidiDeviceWatcher()
+{
+    inputs  = MidiInput::getDevices();
+    outputs = MidiOutput::getDevices();
+
+    native.reset (new Native (*this));
+    if (! native->isValid())
+    {
+        native.reset();
+        startTimer (pollMillis);
+    }
+}
+
+MidiDeviceWatcher::~MidiDeviceWatcher()
+{
+    // the native side can still be calling devicesChanged until it's gone
+    native.reset();
+    cancelPendingUpdate();
+    stopTimer();
+}
+
+bool MidiDeviceWatcher::refresh()
+{
+    const auto newInputs  = MidiInput::getDevices();
+    const auto newOutputs = MidiOutput::getDevices();
+    if (newInputs == inputs && newOutputs == outputs)
+        return false;
+
+    inputs  = newInputs;
+    outputs = newOutputs;
+    if (onChange)
+        onChange();
+    return true;
+}
+
+void MidiDeviceWatcher::devicesChanged()
+{
+    triggerAsyncUpdate();
+}
+
+void MidiDeviceWatcher::handleAsyncUpdate()
+{
+    // notifications come in bursts while a device registers its ports
+    startTimer (settleMillis);
+}
+
+void MidiDeviceWatcher::timerCallback()
+{
+    if (native != nullptr)
+        stopTimer();
+    else if (getTimerInterval() != pollMillis)
+        startTimer (pollMillis);
+    refresh();
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Tells the message thread when MIDI devices come and go.
+
+    The OS says when something changed: ALSA's announce port on Linux,
+    CoreMIDI's setup notifications on macOS and WM_DEVICECHANGE on Windows.
+    Only then are the devices listed again, a little later so a controller
+    that's still settling shows up with all its ports. Where none of these
+    are available the lists are compared on a slow timer instead.
+
+    onChange is called on the message thread when either list differs from
+    the last one seen.
+ */
+class MidiDeviceWatcher : private AsyncUpdater,
+                          private Timer
+{
+public:
+    MidiDeviceWatcher();
+    ~MidiDeviceWatcher();
+
+    /** Called on the message thread when devices were added or removed */
+    std::function<void()> onChange;
+
+    /** Returns the input devices last listed */
+    const StringArray& getInputDevices() const noexcept     { return inputs; }
+
+    /** Returns the output devices last listed */
+    const StringArray& getOutputDevices() const noexcept    { return outputs; }
+
+    /** Returns true if the OS tells this about changes, false if it polls */
+    bool isEventDriven() const noexcept                     { return native != nullptr; }
+
+    /** Lists the devices now, calling onChange if they differ. Returns true
+        if something changed */
+    bool refresh();
+
+    /** Asks for a refresh soon. This can be called from any thread */
+    void devicesChanged();
+
+private:
+    StringArray inputs, outputs;
+    class Native;
+    std::unique_ptr<Native> native;
+
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiDeviceWatcher)
+};
+
+}
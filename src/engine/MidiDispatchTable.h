@@ -0,0 +1,146 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Finds the handlers mapped to a MIDI message without asking each of them.
+
+    Handlers are indexed by message type, channel and controller or note
+    number when the table is built, so an incoming message only visits the
+    handlers in its own bucket plus the ones listening on every channel.
+    Building allocates, dispatching doesn't.
+
+    Handler must provide getDispatchKey() returning a Key.
+ */
+template<class Handler>
+class MidiDispatchTable
+{
+public:
+    enum Type
+    {
+        controller = 0,
+        note,           ///< note on and off
+        numTypes
+    };
+
+    struct Key
+    {
+        int type    = -1;   ///< one of Type, or -1 for a handler that takes nothing
+        int channel = 0;    ///< 1 to 16, or 0 for every channel
+        int number  = 0;    ///< controller or note number
+        int pairedNumber = -1; ///< a second number, like the LSB of a 14-bit controller
+    };
+
+    MidiDispatchTable()
+    {
+        starts.calloc ((size_t) numBuckets + 1);
+    }
+
+    /** Indexes the handlers, keeping their order within each bucket */
+    template<class HandlerArray>
+    void build (const HandlerArray& handlers)
+    {
+        zeromem (starts.get(), sizeof (int) * ((size_t) numBuckets + 1));
+        for (auto* const handler : handlers)
+        {
+            const auto key = handler->getDispatchKey();
+            for (const int bucket : { getBucket (key, key.number), getBucket (key, key.pairedNumber) })
+                if (bucket >= 0)
+                    ++starts [bucket + 1];
+        }
+
+        for (int i = 0; i < numBuckets; ++i)
+            starts [i + 1] += starts [i];
+
+        entries.clearQuick();
+        entries.insertMultiple (0, nullptr, starts [numBuckets]);
+
+        HeapBlock<int> next;
+        next.allocate ((size_t) numBuckets, false);
+        memcpy (next.get(), starts.get(), sizeof (int) * (size_t) numBuckets);
+        for (auto* const handler : handlers)
+        {
+            const auto key = handler->getDispatchKey();
+            for (const int bucket : { getBucket (key, key.number), getBucket (key, key.pairedNumber) })
+                if (bucket >= 0)
+                    entries.set (next [bucket]++, handler);
+        }
+    }
+
+    /** Returns the number of entries indexed, handlers with a paired number count twice */
+    int size() const noexcept { return entries.size(); }
+
+    /** Calls the function with every handler keyed for the message: the ones
+        on its channel first, then the ones on every channel */
+    template<class Function>
+    void dispatch (const MidiMessage& message, Function&& function) const
+    {
+        int type = -1, number = 0;
+        if (message.isController())
+        {
+            type = controller;
+            number = message.getControllerNumber();
+        }
+        else if (message.isNoteOnOrOff())
+        {
+            type = note;
+            number = message.getNoteNumber();
+        }
+        else
+        {
+            return;
+        }
+
+        visit (getBucket (type, message.getChannel(), number), function);
+        visit (getBucket (type, 0, number), function);
+    }
+
+private:
+    enum { numChannelSlots = 17, numNumbers = 128, numBuckets = numTypes * numChannelSlots * numNumbers };
+
+    HeapBlock<int> starts;
+    Array<Handler*> entries;
+
+    static int getBucket (int type, int channel, int number) noexcept
+    {
+        return (type * numChannelSlots + channel) * numNumbers + number;
+    }
+
+    static int getBucket (const Key& key, int number) noexcept
+    {
+        if (! isPositiveAndBelow (key.type, (int) numTypes)
+            || ! isPositiveAndBelow (key.channel, (int) numChannelSlots)
+            || ! isPositiveAndBelow (number, (int) numNumbers))
+            return -1;
+        return getBucket (key.type, key.channel, number);
+    }
+
+    template<class Function>
+    void visit (int bucket, Function& function) const
+    {
+        for (int i = starts [bucket]; i < starts [bucket + 1]; ++i)
+            function (*entries.getUnchecked (i));
+    }
+};
+
+}
@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "engine/MidiDeviceWatcher.h"
 #include "engine/MidiEngine.h"
 #include "Settings.h"
 
@@ -42,12 +43,42 @@ void MidiEngine::applySettings (Settings& settings)
                         midiInsFromXml.add (child [Tags::name]);
                 }
             }
+            else if (child.hasType ("output"))
+            {
+                setMidiOutputLatency (child [Tags::name], (double) child.getProperty ("latency", 0.0));
+            }
+        }
+
+        setDefaultMidiOutput (data ["defaultMidiOutput"].toString());
+
+        clearMidiThru();
+        for (int i = 0; i < data.getNumChildren(); ++i)
+        {
+            const auto child (data.getChild (i));
+            if (! child.hasType ("thru"))
+                continue;
+
+            MidiThru route;
+            route.inputName  = child ["input"].toString();
+            route.outputName = child ["output"].toString();
+            route.keyRange   = { (int) child.getProperty ("keyStart", 0), (int) child.getProperty ("keyEnd", 127) };
+            route.transpose  = (int) child ["transpose"];
+            if (child.hasProperty ("channels"))
+            {
+                BigInteger channels;
+                channels.parseString (child ["channels"].toString(), 16);
+                route.channels.setChannels (channels);
+            }
+
+            const auto map = StringArray::fromTokens (child ["channelMap"].toString(), false);
+            for (int ch = 1; ch <= jmin (16, map.size()); ++ch)
+                route.channelMap.set (ch, jlimit (1, 16, map [ch - 1].getIntValue()));
+
+            addMidiThru (route);
         }
 
         for (auto& m : MidiInput::getDevices())
             setMidiInputEnabled (m, midiInsFromXml.contains (m));
-
-        setDefaultMidiOutput (data ["defaultMidiOutput"].toString());
     }
 }
 
@@ -79,6 +110,45 @@ void MidiEngine::writeSettings (Settings& settings)
         }
     }
 
+    // and ones enabled since, which are unplugged right now
+    for (int i = 0; i < disconnectedInputs.size(); ++i)
+    {
+        const auto name = disconnectedInputs.getName(i).toString();
+        if (! (bool) disconnectedInputs.getValueAt (i) || midiInsFromXml.contains (name))
+            continue;
+        ValueTree input ("input");
+        input.setProperty (Tags::name, name, nullptr)
+             .setProperty (Tags::active, true, nullptr);
+        data.appendChild (input, nullptr);
+    }
+
+    for (int i = 0; i < outputLatencies.size(); ++i)
+    {
+        ValueTree output ("output");
+        output.setProperty (Tags::name, outputLatencies.getName(i).toString(), nullptr)
+              .setProperty ("latency", outputLatencies.getValueAt (i), nullptr);
+        data.appendChild (output, nullptr);
+    }
+
+    for (const auto& route : getMidiThruRoutes())
+    {
+        ValueTree thru ("thru");
+        thru.setProperty ("input", route.inputName, nullptr)
+            .setProperty ("output", route.outputName, nullptr)
+            .setProperty ("keyStart", route.keyRange.getStart(), nullptr)
+            .setProperty ("keyEnd", route.keyRange.getEnd(), nullptr)
+            .setProperty ("transpose", route.transpose, nullptr)
+            .setProperty ("channels", route.channels.get().toString (16), nullptr);
+        if (! route.channelMap.isIdentity())
+        {
+            StringArray map;
+            for (int ch = 1; ch <= 16; ++ch)
+                map.add (String (route.channelMap.get (ch)));
+            thru.setProperty ("channelMap", map.joinIntoString (" "), nullptr);
+        }
+        data.appendChild (thru, nullptr);
+    }
+
     data.setProperty ("defaultMidiOutput", defaultMidiOutputName, nullptr);
 
     if (auto xml = std::unique_ptr<XmlElement> (data.createXml()))
@@ -135,6 +205,8 @@ void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source,
         return;
 
     jassert (source == input.get());
+    engine.sendMidiThru (input->getName(), active, message);
+
     const ScopedLock sl (engine.midiCallbackLock);
 
     for (auto& mc : engine.midiCallbacks)
@@ -146,10 +218,14 @@ void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source,
 MidiEngine::MidiEngine()
 {
     callbackHandler.reset (new CallbackHandler (*this));
+    watcher.reset (new MidiDeviceWatcher());
+    watcher->onChange = [this]() { handleDevicesChanged(); };
 }
 
 MidiEngine::~MidiEngine()
 {
+    clearMidiThru();
+    watcher.reset (nullptr);
     callbackHandler.reset (nullptr);
 }
 
@@ -289,15 +365,228 @@ void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, doubl
     }
 }
 
+//==============================================================================
+int MidiEngine::addMidiThru (const MidiThru& settings)
+{
+    std::unique_ptr<ThruRoute> route (new ThruRoute());
+    route->id = ++lastThruId;
+    route->settings = settings;
+    route->table.compile (settings.keyRange, settings.channels, settings.transpose, false);
+    if (settings.outputName.isNotEmpty())
+        route->output = openThruOutput (settings.outputName);
+    route->usesDefaultOutput = route->output == nullptr
+        && (settings.outputName.isEmpty() || settings.outputName == defaultMidiOutputName);
+
+    if (settings.inputName.isNotEmpty())
+        getMidiInput (settings.inputName, true);
+
+    const int routeId = route->id;
+    const ScopedLock sl (thruLock);
+    thruRoutes.add (route.release());
+    numThruRoutes.store (thruRoutes.size());
+    return routeId;
+}
+
+void MidiEngine::removeMidiThru (int routeId)
+{
+    {
+        const ScopedLock sl (thruLock);
+        for (int i = thruRoutes.size(); --i >= 0;)
+            if (thruRoutes.getUnchecked(i)->id == routeId)
+                thruRoutes.remove (i);
+        numThruRoutes.store (thruRoutes.size());
+    }
+
+    closeUnusedThruOutputs();
+}
+
+void MidiEngine::clearMidiThru()
+{
+    {
+        const ScopedLock sl (thruLock);
+        thruRoutes.clear();
+        numThruRoutes.store (0);
+    }
+
+    closeUnusedThruOutputs();
+}
+
+Array<MidiEngine::MidiThru> MidiEngine::getMidiThruRoutes() const
+{
+    Array<MidiThru> routes;
+    const ScopedLock sl (thruLock);
+    for (const auto* route : thruRoutes)
+        routes.add (route->settings);
+    return routes;
+}
+
+void MidiEngine::sendMidiThru (const String& inputName, bool inputActive, const MidiMessage& message)
+{
+    if (numThruRoutes.load() <= 0)
+        return;
+
+    const auto* data = message.getRawData();
+    const int size = message.getRawDataSize();
+    const ScopedLock sl (thruLock);
+
+    for (auto* route : thruRoutes)
+    {
+        const auto& settings = route->settings;
+        if (settings.inputName.isEmpty() ? ! inputActive : settings.inputName != inputName)
+            continue;
+
+        // sysex goes through untouched
+        MidiMessage out (message);
+        if (size <= 3)
+        {
+            uint8 bytes[3] = { data[0], size > 1 ? data[1] : (uint8) 0, size > 2 ? data[2] : (uint8) 0 };
+            if (! route->table.filterMessage (bytes, size))
+                continue;
+            out = MidiMessage (bytes, size, message.getTimeStamp());
+            settings.channelMap.process (out);
+        }
+
+        if (route->output != nullptr)
+        {
+            route->output->sendMessageNow (out);
+        }
+        else if (route->usesDefaultOutput)
+        {
+            const ScopedLock osl (midiOutputLock);
+            if (defaultMidiOutput)
+                defaultMidiOutput->sendMessageNow (out);
+        }
+    }
+}
+
+MidiOutput* MidiEngine::openThruOutput (const String& deviceName)
+{
+    for (auto* output : thruOutputs)
+        if (output->getName() == deviceName)
+            return output;
+
+    const int index = MidiOutput::getDevices().indexOf (deviceName);
+    if (index < 0)
+        return nullptr;
+
+    // some drivers only open a port once, the default output is shared then
+    if (auto output = MidiOutput::openDevice (index))
+    {
+        const ScopedLock sl (thruLock);
+        return thruOutputs.add (output.release());
+    }
+
+    return nullptr;
+}
+
+void MidiEngine::closeUnusedThruOutputs()
+{
+    OwnedArray<MidiOutput> unused;
+    {
+        const ScopedLock sl (thruLock);
+        for (int i = thruOutputs.size(); --i >= 0;)
+        {
+            auto* const output = thruOutputs.getUnchecked (i);
+            bool used = false;
+            for (const auto* route : thruRoutes)
+                used |= route->output == output;
+            if (! used)
+                unused.add (thruOutputs.removeAndReturn (i));
+        }
+    }
+}
+
 int MidiEngine::getNumActiveMidiInputs() const
 {
     int total = 0;
-    for (const auto& dev : MidiInput::getDevices())
+    for (const auto& dev : getMidiInputDevices())
         if (isMidiInputEnabled (dev))
             ++total;
     return total;
 }
 
+//==============================================================================
+const StringArray& MidiEngine::getMidiInputDevices() const noexcept   { return watcher->getInputDevices(); }
+const StringArray& MidiEngine::getMidiOutputDevices() const noexcept  { return watcher->getOutputDevices(); }
+
+void MidiEngine::handleDevicesChanged()
+{
+    const auto& inputs = getMidiInputDevices();
+    bool changed = false;
+
+    // an unplugged port's handle never delivers again, even once it's back
+    for (int i = openMidiInputs.size(); --i >= 0;)
+    {
+        auto* const holder = openMidiInputs.getUnchecked (i);
+        const auto name = holder->input != nullptr ? holder->input->getName() : String();
+        if (inputs.contains (name))
+            continue;
+
+        if (name.isNotEmpty())
+            disconnectedInputs.set (name, holder->active);
+        if (holder->input != nullptr)
+            holder->input->stop();
+        openMidiInputs.remove (i);
+        changed = true;
+    }
+
+    for (int i = disconnectedInputs.size(); --i >= 0;)
+    {
+        const auto name = disconnectedInputs.getName(i).toString();
+        if (! inputs.contains (name))
+            continue;
+
+        const bool wasActive = (bool) disconnectedInputs.getValueAt (i);
+        disconnectedInputs.remove (name);
+        if (auto* holder = getMidiInput (name, true))
+        {
+            holder->active = wasActive || midiInsFromXml.contains (name);
+            changed = true;
+        }
+    }
+
+    // inputs enabled in settings that weren't there at startup
+    for (const auto& name : midiInsFromXml)
+    {
+        if (! inputs.contains (name) || getMidiInput (name, false) != nullptr)
+            continue;
+        if (auto* holder = getMidiInput (name, true))
+        {
+            holder->active = true;
+            changed = true;
+        }
+    }
+
+    // same for the default output, which reopens under its old name
+    const bool outputPresent = defaultMidiOutputName.isNotEmpty()
+        && getMidiOutputDevices().contains (defaultMidiOutputName);
+    if (outputPresent != defaultOutputOpen.load())
+    {
+        const auto name = defaultMidiOutputName;
+        defaultMidiOutputName = String();
+        if (! outputPresent)
+        {
+            std::unique_ptr<MidiOutput> oldOutput;
+            defaultOutputOpen.store (false);
+            {
+                ScopedLock sl (midiOutputLock);
+                defaultMidiOutput.swap (oldOutput);
+            }
+            if (oldOutput)
+                oldOutput->stopBackgroundThread();
+            defaultMidiOutputName = name;
+        }
+        else
+        {
+            setDefaultMidiOutput (name);
+        }
+        changed = true;
+    }
+
+    if (changed)
+        sendChangeMessage();
+}
+
 //==============================================================================
 void MidiEngine::setDefaultMidiOutput (const String& deviceName)
 {
@@ -315,6 +604,7 @@ void MidiEngine::setDefaultMidiOutput (const String& deviceName)
                 ScopedLock sl (midiOutputLock);
                 defaultMidiOutput.swap (newMidiOut);
             }
+            defaultOutputOpen.store (true);
 
             if (newMidiOut) // is now the old output
             {
@@ -324,9 +614,37 @@ void MidiEngine::setDefaultMidiOutput (const String& deviceName)
         }
 
         defaultMidiOutputName = deviceName;
+        defaultOutputLatency.store (getMidiOutputLatency (deviceName));
+
+        {
+            const ScopedLock sl (thruLock);
+            for (auto* route : thruRoutes)
+                if (route->output == nullptr && route->settings.outputName.isNotEmpty())
+                    route->usesDefaultOutput = route->settings.outputName == deviceName;
+        }
 
         sendChangeMessage();
     }
 }
 
+void MidiEngine::setMidiOutputLatency (const String& deviceName, double latencyMs)
+{
+    if (deviceName.isEmpty())
+        return;
+
+    latencyMs = jlimit (0.0, 1000.0, latencyMs);
+    if (latencyMs > 0.0)
+        outputLatencies.set (deviceName, latencyMs);
+    else
+        outputLatencies.remove (deviceName);
+
+    if (deviceName == defaultMidiOutputName)
+        defaultOutputLatency.store (latencyMs);
+}
+
+double MidiEngine::getMidiOutputLatency (const String& deviceName) const
+{
+    return (double) outputLatencies.getWithDefault (deviceName, 0.0);
+}
+
 }
@@ -18,11 +18,14 @@
 */
 
 #include "JuceHeader.h"
+#include "engine/MidiChannelMap.h"
+#include "engine/MidiFilterTable.h"
 
 #pragma once
 
 namespace Element {
 
+class MidiDeviceWatcher;
 class Settings;
 
 class MidiEngine : public ChangeBroadcaster
@@ -87,6 +90,27 @@ public:
 
     /** Returns the number of enabled midi inputs */
     int getNumActiveMidiInputs() const;
+
+    //==============================================================================
+    /** Returns the midi inputs currently connected. This is kept up to date as
+        devices are plugged in and out, so it's cheaper than MidiInput::getDevices()
+     */
+    const StringArray& getMidiInputDevices() const noexcept;
+
+    /** Returns the midi outputs currently connected */
+    const StringArray& getMidiOutputDevices() const noexcept;
+
+    /** Returns true if a midi input is connected */
+    bool isMidiInputAvailable (const String& deviceName) const  { return getMidiInputDevices().contains (deviceName); }
+
+    /** Returns true if a midi output is connected */
+    bool isMidiOutputAvailable (const String& deviceName) const { return getMidiOutputDevices().contains (deviceName); }
+
+    /** Closes inputs and outputs that went away and reopens the ones that came
+        back, keeping whether they were enabled. Called when the device watcher
+        sees a change, and sends a change message if anything did.
+     */
+    void handleDevicesChanged();
     
     //==============================================================================
     /** Sets a midi output device to use as the default.
@@ -114,8 +138,62 @@ public:
     */
     MidiOutput* getDefaultMidiOutput() const noexcept               { return defaultMidiOutput.get(); }
 
+    /** Returns true if the default midi output is open. Safe to call from
+        any thread, unlike getDefaultMidiOutput() without the output lock */
+    bool hasDefaultMidiOutput() const noexcept                      { return defaultOutputOpen.load(); }
+
+    /** Sets how long, in milliseconds, a midi output takes to sound after a
+        message is sent. Messages to it are sent that much earlier.
+        @see getMidiOutputLatency
+     */
+    void setMidiOutputLatency (const String& deviceName, double latencyMs);
+
+    /** Returns the latency set for a midi output, zero by default */
+    double getMidiOutputLatency (const String& deviceName) const;
+
+    /** Returns the latency of the default midi output. Safe to call from any thread */
+    double getDefaultMidiOutputLatency() const noexcept             { return defaultOutputLatency.load(); }
+
     void processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate);
 
+    //==============================================================================
+    /** Settings for a route that sends messages from a midi input straight to
+        a midi output */
+    struct MidiThru
+    {
+        String inputName;               ///< empty forwards every enabled input
+        String outputName;
+        Range<int> keyRange { 0, 127 };
+        kv::MidiChannels channels;      ///< channels let through, omni by default
+        int transpose = 0;
+        MidiChannelMap channelMap;      ///< applied after filtering
+    };
+
+    /** Adds a midi-thru route and returns its id.
+
+        Messages are forwarded on the input's own thread as they arrive, rather
+        than waiting for the next audio callback and going out with a block of
+        messages, so a controller played through to hardware gets no buffer's
+        worth of latency or jitter. Filters are compiled into a table when the
+        route is added. A named input is opened for the route if it isn't open
+        already, and the output is opened for it, sharing the default output
+        when the device can't be opened twice.
+     */
+    int addMidiThru (const MidiThru& route);
+
+    /** Removes a midi-thru route */
+    void removeMidiThru (int routeId);
+
+    /** Removes every midi-thru route */
+    void clearMidiThru();
+
+    /** Returns the settings of every midi-thru route */
+    Array<MidiThru> getMidiThruRoutes() const;
+
+    /** Sends a message through the routes for an input. Called on the input's
+        thread, with inputActive saying if the input is enabled */
+    void sendMidiThru (const String& inputName, bool inputActive, const MidiMessage& message);
+
     CriticalSection& getMidiOutputLock() { return midiOutputLock; }
 
 private:
@@ -147,16 +225,39 @@ private:
     };
 
     StringArray midiInsFromXml;
+    NamedValueSet disconnectedInputs;   // name -> was active
+    std::unique_ptr<MidiDeviceWatcher> watcher;
     OwnedArray<MidiInputHolder> openMidiInputs;
     Array<MidiCallbackInfo> midiCallbacks;
 
     String defaultMidiOutputName;
     std::unique_ptr<MidiOutput> defaultMidiOutput;
+    std::atomic<bool> defaultOutputOpen { false };
+    NamedValueSet outputLatencies;
+    std::atomic<double> defaultOutputLatency { 0.0 };
     CriticalSection audioCallbackLock, midiCallbackLock, midiOutputLock;
 
     class CallbackHandler;
     std::unique_ptr<CallbackHandler> callbackHandler;
 
+    struct ThruRoute
+    {
+        int id = 0;
+        MidiThru settings;
+        MidiFilterTable table;
+        MidiOutput* output = nullptr;   ///< one of thruOutputs, or null
+        bool usesDefaultOutput = false;
+    };
+
+    CriticalSection thruLock;
+    OwnedArray<ThruRoute> thruRoutes;
+    OwnedArray<MidiOutput> thruOutputs;
+    std::atomic<int> numThruRoutes { 0 };
+    int lastThruId = 0;
+
+    MidiOutput* openThruOutput (const String& deviceName);
+    void closeUnusedThruOutputs();
+
     MidiInputHolder* getMidiInput (const String& deviceName, bool openIfNotAlready);
     void handleIncomingMidiMessageInt (MidiInput*, const MidiMessage&);
 };
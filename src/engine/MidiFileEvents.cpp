@@ -0,0 +1,163 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiFileEvents.h"
+
+namespace Element {
+
+/** Files timed in SMPTE frames have no beats, so they're given this tempo */
+static const double smpteTempo = 120.0;
+
+static bool isNoteOff (const uint8* data) noexcept
+{
+    const uint8 kind = data[0] & 0xf0;
+    return kind == 0x80 || (kind == 0x90 && data[2] == 0);
+}
+
+MidiFileEvents::MidiFileEvents (const MidiFile& source, double sampleRate)
+{
+    const short timeFormat = source.getTimeFormat();
+    MidiFile file (source);
+    double beatsPerTick = 1.0;
+    if (timeFormat > 0)
+    {
+        beatsPerTick = 1.0 / (double) timeFormat;
+    }
+    else
+    {
+        file.convertTimestampTicksToSeconds();
+        beatsPerTick = smpteTempo / 60.0;
+    }
+
+    numTracks = file.getNumTracks();
+    for (int t = 0; t < numTracks; ++t)
+    {
+        const auto* track = file.getTrack (t);
+        for (int i = 0; i < track->getNumEvents(); ++i)
+        {
+            const auto& message = track->getEventPointer (i)->message;
+            const double beat = jmax (0.0, message.getTimeStamp() * beatsPerTick);
+            lengthInBeats = jmax (lengthInBeats, beat);
+
+            if (message.isTempoMetaEvent())
+            {
+                if (timeFormat > 0)
+                    tempos.add ({ beat, 60.0 / message.getTempoSecondsPerQuarterNote(), false });
+            }
+            else if (message.isTimeSignatureMetaEvent())
+            {
+                int numerator = 4, denominator = 4;
+                message.getTimeSignatureInfo (numerator, denominator);
+                meters.add ({ beat, numerator, denominator });
+            }
+            else if (message.getRawDataSize() <= 3 && ! message.isMetaEvent() && ! message.isSysEx())
+            {
+                Event event { beat, 0.0, { 0, 0, 0 }, (uint8) message.getRawDataSize() };
+                memcpy (event.data, message.getRawData(), (size_t) event.size);
+                events.add (event);
+            }
+        }
+    }
+
+    if (timeFormat <= 0 || tempos.isEmpty())
+        tempos.insert (0, { 0.0, smpteTempo, false });
+
+    // tracks merge in order, with note offs ahead of anything else on the same
+    // beat so a note ending where another starts doesn't cut the new one
+    struct ByTime
+    {
+        static int compareElements (const Event& a, const Event& b) noexcept
+        {
+            if (a.beat != b.beat)
+                return a.beat < b.beat ? -1 : 1;
+            const bool aOff = isNoteOff (a.data), bOff = isNoteOff (b.data);
+            return aOff == bOff ? 0 : (aOff ? -1 : 1);
+        }
+    } byTime;
+    events.sort (byTime, true);
+
+    resolve (sampleRate);
+}
+
+MidiFileEvents::MidiFileEvents (const MidiFileEvents& other, double sampleRate)
+    : events (other.events),
+      tempos (other.tempos),
+      meters (other.meters),
+      numTracks (other.numTracks),
+      lengthInBeats (other.lengthInBeats)
+{
+    resolve (sampleRate);
+}
+
+MidiFileEvents* MidiFileEvents::read (const File& file, double sampleRate, String& error)
+{
+    FileInputStream input (file);
+    MidiFile midi;
+    if (! input.openedOk())
+    {
+        error = "Could not open " + file.getFileName();
+        return nullptr;
+    }
+
+    if (! midi.readFrom (input))
+    {
+        error = file.getFileName() + " is not a MIDI file";
+        return nullptr;
+    }
+
+    error.clear();
+    return new MidiFileEvents (midi, sampleRate);
+}
+
+void MidiFileEvents::resolve (double sampleRate)
+{
+    tempoTable.reset (new TempoTable (sampleRate, tempos, meters));
+    for (auto& event : events)
+        event.frame = tempoTable->beatToFrame (event.beat);
+}
+
+int MidiFileEvents::seekFrame (double frame) const noexcept
+{
+    int start = 0, end = events.size();
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (events.getReference (middle).frame < frame)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return start;
+}
+
+int MidiFileEvents::seekBeat (double beat) const noexcept
+{
+    int start = 0, end = events.size();
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (events.getReference (middle).beat < beat)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return start;
+}
+
+}
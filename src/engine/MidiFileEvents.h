@@ -0,0 +1,93 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/TempoTable.h"
+
+namespace Element {
+
+/** A standard MIDI file compiled for playback.
+
+    Every track is merged into one flat array of short messages sorted by
+    time, and the file's tempo changes are compiled into a TempoTable so
+    each event's sample is worked out ahead along with its beat. Playing is
+    then a binary search for where to start and a walk forward, by sample at
+    the file's tempo or by beat at any other. Compiles never change once
+    built: another sample rate gets a new one, re-timed from this one's
+    events without reading the file again.
+ */
+class MidiFileEvents : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<MidiFileEvents>;
+
+    struct Event
+    {
+        double beat;
+        double frame;
+        uint8 data [3];
+        uint8 size;
+    };
+
+    /** Merges the tracks of a file and resolves its events at a sample rate */
+    MidiFileEvents (const MidiFile& file, double sampleRate);
+
+    /** Resolves another compile's events at a different sample rate */
+    MidiFileEvents (const MidiFileEvents& other, double sampleRate);
+
+    /** Reads and compiles a file. Returns nullptr with the error set if it
+        isn't a MIDI file */
+    static MidiFileEvents* read (const File& file, double sampleRate, String& error);
+
+    double getSampleRate() const noexcept                   { return tempoTable->getSampleRate(); }
+    int size() const noexcept                               { return events.size(); }
+    const Event& operator[] (int index) const noexcept      { return events.getReference (index); }
+
+    /** Returns the number of tracks the events were merged from */
+    int getNumTracks() const noexcept                       { return numTracks; }
+
+    /** Returns where the last track ends */
+    double getLengthInBeats() const noexcept                { return lengthInBeats; }
+    double getLengthInFrames() const noexcept               { return tempoTable->beatToFrame (lengthInBeats); }
+
+    /** Returns the file's tempo map at this compile's sample rate */
+    const TempoTable& getTempoTable() const noexcept        { return *tempoTable; }
+
+    /** Returns the index of the first event at or after a sample */
+    int seekFrame (double frame) const noexcept;
+
+    /** Returns the index of the first event at or after a beat */
+    int seekBeat (double beat) const noexcept;
+
+private:
+    Array<Event> events;
+    Array<TempoTable::Tempo> tempos;
+    Array<TempoTable::Meter> meters;
+    std::unique_ptr<TempoTable> tempoTable;
+    int numTracks = 0;
+    double lengthInBeats = 0.0;
+
+    void resolve (double sampleRate);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiFileEvents)
+};
+
+}
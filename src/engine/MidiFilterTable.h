@@ -0,0 +1,198 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiBudget.h"
+#include "engine/VelocityCurve.h"
+
+namespace Element {
+
+/** A node's or graph's MIDI filters compiled into lookup tables.
+
+    Key range and transposition fold into one note table, velocity curves
+    into a velocity table and the channel filter into a bit mask, so a buffer
+    is filtered in a single pass without building MidiMessages. Tables are
+    compiled off the audio thread and only read while rendering.
+ */
+class MidiFilterTable
+{
+public:
+    MidiFilterTable() { compile ({ 0, 127 }, {}, 0, false); }
+
+    /** Rebuilds the tables. An empty or full key range passes every note */
+    void compile (Range<int> keyRange, const kv::MidiChannels& channels,
+                  int transposeOffset, bool consumePrograms,
+                  const VelocityCurve* velocityCurve = nullptr)
+    {
+        const bool keyed = keyRange.getLength() > 0
+                        && (keyRange.getStart() > 0 || keyRange.getEnd() < 127);
+        for (int note = 0; note < 128; ++note)
+        {
+            const bool inRange = ! keyed || (note >= keyRange.getStart() && note <= keyRange.getEnd());
+            // wraps like MidiMessage::setNoteNumber
+            noteMap[note] = inRange ? (uint8) ((note + transposeOffset) & 127) : droppedNote;
+        }
+
+        VelocityCurve curve;
+        if (velocityCurve != nullptr)
+            curve = *velocityCurve;
+        bool curved = false;
+        for (int velocity = 0; velocity < 128; ++velocity)
+        {
+            velocityMap[velocity] = curve.process ((uint8) velocity);
+            curved |= velocityMap[velocity] != velocity;
+        }
+
+        channelMask = 0;
+        for (int channel = 1; channel <= 16; ++channel)
+            if (channels.isOmni() || ! channels.isOff (channel))
+                channelMask |= (uint16) (1 << (channel - 1));
+
+        programs    = consumePrograms;
+        dropsEvents = keyed || channelMask != allChannels || programs;
+        active      = dropsEvents || curved || (transposeOffset % 128) != 0;
+    }
+
+    /** True if buffers need to go through the table at all */
+    bool isActive() const noexcept { return active; }
+
+    /** True if the table removes events as well as rewriting them */
+    bool canDropEvents() const noexcept { return dropsEvents; }
+
+    /** Filters a buffer, using the scratch buffer when events have to be
+        removed. Program changes are consumed if the table asks for it, the
+        last one is returned or -1 if there was none */
+    int process (MidiBuffer& midi, MidiBuffer& scratch) const noexcept
+    {
+        if (! active)
+            return -1;
+
+        if (! dropsEvents)
+        {
+            rewrite (midi);
+            return -1;
+        }
+
+        const int program = filter (midi, scratch);
+        midi.swapWith (scratch);
+        scratch.clear();
+        return program;
+    }
+
+    /** Maps notes and velocities in place. Only valid for tables which
+        never drop events */
+    void rewrite (MidiBuffer& midi) const noexcept
+    {
+        jassert (! dropsEvents);
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data; int size, frame;
+        while (iter.getNextEvent (data, size, frame))
+        {
+            // same size in and out, so the buffer's own storage is rewritten
+            auto* bytes = const_cast<uint8*> (data);
+            if (size >= 3 && isNoteOnOrOff (bytes[0]))
+                mapNote (bytes);
+        }
+    }
+
+    /** Writes what passes through the table to another buffer. Returns the
+        last consumed program change or -1 */
+    int filter (const MidiBuffer& source, MidiBuffer& dest) const noexcept
+    {
+        dest.clear();
+        MidiBudget::Writer writer (dest);
+        MidiBuffer::Iterator iter (source);
+        const uint8* data; int size, frame;
+        int program = -1;
+
+        while (iter.getNextEvent (data, size, frame))
+        {
+            const uint8 status = data[0];
+            if (status < 0xf0 && (channelMask & (1 << (status & 0x0f))) == 0)
+                continue;
+
+            if (size >= 3 && isNoteOnOrOff (status))
+            {
+                if (noteMap [data[1] & 127] == droppedNote)
+                    continue;
+                uint8 bytes[3] = { data[0], data[1], data[2] };
+                mapNote (bytes);
+                writer.add (bytes, 3, frame);
+                continue;
+            }
+
+            if (programs && size >= 2 && (status & 0xf0) == 0xc0)
+            {
+                program = data[1] & 127;
+                continue;
+            }
+
+            writer.add (data, size, frame);
+        }
+
+        return program;
+    }
+
+    /** Filters a single message of up to three bytes in place. Returns false
+        if the table drops it, consumed program changes included */
+    bool filterMessage (uint8* bytes, int size) const noexcept
+    {
+        if (! active || size <= 0)
+            return true;
+
+        const uint8 status = bytes[0];
+        if (status < 0xf0 && (channelMask & (1 << (status & 0x0f))) == 0)
+            return false;
+
+        if (size >= 3 && isNoteOnOrOff (status))
+        {
+            if (noteMap [bytes[1] & 127] == droppedNote)
+                return false;
+            mapNote (bytes);
+            return true;
+        }
+
+        return ! (programs && size >= 2 && (status & 0xf0) == 0xc0);
+    }
+
+private:
+    enum : uint8  { droppedNote = 0xff };
+    enum : uint16 { allChannels = 0xffff };
+
+    uint8 noteMap [128];
+    uint8 velocityMap [128];
+    uint16 channelMask = allChannels;
+    bool programs = false, dropsEvents = false, active = false;
+
+    static bool isNoteOnOrOff (uint8 status) noexcept
+    {
+        const uint8 kind = status & 0xf0;
+        return kind == 0x90 || kind == 0x80;
+    }
+
+    void mapNote (uint8* bytes) const noexcept
+    {
+        bytes[1] = noteMap [bytes[1] & 127];
+        if ((bytes[0] & 0xf0) == 0x90)
+            bytes[2] = velocityMap [bytes[2] & 127];
+    }
+};
+
+}
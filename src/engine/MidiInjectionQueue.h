@@ -0,0 +1,199 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiBudget.h"
+
+namespace Element {
+
+/** A multiple producer, single consumer queue for MIDI made inside the app,
+    such as the virtual keyboard, menu actions and scripts.
+
+    Producers claim a slot with one compare and swap and copy the message
+    into it, so they never wait on each other or on the audio thread, and
+    a burst from a script can't hold up device input. Each message carries
+    where it should land: either straight away, placed by when it was
+    posted like device input, or at a sample position on the queue's own
+    clock, which counts the samples drained since it was created. Messages
+    due after the block being drained are held back until their block.
+
+    Messages bigger than maxMessageBytes don't fit a slot and are refused,
+    as is anything posted while every slot is taken.
+ */
+class MidiInjectionQueue
+{
+public:
+    enum
+    {
+        maxMessageBytes = 32,
+        asSoonAsPossible = -1
+    };
+
+    explicit MidiInjectionQueue (int capacity = 1024)
+        : mask (nextPowerOfTwo (jmax (2, capacity)) - 1)
+    {
+        slots.calloc ((size_t) mask + 1);
+        held.calloc ((size_t) mask + 1);
+        for (size_t i = 0; i <= mask; ++i)
+            slots[i].sequence.store (i, std::memory_order_relaxed);
+    }
+
+    /** Queues raw message bytes. The sample time is a position on the
+        queue's clock, see getNextBlockPosition(), or asSoonAsPossible to
+        land by the time it was posted, in seconds on the
+        Time::getMillisecondCounterHiRes() clock. Any thread may post */
+    bool post (const uint8* data, int size, int64 sampleTime, double timestamp) noexcept
+    {
+        if (size <= 0 || size > (int) maxMessageBytes)
+            return false;
+
+        size_t position = writePosition.load (std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        for (;;)
+        {
+            slot = &slots [position & mask];
+            const size_t sequence = slot->sequence.load (std::memory_order_acquire);
+            const auto diff = (intptr_t) sequence - (intptr_t) position;
+
+            if (diff == 0)
+            {
+                // on failure position holds the slot another producer left
+                if (writePosition.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = writePosition.load (std::memory_order_relaxed);
+            }
+        }
+
+        slot->event.sampleTime = sampleTime;
+        slot->event.timestamp = timestamp;
+        slot->event.size = size;
+        memcpy (slot->event.data, data, (size_t) size);
+        slot->sequence.store (position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool post (const MidiMessage& message, int64 sampleTime, double timestamp) noexcept
+    {
+        return post (message.getRawData(), message.getRawDataSize(), sampleTime, timestamp);
+    }
+
+    /** Returns the position on the queue's clock of the next block to be
+        drained. Producers can add to this to schedule ahead */
+    int64 getNextBlockPosition() const noexcept { return blockPosition.load (std::memory_order_acquire); }
+
+    /** Moves everything due in this block into it and advances the clock by
+        the block. Only the audio thread may drain */
+    void drain (MidiBuffer& midi, int numSamples, double sampleRate, double now) noexcept
+    {
+        MidiBudget::Writer writer (midi);
+        const int64 start = blockPosition.load (std::memory_order_relaxed);
+        const int64 end = start + numSamples;
+
+        // held messages came in before anything still in the slots
+        int numKept = 0;
+        for (int i = 0; i < numHeld; ++i)
+        {
+            const auto& event = held[i];
+            if (event.sampleTime < end)
+                writer.add (event.data, event.size, getFrame (event, start, numSamples, sampleRate, now));
+            else
+                held [numKept++] = event;
+        }
+        numHeld = numKept;
+
+        Event event;
+        while (take (event))
+        {
+            if (event.sampleTime >= end && numHeld <= (int) mask)
+                held [numHeld++] = event;
+            else
+                writer.add (event.data, event.size, getFrame (event, start, numSamples, sampleRate, now));
+        }
+
+        blockPosition.store (end, std::memory_order_release);
+    }
+
+    /** Throws away anything queued or held, keeping the clock. Only the
+        audio thread may discard */
+    void discard() noexcept
+    {
+        Event event;
+        while (take (event)) {}
+        numHeld = 0;
+    }
+
+    /** Returns the number of messages waiting for a later block */
+    int getNumHeld() const noexcept { return numHeld; }
+
+private:
+    struct Event
+    {
+        int64 sampleTime;
+        double timestamp;
+        int size;
+        uint8 data [maxMessageBytes];
+    };
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        Event event;
+    };
+
+    const size_t mask;
+    HeapBlock<Slot> slots;
+    HeapBlock<Event> held;
+    int numHeld = 0;
+    std::atomic<size_t> writePosition { 0 };
+    size_t readPosition = 0;
+    std::atomic<int64> blockPosition { 0 };
+
+    bool take (Event& event) noexcept
+    {
+        auto& slot = slots [readPosition & mask];
+        if (slot.sequence.load (std::memory_order_acquire) != readPosition + 1)
+            return false;
+
+        event = slot.event;
+        slot.sequence.store (readPosition + mask + 1, std::memory_order_release);
+        ++readPosition;
+        return true;
+    }
+
+    static int getFrame (const Event& event, int64 start, int numSamples, double sampleRate, double now) noexcept
+    {
+        const int64 frame = event.sampleTime == asSoonAsPossible
+            ? (int64) (numSamples - roundToInt ((now - event.timestamp) * sampleRate))
+            : event.sampleTime - start;
+        return (int) jlimit ((int64) 0, (int64) jmax (0, numSamples - 1), frame);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (MidiInjectionQueue)
+};
+
+}
@@ -0,0 +1,163 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiBudget.h"
+
+namespace Element {
+
+/** A single producer, single consumer queue of timestamped MIDI messages
+    from one input to the audio thread, or from the audio thread to an
+    output.
+
+    Messages are copied into a byte ring when they arrive and pulled out
+    once per block, or one at a time. Neither side locks or allocates
+    while draining; when the ring is full new messages are dropped.
+ */
+class MidiInputQueue
+{
+public:
+    explicit MidiInputQueue (int capacityInBytes = 16384)
+        : fifo (capacityInBytes)
+    {
+        ring.allocate ((size_t) capacityInBytes, true);
+        scratch.allocate ((size_t) capacityInBytes, true);
+    }
+
+    /** Queues a message received at the given time, in seconds on the
+        Time::getMillisecondCounterHiRes() clock. Only one thread may push */
+    bool push (const MidiMessage& message, double timestamp) noexcept
+    {
+        return push (message.getRawData(), message.getRawDataSize(), timestamp);
+    }
+
+    /** Queues raw message bytes, such as an event read from a MidiBuffer */
+    bool push (const uint8* data, int size, double timestamp) noexcept
+    {
+        const int total = (int) sizeof (Header) + size;
+        if (size <= 0 || fifo.getFreeSpace() < total)
+            return false;
+
+        const Header header { timestamp, size };
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (total, start1, size1, start2, size2);
+        copyIn (&header, (int) sizeof (Header), 0, start1, size1, start2);
+        copyIn (data, size, (int) sizeof (Header), start1, size1, start2);
+        fifo.finishedWrite (total);
+        return true;
+    }
+
+    /** Moves everything queued into the block. Messages land as far from
+        the end of the block as they arrived before now, so jitter in the
+        device callbacks turns into a constant block of latency. Messages
+        over the block's MidiBudget are dropped */
+    void drain (MidiBuffer& midi, int numSamples, double sampleRate, double now) noexcept
+    {
+        MidiBudget::Writer writer (midi);
+        Header header;
+        while (peekHeader (header))
+        {
+            const int total = (int) sizeof (Header) + header.size;
+            int start1, size1, start2, size2;
+            fifo.prepareToRead (total, start1, size1, start2, size2);
+            copyOut (scratch, header.size, (int) sizeof (Header), start1, size1, start2);
+            fifo.finishedRead (total);
+
+            const int frame = numSamples - roundToInt ((now - header.timestamp) * sampleRate);
+            writer.add (scratch.get(), header.size, jlimit (0, jmax (0, numSamples - 1), frame));
+        }
+    }
+
+    /** Returns the time of the oldest message without taking it. Only the
+        consumer may call this */
+    bool peekTimestamp (double& timestamp) noexcept
+    {
+        Header header;
+        if (! peekHeader (header))
+            return false;
+        timestamp = header.timestamp;
+        return true;
+    }
+
+    /** Takes the oldest message. Only the consumer may call this, and
+        sysex may allocate */
+    bool pop (MidiMessage& message, double& timestamp)
+    {
+        Header header;
+        if (! peekHeader (header))
+            return false;
+
+        const int total = (int) sizeof (Header) + header.size;
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (total, start1, size1, start2, size2);
+        copyOut (scratch, header.size, (int) sizeof (Header), start1, size1, start2);
+        fifo.finishedRead (total);
+
+        timestamp = header.timestamp;
+        message = MidiMessage (scratch.get(), header.size, timestamp);
+        return true;
+    }
+
+    /** Throws away anything queued. Only the consumer may call this */
+    void discard() noexcept
+    {
+        fifo.finishedRead (fifo.getNumReady());
+    }
+
+private:
+    struct Header
+    {
+        double timestamp;
+        int size;
+    };
+
+    AbstractFifo fifo;
+    HeapBlock<uint8> ring, scratch;
+
+    bool peekHeader (Header& header) noexcept
+    {
+        if (fifo.getNumReady() < (int) sizeof (Header))
+            return false;
+        int start1, size1, start2, size2;
+        fifo.prepareToRead ((int) sizeof (Header), start1, size1, start2, size2);
+        copyOut (&header, (int) sizeof (Header), 0, start1, size1, start2);
+        return true;
+    }
+
+    /** Copies bytes into the record starting at the given offset, which may
+        wrap from the first region into the second */
+    void copyIn (const void* source, int numBytes, int offset, int start1, int size1, int start2) noexcept
+    {
+        auto* src = static_cast<const uint8*> (source);
+        for (int i = 0; i < numBytes; ++i, ++offset)
+            ring [offset < size1 ? start1 + offset : start2 + offset - size1] = src[i];
+    }
+
+    void copyOut (void* dest, int numBytes, int offset, int start1, int size1, int start2) const noexcept
+    {
+        auto* dst = static_cast<uint8*> (dest);
+        for (int i = 0; i < numBytes; ++i, ++offset)
+            dst[i] = ring [offset < size1 ? start1 + offset : start2 + offset - size1];
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (MidiInputQueue)
+};
+
+}
@@ -0,0 +1,262 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiEngine.h"
+#include "engine/MidiOutputScheduler.h"
+#include "engine/RealtimeThreads.h"
+
+namespace Element {
+
+//=============================================================================
+SysExTransfer::SysExTransfer (const Array<MidiMessage>& m, const Options& o)
+    : messages (m), options (o)
+{
+    for (const auto& message : messages)
+        totalBytes += message.getRawDataSize();
+}
+
+SysExTransfer::~SysExTransfer()
+{
+    cancelPendingUpdate();
+}
+
+Array<MidiMessage> SysExTransfer::parse (const void* data, size_t numBytes)
+{
+    Array<MidiMessage> messages;
+    const auto* bytes = static_cast<const uint8*> (data);
+    size_t start = 0;
+    bool inMessage = false;
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        if (bytes[i] == 0xf0)
+        {
+            // a start without an end drops the unfinished message
+            start = i;
+            inMessage = true;
+        }
+        else if (bytes[i] == 0xf7 && inMessage)
+        {
+            messages.add (MidiMessage (bytes + start, (int) (i - start + 1)));
+            inMessage = false;
+        }
+    }
+
+    return messages;
+}
+
+double SysExTransfer::getProgress() const noexcept
+{
+    return totalBytes > 0 ? (double) bytesSent.load() / (double) totalBytes
+                          : (isFinished() ? 1.0 : 0.0);
+}
+
+const MidiMessage* SysExTransfer::takeDueMessage (double nowMs) noexcept
+{
+    if (isDone() || nowMs < nextDueMs)
+        return nullptr;
+
+    const auto& message = messages.getReference (nextMessage++);
+    const int size = message.getRawDataSize();
+    nextDueMs = nowMs + 1000.0 * size / (double) jmax (1, options.bytesPerSecond)
+                      + (double) jmax (0, options.messageGapMs);
+    bytesSent.fetch_add (size);
+    triggerAsyncUpdate();
+    return &message;
+}
+
+void SysExTransfer::finish() noexcept
+{
+    finished.store (true);
+    triggerAsyncUpdate();
+}
+
+void SysExTransfer::handleAsyncUpdate()
+{
+    if (onProgress)
+        onProgress (*this);
+
+    if (finished.load() && ! notifiedComplete)
+    {
+        notifiedComplete = true;
+        if (onComplete)
+            onComplete (*this);
+    }
+}
+
+//=============================================================================
+MidiOutputScheduler::MidiOutputScheduler (MidiEngine& e)
+    : Thread ("Element MIDI Output"), engine (e) { }
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+    stop();
+}
+
+void MidiOutputScheduler::start()
+{
+    if (! isThreadRunning())
+        startThread (10);
+}
+
+void MidiOutputScheduler::stop()
+{
+    stopThread (500);
+    queue.discard();
+    cancelTransfers();
+}
+
+SysExTransfer::Ptr MidiOutputScheduler::sendSysEx (const Array<MidiMessage>& messages,
+                                                   const SysExTransfer::Options& options)
+{
+    Array<MidiMessage> sysex;
+    for (const auto& message : messages)
+        if (message.isSysEx())
+            sysex.add (message);
+
+    SysExTransfer::Ptr transfer = new SysExTransfer (sysex, options);
+    {
+        const ScopedLock sl (transferLock);
+        transfers.add (transfer);
+    }
+
+    start();
+    return transfer;
+}
+
+int MidiOutputScheduler::getNumSysExTransfers() const
+{
+    const ScopedLock sl (transferLock);
+    return transfers.size();
+}
+
+void MidiOutputScheduler::cancelTransfers()
+{
+    ReferenceCountedArray<SysExTransfer> cancelled;
+    {
+        const ScopedLock sl (transferLock);
+        cancelled.swapWith (transfers);
+    }
+
+    for (auto* transfer : cancelled)
+    {
+        transfer->cancel();
+        transfer->finish();
+    }
+}
+
+double MidiOutputScheduler::sendDueSysEx()
+{
+    SysExTransfer::Ptr transfer;
+    {
+        const ScopedLock sl (transferLock);
+        transfer = transfers.getFirst();
+    }
+
+    if (transfer == nullptr)
+        return 10.0;
+
+    if (transfer->isDone())
+    {
+        {
+            const ScopedLock sl (transferLock);
+            transfers.removeObject (transfer.get());
+        }
+
+        transfer->finish();
+        return 0.0;
+    }
+
+    const double now = Time::getMillisecondCounterHiRes();
+    if (now >= transfer->getNextDueMs())
+    {
+        const ScopedLock sl (engine.getMidiOutputLock());
+        if (auto* const output = engine.getDefaultMidiOutput())
+        {
+            if (auto* message = transfer->takeDueMessage (now))
+                output->sendMessageNow (*message);
+        }
+        else
+        {
+            transfer->cancel();
+            return 0.0;
+        }
+    }
+
+    return transfer->isDone() ? 0.0 : transfer->getNextDueMs() - now;
+}
+
+int MidiOutputScheduler::push (const MidiBuffer& midi, double blockTime, double sampleRate) noexcept
+{
+    if (sampleRate <= 0.0)
+        return 0;
+
+    MidiBuffer::Iterator iter (midi);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0, numQueued = 0;
+
+    while (iter.getNextEvent (data, size, frame))
+    {
+        if (queue.push (data, size, blockTime + (double) frame / sampleRate))
+            ++numQueued;
+        else
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    return numQueued;
+}
+
+void MidiOutputScheduler::run()
+{
+    RealtimeThreads::setCurrentThreadRealtime();
+
+    MidiMessage message;
+    double timestamp = 0.0;
+
+    while (! threadShouldExit())
+    {
+        // dumps only go out between the engine's messages
+        const double untilSysExMs = sendDueSysEx();
+
+        if (! queue.peekTimestamp (timestamp))
+        {
+            wait (jlimit (1, 10, (int) untilSysExMs));
+            continue;
+        }
+
+        // messages are queued in time order, so nothing can be due before the oldest
+        const double due = timestamp - engine.getDefaultMidiOutputLatency() * 0.001;
+        const double untilDueMs = (due - Time::getMillisecondCounterHiRes() * 0.001) * 1000.0;
+        if (untilDueMs >= 1.0)
+        {
+            if (untilSysExMs >= 1.0)
+                wait (jmin (10, (int) untilDueMs, (int) untilSysExMs));
+            continue;
+        }
+
+        if (! queue.pop (message, timestamp))
+            continue;
+
+        const ScopedLock sl (engine.getMidiOutputLock());
+        if (auto* const output = engine.getDefaultMidiOutput())
+            output->sendMessageNow (message);
+    }
+}
+
+}
@@ -0,0 +1,174 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+class MidiEngine;
+
+/** A SysEx dump sent to the default MIDI output at a pace the device can take.
+
+    Slow devices drop data sent faster than their MIDI input runs, and many
+    need a pause after each message to store it. A transfer sends one
+    message at a time from the scheduler's thread, waiting afterwards for as
+    long as the message takes at the transfer's rate plus the gap. Each
+    message goes out whole, since outputs can't take one split into pieces
+    on every platform, so dumps are paced by the messages they're made of.
+ */
+class SysExTransfer : public ReferenceCountedObject,
+                      private AsyncUpdater
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<SysExTransfer>;
+
+    struct Options
+    {
+        /** Bytes per second to send at. A MIDI cable carries 3125 */
+        int bytesPerSecond = 3125;
+
+        /** Milliseconds to wait after each message on top of its send time */
+        int messageGapMs = 20;
+    };
+
+    SysExTransfer (const Array<MidiMessage>& messages, const Options& options);
+    ~SysExTransfer();
+
+    /** Splits a stream of bytes into the SysEx messages in it, as found in a
+        .syx file. Anything outside an F0 to F7 message is skipped */
+    static Array<MidiMessage> parse (const void* data, size_t numBytes);
+
+    /** Returns the number of messages in the dump */
+    int getNumMessages() const noexcept { return messages.size(); }
+
+    /** Returns the number of bytes in the dump */
+    int64 getTotalBytes() const noexcept { return totalBytes; }
+
+    /** Returns the number of bytes sent so far */
+    int64 getBytesSent() const noexcept { return bytesSent.load(); }
+
+    /** Returns how much has been sent, from 0 to 1 */
+    double getProgress() const noexcept;
+
+    /** Returns true once the transfer has sent everything or was cancelled */
+    bool isFinished() const noexcept { return finished.load(); }
+
+    /** Returns true if the transfer was cancelled, or there was no output
+        to send to */
+    bool wasCancelled() const noexcept { return cancelled.load(); }
+
+    /** Stops sending. The message being sent, if any, still finishes */
+    void cancel() noexcept { cancelled.store (true); }
+
+    /** Called on the message thread as messages go out */
+    std::function<void (const SysExTransfer&)> onProgress;
+
+    /** Called on the message thread once the transfer has finished */
+    std::function<void (const SysExTransfer&)> onComplete;
+
+    //=========================================================================
+    /** Returns the message due at a time on the Time::getMillisecondCounterHiRes()
+        clock and moves on to the next, or nullptr if none is due. Called by
+        the scheduler's thread */
+    const MidiMessage* takeDueMessage (double nowMs) noexcept;
+
+    /** Returns when the next message is due on the same clock */
+    double getNextDueMs() const noexcept { return nextDueMs; }
+
+    /** Returns true if there's nothing left to send */
+    bool isDone() const noexcept { return cancelled.load() || nextMessage >= messages.size(); }
+
+private:
+    friend class MidiOutputScheduler;
+    const Array<MidiMessage> messages;
+    const Options options;
+    int64 totalBytes = 0;
+    int nextMessage = 0;
+    double nextDueMs = 0.0;
+    std::atomic<int64> bytesSent { 0 };
+    std::atomic<bool> finished { false }, cancelled { false };
+    bool notifiedComplete = false;
+
+    void finish() noexcept;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SysExTransfer)
+};
+
+/** Sends the audio engine's MIDI to the default output from a thread of
+    its own.
+
+    The audio thread turns each block's events into wall clock times and
+    queues them without locking. The scheduler thread runs at realtime
+    priority, sleeps until each message is due, less the output's latency,
+    and sends it straight to the device.
+
+    SysEx dumps are sent from the same thread in the gaps between, so they
+    never go near the audio callback and can't hold the engine's MIDI up for
+    longer than one of their messages takes.
+ */
+class MidiOutputScheduler : private Thread
+{
+public:
+    explicit MidiOutputScheduler (MidiEngine& engine);
+    ~MidiOutputScheduler();
+
+    /** Starts the scheduler thread if it isn't running */
+    void start();
+
+    /** Stops the thread and throws away anything not yet sent */
+    void stop();
+
+    /** Queues a block of messages. The block's first sample is heard at
+        blockTime, in seconds on the Time::getMillisecondCounterHiRes() clock.
+        Called from the audio thread, returns the number of events queued */
+    int push (const MidiBuffer& midi, double blockTime, double sampleRate) noexcept;
+
+    /** Returns the number of messages dropped because the queue was full */
+    int getNumDropped() const noexcept { return numDropped.load (std::memory_order_relaxed); }
+
+    /** Queues a SysEx dump for the default output. Dumps are sent one after
+        another in the order they were queued. Call from the message thread */
+    SysExTransfer::Ptr sendSysEx (const Array<MidiMessage>& messages,
+                                  const SysExTransfer::Options& options = {});
+
+    /** Returns the number of dumps queued or being sent */
+    int getNumSysExTransfers() const;
+
+private:
+    MidiEngine& engine;
+    MidiInputQueue queue { 65536 };
+    std::atomic<int> numDropped { 0 };
+
+    CriticalSection transferLock;
+    ReferenceCountedArray<SysExTransfer> transfers;
+
+    /** Sends the current dump's next message if it's due. Returns how many
+        milliseconds until there's something to do */
+    double sendDueSysEx();
+    void cancelTransfers();
+
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiOutputScheduler)
+};
+
+}
@@ -21,32 +21,50 @@
 
 namespace Element {
 
-MidiPipe::MidiPipe()
-{ 
-    size = 0;
-    memset(referencedBuffers, 0, sizeof(MidiBuffer*) * maxReferencedBuffers);
-}
+MidiPipe::MidiPipe() { }
 
 MidiPipe::MidiPipe (MidiBuffer** buffers, int numBuffers)
-{ 
-    jassert (numBuffers < maxReferencedBuffers);
-    memset (referencedBuffers, 0, sizeof(MidiBuffer*) * maxReferencedBuffers);
-    for (int i = 0; i < numBuffers; ++i)
+{
+    Array<Port> newPorts;
+    newPorts.resize (jmax (0, numBuffers));
+    setPorts (newPorts);
+    for (int i = 0; i < size; ++i)
         referencedBuffers[i] = buffers[i];
-    size = numBuffers;
 }
 
 MidiPipe::MidiPipe (const OwnedArray<MidiBuffer>& buffers, const Array<int>& channels)
 {
-    jassert(channels.size() < maxReferencedBuffers);
-    memset(referencedBuffers, 0, sizeof(MidiBuffer*) * maxReferencedBuffers);
-    for (int i = 0; i < channels.size(); ++i)
-        referencedBuffers[i] = buffers.getUnchecked (channels.getUnchecked (i));
-    size = channels.size();
+    Array<Port> newPorts;
+    for (const auto channel : channels)
+    {
+        Port port;
+        port.bufferIndex = channel;
+        newPorts.add (port);
+    }
+
+    setPorts (newPorts);
+    bind (buffers);
 }
 
 MidiPipe::~MidiPipe() { }
 
+void MidiPipe::setPorts (const Array<Port>& newPorts)
+{
+    ports = newPorts;
+    size = ports.size();
+    referencedBuffers.calloc ((size_t) jmax (1, size));
+}
+
+void MidiPipe::bind (const OwnedArray<MidiBuffer>& buffers) noexcept
+{
+    for (int i = 0; i < size; ++i)
+    {
+        const int index = ports.getReference(i).bufferIndex;
+        jassert (isPositiveAndBelow (index, buffers.size()));
+        referencedBuffers[i] = buffers [index];
+    }
+}
+
 const MidiBuffer* const MidiPipe::getReadBuffer (const int index) const
 {
     jassert (isPositiveAndBelow (index, size));
@@ -59,26 +77,29 @@ MidiBuffer* const MidiPipe::getWriteBuffer (const int index) const
     return referencedBuffers [index];
 }
 
+const MidiPipe::Port& MidiPipe::getPort (const int index) const
+{
+    jassert (isPositiveAndBelow (index, size));
+    return ports.getReference (index);
+}
+
+bool MidiPipe::isOutputUsed (const int index) const noexcept
+{
+    return ! isPositiveAndBelow (index, size) || ports.getReference (index).outputUsed;
+}
+
 void MidiPipe::clear()
 {
-    for (int i = 0; i < maxReferencedBuffers; ++i)
-    {
+    for (int i = 0; i < size; ++i)
         if (auto* rbuffer = referencedBuffers [i])
             rbuffer->clear();
-        else
-            break;
-    }
 }
 
 void MidiPipe::clear (int startSample, int numSamples)
 {
-    for (int i = 0; i < maxReferencedBuffers; ++i)
-    {
+    for (int i = 0; i < size; ++i)
         if (auto* rbuffer = referencedBuffers [i])
             rbuffer->clear (startSample, numSamples);
-        else
-            break;
-    }
 }
 
 void MidiPipe::clear (int channel, int startSample, int numSamples)
@@ -23,27 +23,55 @@
 
 namespace Element {
 
-/** A glorified array of MidiBuffers used in rendering graph nodes */
+/** A glorified array of MidiBuffers used in rendering graph nodes.
+
+    The ports a pipe carries are set up front, when the render ops are built.
+    Binding the pipe to a graph's shared buffers afterwards only copies
+    pointers into storage it already has, so it can be done every block.
+ */
 class MidiPipe
 {
 public:
+    /** What one buffer in the pipe stands for */
+    struct Port
+    {
+        int bufferIndex = -1;   ///< the graph's shared buffer
+        int inputPort   = -1;   ///< node port reading the buffer, -1 for none
+        int outputPort  = -1;   ///< node port writing the buffer, -1 for none
+        bool outputUsed = true; ///< false if nothing is connected to the output port
+    };
+
     MidiPipe();
     MidiPipe (MidiBuffer** buffers, int numBuffers);
     MidiPipe (const OwnedArray<MidiBuffer>& buffers, const Array<int>& channels);
     ~MidiPipe();
 
+    /** Sets the ports this pipe carries. This allocates, call it while
+        building and bind() afterwards */
+    void setPorts (const Array<Port>& newPorts);
+
+    /** Points every port at its shared buffer */
+    void bind (const OwnedArray<MidiBuffer>& buffers) noexcept;
+
     int getNumBuffers() const { return size; }
     const MidiBuffer* const getReadBuffer (const int index) const;
     MidiBuffer* const getWriteBuffer (const int index) const;
 
+    /** Returns the description of a port */
+    const Port& getPort (const int index) const;
+
+    /** Returns false if nothing reads what gets written to a buffer, so a node
+        can skip the output. Pipes without port details use every buffer */
+    bool isOutputUsed (const int index) const noexcept;
+
     void clear();
     void clear (int startSample, int numSamples);
     void clear (int index, int startSample, int numSamples);
 
 private:
-    enum { maxReferencedBuffers = 32 };
     int size = 0;
-    MidiBuffer* referencedBuffers [maxReferencedBuffers];
+    HeapBlock<MidiBuffer*> referencedBuffers;
+    Array<Port> ports;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiPipe);
 };
 
@@ -0,0 +1,354 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiSequencer.h"
+#include "session/ClipModel.h"
+#include "session/TrackModel.h"
+
+namespace Element {
+
+static const Identifier notesType ("notes");
+static const Identifier muteProperty ("mute");
+static const Identifier offsetProperty ("offset");
+
+static bool isMidiClip (const ValueTree& tree)
+{
+    return tree.hasType (Slugs::clip) && tree.getProperty (Slugs::type).toString() == "midi";
+}
+
+MidiSequencer::MidiSequencer() { }
+
+MidiSequencer::~MidiSequencer()
+{
+    cancelPendingUpdate();
+    sequence.removeListener (this);
+
+    // rendering has to have stopped by now
+    jassert (compiledInUse.load() == nullptr || compiledInUse.load() == compiled.load());
+    std::unique_ptr<Compiled> last (compiled.exchange (nullptr));
+    retired.clear();
+}
+
+void MidiSequencer::setSequence (const ValueTree& newSequence)
+{
+    sequence.removeListener (this);
+    sequence = newSequence;
+    sequence.addListener (this);
+    cancelPendingUpdate();
+    publish();
+}
+
+void MidiSequencer::update()
+{
+    for (auto* events : clipEvents)
+        events->update();
+
+    if (isUpdatePending())
+    {
+        cancelPendingUpdate();
+        publish();
+    }
+}
+
+int MidiSequencer::getNumTracks() const noexcept
+{
+    auto* const current = compiled.load();
+    return current != nullptr ? current->tracks.size() : 0;
+}
+
+void MidiSequencer::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    wasPlaying = false;
+}
+
+void MidiSequencer::release()
+{
+    playing = nullptr;
+    wasPlaying = false;
+    compiledInUse.store (nullptr);
+}
+
+//=============================================================================
+void MidiSequencer::render (MidiBudget::Writer& midi, const AudioPlayHead::CurrentPositionInfo& position,
+                            int numSamples) noexcept
+{
+    // the compiled sequence being played stays advertised between blocks, so
+    // its notes can still be released once it has been replaced
+    bool replaced = false;
+    auto* current = compiled.load();
+    if (current != playing)
+    {
+        if (wasPlaying)
+            releaseAll (midi, playing, 0);
+
+        compiledInUse.store (current);
+        for (auto* latest = compiled.load(); latest != current; latest = compiled.load())
+        {
+            current = latest;
+            compiledInUse.store (current);
+        }
+
+        playing = current;
+        replaced = true;
+    }
+
+    if (! position.isPlaying || position.bpm <= 0.0 || playing == nullptr)
+    {
+        if (wasPlaying && ! replaced)
+            releaseAll (midi, playing, 0);
+        wasPlaying = false;
+        return;
+    }
+
+    const double samplesPerBeat = sampleRate * 60.0 / position.bpm;
+    const Range<double> beats (position.ppqPosition, position.ppqPosition + numSamples / samplesPerBeat);
+
+    // anything further than a sample from where the last block ended is a jump
+    const bool jumped = std::abs (beats.getStart() - nextBeat) * samplesPerBeat >= 1.0;
+    if (wasPlaying && jumped && ! replaced)
+        releaseAll (midi, playing, 0);
+
+    const bool located = replaced || jumped || ! wasPlaying;
+    for (auto* track : playing->tracks)
+    {
+        auto& clips = track->clips;
+        if (located)
+            seek (*track, beats.getStart());
+        else
+            while (track->cursor < clips.size() && clips.getReference (track->cursor).end <= beats.getStart())
+                ++track->cursor;
+
+        for (int i = track->cursor; i < clips.size(); ++i)
+        {
+            const auto& clip = clips.getReference (i);
+            if (clip.start >= beats.getEnd())
+                break;
+            if (clip.end > beats.getStart())
+                renderClip (midi, *track, clip, beats, samplesPerBeat, numSamples);
+        }
+    }
+
+    nextBeat = beats.getEnd();
+    wasPlaying = true;
+}
+
+void MidiSequencer::seek (Track& track, double beat) noexcept
+{
+    const auto& clips = track.clips;
+    int start = 0, end = clips.size();
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (clips.getReference (middle).start <= beat)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+
+    // back up over clips which started earlier and are still playing
+    while (start > 0 && clips.getReference (start - 1).end > beat)
+        --start;
+    track.cursor = start;
+}
+
+void MidiSequencer::renderClip (MidiBudget::Writer& midi, Track& track, const Clip& clip,
+                                Range<double> beats, double samplesPerBeat, int numSamples) noexcept
+{
+    const Range<double> played (jmax (beats.getStart(), clip.start), jmin (beats.getEnd(), clip.end));
+    const double shift = clip.offset - clip.start;
+    auto frameOf = [&] (double beat) {
+        return jlimit (0, numSamples - 1, (int) ((beat - beats.getStart()) * samplesPerBeat));
+    };
+
+    const MidiClipEvents::Reader events (*clip.events);
+    for (int i = events.seek (played.getStart() + shift); i < events.size(); ++i)
+    {
+        const auto& event = events[i];
+        const double beat = event.beat - shift;
+        if (beat >= played.getEnd())
+            break;
+
+        const uint8 status = event.data[0];
+        if ((status & 0xf0) == 0x90 && event.data[2] > 0)
+        {
+            if (track.numSounding == Track::maxSounding)
+                continue;
+            track.sounding[track.numSounding][0] = status & 0x0f;
+            track.sounding[track.numSounding][1] = event.data[1];
+            ++track.numSounding;
+        }
+        else
+        {
+            // offs for notes which didn't start in this clip are dropped
+            int index = track.numSounding;
+            while (--index >= 0)
+                if (track.sounding[index][0] == (status & 0x0f) && track.sounding[index][1] == event.data[1])
+                    break;
+            if (index < 0)
+                continue;
+            --track.numSounding;
+            track.sounding[index][0] = track.sounding[track.numSounding][0];
+            track.sounding[index][1] = track.sounding[track.numSounding][1];
+        }
+
+        midi.add (event.data, 3, frameOf (beat));
+    }
+
+    if (clip.end <= beats.getEnd())
+        releaseNotes (midi, track, frameOf (clip.end));
+}
+
+void MidiSequencer::releaseNotes (MidiBudget::Writer& midi, Track& track, int frame) noexcept
+{
+    for (int i = 0; i < track.numSounding; ++i)
+    {
+        const uint8 data[3] = { (uint8) (0x80 | track.sounding[i][0]), track.sounding[i][1], 0 };
+        midi.add (data, 3, frame);
+    }
+    track.numSounding = 0;
+}
+
+void MidiSequencer::releaseAll (MidiBudget::Writer& midi, Compiled* sequenceToRelease, int frame) noexcept
+{
+    if (sequenceToRelease != nullptr)
+        for (auto* track : sequenceToRelease->tracks)
+            releaseNotes (midi, *track, frame);
+}
+
+//=============================================================================
+MidiClipEvents* MidiSequencer::getEventsFor (const ValueTree& clip)
+{
+    for (int i = clipTrees.size(); --i >= 0;)
+        if (clipTrees.getReference (i) == clip)
+            return clipEvents.getUnchecked (i);
+
+    const ValueTree notes (clip.getChildWithName (notesType));
+    if (! notes.isValid())
+        return nullptr;
+
+    clipTrees.add (clip);
+    return clipEvents.add (new MidiClipEvents (NoteSequence (notes)));
+}
+
+void MidiSequencer::publish()
+{
+    std::unique_ptr<Compiled> next (new Compiled());
+    Array<MidiClipEvents*> used;
+
+    for (int i = 0; i < sequence.getNumChildren(); ++i)
+    {
+        const ValueTree trackTree (sequence.getChild (i));
+        if (! TrackModel (trackTree).isValid() || (bool) trackTree.getProperty (muteProperty, false))
+            continue;
+
+        std::unique_ptr<Track> track (new Track());
+        for (int j = 0; j < trackTree.getNumChildren(); ++j)
+        {
+            const ValueTree clipTree (trackTree.getChild (j));
+            const ClipModel model (clipTree);
+            if (! isMidiClip (clipTree) || model.length() <= 0.0)
+                continue;
+
+            if (auto* events = getEventsFor (clipTree))
+            {
+                track->clips.add ({ model.start(), model.end(), model.offset(), events });
+                used.add (events);
+            }
+        }
+
+        if (track->clips.isEmpty())
+            continue;
+
+        struct ByStart
+        {
+            static int compareElements (const Clip& a, const Clip& b) noexcept
+            {
+                return a.start < b.start ? -1 : (b.start < a.start ? 1 : 0);
+            }
+        } byStart;
+        track->clips.sort (byStart, true);
+        next->tracks.add (track.release());
+    }
+
+    // clips no longer played are freed with the last sequence that played them
+    for (int i = clipEvents.size(); --i >= 0;)
+    {
+        if (used.contains (clipEvents.getUnchecked (i)))
+            continue;
+        clipTrees.remove (i);
+        retiredClipEvents.add (clipEvents.removeAndReturn (i));
+    }
+
+    if (auto* const previous = compiled.exchange (next.release()))
+        retired.add (previous);
+    reclaimRetired();
+}
+
+void MidiSequencer::reclaimRetired()
+{
+    for (int i = retired.size(); --i >= 0;)
+        if (compiledInUse.load() != retired.getUnchecked (i))
+            retired.remove (i);
+
+    if (retired.isEmpty())
+        retiredClipEvents.clear();
+}
+
+void MidiSequencer::handleAsyncUpdate()
+{
+    publish();
+}
+
+//=============================================================================
+void MidiSequencer::valueTreePropertyChanged (ValueTree& tree, const Identifier& property)
+{
+    const bool trackChanged = tree.getParent() == sequence && property == muteProperty;
+    const bool clipChanged  = tree.hasType (Slugs::clip) && tree.getParent().getParent() == sequence
+        && (property == Slugs::start || property == Slugs::length || property == offsetProperty
+            || property == Slugs::type);
+    if (trackChanged || clipChanged)
+        triggerAsyncUpdate();
+}
+
+void MidiSequencer::valueTreeChildAdded (ValueTree& parent, ValueTree& child)
+{
+    // note edits are followed by each clip's events
+    if (parent == sequence || parent.getParent() == sequence || child.hasType (notesType))
+        triggerAsyncUpdate();
+}
+
+void MidiSequencer::valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int)
+{
+    if (parent == sequence || parent.getParent() == sequence || child.hasType (notesType))
+        triggerAsyncUpdate();
+}
+
+void MidiSequencer::valueTreeChildOrderChanged (ValueTree& parent, int, int)
+{
+    if (parent == sequence || parent.getParent() == sequence)
+        triggerAsyncUpdate();
+}
+
+void MidiSequencer::valueTreeRedirected (ValueTree&)
+{
+    triggerAsyncUpdate();
+}
+
+}
@@ -0,0 +1,132 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiClipEvents.h"
+
+namespace Element {
+
+/** Plays tracks of MIDI clips in time with a play head.
+
+    The sequence is a tree of tracks holding clips, each clip a start, length
+    and offset in beats with a note sequence. The message thread compiles it
+    into a flat list of tracks with their clips sorted by start, which is
+    swapped to the audio thread the same way a clip's events are. Each track
+    keeps a cursor on its current clip: it moves forward as blocks play and
+    is found again by binary search when the play head jumps. Events are
+    written at the frame they fall on within the block, and notes still
+    sounding when a clip ends, playback stops or the play head jumps are
+    released.
+
+    Stopped sequencers return straight away, and tracks which have no clips
+    left to play cost only a comparison, so idle tracks are free.
+
+    One thread at a time may render.
+ */
+class MidiSequencer : private ValueTree::Listener,
+                      private AsyncUpdater
+{
+public:
+    MidiSequencer();
+    ~MidiSequencer();
+
+    /** Sets the tree of tracks to play and follows its edits */
+    void setSequence (const ValueTree& sequence);
+
+    /** Returns the tree being played */
+    ValueTree getSequence() const { return sequence; }
+
+    /** Publishes pending edits now instead of on the next message loop.
+        Call from the message thread */
+    void update();
+
+    /** Returns the number of tracks with clips to play */
+    int getNumTracks() const noexcept;
+
+    /** Sets the rate blocks are rendered at. Call before rendering */
+    void prepare (double sampleRate);
+
+    /** Call once rendering has stopped so the last compiled sequence can be
+        freed */
+    void release();
+
+    /** Adds the events of a block starting at the position to a buffer.
+        Realtime safe */
+    void render (MidiBudget::Writer& midi, const AudioPlayHead::CurrentPositionInfo& position,
+                 int numSamples) noexcept;
+
+private:
+    struct Clip
+    {
+        double start, end, offset;
+        MidiClipEvents* events;
+    };
+
+    struct Track
+    {
+        enum { maxSounding = 64 };
+        Array<Clip> clips;
+        int cursor = 0;
+        int numSounding = 0;
+        uint8 sounding [maxSounding][2];
+    };
+
+    struct Compiled
+    {
+        OwnedArray<Track> tracks;
+    };
+
+    ValueTree sequence;
+    Array<ValueTree> clipTrees;
+    OwnedArray<MidiClipEvents> clipEvents;
+    OwnedArray<MidiClipEvents> retiredClipEvents;
+
+    std::atomic<Compiled*> compiled { nullptr };
+    std::atomic<Compiled*> compiledInUse { nullptr };
+    OwnedArray<Compiled> retired;
+
+    // audio thread
+    Compiled* playing = nullptr;
+    double sampleRate = 44100.0;
+    double nextBeat = 0.0;
+    bool wasPlaying = false;
+
+    MidiClipEvents* getEventsFor (const ValueTree& clip);
+    void publish();
+    void reclaimRetired();
+
+    static void seek (Track&, double beat) noexcept;
+    static void renderClip (MidiBudget::Writer&, Track&, const Clip&, Range<double> beats,
+                            double samplesPerBeat, int numSamples) noexcept;
+    static void releaseNotes (MidiBudget::Writer&, Track&, int frame) noexcept;
+    void releaseAll (MidiBudget::Writer&, Compiled*, int frame) noexcept;
+
+    void handleAsyncUpdate() override;
+    void valueTreePropertyChanged (ValueTree&, const Identifier&) override;
+    void valueTreeChildAdded (ValueTree&, ValueTree&) override;
+    void valueTreeChildRemoved (ValueTree&, ValueTree&, int) override;
+    void valueTreeChildOrderChanged (ValueTree&, int, int) override;
+    void valueTreeParentChanged (ValueTree&) override { }
+    void valueTreeRedirected (ValueTree&) override;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiSequencer)
+};
+
+}
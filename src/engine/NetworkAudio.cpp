@@ -0,0 +1,578 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <chrono>
+#include "engine/NetworkAudio.h"
+
+namespace Element {
+
+/** The header extension's profile, 'EL', and its length in 32 bit words */
+static const uint16 extensionProfile = 0x454c;
+static const uint16 extensionWords   = 4;
+
+/** Seconds from the NTP epoch, 1900, to the Unix one */
+static const uint64 ntpEpochOffset = 2208988800ull;
+
+/** A stream is considered gone after this long without a packet */
+static const double streamTimeout = 0.5;
+
+static inline void put16 (uint8* p, uint16 v) noexcept  { p[0] = (uint8) (v >> 8); p[1] = (uint8) v; }
+static inline void put32 (uint8* p, uint32 v) noexcept  { put16 (p, (uint16) (v >> 16)); put16 (p + 2, (uint16) v); }
+static inline void put64 (uint8* p, uint64 v) noexcept  { put32 (p, (uint32) (v >> 32)); put32 (p + 4, (uint32) v); }
+static inline uint16 get16 (const uint8* p) noexcept    { return (uint16) ((p[0] << 8) | p[1]); }
+static inline uint32 get32 (const uint8* p) noexcept    { return ((uint32) get16 (p) << 16) | get16 (p + 2); }
+static inline uint64 get64 (const uint8* p) noexcept    { return ((uint64) get32 (p) << 32) | get32 (p + 4); }
+
+/** Samples go on the wire little endian, which needs no conversion at all
+    nearly everywhere */
+static inline void toWire (float* dest, const float* src, int numSamples) noexcept
+{
+   #if JUCE_BIG_ENDIAN
+    auto* const d = reinterpret_cast<uint32*> (dest);
+    auto* const s = reinterpret_cast<const uint32*> (src);
+    for (int i = 0; i < numSamples; ++i)
+        d[i] = ByteOrder::swap (s[i]);
+   #else
+    memcpy (dest, src, (size_t) numSamples * sizeof (float));
+   #endif
+}
+
+static inline void fromWire (float* samples, int numSamples) noexcept
+{
+   #if JUCE_BIG_ENDIAN
+    auto* const s = reinterpret_cast<uint32*> (samples);
+    for (int i = 0; i < numSamples; ++i)
+        s[i] = ByteOrder::swap (s[i]);
+   #else
+    ignoreUnused (samples, numSamples);
+   #endif
+}
+
+//=============================================================================
+int NetworkAudioPacket::getMaxFrames (int numChannels) noexcept
+{
+    const int bytesPerFrame = jmax (1, numChannels) * (int) sizeof (float);
+    return jlimit (1, (int) maxFrames, (maxSize - headerSize) / bytesPerFrame);
+}
+
+void NetworkAudioPacket::writeHeader (uint8* p, const Header& header) noexcept
+{
+    p[0] = 0x80 | 0x10; // version 2 with an extension
+    p[1] = (uint8) payloadType;
+    put16 (p + 2, header.sequence);
+    put32 (p + 4, header.timestamp);
+    put32 (p + 8, header.ssrc);
+    put16 (p + 12, extensionProfile);
+    put16 (p + 14, extensionWords);
+    put16 (p + 16, (uint16) header.numChannels);
+    put16 (p + 18, (uint16) header.numFrames);
+    put32 (p + 20, header.sampleRate);
+    put64 (p + 24, header.wallClock);
+}
+
+bool NetworkAudioPacket::readHeader (const uint8* p, int size, Header& header) noexcept
+{
+    if (size < headerSize || (p[0] & 0xd0) != 0x90 || (p[1] & 0x7f) != payloadType
+        || get16 (p + 12) != extensionProfile || get16 (p + 14) != extensionWords)
+        return false;
+
+    header.sequence     = get16 (p + 2);
+    header.timestamp    = get32 (p + 4);
+    header.ssrc         = get32 (p + 8);
+    header.numChannels  = (int) get16 (p + 16);
+    header.numFrames    = (int) get16 (p + 18);
+    header.sampleRate   = get32 (p + 20);
+    header.wallClock    = get64 (p + 24);
+
+    return header.numChannels > 0 && header.numChannels <= maxChannels
+        && header.numFrames > 0 && header.numFrames <= maxFrames
+        && header.sampleRate > 0
+        && size >= getSize (header.numChannels, header.numFrames);
+}
+
+uint64 NetworkAudioPacket::getWallClock() noexcept
+{
+    using namespace std::chrono;
+    const auto micros = (uint64) duration_cast<microseconds> (system_clock::now().time_since_epoch()).count();
+    const uint64 seconds = micros / 1000000 + ntpEpochOffset;
+    const uint64 fraction = ((micros % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+double NetworkAudioPacket::getMillisecondsBetween (uint64 earlier, uint64 later) noexcept
+{
+    return (double) (int64) (later - earlier) / 4294967296.0 * 1000.0;
+}
+
+//=============================================================================
+NetworkAudioSender::NetworkAudioSender()
+    : Thread ("el.networkSend")
+{ }
+
+NetworkAudioSender::~NetworkAudioSender()
+{
+    release();
+}
+
+void NetworkAudioSender::setDestination (const String& newHost, int newPort)
+{
+    const ScopedLock sl (destinationLock);
+    host = newHost.trim();
+    port = jlimit (1, 65535, newPort);
+}
+
+String NetworkAudioSender::getHost() const
+{
+    const ScopedLock sl (destinationLock);
+    return host;
+}
+
+int NetworkAudioSender::getPort() const
+{
+    const ScopedLock sl (destinationLock);
+    return port;
+}
+
+void NetworkAudioSender::prepare (int channels, double rate, int frames)
+{
+    release();
+    numChannels = jlimit (1, (int) NetworkAudioPacket::maxChannels, channels);
+    framesPerPacket = jlimit (1, NetworkAudioPacket::getMaxFrames (numChannels), frames);
+    packetSize = NetworkAudioPacket::getSize (numChannels, framesPerPacket);
+    sampleRate = (uint32) roundToInt (rate);
+    ssrc = (uint32) Random::getSystemRandom().nextInt();
+
+    slots.calloc ((size_t) numSlots * (size_t) NetworkAudioPacket::maxSize);
+    fifo.reset();
+    current = nullptr;
+    dropping = false;
+    sequence = 0;
+    timestamp = 0;
+    framesInPacket = 0;
+    startThread (8);
+}
+
+void NetworkAudioSender::release()
+{
+    stopThread (1000);
+    slots.free();
+    numChannels = framesPerPacket = packetSize = 0;
+}
+
+void NetworkAudioSender::push (const float* const* channels, int numInputChannels, int numFrames) noexcept
+{
+    if (slots == nullptr)
+        return;
+
+    for (int done = 0; done < numFrames;)
+    {
+        if (framesInPacket == 0)
+        {
+            // claim the next slot, or drop the whole packet if the ring is full
+            int start1, size1, start2, size2;
+            fifo.prepareToWrite (1, start1, size1, start2, size2);
+            dropping = size1 + size2 == 0;
+            current = dropping ? nullptr : getSlot (size1 > 0 ? start1 : start2);
+
+            if (current != nullptr)
+            {
+                NetworkAudioPacket::Header header;
+                header.sequence = sequence;
+                header.timestamp = timestamp;
+                header.ssrc = ssrc;
+                header.numChannels = numChannels;
+                header.numFrames = framesPerPacket;
+                header.sampleRate = sampleRate;
+                header.wallClock = stamping.load (std::memory_order_relaxed) ? NetworkAudioPacket::getWallClock() : 0;
+                NetworkAudioPacket::writeHeader (current, header);
+            }
+        }
+
+        const int numToCopy = jmin (numFrames - done, framesPerPacket - framesInPacket);
+        if (current != nullptr)
+        {
+            auto* const payload = reinterpret_cast<float*> (current + NetworkAudioPacket::headerSize);
+            for (int c = 0; c < numChannels; ++c)
+            {
+                float* const dest = payload + c * framesPerPacket + framesInPacket;
+                if (c < numInputChannels && channels[c] != nullptr)
+                    toWire (dest, channels[c] + done, numToCopy);
+                else
+                    FloatVectorOperations::clear (dest, numToCopy);
+            }
+        }
+
+        framesInPacket += numToCopy;
+        done += numToCopy;
+
+        if (framesInPacket == framesPerPacket)
+        {
+            if (dropping)
+            {
+                overruns.fetch_add (1, std::memory_order_relaxed);
+            }
+            else
+            {
+                fifo.finishedWrite (1);
+                notify();
+            }
+
+            current = nullptr;
+            framesInPacket = 0;
+            timestamp += (uint32) framesPerPacket;
+            ++sequence;
+        }
+    }
+}
+
+NetworkAudioSender::Stats NetworkAudioSender::getStats() const noexcept
+{
+    Stats stats;
+    stats.packetsSent = packetsSent.load (std::memory_order_relaxed);
+    stats.overruns = overruns.load (std::memory_order_relaxed);
+    stats.sendErrors = sendErrors.load (std::memory_order_relaxed);
+    return stats;
+}
+
+void NetworkAudioSender::run()
+{
+    DatagramSocket socket;
+
+    while (! threadShouldExit())
+    {
+        wait (50);
+
+        String destination;
+        int destinationPort = 0;
+        {
+            const ScopedLock sl (destinationLock);
+            destination = host;
+            destinationPort = port;
+        }
+
+        while (fifo.getNumReady() > 0 && ! threadShouldExit())
+        {
+            int start1, size1, start2, size2;
+            fifo.prepareToRead (1, start1, size1, start2, size2);
+            const auto* packet = getSlot (size1 > 0 ? start1 : start2);
+
+            if (destination.isNotEmpty()
+                && socket.write (destination, destinationPort, packet, packetSize) == packetSize)
+                packetsSent.fetch_add (1, std::memory_order_relaxed);
+            else
+                sendErrors.fetch_add (1, std::memory_order_relaxed);
+
+            fifo.finishedRead (1);
+        }
+    }
+}
+
+//=============================================================================
+NetworkAudioReceiver::NetworkAudioReceiver()
+    : Thread ("el.networkReceive")
+{ }
+
+NetworkAudioReceiver::~NetworkAudioReceiver()
+{
+    release();
+}
+
+void NetworkAudioReceiver::setPort (int newPort)
+{
+    newPort = jlimit (1, 65535, newPort);
+    if (port.exchange (newPort) != newPort)
+        portChanged.store (true);
+}
+
+void NetworkAudioReceiver::prepare (int channels, double rate, int blockSize)
+{
+    release();
+    numChannels = jlimit (1, (int) NetworkAudioPacket::maxChannels, channels);
+    sampleRate = rate;
+
+    // the latency covers a packet and the network's jitter on top of the
+    // render blocks the resampler allows for anyway
+    const int latencyFrames = jmax (1, roundToInt (latencyMs * 0.001 * sampleRate));
+    resampler.prepare (numChannels, sampleRate, sampleRate, latencyFrames, blockSize);
+
+    held.calloc ((size_t) reorderSlots * (size_t) NetworkAudioPacket::maxSize);
+    for (auto& valid : heldValid)
+        valid = false;
+    silence.calloc ((size_t) NetworkAudioPacket::maxFrames);
+    channelPointers.calloc ((size_t) NetworkAudioPacket::maxChannels);
+    streaming = false;
+    holdingSince = 0.0;
+    holdSeconds = jmax (0.002, latencyMs * 0.0005);
+
+    packetsReceived.store (0);
+    lost.store (0); late.store (0); reordered.store (0); rejected.store (0);
+    networkMs.store (-1.0);
+    packetMs.store (0.0);
+    lastPacketTime.store (0.0);
+    portChanged.store (false);
+    startThread (8);
+}
+
+void NetworkAudioReceiver::release()
+{
+    stopThread (1000);
+    resampler.release();
+    held.free();
+    silence.free();
+    channelPointers.free();
+    numChannels = 0;
+}
+
+void NetworkAudioReceiver::pull (float* const* channels, int numOutputChannels, int numFrames) noexcept
+{
+    if (! resampler.isPrepared())
+    {
+        for (int c = 0; c < numOutputChannels; ++c)
+            FloatVectorOperations::clear (channels[c], numFrames);
+        return;
+    }
+
+    resampler.pull (channels, numOutputChannels, numFrames, Time::getMillisecondCounterHiRes() * 0.001);
+}
+
+NetworkAudioReceiver::Stats NetworkAudioReceiver::getStats() const noexcept
+{
+    Stats stats;
+    stats.packetsReceived = packetsReceived.load (std::memory_order_relaxed);
+    stats.lost = lost.load (std::memory_order_relaxed);
+    stats.late = late.load (std::memory_order_relaxed);
+    stats.reordered = reordered.load (std::memory_order_relaxed);
+    stats.rejected = rejected.load (std::memory_order_relaxed);
+
+    const auto resampling = resampler.getStats();
+    stats.underruns = resampling.underruns;
+    stats.driftPpm = resampling.driftPpm;
+    stats.networkMs = networkMs.load (std::memory_order_relaxed);
+    stats.packetMs = packetMs.load (std::memory_order_relaxed);
+    stats.bufferMs = sampleRate > 0.0 ? resampling.fill / sampleRate * 1000.0 : 0.0;
+    stats.totalMs = stats.packetMs + jmax (0.0, stats.networkMs) + stats.bufferMs;
+
+    const auto now = Time::getMillisecondCounterHiRes() * 0.001;
+    stats.isReceiving = now - lastPacketTime.load (std::memory_order_relaxed) < streamTimeout;
+    return stats;
+}
+
+void NetworkAudioReceiver::run()
+{
+    std::unique_ptr<DatagramSocket> socket;
+    HeapBlock<uint8> buffer ((size_t) NetworkAudioPacket::maxSize);
+
+    while (! threadShouldExit())
+    {
+        if (socket == nullptr || portChanged.exchange (false))
+        {
+            socket.reset (new DatagramSocket());
+            if (! socket->bindToPort (port.load()))
+            {
+                socket.reset();
+                wait (500);
+                continue;
+            }
+            streaming = false;
+        }
+
+        auto now = Time::getMillisecondCounterHiRes() * 0.001;
+
+        // a packet held too long waits for one that's not coming
+        if (holdingSince > 0.0 && now - holdingSince > holdSeconds)
+            flushHeld (now, true);
+
+        if (socket->waitUntilReady (true, 20) != 1)
+        {
+            if (streaming && now - lastPacketTime.load() > streamTimeout)
+            {
+                flushHeld (now, true);
+                streaming = false;
+            }
+            continue;
+        }
+
+        String senderAddress;
+        int senderPort = 0;
+        const int size = socket->read (buffer.getData(), NetworkAudioPacket::maxSize, false, senderAddress, senderPort);
+        if (size <= 0)
+            continue;
+
+        NetworkAudioPacket::Header header;
+        if (! NetworkAudioPacket::readHeader (buffer.getData(), size, header)
+            || std::abs ((double) header.sampleRate - sampleRate) > 1.0)
+        {
+            rejected.fetch_add (1, std::memory_order_relaxed);
+            continue;
+        }
+
+        now = Time::getMillisecondCounterHiRes() * 0.001;
+        receive (buffer.getData(), header, now);
+    }
+}
+
+void NetworkAudioReceiver::receive (uint8* packet, const NetworkAudioPacket::Header& header, double now)
+{
+    packetsReceived.fetch_add (1, std::memory_order_relaxed);
+    lastPacketTime.store (now, std::memory_order_relaxed);
+
+    const double fillMs = (double) header.numFrames / sampleRate * 1000.0;
+    packetMs.store (fillMs, std::memory_order_relaxed);
+    if (header.wallClock != 0)
+    {
+        // stamped at the packet's first frame, so filling it comes off
+        const double transit = jmax (0.0, NetworkAudioPacket::getMillisecondsBetween (
+            header.wallClock, NetworkAudioPacket::getWallClock()) - fillMs);
+        const double previous = networkMs.load (std::memory_order_relaxed);
+        networkMs.store (previous < 0.0 ? transit : previous + 0.05 * (transit - previous),
+                         std::memory_order_relaxed);
+    }
+
+    const auto maxGap = (int32) sampleRate;
+    if (! streaming || header.ssrc != streamSsrc
+        || std::abs ((int32) (header.timestamp - nextTimestamp)) > maxGap)
+    {
+        // a new or restarted stream
+        for (auto& valid : heldValid)
+            valid = false;
+        holdingSince = 0.0;
+        streaming = true;
+        streamSsrc = header.ssrc;
+        nextTimestamp = header.timestamp;
+    }
+
+    const auto delta = (int32) (header.timestamp - nextTimestamp);
+    if (delta < 0)
+    {
+        late.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (delta == 0)
+    {
+        deliver (packet, header, now);
+        flushHeld (now, false);
+        return;
+    }
+
+    // early, hold it until the ones before it turn up
+    int slot = -1;
+    for (int i = 0; i < reorderSlots && slot < 0; ++i)
+        if (! heldValid[i])
+            slot = i;
+
+    if (slot < 0)
+    {
+        flushHeld (now, true);
+        for (int i = 0; i < reorderSlots && slot < 0; ++i)
+            if (! heldValid[i])
+                slot = i;
+        if (slot < 0)
+            return;
+    }
+
+    memcpy (getHeld (slot), packet, (size_t) NetworkAudioPacket::getSize (header.numChannels, header.numFrames));
+    heldHeaders[slot] = header;
+    heldValid[slot] = true;
+    if (holdingSince <= 0.0)
+        holdingSince = now;
+    reordered.fetch_add (1, std::memory_order_relaxed);
+}
+
+void NetworkAudioReceiver::deliver (uint8* packet, const NetworkAudioPacket::Header& header, double now)
+{
+    auto* const payload = reinterpret_cast<float*> (packet + NetworkAudioPacket::headerSize);
+    fromWire (payload, header.numChannels * header.numFrames);
+
+    for (int c = 0; c < numChannels; ++c)
+        channelPointers[c] = c < header.numChannels ? payload + c * header.numFrames : nullptr;
+    resampler.push (channelPointers.getData(), numChannels, header.numFrames, now);
+    nextTimestamp = header.timestamp + (uint32) header.numFrames;
+}
+
+void NetworkAudioReceiver::deliverSilence (int numFrames, double now)
+{
+    for (int c = 0; c < numChannels; ++c)
+        channelPointers[c] = silence.getData();
+
+    for (int done = 0; done < numFrames;)
+    {
+        const int numToPush = jmin ((int) NetworkAudioPacket::maxFrames, numFrames - done);
+        resampler.push (channelPointers.getData(), numChannels, numToPush, now);
+        done += numToPush;
+    }
+
+    nextTimestamp += (uint32) numFrames;
+}
+
+void NetworkAudioReceiver::flushHeld (double now, bool force)
+{
+    for (;;)
+    {
+        int next = -1, earliest = -1;
+        for (int i = 0; i < reorderSlots; ++i)
+        {
+            if (! heldValid[i])
+                continue;
+            const auto delta = (int32) (heldHeaders[i].timestamp - nextTimestamp);
+            if (delta < 0)
+            {
+                // overtaken by a forced gap
+                heldValid[i] = false;
+                late.fetch_add (1, std::memory_order_relaxed);
+            }
+            else if (delta == 0)
+            {
+                next = i;
+            }
+            else if (earliest < 0 || delta < (int32) (heldHeaders[earliest].timestamp - nextTimestamp))
+            {
+                earliest = i;
+            }
+        }
+
+        if (next >= 0)
+        {
+            heldValid[next] = false;
+            deliver (getHeld (next), heldHeaders[next], now);
+            continue;
+        }
+
+        if (earliest < 0)
+        {
+            holdingSince = 0.0;
+            return;
+        }
+
+        if (! force)
+            return;
+
+        // give up on what's missing and play silence in its place
+        const auto gap = (int) (heldHeaders[earliest].timestamp - nextTimestamp);
+        lost.fetch_add (jmax (1, gap / jmax (1, heldHeaders[earliest].numFrames)), std::memory_order_relaxed);
+        if (gap <= resampler.getLatencySamples())
+            deliverSilence (gap, now);
+        else
+            nextTimestamp += (uint32) gap; // longer than the buffer, it underruns instead
+        holdingSince = now;
+        force = false;
+    }
+}
+
+}
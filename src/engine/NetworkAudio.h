@@ -0,0 +1,257 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/DriftResampler.h"
+
+namespace Element {
+
+/** The packets network audio nodes send each other over UDP.
+
+    Each packet starts with an RTP header (RFC 3550): sequence number, a
+    timestamp counting frames on the sender's sample clock and the sender's
+    SSRC. A header extension, profile 'EL', follows with the channel and
+    frame counts, the sample rate and, when the sender stamps it, the wall
+    clock time the packet's first frame was rendered, in NTP format. Hosts
+    whose clocks are kept in step, by PTP for example, can tell the network
+    delay from it.
+
+    After the header come the frames, channel after channel, as 32 bit
+    little endian floats. On little endian machines those are the render
+    buffer's own bytes, so a packet is filled and read with plain copies
+    and the receiver resamples straight out of it.
+ */
+struct NetworkAudioPacket
+{
+    enum
+    {
+        headerSize      = 32,
+        maxSize         = 1472,     ///< fits an ethernet frame without fragmenting
+        maxFrames       = 256,
+        payloadType     = 97,       ///< from the dynamic range
+        maxChannels     = 32
+    };
+
+    struct Header
+    {
+        uint16 sequence     = 0;
+        uint32 timestamp    = 0;    ///< frames on the sender's sample clock
+        uint32 ssrc         = 0;
+        int numChannels     = 0;
+        int numFrames       = 0;
+        uint32 sampleRate   = 0;
+        uint64 wallClock    = 0;    ///< NTP time, zero when not stamped
+    };
+
+    /** Returns the most frames a packet of this many channels holds */
+    static int getMaxFrames (int numChannels) noexcept;
+
+    /** Returns the bytes a packet takes */
+    static int getSize (int numChannels, int numFrames) noexcept
+    {
+        return headerSize + numChannels * numFrames * (int) sizeof (float);
+    }
+
+    static void writeHeader (uint8* packet, const Header& header) noexcept;
+
+    /** Reads and checks a header. Returns false unless it's one of ours
+        and the packet is as long as it says */
+    static bool readHeader (const uint8* packet, int size, Header& header) noexcept;
+
+    /** Returns the current wall clock time in NTP format */
+    static uint64 getWallClock() noexcept;
+
+    /** Returns the milliseconds between two NTP times */
+    static double getMillisecondsBetween (uint64 earlier, uint64 later) noexcept;
+};
+
+//=============================================================================
+/** Sends audio from the render thread to a host and port.
+
+    The audio thread writes frames straight into packets in a ring, and a
+    thread of the sender's own puts the finished ones on the network, so
+    the audio thread never touches a socket. A full ring drops the packet
+    and counts an overrun.
+ */
+class NetworkAudioSender : private Thread
+{
+public:
+    struct Stats
+    {
+        int64 packetsSent = 0;
+        int overruns = 0;
+        int sendErrors = 0;
+    };
+
+    NetworkAudioSender();
+    ~NetworkAudioSender();
+
+    /** Sets where packets go. Can be called any time from the message thread */
+    void setDestination (const String& host, int port);
+    String getHost() const;
+    int getPort() const;
+
+    /** Stamps packets with the wall clock, for hosts with synchronised clocks */
+    void setWallClockTimestamps (bool shouldStamp) noexcept     { stamping.store (shouldStamp); }
+    bool isStampingWallClock() const noexcept                   { return stamping.load(); }
+
+    /** Allocates the ring and starts the network thread. Frames per packet
+        are capped to what fits one datagram */
+    void prepare (int numChannels, double sampleRate, int framesPerPacket);
+
+    /** Stops the thread and frees the ring */
+    void release();
+
+    /** Returns the frames each packet carries, and so the delay added before sending */
+    int getFramesPerPacket() const noexcept                     { return framesPerPacket; }
+
+    /** Packs frames for sending. Audio thread only */
+    void push (const float* const* channels, int numChannels, int numFrames) noexcept;
+
+    Stats getStats() const noexcept;
+
+private:
+    int numChannels = 0;
+    int framesPerPacket = 0;
+    int packetSize = 0;
+    uint32 sampleRate = 0;
+    uint32 ssrc = 0;
+
+    enum { numSlots = 128 };
+    AbstractFifo fifo { numSlots };
+    HeapBlock<uint8> slots;
+
+    // audio thread only
+    uint8* current = nullptr;
+    bool dropping = false;
+    uint16 sequence = 0;
+    uint32 timestamp = 0;
+    int framesInPacket = 0;
+
+    std::atomic<bool> stamping { false };
+    std::atomic<int64> packetsSent { 0 };
+    std::atomic<int> overruns { 0 };
+    std::atomic<int> sendErrors { 0 };
+
+    CriticalSection destinationLock;
+    String host { "127.0.0.1" };
+    int port = 9500;
+
+    uint8* getSlot (int index) noexcept { return slots.getData() + (size_t) index * (size_t) NetworkAudioPacket::maxSize; }
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (NetworkAudioSender)
+};
+
+//=============================================================================
+/** Receives audio sent by a NetworkAudioSender.
+
+    A thread of the receiver's own reads the socket, puts packets that
+    arrive out of order back in order, fills the gaps of lost ones with
+    silence and hands the frames to a DriftResampler. The render thread
+    pulls from that, so it follows the sender's sample clock without
+    either side locking. The jitter buffer holds the configured latency on
+    top of a packet and two render blocks.
+ */
+class NetworkAudioReceiver : private Thread
+{
+public:
+    struct Stats
+    {
+        int64 packetsReceived = 0;
+        int lost = 0;           ///< packets that never arrived, played as silence
+        int late = 0;           ///< packets that arrived after their frames were played
+        int reordered = 0;      ///< packets put back in order
+        int rejected = 0;       ///< packets in another format or rate
+        int underruns = 0;
+        double driftPpm = 0.0;
+        double networkMs = -1.0;    ///< transit time, when the sender stamps packets
+        double bufferMs = 0.0;      ///< time spent in the jitter buffer
+        double packetMs = 0.0;      ///< time the sender waits to fill a packet
+        double totalMs = 0.0;       ///< sender input to receiver output
+
+        bool isReceiving = false;
+    };
+
+    NetworkAudioReceiver();
+    ~NetworkAudioReceiver();
+
+    /** Sets the UDP port to listen on. Message thread */
+    void setPort (int port);
+    int getPort() const noexcept                { return port.load(); }
+
+    /** Sets milliseconds of jitter the buffer absorbs. Takes effect when prepared */
+    void setLatency (double milliseconds) noexcept  { latencyMs = jlimit (0.0, 1000.0, milliseconds); }
+    double getLatency() const noexcept          { return latencyMs; }
+
+    /** Sizes the jitter buffer and starts listening. Packets at other
+        sample rates are rejected */
+    void prepare (int numChannels, double sampleRate, int blockSize);
+
+    /** Stops listening */
+    void release();
+
+    /** Returns the delay the jitter buffer adds, in frames */
+    int getLatencySamples() const noexcept      { return resampler.getLatencySamples(); }
+
+    /** Reads frames on the render thread. Outputs silence until enough has
+        arrived */
+    void pull (float* const* channels, int numChannels, int numFrames) noexcept;
+
+    Stats getStats() const noexcept;
+
+private:
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    double latencyMs = 10.0;
+    std::atomic<int> port { 9500 };
+    std::atomic<bool> portChanged { false };
+    DriftResampler resampler;
+
+    // network thread only
+    enum { reorderSlots = 8 };
+    HeapBlock<uint8> held;
+    NetworkAudioPacket::Header heldHeaders [reorderSlots];
+    bool heldValid [reorderSlots] = {};
+    HeapBlock<float> silence;
+    HeapBlock<const float*> channelPointers;
+    bool streaming = false;
+    uint32 streamSsrc = 0;
+    uint32 nextTimestamp = 0;
+    double holdingSince = 0.0;
+    double holdSeconds = 0.005;     ///< how long an early packet waits for the ones before it
+
+    std::atomic<int64> packetsReceived { 0 };
+    std::atomic<int> lost { 0 }, late { 0 }, reordered { 0 }, rejected { 0 };
+    std::atomic<double> networkMs { -1.0 };
+    std::atomic<double> packetMs { 0.0 };
+    std::atomic<double> lastPacketTime { 0.0 };
+
+    uint8* getHeld (int index) noexcept { return held.getData() + (size_t) index * (size_t) NetworkAudioPacket::maxSize; }
+    void run() override;
+    void receive (uint8* packet, const NetworkAudioPacket::Header&, double now);
+    void deliver (uint8* packet, const NetworkAudioPacket::Header&, double now);
+    void deliverSilence (int numFrames, double now);
+    void flushHeld (double now, bool force);
+
+    JUCE_DECLARE_NON_COPYABLE (NetworkAudioReceiver)
+};
+
+}
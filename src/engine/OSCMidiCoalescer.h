@@ -0,0 +1,108 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "Utils.h"
+
+namespace Element {
+
+/** Gathers MIDI turned into OSC so it can go out as one bundle.
+
+    Events are added with the time they were rendered and sent as a single
+    bundle tagged with the time of the first. With deduplication on, a
+    controller, pitch bend or pressure value replaces any earlier one for
+    the same address and controller still waiting to be sent, so only the
+    latest goes out. Notes and everything else are always kept.
+ */
+class OSCMidiCoalescer
+{
+public:
+    OSCMidiCoalescer() { events.ensureStorageAllocated (maxEvents); }
+
+    enum { maxEvents = 256 };   ///< a full coalescer should be sent whatever the rate limit
+
+    /** Turns latest value wins on or off */
+    void setDeduplicating (bool shouldDeduplicate) noexcept     { deduplicating = shouldDeduplicate; }
+    bool isDeduplicating() const noexcept                       { return deduplicating; }
+
+    /** Adds an event rendered at the given time, in seconds on the
+        Time::getMillisecondCounterHiRes() clock */
+    void add (const MidiMessage& message, double time)
+    {
+        if (events.isEmpty())
+            startTime = time;
+
+        if (deduplicating && isContinuous (message))
+        {
+            const int key = getKey (message);
+            for (int i = events.size(); --i >= 0;)
+            {
+                if (isContinuous (events.getReference (i)) && getKey (events.getReference (i)) == key)
+                {
+                    events.remove (i);
+                    break;
+                }
+            }
+        }
+
+        events.add (message);
+    }
+
+    bool isEmpty() const noexcept                   { return events.isEmpty(); }
+    bool isFull() const noexcept                    { return events.size() >= (int) maxEvents; }
+    int getNumEvents() const noexcept               { return events.size(); }
+    const MidiMessage& getEvent (int index) const   { return events.getReference (index); }
+
+    /** Returns the time of the first event added since the last clear */
+    double getStartTime() const noexcept            { return startTime; }
+
+    /** Builds a bundle of everything added, tagged with the wall clock time
+        of the first event */
+    OSCBundle createBundle() const
+    {
+        const double wallClockMs = startTime * 1000.0 + (double) Time::currentTimeMillis()
+                                 - Time::getMillisecondCounterHiRes();
+        OSCBundle bundle (OSCTimeTag (Time ((int64) wallClockMs)));
+        for (const auto& message : events)
+            bundle.addElement (Util::processMidiToOscMessage (message));
+        return bundle;
+    }
+
+    void clear() noexcept                           { events.clearQuick(); }
+
+private:
+    Array<MidiMessage> events;
+    double startTime = 0.0;
+    bool deduplicating = false;
+
+    static bool isContinuous (const MidiMessage& m) noexcept
+    {
+        return m.isController() || m.isPitchWheel() || m.isChannelPressure() || m.isAftertouch();
+    }
+
+    /** Status byte, with the controller or note number for the messages that have one */
+    static int getKey (const MidiMessage& m) noexcept
+    {
+        const auto* data = m.getRawData();
+        return m.isController() || m.isAftertouch() ? (data[0] << 8) | data[1] : data[0] << 8;
+    }
+};
+
+}
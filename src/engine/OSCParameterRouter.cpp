@@ -0,0 +1,284 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/OSCParameterRouter.h"
+
+#define EL_OSC_ADDRESS_PARAM "/element/param/"
+
+namespace Element {
+
+/** Messages to unresolved addresses beyond this wait for the next batch */
+static const int maxPendingMessages = 1024;
+
+/** The cache starts over when it holds more addresses than this */
+static const int maxCachedAddresses = 4096;
+
+static bool getValue (const OSCArgument& arg, float& value)
+{
+    if (arg.isFloat32())
+        value = arg.getFloat32();
+    else if (arg.isInt32())
+        value = (float) arg.getInt32();
+    else
+        return false;
+    value = jlimit (0.f, 1.f, value);
+    return true;
+}
+
+//=============================================================================
+OSCParameterRouter::OSCParameterRouter()
+    : cache (new Cache())
+{ }
+
+OSCParameterRouter::~OSCParameterRouter()
+{
+    stopTimer();
+    cancelPendingUpdate();
+}
+
+void OSCParameterRouter::setGraphSource (std::function<Node()> source)
+{
+    graphSource = source;
+    updateGraph();
+    if (graphSource)
+        startTimer (500);
+    else
+        stopTimer();
+}
+
+void OSCParameterRouter::invalidate()
+{
+    setCache (new Cache());
+}
+
+int OSCParameterRouter::getNumCachedAddresses() const
+{
+    return getCache()->targets.size();
+}
+
+//=============================================================================
+bool OSCParameterRouter::parseAddress (const String& address, uint32& nodeId, String& parameter)
+{
+    if (! address.startsWith (EL_OSC_ADDRESS_PARAM))
+        return false;
+
+    const auto rest = address.substring (String (EL_OSC_ADDRESS_PARAM).length());
+    const auto node = rest.upToFirstOccurrenceOf ("/", false, false);
+    const auto param = rest.fromFirstOccurrenceOf ("/", false, false);
+    if (node.isEmpty() || ! node.containsOnly ("0123456789") || param.containsChar ('/'))
+        return false;
+
+    nodeId = (uint32) node.getLargeIntValue();
+    parameter = param;
+    return true;
+}
+
+int OSCParameterRouter::findParameter (const GraphNode& node, const String& parameter)
+{
+    const auto& params = node.getParameters();
+    if (parameter.isEmpty())
+        return -1;
+
+    if (parameter.containsOnly ("0123456789"))
+    {
+        const int index = parameter.getIntValue();
+        return isPositiveAndBelow (index, params.size()) ? index : -1;
+    }
+
+    for (int i = 0; i < params.size(); ++i)
+    {
+        const auto name = params.getUnchecked(i)->getName (128);
+        if (name.equalsIgnoreCase (parameter) || name.replaceCharacter (' ', '_').equalsIgnoreCase (parameter))
+            return i;
+    }
+
+    return -1;
+}
+
+//=============================================================================
+void OSCParameterRouter::oscMessageReceived (const OSCMessage& message)
+{
+    route (message, Time::getMillisecondCounterHiRes() * 0.001);
+}
+
+void OSCParameterRouter::oscBundleReceived (const OSCBundle& bundle)
+{
+    routeBundle (bundle, Time::getMillisecondCounterHiRes() * 0.001);
+}
+
+void OSCParameterRouter::routeBundle (const OSCBundle& bundle, double timestamp)
+{
+    for (const auto& element : bundle)
+    {
+        if (element.isMessage())
+            route (element.getMessage(), timestamp);
+        else if (element.isBundle())
+            routeBundle (element.getBundle(), timestamp);
+    }
+}
+
+void OSCParameterRouter::route (const OSCMessage& message, double timestamp)
+{
+    const auto address = message.getAddressPattern().toString();
+    if (! address.startsWith (EL_OSC_ADDRESS_PARAM))
+        return;
+
+    const auto current = getCache();
+    if (current->targets.contains (address))
+    {
+        apply (current->targets [address], message, timestamp);
+        return;
+    }
+
+    {
+        const ScopedLock sl (pendingLock);
+        if (pending.size() >= maxPendingMessages)
+            return;
+        pending.add ({ message, timestamp });
+    }
+
+    triggerAsyncUpdate();
+}
+
+void OSCParameterRouter::apply (const Target& target, const OSCMessage& message, double timestamp)
+{
+    auto* node = target.node.get();
+    if (node == nullptr)
+        return;
+
+    float value = 0.f;
+    if (target.parameter >= 0)
+    {
+        if (message.size() > 0 && getValue (message[0], value))
+        {
+            node->scheduleParameterChange (target.parameter, value, timestamp);
+            ++numRouted;
+        }
+        return;
+    }
+
+    const int numParams = node->getParameters().size();
+    for (int i = 0; i + 1 < message.size(); i += 2)
+    {
+        if (! message[i].isInt32() || ! getValue (message[i + 1], value))
+            continue;
+        const int parameter = message[i].getInt32();
+        if (! isPositiveAndBelow (parameter, numParams))
+            continue;
+        node->scheduleParameterChange (parameter, value, timestamp);
+        ++numRouted;
+    }
+}
+
+//=============================================================================
+OSCParameterRouter::Cache::Ptr OSCParameterRouter::getCache() const
+{
+    SpinLock::ScopedLockType sl (cacheLock);
+    return cache;
+}
+
+void OSCParameterRouter::setCache (Cache::Ptr newCache)
+{
+    Cache::Ptr previous;
+    {
+        SpinLock::ScopedLockType sl (cacheLock);
+        previous = cache;
+        cache = newCache;
+    }
+
+    retired.add (previous);
+}
+
+OSCParameterRouter::Target OSCParameterRouter::resolve (const String& address) const
+{
+    Target target;
+    uint32 nodeId = 0;
+    String parameter;
+    if (! graph.isValid() || ! parseAddress (address, nodeId, parameter))
+        return target;
+
+    GraphNodePtr node = graph.getNodeById (nodeId).getGraphNode();
+    if (node == nullptr)
+        return target;
+
+    target.parameter = parameter.isEmpty() ? -1 : findParameter (*node, parameter);
+    if (parameter.isEmpty() || target.parameter >= 0)
+        target.node = node;
+    return target;
+}
+
+void OSCParameterRouter::updateGraph()
+{
+    const auto newGraph = graphSource ? graphSource() : Node();
+    if (newGraph != graph)
+    {
+        graph = newGraph;
+        invalidate();
+    }
+}
+
+void OSCParameterRouter::handleAsyncUpdate()
+{
+    Array<Pending> messages;
+    {
+        const ScopedLock sl (pendingLock);
+        messages.swapWith (pending);
+    }
+
+    updateGraph();
+
+    const auto current = getCache();
+    Cache::Ptr next = new Cache();
+    if (current->targets.size() < maxCachedAddresses)
+        for (HashMap<String, Target>::Iterator iter (current->targets); iter.next();)
+            next->targets.set (iter.getKey(), iter.getValue());
+
+    for (const auto& item : messages)
+    {
+        const auto address = item.message.getAddressPattern().toString();
+        if (! next->targets.contains (address))
+            next->targets.set (address, resolve (address));
+        apply (next->targets [address], item.message, item.timestamp);
+    }
+
+    setCache (next);
+}
+
+void OSCParameterRouter::timerCallback()
+{
+    // anything retired a tick ago is no longer in use on the receiver thread
+    retired.clear();
+    updateGraph();
+
+    // drop nodes that went away and addresses that didn't resolve, which
+    // might now
+    const auto current = getCache();
+    Cache::Ptr next = new Cache();
+    for (HashMap<String, Target>::Iterator iter (current->targets); iter.next();)
+    {
+        const auto target = iter.getValue();
+        if (target.node != nullptr && graph.getNodeById (target.node->nodeId).getGraphNode() == target.node.get())
+            next->targets.set (iter.getKey(), target);
+    }
+
+    if (next->targets.size() != current->targets.size())
+        setCache (next);
+}
+
+}
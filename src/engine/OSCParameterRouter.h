@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "session/Node.h"
+
+namespace Element {
+
+/** Sets node parameters from OSC without going through the message thread.
+
+    The router listens on the OSC receiver's own thread and puts each change
+    straight on its node's parameter queue, so the render program picks it
+    up at the sample it arrived on. Addresses are relative to the graph the
+    router follows:
+
+        /element/param/<node>/<parameter> <float>       sets one parameter, given
+                                                        by index or by name
+        /element/param/<node> <int> <float> ...         sets any number of parameters
+                                                        of a node, in index/value pairs
+
+    Values are normalized. Every change in a bundle, nested ones included,
+    carries the bundle's arrival time so they land on the same sample.
+
+    Resolved addresses are cached. The first message to an address is
+    resolved on the message thread and applied from there, every one after
+    it is handled on the receiver thread with a single lookup. The cache is
+    dropped when the graph changes or one of its nodes goes away.
+ */
+class OSCParameterRouter : public OSCReceiver::Listener<OSCReceiver::RealtimeCallback>,
+                           private AsyncUpdater,
+                           private Timer
+{
+public:
+    OSCParameterRouter();
+    ~OSCParameterRouter();
+
+    /** Sets the function the router asks for the graph to follow. It's
+        called on the message thread */
+    void setGraphSource (std::function<Node()> source);
+
+    /** Forgets every resolved address */
+    void invalidate();
+
+    /** Returns the number of addresses resolved so far */
+    int getNumCachedAddresses() const;
+
+    /** Returns the number of changes scheduled since the router was made */
+    int64 getNumChangesRouted() const noexcept { return numRouted.get(); }
+
+    /** Splits a /element/param address into its node id and parameter, which
+        is empty for the pair form. Returns false if it isn't one */
+    static bool parseAddress (const String& address, uint32& nodeId, String& parameter);
+
+    /** Finds a parameter of a node by index or by name. Names match without
+        case, with underscores standing in for spaces */
+    static int findParameter (const GraphNode& node, const String& parameter);
+
+    void oscMessageReceived (const OSCMessage&) override;
+    void oscBundleReceived (const OSCBundle&) override;
+
+private:
+    struct Target
+    {
+        GraphNodePtr node;
+        int parameter = -1;     ///< -1 for index/value pairs
+    };
+
+    struct Cache : public ReferenceCountedObject
+    {
+        using Ptr = ReferenceCountedObjectPtr<Cache>;
+        HashMap<String, Target> targets;
+    };
+
+    SpinLock cacheLock;
+    Cache::Ptr cache;
+    ReferenceCountedArray<Cache> retired;   ///< released here, never on the receiver thread
+
+    struct Pending
+    {
+        OSCMessage message;
+        double timestamp;
+    };
+
+    CriticalSection pendingLock;
+    Array<Pending> pending;
+
+    std::function<Node()> graphSource;
+    Node graph;
+    Atomic<int64> numRouted { 0 };
+
+    Cache::Ptr getCache() const;
+    void setCache (Cache::Ptr);
+    void route (const OSCMessage&, double timestamp);
+    void routeBundle (const OSCBundle&, double timestamp);
+    void apply (const Target&, const OSCMessage&, double timestamp);
+    Target resolve (const String& address) const;
+    void updateGraph();
+
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE (OSCParameterRouter)
+};
+
+}
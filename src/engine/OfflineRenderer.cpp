@@ -0,0 +1,191 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/GraphNode.h"
+#include "engine/GraphProcessor.h"
+#include "engine/OfflineRenderer.h"
+#include "engine/Transport.h"
+
+namespace Element {
+
+/** Points a processor and everything in it at a play head, remembering
+    the previous ones so they can be put back afterwards */
+class PlayHeadSwap
+{
+public:
+    PlayHeadSwap (AudioProcessor& processor, AudioPlayHead* playHead)
+    {
+        swap (processor, playHead);
+    }
+
+    ~PlayHeadSwap()
+    {
+        for (int i = processors.size(); --i >= 0;)
+            processors.getUnchecked(i)->setPlayHead (previous.getUnchecked (i));
+    }
+
+private:
+    Array<AudioProcessor*> processors;
+    Array<AudioPlayHead*> previous;
+
+    void swap (AudioProcessor& processor, AudioPlayHead* playHead)
+    {
+        processors.add (&processor);
+        previous.add (processor.getPlayHead());
+        processor.setPlayHead (playHead);
+
+        if (auto* graph = dynamic_cast<GraphProcessor*> (&processor))
+            for (int i = 0; i < graph->getNumNodes(); ++i)
+                if (auto* proc = graph->getNode(i)->getAudioProcessor())
+                    swap (*proc, playHead);
+    }
+};
+
+//=============================================================================
+
+OfflineRenderer::OfflineRenderer (AudioProcessor& p, const Options& o)
+    : processor (p), options (o)
+{
+    jassert (options.sampleRate > 0.0 && options.blockSize > 0);
+}
+
+OfflineRenderer::~OfflineRenderer() { }
+
+Result OfflineRenderer::render (std::function<bool (double)> progress)
+{
+    const int numChannels = jmax (1, options.numChannels > 0 ? options.numChannels
+                                                             : processor.getTotalNumOutputChannels());
+    const int numBufferChannels = jmax (numChannels, processor.getTotalNumInputChannels(),
+                                        processor.getTotalNumOutputChannels());
+    const int blockSize   = jmax (1, options.blockSize);
+
+    // output streams append, so an old file has to go first
+    if (! options.file.deleteFile())
+        return Result::fail ("Could not replace " + options.file.getFullPathName());
+    std::unique_ptr<FileOutputStream> stream (options.file.createOutputStream());
+    if (stream == nullptr)
+        return Result::fail ("Could not open " + options.file.getFullPathName());
+
+    WavAudioFormat wav;
+    std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (stream.get(), options.sampleRate,
+        (unsigned int) numChannels, options.bitDepth, {}, 0));
+    if (writer == nullptr)
+        return Result::fail ("Could not create a writer for " + options.file.getFullPathName());
+    stream.release(); // owned by the writer now
+
+    // the writer thread drains the fifo while rendering runs ahead of it
+    TimeSliceThread writerThread ("Offline Render Writer");
+    writerThread.startThread();
+    std::unique_ptr<AudioFormatWriter::ThreadedWriter> threaded (
+        new AudioFormatWriter::ThreadedWriter (writer.release(), writerThread, blockSize * 64));
+
+    Transport transport;
+    transport.requestTempo (options.tempo);
+    transport.requestAudioFrame (options.startFrame);
+    transport.requestPlayState (true);
+    transport.preProcess (0);
+    transport.postProcess (0);
+
+    PlayHeadSwap playHead (processor, &transport);
+    processor.setRateAndBufferSizeDetails (options.sampleRate, blockSize);
+    processor.setNonRealtime (true);
+    processor.prepareToPlay (options.sampleRate, blockSize);
+
+    AudioSampleBuffer audio (numBufferChannels, blockSize);
+    MidiBuffer midi;
+    bool cancelled = false;
+
+    for (int64 position = 0; position < options.lengthInSamples;)
+    {
+        const int numSamples = (int) jmin ((int64) blockSize, options.lengthInSamples - position);
+        AudioSampleBuffer block (audio.getArrayOfWritePointers(), numBufferChannels, numSamples);
+        block.clear();
+        midi.clear();
+
+        transport.preProcess (numSamples);
+        processor.processBlock (block, midi);
+        transport.advance (numSamples);
+        transport.postProcess (numSamples);
+
+        // wait for the writer when rendering outpaces the disk
+        while (! threaded->write (block.getArrayOfReadPointers(), numSamples))
+            Thread::sleep (1);
+
+        position += numSamples;
+        if (progress && ! progress ((double) position / (double) options.lengthInSamples))
+        {
+            cancelled = true;
+            break;
+        }
+    }
+
+    processor.releaseResources();
+    processor.setNonRealtime (false);
+
+    // flushes what's left in the fifo
+    threaded.reset();
+    writerThread.stopThread (2000);
+
+    if (cancelled)
+    {
+        options.file.deleteFile();
+        return Result::fail ("Rendering was cancelled");
+    }
+
+    return Result::ok();
+}
+
+//=============================================================================
+
+class OfflineRenderJob : public ThreadPoolJob
+{
+public:
+    OfflineRenderJob (OfflineRenderer& r)
+        : ThreadPoolJob ("Offline Render"), renderer (r) { }
+
+    JobStatus runJob() override
+    {
+        result = renderer.render ([this] (double) { return ! shouldExit(); });
+        return jobHasFinished;
+    }
+
+    OfflineRenderer& renderer;
+    Result result { Result::ok() };
+};
+
+Result OfflineRenderer::renderInParallel (const Array<OfflineRenderer*>& renderers, int numThreads)
+{
+    // declared first so the pool is done with the jobs before they go
+    OwnedArray<OfflineRenderJob> jobs;
+    ThreadPool pool (jlimit (1, jmax (1, renderers.size()), numThreads));
+
+    for (auto* renderer : renderers)
+        pool.addJob (jobs.add (new OfflineRenderJob (*renderer)), false);
+
+    for (auto* job : jobs)
+        pool.waitForJobToFinish (job, -1);
+
+    for (auto* job : jobs)
+        if (job->result.failed())
+            return job->result;
+
+    return Result::ok();
+}
+
+}
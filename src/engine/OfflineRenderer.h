@@ -0,0 +1,71 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Renders a graph, or any other processor, to an audio file as fast as
+    the CPU allows.
+
+    The processor is driven by a transport of its own instead of an audio
+    device, so nothing else may be rendering it meanwhile. Its channel layout
+    is left as it is, the input is silent. Graph nodes are put in
+    non-realtime mode for the duration and rendered blocks are streamed to
+    disk by a background writer.
+ */
+class OfflineRenderer
+{
+public:
+    struct Options
+    {
+        double sampleRate       = 44100.0;
+        int blockSize           = 512;
+        int numChannels         = 2;        ///< channels to write, 0 for all of the outputs
+        int bitDepth            = 24;
+        int64 startFrame        = 0;        ///< transport position of the first sample
+        int64 lengthInSamples   = 0;        ///< number of samples to render
+        double tempo            = 120.0;
+        File file;                          ///< the WAV file to write
+    };
+
+    OfflineRenderer (AudioProcessor& processor, const Options& options);
+    ~OfflineRenderer();
+
+    /** Renders on the calling thread. The callback is given the progress
+        from 0 to 1 after each block and can return false to cancel */
+    Result render (std::function<bool (double)> progress = nullptr);
+
+    /** Renders several independent processors on a pool of threads. Returns the
+        first failure, if any */
+    static Result renderInParallel (const Array<OfflineRenderer*>& renderers, int numThreads);
+
+    /** Returns the options this renderer was created with */
+    const Options& getOptions() const noexcept { return options; }
+
+private:
+    AudioProcessor& processor;
+    const Options options;
+
+    JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
+
+}
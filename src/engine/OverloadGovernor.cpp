@@ -0,0 +1,217 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/GraphProcessor.h"
+#include "engine/OverloadGovernor.h"
+
+namespace Element {
+
+static String describeLoad (double load)
+{
+    return " (load " + String (roundToInt (load * 100.0)) + "%)";
+}
+
+/** Nodes the governor may take load off at all */
+static bool isCandidate (const GraphNode& node)
+{
+    return node.getLoadPriority() != GraphNode::EssentialPriority
+        && node.isEnabled() && ! node.isFrozen() && ! node.isSuspended()
+        && ! node.isAudioIONode() && ! node.isMidiIONode() && ! node.isMidiDeviceNode();
+}
+
+/** Changes how far a node's oversampling is lowered. The node is released
+    and prepared again around it, the graph then rebuilds for its latency */
+static void setReduction (GraphNode& node, int halvings)
+{
+    auto* const graph = node.getParentGraph();
+    const bool reprepare = graph != nullptr && node.isEnabled();
+    if (reprepare)
+        node.setEnabled (false);
+    node.setOversamplingReduction (halvings);
+    if (reprepare)
+    {
+        node.setEnabled (true);
+        graph->triggerAsyncUpdate();
+    }
+}
+
+//=============================================================================
+OverloadGovernor::OverloadGovernor() { }
+
+OverloadGovernor::OverloadGovernor (const Options& o)
+    : options (o)
+{ }
+
+OverloadGovernor::~OverloadGovernor()
+{
+    restoreAll();
+    for (auto* node : profiled)
+        node->removeProfileSubscriber();
+}
+
+bool OverloadGovernor::update (double load, const ReferenceCountedArray<GraphNode>& nodes)
+{
+    watch (nodes);
+
+    if (load > options.overloadLoad)
+    {
+        numUnder = 0;
+        if (++numOver < options.overloadReadings)
+            return false;
+        // wait as long again to see what this did
+        numOver = 0;
+        return shedLoad (load, nodes);
+    }
+
+    numOver = 0;
+    if (load >= options.restoreLoad || actions.isEmpty())
+    {
+        numUnder = 0;
+        return false;
+    }
+
+    if (++numUnder < options.restoreReadings)
+        return false;
+    numUnder = 0;
+    return restoreLast (load);
+}
+
+void OverloadGovernor::restoreAll()
+{
+    while (! actions.isEmpty())
+        restoreLast (-1.0);
+    numOver = numUnder = 0;
+    exhausted = false;
+}
+
+//=============================================================================
+void OverloadGovernor::watch (const ReferenceCountedArray<GraphNode>& nodes)
+{
+    // nodes that were removed have nothing to give back
+    for (int i = actions.size(); --i >= 0;)
+    {
+        auto* const node = actions.getReference (i).node.get();
+        if (! nodes.contains (node))
+        {
+            node->setShed (false);
+            actions.remove (i);
+        }
+    }
+
+    for (int i = profiled.size(); --i >= 0;)
+    {
+        if (! nodes.contains (profiled.getObjectPointerUnchecked (i)))
+        {
+            profiled.getObjectPointerUnchecked (i)->removeProfileSubscriber();
+            profiled.remove (i);
+        }
+    }
+
+    for (auto* node : nodes)
+    {
+        if (! profiled.contains (node))
+        {
+            node->addProfileSubscriber();
+            profiled.add (node);
+        }
+    }
+}
+
+bool OverloadGovernor::shedLoad (double load, const ReferenceCountedArray<GraphNode>& nodes)
+{
+    GraphNode* heaviest = nullptr;
+    double heaviestMs = -1.0;
+
+    // oversampling goes first, it's lost without anything going quiet
+    for (auto* node : nodes)
+    {
+        if (! isCandidate (*node) || node->isShed() || node->getOversamplingFactor() <= 1)
+            continue;
+        const double ms = node->getProcessTime().averageMs;
+        if (ms > heaviestMs)
+        {
+            heaviest = node;
+            heaviestMs = ms;
+        }
+    }
+
+    if (heaviest != nullptr)
+    {
+        setReduction (*heaviest, heaviest->getOversamplingReduction() + 1);
+        actions.add ({ heaviest, LowerOversampling });
+        exhausted = false;
+        Logger::writeToLog ("[EL] overload: lowered oversampling of " + heaviest->getName()
+            + " to " + String (heaviest->getOversamplingFactor()) + "x" + describeLoad (load));
+        return true;
+    }
+
+    for (auto* node : nodes)
+    {
+        if (! isCandidate (*node) || node->isShed() || node->getLoadPriority() != GraphNode::LowPriority)
+            continue;
+        const double ms = node->getProcessTime().averageMs;
+        if (ms > heaviestMs)
+        {
+            heaviest = node;
+            heaviestMs = ms;
+        }
+    }
+
+    if (heaviest == nullptr)
+    {
+        if (! exhausted)
+            Logger::writeToLog ("[EL] overload: nothing left to shed" + describeLoad (load));
+        exhausted = true;
+        return false;
+    }
+
+    heaviest->setShed (true);
+    actions.add ({ heaviest, ShedNode });
+    exhausted = false;
+    Logger::writeToLog ("[EL] overload: bypassed " + heaviest->getName() + describeLoad (load));
+    return true;
+}
+
+bool OverloadGovernor::restoreLast (double load)
+{
+    if (actions.isEmpty())
+        return false;
+
+    exhausted = false;
+    const auto action = actions.removeAndReturn (actions.size() - 1);
+    auto& node = *action.node;
+    const String reason = load >= 0.0 ? "[EL] load recovered: " : "[EL] overload protection off: ";
+
+    if (action.type == ShedNode)
+    {
+        node.setShed (false);
+        Logger::writeToLog (reason + "restored " + node.getName()
+            + (load >= 0.0 ? describeLoad (load) : String()));
+    }
+    else
+    {
+        setReduction (node, node.getOversamplingReduction() - 1);
+        Logger::writeToLog (reason + "restored " + String (node.getOversamplingFactor())
+            + "x oversampling of " + node.getName() + (load >= 0.0 ? describeLoad (load) : String()));
+    }
+
+    return true;
+}
+
+}
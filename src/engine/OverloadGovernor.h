@@ -0,0 +1,101 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/GraphNode.h"
+
+namespace Element {
+
+/** Takes load off the engine while it can't keep up and gives it back once
+    it can.
+
+    It's handed the device's callback load a few times a second. Once the
+    load has stayed over the overload threshold for a number of readings, it
+    halves the oversampling of the heaviest node that isn't essential. When
+    nothing is left oversampled, it sheds the heaviest low priority node, see
+    GraphNode::setShed. Once the load has stayed under the lower restore
+    threshold for longer, the last action is undone. The gap between the
+    thresholds and the longer wait to restore keep it from flapping. Every
+    action is logged.
+
+    Nodes are weighed by their render times, so the governor profiles the
+    nodes it's given. Use from the message thread.
+ */
+class OverloadGovernor
+{
+public:
+    struct Options
+    {
+        double overloadLoad     = 0.85; ///< load the engine is overloaded over, from 0 to 1
+        double restoreLoad      = 0.60; ///< load under which it has room to give back
+        int overloadReadings    = 4;    ///< readings in a row over the threshold before acting
+        int restoreReadings     = 20;   ///< readings in a row under the threshold before restoring
+    };
+
+    enum ActionType
+    {
+        LowerOversampling = 0,
+        ShedNode
+    };
+
+    struct Action
+    {
+        GraphNodePtr node;
+        ActionType type;
+    };
+
+    OverloadGovernor();
+    explicit OverloadGovernor (const Options&);
+
+    /** Restores every node */
+    ~OverloadGovernor();
+
+    void setOptions (const Options& newOptions) { options = newOptions; }
+    const Options& getOptions() const noexcept  { return options; }
+
+    /** Takes a load reading and acts on the nodes once the engine has been
+        over or under long enough. Returns true if a node was changed */
+    bool update (double load, const ReferenceCountedArray<GraphNode>& nodes);
+
+    /** Undoes every action, the last first */
+    void restoreAll();
+
+    /** Returns the number of actions in effect */
+    int getNumActions() const noexcept                  { return actions.size(); }
+
+    /** Returns an action in effect, the first taken first */
+    const Action& getAction (int index) const           { return actions.getReference (index); }
+
+private:
+    Options options;
+    Array<Action> actions;
+    ReferenceCountedArray<GraphNode> profiled;
+    int numOver = 0;
+    int numUnder = 0;
+    bool exhausted = false;
+
+    void watch (const ReferenceCountedArray<GraphNode>& nodes);
+    bool shedLoad (double load, const ReferenceCountedArray<GraphNode>& nodes);
+    bool restoreLast (double load);
+
+    JUCE_DECLARE_NON_COPYABLE (OverloadGovernor)
+};
+
+}
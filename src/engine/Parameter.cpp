@@ -23,11 +23,66 @@
 
 namespace Element {
 
+/** Nesting of listener callbacks on this thread, so removing a listener
+    from inside one doesn't wait on itself */
+static thread_local int notificationDepth = 0;
+
+//==============================================================================
+std::atomic<uint64>* ParameterChanges::allocate (int& bit)
+{
+    bit = numBits++;
+    if (bit / 64 >= words.size())
+        words.add (new Word());
+    return &words.getUnchecked (bit / 64)->value;
+}
+
+bool ParameterChanges::takeChanges (Array<uint64>& bits)
+{
+    bits.resize (words.size());
+    bool anyChanged = false;
+    for (int i = 0; i < words.size(); ++i)
+    {
+        const auto word = words.getUnchecked(i)->value.exchange (0, std::memory_order_acquire);
+        bits.setUnchecked (i, word);
+        anyChanged |= word != 0;
+    }
+    return anyChanged;
+}
+
+//==============================================================================
+struct Parameter::ListenerArray
+{
+    Array<Listener*> items;
+};
+
+/** Keeps the listener array being called from being freed */
+struct Parameter::ScopedNotification
+{
+    ScopedNotification (Parameter& p)
+        : parameter (p)
+    {
+        ++notificationDepth;
+        parameter.numNotifying.fetch_add (1);
+        array = parameter.listeners.load();
+    }
+
+    ~ScopedNotification()
+    {
+        parameter.numNotifying.fetch_sub (1);
+        --notificationDepth;
+    }
+
+    Parameter& parameter;
+    ListenerArray* array = nullptr;
+};
+
 //==============================================================================
 Parameter::Parameter() noexcept {}
 
 Parameter::~Parameter()
 {
+    delete listeners.exchange (nullptr);
+
    #if JUCE_DEBUG && ! JUCE_DISABLE_AUDIOPROCESSOR_BEGIN_END_GESTURE_CHECKING
     // This will fail if you've called beginChangeGesture() without having made
     // a corresponding call to endChangeGesture...
@@ -41,6 +96,17 @@ void Parameter::setValueNotifyingHost (float newValue)
     sendValueChangedMessageToListeners (newValue);
 }
 
+void Parameter::setChanges (ParameterChanges& newChanges)
+{
+    if (changes != nullptr)
+        return;
+
+    changes = &newChanges;
+    auto* const word = changes->allocate (changeBit);
+    changeMask = (uint64) 1 << (changeBit % 64);
+    changeWord.store (word, std::memory_order_release);
+}
+
 void Parameter::beginChangeGesture()
 {
     // This method can't be used until the parameter has been attached to a processor!
@@ -75,18 +141,21 @@ void Parameter::endChangeGesture()
 
 void Parameter::sendValueChangedMessageToListeners (float newValue)
 {
-    ScopedLock lock (listenerLock);
-    for (int i = listeners.size(); --i >= 0;)
-        if (auto* l = listeners [i])
-            l->controlValueChanged (getParameterIndex(), newValue);
+    if (auto* word = changeWord.load (std::memory_order_acquire))
+        word->fetch_or (changeMask, std::memory_order_release);
+
+    const ScopedNotification notification (*this);
+    if (auto* array = notification.array)
+        for (int i = array->items.size(); --i >= 0;)
+            array->items.getUnchecked(i)->controlValueChanged (getParameterIndex(), newValue);
 }
 
 void Parameter::sendGestureChangedMessageToListeners (bool touched)
 {
-    ScopedLock lock (listenerLock);
-    for (int i = listeners.size(); --i >= 0;)
-        if (auto* l = listeners [i])
-            l->controlTouched (getParameterIndex(), touched);
+    const ScopedNotification notification (*this);
+    if (auto* array = notification.array)
+        for (int i = array->items.size(); --i >= 0;)
+            array->items.getUnchecked(i)->controlTouched (getParameterIndex(), touched);
 }
 
 
@@ -123,14 +192,42 @@ StringArray Parameter::getValueStrings() const
 
 void Parameter::addListener (Parameter::Listener* newListener)
 {
-    const ScopedLock sl (listenerLock);
-    listeners.addIfNotAlreadyThere (newListener);
+    updateListeners (newListener, true);
 }
 
 void Parameter::removeListener (Parameter::Listener* listenerToRemove)
+{
+    updateListeners (listenerToRemove, false);
+}
+
+void Parameter::updateListeners (Listener* listener, bool add)
 {
     const ScopedLock sl (listenerLock);
-    listeners.removeFirstMatchingValue (listenerToRemove);
+    auto* const current = listeners.load();
+    const bool isListening = current != nullptr && current->items.contains (listener);
+    if (listener == nullptr || isListening == add)
+        return;
+
+    // notifiers never lock, so they get a new copy to read
+    std::unique_ptr<ListenerArray> updated (new ListenerArray());
+    if (current != nullptr)
+        updated->items = current->items;
+    if (add)
+        updated->items.add (listener);
+    else
+        updated->items.removeFirstMatchingValue (listener);
+    listeners.store (updated.release());
+
+    std::unique_ptr<ListenerArray> old (current);
+    if (notificationDepth > 0)
+    {
+        retiredListeners.add (old.release());
+        return;
+    }
+
+    while (numNotifying.load() > 0)
+        Thread::yield();
+    retiredListeners.clear();
 }
 
 ControlPortParameter::ControlPortParameter (const kv::PortDescription& p)
@@ -168,4 +265,116 @@ ControlPortParameter& ControlPortParameter::operator= (float newValue)
     return *this;
 }
 
+//==============================================================================
+struct ParameterDispatcher::Group
+{
+    ParameterChanges::Ptr changes;
+    Array<ParameterListener*> listeners;
+};
+
+ParameterDispatcher::ParameterDispatcher() {}
+
+ParameterDispatcher::~ParameterDispatcher()
+{
+    jassert (listeners.isEmpty());
+    stopRefresh();
+}
+
+void ParameterDispatcher::add (ParameterListener* listener)
+{
+    JUCE_ASSERT_MESSAGE_MANAGER_IS_LOCKED
+    auto& param = *listener->parameter;
+
+    // parameters outside a node get a set of their own
+    if (param.getChanges() == nullptr)
+        param.setChanges (*new ParameterChanges());
+
+    Group* group = nullptr;
+    for (auto* g : groups)
+    {
+        if (g->changes.get() == param.getChanges())
+        {
+            group = g;
+            break;
+        }
+    }
+
+    if (group == nullptr)
+    {
+        group = groups.add (new Group());
+        group->changes = param.getChanges();
+    }
+
+    group->listeners.add (listener);
+    listeners.add (listener);
+    if (! isRefreshing())
+        startRefresh (RefreshClock::frameRateHz);
+}
+
+void ParameterDispatcher::remove (ParameterListener* listener)
+{
+    JUCE_ASSERT_MESSAGE_MANAGER_IS_LOCKED
+    listeners.removeFirstMatchingValue (listener);
+    for (int i = groups.size(); --i >= 0;)
+    {
+        auto* group = groups.getUnchecked (i);
+        group->listeners.removeFirstMatchingValue (listener);
+        if (group->listeners.isEmpty())
+            groups.remove (i);
+    }
+
+    if (listeners.isEmpty())
+        stopRefresh();
+}
+
+void ParameterDispatcher::dispatchPendingChanges()
+{
+    for (auto* group : groups)
+    {
+        if (! group->changes->takeChanges (bits))
+            continue;
+
+        for (auto* listener : group->listeners)
+        {
+            const int bit = listener->parameter->changeBit;
+            if ((bits.getUnchecked (bit / 64) & ((uint64) 1 << (bit % 64))) != 0)
+                listener->pending = true;
+        }
+    }
+
+    Array<ParameterListener*> due;
+    for (auto* listener : listeners)
+    {
+        if (! listener->pending)
+            continue;
+        if (auto* component = dynamic_cast<Component*> (listener))
+            if (! component->isShowing())
+                continue;
+        due.add (listener);
+    }
+
+    // a callback can delete other listeners
+    for (auto* listener : due)
+    {
+        if (! listeners.contains (listener))
+            continue;
+        listener->pending = false;
+        listener->handleNewParameterValue();
+    }
+}
+
+//==============================================================================
+ParameterListener::ParameterListener (Parameter::Ptr param)
+    : parameter (param)
+{
+    jassert (parameter != nullptr);
+    dispatcher->add (this);
+}
+
+ParameterListener::~ParameterListener()
+{
+    dispatcher->remove (this);
+    parameter = nullptr;
+}
+
 }
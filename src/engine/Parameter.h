@@ -20,11 +20,44 @@
 */
 
 #include "JuceHeader.h"
+#include "gui/RefreshClock.h"
 
 #pragma once
 
 namespace Element {
 
+/** Lock-free change flags for a group of parameters, normally those of one
+    node. Each parameter owns a bit that's set whenever its value is set, from
+    any thread, and the ParameterDispatcher takes them on the message thread.
+ */
+class ParameterChanges : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<ParameterChanges>;
+
+    ParameterChanges() = default;
+    ~ParameterChanges() = default;
+
+    /** Returns the number of bits handed out */
+    int getNumBits() const noexcept { return numBits; }
+
+    /** Hands out a new bit, returning the word it lives in. The word stays put
+        for the life of this object. Call this on the message thread */
+    std::atomic<uint64>* allocate (int& bit);
+
+    /** Moves the bits marked since the last call into bits, one value per 64,
+        and clears them. Returns true if any were marked. Call this on the
+        message thread */
+    bool takeChanges (Array<uint64>& bits);
+
+private:
+    struct Word { std::atomic<uint64> value { 0 }; };
+    OwnedArray<Word> words;
+    int numBits = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterChanges)
+};
+
 /** An abstract base class for parameter objects that can be added to a Node
     Based on juce::AudioProcessorParameter, but designed for GraphNodes which 
     can change parameters.
@@ -272,6 +305,10 @@ public:
     /** Registers a listener to receive events when the parameter's state changes.
         If the listener is already registered, this will not register it again.
 
+        Listeners are (un)registered under a lock which setting the parameter
+        never takes. Once removeListener returns the listener won't be called
+        again, unless it was removed from inside one of its own callbacks.
+
         @see removeListener
     */
     void addListener (Listener* newListener);
@@ -290,13 +327,29 @@ public:
 
 private:
     friend class GraphNode;
+    friend class ParameterDispatcher;
 
     //==============================================================================
     int parameterIndex = -1;
-    CriticalSection listenerLock;
-    Array<Listener*> listeners;
     mutable StringArray valueStrings;
 
+    struct ListenerArray;
+    struct ScopedNotification;
+    CriticalSection listenerLock;
+    std::atomic<ListenerArray*> listeners { nullptr };
+    std::atomic<int> numNotifying { 0 };
+    OwnedArray<ListenerArray> retiredListeners;
+    void updateListeners (Listener*, bool add);
+
+    ParameterChanges::Ptr changes;
+    int changeBit = -1;
+    uint64 changeMask = 0;
+    std::atomic<std::atomic<uint64>*> changeWord { nullptr };
+
+    /** Gives the parameter a bit in changes, unless it has one already */
+    void setChanges (ParameterChanges&);
+    ParameterChanges* getChanges() const noexcept { return changes.get(); }
+
    #if JUCE_DEBUG
     bool isPerformingGesture = false;
    #endif
@@ -345,56 +398,63 @@ private:
     float value { 0.0 };
 };
 
-class ParameterListener : private Parameter::Listener,
-                          private Timer
+class ParameterListener;
+
+/** Delivers parameter changes to ParameterListeners on the message thread.
+
+    Setting a parameter only marks its bit in a ParameterChanges, so it takes
+    no locks from any thread. Once per display frame the dispatcher takes the
+    marked bits of every set that has listeners and calls the listeners of
+    the parameters that changed, however often they were set in between.
+    Listeners that are components off screen keep their change until they're
+    showing again.
+
+    Listeners hold the dispatcher through a SharedResourcePointer.
+ */
+class ParameterDispatcher : private RefreshClient
 {
 public:
-    ParameterListener (Parameter::Ptr param)
-        : parameter (param)
-    {
-        jassert (parameter != nullptr);
-        parameter->addListener (this);
-        startTimer (100);
-    }
+    ParameterDispatcher();
+    ~ParameterDispatcher();
 
-    ~ParameterListener() override
-    {
-        stopTimer();
-        parameter->removeListener (this);
-        parameter = nullptr;
-    }
+    /** Returns the number of registered listeners */
+    int getNumListeners() const noexcept { return listeners.size(); }
 
-    Parameter* getParameter() noexcept { return parameter.get(); }
-
-    virtual void handleNewParameterValue() = 0;
+    /** Calls the listeners whose parameters changed. The clock does this
+        every frame */
+    void dispatchPendingChanges();
 
 private:
-    //==============================================================================
-  
-    void controlValueChanged (int, float) override
-    {
-        parameterValueHasChanged = 1;
-    }
+    friend class ParameterListener;
+    struct Group;
+    OwnedArray<Group> groups;
+    Array<ParameterListener*> listeners;
+    Array<uint64> bits;
 
-    void controlTouched (int, bool) override {}
+    void add (ParameterListener*);
+    void remove (ParameterListener*);
+    void refreshCallback() override { dispatchPendingChanges(); }
 
-    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE (ParameterDispatcher)
+};
 
-    void timerCallback() override
-    {
-        if (parameterValueHasChanged.compareAndSetBool (0, 1))
-        {
-            handleNewParameterValue();
-            startTimerHz (50);
-        }
-        else
-        {
-            startTimer (jmin (250, getTimerInterval() + 10));
-        }
-    }
+/** Mix this into something on the message thread that shows a parameter */
+class ParameterListener
+{
+public:
+    ParameterListener (Parameter::Ptr param);
+    virtual ~ParameterListener();
 
+    Parameter* getParameter() noexcept { return parameter.get(); }
+
+    /** Called on the message thread, at most once a frame, after the value changed */
+    virtual void handleNewParameterValue() = 0;
+
+private:
+    friend class ParameterDispatcher;
+    SharedResourcePointer<ParameterDispatcher> dispatcher;
     Parameter::Ptr parameter;
-    Atomic<int> parameterValueHasChanged { 0 };
+    bool pending = false;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterListener)
 };
@@ -0,0 +1,145 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Glides parameters towards the values mapped controllers send them, so
+    7-bit steps don't zipper.
+
+    The render program owns one per node and moves each ramp along between
+    the parts it splits a block into, at most interval samples apart. Ramps
+    are kept in a fixed array so nothing here allocates.
+ */
+class ParameterRamps
+{
+public:
+    enum Shape
+    {
+        none = 0,       ///< jump straight to the value
+        linear,         ///< constant rate, arriving after the smoothing time
+        onePole         ///< exponential approach, the smoothing time is its time constant
+    };
+
+    enum
+    {
+        maxRamps = 32,  ///< ramps running at once, others jump
+        interval = 32   ///< samples between parameter updates while ramping
+    };
+
+    /** Starts gliding a parameter from one value to another, replacing a ramp
+        it already had. Returns false if there's no room, the caller should
+        set the value itself */
+    bool start (int parameter, float from, float to, int shape, int numSamples) noexcept
+    {
+        cancel (parameter);
+        if (shape == none || numSamples <= 0 || from == to || numRamps >= maxRamps)
+            return false;
+
+        auto& ramp = ramps [numRamps++];
+        ramp.parameter  = parameter;
+        ramp.shape      = shape;
+        ramp.value      = from;
+        ramp.target     = to;
+        ramp.remaining  = numSamples;
+        ramp.step       = (to - from) / (float) numSamples;
+        ramp.numSamples = numSamples;
+        return true;
+    }
+
+    /** Stops a parameter's ramp where it is */
+    void cancel (int parameter) noexcept
+    {
+        for (int i = numRamps; --i >= 0;)
+            if (ramps[i].parameter == parameter)
+                remove (i);
+    }
+
+    /** Stops all ramps */
+    void clear() noexcept { numRamps = 0; }
+
+    /** Returns true while any parameter is still moving */
+    bool isActive() const noexcept { return numRamps > 0; }
+
+    /** Returns the number of ramps running */
+    int size() const noexcept { return numRamps; }
+
+    /** Moves every ramp on by a number of samples, calling the setter with
+        each parameter's new value. Finished ramps land on their target */
+    template<class Setter>
+    void advance (int numSamples, Setter&& set) noexcept
+    {
+        for (int i = numRamps; --i >= 0;)
+        {
+            auto& ramp = ramps[i];
+            ramp.remaining -= numSamples;
+
+            if (ramp.shape == linear)
+            {
+                ramp.value = ramp.remaining > 0 ? ramp.target - ramp.step * (float) ramp.remaining
+                                                : ramp.target;
+            }
+            else
+            {
+                const float coefficient = 1.f - std::exp (-(float) numSamples / (float) ramp.numSamples);
+                ramp.value += (ramp.target - ramp.value) * coefficient;
+                if (std::abs (ramp.target - ramp.value) < settleThreshold)
+                {
+                    ramp.value = ramp.target;
+                    ramp.remaining = 0;
+                }
+                else
+                {
+                    ramp.remaining = jmax (1, ramp.remaining);
+                }
+            }
+
+            set (ramp.parameter, ramp.value);
+            if (ramp.remaining <= 0)
+                remove (i);
+        }
+    }
+
+private:
+    struct Ramp
+    {
+        int parameter   = 0;
+        int shape       = none;
+        float value     = 0.f;
+        float target    = 0.f;
+        float step      = 0.f;
+        int remaining   = 0;
+        int numSamples  = 0;
+    };
+
+    static constexpr float settleThreshold = 1.0e-4f;
+
+    Ramp ramps [maxRamps];
+    int numRamps = 0;
+
+    void remove (int index) noexcept
+    {
+        ramps [index] = ramps [--numRamps];
+    }
+};
+
+}
@@ -0,0 +1,70 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/ProcessTimer.h"
+
+namespace Element {
+
+// weight of the newest block in the running average, roughly the last
+// hundred blocks contribute to it
+static constexpr float averageWeight = 0.01f;
+
+void ProcessTimer::prepare (double newSampleRate) noexcept
+{
+    sampleRate.store (newSampleRate > 0.0 ? newSampleRate : 44100.0, std::memory_order_relaxed);
+    reset();
+}
+
+void ProcessTimer::addBlock (int64 startTicks, int numSamples) noexcept
+{
+    const double seconds = Time::highResolutionTicksToSeconds (now() - startTicks);
+    const float ms = (float) (seconds * 1000.0);
+    const double duration = (double) jmax (1, numSamples) / sampleRate.load (std::memory_order_relaxed);
+
+    float newAverage = average.load (std::memory_order_relaxed);
+    float newMaximum = maximum.load (std::memory_order_relaxed);
+
+    if (resetPending.exchange (false, std::memory_order_relaxed) || newAverage <= 0.f)
+    {
+        newAverage = ms;
+        newMaximum = ms;
+    }
+    else
+    {
+        newAverage += (ms - newAverage) * averageWeight;
+        newMaximum = jmax (newMaximum, ms);
+    }
+
+    last.store (ms, std::memory_order_relaxed);
+    average.store (newAverage, std::memory_order_relaxed);
+    maximum.store (newMaximum, std::memory_order_relaxed);
+    load.store ((float) ((double) newAverage * 0.001 / duration), std::memory_order_relaxed);
+}
+
+ProcessTimer::Reading ProcessTimer::getReading() const noexcept
+{
+    Reading r;
+    r.lastMs    = (double) last.load (std::memory_order_relaxed);
+    r.averageMs = (double) average.load (std::memory_order_relaxed);
+    r.maximumMs = (double) maximum.load (std::memory_order_relaxed);
+    r.load      = (double) load.load (std::memory_order_relaxed);
+    return r;
+}
+
+}
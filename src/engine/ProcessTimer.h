@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Times how long something takes to render each block. The render thread
+    adds blocks while other threads read the latest figures, nothing here
+    locks or allocates.
+ */
+class ProcessTimer
+{
+public:
+    /** A snapshot of the measured times */
+    struct Reading
+    {
+        double lastMs    = 0.0;     ///< time taken by the last block
+        double averageMs = 0.0;     ///< average time per block
+        double maximumMs = 0.0;     ///< longest block since the last reset
+        double load      = 0.0;     ///< average time as a fraction of the block's duration
+    };
+
+    ProcessTimer() = default;
+    ~ProcessTimer() = default;
+
+    /** Sets the sample rate used to work out block durations */
+    void prepare (double sampleRate) noexcept;
+
+    /** Returns the current high resolution tick count */
+    static int64 now() noexcept { return Time::getHighResolutionTicks(); }
+
+    /** Adds a block which started rendering at startTicks and just finished */
+    void addBlock (int64 startTicks, int numSamples) noexcept;
+
+    /** Returns the latest figures. Can be called from any thread */
+    Reading getReading() const noexcept;
+
+    /** Clears the figures. The render thread picks this up on its next block */
+    void reset() noexcept { resetPending.store (true, std::memory_order_relaxed); }
+
+    /** Times the scope it lives in when given a timer, does nothing otherwise */
+    struct Scope
+    {
+        Scope (ProcessTimer* t, int n) noexcept
+            : timer (t), numSamples (n), start (t != nullptr ? now() : 0) { }
+        ~Scope() noexcept { if (timer != nullptr) timer->addBlock (start, numSamples); }
+
+    private:
+        ProcessTimer* const timer;
+        const int numSamples;
+        const int64 start;
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+private:
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<float> last { 0.f }, average { 0.f }, maximum { 0.f }, load { 0.f };
+    std::atomic<bool> resetPending { false };
+
+    JUCE_DECLARE_NON_COPYABLE (ProcessTimer)
+};
+
+}
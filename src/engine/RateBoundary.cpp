@@ -0,0 +1,236 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "engine/RateBoundary.h"
+
+namespace Element {
+
+void RateBoundary::prepare (int newNumChannels, int newDivision, int newInnerBlockSize)
+{
+    numChannels     = jmax (1, newNumChannels);
+    division        = jlimit (1, (int) maxDivision, newDivision);
+    innerBlockSize  = jmax (1, newInnerBlockSize);
+    blockSize       = innerBlockSize * division;
+
+    if (division > 1)
+    {
+        // the centre lands on a multiple of the division, so decimated
+        // samples line up with the ones they came from
+        const int centre = (int) tapsPerDivision * division;
+        numTaps = 2 * centre + 1;
+        filterLatency = 2 * centre;
+        taps.allocate ((size_t) numTaps, true);
+
+        // cut a little below the inner rate's nyquist
+        const double cutoff = 0.45 / (double) division;
+        double sum = 0.0;
+        for (int k = 0; k < numTaps; ++k)
+        {
+            const double x = (double) (k - centre);
+            const double sinc = x == 0.0 ? 2.0 * cutoff
+                                         : std::sin (MathConstants<double>::twoPi * cutoff * x) / (MathConstants<double>::pi * x);
+            const double phase = MathConstants<double>::twoPi * (double) k / (double) (numTaps - 1);
+            const double window = 0.42 - 0.5 * std::cos (phase) + 0.08 * std::cos (2.0 * phase);
+            taps[k] = (float) (sinc * window);
+            sum += sinc * window;
+        }
+
+        for (int k = 0; k < numTaps; ++k)
+            taps[k] = (float) (taps[k] / sum);
+
+        decimating.setSize (numChannels, numTaps - 1 + blockSize);
+        interpolating.setSize (numChannels, numTaps - 1 + blockSize);
+    }
+    else
+    {
+        numTaps = filterLatency = 0;
+        taps.free();
+        decimating.setSize (1, 1);
+        interpolating.setSize (1, 1);
+    }
+
+    input.setSize (numChannels, blockSize);
+    output.setSize (numChannels, blockSize);
+    inner.setSize (numChannels, innerBlockSize);
+
+    MidiBudget::reserve (inputMidi);
+    MidiBudget::reserve (outputMidi);
+    MidiBudget::reserve (innerMidi);
+    MidiBudget::reserve (processedMidi);
+    reset();
+}
+
+void RateBoundary::release()
+{
+    numChannels = innerBlockSize = blockSize = 0;
+    division = 1;
+    numTaps = filterLatency = 0;
+    position = 0;
+    taps.free();
+    input.setSize (1, 1);
+    output.setSize (1, 1);
+    inner.setSize (1, 1);
+    decimating.setSize (1, 1);
+    interpolating.setSize (1, 1);
+    inputMidi.clear();
+    outputMidi.clear();
+    innerMidi.clear();
+    processedMidi.clear();
+}
+
+void RateBoundary::reset()
+{
+    input.clear();
+    output.clear();
+    inner.clear();
+    decimating.clear();
+    interpolating.clear();
+    inputMidi.clear();
+    outputMidi.clear();
+    innerMidi.clear();
+    inputWriter.reset (inputMidi);
+    position = 0;
+}
+
+void RateBoundary::process (AudioSampleBuffer& buffer, MidiBuffer& midi, const Renderer& render) noexcept
+{
+    if (! isPrepared())
+        return;
+
+    const int numSamples = buffer.getNumSamples();
+    const int numBufferChannels = jmin (numChannels, buffer.getNumChannels());
+    processedMidi.clear();
+    MidiBudget::Writer processed (processedMidi);
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        const int count = jmin (numSamples - offset, blockSize - position);
+        for (int ch = 0; ch < numBufferChannels; ++ch)
+        {
+            float* const data = buffer.getWritePointer (ch, offset);
+            FloatVectorOperations::copy (input.getWritePointer (ch, position), data, count);
+            FloatVectorOperations::copy (data, output.getReadPointer (ch, position), count);
+        }
+
+        inputWriter.addEvents (midi, offset, count, position - offset);
+        processed.addEvents (outputMidi, position, count, offset - position);
+
+        position += count;
+        offset += count;
+        if (position == blockSize)
+        {
+            renderInner (render);
+            position = 0;
+        }
+    }
+
+    for (int ch = numBufferChannels; ch < buffer.getNumChannels(); ++ch)
+        buffer.clear (ch, 0, numSamples);
+
+    midi.swapWith (processedMidi);
+}
+
+void RateBoundary::renderInner (const Renderer& render) noexcept
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        if (division > 1)
+            decimate (ch);
+        else
+            inner.copyFrom (ch, 0, input, ch, 0, blockSize);
+    }
+
+    const uint8* data = nullptr;
+    int numBytes = 0, frame = 0;
+
+    innerMidi.clear();
+    {
+        MidiBudget::Writer writer (innerMidi);
+        MidiBuffer::Iterator iter (inputMidi);
+        while (iter.getNextEvent (data, numBytes, frame))
+            writer.add (data, numBytes, frame / division);
+    }
+
+    inputMidi.clear();
+    inputWriter.reset (inputMidi);
+
+    render (inner, innerMidi);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        if (division > 1)
+            interpolate (ch);
+        else
+            output.copyFrom (ch, 0, inner, ch, 0, blockSize);
+    }
+
+    // MIDI is only delayed by the buffering, it doesn't go through the filters
+    outputMidi.clear();
+    MidiBudget::Writer writer (outputMidi);
+    MidiBuffer::Iterator iter (innerMidi);
+    while (iter.getNextEvent (data, numBytes, frame))
+        writer.add (data, numBytes, jlimit (0, blockSize - 1, frame * division));
+}
+
+void RateBoundary::decimate (int channel) noexcept
+{
+    const int history = numTaps - 1;
+    float* const samples = decimating.getWritePointer (channel);
+    FloatVectorOperations::copy (samples + history, input.getReadPointer (channel), blockSize);
+
+    float* const out = inner.getWritePointer (channel);
+    for (int i = 0; i < innerBlockSize; ++i)
+    {
+        const float* const x = samples + history + i * division;
+        float sum = 0.f;
+        for (int k = 0; k < numTaps; ++k)
+            sum += taps[k] * x[-k];
+        out[i] = sum;
+    }
+
+    std::memmove (samples, samples + blockSize, sizeof (float) * (size_t) history);
+}
+
+void RateBoundary::interpolate (int channel) noexcept
+{
+    const int history = numTaps - 1;
+    float* const samples = interpolating.getWritePointer (channel);
+    FloatVectorOperations::clear (samples + history, blockSize);
+
+    // zero stuffed, and scaled up to make up for the zeros
+    const float* const in = inner.getReadPointer (channel);
+    for (int i = 0; i < innerBlockSize; ++i)
+        samples [history + i * division] = in[i] * (float) division;
+
+    // only every division'th tap lands on a sample that isn't zero
+    float* const out = output.getWritePointer (channel);
+    for (int i = 0; i < blockSize; ++i)
+    {
+        const float* const x = samples + history + i;
+        float sum = 0.f;
+        for (int k = i % division; k < numTaps; k += division)
+            sum += taps[k] * x[-k];
+        out[i] = sum;
+    }
+
+    std::memmove (samples, samples + blockSize, sizeof (float) * (size_t) history);
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/MidiBudget.h"
+
+namespace Element {
+
+/** Buffers and resamples audio and MIDI at the edge of a graph rendering at
+    its own rate or block size.
+
+    Blocks coming in are gathered until there's enough for one block of the
+    inner graph. Those samples are decimated by an integer division, rendered
+    in one go and interpolated back, then played out while the next lot is
+    gathered. Output comes a whole gathered block later, plus the group delay
+    of the decimating and interpolating filters when the rate is divided,
+    which is what getLatencySamples reports.
+
+    The filters are linear phase windowed sincs, applied polyphase so only
+    the taps that land on real samples are summed.
+ */
+class RateBoundary
+{
+public:
+    /** Renders one inner block in place, at the inner rate */
+    using Renderer = std::function<void (AudioSampleBuffer&, MidiBuffer&)>;
+
+    enum
+    {
+        maxDivision         = 8,
+        tapsPerDivision     = 16    ///< filter taps either side of the centre, per step of the division
+    };
+
+    RateBoundary() = default;
+
+    /** Sizes the buffers and builds the filters. Not realtime safe */
+    void prepare (int numChannels, int division, int innerBlockSize);
+
+    /** Frees everything allocated when prepared */
+    void release();
+
+    /** Silences the buffers and the filters' history */
+    void reset();
+
+    bool isPrepared() const noexcept            { return blockSize > 0; }
+
+    /** Returns how many samples in go to one of the inner graph */
+    int getDivision() const noexcept            { return division; }
+
+    /** Returns the samples in an inner block, at the inner rate */
+    int getInnerBlockSize() const noexcept      { return innerBlockSize; }
+
+    /** Returns the samples gathered for each inner block */
+    int getBlockSize() const noexcept           { return blockSize; }
+
+    /** Returns the delay added by buffering and filtering */
+    int getLatencySamples() const noexcept      { return blockSize + filterLatency; }
+
+    /** Passes a block through, rendering whenever enough has been gathered */
+    void process (AudioSampleBuffer& buffer, MidiBuffer& midi, const Renderer& render) noexcept;
+
+private:
+    int numChannels = 0;
+    int division = 1;
+    int innerBlockSize = 0;
+    int blockSize = 0;
+    int numTaps = 0;
+    int filterLatency = 0;
+    int position = 0;
+
+    HeapBlock<float> taps;
+    AudioSampleBuffer input, output, inner;
+    // filter history followed by the block being filtered
+    AudioSampleBuffer decimating, interpolating;
+    MidiBuffer inputMidi, outputMidi, innerMidi, processedMidi;
+    MidiBudget::Writer inputWriter;
+
+    void renderInner (const Renderer& render) noexcept;
+    void decimate (int channel) noexcept;
+    void interpolate (int channel) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (RateBoundary)
+};
+
+}
@@ -0,0 +1,195 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/RealtimeSanitizer.h"
+
+#if EL_RTSAN
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+namespace Element {
+
+// the markers are read on every allocation of every thread, including
+// before main, so they're kept in static TLS and never constructed
+static thread_local int realtimeDepth   __attribute__ ((tls_model ("initial-exec"))) = 0;
+static thread_local int allowDepth      __attribute__ ((tls_model ("initial-exec"))) = 0;
+
+static std::atomic<int> numViolations { 0 };
+static SpinLock reportedLock;
+static Array<int64> reportedTraces;
+
+RealtimeSanitizer::ScopedRealtime::ScopedRealtime() noexcept     { ++realtimeDepth; }
+RealtimeSanitizer::ScopedRealtime::~ScopedRealtime() noexcept    { --realtimeDepth; }
+RealtimeSanitizer::ScopedAllow::ScopedAllow() noexcept           { ++allowDepth; }
+RealtimeSanitizer::ScopedAllow::~ScopedAllow() noexcept          { --allowDepth; }
+
+bool RealtimeSanitizer::isRealtimeThread() noexcept
+{
+    return realtimeDepth > 0 && allowDepth <= 0;
+}
+
+int RealtimeSanitizer::getNumViolations() noexcept
+{
+    return numViolations.load (std::memory_order_relaxed);
+}
+
+void RealtimeSanitizer::check (const char* function) noexcept
+{
+    if (! isRealtimeThread())
+        return;
+
+    // whatever reporting does is allowed, it's already too late for this block
+    const ScopedAllow allow;
+    numViolations.fetch_add (1, std::memory_order_relaxed);
+    const auto trace = SystemStats::getStackBacktrace();
+
+    {
+        const SpinLock::ScopedLockType sl (reportedLock);
+        const auto key = trace.hashCode64();
+        if (reportedTraces.contains (key))
+            return;
+        reportedTraces.add (key);
+    }
+
+    Logger::writeToLog (String ("[EL] rtsan: ") + function + " called on a realtime thread\n" + trace);
+    if (std::getenv ("ELEMENT_RTSAN_ABORT") != nullptr)
+        std::abort();
+}
+
+}
+
+#if JUCE_LINUX
+//=============================================================================
+// Definitions here take the place of glibc's for the whole process, plugins
+// included. Allocations are passed on to glibc's own entry points, which
+// never come back here, everything else is looked up once with dlsym
+
+extern "C" {
+
+void* __libc_malloc (size_t);
+void* __libc_calloc (size_t, size_t);
+void* __libc_realloc (void*, size_t);
+void* __libc_memalign (size_t, size_t);
+void  __libc_free (void*);
+
+template <typename Function>
+static Function findNext (std::atomic<void*>& cached, const char* name) noexcept
+{
+    auto* function = cached.load (std::memory_order_relaxed);
+    if (function == nullptr)
+    {
+        function = dlsym (RTLD_NEXT, name);
+        cached.store (function, std::memory_order_relaxed);
+    }
+    return reinterpret_cast<Function> (function);
+}
+
+#define EL_RTSAN_NEXT(name, type) \
+    static std::atomic<void*> next_##name { nullptr }; \
+    auto real_##name = findNext<type> (next_##name, #name);
+
+void* malloc (size_t size)
+{
+    Element::RealtimeSanitizer::check ("malloc");
+    return __libc_malloc (size);
+}
+
+void* calloc (size_t count, size_t size)
+{
+    Element::RealtimeSanitizer::check ("calloc");
+    return __libc_calloc (count, size);
+}
+
+void* realloc (void* ptr, size_t size)
+{
+    Element::RealtimeSanitizer::check ("realloc");
+    return __libc_realloc (ptr, size);
+}
+
+void* aligned_alloc (size_t alignment, size_t size)
+{
+    Element::RealtimeSanitizer::check ("aligned_alloc");
+    return __libc_memalign (alignment, size);
+}
+
+int posix_memalign (void** result, size_t alignment, size_t size)
+{
+    Element::RealtimeSanitizer::check ("posix_memalign");
+    if (alignment < sizeof (void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    *result = __libc_memalign (alignment, size);
+    return *result != nullptr ? 0 : ENOMEM;
+}
+
+void free (void* ptr)
+{
+    if (ptr != nullptr)
+        Element::RealtimeSanitizer::check ("free");
+    __libc_free (ptr);
+}
+
+// condition waits need their mutex locked first, so they're reported here too
+int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    Element::RealtimeSanitizer::check ("pthread_mutex_lock");
+    EL_RTSAN_NEXT (pthread_mutex_lock, int (*)(pthread_mutex_t*))
+    return real_pthread_mutex_lock (mutex);
+}
+
+int sem_wait (sem_t* semaphore)
+{
+    Element::RealtimeSanitizer::check ("sem_wait");
+    EL_RTSAN_NEXT (sem_wait, int (*)(sem_t*))
+    return real_sem_wait (semaphore);
+}
+
+int nanosleep (const struct timespec* duration, struct timespec* remaining)
+{
+    Element::RealtimeSanitizer::check ("nanosleep");
+    EL_RTSAN_NEXT (nanosleep, int (*)(const struct timespec*, struct timespec*))
+    return real_nanosleep (duration, remaining);
+}
+
+int usleep (useconds_t microseconds)
+{
+    Element::RealtimeSanitizer::check ("usleep");
+    EL_RTSAN_NEXT (usleep, int (*)(useconds_t))
+    return real_usleep (microseconds);
+}
+
+unsigned int sleep (unsigned int seconds)
+{
+    Element::RealtimeSanitizer::check ("sleep");
+    EL_RTSAN_NEXT (sleep, unsigned int (*)(unsigned int))
+    return real_sleep (seconds);
+}
+
+#undef EL_RTSAN_NEXT
+
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#ifndef EL_RTSAN
+ #define EL_RTSAN 0
+#endif
+
+namespace Element {
+
+/** Reports what threads marked realtime do that they must not.
+
+    Building with EL_RTSAN enabled (waf configure --rtsan) intercepts
+    malloc and free, mutex locks, semaphore waits and sleeps. Each call made while a thread is marked is logged once per call site
+    with a stack trace, and aborts the process if the ELEMENT_RTSAN_ABORT
+    environment variable is set. Interception works on Linux; elsewhere
+    threads are only marked. Without EL_RTSAN everything here compiles to
+    nothing.
+ */
+class RealtimeSanitizer
+{
+public:
+   #if EL_RTSAN
+    /** Marks the calling thread realtime while in scope. Scopes nest */
+    struct ScopedRealtime
+    {
+        ScopedRealtime() noexcept;
+        ~ScopedRealtime() noexcept;
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtime)
+    };
+
+    /** Lets a marked thread do anything while in scope, for code which is
+        known to be safe or already reported */
+    struct ScopedAllow
+    {
+        ScopedAllow() noexcept;
+        ~ScopedAllow() noexcept;
+        JUCE_DECLARE_NON_COPYABLE (ScopedAllow)
+    };
+
+    /** Returns true if the calling thread is marked and not allowed */
+    static bool isRealtimeThread() noexcept;
+
+    /** Returns the number of violations seen, including repeated ones */
+    static int getNumViolations() noexcept;
+
+    /** Reports a call to a function that isn't realtime safe if the calling
+        thread is marked. Interceptors call this, but so can code that knows
+        it's about to do something unsafe */
+    static void check (const char* function) noexcept;
+   #else
+    struct ScopedRealtime { ScopedRealtime() noexcept { } };
+    struct ScopedAllow    { ScopedAllow() noexcept { } };
+    static bool isRealtimeThread() noexcept             { return false; }
+    static int getNumViolations() noexcept              { return 0; }
+    static void check (const char*) noexcept            { }
+   #endif
+};
+
+}
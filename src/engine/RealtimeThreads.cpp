@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/RealtimeThreads.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <pthread.h>
+ #include <sys/mman.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#endif
+
+namespace Element {
+
+static std::atomic<uint64> sBackgroundMask { 0 };
+
+static int getNumCores()
+{
+    return jlimit (1, 64, SystemStats::getNumCpus());
+}
+
+bool RealtimeThreads::setCurrentThreadRealtime()
+{
+    // round robin on posix, time critical on windows
+    return Thread::setCurrentThreadPriority (10);
+}
+
+bool RealtimeThreads::setCurrentThreadAffinity (uint64 coreMask)
+{
+    if (coreMask == 0)
+        return false;
+
+   #if JUCE_LINUX
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    for (int i = 0; i < 64; ++i)
+        if ((coreMask & ((uint64) 1 << i)) != 0)
+            CPU_SET (i, &set);
+    return pthread_setaffinity_np (pthread_self(), sizeof (set), &set) == 0;
+   #elif JUCE_WINDOWS
+    return SetThreadAffinityMask (GetCurrentThread(), (DWORD_PTR) coreMask) != 0;
+   #else
+    // macOS only takes affinity hints between threads, not cores
+    return false;
+   #endif
+}
+
+bool RealtimeThreads::lockMemory (bool shouldLock)
+{
+   #if JUCE_LINUX || JUCE_MAC
+    return shouldLock ? mlockall (MCL_CURRENT | MCL_FUTURE) == 0
+                      : munlockall() == 0;
+   #else
+    // windows can only lock ranges, not the whole heap
+    return ! shouldLock;
+   #endif
+}
+
+int RealtimeThreads::getCoreForWorker (int workerIndex)
+{
+    const int numCores = getNumCores();
+    return numCores - 1 - (workerIndex % numCores);
+}
+
+uint64 RealtimeThreads::getBackgroundMask (int numWorkers)
+{
+    const int numCores = getNumCores();
+    const int numFree  = jmax (1, numCores - jmax (0, numWorkers));
+    return numFree >= 64 ? ~(uint64) 0 : (((uint64) 1 << numFree) - 1);
+}
+
+void RealtimeThreads::setBackgroundIsolation (uint64 coreMask)
+{
+    sBackgroundMask.store (coreMask, std::memory_order_relaxed);
+}
+
+uint64 RealtimeThreads::getBackgroundIsolation()
+{
+    return sBackgroundMask.load (std::memory_order_relaxed);
+}
+
+bool RealtimeThreads::applyBackgroundAffinity()
+{
+    const auto mask = sBackgroundMask.load (std::memory_order_relaxed);
+    if (mask == 0)
+        return true;
+    return setCurrentThreadAffinity (mask);
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Scheduling, CPU pinning and page locking for the engine's threads.
+
+    Everything here is best effort. Each call reports whether the system
+    went along with it, since most of it needs privileges a desktop user
+    might not have.
+ */
+struct RealtimeThreads
+{
+    /** Requests the highest realtime priority for the calling thread */
+    static bool setCurrentThreadRealtime();
+
+    /** Restricts the calling thread to the cores set in the mask */
+    static bool setCurrentThreadAffinity (uint64 coreMask);
+
+    /** Locks every current and future page of the process in RAM, or
+        unlocks them again */
+    static bool lockMemory (bool shouldLock);
+
+    /** The core a render worker is pinned to. Workers take cores from the
+        top down, leaving the lower ones for the device and everything else */
+    static int getCoreForWorker (int workerIndex);
+
+    /** Cores background threads are kept on while isolated from the given
+        number of render workers, or all of them when not isolated */
+    static uint64 getBackgroundMask (int numWorkers);
+
+    /** Sets the cores background threads should use from now on, zero for any */
+    static void setBackgroundIsolation (uint64 coreMask);
+
+    /** Returns the cores background threads are kept on, zero for any */
+    static uint64 getBackgroundIsolation();
+
+    /** Moves the calling thread onto the background cores. Background threads
+        call this when they start. Returns false if isolation is on and the
+        system refused */
+    static bool applyBackgroundAffinity();
+};
+
+}
@@ -0,0 +1,164 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "engine/GraphProcessor.h"
+#include "engine/RenderInspector.h"
+
+namespace Element {
+
+static String quoted (const String& text)
+{
+    return "\"" + text.replace ("\\", "\\\\").replace ("\"", "\\\"") + "\"";
+}
+
+static String getLabel (const var& op)
+{
+    const auto type = op["op"].toString();
+    StringArray lines;
+
+    if (op.hasProperty ("node"))
+    {
+        lines.add (op["name"].toString());
+        lines.add (type + " #" + op["node"].toString());
+        if ((int) op["latency"] > 0)
+            lines.add ("latency " + op["latency"].toString());
+        if ((int) op["oversampling"] > 1)
+            lines.add (op["oversampling"].toString() + "x oversampled");
+        if (auto* timing = op["timing"].getDynamicObject())
+            lines.add (String ((double) timing->getProperty ("average"), 3) + " ms avg, "
+                       + String ((double) timing->getProperty ("maximum"), 3) + " ms max");
+    }
+    else if (type == "delay")
+    {
+        lines.add (type);
+        StringArray delays;
+        if (auto* values = op["delays"].getArray())
+            for (const auto& value : *values)
+                delays.add (value.toString());
+        lines.add (delays.joinIntoString (", ") + " samples");
+    }
+    else
+    {
+        lines.add (type);
+        if (op.hasProperty ("source"))
+            lines.add (op["source"].toString() + " > " + op["dest"].toString());
+        else
+            lines.add (op["dest"].toString());
+    }
+
+    if (op.hasProperty ("stage"))
+        lines.add ("stage " + op["stage"].toString());
+
+    return lines.joinIntoString ("\\n");
+}
+
+static void addBuffers (const var& values, Array<int>& buffers)
+{
+    if (auto* array = values.getArray())
+        for (const auto& value : *array)
+            buffers.addIfNotAlreadyThere ((int) value);
+}
+
+String RenderInspector::toJSON (const var& info)
+{
+    return JSON::toString (info);
+}
+
+String RenderInspector::toDot (const var& info)
+{
+    String dot;
+    dot << "digraph " << quoted (info["graph"].toString()) << " {" << newLine
+        << "    rankdir=LR;" << newLine
+        << "    node [shape=box, fontname=\"monospace\", fontsize=10];" << newLine
+        << "    label=" << quoted (String (info["audioBuffers"].toString()) + " audio / "
+                                   + info["midiBuffers"].toString() + " midi buffers, latency "
+                                   + info["latency"].toString()) << ";" << newLine;
+
+    // the op that last wrote each shared buffer, audio zero is always silent
+    HashMap<int, int> audioWriters, midiWriters;
+    auto* const ops = info["ops"].getArray();
+    const int numOps = ops != nullptr ? ops->size() : 0;
+
+    for (int i = 0; i < numOps; ++i)
+    {
+        const auto& op = ops->getReference (i);
+        const auto type = op["op"].toString();
+        const bool buffer = ! op.hasProperty ("node") && type != "delay" && type != "mergeMidi";
+        const bool midi = type.endsWith ("Midi");
+
+        dot << "    op" << i << " [label=" << quoted (getLabel (op));
+        if (op.hasProperty ("node"))
+            dot << ", style=filled, fillcolor=\"#dde8f5\"";
+        else if (type == "delay")
+            dot << ", style=filled, fillcolor=\"#f5e6cc\"";
+        else if (buffer)
+            dot << ", shape=ellipse, fontsize=8";
+        dot << "];" << newLine;
+
+        if (i > 0)
+            dot << "    op" << (i - 1) << " -> op" << i << " [style=dashed, color=gray];" << newLine;
+
+        Array<int> audioRead, midiRead;
+        if (buffer)
+        {
+            auto& read = midi ? midiRead : audioRead;
+            if (op.hasProperty ("source"))
+                read.add ((int) op["source"]);
+            if (type.startsWith ("add"))
+                read.add ((int) op["dest"]);
+        }
+        else
+        {
+            addBuffers (op["audio"], audioRead);
+            addBuffers (op["midi"], midiRead);
+        }
+
+        for (const auto index : audioRead)
+            if (index != 0 && audioWriters.contains (index))
+                dot << "    op" << audioWriters [index] << " -> op" << i << " [label=\"a" << index << "\"];" << newLine;
+        for (const auto index : midiRead)
+            if (midiWriters.contains (index))
+                dot << "    op" << midiWriters [index] << " -> op" << i << " [label=\"m" << index << "\", color=\"#2a7\"];" << newLine;
+
+        if (buffer)
+        {
+            (midi ? midiWriters : audioWriters).set ((int) op["dest"], i);
+        }
+        else
+        {
+            for (const auto index : audioRead)
+                audioWriters.set (index, i);
+            for (const auto index : midiRead)
+                midiWriters.set (index, i);
+        }
+    }
+
+    dot << "}" << newLine;
+    return dot;
+}
+
+Result RenderInspector::exportTo (const GraphProcessor& graph, const File& file)
+{
+    const auto info = graph.getRenderProgramInfo();
+    const auto text = file.hasFileExtension ("dot") ? toDot (info) : toJSON (info);
+    if (! file.replaceWithText (text))
+        return Result::fail ("Could not write " + file.getFullPathName());
+    return Result::ok();
+}
+
+}
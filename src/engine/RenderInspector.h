@@ -0,0 +1,48 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class GraphProcessor;
+
+/** Exports what a graph's render program does, as GraphProcessor::getRenderProgramInfo()
+    describes it, for looking at outside the engine.
+
+    The JSON form is the description itself. The DOT form draws each op as a
+    box in render order, with solid edges from the op that last wrote a
+    shared buffer to the ops that read it, so buffer reuse and latency delays
+    show up as they render.
+ */
+struct RenderInspector
+{
+    /** Returns the description as JSON */
+    static String toJSON (const var& info);
+
+    /** Returns the description as a Graphviz digraph */
+    static String toDot (const var& info);
+
+    /** Writes the graph's current program to a file, as DOT if it has a .dot
+        extension and JSON otherwise. Call this from the message thread */
+    static Result exportTo (const GraphProcessor& graph, const File& file);
+};
+
+}
@@ -0,0 +1,72 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+namespace GraphRender {
+
+class Task;
+
+/** A single step of a compiled rendering sequence.
+
+    Buffer operations carry their operands inline so the render loop never
+    leaves the instruction array for them. Stateful ops such as latency
+    delays and node processing are referenced through their task.
+ */
+struct Instruction
+{
+    enum Opcode
+    {
+        clearAudio = 0,
+        copyAudio,
+        addAudio,
+        clearMidi,
+        copyMidi,
+        addMidi,
+        performTask
+    };
+
+    int opcode  = performTask;
+    int source  = 0;
+    int dest    = 0;
+    Task* task  = nullptr;
+};
+
+/** Renders instructions in the range [begin, end) using the shared buffers.
+
+    silentBuffers holds one flag per shared audio buffer which is non-zero
+    while that buffer is known to contain only zeros. Clears and copies of
+    silent buffers are skipped and the flags are kept up to date as the
+    instructions run.
+ */
+void renderInstructions (const Instruction* begin, const Instruction* end,
+                         AudioSampleBuffer& audio, const OwnedArray<MidiBuffer>& midi,
+                         const int numSamples, uint8* silentBuffers) noexcept;
+
+/** Double precision version of renderInstructions() for graphs rendering
+    with 64-bit shared buffers */
+void renderInstructions (const Instruction* begin, const Instruction* end,
+                         AudioBuffer<double>& audio, const OwnedArray<MidiBuffer>& midi,
+                         const int numSamples, uint8* silentBuffers) noexcept;
+
+}
+}
@@ -0,0 +1,312 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/CombFilterProcessor.h"
+#include "engine/nodes/CompressorProcessor.h"
+#include "engine/nodes/EQFilterProcessor.h"
+#include "engine/nodes/ReverbProcessor.h"
+#include "engine/nodes/VolumeProcessor.h"
+#include "engine/GraphNode.h"
+#include "engine/GraphProcessor.h"
+#include "engine/RenderRegression.h"
+#include "engine/RenderThreadPool.h"
+
+namespace Element {
+
+typedef GraphProcessor::AudioGraphIOProcessor IOProcessor;
+
+/** Branches in the wide session, enough to keep several workers busy */
+static const int numWideBranches = 8;
+
+static GraphNodePtr addPrepared (GraphProcessor& graph, AudioProcessor* processor)
+{
+    GraphNodePtr node = graph.addNode (processor);
+    graph.prepareToPlay (graph.getSampleRate(), graph.getBlockSize());
+    return node;
+}
+
+static bool buildSession (GraphProcessor& graph, const String& name)
+{
+    GraphNodePtr input  = addPrepared (graph, new IOProcessor (IOProcessor::audioInputNode));
+    GraphNodePtr output = addPrepared (graph, new IOProcessor (IOProcessor::audioOutputNode));
+
+    if (name == "chain")
+    {
+        GraphNodePtr eq         = addPrepared (graph, new EQFilterProcessor (2));
+        GraphNodePtr compressor = addPrepared (graph, new CompressorProcessor (2));
+        GraphNodePtr volume     = addPrepared (graph, new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (eq);
+        eq->connectAudioTo (compressor);
+        compressor->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+    }
+    else if (name == "wide")
+    {
+        for (int i = 0; i < numWideBranches; ++i)
+        {
+            GraphNodePtr comb   = addPrepared (graph, new CombFilterProcessor (true));
+            GraphNodePtr volume = addPrepared (graph, new VolumeProcessor (-60.0, 12.0, true));
+            input->connectAudioTo (comb);
+            comb->connectAudioTo (volume);
+            volume->connectAudioTo (output);
+        }
+    }
+    else if (name == "reverb")
+    {
+        GraphNodePtr reverb = addPrepared (graph, new ReverbProcessor());
+        GraphNodePtr dry    = addPrepared (graph, new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (reverb);
+        input->connectAudioTo (dry);
+        reverb->connectAudioTo (output);
+        dry->connectAudioTo (output);
+    }
+    else
+    {
+        return false;
+    }
+
+    graph.prepareToPlay (graph.getSampleRate(), graph.getBlockSize());
+    return true;
+}
+
+/** The same input for every render: a sine sweep with seeded noise on top */
+static void fillInput (AudioSampleBuffer& audio, int block, Random& random)
+{
+    const int numSamples = audio.getNumSamples();
+    for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+    {
+        auto* data = audio.getWritePointer (ch);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double phase = (double) (block * numSamples + i) * 0.01 * (1.0 + ch);
+            data[i] = 0.5f * (float) std::sin (phase) + 0.05f * (random.nextFloat() * 2.f - 1.f);
+        }
+    }
+}
+
+/** Renders a session once, writing its output to the stream. Returns the
+    average milliseconds spent per block, or -1 if there is no such session */
+static double renderSession (const String& session, RenderRegression::Scheduler scheduler,
+                             const RenderRegression::Options& options, OutputStream& rendered)
+{
+    RenderThreadPool pool;
+    GraphProcessor graph;
+    graph.setPlayConfigDetails (2, 2, options.sampleRate, options.blockSize);
+    if (scheduler == RenderRegression::parallelScheduler)
+    {
+        pool.setNumWorkers (jmax (1, options.numWorkers));
+        graph.setRenderThreadPool (&pool);
+        graph.setParallelRenderingEnabled (true);
+    }
+
+    if (! buildSession (graph, session))
+    {
+        graph.setRenderThreadPool (nullptr);
+        return -1.0;
+    }
+
+    graph.setNonRealtime (true);
+    AudioSampleBuffer audio (2, options.blockSize);
+    MidiBuffer midi;
+    Random random (1234);
+    GraphNodePtr extra;
+    int64 ticks = 0;
+
+    for (int block = 0; block < options.numBlocks; ++block)
+    {
+        // an unconnected node added and removed again rebuilds the
+        // sequence twice, carrying every other op over
+        if (scheduler == RenderRegression::incrementalScheduler && block == options.numBlocks / 2)
+        {
+            extra = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            graph.handleUpdateNowIfNeeded();
+        }
+        else if (extra != nullptr)
+        {
+            graph.removeNode (extra->nodeId);
+            graph.handleUpdateNowIfNeeded();
+            extra = nullptr;
+        }
+
+        fillInput (audio, block, random);
+        midi.clear();
+
+        const auto start = Time::getHighResolutionTicks();
+        graph.processBlock (audio, midi);
+        ticks += Time::getHighResolutionTicks() - start;
+
+        for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+            rendered.write (audio.getReadPointer (ch), sizeof (float) * (size_t) options.blockSize);
+    }
+
+    graph.setNonRealtime (false);
+    graph.releaseResources();
+    graph.setRenderThreadPool (nullptr);
+    graph.clear();
+
+    const double msPerTick = 1.0e3 / (double) Time::getHighResolutionTicksPerSecond();
+    return (double) ticks * msPerTick / (double) jmax (1, options.numBlocks);
+}
+
+//=============================================================================
+RenderRegression::RenderRegression (const Options& o)
+    : options (o) { }
+
+RenderRegression::~RenderRegression() { }
+
+StringArray RenderRegression::getSessionNames()
+{
+    return { "chain", "wide", "reverb" };
+}
+
+String RenderRegression::getSchedulerName (Scheduler scheduler)
+{
+    switch (scheduler)
+    {
+        case serialScheduler:       return "serial";
+        case parallelScheduler:     return "parallel";
+        case incrementalScheduler:  return "incremental";
+        default: break;
+    }
+
+    return {};
+}
+
+RenderRegression::Outcome RenderRegression::render (const String& session, Scheduler scheduler) const
+{
+    Outcome outcome;
+    outcome.session = session;
+    outcome.scheduler = scheduler;
+
+    MemoryOutputStream rendered;
+    for (int run = 0; run < jmax (1, options.numRuns); ++run)
+    {
+        // every run builds the session afresh, so nothing carries over between them
+        rendered.reset();
+        const double ms = renderSession (session, scheduler, options, rendered);
+        if (ms < 0.0)
+            return outcome;
+        outcome.msPerBlock = run == 0 ? ms : jmin (outcome.msPerBlock, ms);
+    }
+
+    outcome.hash = MD5 (rendered.getData(), rendered.getDataSize()).toHexString();
+    return outcome;
+}
+
+void RenderRegression::run()
+{
+    outcomes.clearQuick();
+    for (const auto& session : getSessionNames())
+        for (int i = 0; i < numSchedulers; ++i)
+            outcomes.add (render (session, static_cast<Scheduler> (i)));
+}
+
+StringArray RenderRegression::getNondeterministicSessions() const
+{
+    StringArray sessions;
+    for (const auto& outcome : outcomes)
+        for (const auto& other : outcomes)
+            if (outcome.session == other.session && outcome.hash != other.hash)
+                sessions.addIfNotAlreadyThere (outcome.session);
+    return sessions;
+}
+
+void RenderRegression::compareWithBaseline (const var& baseline)
+{
+    const bool comparable = (double) baseline["sampleRate"] == options.sampleRate
+                         && (int) baseline["blockSize"] == options.blockSize;
+
+    for (auto& outcome : outcomes)
+    {
+        outcome.baselineMs = 0.0;
+        outcome.baselineHash = String();
+        outcome.slower = false;
+        if (! comparable)
+            continue;
+
+        if (const auto* results = baseline["results"].getArray())
+        {
+            for (const auto& result : *results)
+            {
+                if (result["session"].toString() != outcome.session
+                     || result["scheduler"].toString() != getSchedulerName (outcome.scheduler))
+                    continue;
+
+                outcome.baselineMs = (double) result["msPerBlock"];
+                outcome.baselineHash = result["hash"].toString();
+                outcome.slower = outcome.baselineMs > 0.0
+                    && outcome.msPerBlock > outcome.baselineMs * (1.0 + options.slowdownThreshold);
+                break;
+            }
+        }
+    }
+}
+
+int RenderRegression::getNumSlowdowns() const
+{
+    int count = 0;
+    for (const auto& outcome : outcomes)
+        if (outcome.slower)
+            ++count;
+    return count;
+}
+
+int RenderRegression::getNumChanges() const
+{
+    int count = 0;
+    for (const auto& outcome : outcomes)
+        if (outcome.hasChanged())
+            ++count;
+    return count;
+}
+
+var RenderRegression::createReport() const
+{
+    Array<var> results;
+    for (const auto& outcome : outcomes)
+    {
+        auto* obj = new DynamicObject();
+        obj->setProperty ("session", outcome.session);
+        obj->setProperty ("scheduler", getSchedulerName (outcome.scheduler));
+        obj->setProperty ("hash", outcome.hash);
+        obj->setProperty ("msPerBlock", outcome.msPerBlock);
+        if (outcome.baselineMs > 0.0)
+        {
+            obj->setProperty ("baselineMs", outcome.baselineMs);
+            obj->setProperty ("slower", outcome.slower);
+        }
+        if (outcome.baselineHash.isNotEmpty())
+            obj->setProperty ("changed", outcome.hasChanged());
+        results.add (var (obj));
+    }
+
+    auto* report = new DynamicObject();
+    report->setProperty ("version", ProjectInfo::versionString);
+    report->setProperty ("sampleRate", options.sampleRate);
+    report->setProperty ("blockSize", options.blockSize);
+    report->setProperty ("numBlocks", options.numBlocks);
+    report->setProperty ("slowdownThreshold", options.slowdownThreshold);
+    report->setProperty ("nondeterministic", getNondeterministicSessions().joinIntoString (","));
+    report->setProperty ("slowdowns", getNumSlowdowns());
+    report->setProperty ("changes", getNumChanges());
+    report->setProperty ("results", results);
+    return var (report);
+}
+
+}
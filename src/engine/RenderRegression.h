@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Renders canned graphs of internal nodes offline and checks that every
+    scheduler produces the same output, as fast as before.
+
+    Each session is rendered with the serial and parallel schedulers and
+    serially again with the graph rebuilt halfway through, so that ops are
+    carried over between sequences. Outputs are hashed sample for sample,
+    a session whose hashes differ between schedulers isn't deterministic.
+    Timings are the best of several runs and can be compared against a
+    baseline from an earlier report to flag slowdowns.
+ */
+class RenderRegression
+{
+public:
+    enum Scheduler
+    {
+        serialScheduler = 0,
+        parallelScheduler,
+        incrementalScheduler,
+        numSchedulers
+    };
+
+    struct Options
+    {
+        double sampleRate           = 48000.0;
+        int blockSize               = 256;
+        int numBlocks               = 400;
+        int numRuns                 = 3;        ///< timings are the best of this many renders
+        int numWorkers              = 3;        ///< render threads used by the parallel scheduler
+        double slowdownThreshold    = 0.15;     ///< fraction slower than the baseline that's flagged
+    };
+
+    struct Outcome
+    {
+        String session;
+        Scheduler scheduler = serialScheduler;
+        String hash;
+        double msPerBlock = 0.0;
+        double baselineMs = 0.0;                ///< zero when the baseline doesn't have it
+        String baselineHash;
+        bool slower = false;
+
+        /** Returns true if a baseline hash was found and it differs */
+        bool hasChanged() const noexcept { return baselineHash.isNotEmpty() && baselineHash != hash; }
+    };
+
+    explicit RenderRegression (const Options& options = Options());
+    ~RenderRegression();
+
+    /** Returns the names of the canned sessions */
+    static StringArray getSessionNames();
+
+    /** Returns the name a scheduler is reported as */
+    static String getSchedulerName (Scheduler scheduler);
+
+    /** Renders one session with a scheduler */
+    Outcome render (const String& session, Scheduler scheduler) const;
+
+    /** Renders every session with every scheduler */
+    void run();
+
+    /** Returns what the last run produced */
+    const Array<Outcome>& getOutcomes() const noexcept { return outcomes; }
+
+    /** Returns the sessions whose output depended on the scheduler */
+    StringArray getNondeterministicSessions() const;
+
+    /** Looks up each outcome in a report written earlier, flagging those slower
+        than the threshold allows. Sessions are only compared when they were
+        rendered with the same sample rate and block size */
+    void compareWithBaseline (const var& baseline);
+
+    /** Returns the number of outcomes flagged slower than the baseline */
+    int getNumSlowdowns() const;
+
+    /** Returns the number of outcomes whose hash differs from the baseline */
+    int getNumChanges() const;
+
+    /** Returns a report of the last run, which can be used as a baseline */
+    var createReport() const;
+
+    const Options& getOptions() const noexcept { return options; }
+
+private:
+    const Options options;
+    Array<Outcome> outcomes;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderRegression)
+};
+
+}
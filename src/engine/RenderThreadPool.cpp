@@ -0,0 +1,334 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/RealtimeSanitizer.h"
+#include "engine/RealtimeThreads.h"
+#include "engine/RenderThreadPool.h"
+
+namespace Element {
+
+//=============================================================================
+void RenderJob::setNumStages (int newNumStages)
+{
+    numStages = jmax (0, newNumStages);
+    dependencyCounts.calloc ((size_t) jmax (1, numStages));
+    pending.allocate ((size_t) jmax (1, numStages), true);
+    readyQueue.allocate ((size_t) jmax (1, numStages), true);
+    costs.calloc ((size_t) jmax (1, numStages));
+    priorities.calloc ((size_t) jmax (1, numStages));
+    roots.calloc ((size_t) jmax (1, numStages));
+    dependents.clearQuick();
+    dependents.resize (numStages);
+}
+
+void RenderJob::addDependency (int sourceStage, int dependentStage)
+{
+    jassert (isPositiveAndBelow (sourceStage, numStages));
+    jassert (isPositiveAndBelow (dependentStage, numStages));
+    jassert (sourceStage < dependentStage);
+    auto& list = dependents.getReference (sourceStage);
+    if (list.contains (dependentStage))
+        return;
+    list.add (dependentStage);
+    ++dependencyCounts[dependentStage];
+}
+
+double RenderJob::getStageCost (int stage) const noexcept
+{
+    return isPositiveAndBelow (stage, numStages) ? costs[stage] : 0.0;
+}
+
+double RenderJob::getStagePriority (int stage) const noexcept
+{
+    return isPositiveAndBelow (stage, numStages) ? priorities[stage] : 0.0;
+}
+
+void RenderJob::updatePriorities() noexcept
+{
+    // dependents always come after their sources, so one pass from the back
+    // sees every dependent first. a tick per stage lets the longer chain
+    // win before anything has been timed
+    for (int i = numStages; --i >= 0;)
+    {
+        double longest = 0.0;
+        for (const auto dependent : dependents.getReference (i))
+            longest = jmax (longest, priorities[dependent]);
+        priorities[i] = costs[i] + 1.0 + longest;
+    }
+}
+
+void RenderJob::begin() noexcept
+{
+    for (int i = 0; i < numStages; ++i)
+    {
+        pending[i].store (dependencyCounts[i]);
+        readyQueue[i].store (-1);
+    }
+
+    queueHead.store (0);
+    queueTail.store (0);
+    remaining.store (numStages);
+    updatePriorities();
+
+    // the stages that are ready right away, most critical first
+    int numRoots = 0;
+    for (int i = 0; i < numStages; ++i)
+    {
+        if (dependencyCounts[i] != 0)
+            continue;
+        int slot = numRoots++;
+        for (; slot > 0 && priorities[roots[slot - 1]] < priorities[i]; --slot)
+            roots[slot] = roots[slot - 1];
+        roots[slot] = i;
+    }
+
+    for (int i = 0; i < numRoots; ++i)
+        push (roots[i]);
+}
+
+void RenderJob::push (int stage) noexcept
+{
+    // every stage is pushed exactly once per cycle, so the queue can never overflow
+    const int slot = queueTail.fetch_add (1);
+    jassert (slot < numStages);
+    readyQueue[slot].store (stage);
+}
+
+int RenderJob::pop() noexcept
+{
+    int head = queueHead.load();
+    while (head < queueTail.load())
+    {
+        if (queueHead.compare_exchange_weak (head, head + 1))
+        {
+            // the slot was reserved but might not be published yet
+            int stage = -1;
+            while ((stage = readyQueue[head].load()) < 0) {}
+            return stage;
+        }
+    }
+
+    return -1;
+}
+
+int RenderJob::run (int stage) noexcept
+{
+    const auto started = Time::getHighResolutionTicks();
+    renderStage (stage);
+    const auto elapsed = (double) (Time::getHighResolutionTicks() - started);
+
+    // only this thread touches the stage's cost until the job is finished
+    auto& cost = costs[stage];
+    cost = cost <= 0.0 ? elapsed : cost + (elapsed - cost) * 0.125;
+
+    // keep the most critical released dependent, queue the others
+    int next = -1;
+    for (const auto dependent : dependents.getReference (stage))
+    {
+        if (pending[dependent].fetch_sub (1) != 1)
+            continue;
+        if (next < 0)
+        {
+            next = dependent;
+        }
+        else if (priorities[dependent] > priorities[next])
+        {
+            push (next);
+            next = dependent;
+        }
+        else
+        {
+            push (dependent);
+        }
+    }
+
+    remaining.fetch_sub (1);
+    return next;
+}
+
+//=============================================================================
+class RenderThreadPool::Worker : public Thread
+{
+public:
+    Worker (RenderThreadPool& p, int i)
+        : Thread ("element.render." + String (i)),
+          pool (p), index (i) { }
+
+    ~Worker()
+    {
+        signalThreadShouldExit();
+        wakeUp();
+        stopThread (1000);
+    }
+
+    void wakeUp() noexcept { event.signal(); }
+
+    void run() override
+    {
+        pool.configureWorker (*this);
+        pool.workerLoop (*this);
+    }
+
+private:
+    friend class RenderThreadPool;
+    RenderThreadPool& pool;
+    int index = 0;
+    WaitableEvent event;
+    uint32 lastGeneration = 0;
+};
+
+//=============================================================================
+RenderThreadPool::RenderThreadPool() { }
+
+RenderThreadPool::~RenderThreadPool()
+{
+    workers.clear();
+}
+
+int RenderThreadPool::getDefaultNumWorkers()
+{
+    return jlimit (0, 16, SystemStats::getNumCpus() - 1);
+}
+
+void RenderThreadPool::setNumWorkers (int newNumWorkers)
+{
+    newNumWorkers = jlimit (0, 64, newNumWorkers);
+    if (newNumWorkers == workers.size())
+        return;
+
+    startWorkers (newNumWorkers);
+}
+
+void RenderThreadPool::setThreadOptions (bool realtimePriority, bool pinToCores)
+{
+    if (realtime == realtimePriority && pinned == pinToCores)
+        return;
+
+    realtime = realtimePriority;
+    pinned = pinToCores;
+    startWorkers (workers.size());
+}
+
+void RenderThreadPool::startWorkers (int numWorkers)
+{
+    jassert (currentJob.load() == nullptr);
+    workers.clear();
+    numRealtimeWorkers.store (0);
+    numPinnedWorkers.store (0);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* worker = workers.add (new Worker (*this, i));
+        worker->lastGeneration = generation.load();
+        worker->startThread (9);
+    }
+}
+
+void RenderThreadPool::configureWorker (Worker& worker)
+{
+    if (realtime && RealtimeThreads::setCurrentThreadRealtime())
+        numRealtimeWorkers.fetch_add (1);
+    if (pinned && RealtimeThreads::setCurrentThreadAffinity (
+            (uint64) 1 << RealtimeThreads::getCoreForWorker (worker.index)))
+        numPinnedWorkers.fetch_add (1);
+}
+
+bool RenderThreadPool::isWorkerThread() const noexcept
+{
+    auto* const thread = Thread::getCurrentThread();
+    if (thread == nullptr)
+        return false;
+    for (const auto* worker : workers)
+        if (worker == thread)
+            return true;
+    return false;
+}
+
+bool RenderThreadPool::isRenderingThread() const noexcept
+{
+    return renderingThread.load() == Thread::getCurrentThreadId() || isWorkerThread();
+}
+
+void RenderThreadPool::render (RenderJob& job) noexcept
+{
+    if (job.getNumStages() <= 0)
+        return;
+
+    job.begin();
+
+    // a job started from a stage of another would take over the workers
+    // that job is waiting on, so the thread renders it on its own
+    if (workers.isEmpty() || job.getNumStages() == 1 || isRenderingThread())
+    {
+        runJob (job);
+        return;
+    }
+
+    renderingThread.store (Thread::getCurrentThreadId());
+    currentJob.store (&job);
+    generation.fetch_add (1);
+    for (auto* worker : workers)
+        worker->wakeUp();
+
+    runJob (job);
+
+    // make sure no worker still holds a reference to the job before
+    // handing it back to the graph
+    currentJob.store (nullptr);
+    while (numActiveWorkers.load() > 0) {}
+    renderingThread.store (nullptr);
+}
+
+void RenderThreadPool::runJob (RenderJob& job) noexcept
+{
+    RealtimeSanitizer::ScopedRealtime realtime;
+    while (! job.isFinished())
+        for (int stage = job.pop(); stage >= 0;)
+            stage = job.run (stage);
+}
+
+void RenderThreadPool::workerLoop (Worker& worker)
+{
+    constexpr int numSpinsBeforeSleeping = 4000;
+    int spins = 0;
+
+    while (! worker.threadShouldExit())
+    {
+        const auto gen = generation.load();
+        if (gen != worker.lastGeneration)
+        {
+            worker.lastGeneration = gen;
+            spins = 0;
+
+            numActiveWorkers.fetch_add (1);
+            if (auto* job = currentJob.load())
+                runJob (*job);
+            numActiveWorkers.fetch_sub (1);
+            continue;
+        }
+
+        if (++spins < numSpinsBeforeSleeping)
+            continue;
+
+        worker.event.wait (10);
+        spins = 0;
+    }
+}
+
+}
@@ -0,0 +1,156 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A job that can be split into independent stages and rendered on several
+    threads at once. Stages are released by the job itself as their
+    dependencies complete, so the pool only needs to know how to run them.
+
+    The job times every stage it runs and keeps a moving average of each.
+    Ready stages on the longest remaining path, by those times, go first,
+    and a thread finishing a stage carries on with the most critical of
+    the dependents it released. Long chains start early instead of waiting
+    behind short branches that happened to come first.
+ */
+class RenderJob
+{
+public:
+    RenderJob() = default;
+    virtual ~RenderJob() = default;
+
+    /** Returns the number of stages in this job */
+    int getNumStages() const noexcept { return numStages; }
+
+    /** Returns the average time a stage took to render, in high resolution
+        ticks. Zero until it has been rendered by a pool */
+    double getStageCost (int stage) const noexcept;
+
+    /** Returns the time from the start of a stage until the end of the
+        longest chain of stages depending on it, from the last render */
+    double getStagePriority (int stage) const noexcept;
+
+protected:
+    /** Render a single stage. Called from the audio thread or a worker */
+    virtual void renderStage (int stage) noexcept = 0;
+
+    /** Allocate space for the given number of stages. Not realtime safe */
+    void setNumStages (int newNumStages);
+
+    /** Make the dependent stage wait for the source stage to complete */
+    void addDependency (int sourceStage, int dependentStage);
+
+private:
+    friend class RenderThreadPool;
+
+    int numStages = 0;
+    HeapBlock<int> dependencyCounts;
+    HeapBlock<std::atomic<int>> pending;
+    HeapBlock<std::atomic<int>> readyQueue;
+    Array<Array<int>> dependents;
+    std::atomic<int> queueHead { 0 };
+    std::atomic<int> queueTail { 0 };
+    std::atomic<int> remaining { 0 };
+    HeapBlock<double> costs, priorities;
+    HeapBlock<int> roots;
+
+    void begin() noexcept;
+    void updatePriorities() noexcept;
+    void push (int stage) noexcept;
+    int pop() noexcept;
+    bool isFinished() const noexcept { return remaining.load() <= 0; }
+
+    /** Renders a stage and releases its dependents. Returns the one this
+        thread should render next, or -1 */
+    int run (int stage) noexcept;
+};
+
+/** Realtime safe pool of worker threads used to render the independent
+    parts of a graph concurrently.
+
+    The thread calling render() takes part in the work and does not return
+    until every stage of the job has been rendered.  Nothing is allocated and
+    no locks are taken while a job runs; idle workers spin briefly before
+    going to sleep.
+
+    A job rendered from inside a stage of another, by a worker or by the
+    thread that started the outer job, is rendered by that thread alone.
+ */
+class RenderThreadPool
+{
+public:
+    RenderThreadPool();
+    ~RenderThreadPool();
+
+    /** Returns a sensible default worker count for this machine */
+    static int getDefaultNumWorkers();
+
+    /** Change the number of worker threads.  This will stop and restart the
+        workers, so don't call it while a job is rendering. */
+    void setNumWorkers (int newNumWorkers);
+
+    /** Returns the number of worker threads */
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    /** Workers can ask for realtime priority and be pinned to a core of their
+        own, see RealtimeThreads. Changing this restarts the workers, so don't
+        call it while a job is rendering. */
+    void setThreadOptions (bool realtimePriority, bool pinToCores);
+
+    /** Returns how many workers got realtime priority when they started */
+    int getNumRealtimeWorkers() const noexcept { return numRealtimeWorkers.load(); }
+
+    /** Returns how many workers were pinned to their core when they started */
+    int getNumPinnedWorkers() const noexcept { return numPinnedWorkers.load(); }
+
+    /** Render a job using the calling thread and all workers. */
+    void render (RenderJob& job) noexcept;
+
+    /** Returns true if the calling thread is one of this pool's workers */
+    bool isWorkerThread() const noexcept;
+
+    /** Returns true if the calling thread is rendering a job on this pool,
+        as a worker or as the thread that called render(). Jobs it starts
+        now can't use the workers */
+    bool isRenderingThread() const noexcept;
+
+private:
+    class Worker;
+    OwnedArray<Worker> workers;
+    std::atomic<RenderJob*> currentJob { nullptr };
+    std::atomic<Thread::ThreadID> renderingThread { nullptr };
+    std::atomic<int> numActiveWorkers { 0 };
+    std::atomic<uint32> generation { 0 };
+    bool realtime = false, pinned = false;
+    std::atomic<int> numRealtimeWorkers { 0 };
+    std::atomic<int> numPinnedWorkers { 0 };
+
+    void startWorkers (int numWorkers);
+    void configureWorker (Worker&);
+    void runJob (RenderJob&) noexcept;
+    void workerLoop (Worker&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderThreadPool)
+};
+
+}
@@ -0,0 +1,159 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/GraphNode.h"
+#include "engine/GraphProcessor.h"
+#include "engine/RigSnapshot.h"
+
+namespace Element {
+
+struct RigSnapshot::NodeState
+{
+    Array<uint32> path;
+    bool hasState = false;
+    MemoryBlock state;
+    float gain = 1.f, inputGain = 1.f;
+    bool muted = false, mutingInputs = false, bypassed = false;
+};
+
+struct RigSnapshot::Recall::Target
+{
+    GraphNodePtr node;
+    const NodeState* state;
+};
+
+//=============================================================================
+RigSnapshot::~RigSnapshot() { }
+
+RigSnapshot::Ptr RigSnapshot::capture (GraphProcessor& graph, const String& name)
+{
+    Ptr snapshot = new RigSnapshot();
+    snapshot->name = name;
+    snapshot->captureGraph (graph, {});
+    return snapshot;
+}
+
+void RigSnapshot::captureGraph (GraphProcessor& graph, const Array<uint32>& parent)
+{
+    for (int i = 0; i < graph.getNumNodes(); ++i)
+    {
+        auto* const node = graph.getNode (i);
+        auto* const state = nodes.add (new NodeState());
+        state->path = parent;
+        state->path.add (node->nodeId);
+        state->gain         = node->getGain();
+        state->inputGain    = node->getInputGain();
+        state->muted        = node->isMuted();
+        state->mutingInputs = node->isMutingInputs();
+        state->bypassed     = node->isSuspended();
+
+        // a graph's sound is its nodes
+        if (auto* const sub = node->processor<GraphProcessor>())
+        {
+            captureGraph (*sub, state->path);
+            continue;
+        }
+
+        node->getState (state->state);
+        state->hasState = true;
+    }
+}
+
+size_t RigSnapshot::getSizeInBytes() const noexcept
+{
+    size_t bytes = 0;
+    for (const auto* state : nodes)
+        bytes += state->state.getSize();
+    return bytes;
+}
+
+RigSnapshot::Recall RigSnapshot::prepare (GraphProcessor& graph)
+{
+    return Recall (graph, this);
+}
+
+int RigSnapshot::recall (GraphProcessor& graph)
+{
+    return prepare (graph).apply();
+}
+
+//=============================================================================
+RigSnapshot::Recall::Recall (GraphProcessor& g, Ptr s)
+    : graph (g), snapshot (s)
+{
+    for (const auto* state : snapshot->nodes)
+    {
+        GraphProcessor* parent = &graph;
+        GraphNode* node = nullptr;
+        for (const auto nodeId : state->path)
+        {
+            node = parent != nullptr ? parent->getNodeForId (nodeId) : nullptr;
+            if (node == nullptr)
+                break;
+            parent = node->processor<GraphProcessor>();
+        }
+
+        if (node != nullptr)
+            targets.add (new Target { node, state });
+    }
+}
+
+RigSnapshot::Recall::Recall (Recall&&) = default;
+RigSnapshot::Recall::~Recall() { }
+
+int RigSnapshot::Recall::apply()
+{
+    // plugins can take a while to load a state, so they load outside the
+    // callback lock and keep rendering the old one meanwhile, as they do for
+    // program changes. each switches over once its own state is in
+    for (const auto* target : targets)
+    {
+        const auto& state = *target->state;
+        if (state.hasState)
+            target->node->setState (state.state.getData(), (int) state.state.getSize());
+    }
+
+    {
+        const ScopedLock sl (graph.getCallbackLock());
+        for (const auto* target : targets)
+        {
+            auto& node = *target->node;
+            const auto& state = *target->state;
+            node.setGain (state.gain);
+            node.setInputGain (state.inputGain);
+            node.setMuteInput (state.mutingInputs);
+            node.setMutedFromAnyThread (state.muted);
+            node.suspendProcessing (state.bypassed);
+        }
+    }
+
+    // listeners hear about mutes outside the lock
+    for (const auto* target : targets)
+    {
+        target->node->setMuted (target->state->muted);
+        if (target->state->hasState)
+            target->node->markStateChanged();
+    }
+
+    const int numRecalled = targets.size();
+    targets.clear();
+    return numRecalled;
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class GraphNode;
+class GraphProcessor;
+
+/** The sound of a whole rig, held in memory so it can be recalled at once.
+
+    Captures the state of every node in a graph, and in the graphs inside it,
+    along with their gains, mutes and bypass. Recalling loads the states while
+    the nodes go on rendering the ones they have, then flips the gains, mutes
+    and bypass together under the graph's callback lock, so the mix changes
+    between one block and the next without dropping out or re-instantiating
+    anything. Nodes are matched by id, and ones that have gone since the
+    capture are skipped.
+ */
+class RigSnapshot : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<RigSnapshot>;
+
+    ~RigSnapshot();
+
+    /** Captures the graph. Call this on the message thread */
+    static Ptr capture (GraphProcessor& graph, const String& name = String());
+
+    /** Returns the name given at capture */
+    const String& getName() const noexcept      { return name; }
+
+    /** Returns the number of nodes captured */
+    int getNumNodes() const noexcept            { return nodes.size(); }
+
+    /** Returns the bytes held by the captured states */
+    size_t getSizeInBytes() const noexcept;
+
+    /** The nodes of a graph matched up with a snapshot, ready to switch to */
+    class Recall
+    {
+    public:
+        Recall (Recall&&);
+        ~Recall();
+
+        /** Returns the number of nodes that will be recalled */
+        int getNumNodes() const noexcept        { return targets.size(); }
+
+        /** Loads the states into their nodes, which keep rendering their
+            old states while they load, then switches gains, mutes and bypass
+            between two blocks. Returns the number of nodes recalled. Call
+            this on the message thread, once */
+        int apply();
+
+    private:
+        friend class RigSnapshot;
+        Recall (GraphProcessor&, Ptr);
+        GraphProcessor& graph;
+        Ptr snapshot;
+        struct Target;
+        OwnedArray<Target> targets;
+        JUCE_DECLARE_NON_COPYABLE (Recall)
+    };
+
+    /** Matches the snapshot to the graph's nodes, ahead of applying it */
+    Recall prepare (GraphProcessor& graph);
+
+    /** Prepares and applies in one go, returning the number of nodes recalled */
+    int recall (GraphProcessor& graph);
+
+private:
+    RigSnapshot() = default;
+    struct NodeState;
+    String name;
+    OwnedArray<NodeState> nodes;
+
+    void captureGraph (GraphProcessor&, const Array<uint32>& path);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RigSnapshot)
+};
+
+}
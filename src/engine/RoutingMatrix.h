@@ -0,0 +1,109 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Which inputs feed which outputs, kept as one word of output bits per
+    input in a single block of memory.
+
+    Like ToggleGrid this is meant for the audio thread: only the
+    constructors and resize() allocate.
+ */
+class RoutingMatrix
+{
+public:
+    enum { maxOutputs = 64 };
+
+    explicit RoutingMatrix (int ins = 4, int outs = 4)
+    {
+        resize (ins, outs);
+    }
+
+    explicit RoutingMatrix (const MatrixState& matrix)
+    {
+        resize (matrix.getNumRows(), matrix.getNumColumns());
+        assign (matrix);
+    }
+
+    /** Changes the size and clears every route */
+    void resize (int ins, int outs)
+    {
+        jassert (ins > 0 && outs > 0 && outs <= (int) maxOutputs);
+        numIns  = jmax (1, ins);
+        numOuts = jlimit (1, (int) maxOutputs, outs);
+        rows.calloc ((size_t) numIns);
+    }
+
+    inline bool sameSizeAs (const MatrixState& matrix) const noexcept
+    {
+        return numIns == matrix.getNumRows() && numOuts == matrix.getNumColumns();
+    }
+
+    /** Copies the routes of a matrix, as much of it as fits */
+    void assign (const MatrixState& matrix) noexcept
+    {
+        clear();
+        for (int i = 0; i < jmin (numIns, matrix.getNumRows()); ++i)
+            for (int o = 0; o < jmin (numOuts, matrix.getNumColumns()); ++o)
+                if (matrix.connected (i, o))
+                    rows[i] |= (uint64) 1 << o;
+    }
+
+    inline void clear() noexcept
+    {
+        zeromem (rows.get(), sizeof (uint64) * (size_t) numIns);
+    }
+
+    inline bool get (const int in, const int out) const noexcept
+    {
+        jassert (isPositiveAndBelow (in, numIns) && isPositiveAndBelow (out, numOuts));
+        return (rows[in] & ((uint64) 1 << out)) != 0;
+    }
+
+    inline void set (const int in, const int out, const bool value) noexcept
+    {
+        jassert (isPositiveAndBelow (in, numIns) && isPositiveAndBelow (out, numOuts));
+        if (value)
+            rows[in] |= (uint64) 1 << out;
+        else
+            rows[in] &= ~((uint64) 1 << out);
+    }
+
+    /** Returns the outputs an input feeds, bit n standing for output n */
+    inline uint64 getOutputs (const int in) const noexcept
+    {
+        jassert (isPositiveAndBelow (in, numIns));
+        return rows[in];
+    }
+
+    inline int getNumInputs() const noexcept    { return numIns; }
+    inline int getNumOutputs() const noexcept   { return numOuts; }
+
+private:
+    int numIns = 0, numOuts = 0;
+    HeapBlock<uint64> rows;
+
+    JUCE_DECLARE_NON_COPYABLE (RoutingMatrix)
+};
+
+}
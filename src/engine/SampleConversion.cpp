@@ -0,0 +1,62 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/SampleConversion.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#endif
+
+namespace Element {
+
+void SampleConversion::convert (const float* source, double* dest, int numSamples) noexcept
+{
+    int i = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 s = _mm_loadu_ps (source + i);
+        _mm_storeu_pd (dest + i,     _mm_cvtps_pd (s));
+        _mm_storeu_pd (dest + i + 2, _mm_cvtps_pd (_mm_movehl_ps (s, s)));
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        dest[i] = (double) source[i];
+}
+
+void SampleConversion::convert (const double* source, float* dest, int numSamples) noexcept
+{
+    int i = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 low  = _mm_cvtpd_ps (_mm_loadu_pd (source + i));
+        const __m128 high = _mm_cvtpd_ps (_mm_loadu_pd (source + i + 2));
+        _mm_storeu_ps (dest + i, _mm_movelh_ps (low, high));
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        dest[i] = (float) source[i];
+}
+
+}
@@ -0,0 +1,46 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Converts between single and double precision sample buffers */
+struct SampleConversion
+{
+    /** Widens floats to doubles */
+    static void convert (const float* source, double* dest, int numSamples) noexcept;
+
+    /** Narrows doubles to floats */
+    static void convert (const double* source, float* dest, int numSamples) noexcept;
+
+    /** Converts the first numChannels channels of one buffer into another */
+    template<typename Source, typename Dest>
+    static void convert (const AudioBuffer<Source>& source, AudioBuffer<Dest>& dest,
+                         int numChannels, int numSamples) noexcept
+    {
+        jassert (numChannels <= source.getNumChannels() && numChannels <= dest.getNumChannels());
+        for (int ch = 0; ch < numChannels; ++ch)
+            convert (source.getReadPointer (ch), dest.getWritePointer (ch), numSamples);
+    }
+};
+
+}
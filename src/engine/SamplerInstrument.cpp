@@ -0,0 +1,314 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "engine/SamplerInstrument.h"
+
+namespace Element {
+
+/* Samples that can't be mapped are decoded whole, up to ten minutes of
+   audio at 48 kHz */
+static const int64 maxInMemoryFrames = 48000 * 60 * 10;
+
+static String removeComments (const String& text)
+{
+    String result (text);
+    for (int start = result.indexOf ("/*"); start >= 0; start = result.indexOf ("/*"))
+    {
+        const int end = result.indexOf (start + 2, "*/");
+        result = result.substring (0, start) + (end >= 0 ? result.substring (end + 2) : String());
+    }
+
+    StringArray lines;
+    lines.addLines (result);
+    for (auto& line : lines)
+        line = line.upToFirstOccurrenceOf ("//", false, false);
+    return lines.joinIntoString ("\n");
+}
+
+/** Returns where an opcode's value ends. Values like sample paths can hold
+    spaces, so one runs until the next opcode, header or line end */
+static int findValueEnd (const String& line, int start)
+{
+    const int length = line.length();
+    for (int i = start; i < length; ++i)
+    {
+        if (line[i] == '<')
+            return i;
+        if (! CharacterFunctions::isWhitespace (line[i]))
+            continue;
+
+        int next = i;
+        while (next < length && CharacterFunctions::isWhitespace (line[next]))
+            ++next;
+        int nameEnd = next;
+        while (nameEnd < length && (CharacterFunctions::isLetterOrDigit (line[nameEnd]) || line[nameEnd] == '_'))
+            ++nameEnd;
+        if ((nameEnd > next && nameEnd < length && line[nameEnd] == '=') || (next < length && line[next] == '<'))
+            return i;
+    }
+
+    return length;
+}
+
+static void applyOpcodes (SamplerInstrument::Region& region, const StringPairArray& opcodes,
+                          const File& directory, const String& defaultPath)
+{
+    for (int i = 0; i < opcodes.size(); ++i)
+    {
+        const auto name = opcodes.getAllKeys()[i];
+        const auto value = opcodes.getAllValues()[i];
+
+        if (name == "sample")
+        {
+            const auto path = (defaultPath + value).replaceCharacter ('\\', '/');
+            region.sample = directory.getChildFile (path);
+        }
+        else if (name == "key")
+        {
+            const int key = SamplerInstrument::parseKey (value);
+            if (key >= 0)
+                region.loKey = region.hiKey = region.rootKey = key;
+        }
+        else if (name == "lokey" || name == "hikey" || name == "pitch_keycenter")
+        {
+            const int key = SamplerInstrument::parseKey (value);
+            if (key < 0)
+                continue;
+            if (name == "lokey")
+                region.loKey = key;
+            else if (name == "hikey")
+                region.hiKey = key;
+            else
+                region.rootKey = key;
+        }
+        else if (name == "lovel")       region.loVelocity = jlimit (1, 127, value.getIntValue());
+        else if (name == "hivel")       region.hiVelocity = jlimit (1, 127, value.getIntValue());
+        else if (name == "volume")      region.volumeDb = jlimit (-144.f, 6.f, value.getFloatValue());
+        else if (name == "tune")        region.tuneCents = jlimit (-100.0, 100.0, value.getDoubleValue());
+        else if (name == "transpose")   region.transpose = jlimit (-127, 127, value.getIntValue());
+    }
+}
+
+//=============================================================================
+int SamplerInstrument::parseKey (const String& text)
+{
+    const auto key = text.trim().toLowerCase();
+    if (key.isEmpty())
+        return -1;
+
+    if (key.containsOnly ("0123456789"))
+    {
+        const int number = key.getIntValue();
+        return isPositiveAndNotGreaterThan (number, 127) ? number : -1;
+    }
+
+    static const int semitones[] = { 9, 11, 0, 2, 4, 5, 7 };
+    const auto letter = key[0];
+    if (letter < 'a' || letter > 'g')
+        return -1;
+
+    int note = semitones [letter - 'a'];
+    int index = 1;
+    if (key[index] == '#')      { ++note; ++index; }
+    else if (key[index] == 'b') { --note; ++index; }
+
+    const auto octave = key.substring (index);
+    if (octave.isEmpty() || ! octave.containsOnly ("-0123456789"))
+        return -1;
+
+    note += (octave.getIntValue() + 1) * 12;
+    return isPositiveAndNotGreaterThan (note, 127) ? note : -1;
+}
+
+Result SamplerInstrument::parseSfz (const String& text, const File& directory, Array<Region>& regions)
+{
+    regions.clearQuick();
+    StringPairArray global, group, region;
+    String header, defaultPath;
+    bool inRegion = false;
+
+    auto finishRegion = [&]()
+    {
+        if (! inRegion)
+            return;
+        inRegion = false;
+
+        Region newRegion;
+        applyOpcodes (newRegion, global, directory, defaultPath);
+        applyOpcodes (newRegion, group, directory, defaultPath);
+        applyOpcodes (newRegion, region, directory, defaultPath);
+        region.clear();
+        if (newRegion.sample != File() && newRegion.loKey <= newRegion.hiKey
+            && newRegion.loVelocity <= newRegion.hiVelocity)
+            regions.add (newRegion);
+    };
+
+    StringArray lines;
+    lines.addLines (removeComments (text));
+    for (int l = 0; l < lines.size(); ++l)
+    {
+        const auto& line = lines.getReference (l);
+        int pos = 0;
+        while (pos < line.length())
+        {
+            while (pos < line.length() && CharacterFunctions::isWhitespace (line[pos]))
+                ++pos;
+            if (pos >= line.length())
+                break;
+
+            if (line[pos] == '<')
+            {
+                const int end = line.indexOfChar (pos, '>');
+                if (end < 0)
+                    return Result::fail ("Unclosed header on line " + String (l + 1));
+
+                finishRegion();
+                header = line.substring (pos + 1, end).trim().toLowerCase();
+                if (header == "region")
+                    inRegion = true;
+                else if (header == "group" || header == "master")
+                    group.clear();
+                else if (header == "global")
+                {
+                    global.clear();
+                    group.clear();
+                }
+
+                pos = end + 1;
+                continue;
+            }
+
+            const int equals = line.indexOfChar (pos, '=');
+            if (equals < 0)
+                return Result::fail ("Expected an opcode on line " + String (l + 1));
+
+            const auto name = line.substring (pos, equals).trim().toLowerCase();
+            const int end = findValueEnd (line, equals + 1);
+            const auto value = line.substring (equals + 1, end).trim();
+            pos = end;
+
+            if (header == "control")
+            {
+                if (name == "default_path")
+                    defaultPath = value.replaceCharacter ('\\', '/');
+            }
+            else if (header == "region")    region.set (name, value);
+            else if (header == "group" || header == "master")
+                group.set (name, value);
+            else if (header == "global")    global.set (name, value);
+        }
+    }
+
+    finishRegion();
+    return Result::ok();
+}
+
+//=============================================================================
+static SamplerInstrument::Zone* openZone (AudioFormatManager& formats, const SamplerInstrument::Region& region,
+                                          double preloadSeconds)
+{
+    std::unique_ptr<SamplerInstrument::Zone> zone (new SamplerInstrument::Zone());
+    zone->region = region;
+    zone->gain = Decibels::decibelsToGain (region.volumeDb);
+
+    if (auto* format = formats.findFormatForFileExtension (region.sample.getFileExtension()))
+    {
+        std::unique_ptr<MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (region.sample));
+        if (mapped != nullptr && mapped->mapEntireFile() && mapped->lengthInSamples > 0)
+        {
+            zone->length = mapped->lengthInSamples;
+            zone->sampleRate = mapped->sampleRate;
+            const auto frames = (int) jmin (zone->length, (int64) (jmax (0.0, preloadSeconds) * zone->sampleRate));
+            zone->attack.setSize (jlimit (1, 2, (int) mapped->numChannels), frames);
+            mapped->read (&zone->attack, 0, frames, 0, true, true);
+
+            // a sample that fits in the preload never needs the map
+            if (frames < zone->length)
+                zone->reader = std::move (mapped);
+            return zone.release();
+        }
+    }
+
+    std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (region.sample));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->lengthInSamples > maxInMemoryFrames)
+        return nullptr;
+
+    zone->length = reader->lengthInSamples;
+    zone->sampleRate = reader->sampleRate;
+    zone->attack.setSize (jlimit (1, 2, (int) reader->numChannels), (int) zone->length);
+    reader->read (&zone->attack, 0, (int) zone->length, 0, true, true);
+    return zone.release();
+}
+
+Result SamplerInstrument::load (const File& newFile, double preloadSeconds)
+{
+    zones.clearQuick (true);
+    numMissing = 0;
+    file = newFile;
+
+    if (! newFile.existsAsFile())
+        return Result::fail ("The instrument file doesn't exist");
+
+    Array<Region> regions;
+    if (newFile.hasFileExtension ("sfz"))
+    {
+        const auto result = parseSfz (newFile.loadFileAsString(), newFile.getParentDirectory(), regions);
+        if (result.failed())
+            return result;
+    }
+    else
+    {
+        Region region;
+        region.sample = newFile;
+        regions.add (region);
+    }
+
+    AudioFormatManager formats;
+    formats.registerBasicFormats();
+    for (const auto& region : regions)
+    {
+        if (auto* zone = openZone (formats, region, preloadSeconds))
+            zones.add (zone);
+        else
+            ++numMissing;
+    }
+
+    if (zones.isEmpty())
+        return Result::fail (regions.isEmpty() ? "The instrument has no regions"
+                                               : "None of the instrument's samples could be opened");
+    return Result::ok();
+}
+
+int SamplerInstrument::findZones (int note, int velocity, const Zone** found, int maxZones) const noexcept
+{
+    int numFound = 0;
+    for (const auto* zone : zones)
+        if (numFound < maxZones && zone->contains (note, velocity))
+            found [numFound++] = zone;
+    return numFound;
+}
+
+int64 SamplerInstrument::getMemoryBytes() const noexcept
+{
+    int64 bytes = 0;
+    for (const auto* zone : zones)
+        bytes += (int64) zone->attack.getNumChannels() * zone->attack.getNumSamples() * (int64) sizeof (float);
+    return bytes;
+}
+
+}
@@ -0,0 +1,108 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A multisample set, opened for streaming.
+
+    Instruments are SFZ files, or a single audio file played across the
+    keyboard. WAV and AIFF samples are memory mapped and only the start of
+    each is read into memory, so a large instrument opens in moments and
+    costs little RAM. The rest is read through the map as voices play.
+    Samples in other formats are decoded into memory whole.
+
+    Of SFZ, the sample, lokey, hikey, key, pitch_keycenter, lovel, hivel,
+    volume, tune and transpose opcodes are read in region, group and global
+    headers, and default_path in control headers.
+ */
+class SamplerInstrument
+{
+public:
+    /** A region as it was written in the instrument */
+    struct Region
+    {
+        File sample;
+        int loKey = 0, hiKey = 127;
+        int loVelocity = 1, hiVelocity = 127;
+        int rootKey = 60;
+        int transpose = 0;
+        double tuneCents = 0.0;
+        float volumeDb = 0.f;
+    };
+
+    /** A region and its sample, ready to play */
+    struct Zone
+    {
+        Region region;
+        /** The memory mapped sample. Null when all of it is in memory */
+        std::unique_ptr<AudioFormatReader> reader;
+        /** The start of the sample, or all of it */
+        AudioBuffer<float> attack;
+        int64 length = 0;
+        double sampleRate = 44100.0;
+        float gain = 1.f;
+
+        bool isStreamed() const noexcept { return reader != nullptr; }
+        bool contains (int note, int velocity) const noexcept
+        {
+            return note >= region.loKey && note <= region.hiKey
+                && velocity >= region.loVelocity && velocity <= region.hiVelocity;
+        }
+    };
+
+    SamplerInstrument() = default;
+    ~SamplerInstrument() = default;
+
+    /** Opens an instrument, keeping this much of each mapped sample in memory */
+    Result load (const File& file, double preloadSeconds);
+
+    /** Returns the file the instrument was opened from */
+    const File& getFile() const noexcept { return file; }
+
+    int getNumZones() const noexcept { return zones.size(); }
+    const Zone* getZone (int index) const noexcept { return zones [index]; }
+
+    /** Returns the number of regions whose samples couldn't be opened */
+    int getNumMissing() const noexcept { return numMissing; }
+
+    /** Fills in the zones a note plays, up to maxZones, and returns how many */
+    int findZones (int note, int velocity, const Zone** found, int maxZones) const noexcept;
+
+    /** Returns the bytes of sample data held in memory */
+    int64 getMemoryBytes() const noexcept;
+
+    /** Reads the regions of SFZ text. Samples are relative to the directory */
+    static Result parseSfz (const String& text, const File& directory, Array<Region>& regions);
+
+    /** Reads a key as a MIDI note number or a name like c#4, where c4 is 60.
+        Returns -1 if it's neither */
+    static int parseKey (const String& text);
+
+private:
+    File file;
+    OwnedArray<Zone> zones;
+    int numMissing = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (SamplerInstrument)
+};
+
+}
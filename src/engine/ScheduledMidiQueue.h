@@ -0,0 +1,155 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+/** Timestamped MIDI from another thread, released on the sample it is due.
+
+    Producers push messages stamped with the time they should sound, which
+    may be well ahead of the audio. Each block the audio thread takes what
+    has been pushed into a time ordered list and writes out whatever falls
+    inside the block. An optional delay is added to every message, a
+    jitter buffer for sources that send late or unevenly. Nothing locks,
+    and only sysex longer than a pointer allocates.
+ */
+class ScheduledMidiQueue
+{
+public:
+    enum
+    {
+        maxEventSize = 32   ///< larger messages are written out as soon as they arrive
+    };
+
+    explicit ScheduledMidiQueue (int capacityInBytes = 16384, int maxPending = 1024)
+        : incoming (capacityInBytes)
+    {
+        pending.allocate ((size_t) jmax (1, maxPending), true);
+        pendingCapacity = jmax (1, maxPending);
+    }
+
+    /** Queues a message due at the given time, in seconds on the
+        Time::getMillisecondCounterHiRes() clock. Only one thread may push */
+    bool push (const MidiMessage& message, double time) noexcept
+    {
+        return incoming.push (message, time);
+    }
+
+    /** Sets the delay, in seconds, added to every message */
+    void setDelay (double seconds) noexcept             { delay.store (jmax (0.0, seconds)); }
+
+    /** Returns the delay added to every message */
+    double getDelay() const noexcept                    { return delay.load(); }
+
+    /** Returns the number of messages waiting for a later block */
+    int getNumPending() const noexcept                  { return numPending; }
+
+    /** Returns the number of messages dropped because too many were pending */
+    int getNumDropped() const noexcept                  { return numDropped.load (std::memory_order_relaxed); }
+
+    /** Writes everything due before the end of the block. The end of the
+        block is now, and messages land as far before it as they are due before
+        now, late ones on the first sample. Only the audio thread may call this */
+    void render (MidiBuffer& midi, int numSamples, double sampleRate, double now) noexcept
+    {
+        MidiBudget::Writer writer (midi);
+        const double offset = delay.load();
+        const int lastFrame = jmax (0, numSamples - 1);
+
+        MidiMessage message;
+        double time = 0.0;
+        while (incoming.pop (message, time))
+        {
+            if (message.getRawDataSize() > (int) maxEventSize)
+                writer.add (message, jlimit (0, lastFrame, getFrame (time + offset, numSamples, sampleRate, now)));
+            else
+                insert (message, time);
+        }
+
+        int numDone = 0;
+        for (; numDone < numPending; ++numDone)
+        {
+            const auto& event = pending [numDone];
+            const int frame = getFrame (event.time + offset, numSamples, sampleRate, now);
+            if (frame >= numSamples)
+                break;
+            writer.add (event.data, event.size, jmax (0, frame));
+        }
+
+        if (numDone > 0)
+        {
+            numPending -= numDone;
+            memmove (pending.get(), pending.get() + numDone, (size_t) numPending * sizeof (Event));
+        }
+    }
+
+    /** Throws away everything queued and pending. Only the audio thread may call this */
+    void discard() noexcept
+    {
+        incoming.discard();
+        numPending = 0;
+    }
+
+private:
+    struct Event
+    {
+        double time;
+        int size;
+        uint8 data [maxEventSize];
+    };
+
+    MidiInputQueue incoming;
+    HeapBlock<Event> pending;
+    int pendingCapacity = 0, numPending = 0;
+    std::atomic<double> delay { 0.0 };
+    std::atomic<int> numDropped { 0 };
+
+    static int getFrame (double time, int numSamples, double sampleRate, double now) noexcept
+    {
+        return numSamples - roundToInt ((now - time) * sampleRate);
+    }
+
+    /** Adds a message after any due at the same time or earlier */
+    void insert (const MidiMessage& message, double time) noexcept
+    {
+        if (numPending >= pendingCapacity)
+        {
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        int index = numPending;
+        while (index > 0 && pending [index - 1].time > time)
+            --index;
+
+        memmove (pending.get() + index + 1, pending.get() + index, (size_t) (numPending - index) * sizeof (Event));
+        auto& event = pending [index];
+        event.time = time;
+        event.size = message.getRawDataSize();
+        memcpy (event.data, message.getRawData(), (size_t) event.size);
+        ++numPending;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ScheduledMidiQueue)
+};
+
+}
@@ -0,0 +1,327 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/SincResampler.h"
+
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define EL_SINC_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define EL_SINC_NEON 1
+#endif
+
+namespace Element {
+
+namespace SincPresets
+{
+    struct Preset
+    {
+        int halfTaps;
+        int numPhases;
+        double beta;
+        double passband;
+    };
+
+    static const Preset presets[] = {
+        {  8,  64,  6.0, 0.90 },
+        { 16, 256,  8.0, 0.94 },
+        { 32, 512, 10.0, 0.97 }
+    };
+
+    // downsampling widens the kernel with the ratio, up to this
+    static const double maxWidening = 8.0;
+}
+
+/** Dot products of one input window with two phases, loading the input once */
+static inline void dotProducts (const float* x, const float* h0, const float* h1, int num,
+                                float& s0, float& s1) noexcept
+{
+    int i = 0;
+
+   #if EL_SINC_SSE
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+    for (; i + 4 <= num; i += 4)
+    {
+        const __m128 v = _mm_loadu_ps (x + i);
+        a0 = _mm_add_ps (a0, _mm_mul_ps (v, _mm_loadu_ps (h0 + i)));
+        a1 = _mm_add_ps (a1, _mm_mul_ps (v, _mm_loadu_ps (h1 + i)));
+    }
+    float r0[4], r1[4];
+    _mm_storeu_ps (r0, a0);
+    _mm_storeu_ps (r1, a1);
+    s0 = r0[0] + r0[1] + r0[2] + r0[3];
+    s1 = r1[0] + r1[1] + r1[2] + r1[3];
+   #elif EL_SINC_NEON
+    float32x4_t a0 = vdupq_n_f32 (0.f), a1 = vdupq_n_f32 (0.f);
+    for (; i + 4 <= num; i += 4)
+    {
+        const float32x4_t v = vld1q_f32 (x + i);
+        a0 = vmlaq_f32 (a0, v, vld1q_f32 (h0 + i));
+        a1 = vmlaq_f32 (a1, v, vld1q_f32 (h1 + i));
+    }
+    s0 = vgetq_lane_f32 (a0, 0) + vgetq_lane_f32 (a0, 1) + vgetq_lane_f32 (a0, 2) + vgetq_lane_f32 (a0, 3);
+    s1 = vgetq_lane_f32 (a1, 0) + vgetq_lane_f32 (a1, 1) + vgetq_lane_f32 (a1, 2) + vgetq_lane_f32 (a1, 3);
+   #else
+    s0 = s1 = 0.f;
+   #endif
+
+    for (; i < num; ++i)
+    {
+        s0 += x[i] * h0[i];
+        s1 += x[i] * h1[i];
+    }
+}
+
+float SincResamplingAudioSource::FilterTable::interpolate (const float* window, double fraction) const noexcept
+{
+    const double phase = fraction * (double) numPhases;
+    const int p = (int) phase;
+    float s0, s1;
+    dotProducts (window, getPhase (p), getPhase (p + 1), numTaps, s0, s1);
+    return s0 + (float) (phase - (double) p) * (s1 - s0);
+}
+
+static double besselI0 (double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1.0e-12; ++k)
+    {
+        const double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+static SincResamplingAudioSource::FilterTable* buildTable (const SincPresets::Preset& preset, double ratio)
+{
+    const double widening = jlimit (1.0, SincPresets::maxWidening, ratio);
+    // a multiple of four taps keeps the vector loops free of remainders
+    const int halfTaps = ((int) std::ceil (preset.halfTaps * widening) + 1) & ~1;
+    const double cutoff = 0.5 * preset.passband / widening;
+
+    auto* table = new SincResamplingAudioSource::FilterTable();
+    table->numTaps = halfTaps * 2;
+    table->numPhases = preset.numPhases;
+    table->coefficients.calloc ((size_t) table->numTaps * (size_t) (table->numPhases + 1));
+
+    const double window = besselI0 (preset.beta);
+    for (int p = 0; p <= table->numPhases; ++p)
+    {
+        auto* row = table->coefficients + (size_t) p * (size_t) table->numTaps;
+        const double frac = (double) p / (double) table->numPhases;
+        double sum = 0.0;
+
+        for (int k = 0; k < table->numTaps; ++k)
+        {
+            const double x = (double) (k - (halfTaps - 1)) - frac;
+            const double r = x / (double) halfTaps;
+            if (std::abs (r) >= 1.0)
+                continue;
+
+            const double t = 2.0 * cutoff * x;
+            const double sinc = std::abs (t) < 1.0e-9 ? 1.0 : std::sin (MathConstants<double>::pi * t) / (MathConstants<double>::pi * t);
+            const double h = 2.0 * cutoff * sinc * besselI0 (preset.beta * std::sqrt (1.0 - r * r)) / window;
+            row[k] = (float) h;
+            sum += h;
+        }
+
+        // unity gain at DC for every phase
+        if (sum > 0.0)
+            for (int k = 0; k < table->numTaps; ++k)
+                row[k] = (float) (row[k] / sum);
+    }
+
+    return table;
+}
+
+SincResamplingAudioSource::FilterTable::Ptr SincResamplingAudioSource::FilterCache::get (Quality quality, double ratio)
+{
+    // below 1 the kernel is the same whatever the ratio
+    ratio = jlimit (1.0, SincPresets::maxWidening, ratio);
+    const auto key = std::make_pair ((int) quality, (int64) std::llround (ratio * 1.0e6));
+
+    const ScopedLock sl (lock);
+    auto iter = tables.find (key);
+    if (iter != tables.end())
+        return iter->second;
+
+    FilterTable::Ptr table = buildTable (SincPresets::presets [jlimit (0, 2, (int) quality)], ratio);
+    tables [key] = table;
+    return table;
+}
+
+int SincResamplingAudioSource::FilterCache::getNumTables() const
+{
+    const ScopedLock sl (lock);
+    return (int) tables.size();
+}
+
+//=============================================================================
+SincResamplingAudioSource::SincResamplingAudioSource (PositionableAudioSource* s, bool deleteSourceWhenDeleted,
+                                                      double rate, int channels, Quality q)
+    : source (s, deleteSourceWhenDeleted),
+      sourceSampleRate (rate),
+      numChannels (jmax (1, channels)),
+      quality (q)
+{
+    jassert (source != nullptr);
+}
+
+SincResamplingAudioSource::~SincResamplingAudioSource()
+{
+    releaseResources();
+}
+
+void SincResamplingAudioSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+    const auto position = getInputPosition();
+
+    {
+        const SpinLock::ScopedLockType sl (lock);
+        ratio = sampleRate > 0.0 && sourceSampleRate > 0.0 ? sourceSampleRate / sampleRate : 1.0;
+        // at the same rate the source is read straight through
+        table = std::abs (ratio - 1.0) < 1.0e-9 ? nullptr : filters->get (quality, ratio);
+        if (table != nullptr)
+            history.setSize (numChannels, (int) std::ceil (samplesPerBlockExpected * ratio) + table->numTaps + 2);
+    }
+
+    source->prepareToPlay ((int) std::ceil (samplesPerBlockExpected * ratio), sourceSampleRate);
+    reset (position);
+}
+
+void SincResamplingAudioSource::releaseResources()
+{
+    source->releaseResources();
+}
+
+double SincResamplingAudioSource::getInputPosition() const
+{
+    const SpinLock::ScopedLockType sl (lock);
+    if (table == nullptr)
+        return (double) source->getNextReadPosition();
+
+    // the source is ahead by whatever's buffered past the read position
+    double position = (double) source->getNextReadPosition() - ((double) numValid - readPos);
+    const auto length = source->getTotalLength();
+    if (position < 0.0 && source->isLooping() && length > 0)
+        position += (double) length;
+    return jmax (0.0, position);
+}
+
+void SincResamplingAudioSource::reset (double inputPosition)
+{
+    const SpinLock::ScopedLockType sl (lock);
+    const auto start = (int64) std::floor (inputPosition);
+    if (table == nullptr)
+    {
+        source->setNextReadPosition (start);
+        return;
+    }
+
+    // read the frames before the position too, so a seek doesn't fade in
+    const int halfTaps = table->numTaps / 2;
+    const int preroll = (int) jmin ((int64) (halfTaps - 1), start);
+    history.clear();
+    numValid = halfTaps - 1 - preroll;
+    readPos = (double) (halfTaps - 1) + (inputPosition - (double) start);
+    source->setNextReadPosition (start - preroll);
+}
+
+void SincResamplingAudioSource::fill (int numFrames)
+{
+    if (numFrames <= numValid)
+        return;
+
+    if (numFrames > history.getNumSamples())
+    {
+        // blocks larger than prepared for
+        jassertfalse;
+        history.setSize (numChannels, numFrames, true, true, true);
+    }
+
+    AudioSourceChannelInfo info (&history, numValid, numFrames - numValid);
+    source->getNextAudioBlock (info);
+    numValid = numFrames;
+}
+
+void SincResamplingAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    const SpinLock::ScopedLockType sl (lock);
+    if (table == nullptr)
+    {
+        source->getNextAudioBlock (info);
+        return;
+    }
+
+    const int halfTaps = table->numTaps / 2;
+    fill ((int) (readPos + (info.numSamples - 1) * ratio) + halfTaps + 1);
+
+    const int numOut = jmin (numChannels, info.buffer->getNumChannels());
+    for (int c = 0; c < numOut; ++c)
+    {
+        const float* in = history.getReadPointer (c);
+        float* out = info.buffer->getWritePointer (c, info.startSample);
+        double pos = readPos;
+
+        for (int i = 0; i < info.numSamples; ++i)
+        {
+            const int n = (int) pos;
+            out[i] = table->interpolate (in + n - (halfTaps - 1), pos - (double) n);
+            pos += ratio;
+        }
+    }
+
+    for (int c = numOut; c < info.buffer->getNumChannels(); ++c)
+        info.buffer->clear (c, info.startSample, info.numSamples);
+
+    readPos += info.numSamples * ratio;
+
+    // keep only the frames the next window reaches back to
+    const int discard = jmin (numValid, (int) readPos - (halfTaps - 1));
+    if (discard > 0)
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto* data = history.getWritePointer (c);
+            std::memmove (data, data + discard, sizeof (float) * (size_t) (numValid - discard));
+        }
+
+        numValid -= discard;
+        readPos -= discard;
+    }
+}
+
+void SincResamplingAudioSource::setNextReadPosition (int64 newPosition)
+{
+    reset ((double) newPosition * ratio);
+}
+
+int64 SincResamplingAudioSource::getNextReadPosition() const
+{
+    return (int64) std::llround (getInputPosition() / ratio);
+}
+
+int64 SincResamplingAudioSource::getTotalLength() const
+{
+    return (int64) ((double) source->getTotalLength() / ratio);
+}
+
+}
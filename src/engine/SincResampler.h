@@ -0,0 +1,120 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Converts a source to the device's sample rate with a windowed sinc filter.
+
+    The filter is polyphase: a table holds the kernel at a number of
+    fractional offsets, and each output sample is the dot product of the
+    input around it with the two nearest phases, blended. Tables depend only
+    on the quality and the ratio, so players converting at the same ratio
+    share one. Positions and lengths are in frames of the output rate, which
+    lets an AudioTransportSource use this in place of its own resampler.
+ */
+class SincResamplingAudioSource : public PositionableAudioSource
+{
+public:
+    enum Quality
+    {
+        /** 16 taps, for lots of players or slow machines */
+        Fast = 0,
+        /** 32 taps */
+        Good,
+        /** 64 taps, with the widest passband */
+        Best
+    };
+
+    /** A kernel sampled at every phase. Phase p's numTaps coefficients start
+        at p * numTaps, and there's one phase past the last to blend towards */
+    struct FilterTable : public ReferenceCountedObject
+    {
+        using Ptr = ReferenceCountedObjectPtr<FilterTable>;
+        int numTaps = 0;
+        int numPhases = 0;
+        HeapBlock<float> coefficients;
+
+        const float* getPhase (int phase) const noexcept { return coefficients + (size_t) phase * (size_t) numTaps; }
+
+        /** Returns the sample a fraction past the centre of a window of
+            numTaps, which starts numTaps / 2 - 1 frames before it */
+        float interpolate (const float* window, double fraction) const noexcept;
+    };
+
+    /** Tables already built, by quality and ratio */
+    class FilterCache
+    {
+    public:
+        FilterCache() = default;
+
+        /** Returns the table for a ratio, building it if it's the first */
+        FilterTable::Ptr get (Quality quality, double ratio);
+        int getNumTables() const;
+
+    private:
+        CriticalSection lock;
+        std::map<std::pair<int, int64>, FilterTable::Ptr> tables;
+        JUCE_DECLARE_NON_COPYABLE (FilterCache)
+    };
+
+    SincResamplingAudioSource (PositionableAudioSource* source, bool deleteSourceWhenDeleted,
+                               double sourceSampleRate, int numChannels, Quality quality = Good);
+    ~SincResamplingAudioSource();
+
+    Quality getQuality() const noexcept { return quality; }
+
+    /** Returns source frames read per output frame. Set when prepared */
+    double getRatio() const noexcept { return ratio; }
+
+    /** @internal */
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+    void setNextReadPosition (int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override             { return source->isLooping(); }
+    void setLooping (bool shouldLoop) override  { source->setLooping (shouldLoop); }
+
+private:
+    OptionalScopedPointer<PositionableAudioSource> source;
+    SharedResourcePointer<FilterCache> filters;
+    FilterTable::Ptr table;
+    const double sourceSampleRate;
+    const int numChannels;
+    const Quality quality;
+    double ratio = 1.0;
+
+    SpinLock lock;
+    AudioBuffer<float> history;
+    int numValid = 0;
+    double readPos = 0.0;
+
+    double getInputPosition() const;
+    void reset (double inputPosition);
+    void fill (int numFrames);
+
+    JUCE_DECLARE_NON_COPYABLE (SincResamplingAudioSource)
+};
+
+}
@@ -0,0 +1,216 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A float parameter of an internal node, smoothed sample by sample.
+
+    Each block the values are worked out in one go: changes made on the
+    parameter itself glide over the default ramp time from the start of the
+    block, and events the engine timed land on their own sample with the
+    ramp they came with. Ramps are linear, which keeps the fill simple
+    enough to vectorize. A mapping can turn the parameter's value into what
+    the node uses, a gain say, before it's smoothed.
+
+    Nodes register these with BaseProcessor::addSmoothedParameter so the
+    engine hands them parameter events instead of splitting their blocks.
+ */
+class SmoothedParameter
+{
+public:
+    /** Converts the parameter's value into the smoothed one */
+    using Mapping = float (*) (float);
+
+    enum
+    {
+        maxEvents = 32,     ///< events queued for one block, later ones replace the last
+        interval  = 32      ///< samples between updates for nodes that can't use every value
+    };
+
+    SmoothedParameter() = default;
+
+    /** Attaches the parameter this smooths. Call once, before prepare */
+    void attach (AudioParameterFloat& newParameter, Mapping newMapping = nullptr) noexcept
+    {
+        parameter = &newParameter;
+        mapping = newMapping;
+        reset();
+    }
+
+    AudioParameterFloat* getParameter() const noexcept { return parameter; }
+
+    /** Allocates room for a block and sets the default ramp. Not realtime safe */
+    void prepare (double sampleRate, int maxBlockSize, double rampSeconds = 0.02)
+    {
+        capacity = jmax (1, maxBlockSize);
+        values.allocate ((size_t) capacity, true);
+        defaultRamp = jmax (1, roundToInt (rampSeconds * sampleRate));
+        reset();
+    }
+
+    /** Jumps to the parameter's value and drops queued events */
+    void reset() noexcept
+    {
+        lastValue = parameter != nullptr ? parameter->get() : 0.f;
+        current = target = map (lastValue);
+        remaining = numEvents = 0;
+        smoothing = false;
+    }
+
+    /** Queues a change for the next block, at a sample offset into it. The
+        value is normalised, like the parameter's. A negative ramp uses the
+        default one */
+    void addEvent (float normalisedValue, int offset, int rampSamples = -1) noexcept
+    {
+        if (numEvents >= (int) maxEvents)
+            --numEvents;
+
+        // kept in order of their offsets
+        int index = numEvents++;
+        for (; index > 0 && events[index - 1].offset > offset; --index)
+            events[index] = events[index - 1];
+        events[index] = { normalisedValue, offset, rampSamples };
+    }
+
+    /** Works out the values of a block, applying the events queued for it.
+        Returns them, numSamples long */
+    const float* process (int numSamples) noexcept
+    {
+        if (numSamples > capacity)
+        {
+            // a bigger block than prepared for, which shouldn't happen
+            jassertfalse;
+            capacity = numSamples;
+            values.realloc ((size_t) capacity);
+        }
+
+        smoothing = remaining > 0;
+        const float value = parameter != nullptr ? parameter->get() : lastValue;
+        if (value != lastValue)
+        {
+            lastValue = value;
+            setTarget (map (value), defaultRamp);
+        }
+
+        int position = 0;
+        for (int i = 0; i < numEvents; ++i)
+        {
+            const auto& event = events[i];
+            const int offset = jlimit (position, numSamples, event.offset);
+            fill (position, offset);
+            position = offset;
+            setTarget (map (parameter->range.convertFrom0to1 (event.value)),
+                       event.rampSamples < 0 ? defaultRamp : event.rampSamples);
+        }
+
+        numEvents = 0;
+        fill (position, numSamples);
+        return values;
+    }
+
+    /** Returns the values worked out by the last call to process */
+    const float* getValues() const noexcept     { return values; }
+
+    /** Returns true if the values of the last block weren't all the same */
+    bool isSmoothing() const noexcept           { return smoothing; }
+
+    /** Returns the value at the end of the last block */
+    float getCurrentValue() const noexcept      { return current; }
+
+    /** Returns the value being glided to */
+    float getTargetValue() const noexcept       { return target; }
+
+    /** Multiplies channels by the values of the last block */
+    void applyGain (float* const* channels, int numChannels, int numSamples) const noexcept
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            if (smoothing)
+                FloatVectorOperations::multiply (channels[c], values, numSamples);
+            else if (current == 0.f)
+                FloatVectorOperations::clear (channels[c], numSamples);
+            else if (current != 1.f)
+                FloatVectorOperations::multiply (channels[c], current, numSamples);
+        }
+    }
+
+private:
+    struct Event
+    {
+        float value;
+        int offset;
+        int rampSamples;
+    };
+
+    AudioParameterFloat* parameter = nullptr;
+    Mapping mapping = nullptr;
+    HeapBlock<float> values;
+    int capacity = 0;
+    int defaultRamp = 1;
+
+    float lastValue = 0.f;
+    float current = 0.f, target = 0.f, step = 0.f;
+    int remaining = 0;
+    bool smoothing = false;
+
+    Event events [maxEvents];
+    int numEvents = 0;
+
+    float map (float value) const noexcept { return mapping != nullptr ? mapping (value) : value; }
+
+    void setTarget (float newTarget, int numSamples) noexcept
+    {
+        if (newTarget == target)
+            return;
+
+        target = newTarget;
+        remaining = jmax (0, numSamples);
+        if (remaining == 0)
+            current = target;
+        else
+            step = (target - current) / (float) remaining;
+        smoothing = true;
+    }
+
+    void fill (int start, int end) noexcept
+    {
+        if (remaining > 0 && start < end)
+        {
+            const int numRamp = jmin (end - start, remaining);
+            const float base = current, increment = step;
+            float* const data = values + start;
+            for (int i = 0; i < numRamp; ++i)
+                data[i] = base + increment * (float) (i + 1);
+
+            remaining -= numRamp;
+            current = remaining > 0 ? base + increment * (float) numRamp : target;
+            start += numRamp;
+        }
+
+        if (start < end)
+            FloatVectorOperations::fill (values + start, current, end - start);
+    }
+};
+
+}
@@ -0,0 +1,191 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/TempoTable.h"
+
+namespace Element {
+
+TempoTable::TempoTable (double rate, Array<Tempo> tempos, Array<Meter> newMeters)
+    : sampleRate (rate > 0.0 ? rate : 44100.0)
+{
+    struct ByBeat
+    {
+        static int compareElements (const Tempo& a, const Tempo& b) noexcept { return compare (a.beat, b.beat); }
+        static int compareElements (const Meter& a, const Meter& b) noexcept { return compare (a.beat, b.beat); }
+        static int compare (double a, double b) noexcept { return a < b ? -1 : (b < a ? 1 : 0); }
+    } byBeat;
+
+    for (int i = tempos.size(); --i >= 0;)
+        if (tempos.getReference (i).bpm <= 0.0 || tempos.getReference (i).beat < 0.0)
+            tempos.remove (i);
+    tempos.sort (byBeat, true);
+    if (tempos.isEmpty() || tempos.getReference (0).beat > 0.0)
+        tempos.insert (0, { 0.0, tempos.isEmpty() ? 120.0 : tempos.getReference (0).bpm, false });
+
+    for (int i = 0; i < tempos.size(); ++i)
+    {
+        const auto& tempo = tempos.getReference (i);
+        // a later change on the same beat wins
+        if (i + 1 < tempos.size() && tempos.getReference (i + 1).beat == tempo.beat)
+            continue;
+
+        Segment segment { tempo.beat, 0.0, tempo.bpm, 0.0 };
+        if (tempo.ramp && i + 1 < tempos.size())
+        {
+            const auto& next = tempos.getReference (i + 1);
+            segment.slope = (next.bpm - tempo.bpm) / (next.beat - tempo.beat);
+        }
+
+        if (! segments.isEmpty())
+        {
+            const auto& previous = segments.getReference (segments.size() - 1);
+            segment.frame = previous.frame + framesInto (previous, segment.beat - previous.beat);
+        }
+
+        segments.add (segment);
+    }
+
+    for (int i = newMeters.size(); --i >= 0;)
+        if (newMeters.getReference (i).beatsPerBar < 1 || newMeters.getReference (i).beatType < 1)
+            newMeters.remove (i);
+    newMeters.sort (byBeat, true);
+    if (newMeters.isEmpty() || newMeters.getReference (0).beat > 0.0)
+        newMeters.insert (0, { 0.0, 4, 4 });
+    meters = newMeters;
+}
+
+TempoTable* TempoTable::fromTempoMap (const ValueTree& tempoMap, double rate, double defaultTempo)
+{
+    Array<Tempo> tempos;
+    Array<Meter> newMeters;
+    tempos.add ({ 0.0, defaultTempo, false });
+
+    for (int i = 0; i < tempoMap.getNumChildren(); ++i)
+    {
+        const auto child = tempoMap.getChild (i);
+        const double beat = child.getProperty ("beat", 0.0);
+        if (child.hasType ("tempo"))
+            tempos.add ({ beat, (double) child.getProperty ("bpm", defaultTempo),
+                          (bool) child.getProperty ("ramp", false) });
+        else if (child.hasType ("meter"))
+            newMeters.add ({ beat, (int) child.getProperty ("beatsPerBar", 4),
+                             (int) child.getProperty ("beatType", 4) });
+    }
+
+    return new TempoTable (rate, tempos, newMeters);
+}
+
+//=============================================================================
+double TempoTable::beatToFrame (double beat) const noexcept
+{
+    const auto& segment = findSegmentForBeat (beat);
+    return segment.frame + framesInto (segment, beat - segment.beat);
+}
+
+double TempoTable::frameToBeat (double frame) const noexcept
+{
+    const auto& segment = findSegmentForFrame (frame);
+    return segment.beat + beatsInto (segment, frame - segment.frame);
+}
+
+double TempoTable::getTempoAtBeat (double beat) const noexcept
+{
+    const auto& segment = findSegmentForBeat (beat);
+    return segment.bpm + segment.slope * jmax (0.0, beat - segment.beat);
+}
+
+void TempoTable::fillPosition (AudioPlayHead::CurrentPositionInfo& position, int64 frame) const noexcept
+{
+    const auto& segment = findSegmentForFrame ((double) frame);
+    const double beat = segment.beat + beatsInto (segment, (double) frame - segment.frame);
+    const auto& meter = findMeter (beat);
+    const double beatsPerBar = meter.beatsPerBar * 4.0 / meter.beatType;
+
+    position.timeInSamples  = frame;
+    position.timeInSeconds  = (double) frame / sampleRate;
+    position.ppqPosition    = beat;
+    position.bpm            = segment.bpm + segment.slope * jmax (0.0, beat - segment.beat);
+    position.timeSigNumerator   = meter.beatsPerBar;
+    position.timeSigDenominator = meter.beatType;
+    position.ppqPositionOfLastBarStart = meter.beat
+        + std::floor ((jmax (meter.beat, beat) - meter.beat) / beatsPerBar) * beatsPerBar;
+}
+
+//=============================================================================
+double TempoTable::framesInto (const Segment& segment, double beats) const noexcept
+{
+    if (segment.slope == 0.0)
+        return beats * 60.0 * sampleRate / segment.bpm;
+
+    // the tempo moves evenly with the beat, integrating 60 / tempo over the
+    // beats gives the seconds they take
+    const double bpm = jmax (1.0e-3, segment.bpm + segment.slope * beats);
+    return sampleRate * 60.0 / segment.slope * std::log (bpm / segment.bpm);
+}
+
+double TempoTable::beatsInto (const Segment& segment, double frames) const noexcept
+{
+    if (segment.slope == 0.0)
+        return frames * segment.bpm / (60.0 * sampleRate);
+    return segment.bpm / segment.slope * (std::exp (segment.slope * frames / (60.0 * sampleRate)) - 1.0);
+}
+
+const TempoTable::Segment& TempoTable::findSegmentForBeat (double beat) const noexcept
+{
+    int start = 1, end = segments.size();
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (segments.getReference (middle).beat <= beat)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return segments.getReference (start - 1);
+}
+
+const TempoTable::Segment& TempoTable::findSegmentForFrame (double frame) const noexcept
+{
+    int start = 1, end = segments.size();
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (segments.getReference (middle).frame <= frame)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return segments.getReference (start - 1);
+}
+
+const TempoTable::Meter& TempoTable::findMeter (double beat) const noexcept
+{
+    int start = 1, end = meters.size();
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (meters.getReference (middle).beat <= beat)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+    return meters.getReference (start - 1);
+}
+
+}
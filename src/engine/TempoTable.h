@@ -0,0 +1,100 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A tempo map compiled for the audio thread.
+
+    Tempo changes become segments of constant tempo, or of tempo moving evenly
+    from one change to the next, each with the sample it starts on worked out
+    ahead. Converting between beats and samples is then a binary search for
+    the segment and a closed form within it. Tables never change once built:
+    edits build a new one which replaces it.
+
+    Beats here are quarter notes, like the play head's ppq position.
+ */
+class TempoTable
+{
+public:
+    /** A tempo from a beat on. Ramps move evenly to the next tempo */
+    struct Tempo
+    {
+        double beat;
+        double bpm;
+        bool ramp;
+    };
+
+    /** A time signature from a beat on. The beat type is the note value of
+        a beat, 4 for quarter notes */
+    struct Meter
+    {
+        double beat;
+        int beatsPerBar;
+        int beatType;
+    };
+
+    TempoTable (double sampleRate, Array<Tempo> tempos, Array<Meter> meters);
+
+    /** Builds a table from a session's tempo map tree, see TempoMap */
+    static TempoTable* fromTempoMap (const ValueTree& tempoMap, double sampleRate,
+                                     double defaultTempo = 120.0);
+
+    double getSampleRate() const noexcept { return sampleRate; }
+    int getNumSegments() const noexcept   { return segments.size(); }
+
+    /** Returns the sample a beat falls on */
+    double beatToFrame (double beat) const noexcept;
+
+    /** Returns the beat playing at a sample */
+    double frameToBeat (double frame) const noexcept;
+
+    /** Returns the tempo at a beat */
+    double getTempoAtBeat (double beat) const noexcept;
+
+    /** Fills in the musical position of a sample: its time, beat, tempo, time
+        signature and where its bar started */
+    void fillPosition (AudioPlayHead::CurrentPositionInfo& position, int64 frame) const noexcept;
+
+private:
+    struct Segment
+    {
+        double beat;
+        double frame;
+        double bpm;
+        double slope;   ///< tempo change per beat, zero if constant
+    };
+
+    double sampleRate;
+    Array<Segment> segments;
+    Array<Meter> meters;
+
+    const Segment& findSegmentForBeat (double beat) const noexcept;
+    const Segment& findSegmentForFrame (double frame) const noexcept;
+    const Meter& findMeter (double beat) const noexcept;
+    double framesInto (const Segment&, double beats) const noexcept;
+    double beatsInto (const Segment&, double frames) const noexcept;
+
+    JUCE_LEAK_DETECTOR (TempoTable)
+};
+
+}
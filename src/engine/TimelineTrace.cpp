@@ -0,0 +1,235 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "engine/TimelineTrace.h"
+
+namespace Element {
+
+std::atomic<bool> TimelineTrace::enabled { false };
+
+namespace {
+
+/** The spans of one thread. Only that thread writes, readers check the
+    write count before and after copying to tell what was overwritten */
+struct ThreadRing
+{
+    std::atomic<const char*> name { nullptr };
+    char threadName [48] = { 0 };
+    std::atomic<uint32> writeCount { 0 };
+    TimelineTrace::Event events [TimelineTrace::capacity];
+};
+
+/** Rings are handed out to threads in turn and live until exit, so a thread
+    that ended can still be exported */
+struct Rings
+{
+    ~Rings()
+    {
+        for (auto& ring : rings)
+            delete ring.load();
+    }
+
+    std::atomic<ThreadRing*> rings [TimelineTrace::maxThreads] {};
+    std::atomic<int> numClaimed { 0 };
+    std::atomic<int64> clearedAt { 0 };
+};
+
+static Rings sRings;
+
+/** A thread that found every ring taken */
+static ThreadRing* const noRing = reinterpret_cast<ThreadRing*> (1);
+static thread_local ThreadRing* threadRing = nullptr;
+
+static ThreadRing* claimRing() noexcept
+{
+    // the last ring is allocated last, a thread that raced the first
+    // enable tries again on its next span
+    if (sRings.rings[TimelineTrace::maxThreads - 1].load (std::memory_order_acquire) == nullptr)
+        return nullptr;
+
+    const int index = sRings.numClaimed.fetch_add (1, std::memory_order_relaxed);
+    auto* ring = index < TimelineTrace::maxThreads
+        ? sRings.rings[index].load (std::memory_order_acquire) : nullptr;
+    if (ring == nullptr)
+        return noRing;
+
+    if (auto* thread = Thread::getCurrentThread())
+        thread->getThreadName().copyToUTF8 (ring->threadName, sizeof (ring->threadName));
+    else if (MessageManager::existsAndIsCurrentThread())
+        String ("Message Thread").copyToUTF8 (ring->threadName, sizeof (ring->threadName));
+    return ring;
+}
+
+static ThreadRing* getRing() noexcept
+{
+    if (threadRing == nullptr)
+        threadRing = claimRing();
+    return threadRing != noRing ? threadRing : nullptr;
+}
+
+static CriticalSection allocationLock;
+
+static void writeJsonString (OutputStream& stream, const String& text)
+{
+    stream << JSON::toString (var (text));
+}
+
+}
+
+//=============================================================================
+void TimelineTrace::setEnabled (bool shouldBeEnabled)
+{
+    if (shouldBeEnabled)
+    {
+        // rings aren't allocated until they're wanted, and then only once
+        const ScopedLock sl (allocationLock);
+        if (sRings.rings[maxThreads - 1].load (std::memory_order_relaxed) == nullptr)
+            for (auto& ring : sRings.rings)
+                ring.store (new ThreadRing(), std::memory_order_release);
+    }
+
+    enabled.store (shouldBeEnabled, std::memory_order_relaxed);
+}
+
+void TimelineTrace::nameThread (const char* name) noexcept
+{
+    if (! isEnabled())
+        return;
+    if (auto* ring = getRing())
+        if (ring->name.load (std::memory_order_relaxed) != name)
+            ring->name.store (name, std::memory_order_relaxed);
+}
+
+void TimelineTrace::add (const char* name, int64 startTicks, int64 endTicks, int64 arg) noexcept
+{
+    auto* ring = getRing();
+    if (ring == nullptr)
+        return;
+
+    const uint32 count = ring->writeCount.load (std::memory_order_relaxed);
+    auto& event = ring->events [count % capacity];
+    event.name = name;
+    event.startTicks = startTicks;
+    event.endTicks = endTicks;
+    event.arg = arg;
+    ring->writeCount.store (count + 1, std::memory_order_release);
+}
+
+void TimelineTrace::clear() noexcept
+{
+    sRings.clearedAt.store (Time::getHighResolutionTicks(), std::memory_order_relaxed);
+}
+
+void TimelineTrace::getEvents (Array<ThreadEvents>& threads)
+{
+    threads.clearQuick();
+    const int64 clearedAt = sRings.clearedAt.load (std::memory_order_relaxed);
+    const int numRings = jmin ((int) maxThreads, sRings.numClaimed.load (std::memory_order_relaxed));
+
+    for (int i = 0; i < numRings; ++i)
+    {
+        const auto* ring = sRings.rings[i].load (std::memory_order_acquire);
+        if (ring == nullptr)
+            continue;
+
+        const uint32 before = ring->writeCount.load (std::memory_order_acquire);
+        const uint32 numEvents = jmin (before, (uint32) capacity);
+        Array<Event> events;
+        events.ensureStorageAllocated ((int) numEvents);
+        for (uint32 e = before - numEvents; e != before; ++e)
+            events.add (ring->events [e % capacity]);
+
+        // whatever the thread wrote meanwhile replaced the oldest copies
+        std::atomic_thread_fence (std::memory_order_acquire);
+        const uint32 after = ring->writeCount.load (std::memory_order_relaxed);
+        const int numOverwritten = jmin ((int) numEvents, (int) (after - before));
+        events.removeRange (0, numOverwritten);
+
+        int numCleared = 0;
+        while (numCleared < events.size() && events.getReference (numCleared).startTicks < clearedAt)
+            ++numCleared;
+        events.removeRange (0, numCleared);
+        if (events.isEmpty())
+            continue;
+
+        ThreadEvents thread;
+        thread.index = i + 1;
+        if (const char* name = ring->name.load (std::memory_order_relaxed))
+            thread.name = name;
+        else if (ring->threadName[0] != 0)
+            thread.name = String::fromUTF8 (ring->threadName);
+        else
+            thread.name = "Thread " + String (thread.index);
+        thread.events.swapWith (events);
+        threads.add (thread);
+    }
+}
+
+bool TimelineTrace::writeChromeTrace (const File& file)
+{
+    Array<ThreadEvents> threads;
+    getEvents (threads);
+
+    FileOutputStream stream (file);
+    if (! stream.openedOk())
+        return false;
+    stream.setPosition (0);
+    stream.truncate();
+
+    int64 firstTicks = 0;
+    for (const auto& thread : threads)
+    {
+        const auto ticks = thread.events.getReference(0).startTicks;
+        if (firstTicks == 0 || ticks < firstTicks)
+            firstTicks = ticks;
+    }
+
+    // timestamps are microseconds from the first span
+    const double ticksPerMicro = (double) Time::getHighResolutionTicksPerSecond() / 1000000.0;
+    bool first = true;
+    auto separate = [&]() { stream << (first ? "\n" : ",\n"); first = false; };
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (const auto& thread : threads)
+    {
+        separate();
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.index
+               << ",\"args\":{\"name\":";
+        writeJsonString (stream, thread.name);
+        stream << "}}";
+
+        for (const auto& event : thread.events)
+        {
+            separate();
+            stream << "{\"name\":";
+            writeJsonString (stream, event.name);
+            stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.index
+                   << ",\"ts\":" << String ((double) (event.startTicks - firstTicks) / ticksPerMicro, 3)
+                   << ",\"dur\":" << String ((double) (event.endTicks - event.startTicks) / ticksPerMicro, 3);
+            if (event.arg >= 0)
+                stream << ",\"args\":{\"id\":" << event.arg << "}";
+            stream << "}";
+        }
+    }
+    stream << "\n]}\n";
+
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Records a timeline of what the engine's threads are doing, for viewing in
+    a trace viewer such as chrome://tracing or Perfetto.
+
+    Code marks the spans it wants to see by putting a Zone on the stack. Each
+    thread writes its spans into a ring of its own, so nothing locks or
+    allocates while recording and a disabled trace costs one relaxed load per
+    zone. The rings are allocated the first time tracing is enabled and hold
+    the last few seconds per thread. Zone names must be string literals.
+ */
+class TimelineTrace
+{
+public:
+    /** One finished span */
+    struct Event
+    {
+        const char* name    = nullptr;
+        int64 startTicks    = 0;    ///< high resolution ticks when the span began
+        int64 endTicks      = 0;
+        int64 arg           = -1;   ///< a value shown with the span, like a node id
+    };
+
+    /** The spans one thread recorded, oldest first */
+    struct ThreadEvents
+    {
+        int index = 0;
+        String name;
+        Array<Event> events;
+    };
+
+    enum
+    {
+        capacity    = 16384,    ///< spans kept per thread
+        maxThreads  = 32        ///< threads after this aren't recorded
+    };
+
+    /** Starts or stops recording. Can be called from any thread */
+    static void setEnabled (bool shouldBeEnabled);
+
+    /** Returns true while recording */
+    static bool isEnabled() noexcept { return enabled.load (std::memory_order_relaxed); }
+
+    /** Names the calling thread in the timeline. Threads started by JUCE get
+        their own name, this is for the ones drivers start */
+    static void nameThread (const char* name) noexcept;
+
+    /** Records a span for the calling thread */
+    static void add (const char* name, int64 startTicks, int64 endTicks, int64 arg = -1) noexcept;
+
+    /** Forgets what was recorded so far */
+    static void clear() noexcept;
+
+    /** Copies what each thread recorded. Spans overwritten while copying are
+        left out */
+    static void getEvents (Array<ThreadEvents>& threads);
+
+    /** Writes what was recorded as Chrome trace event JSON */
+    static bool writeChromeTrace (const File& file);
+
+    /** Records the span of the scope it lives in while tracing is enabled */
+    struct Zone
+    {
+        explicit Zone (const char* n, int64 a = -1) noexcept
+            : name (n), arg (a), start (isEnabled() ? Time::getHighResolutionTicks() : 0) { }
+        ~Zone() noexcept { if (start != 0) add (name, start, Time::getHighResolutionTicks(), arg); }
+
+    private:
+        const char* const name;
+        const int64 arg;
+        const int64 start;
+        JUCE_DECLARE_NON_COPYABLE (Zone)
+    };
+
+private:
+    static std::atomic<bool> enabled;
+    TimelineTrace() = delete;
+};
+
+}
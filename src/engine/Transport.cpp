@@ -27,7 +27,6 @@ Transport::Transport()
       recordState (false)
 {
     monitor = new Monitor();
-    monitor->tempo.set (getTempo());
     
     seekWanted.set (false);
     seekFrame.set (0);
@@ -36,9 +35,81 @@ Transport::Transport()
     nextBeatDivisor.set (getBeatType());
     
     setLengthFrames (0);
+    position.resetToDefault();
+    publishSnapshot();
 }
 
-Transport::~Transport() { }
+Transport::~Transport()
+{
+    std::unique_ptr<TempoTable> table (tempoTable.exchange (nullptr));
+}
+
+void Transport::setTempoTable (TempoTable* table)
+{
+    if (auto* const previous = tempoTable.exchange (table))
+        retiredTables.add (previous);
+
+    // tables are only held while a block's position is worked out
+    for (int i = retiredTables.size(); --i >= 0;)
+    {
+        auto* const old = retiredTables.getUnchecked (i);
+        while (tempoTableInUse.load() == old)
+            Thread::yield();
+        retiredTables.remove (i);
+    }
+}
+
+void Transport::prepareToPlay (const double newSampleRate)
+{
+    if (newSampleRate > 0.0)
+        sampleRate = newSampleRate;
+}
+
+bool Transport::getCurrentPosition (CurrentPositionInfo& result)
+{
+    result = position;
+    return true;
+}
+
+void Transport::updatePosition()
+{
+    auto* table = tempoTable.load();
+    tempoTableInUse.store (table);
+    for (auto* latest = tempoTable.load(); latest != table; latest = tempoTable.load())
+    {
+        table = latest;
+        tempoTableInUse.store (table);
+    }
+
+    if (table == nullptr)
+    {
+        Shuttle::getCurrentPosition (position);
+        return;
+    }
+
+    table->fillPosition (position, getPositionFrames());
+    tempoTableInUse.store (nullptr);
+    position.isPlaying   = playing;
+    position.isRecording = recording;
+
+    // the map's tempo is the one everything else follows, the MIDI clock say
+    if (getTempo() != position.bpm)
+        setTempo (position.bpm);
+}
+
+void Transport::publishSnapshot()
+{
+    Monitor::Snapshot snapshot;
+    snapshot.positionFrames = getPositionFrames();
+    snapshot.sampleRate     = sampleRate;
+    snapshot.tempo          = getTempo();
+    snapshot.beatsPerBar    = tempoTable.load() != nullptr ? position.timeSigNumerator : getBeatsPerBar();
+    snapshot.beatType       = getBeatType();
+    snapshot.beatDivisor    = (int) ts.beatDivisor();
+    snapshot.playing        = playing;
+    snapshot.recording      = recording;
+    monitor->publish (snapshot);
+}
 
 void Transport::preProcess (int nframes)
 {
@@ -50,36 +121,36 @@ void Transport::preProcess (int nframes)
         playing = playState.get();
     }
 
-    if (playing) {
-        
+    if (playing && clockSyncWanted && getTempo() > 0.0)
+    {
+        const double framesPerBeat = clockSampleRate * 60.0 / getTempo();
+        const int64 clockFrame = (int64) std::floor (clockBeats * framesPerBeat + 0.5);
+        if (std::abs ((double) (clockFrame - getPositionFrames())) > framesPerBeat * clockTolerance)
+            seekAudioFrame (clockFrame);
     }
+
+    clockSyncWanted = false;
+    updatePosition();
 }
 
 void Transport::postProcess (int nframes)
 {
-    if (getTempo() != nextTempo.get())
+    if (tempoTable.load() == nullptr && getTempo() != nextTempo.get())
     {
         setTempo (nextTempo.get());
         nextTempo.set (getTempo());
-        monitor->tempo.set (nextTempo.get());
     }
     
-    monitor->playing.set (playing);
-    monitor->recording.set (recording);
-    monitor->positionFrames.set (getPositionFrames());
-    
     bool updateTimeScale = false;
     if (getBeatsPerBar() != nextBeatsPerBar.get())
     {
         ts.setBeatsPerBar ((unsigned short) nextBeatsPerBar.get());
-        monitor->beatsPerBar.set (getBeatsPerBar());
         updateTimeScale = true;
     }
     
     if (ts.beatDivisor() != nextBeatDivisor.get())
     {
         ts.setBeatDivisor ((unsigned short) nextBeatDivisor.get());
-        monitor->beatDivisor.set (nextBeatDivisor.get());
         updateTimeScale = true;
     }
     
@@ -92,6 +163,8 @@ void Transport::postProcess (int nframes)
             seekAudioFrame (seekFrame.get());
         seekWanted.set (false);
     }
+
+    publishSnapshot();
 }
 
 void Transport::requestMeter (int beatsPerBar, int beatDivisor)
@@ -104,6 +177,17 @@ void Transport::requestMeter (int beatsPerBar, int beatDivisor)
     nextBeatDivisor.set (beatDivisor);
 }
 
+void Transport::requestClockSync (const double tempo, const double beats, const double sampleRate,
+                                  const double toleranceBeats)
+{
+    if (tempo > 0.0 && tempo != nextTempo.get())
+        requestTempo (tempo);
+    clockBeats      = beats;
+    clockSampleRate = sampleRate;
+    clockTolerance  = toleranceBeats;
+    clockSyncWanted = sampleRate > 0.0;
+}
+
 void Transport::requestAudioFrame (const int64 frame)
 {
     seekFrame.set (frame);
@@ -20,54 +20,108 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/TempoTable.h"
 
 namespace Element
 {
     class Transport : public Shuttle
     {
     public:
+        /** The transport as the GUI and other threads see it. The audio
+            thread publishes a whole snapshot once per block, readers always
+            get one that belongs together. Publishing never waits, a read
+            that overlaps it starts over */
         class Monitor : public ReferenceCountedObject
         {
         public:
+            struct Snapshot
+            {
+                int64  positionFrames   = 0;
+                double sampleRate       = 44100.0;
+                double tempo            = 120.0;
+                int    beatsPerBar      = 4;
+                int    beatType         = 2;
+                int    beatDivisor      = 2;
+                bool   playing          = false;
+                bool   recording        = false;
+
+                inline double getPositionSeconds() const
+                {
+                    return sampleRate > 0.0 ? (double) positionFrames / sampleRate : 0.0;
+                }
+
+                inline double getPositionBeats() const
+                {
+                    const double numerator = (double) (1 << beatDivisor);
+                    const double divisor   = (double) (1 << beatType) / numerator * 60.0;
+                    return getPositionSeconds() * (tempo / divisor);
+                }
+
+                inline void getBarsAndBeats (int& bars, int& beats, int& subBeats,
+                                             int subDivisions = 4) const
+                {
+                    const double t = getPositionBeats();
+                    const int perBar = jmax (1, beatsPerBar);
+                    bars     = (int) std::floor (t / perBar);
+                    beats    = (int) std::floor (t) % perBar;
+                    subBeats = (int) std::floor (t * subDivisions) % subDivisions;
+                }
+            };
+
             Monitor()
             {
-                sampleRate.set (44100.0);
-                beatsPerBar.set (4);
-                beatType.set (2);
-                beatDivisor.set (2);
+                publish (Snapshot());
             }
-            
-            Atomic<int>    beatsPerBar;
-            Atomic<int>    beatType;
-            Atomic<int>    beatDivisor;
-            Atomic<double> sampleRate;
-            Atomic<float>  tempo;
-            Atomic<bool>   playing;
-            Atomic<bool>   recording;
-            Atomic<int64>  positionFrames;
-            
-            inline double getPositionSeconds() const
+
+            /** Replaces the snapshot. Only the audio thread calls this */
+            inline void publish (const Snapshot& snapshot) noexcept
             {
-                return (double) positionFrames.get() / sampleRate.get();
+                uint64 words [numWords] = { 0 };
+                memcpy (words, &snapshot, sizeof (Snapshot));
+
+                const auto seq = sequence.load (std::memory_order_relaxed);
+                sequence.store (seq + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence (std::memory_order_release);
+                for (int i = 0; i < numWords; ++i)
+                    data[i].store (words[i], std::memory_order_relaxed);
+                sequence.store (seq + 2, std::memory_order_release);
             }
-            
-            inline float getPositionBeats() const
+
+            /** Returns the latest snapshot, from any thread */
+            inline Snapshot read() const noexcept
             {
-                float numerator = (float)(1 << beatDivisor.get());
-                float divisor = (float)(1 << beatType.get());
-                divisor = divisor / numerator;
-                divisor *= 60.f;
-                return getPositionSeconds() * (tempo.get() / divisor);
+                uint64 words [numWords];
+                for (;;)
+                {
+                    const auto before = sequence.load (std::memory_order_acquire);
+                    if ((before & 1) != 0)
+                        continue;
+                    for (int i = 0; i < numWords; ++i)
+                        words[i] = data[i].load (std::memory_order_relaxed);
+                    std::atomic_thread_fence (std::memory_order_acquire);
+                    if (sequence.load (std::memory_order_relaxed) == before)
+                        break;
+                }
+
+                Snapshot snapshot;
+                memcpy (&snapshot, words, sizeof (Snapshot));
+                return snapshot;
             }
-            
+
+            inline double getPositionSeconds() const    { return read().getPositionSeconds(); }
+            inline double getPositionBeats() const      { return read().getPositionBeats(); }
+
             inline void getBarsAndBeats (int& bars, int& beats, int& subBeats,
-                                         int subDivisions = 4)
+                                         int subDivisions = 4) const
             {
-                float t  = getPositionBeats();
-                bars     = std::floor(t / beatsPerBar.get());
-                beats    = (int)std::floor(t) % beatsPerBar.get();
-                subBeats = (int)std::floor(t * subDivisions) % subDivisions;
+                read().getBarsAndBeats (bars, beats, subBeats, subDivisions);
             }
+
+        private:
+            static_assert (std::is_trivially_copyable<Snapshot>::value, "snapshots are copied as words");
+            enum { numWords = (int) ((sizeof (Snapshot) + sizeof (uint64) - 1) / sizeof (uint64)) };
+            std::atomic<uint32> sequence { 0 };
+            std::atomic<uint64> data [numWords];
         };
         
         typedef ReferenceCountedObjectPtr<Monitor> MonitorPtr;
@@ -86,6 +140,25 @@ namespace Element
         
         void requestAudioFrame (const int64 frame);
 
+        /** Follows an external clock. Takes its tempo and, while playing,
+            moves to the beat it says the next block starts on whenever the
+            two have drifted more than the tolerance apart, a MIDI clock tick
+            unless given. Call on the audio thread before preProcess() */
+        void requestClockSync (double tempo, double beats, double sampleRate,
+                               double toleranceBeats = 1.0 / 24.0);
+
+        /** Follows a tempo map while playing instead of the single tempo and
+            meter, or goes back to them given nullptr. Takes ownership.
+            Call from the message thread */
+        void setTempoTable (TempoTable* table);
+
+        /** Returns the position of the block being processed. It's worked out
+            once in preProcess() for every node that asks */
+        bool getCurrentPosition (CurrentPositionInfo& result) override;
+
+        /** Sets the rate positions are reported in seconds and beats for */
+        void prepareToPlay (double sampleRate);
+
         void preProcess (int nframes);
         void postProcess (int nframes);
 
@@ -98,7 +171,18 @@ namespace Element
         
         Atomic<bool> seekWanted;
         AtomicValue<int64> seekFrame;
+
+        bool clockSyncWanted = false;
+        double clockBeats = 0.0, clockSampleRate = 0.0, clockTolerance = 0.0;
         
         MonitorPtr monitor;
+
+        CurrentPositionInfo position;
+        std::atomic<TempoTable*> tempoTable { nullptr };
+        std::atomic<TempoTable*> tempoTableInUse { nullptr };
+        OwnedArray<TempoTable> retiredTables;
+        double sampleRate = 44100.0;
+        void updatePosition();
+        void publishSnapshot();
     };
 }
@@ -35,7 +35,8 @@ public:
         Hard_2,
         Hard_3,
         Max,
-        numModes
+        numModes,
+        Custom = numModes   ///< a user table, not one of the presets
     };
 
     VelocityCurve() { setMode (Linear); }
@@ -53,6 +54,7 @@ public:
             case Hard_2: return "Harder"; break;
             case Hard_3: return "Hardest"; break;
             case Max: return "Max"; break;
+            case Custom: return "Custom"; break;
         }
 
         return { };
@@ -60,9 +62,11 @@ public:
 
     inline String getModeName() const { return getModeName (mode); }
     inline int getMode() const { return static_cast<int> (mode); }
+
+    /** Changes to one of the preset curves and rebuilds the lookup table */
     inline void setMode (const Mode m)
     {
-        if (mode == m) 
+        if (mode == m || m == Custom)
             return;
         mode = m;
 
@@ -78,9 +82,65 @@ public:
             case Hard_2: setOffset (0.65); break;
             case Hard_3: setOffset (0.75); break;
         }
+
+        for (int i = 0; i < 128; ++i)
+        {
+            levels[i] = compute (static_cast<float> (i) / 127.f);
+            table[i]  = toMidiByte (levels[i]);
+        }
+        table[0] = 0;
+    }
+
+    /** Uses a curve of the user's own. Velocity i becomes values[i] */
+    inline void setCustomCurve (const uint8* values)
+    {
+        mode = Custom;
+        for (int i = 0; i < 128; ++i)
+        {
+            table[i]  = static_cast<uint8> (jmin (127, static_cast<int> (values[i])));
+            levels[i] = static_cast<float> (table[i]) / 127.f;
+        }
+        table[0] = 0;
+    }
+
+    /** Returns the 128 entry table the curve is looked up in */
+    inline const uint8* getTable() const noexcept { return table; }
+
+    /** Maps a normalized velocity, interpolating between the curve's
+        values at each MIDI velocity */
+    inline float process (float velocity) const noexcept
+    {
+        if (mode == Linear)
+            return velocity;
+
+        const float index = jlimit (0.f, 127.f, velocity * 127.f);
+        // nudged so velocities that started out as MIDI bytes land on their entry
+        const int low = jmin (127, static_cast<int> (index + 1.0e-4f));
+        const int high = jmin (127, low + 1);
+        const float frac = jmax (0.f, index - static_cast<float> (low));
+        return levels[low] + (levels[high] - levels[low]) * frac;
+    }
+
+    inline uint8 process (const uint8 velocity) const noexcept
+    {
+        return table [velocity & 127];
     }
 
-    inline float process (float velocity)
+private:
+    Mode mode = numModes;
+    float rsq;
+    float c0, c1;
+    float t;
+    float levels [128];     // the curve at each velocity, normalized
+    uint8 table [128];      // and rounded to MIDI velocities
+
+    static uint8 toMidiByte (float velocity) noexcept
+    {
+        return static_cast<uint8> (jlimit (0, 127, roundToInt (velocity * 127.f)));
+    }
+
+    /** The curve itself, only evaluated while building the table */
+    inline float compute (float velocity) const
     {
         if (mode == Linear)
         {
@@ -107,25 +167,9 @@ public:
             jassertfalse;
         }
 
-        return velocity / 127.f;
+        return jlimit (0.f, 1.f, velocity / 127.f);
     }
 
-    inline uint8 process (const uint8 velocity)
-    {
-        if (mode == Linear)
-            return velocity;
-        else if (mode == Max)
-            return 127;
-        return static_cast<uint8> (roundToIntAccurate (
-            process (static_cast<float> (velocity) / 127.f)));
-    }
-
-private:
-    Mode mode;
-    float rsq;
-    float c0, c1;
-    float t;
-
     void setOffset (float newT)
     {
        #define dbgVars 0
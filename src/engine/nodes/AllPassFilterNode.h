@@ -20,53 +20,55 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/DelayLine.h"
 
 namespace Element {
 
+/** A Schroeder all-pass over every channel of a block at once. The delay
+    is preallocated, so its length can move while playing */
 class AllPassFilter
 {
 public:
-    AllPassFilter() noexcept : bufferSize (0), bufferIndex (0) {}
-    
-    void setSize (const int size)
-    {
-        if (size != bufferSize)
-        {
-            bufferIndex = 0;
-            buffer.malloc ((size_t) size);
-            bufferSize = size;
-        }
-        
-        clear();
-    }
-    
-    void clear() noexcept
-    {
-        bufferIndex = 0;
-        buffer.clear ((size_t) bufferSize);
-    }
-    
-    void free()
+    AllPassFilter() noexcept { }
+
+    /** Allocates the delay. Not realtime safe */
+    void prepare (const int maxLengthSamples, const int numChannels, const int rampSamples)
     {
-        bufferSize = 0;
-        bufferIndex = 0;
-        buffer.free();
+        line.prepare (maxLengthSamples, numChannels, rampSamples);
     }
-    
-    float process (const float input) noexcept
+
+    /** Sets the length in samples, gliding there unless glide is false. Realtime safe */
+    void setLength (const float numSamples, const bool glide = true) noexcept { line.setDelay (numSamples, glide); }
+
+    void clear() noexcept   { line.clear(); }
+    void free()             { line.free(); }
+
+    /** Filters channels in place */
+    void processBlock (float* const* channels, const int numChannels, const int numSamples) noexcept
     {
-        const float bufferedValue = buffer [bufferIndex];
-        float temp = input + (bufferedValue * 0.5f);
-        JUCE_UNDENORMALISE (temp);
-        buffer [bufferIndex] = temp;
-        bufferIndex = (bufferIndex + 1) % bufferSize;
-        return bufferedValue - input;
+        if (! line.isPrepared())
+            return;
+
+        const ScopedNoDenormals noDenormals;
+        const int numChans = jmin (numChannels, line.getNumChannels());
+        float buffered [FeedbackDelay::maxChannels] = {};
+        float input    [FeedbackDelay::maxChannels] = {};
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            line.read (buffered);
+            for (int c = 0; c < numChans; ++c)
+            {
+                input[c] = channels[c][i] + (buffered[c] * 0.5f);
+                channels[c][i] = buffered[c] - channels[c][i];
+            }
+            line.write (input);
+        }
     }
-    
+
 private:
-    HeapBlock<float> buffer;
-    int bufferSize, bufferIndex;
-    
+    FeedbackDelay line;
+
     JUCE_DECLARE_NON_COPYABLE (AllPassFilter)
 };
 
@@ -82,6 +84,8 @@ public:
     {
         setPlayConfigDetails (stereo ? 2 : 1, stereo ? 2 : 1, 44100.0, 1024);
         addParameter (length   = new AudioParameterFloat ("length",   "Buffer Length",  1.f, 500.f, 90.f));
+        smoothedLength.attach (*length);
+        addSmoothedParameter (smoothedLength);
         lastLength = *length;
     }
     
@@ -108,35 +112,43 @@ public:
     
     void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
     {
+        const int numChans = stereo ? 2 : 1;
+        allPass.prepare (roundToIntAccurate (length->range.end * sampleRate * 0.001),
+                         numChans, roundToIntAccurate (sampleRate * 0.02));
+        prepareSmoothedParameters (sampleRate, maximumExpectedSamplesPerBlock);
         lastLength = *length;
-        for (int i = 0; i < 2; ++i)
-            allPass[i].setSize (*length * sampleRate * 0.001);
-        setPlayConfigDetails (stereo ? 2 : 1, stereo ? 2 : 1,
-                              sampleRate, maximumExpectedSamplesPerBlock);
+        allPass.setLength ((float) (*length * sampleRate * 0.001), false);
+        setPlayConfigDetails (numChans, numChans, sampleRate, maximumExpectedSamplesPerBlock);
     }
     
     void releaseResources() override
     {
-        for (int i = 0; i < 2; ++i)
-            allPass[i].free();
+        allPass.free();
     }
     
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
     {
-        if (lastLength != *length)
+        const int numSamples = buffer.getNumSamples();
+        const int numChans = jmin (stereo ? 2 : 1, buffer.getNumChannels());
+        const float* const lengthValues = smoothedLength.process (numSamples);
+        const bool moving = smoothedLength.isSmoothing();
+
+        // the delay glides between lengths itself, it only needs them every so often
+        const int step = moving ? (int) SmoothedParameter::interval : numSamples;
+        float* channels [2] = {};
+        for (int offset = 0; offset < numSamples; offset += step)
         {
-            const int newSize = roundToIntAccurate (*length * getSampleRate() * 0.001);
-            for (int i = 0; i < 2; ++i)
-                allPass[i].setSize (newSize);
-            lastLength = *length;
+            const float newLength = moving ? lengthValues[offset] : smoothedLength.getCurrentValue();
+            if (lastLength != newLength)
+            {
+                allPass.setLength ((float) (newLength * getSampleRate() * 0.001));
+                lastLength = newLength;
+            }
+
+            for (int c = 0; c < numChans; ++c)
+                channels[c] = buffer.getWritePointer (c, offset);
+            allPass.processBlock (channels, numChans, jmin (step, numSamples - offset));
         }
-        
-        const int numChans = jmin (2, buffer.getNumChannels());
-        const auto** input = buffer.getArrayOfReadPointers();
-        auto** output = buffer.getArrayOfWritePointers();
-        for (int c = 0; c < numChans; ++c)
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-                output[c][i] = allPass[c].process (input[c][i]);
     }
     
     AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
@@ -166,12 +178,16 @@ public:
         {
             auto state = ValueTree::fromXml (*e);
             if (state.isValid())
+            {
                 *length   = (float) state.getProperty ("length",   (float) *length);
+                resetSmoothedParameters();
+            }
         }
     }
     
 private:
-    AllPassFilter allPass[2];
+    AllPassFilter allPass;
+    SmoothedParameter smoothedLength;
     float lastLength;
 };
 
@@ -28,6 +28,7 @@
 #include "gui/views/PluginsPanelView.h"
 #include "gui/NavigationConcertinaPanel.h"
 
+#include "FileIndex.h"
 #include "Utils.h"
 
 namespace Element {
@@ -61,6 +62,16 @@ public:
         loopButton.setButtonText ("Loop");
         loopButton.setColour (TextButton::buttonOnColourId, Colors::toggleBlue);
 
+        addAndMakeVisible (loadModeBox);
+        loadModeBox.addItem ("Stream from disk", 1 + AudioFilePlayerNode::Streamed);
+        loadModeBox.addItem ("Memory mapped", 1 + AudioFilePlayerNode::MemoryMapped);
+        loadModeBox.addItem ("Load into memory", 1 + AudioFilePlayerNode::InMemory);
+
+        addAndMakeVisible (qualityBox);
+        qualityBox.addItem ("Fast resampling", 1 + SincResamplingAudioSource::Fast);
+        qualityBox.addItem ("Good resampling", 1 + SincResamplingAudioSource::Good);
+        qualityBox.addItem ("Best resampling", 1 + SincResamplingAudioSource::Best);
+
         addAndMakeVisible (startStopContinueToggle);
         startStopContinueToggle.setButtonText ("Respond to MIDI start/stop/continue");
 
@@ -92,20 +103,23 @@ public:
     {
         if (recentsDir.isDirectory())
         {
-            DirectoryIterator iter (recentsDir, recursive, processor.getWildcard(), File::findFiles);
-            while (iter.next())
-            {
-                if (iter.getFile().isDirectory())
-                    continue;
-                chooser->addRecentlyUsedFile (iter.getFile());
-            }
+            Array<File> files;
+            index->findFiles (recentsDir, recursive, processor.getWildcard(), files);
+            for (const auto& file : files)
+                chooser->addRecentlyUsedFile (file);
 
             sortRecents();
         }
     }
 
     void timerCallback() override { stabilizeComponents(); }
-    void changeListenerCallback (ChangeBroadcaster*) override { stabilizeComponents(); }
+    void changeListenerCallback (ChangeBroadcaster* source) override
+    {
+        // pick up files that arrived in the watched folder
+        if (source == &index.get())
+            addRecentsFrom (processor.getWatchDir());
+        stabilizeComponents();
+    }
 
     void stabilizeComponents()
     {
@@ -121,6 +135,8 @@ public:
         playButton.setButtonText (playButton.getToggleState() ? "Pause" : "Play");
 
         loopButton.setToggleState (processor.isLooping(), dontSendNotification);
+        loadModeBox.setSelectedId (1 + processor.getLoadMode(), dontSendNotification);
+        qualityBox.setSelectedId (1 + processor.getResampleQuality(), dontSendNotification);
 
         if (! draggingPos)
         {
@@ -163,7 +179,11 @@ public:
         r.removeFromTop (4);
         playButton.setBounds (r.removeFromTop (18));
         r.removeFromTop (4);
-        loopButton.setBounds (r.removeFromTop (18));
+        auto r3 = r.removeFromTop (18);
+        const int boxWidth = r3.getWidth() / 3;
+        loadModeBox.setBounds (r3.removeFromRight (boxWidth).withTrimmedLeft (4));
+        qualityBox.setBounds (r3.removeFromRight (boxWidth).withTrimmedLeft (4));
+        loopButton.setBounds (r3);
         r.removeFromTop (4);
         volume.setBounds (r.removeFromTop (18));
         r.removeFromTop (4);
@@ -226,11 +246,14 @@ public:
 
 private:
     AudioFilePlayerNode& processor;
+    SharedResourcePointer<FileIndex> index;
     std::unique_ptr<FilenameComponent> chooser;
     Slider position;
     Slider volume;
     TextButton playButton;
     TextButton loopButton;
+    ComboBox loadModeBox;
+    ComboBox qualityBox;
     IconButton watchButton;
     ToggleButton startStopContinueToggle;
     Atomic<int> startStopContinue { 0 };
@@ -247,6 +270,7 @@ private:
     void bindHandlers()
     {
         processor.getPlayer().addChangeListener (this);
+        index->addChangeListener (this);
         processor.restoredState.connect (std::bind(
             &AudioFilePlayerEditor::onStateRestored, this
         ));
@@ -276,6 +300,18 @@ private:
             stabilizeComponents();
         };
 
+        loadModeBox.onChange = [this]()
+        {
+            processor.setLoadMode ((AudioFilePlayerNode::LoadMode) (loadModeBox.getSelectedId() - 1));
+            stabilizeComponents();
+        };
+
+        qualityBox.onChange = [this]()
+        {
+            processor.setResampleQuality ((SincResamplingAudioSource::Quality) (qualityBox.getSelectedId() - 1));
+            stabilizeComponents();
+        };
+
         volume.onValueChange = [this]() {
             int index = AudioFilePlayerNode::Volume;
             if (auto* const param = dynamic_cast<AudioParameterFloat*> (processor.getParameters()[index]))
@@ -311,12 +347,15 @@ private:
     {
         playButton.onClick = nullptr;
         loopButton.onClick = nullptr;
+        loadModeBox.onChange = nullptr;
+        qualityBox.onChange = nullptr;
         position.onDragStart = nullptr;
         position.onDragEnd = nullptr;
         position.textFromValueFunction = nullptr;
         volume.onValueChange = nullptr;
         startStopContinueToggle.onClick = nullptr;
         processor.getPlayer().removeChangeListener (this);
+        index->removeChangeListener (this);
         chooser->removeListener (this);
         watchButton.onClick = nullptr;
     }
@@ -381,44 +420,269 @@ void AudioFilePlayerNode::fillInPluginDescription (PluginDescription& desc) cons
 void AudioFilePlayerNode::clearPlayer()
 {
     player.setSource (nullptr);
-    if (reader)
-        reader = nullptr;
+    resampler = nullptr;
+    if (source)
+        source = nullptr;
     *playing = player.isPlaying();
 }
 
-void AudioFilePlayerNode::openFile (const File& file)
+/** Frames and channels streamed files are buffered with */
+static const int streamedFrames = 1024 * 8;
+static const int streamedChannels = 2;
+
+int64 AudioFilePlayerNode::getMemoryBytes() const
+{
+    const ScopedLock sl (getCallbackLock());
+    if (auto* cached = dynamic_cast<CachedAudioSource*> (source.get()))
+        return cached->getEntry()->getSizeInBytes();
+    if (streamed.load() && source != nullptr)
+        return (int64) streamedFrames * streamedChannels * (int64) sizeof (float);
+    return 0;
+}
+
+/* Ten minutes of stereo at 48 kHz. Anything longer is streamed instead of
+   being decoded into memory */
+static const int64 maxInMemoryFrames = 48000 * 60 * 10;
+
+//=============================================================================
+/** Opens a file on the job service's thread. The node swaps its source for
+    the new one when the job responds, and the old source goes back with the
+    job to be deleted off the render thread */
+struct AudioFilePlayerNode::OpenJob : public JobService::Job
+{
+    OpenJob (AudioFilePlayerNode& n, const File& f, double pos, bool shouldPlay)
+        : node (n), file (f),
+          loadMode (n.loadMode),
+          quality (n.resampleQuality),
+          cues (n.cues),
+          cueBufferTime (n.cueBufferTime),
+          prepared (n.prepared),
+          sampleRate (n.renderSampleRate),
+          blockSize (n.renderBlockSize),
+          position (pos),
+          play (shouldPlay),
+          serial (++n.latestLoad)
+    { }
+
+    void run() override
+    {
+        AudioFormatManager formats;
+        formats.registerBasicFormats();
+        source.reset (createSource (formats));
+        if (source == nullptr)
+            return;
+
+        if (auto* stream = isStreamed ? dynamic_cast<StreamingAudioSource*> (source.get()) : nullptr)
+        {
+            // sources in memory start instantly anyway
+            Array<int64> positions;
+            positions.add (0);
+            for (auto cue : cues)
+                positions.addIfNotAlreadyThere ((int64) (cue * sourceSampleRate));
+            stream->setCues (positions, roundToInt (cueBufferTime * sourceSampleRate / 1000.0));
+        }
+
+        resampler.reset (new SincResamplingAudioSource (source.get(), false, sourceSampleRate, 2, quality));
+        if (prepared)
+            resampler->prepareToPlay (blockSize, sampleRate);
+    }
+
+    void respond() override
+    {
+        node.install (*this);
+    }
+
+    AudioFilePlayerNode& node;
+    const File file;
+    const LoadMode loadMode;
+    const SincResamplingAudioSource::Quality quality;
+    const Array<double> cues;
+    const int cueBufferTime;
+    const bool prepared;
+    const double sampleRate;
+    const int blockSize;
+    const double position;
+    const bool play;
+    const int serial;
+
+    // the new source while it's read, the old one once it responds
+    std::unique_ptr<PositionableAudioSource> source;
+    std::unique_ptr<SincResamplingAudioSource> resampler;
+    double sourceSampleRate = 0.0;
+    bool isStreamed = false;
+
+private:
+    PositionableAudioSource* createSource (AudioFormatManager& formats)
+    {
+        if (loadMode == InMemory)
+        {
+            // decoded once, then shared with other players and kept between sessions
+            if (auto entry = node.cache->load (file, formats, maxInMemoryFrames))
+            {
+                sourceSampleRate = entry->sampleRate;
+                return new CachedAudioSource (entry, false);
+            }
+        }
+
+        if (loadMode == MemoryMapped)
+        {
+            auto* format = formats.findFormatForFileExtension (file.getFileExtension());
+            std::unique_ptr<MemoryMappedAudioFormatReader> mapped (
+                format != nullptr ? format->createMemoryMappedReader (file) : nullptr);
+
+            if (mapped != nullptr && mapped->mapEntireFile())
+            {
+                // fault the pages in now rather than on the audio thread
+                for (int64 frame = 0; frame < mapped->lengthInSamples; frame += 512)
+                    mapped->touchSample (frame);
+                sourceSampleRate = mapped->sampleRate;
+                return new AudioFormatReaderSource (mapped.release(), true);
+            }
+        }
+
+        std::unique_ptr<AudioFormatReader> newReader (formats.createReaderFor (file));
+        if (newReader == nullptr)
+            return nullptr;
+
+        sourceSampleRate = newReader->sampleRate;
+        isStreamed = true;
+        return new StreamingAudioSource (new AudioFormatReaderSource (newReader.release(), true), true,
+                                         *node.streamer, streamedFrames, streamedChannels);
+    }
+};
+
+void AudioFilePlayerNode::attachSource()
 {
-    if (file == audioFile)
+    // streams buffer themselves, and sources in memory are read on the audio
+    // thread, so the transport needn't read ahead. The transport's own
+    // resampler is bypassed for the sinc one, which works in device frames
+    player.setSource (nullptr);
+    resampler.reset (new SincResamplingAudioSource (source.get(), false, sourceSampleRate, 2, resampleQuality));
+    player.setSource (resampler.get(), 0, nullptr, 0.0, 2);
+}
+
+void AudioFilePlayerNode::install (OpenJob& job)
+{
+    // a newer file was asked for while this one was read
+    if (job.serial != latestLoad.load())
         return;
-    if (auto* newReader = formats.createReaderFor (file))
+
+    if (job.source == nullptr)
     {
-        clearPlayer();
-        reader.reset (new AudioFormatReaderSource (newReader, true));
-        audioFile = file;
-        player.setSource (reader.get(), 1024 * 8, &thread, 
-                          newReader->sampleRate, 2);
+        loadFailed.store (job.serial);
+        triggerAsyncUpdate();
+        return;
+    }
 
-        ScopedLock sl (getCallbackLock());
-        reader->setLooping (*looping);
-        player.setLooping (*looping);
+    // the transport is stopped by the swap, reloads pick up where they were
+    player.setSource (job.resampler.get(), 0, nullptr, 0.0, 2);
+    std::swap (source, job.source);
+    std::swap (resampler, job.resampler);
+    sourceSampleRate = job.sourceSampleRate;
+    streamed.store (job.isStreamed);
+
+    source->setLooping (*looping);
+    player.setLooping (*looping);
+    if (job.position > 0.0)
+        player.setPosition (job.position);
+    if (job.play)
+        player.start();
+
+    fileSwapped.store (true);
+    triggerAsyncUpdate();
+}
+
+void AudioFilePlayerNode::load (const File& file, double position, bool play)
+{
+    lastGoodFile = audioFile;
+    audioFile = file;
+
+    std::unique_ptr<OpenJob> job (new OpenJob (*this, file, position, play));
+    if (prepared && jobs.schedule (job.get()))
+    {
+        job.release();
+        return;
     }
+
+    // nothing is rendering to hand the file to, so it's opened here
+    job->run();
+    if (job->source == nullptr)
+    {
+        audioFile = lastGoodFile;
+        return;
+    }
+
+    const ScopedLock sl (getCallbackLock());
+    install (*job);
+}
+
+void AudioFilePlayerNode::reload()
+{
+    if (audioFile != File())
+        load (audioFile, player.getCurrentPosition(), player.isPlaying());
+}
+
+void AudioFilePlayerNode::openFile (const File& file)
+{
+    if (file != audioFile)
+        load (file, 0.0, false);
+}
+
+bool AudioFilePlayerNode::waitUntilLoaded (int timeoutMs)
+{
+    return jobs.waitUntilReady (timeoutMs);
+}
+
+void AudioFilePlayerNode::setCues (const Array<double>& seconds)
+{
+    cues = seconds;
+    cues.sort();
+    if (streamed.load())
+        reload();
+}
+
+void AudioFilePlayerNode::setCueBufferTime (int milliseconds)
+{
+    milliseconds = jlimit (0, 10000, milliseconds);
+    if (milliseconds == cueBufferTime)
+        return;
+    cueBufferTime = milliseconds;
+    if (streamed.load())
+        reload();
+}
+
+void AudioFilePlayerNode::setLoadMode (LoadMode mode)
+{
+    if (mode == loadMode)
+        return;
+    loadMode = mode;
+    reload();
+}
+
+void AudioFilePlayerNode::setResampleQuality (SincResamplingAudioSource::Quality quality)
+{
+    if (quality == resampleQuality)
+        return;
+    resampleQuality = quality;
+    reload();
 }
 
 void AudioFilePlayerNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
-    thread.startThread();
     formats.registerBasicFormats();
     player.prepareToPlay (maximumExpectedSamplesPerBlock, sampleRate);
 
-    if (reader)
-    {
-        double readerSampleRate = sampleRate;
-        if (auto* fmtReader = reader->getAudioFormatReader())
-            readerSampleRate = fmtReader->sampleRate;
+    // files read while nothing was rendering
+    jobs.deliverResponses();
+    prepared = true;
+    renderSampleRate = sampleRate;
+    renderBlockSize = maximumExpectedSamplesPerBlock;
 
-        reader->setLooping (*looping);
+    if (source)
+    {
+        source->setLooping (*looping);
         player.setLooping (*looping);
-        player.setSource (reader.get(), 1024 * 8, &thread, readerSampleRate, 2);
+        attachSource();
         player.setPosition (jmax (0.0, lastTransportPos));
         if (wasPlaying)
             player.start();
@@ -431,6 +695,8 @@ void AudioFilePlayerNode::prepareToPlay (double sampleRate, int maximumExpectedS
 
 void AudioFilePlayerNode::releaseResources()
 {
+    prepared = false;
+    jobs.deliverResponses();
     lastTransportPos = player.getCurrentPosition();
     wasPlaying = player.isPlaying();
 
@@ -438,7 +704,6 @@ void AudioFilePlayerNode::releaseResources()
     player.releaseResources();
     player.setSource (nullptr);
     formats.clearFormats();
-    thread.stopThread (14);
 }
 
 void AudioFilePlayerNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
@@ -462,6 +727,8 @@ void AudioFilePlayerNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer&
     info.buffer = &buffer;
 
     ScopedLock sl (getCallbackLock());
+    jobs.deliverResponses();
+
     if (midiStartStopContinue.get() == 1)
     {
         while (iter.getNextEvent (msg, frame))
@@ -470,18 +737,24 @@ void AudioFilePlayerNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer&
             info.numSamples = frame - start;
             player.getNextAudioBlock (info);
 
+            // the transport's started here so playback begins on the
+            // message's frame, the parameter catches up afterwards
             if (msg.isMidiStart())
             {
+                player.setPosition (0.0);
+                player.start();
                 midiPlayState.set (Start);
                 triggerAsyncUpdate();
             } 
             else if (msg.isMidiContinue())
             {
+                player.start();
                 midiPlayState.set (Continue);
                 triggerAsyncUpdate();
             }
             else if (msg.isMidiStop())
             {
+                player.stop();
                 midiPlayState.set (Stop);
                 triggerAsyncUpdate();
             }
@@ -513,22 +786,22 @@ bool AudioFilePlayerNode::isLooping() const
 
 void AudioFilePlayerNode::handleAsyncUpdate()
 {
+    if (loadFailed.exchange (0) == latestLoad.load())
+        audioFile = lastGoodFile;
+    if (fileSwapped.exchange (false))
+        *playing = player.isPlaying();
+
     switch (midiPlayState.get())
     {
         case Start:
+        case Continue:
         {
-            player.setPosition (0.0);
-            player.start();
+            *playing = true;
         } break;
 
         case Stop:
         {
-            player.stop();
-        } break;
-
-        case Continue:
-        {
-            player.start();
+            *playing = false;
         } break;
 
         case None:
@@ -551,7 +824,18 @@ void AudioFilePlayerNode::getStateInformation (juce::MemoryBlock& destData)
          .setProperty ("playing", (bool)*playing, nullptr)
          .setProperty ("slave", (bool)*slave, nullptr)
          .setProperty ("loop", (bool)*looping, nullptr)
-         .setProperty ("midiStartStopContinue", midiStartStopContinue.get() == 1, nullptr);
+         .setProperty ("midiStartStopContinue", midiStartStopContinue.get() == 1, nullptr)
+         .setProperty ("loadMode", (int) loadMode, nullptr)
+         .setProperty ("resampleQuality", (int) resampleQuality, nullptr)
+         .setProperty ("cueBufferTime", cueBufferTime, nullptr);
+
+    if (! cues.isEmpty())
+    {
+        StringArray times;
+        for (auto cue : cues)
+            times.add (String (cue));
+        state.setProperty ("cues", times.joinIntoString (" "), nullptr);
+    }
     
     if (watchDir.exists())
         state.setProperty ("watchDir", watchDir.getFullPathName(), nullptr);
@@ -565,11 +849,22 @@ void AudioFilePlayerNode::setStateInformation (const void* data, int sizeInBytes
     const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
     if (state.isValid())
     {
+        // read once with everything restored
+        loadMode = (LoadMode) jlimit ((int) Streamed, (int) InMemory,
+                                      (int) state.getProperty ("loadMode", (int) Streamed));
+        resampleQuality = (SincResamplingAudioSource::Quality) jlimit (
+            (int) SincResamplingAudioSource::Fast, (int) SincResamplingAudioSource::Best,
+            (int) state.getProperty ("resampleQuality", (int) SincResamplingAudioSource::Good));
+        Array<double> restoredCues;
+        for (const auto& time : StringArray::fromTokens (state["cues"].toString(), " ", {}))
+            restoredCues.add (time.getDoubleValue());
+        cues.swapWith (restoredCues);
+        cueBufferTime = jlimit (0, 10000, (int) state.getProperty ("cueBufferTime", 500));
+        *looping = (bool) state.getProperty ("loop", true);
         if (File::isAbsolutePath (state["audioFile"].toString()))
-            openFile (File (state["audioFile"].toString()));
+            load (File (state["audioFile"].toString()), 0.0, (bool) state.getProperty ("playing", false));
         *playing = (bool) state.getProperty ("playing", false);
         *slave = (bool) state.getProperty ("slave", false);
-        *looping = (bool) state.getProperty ("loop", true);
         midiStartStopContinue.set ((bool) state.getProperty ("midiStartStopContinue", false) ? 1 : 0);
         if (state.hasProperty ("watchDir"))
         {
@@ -606,10 +901,11 @@ void AudioFilePlayerNode::parameterValueChanged (int parameter, float newValue)
 
         case Looping:
         {
-            if (reader != nullptr)
+            const ScopedLock sl (getCallbackLock());
+            if (source != nullptr)
             {
                 player.setLooping (*looping);
-                reader->setLooping (*looping);
+                source->setLooping (*looping);
             }
         } break;
     }
@@ -20,6 +20,10 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/AudioCache.h"
+#include "engine/DiskStreamer.h"
+#include "engine/JobService.h"
+#include "engine/SincResampler.h"
 #include "Signals.h"
 
 namespace Element {
@@ -32,6 +36,17 @@ public:
     enum Parameters { Playing = 0, Slave, Volume, Looping };
     enum MidiPlayState { None = 0, Start, Stop, Continue };
 
+    /** How the audio file is read while playing */
+    enum LoadMode
+    {
+        /** Decoded ahead of the playhead by the disk streamer */
+        Streamed = 0,
+        /** Read straight from a memory mapped WAV or AIFF file */
+        MemoryMapped,
+        /** Decoded into memory up front, shared with other players through the AudioCache */
+        InMemory
+    };
+
     AudioFilePlayerNode ();
     virtual ~AudioFilePlayerNode();
 
@@ -44,7 +59,42 @@ public:
     void setLooping (const bool shouldLoop);
     bool isLooping() const;
 
+    /** Returns the decoded file held in the cache, or the streaming buffer */
+    int64 getMemoryBytes() const override;
+
+    /** Opens a file. While the node is prepared the file is read on the job
+        service's thread and swapped in at the start of a block, otherwise
+        it's read straight away. A file that can't be read leaves the one
+        playing as it was */
     void openFile (const File& file);
+
+    /** Blocks until the files asked for have been read and are waiting for
+        the next block, or the timeout passes */
+    bool waitUntilLoaded (int timeoutMs);
+
+    /** Changes how files are read. The open file is loaded again.
+        Memory mapping only applies to WAV and AIFF files, and files too long
+        to hold in memory are streamed */
+    void setLoadMode (LoadMode mode);
+    LoadMode getLoadMode() const { return loadMode; }
+
+    /** Changes the filter converting files to the device's sample rate */
+    void setResampleQuality (SincResamplingAudioSource::Quality quality);
+    SincResamplingAudioSource::Quality getResampleQuality() const { return resampleQuality; }
+
+    /** Sets the positions, in seconds, that playback often starts from. When
+        streaming, the audio after each cue and the start of the file is held
+        in memory so starting there doesn't wait on the disk. A streamed
+        file is loaded again with the new cues */
+    void setCues (const Array<double>& seconds);
+    const Array<double>& getCues() const { return cues; }
+
+    /** Sets how much audio after each cue is held in memory */
+    void setCueBufferTime (int milliseconds);
+    int getCueBufferTime() const { return cueBufferTime; }
+
+    /** Returns true if the open file is read through the disk streamer */
+    bool isStreaming() const { return streamed.load(); }
     const File& getAudioFile() const { return audioFile; }
     String getWildcard() const { return formats.getWildcardForAllFormats(); }
     
@@ -127,8 +177,16 @@ protected:
 #endif
 
 private:
-    TimeSliceThread thread { "MediaPlayer" };
-    std::unique_ptr<AudioFormatReaderSource> reader;
+    SharedResourcePointer<DiskStreamer> streamer;
+    SharedResourcePointer<AudioCache> cache;
+    std::unique_ptr<PositionableAudioSource> source;
+    std::unique_ptr<SincResamplingAudioSource> resampler;
+    double sourceSampleRate { 44100.0 };
+    LoadMode loadMode { Streamed };
+    SincResamplingAudioSource::Quality resampleQuality { SincResamplingAudioSource::Good };
+    std::atomic<bool> streamed { true };
+    Array<double> cues;
+    int cueBufferTime { 500 };
     AudioFormatManager formats;
     AudioTransportSource player;
 
@@ -146,7 +204,21 @@ private:
     
     File watchDir;
 
+    bool prepared { false };
+    double renderSampleRate { 44100.0 };
+    int renderBlockSize { 512 };
+    File lastGoodFile;
+    std::atomic<int> latestLoad { 0 }, loadFailed { 0 };
+    std::atomic<bool> fileSwapped { false };
+    JobService::Client jobs;
+
+    struct OpenJob;
+    friend struct OpenJob;
     void clearPlayer();
+    void attachSource();
+    void install (OpenJob&);
+    void load (const File& file, double position, bool play);
+    void reload();
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFilePlayerNode)
 };
 
@@ -20,6 +20,7 @@
 #include "engine/nodes/AudioMixerProcessor.h"
 #include "gui/widgets/HorizontalListBox.h"
 #include "gui/LookAndFeel.h"
+#include "gui/RefreshClock.h"
 
 #define EL_FADER_MIN_DB     -90.0
 #define EL_FADER_MAX_DB     12.0
@@ -29,7 +30,7 @@ namespace Element {
 typedef AudioMixerProcessor::MonitorPtr MonitorPtr;
 
 class AudioMixerEditor : public AudioProcessorEditor,
-                         private Timer
+                         private RefreshClient
 {
 public:
     AudioMixerEditor (AudioMixerProcessor& p) 
@@ -40,10 +41,14 @@ public:
         setName ("AudioMixerEditor");
         addAndMakeVisible (channels);
         setSize (330, 210);
-        startTimerHz (24);
+        owner.beginMetering();
+        startRefresh (24);
     }
 
-    ~AudioMixerEditor() noexcept { }
+    ~AudioMixerEditor() noexcept
+    {
+        owner.endMetering();
+    }
 
     void paint (Graphics& g) override 
     {
@@ -349,8 +354,7 @@ private:
     ScopedPointer<ChannelStrip> masterStrip;
     MonitorPtr masterMonitor;
 
-    friend class Timer;
-    void timerCallback() override
+    void refreshCallback() override
     {
         for (auto* const strip : strips)
         {
@@ -362,28 +366,32 @@ private:
 
 AudioMixerProcessor::~AudioMixerProcessor()
 {
-    Array<Track*> oldTracks;
-    {
-        ScopedLock sl (getCallbackLock());
-        masterMute = nullptr;
-        masterVolume = nullptr;
-        tracks.swapWith (oldTracks);
-    }
-
-    for (auto* t : oldTracks)
-        delete t;
+    masterMute = nullptr;
+    masterVolume = nullptr;
 }
 
 AudioMixerProcessor::MonitorPtr AudioMixerProcessor::getMonitor (const int track) const
 {
     if (track < 0)
         return masterMonitor;
-    ScopedLock sl (getCallbackLock());
+    ScopedLock sl (lock);
     if (! isPositiveAndBelow (track, tracks.size()))
         return nullptr;
     return tracks.getUnchecked(track)->monitor;
 }
 
+void AudioMixerProcessor::publishTracks()
+{
+    // called with the lock held, after the tracks have changed
+    auto& snapshot = snapshots [snapshotBack];
+    snapshot.clearQuick();
+    snapshot.ensureStorageAllocated (tracks.size());
+    for (const auto* const track : tracks)
+        snapshot.add (*track);
+
+    snapshotBack = snapshotMiddle.exchange (snapshotBack | tracksDirty) & trackIndexMask;
+}
+
 void AudioMixerProcessor::addMonoTrack()
 {
     auto* track = new Track();
@@ -391,9 +399,6 @@ void AudioMixerProcessor::addMonoTrack()
     track->busIdx = -1;
     track->numInputs = 1;
     track->numOutputs = 2;
-    track->lastGain = 1.0;
-    track->gain = 1.0;
-    track->mute = false;
     deleteAndZero (track); // mono not yet supported
 }
 
@@ -415,14 +420,12 @@ void AudioMixerProcessor::addStereoTrack()
         track->busIdx       = input->getBusIndex();
         track->numInputs    = input->getNumberOfChannels();
         track->numOutputs   = input->getNumberOfChannels();
-        track->lastGain     = 1.0;
-        track->gain         = 1.0;
-        track->mute         = false;
         track->monitor      = new Monitor (track->index, track->numOutputs);
 
-        ScopedLock sl (getCallbackLock());
+        ScopedLock sl (lock);
         tracks.add (track);
         numTracks = tracks.size();
+        publishTracks();
     }
     else
     {
@@ -443,15 +446,64 @@ void AudioMixerProcessor::prepareToPlay (const double sampleRate, const int buff
     jassert (tracks.size() == getBusCount (true));
     jassert (1 == getBusCount (false));
     tempBuffer.setSize (getMainBusNumOutputChannels(), bufferSize, false, true, true);
+    meterInterval = jmax (1, roundToInt (sampleRate / (double) meterRateHz));
+    samplesSinceMeter = 0;
+}
+
+/** Adds a batch of sources, each with its own gain, in one pass over the
+    destination. The loop is plain so the compiler can vectorize it */
+static void mixSources (float* const dest, const float* const* sources, const float* gains,
+                        const int numSources, const int numSamples) noexcept
+{
+    switch (numSources)
+    {
+        case 4:
+        {
+            const float* const s0 = sources[0]; const float* const s1 = sources[1];
+            const float* const s2 = sources[2]; const float* const s3 = sources[3];
+            const float g0 = gains[0], g1 = gains[1], g2 = gains[2], g3 = gains[3];
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] += s0[i] * g0 + s1[i] * g1 + s2[i] * g2 + s3[i] * g3;
+            break;
+        }
+
+        case 3:
+        {
+            const float* const s0 = sources[0]; const float* const s1 = sources[1];
+            const float* const s2 = sources[2];
+            const float g0 = gains[0], g1 = gains[1], g2 = gains[2];
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] += s0[i] * g0 + s1[i] * g1 + s2[i] * g2;
+            break;
+        }
+
+        case 2:
+        {
+            const float* const s0 = sources[0]; const float* const s1 = sources[1];
+            const float g0 = gains[0], g1 = gains[1];
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] += s0[i] * g0 + s1[i] * g1;
+            break;
+        }
+
+        case 1:
+            FloatVectorOperations::addWithMultiply (dest, sources[0], gains[0], numSamples);
+            break;
+
+        default:
+            break;
+    }
 }
 
 void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& midi)
 {
     midi.clear();
 
-    ScopedLock sl (getCallbackLock());
+    if ((snapshotMiddle.load() & tracksDirty) != 0)
+        snapshotFront = snapshotMiddle.exchange (snapshotFront) & trackIndexMask;
+    const auto& tracksToMix = snapshots [snapshotFront];
 
-    if (tracks.size() <= 0)
+    if (tracksToMix.size() <= 0)
     {
         audio.clear();
         return;
@@ -459,44 +511,80 @@ void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& mi
 
     auto output (getBusBuffer<float> (audio, false, 0));
     const int numSamples = audio.getNumSamples();
+    const int numMixChannels = jmin (tempBuffer.getNumChannels(), output.getNumChannels());
+    if (numSamples > tempBuffer.getNumSamples())
+    {
+        jassertfalse; // bigger block than prepared for
+        return;
+    }
+
     tempBuffer.clear (0, numSamples);
 
-    for (int i = 0; i < tracks.size(); ++i)
+    samplesSinceMeter += numSamples;
+    const bool meterDue = isMetering() && samplesSinceMeter >= meterInterval;
+    if (meterDue)
+        samplesSinceMeter = 0;
+
+    enum { batchSize = 4 };
+    const float* sources [batchSize];
+    float gains [batchSize];
+
+    for (int c = 0; c < numMixChannels; ++c)
     {
-        auto* const track = tracks.getUnchecked (i);
-        auto input (getBusBuffer<float> (audio, true, track->busIdx));
-        auto& rms = track->monitor->rms;
+        auto* const dest = tempBuffer.getWritePointer (c);
+        int numBatched = 0;
 
-        if (track->mute)
-        {
-            for (int c = 0; c < track->numInputs; ++c)
-                rms.getReference(c).set (0.0);
-        }
-        else
+        for (const auto& track : tracksToMix)
         {
-            for (int c = 0; c < track->numInputs; ++c)
+            auto* const monitor = track.monitor.get();
+            if (monitor == nullptr || c >= track.numInputs)
+                continue;
+
+            // requests are applied once per block, when the first channel is mixed
+            if (c == 0)
             {
-                rms.getReference(c).set (track->gain * input.getRMSLevel (c, 0, numSamples));
-                tempBuffer.addFromWithRamp (c, 0, input.getReadPointer(c), numSamples,
-                                            track->lastGain, track->gain);
+                monitor->gain.set (monitor->nextGain.get());
+                monitor->muted.set (monitor->nextMute.get());
             }
-        }
 
-        track->lastGain = track->gain;
+            const float from = monitor->lastGain;
+            const float to = monitor->isMuted() ? 0.f : monitor->getGain();
+            if (c == numMixChannels - 1 || c == track.numInputs - 1)
+                monitor->lastGain = to;
+
+            const auto input (getBusBuffer<float> (audio, true, track.busIdx));
+            if (c >= input.getNumChannels())
+                continue;
 
-        if (track->gain != track->monitor->nextGain.get())
-            track->gain = track->monitor->nextGain.get();
-        track->monitor->gain.set (track->gain);
+            if (meterDue)
+                monitor->rms.getReference(c).set (to * input.getRMSLevel (c, 0, numSamples));
+
+            if (from == to)
+            {
+                if (to == 0.f)
+                    continue;
+
+                sources[numBatched] = input.getReadPointer (c);
+                gains[numBatched] = to;
+                if (++numBatched == batchSize)
+                {
+                    mixSources (dest, sources, gains, numBatched, numSamples);
+                    numBatched = 0;
+                }
+            }
+            else
+            {
+                tempBuffer.addFromWithRamp (c, 0, input.getReadPointer (c), numSamples, from, to);
+            }
+        }
 
-        if (static_cast<int> (track->mute) != track->monitor->nextMute.get())
-            track->mute = track->monitor->nextMute.get() > 0;
-        track->monitor->muted.set (track->mute ? 1 : 0);
+        mixSources (dest, sources, gains, numBatched, numSamples);
     }
 
     output.clear (0, numSamples);
     const float gain = Decibels::decibelsToGain ((float)*masterVolume, (float) EL_FADER_MIN_DB);
     if (! *masterMute)
-        for (int c = 0; c < output.getNumChannels(); ++c)
+        for (int c = 0; c < numMixChannels; ++c)
             output.copyFromWithRamp (c, 0, tempBuffer.getReadPointer(c), numSamples,
                                      lastGain, gain);
 
@@ -508,9 +596,10 @@ void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& mi
     masterMonitor->muted.set (*masterMute);
     masterMonitor->gain.set (gain);
 
-    for (int i = 0; i < 2; ++i)
-        masterMonitor->rms.getReference(i).set (
-            output.getRMSLevel (i, 0, numSamples));
+    if (meterDue)
+        for (int i = 0; i < jmin (2, output.getNumChannels()); ++i)
+            masterMonitor->rms.getReference(i).set (
+                output.getRMSLevel (i, 0, numSamples));
 
     lastGain = gain;
 }
@@ -544,63 +633,55 @@ bool AudioMixerProcessor::canApplyBusCountChange (bool isInput, bool isAdding,
 
 void AudioMixerProcessor::setTrackGain (const int track, const float gain)
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return;
-    ScopedLock sl (getCallbackLock());
-    tracks.getUnchecked(track)->gain = gain;
+    if (auto monitor = getMonitor (track))
+        if (track >= 0)
+            monitor->requestGain (gain);
 }
 
-void AudioMixerProcessor::setTrackMuted (const int track, const bool mute) {
-    if (! isPositiveAndBelow (track, numTracks))
-        return;
-    ScopedLock sl (getCallbackLock());
-    tracks.getUnchecked(track)->mute = mute;
+void AudioMixerProcessor::setTrackMuted (const int track, const bool mute)
+{
+    if (auto monitor = getMonitor (track))
+        if (track >= 0)
+            monitor->requestMute (mute);
 }
 
 bool AudioMixerProcessor::isTrackMuted (const int track) const
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return false;
-    ScopedLock sl (getCallbackLock());
-    return tracks.getUnchecked(track)->mute;
+    if (auto monitor = getMonitor (track))
+        if (track >= 0)
+            return monitor->nextMute.get() > 0;
+    return false;
 }
 
 float AudioMixerProcessor::getTrackGain (const int track) const
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return 1.f;
-    ScopedLock sl (getCallbackLock());
-    return tracks.getUnchecked(track)->gain;
+    if (auto monitor = getMonitor (track))
+        if (track >= 0)
+            return monitor->nextGain.get();
+    return 1.f;
 }
 
 void AudioMixerProcessor::getStateInformation (juce::MemoryBlock& block)
 {
-    OwnedArray<Track> t;
-    while (t.size() < numTracks)
-        t.add (new Track());
-    float volume = 0.0f;
-    bool mute = false;
+    Array<Track> t;
     {
-        ScopedLock sl (getCallbackLock());
-        for (int i = 0; i < numTracks; ++i)
-            t.getUnchecked(i)->update (tracks.getUnchecked (i));
-        volume = *masterVolume;
-        mute = *masterMute;
+        ScopedLock sl (lock);
+        for (const auto* const track : tracks)
+            t.add (*track);
     }
 
     ValueTree state ("audiomixer");
-    state.setProperty (Tags::volume, volume, 0)
-         .setProperty ("mute", mute, 0);
-    for (int i = 0; i < numTracks; ++i)
+    state.setProperty (Tags::volume, (float) *masterVolume, 0)
+         .setProperty ("mute", (bool) *masterMute, 0);
+    for (const auto& track : t)
     {
         ValueTree trk ("track");
-        auto* const track = t.getUnchecked (i);
-        trk.setProperty ("index",       track->index, 0)
-           .setProperty ("busIdx",      track->busIdx, 0)
-           .setProperty ("numInputs",   track->numInputs, 0)
-           .setProperty ("numOutputs",  track->numOutputs, 0)
-           .setProperty ("gain",        track->gain, 0)
-           .setProperty ("mute",        track->mute, 0);
+        trk.setProperty ("index",       track.index, 0)
+           .setProperty ("busIdx",      track.busIdx, 0)
+           .setProperty ("numInputs",   track.numInputs, 0)
+           .setProperty ("numOutputs",  track.numOutputs, 0)
+           .setProperty ("gain",        track.monitor->nextGain.get(), 0)
+           .setProperty ("mute",        track.monitor->nextMute.get() > 0, 0);
         state.addChild (trk, -1, 0);
     }
 
@@ -621,7 +702,7 @@ void AudioMixerProcessor::setStateInformation (const void* data, int size)
     if (! state.isValid())
         return;
 
-    Array<Track*> newTracks;
+    OwnedArray<Track> newTracks;
     for (int i = 0; i < state.getNumChildren(); ++i)
     {
         const ValueTree trk (state.getChild (i));
@@ -630,34 +711,31 @@ void AudioMixerProcessor::setStateInformation (const void* data, int size)
         track->busIdx       = trk.getProperty ("busIdx", i);
         track->numInputs    = trk.getProperty ("numInputs", 2);
         track->numOutputs   = trk.getProperty ("numOutputs", 2);
-        track->gain         = trk.getProperty ("gain", 1.f);
-        track->lastGain     = track->gain;
-        track->mute         = (bool) trk.getProperty ("mute", false);
+        const float gain    = trk.getProperty ("gain", 1.f);
+        const bool mute     = (bool) trk.getProperty ("mute", false);
 
         track->monitor = new Monitor (track->index, track->numInputs);
-        track->monitor->gain.set (track->gain);
-        track->monitor->nextGain.set (track->gain);
-        track->monitor->muted.set (track->mute ? 1 : 0);
-        track->monitor->nextMute.set (track->mute ? 1 : 0);
+        track->monitor->gain.set (gain);
+        track->monitor->nextGain.set (gain);
+        track->monitor->lastGain = mute ? 0.f : gain;
+        track->monitor->muted.set (mute ? 1 : 0);
+        track->monitor->nextMute.set (mute ? 1 : 0);
         
         newTracks.add (track);
     }
 
-    {
-        ScopedLock sl (getCallbackLock());
-        *masterVolume = (float) state.getProperty (Tags::volume, 0.0);
-        *masterMute = (bool) state.getProperty ("mute", false);
-        masterMonitor->nextGain.set (Decibels::decibelsToGain ((float)*masterVolume, (float)EL_FADER_MIN_DB));
-        masterMonitor->gain.set (masterMonitor->nextGain.get());
-        masterMonitor->nextMute.set (*masterMute ? 1 : 0);
-        masterMonitor->muted.set (masterMonitor->nextMute.get());
-        tracks.swapWith (newTracks);
-        numTracks = tracks.size();
-    }
-
-    for (auto* dt : newTracks)
-        delete dt;
-    newTracks.clear();
+    *masterVolume = (float) state.getProperty (Tags::volume, 0.0);
+    *masterMute = (bool) state.getProperty ("mute", false);
+    masterMonitor->nextGain.set (Decibels::decibelsToGain ((float)*masterVolume, (float)EL_FADER_MIN_DB));
+    masterMonitor->gain.set (masterMonitor->nextGain.get());
+    masterMonitor->nextMute.set (*masterMute ? 1 : 0);
+    masterMonitor->muted.set (masterMonitor->nextMute.get());
+
+    // the old tracks go with newTracks, after the snapshots stop using them
+    ScopedLock sl (lock);
+    tracks.swapWith (newTracks);
+    numTracks = tracks.size();
+    publishTracks();
 }
 
 }
@@ -23,6 +23,13 @@
 
 namespace Element {
 
+/** Sums stereo input buses into a master output.
+
+    The audio thread never locks. Track layouts are published to it as
+    triple buffered snapshots, gains and mutes are requested through each
+    track's Monitor, and levels are only measured while something is
+    metering, a few dozen times a second.
+ */
 class AudioMixerProcessor : public BaseProcessor
 {
     AudioParameterBool* masterMute;
@@ -79,6 +86,7 @@ public:
         Atomic<int> nextMute;
         Atomic<float> gain;
         Atomic<float> nextGain;
+        float lastGain = 1.f; // audio thread only, includes the mute
 
         void reset()
         {
@@ -95,28 +103,14 @@ public:
 
     typedef ReferenceCountedObjectPtr<Monitor> MonitorPtr;
 
+    /** A track's layout. Its gain and mute live in the monitor */
     struct Track
     {
         int index       = -1;
         int busIdx      = -1;
         int numInputs   = 0;
         int numOutputs  = 0;
-        float lastGain  = 1.0;
-        float gain      = 1.0;
-        bool mute       = false;
         MonitorPtr      monitor;
-
-        inline void update (const Track* const track)
-        {
-            this->index         = track->index;
-            this->busIdx        = track->busIdx;
-            this->numInputs     = track->numInputs;
-            this->numOutputs    = track->numOutputs;
-            this->gain          = track->gain;
-            this->lastGain      = track->gain;
-            this->mute          = track->mute;
-            this->monitor       = track->monitor;
-        }
     };
 
     explicit AudioMixerProcessor (int numTracks = 4,
@@ -153,10 +147,19 @@ public:
         desc.version            = "1.0.0";
     }
 
-    int getNumTracks() const { ScopedLock sl (getCallbackLock()); return tracks.size(); }
+    int getNumTracks() const { ScopedLock sl (lock); return tracks.size(); }
     
     MonitorPtr getMonitor (const int track = -1) const;
     
+    /** Levels are measured while there is at least one of these, e.g. for
+        as long as an editor is showing meters */
+    void beginMetering()    { ++numMeterViews; }
+    void endMetering()      { --numMeterViews; }
+    bool isMetering() const { return numMeterViews.load() > 0; }
+
+    /** Times a second levels are measured while metering */
+    static constexpr int meterRateHz = 30;
+
     void setTrackGain  (const int track, const float gain);
     void setTrackMuted (const int track, const bool mute);
     bool isTrackMuted  (const int track) const;
@@ -201,10 +204,25 @@ public:
 
 private:
     MonitorPtr masterMonitor;
-    Array<Track*> tracks;
+    CriticalSection lock;
+    OwnedArray<Track> tracks;
     int numTracks = 0;
     AudioSampleBuffer tempBuffer;
     float lastGain = 0.f;
+
+    // triple buffered: changes fill the back, processing reads the front
+    // and they swap through the middle
+    enum { trackIndexMask = 3, tracksDirty = 4 };
+    Array<Track> snapshots [3];
+    std::atomic<int> snapshotMiddle { 1 };
+    int snapshotFront = 0;
+    int snapshotBack = 2;
+    void publishTracks();
+
+    std::atomic<int> numMeterViews { 0 };
+    int meterInterval = 1470;
+    int samplesSinceMeter = 0;
+
     void addMonoTrack();
     void addStereoTrack();
 };
@@ -125,6 +125,13 @@ void AudioProcessorNode::prepareToRender (double sampleRate, int maxBufferSize)
     proc->prepareToPlay (sampleRate, maxBufferSize);
 }
 
+int64 AudioProcessorNode::getContentMemoryBytes() const
+{
+    if (auto* base = dynamic_cast<BaseProcessor*> (proc.get()))
+        return base->getMemoryBytes();
+    return 0;
+}
+
 void AudioProcessorNode::releaseResources() 
 { 
     if (! proc)
@@ -153,6 +160,7 @@ AudioProcessorNode::AudioProcessorNode (uint32 nodeId, AudioProcessor* processor
     
     for (auto* param : proc->getParameters())
         params.add (new AudioProcessorNodeParameter (*param));
+    proc->addListener (this);
     
     if (auto* instance = dynamic_cast<AudioPluginInstance*> (proc.get()))
     {
@@ -170,9 +178,30 @@ AudioProcessorNode::~AudioProcessorNode()
     GraphNode::clearParameters();
     enablement.cancelPendingUpdate();
     pluginState.reset();
+    if (proc != nullptr)
+        proc->removeListener (this);
+    if (releaser)
+        releaser (proc.release());
     proc = nullptr;
 }
 
+void AudioProcessorNode::setProcessorReleaser (std::function<void (AudioProcessor*)> newReleaser)
+{
+    releaser = newReleaser;
+}
+
+void AudioProcessorNode::audioProcessorParameterChanged (AudioProcessor*, int, float)
+{
+    markStateChanged();
+}
+
+void AudioProcessorNode::audioProcessorChanged (AudioProcessor*)
+{
+    if (proc != nullptr)
+        setLatencySamples (proc->getLatencySamples());
+    markStateChanged();
+}
+
 void AudioProcessorNode::getState (MemoryBlock& block)
 {
     if (proc != nullptr)
@@ -26,7 +26,8 @@ namespace Element {
 class GraphProcessor;
 class MidiPipe;
 
-class AudioProcessorNode : public GraphNode
+class AudioProcessorNode : public GraphNode,
+                           private AudioProcessorListener
 {
 public:
     AudioProcessorNode (uint32 nodeId, AudioProcessor* processor);
@@ -41,6 +42,13 @@ public:
     void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override;
 
+    /** Returns what an internal processor reports holding */
+    int64 getContentMemoryBytes() const override;
+
+    /** Hands the processor to a function instead of deleting it when the node
+        goes away, e.g. to keep it for reuse */
+    void setProcessorReleaser (std::function<void (AudioProcessor*)> releaser);
+
 protected:
     void createPorts() override;
     Parameter::Ptr getParameter (const PortDescription& port) override;
@@ -49,9 +57,13 @@ private:
     ScopedPointer<AudioProcessor> proc;
     Atomic<int> enabled { 1 };
     MemoryBlock pluginState;
+    std::function<void (AudioProcessor*)> releaser;
 
     ParameterArray params;
 
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override;
+    void audioProcessorChanged (AudioProcessor*) override;
+
     struct EnablementUpdater : public AsyncUpdater
     {
         EnablementUpdater (AudioProcessorNode& n) : node (n) { }
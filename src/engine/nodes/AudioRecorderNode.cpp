@@ -0,0 +1,406 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/AudioRecorderNode.h"
+#include "gui/LookAndFeel.h"
+#include "DataPath.h"
+#include "Utils.h"
+
+namespace Element {
+
+//=============================================================================
+class AudioRecorderNode::Recording : private Thread
+{
+public:
+    Recording (AudioFormatWriter* w, int numChannels, int numFrames)
+        : Thread ("el.audioRecorder"),
+          writer (w),
+          fifo (numFrames),
+          buffer (numChannels, numFrames)
+    {
+        startThread (6);
+    }
+
+    ~Recording()
+    {
+        signalThreadShouldExit();
+        waitForThreadToExit (-1);
+        // anything still queued goes in before the writer finishes the file
+        while (flush()) { }
+        writer.reset();
+    }
+
+    /** Called on the audio thread */
+    void push (const AudioBuffer<float>& input, int numFrames) noexcept
+    {
+        if (fifo.getFreeSpace() < numFrames)
+        {
+            ++numOverruns;
+            return;
+        }
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numFrames, start1, size1, start2, size2);
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+        {
+            if (c >= input.getNumChannels())
+            {
+                buffer.clear (c, start1, size1);
+                if (size2 > 0)
+                    buffer.clear (c, start2, size2);
+                continue;
+            }
+
+            buffer.copyFrom (c, start1, input, c, 0, size1);
+            if (size2 > 0)
+                buffer.copyFrom (c, start2, input, c, size1, size2);
+        }
+        fifo.finishedWrite (size1 + size2);
+    }
+
+    int64 getNumFramesWritten() const noexcept  { return numFramesWritten.load(); }
+    int getNumOverruns() const noexcept         { return numOverruns.load(); }
+
+private:
+    std::unique_ptr<AudioFormatWriter> writer;
+    AbstractFifo fifo;
+    AudioBuffer<float> buffer;
+    std::atomic<int64> numFramesWritten { 0 };
+    std::atomic<int> numOverruns { 0 };
+
+    bool flush()
+    {
+        const int ready = fifo.getNumReady();
+        if (ready <= 0)
+            return false;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (ready, start1, size1, start2, size2);
+        if (size1 > 0)
+            writer->writeFromAudioSampleBuffer (buffer, start1, size1);
+        if (size2 > 0)
+            writer->writeFromAudioSampleBuffer (buffer, start2, size2);
+        fifo.finishedRead (size1 + size2);
+        numFramesWritten += size1 + size2;
+        return true;
+    }
+
+    void run() override
+    {
+        // polled, so the audio thread never has to signal anything
+        while (! threadShouldExit())
+            if (! flush())
+                wait (20);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Recording)
+};
+
+//=============================================================================
+class AudioRecorderEditor : public AudioProcessorEditor,
+                            private Timer
+{
+public:
+    AudioRecorderEditor (AudioRecorderNode& o)
+        : AudioProcessorEditor (&o),
+          processor (o)
+    {
+        setOpaque (true);
+
+        addAndMakeVisible (recordButton);
+        recordButton.setButtonText ("Record");
+        recordButton.setColour (TextButton::buttonOnColourId, Colours::red.darker());
+
+        addAndMakeVisible (formatBox);
+        formatBox.addItem ("WAV", 1 + AudioRecorderNode::WAV);
+        formatBox.addItem ("AIFF", 1 + AudioRecorderNode::AIFF);
+
+        addAndMakeVisible (folderButton);
+        folderButton.setButtonText ("Folder...");
+
+        addAndMakeVisible (status);
+        status.setFont (Font (12.f));
+
+        recordButton.onClick = [this]()
+        {
+            if (auto* param = dynamic_cast<AudioParameterBool*> (processor.getParameters()[AudioRecorderNode::Record]))
+                *param = ! processor.isRecording();
+        };
+
+        formatBox.onChange = [this]()
+        {
+            processor.setFileFormat ((AudioRecorderNode::FileFormat) (formatBox.getSelectedId() - 1));
+        };
+
+        folderButton.onClick = [this]()
+        {
+            FileChooser fc ("Record to folder", processor.getDirectory(), "*", true, false, nullptr);
+            if (fc.browseForDirectory())
+                processor.setDirectory (fc.getResult());
+            stabilizeComponents();
+        };
+
+        stabilizeComponents();
+        setSize (360, 80);
+        startTimer (250);
+    }
+
+    ~AudioRecorderEditor() noexcept
+    {
+        stopTimer();
+        recordButton.onClick = nullptr;
+        formatBox.onChange = nullptr;
+        folderButton.onClick = nullptr;
+    }
+
+    void stabilizeComponents()
+    {
+        const bool recording = processor.isRecording();
+        recordButton.setToggleState (recording, dontSendNotification);
+        recordButton.setButtonText (recording ? "Stop" : "Record");
+        formatBox.setSelectedId (1 + processor.getFileFormat(), dontSendNotification);
+        formatBox.setEnabled (! recording);
+        folderButton.setEnabled (! recording);
+
+        String text;
+        if (recording)
+        {
+            const auto seconds = (double) processor.getNumFramesRecorded() / jmax (1.0, processor.getSampleRate());
+            text << processor.getRecordingFile().getFileName() << "  " << Util::minutesToString (seconds / 60.0);
+            if (processor.getNumOverruns() > 0)
+                text << "  " << processor.getNumOverruns() << " overruns";
+        }
+        else
+        {
+            text << processor.getDirectory().getFullPathName();
+        }
+
+        status.setText (text, dontSendNotification);
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        auto r2 = r.removeFromTop (18);
+        folderButton.setBounds (r2.removeFromRight (72).withTrimmedLeft (4));
+        formatBox.setBounds (r2.removeFromRight (72).withTrimmedLeft (4));
+        recordButton.setBounds (r2);
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    AudioRecorderNode& processor;
+    TextButton recordButton;
+    ComboBox formatBox;
+    TextButton folderButton;
+    Label status;
+
+    void timerCallback() override { stabilizeComponents(); }
+};
+
+//=============================================================================
+AudioRecorderNode::AudioRecorderNode (int numChannels)
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 32, numChannels)), true)
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 32, numChannels)), true))
+{
+    directory = DataPath::defaultLocation().getChildFile ("Recordings");
+    addParameter (record = new AudioParameterBool ("record", "Record", false));
+    for (auto* const param : getParameters())
+        param->addListener (this);
+}
+
+AudioRecorderNode::~AudioRecorderNode()
+{
+    for (auto* const param : getParameters())
+        param->removeListener (this);
+    cancelPendingUpdate();
+    stopRecording();
+    record = nullptr;
+}
+
+void AudioRecorderNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_AUDIO_RECORDER;
+    desc.descriptiveName    = "Records audio to a file";
+    desc.numInputChannels   = getTotalNumInputChannels();
+    desc.numOutputChannels  = getTotalNumOutputChannels();
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_AUDIO_RECORDER;
+}
+
+File AudioRecorderNode::createNewFile() const
+{
+    const auto name = "Recording " + Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    return directory.getNonexistentChildFile (name, format == AIFF ? ".aiff" : ".wav", false);
+}
+
+bool AudioRecorderNode::startRecording (const File& file)
+{
+    stopRecording();
+    if (getSampleRate() <= 0.0)
+        return false;
+
+    WavAudioFormat wav;
+    AiffAudioFormat aiff;
+    AudioFormat& audioFormat = format == AIFF ? static_cast<AudioFormat&> (aiff) : wav;
+
+    file.getParentDirectory().createDirectory();
+    file.deleteFile();
+    std::unique_ptr<FileOutputStream> out (file.createOutputStream (1024 * 256));
+    if (out == nullptr || out->failedToOpen())
+        return false;
+
+    const int numChannels = getTotalNumInputChannels();
+    auto* writer = audioFormat.createWriterFor (out.get(), getSampleRate(), (unsigned int) numChannels, 24, {}, 0);
+    if (writer == nullptr)
+        return false;
+    out.release();
+
+    // allocated here so the audio thread never has to
+    std::unique_ptr<Recording> newRecording (new Recording (
+        writer, numChannels, roundToInt (getSampleRate()) * fifoSeconds));
+    recordingFile = file;
+
+    {
+        ScopedLock sl (getCallbackLock());
+        recording.swap (newRecording);
+    }
+
+    return true;
+}
+
+void AudioRecorderNode::stopRecording()
+{
+    std::unique_ptr<Recording> oldRecording;
+    {
+        ScopedLock sl (getCallbackLock());
+        recording.swap (oldRecording);
+    }
+
+    // finishes writing the file outside the lock
+    oldRecording.reset();
+}
+
+bool AudioRecorderNode::isRecording() const
+{
+    return recording != nullptr;
+}
+
+int64 AudioRecorderNode::getNumFramesRecorded() const
+{
+    return recording != nullptr ? recording->getNumFramesWritten() : 0;
+}
+
+int AudioRecorderNode::getNumOverruns() const
+{
+    return recording != nullptr ? recording->getNumOverruns() : 0;
+}
+
+void AudioRecorderNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    // a recording can't change rate part way through
+    if (recording != nullptr && sampleRate != getSampleRate())
+        stopRecording();
+    setPlayConfigDetails (getTotalNumInputChannels(), getTotalNumOutputChannels(),
+                          sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+void AudioRecorderNode::releaseResources() { }
+
+void AudioRecorderNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    ScopedLock sl (getCallbackLock());
+    if (recording != nullptr)
+        recording->push (buffer, buffer.getNumSamples());
+    midi.clear();
+}
+
+AudioProcessorEditor* AudioRecorderNode::createEditor()
+{
+    return new AudioRecorderEditor (*this);
+}
+
+void AudioRecorderNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("directory", directory.getFullPathName(), nullptr)
+         .setProperty ("format", (int) format, nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void AudioRecorderNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (state.isValid())
+    {
+        if (File::isAbsolutePath (state["directory"].toString()))
+            directory = File (state["directory"].toString());
+        format = (FileFormat) jlimit ((int) WAV, (int) AIFF, (int) state.getProperty ("format", (int) WAV));
+    }
+}
+
+void AudioRecorderNode::parameterValueChanged (int parameter, float newValue)
+{
+    ignoreUnused (newValue);
+    // files are opened and finished on the message thread
+    if (parameter == Record)
+        triggerAsyncUpdate();
+}
+
+void AudioRecorderNode::parameterGestureChanged (int parameterIndex, bool gestureIsStarting)
+{
+    ignoreUnused (parameterIndex, gestureIsStarting);
+}
+
+void AudioRecorderNode::handleAsyncUpdate()
+{
+    if (*record && ! isRecording())
+    {
+        if (! startRecording (createNewFile()))
+            *record = false;
+    }
+    else if (! *record && isRecording())
+    {
+        stopRecording();
+    }
+}
+
+bool AudioRecorderNode::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    // one bus each way, passed straight through
+    if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != 1)
+        return false;
+    return layout.getMainInputChannels() > 0
+        && layout.getMainInputChannels() == layout.getMainOutputChannels();
+}
+
+}
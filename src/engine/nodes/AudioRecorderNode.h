@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+
+namespace Element {
+
+/** Records its inputs to a file, and passes them through.
+
+    The audio thread only copies each block into a FIFO allocated when
+    recording starts. A thread of the recording's own empties it to the
+    file, so a slow disk never holds up processing. If the FIFO is ever full
+    the block is dropped from the file, not the output, and counted as an
+    overrun.
+ */
+class AudioRecorderNode : public BaseProcessor,
+                          public AudioProcessorParameter::Listener,
+                          private AsyncUpdater
+{
+public:
+    enum Parameters { Record = 0 };
+    enum FileFormat { WAV = 0, AIFF };
+
+    explicit AudioRecorderNode (int numChannels = 2);
+    virtual ~AudioRecorderNode();
+
+    /** Starts recording to a file, replacing it. The node must be prepared.
+        Returns false if the file couldn't be opened */
+    bool startRecording (const File& file);
+
+    /** Stops recording and finishes the file */
+    void stopRecording();
+
+    bool isRecording() const;
+
+    /** Returns the file being recorded, or the last one recorded */
+    const File& getRecordingFile() const { return recordingFile; }
+
+    /** Returns frames written to the file so far */
+    int64 getNumFramesRecorded() const;
+
+    /** Returns how many blocks were dropped because the disk fell behind */
+    int getNumOverruns() const;
+
+    /** Sets the directory the record parameter creates new files in */
+    void setDirectory (const File& newDirectory) { directory = newDirectory; }
+    const File& getDirectory() const { return directory; }
+
+    void setFileFormat (FileFormat newFormat) { format = newFormat; }
+    FileFormat getFileFormat() const { return format; }
+
+    /** Returns a new file in the directory, named after the time */
+    File createNewFile() const;
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "Audio Recorder"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return false; }
+    bool producesMidi() const override                  { return false; }
+    bool supportsMPE() const override                   { return false; }
+    bool isMidiEffect() const override                  { return false; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    void parameterValueChanged (int parameterIndex, float newValue) override;
+    void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override;
+
+    /** Seconds of audio the FIFO holds */
+    static const int fifoSeconds = 4;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    class Recording;
+    std::unique_ptr<Recording> recording;
+    AudioParameterBool* record { nullptr };
+    File directory;
+    File recordingFile;
+    FileFormat format { WAV };
+
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioRecorderNode)
+};
+
+}
@@ -27,20 +27,21 @@ namespace Element {
 
 AudioRouterNode::AudioRouterNode (int ins, int outs)
     : GraphNode (0),
-      numSources (ins),
-      numDestinations (outs),
-      state (ins, outs),
-      toggles (ins, outs),
-      nextToggles (ins, outs)
+      numSources (jlimit (1, (int) maxChannels, ins)),
+      numDestinations (jlimit (1, (int) maxChannels, outs)),
+      state (numSources, numDestinations)
 {
+    ins = numSources;
+    outs = numDestinations;
+
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_AUDIO_ROUTER, nullptr);
-    
-    fadeIn.setFadesIn (true);
-    fadeIn.setLength (fadeLengthSeconds);
-    fadeOut.setFadesIn (false);
-    fadeOut.setLength (fadeLengthSeconds);
+
+    active.malloc ((size_t) (maxChannels * maxChannels));
+    activeIndex.malloc ((size_t) (maxChannels * maxChannels));
+    for (int i = 0; i < maxChannels * maxChannels; ++i)
+        activeIndex[i] = -1;
 
     clearPatches();
 
@@ -92,17 +93,19 @@ void AudioRouterNode::setCurrentProgram (int index)
     }
 }
 
-void AudioRouterNode::applyMatrix (const MatrixState& matrix)
+void AudioRouterNode::publishPatches()
 {
-    jassert (matrix.sameSizeAs (state));
-    ToggleGrid newPatches (matrix);
-    {
-        ScopedLock sl (getLock());
-        nextToggles.swapWith (newPatches);
-        togglesChanged = true; // initiate the crossfade
-    }
-
-    sendChangeMessage();
+    ScopedLock sl (lock);
+    auto& list = patchLists [patchBack];
+    list.numSources = state.getNumRows();
+    list.numDestinations = state.getNumColumns();
+    list.patches.clearQuick();
+    for (int src = 0; src < list.numSources; ++src)
+        for (int dst = 0; dst < list.numDestinations; ++dst)
+            if (state.connected (src, dst))
+                list.patches.add ({ (int16) src, (int16) dst });
+
+    patchBack = patchMiddle.exchange (patchBack | patchesDirty) & patchIndexMask;
 }
 
 String AudioRouterNode::getSizeString() const
@@ -121,28 +124,19 @@ String AudioRouterNode::getSizeString() const
 
 void AudioRouterNode::setSize (int newIns, int newOuts)
 {
-    newIns  = jmax (1, newIns);
-    newOuts = jmax (1, newOuts);
+    newIns  = jlimit (1, (int) maxChannels, newIns);
+    newOuts = jlimit (1, (int) maxChannels, newOuts);
     
     {
-        ScopedLock sl1 (getLock());
+        ScopedLock sl (lock);
         if (newIns == numSources && newOuts == numDestinations)
             return;
-    }
-
-    state.resize (newIns, newOuts, true);
-    ToggleGrid newPatches (state);
-    ToggleGrid newNextPatches (state);
-    
-    {
-        ScopedLock sl (getLock());
-        nextToggles.swapWith (newNextPatches);
-        toggles.swapWith (newPatches);
+        state.resize (newIns, newOuts, true);
         numSources = newIns;
         numDestinations = newOuts;
-        sizeChanged = true; // initiate the size change
     }
 
+    publishPatches();
     rebuildPorts = true;
     triggerPortReset();
     sendChangeMessage();
@@ -150,8 +144,14 @@ void AudioRouterNode::setSize (int newIns, int newOuts)
 
 void AudioRouterNode::setMatrixState (const MatrixState& matrix)
 {
-    state = matrix;
-    applyMatrix (state);
+    jassert (matrix.sameSizeAs (state));
+    {
+        ScopedLock sl (lock);
+        state = matrix;
+    }
+
+    publishPatches();
+    sendChangeMessage();
 }
 
 MatrixState AudioRouterNode::getMatrixState() const
@@ -159,6 +159,56 @@ MatrixState AudioRouterNode::getMatrixState() const
     return state;
 }
 
+void AudioRouterNode::prepareToRender (double newSampleRate, int maxBufferSize)
+{
+    sampleRate = newSampleRate;
+    tempAudio.setSize (maxChannels, jmax (1, maxBufferSize), false, false, true);
+}
+
+void AudioRouterNode::removeActive (int index)
+{
+    const auto& patch = active[index];
+    activeIndex[patch.source * maxChannels + patch.destination] = -1;
+    if (--numActive != index)
+    {
+        active[index] = active[numActive];
+        activeIndex[active[index].source * maxChannels + active[index].destination] = (int16) index;
+    }
+}
+
+void AudioRouterNode::applyPatches (const PatchList& list)
+{
+    // a new size cuts straight over, as the old patches no longer line up
+    const bool cut = list.numSources != renderSources || list.numDestinations != renderDestinations;
+    renderSources = list.numSources;
+    renderDestinations = list.numDestinations;
+
+    if (cut)
+    {
+        while (numActive > 0)
+            removeActive (numActive - 1);
+    }
+    else
+    {
+        for (int i = 0; i < numActive; ++i)
+            active[i].target = 0.f;
+    }
+
+    for (const auto& patch : list.patches)
+    {
+        const int key = patch.source * maxChannels + patch.destination;
+        if (activeIndex[key] >= 0)
+        {
+            active[activeIndex[key]].target = 1.f;
+            continue;
+        }
+
+        const float gain = cut ? 1.f : 0.f;
+        active[numActive] = { patch.source, patch.destination, gain, 1.f };
+        activeIndex[key] = (int16) numActive++;
+    }
+}
+
 void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     jassert (midi.getNumBuffers() == 1);
@@ -175,145 +225,55 @@ void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
             { DBG("program "); }
     }
 
-    const int numFrames = audio.getNumSamples();
-    const int numChannels = audio.getNumChannels();
-
-    tempAudio.setSize (numChannels, numFrames, false, false, true);
-    tempAudio.clear (0, numFrames);
-
-    if (sizeChanged)
+    if ((patchMiddle.load() & patchesDirty) != 0)
     {
-        fadeIn.reset();
-        fadeOut.reset();
-        sizeChanged = false;
-        TRACE_AUDIO_ROUTER("size changed");
+        patchFront = patchMiddle.exchange (patchFront) & patchIndexMask;
+        applyPatches (patchLists [patchFront]);
+        TRACE_AUDIO_ROUTER("patches changed");
     }
 
-    if (togglesChanged)
-    {
-        fadeIn.reset();
-        fadeIn.startFading();
-        fadeOut.reset();
-        fadeOut.startFading();
-        togglesChanged = false;
-        TRACE_AUDIO_ROUTER("fade start");
-    }
+    const int numFrames = audio.getNumSamples();
+    const int numChannels = audio.getNumChannels();
 
-    if (numSources > numChannels || numDestinations > numChannels)
+    if (renderSources > numChannels || renderDestinations > numChannels)
     {
         audio.clear();
         midi.clear();
         return;
     }
 
-    if (fadeIn.isActive() || fadeOut.isActive())
-    {
-        auto framesToProcess = numFrames;
-        int frame = 0;
-        ScopedLock sl (lock);
-        
-        float fadeInGain  = 0.0f;
-        float fadeOutGain = 1.0f;
-
-        while (--framesToProcess >= 0)
-        {
-            fadeInGain  = fadeIn.isActive()  ? fadeIn.getNextEnvelopeValue()  : 1.0f;
-            fadeOutGain = fadeOut.isActive() ? fadeOut.getNextEnvelopeValue() : 0.0f;
-
-            if (!fadeIn.isActive() && !fadeOut.isActive())
-            {
-                TRACE_AUDIO_ROUTER("last frame fade in gain  : " << fadeInGain);
-                TRACE_AUDIO_ROUTER("last frame fade out gain : " << fadeOutGain);
-            }
-
-            for (int i = 0; i < numSources; ++i)
-            {
-                for (int j = 0; j < numDestinations; ++j)
-                {
-                    if (toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        // no patch change and on means 1 to 1 mix
-                        tempAudio.getWritePointer(j)[frame] += 
-                            audio.getReadPointer(i)[frame];
-                    }
-                    else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                    {
-                        // no patch change and off means no fade and zero'd
-                        tempAudio.getWritePointer(j)[frame] += 0.0f;
-                    }
-                    else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeInGain);
-                    }
-                    else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeOutGain);
-                    }
-                }
-            }
+    tempAudio.setSize (jmax (tempAudio.getNumChannels(), numChannels), numFrames, false, false, true);
+    tempAudio.clear (0, numFrames);
 
-            ++frame;
+    const float step = (float) (1.0 / jmax (1.0, fadeLengthSeconds.load() * sampleRate));
 
-            if (!fadeIn.isActive() && !fadeOut.isActive())
-                break;
-        }
+    for (int i = 0; i < numActive; ++i)
+    {
+        auto& patch = active[i];
+        const auto* const input = audio.getReadPointer (patch.source);
 
-        if (!fadeOut.isActive() && !fadeIn.isActive())
+        if (patch.gain == patch.target)
         {
-            TRACE_AUDIO_ROUTER("fade stopped @ frame: " << (frame));
-            TRACE_AUDIO_ROUTER("fade in level  : " << fadeInGain);
-            TRACE_AUDIO_ROUTER("fade out level : " << fadeOutGain);
-
-            if (framesToProcess > 0)
-            {
-                TRACE_AUDIO_ROUTER("rendering " << framesToProcess << " remainging frames");
-                for (int i = 0; i < numSources; ++i)
-                {
-                    for (int j = 0; j < numDestinations; ++j)
-                    {
-                        if (toggles.get(i, j) && nextToggles.get (i, j))
-                        {
-                            // no patch change and on means 1 to 1 mix
-                            tempAudio.addFrom (j, frame, audio.getReadPointer (i, frame), 
-                                               framesToProcess);
-                        }
-                        else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                        {
-                            // patch not changed and of, so clear the out channel.
-                            // nothing to do
-                        }
-                        else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame), 
-                                                          framesToProcess, fadeInGain, 1.0f);
-                        }
-                        else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame),
-                                                          framesToProcess, fadeOutGain, 0.0f);
-                        }
-                        else
-                        {
-                            // this would be an unhandled fading scenario
-                            jassertfalse;
-                        }
-                    }
-                }
-            }
-
-            toggles.swapWith (nextToggles);
+            tempAudio.addFrom (patch.destination, 0, input, numFrames, patch.gain);
+            continue;
         }
+
+        // fade to the target, then hold it for the rest of the block
+        const int fadeFrames = jmin (numFrames, roundToInt (std::abs (patch.target - patch.gain) / step));
+        const float endGain = fadeFrames < numFrames ? patch.target
+            : patch.gain + (patch.target > patch.gain ? step : -step) * (float) fadeFrames;
+        if (fadeFrames > 0)
+            tempAudio.addFromWithRamp (patch.destination, 0, input, fadeFrames, patch.gain, endGain);
+        patch.gain = jlimit (0.f, 1.f, endGain);
+        if (fadeFrames < numFrames && patch.gain > 0.f)
+            tempAudio.addFrom (patch.destination, fadeFrames, input + fadeFrames,
+                               numFrames - fadeFrames, patch.gain);
     }
-    else
-    {
-        ScopedLock sl (lock);
-        for (int i = 0; i < numSources; ++i)
-            for (int j = 0; j < numDestinations; ++j)
-                if (toggles.get (i, j))
-                    tempAudio.addFrom (j, 0, audio, i, 0, numFrames);
-    }
+
+    // faded out patches are done with
+    for (int i = numActive; --i >= 0;)
+        if (active[i].target == 0.f && active[i].gain <= 0.f)
+            removeActive (i);
 
     for (int c = 0; c < numChannels; ++c)
         audio.copyFrom (c, 0, tempAudio.getReadPointer(c), numFrames);
@@ -337,19 +297,16 @@ void AudioRouterNode::setState (const void* data, int sizeInBytes)
         jassert (matrix.getNumRows() > 0 && matrix.getNumColumns() > 0);
         if (matrix.getNumRows() > 0 && matrix.getNumColumns() > 0)
         {
-            state = matrix;
-
-            ToggleGrid newPatches (state);
-            ToggleGrid newNextPatches (state);
             {
-                ScopedLock sl (getLock());
-                numSources = matrix.getNumRows();
-                numDestinations = matrix.getNumColumns();
-                nextToggles.swapWith (newNextPatches);
-                toggles.swapWith (newPatches);
-                sizeChanged = true;
+                ScopedLock sl (lock);
+                state = matrix;
+                numSources = jmin ((int) maxChannels, matrix.getNumRows());
+                numDestinations = jmin ((int) maxChannels, matrix.getNumColumns());
+                if (numSources != matrix.getNumRows() || numDestinations != matrix.getNumColumns())
+                    state.resize (numSources, numDestinations, true);
             }
 
+            publishPatches();
             rebuildPorts = true;
             sendChangeMessage();
             triggerPortReset();
@@ -360,28 +317,23 @@ void AudioRouterNode::setState (const void* data, int sizeInBytes)
 void AudioRouterNode::setWithoutLocking (int src, int dst, bool set)
 {
     jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
-    toggles.set (src, dst, set);
     state.set (src, dst, set);
+    publishPatches();
 }
 
 void AudioRouterNode::set (int src, int dst, bool patched)
 {
-    jassert (src >= 0 && src < numSources && dst >= 0 && numDestinations < 4);
-    toggles.set (src, dst, patched);
+    jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
     state.set (src, dst, patched);
+    publishPatches();
 }
 
 void AudioRouterNode::clearPatches()
 {
-    {
-        ScopedLock sl (getLock());
-        toggles.clear();
-        nextToggles.clear();
-    }
-
     for (int r = 0; r < state.getNumRows(); ++r)
         for (int c = 0; c < state.getNumColumns(); ++c)
             state.set (r, c, false);
+    publishPatches();
 }
 
 }
@@ -20,12 +20,17 @@
 #pragma once
 
 #include "engine/GraphNode.h"
-#include "engine/LinearFade.h"
-#include "engine/ToggleGrid.h"
 #include "engine/nodes/BaseProcessor.h"
 
 namespace Element {
 
+/** Patches audio inputs to outputs through a matrix.
+
+    The matrix is compiled into a list of the patches that are on and
+    handed to the audio thread through a triple buffer, so rendering never
+    locks and only costs as much as the patches in use. Each patch fades
+    in or out on its own when the matrix changes.
+ */
 class AudioRouterNode : public GraphNode,
                         public ChangeBroadcaster
 {
@@ -33,7 +38,10 @@ public:
     explicit AudioRouterNode (int ins = 4, int outs = 4);
     ~AudioRouterNode();
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    /** Largest number of inputs or outputs */
+    enum { maxChannels = 64 };
+
+    void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override { }
 
     inline bool wantsMidiPipe() const override { return true; }
@@ -48,6 +56,10 @@ public:
     void setWithoutLocking (int src, int dst, bool set);
     CriticalSection& getLock() { return lock; }
 
+    /** Returns the number of patches being rendered, including any still
+        fading out. Only meaningful on the audio thread */
+    int getNumActivePatches() const noexcept { return numActive; }
+
     int getNumPrograms() const override { return jmax (1, programs.size()); }
     int getCurrentProgram() const override { return currentProgram; }
     void setCurrentProgram (int index) override;
@@ -60,11 +72,7 @@ public:
 
     void setFadeLength (double seconds)
     {
-        seconds = jlimit (0.001, 5.0, seconds);
-        ScopedLock sl (lock);
-        fadeLengthSeconds = seconds;
-        fadeIn.setLength (static_cast<float> (fadeLengthSeconds));
-        fadeOut.setLength (static_cast<float> (fadeLengthSeconds));
+        fadeLengthSeconds.store (jlimit (0.001, 5.0, seconds));
     }
 
     void getPluginDescription (PluginDescription& desc) const override
@@ -137,15 +145,41 @@ private:
     // used by the UI, but not the rendering
     MatrixState state;
 
-    double fadeLengthSeconds { 0.001 }; // 1 ms
-    LinearFade fadeIn;
-    LinearFade fadeOut;
-    ToggleGrid toggles;
-    ToggleGrid nextToggles;
-    bool togglesChanged { false },
-         sizeChanged { false };
+    /** The patches that are on, in a matrix of a given size */
+    struct PatchList
+    {
+        struct Patch { int16 source, destination; };
+        int numSources = 0, numDestinations = 0;
+        Array<Patch> patches;
+    };
+
+    // triple buffered: changes fill the back, rendering reads the front
+    // and they swap through the middle
+    enum { patchIndexMask = 3, patchesDirty = 4 };
+    PatchList patchLists [3];
+    std::atomic<int> patchMiddle { 1 };
+    int patchFront = 0;
+    int patchBack = 2;
+    void publishPatches();
+
+    /** A patch being rendered, with its fade */
+    struct ActivePatch
+    {
+        int16 source, destination;
+        float gain, target;
+    };
+
+    // audio thread only, allocated up front for every possible patch
+    HeapBlock<ActivePatch> active;
+    HeapBlock<int16> activeIndex;       // by source * maxChannels + destination, or -1
+    int numActive = 0;
+    int renderSources = 0, renderDestinations = 0;
+
+    double sampleRate = 44100.0;
+    std::atomic<double> fadeLengthSeconds { 0.001 }; // 1 ms
 
-    void applyMatrix (const MatrixState&);
+    void applyPatches (const PatchList&);
+    void removeActive (int index);
 };
 
 }
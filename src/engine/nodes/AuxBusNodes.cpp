@@ -0,0 +1,336 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/AuxBusNodes.h"
+#include "gui/LookAndFeel.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+//=============================================================================
+/** The bus to use and a slider or toggle for each parameter */
+class AuxBusEditor : public AudioProcessorEditor,
+                     private Timer
+{
+public:
+    AuxBusEditor (AuxBusNode& o)
+        : AudioProcessorEditor (&o),
+          node (o)
+    {
+        setOpaque (true);
+
+        addAndMakeVisible (bus);
+        bus.setEditableText (true);
+        bus.setTextWhenNothingSelected ("Bus");
+        bus.onChange = [this]()
+        {
+            const auto name = bus.getText().trim();
+            if (name.isNotEmpty())
+                node.setBusName (name);
+            updateBuses();
+        };
+
+        for (auto* const param : node.getParameters())
+        {
+            if (auto* const toggle = dynamic_cast<AudioParameterBool*> (param))
+            {
+                auto* const button = buttons.add (new ToggleButton (toggle->name));
+                addAndMakeVisible (button);
+                button->onClick = [toggle, button]() { *toggle = button->getToggleState(); };
+            }
+            else if (auto* const ranged = dynamic_cast<AudioParameterFloat*> (param))
+            {
+                auto* const slider = sliders.add (new Slider (Slider::LinearHorizontal, Slider::TextBoxRight));
+                addAndMakeVisible (slider);
+                slider->setRange (ranged->range.start, ranged->range.end, 0.1);
+                slider->setTextValueSuffix (" dB");
+                slider->onValueChange = [ranged, slider]() { *ranged = (float) slider->getValue(); };
+
+                auto* const label = labels.add (new Label (String(), ranged->name));
+                label->setFont (Font (12.f));
+                addAndMakeVisible (label);
+            }
+        }
+
+        updateBuses();
+        timerCallback();
+        setSize (300, 30 + 24 * (sliders.size() + buttons.size()));
+        startTimer (250);
+    }
+
+    ~AuxBusEditor() noexcept
+    {
+        stopTimer();
+        bus.onChange = nullptr;
+        for (auto* slider : sliders)
+            slider->onValueChange = nullptr;
+        for (auto* button : buttons)
+            button->onClick = nullptr;
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        bus.setBounds (r.removeFromTop (22));
+        for (int i = 0; i < sliders.size(); ++i)
+        {
+            r.removeFromTop (2);
+            auto row = r.removeFromTop (22);
+            labels[i]->setBounds (row.removeFromLeft (60));
+            sliders[i]->setBounds (row);
+        }
+        for (auto* button : buttons)
+        {
+            r.removeFromTop (2);
+            button->setBounds (r.removeFromTop (22).withTrimmedLeft (60));
+        }
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (Element::LookAndFeel::backgroundColor);
+    }
+
+private:
+    AuxBusNode& node;
+    ComboBox bus;
+    OwnedArray<Slider> sliders;
+    OwnedArray<Label> labels;
+    OwnedArray<ToggleButton> buttons;
+
+    void updateBuses()
+    {
+        bus.clear (dontSendNotification);
+        if (auto* const buses = node.getAuxBuses())
+        {
+            const auto names = buses->getBusNames();
+            for (int i = 0; i < names.size(); ++i)
+                bus.addItem (names [i], i + 1);
+        }
+        bus.setText (node.getBusName(), dontSendNotification);
+    }
+
+    void timerCallback() override
+    {
+        int slider = 0, button = 0;
+        for (auto* const param : node.getParameters())
+        {
+            if (auto* const toggle = dynamic_cast<AudioParameterBool*> (param))
+                buttons[button++]->setToggleState (toggle->get(), dontSendNotification);
+            else if (auto* const ranged = dynamic_cast<AudioParameterFloat*> (param))
+                sliders[slider++]->setValue (ranged->get(), dontSendNotification);
+        }
+    }
+};
+
+//=============================================================================
+AuxBusNode::AuxBusNode (const BusesProperties& ioLayouts)
+    : BaseProcessor (ioLayouts)
+{
+    addParameter (level = new AudioParameterFloat ("level", "Level", -70.f, 12.f, 0.f));
+    levelGain.attach (*level, levelToGain);
+    addSmoothedParameter (levelGain);
+}
+
+AuxBusNode::~AuxBusNode()
+{
+    attach (nullptr);
+}
+
+void AuxBusNode::setBusName (const String& name)
+{
+    if (name.isEmpty() || name == busName)
+        return;
+    busName = name;
+    if (buses == nullptr)
+        return;
+
+    bus.store (buses->getBus (busName), std::memory_order_release);
+    if (buses->onRoutingChanged)
+        buses->onRoutingChanged();
+}
+
+void AuxBusNode::attach (AuxBuses* newBuses)
+{
+    buses = newBuses;
+    bus.store (buses != nullptr ? buses->getBus (busName) : nullptr, std::memory_order_release);
+}
+
+AudioProcessorEditor* AuxBusNode::createEditor()
+{
+    return new AuxBusEditor (*this);
+}
+
+void AuxBusNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("bus", busName, nullptr)
+         .setProperty ("level", (float) *level, nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void AuxBusNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+    setBusName (state.getProperty ("bus", busName).toString());
+    *level = (float) state.getProperty ("level", (float) *level);
+    resetSmoothedParameters();
+}
+
+//=============================================================================
+AuxSendNode::AuxSendNode()
+    : AuxBusNode (BusesProperties()
+        .withInput  ("Main", AudioChannelSet::stereo(), true)
+        .withOutput ("Main", AudioChannelSet::stereo(), true))
+{
+    addParameter (send = new AudioParameterFloat ("send", "Send", -70.f, 12.f, 0.f));
+    addParameter (preFader = new AudioParameterBool ("pre", "Pre Level", false));
+    sendGain.attach (*send, levelToGain);
+    addSmoothedParameter (sendGain);
+}
+
+AuxSendNode::~AuxSendNode() { }
+
+void AuxSendNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_AUX_SEND;
+    desc.descriptiveName    = "Mixes its inputs into an aux bus";
+    desc.numInputChannels   = 2;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_AUX_SEND;
+}
+
+void AuxSendNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (2, 2, sampleRate, maximumExpectedSamplesPerBlock);
+    prepareSmoothedParameters (sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+void AuxSendNode::mixInto (AuxBuses::Bus& target, float* const* channels,
+                           const int numChannels, const int numSamples) noexcept
+{
+    if (sendGain.isSmoothing())
+        target.add (channels, numChannels, sendGain.getValues(), numSamples);
+    else if (sendGain.getCurrentValue() > 0.f)
+        target.add (channels, numChannels, sendGain.getCurrentValue(), numSamples);
+}
+
+void AuxSendNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    const int numSamples  = buffer.getNumSamples();
+    const int numChannels = jmin (2, buffer.getNumChannels());
+    auto* const* channels = buffer.getArrayOfWritePointers();
+    auto* const target = getCurrentBus();
+    const bool pre = preFader->get();
+
+    levelGain.process (numSamples);
+    sendGain.process (numSamples);
+
+    if (target != nullptr && pre)
+        mixInto (*target, channels, numChannels, numSamples);
+    levelGain.applyGain (channels, numChannels, numSamples);
+    if (target != nullptr && ! pre)
+        mixInto (*target, channels, numChannels, numSamples);
+}
+
+void AuxSendNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("bus", getBusName(), nullptr)
+         .setProperty ("level", (float) *level, nullptr)
+         .setProperty ("send", (float) *send, nullptr)
+         .setProperty ("pre", preFader->get(), nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void AuxSendNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+    *send = (float) state.getProperty ("send", (float) *send);
+    *preFader = (bool) state.getProperty ("pre", false);
+    AuxBusNode::setStateInformation (data, sizeInBytes);
+}
+
+//=============================================================================
+AuxReturnNode::AuxReturnNode()
+    : AuxBusNode (BusesProperties()
+        .withOutput ("Main", AudioChannelSet::stereo(), true))
+{ }
+
+AuxReturnNode::~AuxReturnNode() { }
+
+void AuxReturnNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_AUX_RETURN;
+    desc.descriptiveName    = "Plays what was sent to an aux bus";
+    desc.numInputChannels   = 0;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_AUX_RETURN;
+}
+
+void AuxReturnNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (0, 2, sampleRate, maximumExpectedSamplesPerBlock);
+    prepareSmoothedParameters (sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+void AuxReturnNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    const int numSamples  = buffer.getNumSamples();
+    const int numChannels = jmin ((int) AuxBuses::numChannels, buffer.getNumChannels());
+    auto* const source = getCurrentBus();
+    levelGain.process (numSamples);
+    midi.clear();
+
+    if (source == nullptr || ! source->hasSignal())
+    {
+        buffer.clear();
+        return;
+    }
+
+    const int numFromBus = jmin (numSamples, source->getNumSamples());
+    for (int c = 0; c < numChannels; ++c)
+        FloatVectorOperations::copy (buffer.getWritePointer (c), source->getReadPointer (c), numFromBus);
+    for (int c = numChannels; c < buffer.getNumChannels(); ++c)
+        buffer.clear (c, 0, numSamples);
+    if (numFromBus < numSamples)
+        for (int c = 0; c < numChannels; ++c)
+            buffer.clear (c, numFromBus, numSamples - numFromBus);
+    levelGain.applyGain (buffer.getArrayOfWritePointers(), numChannels, numSamples);
+}
+
+}
@@ -0,0 +1,141 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/AuxBus.h"
+
+namespace Element {
+
+/** A node that sends to or returns from one of its graph's aux buses.
+
+    The graph hands nodes its buses when it builds a rendering sequence and
+    orders every send of a bus before its returns, so a bus has no wires and
+    needs no buffers of the graph's own.
+ */
+class AuxBusNode : public BaseProcessor
+{
+public:
+    AuxBusNode (const BusesProperties& ioLayouts);
+    virtual ~AuxBusNode();
+
+    /** Returns true for sends, false for returns */
+    virtual bool isSend() const noexcept = 0;
+
+    /** Picks the bus by name. Message thread */
+    void setBusName (const String& name);
+    const String& getBusName() const noexcept { return busName; }
+
+    /** Sets the buses this uses, called by the graph rendering the node */
+    void attach (AuxBuses* buses);
+
+    /** Returns the buses of the graph rendering this, nullptr if none */
+    AuxBuses* getAuxBuses() const noexcept { return buses; }
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return false; }
+    bool producesMidi() const override                  { return false; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    AudioParameterFloat* level = nullptr;
+    SmoothedParameter levelGain;
+
+    /** Returns the bus to use this block. Audio thread */
+    AuxBuses::Bus* getCurrentBus() const noexcept { return bus.load (std::memory_order_acquire); }
+
+    static float levelToGain (float db) { return db <= -70.f ? 0.f : Decibels::decibelsToGain (db); }
+
+private:
+    String busName { "Aux 1" };
+    AuxBuses* buses = nullptr;
+    std::atomic<AuxBuses::Bus*> bus { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE (AuxBusNode)
+};
+
+//=============================================================================
+/** Passes its inputs through at its level and mixes them into an aux bus,
+    before or after the level and scaled by the send's own
+ */
+class AuxSendNode : public AuxBusNode
+{
+public:
+    AuxSendNode();
+    ~AuxSendNode();
+
+    bool isSend() const noexcept override { return true; }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "Aux Send"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override { }
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+    bool silenceInProducesSilenceOut() const override { return true; }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+private:
+    AudioParameterFloat* send = nullptr;
+    AudioParameterBool* preFader = nullptr;
+    SmoothedParameter sendGain;
+
+    void mixInto (AuxBuses::Bus&, float* const* channels, int numChannels, int numSamples) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AuxSendNode)
+};
+
+//=============================================================================
+/** Plays what was sent to an aux bus this block, at its level */
+class AuxReturnNode : public AuxBusNode
+{
+public:
+    AuxReturnNode();
+    ~AuxReturnNode();
+
+    bool isSend() const noexcept override { return false; }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "Aux Return"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override { }
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AuxReturnNode)
+};
+
+}
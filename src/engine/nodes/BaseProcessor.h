@@ -20,6 +20,7 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "engine/SmoothedParameter.h"
 
 #define EL_INTERNAL_FORMAT_NAME                 "Element"
 
@@ -47,6 +48,14 @@
 #define EL_INTERNAL_ID_LUA                      "element.lua"
 #define EL_INTERNAL_ID_COMPRESSOR               "element.compressor"
 #define EL_INTERNAL_ID_MIDI_ROUTER              "element.midiRouter"
+#define EL_INTERNAL_ID_AUDIO_RECORDER           "element.audioRecorder"
+#define EL_INTERNAL_ID_CONVOLUTION              "element.convolution"
+#define EL_INTERNAL_ID_NETWORK_SEND             "element.networkSend"
+#define EL_INTERNAL_ID_NETWORK_RECEIVE          "element.networkReceive"
+#define EL_INTERNAL_ID_AUX_SEND                 "element.auxSend"
+#define EL_INTERNAL_ID_AUX_RETURN               "element.auxReturn"
+#define EL_INTERNAL_ID_SAMPLER                  "element.sampler"
+#define EL_INTERNAL_ID_MIDI_FILE_PLAYER         "element.midiFilePlayer"
 
 #define EL_INTERNAL_UID_AUDIO_FILE_PLAYER        1000
 #define EL_INTERNAL_UID_AUDIO_MIXER              1001
@@ -72,6 +81,14 @@
 #define EL_INTERNAL_UID_LUA                      1021
 #define EL_INTERNAL_UID_COMPRESSOR               1022
 #define EL_INTERNAL_UID_MIDI_ROUTER              1023
+#define EL_INTERNAL_UID_AUDIO_RECORDER           1024
+#define EL_INTERNAL_UID_CONVOLUTION              1025
+#define EL_INTERNAL_UID_NETWORK_SEND             1026
+#define EL_INTERNAL_UID_NETWORK_RECEIVE          1027
+#define EL_INTERNAL_UID_AUX_SEND                 1028
+#define EL_INTERNAL_UID_AUX_RETURN               1029
+#define EL_INTERNAL_UID_SAMPLER                  1030
+#define EL_INTERNAL_UID_MIDI_FILE_PLAYER         1031
 
 namespace Element {
 
@@ -83,6 +100,62 @@ public:
         : AudioPluginInstance (ioLayouts) { }
     virtual ~BaseProcessor() { }
 
+    /** Returns true if this smooths some of its parameters itself, in which
+        case the engine passes their timed changes on as events rather than
+        splitting blocks where they land */
+    bool acceptsParameterEvents() const noexcept { return smoothedParameters.size() > 0; }
+
+    /** Queues a change to a parameter for the next block, at a sample offset
+        into it. Returns false if the parameter isn't smoothed here, and the
+        caller should set it. Audio thread only */
+    bool addParameterEvent (int parameterIndex, float normalisedValue,
+                            int offset, int rampSamples = -1) noexcept
+    {
+        auto* const parameter = getParameters()[parameterIndex];
+        for (auto* smoothed : smoothedParameters)
+        {
+            if (smoothed->getParameter() == parameter)
+            {
+                smoothed->addEvent (normalisedValue, offset, rampSamples);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Returns the bytes this holds beyond what the engine gives it, e.g.
+        decoded files. Called on the message thread */
+    virtual int64 getMemoryBytes() const { return 0; }
+
+    /** Returns true if prepareToPlay() is safe to call off the message thread
+        while other nodes prepare, letting graphs prepare it on a worker. Only
+        for processors doing plain DSP setup there */
+    virtual bool canPrepareConcurrently() const { return false; }
+
+protected:
+    /** Registers a smoothed parameter, so it gets the engine's events */
+    void addSmoothedParameter (SmoothedParameter& parameter)
+    {
+        jassert (parameter.getParameter() != nullptr);
+        smoothedParameters.addIfNotAlreadyThere (&parameter);
+    }
+
+    /** Prepares every registered parameter */
+    void prepareSmoothedParameters (double sampleRate, int maxBlockSize, double rampSeconds = 0.02)
+    {
+        for (auto* smoothed : smoothedParameters)
+            smoothed->prepare (sampleRate, maxBlockSize, rampSeconds);
+    }
+
+    /** Jumps every registered parameter to its value, after loading state say */
+    void resetSmoothedParameters() noexcept
+    {
+        for (auto* smoothed : smoothedParameters)
+            smoothed->reset();
+    }
+
+public:
+
 #if 0
     // Audio Processor Template
     virtual const String getName() const = 0;
@@ -141,6 +214,8 @@ protected:
 #endif
     
 private:
+    Array<SmoothedParameter*> smoothedParameters;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BaseProcessor)
 };
 
@@ -20,68 +20,71 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/DelayLine.h"
 
 namespace Element {
 
+/** A damped feedback comb over every channel of a block at once. The
+    delay is preallocated, so its length can move while playing */
 class CombFilter
 {
 public:
-    CombFilter() noexcept
-        : bufferSize(0), bufferIndex(0), allocatedSize(0), last(0) { }
-    
-    void setSize (const int numSamples)
+    CombFilter() noexcept { }
+
+    /** Allocates the delay. Not realtime safe */
+    void prepare (const int maxLengthSamples, const int numChannels, const int rampSamples)
     {
-        if (numSamples == bufferSize)
-            return;
-        
-        const int proposedSize = nextPowerOfTwo (numSamples);
-        if (proposedSize > allocatedSize)
-        {
-            buffer.realloc (static_cast<size_t> ( proposedSize));
-            allocatedSize = proposedSize;
-        }
-        
-        bufferSize = numSamples;
-        if (bufferIndex >= bufferSize)
-        {
-            bufferIndex = 0;
-        }
-        
+        line.prepare (maxLengthSamples, numChannels, rampSamples);
         clear();
     }
-    
+
+    /** Sets the length in samples, gliding there unless glide is false. Realtime safe */
+    void setLength (const float numSamples, const bool glide = true) noexcept { line.setDelay (numSamples, glide); }
+
+    /** Sets extra length for one channel */
+    void setSpread (const int channel, const int numSamples) noexcept { line.setChannelOffset (channel, numSamples); }
+
     void clear() noexcept
     {
-        last = 0;
-        bufferIndex = 0;
-        buffer.clear ((size_t) bufferSize);
+        line.clear();
+        zeromem (last, sizeof (last));
     }
-    
+
     void free()
     {
-        last = 0;
-        bufferSize = allocatedSize = 0;
-        buffer.free();
+        line.free();
+        zeromem (last, sizeof (last));
     }
-    
-    float process (const float input, const float damp, const float feedbackLevel) noexcept
+
+    /** Filters channels in place */
+    void processBlock (float* const* channels, const int numChannels, const int numSamples,
+                       const float damp, const float feedbackLevel) noexcept
     {
-        const float output = buffer [bufferIndex];
-        last = (output * (1.0f - damp)) + (last * damp);
-        JUCE_UNDENORMALISE (last);
-        
-        float temp = input + (last * feedbackLevel);
-        JUCE_UNDENORMALISE (temp);
-        buffer [bufferIndex] = temp;
-        bufferIndex = (bufferIndex + 1) % bufferSize;
-        return output;
+        if (! line.isPrepared())
+            return;
+
+        const ScopedNoDenormals noDenormals;
+        const int numChans = jmin (numChannels, line.getNumChannels());
+        float output [FeedbackDelay::maxChannels] = {};
+        float input  [FeedbackDelay::maxChannels] = {};
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            line.read (output);
+            for (int c = 0; c < numChans; ++c)
+            {
+                last[c]  = (output[c] * (1.0f - damp)) + (last[c] * damp);
+                input[c] = channels[c][i] + (last[c] * feedbackLevel);
+                channels[c][i] = output[c];
+            }
+            line.write (input);
+        }
     }
-    
+
 private:
-    HeapBlock<float> buffer;
-    int bufferSize, bufferIndex, allocatedSize;
-    float last;
-    
+    FeedbackDelay line;
+    float last [FeedbackDelay::maxChannels] = {};
+
     JUCE_DECLARE_NON_COPYABLE (CombFilter)
 };
 
@@ -107,9 +110,14 @@ public:
     {
         setPlayConfigDetails (stereo ? 2 : 1, stereo ? 2 : 1, 44100.0, 1024);
         addParameter (length   = new AudioParameterFloat ("length",   "Buffer Length",  1.f, 500.f, 90.f));
-        lastLength = *length;
         addParameter (damping  = new AudioParameterFloat ("damping",  "Damping",        0.f, 1.f, 0.f));
         addParameter (feedback = new AudioParameterFloat ("feedback", "Feedback Level", 0.f, 1.f, 0.5f));
+        smoothedDamping.attach (*damping);
+        smoothedFeedback.attach (*feedback);
+        smoothedLength.attach (*length);
+        addSmoothedParameter (smoothedDamping);
+        addSmoothedParameter (smoothedFeedback);
+        addSmoothedParameter (smoothedLength);
     }
     
     virtual ~CombFilterProcessor()
@@ -138,35 +146,53 @@ public:
     }
     void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
     {
+        const int numChans = stereo ? 2 : 1;
+        const int maxSize = roundToIntAccurate (length->range.end * sampleRate * 0.001)
+                          + spreadForChannel (numChans - 1);
+        comb.prepare (maxSize, numChans, roundToIntAccurate (sampleRate * 0.02));
+        for (int c = 0; c < numChans; ++c)
+            comb.setSpread (c, spreadForChannel (c));
+
+        prepareSmoothedParameters (sampleRate, maximumExpectedSamplesPerBlock);
         lastLength = *length;
-        for (int i = 0; i < 2; ++i)
-            comb[i].setSize (spreadForChannel(i) + (*length * sampleRate * 0.001));
-        setPlayConfigDetails (stereo ? 2 : 1, stereo ? 2 : 1,
-                              sampleRate, maximumExpectedSamplesPerBlock);
+        comb.setLength ((float) (*length * sampleRate * 0.001), false);
+        setPlayConfigDetails (numChans, numChans, sampleRate, maximumExpectedSamplesPerBlock);
     }
     
     void releaseResources() override
     {
-        for (int i = 0; i < 2; ++i)
-            comb[i].free();
+        comb.free();
     }
     
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
     {
-        if (lastLength != *length)
+        const int numSamples = buffer.getNumSamples();
+        const int numChans = jmin (stereo ? 2 : 1, buffer.getNumChannels());
+        const float* const dampValues     = smoothedDamping.process (numSamples);
+        const float* const feedbackValues = smoothedFeedback.process (numSamples);
+        const float* const lengthValues   = smoothedLength.process (numSamples);
+        const bool moving = smoothedDamping.isSmoothing() || smoothedFeedback.isSmoothing()
+                         || smoothedLength.isSmoothing();
+
+        // the delay glides between lengths itself, the rest step along
+        const int step = moving ? (int) SmoothedParameter::interval : numSamples;
+        float* channels [2] = {};
+        for (int offset = 0; offset < numSamples; offset += step)
         {
-            const int newSize = roundToIntAccurate (*length * getSampleRate() * 0.001);
-            for (int i = 0; i < 2; ++i)
-                comb[i].setSize (newSize);
-            lastLength = *length;
+            const int numThisTime = jmin (step, numSamples - offset);
+            const float newLength = moving ? lengthValues[offset] : smoothedLength.getCurrentValue();
+            if (lastLength != newLength)
+            {
+                comb.setLength ((float) (newLength * getSampleRate() * 0.001));
+                lastLength = newLength;
+            }
+
+            for (int c = 0; c < numChans; ++c)
+                channels[c] = buffer.getWritePointer (c, offset);
+            comb.processBlock (channels, numChans, numThisTime,
+                               moving ? dampValues[offset] : smoothedDamping.getCurrentValue(),
+                               moving ? feedbackValues[offset] : smoothedFeedback.getCurrentValue());
         }
-        
-        const int numChans = jmin (2, buffer.getNumChannels());
-        const auto** input = buffer.getArrayOfReadPointers();
-        auto** output = buffer.getArrayOfWritePointers();
-        for (int c = 0; c < numChans; ++c)
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-                output[c][i] = comb[c].process (input[c][i], *damping, *feedback);
     }
 
     AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
@@ -202,13 +228,15 @@ public:
                 *damping  = (float) state.getProperty ("damping",  (float) *damping);
                 *feedback = (float) state.getProperty ("feedback", (float) *feedback);
                 *length   = (float) state.getProperty ("length",   (float) *length);
+                resetSmoothedParameters();
             }
         }
     }
 
 private:
-    CombFilter comb[2];
-    float lastLength;
+    CombFilter comb;
+    SmoothedParameter smoothedDamping, smoothedFeedback, smoothedLength;
+    float lastLength = 0.f;
 };
 
 }
@@ -48,6 +48,8 @@ CompressorProcessor::CompressorProcessor (const int _numChannels)
     addParameter (releaseMs = new AudioParameterFloat ("release",   "Release [ms]",   releaseRange, 100.0f));
     addParameter (makeupDB  = new AudioParameterFloat ("makeup",    "Makeup [dB]",    -18.0f, 18.0f, 0.0f));
     addParameter (sideChain = new AudioParameterFloat ("sidechain", "Side Chain",     0.0f, 1.0f, 0.0f));
+    addParameter (lookaheadMs = new AudioParameterFloat ("lookahead", "Lookahead [ms]", 0.0f, maxLookaheadMs, 0.0f));
+    addParameter (link      = new AudioParameterChoice ("link",     "Stereo Link",    StringArray { "Linked", "Unlinked" }, 0));
 
     makeupGain.reset (numSteps);
 }
@@ -69,64 +71,187 @@ void CompressorProcessor::fillInPluginDescription (PluginDescription& desc) cons
 
 void CompressorProcessor::updateParams()
 {
-    detector.setAttackMs (*attackMs);
-    detector.setReleaseMs (*releaseMs);
+    for (int c = 0; c < maxChannels; ++c)
+    {
+        detectors[c].setAttackMs (*attackMs);
+        detectors[c].setReleaseMs (*releaseMs);
 
-    sideDetector.setAttackMs (*attackMs);
-    sideDetector.setReleaseMs (*releaseMs);
+        sideDetectors[c].setAttackMs (*attackMs);
+        sideDetectors[c].setReleaseMs (*releaseMs);
 
-    gainComputer.setThreshold (*threshDB);
-    gainComputer.setRatio (*ratio);
-    gainComputer.setKnee (*kneeDB);
+        gainComputers[c].setThreshold (*threshDB);
+        gainComputers[c].setRatio (*ratio);
+        gainComputers[c].setKnee (*kneeDB);
+    }
 
     makeupGain.setTargetValue (Decibels::decibelsToGain ((float) *makeupDB));
 }
 
-void CompressorProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+void CompressorProcessor::prepareToPlay (double newSampleRate, int maximumExpectedSamplesPerBlock)
 {
-    detector.reset ((float) sampleRate);
-    sideDetector.reset ((float) sampleRate);
-    gainComputer.reset();
+    sampleRate = newSampleRate;
+    blockSize = jmax (1, maximumExpectedSamplesPerBlock);
+
+    for (int c = 0; c < maxChannels; ++c)
+    {
+        detectors[c].reset ((float) sampleRate);
+        sideDetectors[c].reset ((float) sampleRate);
+        gainComputers[c].reset();
+    }
+
+    maxLookahead = roundToInt (sampleRate * maxLookaheadMs / 1000.0);
+    lookahead = jlimit (0, maxLookahead, roundToInt (sampleRate * *lookaheadMs / 1000.0));
+    levels.setSize (maxChannels * 2, blockSize);
+    gains.setSize (maxChannels, blockSize);
+    delayLines.setSize (maxChannels, maxLookahead + blockSize);
+    delayLines.clear();
+
+    reportInterval = jmax (1, roundToInt (sampleRate * reportIntervalMs / 1000.0));
+    reportLevel = 0.0f;
+    samplesSinceReport = 0;
 
     setBusesLayout (getBusesLayout());
     setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+    setLatencySamples (lookahead);
 }
 
-void CompressorProcessor::releaseResources() {}
+void CompressorProcessor::releaseResources()
+{
+    levels.setSize (1, 1);
+    gains.setSize (1, 1);
+    delayLines.setSize (1, 1);
+    blockSize = 0;
+}
 
 void CompressorProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
 {
+    if (blockSize <= 0)
+        return;
+
     auto mainBuffer = getBusBuffer (buffer, true, 0);
     auto sideBuffer = getBusBuffer (buffer, true, 1);
 
-    auto numBuffChannels = mainBuffer.getNumChannels();
-
     updateParams();
 
-    float level = 0.0f;
-    for (int n = 0; n < buffer.getNumSamples(); ++n)
+    const auto newLookahead = jlimit (0, maxLookahead, roundToInt (sampleRate * *lookaheadMs / 1000.0));
+    if (newLookahead != lookahead)
+    {
+        // the history isn't kept without lookahead, don't play it back stale
+        if (lookahead == 0)
+            delayLines.clear();
+        lookahead = newLookahead;
+        triggerAsyncUpdate();
+    }
+
+    for (int offset = 0; offset < buffer.getNumSamples(); offset += blockSize)
+        process (mainBuffer, sideBuffer, offset, jmin (blockSize, buffer.getNumSamples() - offset));
+}
+
+void CompressorProcessor::process (AudioBuffer<float>& main, AudioBuffer<float>& side, int offset, int numSamples)
+{
+    const int numMain = jmin ((int) maxChannels, main.getNumChannels());
+    const int numSide = jmin (numMain, side.getNumChannels());
+    if (numMain <= 0)
+        return;
+
+    const float sideMix = numSide > 0 ? (float) *sideChain : 0.0f;
+    const bool linked = link->getIndex() == 0 || numMain == 1;
+    const int numDetectors = linked ? 1 : numMain;
+
+    // detect levels, mixing the linked inputs down to mono first
+    auto detect = [&] (AudioBuffer<float>& input, int numInputs, LevelDetector* dets, float* const* dest)
+    {
+        for (int d = 0; d < numDetectors; ++d)
+        {
+            const float* in = input.getReadPointer (jmin (d, numInputs - 1), offset);
+            if (linked && numInputs > 1)
+            {
+                FloatVectorOperations::copy (dest[d], in, numSamples);
+                for (int c = 1; c < numInputs; ++c)
+                    FloatVectorOperations::add (dest[d], input.getReadPointer (c, offset), numSamples);
+                FloatVectorOperations::multiply (dest[d], 1.0f / (float) numInputs, numSamples);
+                in = dest[d];
+            }
+
+            dets[d].processBlock (in, dest[d], numSamples);
+        }
+    };
+
+    float* mainLevels[maxChannels] = { levels.getWritePointer (0), levels.getWritePointer (1) };
+    float* sideLevels[maxChannels] = { levels.getWritePointer (2), levels.getWritePointer (3) };
+
+    if (sideMix < 1.0f)
+        detect (main, numMain, detectors, mainLevels);
+    if (sideMix > 0.0f)
+        detect (side, numSide, sideDetectors, sideLevels);
+
+    float peak = 0.0f;
+    for (int d = 0; d < numDetectors; ++d)
     {
-        // Get Main mono input
-        float mainInput = getSummedMonoSample (mainBuffer, n, numBuffChannels);
+        if (sideMix >= 1.0f)
+        {
+            FloatVectorOperations::copy (mainLevels[d], sideLevels[d], numSamples);
+        }
+        else if (sideMix > 0.0f)
+        {
+            FloatVectorOperations::multiply (mainLevels[d], 1.0f - sideMix, numSamples);
+            FloatVectorOperations::addWithMultiply (mainLevels[d], sideLevels[d], sideMix, numSamples);
+        }
 
-        // Get sidechain mono input
-        float sideInput = getSummedMonoSample (sideBuffer, n, numBuffChannels);
+        peak = jmax (peak, FloatVectorOperations::findMaximum (mainLevels[d], numSamples));
+        gainComputers[d].processBlock (mainLevels[d], gains.getWritePointer (d), numSamples);
+    }
 
-        // Get level estimate, and compute gain
-        level = detector.process (mainInput) * (1.0f - *sideChain)
-              + sideDetector.process (sideInput) * *sideChain;
-        float gain = gainComputer.process (level);
+    if (makeupGain.isSmoothing())
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto makeup = makeupGain.getNextValue();
+            for (int d = 0; d < numDetectors; ++d)
+                gains.getWritePointer (d)[i] *= makeup;
+        }
+    }
+    else
+    {
+        for (int d = 0; d < numDetectors; ++d)
+            FloatVectorOperations::multiply (gains.getWritePointer (d), makeupGain.getTargetValue(), numSamples);
+    }
+
+    for (int c = 0; c < numMain; ++c)
+    {
+        auto* audio = main.getWritePointer (c, offset);
+
+        if (lookahead > 0)
+        {
+            // history sits in front of the block, play from lookahead samples back
+            auto* line = delayLines.getWritePointer (c);
+            FloatVectorOperations::copy (line + maxLookahead, audio, numSamples);
+            FloatVectorOperations::copy (audio, line + maxLookahead - lookahead, numSamples);
+            std::memmove (line, line + numSamples, sizeof (float) * (size_t) maxLookahead);
+        }
 
-        // Apply gain
-        mainBuffer.applyGain (n, 1, gain * makeupGain.getNextValue());
+        FloatVectorOperations::multiply (audio, gains.getReadPointer (linked ? 0 : c), numSamples);
     }
 
-    listeners.call (&Listener::updateInGainDB, Decibels::gainToDecibels (level));
+    reportLevel = jmax (reportLevel, peak);
+    samplesSinceReport += numSamples;
+    if (samplesSinceReport >= reportInterval)
+    {
+        listeners.call (&Listener::updateInGainDB, Decibels::gainToDecibels (reportLevel));
+        reportLevel = 0.0f;
+        samplesSinceReport = 0;
+    }
+}
+
+void CompressorProcessor::handleAsyncUpdate()
+{
+    setLatencySamples (lookahead);
 }
 
 float CompressorProcessor::calcGainDB (float db)
 {
     auto x = Decibels::decibelsToGain (db);
+    auto& gainComputer = gainComputers[0];
     auto gain = gainComputer.calcGain (x, gainComputer.thresh.getCurrentValue(), gainComputer.ratio.getCurrentValue());
     return Decibels::gainToDecibels (gain);
 }
@@ -143,6 +268,8 @@ void CompressorProcessor::getStateInformation (juce::MemoryBlock& destData)
     state.setProperty ("release",   (float) *releaseMs, 0);
     state.setProperty ("makeup",    (float) *makeupDB,  0);
     state.setProperty ("sidechain", (float) *sideChain, 0);
+    state.setProperty ("lookahead", (float) *lookaheadMs, 0);
+    state.setProperty ("link",      link->getIndex(),   0);
     if (auto e = state.createXml())
         AudioProcessor::copyXmlToBinary (*e, destData);
 }
@@ -161,6 +288,8 @@ void CompressorProcessor::setStateInformation (const void* data, int sizeInBytes
             *releaseMs = (float) state.getProperty ("release",   (float) *releaseMs);
             *makeupDB  = (float) state.getProperty ("makeup",    (float) *makeupDB);
             *sideChain = (float) state.getProperty ("sidechain", (float) *sideChain);
+            *lookaheadMs = (float) state.getProperty ("lookahead", (float) *lookaheadMs);
+            *link      = (int) state.getProperty ("link", link->getIndex());
         }
     }
 }
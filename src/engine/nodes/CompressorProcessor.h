@@ -74,6 +74,19 @@ public:
         return levelEstimate;
     }
 
+    /* Process a block of samples. in and out may be the same buffer */
+    inline void processBlock (const float* in, float* out, int numSamples)
+    {
+        auto estimate = levelEstimate;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto x = std::abs (in[i]);
+            estimate += (x > estimate ? b0_a : b0_r) * (x - estimate);
+            out[i] = estimate;
+        }
+        levelEstimate = estimate;
+    }
+
     void setLevelEstimate (float levelEst) { levelEstimate = levelEst; }
     float getLevelEstimate() { return levelEstimate; }
 
@@ -159,6 +172,22 @@ public:
         return calcGain (x, thresh.getNextValue(), ratio.getNextValue());
     }
 
+    /* Computes gains for a block of levels. in and out may be the same buffer */
+    inline void processBlock (const float* in, float* out, int numSamples)
+    {
+        if (thresh.isSmoothing() || ratio.isSmoothing())
+        {
+            for (int i = 0; i < numSamples; ++i)
+                out[i] = process (in[i]);
+            return;
+        }
+
+        const auto curThresh = thresh.getTargetValue();
+        const auto curRatio  = ratio.getTargetValue();
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = calcGain (in[i], curThresh, curRatio);
+    }
+
 private:
     // recalculate knee values for a new threshold or knee width
     void recalcKnees()
@@ -189,8 +218,16 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainComputer)
 };
 
-/** Compressor Processing */
-class CompressorProcessor : public BaseProcessor
+/** Compressor Processing.
+
+    Detection and gain are computed a block at a time into preallocated
+    buffers, either once for all channels (linked) or per channel. With
+    lookahead the main signal is delayed so the gain reacts ahead of the
+    audio, and the delay is reported as latency. Listeners are updated at
+    most every reportIntervalMs with the peak level since the last update.
+*/
+class CompressorProcessor : public BaseProcessor,
+                            private AsyncUpdater
 {
 public:
     explicit CompressorProcessor (const int _numChannels = 2);
@@ -233,6 +270,12 @@ public:
     void addListener (Listener* l) { listeners.add (l); }
     void removeListener (Listener* l) { listeners.remove (l); }
 
+    /** Longest lookahead in milliseconds */
+    static constexpr float maxLookaheadMs = 20.0f;
+
+    /** Milliseconds between listener updates */
+    static constexpr int reportIntervalMs = 30;
+
 protected:
     inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
     {
@@ -260,13 +303,7 @@ protected:
     }
 
 private:
-    inline float getSummedMonoSample (AudioBuffer<float>& buffer, int idx, int numChans)
-    {
-        float sum = 0.0f;
-        for (int ch = 0; ch < numChans; ++ch)
-            sum += buffer.getSample (ch, idx);
-        return sum / (float) numChans;
-    };
+    enum { maxChannels = 2 };
 
     int numChannels = 0;
     AudioParameterFloat* threshDB  = nullptr;
@@ -276,15 +313,31 @@ private:
     AudioParameterFloat* releaseMs = nullptr;
     AudioParameterFloat* makeupDB  = nullptr;
     AudioParameterFloat* sideChain = nullptr;
+    AudioParameterFloat* lookaheadMs = nullptr;
+    AudioParameterChoice* link     = nullptr;
 
     SmoothedValue<float, ValueSmoothingTypes::Multiplicative> makeupGain = 1.0f;
     const int numSteps = 200;
 
-    LevelDetector detector;
-    LevelDetector sideDetector;
-    GainComputer gainComputer;
+    LevelDetector detectors [maxChannels];
+    LevelDetector sideDetectors [maxChannels];
+    GainComputer gainComputers [maxChannels];
+
+    double sampleRate = 44100.0;
+    int blockSize = 0;
+    AudioBuffer<float> levels;      // main levels, then side levels
+    AudioBuffer<float> gains;
+    AudioBuffer<float> delayLines;  // per channel history of maxLookahead, then the block
+    int maxLookahead = 0;
+    int lookahead = 0;
 
     ListenerList<Listener> listeners;
+    float reportLevel = 0.0f;
+    int reportInterval = 0;
+    int samplesSinceReport = 0;
+
+    void process (AudioBuffer<float>& main, AudioBuffer<float>& side, int offset, int numSamples);
+    void handleAsyncUpdate() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompressorProcessor)
 };
@@ -0,0 +1,238 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "engine/nodes/ConvolutionProcessor.h"
+#include "gui/nodes/ConvolutionNodeEditor.h"
+
+namespace Element {
+
+ConvolutionProcessor::ConvolutionProcessor()
+    : BaseProcessor()
+{
+    setPlayConfigDetails (2, 2, 44100.0, 512);
+    formats.registerBasicFormats();
+    addParameter (wetLevel = new AudioParameterFloat ("wetLevel", "Wet Level", 0.f, 1.f, 1.f));
+    addParameter (dryLevel = new AudioParameterFloat ("dryLevel", "Dry Level", 0.f, 1.f, 0.f));
+    wetGain.attach (*wetLevel);
+    dryGain.attach (*dryLevel);
+    addSmoothedParameter (wetGain);
+    addSmoothedParameter (dryGain);
+}
+
+ConvolutionProcessor::~ConvolutionProcessor()
+{
+    engine.reset();
+}
+
+void ConvolutionProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_CONVOLUTION;
+    desc.descriptiveName    = "Convolves audio with an impulse response";
+    desc.numInputChannels   = 2;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_CONVOLUTION;
+}
+
+bool ConvolutionProcessor::loadImpulse (const File& file)
+{
+    auto entry = cache->load (file, formats, (int64) maxImpulseSeconds * 48000);
+    if (entry == nullptr || entry->audio.getNumSamples() <= 0)
+        return false;
+
+    impulseFile = file;
+    impulse = entry;
+    buildEngine();
+    sendChangeMessage();
+    return true;
+}
+
+void ConvolutionProcessor::clearImpulse()
+{
+    impulseFile = File();
+    impulse = nullptr;
+    buildEngine();
+    sendChangeMessage();
+}
+
+int ConvolutionProcessor::getImpulseLength() const
+{
+    return impulseLength.load();
+}
+
+double ConvolutionProcessor::getTailLengthSeconds() const
+{
+    return (double) impulseLength.load() / preparedRate;
+}
+
+int64 ConvolutionProcessor::getMemoryBytes() const
+{
+    if (impulse == nullptr)
+        return 0;
+    // the engine's partitions are zero padded to twice their length
+    const int numChannels = jmin ((int) Convolver::maxChannels, impulse->audio.getNumChannels());
+    return impulse->getSizeInBytes()
+        + 2 * (int64) impulseLength.load() * numChannels * (int64) sizeof (float);
+}
+
+void ConvolutionProcessor::buildEngine()
+{
+    std::unique_ptr<Convolver> newEngine;
+
+    if (impulse != nullptr)
+    {
+        const auto& source = impulse->audio;
+        AudioBuffer<float> response;
+
+        if (impulse->sampleRate == preparedRate)
+        {
+            response.makeCopyOf (source);
+        }
+        else
+        {
+            // scaled so the response is as loud at the new rate
+            // the interpolator reads a little ahead, so it gets some silence past the end
+            const double ratio = impulse->sampleRate / preparedRate;
+            const int length = jmax (1, roundToInt (source.getNumSamples() / ratio));
+            AudioBuffer<float> padded (source.getNumChannels(), source.getNumSamples() + 16);
+            padded.clear();
+            response.setSize (source.getNumChannels(), length);
+            for (int c = 0; c < source.getNumChannels(); ++c)
+            {
+                padded.copyFrom (c, 0, source, c, 0, source.getNumSamples());
+                LagrangeInterpolator interpolator;
+                interpolator.process (ratio, padded.getReadPointer (c), response.getWritePointer (c), length);
+            }
+            response.applyGain ((float) ratio);
+        }
+
+        newEngine.reset (new Convolver());
+        newEngine->prepare (response, getTotalNumOutputChannels(), preparedBlockSize);
+    }
+
+    impulseLength.store (newEngine != nullptr ? newEngine->getImpulseLength() : 0);
+
+    {
+        const SpinLock::ScopedLockType sl (engineLock);
+        std::swap (engine, newEngine);
+    }
+
+    // the old engine, and its tail thread, go here rather than on the audio thread
+    newEngine.reset();
+}
+
+void ConvolutionProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (2, 2, sampleRate, maximumExpectedSamplesPerBlock);
+    const bool changed = sampleRate != preparedRate || maximumExpectedSamplesPerBlock != preparedBlockSize;
+    preparedRate = sampleRate;
+    preparedBlockSize = jmax (1, maximumExpectedSamplesPerBlock);
+    dryBuffer.setSize (2, preparedBlockSize, false, false, true);
+
+    prepareSmoothedParameters (sampleRate, preparedBlockSize);
+
+    if (changed || engine == nullptr)
+        buildEngine();
+    else
+        engine->reset();
+}
+
+void ConvolutionProcessor::releaseResources() { }
+
+void ConvolutionProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    const int numChannels = jmin (2, buffer.getNumChannels());
+    const float* const wet = wetGain.process (buffer.getNumSamples());
+    const float* const dry = dryGain.process (buffer.getNumSamples());
+
+    const SpinLock::ScopedLockType sl (engineLock);
+
+    for (int offset = 0; offset < buffer.getNumSamples();)
+    {
+        const int numSamples = jmin (buffer.getNumSamples() - offset, dryBuffer.getNumSamples());
+        float* channels[2] = { buffer.getWritePointer (0, offset), nullptr };
+        if (numChannels > 1)
+            channels[1] = buffer.getWritePointer (1, offset);
+
+        for (int c = 0; c < numChannels; ++c)
+            dryBuffer.copyFrom (c, 0, channels[c], numSamples);
+
+        if (engine != nullptr)
+            engine->process (channels, numChannels, numSamples);
+        else
+            for (int c = 0; c < numChannels; ++c)
+                FloatVectorOperations::clear (channels[c], numSamples);
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            if (wetGain.isSmoothing())
+                FloatVectorOperations::multiply (channels[c], wet + offset, numSamples);
+            else if (wetGain.getCurrentValue() != 1.f)
+                FloatVectorOperations::multiply (channels[c], wetGain.getCurrentValue(), numSamples);
+
+            if (dryGain.isSmoothing())
+                FloatVectorOperations::addWithMultiply (channels[c], dryBuffer.getReadPointer (c), dry + offset, numSamples);
+            else if (dryGain.getCurrentValue() != 0.f)
+                FloatVectorOperations::addWithMultiply (channels[c], dryBuffer.getReadPointer (c),
+                                                        dryGain.getCurrentValue(), numSamples);
+        }
+
+        offset += numSamples;
+    }
+}
+
+AudioProcessorEditor* ConvolutionProcessor::createEditor() { return new ConvolutionNodeEditor (*this); }
+
+void ConvolutionProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("impulse",  impulseFile.getFullPathName(), nullptr);
+    state.setProperty ("wetLevel", (float) *wetLevel, nullptr);
+    state.setProperty ("dryLevel", (float) *dryLevel, nullptr);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void ConvolutionProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (state.isValid())
+        {
+            *wetLevel = (float) state.getProperty ("wetLevel", (float) *wetLevel);
+            *dryLevel = (float) state.getProperty ("dryLevel", (float) *dryLevel);
+            resetSmoothedParameters();
+
+            const auto path = state.getProperty ("impulse").toString();
+            if (File::isAbsolutePath (path) && File (path).existsAsFile())
+                loadImpulse (File (path));
+            else
+                clearImpulse();
+        }
+    }
+}
+
+}
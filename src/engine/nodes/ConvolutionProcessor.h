@@ -0,0 +1,111 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/AudioCache.h"
+#include "engine/Convolver.h"
+
+namespace Element {
+
+/** Convolves stereo audio with an impulse response file.
+
+    Files are decoded through the AudioCache, so cabinets and rooms used by
+    several nodes are only held once, and resampled to the engine's rate
+    when they differ. The Convolver keeps the long tail of a response off the
+    audio thread without adding latency.
+ */
+class ConvolutionProcessor : public BaseProcessor,
+                             public ChangeBroadcaster
+{
+public:
+    /** Longest impulse response that will be loaded, in seconds at 48 kHz */
+    enum { maxImpulseSeconds = 20 };
+
+    ConvolutionProcessor();
+    ~ConvolutionProcessor();
+
+    const String getName() const override { return "Convolution"; }
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    /** Loads an impulse response, on the message thread. Returns false and
+        keeps the current one if the file can't be decoded */
+    bool loadImpulse (const File& file);
+    
+    /** Removes the impulse response. The wet signal is silent without one */
+    void clearImpulse();
+
+    /** Returns the impulse response file, if one is loaded */
+    File getImpulseFile() const { return impulseFile; }
+
+    /** Returns the length of the impulse response at the current rate */
+    int getImpulseLength() const;
+
+    /** Returns the file types impulse responses can be loaded from */
+    String getWildcard() const { return formats.getWildcardForAllFormats(); }
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override                 { return true; }
+
+    double getTailLengthSeconds() const override;
+    int64 getMemoryBytes() const override;
+    bool canPrepareConcurrently() const override    { return true; }
+    bool acceptsMidi() const override               { return false; }
+    bool producesMidi() const override              { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 0; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Default"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+private:
+    AudioParameterFloat* wetLevel = nullptr;
+    AudioParameterFloat* dryLevel = nullptr;
+    SmoothedParameter wetGain, dryGain;
+
+    SharedResourcePointer<AudioCache> cache;
+    AudioFormatManager formats;
+    File impulseFile;
+    AudioCache::Entry::Ptr impulse;
+
+    // only held to swap the engine, which the audio thread then uses alone
+    SpinLock engineLock;
+    std::unique_ptr<Convolver> engine;
+    std::atomic<int> impulseLength { 0 };
+
+    AudioBuffer<float> dryBuffer;
+    double preparedRate = 44100.0;
+    int preparedBlockSize = 512;
+
+    void buildEngine();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionProcessor)
+};
+
+}
@@ -0,0 +1,156 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "engine/nodes/Crossover.h"
+
+namespace Element {
+
+Crossover::Crossover() { }
+Crossover::~Crossover() { }
+
+float Crossover::getSectionQ (Slope forSlope, int section)
+{
+    // Butterworth 2nd and 4th order section Qs
+    if (forSlope == LR8)
+        return (section % 2) == 0 ? 0.54119610f : 1.30656296f;
+    return 0.70710678f;
+}
+
+void Crossover::prepare (double newSampleRate, int newNumBands)
+{
+    sampleRate = newSampleRate;
+    numBands = jlimit (1, (int) maxBands, newNumBands);
+
+    splits.clear();
+    for (int i = 0; i < numBands - 1; ++i)
+    {
+        auto* split = splits.add (new Split());
+        // split i leaves bands 0 to i - 1 below it
+        for (int n = 0; n < i * maxSections / 2; ++n)
+            split->allPasses.add (new EQFilter());
+    }
+
+    setupFilters();
+}
+
+void Crossover::setSlope (Slope newSlope)
+{
+    if (slope == newSlope)
+        return;
+    slope = newSlope;
+    setupFilters();
+}
+
+void Crossover::setFrequency (int index, float frequency)
+{
+    if (isPositiveAndBelow (index, (int) maxBands - 1))
+        frequencies[index] = frequency;
+
+    if (auto* split = splits [index])
+    {
+        for (auto& filter : split->lowPass)
+            filter.setFrequency (frequency);
+        for (auto& filter : split->highPass)
+            filter.setFrequency (frequency);
+        for (auto* filter : split->allPasses)
+            filter->setFrequency (frequency);
+    }
+}
+
+void Crossover::setupFilters()
+{
+    auto setup = [this] (EQFilter& filter, EQFilter::Shape shape, float frequency, float Q)
+    {
+        filter.setFrequency (frequency);
+        filter.setQ (Q);
+        filter.setGain (1.0f);
+        filter.setShape (shape);
+        filter.reset (sampleRate);
+    };
+
+    for (int i = 0; i < splits.size(); ++i)
+    {
+        auto* split = splits.getUnchecked (i);
+        const auto frequency = frequencies[i];
+
+        for (int s = 0; s < maxSections; ++s)
+        {
+            setup (split->lowPass[s],  EQFilter::LowPass,  frequency, getSectionQ (slope, s));
+            setup (split->highPass[s], EQFilter::HighPass, frequency, getSectionQ (slope, s));
+        }
+
+        for (int n = 0; n < split->allPasses.size(); ++n)
+            setup (*split->allPasses.getUnchecked (n), EQFilter::AllPass,
+                   frequency, getSectionQ (slope, n % (maxSections / 2)));
+    }
+}
+
+void Crossover::reset()
+{
+    for (auto* split : splits)
+    {
+        for (auto& filter : split->lowPass)
+            filter.reset (sampleRate);
+        for (auto& filter : split->highPass)
+            filter.reset (sampleRate);
+        for (auto* filter : split->allPasses)
+            filter->reset (sampleRate);
+    }
+}
+
+void Crossover::process (const float* const* input, int numChannels,
+                         float* const* const* bands, int numSamples)
+{
+    numChannels = jmin (numChannels, (int) maxChannels);
+    if (numBands <= 0 || numChannels <= 0)
+        return;
+
+    // what's left above each split runs through the top band's channels,
+    // copied first as the input may be the bottom band
+    float* const* rest = bands [numBands - 1];
+    for (int c = 0; c < numChannels; ++c)
+        if (rest[c] != input[c])
+            FloatVectorOperations::copy (rest[c], input[c], numSamples);
+
+    const int numSections = getNumSections();
+    const int numAllPasses = getNumAllPasses();
+
+    for (int i = 0; i < splits.size(); ++i)
+    {
+        auto* split = splits.getUnchecked (i);
+
+        // bands below are phase matched to this split
+        for (int band = 0; band < i; ++band)
+            for (int n = 0; n < numAllPasses; ++n)
+                split->allPasses.getUnchecked (band * (maxSections / 2) + n)
+                    ->processBlock (bands[band], numChannels, numSamples);
+
+        for (int c = 0; c < numChannels; ++c)
+            FloatVectorOperations::copy (bands[i][c], rest[c], numSamples);
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            split->lowPass[s].processBlock (bands[i], numChannels, numSamples);
+            split->highPass[s].processBlock (rest, numChannels, numSamples);
+        }
+    }
+}
+
+}
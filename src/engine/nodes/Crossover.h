@@ -0,0 +1,103 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "engine/nodes/EQFilterProcessor.h"
+
+namespace Element {
+
+/** A Linkwitz-Riley crossover splitting a signal into any number of bands.
+
+    Bands are split off from the bottom up. Each crossover is a cascade of
+    Butterworth sections, so every band gets all-pass compensation for the
+    crossovers above it and the bands sum back to a flat, all-passed
+    signal. All channels of a section are filtered together in SIMD lanes
+    and frequency changes are smoothed by the sections. Being IIR, the
+    crossover adds no latency.
+ */
+class Crossover
+{
+public:
+    enum Slope
+    {
+        LR4 = 0,    // 24 dB per octave
+        LR8         // 48 dB per octave
+    };
+
+    static constexpr int maxBands    = 8;
+    static constexpr int maxChannels = EQFilter::maxChannels;
+
+    Crossover();
+    ~Crossover();
+
+    /** Sets up the filters for a number of bands. Not realtime safe */
+    void prepare (double sampleRate, int numBands);
+
+    /** Returns the number of bands */
+    int getNumBands() const noexcept { return numBands; }
+
+    /** Changes the slope. This clears the filters, so it clicks if done
+        while playing */
+    void setSlope (Slope newSlope);
+    Slope getSlope() const noexcept { return slope; }
+
+    /** Sets the frequency of a crossover, between band index and the one
+        above it */
+    void setFrequency (int index, float frequency);
+
+    /** Always zero, the filters are minimum phase */
+    int getLatencySamples() const noexcept { return 0; }
+
+    /** Splits input into bands, each an array of numChannels channels. The
+        input may be the first band's channels, but no other band's */
+    void process (const float* const* input, int numChannels,
+                  float* const* const* bands, int numSamples);
+
+    /** Clears the filters */
+    void reset();
+
+private:
+    // both LR8 halves are a pair of 4th order Butterworths
+    static constexpr int maxSections = 4;
+
+    struct Split
+    {
+        EQFilter lowPass [maxSections];
+        EQFilter highPass [maxSections];
+        // all-passes for every band below this split
+        OwnedArray<EQFilter> allPasses;
+    };
+
+    OwnedArray<Split> splits;
+    float frequencies [maxBands - 1] = { 1000.0f, 1000.0f, 1000.0f, 1000.0f, 1000.0f, 1000.0f, 1000.0f };
+    double sampleRate = 44100.0;
+    int numBands = 0;
+    Slope slope = LR4;
+
+    int getNumSections() const noexcept     { return slope == LR8 ? 4 : 2; }
+    int getNumAllPasses() const noexcept    { return slope == LR8 ? 2 : 1; }
+    static float getSectionQ (Slope forSlope, int section);
+    void setupFilters();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Crossover)
+};
+
+}
@@ -24,10 +24,18 @@
 
 namespace Element {
 
-/* Filter for a single EQ band */
+/* Filter for a single EQ band, on as many as maxChannels channels.
+
+   Coefficients are shared by every channel and, while a parameter is
+   smoothing, worked out once every coefInterval samples instead of every
+   sample. Channels are filtered together, one per lane of a SIMD register.
+*/
 class EQFilter
 {
 public:
+    static constexpr int maxChannels = 8;
+    static constexpr int coefInterval = 16;
+
     enum Shape
     {
         Bell,
@@ -36,6 +44,7 @@ public:
         LowShelf,
         HighPass,
         LowPass,
+        AllPass,
     };
     
     EQFilter()
@@ -97,6 +106,10 @@ public:
             calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsHighPass (fc, Q, gain); };
             break;
 
+        case AllPass:
+            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsAllPass (fc, Q, gain); };
+            break;
+
         default:
             return;
         }
@@ -211,32 +224,69 @@ public:
         a[2] = (phi - K + 1.0f) / a0;
     }
 
-    inline float process (float x)
+    void calcCoefsAllPass (float newFreq, float newQ, float newGain)
+    {
+        float wc = MathConstants<float>::twoPi * newFreq / fs;
+        float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
+        float phi = c * c;
+        float K = c / newQ;
+        float a0 = phi + K + 1.0f;
+
+        b[0] = newGain * (phi - K + 1.0f) / a0;
+        b[1] = newGain * 2.0f * (1.0f - phi) / a0;
+        b[2] = newGain;
+        a[1] = 2.0f * (1.0f - phi) / a0;
+        a[2] = (phi - K + 1.0f) / a0;
+    }
+
+    inline float process (float x, int channel = 0)
     {
         // process input sample, direct form II transposed
-        float y = z[1] + x * b[0];
+        auto* zc = z[channel];
+        float y = zc[1] + x * b[0];
 
-        z[1] = z[2] + x*b[1] - y*a[1];
-        z[2] = x*b[2] - y*a[2];
+        zc[1] = zc[2] + x*b[1] - y*a[1];
+        zc[2] = x*b[2] - y*a[2];
 
         return y;
     }
 
     void processBlock (float* buffer, int numSamples)
     {
-        for (int n = 0; n < numSamples; n++)
+        processBlock (&buffer, 1, numSamples);
+    }
+
+    void processBlock (float* const* channels, int numChannels, int numSamples)
+    {
+        numChannels = jmin (numChannels, (int) maxChannels);
+        for (int start = 0; start < numSamples;)
         {
+            const int num = jmin ((int) coefInterval, numSamples - start);
             if (freq.isSmoothing() || Q.isSmoothing() || gain.isSmoothing())
-                calcCoefs (freq.getNextValue(), Q.getNextValue(), gain.getNextValue());
-            buffer[n] = process (buffer[n]);
+                calcCoefs (freq.skip (num), Q.skip (num), gain.skip (num));
+
+            if (numChannels == 1)
+            {
+                auto* data = channels[0] + start;
+                for (int n = 0; n < num; ++n)
+                    data[n] = process (data[n]);
+            }
+            else
+            {
+                for (int c = 0; c < numChannels; c += (int) Lanes::SIMDNumElements)
+                    processLanes (channels, c, jmin ((int) Lanes::SIMDNumElements, numChannels - c), start, num);
+            }
+
+            start += num;
         }
     }
 
     void reset (double sampleRate)
     {
         // clear state
-        for (int n = 0; n < 3; ++n)
-            z[n] = 0.0f;
+        for (auto& zc : z)
+            for (int n = 0; n < 3; ++n)
+                zc[n] = 0.0f;
 
         fs = (float) sampleRate;
         calcCoefs (freq.skip (smoothSteps), Q.skip (smoothSteps), gain.skip (smoothSteps));
@@ -311,11 +361,51 @@ public:
             denominator = s * s + s / Q.getTargetValue() + 1.0f;
             numerator *= gain.getTargetValue();
         }
+        else if (eqShape == AllPass)
+        {
+            return gain.getTargetValue();
+        }
 
         return abs (numerator / denominator); // |H(s)|
     }
 
 private:
+    using Lanes = dsp::SIMDRegister<float>;
+
+    /* Filters up to a register's worth of channels at once. The registers live
+       on the stack, as the filter itself might not be aligned for them */
+    void processLanes (float* const* channels, int first, int numLanes, int start, int num)
+    {
+        const auto b0 = Lanes::expand (b[0]), b1 = Lanes::expand (b[1]), b2 = Lanes::expand (b[2]);
+        const auto a1 = Lanes::expand (a[1]), a2 = Lanes::expand (a[2]);
+        auto z1 = Lanes::expand (0.0f), z2 = Lanes::expand (0.0f);
+        for (int l = 0; l < numLanes; ++l)
+        {
+            z1.set ((size_t) l, z[first + l][1]);
+            z2.set ((size_t) l, z[first + l][2]);
+        }
+
+        for (int n = start; n < start + num; ++n)
+        {
+            auto x = Lanes::expand (0.0f);
+            for (int l = 0; l < numLanes; ++l)
+                x.set ((size_t) l, channels[first + l][n]);
+
+            const auto y = z1 + x * b0;
+            z1 = z2 + x * b1 - y * a1;
+            z2 = x * b2 - y * a2;
+
+            for (int l = 0; l < numLanes; ++l)
+                channels[first + l][n] = y.get ((size_t) l);
+        }
+
+        for (int l = 0; l < numLanes; ++l)
+        {
+            z[first + l][1] = z1.get ((size_t) l);
+            z[first + l][2] = z2.get ((size_t) l);
+        }
+    }
+
     SmoothedValue<float, ValueSmoothingTypes::Linear> freq;
     SmoothedValue<float, ValueSmoothingTypes::Linear> Q;
     SmoothedValue<float, ValueSmoothingTypes::Linear> gain;
@@ -327,7 +417,7 @@ private:
 
     float b[3] = { 1.0f, 0.0f, 0.0f };
     float a[3] = { 1.0f, 0.0f, 0.0f };
-    float z[3] = { 0.0f, 0.0f, 0.0f };
+    float z[maxChannels][3] = {};
 
     float fs = 44100.0f;
 
@@ -349,12 +439,13 @@ public:
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
 
     void updateParams();
-    float getMagnitudeAtFreq (float freq) { return eqFilter[0].getMagnitudeAtFreq (freq); }
+    float getMagnitudeAtFreq (float freq) { return eqFilter.getMagnitudeAtFreq (freq); }
 
     AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override                 { return true; }
 
     double getTailLengthSeconds() const override    { return 0.0; };
+    bool silenceInProducesSilenceOut() const override { return true; }
     bool acceptsMidi() const override               { return false; }
     bool producesMidi() const override              { return false; }
 
@@ -397,7 +488,7 @@ private:
     AudioParameterFloat* q        = nullptr;
     AudioParameterFloat* gainDB   = nullptr;
     AudioParameterChoice* eqShape = nullptr;
-    EQFilter eqFilter[2];
+    EQFilter eqFilter;
 };
 
 }
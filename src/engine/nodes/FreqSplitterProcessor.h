@@ -20,21 +20,20 @@ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/nodes/Crossover.h"
 #include "ElementApp.h"
-#include "EQFilterProcessor.h"
 
 namespace Element {
+    /** Splits its input into frequency bands, one output bus each, with a
+        phase compensated Linkwitz-Riley crossover */
     class FreqSplitterProcessor : public BaseProcessor
     {
     public:
-        explicit FreqSplitterProcessor (const int _numChannels = 2)
-            : BaseProcessor (BusesProperties()
-                .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-                .withOutput ("Low", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-                .withOutput ("Mid", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-                .withOutput ("High", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))),
+        explicit FreqSplitterProcessor (const int _numChannels = 2, const int _numBands = 3)
+            : BaseProcessor (makeBuses (jlimit (1, 2, _numChannels), jlimit (2, (int) Crossover::maxBands, _numBands))),
+            numBands (jlimit (2, (int) Crossover::maxBands, _numBands)),
             numChannelsIn (jlimit (1, 2, _numChannels)),
-            numChannelsOut (3 * numChannelsIn)
+            numChannelsOut (numBands * numChannelsIn)
         {
             setBusesLayout (getBusesLayout());
             setRateAndBufferSizeDetails (44100.0, 1024);
@@ -42,8 +41,20 @@ namespace Element {
             NormalisableRange<float> freqRange (20.0f, 22000.0f);
             freqRange.setSkewForCentre (1000.0f);
 
-            addParameter (lowFreq  = new AudioParameterFloat ("lowFreq",  "Low Frequency [Hz]",  freqRange, 500.0f));
-            addParameter (highFreq = new AudioParameterFloat ("highFreq", "High Frequency [Hz]", freqRange, 2000.0f));
+            for (int i = 0; i < numBands - 1; ++i)
+            {
+                // the three band layout keeps its original low and high ids
+                const String id = i == 0 ? "lowFreq" : i == numBands - 2 ? "highFreq" : "freq" + String (i + 1);
+                const String name = i == 0 ? "Low" : i == numBands - 2 ? "High" : "Crossover " + String (i + 1);
+                const float defaultFreq = numBands == 2 ? 1000.0f
+                    : 500.0f * std::pow (4.0f, (float) i / (float) (numBands - 2));
+                auto* freq = new AudioParameterFloat (id, name + " Frequency [Hz]", freqRange, defaultFreq);
+                addParameter (freq);
+                freqs.add (freq);
+            }
+
+            addParameter (slope = new AudioParameterChoice ("slope", "Slope",
+                StringArray { "LR4 (24 dB/oct)", "LR8 (48 dB/oct)" }, 0));
         }
 
         const String getName() const override { return "Frequency Band Splitter"; }
@@ -63,28 +74,17 @@ namespace Element {
             desc.uid                = EL_INTERNAL_UID_FREQ_SPLITTER;
         }
 
+        int getNumBands() const noexcept { return numBands; }
+
         void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
         {
-            const float butterQ = 0.7071f; // maximally flat passband
-            auto setupFilter = [butterQ, sampleRate] (EQFilter& filt, float freq, EQFilter::Shape shape)
-            {
-                filt.setFrequency (freq);
-                filt.setQ (butterQ);
-                filt.setGain (1.0f);
-                filt.setShape (shape);
-                filt.reset (sampleRate);
-            };
-
-            for (int ch = 0; ch < 2; ++ch)
-            {
-                setupFilter (lowLPF[ch],  *lowFreq,  EQFilter::Shape::LowPass);
-                setupFilter (lowHPF[ch],  *lowFreq,  EQFilter::Shape::HighPass);
-                setupFilter (highLPF[ch], *highFreq, EQFilter::Shape::LowPass);
-                setupFilter (highHPF[ch], *highFreq, EQFilter::Shape::HighPass);
-            }
+            updateCrossover();
+            crossover.setSlope ((Crossover::Slope) slope->getIndex());
+            crossover.prepare (sampleRate, numBands);
 
             setBusesLayout (getBusesLayout());
             setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+            setLatencySamples (crossover.getLatencySamples());
         }
 
         void releaseResources() override
@@ -93,49 +93,28 @@ namespace Element {
 
         void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
         {
-            auto inBuffer = getBusBuffer (buffer, true, 0);
-            auto lowBuffer = getBusBuffer (buffer, false, 0);
-            auto midBuffer = getBusBuffer (buffer, false, 1);
-            auto highBuffer = getBusBuffer (buffer, false, 2);
+            const auto numChannels = getMainBusNumInputChannels();
+            auto** const channels = buffer.getArrayOfWritePointers();
 
-            const auto numChannels = inBuffer.getNumChannels();
-            const auto numSamples = buffer.getNumSamples();
-
-            // copy input into extra output channels
-            for (int ch = 0; ch < numChannels; ++ch)
-            {
-                lowBuffer.copyFrom (ch, 0, inBuffer.getReadPointer (ch), numSamples);
-                midBuffer.copyFrom (ch, 0, inBuffer.getReadPointer (ch), numSamples);
-                highBuffer.copyFrom (ch, 0, inBuffer.getReadPointer (ch), numSamples);
-            }
-
-            // update filter parameters
-            for (int c = 0; c < 2; ++c)
+            float* const* bands [Crossover::maxBands] = {};
+            for (int band = 0; band < numBands; ++band)
             {
-                lowLPF[c].setFrequency (*lowFreq);
-                lowHPF[c].setFrequency (*lowFreq);
-                highLPF[c].setFrequency (*highFreq);
-                highHPF[c].setFrequency (*highFreq);
+                const auto* bus = getBus (false, band);
+                if (bus == nullptr || bus->getNumberOfChannels() < numChannels)
+                    return;
+                bands[band] = channels + getChannelIndexInProcessBlockBuffer (false, band, 0);
             }
 
-            for (int ch = 0; ch < numChannels; ++ch)
-            {
-                // Low freq band
-                lowLPF[ch].processBlock (lowBuffer.getWritePointer (ch), numSamples);
-
-                // Mid freq band
-                lowHPF[ch].processBlock  (midBuffer.getWritePointer (ch), numSamples);
-                highLPF[ch].processBlock (midBuffer.getWritePointer (ch), numSamples);
-
-                // High freq band
-                highHPF[ch].processBlock (highBuffer.getWritePointer (ch), numSamples);
-            }
+            updateCrossover();
+            crossover.setSlope ((Crossover::Slope) slope->getIndex());
+            crossover.process (buffer.getArrayOfReadPointers(), numChannels, bands, buffer.getNumSamples());
         }
 
         AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
         bool hasEditor() const override                 { return true; }
 
         double getTailLengthSeconds() const override    { return 0.0; };
+        bool silenceInProducesSilenceOut() const override { return true; }
         bool acceptsMidi() const override               { return false; }
         bool producesMidi() const override              { return false; }
 
@@ -148,8 +127,9 @@ namespace Element {
         void getStateInformation (juce::MemoryBlock& destData) override
         {
             ValueTree state (Tags::state);
-            state.setProperty ("lowFreq",  (float) *lowFreq,  0);
-            state.setProperty ("highFreq", (float) *highFreq, 0);
+            for (auto* freq : freqs)
+                state.setProperty (freq->paramID, (float) *freq, 0);
+            state.setProperty ("slope", slope->getIndex(), 0);
             if (auto e = state.createXml())
                 AudioProcessor::copyXmlToBinary (*e, destData);
         }
@@ -161,8 +141,9 @@ namespace Element {
                 auto state = ValueTree::fromXml (*e);
                 if (state.isValid())
                 {
-                    *lowFreq  = (float) state.getProperty ("lowFreq",  (float) *lowFreq);
-                    *highFreq = (float) state.getProperty ("highFreq", (float) *highFreq);
+                    for (auto* freq : freqs)
+                        *freq = (float) state.getProperty (freq->paramID, (float) *freq);
+                    *slope = (int) state.getProperty ("slope", slope->getIndex());
                 }
             }
         }
@@ -176,12 +157,12 @@ namespace Element {
     protected:
         inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
         {
-            // supports single input bus, three output busses
-            if (layout.inputBuses.size() != 1 && layout.outputBuses.size() != 3)
+            // supports single input bus, an output bus per band
+            if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != numBands)
                 return false;
 
             // ins must equal outs
-            for (int bus = 0; bus < 3; ++bus)
+            for (int bus = 0; bus < numBands; ++bus)
             {
                 if (layout.getMainInputChannels() != layout.outputBuses[bus].size())
                     return false;
@@ -199,14 +180,38 @@ namespace Element {
         }
 
     private:
+        const int numBands;
         int numChannelsIn = 0;
         int numChannelsOut = 0;
-        AudioParameterFloat* lowFreq    = nullptr;
-        AudioParameterFloat* highFreq   = nullptr;
-        EQFilter lowLPF[2];
-        EQFilter lowHPF[2];
-        EQFilter highLPF[2];
-        EQFilter highHPF[2];
+        Array<AudioParameterFloat*> freqs;
+        AudioParameterChoice* slope = nullptr;
+        Crossover crossover;
+
+        static BusesProperties makeBuses (int numChannels, int numBands)
+        {
+            const auto set = AudioChannelSet::canonicalChannelSet (numChannels);
+            BusesProperties buses;
+            buses = buses.withInput ("Main", set);
+            for (int band = 0; band < numBands; ++band)
+            {
+                const String name = numBands == 3 ? StringArray { "Low", "Mid", "High" } [band]
+                                  : numBands == 2 ? StringArray { "Low", "High" } [band]
+                                  : "Band " + String (band + 1);
+                buses = buses.withOutput (name, set);
+            }
+            return buses;
+        }
+
+        /** Crossover frequencies can't pass each other */
+        void updateCrossover()
+        {
+            float lowest = 0.0f;
+            for (int i = 0; i < freqs.size(); ++i)
+            {
+                lowest = jmax (lowest, (float) *freqs.getUnchecked (i));
+                crossover.setFrequency (i, lowest);
+            }
+        }
     };
 
 }
@@ -25,7 +25,11 @@
 #include "engine/nodes/LuaNode.h"
 #include "engine/MidiPipe.h"
 #include "engine/Parameter.h"
+#include "engine/TimelineTrace.h"
+#include "scripting/LuaAllocator.h"
 #include "scripting/LuaBindings.h"
+#include "scripting/LuaBytecodeCache.h"
+#include "scripting/LuaDSP.h"
 
 #define EL_LUA_DBG(x)
 // #define EL_LUA_DBG(x) DBG(x)
@@ -183,6 +187,7 @@ private:
 struct LuaNode::Context
 {
     explicit Context ()
+        : state (sol::default_at_panic, LuaAllocator::allocate, &allocator)
     { 
         L = state.lua_state();
     }
@@ -196,6 +201,8 @@ struct LuaNode::Context
         inParams.clear();
         outParams.clear();
 
+        renderThread = nullptr;
+        luaL_unref (state, LUA_REGISTRYINDEX, renderThreadRef);
         luaL_unref (state, LUA_REGISTRYINDEX, renderRef);
         audioBuffer = nullptr;
         luaL_unref (state, LUA_REGISTRYINDEX, audioBufRef);
@@ -220,9 +227,14 @@ struct LuaNode::Context
                                   sol::lib::io, sol::lib::package,
                                   sol::lib::math);
             Lua::openDSP (state);
-            auto res = state.script (script.toRawUTF8());
-            
-            if (res.valid())
+            Lua::openRenderBlock (L, renderBlock);
+            SharedResourcePointer<LuaBytecodeCache> cache;
+            if (cache->load (L, script, "=LuaNode") != LUA_OK || lua_pcall (L, 0, 0, 0) != LUA_OK)
+            {
+                errorMsg = String::fromUTF8 (lua_tostring (L, -1));
+                lua_pop (L, 1);
+            }
+            else
             {
                 bool ok = false;
                 if (lua_getglobal (state, "node_render") == LUA_TFUNCTION)
@@ -244,6 +256,14 @@ struct LuaNode::Context
                     midiPipeRef = luaL_ref (state, LUA_REGISTRYINDEX);
                     ok = midiPipeRef != LUA_REFNIL && midiPipeRef != LUA_NOREF;
                 }
+
+                if (ok)
+                    ok = createRenderThread();
+
+                // from here the collector only runs in steps after each block
+                // and when the message thread is done with the state
+                state.collect_garbage();
+                lua_gc (L, LUA_GCSTOP, 0);
                 
                 loaded = ok;
             }
@@ -350,6 +370,8 @@ struct LuaNode::Context
         if (! ready())
             return;
 
+        gcTimer.prepare (rate);
+        sampleRate = rate;
         if (auto fn = state ["node_prepare"])
             fn (rate, block);
         
@@ -369,6 +391,17 @@ struct LuaNode::Context
         {
             kv_midi_pipe_resize (L, midiPipe, nmidi);
             kv_midi_pipe_clear (midiPipe, -1);
+            numPipeBuffers = nmidi;
+        }
+
+        midiEvents.calloc ((size_t) jmax (1, nmidi) * maxViewEvents);
+        midiViews.clearQuick();
+        for (int i = 0; i < nmidi; ++i)
+        {
+            Lua::MidiView view;
+            view.events = midiEvents.get() + i * maxViewEvents;
+            view.capacity = maxViewEvents;
+            midiViews.add (view);
         }
 
         state.collect_garbage();
@@ -391,6 +424,7 @@ struct LuaNode::Context
         if (midiPipe != nullptr)
         {
             kv_midi_pipe_resize (L, midiPipe, 0);
+            numPipeBuffers = 0;
         }
 
         state.collect_garbage();
@@ -398,76 +432,138 @@ struct LuaNode::Context
 
     void render (AudioSampleBuffer& audio, MidiPipe& midi) noexcept
     {
-        if (! loaded)
+        if (! loaded || renderFailed)
+            return;
+
+        // the message thread only holds this while it runs the script
+        // itself, e.g. to save state. that block passes through unprocessed
+        const SpinLock::ScopedTryLockType sl (luaLock);
+        if (! sl.isLocked())
             return;
 
         const auto nchans  = audio.getNumChannels();
         const auto nframes = audio.getNumSamples();
         const auto nmidi   = midi.getNumBuffers();
 
-        if (lua_rawgeti (L, LUA_REGISTRYINDEX, renderRef) == LUA_TFUNCTION)
+       #if ! LRT_FORCE_FLOAT32
+        kv_audio_buffer_duplicate_32 (audioBuffer,
+            audio.getArrayOfReadPointers(), nchans, nframes);
+       #else
+        kv_audio_buffer_refer_to (audioBuffer,
+            audio.getArrayOfWritePointers(), nchans, nframes);
+       #endif
+
+        if (nmidi != numPipeBuffers)
+        {
+            kv_midi_pipe_resize (L, midiPipe, nmidi);
+            numPipeBuffers = nmidi;
+        }
+
+        kv_midi_pipe_clear (midiPipe, -1);
+
+        // buffers the pipe has beyond what was prepared get no view
+        const int nviews = jmin (nmidi, midiViews.size());
+        int bytes = 0, frame = 0;
+        const uint8* data = nullptr;
+        for (int i = 0; i < nmidi; ++i)
         {
-            if (lua_rawgeti (L, LUA_REGISTRYINDEX, audioBufRef) == LUA_TUSERDATA)
+            auto* src = midi.getWriteBuffer (i);
+            auto* dst = kv_midi_pipe_get (midiPipe, i);
+            auto* view = i < nviews ? midiViews.getRawDataPointer() + i : nullptr;
+            if (view != nullptr)
+                view->reset();
+            if (src->isEmpty())
+                continue;
+            MidiBuffer::Iterator iter (*src);
+            while (iter.getNextEvent (data, bytes, frame))
             {
-                if (lua_rawgeti (L, LUA_REGISTRYINDEX, midiPipeRef) == LUA_TUSERDATA)
-                {
-                   #if ! LRT_FORCE_FLOAT32
-                    kv_audio_buffer_duplicate_32 (audioBuffer,
-                        audio.getArrayOfReadPointers(), nchans, nframes);
-                   #else
-                    kv_audio_buffer_refer_to (audioBuffer,
-                        audio.getArrayOfWritePointers(), nchans, nframes);
-                   #endif
-                
-                    kv_midi_pipe_resize (L, midiPipe, midi.getNumBuffers());
-                    kv_midi_pipe_clear (midiPipe, -1);
-                    
-                    int bytes = 0, frame = 0;
-                    const uint8* data = nullptr;
-                    for (int i = 0; i < nmidi; ++i)
-                    {
-                        auto* src = midi.getWriteBuffer (i);
-                        auto* dst = kv_midi_pipe_get (midiPipe, i);
-                        if (src->isEmpty())
-                            continue;
-                        MidiBuffer::Iterator iter (*src);
-                        while (iter.getNextEvent (data, bytes, frame))
-                            kv_midi_buffer_insert (dst, data, bytes, frame);
-                        src->clear();
-                    }
+                kv_midi_buffer_insert (dst, data, bytes, frame);
+                if (view != nullptr)
+                    view->add (data, bytes, frame);
+            }
+            src->clear();
+        }
 
-                    lua_call (L, 2, 0);
-                    
-                    for (int i = 0; i < nmidi; ++i) 
-                    {
-                        auto* src = kv_midi_pipe_get (midiPipe, i);
-                        auto* dst = midi.getWriteBuffer (i);
-                        kv_midi_buffer_foreach (src, iter)
-                        {
-                            dst->addEvent (
-                                kv_midi_buffer_iter_data (iter),
-                                kv_midi_buffer_iter_size (iter),
-                                kv_midi_buffer_iter_frame (iter)
-                            );
-                        }
-                    }
+        renderBlock.channels = const_cast<kv_sample_t* const*> (kv_audio_buffer_array (audioBuffer));
+        renderBlock.numChannels = nchans;
+        renderBlock.numFrames = nframes;
+        renderBlock.midi = midiPipe;
+        renderBlock.numMidiBuffers = nmidi;
+        renderBlock.midiViews = midiViews.getRawDataPointer();
+        renderBlock.numMidiViews = nviews;
+
+        // node_render and its arguments wait at the bottom of the render
+        // thread's stack, only copies are called
+        lua_pushvalue (renderThread, 1);
+        lua_pushvalue (renderThread, 2);
+        lua_pushvalue (renderThread, 3);
+        startBudget (nframes);
+        bool rendered = false;
+        {
+            const TimelineTrace::Zone zone ("node_render");
+            rendered = lua_pcall (renderThread, 2, 0, 0) == LUA_OK;
+        }
 
-                   #if ! LRT_FORCE_FLOAT32
-                    const kv_sample_t* const* src = kv_audio_buffer_array (audioBuffer);
-                    auto** dst = audio.getArrayOfWritePointers();
-                    for (int c = 0; c < nchans; ++c)
-                    {
-                        for (int f = 0; f < nframes; ++f)
-                            dst[c][f] = static_cast<float> (src[c][f]);
-                    }
-                   #endif
+        if (! rendered)
+        {
+            // a script that fails once stops rendering until it's reloaded,
+            // one that ran over budget is left for the node to bypass
+            DBG("[EL] node_render failed: " << lua_tostring (renderThread, -1));
+            lua_settop (renderThread, 3);
+            if (! overrun)
+                renderFailed = true;
+        }
+
+        renderBlock.clear();
+
+        stepGarbageCollector (nframes);
+
+        for (int i = 0; i < nmidi; ++i) 
+        {
+            auto* src = kv_midi_pipe_get (midiPipe, i);
+            auto* dst = midi.getWriteBuffer (i);
+            const auto* view = i < nviews ? midiViews.getRawDataPointer() + i : nullptr;
+            if (view != nullptr && view->changed)
+            {
+                // the view stands in for the first short events it holds
+                int numShort = 0;
+                kv_midi_buffer_foreach (src, iter)
+                {
+                    const auto size = (int) kv_midi_buffer_iter_size (iter);
+                    if (size <= 3 && numShort++ < view->capacity)
+                        continue;
+                    dst->addEvent (kv_midi_buffer_iter_data (iter), size,
+                                   kv_midi_buffer_iter_frame (iter));
+                }
+
+                for (int e = 0; e < view->numEvents; ++e)
+                {
+                    const auto& event = view->events[e];
+                    if (event.size > 0)
+                        dst->addEvent (event.data, event.size, jlimit (0, nframes - 1, event.frame));
                 }
+                continue;
+            }
+
+            kv_midi_buffer_foreach (src, iter)
+            {
+                dst->addEvent (
+                    kv_midi_buffer_iter_data (iter),
+                    kv_midi_buffer_iter_size (iter),
+                    kv_midi_buffer_iter_frame (iter)
+                );
             }
         }
-        else
+
+       #if ! LRT_FORCE_FLOAT32
+        const kv_sample_t* const* src = kv_audio_buffer_array (audioBuffer);
+        auto** dst = audio.getArrayOfWritePointers();
+        for (int c = 0; c < nchans; ++c)
         {
-            DBG("didn't get render fucntion in callback");
+            for (int f = 0; f < nframes; ++f)
+                dst[c][f] = static_cast<float> (src[c][f]);
         }
+       #endif
     }
     
     const OwnedArray<PortDescription>& getPortArray() const noexcept
@@ -475,6 +571,25 @@ struct LuaNode::Context
         return ports.getPorts();
     }
 
+    int getNumAudioChannels() const
+    {
+        return jmax (ports.size (kv::PortType::Audio, true), ports.size (kv::PortType::Audio, false));
+    }
+
+    int getNumMidiBuffers() const
+    {
+        return jmax (ports.size (kv::PortType::Midi, true), ports.size (kv::PortType::Midi, false));
+    }
+
+    bool hasSamePorts (const Context& other) const
+    {
+        for (const auto type : { kv::PortType::Audio, kv::PortType::Midi, kv::PortType::Control })
+            for (const bool input : { true, false })
+                if (ports.size (type, input) != other.ports.size (type, input))
+                    return false;
+        return true;
+    }
+
     void getPorts (PortList& results)
     {
         for (const auto* port : ports.getPorts())
@@ -526,6 +641,7 @@ struct LuaNode::Context
 
     void getState (MemoryBlock& block)
     {
+        const SpinLock::ScopedLockType sl (luaLock);
         sol::function save = state ["node_save"];
         if (! save.valid())
             return;
@@ -555,6 +671,7 @@ struct LuaNode::Context
 
     void setState (const void* data, size_t size)
     {
+        const SpinLock::ScopedLockType sl (luaLock);
         sol::function restore = state["node_restore"];
         if (! restore.valid())
             return;
@@ -580,12 +697,40 @@ struct LuaNode::Context
     }
 
 private:
+    // declared first so the state is closed before its memory goes
+    LuaAllocator allocator;
     sol::state state;
     lua_State* L { nullptr };
     sol::function renderf;
     std::function<void(AudioSampleBuffer&, MidiPipe&)> renderstdf;
     String name;
     bool loaded = false;
+    bool renderFailed = false;
+    SpinLock luaLock;
+    Lua::RenderBlock renderBlock;
+
+    // node_render is called on its own Lua thread, whose stack holds the
+    // function, buffer and pipe for as long as the script is loaded
+    lua_State* renderThread { nullptr };
+    int renderThreadRef = LUA_NOREF;
+    int numPipeBuffers = 0;
+
+    // kilobytes of collection work per block
+    enum { gcStepSize = 8 };
+
+    // the budget hook runs every hookInterval VM instructions
+    enum { hookInterval = 1000 };
+    std::atomic<double> budgetFraction { 0.0 };
+    std::atomic<int64> budgetInstructions { 0 };
+    int64 instructionCount = 0, maxInstructions = 0, deadline = 0;
+    bool overrun = false;
+    double sampleRate = 44100.0;
+
+    // flat copies of the short MIDI events for el.block's views
+    enum { maxViewEvents = 1024 };
+    HeapBlock<Lua::MidiEvent> midiEvents;
+    Array<Lua::MidiView> midiViews;
+    ProcessTimer gcTimer;
 
     int renderRef  = LUA_NOREF;
     int audioBufRef = LUA_NOREF;
@@ -601,6 +746,92 @@ private:
     float paramData [maxParams];
     float paramDataOut [maxParams];
 
+    /** Sets the most node_render may take per block, as a fraction of the
+        block's duration and as a count of VM instructions. Zero is no limit */
+    void setBudget (double blockFraction, int64 instructions) noexcept
+    {
+        budgetFraction.store (blockFraction);
+        budgetInstructions.store (instructions);
+    }
+
+    /** Returns true once, after node_render was stopped for going over budget */
+    bool takeOverrun() noexcept
+    {
+        const bool was = overrun;
+        overrun = false;
+        return was;
+    }
+
+    static void budgetHook (lua_State* thread, lua_Debug*)
+    {
+        auto* const ctx = *static_cast<Context**> (lua_getextraspace (thread));
+        if (ctx != nullptr && ctx->checkBudget())
+            luaL_error (thread, "node_render went over its budget");
+    }
+
+    bool checkBudget() noexcept
+    {
+        instructionCount += hookInterval;
+        if ((maxInstructions > 0 && instructionCount > maxInstructions)
+            || (deadline > 0 && Time::getHighResolutionTicks() > deadline))
+        {
+            overrun = true;
+        }
+        return overrun;
+    }
+
+    void startBudget (int nframes) noexcept
+    {
+        instructionCount = 0;
+        maxInstructions = budgetInstructions.load (std::memory_order_relaxed);
+        const auto fraction = budgetFraction.load (std::memory_order_relaxed);
+        deadline = fraction > 0.0
+            ? Time::getHighResolutionTicks() + (int64) (fraction * nframes / sampleRate
+                                                      * (double) Time::getHighResolutionTicksPerSecond())
+            : 0;
+    }
+
+    /** Runs an incremental step of the collector, a larger one when the
+        arena is getting full */
+    void stepGarbageCollector (int nframes) noexcept
+    {
+        const ProcessTimer::Scope timer (&gcTimer, nframes);
+        const auto stats = allocator.getStats();
+        const int budget = stats.inUse > stats.arenaSize - stats.arenaSize / 4
+            ? gcStepSize * 4 : gcStepSize;
+        lua_gc (L, LUA_GCSTEP, budget);
+    }
+
+    LuaNode::ScriptProfile getProfile() const noexcept
+    {
+        LuaNode::ScriptProfile profile;
+        profile.memory = allocator.getStats();
+        profile.gc = gcTimer.getReading();
+        return profile;
+    }
+
+    void resetProfile() noexcept { gcTimer.reset(); }
+
+    bool createRenderThread()
+    {
+        renderThread = lua_newthread (L);
+        renderThreadRef = luaL_ref (L, LUA_REGISTRYINDEX);
+        if (renderThread == nullptr || renderThreadRef == LUA_REFNIL || renderThreadRef == LUA_NOREF)
+            return false;
+
+        for (const int ref : { renderRef, audioBufRef, midiPipeRef })
+            lua_rawgeti (L, LUA_REGISTRYINDEX, ref);
+        lua_xmove (L, renderThread, 3);
+
+        // the hook finds the context in the thread's extra space. coroutines
+        // node_render makes inherit the hook
+        *static_cast<Context**> (lua_getextraspace (renderThread)) = this;
+        lua_sethook (renderThread, budgetHook, LUA_MASKCOUNT, hookInterval);
+        return lua_type (renderThread, 1) == LUA_TFUNCTION
+            && lua_type (renderThread, 2) == LUA_TUSERDATA
+            && lua_type (renderThread, 3) == LUA_TUSERDATA;
+    }
+
     LuaParameter* findParameter (const PortDescription& port) const
     {
         for (auto* const ip : inParams)
@@ -749,10 +980,114 @@ void LuaParameter::controlValueChanged (int index, float value)
 
 void LuaParameter::controlTouched (int, bool) {}
 
+//=============================================================================
+/** Compiles scripts one after another on a background thread and hands them
+    to the node on the message thread. The thread runs while there are
+    scripts waiting */
+class LuaNode::Compiler : private Thread,
+                          private AsyncUpdater
+{
+public:
+    struct Job
+    {
+        String script;
+        bool prepared = false;
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        bool migrateState = false;
+        bool crossfade = false;
+        std::function<void (const Result&)> callback;
+        Result result { Result::ok() };
+        std::unique_ptr<Context> context;
+    };
+
+    explicit Compiler (LuaNode& n) : Thread ("el.luaCompiler"), node (n) { }
+
+    ~Compiler()
+    {
+        signalThreadShouldExit();
+        waitForThreadToExit (-1);
+        cancelPendingUpdate();
+    }
+
+    void compile (Job* job)
+    {
+        bool start = false;
+        {
+            const ScopedLock sl (lock);
+            pending.add (job);
+            start = ! running;
+            running = true;
+        }
+
+        if (start)
+        {
+            // a run that just found nothing left may still be on its way out
+            waitForThreadToExit (-1);
+            startThread (3);
+        }
+    }
+
+    bool isCompiling() const
+    {
+        const ScopedLock sl (lock);
+        return running || finished.size() > 0;
+    }
+
+private:
+    LuaNode& node;
+    CriticalSection lock;
+    OwnedArray<Job> pending, finished;
+    bool running = false;
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            std::unique_ptr<Job> job;
+            {
+                const ScopedLock sl (lock);
+                if (pending.isEmpty())
+                    break;
+                job.reset (pending.removeAndReturn (0));
+            }
+
+            job->result = LuaNode::compile (job->script, job->context, job->prepared,
+                                            job->sampleRate, job->blockSize);
+
+            const ScopedLock sl (lock);
+            finished.add (job.release());
+            triggerAsyncUpdate();
+        }
+
+        const ScopedLock sl (lock);
+        running = false;
+    }
+
+    void handleAsyncUpdate() override
+    {
+        OwnedArray<Job> jobs;
+        {
+            const ScopedLock sl (lock);
+            jobs.swapWith (finished);
+        }
+
+        for (auto* job : jobs)
+        {
+            if (job->result.wasOk())
+                node.install (job->script, std::move (job->context), job->prepared, job->sampleRate,
+                              job->blockSize, job->migrateState, job->crossfade);
+            if (job->callback)
+                job->callback (job->result);
+        }
+    }
+};
+
 LuaNode::LuaNode() noexcept
     : GraphNode (0)
 {
     context = std::make_unique<Context>();
+    renderContext.store (context.get());
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, EL_INTERNAL_FORMAT_NAME, nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_LUA, nullptr);
@@ -761,6 +1096,8 @@ LuaNode::LuaNode() noexcept
 
 LuaNode::~LuaNode()
 {
+    compiler = nullptr;
+    renderContext.store (nullptr);
     context.reset();
 }
 
@@ -777,34 +1114,144 @@ Parameter::Ptr LuaNode::getParameter (const PortDescription& port)
     return context->getParameter (port);
 }
 
-Result LuaNode::loadScript (const String& newScript)
+Result LuaNode::compile (const String& newScript, std::unique_ptr<Context>& newContext,
+                         bool prepareContext, double rate, int block)
 {
     auto result = Context::validate (newScript);
     if (result.failed())
         return result;
-    
-    auto newContext = std::make_unique<Context>();
+
+    newContext = std::make_unique<Context>();
     result = newContext->load (newScript);
+    if (result.failed())
+    {
+        newContext.reset();
+        return result;
+    }
+
+    if (prepareContext)
+        newContext->prepare (rate, block);
+    return result;
+}
 
+void LuaNode::loadScriptAsync (const String& newScript, bool migrateState, bool crossfade,
+                               std::function<void (const Result&)> callback)
+{
+    if (compiler == nullptr)
+        compiler.reset (new Compiler (*this));
+
+    auto* job = new Compiler::Job();
+    job->script         = newScript;
+    job->prepared       = prepared;
+    job->sampleRate     = sampleRate;
+    job->blockSize      = blockSize;
+    job->migrateState   = migrateState;
+    job->crossfade      = crossfade;
+    job->callback       = callback;
+    compiler->compile (job);
+}
+
+bool LuaNode::isCompiling() const
+{
+    return compiler != nullptr && compiler->isCompiling();
+}
+
+Result LuaNode::loadScript (const String& newScript)
+{
+    std::unique_ptr<Context> newContext;
+    auto result = compile (newScript, newContext, prepared, sampleRate, blockSize);
     if (result.wasOk())
+        install (newScript, std::move (newContext), prepared, sampleRate, blockSize, false, false);
+    return result;
+}
+
+void LuaNode::install (const String& newScript, std::unique_ptr<Context> newContext,
+                       bool wasPrepared, double rate, int block,
+                       bool migrateState, bool crossfade)
+{
+    // the node may have been prepared or released while this was compiling
+    if (wasPrepared != prepared || (prepared && (rate != sampleRate || block != blockSize)))
     {
-        script = draftScript = newScript;
+        if (wasPrepared)
+            newContext->release();
         if (prepared)
             newContext->prepare (sampleRate, blockSize);
+    }
+
+    script = draftScript = newScript;
+    newContext->setBudget (budgetFraction, budgetInstructions);
+    overBudget.store (false);
+    if (isSuspended())
+        suspendProcessing (false);
+    auto* const old = context.get();
+    const bool samePorts = old != nullptr && old->hasSamePorts (*newContext);
+    if (! samePorts)
         triggerPortReset();
-        ScopedLock sl (lock);
-        if (context != nullptr)
-            newContext->copyParameterValues (*context);
-        context.swap (newContext);
+
+    if (old != nullptr)
+    {
+        newContext->copyParameterValues (*old);
+        if (migrateState)
+        {
+            MemoryBlock data;
+            old->getState (data);
+            if (data.getSize() > 0)
+                newContext->setState (data.getData(), data.getSize());
+        }
+    }
+
+    // fading needs the old script's outputs to line up with the new one's
+    const bool fade = crossfade && prepared && samePorts && old->ready();
+    if (fade)
+    {
+        const int nchans = jmax (1, newContext->getNumAudioChannels());
+        const int nmidi  = newContext->getNumMidiBuffers();
+        fadeAudio.setSize (nchans, blockSize, false, true, false);
+        fadeMidiBuffers.clearQuick (true);
+        for (int i = 0; i < nmidi; ++i)
+            fadeMidiBuffers.add (new MidiBuffer())->ensureSize (4096);
+        fadeMidi.reset (new MidiPipe (fadeMidiBuffers.getRawDataPointer(), nmidi));
+        fadeLength = jmax (1, roundToInt (sampleRate * 0.02));
+        fadeDone.store (false);
+        fadeAbort.store (false);
+        fadeContext.store (old);
     }
 
+    // publish the new context, then wait until the render thread is
+    // past any block it started with the old one before it goes
+    renderContext.store (newContext.get());
+    context.swap (newContext);
+    const auto deadline = Time::getMillisecondCounter() + 1000;
+    while (old != nullptr && renderingContext.load() == old
+        && Time::getMillisecondCounter() < deadline)
+        Thread::sleep (1);
+    jassert (renderingContext.load() != old || old == nullptr);
+
+    if (fade)
+        waitForFade (old);
+
     if (newContext != nullptr)
     {
         newContext->release();
         newContext.reset();
     }
+}
 
-    return result;
+void LuaNode::waitForFade (Context* old)
+{
+    const auto deadline = Time::getMillisecondCounter() + 1000;
+    while (! fadeDone.load() && Time::getMillisecondCounter() < deadline)
+        Thread::sleep (1);
+
+    // not picked up, so the render thread never saw it
+    if (fadeContext.exchange (nullptr) != nullptr || fadeDone.load())
+        return;
+
+    // picked up but not rendering any more: stop it, then wait out any
+    // block that has the old context in hand
+    fadeAbort.store (true);
+    while (renderingFade.load() == old)
+        Thread::sleep (1);
 }
 
 void LuaNode::fillInPluginDescription (PluginDescription& desc)
@@ -842,8 +1289,143 @@ void LuaNode::releaseResources()
 
 void LuaNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
-    ScopedLock sl (lock);
-    context->render (audio, midi);
+    // bypassed until the message thread suspends the node
+    if (overBudget.load())
+    {
+        renderBypassed (audio, midi);
+        return;
+    }
+
+    // advertise the context before using it, and use it only if it's still
+    // the published one. loadScript won't delete a context advertised here
+    auto* current = renderContext.load();
+    for (;;)
+    {
+        renderingContext.store (current);
+        auto* const latest = renderContext.load();
+        if (latest == current)
+            break;
+        current = latest;
+    }
+
+    if (fadingOut == nullptr)
+    {
+        if (auto* const next = fadeContext.exchange (nullptr))
+        {
+            // published the fade before the new context, so this block
+            // may have the old one still. take the fade up next block
+            if (next == current)
+            {
+                fadeContext.store (next);
+            }
+            else
+            {
+                fadingOut = next;
+                fadePosition = 0;
+            }
+        }
+    }
+
+    if (fadingOut != nullptr)
+    {
+        renderingFade.store (fadingOut);
+        if (fadeAbort.load() || current == nullptr)
+            finishFade();
+    }
+
+    if (fadingOut != nullptr)
+    {
+        const int nchans  = audio.getNumChannels();
+        const int nframes = audio.getNumSamples();
+        const int nmidi   = midi.getNumBuffers();
+        if (nchans > fadeAudio.getNumChannels() || nframes > fadeAudio.getNumSamples()
+            || nmidi != fadeMidiBuffers.size())
+        {
+            finishFade();
+        }
+        else
+        {
+            AudioSampleBuffer old (fadeAudio.getArrayOfWritePointers(), nchans, nframes);
+            for (int c = 0; c < nchans; ++c)
+                old.copyFrom (c, 0, audio, c, 0, nframes);
+            for (int i = 0; i < nmidi; ++i)
+            {
+                auto* const buffer = fadeMidiBuffers.getUnchecked (i);
+                buffer->clear();
+                buffer->addEvents (*midi.getReadBuffer (i), 0, nframes, 0);
+            }
+
+            fadingOut->render (old, *fadeMidi);
+            fadingOut->takeOverrun();
+            current->render (audio, midi);
+            if (current->takeOverrun())
+            {
+                finishFade();
+                renderingFade.store (nullptr);
+                renderingContext.store (nullptr);
+                exceededBudget (audio, midi);
+                return;
+            }
+
+            const float start = (float) fadePosition / (float) fadeLength;
+            fadePosition = jmin (fadeLength, fadePosition + nframes);
+            const float end = (float) fadePosition / (float) fadeLength;
+            for (int c = 0; c < nchans; ++c)
+            {
+                audio.applyGainRamp (c, 0, nframes, start, end);
+                audio.addFromWithRamp (c, 0, old.getReadPointer (c), nframes, 1.f - start, 1.f - end);
+            }
+
+            if (fadePosition >= fadeLength)
+                finishFade();
+            renderingFade.store (nullptr);
+            renderingContext.store (nullptr);
+            return;
+        }
+    }
+
+    renderingFade.store (nullptr);
+    bool overran = false;
+    if (current != nullptr)
+    {
+        current->render (audio, midi);
+        overran = current->takeOverrun();
+    }
+    renderingContext.store (nullptr);
+    if (overran)
+        exceededBudget (audio, midi);
+}
+
+void LuaNode::exceededBudget (AudioSampleBuffer& audio, MidiPipe& midi)
+{
+    // what the script left of the block is dropped
+    overBudget.store (true);
+    numOverruns.fetch_add (1);
+    renderBypassed (audio, midi);
+    overrunNotifier.triggerAsyncUpdate();
+}
+
+void LuaNode::OverrunNotifier::handleAsyncUpdate()
+{
+    node.suspendProcessing (true);
+    node.overBudget.store (false);
+    Logger::writeToLog ("[EL] Lua node \"" + node.getName()
+        + "\" went over its render budget and was bypassed");
+    node.budgetExceeded();
+}
+
+void LuaNode::setRenderBudget (double blockFraction, int64 instructions)
+{
+    budgetFraction = jmax (0.0, blockFraction);
+    budgetInstructions = jmax ((int64) 0, instructions);
+    if (context != nullptr)
+        context->setBudget (budgetFraction, budgetInstructions);
+}
+
+void LuaNode::finishFade() noexcept
+{
+    fadingOut = nullptr;
+    fadeDone.store (true);
 }
 
 void LuaNode::setState (const void* data, int size)
@@ -851,6 +1433,9 @@ void LuaNode::setState (const void* data, int size)
     const auto state = ValueTree::readFromGZIPData (data, size);
     if (state.isValid())
     {
+        if (state.hasProperty ("budget"))
+            setRenderBudget (state["budget"], state["instructions"].toString().getLargeIntValue());
+
         // May want to do this procedure async with a Message::post()
         auto result = loadScript (state["script"].toString());
 
@@ -880,7 +1465,9 @@ void LuaNode::getState (MemoryBlock& block)
 {
     ValueTree state ("LuaNodeState");
     state.setProperty ("script", script, nullptr)
-         .setProperty ("draft",  draftScript, nullptr);
+         .setProperty ("draft",  draftScript, nullptr)
+         .setProperty ("budget", budgetFraction, nullptr)
+         .setProperty ("instructions", String (budgetInstructions), nullptr);
 
     MemoryBlock scriptBlock;
     context->getParameterData (scriptBlock);
@@ -899,9 +1486,26 @@ void LuaNode::getState (MemoryBlock& block)
     }
 }
 
+LuaNode::ScriptProfile LuaNode::getScriptProfile() const
+{
+    return context != nullptr ? context->getProfile() : ScriptProfile();
+}
+
+int64 LuaNode::getContentMemoryBytes() const
+{
+    const auto memory = getScriptProfile().memory;
+    const size_t outside = memory.inUse > memory.arenaUsed ? memory.inUse - memory.arenaUsed : 0;
+    return (int64) (memory.arenaSize + outside);
+}
+
+void LuaNode::resetScriptProfile()
+{
+    if (context != nullptr)
+        context->resetProfile();
+}
+
 void LuaNode::setParameter (int index, float value)
 {
-    ScopedLock sl (lock);
     context->setParameter (index, value);
 }
 
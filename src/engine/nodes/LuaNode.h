@@ -21,6 +21,7 @@
 
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/GraphNode.h"
+#include "scripting/LuaAllocator.h"
 
 namespace Element {
 
@@ -42,8 +43,28 @@ public:
     void setState (const void* data, int size) override;
     void getState (MemoryBlock& block) override;
     
+    /** Compiles and swaps in a script, blocking until it's done */
     Result loadScript (const String&);
 
+    /** Compiles, validates and prepares a script on a background thread.
+        Once ready it's swapped in on the message thread between render
+        blocks, and the callback gets the result. Rendering carries on with
+        the old script meanwhile.
+
+        @param script       The script to load
+        @param migrateState Pass the old script's node_save data to the new
+                            script's node_restore
+        @param crossfade    Fade from the old script's output to the new one's
+                            over a few milliseconds, when both have the same ports
+        @param callback     Called on the message thread once the script is in,
+                            or failed
+    */
+    void loadScriptAsync (const String& script, bool migrateState, bool crossfade,
+                          std::function<void (const Result&)> callback = nullptr);
+
+    /** Returns true while scripts passed to loadScriptAsync are compiling */
+    bool isCompiling() const;
+
     const String& getScript() const { return script; }
     const String& getDraftScript() const { return draftScript; }
     void setDraftScript (const String& draft) { draftScript = draft; }
@@ -56,18 +77,90 @@ public:
     */
     void setParameter (int index, float value);
 
+    /** Limits how long node_render may run each block, as a fraction of the
+        block's duration, and how many VM instructions it may execute. Zero
+        turns a limit off. A script that goes over is stopped for that block
+        and the node is bypassed, which is reported through budgetExceeded
+        and the log. Un-bypassing the node or loading a script tries again */
+    void setRenderBudget (double blockFraction, int64 instructions = 0);
+
+    /** Returns the time budget as a fraction of a block */
+    double getRenderBudget() const noexcept { return budgetFraction; }
+
+    /** Returns the instruction budget */
+    int64 getInstructionBudget() const noexcept { return budgetInstructions; }
+
+    /** Returns how many times the script went over budget */
+    int getNumOverruns() const noexcept { return numOverruns.load(); }
+
+    /** Triggered on the message thread when the node is bypassed for going
+        over budget */
+    Signal<void()> budgetExceeded;
+
+    /** Memory and garbage collection figures for the loaded script */
+    struct ScriptProfile
+    {
+        LuaAllocator::Stats memory;     ///< the script's arena and allocations
+        ProcessTimer::Reading gc;       ///< time spent collecting after each block
+    };
+
+    /** Returns the loaded script's figures. GC times are always measured */
+    ScriptProfile getScriptProfile() const;
+
+    /** Clears the GC times */
+    void resetScriptProfile();
+
+    /** Returns the script's arena and what it allocated beyond it */
+    int64 getContentMemoryBytes() const override;
+
 protected:
     inline bool wantsMidiPipe() const override { return true; }
     void createPorts() override;
     Parameter::Ptr getParameter (const PortDescription& port) override;
 
 private:
+    class Compiler;
+    std::unique_ptr<Compiler> compiler;
+
+    double budgetFraction = 1.0;
+    int64 budgetInstructions = 0;
+    std::atomic<bool> overBudget { false };
+    std::atomic<int> numOverruns { 0 };
+
+    struct OverrunNotifier : public AsyncUpdater
+    {
+        OverrunNotifier (LuaNode& n) : node (n) { }
+        ~OverrunNotifier() { cancelPendingUpdate(); }
+        void handleAsyncUpdate() override;
+        LuaNode& node;
+    } overrunNotifier { *this };
+
     String script, draftScript;
     int blockSize = 512;
     double sampleRate = 44100.0;
     bool prepared = false;
-    CriticalSection lock;
     std::unique_ptr<Context> context;
+    std::atomic<Context*> renderContext { nullptr };
+    std::atomic<Context*> renderingContext { nullptr };
+
+    // the context being faded out after a swap, handed to the render thread
+    std::atomic<Context*> fadeContext { nullptr };
+    std::atomic<Context*> renderingFade { nullptr };
+    std::atomic<bool> fadeDone { true }, fadeAbort { false };
+    Context* fadingOut = nullptr;
+    int fadePosition = 0, fadeLength = 1;
+    AudioSampleBuffer fadeAudio;
+    OwnedArray<MidiBuffer> fadeMidiBuffers;
+    std::unique_ptr<MidiPipe> fadeMidi;
+
+    static Result compile (const String& script, std::unique_ptr<Context>& context,
+                           bool prepareContext, double rate, int block);
+    void install (const String& script, std::unique_ptr<Context> context,
+                  bool wasPrepared, double rate, int block,
+                  bool migrateState, bool crossfade);
+    void waitForFade (Context* old);
+    void finishFade() noexcept;
+    void exceededBudget (AudioSampleBuffer&, MidiPipe&);
     ParameterArray inParams, outParams;
 };
 
@@ -213,6 +213,7 @@ void MediaPlayerProcessor::fillInPluginDescription (PluginDescription& desc) con
 void MediaPlayerProcessor::clearPlayer()
 {
     player.setSource (nullptr);
+    resampler = nullptr;
     if (reader)
         reader = nullptr;
     *playing = player.isPlaying();
@@ -225,9 +226,12 @@ void MediaPlayerProcessor::openFile (const File& file)
     if (auto* newReader = formats.createReaderFor (file))
     {
         clearPlayer();
-        reader.reset (new AudioFormatReaderSource (newReader, true));
+        const auto sampleRate = newReader->sampleRate;
+        reader.reset (new StreamingAudioSource (new AudioFormatReaderSource (newReader, true), true,
+                                                *streamer, 1024 * 8, 2));
+        resampler.reset (new SincResamplingAudioSource (reader.get(), false, sampleRate, 2));
         audioFile = file;
-        player.setSource (reader.get(), 1024 * 8, &thread, getSampleRate(), 2);
+        player.setSource (resampler.get(), 0, nullptr, 0.0, 2);
         ScopedLock sl (getCallbackLock());        
         player.setLooping (true);
         reader->setLooping (true);
@@ -236,7 +240,6 @@ void MediaPlayerProcessor::openFile (const File& file)
 
 void MediaPlayerProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
-    thread.startThread();
     formats.registerBasicFormats();
     player.prepareToPlay (maximumExpectedSamplesPerBlock, sampleRate);
     player.setLooping (true);
@@ -249,7 +252,6 @@ void MediaPlayerProcessor::releaseResources()
     player.stop();
     player.releaseResources();
     formats.clearFormats();
-    thread.stopThread (14);
 }
 
 void MediaPlayerProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
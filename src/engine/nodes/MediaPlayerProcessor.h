@@ -20,6 +20,8 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/DiskStreamer.h"
+#include "engine/SincResampler.h"
 
 namespace Element {
 
@@ -104,8 +106,9 @@ protected:
 #endif
 
 private:
-    TimeSliceThread thread { "MediaPlayer" };
-    std::unique_ptr<AudioFormatReaderSource> reader;
+    SharedResourcePointer<DiskStreamer> streamer;
+    std::unique_ptr<StreamingAudioSource> reader;
+    std::unique_ptr<SincResamplingAudioSource> resampler;
     AudioFormatManager formats;
     AudioTransportSource player;
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "engine/nodes/MidiFilterNode.h"
+#include "engine/MidiBudget.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 
@@ -41,7 +42,11 @@ public:
     void setState (const void* data, int size) override { ignoreUnused (data, size); }
     void getState (MemoryBlock& block) override { ignoreUnused (block); }
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    void prepareToRender (double sampleRate, int maxBufferSize) override
+    {
+        ignoreUnused (sampleRate, maxBufferSize);
+        MidiBudget::reserve (tempMidi);
+    }
     void releaseResources() override { }
 
     inline void render (AudioSampleBuffer& audio, MidiPipe& midi) override
@@ -58,25 +63,38 @@ public:
             return;
         }
 
-        buffers[0] = &tempMidi;
-        for (int ch = 1; ch < 16; ++ch)
+        // channel to output, null where nothing is connected. the first
+        // output shares its buffer with the input so it's gathered aside
+        for (int ch = 0; ch < 16; ++ch)
         {
-            buffers[ch] = midi.getWriteBuffer (ch);
-            buffers[ch]->clear();
+            if (! midi.isOutputUsed (ch))
+            {
+                writers[ch] = nullptr;
+                continue;
+            }
+
+            auto* const buffer = ch == 0 ? &tempMidi : midi.getWriteBuffer (ch);
+            buffer->clear();
+            writerStorage[ch].reset (*buffer);
+            writers[ch] = &writerStorage[ch];
         }
-        
+
+        // one pass over the raw events, each copied once into its output
         MidiBuffer& input (*midi.getWriteBuffer (0));
         MidiBuffer::Iterator iter (input);
-        MidiMessage msg; int frame = 0;
-
-        while (iter.getNextEvent (msg, frame))
+        const uint8* data; int size, frame;
+        while (iter.getNextEvent (data, size, frame))
         {
-            if (msg.getChannel() <= 0)
+            if (size <= 0 || data[0] < 0x80 || data[0] >= 0xf0)
                 continue;
-            buffers[msg.getChannel() - 1]->addEvent (msg, frame);
+            if (auto* const writer = writers [data[0] & 0x0f])
+                writer->add (data, size, frame);
         }
 
-        input.swapWith (tempMidi);
+        if (writers[0] != nullptr)
+            input.swapWith (tempMidi);
+        else
+            input.clear();
         tempMidi.clear();
     }
 
@@ -98,7 +116,8 @@ public:
 protected:
     bool assertedLowChannels = false;
     bool createdPorts = false;
-    MidiBuffer* buffers [16];
+    MidiBudget::Writer* writers [16];
+    MidiBudget::Writer writerStorage [16];
     MidiBuffer tempMidi;
 
     inline void createPorts() override
@@ -26,7 +26,7 @@ namespace Element {
 class MidiDeviceEditor : public AudioProcessorEditor,
                          public ComboBox::Listener,
                          public Button::Listener,
-                         public Timer
+                         private ChangeListener
 {
 public:
     MidiDeviceEditor (MidiDeviceProcessor& p, const bool isInput)
@@ -44,12 +44,12 @@ public:
 
         setSize (240, 80);
 
-        startTimer (1000 * 2.5);
+        proc.getMidiEngine().addChangeListener (this);
     }
 
     ~MidiDeviceEditor()
     {
-        stopTimer();
+        proc.getMidiEngine().removeChangeListener (this);
         deviceBox.removeListener (this);
     }
 
@@ -64,8 +64,9 @@ public:
         stabilizeComponents();
     }
 
-    void timerCallback() override
+    void changeListenerCallback (ChangeBroadcaster*) override
     {
+        updateDevices (true);
         stabilizeComponents();
     }
 
@@ -102,7 +103,8 @@ private:
     void updateDevices (const bool resetList = true)
     {
         if (resetList)
-            devices = inputDevice ? MidiInput::getDevices() : MidiOutput::getDevices();
+            devices = inputDevice ? proc.getMidiEngine().getMidiInputDevices()
+                                  : proc.getMidiEngine().getMidiOutputDevices();
         deviceBox.clear (dontSendNotification);
         for (int i = 0; i < devices.size(); ++i)
             deviceBox.addItem (devices [i], i + 1);
@@ -116,9 +118,14 @@ MidiDeviceProcessor::MidiDeviceProcessor (const bool isInput, MidiEngine& me)
       midi (me)
 {
     setPlayConfigDetails (0, 0, 44100.0, 1024);
+    wasAvailable = isDeviceAvailable();
+    midi.addChangeListener (this);
 }
 
-MidiDeviceProcessor::~MidiDeviceProcessor() noexcept { }
+MidiDeviceProcessor::~MidiDeviceProcessor() noexcept
+{
+    midi.removeChangeListener (this);
+}
 
 void MidiDeviceProcessor::setCurrentDevice (const String& device)
 {
@@ -132,6 +139,7 @@ void MidiDeviceProcessor::setCurrentDevice (const String& device)
         releaseResources();
 
     deviceName = device;
+    wasAvailable = isDeviceAvailable();
 
     if (wasPrepared)
         prepareToPlay (rate, block);
@@ -142,7 +150,27 @@ void MidiDeviceProcessor::setCurrentDevice (const String& device)
 bool MidiDeviceProcessor::isDeviceOpen() const
 {
     ScopedLock sl (getCallbackLock());
-    return inputDevice ? deviceName.isNotEmpty() : output != nullptr;
+    return inputDevice ? deviceName.isNotEmpty() && midi.isMidiInputAvailable (deviceName)
+                       : output != nullptr && isDeviceAvailable();
+}
+
+bool MidiDeviceProcessor::isDeviceAvailable() const
+{
+    if (deviceName.isEmpty())
+        return true;
+    return inputDevice ? midi.isMidiInputAvailable (deviceName)
+                       : midi.isMidiOutputAvailable (deviceName);
+}
+
+void MidiDeviceProcessor::changeListenerCallback (ChangeBroadcaster*)
+{
+    // inputs come back through the engine by name, outputs are ours to reopen
+    const bool available = isDeviceAvailable();
+    if (available == wasAvailable)
+        return;
+    if (isOutputDevice())
+        reload();
+    wasAvailable = available;
 }
 
 void MidiDeviceProcessor::reload()
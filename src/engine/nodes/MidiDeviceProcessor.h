@@ -26,7 +26,8 @@ namespace Element {
 class MidiEngine;
 
 class MidiDeviceProcessor : public BaseProcessor,
-                            public MidiInputCallback
+                            public MidiInputCallback,
+                            private ChangeListener
 {
 public:
     explicit MidiDeviceProcessor (const bool isInput, MidiEngine&);
@@ -56,7 +57,12 @@ public:
     const String& getCurrentDevice() const { return deviceName; }
     bool isDeviceOpen() const;
 
+    /** Returns true if the device is plugged in */
+    bool isDeviceAvailable() const;
+
     void reload();
+
+    MidiEngine& getMidiEngine() const noexcept { return midi; }
     
     const String getName() const override;
     
@@ -136,6 +142,9 @@ private:
     std::unique_ptr<MidiInput> input;
     std::unique_ptr<MidiOutput> output;
     MidiMessageCollector inputMessages;
+    bool wasAvailable = false;
+
+    void changeListenerCallback (ChangeBroadcaster*) override;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiDeviceProcessor);
 };
 
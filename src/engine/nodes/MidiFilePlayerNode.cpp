@@ -0,0 +1,360 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "engine/nodes/MidiFilePlayerNode.h"
+#include "gui/LookAndFeel.h"
+
+namespace Element {
+
+//=============================================================================
+struct MidiFilePlayerNode::LoadJob : public JobService::Job
+{
+    LoadJob (MidiFilePlayerNode& n, const File& f)
+        : node (n), file (f),
+          sampleRate (n.renderSampleRate),
+          serial (++n.latestLoad)
+    { }
+
+    void run() override
+    {
+        String error;
+        events = MidiFileEvents::read (file, sampleRate, error);
+        const ScopedLock sl (node.errorLock);
+        if (serial == node.latestLoad.load())
+            node.loadError = error;
+    }
+
+    void respond() override
+    {
+        node.install (*this);
+    }
+
+    MidiFilePlayerNode& node;
+    const File file;
+    const double sampleRate;
+    const int serial;
+    MidiFileEvents::Ptr events;
+};
+
+//=============================================================================
+class MidiFilePlayerEditor : public AudioProcessorEditor,
+                             private Timer
+{
+public:
+    MidiFilePlayerEditor (MidiFilePlayerNode& o)
+        : AudioProcessorEditor (&o),
+          processor (o)
+    {
+        setOpaque (true);
+
+        addAndMakeVisible (loadButton);
+        loadButton.setButtonText ("Load...");
+        loadButton.onClick = [this]()
+        {
+            FileChooser fc ("Load MIDI File", processor.getFile(), "*.mid;*.midi;*.smf", true, false, nullptr);
+            if (fc.browseForFileToOpen())
+                processor.loadFile (fc.getResult());
+            stabilizeComponents();
+        };
+
+        addAndMakeVisible (fileTempoButton);
+        fileTempoButton.setButtonText ("File tempo");
+        fileTempoButton.setToggleState (processor.followsFileTempo(), dontSendNotification);
+        fileTempoButton.onClick = [this]() { processor.setFollowsFileTempo (fileTempoButton.getToggleState()); };
+
+        addAndMakeVisible (status);
+        status.setFont (Font (12.f));
+
+        stabilizeComponents();
+        setSize (360, 80);
+        startTimer (250);
+    }
+
+    ~MidiFilePlayerEditor() noexcept
+    {
+        stopTimer();
+        loadButton.onClick = nullptr;
+        fileTempoButton.onClick = nullptr;
+    }
+
+    void stabilizeComponents()
+    {
+        String text;
+        const auto error = processor.getLoadError();
+        if (processor.getFile() == File())
+            text << "No file";
+        else if (error.isNotEmpty())
+            text << error;
+        else
+            text << processor.getFile().getFileName() << "  "
+                 << processor.getNumTracks() << " tracks  "
+                 << processor.getNumEvents() << " events  "
+                 << RelativeTime (processor.getLengthInSeconds()).getDescription();
+        status.setText (text, dontSendNotification);
+        fileTempoButton.setToggleState (processor.followsFileTempo(), dontSendNotification);
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        auto r2 = r.removeFromTop (18);
+        loadButton.setBounds (r2.removeFromLeft (72));
+        fileTempoButton.setBounds (r2.removeFromRight (100));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    MidiFilePlayerNode& processor;
+    TextButton loadButton;
+    ToggleButton fileTempoButton;
+    Label status;
+
+    void timerCallback() override { stabilizeComponents(); }
+};
+
+//=============================================================================
+MidiFilePlayerNode::MidiFilePlayerNode()
+{
+    setPlayConfigDetails (0, 0, 44100.0, 512);
+    zeromem (sounding, sizeof (sounding));
+}
+
+MidiFilePlayerNode::~MidiFilePlayerNode()
+{
+    cancelPendingUpdate();
+}
+
+void MidiFilePlayerNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_MIDI_FILE_PLAYER;
+    desc.descriptiveName    = "Plays standard MIDI files with the transport";
+    desc.numInputChannels   = 0;
+    desc.numOutputChannels  = 0;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_MIDI_FILE_PLAYER;
+}
+
+void MidiFilePlayerNode::loadFile (const File& file)
+{
+    midiFile = file;
+
+    std::unique_ptr<LoadJob> job (new LoadJob (*this, file));
+    if (prepared && jobs.schedule (job.get()))
+    {
+        job.release();
+        return;
+    }
+
+    // nothing is rendering to hand the file to, so it's read here
+    job->run();
+    const ScopedLock sl (getCallbackLock());
+    install (*job);
+}
+
+bool MidiFilePlayerNode::waitUntilLoaded (int timeoutMs)
+{
+    return jobs.waitUntilReady (timeoutMs);
+}
+
+String MidiFilePlayerNode::getLoadError() const
+{
+    const ScopedLock sl (errorLock);
+    return loadError;
+}
+
+void MidiFilePlayerNode::setFollowsFileTempo (bool shouldFollow)
+{
+    if (fileTempo.exchange (shouldFollow) == shouldFollow)
+        return;
+    const ScopedLock sl (getCallbackLock());
+    located = false;
+}
+
+void MidiFilePlayerNode::install (LoadJob& job)
+{
+    // a newer file was asked for while this one was read
+    if (job.serial != latestLoad.load() || job.events == nullptr)
+        return;
+
+    // the file was timed for another rate, so it's read again
+    if (prepared && job.sampleRate != renderSampleRate)
+    {
+        triggerAsyncUpdate();
+        return;
+    }
+
+    // the job takes the old file with it, so it isn't freed while rendering
+    std::swap (events, job.events);
+    located = false;
+
+    numEvents.store (events->size());
+    numTracks.store (events->getNumTracks());
+    lengthInSeconds.store (events->getLengthInFrames() / events->getSampleRate());
+}
+
+void MidiFilePlayerNode::handleAsyncUpdate()
+{
+    if (midiFile != File())
+        loadFile (midiFile);
+}
+
+void MidiFilePlayerNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (0, 0, sampleRate, maximumExpectedSamplesPerBlock);
+
+    // files read while nothing was rendering
+    jobs.deliverResponses();
+    prepared = true;
+    renderSampleRate = sampleRate;
+
+    if (events != nullptr && events->getSampleRate() != sampleRate)
+        events = new MidiFileEvents (*events, sampleRate);
+    wasPlaying = located = false;
+    numSounding = 0;
+    zeromem (sounding, sizeof (sounding));
+}
+
+void MidiFilePlayerNode::releaseResources()
+{
+    prepared = false;
+    jobs.deliverResponses();
+}
+
+void MidiFilePlayerNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    AudioPlayHead::CurrentPositionInfo position;
+    if (auto* const playHead = getPlayHead())
+        playHead->getCurrentPosition (position);
+    else
+        position.resetToDefault();
+
+    const ScopedLock sl (getCallbackLock());
+    jobs.deliverResponses();
+
+    MidiBudget::Writer writer (midi);
+    render (writer, position, buffer.getNumSamples());
+}
+
+void MidiFilePlayerNode::render (MidiBudget::Writer& midi, const AudioPlayHead::CurrentPositionInfo& position,
+                                 int numSamples) noexcept
+{
+    const bool byFrame = fileTempo.load (std::memory_order_relaxed);
+    if (! position.isPlaying || events == nullptr || (! byFrame && position.bpm <= 0.0))
+    {
+        if (wasPlaying)
+            releaseAll (midi, 0);
+        wasPlaying = false;
+        return;
+    }
+
+    // positions are samples at the file's tempo, or beats at the session's
+    const double framesPerStep = byFrame ? 1.0 : renderSampleRate * 60.0 / position.bpm;
+    const double start = byFrame ? (double) position.timeInSamples : position.ppqPosition;
+    const Range<double> span (start, start + numSamples / framesPerStep);
+
+    // anything further than a sample from where the last block ended is a jump
+    const bool jumped = std::abs (span.getStart() - nextPosition) * framesPerStep >= 1.0;
+    if (wasPlaying && (jumped || ! located))
+        releaseAll (midi, 0);
+    if (! wasPlaying || jumped || ! located)
+        cursor = byFrame ? events->seekFrame (span.getStart()) : events->seekBeat (span.getStart());
+
+    for (; cursor < events->size(); ++cursor)
+    {
+        const auto& event = (*events)[cursor];
+        const double time = byFrame ? event.frame : event.beat;
+        if (time >= span.getEnd())
+            break;
+
+        const int frame = jlimit (0, numSamples - 1, (int) ((time - span.getStart()) * framesPerStep));
+        const uint8 channel = event.data[0] & 0x0f, kind = event.data[0] & 0xf0;
+        bool& isSounding = sounding [channel][event.data[1] & 127];
+        if (kind == 0x90 && event.data[2] > 0)
+        {
+            if (! isSounding)
+                ++numSounding;
+            isSounding = true;
+        }
+        else if (kind == 0x80 || kind == 0x90)
+        {
+            if (isSounding)
+                --numSounding;
+            isSounding = false;
+        }
+
+        midi.add (event.data, (int) event.size, frame);
+    }
+
+    nextPosition = span.getEnd();
+    wasPlaying = located = true;
+}
+
+void MidiFilePlayerNode::releaseAll (MidiBudget::Writer& midi, int frame) noexcept
+{
+    for (int channel = 0; channel < 16 && numSounding > 0; ++channel)
+    {
+        for (int note = 0; note < 128; ++note)
+        {
+            if (! sounding [channel][note])
+                continue;
+            const uint8 off[3] = { (uint8) (0x80 | channel), (uint8) note, 0 };
+            midi.add (off, 3, frame);
+            sounding [channel][note] = false;
+            --numSounding;
+        }
+    }
+}
+
+AudioProcessorEditor* MidiFilePlayerNode::createEditor()
+{
+    return new MidiFilePlayerEditor (*this);
+}
+
+void MidiFilePlayerNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty (Tags::file, midiFile.getFullPathName(), nullptr)
+         .setProperty ("fileTempo", fileTempo.load(), nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void MidiFilePlayerNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+
+    setFollowsFileTempo ((bool) state.getProperty ("fileTempo", true));
+    const auto path = state[Tags::file].toString();
+    if (File::isAbsolutePath (path))
+        loadFile (File (path));
+}
+
+}
@@ -0,0 +1,127 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/JobService.h"
+#include "engine/MidiBudget.h"
+#include "engine/MidiFileEvents.h"
+
+namespace Element {
+
+/** Plays a standard MIDI file with the transport.
+
+    Files are read and compiled on the job service's thread and swapped in
+    at the start of a block. Each block finds where the transport is with a
+    binary search, or carries on from where the last one ended, and copies
+    out the events that fall in it at the sample they're due. The file plays
+    at its own tempo from the transport's sample position, or follows the
+    session's tempo from its beat position. Incoming MIDI passes through.
+ */
+class MidiFilePlayerNode : public BaseProcessor,
+                           private AsyncUpdater
+{
+public:
+    MidiFilePlayerNode();
+    virtual ~MidiFilePlayerNode();
+
+    /** Opens a MIDI file. While prepared it's read on the job service's
+        thread, and the file playing carries on until it's ready */
+    void loadFile (const File& file);
+
+    /** Blocks until files asked for are waiting for the next block, or the
+        timeout passes */
+    bool waitUntilLoaded (int timeoutMs);
+
+    /** Returns the file asked for last */
+    const File& getFile() const { return midiFile; }
+
+    /** Returns why the last file couldn't be read, or nothing */
+    String getLoadError() const;
+
+    /** Plays at the file's tempo when true, otherwise at the session's */
+    void setFollowsFileTempo (bool shouldFollow);
+    bool followsFileTempo() const { return fileTempo.load(); }
+
+    /** Returns the number of events in the file playing */
+    int getNumEvents() const { return numEvents.load(); }
+
+    /** Returns the number of tracks in the file playing */
+    int getNumTracks() const { return numTracks.load(); }
+
+    /** Returns the length of the file playing, at its own tempo */
+    double getLengthInSeconds() const { return lengthInSeconds.load(); }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "MIDI File Player"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return true; }
+    bool producesMidi() const override                  { return true; }
+    bool supportsMPE() const override                   { return false; }
+    bool isMidiEffect() const override                  { return true; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+private:
+    struct LoadJob;
+    friend struct LoadJob;
+
+    MidiFileEvents::Ptr events;
+    int cursor { 0 };
+    double nextPosition { 0.0 };
+    bool wasPlaying { false }, located { false };
+    bool sounding [16][128];
+    int numSounding { 0 };
+
+    File midiFile;
+    bool prepared { false };
+    double renderSampleRate { 44100.0 };
+    std::atomic<bool> fileTempo { true };
+
+    CriticalSection errorLock;
+    String loadError;
+    std::atomic<int> numEvents { 0 }, numTracks { 0 }, latestLoad { 0 };
+    std::atomic<double> lengthInSeconds { 0.0 };
+    JobService::Client jobs;
+
+    void install (LoadJob&);
+    void render (MidiBudget::Writer& midi, const AudioPlayHead::CurrentPositionInfo& position, int numSamples) noexcept;
+    void releaseAll (MidiBudget::Writer& midi, int frame) noexcept;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiFilePlayerNode)
+};
+
+}
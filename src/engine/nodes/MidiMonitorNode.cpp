@@ -28,7 +28,6 @@ MidiMonitorNode::MidiMonitorNode()
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_MONITOR, nullptr);
-    midiTemp.ensureSize (3 * 32);
 }
 
 MidiMonitorNode::~MidiMonitorNode()
@@ -39,9 +38,7 @@ MidiMonitorNode::~MidiMonitorNode()
 
 void MidiMonitorNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    inputMessages.reset (sampleRate);
     currentSampleRate = sampleRate;
-    numSamples = 0;
     startTimerHz (refreshRateHz);
 };
 
@@ -52,61 +49,43 @@ void MidiMonitorNode::releaseResources()
 
 void MidiMonitorNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
-    auto timestamp = Time::getMillisecondCounterHiRes();
+    const auto timestamp = Time::getMillisecondCounterHiRes() * 0.001;
     const auto nframes = audio.getNumSamples();
 
     if (nframes == 0)
         return;
 
+    // never waits on the GUI, anything that doesn't fit is counted and dropped
     auto* const midiIn = midi.getWriteBuffer (0);
     MidiBuffer::Iterator iter (*midiIn);
-    MidiMessage msg;
-    int frame;
-
-    ScopedLock sl (lock);
-    while (iter.getNextEvent (msg, frame))
-    {
-        msg.setTimeStamp (timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)));
-        inputMessages.addMessageToQueue (msg);
-    }
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
 
-    numSamples += nframes;
-}
-
-void MidiMonitorNode::getMessages (MidiBuffer& destBuffer)
-{
-    ScopedLock sl (lock);
-    if (numSamples <= 0)
-        return;
-    inputMessages.removeNextBlockOfMessages (destBuffer, numSamples);
-    numSamples = 0;
+    while (iter.getNextEvent (data, size, frame))
+        if (! inputMessages.push (data, size, timestamp + static_cast<double> (frame) / currentSampleRate))
+            numDropped.fetch_add (1, std::memory_order_relaxed);
 }
 
 void MidiMonitorNode::clearMessages()
 {
     midiLog.clearQuick();
-    {
-        ScopedLock sl (lock);
-        inputMessages.reset (currentSampleRate);
-        numSamples = 0;
-    }
+    inputMessages.discard();
+    numDropped.store (0, std::memory_order_relaxed);
+    lastNumDropped = 0;
     messagesLogged();
 }
 
 void MidiMonitorNode::timerCallback()
 {
-    midiTemp.clear();
-    getMessages (midiTemp);
-    if (midiTemp.getNumEvents() <= 0)
-        return;
-
-    MidiBuffer::Iterator iter (midiTemp);
-    MidiMessage msg; int frame = 0;
+    MidiMessage msg;
+    double timestamp = 0.0;
 
-    int numLogged = 0;
+    // a bounded drain per refresh, the rest waits for the next one
+    int numRead = 0, numLogged = 0;
     String text;
-    while (iter.getNextEvent (msg, frame))
+    while (numRead < maxMessagesPerRefresh && inputMessages.pop (msg, timestamp))
     {
+        ++numRead;
         if (msg.isMidiClock())
         {
             text.clear();
@@ -128,8 +107,12 @@ void MidiMonitorNode::timerCallback()
     if (midiLog.size() > maxLoggedMessages)
         midiLog.removeRange (0, midiLog.size() - maxLoggedMessages);
 
-    if (numLogged > 0)
+    const int dropped = getNumDropped();
+    if (numLogged > 0 || dropped != lastNumDropped)
+    {
+        lastNumDropped = dropped;
         messagesLogged();
+    }
 }
 
 };
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "engine/MidiInputQueue.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
@@ -63,18 +64,22 @@ public:
     
     const StringArray& getLog() const { return midiLog; }
 
+    /** Returns how many events the audio thread couldn't queue because the
+        monitor fell behind */
+    int getNumDropped() const noexcept { return numDropped.load (std::memory_order_relaxed); }
+
 private:
     friend class MidiMonitorNodeEditor;
      Signal<void()> messagesLogged;
     double currentSampleRate = 44100.0;
-    int numSamples = 0;
-    MidiMessageCollector inputMessages;
+    MidiInputQueue inputMessages { 32768 };
+    std::atomic<int> numDropped { 0 };
+    int lastNumDropped = 0;
     bool createdPorts = false;
-    CriticalSection lock;
     
-    MidiBuffer  midiTemp;
     StringArray midiLog;
     int maxLoggedMessages { 100 };
+    int maxMessagesPerRefresh { 512 };
     float refreshRateHz { 60.0 };
 
     inline void createPorts() override
@@ -88,7 +93,6 @@ private:
         createdPorts = true;
     }
 
-    void getMessages (MidiBuffer &destBuffer);
     void timerCallback() override;
 };
 
@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "engine/MidiBudget.h"
 #include "engine/nodes/MidiProgramMapNode.h"
 
 namespace Element {
@@ -27,7 +28,8 @@ MidiProgramMapNode::MidiProgramMapNode()
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_PROGRAM_MAP, nullptr);
-    
+    publishTable();
+    tableFront = tableMiddle.exchange (tableFront) & tableIndexMask;
 }
 
 MidiProgramMapNode::~MidiProgramMapNode() { }
@@ -35,22 +37,40 @@ MidiProgramMapNode::~MidiProgramMapNode() { }
 void MidiProgramMapNode::clear()
 {
     entries.clearQuick (true);
-    ScopedLock sl (lock);
-    for (int i = 0; i < 128; ++i)
-        programMap [i] = -1;
+    publishTable();
 }
 
-void MidiProgramMapNode::prepareToRender (double sampleRate, int maxBufferSize)
+void MidiProgramMapNode::publishTable()
 {
-    ignoreUnused (sampleRate, maxBufferSize);
-    
+    auto& table = tables [tableBack];
+    for (int c = 0; c < 16; ++c)
+        for (int p = 0; p < 128; ++p)
+            table.mappings[c][p] = { (uint8) p, false, -1 };
+
+    // entries for all channels first, so single channel ones override them
+    for (int pass = 0; pass < 2; ++pass)
     {
-        ScopedLock sl (lock);
-        for (int i = 0; i < 128; ++i)
-            programMap [i] = -1;
         for (const auto* const entry : entries)
-            programMap [entry->in] = entry->out;
+        {
+            if ((pass == 0) != (entry->channel <= 0))
+                continue;
+            const Mapping mapping { (uint8) jlimit (0, 127, entry->out), true, (int16) entry->bank };
+            const int in = jlimit (0, 127, entry->in);
+            if (entry->channel <= 0)
+                for (int c = 0; c < 16; ++c)
+                    table.mappings[c][in] = mapping;
+            else
+                table.mappings[jlimit (1, 16, entry->channel) - 1][in] = mapping;
+        }
     }
+
+    tableBack = tableMiddle.exchange (tableBack | tableDirty) & tableIndexMask;
+}
+
+void MidiProgramMapNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    ignoreUnused (sampleRate);
+    tempMidi.ensureSize ((size_t) jmax (MidiBudget::getMaxBytesPerBlock(), maxBufferSize));
 }
 
 void MidiProgramMapNode::releaseResources() { }
@@ -71,38 +91,48 @@ void MidiProgramMapNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
    
     auto* const midiIn = midi.getWriteBuffer (0);
 
-    ScopedLock sl (lock);
-    MidiMessage msg; int frame = 0;
+    if ((tableMiddle.load() & tableDirty) != 0)
+        tableFront = tableMiddle.exchange (tableFront) & tableIndexMask;
+    const auto& table = tables [tableFront];
 
-    if (! toSendMidi.isEmpty())
-    {
-        MidiBuffer::Iterator iter1 (toSendMidi);
-        while (iter1.getNextEvent (msg, frame))
-            midiIn->addEvent (msg, frame);
-        toSendMidi.clear();
-    }
+    const int toSend = programToSend.exchange (-1);
+    if (toSend >= 0)
+        midiIn->addEvent (MidiMessage::programChange (jlimit (1, 16, toSend >> 8), toSend & 0x7f), 0);
 
-    MidiBuffer::Iterator iter2 (*midiIn);
+    MidiBudget::Writer writer (tempMidi);
+    MidiBuffer::Iterator iter (*midiIn);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
     int program = -1;
 
-    while (iter2.getNextEvent (msg, frame))
+    while (iter.getNextEvent (data, size, frame))
     {
-        if (msg.isProgramChange() && programMap [msg.getProgramChangeNumber()] >= 0)
+        if (size != 2 || (data[0] & 0xf0) != 0xc0)
         {
-            program = msg.getProgramChangeNumber();
-            tempMidi.addEvent (MidiMessage::programChange (
-                msg.getChannel(), programMap [msg.getProgramChangeNumber()]),
-                frame);
+            writer.add (data, size, frame);
+            continue;
         }
-        else
+
+        const int channel = data[0] & 0x0f;
+        const auto& mapping = table.mappings [channel][data[1] & 0x7f];
+        if (mapping.mapped)
+            program = data[1];
+
+        if (mapping.bank >= 0)
         {
-            tempMidi.addEvent (msg, frame);
+            const uint8 msb[3] = { (uint8) (0xb0 | channel), 0,  (uint8) ((mapping.bank >> 7) & 0x7f) };
+            const uint8 lsb[3] = { (uint8) (0xb0 | channel), 32, (uint8) (mapping.bank & 0x7f) };
+            writer.add (msb, 3, frame);
+            writer.add (lsb, 3, frame);
         }
+
+        const uint8 change[2] = { data[0], mapping.program };
+        writer.add (change, 2, frame);
     }
 
-    if (program >= 0 && program != lastProgram)
+    if (program >= 0 && program != lastProgram.load (std::memory_order_relaxed))
     {
-        lastProgram = program;
+        lastProgram.store (program, std::memory_order_relaxed);
         triggerAsyncUpdate();
     }
 
@@ -113,9 +143,7 @@ void MidiProgramMapNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 
 void MidiProgramMapNode::sendProgramChange (int program, int channel)
 {
-    const auto msg (MidiMessage::programChange (channel, program));
-    ScopedLock sl (lock);
-    toSendMidi.addEvent (msg, 0);
+    programToSend.store ((jlimit (1, 16, channel) << 8) | jlimit (0, 127, program));
 }
 
 int MidiProgramMapNode::getNumProgramEntries() const { return entries.size(); }
@@ -145,10 +173,8 @@ void MidiProgramMapNode::addProgramEntry (const String& name, int programIn, int
     entry->name = name;
     entry->in   = programIn;
     entry->out  = programOut;
+    publishTable();
     sendChangeMessage();
-
-    ScopedLock sl (lock);
-    programMap [entry->in] = entry->out;
 }
 
 void MidiProgramMapNode::editProgramEntry (int index, const String& name, int inProgram, int outProgram)
@@ -156,23 +182,39 @@ void MidiProgramMapNode::editProgramEntry (int index, const String& name, int in
     if (auto* entry = entries [index])
     {
         entry->name     = name.isNotEmpty() ? name : entry->name;
-        entry->in       = inProgram;
-        entry->out      = outProgram;
-        ScopedLock sl (lock);
-        programMap[entry->in] = entry->out;
+        entry->in       = jlimit (0, 127, inProgram);
+        entry->out      = jlimit (0, 127, outProgram);
+        publishTable();
+        sendChangeMessage();
+    }
+}
+
+void MidiProgramMapNode::setProgramEntryChannel (int index, int channel)
+{
+    if (auto* entry = entries [index])
+    {
+        entry->channel = jlimit (0, 16, channel);
+        publishTable();
+        sendChangeMessage();
+    }
+}
+
+void MidiProgramMapNode::setProgramEntryBank (int index, int bank)
+{
+    if (auto* entry = entries [index])
+    {
+        entry->bank = jlimit (-1, 16383, bank);
+        publishTable();
         sendChangeMessage();
     }
 }
 
 void MidiProgramMapNode::removeProgramEntry (int index)
 {
-    std::unique_ptr<ProgramEntry> deleter;
-    if (auto* const entry = entries [index])
+    if (entries [index] != nullptr)
     {
-        entries.remove (index, false);
-        deleter.reset (entry);
-        ScopedLock sl (lock);
-        programMap[entry->in] = -1;
+        entries.remove (index, true);
+        publishTable();
         sendChangeMessage();
     }
 }
@@ -36,6 +36,8 @@ public:
         String name;
         int in;
         int out;
+        int channel = 0;    ///< 1 to 16 to map on one channel only, 0 for all
+        int bank = -1;      ///< 14 bit bank to select before the program, -1 for none
     };
     
     MidiProgramMapNode();
@@ -69,6 +71,13 @@ public:
     void editProgramEntry (int index, const String& name, int inProgram, int outProgram);
     ProgramEntry getProgramEntry (int index) const;
 
+    /** Limits an entry to one channel, 1 to 16, or 0 for all of them.
+        Entries for a single channel win over ones for all */
+    void setProgramEntryChannel (int index, int channel);
+
+    /** Sends a 14 bit bank select, or nothing when -1, ahead of the entry's program */
+    void setProgramEntryBank (int index, int bank);
+
     inline int getWidth() const { return width; }
     inline int getHeight() const { return height; }
 
@@ -86,8 +95,7 @@ public:
 
     inline int getLastProgram() const
     {
-        ScopedLock sl (lock);
-        return lastProgram;
+        return lastProgram.load (std::memory_order_relaxed);
     }
 
     void setState (const void* data, int size) override
@@ -96,7 +104,7 @@ public:
         if (! tree.isValid())
             return;
 
-        clear();
+        entries.clearQuick (true);
 
         fontSize = jlimit (9.f, 72.f, (float) tree.getProperty ("fontSize", 15.f));
         width    = jmax (10, (int) tree.getProperty ("width", 360));
@@ -106,17 +114,14 @@ public:
         {
             const auto e = tree.getChild (i);
             auto* const entry = entries.add (new ProgramEntry());
-            entry->name = e["name"].toString();
-            entry->in   = (int) e ["in"];
-            entry->out  = (int) e ["out"];
+            entry->name     = e["name"].toString();
+            entry->in       = jlimit (0, 127, (int) e ["in"]);
+            entry->out      = jlimit (0, 127, (int) e ["out"]);
+            entry->channel  = jlimit (0, 16, (int) e.getProperty ("channel", 0));
+            entry->bank     = jlimit (-1, 16383, (int) e.getProperty ("bank", -1));
         }
         
-        {
-            ScopedLock sl (lock);
-            for (const auto* const entry : entries)
-                programMap [entry->in] = entry->out;
-        }
-
+        publishTable();
         sendChangeMessage();
     }
 
@@ -132,6 +137,10 @@ public:
             e.setProperty ("name", entry->name, nullptr)
              .setProperty ("in",   entry->in,   nullptr)
              .setProperty ("out",  entry->out,  nullptr);
+            if (entry->channel > 0)
+                e.setProperty ("channel", entry->channel, nullptr);
+            if (entry->bank >= 0)
+                e.setProperty ("bank", entry->bank, nullptr);
             tree.appendChild (e, nullptr);
         }
 
@@ -147,20 +156,42 @@ public:
     Signal<void()> lastProgramChanged;
 
 protected:
-    CriticalSection lock;
     OwnedArray<ProgramEntry> entries;
-    int programMap [128];
+
+    /** What a program change on one channel turns into */
+    struct Mapping
+    {
+        uint8 program;
+        bool mapped;
+        int16 bank;
+    };
+
+    /** Every channel and program, built whenever the entries change */
+    struct ProgramTable
+    {
+        Mapping mappings [16][128];
+    };
+
+    // triple buffered: editing fills the back, rendering reads the front
+    // and they swap through the middle
+    enum { tableIndexMask = 3, tableDirty = 4 };
+    ProgramTable tables [3];
+    std::atomic<int> tableMiddle { 1 };
+    int tableFront = 0;
+    int tableBack = 2;
+    void publishTable();
+
+    // a program change from the editor, channel << 8 | program, or -1
+    std::atomic<int> programToSend { -1 };
 
     bool assertedLowChannels = false;
     bool createdPorts = false;
-    MidiBuffer* buffers [16];
     MidiBuffer tempMidi;
-    MidiBuffer toSendMidi;
 
     int width = 360;
     int height = 540;
     float fontSize = 15.f;
-    int lastProgram = -1;
+    std::atomic<int> lastProgram { -1 };
 
     inline void createPorts() override
     {
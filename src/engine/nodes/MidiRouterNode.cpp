@@ -29,10 +29,11 @@ MidiRouterNode::MidiRouterNode (int ins, int outs)
     : GraphNode (0),
       numSources (ins),
       numDestinations (outs),
-      state (ins, outs),
-      toggles (ins, outs),
-      nextToggles (ins, outs)
+      state (ins, outs)
 {
+    for (auto& matrix : routing)
+        matrix.resize (ins, outs);
+
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_ROUTER, nullptr);
@@ -85,14 +86,7 @@ void MidiRouterNode::setMatrixState (const MatrixState& matrix)
 {
     jassert (state.sameSizeAs (matrix));
     state = matrix;
-    ToggleGrid newPatches (state);
-
-    {
-        ScopedLock sl (getLock());
-        toggles.swapWith (newPatches);
-        togglesChanged = true; // initiate the crossfade
-    }
-
+    publishRouting();
     sendChangeMessage();
 }
 
@@ -101,6 +95,19 @@ MatrixState MidiRouterNode::getMatrixState() const
     return state;
 }
 
+void MidiRouterNode::publishRouting()
+{
+    routing[routingBack].assign (state);
+    routingBack = routingMiddle.exchange (routingBack | routingDirty) & routingIndexMask;
+}
+
+void MidiRouterNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    ignoreUnused (sampleRate, maxBufferSize);
+    for (auto* const buffer : midiOuts)
+        MidiBudget::reserve (*buffer);
+}
+
 void MidiRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     jassert (midi.getNumBuffers() >= numDestinations);
@@ -109,16 +116,27 @@ void MidiRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     const auto nbuffers = midi.getNumBuffers();
     audio.clear();
 
-    ScopedLock sl (getLock());
-    for (int src = 0; src < numSources; ++src)
+    if ((routingMiddle.load() & routingDirty) != 0)
+        routingFront = routingMiddle.exchange (routingFront) & routingIndexMask;
+    const auto& matrix = routing [routingFront];
+
+    for (int dst = 0; dst < numDestinations; ++dst)
+        writers.getReference (dst).reset (*midiOuts.getUnchecked (dst));
+
+    // one pass over each input, fanning every event out to its outputs
+    for (int src = 0; src < jmin (numSources, nbuffers); ++src)
     {
-        if (src >= nbuffers)
-            break;
-        
-        const auto& rb = *midi.getReadBuffer (src);
-        for (int dst = 0; dst < numDestinations; ++dst)
-            if (toggles.get (src, dst))
-                midiOuts.getUnchecked(dst)->addEvents (rb, 0, nsamples, 0);
+        const uint64 outputs = matrix.getOutputs (src);
+        if (outputs == 0)
+            continue;
+
+        MidiBuffer::Iterator iter (*midi.getReadBuffer (src));
+        const uint8* data = nullptr;
+        int size = 0, frame = 0;
+        while (iter.getNextEvent (data, size, frame) && frame < nsamples)
+            for (int dst = 0; dst < numDestinations; ++dst)
+                if ((outputs >> dst) & 1)
+                    writers.getReference (dst).add (data, size, frame);
     }
 
     for (int i = midiOuts.size(); --i >= 0;)
@@ -151,28 +169,23 @@ void MidiRouterNode::setState (const void* data, int sizeInBytes)
 void MidiRouterNode::setWithoutLocking (int src, int dst, bool set)
 {
     jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
-    toggles.set (src, dst, set);
     state.set (src, dst, set);
+    publishRouting();
 }
 
 void MidiRouterNode::set (int src, int dst, bool patched)
 {
-    jassert (src >= 0 && src < numSources && dst >= 0 && numDestinations < 4);
-    toggles.set (src, dst, patched);
+    jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
     state.set (src, dst, patched);
+    publishRouting();
 }
 
 void MidiRouterNode::clearPatches()
 {
-    {
-        ScopedLock sl (getLock());
-        toggles.clear();
-        nextToggles.clear();
-    }
-
     for (int r = 0; r < state.getNumRows(); ++r)
         for (int c = 0; c < state.getNumColumns(); ++c)
             state.set (r, c, false);
+    publishRouting();
 }
 
 void MidiRouterNode::initMidiOuts (OwnedArray<MidiBuffer>& outs)
@@ -182,6 +195,8 @@ void MidiRouterNode::initMidiOuts (OwnedArray<MidiBuffer>& outs)
         auto* const buf = outs.add (new MidiBuffer());
         buf->ensureSize (16 * 3);
     }
+
+    writers.resize (outs.size());
 }
 
 }
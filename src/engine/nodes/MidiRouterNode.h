@@ -21,7 +21,8 @@
 
 #include "engine/GraphNode.h"
 #include "engine/LinearFade.h"
-#include "engine/ToggleGrid.h"
+#include "engine/MidiBudget.h"
+#include "engine/RoutingMatrix.h"
 #include "engine/nodes/BaseProcessor.h"
 
 namespace Element {
@@ -33,7 +34,7 @@ public:
     explicit MidiRouterNode (int ins = 4, int outs = 4);
     ~MidiRouterNode();
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override { }
 
     inline bool wantsMidiPipe() const override { return true; }
@@ -44,7 +45,6 @@ public:
     void setMatrixState (const MatrixState&);
     MatrixState getMatrixState() const;
     void setWithoutLocking (int src, int dst, bool set);
-    CriticalSection& getLock() { return lock; }
 
     int getNumPrograms() const override { return jmax (1, programs.size()); }
     int getCurrentProgram() const override { return currentProgram; }
@@ -90,7 +90,6 @@ protected:
     }
 
 private:
-    CriticalSection lock;
     const int numSources;
     const int numDestinations;
     
@@ -112,11 +111,17 @@ private:
     // used by the UI, but not the rendering
     MatrixState state;
 
-    ToggleGrid toggles;
-    ToggleGrid nextToggles;
-    bool togglesChanged { false };
+    // triple buffered: the UI fills the back, the audio thread renders the
+    // front and they swap through the middle
+    enum { routingIndexMask = 3, routingDirty = 4 };
+    RoutingMatrix routing [3];
+    std::atomic<int> routingMiddle { 1 };
+    int routingFront = 0;
+    int routingBack = 2;
+    void publishRouting();
 
     OwnedArray<MidiBuffer> midiOuts;
+    Array<MidiBudget::Writer> writers;
     void initMidiOuts (OwnedArray<MidiBuffer>& outs);
 };
 
@@ -0,0 +1,117 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/MidiSequencer.h"
+
+namespace Element {
+
+/** A node playing tracks of MIDI clips with the transport. Incoming MIDI
+    passes through */
+class MidiSequencerProcessor : public BaseProcessor
+{
+public:
+    MidiSequencerProcessor()
+        : sequence ("sequence")
+    {
+        setPlayConfigDetails (0, 0, 44100.0, 512);
+        sequencer.setSequence (sequence);
+    }
+
+    ~MidiSequencerProcessor() { }
+
+    /** Returns the tracks being played. Edit it on the message thread */
+    ValueTree getSequence() const { return sequence; }
+
+    inline const String getName() const override { return "MIDI Sequencer"; }
+    inline void fillInPluginDescription (PluginDescription& desc) const override
+    {
+        desc.name               = getName();
+        desc.fileOrIdentifier   = EL_INTERNAL_ID_MIDI_SEQUENCER;
+        desc.uid                = EL_INTERNAL_UID_MIDI_SEQUENCER;
+        desc.descriptiveName    = "Plays tracks of MIDI clips";
+        desc.numInputChannels   = 0;
+        desc.numOutputChannels  = 0;
+        desc.hasSharedContainer = false;
+        desc.isInstrument       = false;
+        desc.manufacturerName   = "Element";
+        desc.pluginFormatName   = "Element";
+        desc.version            = "1.0.0";
+    }
+
+    inline AudioProcessorEditor* createEditor() override { return nullptr; }
+    inline bool hasEditor() const override { return false; }
+
+    inline void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
+    {
+        setPlayConfigDetails (0, 0, sampleRate, maximumExpectedSamplesPerBlock);
+        sequencer.prepare (sampleRate);
+    }
+
+    inline void releaseResources() override { sequencer.release(); }
+
+    inline void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+    {
+        AudioPlayHead::CurrentPositionInfo position;
+        if (auto* const playHead = getPlayHead())
+            playHead->getCurrentPosition (position);
+        else
+            position.resetToDefault();
+
+        MidiBudget::Writer writer (midi);
+        sequencer.render (writer, position, buffer.getNumSamples());
+    }
+
+    inline double getTailLengthSeconds() const override { return 0; }
+    inline bool acceptsMidi() const override { return true; }
+    inline bool producesMidi() const override { return true; }
+    inline bool supportsMPE() const override { return false; }
+    inline bool isMidiEffect() const override  { return true; }
+
+    inline void getStateInformation (juce::MemoryBlock& destData) override
+    {
+        MemoryOutputStream stream (destData, false);
+        sequence.writeToStream (stream);
+    }
+
+    inline void setStateInformation (const void* data, int sizeInBytes) override
+    {
+        const auto tree = ValueTree::readFromData (data, (size_t) sizeInBytes);
+        if (! tree.hasType ("sequence"))
+            return;
+        sequence = tree;
+        sequencer.setSequence (sequence);
+    }
+
+    inline int getNumPrograms() override { return 1; }
+    inline int getCurrentProgram() override { return 0; }
+    inline void setCurrentProgram (int index) override { ignoreUnused (index); }
+    inline const String getProgramName (int index) override { ignoreUnused (index); return ""; }
+    inline void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+private:
+    ValueTree sequence;
+    MidiSequencer sequencer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiSequencerProcessor)
+};
+
+}
@@ -0,0 +1,391 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/NetworkAudioNodes.h"
+#include "gui/LookAndFeel.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+static const int framesPerPacketChoices[] = { 16, 32, 64, 128, 256 };
+
+//=============================================================================
+class NetworkAudioSendEditor : public AudioProcessorEditor,
+                               private Timer
+{
+public:
+    NetworkAudioSendEditor (NetworkAudioSendNode& o)
+        : AudioProcessorEditor (&o),
+          processor (o)
+    {
+        setOpaque (true);
+
+        addAndMakeVisible (host);
+        host.setTextToShowWhenEmpty ("Host", Colours::grey);
+        host.setText (processor.getHost(), false);
+        addAndMakeVisible (port);
+        port.setInputRestrictions (5, "0123456789");
+        port.setText (String (processor.getPort()), false);
+
+        addAndMakeVisible (frames);
+        for (const auto choice : framesPerPacketChoices)
+            frames.addItem (String (choice) + " frames", choice);
+        frames.setSelectedId (processor.getFramesPerPacket(), dontSendNotification);
+
+        addAndMakeVisible (timestamps);
+        timestamps.setButtonText ("Wall clock timestamps");
+        timestamps.setToggleState (processor.isStampingWallClock(), dontSendNotification);
+
+        addAndMakeVisible (status);
+        status.setFont (Font (12.f));
+
+        auto apply = [this]() { processor.setDestination (host.getText(), port.getText().getIntValue()); };
+        host.onReturnKey = host.onFocusLost = apply;
+        port.onReturnKey = port.onFocusLost = apply;
+        frames.onChange = [this]() { processor.setFramesPerPacket (frames.getSelectedId()); };
+        timestamps.onClick = [this]() { processor.setWallClockTimestamps (timestamps.getToggleState()); };
+
+        timerCallback();
+        setSize (360, 80);
+        startTimer (500);
+    }
+
+    ~NetworkAudioSendEditor() noexcept
+    {
+        stopTimer();
+        host.onReturnKey = host.onFocusLost = nullptr;
+        port.onReturnKey = port.onFocusLost = nullptr;
+        frames.onChange = nullptr;
+        timestamps.onClick = nullptr;
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        auto r2 = r.removeFromTop (20);
+        port.setBounds (r2.removeFromRight (60).withTrimmedLeft (4));
+        host.setBounds (r2);
+        r.removeFromTop (4);
+        r2 = r.removeFromTop (20);
+        frames.setBounds (r2.removeFromLeft (110));
+        timestamps.setBounds (r2.withTrimmedLeft (8));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    NetworkAudioSendNode& processor;
+    TextEditor host, port;
+    ComboBox frames;
+    ToggleButton timestamps;
+    Label status;
+
+    void timerCallback() override
+    {
+        const auto stats = processor.getStats();
+        String text;
+        text << stats.packetsSent << " packets sent";
+        if (stats.overruns > 0)
+            text << "  " << stats.overruns << " overruns";
+        if (stats.sendErrors > 0)
+            text << "  " << stats.sendErrors << " errors";
+        status.setText (text, dontSendNotification);
+    }
+};
+
+//=============================================================================
+class NetworkAudioReceiveEditor : public AudioProcessorEditor,
+                                  private Timer
+{
+public:
+    NetworkAudioReceiveEditor (NetworkAudioReceiveNode& o)
+        : AudioProcessorEditor (&o),
+          processor (o)
+    {
+        setOpaque (true);
+
+        addAndMakeVisible (port);
+        port.setInputRestrictions (5, "0123456789");
+        port.setText (String (processor.getPort()), false);
+
+        addAndMakeVisible (latency);
+        latency.setSliderStyle (Slider::LinearBar);
+        latency.setRange (0.0, 100.0, 0.5);
+        latency.setTextValueSuffix (" ms");
+        latency.setValue (processor.getLatency(), dontSendNotification);
+
+        addAndMakeVisible (status);
+        status.setFont (Font (12.f));
+        addAndMakeVisible (timing);
+        timing.setFont (Font (12.f));
+
+        auto apply = [this]() { processor.setPort (port.getText().getIntValue()); };
+        port.onReturnKey = port.onFocusLost = apply;
+        latency.onDragEnd = [this]() { processor.setLatency (latency.getValue()); };
+
+        timerCallback();
+        setSize (360, 90);
+        startTimer (500);
+    }
+
+    ~NetworkAudioReceiveEditor() noexcept
+    {
+        stopTimer();
+        port.onReturnKey = port.onFocusLost = nullptr;
+        latency.onDragEnd = nullptr;
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        auto r2 = r.removeFromTop (20);
+        port.setBounds (r2.removeFromLeft (60));
+        latency.setBounds (r2.withTrimmedLeft (4));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+        timing.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    NetworkAudioReceiveNode& processor;
+    TextEditor port;
+    Slider latency;
+    Label status, timing;
+
+    void timerCallback() override
+    {
+        const auto stats = processor.getStats();
+        String text;
+        text << (stats.isReceiving ? "Receiving" : "Waiting") << "  "
+             << stats.packetsReceived << " packets";
+        if (stats.lost + stats.late > 0)
+            text << "  " << stats.lost << " lost  " << stats.late << " late";
+        if (stats.underruns > 0)
+            text << "  " << stats.underruns << " underruns";
+        status.setText (text, dontSendNotification);
+
+        text.clear();
+        text << "Latency " << String (stats.totalMs, 1) << " ms: packet " << String (stats.packetMs, 1)
+             << ", network " << (stats.networkMs >= 0.0 ? String (stats.networkMs, 1) : String ("?"))
+             << ", buffer " << String (stats.bufferMs, 1)
+             << "  drift " << String (stats.driftPpm, 1) << " ppm";
+        timing.setText (text, dontSendNotification);
+    }
+};
+
+//=============================================================================
+NetworkAudioSendNode::NetworkAudioSendNode (int numChannels)
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 32, numChannels)), true)
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 32, numChannels)), true))
+{ }
+
+NetworkAudioSendNode::~NetworkAudioSendNode()
+{
+    sender.release();
+}
+
+void NetworkAudioSendNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_NETWORK_SEND;
+    desc.descriptiveName    = "Sends audio to another machine";
+    desc.numInputChannels   = getTotalNumInputChannels();
+    desc.numOutputChannels  = getTotalNumOutputChannels();
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_NETWORK_SEND;
+}
+
+void NetworkAudioSendNode::setFramesPerPacket (int frames)
+{
+    frames = jlimit (1, (int) NetworkAudioPacket::maxFrames, frames);
+    if (frames == framesPerPacket)
+        return;
+    framesPerPacket = frames;
+
+    if (prepared)
+    {
+        const ScopedLock sl (getCallbackLock());
+        sender.prepare (getTotalNumInputChannels(), getSampleRate(), framesPerPacket);
+    }
+}
+
+void NetworkAudioSendNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (getTotalNumInputChannels(), getTotalNumOutputChannels(),
+                          sampleRate, maximumExpectedSamplesPerBlock);
+    sender.prepare (getTotalNumInputChannels(), sampleRate, framesPerPacket);
+    prepared = true;
+}
+
+void NetworkAudioSendNode::releaseResources()
+{
+    prepared = false;
+    sender.release();
+}
+
+void NetworkAudioSendNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    ScopedLock sl (getCallbackLock());
+    sender.push (buffer.getArrayOfReadPointers(), getTotalNumInputChannels(), buffer.getNumSamples());
+    midi.clear();
+}
+
+AudioProcessorEditor* NetworkAudioSendNode::createEditor()
+{
+    return new NetworkAudioSendEditor (*this);
+}
+
+void NetworkAudioSendNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("host", getHost(), nullptr)
+         .setProperty ("port", getPort(), nullptr)
+         .setProperty ("framesPerPacket", framesPerPacket, nullptr)
+         .setProperty ("wallClock", isStampingWallClock(), nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void NetworkAudioSendNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+    setDestination (state.getProperty ("host", getHost()).toString(),
+                    (int) state.getProperty ("port", getPort()));
+    setFramesPerPacket ((int) state.getProperty ("framesPerPacket", framesPerPacket));
+    setWallClockTimestamps ((bool) state.getProperty ("wallClock", false));
+}
+
+bool NetworkAudioSendNode::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    // one bus each way, passed straight through
+    if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != 1)
+        return false;
+    return layout.getMainInputChannels() > 0
+        && layout.getMainInputChannels() <= NetworkAudioPacket::maxChannels
+        && layout.getMainInputChannels() == layout.getMainOutputChannels();
+}
+
+//=============================================================================
+NetworkAudioReceiveNode::NetworkAudioReceiveNode (int numChannels)
+    : BaseProcessor (BusesProperties()
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 32, numChannels)), true))
+{ }
+
+NetworkAudioReceiveNode::~NetworkAudioReceiveNode()
+{
+    receiver.release();
+}
+
+void NetworkAudioReceiveNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_NETWORK_RECEIVE;
+    desc.descriptiveName    = "Plays audio sent from another machine";
+    desc.numInputChannels   = 0;
+    desc.numOutputChannels  = getTotalNumOutputChannels();
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_NETWORK_RECEIVE;
+}
+
+void NetworkAudioReceiveNode::setLatency (double milliseconds)
+{
+    if (milliseconds == receiver.getLatency())
+        return;
+    receiver.setLatency (milliseconds);
+
+    if (prepared)
+    {
+        const ScopedLock sl (getCallbackLock());
+        receiver.prepare (getTotalNumOutputChannels(), getSampleRate(), getBlockSize());
+    }
+}
+
+void NetworkAudioReceiveNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (0, getTotalNumOutputChannels(), sampleRate, maximumExpectedSamplesPerBlock);
+    receiver.prepare (getTotalNumOutputChannels(), sampleRate, maximumExpectedSamplesPerBlock);
+    prepared = true;
+}
+
+void NetworkAudioReceiveNode::releaseResources()
+{
+    prepared = false;
+    receiver.release();
+}
+
+void NetworkAudioReceiveNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    ScopedLock sl (getCallbackLock());
+    receiver.pull (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+    midi.clear();
+}
+
+AudioProcessorEditor* NetworkAudioReceiveNode::createEditor()
+{
+    return new NetworkAudioReceiveEditor (*this);
+}
+
+void NetworkAudioReceiveNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("port", getPort(), nullptr)
+         .setProperty ("latency", getLatency(), nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void NetworkAudioReceiveNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+    setPort ((int) state.getProperty ("port", getPort()));
+    setLatency ((double) state.getProperty ("latency", getLatency()));
+}
+
+bool NetworkAudioReceiveNode::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    if (layout.inputBuses.size() != 0 || layout.outputBuses.size() != 1)
+        return false;
+    return layout.getMainOutputChannels() > 0
+        && layout.getMainOutputChannels() <= NetworkAudioPacket::maxChannels;
+}
+
+}
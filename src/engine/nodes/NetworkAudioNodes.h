@@ -0,0 +1,152 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/NetworkAudio.h"
+
+namespace Element {
+
+/** Sends its inputs to another machine over UDP, and passes them through.
+
+    See NetworkAudioPacket for what goes on the wire. Frames are packed on
+    the audio thread and sent from a thread of the node's own.
+ */
+class NetworkAudioSendNode : public BaseProcessor
+{
+public:
+    explicit NetworkAudioSendNode (int numChannels = 2);
+    ~NetworkAudioSendNode();
+
+    /** Sets the host and port packets are sent to */
+    void setDestination (const String& host, int port)  { sender.setDestination (host, port); }
+    String getHost() const                              { return sender.getHost(); }
+    int getPort() const                                 { return sender.getPort(); }
+
+    /** Sets how many frames each packet carries. Fewer means less delay and
+        more packets */
+    void setFramesPerPacket (int frames);
+    int getFramesPerPacket() const noexcept             { return framesPerPacket; }
+
+    /** Stamps packets with the wall clock, for receivers on hosts
+        synchronised by PTP or NTP that want to measure the network delay */
+    void setWallClockTimestamps (bool stamp)            { sender.setWallClockTimestamps (stamp); }
+    bool isStampingWallClock() const                    { return sender.isStampingWallClock(); }
+
+    NetworkAudioSender::Stats getStats() const          { return sender.getStats(); }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "Network Send"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return false; }
+    bool producesMidi() const override                  { return false; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    NetworkAudioSender sender;
+    int framesPerPacket = 64;
+    bool prepared = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NetworkAudioSendNode)
+};
+
+//=============================================================================
+/** Plays audio sent from a NetworkAudioSendNode, usually on another machine.
+
+    The jitter buffer follows the sender's sample clock, so the two can run
+    from different audio interfaces for as long as needed. Its latency is
+    set in milliseconds, on top of a packet and two blocks.
+ */
+class NetworkAudioReceiveNode : public BaseProcessor
+{
+public:
+    explicit NetworkAudioReceiveNode (int numChannels = 2);
+    ~NetworkAudioReceiveNode();
+
+    /** Sets the UDP port to listen on */
+    void setPort (int port)                             { receiver.setPort (port); }
+    int getPort() const                                 { return receiver.getPort(); }
+
+    /** Sets the milliseconds of network jitter absorbed. The buffer is
+        rebuilt, so the stream drops out briefly */
+    void setLatency (double milliseconds);
+    double getLatency() const                           { return receiver.getLatency(); }
+
+    NetworkAudioReceiver::Stats getStats() const        { return receiver.getStats(); }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "Network Receive"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return false; }
+    bool producesMidi() const override                  { return false; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    NetworkAudioReceiver receiver;
+    bool prepared = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NetworkAudioReceiveNode)
+};
+
+}
@@ -49,6 +49,7 @@ void OSCReceiverNode::setState (const void* data, int size)
     int newPortNumber = jlimit (1, 65536, (int) tree.getProperty ("portNumber", 9001));
     bool newConnected = (bool) tree.getProperty ("connected", false);
     bool newPaused = (bool) tree.getProperty ("paused", false);
+    setJitterBuffer ((double) tree.getProperty ("jitterBuffer", 0.0));
 
     if (newHostName != currentHostName || newPortNumber != currentPortNumber)
         disconnect();
@@ -70,6 +71,7 @@ void OSCReceiverNode::getState (MemoryBlock& block)
     tree.setProperty ("portNumber", currentPortNumber, nullptr);
     tree.setProperty ("connected", connected, nullptr);
     tree.setProperty ("paused", paused, nullptr);
+    tree.setProperty ("jitterBuffer", getJitterBuffer(), nullptr);
 
     MemoryOutputStream stream (block, false);
 
@@ -95,11 +97,8 @@ inline void OSCReceiverNode::createPorts()
 
 void OSCReceiverNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    if (! outputMidiMessagesInitDone) {
-        outputMidiMessages.reset (sampleRate);
-        currentSampleRate = sampleRate;
-        outputMidiMessagesInitDone = true;
-    }
+    ignoreUnused (maxBufferSize);
+    currentSampleRate = sampleRate;
 }
 
 void OSCReceiverNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
@@ -109,7 +108,8 @@ void OSCReceiverNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
         return;
     }
 
-    outputMidiMessages.removeNextBlockOfMessages ( *midi.getWriteBuffer (0), nframes );
+    outputMidiMessages.render (*midi.getWriteBuffer (0), nframes, currentSampleRate,
+                               Time::getMillisecondCounterHiRes() * 0.001);
 }
 
 /** OSCReceiver real-time callbacks */
@@ -119,17 +119,51 @@ void OSCReceiverNode::oscMessageReceived (const OSCMessage& message)
     if (paused)
         return;
 
-    auto timestamp = Time::getMillisecondCounterHiRes();
+    outputMidiMessages.push (Util::processOscToMidiMessage (message),
+                             Time::getMillisecondCounterHiRes() * 0.001);
+};
 
-    MidiMessage midiMsg = Util::processOscToMidiMessage (message);
-    midiMsg.setTimeStamp (timestamp);
+void OSCReceiverNode::oscBundleReceived (const OSCBundle& bundle)
+{
+    if (paused)
+        return;
 
-    outputMidiMessages.addMessageToQueue( midiMsg );
+    // seconds to add to the wall clock to get the high resolution clock
+    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+    scheduleBundle (bundle, now, now - Time::currentTimeMillis() * 0.001);
 };
 
-void OSCReceiverNode::oscBundleReceived(const OSCBundle& bundle)
+void OSCReceiverNode::scheduleBundle (const OSCBundle& bundle, double now, double wallClockOffset)
 {
-};
+    const auto tag = bundle.getTimeTag();
+    double time = now;
+    if (! tag.isImmediately())
+    {
+        // NTP seconds since 1900 with a 32 bit fraction
+        const uint64 raw = tag.getRawTimeTag();
+        const double seconds = (double) (raw >> 32) - 2208988800.0
+                             + (double) (raw & 0xffffffff) / 4294967296.0;
+        time = jmax (now, seconds + wallClockOffset);
+    }
+
+    for (auto& element : bundle)
+    {
+        if (element.isMessage())
+            outputMidiMessages.push (Util::processOscToMidiMessage (element.getMessage()), time);
+        else if (element.isBundle())
+            scheduleBundle (element.getBundle(), now, wallClockOffset);
+    }
+}
+
+void OSCReceiverNode::setJitterBuffer (double milliseconds)
+{
+    outputMidiMessages.setDelay (jlimit (0.0, 1000.0, milliseconds) * 0.001);
+}
+
+double OSCReceiverNode::getJitterBuffer() const
+{
+    return outputMidiMessages.getDelay() * 1000.0;
+}
 
 /** For node editor */
 
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "engine/MidiPipe.h"
+#include "engine/ScheduledMidiQueue.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
 
@@ -73,6 +74,12 @@ public:
     void setPortNumber (int port);
     void setHostName (String hostName);
 
+    /** Delays every message by the given milliseconds, so messages that
+        arrive unevenly still play evenly. Zero, the default, plays them as
+        soon as they arrive or their bundle is due */
+    void setJitterBuffer (double milliseconds);
+    double getJitterBuffer() const;
+
     void addMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback);
     void removeMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback);
 
@@ -80,9 +87,8 @@ private:
 
     /** MIDI */
     bool createdPorts = false;
-    double currentSampleRate;
-    bool outputMidiMessagesInitDone = false;
-    MidiMessageCollector outputMidiMessages;
+    double currentSampleRate = 44100.0;
+    ScheduledMidiQueue outputMidiMessages;
 
     /** OSC */
     OSCReceiver oscReceiver;
@@ -93,6 +99,7 @@ private:
 
     void oscMessageReceived(const OSCMessage& message) override;
     void oscBundleReceived(const OSCBundle& bundle) override;
+    void scheduleBundle (const OSCBundle& bundle, double now, double wallClockOffset);
 };
 
 
@@ -50,6 +50,8 @@ void OSCSenderNode::setState (const void* data, int size)
     int newPortNumber = jlimit (1, 65536, (int) tree.getProperty ("portNumber", 9001));
     bool newConnected = (bool) tree.getProperty ("connected", false);
     bool newPaused = (bool) tree.getProperty ("paused", false);
+    setMaxBundleRate ((double) tree.getProperty ("maxBundleRate", 0.0));
+    setDeduplicating ((bool) tree.getProperty ("deduplicate", false));
 
     if (newHostName != currentHostName || newPortNumber != currentPortNumber)
         disconnect();
@@ -71,6 +73,8 @@ void OSCSenderNode::getState (MemoryBlock& block)
     tree.setProperty ("portNumber", currentPortNumber, nullptr);
     tree.setProperty ("connected", connected, nullptr);
     tree.setProperty ("paused", paused, nullptr);
+    tree.setProperty ("maxBundleRate", getMaxBundleRate(), nullptr);
+    tree.setProperty ("deduplicate", isDeduplicating(), nullptr);
 
     MemoryOutputStream stream (block, false);
 
@@ -82,6 +86,9 @@ void OSCSenderNode::getState (MemoryBlock& block)
 
 void OSCSenderNode::run ()
 {
+    MidiMessage msg;
+    double time = 0.0;
+
     while (! threadShouldExit())
     {
         sem.wait();
@@ -89,37 +96,49 @@ void OSCSenderNode::run ()
         if (threadShouldExit())
             break;
 
-        /** MIDI queue -> OSC messages */
-
-        MidiBuffer messages;
-
-        midiMessageQueue.removeNextBlockOfMessages (messages, numSamples.get());
-        numSamples = 0;
+        /** MIDI queue -> OSC bundles, one per block unless rate limited */
 
-        MidiBuffer::Iterator iter1 (messages);
-        MidiMessage msg;
-        int frame;
+        pendingBundle.setDeduplicating (deduplicating.load());
+        const double rate = maxBundleRate.load();
+        const double minInterval = rate > 0.0 ? 1.0 / rate : 0.0;
 
-        ScopedLock sl (lock);
-
-        while (iter1.getNextEvent (msg, frame))
+        while (midiMessageQueue.pop (msg, time))
         {
-            OSCMessage oscMsg = Util::processMidiToOscMessage (msg);
-            oscSender.send ( oscMsg );
-
-            if (! msg.isMidiClock())
+            if (! pendingBundle.isEmpty() && time != pendingBundle.getStartTime()
+                && (time - lastBundleTime >= minInterval || pendingBundle.isFull()))
             {
-                oscMessagesToLog.push_back ( oscMsg );
+                sendPendingBundle();
             }
+
+            pendingBundle.add (msg, time);
         }
 
-        while (oscMessagesToLog.size() > (size_t) maxOscMessages)
-            oscMessagesToLog.erase ( oscMessagesToLog.begin() );
+        if (! pendingBundle.isEmpty()
+            && (Time::getMillisecondCounterHiRes() * 0.001 - lastBundleTime >= minInterval || pendingBundle.isFull()))
+        {
+            sendPendingBundle();
+        }
     }
 
     DBG("[EL] OSCSenderNode: OSC -> MIDI processing thread exited");
 }
 
+void OSCSenderNode::sendPendingBundle()
+{
+    oscSender.send (pendingBundle.createBundle());
+    lastBundleTime = pendingBundle.getStartTime();
+
+    ScopedLock sl (lock);
+    for (int i = 0; i < pendingBundle.getNumEvents(); ++i)
+        if (! pendingBundle.getEvent (i).isMidiClock())
+            oscMessagesToLog.push_back (Util::processMidiToOscMessage (pendingBundle.getEvent (i)));
+
+    while (oscMessagesToLog.size() > (size_t) maxOscMessages)
+        oscMessagesToLog.erase ( oscMessagesToLog.begin() );
+
+    pendingBundle.clear();
+}
+
 void OSCSenderNode::stop ()
 {
     if (isThreadRunning())
@@ -144,11 +163,8 @@ inline void OSCSenderNode::createPorts()
 }
 
 void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize) {
-    if (! midiMessageQueueInitDone) {
-        midiMessageQueue.reset (sampleRate);
-        currentSampleRate = sampleRate;
-        midiMessageQueueInitDone = true;
-    }
+    ignoreUnused (maxBufferSize);
+    currentSampleRate = sampleRate;
 };
 
 void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
@@ -161,18 +177,16 @@ void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
         return;
     }
 
+    // every event in the block shares its time, which is how the sender
+    // thread tells where one block's bundle ends
     MidiBuffer::Iterator iter1 (*midiIn);
-    MidiMessage msg;
-    int frame;
-    auto timestamp = Time::getMillisecondCounterHiRes();
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+    const auto timestamp = Time::getMillisecondCounterHiRes() * 0.001;
 
-    while (iter1.getNextEvent (msg, frame))
-    {
-        msg.setTimeStamp ( timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)) );
-        midiMessageQueue.addMessageToQueue ( msg );
-    }
+    while (iter1.getNextEvent (data, size, frame))
+        midiMessageQueue.push (data, size, timestamp);
 
-    numSamples += nframes;
     sem.post();
     midiIn->clear();
 }
@@ -262,4 +276,24 @@ std::vector<OSCMessage> OSCSenderNode::getOscMessages()
     return copied;
 }
 
+void OSCSenderNode::setMaxBundleRate (double bundlesPerSecond)
+{
+    maxBundleRate.store (jlimit (0.0, 1000.0, bundlesPerSecond));
+}
+
+double OSCSenderNode::getMaxBundleRate() const
+{
+    return maxBundleRate.load();
+}
+
+void OSCSenderNode::setDeduplicating (bool shouldDeduplicate)
+{
+    deduplicating.store (shouldDeduplicate);
+}
+
+bool OSCSenderNode::isDeduplicating() const
+{
+    return deduplicating.load();
+}
+
 }
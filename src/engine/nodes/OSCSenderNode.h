@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include "engine/MidiInputQueue.h"
 #include "engine/MidiPipe.h"
+#include "engine/OSCMidiCoalescer.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
 
@@ -83,6 +85,16 @@ public:
 
     std::vector<OSCMessage> getOscMessages();
 
+    /** Limits how many bundles are sent per second, zero for one per block.
+        Blocks that come too soon are merged into the next bundle */
+    void setMaxBundleRate (double bundlesPerSecond);
+    double getMaxBundleRate() const;
+
+    /** Sends only the latest value of each controller, pitch bend and
+        pressure in a bundle */
+    void setDeduplicating (bool shouldDeduplicate);
+    bool isDeduplicating() const;
+
 private:
 
     Semaphore sem;
@@ -106,12 +118,16 @@ private:
     /** GUI */
     std::vector<OSCMessage> oscMessagesToLog;
 
-    /** To be processed and sent as OSC messages */
-    MidiMessageCollector midiMessageQueue;
+    /** To be processed and sent as OSC messages, stamped with their block's time */
+    MidiInputQueue midiMessageQueue { 32768 };
+    OSCMidiCoalescer pendingBundle;
+    std::atomic<double> maxBundleRate { 0.0 };
+    std::atomic<bool> deduplicating { false };
+    double lastBundleTime = 0.0;
 
-    Atomic<int> numSamples = 0;
     double currentSampleRate = 0;
-    bool midiMessageQueueInitDone = false;
+
+    void sendPendingBundle();
 };
 
 }
@@ -30,6 +30,7 @@ namespace Element {
         AudioParameterFloat* wetLevel;
         AudioParameterFloat* dryLevel;
         AudioParameterFloat* width;
+        SmoothedParameter smoothed [5];
         
     public:
         explicit ReverbProcessor()
@@ -41,6 +42,13 @@ namespace Element {
             addParameter (wetLevel = new AudioParameterFloat ("wetLevel", "Wet Level", 0.0f, 1.0f, params.wetLevel));
             addParameter (dryLevel = new AudioParameterFloat ("dryLevel", "Dry Level", 0.0f, 1.0f, params.dryLevel));
             addParameter (width    = new AudioParameterFloat ("width",    "Width",     0.0f, 1.0f, params.width));
+
+            AudioParameterFloat* const all[] = { roomSize, damping, wetLevel, dryLevel, width };
+            for (int i = 0; i < 5; ++i)
+            {
+                smoothed[i].attach (*all[i]);
+                addSmoothedParameter (smoothed[i]);
+            }
         }
 
         virtual ~ReverbProcessor() { }
@@ -64,32 +72,33 @@ namespace Element {
         void prepareToPlay (double sampleRate, int maxBlockSize) override
         {
             setPlayConfigDetails (2, 2, sampleRate, maxBlockSize);
+            prepareSmoothedParameters (sampleRate, maxBlockSize);
             verb.reset();
             verb.setSampleRate (sampleRate);
+            updateParameters (0);
         }
         
         void releaseResources() override { }
         void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
         {
-            if (paramsChanged())
+            const int numSamples = buffer.getNumSamples();
+            bool moving = false;
+            for (auto& parameter : smoothed)
             {
-                params.roomSize = (float) *roomSize;
-                params.damping  = (float) *damping;
-                params.wetLevel = (float) *wetLevel;
-                params.dryLevel = (float) *dryLevel;
-                params.width    = (float) *width;
-                verb.setParameters (params);
+                parameter.process (numSamples);
+                moving |= parameter.isSmoothing();
             }
 
-            verb.processStereo (buffer.getWritePointer (0),
-                                buffer.getWritePointer (1),
-                                buffer.getNumSamples());
-            
-            lastParams.roomSize = params.roomSize;
-            lastParams.damping  = params.damping;
-            lastParams.wetLevel = params.wetLevel;
-            lastParams.dryLevel = params.dryLevel;
-            lastParams.width    = params.width;
+            // the reverb smooths its own settings, they only need to move every so often
+            const int step = moving ? (int) SmoothedParameter::interval : numSamples;
+            for (int offset = 0; offset < numSamples; offset += step)
+            {
+                if (moving || offset == 0)
+                    updateParameters (offset);
+                verb.processStereo (buffer.getWritePointer (0, offset),
+                                    buffer.getWritePointer (1, offset),
+                                    jmin (step, numSamples - offset));
+            }
         }
         
         void processBlockBypassed (AudioBuffer<float>& buffer, MidiBuffer& midi) override
@@ -130,26 +139,42 @@ namespace Element {
                 auto state = ValueTree::fromXml (*e);
                 if (state.isValid())
                 {
-                    *roomSize = params.roomSize = ((float) state.getProperty ("roomSize", 0.0));
-                    *damping  = params.damping  = ((float) state.getProperty ("damping", 0.0));
-                    *wetLevel = params.wetLevel = ((float) state.getProperty ("wetLevel", 0.0));
-                    *dryLevel = params.dryLevel = ((float) state.getProperty ("dryLevel", 0.0));
-                    *width    = params.width    = ((float) state.getProperty ("width", 0.0));
+                    *roomSize = ((float) state.getProperty ("roomSize", 0.0));
+                    *damping  = ((float) state.getProperty ("damping", 0.0));
+                    *wetLevel = ((float) state.getProperty ("wetLevel", 0.0));
+                    *dryLevel = ((float) state.getProperty ("dryLevel", 0.0));
+                    *width    = ((float) state.getProperty ("width", 0.0));
+                    resetSmoothedParameters();
                 }
             }
         }
         
     private:
         Reverb verb;
-        Reverb::Parameters params, lastParams;
-        
-        bool paramsChanged() const noexcept
+        Reverb::Parameters params;
+
+        float valueAt (int index, int offset) const noexcept
         {
-            return params.roomSize != (float) *roomSize ||
-                params.damping  != (float) *damping ||
-                params.wetLevel != (float) *wetLevel ||
-                params.dryLevel != (float) *dryLevel ||
-                params.width    != (float) *width;
+            const auto& parameter = smoothed[index];
+            return parameter.isSmoothing() ? parameter.getValues()[offset] : parameter.getCurrentValue();
+        }
+
+        void updateParameters (int offset) noexcept
+        {
+            Reverb::Parameters next;
+            next.roomSize = valueAt (0, offset);
+            next.damping  = valueAt (1, offset);
+            next.wetLevel = valueAt (2, offset);
+            next.dryLevel = valueAt (3, offset);
+            next.width    = valueAt (4, offset);
+
+            if (next.roomSize != params.roomSize || next.damping != params.damping
+                || next.wetLevel != params.wetLevel || next.dryLevel != params.dryLevel
+                || next.width != params.width)
+            {
+                params = next;
+                verb.setParameters (params);
+            }
         }
     };
-}
+}
\ No newline at end of file
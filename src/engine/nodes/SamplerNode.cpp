@@ -0,0 +1,689 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "engine/nodes/SamplerNode.h"
+#include "gui/LookAndFeel.h"
+
+namespace Element {
+
+/** Frames each voice's stream buffers ahead of its playhead */
+static const int streamFrames = 16384;
+
+/** The most a voice's pitch may be raised, as a playback rate. Higher notes
+    play at this rate */
+static const int maxIncrement = 8;
+
+//=============================================================================
+/** What a voice's stream reads from, the zone the voice is playing. The I/O
+    threads call it */
+class SamplerNode::VoiceSource : public PositionableAudioSource
+{
+public:
+    void setZone (const SamplerInstrument::Zone* newZone) noexcept
+    {
+        zone.store (newZone, std::memory_order_release);
+    }
+
+    void prepareToPlay (int, double) override { }
+    void releaseResources() override { }
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        const auto* current = zone.load (std::memory_order_acquire);
+        if (current == nullptr || current->reader == nullptr)
+            info.clearActiveBufferRegion();
+        else // mapped readers only copy out of the map, so voices on several threads share one
+            current->reader->read (info.buffer, info.startSample, info.numSamples, position, true, true);
+        position += info.numSamples;
+    }
+
+    void setNextReadPosition (int64 newPosition) override { position = newPosition; }
+    int64 getNextReadPosition() const override { return position; }
+
+    int64 getTotalLength() const override
+    {
+        const auto* current = zone.load (std::memory_order_acquire);
+        return current != nullptr ? current->length : 0;
+    }
+
+    bool isLooping() const override { return false; }
+    void setLooping (bool) override { }
+
+private:
+    std::atomic<const SamplerInstrument::Zone*> zone { nullptr };
+    int64 position = 0;
+};
+
+//=============================================================================
+/** Plays one zone. The start comes from the zone's memory and the rest from
+    the voice's stream, which is restarted past the part in memory when the
+    note starts */
+class SamplerNode::Voice
+{
+public:
+    explicit Voice (DiskStreamer& streamer)
+        : stream (&source, false, streamer, streamFrames, 2) { }
+
+    void prepareStream (double sampleRate, int blockSize)
+    {
+        outputRate = sampleRate;
+        raw.setSize (2, blockSize * maxIncrement + 4);
+        mix.setSize (2, blockSize);
+        stream.prepareToPlay (blockSize, sampleRate);
+        zone = nullptr;
+    }
+
+    void releaseStream()
+    {
+        zone = nullptr;
+        stream.releaseResources();
+    }
+
+    bool isActive() const noexcept          { return zone != nullptr; }
+    bool isReleasing() const noexcept       { return releasing; }
+    bool isSustained() const noexcept       { return sustained; }
+    int getNote() const noexcept            { return note; }
+    uint32 getOrder() const noexcept        { return order; }
+
+    void start (const SamplerInstrument::Zone& newZone, int newNote, float velocity, uint32 newOrder) noexcept
+    {
+        zone = &newZone;
+        note = newNote;
+        order = newOrder;
+        gain = newZone.gain * velocity * velocity;
+        envelope = 1.f;
+        releasing = sustained = false;
+
+        const auto& region = newZone.region;
+        const double semitones = newNote - region.rootKey + region.transpose + region.tuneCents / 100.0;
+        increment = jmin ((double) maxIncrement, std::pow (2.0, semitones / 12.0) * newZone.sampleRate / outputRate);
+        position = 0.0;
+        rawStart = rawEnd = 0;
+
+        source.setZone (&newZone);
+        if (newZone.isStreamed())
+            stream.restart (newZone.attack.getNumSamples());
+    }
+
+    /** Lets the note ring out over the release, or holds it for the pedal */
+    void stop (bool allowTail, bool holdForSustain = false) noexcept
+    {
+        if (holdForSustain)
+        {
+            sustained = true;
+        }
+        else if (allowTail)
+        {
+            releasing = true;
+            sustained = false;
+        }
+        else
+        {
+            zone = nullptr;
+        }
+    }
+
+    /** Adds the voice to a buffer, ramping its level from one gain to another */
+    void render (AudioBuffer<float>& output, int start, int numSamples,
+                 float startGain, float endGain, float releaseStep) noexcept
+    {
+        while (numSamples > 0 && zone != nullptr)
+        {
+            const int count = jmin (numSamples, mix.getNumSamples());
+            const float fraction = (float) count / (float) numSamples;
+            const float gainAfter = startGain + (endGain - startGain) * fraction;
+
+            interpolate (count);
+            const float envelopeBefore = envelope;
+            if (releasing)
+                envelope = jmax (0.f, envelope - releaseStep * (float) count);
+
+            for (int c = 0; c < output.getNumChannels(); ++c)
+                output.addFromWithRamp (c, start, mix.getReadPointer (jmin (c, 1)), count,
+                                        envelopeBefore * gain * startGain, envelope * gain * gainAfter);
+
+            if ((releasing && envelope <= 0.f) || position >= (double) zone->length)
+                zone = nullptr;
+
+            start += count;
+            numSamples -= count;
+            startGain = gainAfter;
+        }
+    }
+
+private:
+    VoiceSource source;
+    StreamingAudioSource stream;
+    AudioBuffer<float> raw, mix;
+    const SamplerInstrument::Zone* zone = nullptr;
+    double outputRate = 44100.0;
+    double position = 0.0, increment = 1.0;
+    int64 rawStart = 0, rawEnd = 0;
+    float gain = 1.f, envelope = 1.f;
+    bool releasing = false, sustained = false;
+    int note = -1;
+    uint32 order = 0;
+
+    /** Resamples the next frames of the zone into the mix buffer */
+    void interpolate (int numSamples) noexcept
+    {
+        discardBefore ((int64) position);
+        // one frame past the last one read, where the next block starts
+        fetch ((int64) (position + numSamples * increment) + 2);
+
+        const float* const in[2] = { raw.getReadPointer (0), raw.getReadPointer (1) };
+        float* const out[2] = { mix.getWritePointer (0), mix.getWritePointer (1) };
+        double offset = position - (double) rawStart;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int index = (int) offset;
+            const float alpha = (float) (offset - (double) index);
+            for (int c = 0; c < 2; ++c)
+                out[c][i] = in[c][index] + alpha * (in[c][index + 1] - in[c][index]);
+            offset += increment;
+        }
+
+        position = (double) rawStart + offset;
+    }
+
+    void discardBefore (int64 frame) noexcept
+    {
+        if (frame <= rawStart)
+            return;
+        jassert (frame <= rawEnd);
+        const int shift = (int) (frame - rawStart);
+        const int remaining = (int) (rawEnd - frame);
+        for (int c = 0; c < 2; ++c)
+            if (remaining > 0)
+                std::memmove (raw.getWritePointer (c), raw.getReadPointer (c) + shift, sizeof (float) * (size_t) remaining);
+        rawStart = frame;
+    }
+
+    /** Reads the zone up to a frame, from memory while it lasts and then
+        from the stream */
+    void fetch (int64 upTo) noexcept
+    {
+        int offset = (int) (rawEnd - rawStart);
+        int count = (int) jmin (upTo - rawEnd, (int64) (raw.getNumSamples() - offset));
+        if (count <= 0)
+            return;
+
+        const auto& attack = zone->attack;
+        const int fromMemory = (int) jlimit ((int64) 0, (int64) count, (int64) attack.getNumSamples() - rawEnd);
+        if (fromMemory > 0)
+        {
+            for (int c = 0; c < 2; ++c)
+                raw.copyFrom (c, offset, attack, jmin (c, attack.getNumChannels() - 1), (int) rawEnd, fromMemory);
+            offset += fromMemory;
+            count -= fromMemory;
+            rawEnd += fromMemory;
+        }
+
+        if (count <= 0)
+            return;
+        if (zone->isStreamed())
+            stream.getNextAudioBlock (AudioSourceChannelInfo (&raw, offset, count));
+        else
+            raw.clear (offset, count);
+        rawEnd += count;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Voice)
+};
+
+//=============================================================================
+/** An instrument and the voices that play it. Replaced kits are deleted on
+    the job service's thread, where their streams wait for any read under way */
+struct SamplerNode::Kit
+{
+    explicit Kit (DiskStreamer& streamer)
+    {
+        for (int i = 0; i < maxVoices; ++i)
+            voices.add (new Voice (streamer));
+    }
+
+    void prepare (double sampleRate, int blockSize)
+    {
+        for (auto* voice : voices)
+            voice->prepareStream (sampleRate, blockSize);
+    }
+
+    void release()
+    {
+        for (auto* voice : voices)
+            voice->releaseStream();
+    }
+
+    SamplerInstrument instrument;
+    OwnedArray<Voice> voices;
+};
+
+//=============================================================================
+struct SamplerNode::LoadJob : public JobService::Job
+{
+    LoadJob (SamplerNode& n, const File& f)
+        : node (n), file (f),
+          preloadSeconds (n.preloadTime / 1000.0),
+          prepared (n.prepared),
+          sampleRate (n.renderSampleRate),
+          blockSize (n.renderBlockSize),
+          serial (++n.latestLoad)
+    { }
+
+    void run() override
+    {
+        std::unique_ptr<Kit> newKit (new Kit (*node.streamer));
+        const auto result = newKit->instrument.load (file, preloadSeconds);
+        {
+            const ScopedLock sl (node.errorLock);
+            if (serial == node.latestLoad.load())
+                node.loadError = result.getErrorMessage();
+        }
+
+        if (result.failed())
+            return;
+        if (prepared)
+            newKit->prepare (sampleRate, blockSize);
+        kit = std::move (newKit);
+    }
+
+    void respond() override
+    {
+        node.install (*this);
+    }
+
+    SamplerNode& node;
+    const File file;
+    const double preloadSeconds;
+    const bool prepared;
+    const double sampleRate;
+    const int blockSize;
+    const int serial;
+    std::unique_ptr<Kit> kit;
+};
+
+//=============================================================================
+class SamplerEditor : public AudioProcessorEditor,
+                      private Timer
+{
+public:
+    SamplerEditor (SamplerNode& o)
+        : AudioProcessorEditor (&o),
+          processor (o)
+    {
+        setOpaque (true);
+
+        addAndMakeVisible (loadButton);
+        loadButton.setButtonText ("Load...");
+        loadButton.onClick = [this]()
+        {
+            FileChooser fc ("Load Instrument", processor.getInstrumentFile(),
+                            "*.sfz;*.wav;*.aif;*.aiff;*.flac;*.ogg", true, false, nullptr);
+            if (fc.browseForFileToOpen())
+                processor.loadInstrument (fc.getResult());
+            stabilizeComponents();
+        };
+
+        addAndMakeVisible (preloadLabel);
+        preloadLabel.setFont (Font (12.f));
+        preloadLabel.setText ("Preload (ms)", dontSendNotification);
+        addAndMakeVisible (preload);
+        preload.setSliderStyle (Slider::IncDecButtons);
+        preload.setTextBoxStyle (Slider::TextBoxLeft, false, 52, 18);
+        preload.setRange (20.0, 5000.0, 10.0);
+        preload.setValue ((double) processor.getPreloadTime(), dontSendNotification);
+        preload.onValueChange = [this]() { processor.setPreloadTime (roundToInt (preload.getValue())); };
+
+        addAndMakeVisible (status);
+        status.setFont (Font (12.f));
+
+        stabilizeComponents();
+        setSize (360, 80);
+        startTimer (250);
+    }
+
+    ~SamplerEditor() noexcept
+    {
+        stopTimer();
+        loadButton.onClick = nullptr;
+        preload.onValueChange = nullptr;
+    }
+
+    void stabilizeComponents()
+    {
+        String text;
+        const auto error = processor.getLoadError();
+        if (processor.getInstrumentFile() == File())
+            text << "No instrument";
+        else if (error.isNotEmpty())
+            text << processor.getInstrumentFile().getFileName() << ": " << error;
+        else
+            text << processor.getInstrumentFile().getFileName() << "  "
+                 << processor.getNumZones() << " zones  "
+                 << String ((double) processor.getMemoryBytes() / (1024.0 * 1024.0), 1) << " MB  "
+                 << processor.getNumActiveVoices() << " voices";
+        status.setText (text, dontSendNotification);
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        auto r2 = r.removeFromTop (18);
+        loadButton.setBounds (r2.removeFromLeft (72));
+        preload.setBounds (r2.removeFromRight (100));
+        preloadLabel.setBounds (r2.removeFromRight (80));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    SamplerNode& processor;
+    TextButton loadButton;
+    Label preloadLabel;
+    Slider preload;
+    Label status;
+
+    void timerCallback() override { stabilizeComponents(); }
+};
+
+//=============================================================================
+SamplerNode::SamplerNode()
+    : BaseProcessor (BusesProperties()
+        .withOutput ("Main", AudioChannelSet::stereo(), true))
+{
+    addParameter (volume  = new AudioParameterFloat ("volume", "Volume", -60.f, 12.f, 0.f));
+    addParameter (release = new AudioParameterFloat ("release", "Release", 0.005f, 5.f, 0.25f));
+}
+
+SamplerNode::~SamplerNode()
+{
+    cancelPendingUpdate();
+    volume = nullptr;
+    release = nullptr;
+}
+
+void SamplerNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_SAMPLER;
+    desc.descriptiveName    = "Streams multisample instruments from disk";
+    desc.numInputChannels   = 0;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = true;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_SAMPLER;
+}
+
+void SamplerNode::loadInstrument (const File& file)
+{
+    instrumentFile = file;
+
+    std::unique_ptr<LoadJob> job (new LoadJob (*this, file));
+    if (prepared && jobs.schedule (job.get()))
+    {
+        job.release();
+        return;
+    }
+
+    // nothing is rendering to hand the instrument to, so it's opened here
+    job->run();
+    const ScopedLock sl (getCallbackLock());
+    install (*job);
+}
+
+bool SamplerNode::waitUntilLoaded (int timeoutMs)
+{
+    return jobs.waitUntilReady (timeoutMs);
+}
+
+String SamplerNode::getLoadError() const
+{
+    const ScopedLock sl (errorLock);
+    return loadError;
+}
+
+void SamplerNode::setPreloadTime (int milliseconds)
+{
+    milliseconds = jlimit (20, 5000, milliseconds);
+    if (milliseconds == preloadTime)
+        return;
+    preloadTime = milliseconds;
+    if (instrumentFile != File())
+        loadInstrument (instrumentFile);
+}
+
+int64 SamplerNode::getMemoryBytes() const
+{
+    const ScopedLock sl (getCallbackLock());
+    if (kit == nullptr)
+        return 0;
+    const int64 streams = prepared ? (int64) maxVoices * streamFrames * 2 * (int64) sizeof (float) : 0;
+    return kit->instrument.getMemoryBytes() + streams;
+}
+
+void SamplerNode::install (LoadJob& job)
+{
+    // a newer instrument was asked for while this one was opened
+    if (job.serial != latestLoad.load() || job.kit == nullptr)
+        return;
+
+    // the kit was readied for another rate or block size, so it's opened again
+    if (prepared && (! job.prepared || job.sampleRate != renderSampleRate || job.blockSize != renderBlockSize))
+    {
+        triggerAsyncUpdate();
+        return;
+    }
+
+    std::swap (kit, job.kit);
+    if (! prepared && job.prepared)
+        kit->release();
+
+    numZones.store (kit->instrument.getNumZones());
+    numActiveVoices.store (0);
+}
+
+void SamplerNode::handleAsyncUpdate()
+{
+    if (instrumentFile != File())
+        loadInstrument (instrumentFile);
+}
+
+void SamplerNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (0, getTotalNumOutputChannels(), sampleRate, maximumExpectedSamplesPerBlock);
+
+    // instruments opened while nothing was rendering
+    jobs.deliverResponses();
+    prepared = true;
+    renderSampleRate = sampleRate;
+    renderBlockSize = maximumExpectedSamplesPerBlock;
+    lastGain = Decibels::decibelsToGain ((float) *volume, -60.f);
+    sustain = false;
+
+    if (kit != nullptr)
+        kit->prepare (sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+void SamplerNode::releaseResources()
+{
+    prepared = false;
+    jobs.deliverResponses();
+    if (kit != nullptr)
+        kit->release();
+    numActiveVoices.store (0);
+}
+
+void SamplerNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    const int numSamples = buffer.getNumSamples();
+    buffer.clear (0, numSamples);
+
+    const ScopedLock sl (getCallbackLock());
+    jobs.deliverResponses();
+
+    MidiBuffer::Iterator iter (midi);
+    MidiMessage msg;
+    int frame = 0, position = 0;
+    while (iter.getNextEvent (msg, frame))
+    {
+        frame = jlimit (position, numSamples, frame);
+        render (buffer, position, frame - position);
+        position = frame;
+
+        if (msg.isNoteOn())
+            noteOn (msg.getNoteNumber(), msg.getFloatVelocity());
+        else if (msg.isNoteOff())
+            noteOff (msg.getNoteNumber());
+        else if (msg.isSustainPedalOn())
+            setSustain (true);
+        else if (msg.isSustainPedalOff())
+            setSustain (false);
+        else if (msg.isAllNotesOff())
+            stopAll (true);
+        else if (msg.isAllSoundOff())
+            stopAll (false);
+    }
+
+    render (buffer, position, numSamples - position);
+    midi.clear();
+}
+
+void SamplerNode::noteOn (int note, float velocity)
+{
+    if (kit == nullptr)
+        return;
+
+    const SamplerInstrument::Zone* zones [maxLayers];
+    const int numFound = kit->instrument.findZones (
+        note, jlimit (1, 127, roundToInt (velocity * 127.f)), zones, maxLayers);
+
+    for (int i = 0; i < numFound; ++i)
+    {
+        // a free voice, or else the oldest, preferring ones already fading
+        Voice* best = nullptr;
+        for (auto* voice : kit->voices)
+        {
+            if (! voice->isActive())
+            {
+                best = voice;
+                break;
+            }
+
+            if (best == nullptr || (voice->isReleasing() && ! best->isReleasing())
+                || (voice->isReleasing() == best->isReleasing() && voice->getOrder() < best->getOrder()))
+                best = voice;
+        }
+
+        best->start (*zones[i], note, velocity, ++voiceOrder);
+    }
+}
+
+void SamplerNode::noteOff (int note)
+{
+    if (kit == nullptr)
+        return;
+    for (auto* voice : kit->voices)
+        if (voice->isActive() && voice->getNote() == note && ! voice->isReleasing())
+            voice->stop (true, sustain);
+}
+
+void SamplerNode::setSustain (bool down)
+{
+    sustain = down;
+    if (down || kit == nullptr)
+        return;
+    for (auto* voice : kit->voices)
+        if (voice->isActive() && voice->isSustained())
+            voice->stop (true);
+}
+
+void SamplerNode::stopAll (bool allowTail)
+{
+    if (kit == nullptr)
+        return;
+    for (auto* voice : kit->voices)
+        if (voice->isActive())
+            voice->stop (allowTail);
+}
+
+void SamplerNode::render (AudioBuffer<float>& buffer, int start, int numSamples)
+{
+    if (kit == nullptr || numSamples <= 0)
+        return;
+
+    const float gain = Decibels::decibelsToGain ((float) *volume, -60.f);
+    const float releaseStep = 1.f / (float) jmax (1.0, (double) *release * renderSampleRate);
+
+    int numActive = 0;
+    for (auto* voice : kit->voices)
+    {
+        if (! voice->isActive())
+            continue;
+        voice->render (buffer, start, numSamples, lastGain, gain, releaseStep);
+        if (voice->isActive())
+            ++numActive;
+    }
+
+    lastGain = gain;
+    numActiveVoices.store (numActive, std::memory_order_relaxed);
+}
+
+AudioProcessorEditor* SamplerNode::createEditor()
+{
+    return new SamplerEditor (*this);
+}
+
+void SamplerNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("instrument", instrumentFile.getFullPathName(), nullptr)
+         .setProperty ("preloadTime", preloadTime, nullptr);
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void SamplerNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+
+    preloadTime = jlimit (20, 5000, (int) state.getProperty ("preloadTime", 250));
+    const auto path = state["instrument"].toString();
+    if (File::isAbsolutePath (path))
+        loadInstrument (File (path));
+}
+
+bool SamplerNode::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    // one main output, stereo or mono
+    if (layout.inputBuses.size() > 0 || layout.outputBuses.size() > 1)
+        return false;
+    return layout.getMainOutputChannelSet() == AudioChannelSet::stereo() ||
+           layout.getMainOutputChannelSet() == AudioChannelSet::mono();
+}
+
+}
@@ -0,0 +1,150 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/DiskStreamer.h"
+#include "engine/JobService.h"
+#include "engine/SamplerInstrument.h"
+
+namespace Element {
+
+/** Plays multisample instruments from disk.
+
+    The start of every sample is held in memory, so notes start straight
+    away, and the rest is streamed by the shared DiskStreamer as voices
+    play. Voices are allocated with the instrument, each with a stream of
+    its own, so playing never allocates. Instruments are opened on the job
+    service's thread and swapped in at the start of a block.
+ */
+class SamplerNode : public BaseProcessor,
+                    private AsyncUpdater
+{
+public:
+    enum Parameters { Volume = 0, Release };
+
+    enum
+    {
+        /** Voices each instrument plays at once */
+        maxVoices = 32,
+        /** Zones one note can layer */
+        maxLayers = 8
+    };
+
+    SamplerNode();
+    virtual ~SamplerNode();
+
+    /** Opens an SFZ file, or an audio file to play across the keyboard. While
+        prepared the instrument is opened on the job service's thread, and
+        the one playing carries on until it's ready */
+    void loadInstrument (const File& file);
+
+    /** Blocks until instruments asked for are waiting for the next block,
+        or the timeout passes */
+    bool waitUntilLoaded (int timeoutMs);
+
+    /** Returns the file asked for last */
+    const File& getInstrumentFile() const { return instrumentFile; }
+
+    /** Returns why the last instrument couldn't be opened, or nothing */
+    String getLoadError() const;
+
+    /** Sets how much of each sample is held in memory, and opens the
+        instrument again. Longer gives the disk more time to catch up */
+    void setPreloadTime (int milliseconds);
+    int getPreloadTime() const { return preloadTime; }
+
+    /** Returns the number of zones in the instrument playing */
+    int getNumZones() const { return numZones.load(); }
+
+    /** Returns the number of voices sounding */
+    int getNumActiveVoices() const { return numActiveVoices.load(); }
+
+    /** Returns the bytes of sample data and stream buffers held */
+    int64 getMemoryBytes() const override;
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    const String getName() const override { return "Sampler"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return (double) *release; }
+    bool acceptsMidi() const override                   { return true; }
+    bool producesMidi() const override                  { return false; }
+    bool supportsMPE() const override                   { return false; }
+    bool isMidiEffect() const override                  { return false; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    class VoiceSource;
+    class Voice;
+    struct Kit;
+    struct LoadJob;
+    friend struct LoadJob;
+
+    SharedResourcePointer<DiskStreamer> streamer;
+    std::unique_ptr<Kit> kit;
+    AudioParameterFloat* volume { nullptr };
+    AudioParameterFloat* release { nullptr };
+    float lastGain { 1.f };
+    bool sustain { false };
+    uint32 voiceOrder { 0 };
+
+    File instrumentFile;
+    int preloadTime { 250 };
+    bool prepared { false };
+    double renderSampleRate { 44100.0 };
+    int renderBlockSize { 512 };
+
+    CriticalSection errorLock;
+    String loadError;
+    std::atomic<int> numZones { 0 }, numActiveVoices { 0 }, latestLoad { 0 };
+    JobService::Client jobs;
+
+    void install (LoadJob&);
+    void noteOn (int note, float velocity);
+    void noteOff (int note);
+    void setSustain (bool down);
+    void stopAll (bool allowTail);
+    void render (AudioBuffer<float>& buffer, int start, int numSamples);
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerNode)
+};
+
+}
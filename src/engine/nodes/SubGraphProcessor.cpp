@@ -27,6 +27,9 @@ namespace Element
 SubGraphProcessor::SubGraphProcessor ()
 {
     setPlayConfigDetails (2, 2, 44100.f, 512);
+    renderInner = [this] (AudioSampleBuffer& audio, MidiBuffer& midi) {
+        GraphProcessor::processBlock (audio, midi);
+    };
 }
 
 SubGraphProcessor::~SubGraphProcessor()
@@ -44,6 +47,65 @@ void SubGraphProcessor::initController (PluginManager& plugins)
 
 void SubGraphProcessor::createAllIONodes() { }
 
+void SubGraphProcessor::setRateDivision (int division)
+{
+    rateDivision = jlimit (1, (int) RateBoundary::maxDivision, division);
+}
+
+void SubGraphProcessor::setInnerBlockSize (int numSamples)
+{
+    innerBlockSize = jmax (0, numSamples);
+}
+
+double SubGraphProcessor::getRenderSampleRate() const
+{
+    return boundary.isPrepared() ? getSampleRate() / (double) boundary.getDivision()
+                                 : getSampleRate();
+}
+
+int SubGraphProcessor::getRenderBlockSize() const
+{
+    return boundary.isPrepared() ? boundary.getInnerBlockSize() : getBlockSize();
+}
+
+int SubGraphProcessor::getReportedLatency (int renderLatency) const
+{
+    return boundary.isPrepared() ? boundary.getLatencySamples() + renderLatency * boundary.getDivision()
+                                 : renderLatency;
+}
+
+void SubGraphProcessor::prepareToPlay (double sampleRate, int estimatedBlockSize)
+{
+    // the boundary is sized first, the nodes inside are prepared at its rate
+    if (isMultiRate())
+        boundary.prepare (jmax (getTotalNumInputChannels(), getTotalNumOutputChannels()), rateDivision,
+                          innerBlockSize > 0 ? innerBlockSize : jmax (1, estimatedBlockSize / rateDivision));
+    else
+        boundary.release();
+
+    GraphProcessor::prepareToPlay (sampleRate, estimatedBlockSize);
+}
+
+void SubGraphProcessor::releaseResources()
+{
+    GraphProcessor::releaseResources();
+    boundary.release();
+}
+
+void SubGraphProcessor::reset()
+{
+    GraphProcessor::reset();
+    boundary.reset();
+}
+
+void SubGraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midi)
+{
+    if (boundary.isPrepared())
+        boundary.process (buffer, midi, renderInner);
+    else
+        GraphProcessor::processBlock (buffer, midi);
+}
+
 void SubGraphProcessor::fillInPluginDescription (PluginDescription& d) const
 {
     d.name                = "Graph";
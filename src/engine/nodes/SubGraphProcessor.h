@@ -21,6 +21,7 @@
 
 #include "ElementApp.h"
 #include "engine/GraphProcessor.h"
+#include "engine/RateBoundary.h"
 
 namespace Element {
 
@@ -35,12 +36,44 @@ public:
     virtual ~SubGraphProcessor();
     void fillInPluginDescription (PluginDescription& d) const override;
     GraphManager& getController() const { jassert(controller); return* controller; }
-    
+
+    /** Renders the nodes inside at the sample rate divided by this, between
+        1 and RateBoundary::maxDivision. Audio is decimated on the way in and
+        interpolated on the way out. Takes effect when next prepared */
+    void setRateDivision (int division);
+    int getRateDivision() const noexcept { return rateDivision; }
+
+    /** Renders the nodes inside in blocks of this many samples, at their own
+        rate, 0 to follow the blocks coming in. The blocks gathered for one
+        add their length in latency. Takes effect when next prepared */
+    void setInnerBlockSize (int numSamples);
+    int getInnerBlockSize() const noexcept { return innerBlockSize; }
+
+    /** Returns true if the nodes inside render at their own rate or block size */
+    bool isMultiRate() const noexcept { return rateDivision > 1 || innerBlockSize > 0; }
+
+    double getRenderSampleRate() const override;
+    int getRenderBlockSize() const override;
+    int getReportedLatency (int renderLatency) const override;
+
+    void prepareToPlay (double sampleRate, int estimatedBlockSize) override;
+    void releaseResources() override;
+    void reset() override;
+    using GraphProcessor::processBlock;
+    void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+
+    /** Multi-rate graphs only render in single precision */
+    bool supportsDoublePrecisionProcessing() const override { return ! isMultiRate(); }
+
 private:
     typedef GraphProcessor::AudioGraphIOProcessor IOProcessor;
     GraphNodePtr ioNodes [PortType::Unknown];
     friend class GraphManager;
     ScopedPointer<GraphManager> controller;
+    int rateDivision = 1;
+    int innerBlockSize = 0;
+    RateBoundary boundary;
+    RateBoundary::Renderer renderInner;
     void createAllIONodes();
     void initController (PluginManager& plugins);
 
@@ -27,10 +27,10 @@ class VolumeProcessor : public BaseProcessor
 {
 private:
     const bool stereo;
-    float lastVolume;
-    float gain;
-    float lastGain;
     AudioParameterFloat* volume = nullptr;
+    SmoothedParameter gain;
+
+    static float volumeToGain (float db) { return db <= -30.f ? 0.f : Decibels::decibelsToGain (db); }
     
 public:
     explicit VolumeProcessor (const double minDb, const double maxDb,
@@ -41,9 +41,8 @@ public:
         setPlayConfigDetails (stereo ? 2 : 1, stereo ? 2 : 1, 44100.0, 1024);
         addParameter (volume = new AudioParameterFloat (Tags::volume.toString(),
                                                         "Volume", minDb, maxDb, 0.f));
-        lastVolume = *volume;
-        gain = Decibels::decibelsToGain (lastVolume);
-        lastGain = gain;
+        gain.attach (*volume, volumeToGain);
+        addSmoothedParameter (gain);
     }
     
     virtual ~VolumeProcessor()
@@ -71,6 +70,7 @@ public:
     {
         setPlayConfigDetails (stereo ? 2 : 1, stereo ? 2 : 1,
                                 sampleRate, maximumExpectedSamplesPerBlock);
+        prepareSmoothedParameters (sampleRate, maximumExpectedSamplesPerBlock);
     }
     
     void releaseResources() override
@@ -80,21 +80,16 @@ public:
     
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
     {
-        if (lastVolume != (float) *volume) {
-            gain = (float)*volume <= -30.f ? 0.f : Decibels::decibelsToGain ((float) *volume);
-        }
-        
-        for (int c = jmin (2, buffer.getNumChannels()); --c >= 0;)
-            buffer.applyGainRamp (c, 0, buffer.getNumSamples(), lastGain, gain);
-        
-        lastGain = gain;
-        lastVolume = *volume;
+        gain.process (buffer.getNumSamples());
+        gain.applyGain (buffer.getArrayOfWritePointers(), jmin (2, buffer.getNumChannels()),
+                        buffer.getNumSamples());
     }
     
     AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
     bool hasEditor() const override                 { return true; }
     
     double getTailLengthSeconds() const override    { return 0.0; };
+    bool silenceInProducesSilenceOut() const override { return true; }
     bool acceptsMidi() const override               { return false; }
     bool producesMidi() const override              { return false; }
     
@@ -119,8 +114,8 @@ public:
             auto state = ValueTree::fromXml (*e);
             if (state.isValid())
             {
-                *volume = lastVolume = (float) state.getProperty (Tags::volume,  (float) *volume);
-                gain = lastGain = Decibels::decibelsToGain ((float) *volume);
+                *volume = (float) state.getProperty (Tags::volume,  (float) *volume);
+                resetSmoothedParameters();
             }
         }
     }
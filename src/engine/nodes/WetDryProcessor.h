@@ -28,8 +28,11 @@ class WetDryProcessor : public BaseProcessor
 private:
     AudioParameterFloat* wetLevel = nullptr;
     AudioParameterFloat* dryLevel = nullptr;
-    float lastWetLevel = 0.33f;
-    float lastDryLevel = 0.40f;
+    SmoothedParameter wetGain, dryGain;
+
+    // the scaling juce::Reverb gives its levels, at full width
+    static float wetToGain (float level) { return level * 3.f; }
+    static float dryToGain (float level) { return level * 2.f; }
     
 public:
     explicit WetDryProcessor()
@@ -38,6 +41,10 @@ public:
         setPlayConfigDetails (4, 2, 44100.0, 1024);
         addParameter (wetLevel = new AudioParameterFloat ("wetLevel",   "Wet Level",  0.f, 1.f, 0.33f));
         addParameter (dryLevel = new AudioParameterFloat ("dryLevel",   "Dry Level",  0.f, 1.f, 0.40f));
+        wetGain.attach (*wetLevel, wetToGain);
+        dryGain.attach (*dryLevel, dryToGain);
+        addSmoothedParameter (wetGain);
+        addSmoothedParameter (dryGain);
     }
     
     virtual ~WetDryProcessor()
@@ -61,59 +68,42 @@ public:
         desc.pluginFormatName   = "Element";
     }
     
-    void setLevels (const float newWet, const float newDry)
-    {
-        const float wetScaleFactor = 3.0f;
-        const float dryScaleFactor = 2.0f;
-        const float width          = 1.f;
-        const float wet = newWet * wetScaleFactor;
-        
-        dryGain.setValue (newDry * dryScaleFactor);
-        wetGain1.setValue (0.5f * wet * (1.0f + width));
-        wetGain2.setValue (0.5f * wet * (1.0f - width));
-    }
-    
     void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
     {
         setPlayConfigDetails (4, 2, sampleRate, maximumExpectedSamplesPerBlock);
-        const double smoothTime = 0.01;
-        dryGain .reset (sampleRate, smoothTime);
-        wetGain1.reset (sampleRate, smoothTime);
-        wetGain2.reset (sampleRate, smoothTime);
-        lastWetLevel = (float) *wetLevel;
-        lastDryLevel = (float) *dryLevel;
+        prepareSmoothedParameters (sampleRate, maximumExpectedSamplesPerBlock, 0.01);
     }
     
     void releaseResources() override { }
     
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
     {
-        if (lastWetLevel != (float)*wetLevel || lastDryLevel != (float)*dryLevel)
-            setLevels (*wetLevel, *dryLevel);
-        
+        const int numSamples = buffer.getNumSamples();
+        const float* wet = wetGain.process (numSamples);
+        const float* dry = dryGain.process (numSamples);
+
         if (buffer.getNumChannels() >= 4)
         {
-            const int numSamples = buffer.getNumSamples();
-            const auto** input  = buffer.getArrayOfReadPointers();
-            auto** output = buffer.getArrayOfWritePointers();
-            
-            for (int i = 0; i < numSamples; ++i)
+            for (int c = 0; c < 2; ++c)
             {
-                const float dry  = dryGain.getNextValue();
-                const float wet1 = wetGain1.getNextValue();
-                const float wet2 = wetGain2.getNextValue();
-                
-                output[0][i] = input[0][i] * wet1 + input[1][i] * wet2 + input[2][i] * dry;
-                output[1][i] = input[1][i] * wet1 + input[0][i] * wet2 + input[3][i] * dry;
+                auto* output = buffer.getWritePointer (c);
+                const auto* dryInput = buffer.getReadPointer (c + 2);
+
+                if (wetGain.isSmoothing())
+                    FloatVectorOperations::multiply (output, wet, numSamples);
+                else
+                    FloatVectorOperations::multiply (output, wetGain.getCurrentValue(), numSamples);
+
+                if (dryGain.isSmoothing())
+                    FloatVectorOperations::addWithMultiply (output, dryInput, dry, numSamples);
+                else
+                    FloatVectorOperations::addWithMultiply (output, dryInput, dryGain.getCurrentValue(), numSamples);
             }
         }
         else
         {
             DBG("CHans: " << buffer.getNumChannels());
         }
-        
-        lastWetLevel = *wetLevel;
-        lastDryLevel = *dryLevel;
     }
     
     AudioProcessorEditor* createEditor() override
@@ -126,6 +116,7 @@ public:
     bool hasEditor() const override                 { return true; }
     
     double getTailLengthSeconds() const override    { return 0.0; };
+    bool silenceInProducesSilenceOut() const override { return true; }
     bool acceptsMidi() const override               { return false; }
     bool producesMidi() const override              { return false; }
     
@@ -153,12 +144,10 @@ public:
             {
                 *wetLevel = (float) state.getProperty ("wetLevel", (float) *wetLevel);
                 *dryLevel = (float) state.getProperty ("dryLevel", (float) *dryLevel);
+                resetSmoothedParameters();
             }
         }
     }
-    
-private:
-    LinearSmoothedValue<float> dryGain, wetGain1, wetGain2;
 };
 
 }
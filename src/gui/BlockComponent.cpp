@@ -26,6 +26,7 @@
 #include "gui/GraphEditorComponent.h"
 #include "gui/NodeIOConfiguration.h"
 #include "gui/ViewHelpers.h"
+#include "engine/nodes/LuaNode.h"
 #include "session/Node.h"
 #include "Globals.h"
 #include "ScopedFlag.h"
@@ -80,6 +81,7 @@ Colour PortComponent::getColor() const noexcept
     {
         case PortType::Audio:   return Colours::lightgreen; break;
         case PortType::Control: return Colours::lightblue;  break;
+        case PortType::CV:      return Colours::plum;       break;
         case PortType::Midi:    return Colours::orange;     break;
         default:
             break;
@@ -163,6 +165,7 @@ BlockComponent::BlockComponent (const Node& graph_, const Node& node_, const boo
 
 BlockComponent::~BlockComponent() noexcept
 {
+    setProcessTimeVisible (false);
     nodeEnabled.removeListener (this);
     nodeName.removeListener (this);
     deleteAllPins();
@@ -374,7 +377,7 @@ void BlockComponent::mouseDrag (const MouseEvent& e)
     {
         if (panel->onBlockMoved)
             panel->onBlockMoved (*this);
-        panel->updateConnectorComponents();
+        panel->updateConnectorsFor (node.getNodeId());
     }
 }
 
@@ -399,7 +402,7 @@ void BlockComponent::updatePosition()
     node.getRelativePosition (relativeX, relativeY);
     vertical ? setCentreRelative (relativeX, relativeY)
              : setCentreRelative (relativeY, relativeX);
-    getGraphPanel()->updateConnectorComponents();
+    getGraphPanel()->updateConnectorsFor (node.getNodeId());
 }
 
 void BlockComponent::makeEditorActive()
@@ -410,6 +413,11 @@ void BlockComponent::makeEditorActive()
         if (auto* cc = ViewHelpers::findContentComponent (this))
             cc->setCurrentNode (node);
     }
+    else if (node.hasProperty (Tags::placeholder))
+    {
+        // still loading, the editor can be opened once the plugin is ready
+        return;
+    }
     else if (node.hasProperty (Tags::missing))
     {
         String message = "This node is unavailable and running as a Placeholder.\n";
@@ -480,9 +488,39 @@ Rectangle<int> BlockComponent::getBoxRectangle() const
     #endif
 }
 
+void BlockComponent::setProcessTimeVisible (bool visible)
+{
+    GraphNodePtr newNode = visible ? node.getGraphNode() : nullptr;
+    if (newNode == profiledNode)
+        return;
+
+    if (profiledNode != nullptr)
+        profiledNode->removeProfileSubscriber();
+    profiledNode = newNode;
+    if (profiledNode != nullptr)
+        profiledNode->addProfileSubscriber();
+
+    repaint();
+}
+
 void BlockComponent::paintOverChildren (Graphics& g)
 {
-    ignoreUnused (g);
+    if (profiledNode == nullptr)
+        return;
+
+    const auto time = profiledNode->getProcessTime();
+    auto r = getBoxRectangle().removeFromBottom (12).reduced (4, 0);
+    const float load = (float) jlimit (0.0, 1.0, time.load * 4.0);
+    g.setColour (Colour (0xff333333).interpolatedWith (Colours::red, load));
+    g.setFont (9.f);
+    String text = File::descriptionOfSizeInBytes (profiledNode->getMemoryUsage().getTotal()) + "  "
+        + String (time.averageMs, 2) + " ms  " + String (roundToInt (time.load * 100.0)) + "%";
+    if (auto* lua = dynamic_cast<LuaNode*> (profiledNode.get()))
+    {
+        const auto script = lua->getScriptProfile();
+        text = String ((int64) script.memory.inUse / 1024) + " KB  gc " + String (script.gc.averageMs, 2) + " ms  " + text;
+    }
+    g.drawText (text, r, Justification::centredRight, false);
 }
 
 void BlockComponent::paint (Graphics& g)
@@ -110,6 +110,12 @@ public:
     /** Gets the coordinate of the port index */
     void getPortPos (const int index, const bool isInput, float& x, float& y);
 
+    /** Shows or hides the node's render time over the block */
+    void setProcessTimeVisible (bool);
+
+    /** Returns true if the node's render time is shown */
+    bool isProcessTimeVisible() const noexcept { return profiledNode != nullptr; }
+
     /** @internal */
     void buttonClicked (Button* b) override;
     /** @internal */
@@ -162,6 +168,9 @@ private:
     DropShadowEffect shadow;
     ScopedPointer<Component> embedded;
 
+    // the engine only times nodes that are being displayed
+    GraphNodePtr profiledNode;
+
     void setPositionFromNode();
     void deleteAllPins();
     Rectangle<int> getOpenCloseBox() const;
@@ -65,6 +65,8 @@ public:
     inline void setPath (const Path& p, float reduceby = 2.f)
     {
         path = p;
+        // icons are drawn from their own path so they're cached
+        iconPath = getIcons().contains (&p) ? &p : nullptr;
         pathReduction = jmax (2.f, reduceby);
     }
 
@@ -82,6 +84,7 @@ private:
     String no  = "No";
     Image icon;
     Path path;
+    const Path* iconPath = nullptr;
     int pathReduction = 2;
 };
 
@@ -34,8 +34,12 @@ namespace Element
     // Spacing between each patch point
     static const int gridPadding = 1;
     
+    /** The matrix paints only the cells in view and keeps its connections
+        up to date from arc notifications. Ports and labels are rebuilt once
+        per batch of node and port changes */
     class ConnectionGrid::PatchMatrix :  public PatchMatrixComponent,
                                          private ValueTree::Listener,
+                                         private AsyncUpdater,
                                          ViewHelperMixin
     {
     public:
@@ -54,6 +58,7 @@ namespace Element
         
         ~PatchMatrix()
         {
+            cancelPendingUpdate();
             nodeModels.removeListener (this);
             graphModel.removeListener (this);
         }
@@ -77,6 +82,27 @@ namespace Element
         }
         
         void updateContent();
+
+        /** Returns the label shown for a source or destination */
+        const String& getLabel (const int index, const bool isSource) const
+        {
+            return isSource ? sourceLabels.getReference (index)
+                            : destinationLabels.getReference (index);
+        }
+
+        void setScrollOffsetX (const int x)
+        {
+            offsetX = x;
+            setOffsetX (x);
+            repaint();
+        }
+
+        void setScrollOffsetY (const int y)
+        {
+            offsetY = y;
+            setOffsetY (y);
+            repaint();
+        }
         
         void setUseHighlighting (const bool shouldUseHighlighting)
         {
@@ -93,20 +119,9 @@ namespace Element
                 grid->repaint();
         }
         
-        void mouseMove (const MouseEvent& ev) override
-        {
-            PatchMatrixComponent::mouseMove (ev);
-            
-            if (useHighlighting)
-                repaint();
-        }
-        
         void paintMatrixCell (Graphics& g, const int width, const int height,
                               const int row, const int column) override
         {
-            const Node src (getNode (row, true));
-            const Node dst (getNode (column, false));
-            
             if (useHighlighting &&
                     (mouseIsOverCell (row, column) && ! matrix.connected (row, column)))
             {
@@ -165,7 +180,7 @@ namespace Element
                 connectPorts (srcPort, dstPort);
             }
             
-            repaint();
+            repaintCell (row, col);
         }
         
         void matrixBackgroundClicked (const MouseEvent& ev) override
@@ -178,8 +193,27 @@ namespace Element
         
         void paint (Graphics& g) override
         {
-            if (matrix.isNotEmpty())
-                return PatchMatrixComponent::paint (g);
+            if (! matrix.isNotEmpty())
+                return;
+
+            // only the cells under the clip get painted
+            const int rowThickness = getRowThickness();
+            const int columnThickness = getColumnThickness();
+            const auto clip = g.getClipBounds();
+            const int firstRow = jmax (0, (clip.getY() - offsetY) / rowThickness);
+            const int lastRow  = jmin (matrix.getNumRows(), 1 + (clip.getBottom() - offsetY) / rowThickness);
+            const int firstCol = jmax (0, (clip.getX() - offsetX) / columnThickness);
+            const int lastCol  = jmin (matrix.getNumColumns(), 1 + (clip.getRight() - offsetX) / columnThickness);
+
+            for (int row = firstRow; row < lastRow; ++row)
+            {
+                for (int col = firstCol; col < lastCol; ++col)
+                {
+                    Graphics::ScopedSaveState state (g);
+                    g.setOrigin (offsetX + col * columnThickness, offsetY + row * rowThickness);
+                    paintMatrixCell (g, columnThickness, rowThickness, row, col);
+                }
+            }
         }
         
         void handleNodeMenuResult (const int result, const Node& node)
@@ -237,6 +271,7 @@ namespace Element
         friend class Destinations;
 
         bool useHighlighting;
+        int offsetX = 0, offsetY = 0;
         MatrixState matrix;
         ValueTree nodeModels;
         ValueTree graphModel;
@@ -244,11 +279,55 @@ namespace Element
         PortArray ins, outs;
         Array<int> audioInIndexes, audioOutIndexes, audioInChannels, audioOutChannels,
                    midiInIndexes, midiOutIndexes, midiInChannels, midiOutChannels;
+        StringArray sourceLabels, destinationLabels;
+        HashMap<int64, int> rowsByPort, columnsByPort;
+
+        static int64 getPortKey (const int64 nodeId, const int port)
+        {
+            return (nodeId << 32) | (int64) (uint32) port;
+        }
+
+        static String createLabel (const Node& node, const Port& port)
+        {
+            String text = node.getName();
+            String portName = port.getName();
+            if (portName.isEmpty())
+                portName << port.getType().getName() << " " << (1 + port.getChannel());
+            text << " - " << portName;
+            return text;
+        }
+
+        void repaintRow (const int row)
+        {
+            if (row >= 0)
+                repaint (0, offsetY + row * getRowThickness(), getWidth(), getRowThickness());
+        }
+
+        void repaintColumn (const int col)
+        {
+            if (col >= 0)
+                repaint (offsetX + col * getColumnThickness(), 0, getColumnThickness(), getHeight());
+        }
+
+        void repaintCell (const int row, const int col)
+        {
+            if (row >= 0 && col >= 0)
+                repaint (offsetX + col * getColumnThickness(), offsetY + row * getRowThickness(),
+                         getColumnThickness(), getRowThickness());
+        }
         
         void matrixHoveredCellChanged (const int prevRow, const int prevCol,
                                        const int newRow,  const int newCol) override
         {
+            // hovering highlights the whole row and column
+            repaintRow (prevRow);
+            repaintRow (newRow);
+            repaintColumn (prevCol);
+            repaintColumn (newCol);
+
             auto* quads = findParentComponentOfClass<QuadrantLayout>();
+            if (quads == nullptr)
+                return;
             if (auto* sources = dynamic_cast<ListBox*> (quads->getQauadrantComponent (QuadrantLayout::Q2)))
             {
                 sources->repaintRow (prevRow);
@@ -266,17 +345,9 @@ namespace Element
                                bool rowIsSelected, bool isSource)
         {
             const int padding = 18;
-            const Node node (getNode (rowNumber, isSource));
-            const Port port (getPort (rowNumber, isSource));
-            
-            String text = node.getName();
-            
-            {
-                String portName = port.getName();
-                if (portName.isEmpty())
-                    portName <<  port.getType().getName() << " " << (1 + port.getChannel());
-                text << " - " << portName;
-            }
+            if (! isPositiveAndBelow (rowNumber, isSource ? sourceLabels.size() : destinationLabels.size()))
+                return;
+            const String& text = getLabel (rowNumber, isSource);
             
             Rectangle<int> r (0, 0, width, height);
             
@@ -448,29 +519,36 @@ namespace Element
         
         void resetMatrix()
         {
-            const ValueTree arcs (nodeModels.getParent().getChildWithName (Tags::arcs));
-            //FIXME: jassert (arcs.hasType (Tags::arcs));
             for (int row = 0; row < matrix.getNumRows(); ++row)
-            {
                 for (int col = 0; col < matrix.getNumColumns(); ++col)
-                {
-                    const Node src = getNode (row, true);
-                    const Port srcPort = getPort (row, true);
-                    const Node dst = getNode (col, false);
-                    const Port dstPort = getPort (col, false);
-                    
-                    const ValueTree arc (findArc (arcs, src.getNodeId(), srcPort.getIndex(),
-                                                        dst.getNodeId(), dstPort.getIndex()));
-                    if (arc.isValid())
-                        matrix.connect (row, col);
-                    else
-                        matrix.disconnect (row, col);
-                }
-            }
+                    matrix.disconnect (row, col);
+
+            const ValueTree arcs (graphModel.getChildWithName (Tags::arcs));
+            for (int i = 0; i < arcs.getNumChildren(); ++i)
+                updateArc (arcs.getChild (i), true);
+        }
+
+        /** Sets the cell of an arc, if both of its ports are shown */
+        bool updateArc (const ValueTree& arc, const bool connected)
+        {
+            const auto source = getPortKey ((int64) arc.getProperty (Tags::sourceNode), (int) arc.getProperty (Tags::sourcePort));
+            const auto dest   = getPortKey ((int64) arc.getProperty (Tags::destNode), (int) arc.getProperty (Tags::destPort));
+            if (! rowsByPort.contains (source) || ! columnsByPort.contains (dest))
+                return false;
+
+            const int row = rowsByPort [source];
+            const int col = columnsByPort [dest];
+            if (connected)
+                matrix.connect (row, col);
+            else
+                matrix.disconnect (row, col);
+            repaintCell (row, col);
+            return true;
         }
         
         void buildNodeArray()
         {
+            cancelPendingUpdate();
             nodes.clearQuick();
             for (int i = 0; i < nodeModels.getNumChildren(); ++i)
             {
@@ -480,38 +558,54 @@ namespace Element
             
             updateContent();
         }
-        
+
+        void handleAsyncUpdate() override
+        {
+            buildNodeArray();
+        }
+
+        bool isArcOfGraph (const ValueTree& parent, const ValueTree& child) const
+        {
+            return child.hasType (Tags::arc) && parent.hasType (Tags::arcs)
+                && parent.getParent() == graphModel;
+        }
+
+        // nodes and ports usually change in batches, so they are rebuilt once
+        // the batch is done. Arcs only ever touch their own cell
         friend class ValueTree;
         virtual void valueTreePropertyChanged (ValueTree& treeWhosePropertyHasChanged,
-                                               const Identifier& property) override { }
+                                               const Identifier& property) override
+        {
+            if (property == Tags::name && (treeWhosePropertyHasChanged.hasType (Tags::node) ||
+                                           treeWhosePropertyHasChanged.hasType (Tags::port)))
+                triggerAsyncUpdate();
+        }
         
         virtual void valueTreeChildAdded (ValueTree& parentTree,
                                           ValueTree& childWhichHasBeenAdded) override
         {
-            if (parentTree == nodeModels.getParent() && childWhichHasBeenAdded.hasType(Tags::nodes)) {
-                buildNodeArray();
+            if (isArcOfGraph (parentTree, childWhichHasBeenAdded)) {
+                updateArc (childWhichHasBeenAdded, true);
+            } else if (parentTree == graphModel && childWhichHasBeenAdded.hasType (Tags::arcs)) {
                 resetMatrix();
-            } else if (nodeModels == parentTree && childWhichHasBeenAdded.hasType(Tags::node)) {
-                buildNodeArray();
-            } else if (childWhichHasBeenAdded.hasType (Tags::ports) || childWhichHasBeenAdded.hasType (Tags::port)) {
-                buildNodeArray();
-            } else if (childWhichHasBeenAdded.hasType (Tags::arcs) || childWhichHasBeenAdded.hasType (Tags::arc)) {
-                buildNodeArray();
+                repaint();
+            } else if (childWhichHasBeenAdded.hasType (Tags::nodes) || childWhichHasBeenAdded.hasType (Tags::node) ||
+                       childWhichHasBeenAdded.hasType (Tags::ports) || childWhichHasBeenAdded.hasType (Tags::port)) {
+                triggerAsyncUpdate();
             }
         }
         
         virtual void valueTreeChildRemoved (ValueTree& parentTree, ValueTree& childWhichHasBeenRemoved,
                                             int indexFromWhichChildWasRemoved) override
         {
-            if (parentTree == nodeModels.getParent() && childWhichHasBeenRemoved.hasType(Tags::nodes)) {
-                buildNodeArray();
+            if (isArcOfGraph (parentTree, childWhichHasBeenRemoved)) {
+                updateArc (childWhichHasBeenRemoved, false);
+            } else if (parentTree == graphModel && childWhichHasBeenRemoved.hasType (Tags::arcs)) {
                 resetMatrix();
-            } else if (nodeModels == parentTree && childWhichHasBeenRemoved.hasType (Tags::node)) {
-                buildNodeArray();
-            } else if (childWhichHasBeenRemoved.hasType (Tags::ports) || childWhichHasBeenRemoved.hasType(Tags::port)) {
-                buildNodeArray();
-            } else if (childWhichHasBeenRemoved.hasType (Tags::arcs) || childWhichHasBeenRemoved.hasType (Tags::arc)) {
-                buildNodeArray();
+                repaint();
+            } else if (childWhichHasBeenRemoved.hasType (Tags::nodes) || childWhichHasBeenRemoved.hasType (Tags::node) ||
+                       childWhichHasBeenRemoved.hasType (Tags::ports) || childWhichHasBeenRemoved.hasType (Tags::port)) {
+                triggerAsyncUpdate();
             }
         }
         
@@ -567,8 +661,7 @@ namespace Element
         {
             if (auto *scroll = &getVerticalScrollBar())
             {
-                matrix->setOffsetY (-roundToInt (scroll->getCurrentRangeStart()));
-                matrix->repaint();
+                matrix->setScrollOffsetY (-roundToInt (scroll->getCurrentRangeStart()));
             }
         }
         
@@ -649,8 +742,7 @@ namespace Element
         {
             if (auto *scroll = getHorizontalScrollBar())
             {
-                matrix->setOffsetX (-roundToInt (scroll->getCurrentRangeStart()));
-                matrix->repaint();
+                matrix->setScrollOffsetX (-roundToInt (scroll->getCurrentRangeStart()));
             }
         }
 
@@ -732,10 +824,13 @@ namespace Element
         midiInIndexes.clearQuick(); midiInChannels.clearQuick();
         midiOutIndexes.clearQuick(); midiOutChannels.clearQuick();
         ins.clearQuick(); outs.clearQuick();
+        sourceLabels.clearQuick(); destinationLabels.clearQuick();
+        rowsByPort.clear(); columnsByPort.clear();
         int newNumRows = 0, newNumCols = 0, nodeIndex = 0;
 
         for (const Node& node : nodes)
         {
+            const int64 nodeId = (int64) node.getNodeId();
             const ValueTree ports (node.getPortsValueTree());
             for (int i = 0; i < ports.getNumChildren(); ++i)
             {
@@ -753,6 +848,8 @@ namespace Element
                     inIndexes.add (nodeIndex);
                     inChannels.add (i);
                     ins.add (port);
+                    destinationLabels.add (createLabel (node, port));
+                    columnsByPort.set (getPortKey (nodeId, (int) port.getIndex()), newNumCols);
                     ++newNumCols;
                 }
                 else
@@ -760,6 +857,8 @@ namespace Element
                     outIndexes.add (nodeIndex);
                     outChannels.add (i);
                     outs.add (port);
+                    sourceLabels.add (createLabel (node, port));
+                    rowsByPort.set (getPortKey (nodeId, (int) port.getIndex()), newNumRows);
                     ++newNumRows;
                 }
             }
@@ -493,12 +493,37 @@ ContentComponent::ContentComponent (AppController& ctl_)
 
     const Node node (getGlobals().getSession()->getCurrentGraph());
     setCurrentNode (node);
+    setOpenGLEnabled (getGlobals().getSettings().isOpenGLEnabled());
     
     resized();
 }
 
 ContentComponent::~ContentComponent() noexcept
 {
+    setOpenGLEnabled (false);
+}
+
+void ContentComponent::setOpenGLEnabled (bool enabled)
+{
+   #if EL_USE_OPENGL
+    if (enabled == isOpenGLEnabled())
+        return;
+
+    if (enabled)
+    {
+        openGL.reset (new OpenGLContext());
+        // only repaint when something changed, like the software renderer
+        openGL->setContinuousRepainting (false);
+        openGL->attachTo (*this);
+    }
+    else
+    {
+        openGL->detach();
+        openGL.reset();
+    }
+   #else
+    ignoreUnused (enabled);
+   #endif
 }
 
 
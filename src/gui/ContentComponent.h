@@ -170,6 +170,19 @@ public:
     
     Component* getExtraView() const { return extra.get(); }
 
+    //=========================================================================
+    /** Draws this and everything in it through an OpenGL context instead of
+        the software renderer, so wires and meters are filled on the GPU */
+    void setOpenGLEnabled (bool enabled);
+
+    /** Returns true if an OpenGL context is attached. Always false when
+        built without OpenGL */
+   #if EL_USE_OPENGL
+    bool isOpenGLEnabled() const noexcept { return openGL != nullptr; }
+   #else
+    bool isOpenGLEnabled() const noexcept { return false; }
+   #endif
+
     /** @internal */
     void paint (Graphics &g) override;
     /** @internal */
@@ -207,6 +220,10 @@ private:
     std::unique_ptr<Component> extra;
     int extraViewHeight = 44;
 
+   #if EL_USE_OPENGL
+    std::unique_ptr<OpenGLContext> openGL;
+   #endif
+
     bool statusBarVisible;
     int statusBarSize;
     bool toolBarVisible;
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "gui/GuiCommon.h"
+#include "engine/nodes/SubGraphProcessor.h"
 #include "session/PluginManager.h"
 #include "session/Presets.h"
 
@@ -210,12 +211,45 @@ public:
         int index = 30000;
         GraphNodePtr ptr = node.getGraphNode();
         menu.addItem (index++, "Mute input ports", ptr != nullptr, ptr && ptr->isMutingInputs());
-
+        menu.addItem (index++, "Freeze", ptr != nullptr && ptr->getAudioProcessor() != nullptr
+                                            && ! ptr->isAudioIONode() && ! ptr->isMidiIONode(),
+                      ptr && (ptr->isFrozen() || ptr->isFreezing()));
+
+        addProcessSubmenu (menu, index);
+        menu.addItem (index++, "Render ahead", ptr != nullptr && ptr->getAudioProcessor() != nullptr
+                                                  && ! ptr->isAudioIONode() && ! ptr->isMidiIONode(),
+                      node.isRenderingAhead());
         addOversamplingSubmenu (menu);
+        addRenderRateSubmenu (menu);
+        addLoadPrioritySubmenu (menu);
 
         addSubMenu ("Options", menu, ptr != nullptr);
     }
 
+    /** Group of the plugin host shared by every bridged node */
+    static String getSharedBridgeGroup() { return "shared"; }
+
+    /** Group of a plugin host used by this node alone */
+    String getOwnBridgeGroup() const
+    {
+        return node.getUuidString().isNotEmpty() ? node.getUuidString() : String (node.getNodeId());
+    }
+
+    inline void addProcessSubmenu (PopupMenu& menuToAddTo, int& index)
+    {
+        PopupMenu processMenu;
+        GraphNodePtr ptr = node.getGraphNode();
+        const bool canBridge = ptr != nullptr && ! ptr->isAudioIONode() && ! ptr->isMidiIONode()
+            && node.getFormat().toString() != "Element" && node.getFormat().toString() != "Internal";
+        const auto group = node.getBridgeGroup();
+
+        processMenu.addItem (index++, "Engine", canBridge, group.isEmpty());
+        processMenu.addItem (index++, "Shared plugin host", canBridge, group == getSharedBridgeGroup());
+        processMenu.addItem (index++, "Own plugin host", canBridge,
+                             group.isNotEmpty() && group != getSharedBridgeGroup());
+        menuToAddTo.addSubMenu ("Process", processMenu, canBridge);
+    }
+
     inline void addOversamplingSubmenu (PopupMenu& menuToAddTo)
     {
         PopupMenu osMenu;
@@ -225,14 +259,64 @@ public:
         if (ptr == nullptr || ptr->isAudioIONode() || ptr->isMidiIONode()) // not the right type of node
             return;
 
-        osMenu.addItem (index++, "1x", true, ptr->getOversamplingFactor() == 1);
-        osMenu.addItem (index++, "2x", true, ptr->getOversamplingFactor() == 2);
-        osMenu.addItem (index++, "4x", true, ptr->getOversamplingFactor() == 4);
-        osMenu.addItem (index++, "8x", true, ptr->getOversamplingFactor() == 8);
-                                                      
+        osMenu.addItem (index++, "1x", true, ptr->getRequestedOversamplingFactor() == 1);
+        osMenu.addItem (index++, "2x", true, ptr->getRequestedOversamplingFactor() == 2);
+        osMenu.addItem (index++, "4x", true, ptr->getRequestedOversamplingFactor() == 4);
+        osMenu.addItem (index++, "8x", true, ptr->getRequestedOversamplingFactor() == 8);
+
+        osMenu.addSeparator();
+        index = 40100;
+        for (int i = 0; i < GraphNode::NumOversamplingModes; ++i)
+        {
+            const auto mode = static_cast<GraphNode::OversamplingMode> (i);
+            osMenu.addItem (index++, GraphNode::getOversamplingModeName (mode), true,
+                            ptr->getOversamplingMode() == mode);
+        }
+
         menuToAddTo.addSubMenu ("Oversample", osMenu);
     }
 
+    inline void addLoadPrioritySubmenu (PopupMenu& menuToAddTo)
+    {
+        GraphNodePtr ptr = node.getGraphNode();
+        if (ptr == nullptr || ptr->isAudioIONode() || ptr->isMidiIONode())
+            return;
+
+        static const char* const names[] = { "Essential", "Normal", "Low" };
+        PopupMenu priorityMenu;
+        for (int i = 0; i < GraphNode::NumLoadPriorities; ++i)
+            priorityMenu.addItem (50300 + i, names[i], true, (int) ptr->getLoadPriority() == i);
+        menuToAddTo.addSubMenu ("Load Priority", priorityMenu);
+    }
+
+    /** Block sizes offered for subgraphs: 0, which follows the parent, then 256 to 4096 */
+    enum { numInnerBlockSizes = 6 };
+    static int getInnerBlockSizeOption (int index) { return index <= 0 ? 0 : 128 << index; }
+
+    inline void addRenderRateSubmenu (PopupMenu& menuToAddTo)
+    {
+        GraphNodePtr ptr = node.getGraphNode();
+        auto* sub = ptr != nullptr ? dynamic_cast<SubGraphProcessor*> (ptr->getAudioProcessor()) : nullptr;
+        if (sub == nullptr)
+            return;
+
+        PopupMenu rateMenu;
+        for (int division = 1; division <= RateBoundary::maxDivision; division *= 2)
+            rateMenu.addItem (50000 + division, division == 1 ? String ("Full rate") : "1/" + String (division) + " rate",
+                              true, sub->getRateDivision() == division);
+
+        rateMenu.addSeparator();
+        for (int i = 0; i < numInnerBlockSizes; ++i)
+        {
+            const int blockSize = getInnerBlockSizeOption (i);
+            rateMenu.addItem (50100 + i, blockSize == 0 ? String ("Parent block size")
+                                                        : String (blockSize) + " sample blocks",
+                              true, sub->getInnerBlockSize() == blockSize);
+        }
+
+        menuToAddTo.addSubMenu ("Render", rateMenu);
+    }
+
     inline void addReplaceSubmenu (PluginManager& plugins)
     {
         PopupMenu menu;
@@ -332,26 +416,8 @@ public:
         }
         else if (result >= 20000 && result < 30000)
         {
-            Node n (node);
-            const int index = result - 20000;
-            if (auto* const item = presetItems [index])
-            {
-                const auto data = Node::parse (item->file);
-                if (n.isValid() && data.isValid() && data.hasProperty (Tags::state))
-                {
-                    const String state = data.getProperty(Tags::state).toString();
-                    n.getValueTree().setProperty (Tags::state, state, 0);
-                    if (data.hasProperty (Tags::programState))
-                        n.getValueTree().setProperty (Tags::programState, data.getProperty (Tags::programState), 0);
-                    n.restorePluginState();
-                }
-
-                if (n.isValid() && data.isValid() && data.hasProperty (Tags::name))
-                {
-                    if (data[Tags::name].toString().isNotEmpty())
-                        n.setProperty (Tags::name, data[Tags::name]);
-                }
-            }
+            if (auto* const item = presetItems [result - 20000])
+                return new LoadPresetMessage (node, *item);
         }
         else if (result >= 30000 && result < 40000)
         {
@@ -361,11 +427,22 @@ public:
                 case 0:
                     node.setMuteInput (! node.isMutingInputs());
                     break;
+                case 1:
+                    toggleFreeze();
+                    break;
+                case 2:
+                    return new BridgeNodeMessage (node, String());
+                case 3:
+                    return new BridgeNodeMessage (node, getSharedBridgeGroup());
+                case 4:
+                    return new BridgeNodeMessage (node, getOwnBridgeGroup());
+                case 5:
+                    node.setRenderAhead (! node.isRenderingAhead());
+                    break;
             }
         }
         else if (result >= 40000 && result < 50000)
         {
-            const int osFactor = (int) powf(2, float (result - 40000));
             if (auto gNode = node.getGraphNode())
             {
                 auto* graph = gNode->getParentGraph();
@@ -373,15 +450,71 @@ public:
                 bool wasSuspended = graph->isSuspended();
                 graph->suspendProcessing (true);
                 graph->releaseResources();
-                gNode->setOversamplingFactor (osFactor);
+                if (result >= 40100)
+                    gNode->setOversamplingMode (static_cast<GraphNode::OversamplingMode> (result - 40100));
+                else
+                    gNode->setOversamplingFactor ((int) powf (2, float (result - 40000)));
                 graph->prepareToPlay (gNode->getParentGraph()->getSampleRate(), gNode->getParentGraph()->getBlockSize());
                 graph->suspendProcessing (wasSuspended);
             }
         }
+        else if (result >= 50000 && result < 50200)
+        {
+            auto gNode = node.getGraphNode();
+            if (auto* sub = gNode != nullptr ? dynamic_cast<SubGraphProcessor*> (gNode->getAudioProcessor()) : nullptr)
+            {
+                auto* graph = gNode->getParentGraph();
+                bool wasSuspended = graph->isSuspended();
+                graph->suspendProcessing (true);
+                graph->releaseResources();
+                if (result >= 50100)
+                    sub->setInnerBlockSize (getInnerBlockSizeOption (result - 50100));
+                else
+                    sub->setRateDivision (result - 50000);
+                graph->prepareToPlay (graph->getSampleRate(), graph->getBlockSize());
+                graph->suspendProcessing (wasSuspended);
+            }
+        }
+        else if (result >= 50300 && result < 50300 + GraphNode::NumLoadPriorities)
+        {
+            if (auto gNode = node.getGraphNode())
+                gNode->setLoadPriority (static_cast<GraphNode::LoadPriority> (result - 50300));
+        }
         
         return nullptr;
     }
     
+    /** Seconds rendered when freezing a node from the menu */
+    static constexpr double freezeSeconds = 30.0;
+
+    void toggleFreeze()
+    {
+        GraphNodePtr ptr = node.getGraphNode();
+        if (ptr == nullptr)
+            return;
+
+        if (ptr->isFrozen() || ptr->isFreezing())
+        {
+            ptr->unfreeze();
+            return;
+        }
+
+        const auto name = node.getUuidString().isNotEmpty() ? node.getUuidString()
+                                                            : String (node.getNodeId());
+        const auto file = DataPath::applicationDataDir().getChildFile ("Freeze")
+                                                        .getChildFile (name + ".wav");
+        file.getParentDirectory().createDirectory();
+
+        auto showFailure = [] (const Result& result)
+        {
+            if (result.failed())
+                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Freeze",
+                                                  result.getErrorMessage());
+        };
+
+        showFailure (ptr->freeze (file, freezeSeconds, showFailure));
+    }
+
     Message* showAndCreateMessage()
     {
         return createMessageForResultCode (this->show());
@@ -96,6 +96,36 @@ private:
     GraphEditorComponent& editor;
 };
 
+//=============================================================================
+/** Builds a wire's filled outline and the wider outline it's hit tested with */
+static void createWirePaths (Path& linePath, Path& hitPath, Point<float> start,
+                             Point<float> end, bool vertical)
+{
+    const auto x1 = start.x, y1 = start.y, x2 = end.x, y2 = end.y;
+    linePath.clear();
+    linePath.startNewSubPath (x1, y1);
+
+    if (vertical)
+    {
+        linePath.cubicTo (x1, y1 + (y2 - y1) * 0.33f,
+                          x2, y1 + (y2 - y1) * 0.66f,
+                          x2, y2);
+    }
+    else
+    {
+        linePath.cubicTo (x1 + (x2 - x1) * 0.33f, y1,
+                          x1 + (x2 - x1) * 0.66f, y2,
+                          x2, y2);
+    }
+
+    PathStrokeType wideStroke (8.0f);
+    wideStroke.createStrokedPath (hitPath, linePath);
+
+    PathStrokeType stroke (2.5f);
+    stroke.createStrokedPath (linePath, linePath);
+    linePath.setUsingNonZeroWinding (true);
+}
+
 //=============================================================================
 class ConnectorComponent   : public Component,
                              public SettableTooltipClient
@@ -289,50 +319,8 @@ public:
         x2 -= getX();
         y2 -= getY();
 
-        linePath.clear();
-        linePath.startNewSubPath (x1, y1);
-        const bool vertical = getGraphPanel()->isLayoutVertical();
-        
-        if (vertical)
-        {
-            linePath.cubicTo (x1, y1 + (y2 - y1) * 0.33f,
-                              x2, y1 + (y2 - y1) * 0.66f,
-                              x2, y2);
-        }
-        else
-        {
-            linePath.cubicTo (x1 + (x2 - x1) * 0.33f, y1,
-                              x1 + (x2 - x1) * 0.66f, y2,
-                              x2, y2);
-        }
-        
-        PathStrokeType wideStroke (8.0f);
-        wideStroke.createStrokedPath (hitPath, linePath);
-
-        PathStrokeType stroke (2.5f);
-        stroke.createStrokedPath (linePath, linePath);
-
-        const bool showArrow = false;
-        
-        if (showArrow)
-        {
-            const float arrowW = 5.0f;
-            const float arrowL = 4.0f;
-
-            Path arrow;
-            arrow.addTriangle (-arrowL, arrowW,
-                               -arrowL, -arrowW,
-                               arrowL, 0.0f);
-
-            arrow.applyTransform (AffineTransform()
-                                    .rotated (float_Pi * 0.5f - (float) atan2 (x2 - x1, y2 - y1))
-                                    .translated ((x1 + x2) * 0.5f,
-                                                 (y1 + y2) * 0.5f));
-
-            linePath.addPath (arrow);
-        }
-
-        linePath.setUsingNonZeroWinding (true);
+        createWirePaths (linePath, hitPath, { x1, y1 }, { x2, y2 },
+                         getGraphPanel()->isLayoutVertical());
     }
 
     uint32 sourceFilterID { KV_INVALID_PORT }, 
@@ -363,23 +351,360 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConnectorComponent)
 };
 
+//=============================================================================
+/** Every wire of the graph, drawn as one layer behind the blocks.
+
+    Wires are kept in a grid of cells so hit testing and drawing only look at
+    the ones near a point or inside an area. The wires inside the visible area
+    and a margin around it are drawn into a cached image, which is reused
+    until a wire changes or the view moves past it. */
+class ConnectorLayer : public Component
+{
+public:
+    ConnectorLayer (GraphEditorComponent& e)
+        : editor (e) { }
+
+    ~ConnectorLayer() { }
+
+    /** Adds and removes wires so they match the graph's arcs, then lays
+        out all of them */
+    void sync (const Node& graph)
+    {
+        const ValueTree arcs = graph.getArcsValueTree();
+        HashMap<String, int> current;
+        for (int i = 0; i < arcs.getNumChildren(); ++i)
+            if (! (bool) arcs.getChild (i).getProperty (Tags::missing, false))
+                current.set (getKey (Node::arcFromValueTree (arcs.getChild (i))), i);
+
+        for (int i = wires.size(); --i >= 0;)
+        {
+            auto* wire = wires.getUnchecked (i);
+            const auto key = getKey (wire->arc);
+            if (current.contains (key))
+            {
+                current.remove (key);
+                continue;
+            }
+
+            if (hovered == wire)
+                hovered = nullptr;
+            removeFromGrid (*wire);
+            wires.remove (i);
+        }
+
+        for (HashMap<String, int>::Iterator iter (current); iter.next();)
+            wires.add (new Wire (Node::arcFromValueTree (arcs.getChild (iter.getValue()))));
+
+        for (auto* wire : wires)
+            layout (*wire);
+        invalidate (getLocalBounds());
+    }
+
+    /** Lays out the wires of one node after it moved */
+    void updateNode (const uint32 nodeId)
+    {
+        for (auto* wire : wires)
+        {
+            if (wire->arc.sourceNode != nodeId && wire->arc.destNode != nodeId)
+                continue;
+            const auto oldArea = wire->area;
+            layout (*wire);
+            invalidate (oldArea.getUnion (wire->area));
+        }
+    }
+
+    void clear()
+    {
+        hovered = nullptr;
+        wires.clear();
+        grid.clear();
+        invalidate (getLocalBounds());
+    }
+
+    int getNumWires() const noexcept { return wires.size(); }
+
+    //=========================================================================
+    void paint (Graphics& g) override
+    {
+        const auto clip = g.getClipBounds();
+        if (! cacheValid || ! cachedArea.contains (clip))
+            renderCache (clip);
+
+        g.drawImageAt (cache, cachedArea.getX(), cachedArea.getY());
+
+        if (hovered != nullptr || dragged != nullptr)
+        {
+            g.setColour (wireColour.brighter (0.2f));
+            g.fillPath ((hovered != nullptr ? hovered : dragged)->line);
+        }
+    }
+
+    bool hitTest (int x, int y) override
+    {
+        return findWireAt ((float) x, (float) y) != nullptr;
+    }
+
+    void mouseMove (const MouseEvent& e) override
+    {
+        setHovered (findWireAt ((float) e.x, (float) e.y));
+    }
+
+    void mouseExit (const MouseEvent&) override
+    {
+        setHovered (nullptr);
+    }
+
+    void mouseDown (const MouseEvent& e) override
+    {
+        dragging = false;
+        dragged = isEnabled() ? findWireAt ((float) e.x, (float) e.y) : nullptr;
+    }
+
+    void mouseDrag (const MouseEvent& e) override
+    {
+        if (! dragging && dragged != nullptr && ! e.mouseWasClicked())
+        {
+            // the wire goes once the model drops the arc, keep what's needed
+            const auto arc = dragged->arc;
+            const bool isNearerSource = dragged->start.getDistanceFrom (e.position)
+                                      < dragged->end.getDistanceFrom (e.position);
+            dragging = true;
+            dragged = nullptr;
+            setHovered (nullptr);
+
+            ViewHelpers::postMessageFor (this, new RemoveConnectionMessage (
+                arc.sourceNode, arc.sourcePort, arc.destNode, arc.destPort, editor.graph));
+            editor.beginConnectorDrag (isNearerSource ? 0 : arc.sourceNode, (int) arc.sourcePort,
+                                       isNearerSource ? arc.destNode : 0, (int) arc.destPort, e);
+        }
+        else if (dragging)
+        {
+            editor.dragConnector (e);
+        }
+    }
+
+    void mouseUp (const MouseEvent& e) override
+    {
+        if (dragging)
+            editor.endDraggingConnector (e);
+        dragging = false;
+        dragged = nullptr;
+    }
+
+private:
+    struct Wire
+    {
+        Wire (const Arc& a) : arc (a) { }
+        Arc arc;
+        Point<float> start, end;
+        Path line, hit;
+        Rectangle<int> area;
+        uint32 mark = 0;
+    };
+
+    enum { cellSize = 128, cacheMargin = 256 };
+
+    GraphEditorComponent& editor;
+    OwnedArray<Wire> wires;
+    HashMap<int64, Array<Wire*>> grid;
+    Wire* hovered = nullptr;
+    Wire* dragged = nullptr;
+    bool dragging = false;
+    uint32 lastMark = 0;
+
+    Image cache;
+    Rectangle<int> cachedArea;
+    bool cacheValid = false;
+    const Colour wireColour { Colours::black.brighter() };
+
+    static String getKey (const Arc& arc)
+    {
+        return String (arc.sourceNode) + "." + String (arc.sourcePort) + "."
+             + String (arc.destNode) + "." + String (arc.destPort);
+    }
+
+    static int64 getCell (int cx, int cy) noexcept
+    {
+        return ((int64) cx << 32) | (int64) (uint32) cy;
+    }
+
+    static Rectangle<int> getCells (Rectangle<int> area) noexcept
+    {
+        const auto x1 = area.getX() >= 0 ? area.getX() / cellSize : -1 - (-area.getX() - 1) / cellSize;
+        const auto y1 = area.getY() >= 0 ? area.getY() / cellSize : -1 - (-area.getY() - 1) / cellSize;
+        const auto x2 = area.getRight() >= 0 ? area.getRight() / cellSize : -1 - (-area.getRight() - 1) / cellSize;
+        const auto y2 = area.getBottom() >= 0 ? area.getBottom() / cellSize : -1 - (-area.getBottom() - 1) / cellSize;
+        return { x1, y1, x2 - x1 + 1, y2 - y1 + 1 };
+    }
+
+    void addToGrid (Wire& wire)
+    {
+        const auto cells = getCells (wire.area);
+        for (int cx = cells.getX(); cx < cells.getRight(); ++cx)
+        {
+            for (int cy = cells.getY(); cy < cells.getBottom(); ++cy)
+            {
+                auto list = grid [getCell (cx, cy)];
+                list.add (&wire);
+                grid.set (getCell (cx, cy), list);
+            }
+        }
+    }
+
+    void removeFromGrid (Wire& wire)
+    {
+        if (wire.area.isEmpty())
+            return;
+        const auto cells = getCells (wire.area);
+        for (int cx = cells.getX(); cx < cells.getRight(); ++cx)
+        {
+            for (int cy = cells.getY(); cy < cells.getBottom(); ++cy)
+            {
+                auto list = grid [getCell (cx, cy)];
+                list.removeFirstMatchingValue (&wire);
+                if (list.isEmpty())
+                    grid.remove (getCell (cx, cy));
+                else
+                    grid.set (getCell (cx, cy), list);
+            }
+        }
+    }
+
+    /** Returns the wires whose bounds overlap an area, each once */
+    Array<Wire*> findWires (Rectangle<int> area)
+    {
+        Array<Wire*> found;
+        const auto mark = ++lastMark;
+        const auto cells = getCells (area);
+        for (int cx = cells.getX(); cx < cells.getRight(); ++cx)
+        {
+            for (int cy = cells.getY(); cy < cells.getBottom(); ++cy)
+            {
+                if (! grid.contains (getCell (cx, cy)))
+                    continue;
+                for (auto* wire : grid [getCell (cx, cy)])
+                {
+                    if (wire->mark == mark || ! wire->area.intersects (area))
+                        continue;
+                    wire->mark = mark;
+                    found.add (wire);
+                }
+            }
+        }
+        return found;
+    }
+
+    Wire* findWireAt (float x, float y)
+    {
+        const Point<float> pos (x, y);
+        for (auto* wire : findWires ({ (int) x - 1, (int) y - 1, 3, 3 }))
+        {
+            // avoid clicking the wire when over a pin
+            if (wire->hit.contains (x, y)
+                && wire->start.getDistanceFrom (pos) > 7.0f
+                && wire->end.getDistanceFrom (pos) > 7.0f)
+            {
+                return wire;
+            }
+        }
+        return nullptr;
+    }
+
+    void layout (Wire& wire)
+    {
+        removeFromGrid (wire);
+        wire.area = {};
+        auto* source = editor.getComponentForFilter (wire.arc.sourceNode);
+        auto* dest   = editor.getComponentForFilter (wire.arc.destNode);
+        if (source == nullptr || dest == nullptr)
+        {
+            wire.line.clear();
+            wire.hit.clear();
+            return;
+        }
+
+        source->getPortPos ((int) wire.arc.sourcePort, false, wire.start.x, wire.start.y);
+        dest->getPortPos ((int) wire.arc.destPort, true, wire.end.x, wire.end.y);
+        createWirePaths (wire.line, wire.hit, wire.start, wire.end, editor.isLayoutVertical());
+        wire.area = wire.hit.getBounds().getSmallestIntegerContainer().expanded (1);
+        addToGrid (wire);
+    }
+
+    void setHovered (Wire* wire)
+    {
+        if (hovered == wire)
+            return;
+        if (hovered != nullptr)
+            repaint (hovered->area);
+        hovered = wire;
+        if (hovered != nullptr)
+            repaint (hovered->area);
+    }
+
+    void invalidate (Rectangle<int> area)
+    {
+        cacheValid = false;
+        if (! area.isEmpty())
+            repaint (area);
+    }
+
+    Rectangle<int> getVisibleArea() const
+    {
+        if (auto* viewport = findParentComponentOfClass<Viewport>())
+            if (auto* viewed = viewport->getViewedComponent())
+                return getLocalArea (viewed, viewport->getViewArea());
+        return getLocalBounds();
+    }
+
+    void renderCache (Rectangle<int> clip)
+    {
+        cachedArea = getVisibleArea().getUnion (clip).expanded (cacheMargin)
+                                     .getIntersection (getLocalBounds());
+        cacheValid = true;
+        if (cachedArea.isEmpty())
+        {
+            cache = Image();
+            return;
+        }
+
+        if (! cache.isValid() || cache.getWidth() != cachedArea.getWidth()
+                              || cache.getHeight() != cachedArea.getHeight())
+            cache = Image (Image::ARGB, cachedArea.getWidth(), cachedArea.getHeight(), true);
+        else
+            cache.clear (cache.getBounds());
+
+        Graphics g (cache);
+        g.setOrigin (-cachedArea.getX(), -cachedArea.getY());
+        g.setColour (wireColour);
+        for (auto* wire : findWires (cachedArea))
+            g.fillPath (wire->line);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConnectorLayer)
+};
+
 //=============================================================================
 GraphEditorComponent::GraphEditorComponent()
     : ViewHelperMixin (this)
 {
     factory.reset (new DefaultBlockFactory (*this));
+    connectors.reset (new ConnectorLayer (*this));
+    addAndMakeVisible (connectors.get(), 0);
     setOpaque (true);
     data.addListener (this);
 }
 
 GraphEditorComponent::~GraphEditorComponent()
 {
+    stopRefresh();
     data.removeListener (this);
     graph = Node();
     data = ValueTree();
     draggingConnector = nullptr;
     resizePositionsFrozen = false;
-    deleteAllChildren();
+    deleteBlocks();
+    removeChildComponent (connectors.get());
+    connectors.reset();
 
     factory.reset();
 }
@@ -396,12 +721,8 @@ void GraphEditorComponent::setNode (const Node& n)
     verticalLayout = graph.getProperty (Tags::vertical, true);
     resizePositionsFrozen = (bool) graph.getProperty (Tags::staticPos, false);
 
-    if (draggingConnector)
-        removeChildComponent (draggingConnector.get());
-    deleteAllChildren();
+    deleteBlocks();
     updateComponents();
-    if (draggingConnector)
-        addAndMakeVisible (draggingConnector.get());
     
     data.addListener (this);
 }
@@ -416,10 +737,24 @@ void GraphEditorComponent::setVerticalLayout (const bool isVertical)
         graph.setProperty ("vertical", verticalLayout);
     
     draggingConnector = nullptr;
-    deleteAllChildren();
+    deleteBlocks();
     updateComponents();
 }
 
+void GraphEditorComponent::deleteBlocks()
+{
+    // the layer and a wire being dragged aren't blocks
+    if (draggingConnector)
+        removeChildComponent (draggingConnector.get());
+    removeChildComponent (connectors.get());
+    deleteAllChildren();
+    blocks.clear();
+    connectors->clear();
+    addAndMakeVisible (connectors.get(), 0);
+    if (draggingConnector)
+        addAndMakeVisible (draggingConnector.get());
+}
+
 void GraphEditorComponent::paint (Graphics& g)
 {
    g.fillAll (findColour (Style::contentBackgroundColorId));
@@ -461,6 +796,7 @@ void GraphEditorComponent::mouseDown (const MouseEvent& e)
         menu.addSeparator();
         menu.addItem (5, "Change orientation...");
         menu.addItem (7, "Gather nodes...");
+        menu.addItem (8, "Show DSP load", true, areProcessTimesVisible());
        #if JUCE_DEBUG
         menu.addItem (100, "Misc testing item...");
        #endif
@@ -516,6 +852,11 @@ void GraphEditorComponent::mouseDown (const MouseEvent& e)
                     setVerticalLayout (! isLayoutVertical());
                     return;
                     break;
+
+                case 8:
+                    setProcessTimesVisible (! areProcessTimesVisible());
+                    return;
+                    break;
                 
                 case 7:
                 {
@@ -611,29 +952,8 @@ void GraphEditorComponent::createNewPlugin (const PluginDescription* desc, int x
 
 BlockComponent* GraphEditorComponent::getComponentForFilter (const uint32 filterID) const
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
-    {
-        if (BlockComponent* const fc = dynamic_cast <BlockComponent*> (getChildComponent (i)))
-            if (fc->filterID == filterID)
-                return fc;
-    }
-
-    return nullptr;
-}
-
-ConnectorComponent* GraphEditorComponent::getComponentForConnection (const Arc& arc) const
-{
-    for (int i = getNumChildComponents(); --i >= 0;)
-    {
-        if (ConnectorComponent* const c = dynamic_cast <ConnectorComponent*> (getChildComponent (i)))
-            if (c->sourceFilterID == arc.sourceNode
-                 && c->destFilterID == arc.destNode
-                 && c->sourceFilterChannel == arc.sourcePort
-                 && c->destFilterChannel == arc.destPort)
-                return c;
-    }
-
-    return nullptr;
+    // blocks delete themselves once their node is gone
+    return blocks.contains (filterID) ? blocks [filterID].getComponent() : nullptr;
 }
 
 PortComponent* GraphEditorComponent::findPinAt (const int x, const int y) const
@@ -653,6 +973,7 @@ PortComponent* GraphEditorComponent::findPinAt (const int x, const int y) const
 
 void GraphEditorComponent::resized()
 {
+    connectors->setBounds (getLocalBounds());
     updateBlockComponents (! areResizePositionsFrozen());
     updateConnectorComponents();
 }
@@ -664,24 +985,12 @@ void GraphEditorComponent::changeListenerCallback (ChangeBroadcaster*)
 
 void GraphEditorComponent::updateConnectorComponents()
 {
-    const ValueTree arcs = graph.getArcsValueTree();
-    for (int i = getNumChildComponents(); --i >= 0;)
-    {
-        ConnectorComponent* const cc = dynamic_cast <ConnectorComponent*> (getChildComponent (i));
-        if (cc != nullptr && cc != draggingConnector.get())
-        {
-            if (! Node::connectionExists (arcs, cc->sourceFilterID, (uint32) cc->sourceFilterChannel, 
-                                                cc->destFilterID, (uint32) cc->destFilterChannel,
-                                                true))
-            {
-                delete cc;
-            }
-            else
-            {
-                cc->update();
-            }
-        }
-    }
+    connectors->sync (graph);
+}
+
+void GraphEditorComponent::updateConnectorsFor (const uint32 nodeId)
+{
+    connectors->updateNode (nodeId);
 }
 
 void GraphEditorComponent::updateBlockComponents (const bool doPosition)
@@ -700,33 +1009,14 @@ void GraphEditorComponent::stabilizeNodes()
 
 void GraphEditorComponent::updateComponents()
 {
-    for (int i = graph.getNumConnections(); --i >= 0;)
-    {
-        const ValueTree c = graph.getConnectionValueTree (i);
-        const Arc arc (Node::arcFromValueTree (c));
-        ConnectorComponent* connector = getComponentForConnection (arc);
-        
-        if (connector == nullptr)
-        {
-            connector = new ConnectorComponent (graph);
-            addAndMakeVisible (connector, i);
-        }
-        
-        connector->setGraph (this->graph);
-        connector->setInput (arc.sourceNode, arc.sourcePort);
-        connector->setOutput (arc.destNode, arc.destPort);
-    }
-    
     for (int i = graph.getNumNodes(); --i >= 0;)
     {
         const Node node (graph.getNode (i));
-        BlockComponent* comp = getComponentForFilter (node.getNodeId());
-        if (comp == nullptr)
-        {
-            comp = createBlock (node);
-            jassert (comp != nullptr);
-            addAndMakeVisible (comp, i + 10000);
-        }
+        if (getComponentForFilter (node.getNodeId()) != nullptr)
+            continue;
+        auto* comp = createBlock (node);
+        jassert (comp != nullptr);
+        addAndMakeVisible (comp, i + 10000);
     }
 
     updateBlockComponents (true);
@@ -1059,19 +1349,49 @@ void GraphEditorComponent::updateSelection()
     for (int i = getNumChildComponents(); --i >= 0;)
     {
         if (auto* const block = dynamic_cast <BlockComponent*> (getChildComponent (i)))
-        { 
             block->repaint();
-            MessageManager::getInstance()->runDispatchLoopUntil (20);
-        }
     }
 }
 
 BlockComponent* GraphEditorComponent::createBlock (const Node& node)
 {
     if (auto* cc = ViewHelpers::findContentComponent (this))
-        return factory->createBlockComponent (cc->getAppController(), node);
+    {
+        auto* block = factory->createBlockComponent (cc->getAppController(), node);
+        if (block != nullptr)
+        {
+            block->setProcessTimeVisible (showProcessTimes);
+            blocks.set (node.getNodeId(), block);
+        }
+        return block;
+    }
+
     jassertfalse;
     return nullptr;
 }
 
+void GraphEditorComponent::setProcessTimesVisible (bool visible)
+{
+    if (showProcessTimes == visible)
+        return;
+
+    showProcessTimes = visible;
+    for (int i = 0; i < getNumChildComponents(); ++i)
+        if (auto* block = dynamic_cast<BlockComponent*> (getChildComponent (i)))
+            block->setProcessTimeVisible (showProcessTimes);
+
+    if (showProcessTimes)
+        startRefresh (4);
+    else
+        stopRefresh();
+}
+
+void GraphEditorComponent::refreshCallback()
+{
+    for (int i = 0; i < getNumChildComponents(); ++i)
+        if (auto* block = dynamic_cast<BlockComponent*> (getChildComponent (i)))
+            if (block->isProcessTimeVisible())
+                block->repaint();
+}
+
 }
@@ -21,6 +21,7 @@
 
 #include "ElementApp.h"
 #include "engine/GraphProcessor.h"
+#include "gui/RefreshClock.h"
 #include "gui/ViewHelpers.h"
 
 namespace Element {
@@ -28,14 +29,22 @@ namespace Element {
 class BlockComponent;
 class BlockFactory;
 class ConnectorComponent;
+class ConnectorLayer;
 class PortComponent;
 class PluginWindow;
 
-/** A panel that displays and edits a GraphProcessor. */
+/** A panel that displays and edits a GraphProcessor.
+
+    Blocks are components, found by node ID through an index. Wires aren't:
+    a single layer behind the blocks keeps them in a grid for hit testing,
+    draws the visible ones into a cached image and only rebuilds the wires of
+    blocks that move. Model changes are diffed against what's shown, so
+    editing a large graph doesn't rebuild all of it. */
 class GraphEditorComponent   : public Component,
                                public ChangeListener,
                                public DragAndDropTarget,
                                private ValueTree::Listener,
+                               private RefreshClient,
                                public ViewHelperMixin
 {
 public:
@@ -62,6 +71,12 @@ public:
 
     Rectangle<int> getRequiredSpace() const;
 
+    /** Shows or hides the render time of each node over its block */
+    void setProcessTimesVisible (bool visible);
+
+    /** Returns true if render times are shown */
+    bool areProcessTimesVisible() const noexcept { return showProcessTimes; }
+
     /** Stabilize all nodes without changing position */
     void stabilizeNodes();
 
@@ -96,6 +111,7 @@ protected:
     
 private:
     friend class ConnectorComponent;
+    friend class ConnectorLayer;
     friend class BlockComponent;
     friend class PortComponent;
 
@@ -107,9 +123,12 @@ private:
     float lastDropY = 0.5f;
 
     std::unique_ptr<ConnectorComponent> draggingConnector;
+    std::unique_ptr<ConnectorLayer> connectors;
+    HashMap<uint32, Component::SafePointer<BlockComponent>> blocks;
     std::unique_ptr<BlockFactory> factory;
 
     bool verticalLayout = true;
+    bool showProcessTimes = false;
     
     SelectedItemSet<uint32> selectedNodes;
     bool ignoreNodeSelected = false;
@@ -122,6 +141,8 @@ private:
     
     void updateBlockComponents (const bool doPosition = true);
     void updateConnectorComponents();
+    void updateConnectorsFor (const uint32 nodeId);
+    void deleteBlocks();
     
     void beginConnectorDrag (const uint32 sourceFilterID, const int sourceFilterChannel,
                              const uint32 destFilterID, const int destFilterChannel,
@@ -132,10 +153,10 @@ private:
     BlockComponent* createBlock (const Node&);
 
     BlockComponent* getComponentForFilter (const uint32 filterID) const;
-    ConnectorComponent* getComponentForConnection (const Arc& conn) const;
     PortComponent* findPinAt (const int x, const int y) const;
     
     void updateSelection();
+    void refreshCallback() override;
     
     void valueTreePropertyChanged (ValueTree& treeWhosePropertyHasChanged, const Identifier& property) override { }
     void valueTreeChildAdded (ValueTree& parentTree, ValueTree& childWhichHasBeenAdded) override;
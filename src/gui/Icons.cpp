@@ -29,6 +29,39 @@ const Icons& getIcons()
     return *__icons;
 }
 
+/** Masks beyond this are all dropped, sizes in use are filled again */
+static const int maxCachedMasks = 512;
+/** Icons bigger than this in either direction are filled every time */
+static const int maxMaskSize = 256;
+
+void Icon::draw (Graphics& g, const Rectangle<float>& area, bool isCrossedOut) const
+{
+    if (path == nullptr)
+        return;
+
+    g.setColour (colour);
+
+    const RectanglePlacement placement (RectanglePlacement::centred | RectanglePlacement::onlyReduceInSize);
+    const auto transform = placement.getTransformToFit (path->getBounds(), area);
+    const auto& icons = getIcons();
+    const auto bounds = path->getBounds().transformedBy (transform);
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const int width  = roundToInt (bounds.getWidth() * scale);
+    const int height = roundToInt (bounds.getHeight() * scale);
+
+    if (icons.contains (path) && width > 0 && height > 0 && width <= maxMaskSize && height <= maxMaskSize)
+        g.drawImage (icons.getMask (*path, width, height), bounds, RectanglePlacement::stretchToFit, true);
+    else
+        g.fillPath (*path, transform);
+
+    if (isCrossedOut)
+    {
+        g.setColour (Colours::red.withAlpha (0.8f));
+        g.drawLine ((float) area.getX(), area.getY() + area.getHeight() * 0.2f,
+                    (float) area.getRight(), area.getY() + area.getHeight() * 0.8f, 3.0f);
+    }
+}
+
 namespace IconPathData
 {
 const uint8 folder[] = { 110,109,16,236,21,65,23,92,1,67,98,109,85,179,66,117,43,194,66,104,113,41,67,158,152,127,66,0,0,122,67,56,148,0,66,98,101,12,142,67,78,113,22,66,219,15,136,67,49,43,156,66,242,228,142,67,119,29,199,66,98,206,123,151,67,20,243,28,67,198,52,149,67,118,
@@ -1421,4 +1454,44 @@ Icons::~Icons()
     __icons = nullptr;
 }
 
+bool Icons::contains (const Path* path) const noexcept
+{
+    const auto* const address = reinterpret_cast<const char*> (path);
+    return address >= reinterpret_cast<const char*> (&folder)
+        && address <= reinterpret_cast<const char*> (&fasRectangleLandscape);
+}
+
+Image Icons::getMask (const Path& path, int width, int height) const
+{
+    jassert (contains (&path));
+    const MaskKey key { &path, width, height };
+    auto iter = masks.find (key);
+    if (iter != masks.end())
+        return iter->second;
+
+    if ((int) masks.size() >= maxCachedMasks)
+        masks.clear();
+
+    Image mask (Image::SingleChannel, width, height, true);
+    {
+        Graphics g (mask);
+        g.setColour (Colours::white);
+        g.fillPath (path, RectanglePlacement (RectanglePlacement::stretchToFit).getTransformToFit (
+            path.getBounds(), { 0.f, 0.f, (float) width, (float) height }));
+    }
+
+    masks[key] = mask;
+    return mask;
+}
+
+void Icons::clearImageCache() const
+{
+    masks.clear();
+}
+
+int Icons::getNumCachedImages() const
+{
+    return (int) masks.size();
+}
+
 }
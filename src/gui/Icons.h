@@ -29,23 +29,9 @@ struct Icon
     Icon (const Path& p, const Colour& c)  : path (&p), colour (c) {}
     Icon (const Path* p, const Colour& c)  : path (p),  colour (c) {}
 
-    void draw (Graphics& g, const Rectangle<float>& area, bool isCrossedOut) const
-    {
-        if (path != nullptr)
-        {
-            g.setColour (colour);
-
-            const RectanglePlacement placement (RectanglePlacement::centred | RectanglePlacement::onlyReduceInSize);
-            g.fillPath (*path, placement.getTransformToFit (path->getBounds(), area));
-
-            if (isCrossedOut)
-            {
-                g.setColour (Colours::red.withAlpha (0.8f));
-                g.drawLine ((float) area.getX(), area.getY() + area.getHeight() * 0.2f,
-                            (float) area.getRight(), area.getY() + area.getHeight() * 0.8f, 3.0f);
-            }
-        }
-    }
+    /** Draws the icon fitted to an area. Paths that belong to Icons are
+        drawn from images cached for the size and display scale */
+    void draw (Graphics& g, const Rectangle<float>& area, bool isCrossedOut) const;
 
     Icon withContrastingColourTo (const Colour& background) const
     {
@@ -61,6 +47,21 @@ class Icons : public DeletedAtShutdown
 public:
     Icons();
     ~Icons();
+
+    /** Returns true if a path is one of these icons */
+    bool contains (const Path* path) const noexcept;
+
+    /** Returns one of these icons filled to a size in physical pixels, as a
+        mask to be drawn with the current colour. The mask is kept until the
+        cache is cleared, so the path is only filled once per size */
+    Image getMask (const Path& path, int width, int height) const;
+
+    /** Drops every cached mask */
+    void clearImageCache() const;
+
+    /** Returns the number of masks that are cached */
+    int getNumCachedImages() const;
+
     Path folder, document, imageDoc,
          config, exporter, juceLogo,
          graph, jigsaw, info, warning,
@@ -79,6 +80,20 @@ public:
          fasRectangleLandscape;
 
 private:
+    struct MaskKey
+    {
+        const Path* path;
+        int width, height;
+        bool operator< (const MaskKey& o) const noexcept
+        {
+            if (path != o.path)
+                return std::less<const Path*>() (path, o.path);
+            return width != o.width ? width < o.width : height < o.height;
+        }
+    };
+
+    mutable std::map<MaskKey, Image> masks;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Icons)
 };
 
@@ -156,14 +156,25 @@ MidiEditorBody::clipChangedTrack (TimelineClip *clip, int trackDelta)
 void
 MidiEditorBody::findLassoItemsInArea (Array <NoteClipItem*>& itemsFound, const Rectangle<int>& area)
 {
-    for (int i = 0; i < notes.size(); ++i)
-    {
-        NoteClipItem* note = notes.getUnchecked(i);
-        if (area.intersects (note->getBounds())) {
-            itemsFound.add (note);
-            selected.addToSelection (note);
-        } else {
+    // only notes that were selected can need deselecting
+    const SelectedNotes previous (selected.getItemArray());
+    for (auto* note : previous)
+        if (! area.intersects (note->getBounds()))
             selected.deselect (note);
+
+    // tracks run from the top key down, and edges off the tracks reach the end
+    const int bottomTrack = trackAt (area.getBottomLeft());
+    const int topTrack    = trackAt (area.getTopLeft());
+    const int firstKey = bottomTrack >= 0 ? jlimit (0, 127, 127 - bottomTrack) : 0;
+    const int lastKey  = topTrack >= 0    ? jlimit (0, 127, 127 - topTrack) : 127;
+    for (int key = firstKey; key <= lastKey; ++key)
+    {
+        for (auto* note : notesOnKey [key])
+        {
+            if (area.intersects (note->getBounds())) {
+                itemsFound.add (note);
+                selected.addToSelection (note);
+            }
         }
     }
 }
@@ -237,22 +248,61 @@ void MidiEditorBody::onNoteAdded (const Note& note)
         }
 
         notes.add (c);
+        indexNote (c);
         addTimelineClip (c, 127 - c->keyId());
     }
 }
 
 void MidiEditorBody::onNoteRemoved (const Note& note)
 {
-    for (int i = 0; i < notes.size(); ++i)
-    {
-        NoteClipItem* const clip = notes.getUnchecked (i);
-        if (clip->note() == note)
-        {
-            notes.removeFirstMatchingValue (clip);
-            unloadNote (clip);
-            break;
-        }
-    }
+    NoteClipItem* const clip = notesById [note.eventId()];
+    if (clip == nullptr || clip->note() != note)
+        return;
+
+    unindexNote (clip);
+    notes.removeFirstMatchingValue (clip);
+    unloadNote (clip);
+}
+
+void MidiEditorBody::indexNote (NoteClipItem* clip)
+{
+    const int id = ++lastNoteId;
+    const int key = jlimit (0, 127, clip->keyId());
+    notesById.set (id, clip);
+    keysById.set (id, key);
+    notesOnKey[key].add (clip);
+    clip->note().setEventId (id);
+}
+
+void MidiEditorBody::unindexNote (NoteClipItem* clip)
+{
+    const int id = clip->note().eventId();
+    if (! keysById.contains (id))
+        return;
+
+    notesOnKey[keysById[id]].removeFirstMatchingValue (clip);
+    notesById.remove (id);
+    keysById.remove (id);
+}
+
+void MidiEditorBody::reindexNote (NoteClipItem* clip)
+{
+    const int id = clip->note().eventId();
+    const int key = jlimit (0, 127, clip->keyId());
+    if (! keysById.contains (id) || keysById[id] == key)
+        return;
+
+    notesOnKey[keysById[id]].removeFirstMatchingValue (clip);
+    notesOnKey[key].add (clip);
+    keysById.set (id, key);
+}
+
+void MidiEditorBody::clearIndex()
+{
+    for (auto& clips : notesOnKey)
+        clips.clearQuick();
+    notesById.clear();
+    keysById.clear();
 }
 
 void MidiEditorBody::showAllTracks()
@@ -281,6 +331,7 @@ void MidiEditorBody::setNoteSequence (const NoteSequence& s)
     selected.deselectAll();
     foreachNote (std::bind (&MidiEditorBody::unloadNote, this, std::placeholders::_1));
     notes.clear();
+    clearIndex();
 
     for (int32 c = sequenceNode.getNumChildren(); --c >= 0;)
     {
@@ -338,14 +389,20 @@ void MidiEditorBody::paintTrackLane (Graphics &g, int track, const Rectangle<int
 
 void MidiEditorBody::selectNotesOnKey (int key, bool deselectOthers)
 {
-    for (int i = 0; i < notes.size(); ++i)
+    if (deselectOthers)
     {
-        NoteClipItem* const n = notes.getUnchecked (i);
-        if (n->keyId() == key && n->channel() == insertChannel)
-            selected.addToSelection (n);
-        else if (deselectOthers)
-            selected.deselect (n);
+        const SelectedNotes previous (selected.getItemArray());
+        for (auto* n : previous)
+            if (n->keyId() != key || n->channel() != insertChannel)
+                selected.deselect (n);
     }
+
+    if (! isPositiveAndBelow (key, 128))
+        return;
+
+    for (auto* n : notesOnKey [key])
+        if (n->channel() == insertChannel)
+            selected.addToSelection (n);
 }
 
 void MidiEditorBody::setVisibleChannel (int chan, bool updateInsertChannel)
@@ -446,7 +503,21 @@ void MidiEditorBody::valueTreeChildRemoved (ValueTree& parent, ValueTree& child,
     }
 }
 
-void MidiEditorBody::valueTreePropertyChanged (ValueTree& tree, const Identifier& property) {}
+void MidiEditorBody::valueTreePropertyChanged (ValueTree& tree, const Identifier& property)
+{
+    if (tree.getParent() != sequenceNode || ! tree.hasType (Slugs::note))
+        return;
+    if (property != Slugs::id && property != Slugs::velocity)
+        return;
+
+    // only the changed note is indexed again and repainted
+    if (NoteClipItem* const clip = notesById [Note (tree).eventId()])
+    {
+        if (property == Slugs::id)
+            reindexNote (clip);
+        clip->updateLook();
+    }
+}
 void MidiEditorBody::valueTreeChildOrderChanged (ValueTree& parent, int, int) {}
 void MidiEditorBody::valueTreeParentChanged (ValueTree& child) {}
 
@@ -135,6 +135,18 @@ private:
 
     Array<NoteClipItem*> notes;
 
+    // notes are found by key, and by the event id they're given when loaded,
+    // so picking, lassoing and model changes don't walk every note
+    Array<NoteClipItem*> notesOnKey [128];
+    HashMap<int, NoteClipItem*> notesById;
+    HashMap<int, int> keysById;
+    int lastNoteId = 0;
+
+    void indexNote (NoteClipItem* clip);
+    void unindexNote (NoteClipItem* clip);
+    void reindexNote (NoteClipItem* clip);
+    void clearIndex();
+
     //Signal<void()> changedSignal;
     OptionalScopedPointer<NoteSequence> sequence;
 
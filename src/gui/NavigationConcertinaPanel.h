@@ -525,7 +525,8 @@ public:
         addPanelInternal (-1, mv, "MIDI", nullptr);
        #endif
        
-        auto* pv = new PluginsPanelView (ViewHelpers::getGlobals(this)->getPluginManager());
+        auto* world = ViewHelpers::getGlobals (this);
+        auto* pv = new PluginsPanelView (world->getPluginManager(), world->getDatabase());
         pv->setName ("Plugins");
         pv->setComponentID ("Plugins");
         addPanelInternal (-1, pv, "Plugins", 0);
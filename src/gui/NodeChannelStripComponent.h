@@ -23,12 +23,13 @@
 #include "controllers/GuiController.h"
 #include "engine/GraphNode.h"
 #include "gui/ChannelStripComponent.h"
+#include "gui/RefreshClock.h"
 #include "Signals.h"
 
 namespace Element {
 
 class NodeChannelStripComponent : public Component,
-                                  public Timer,
+                                  public RefreshClient,
                                   public ComboBox::Listener,
                                   private Value::Listener
 {
@@ -49,6 +50,10 @@ public:
                 node.setProperty (Tags::name, nodeName.getText());
         };
 
+        addAndMakeVisible (dspLoad);
+        dspLoad.setJustificationType (Justification::centred);
+        dspLoad.setFont (9.f);
+
         addAndMakeVisible (channelBox);
         channelBox.setJustificationType (Justification::centred);
 
@@ -60,6 +65,7 @@ public:
 
     ~NodeChannelStripComponent()
     {
+        setMeteredNode (nullptr);
         unbindSignals();
     }
 
@@ -104,7 +110,7 @@ public:
     {
         auto r (getLocalBounds());
         nodeName.setBounds (r.removeFromTop(22).reduced (2));
-        r.removeFromTop (10); // padding between strip title and IO boxes
+        dspLoad.setBounds (r.removeFromTop (10));
 
         auto r2 = r.removeFromBottom (jmin (268, r.getHeight()));
         int boxSize = r2.getWidth() - 8;
@@ -121,11 +127,12 @@ public:
         g.drawLine (getWidth() - 1.f, 0.0, getWidth() - 1.f, getHeight());
     }
 
-    inline void timerCallback() override
+    inline void refreshCallback() override
     {
         auto& meter = channelStrip.getDigitalMeter();
         if (GraphNodePtr ptr = node.getGraphNode())
         {
+            setMeteredNode (ptr.get());
             const int startChannel = jmax (0, channelBox.getSelectedId() - 1);
             if (ptr->getNumAudioOutputs() == 1)
             {
@@ -154,11 +161,15 @@ public:
             channelStrip.setPower (! ptr->isSuspended(), false);
             if (channelStrip.isMuted() != ptr->isMuted())
                 channelStrip.setMuted (ptr->isMuted(), false);
+
+            updateDspLoad (*ptr);
         }
         else
         {
+            dspLoad.setText (String(), dontSendNotification);
             meter.resetPeaks();
-            stopTimer();
+            setMeteredNode (nullptr);
+            stopRefresh();
         }
 
         meter.refresh();
@@ -196,7 +207,7 @@ public:
 
     inline void setNode (const Node& newNode)
     {
-        stopTimer();
+        stopRefresh();
         node = newNode;
         isAudioOutNode = node.isAudioOutputNode();
         isAudioInNode  = node.isAudioInputNode();
@@ -204,7 +215,8 @@ public:
         node.getPorts (audioIns, audioOuts, PortType::Audio);
         displayName.referTo (node.getPropertyAsValue (Tags::name));
         stabilizeContent();
-        startTimerHz (meterSpeedHz);
+        setMeteredNode (node.getGraphNode());
+        startRefresh (meterSpeedHz);
 
         if (onNodeChanged)
             onNodeChanged();
@@ -251,6 +263,7 @@ private:
     friend class NodeChannelStripView;
     GuiController& gui;
     Label nodeName;
+    Label dspLoad;
     Node node;
     PortArray audioIns, audioOuts;
     ComboBox channelBox, flowBox;
@@ -267,6 +280,40 @@ private:
 
     Value displayName;
 
+    // the engine only measures levels of nodes that are being displayed
+    GraphNodePtr meteredNode;
+    void setMeteredNode (GraphNode* newNode)
+    {
+        if (meteredNode.get() == newNode)
+            return;
+        if (meteredNode != nullptr)
+        {
+            meteredNode->removeMeterSubscriber();
+            meteredNode->removeProfileSubscriber();
+        }
+        meteredNode = newNode;
+        if (meteredNode != nullptr)
+        {
+            meteredNode->addMeterSubscriber();
+            meteredNode->addProfileSubscriber();
+        }
+    }
+
+    void updateDspLoad (const GraphNode& graphNode)
+    {
+        const auto time = graphNode.getProcessTime();
+        dspLoad.setText (String (time.averageMs, 2) + " ms " + String (roundToInt (time.load * 100.0)) + "%",
+                         dontSendNotification);
+        const auto memory = graphNode.getMemoryUsage();
+        dspLoad.setTooltip ("DSP time: last " + String (time.lastMs, 3) + " ms, average "
+            + String (time.averageMs, 3) + " ms, max " + String (time.maximumMs, 3) + " ms\n"
+            + "Memory: " + File::descriptionOfSizeInBytes (memory.getTotal())
+            + " (render " + File::descriptionOfSizeInBytes (memory.renderBytes + memory.midiBytes)
+            + ", oversampling " + File::descriptionOfSizeInBytes (memory.oversamplingBytes)
+            + ", content " + File::descriptionOfSizeInBytes (memory.contentBytes)
+            + ", plugin " + File::descriptionOfSizeInBytes (memory.pluginBytes) + ")");
+    }
+
     SignalConnection nodeSelectedConnection;
     SignalConnection volumeChangedConnection;
     SignalConnection powerChangedConnection;
@@ -37,13 +37,25 @@ public:
         jassert (model.channel() >= 1 && model.channel() <= 16);
         colour.addColour (0.0, Colours::lightsalmon);
         colour.addColour (1.0, Colours::red);
+        setOpaque (true);
         trackRequested (127 - model.keyId());
+        updateLook();
     }
 
     virtual ~NoteClipItem() { }
 
     inline void setModel (const Note& n) {
         model = n;
+        updateLook();
+    }
+
+    /** Reads the colour and label from the model again. Call this when its
+        key or velocity changes */
+    inline void updateLook()
+    {
+        label = model.isValid() ? String (model.keyId()) : String();
+        fill = fillColor (model.isValid() ? model.velocity() : 0.f);
+        repaint();
     }
 
     inline void reset() {
@@ -71,19 +83,15 @@ public:
     inline void
     paint (Graphics &g)
     {
-        if (! isSelected())
-            g.setColour (fillColor (model.velocity()));
-        else
-            g.setColour (Colours::aqua);
-
+        g.setColour (isSelected() ? Colours::aqua : fill);
         g.fillAll();
 
         g.setColour (Colours::black);
         g.drawRect (getLocalBounds(), 1);
 
-        if (model.isValid())
-            g.drawFittedText (String (model.keyId()),
-                              getLocalBounds(), Justification::centred, 1);
+        // labels don't fit on short notes, so don't lay them out
+        if (label.isNotEmpty() && getWidth() >= minLabelWidth)
+            g.drawText (label, getLocalBounds(), Justification::centred, false);
     }
 
     inline int32 trackIndex() const { return 127 - model.keyId(); }
@@ -125,6 +133,9 @@ private:
     float noteVelocity;
 
     ColourGradient colour;
+    Colour fill;
+    String label;
+    enum { minLabelWidth = 16 };
 
     inline Colour fillColor (float velocity)
     {
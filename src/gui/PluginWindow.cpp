@@ -285,6 +285,9 @@ PluginWindow::PluginWindow (GuiController& g, Component* const ui, const Node& n
 
 PluginWindow::~PluginWindow()
 {
+    // not every edit made in an editor is reported to the host
+    if (GraphNodePtr obj = node.getGraphNode())
+        obj->markStateChanged();
     name.removeListener (this);
     clearContentComponent();
     setLookAndFeel (nullptr);
@@ -18,6 +18,9 @@
 */
 
 //[Headers] You can add your own extra header files here...
+#include "engine/AudioCache.h"
+#include "engine/LinkSync.h"
+#include "engine/TimelineTrace.h"
 #include "session/DeviceManager.h"
 #include "session/PluginManager.h"
 #include "gui/widgets/AudioDeviceSelectorComponent.h"
@@ -25,12 +28,14 @@
 #include "gui/GuiCommon.h"
 #include "gui/MainWindow.h"
 #include "gui/ViewHelpers.h"
+#include "controllers/DevicesController.h"
 #include "controllers/OSCController.h"
 #include "Globals.h"
 #include "Settings.h"
 
 #define EL_GENERAL_SETTINGS_NAME "General"
 #define EL_AUDIO_SETTINGS_NAME "Audio"
+#define EL_ENGINE_SETTINGS_NAME "Engine"
 #define EL_MIDI_SETTINGS_NAME "MIDI"
 #define EL_OSC_SETTINGS_NAME "OSC"
 #define EL_PLUGINS_PREFERENCE_NAME  "Plugins"
@@ -252,6 +257,53 @@ namespace Element {
             }
 
             updateToggleStates();
+
+            addAndMakeVisible (scanProcessesLabel);
+            scanProcessesLabel.setFont (Font (12.0, Font::bold));
+            scanProcessesLabel.setText ("Scanner processes", dontSendNotification);
+            addAndMakeVisible (scanProcesses);
+            scanProcesses.textFromValueFunction = [](double value) -> String {
+                return String (roundToInt (value));
+            };
+            scanProcesses.setRange (1.0, (double) jmax (1, SystemStats::getNumCpus()), 1.0);
+            scanProcesses.setValue ((double) settings.getNumPluginScanProcesses(), dontSendNotification);
+            scanProcesses.setSliderStyle (Slider::IncDecButtons);
+            scanProcesses.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            scanProcesses.onValueChange = [this]()
+            {
+                settings.setNumPluginScanProcesses (roundToInt (scanProcesses.getValue()));
+                settings.saveIfNeeded();
+            };
+
+            addAndMakeVisible (poolBudgetLabel);
+            poolBudgetLabel.setFont (Font (12.0, Font::bold));
+            poolBudgetLabel.setText ("Reuse removed plugins (MB)", dontSendNotification);
+            addAndMakeVisible (poolBudget);
+            poolBudget.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("Off") : String (roundToInt (value));
+            };
+            poolBudget.setRange (0.0, 4096.0, 64.0);
+            poolBudget.setValue ((double) settings.getPluginPoolBudget(), dontSendNotification);
+            poolBudget.setSliderStyle (Slider::IncDecButtons);
+            poolBudget.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            poolBudget.onValueChange = [this]()
+            {
+                settings.setPluginPoolBudget (roundToInt (poolBudget.getValue()));
+                settings.saveIfNeeded();
+            };
+
+            addAndMakeVisible (lazyLoadingLabel);
+            lazyLoadingLabel.setFont (Font (12.0, Font::bold));
+            lazyLoadingLabel.setText ("Load disabled plugins when enabled", dontSendNotification);
+            addAndMakeVisible (lazyLoading);
+            lazyLoading.setYesNoText ("Yes", "No");
+            lazyLoading.setClickingTogglesState (true);
+            lazyLoading.setToggleState (settings.isLazyNodeLoadingEnabled(), dontSendNotification);
+            lazyLoading.onClick = [this]()
+            {
+                settings.setLazyNodeLoadingEnabled (lazyLoading.getToggleState());
+                settings.saveIfNeeded();
+            };
         }
 
         void resized() override
@@ -272,6 +324,18 @@ namespace Element {
                 c->setBounds (r2.removeFromRight (getWidth() - toggleInset));
                 r.removeFromTop (4);
             }
+
+            r.removeFromTop (spacingBetweenSections);
+            auto r2 = r.removeFromTop (22);
+            scanProcessesLabel.setBounds (r2.removeFromLeft (getWidth() / 2));
+            scanProcesses.setBounds (r2.removeFromLeft (120));
+
+            r.removeFromTop (spacingBetweenSections);
+            r2 = r.removeFromTop (22);
+            poolBudgetLabel.setBounds (r2.removeFromLeft (getWidth() / 2));
+            poolBudget.setBounds (r2.removeFromLeft (120));
+
+            layoutSetting (r, lazyLoadingLabel, lazyLoading);
         }
 
         void paint (Graphics&) override { }
@@ -293,6 +357,15 @@ namespace Element {
 
         Label formatNotice;
 
+        Label scanProcessesLabel;
+        Slider scanProcesses;
+
+        Label poolBudgetLabel;
+        Slider poolBudget;
+
+        Label lazyLoadingLabel;
+        SettingButton lazyLoading;
+
         const String key = Settings::pluginFormatsKey;
         bool hasChanged = false;
 
@@ -341,7 +414,8 @@ namespace Element {
         enum ComboBoxIDs
         {
             ClockSourceInternal  = 1,
-            ClockSourceMidiClock = 2
+            ClockSourceMidiClock = 2,
+            ClockSourceLink      = 3
         };
 
         GeneralSettingsPage (Globals& world, GuiController& g)
@@ -370,6 +444,8 @@ namespace Element {
             clockSourceBox.addItem ("Internal", ClockSourceInternal);
            #if defined (EL_PRO)
             clockSourceBox.addItem ("MIDI Clock", ClockSourceMidiClock);
+            if (LinkSync::isAvailable())
+                clockSourceBox.addItem ("Ableton Link", ClockSourceLink);
            #endif
             clockSource.referTo (clockSourceBox.getSelectedIdAsValue());
 
@@ -437,6 +513,37 @@ namespace Element {
             askToSaveSession.setToggleState (settings.askToSaveSession(), dontSendNotification);
             askToSaveSession.getToggleStateValue().addListener (this);
 
+            addAndMakeVisible (autosaveLabel);
+            autosaveLabel.setText ("Autosave every (minutes)", dontSendNotification);
+            autosaveLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (autosave);
+            autosave.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("Off") : String (roundToInt (value));
+            };
+            autosave.setRange (0.0, 120.0, 1.0);
+            autosave.setValue ((double) settings.getAutosaveInterval(), dontSendNotification);
+            autosave.setSliderStyle (Slider::IncDecButtons);
+            autosave.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            autosave.onValueChange = [this]()
+            {
+                settings.setAutosaveInterval (roundToInt (autosave.getValue()));
+                settings.saveIfNeeded();
+            };
+
+            addAndMakeVisible (undoBudgetLabel);
+            undoBudgetLabel.setText ("Undo history size (MB)", dontSendNotification);
+            undoBudgetLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (undoBudget);
+            undoBudget.setRange (8.0, 1024.0, 8.0);
+            undoBudget.setValue ((double) settings.getUndoMemoryBudget(), dontSendNotification);
+            undoBudget.setSliderStyle (Slider::IncDecButtons);
+            undoBudget.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            undoBudget.onValueChange = [this]()
+            {
+                settings.setUndoMemoryBudget (roundToInt (undoBudget.getValue()));
+                settings.saveIfNeeded();
+            };
+
             addAndMakeVisible (systrayLabel);
             systrayLabel.setText ("Show system tray", dontSendNotification);
             systrayLabel.setFont (Font (12.0, Font::bold));
@@ -445,6 +552,16 @@ namespace Element {
             systray.setToggleState (settings.isSystrayEnabled(), dontSendNotification);
             systray.getToggleStateValue().addListener (this);
 
+           #if EL_USE_OPENGL
+            addAndMakeVisible (openGLLabel);
+            openGLLabel.setText ("Draw with OpenGL", dontSendNotification);
+            openGLLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (openGL);
+            openGL.setClickingTogglesState (true);
+            openGL.setToggleState (settings.isOpenGLEnabled(), dontSendNotification);
+            openGL.getToggleStateValue().addListener (this);
+           #endif
+
            #ifdef EL_PRO
             addAndMakeVisible (defaultSessionFileLabel);
             defaultSessionFileLabel.setText ("Default new Session", dontSendNotification);
@@ -458,8 +575,10 @@ namespace Element {
            #endif
 
            #if defined (EL_PRO)
-            const int source = String("internal") == settings.getUserSettings()->getValue("clockSource")
-                ? ClockSourceInternal : ClockSourceMidiClock;
+            const String sourceName = settings.getUserSettings()->getValue("clockSource");
+            const int source = sourceName == "internal" ? ClockSourceInternal
+                : sourceName == "abletonLink" && LinkSync::isAvailable() ? ClockSourceLink
+                : ClockSourceMidiClock;
             clockSourceBox.setSelectedId (source, dontSendNotification);
             clockSource.setValue (source);
             clockSource.addListener (this);
@@ -522,7 +641,12 @@ namespace Element {
             layoutSetting (r, hidePluginWindowsLabel, hidePluginWindows);
             layoutSetting (r, openLastSessionLabel, openLastSession);
             layoutSetting (r, askToSaveSessionLabel, askToSaveSession);
+            layoutSetting (r, autosaveLabel, autosave, getWidth() / 4);
+            layoutSetting (r, undoBudgetLabel, undoBudget, getWidth() / 4);
             layoutSetting (r, systrayLabel, systray);
+           #if EL_USE_OPENGL
+            layoutSetting (r, openGLLabel, openGL);
+           #endif
 
            #ifdef EL_PRO
             layoutSetting (r, defaultSessionFileLabel, defaultSessionFile, 190 - settingHeight);
@@ -548,7 +672,9 @@ namespace Element {
             // clock source
             else if (value.refersToSameSourceAs (clockSource))
             {
-                const var val = ClockSourceInternal == (int)clockSource.getValue() ? "internal" : "midiClock";
+                const int source = (int) clockSource.getValue();
+                const var val = source == ClockSourceInternal ? "internal"
+                    : source == ClockSourceLink ? "abletonLink" : "midiClock";
                 settings.getUserSettings()->setValue ("clockSource", val);
                 engine->applySettings (settings);
                 if (auto* cc = ViewHelpers::findContentComponent())
@@ -584,6 +710,12 @@ namespace Element {
                 settings.setSystrayEnabled (systray.getToggleState());
                 gui.refreshSystemTray();
             }
+            else if (value.refersToSameSourceAs (openGL.getToggleStateValue()))
+            {
+                settings.setOpenGLEnabled (openGL.getToggleState());
+                if (auto* cc = gui.getContentComponent())
+                    cc->setOpenGLEnabled (settings.isOpenGLEnabled());
+            }
 
             settings.saveIfNeeded();
             gui.stabilizeViews();
@@ -617,6 +749,10 @@ namespace Element {
 
         Label askToSaveSessionLabel;
         SettingButton askToSaveSession;
+        Label autosaveLabel;
+        Slider autosave;
+        Label undoBudgetLabel;
+        Slider undoBudget;
 
         Label defaultSessionFileLabel;
         FilenameComponent defaultSessionFile;
@@ -625,6 +761,9 @@ namespace Element {
         Label systrayLabel;
         SettingButton systray;
 
+        Label openGLLabel;
+        SettingButton openGL;
+
         Settings& settings;
         AudioEnginePtr engine;
         GuiController& gui;
@@ -632,29 +771,504 @@ namespace Element {
 
     // MARK: Audio Settings
 
-    class AudioSettingsComponent : public SettingsPage
+    class AudioSettingsComponent : public SettingsPage,
+                                   private ChangeListener
     {
     public:
-        AudioSettingsComponent (DeviceManager& d)
-            : devs (d, 1, DeviceManager::maxAudioChannels,
+        AudioSettingsComponent (Globals& world, GuiController& g)
+            : devs (world.getDeviceManager(), 1, DeviceManager::maxAudioChannels,
                        1, DeviceManager::maxAudioChannels, 
                        false, false, false, false),
-              devices (d)
+              devices (world.getDeviceManager()),
+              settings (world.getSettings()),
+              gui (g)
         {
             addAndMakeVisible (devs);
             devs.setItemHeight (22);
+
+            addAndMakeVisible (loopbackLabel);
+            loopbackLabel.setFont (Font (12.0, Font::bold));
+            loopbackLabel.setText ("Loopback", dontSendNotification);
+            addAndMakeVisible (loopbackOutput);
+            addAndMakeVisible (loopbackInput);
+
+            addAndMakeVisible (roundTripLabel);
+            roundTripLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (measureButton);
+            measureButton.setButtonText ("Measure");
+            measureButton.setTooltip ("Plays impulses from the output to the input through a cable "
+                                      "and measures the round trip. Keep other audio silent meanwhile");
+            measureButton.onClick = [this]() { measure(); };
+
             setSize (300, 400);
+            devices.addChangeListener (this);
+            updateLoopback();
+
+            // the page opens on what was probed before, fresh lists follow
+            devices.rescanInBackground();
         }
 
         ~AudioSettingsComponent()
         {
+            devices.removeChangeListener (this);
         }
 
-        void resized() override { devs.setBounds (getLocalBounds()); }
+        void resized() override
+        {
+            auto r = getLocalBounds();
+            auto r2 = r.removeFromBottom (22);
+            roundTripLabel.setBounds (r2.removeFromLeft (getWidth() / 2));
+            measureButton.setBounds (r2.removeFromLeft (80));
+            r.removeFromBottom (6);
+            r2 = r.removeFromBottom (22);
+            loopbackLabel.setBounds (r2.removeFromLeft (getWidth() / 2));
+            loopbackOutput.setBounds (r2.removeFromLeft (r2.getWidth() / 2).withTrimmedRight (2));
+            loopbackInput.setBounds (r2.withTrimmedLeft (2));
+            r.removeFromBottom (6);
+            devs.setBounds (r);
+        }
 
     private:
         Element::AudioDeviceSelectorComponent devs;
         DeviceManager& devices;
+        Settings& settings;
+        GuiController& gui;
+        Label loopbackLabel, roundTripLabel;
+        ComboBox loopbackOutput, loopbackInput;
+        TextButton measureButton;
+
+        void changeListenerCallback (ChangeBroadcaster*) override { updateLoopback(); }
+
+        void updateLoopback()
+        {
+            loopbackOutput.clear (dontSendNotification);
+            loopbackInput.clear (dontSendNotification);
+
+            auto* device = devices.getCurrentAudioDevice();
+            if (device != nullptr)
+            {
+                const auto outs = device->getOutputChannelNames();
+                for (int i = 0; i < outs.size(); ++i)
+                    loopbackOutput.addItem (outs[i], i + 1);
+                const auto ins = device->getInputChannelNames();
+                for (int i = 0; i < ins.size(); ++i)
+                    loopbackInput.addItem (ins[i], i + 1);
+                loopbackOutput.setSelectedItemIndex (0, dontSendNotification);
+                loopbackInput.setSelectedItemIndex (0, dontSendNotification);
+            }
+
+            auto* controller = gui.findSibling<DevicesController>();
+            measureButton.setEnabled (device != nullptr && controller != nullptr
+                && ! controller->isMeasuringLatency()
+                && loopbackOutput.getNumItems() > 0 && loopbackInput.getNumItems() > 0);
+            showRoundTrip (device != nullptr
+                ? settings.getMeasuredRoundTrip (device->getName(), device->getCurrentSampleRate(),
+                                                 device->getCurrentBufferSizeSamples())
+                : -1);
+        }
+
+        void showRoundTrip (int samples)
+        {
+            String text ("Round trip: ");
+            auto* device = devices.getCurrentAudioDevice();
+            if (samples >= 0 && device != nullptr && device->getCurrentSampleRate() > 0.0)
+                text << samples << " samples (" << String (1000.0 * samples / device->getCurrentSampleRate(), 2) << " ms)";
+            else
+                text << "not measured";
+            roundTripLabel.setText (text, dontSendNotification);
+        }
+
+        void measure()
+        {
+            auto* controller = gui.findSibling<DevicesController>();
+            if (controller == nullptr)
+                return;
+
+            // channel indices count the device's active channels only
+            auto* device = devices.getCurrentAudioDevice();
+            const auto outIndex = loopbackOutput.getSelectedId() - 1;
+            const auto inIndex = loopbackInput.getSelectedId() - 1;
+            if (device == nullptr || ! device->getActiveOutputChannels()[outIndex]
+                                  || ! device->getActiveInputChannels()[inIndex])
+            {
+                roundTripLabel.setText ("Round trip: channels aren't active", dontSendNotification);
+                return;
+            }
+
+            const int output = countActiveBelow (device->getActiveOutputChannels(), outIndex);
+            const int input = countActiveBelow (device->getActiveInputChannels(), inIndex);
+            measureButton.setEnabled (false);
+            roundTripLabel.setText ("Round trip: measuring...", dontSendNotification);
+
+            Component::SafePointer<AudioSettingsComponent> safe (this);
+            controller->measureAudioLatency (output, input, [safe] (int samples)
+            {
+                if (safe == nullptr)
+                    return;
+                safe->updateLoopback();
+                if (samples < 0)
+                    safe->roundTripLabel.setText ("Round trip: nothing came back", dontSendNotification);
+            });
+        }
+
+        static int countActiveBelow (const BigInteger& active, int index)
+        {
+            int count = 0;
+            for (int i = 0; i < index; ++i)
+                if (active[i])
+                    ++count;
+            return count;
+        }
+    };
+
+    // MARK: Engine Settings
+
+    class EngineSettingsPage : public SettingsPage,
+                               private Timer
+    {
+    public:
+        EngineSettingsPage (Globals& w)
+            : world (w)
+        {
+            auto& settings = world.getSettings();
+
+            addAndMakeVisible (renderThreadsLabel);
+            renderThreadsLabel.setFont (Font (12.0, Font::bold));
+            renderThreadsLabel.setText ("Multi-core render threads", dontSendNotification);
+            addAndMakeVisible (renderThreads);
+            renderThreads.textFromValueFunction = [](double value) -> String {
+                return String (roundToInt (value));
+            };
+            renderThreads.setRange (0.0, (double) jmax (1, SystemStats::getNumCpus() * 2), 1.0);
+            renderThreads.setValue ((double) settings.getNumRenderThreads(), dontSendNotification);
+            renderThreads.setSliderStyle (Slider::IncDecButtons);
+            renderThreads.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            renderThreads.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setNumRenderThreads (roundToInt (renderThreads.getValue()));
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+            };
+
+            addAndMakeVisible (meterRateLabel);
+            meterRateLabel.setFont (Font (12.0, Font::bold));
+            meterRateLabel.setText ("Meter refresh rate (Hz)", dontSendNotification);
+            addAndMakeVisible (meterRate);
+            meterRate.textFromValueFunction = [](double value) -> String {
+                return String (roundToInt (value));
+            };
+            meterRate.setRange (1.0, 120.0, 1.0);
+            meterRate.setValue ((double) settings.getMeterRefreshRate(), dontSendNotification);
+            meterRate.setSliderStyle (Slider::IncDecButtons);
+            meterRate.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            meterRate.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setMeterRefreshRate (roundToInt (meterRate.getValue()));
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+            };
+
+            addAndMakeVisible (idleSuspendLabel);
+            idleSuspendLabel.setFont (Font (12.0, Font::bold));
+            idleSuspendLabel.setText ("Suspend idle instruments after (s)", dontSendNotification);
+            addAndMakeVisible (idleSuspend);
+            idleSuspend.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("Never") : String (roundToInt (value));
+            };
+            idleSuspend.setRange (0.0, 600.0, 1.0);
+            idleSuspend.setValue (settings.getIdleSuspendTime(), dontSendNotification);
+            idleSuspend.setSliderStyle (Slider::IncDecButtons);
+            idleSuspend.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            idleSuspend.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setIdleSuspendTime (idleSuspend.getValue());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+            };
+
+            addAndMakeVisible (warmUpLabel);
+            warmUpLabel.setFont (Font (12.0, Font::bold));
+            warmUpLabel.setText ("Warm up blocks after loading", dontSendNotification);
+            addAndMakeVisible (warmUp);
+            warmUp.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("Off") : String (roundToInt (value));
+            };
+            warmUp.setRange (0.0, 256.0, 1.0);
+            warmUp.setValue ((double) settings.getNumWarmUpBlocks(), dontSendNotification);
+            warmUp.setSliderStyle (Slider::IncDecButtons);
+            warmUp.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            warmUp.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setNumWarmUpBlocks (roundToInt (warmUp.getValue()));
+                settings.saveIfNeeded();
+            };
+
+            addAndMakeVisible (preloadLabel);
+            preloadLabel.setFont (Font (12.0, Font::bold));
+            preloadLabel.setText ("Graphs preloaded ahead", dontSendNotification);
+            addAndMakeVisible (preload);
+            preload.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("All") : String (roundToInt (value));
+            };
+            preload.setRange (0.0, 32.0, 1.0);
+            preload.setValue ((double) settings.getNumPreloadedGraphs(), dontSendNotification);
+            preload.setSliderStyle (Slider::IncDecButtons);
+            preload.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            preload.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setNumPreloadedGraphs (roundToInt (preload.getValue()));
+                settings.saveIfNeeded();
+            };
+
+            addAndMakeVisible (midiBudgetLabel);
+            midiBudgetLabel.setFont (Font (12.0, Font::bold));
+            midiBudgetLabel.setText ("MIDI events per block", dontSendNotification);
+            addAndMakeVisible (midiBudget);
+            midiBudget.setRange (64.0, 65536.0, 64.0);
+            midiBudget.setValue ((double) settings.getMidiEventBudget(), dontSendNotification);
+            midiBudget.setSliderStyle (Slider::IncDecButtons);
+            midiBudget.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            midiBudget.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setMidiEventBudget (roundToInt (midiBudget.getValue()));
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+            };
+
+            addAndMakeVisible (audioCacheLabel);
+            audioCacheLabel.setFont (Font (12.0, Font::bold));
+            audioCacheLabel.setText ("Audio file cache (MB)", dontSendNotification);
+            addAndMakeVisible (audioCache);
+            audioCache.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("In use") : String (roundToInt (value));
+            };
+            audioCache.setRange (0.0, 8192.0, 64.0);
+            audioCache.setValue ((double) settings.getAudioCacheBudget(), dontSendNotification);
+            audioCache.setSliderStyle (Slider::IncDecButtons);
+            audioCache.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            audioCache.onValueChange = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setAudioCacheBudget (roundToInt (audioCache.getValue()));
+                settings.saveIfNeeded();
+                SharedResourcePointer<AudioCache> cache;
+                cache->setBudget ((int64) settings.getAudioCacheBudget() * 1024 * 1024);
+            };
+
+            addAndMakeVisible (xrunTracingLabel);
+            xrunTracingLabel.setFont (Font (12.0, Font::bold));
+            xrunTracingLabel.setText ("Save traces of dropouts", dontSendNotification);
+            addAndMakeVisible (xrunTracing);
+            xrunTracing.setYesNoText ("Yes", "No");
+            xrunTracing.setClickingTogglesState (true);
+            xrunTracing.setToggleState (settings.isXrunTracingEnabled(), dontSendNotification);
+            xrunTracing.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setXrunTracingEnabled (xrunTracing.getToggleState());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+            };
+
+            addAndMakeVisible (timelineTracingLabel);
+            timelineTracingLabel.setFont (Font (12.0, Font::bold));
+            timelineTracingLabel.setText ("Record engine timeline", dontSendNotification);
+            addAndMakeVisible (timelineTracing);
+            timelineTracing.setYesNoText ("Yes", "No");
+            timelineTracing.setClickingTogglesState (true);
+            timelineTracing.setToggleState (settings.isTimelineTracingEnabled(), dontSendNotification);
+            timelineTracing.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setTimelineTracingEnabled (timelineTracing.getToggleState());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+            };
+
+            addAndMakeVisible (exportTimelineLabel);
+            exportTimelineLabel.setFont (Font (12.0, Font::bold));
+            exportTimelineLabel.setText ("Export timeline", dontSendNotification);
+            addAndMakeVisible (exportTimeline);
+            exportTimeline.setButtonText ("Save...");
+            exportTimeline.setTooltip ("Saves the recorded timeline as a Chrome trace, "
+                                       "for chrome://tracing or Perfetto");
+            exportTimeline.onClick = [this]()
+            {
+                FileChooser chooser ("Export Timeline", File(), "*.json", true, false);
+                if (! chooser.browseForFileToSave (true))
+                    return;
+                if (! TimelineTrace::writeChromeTrace (chooser.getResult().withFileExtension ("json")))
+                    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Export Timeline",
+                                                      "The timeline couldn't be written");
+            };
+
+            addAndMakeVisible (overloadLabel);
+            overloadLabel.setFont (Font (12.0, Font::bold));
+            overloadLabel.setText ("Shed load when overloaded", dontSendNotification);
+            addAndMakeVisible (overload);
+            overload.setYesNoText ("Yes", "No");
+            overload.setClickingTogglesState (true);
+            overload.setToggleState (settings.isOverloadProtectionEnabled(), dontSendNotification);
+            overload.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setOverloadProtectionEnabled (overload.getToggleState());
+                settings.saveIfNeeded();
+            };
+
+            addAndMakeVisible (realtimeThreadsLabel);
+            realtimeThreadsLabel.setFont (Font (12.0, Font::bold));
+            realtimeThreadsLabel.setText ("Realtime priority for render threads", dontSendNotification);
+            addAndMakeVisible (realtimeThreads);
+            realtimeThreads.setYesNoText ("Yes", "No");
+            realtimeThreads.setClickingTogglesState (true);
+            realtimeThreads.setToggleState (settings.isRealtimeRenderThreadsEnabled(), dontSendNotification);
+            realtimeThreads.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setRealtimeRenderThreadsEnabled (realtimeThreads.getToggleState());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+                updateRealtimeStatus();
+            };
+
+            addAndMakeVisible (pinThreadsLabel);
+            pinThreadsLabel.setFont (Font (12.0, Font::bold));
+            pinThreadsLabel.setText ("Pin render threads to cores", dontSendNotification);
+            addAndMakeVisible (pinThreads);
+            pinThreads.setYesNoText ("Yes", "No");
+            pinThreads.setClickingTogglesState (true);
+            pinThreads.setToggleState (settings.isRenderThreadPinningEnabled(), dontSendNotification);
+            pinThreads.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setRenderThreadPinningEnabled (pinThreads.getToggleState());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+                updateRealtimeStatus();
+            };
+
+            addAndMakeVisible (lockMemoryLabel);
+            lockMemoryLabel.setFont (Font (12.0, Font::bold));
+            lockMemoryLabel.setText ("Lock engine memory in RAM", dontSendNotification);
+            addAndMakeVisible (lockMemory);
+            lockMemory.setYesNoText ("Yes", "No");
+            lockMemory.setClickingTogglesState (true);
+            lockMemory.setToggleState (settings.isMemoryLockingEnabled(), dontSendNotification);
+            lockMemory.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setMemoryLockingEnabled (lockMemory.getToggleState());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+                updateRealtimeStatus();
+            };
+
+            addAndMakeVisible (isolateThreadsLabel);
+            isolateThreadsLabel.setFont (Font (12.0, Font::bold));
+            isolateThreadsLabel.setText ("Keep background threads off render cores", dontSendNotification);
+            addAndMakeVisible (isolateThreads);
+            isolateThreads.setYesNoText ("Yes", "No");
+            isolateThreads.setClickingTogglesState (true);
+            isolateThreads.setToggleState (settings.isBackgroundIsolationEnabled(), dontSendNotification);
+            isolateThreads.onClick = [this]()
+            {
+                auto& settings = world.getSettings();
+                settings.setBackgroundIsolationEnabled (isolateThreads.getToggleState());
+                settings.saveIfNeeded();
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+                updateRealtimeStatus();
+            };
+
+            addAndMakeVisible (realtimeStatus);
+            realtimeStatus.setFont (Font (11.0));
+            realtimeStatus.setJustificationType (Justification::topLeft);
+            updateRealtimeStatus();
+            // workers report in as they restart
+            startTimer (1000);
+        }
+
+        ~EngineSettingsPage() { }
+
+        void resized() override
+        {
+            auto r = getLocalBounds();
+            layoutSetting (r, renderThreadsLabel, renderThreads, getWidth() / 4);
+            layoutSetting (r, meterRateLabel, meterRate, getWidth() / 4);
+            layoutSetting (r, idleSuspendLabel, idleSuspend, getWidth() / 4);
+            layoutSetting (r, warmUpLabel, warmUp, getWidth() / 4);
+            layoutSetting (r, preloadLabel, preload, getWidth() / 4);
+            layoutSetting (r, midiBudgetLabel, midiBudget, getWidth() / 4);
+            layoutSetting (r, audioCacheLabel, audioCache, getWidth() / 4);
+            layoutSetting (r, xrunTracingLabel, xrunTracing);
+            layoutSetting (r, timelineTracingLabel, timelineTracing);
+            layoutSetting (r, exportTimelineLabel, exportTimeline, getWidth() / 4);
+            layoutSetting (r, overloadLabel, overload);
+            layoutSetting (r, realtimeThreadsLabel, realtimeThreads);
+            layoutSetting (r, pinThreadsLabel, pinThreads);
+            layoutSetting (r, lockMemoryLabel, lockMemory);
+            layoutSetting (r, isolateThreadsLabel, isolateThreads);
+            r.removeFromTop (6);
+            realtimeStatus.setBounds (r.removeFromTop (75));
+        }
+
+    private:
+        Globals& world;
+        Label renderThreadsLabel;
+        Slider renderThreads;
+        Label meterRateLabel;
+        Slider meterRate;
+        Label idleSuspendLabel;
+        Slider idleSuspend;
+        Label warmUpLabel;
+        Slider warmUp;
+        Label preloadLabel;
+        Slider preload;
+        Label midiBudgetLabel;
+        Slider midiBudget;
+        Label audioCacheLabel;
+        Slider audioCache;
+        Label xrunTracingLabel;
+        SettingButton xrunTracing;
+        Label timelineTracingLabel;
+        SettingButton timelineTracing;
+        Label exportTimelineLabel;
+        TextButton exportTimeline;
+        Label overloadLabel;
+        SettingButton overload;
+        Label realtimeThreadsLabel;
+        SettingButton realtimeThreads;
+        Label pinThreadsLabel;
+        SettingButton pinThreads;
+        Label lockMemoryLabel;
+        SettingButton lockMemory;
+        Label isolateThreadsLabel;
+        SettingButton isolateThreads;
+        Label realtimeStatus;
+
+        void updateRealtimeStatus()
+        {
+            if (auto engine = world.getAudioEngine())
+                realtimeStatus.setText (engine->getRealtimeStatus(), dontSendNotification);
+        }
+
+        void timerCallback() override { updateRealtimeStatus(); }
     };
 
     // MARK: MIDI Settings
@@ -723,8 +1337,8 @@ namespace Element {
 
         void timerCallback() override
         {
-            if ((midiInputs && midiInputs->getNumDevices() != MidiInput::getDevices().size()) ||
-                midiOutput.getNumItems() - 1 != MidiOutput::getDevices().size())
+            if ((midiInputs && midiInputs->getNumDevices() != midi.getMidiInputDevices().size()) ||
+                midiOutput.getNumItems() - 1 != midi.getMidiOutputDevices().size())
             {
                 updateDevices();
             }
@@ -975,6 +1589,7 @@ PreferencesComponent::PreferencesComponent (Globals& g, GuiController& _gui)
     //[Constructor] You can add your own custom stuff here..
     addPage (EL_GENERAL_SETTINGS_NAME);
     addPage (EL_AUDIO_SETTINGS_NAME);
+    addPage (EL_ENGINE_SETTINGS_NAME);
     addPage (EL_MIDI_SETTINGS_NAME);
     addPage (EL_OSC_SETTINGS_NAME);
     setPage (EL_GENERAL_SETTINGS_NAME);
@@ -1033,7 +1648,9 @@ Component* PreferencesComponent::createPageForName (const String& name)
     if (name == EL_GENERAL_SETTINGS_NAME) {
         return new GeneralSettingsPage (world, gui);
     } else if (name == EL_AUDIO_SETTINGS_NAME) {
-        return new AudioSettingsComponent (world.getDeviceManager());
+        return new AudioSettingsComponent (world, gui);
+    } else if (name == EL_ENGINE_SETTINGS_NAME) {
+        return new EngineSettingsPage (world);
     } else if (name == EL_PLUGINS_PREFERENCE_NAME) {
         return new PluginSettingsComponent (world);
     } else if (name == EL_MIDI_SETTINGS_NAME) {
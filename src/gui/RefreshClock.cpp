@@ -0,0 +1,128 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "gui/RefreshClock.h"
+
+namespace Element {
+
+static constexpr double frameMs = 1000.0 / RefreshClock::frameRateHz;
+
+//=============================================================================
+RefreshClock::RefreshClock() { }
+RefreshClock::~RefreshClock()
+{
+    stopTimer();
+}
+
+void RefreshClock::add (RefreshClient* client)
+{
+    clients.addIfNotAlreadyThere (client);
+    // tick on the next frame if the clock is too slow for the client, so it
+    // doesn't wait out an idle poll
+    if (! isTimerRunning() || getTimerInterval() > roundToInt (jmax (frameMs, client->intervalMs)))
+        startTimer (roundToInt (frameMs));
+}
+
+void RefreshClock::remove (RefreshClient* client)
+{
+    clients.removeFirstMatchingValue (client);
+    if (clients.isEmpty())
+        stopTimer();
+}
+
+void RefreshClock::updateRate (double fastestMs)
+{
+    if (clients.isEmpty())
+    {
+        stopTimer();
+        return;
+    }
+
+    // tick once per as many whole frames as the fastest client can wait
+    const int interval = fastestMs > 0.0
+        ? roundToInt (frameMs * jmax (1, (int) (fastestMs / frameMs)))
+        : 1000 / idleRateHz;
+
+    if (getTimerInterval() != interval)
+        startTimer (interval);
+}
+
+void RefreshClock::timerCallback()
+{
+    const auto now = Time::getMillisecondCounterHiRes();
+    // clients due before the tick after this one are closer to now than to it
+    const auto margin = 0.5 * (double) getTimerInterval();
+    double fastestMs = 0.0;
+
+    // clients can come and go from their callbacks
+    const auto current = clients;
+    for (auto* client : current)
+    {
+        if (! clients.contains (client) || ! client->isShowingForRefresh())
+            continue;
+
+        const auto interval = client->intervalMs;
+        if (fastestMs == 0.0 || interval < fastestMs)
+            fastestMs = interval;
+
+        if (client->nextDue > now + margin)
+            continue;
+
+        // clients coming back from being hidden start over
+        client->nextDue += interval;
+        if (client->nextDue <= now)
+            client->nextDue = now + interval;
+
+        client->refreshCallback();
+    }
+
+    updateRate (fastestMs);
+}
+
+//=============================================================================
+RefreshClient::RefreshClient() { }
+RefreshClient::~RefreshClient()
+{
+    stopRefresh();
+}
+
+void RefreshClient::startRefresh (int hz)
+{
+    jassert (hz > 0);
+    intervalMs = 1000.0 / (double) jlimit (1, RefreshClock::frameRateHz, hz);
+    nextDue = Time::getMillisecondCounterHiRes() + intervalMs;
+    clock->add (this);
+}
+
+void RefreshClient::stopRefresh()
+{
+    if (! isRefreshing())
+        return;
+    intervalMs = 0.0;
+    clock->remove (this);
+}
+
+bool RefreshClient::isShowingForRefresh()
+{
+    if (auto* component = dynamic_cast<Component*> (this))
+        return component->isShowing();
+    return true;
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+class RefreshClient;
+
+/** One clock the GUI's meters and animations refresh on.
+
+    Instead of each widget waking the message thread with its own timer,
+    clients subscribe at the rate they need and are called on a shared tick.
+    The tick lands on display frames, running only as fast as the fastest
+    client that is on screen. Component clients that aren't showing, because
+    they're hidden or their window is minimised, are skipped. With none on
+    screen the clock slows to a poll that notices when they come back, and
+    without clients it stops.
+
+    Clients hold the clock through a SharedResourcePointer, so there is
+    nothing to set up.
+ */
+class RefreshClock : private Timer
+{
+public:
+    RefreshClock();
+    ~RefreshClock();
+
+    /** The display rate ticks are aligned to */
+    static constexpr int frameRateHz = 60;
+
+    /** How often the clock checks for clients to reappear while none are showing */
+    static constexpr int idleRateHz = 4;
+
+    /** Returns the number of subscribed clients */
+    int getNumClients() const noexcept { return clients.size(); }
+
+private:
+    friend class RefreshClient;
+    Array<RefreshClient*> clients;
+
+    void add (RefreshClient*);
+    void remove (RefreshClient*);
+    void updateRate (double fastestMs);
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE (RefreshClock)
+};
+
+/** Mix this into something that refreshes periodically, in place of a Timer.
+    If the client is also a Component it's only called while showing.
+ */
+class RefreshClient
+{
+public:
+    RefreshClient();
+    virtual ~RefreshClient();
+
+    /** Starts calling refreshCallback at about this rate, or changes the rate
+        if it's already refreshing. Rates above the display rate are limited
+        to it */
+    void startRefresh (int hz);
+
+    /** Stops refreshing */
+    void stopRefresh();
+
+    /** Returns true if the client is subscribed to the clock */
+    bool isRefreshing() const noexcept { return intervalMs > 0.0; }
+
+    /** Called on the message thread at the rate given to startRefresh */
+    virtual void refreshCallback() = 0;
+
+private:
+    friend class RefreshClock;
+    SharedResourcePointer<RefreshClock> clock;
+    double intervalMs = 0.0;
+    double nextDue = 0.0;
+
+    bool isShowingForRefresh();
+
+    JUCE_DECLARE_NON_COPYABLE (RefreshClient)
+};
+
+}
@@ -42,7 +42,7 @@ SequencerComponent::SequencerComponent (GuiApp &g)
     Value tempo = session->getPropertyAsValue (Slugs::tempo);
     getTempoValue().referTo (tempo);
 
-    startTimer (60);
+    startRefresh (16);
 }
 
 SequencerComponent::~SequencerComponent()
@@ -147,7 +147,7 @@ void SequencerComponent::paintTrackLane (Graphics&, int /*track*/, const Rectang
 
 }
 
-void SequencerComponent::timerCallback()
+void SequencerComponent::refreshCallback()
 {
     if (! pos)
         pos = session->playbackMonitor();
@@ -21,6 +21,7 @@
 #define ELEMENT_SEQUENCER_COMPONENT_H
 
 #include "session/Session.h"
+#include "gui/RefreshClock.h"
 #include "gui/Timeline.h"
 
 namespace Element {
@@ -30,7 +31,8 @@ namespace Element {
 
     class SequencerComponent : public TimelineComponent,
                                public DragAndDropTarget,
-                               public ValueTree::Listener
+                               public ValueTree::Listener,
+                               private RefreshClient
     {
     public:
         SequencerComponent (GuiApp& gui);
@@ -49,8 +51,6 @@ namespace Element {
         bool shouldDrawDragImageWhenOver() { return false; }
 
     protected:
-        void timerCallback();
-
         void clipClicked (TimelineClip *clip, const MouseEvent &clipEvent);
         void clipDoubleClicked (TimelineClip *clip, const MouseEvent &clipEvent);
         void timelineBodyClicked (const MouseEvent &ev, int track);
@@ -58,6 +58,8 @@ namespace Element {
 
     private:
         GuiApp& gui;
+
+        void refreshCallback() override;
         SessionRef session;
         ValueTree state;
 
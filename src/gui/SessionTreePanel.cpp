@@ -38,23 +38,19 @@ class SessionNodeTreeItem : public TreeItemBase
 {  
 public:
     SessionNodeTreeItem (const Node& n)
-        : node (n)
+        : node (n) { }
+    
+    String getUniqueName() const override
     {
-        ValueTree child (n.getValueTree());
-        ValueTree parent (child.getParent());
-        
-        if (parent.isValid())
-        {
-            uniqueName = String (parent.indexOf (child));
-        }
-        else
-        {
-            uniqueName = String ((int64) node.getNodeId());
-        }
+        // root graphs are known by their place in the session, so their
+        // openness is restored for the same slot. Nodes keep their id while
+        // others come and go around them
+        const ValueTree child (node.getValueTree());
+        const ValueTree parent (child.getParent());
+        return parent.hasType (Tags::graphs) ? String (parent.indexOf (child))
+                                             : String ((int64) node.getNodeId());
     }
     
-    String getUniqueName() const override { return uniqueName; }
-    
     void itemOpennessChanged (const bool isOpen) override
     {
         if (isOpen)
@@ -327,7 +323,6 @@ public:
         }
     }
 
-    String uniqueName;
     Node node;
     NodePopupMenu menu;
 };
@@ -541,6 +536,10 @@ void SessionTreePanel::mouseDown (const MouseEvent &ev)
 
 void SessionTreePanel::setSession (SessionPtr s)
 {
+    stopRefresh();
+    rootChanged = false;
+    changedGraphs.clearQuick();
+
     session = s;
     data.removeListener (this);
     data = (session != nullptr) ? session->getValueTree() : ValueTree();
@@ -630,42 +629,121 @@ void SessionTreePanel::valueTreePropertyChanged (ValueTree& tree, const Identifi
     }
 }
 
-static bool couldBeSessionObjects (ValueTree& parent, ValueTree& child)
+/** Returns the graph whose items change when a child is added to or removed
+    from a tree. The session itself stands for the root graphs */
+static ValueTree findChangedGraph (const ValueTree& parent, const ValueTree& child)
 {
-    return  parent.hasType (Tags::session) ||
-            (parent.hasType (Tags::graphs) && child.hasType (Tags::node)) || 
-            (parent.hasType (Tags::nodes) && child.hasType (Tags::node));
+    if (parent.hasType (Tags::session))
+        return parent;
+    if ((parent.hasType (Tags::graphs) || parent.hasType (Tags::nodes)) && child.hasType (Tags::node))
+        return parent.getParent();
+    if (parent.hasType (Tags::node) && child.hasType (Tags::nodes))
+        return parent;
+    return {};
 }
 
-static void refreshSubItems (TreeItemBase* item)
+/** Brings an open item's sub items in line with a list of nodes. Items of
+    nodes that are still there are kept, along with their own sub items */
+template<class ItemType>
+static void updateSubItems (TreeViewItem& item, const NodeArray& nodes)
 {
-    if (item == nullptr) return;
+    if (! item.isOpen())
+        return;
 
-    if (auto* root = dynamic_cast<SessionRootTreeItem*> (item))
+    for (int i = 0; i < nodes.size(); ++i)
     {
-        root->refreshSubItems();
+        const auto& node = nodes.getReference (i);
+        int found = -1;
+        for (int j = i; j < item.getNumSubItems() && found < 0; ++j)
+            if (auto* sub = dynamic_cast<SessionNodeTreeItem*> (item.getSubItem (j)))
+                if (sub->node == node)
+                    found = j;
+
+        if (found == i)
+            continue;
+
+        if (found > i)
+        {
+            auto* const moved = item.getSubItem (found);
+            item.removeSubItem (found, false);
+            item.addSubItem (moved, i);
+        }
+        else
+        {
+            item.addSubItem (new ItemType (node), i);
+        }
     }
+
+    while (item.getNumSubItems() > nodes.size())
+        item.removeSubItem (item.getNumSubItems() - 1);
+}
+
+void SessionTreePanel::graphChanged (const ValueTree& graph)
+{
+    if (graph.hasType (Tags::session))
+        rootChanged = true;
     else
+        changedGraphs.addIfNotAlreadyThere (graph);
+
+    if (! isRefreshing())
+        startRefresh (RefreshClock::frameRateHz);
+}
+
+void SessionTreePanel::refreshCallback()
+{
+    stopRefresh();
+    Array<ValueTree> graphs;
+    graphs.swapWith (changedGraphs);
+
+    if (rootChanged && rootItem != nullptr && session != nullptr)
+    {
+        rootChanged = false;
+        NodeArray nodes;
+        for (int i = 0; i < session->getNumGraphs(); ++i)
+            nodes.add (session->getGraph (i));
+        updateSubItems<SessionRootGraphTreeItem> (*rootItem, nodes);
+    }
+
+    // graphs inside closed ones don't have items to update
+    for (const auto& graph : graphs)
     {
-        item->refreshSubItems();
+        const Node model (graph, false);
+        if (auto* const item = findItemForNode (model))
+        {
+            NodeArray nodes;
+            const auto children (model.getNodesValueTree());
+            for (int i = 0; i < children.getNumChildren(); ++i)
+            {
+                const Node child (children.getChild (i), false);
+                if (! child.isIONode())
+                    nodes.add (child);
+            }
+
+            updateSubItems<SessionNodeTreeItem> (*item, nodes);
+        }
     }
+
+    selectActiveRootGraph();
 }
 
 void SessionTreePanel::valueTreeChildAdded (ValueTree& parent, ValueTree& child)
 {
-    if (couldBeSessionObjects (parent, child))
-        refreshSubItems (rootItem.get());
+    const auto graph = findChangedGraph (parent, child);
+    if (graph.isValid())
+        graphChanged (graph);
 }
 
 void SessionTreePanel::valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int indexRemovedAt)
 {
-    if (couldBeSessionObjects (parent, child))
-        refreshSubItems (rootItem.get());
+    const auto graph = findChangedGraph (parent, child);
+    if (graph.isValid())
+        graphChanged (graph);
 }
 
 void SessionTreePanel::valueTreeChildOrderChanged (ValueTree& parent, int oldIndex, int newIndex)
 {
-    refreshSubItems (rootItem.get());
+    if (parent.hasType (Tags::graphs) || parent.hasType (Tags::nodes))
+        graphChanged (parent.getParent());
 }
 
 void SessionTreePanel::valueTreeParentChanged (ValueTree& tree)
@@ -22,14 +22,23 @@
 #include "controllers/AppController.h"
 #include "controllers/EngineController.h"
 #include "gui/ContentComponent.h"
+#include "gui/RefreshClock.h"
 #include "gui/TreeviewBase.h"
 #include "gui/ViewHelpers.h"
 #include "session/Session.h"
 
 namespace Element {
 
+/** Shows the session's graphs and their nodes.
+
+    Adding, removing or moving nodes only updates the items of the graphs
+    they're in, keeping every other item, and graphs that are closed don't
+    have items for their nodes at all. Changes are collected and applied
+    once per frame, so a burst of edits updates the tree once.
+ */
 class SessionTreePanel : public TreePanelBase,
-                         private ValueTree::Listener
+                         private ValueTree::Listener,
+                         private RefreshClient
 {
 public:
     explicit SessionTreePanel();
@@ -57,6 +66,11 @@ private:
 
     void onNodeSelected();
 
+    bool rootChanged = false;
+    Array<ValueTree> changedGraphs;
+    void graphChanged (const ValueTree& graph);
+    void refreshCallback() override;
+
     friend class ValueTree;
     void valueTreePropertyChanged (ValueTree& tree, const Identifier& property) override;
     void valueTreeChildAdded (ValueTree& parent, ValueTree& child) override;
@@ -140,16 +140,16 @@ public:
         // Update labels from monitor if EXT sync is on
         if (extButton.getToggleState())
         {
+            const auto snapshot = monitor->read();
             if (! tempoLabel.isEnabled())
             {
-                tempoLabel.engineTempo = monitor->tempo.get();
+                tempoLabel.engineTempo = (float) snapshot.tempo;
                 tempoLabel.repaint();
             }
             
             if (! meter->isEnabled())
             {
-                meter->updateMeter (monitor->beatsPerBar.get(),
-                                    monitor->beatDivisor.get(), false);
+                meter->updateMeter (snapshot.beatsPerBar, snapshot.beatDivisor, false);
             }
         }
     }
@@ -89,7 +89,7 @@ TransportBar::TransportBar ()
     setSize (260, 16);
     updateWidth();
     
-    startTimer (88);
+    startRefresh (11);
 }
 
 TransportBar::~TransportBar()
@@ -117,17 +117,18 @@ bool TransportBar::checkForMonitor()
     return monitor != nullptr;
 }
 
-void TransportBar::timerCallback()
+void TransportBar::refreshCallback()
 {
     if (! checkForMonitor())
         return;
 
-    if (play->getToggleState() != monitor->playing.get())
-        play->setToggleState (monitor->playing.get(), dontSendNotification);
-    if (record->getToggleState() != monitor->recording.get())
-        record->setToggleState (monitor->recording.get(), dontSendNotification);
+    const auto snapshot = monitor->read();
+    if (play->getToggleState() != snapshot.playing)
+        play->setToggleState (snapshot.playing, dontSendNotification);
+    if (record->getToggleState() != snapshot.recording)
+        record->setToggleState (snapshot.recording, dontSendNotification);
 
-    stabilize();
+    stabilize (snapshot);
 }
 
 void TransportBar::paint (Graphics& g)
@@ -151,23 +152,24 @@ void TransportBar::buttonClicked (Button* buttonThatWasClicked)
     if (! checkForMonitor())
         return;
     
+    const auto snapshot = monitor->read();
     if (buttonThatWasClicked == play)
     {
-        if (monitor->playing.get())
+        if (snapshot.playing)
             engine->seekToAudioFrame (0);
         else
             engine->setPlaying (true);
     }
     else if (buttonThatWasClicked == stop)
     {
-        if (! monitor->playing.get())
+        if (! snapshot.playing)
             engine->seekToAudioFrame (0);
         else
             engine->setPlaying (false);
     }
     else if (buttonThatWasClicked == record)
     {
-        engine->setRecording (! monitor->recording.get());
+        engine->setRecording (! snapshot.recording);
     }
 }
 
@@ -179,15 +181,18 @@ void TransportBar::setBeatTime (const float t)
 void TransportBar::stabilize()
 {
     if (checkForMonitor())
-    {
-        int bars = 0, beats = 0, sub = 0;
-        monitor->getBarsAndBeats (bars, beats, sub);
-        barLabel->tempoValue  = bars + 1;
-        beatLabel->tempoValue = beats + 1;
-        subLabel->tempoValue  = sub + 1;
-        for (auto* c : { barLabel.get(), beatLabel.get(), subLabel.get() })
-            c->repaint();
-    }
+        stabilize (monitor->read());
+}
+
+void TransportBar::stabilize (const Transport::Monitor::Snapshot& snapshot)
+{
+    int bars = 0, beats = 0, sub = 0;
+    snapshot.getBarsAndBeats (bars, beats, sub);
+    barLabel->tempoValue  = bars + 1;
+    beatLabel->tempoValue = beats + 1;
+    subLabel->tempoValue  = sub + 1;
+    for (auto* c : { barLabel.get(), beatLabel.get(), subLabel.get() })
+        c->repaint();
 }
 
 void TransportBar::updateWidth()
@@ -21,6 +21,7 @@
 
 #include "ElementApp.h"
 #include "gui/Buttons.h"
+#include "gui/RefreshClock.h"
 #include "engine/AudioEngine.h"
 #include "session/Session.h"
 
@@ -29,7 +30,7 @@ namespace Element {
 class BarLabel;
 class TransportBar  : public Component,
                       public Button::Listener,
-                      private Timer
+                      private RefreshClient
 {
 public:
     TransportBar ();
@@ -56,10 +57,10 @@ private:
     ScopedPointer<DragableIntLabel> subLabel;
     
     friend class BarLabel;
-    friend class Timer;
-    void timerCallback() override;
+    void refreshCallback() override;
     
     bool checkForMonitor();
+    void stabilize (const Transport::Monitor::Snapshot&);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportBar)
 };
@@ -49,6 +49,57 @@ void WindowManager::deletePluginWindow (const int index, const bool windowVisibl
     }
 }
 
+void WindowManager::parkPluginWindow (const int index, const bool windowVisible)
+{
+    if (auto* window = activePluginWindows.getUnchecked (index))
+    {
+        // hidden editors aren't painted and skip the refresh clock, so they
+        // cost memory only until they're shown again
+        window->node.setProperty (Tags::windowVisible, windowVisible);
+        window->setVisible (false);
+        parkedPluginWindows.add (activePluginWindows.removeAndReturn (index));
+        trimParkedPluginWindows();
+    }
+}
+
+void WindowManager::trimParkedPluginWindows()
+{
+    const auto scale = Desktop::getInstance().getDisplays().getMainDisplay().scale;
+    int64 total = 0;
+    for (int i = parkedPluginWindows.size(); --i >= 0;)
+    {
+        auto* window = parkedPluginWindows.getUnchecked (i);
+        total += (int64) (window->getWidth() * window->getHeight() * 4 * scale * scale);
+        if (total > parkedPluginWindowBudget || parkedPluginWindows.size() - i > maxParkedPluginWindows)
+        {
+            parkedPluginWindows.removeRange (0, i + 1);
+            break;
+        }
+    }
+}
+
+PluginWindow* WindowManager::unparkPluginWindowFor (const Node& node)
+{
+    for (int i = parkedPluginWindows.size(); --i >= 0;)
+    {
+        auto* window = parkedPluginWindows.getUnchecked (i);
+        if (window->node != node)
+            continue;
+
+        // a node that was reloaded needs a new editor
+        if (window->owner != node.getGraphNode())
+        {
+            parkedPluginWindows.remove (i);
+            return nullptr;
+        }
+
+        window->node.setProperty (Tags::windowVisible, true);
+        return activePluginWindows.add (parkedPluginWindows.removeAndReturn (i));
+    }
+
+    return nullptr;
+}
+
 PluginWindow* WindowManager::createPluginWindowFor (const Node& n, Component* e)
 {
     auto* window = activePluginWindows.add (new PluginWindow (gui, e, n));
@@ -118,16 +118,26 @@ public:
     inline void closeOpenPluginWindowsFor (GraphProcessor& proc, const bool windowVisible)
     {
         for (int i = 0; i < proc.getNumNodes(); ++i)
+        {
             if (auto node = proc.getNode (i))
+            {
                 for (int j = activePluginWindows.size(); --j >= 0;)
                     if (activePluginWindows.getUnchecked(j)->owner == node)
                         { deletePluginWindow (j, windowVisible); break; }
+                for (int j = parkedPluginWindows.size(); --j >= 0;)
+                    if (parkedPluginWindows.getUnchecked(j)->owner == node)
+                        parkedPluginWindows.remove (j);
+            }
+        }
     }
     
     inline void closeOpenPluginWindowsFor (GraphNode* const node, const bool windowVisible)
     {
         if (! node)
             return;
+        for (int i = parkedPluginWindows.size(); --i >= 0;)
+            if (parkedPluginWindows.getUnchecked(i)->owner == node)
+                parkedPluginWindows.remove (i);
         for (int i = activePluginWindows.size(); --i >= 0;)
             if (activePluginWindows.getUnchecked(i)->owner == node)
                 { deletePluginWindow (i, windowVisible); break; }
@@ -135,6 +145,10 @@ public:
     
     inline void closeOpenPluginWindowsFor (const uint32 nodeId, const bool windowVisible)
     {
+        // parked windows may outlive their graph node, so match them by model
+        for (int i = parkedPluginWindows.size(); --i >= 0;)
+            if (parkedPluginWindows.getUnchecked(i)->node.getNodeId() == nodeId)
+                parkedPluginWindows.remove (i);
         for (int i = activePluginWindows.size(); --i >= 0;)
             if (activePluginWindows.getUnchecked(i)->owner->nodeId == nodeId)
                 { deletePluginWindow (i, windowVisible); break; }
@@ -142,6 +156,9 @@ public:
     
     inline void closeOpenPluginWindowsFor (const Node& node, const bool windowVisible)
     {
+        for (int i = parkedPluginWindows.size(); --i >= 0;)
+            if (parkedPluginWindows.getUnchecked(i)->node == node)
+                parkedPluginWindows.remove (i);
         for (int i = activePluginWindows.size(); --i >= 0;)
             if (activePluginWindows.getUnchecked(i)->node == node)
                 { deletePluginWindow (i, windowVisible); break; }
@@ -149,18 +166,30 @@ public:
 
     inline void closeAllPluginWindows (const bool windowVisible)
     {
-        if (activePluginWindows.size() > 0)
+        if (activePluginWindows.size() > 0 || parkedPluginWindows.size() > 0)
         {
             for (int i = activePluginWindows.size(); --i >= 0;)
                 deletePluginWindow (i, windowVisible);
+            parkedPluginWindows.clear (true);
             MessageManager::getInstance()->runDispatchLoopUntil (50);
         }
     }
+
+    /** Hides every open plugin window, keeping their editors parked */
+    inline void hideAllPluginWindows (const bool windowVisible)
+    {
+        for (int i = activePluginWindows.size(); --i >= 0;)
+            parkPluginWindow (i, windowVisible);
+    }
     
     inline void closePluginWindow (PluginWindow* win)
     {
-        deletePluginWindow (win, false);
+        jassert (activePluginWindows.contains (win));
+        parkPluginWindow (activePluginWindows.indexOf (win), false);
     }
+
+    /** Returns the number of hidden windows kept for reopening */
+    inline int getNumParkedPluginWindows() const { return parkedPluginWindows.size(); }
     
     inline PluginWindow* getPluginWindowFor (GraphNode* node)
     {
@@ -175,6 +204,10 @@ public:
         return getPluginWindowFor (node.getGraphNode());
     }
 
+    /** Moves a parked window for the node back with the open ones and
+        returns it, or nullptr if its editor wasn't kept */
+    PluginWindow* unparkPluginWindowFor (const Node& node);
+
     inline PluginWindow* createPluginWindowFor (const Node& node)
     {
         if (node.getIdentifier().toString() == EL_INTERNAL_ID_MIDI_PROGRAM_MAP)
@@ -228,14 +261,22 @@ public:
     }
 
 private:
+    /** Parked windows are dropped, oldest first, past either limit. Their size
+        is estimated from the pixels a window's editor paints */
+    enum { maxParkedPluginWindows = 16 };
+    static constexpr int64 parkedPluginWindowBudget = 128 * 1024 * 1024;
+
     GuiController& gui;
     OwnedArray<PluginWindow> activePluginWindows;
+    OwnedArray<PluginWindow> parkedPluginWindows;
     OwnedArray<Window> activeWindows;
     OwnedArray<DialogWindow> activeDialogs;
     void onWindowClosed (Window* c);
     
     void deletePluginWindow (PluginWindow* window, const bool windowVisible);
     void deletePluginWindow (const int index, const bool windowVisible);
+    void parkPluginWindow (const int index, const bool windowVisible);
+    void trimParkedPluginWindows();
     PluginWindow* createPluginWindowFor (const Node& n, Component* e);
 };
 
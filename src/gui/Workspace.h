@@ -71,6 +71,14 @@ public:
         return *this;
     }
 
+    /** Returns a deep copy that can be handed to another thread */
+    inline WorkspaceState createCopy() const
+    {
+        WorkspaceState copy;
+        copy.objectData = objectData.createCopy();
+        return copy;
+    }
+
 private:
     void setMissing();
 };
@@ -27,7 +27,7 @@ namespace Element {
 CompressorNodeEditor::CompViz::CompViz (CompressorProcessor& proc) :
     proc (proc)
 {
-    startTimer (40);
+    startRefresh (25);
 
     updateCurve();
 
@@ -84,7 +84,7 @@ void CompressorNodeEditor::CompViz::updateInGainDB (float inDB)
     dotY = getYForDB (outDB);
 }
 
-void CompressorNodeEditor::CompViz::timerCallback()
+void CompressorNodeEditor::CompViz::refreshCallback()
 {
     repaint();
 }
@@ -125,7 +125,7 @@ CompressorNodeEditor::CompressorNodeEditor (CompressorProcessor& proc) :
     knobs (proc, [this, &proc] { proc.updateParams(); compViz.updateCurve(); }),
     compViz (proc)
 {
-    setSize (610, 420);
+    setSize (790, 420);
 
     addAndMakeVisible (knobs);
     addAndMakeVisible (compViz);
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "engine/nodes/CompressorProcessor.h"
+#include "gui/RefreshClock.h"
 #include "KnobsComponent.h"
 
 namespace Element {
@@ -41,14 +42,14 @@ private:
 
     class CompViz : public Component,
                     private CompressorProcessor::Listener,
-                    private Timer
+                    private RefreshClient
     {
     public:
         CompViz (CompressorProcessor& proc);
         ~CompViz();
 
         void updateInGainDB (float inDB) override;
-        void timerCallback() override;
+        void refreshCallback() override;
 
         void updateCurve();
         float getDBForX (float xPos);
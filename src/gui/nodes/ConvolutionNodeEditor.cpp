@@ -0,0 +1,87 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "ConvolutionNodeEditor.h"
+
+namespace Element {
+
+ConvolutionNodeEditor::ConvolutionNodeEditor (ConvolutionProcessor& p)
+    : AudioProcessorEditor (p),
+      proc (p),
+      impulseFile ("Impulse Response", p.getImpulseFile(), false, false, false,
+                   p.getWildcard(), String(), "(choose an impulse response)"),
+      knobs (p)
+{
+    addAndMakeVisible (impulseFile);
+    impulseFile.addListener (this);
+    addAndMakeVisible (impulseInfo);
+    impulseInfo.setFont (Font (12.f));
+    addAndMakeVisible (knobs);
+
+    proc.addChangeListener (this);
+    updateInfo();
+    setSize (400, 170);
+}
+
+ConvolutionNodeEditor::~ConvolutionNodeEditor()
+{
+    proc.removeChangeListener (this);
+    impulseFile.removeListener (this);
+}
+
+void ConvolutionNodeEditor::paint (Graphics& g)
+{
+    g.fillAll (Colours::black);
+}
+
+void ConvolutionNodeEditor::resized()
+{
+    auto r = getLocalBounds().reduced (4);
+    impulseFile.setBounds (r.removeFromTop (22));
+    impulseInfo.setBounds (r.removeFromTop (20));
+    knobs.setBounds (r);
+}
+
+void ConvolutionNodeEditor::filenameComponentChanged (FilenameComponent*)
+{
+    const auto file = impulseFile.getCurrentFile();
+    if (file == proc.getImpulseFile())
+        return;
+
+    if (! file.existsAsFile() || ! proc.loadImpulse (file))
+        impulseFile.setCurrentFile (proc.getImpulseFile(), false, dontSendNotification);
+}
+
+void ConvolutionNodeEditor::changeListenerCallback (ChangeBroadcaster*)
+{
+    impulseFile.setCurrentFile (proc.getImpulseFile(), false, dontSendNotification);
+    updateInfo();
+}
+
+void ConvolutionNodeEditor::updateInfo()
+{
+    const int length = proc.getImpulseLength();
+    const double rate = proc.getSampleRate() > 0.0 ? proc.getSampleRate() : 44100.0;
+    impulseInfo.setText (length > 0 ? String (length / rate, 2) + " seconds"
+                                    : String ("No impulse response"),
+                         dontSendNotification);
+}
+
+}
@@ -0,0 +1,52 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "engine/nodes/ConvolutionProcessor.h"
+#include "KnobsComponent.h"
+
+namespace Element {
+
+class ConvolutionNodeEditor : public AudioProcessorEditor,
+                              private FilenameComponentListener,
+                              private ChangeListener
+{
+public:
+    ConvolutionNodeEditor (ConvolutionProcessor& proc);
+    ~ConvolutionNodeEditor();
+
+    void paint (Graphics& g) override;
+    void resized() override;
+
+private:
+    ConvolutionProcessor& proc;
+    FilenameComponent impulseFile;
+    Label impulseInfo;
+    KnobsComponent knobs;
+
+    void filenameComponentChanged (FilenameComponent*) override;
+    void changeListenerCallback (ChangeBroadcaster*) override;
+    void updateInfo();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionNodeEditor)
+};
+
+}
@@ -407,6 +407,9 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterDisplayComponent)
 };
 
+/** Lays out a row per parameter, but only keeps components for the rows in
+    view. Rows scrolled away are deleted and stop listening, so a plugin with
+    hundreds of parameters only updates the few that can be seen */
 class ParametersPanel   : public Component
 {
 public:
@@ -414,30 +417,76 @@ public:
     {
         for (auto* param : params)
             if (param->isAutomatable())
-                addAndMakeVisible (paramComponents.add (new ParameterDisplayComponent (param)));
+                parameters.add (param);
 
-        if (auto* comp = paramComponents [0])
-            setSize (comp->getWidth(), comp->getHeight() * paramComponents.size());
-        else
+        if (parameters.isEmpty())
             setSize (400, 100);
+        else
+            setSize (400, rowHeight * parameters.size());
     }
 
     void paint (Graphics& g) override { }
 
     void resized() override
     {
-        auto area = getLocalBounds();
+        for (auto* row : rows)
+            row->component.setBounds (0, row->index * rowHeight, getWidth(), rowHeight);
+    }
+
+    /** Creates the rows inside the area, plus one either side, and deletes the rest */
+    void showRows (Rectangle<int> visibleArea)
+    {
+        const int first = jmax (0, visibleArea.getY() / rowHeight - 1);
+        const int last  = jmin (parameters.size(), visibleArea.getBottom() / rowHeight + 2);
 
-        for (auto* comp : paramComponents)
-            comp->setBounds (area.removeFromTop (comp->getHeight()));
+        for (int i = rows.size(); --i >= 0;)
+            if (rows[i]->index < first || rows[i]->index >= last)
+                rows.remove (i);
+
+        for (int i = first; i < last; ++i)
+        {
+            if (findRow (i) != nullptr)
+                continue;
+            auto* row = rows.add (new Row (i, parameters [i]));
+            addAndMakeVisible (row->component);
+            row->component.setBounds (0, i * rowHeight, getWidth(), rowHeight);
+        }
     }
 
 private:
-    OwnedArray<ParameterDisplayComponent> paramComponents;
+    static constexpr int rowHeight = 34;
+
+    struct Row
+    {
+        Row (int i, Parameter* param) : index (i), component (param) { }
+        const int index;
+        ParameterDisplayComponent component;
+    };
+
+    ParameterArray parameters;
+    OwnedArray<Row> rows;
+
+    Row* findRow (int index) const
+    {
+        for (auto* row : rows)
+            if (row->index == index)
+                return row;
+        return nullptr;
+    }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParametersPanel)
 };
 
+class ParametersView : public Viewport
+{
+public:
+    void visibleAreaChanged (const Rectangle<int>& area) override
+    {
+        if (auto* panel = dynamic_cast<ParametersPanel*> (getViewedComponent()))
+            panel->showRows (area);
+    }
+};
+
 struct GenericNodeEditor::Pimpl
 {
     Pimpl (GenericNodeEditor& parent)
@@ -452,7 +501,7 @@ struct GenericNodeEditor::Pimpl
     }
 
     GenericNodeEditor& owner;
-    Viewport view;
+    ParametersView view;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Pimpl)
 };
 
@@ -154,13 +154,21 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
     {
         if (auto* const lua = getNodeObjectOfType<LuaNode>())
         {
+            // compiled in the background, the old script keeps playing
+            // and hands its state over once the new one is ready
             const auto script = document.getAllContent();
-            auto result = lua->loadScript (script);
-            if (! result.wasOk())
+            compileButton.setEnabled (false);
+            Component::SafePointer<LuaNodeEditor> self (this);
+            lua->loadScriptAsync (script, true, true, [self] (const Result& result)
             {
-                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
-                    "Script Error", result.getErrorMessage());
-            }
+                if (self != nullptr)
+                    self->compileButton.setEnabled (true);
+                if (! result.wasOk())
+                {
+                    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
+                        "Script Error", result.getErrorMessage());
+                }
+            });
         }
     };
 
@@ -181,12 +189,15 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
     lua->addChangeListener (this);
     portsChangedConnection = lua->portsChanged.connect (
         std::bind (&LuaNodeEditor::onPortsChanged, this));
+    budgetExceededConnection = lua->budgetExceeded.connect (
+        std::bind (&LuaNodeEditor::onBudgetExceeded, this));
     setSize (660, 480);
 }
 
 LuaNodeEditor::~LuaNodeEditor()
 {
     portsChangedConnection.disconnect();
+    budgetExceededConnection.disconnect();
     if (auto* const lua = getNodeObjectOfType<LuaNode>())
     {
         lua->removeChangeListener (this);
@@ -194,6 +205,13 @@ LuaNodeEditor::~LuaNodeEditor()
     }
 }
 
+void LuaNodeEditor::onBudgetExceeded()
+{
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Script Stopped",
+        "node_render went over its budget, so the node was bypassed. "
+        "Fix the script and compile it again to resume.");
+}
+
 void LuaNodeEditor::updateProperties()
 {
     props.clear();
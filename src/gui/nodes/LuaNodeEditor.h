@@ -46,10 +46,12 @@ private:
     TextButton editorButton;
     PropertyPanel props;
     SignalConnection portsChangedConnection;
+    SignalConnection budgetExceededConnection;
     LuaNode::Ptr lua;
 
     void updateProperties();
     void onPortsChanged();
+    void onBudgetExceeded();
 };
 
 }
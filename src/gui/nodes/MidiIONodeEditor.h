@@ -25,8 +25,7 @@
 namespace Element {
 
 class MidiIONodeEditor : public NodeEditorComponent,
-                         public ChangeListener,
-                         private Timer
+                         public ChangeListener
 {
 public:
     MidiIONodeEditor (const Node& node, MidiEngine& engine, bool ins = true, bool outs = true)
@@ -38,14 +37,12 @@ public:
         view.setScrollBarsShown (true, false);
         addAndMakeVisible (view);
         midi.addChangeListener (this);
-        startTimer (1.5 * 1000);
        #endif
     }
 
     ~MidiIONodeEditor()
     {
        #if ! EL_RUNNING_AS_PLUGIN
-        stopTimer();
         midi.removeChangeListener (this);
         view.setViewedComponent (nullptr, false);
         content.reset();
@@ -184,7 +181,7 @@ private:
             for (auto* btn : midiInputs)
                 btn->removeListener (this);
             midiInputs.clearQuick(true);
-            for (const auto& name : MidiInput::getDevices())
+            for (const auto& name : owner.midi.getMidiInputDevices())
             {
                 auto* toggle = midiInputs.add (new ToggleButton (name));
                 toggle->setToggleState (owner.midi.isMidiInputEnabled (name), dontSendNotification);
@@ -198,7 +195,7 @@ private:
             midiOutputs.clear (dontSendNotification);
             int itemId = 1;
             midiOutputs.addItem ("<< none >>", itemId++);
-            for (const auto& name : MidiOutput::getDevices())
+            for (const auto& name : owner.midi.getMidiOutputDevices())
             {
                 midiOutputs.addItem (name, itemId++);
             }
@@ -255,22 +252,6 @@ private:
     };
 
     std::unique_ptr<Content> content;
-
-    void timerCallback() override
-    {
-       #if ! EL_RUNNING_AS_PLUGIN
-        if (! content)
-            return;
-        bool didAnything = false;
-        if (showIns && content->midiInputs.size() != MidiInput::getDevices().size())
-            { content->updateInputs(); didAnything = true; }
-        if (showOuts && content->midiOutputs.getNumItems() - 1 != MidiOutput::getDevices().size())
-            { content->updateOutputs(); didAnything = true; }
-
-        if (didAnything)
-            content->updateSize();
-       #endif
-    }
 };
 
 }
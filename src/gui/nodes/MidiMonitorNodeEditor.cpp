@@ -87,19 +87,38 @@ MidiMonitorNodeEditor::MidiMonitorNodeEditor (const Node& node)
             n->clearMessages();
     };
 
+    addAndMakeVisible (droppedLabel);
+    droppedLabel.setJustificationType (Justification::centredRight);
+    droppedLabel.setFont (Font (12.f));
+    if (auto* n = getNodeObjectOfType<MidiMonitorNode>())
+        droppedConnection = n->messagesLogged.connect (
+            std::bind (&MidiMonitorNodeEditor::updateDropped, this));
+    updateDropped();
+
     setSize (320, 160);
 }
 
 MidiMonitorNodeEditor::~MidiMonitorNodeEditor()
 {
+    droppedConnection.disconnect();
     logger.reset();
 }
 
+void MidiMonitorNodeEditor::updateDropped()
+{
+    auto* const n = getNodeObjectOfType<MidiMonitorNode>();
+    const int numDropped = n != nullptr ? n->getNumDropped() : 0;
+    droppedLabel.setText (numDropped > 0 ? String (numDropped) + " dropped" : String(),
+                          dontSendNotification);
+}
+
 void MidiMonitorNodeEditor::resized ()
 {
     auto r1 = getLocalBounds().reduced (4);
     clearButton.changeWidthToFitText (24);
     clearButton.setBounds (r1.getX(), r1.getY(), clearButton.getWidth(), clearButton.getHeight());
+    droppedLabel.setBounds (clearButton.getRight() + 4, r1.getY(),
+                            r1.getRight() - clearButton.getRight() - 4, clearButton.getHeight());
     r1.removeFromTop (24 + 2);
     logger->setBounds (r1);
 }
@@ -35,6 +35,9 @@ public:
 private:
     class Logger; std::unique_ptr<Logger> logger;
     TextButton clearButton;
+    Label droppedLabel;
+    SignalConnection droppedConnection;
+    void updateDropped();
 };
 
 }
@@ -34,6 +34,9 @@ OSCReceiverNodeEditor::OSCReceiverNodeEditor (const Node& node)
     portNumberSlider.setRange (1.0, 65535.0, 1.0);
     portNumberSlider.setSliderStyle (Slider::IncDecButtons);
     portNumberSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 60, 22);
+    jitterBufferSlider.setRange (0.0, 1000.0, 1.0);
+    jitterBufferSlider.setSliderStyle (Slider::IncDecButtons);
+    jitterBufferSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 60, 22);
 
     syncUIFromNodeState ();
 
@@ -42,6 +45,8 @@ OSCReceiverNodeEditor::OSCReceiverNodeEditor (const Node& node)
     addAndMakeVisible (hostNameField);
     addAndMakeVisible (portNumberLabel);
     addAndMakeVisible (portNumberSlider);
+    addAndMakeVisible (jitterBufferLabel);
+    addAndMakeVisible (jitterBufferSlider);
     addAndMakeVisible (connectButton);
     addAndMakeVisible (pauseButton);
     addAndMakeVisible (clearButton);
@@ -74,6 +79,10 @@ OSCReceiverNodeEditor::OSCReceiverNodeEditor (const Node& node)
         currentPortNumber = newPortNumber;
         oscReceiverNodePtr->setPortNumber (currentPortNumber);
     };
+    jitterBufferSlider.onValueChange = [this]()
+    {
+        oscReceiverNodePtr->setJitterBuffer (jitterBufferSlider.getValue());
+    };
 
     oscReceiverNodePtr->addChangeListener (this);
     oscReceiverNodePtr->addMessageLoopListener (this);
@@ -87,6 +96,7 @@ OSCReceiverNodeEditor::~OSCReceiverNodeEditor()
     clearButton.onClick = nullptr;
     hostNameField.onTextChange = nullptr;
     portNumberSlider.onValueChange = nullptr;
+    jitterBufferSlider.onValueChange = nullptr;
     oscReceiverNodePtr->removeChangeListener (this);
     oscReceiverNodePtr->removeMessageLoopListener (this);
 }
@@ -141,6 +151,17 @@ void OSCReceiverNodeEditor::resetBounds (int fullWidth, int fullHeight)
     x -= margin + w;
     connectionStatusLabel.setBounds (x, y, w, h);
 
+    // Row
+    x = margin;
+    y += h + margin;
+
+    w = 120;
+    jitterBufferLabel.setBounds (x, y, w, h);
+    x += w;
+
+    w = 100;
+    jitterBufferSlider.setBounds (x, y, w, h);
+
     // Row
     x = 0;
     y += h + margin;
@@ -203,6 +224,7 @@ void OSCReceiverNodeEditor::syncUIFromNodeState ()
 
     updateHostNameField ();
     updatePortNumberSlider ();
+    updateJitterBufferSlider ();
     updateConnectionStatusLabel ();
     updateConnectButton ();
     updatePauseButton ();
@@ -218,6 +240,11 @@ void OSCReceiverNodeEditor::updatePortNumberSlider()
     portNumberSlider.setValue ((double) currentPortNumber);
 }
 
+void OSCReceiverNodeEditor::updateJitterBufferSlider()
+{
+    jitterBufferSlider.setValue (oscReceiverNodePtr->getJitterBuffer(), dontSendNotification);
+}
+
 void OSCReceiverNodeEditor::connect()
 {
     if (! Util::isValidOscPort (currentPortNumber))
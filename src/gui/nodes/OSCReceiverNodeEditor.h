@@ -96,6 +96,8 @@ private:
     Label hostNameField      { {}, "127.0.0.1" };
     Label portNumberLabel    { {}, "Port" };
     Slider portNumberSlider;
+    Label jitterBufferLabel  { {}, "Jitter Buffer (ms)" };
+    Slider jitterBufferSlider;
 
     TextButton connectButton { "Connect" };
     TextButton pauseButton { "Pause" };
@@ -117,6 +119,7 @@ private:
     void updatePauseButton();
     void updateHostNameField();
     void updatePortNumberSlider();
+    void updateJitterBufferSlider();
 
     void connect();
     void disconnect();
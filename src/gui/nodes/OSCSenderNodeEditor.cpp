@@ -38,6 +38,9 @@ OSCSenderNodeEditor::OSCSenderNodeEditor (const Node& node)
     portNumberSlider.setRange (1.0, 65535.0, 1.0);
     portNumberSlider.setSliderStyle (Slider::IncDecButtons);
     portNumberSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 60, 22);
+    bundleRateSlider.setRange (0.0, 1000.0, 1.0);
+    bundleRateSlider.setSliderStyle (Slider::IncDecButtons);
+    bundleRateSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 60, 22);
 
     syncUIFromNodeState ();
 
@@ -45,6 +48,9 @@ OSCSenderNodeEditor::OSCSenderNodeEditor (const Node& node)
     addAndMakeVisible (hostNameField);
     addAndMakeVisible (portNumberLabel);
     addAndMakeVisible (portNumberSlider);
+    addAndMakeVisible (bundleRateLabel);
+    addAndMakeVisible (bundleRateSlider);
+    addAndMakeVisible (deduplicateButton);
     addAndMakeVisible (connectButton);
     addAndMakeVisible (pauseButton);
     addAndMakeVisible (clearButton);
@@ -78,24 +84,34 @@ OSCSenderNodeEditor::OSCSenderNodeEditor (const Node& node)
         currentPortNumber = newPortNumber;
         oscSenderNodePtr->setPortNumber (currentPortNumber);
     };
+    bundleRateSlider.onValueChange = [this]()
+    {
+        oscSenderNodePtr->setMaxBundleRate (bundleRateSlider.getValue());
+    };
+    deduplicateButton.onClick = [this]()
+    {
+        oscSenderNodePtr->setDeduplicating (deduplicateButton.getToggleState());
+    };
 
     oscSenderNodePtr->addChangeListener (this);
-    startTimerHz (60);
+    startRefresh (60);
 }
 
 OSCSenderNodeEditor::~OSCSenderNodeEditor()
 {
     /* Unbind handlers */
-    stopTimer ();
+    stopRefresh();
     connectButton.onClick = nullptr;
     pauseButton.onClick = nullptr;
     clearButton.onClick = nullptr;
     hostNameField.onTextChange = nullptr;
     portNumberSlider.onValueChange = nullptr;
+    bundleRateSlider.onValueChange = nullptr;
+    deduplicateButton.onClick = nullptr;
     oscSenderNodePtr->removeChangeListener (this);
 }
 
-void OSCSenderNodeEditor::timerCallback() {
+void OSCSenderNodeEditor::refreshCallback() {
 
     const std::vector<OSCMessage> oscMessages = oscSenderNodePtr->getOscMessages();
 
@@ -155,6 +171,21 @@ void OSCSenderNodeEditor::resetBounds (int fullWidth, int fullHeight)
     x -= margin + w;
     connectionStatusLabel.setBounds (x, y, w, h);
 
+    // Row
+    x = margin;
+    y += h + margin;
+
+    w = 90;
+    bundleRateLabel.setBounds (x, y, w, h);
+    x += w;
+
+    w = 100;
+    bundleRateSlider.setBounds (x, y, w, h);
+    x += w + margin * 2;
+
+    w = 140;
+    deduplicateButton.setBounds (x, y, w, h);
+
     // Row
     x = 0;
     y += h + margin;
@@ -207,6 +238,7 @@ void OSCSenderNodeEditor::syncUIFromNodeState ()
 
     updateHostNameField ();
     updatePortNumberSlider ();
+    updateBundleControls ();
     updateConnectionStatusLabel ();
     updateConnectButton ();
     updatePauseButton ();
@@ -222,6 +254,12 @@ void OSCSenderNodeEditor::updatePortNumberSlider()
     portNumberSlider.setValue ((double) currentPortNumber);
 }
 
+void OSCSenderNodeEditor::updateBundleControls()
+{
+    bundleRateSlider.setValue (oscSenderNodePtr->getMaxBundleRate(), dontSendNotification);
+    deduplicateButton.setToggleState (oscSenderNodePtr->isDeduplicating(), dontSendNotification);
+}
+
 void OSCSenderNodeEditor::connect()
 {
     if (! Util::isValidOscPort (currentPortNumber))
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "engine/nodes/OSCSenderNode.h"
+#include "gui/RefreshClock.h"
 #include "gui/ViewHelpers.h"
 #include "gui/nodes/NodeEditorComponent.h"
 #include "gui/widgets/LogListBox.h"
@@ -76,7 +77,7 @@ private:
 
 class OSCSenderNodeEditor : public NodeEditorComponent,
                             public ChangeListener,
-                            private Timer
+                            private RefreshClient
 {
 public:
     OSCSenderNodeEditor (const Node&);
@@ -85,7 +86,7 @@ public:
     void paint (Graphics&) override;
     void resized() override;
     void resetBounds (int width, int height);
-    void timerCallback() override;
+    void refreshCallback() override;
     void changeListenerCallback (ChangeBroadcaster*) override;
     void syncUIFromNodeState ();
 
@@ -98,6 +99,9 @@ private:
     Label hostNameField      { {}, "127.0.0.1" };
     Label portNumberLabel    { {}, "Port" };
     Slider portNumberSlider;
+    Label bundleRateLabel    { {}, "Max Bundles/s" };
+    Slider bundleRateSlider;
+    ToggleButton deduplicateButton { "Latest values only" };
 
     TextButton connectButton { "Connect" };
     TextButton pauseButton { "Pause" };
@@ -120,6 +124,7 @@ private:
     void updatePauseButton();
     void updateHostNameField();
     void updatePortNumberSlider();
+    void updateBundleControls();
 
     void connect();
     void disconnect();
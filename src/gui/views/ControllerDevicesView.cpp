@@ -568,6 +568,8 @@ public:
 
         deviceName.addListener (this);
         inputDevice.addListener (this);
+        outputDevice.addListener (this);
+        feedbackBudget.addListener (this);
         controlName.addListener (this);
         eventId.addListener (this);
         eventType.addListener (this);
@@ -624,7 +626,9 @@ public:
             updateComboBoxes();
             ensureCorrectDeviceChosen();
         }
-        else if (value.refersToSameSourceAs (inputDevice))
+        else if (value.refersToSameSourceAs (inputDevice) ||
+                 value.refersToSameSourceAs (outputDevice) ||
+                 value.refersToSameSourceAs (feedbackBudget))
         {
             ViewHelpers::postMessageFor (this, 
                 new RefreshControllerDeviceMessage (editedDevice));
@@ -801,6 +805,8 @@ public:
     {
         deviceName.removeListener (this);
         inputDevice.removeListener (this);
+        outputDevice.removeListener (this);
+        feedbackBudget.removeListener (this);
         controlName.removeListener (this);
         eventType.removeListener (this);
         eventId.removeListener (this);
@@ -836,6 +842,30 @@ public:
         
         props.add (new ChoicePropertyComponent (inputDevice, "Input Device", keys, values));
 
+       #if ! EL_RUNNING_AS_PLUGIN
+        {
+            StringArray outputKeys; outputKeys.add ("None");
+            Array<var> outputValues; outputValues.add (String());
+            for (const auto& d : MidiOutput::getDevices())
+            {
+                outputKeys.add (d);
+                outputValues.add (d);
+            }
+
+            const auto outputDeviceName = editedDevice.getOutputDevice().toString();
+            if (outputDeviceName.isNotEmpty() && ! outputKeys.contains (outputDeviceName))
+            {
+                outputKeys.add (outputDeviceName);
+                outputValues.add (outputDeviceName);
+            }
+
+            outputDevice = editedDevice.getPropertyAsValue ("outputDevice");
+            props.add (new ChoicePropertyComponent (outputDevice, "Feedback Output", outputKeys, outputValues));
+            feedbackBudget = editedDevice.getPropertyAsValue ("feedbackBudget");
+            props.add (new SliderPropertyComponent (feedbackBudget, "Feedback Messages/s", 10.0, 3000.0, 10.0));
+        }
+       #endif
+
        #if EL_RUNNING_AS_PLUGIN
         if (auto* inputDeviceProp = dynamic_cast<ChoicePropertyComponent*> (props.getLast()))
         {
@@ -906,6 +936,8 @@ public:
 
         controlName.addListener (this);
         inputDevice.addListener (this);
+        outputDevice.addListener (this);
+        feedbackBudget.addListener (this);
         deviceName.addListener (this);
         eventType.addListener (this);
         eventId.addListener (this);
@@ -1029,7 +1061,7 @@ private:
     PropertyPanel properties;
     ControllerMapsTable maps;
     SessionPtr session;
-    Value deviceName, inputDevice, controlName;
+    Value deviceName, inputDevice, outputDevice, feedbackBudget, controlName;
     Value eventType, eventId, toggleMode;
     Value momentary;
 
@@ -353,9 +353,28 @@ void GraphMixerView::stabilizeContent()
 
 void GraphMixerView::initializeView (AppController& app)
 {
-    content.reset (new Content (*this, *app.findChild<GuiController>(),
-                                app.getGlobals().getSession()));
+    controller = &app;
+    createContent();
+}
+
+void GraphMixerView::willBeRemoved()
+{
+    // the strips and their meters aren't kept while nobody sees them
+    content = nullptr;
+}
+
+void GraphMixerView::willBecomeActive()
+{
+    if (content == nullptr && controller != nullptr)
+        createContent();
+}
+
+void GraphMixerView::createContent()
+{
+    content.reset (new Content (*this, *controller->findChild<GuiController>(),
+                                controller->getGlobals().getSession()));
     addAndMakeVisible (content.get());
+    content->setBounds (getLocalBounds());
     content->stabilize();
 }
 
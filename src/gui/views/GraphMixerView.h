@@ -32,10 +32,14 @@ public:
     void resized() override;
     void stabilizeContent() override;
     void initializeView (AppController&) override;
+    void willBeRemoved() override;
+    void willBecomeActive() override;
     
 private:
     class Content; friend class Content;
     std::unique_ptr<Content> content;
+    AppController* controller = nullptr;
+    void createContent();
 };
 
 }
@@ -20,6 +20,7 @@
 #include "controllers/AppController.h"
 #include "controllers/EngineController.h"
 
+#include "engine/RenderInspector.h"
 #include "engine/VelocityCurve.h"
 
 #include "gui/properties/MidiMultiChannelPropertyComponent.h"
@@ -105,6 +106,94 @@ namespace Element {
         bool locked = false;
     };
 
+    class ParallelRenderPropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        ParallelRenderPropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Multi-core", "Enabled", "Disabled"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+        }
+
+        bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::parallelRender, false);
+        }
+
+        void setState (bool newState) override
+        {
+            graph.setProperty (Tags::parallelRender, newState);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setParallelRenderingEnabled (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
+    class PipelinePropertyComponent : public ChoicePropertyComponent
+    {
+    public:
+        PipelinePropertyComponent (const Node& g)
+            : ChoicePropertyComponent ("Pipeline"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+            choices.add ("Off");
+            for (int stages = 2; stages <= GraphProcessor::maxPipelineStages; ++stages)
+                choices.add (String (stages) + " stages");
+            setTooltip ("Render on more cores by adding a block of latency per stage");
+        }
+
+        int getIndex() const override
+        {
+            return jlimit (0, choices.size() - 1, (int) graph.getProperty (Tags::pipelineStages, 1) - 1);
+        }
+
+        void setIndex (const int index) override
+        {
+            graph.setProperty (Tags::pipelineStages, index + 1);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setPipelineStages (index + 1);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
+    class InlineSubGraphsPropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        InlineSubGraphsPropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Inline Racks", "Enabled", "Disabled"),
+              graph (g)
+        {
+            jassert (graph.isRootGraph());
+        }
+
+        bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::inlineSubGraphs, false);
+        }
+
+        void setState (bool newState) override
+        {
+            graph.setProperty (Tags::inlineSubGraphs, newState);
+            if (auto* node = graph.getGraphNode())
+                if (auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor()))
+                    root->setSubGraphInliningEnabled (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
     class VelocityCurvePropertyComponent : public ChoicePropertyComponent
     {
     public:
@@ -252,6 +341,68 @@ namespace Element {
         bool locked;
     };
 
+    class MemoryBudgetPropertyComponent : public SliderPropertyComponent
+    {
+    public:
+        MemoryBudgetPropertyComponent (const Node& g)
+            : SliderPropertyComponent ("Memory budget (MB)", 0.0, 16384.0, 64.0, 1.0, false),
+              graph (g)
+        {
+            slider.textFromValueFunction = [](double value) -> String {
+                return value <= 0.0 ? String ("None") : String (roundToInt (value));
+            };
+            slider.setTooltip ("A warning is logged when the graph and its nodes hold more than this");
+            slider.updateText();
+        }
+
+        ~MemoryBudgetPropertyComponent()
+        {
+            slider.textFromValueFunction = nullptr;
+        }
+
+        void setValue (double v) override   { graph.setProperty (Tags::memoryBudget, roundToInt (v)); }
+        double getValue() const override    { return (double) graph.getProperty (Tags::memoryBudget, 0); }
+
+    private:
+        Node graph;
+    };
+
+    class RenderProgramPropertyComponent : public ButtonPropertyComponent
+    {
+    public:
+        RenderProgramPropertyComponent (const Node& g)
+            : ButtonPropertyComponent ("Render program", false),
+              graph (g)
+        {
+            setTooltip ("Export the node order, buffers, latency delays and node timings as JSON or Graphviz DOT");
+        }
+
+        String getButtonText() const override { return "Export..."; }
+
+        void buttonClicked() override
+        {
+            auto* const node = graph.getGraphNode();
+            auto* const proc = node != nullptr ? dynamic_cast<GraphProcessor*> (node->getAudioProcessor()) : nullptr;
+            if (proc == nullptr)
+                return;
+
+            const auto name = File::createLegalFileName (graph.getName().isNotEmpty() ? graph.getName() : String ("Graph"));
+            FileChooser chooser ("Export Render Program",
+                File::getSpecialLocation (File::userDocumentsDirectory).getChildFile (name + ".dot"),
+                "*.dot;*.json", true, false);
+            if (! chooser.browseForFileToSave (true))
+                return;
+
+            const auto result = RenderInspector::exportTo (*proc, chooser.getResult());
+            if (result.failed())
+                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Export Render Program",
+                                                  result.getErrorMessage());
+        }
+
+    private:
+        Node graph;
+    };
+
     class GraphPropertyPanel : public PropertyPanel
     {
     public:
@@ -305,6 +456,9 @@ namespace Element {
                                                   TRANS("Name"), 256, false));
            #if defined (EL_PRO)
             props.add (new RenderModePropertyComponent (g));
+            props.add (new ParallelRenderPropertyComponent (g));
+            props.add (new PipelinePropertyComponent (g));
+            props.add (new InlineSubGraphsPropertyComponent (g));
             props.add (new VelocityCurvePropertyComponent (g));
            #endif
 
@@ -317,6 +471,8 @@ namespace Element {
            #if defined (EL_PRO)
             props.add (new MidiProgramPropertyComponent (g));
            #endif
+            props.add (new MemoryBudgetPropertyComponent (g));
+            props.add (new RenderProgramPropertyComponent (g));
 
             for (auto* const p : props)
                 maybeLockObject (p, locked);
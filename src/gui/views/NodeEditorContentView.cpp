@@ -311,6 +311,14 @@ void NodeEditorContentView::stabilizeContent()
     }
 }
 
+void NodeEditorContentView::willBeRemoved()
+{
+    // reconnected by stabilizeContent when the view is shown again
+    selectedNodeConnection.disconnect();
+    graphChangedConnection.disconnect();
+    sessionLoadedConnection.disconnect();
+}
+
 void NodeEditorContentView::setNode (const Node& newNode)
 {
     auto newGraph = newNode.getParentGraph();
@@ -43,6 +43,7 @@ public:
     void setNode (const Node&);
     
     void stabilizeContent() override;
+    void willBeRemoved() override;
     void resized() override;
     void paint (Graphics& g) override;
 
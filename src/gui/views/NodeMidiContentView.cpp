@@ -90,6 +90,12 @@ void NodeMidiContentView::stabilizeContent()
     nodeSync.setFrozen (false);
 }
 
+void NodeMidiContentView::willBeRemoved()
+{
+    selectedNodeConnection.disconnect();
+    midiProgramChangedConnection.disconnect();
+}
+
 void NodeMidiContentView::updateProperties()
 {
    #if EL_NODE_MIDI_CONTENT_VIEW_PROPS
@@ -32,6 +32,7 @@ public:
     ~NodeMidiContentView();
 
     void stabilizeContent() override;
+    void willBeRemoved() override;
 
     void resized() override;
     void paint (Graphics& g) override;
@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "db/Database.h"
 #include "session/PluginManager.h"
 #include "gui/GuiCommon.h"
 #include "gui/views/PluginsPanelView.h"
@@ -89,12 +90,10 @@ public:
     {
         if (isNowOpen)
         {
-            const auto text = panel.getSearchText();
             for (auto* folder : tree.subFolders)
                 addSubItem (new PluginFolderTreeViewItem (panel, *folder));
             for (const auto& plugin : tree.plugins)
-                if (text.isEmpty() || plugin.name.containsIgnoreCase (text))
-                    addSubItem (new PluginTreeViewItem (plugin));
+                addSubItem (new PluginTreeViewItem (plugin));
         }
         else
         {
@@ -106,12 +105,8 @@ public:
 class PluginsPanelTreeRootItem : public TreeViewItem
 {
 public:
-    PluginsPanelTreeRootItem (PluginsPanelView& o, PluginManager& p)
-        : owner(o),
-            plugins (p)
-    {
-        data = p.getKnownPlugins().createTree (KnownPluginList::sortByCategory);
-    }
+    PluginsPanelTreeRootItem (PluginsPanelView& o, std::unique_ptr<KnownPluginList::PluginTree> t)
+        : owner (o), data (std::move (t)) { }
     
     bool mightContainSubItems() override { return true; }
     
@@ -129,14 +124,14 @@ public:
     }
     
     PluginsPanelView& owner;
-    PluginManager& plugins;
-    
     std::unique_ptr<KnownPluginList::PluginTree> data;
 };
 
-PluginsPanelView::PluginsPanelView (PluginManager& p)
-    : plugins(p)
+PluginsPanelView::PluginsPanelView (PluginManager& p, Database& db)
+    : plugins(p), database (db)
 {
+    updateTypes();
+
     addAndMakeVisible (search);
     search.setTextToShowWhenEmpty (TRANS("Search..."), LookAndFeel::textColor.darker());
     search.addListener (this);
@@ -145,7 +140,7 @@ PluginsPanelView::PluginsPanelView (PluginManager& p)
     tree.setRootItemVisible (false);
     tree.setOpenCloseButtonsVisible (true);
     tree.setIndentSize (10);
-    tree.setRootItem (new PluginsPanelTreeRootItem (*this, plugins));
+    tree.setRootItem (new PluginsPanelTreeRootItem (*this, createTree()));
     plugins.getKnownPlugins().addChangeListener (this);
 }
 
@@ -168,34 +163,66 @@ void PluginsPanelView::paint (Graphics& g) { }
 
 void PluginsPanelView::textEditorTextChanged (TextEditor&)
 {
-    startTimer (200);
+    updateTreeView();
+}
+
+void PluginsPanelView::updateTypes()
+{
+    database.updatePlugins (plugins.getKnownPlugins());
+    types = plugins.getKnownPlugins().getTypes();
+    typeIndexes.clear();
+    for (int i = 0; i < types.size(); ++i)
+        typeIndexes.set (types.getReference(i).createIdentifierString(), i);
+
+    lastSearch.clear();
+    lastResults.clear();
+}
+
+std::unique_ptr<KnownPluginList::PluginTree> PluginsPanelView::createTree()
+{
+    const auto text = getSearchText();
+    if (text.isEmpty())
+    {
+        lastSearch.clear();
+        lastResults.clear();
+        return KnownPluginList::createTree (types, KnownPluginList::sortByCategory);
+    }
+
+    // the catalog matches words in names, manufacturers and categories. Text
+    // added to the last search can only narrow its results
+    if (lastResults.size() > 0 && text.startsWith (lastSearch))
+        lastResults = database.search (text, lastResults);
+    else
+        lastResults = database.search (text, Database::plugin);
+    lastSearch = text;
+
+    Array<PluginDescription> matches;
+    for (const auto id : lastResults)
+        if (const auto* record = database.getRecord (id))
+            if (typeIndexes.contains (record->uid))
+                matches.add (types.getReference (typeIndexes [record->uid]));
+    return KnownPluginList::createTree (matches, KnownPluginList::sortByCategory);
 }
 
 void PluginsPanelView::updateTreeView()
 {
     tree.deleteRootItem();
-    tree.setRootItem (new PluginsPanelTreeRootItem (*this, plugins));
+    tree.setRootItem (new PluginsPanelTreeRootItem (*this, createTree()));
     auto* root = tree.getRootItem();
     for (int i = 0; i < root->getNumSubItems();  ++i)
         root->getSubItem(i)->setOpenness (TreeViewItem::opennessOpen);
 }
 
-void PluginsPanelView::timerCallback()
-{
-    updateTreeView();
-    stopTimer();
-}
-
 void PluginsPanelView::textEditorReturnKeyPressed (TextEditor& e)
 {
-    stopTimer();
     updateTreeView();
 }
 
 void PluginsPanelView::changeListenerCallback (ChangeBroadcaster* src)
 {
+    updateTypes();
     tree.deleteRootItem();
-    tree.setRootItem (new PluginsPanelTreeRootItem (*this, plugins));
+    tree.setRootItem (new PluginsPanelTreeRootItem (*this, createTree()));
 }
 
 }
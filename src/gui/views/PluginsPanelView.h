@@ -24,15 +24,21 @@
 
 namespace Element {
 
+class Database;
 class PluginManager;
 
+/** Lists the known plugins by category, filtered by a search box.
+
+    The descriptions are copied and keyed by identifier when the plugin list
+    changes. Searches go through the catalog's word index and results update
+    as the user types, narrowing the last results while text is added.
+ */
 class PluginsPanelView : public ContentView,
                             public ChangeListener,
-                            public TextEditor::Listener,
-                            public Timer
+                            public TextEditor::Listener
 {
 public:
-    PluginsPanelView (PluginManager& pm);
+    PluginsPanelView (PluginManager& pm, Database& db);
     ~PluginsPanelView();
 
     void resized() override;
@@ -45,12 +51,19 @@ public:
     void textEditorTextChanged (TextEditor&) override;
     void textEditorReturnKeyPressed (TextEditor&) override;
     void changeListenerCallback (ChangeBroadcaster*) override;
-    void timerCallback() override;
 private:
     PluginManager& plugins;
+    Database& database;
     TreeView tree;
     TextEditor search;
 
+    Array<PluginDescription> types;
+    HashMap<String, int> typeIndexes;
+    String lastSearch;
+    Array<int> lastResults;
+
+    void updateTypes();
+    std::unique_ptr<KnownPluginList::PluginTree> createTree();
     void updateTreeView();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginsPanelView);
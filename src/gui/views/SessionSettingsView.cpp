@@ -51,6 +51,8 @@ namespace Element {
                                                   "Name", 256, false));
             props.add (new SliderPropertyComponent (s->getPropertyAsValue (Tags::tempo),
                                                     "Tempo", EL_TEMPO_MIN, EL_TEMPO_MAX, 1));
+            props.add (new BooleanPropertyComponent (s->getPropertyAsValue (Tags::doublePrecision),
+                                                     "64-bit Rendering", "Enabled"));
             props.add (new TextPropertyComponent (s->getPropertyAsValue (Tags::notes),
                                                   "Notes", 512, true));
         }
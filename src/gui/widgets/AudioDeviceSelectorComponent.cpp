@@ -216,7 +216,11 @@ public:
             showAdvancedSettingsButton->onClick = [this] { showAdvanced(); };
         }
 
-        type.scanForDevices();
+        // probed once a session, DeviceManager refreshes them in the background
+        if (auto* devices = dynamic_cast<DeviceManager*> (setup.manager))
+            devices->scanIfNeeded (type);
+        else
+            type.scanForDevices();
 
         setup.manager->addChangeListener (this);
     }
@@ -20,14 +20,15 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "gui/RefreshClock.h"
 
 namespace Element {
 
 struct Spinner  : public Component,
-                  private Timer
+                  private RefreshClient
 {
-    Spinner()                       { startTimer (1000 / 50); }
-    void timerCallback() override   { repaint(); }
+    Spinner()                       { startRefresh (50); }
+    void refreshCallback() override { repaint(); }
     void paint (Graphics& g) override
     {
         getLookAndFeel().drawSpinningWaitAnimation (
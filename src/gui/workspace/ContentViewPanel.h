@@ -33,28 +33,49 @@
 
 namespace Element {
 
+/** A panel that shows a content view. The view is made when the panel is
+    first shown and removed from its models while it's hidden */
 template<class ViewType>
 class ContentViewPanel :  public WorkspacePanel
 {
 public:
-    ContentViewPanel() : WorkspacePanel()
+    ContentViewPanel() : WorkspacePanel() { }
+    ~ContentViewPanel() { }
+
+    void stabilizeContent() override
     {
-        addAndMakeVisible (view);
+        if (isContentActive())
+            view->stabilizeContent();
     }
 
-    ~ContentViewPanel() { }
-    
-    void initializeView (AppController& app) override   { view.initializeView (app); }
-    void didBecomeActive() override                     { view.didBecomeActive(); }
-    void stabilizeContent() override                    { view.stabilizeContent(); }
-
     void resized() override
     {
-        view.setBounds (getLocalBounds());
+        if (view != nullptr)
+            view->setBounds (getLocalBounds());
     }
 
 protected:
-    ViewType view;
+    std::unique_ptr<ViewType> view;
+
+    void createContent (AppController& app) override
+    {
+        view.reset (new ViewType());
+        addAndMakeVisible (view.get());
+        view->setBounds (getLocalBounds());
+        view->initializeView (app);
+    }
+
+    void contentShown() override
+    {
+        view->willBecomeActive();
+        view->didBecomeActive();
+        view->stabilizeContent();
+    }
+
+    void contentHidden() override
+    {
+        view->willBeRemoved();
+    }
 };
 
 class ControllerDevicesPanel : public ContentViewPanel<ControllerDevicesView>
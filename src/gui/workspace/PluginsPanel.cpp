@@ -29,15 +29,13 @@ namespace Element {
 
 PluginsPanel::PluginsPanel() {}
 
-void PluginsPanel::initializeView (AppController& app)
+void PluginsPanel::createContent (AppController& app)
 {
-    if (view != nullptr)
-        return;
-    view.reset (new PluginsPanelView (app.getWorld().getPluginManager()));
+    view.reset (new PluginsPanelView (app.getWorld().getPluginManager(), app.getWorld().getDatabase()));
     addAndMakeVisible (view.get());
+    view->setBounds (getLocalBounds());
 }
 
-void PluginsPanel::didBecomeActive() {}
 void PluginsPanel::stabilizeContent() {}
 
 void PluginsPanel::resized() 
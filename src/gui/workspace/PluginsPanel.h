@@ -31,12 +31,12 @@ public:
     PluginsPanel();
     ~PluginsPanel() = default;
 
-    void initializeView (AppController&) override;
-    void didBecomeActive() override;
     void stabilizeContent() override;
-
     void resized() override;
 
+protected:
+    void createContent (AppController&) override;
+
 private:
     std::unique_ptr<PluginsPanelView> view;
 };
@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+
 #pragma once
 
 #include "ElementApp.h"
@@ -25,18 +26,49 @@ namespace Element {
 
 class AppController;
 
+/** A panel in a workspace.
+
+    Panels are made for everything a workspace references, though most of
+    them sit in tabs that aren't selected. Their content isn't made until the
+    panel is first shown, and it's told when the panel is hidden again so it
+    can let go of listeners and timers while nobody sees it.
+ */
 class WorkspacePanel : public DockPanel
 {
 protected:
-    WorkspacePanel() {}
+    WorkspacePanel() : watcher (*this) {}
+
+    /** Called the first time the panel is shown, to make its content */
+    virtual void createContent (AppController&) { }
+
+    /** Called when the content becomes visible, including the first time */
+    virtual void contentShown() { }
+
+    /** Called when content that was visible is hidden */
+    virtual void contentHidden() { }
 
 public:
     virtual ~WorkspacePanel() {}
 
-    virtual void initializeView (AppController&) { }
-    virtual void didBecomeActive() { }
+    /** Called when the panel is added to a workspace */
+    void initializeView (AppController& app)
+    {
+        controller = &app;
+        updateContent();
+    }
+
+    /** Called after the panel was added, content that's showing is refreshed */
+    void didBecomeActive()                      { updateContent(); }
+
+    /** Refreshes content that's showing */
     virtual void stabilizeContent() { }
 
+    /** Returns true if the content was made and is showing */
+    bool isContentActive() const noexcept       { return active; }
+
+    /** Returns true once the content was made */
+    bool hasContent() const noexcept            { return created; }
+
     void showPopupMenu() override
     {
         PopupMenu menu;
@@ -57,6 +89,50 @@ public:
             default: break;
         }
     }
+
+    /** @internal */
+    void parentHierarchyChanged() override      { updateContent(); }
+    /** @internal */
+    void visibilityChanged() override           { updateContent(); }
+
+private:
+    /** Follows the visibility of the panel and every parent, since a tab
+        may hide something that holds the panel rather than the panel itself */
+    struct Watcher : public ComponentMovementWatcher
+    {
+        Watcher (WorkspacePanel& p) : ComponentMovementWatcher (&p), panel (p) {}
+        void componentMovedOrResized (bool, bool) override {}
+        void componentPeerChanged() override        { panel.updateContent(); }
+        void componentVisibilityChanged() override  { panel.updateContent(); }
+        WorkspacePanel& panel;
+    };
+
+    Watcher watcher;
+    AppController* controller = nullptr;
+    bool created = false;
+    bool active = false;
+
+    void updateContent()
+    {
+        if (controller == nullptr)
+            return;
+
+        const bool showing = isShowing();
+        if (showing && ! created)
+        {
+            created = true;
+            createContent (*controller);
+        }
+
+        if (! created || showing == active)
+            return;
+
+        active = showing;
+        if (active)
+            contentShown();
+        else
+            contentHidden();
+    }
 };
 
 }
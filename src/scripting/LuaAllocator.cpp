@@ -0,0 +1,156 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "scripting/LuaAllocator.h"
+
+namespace Element {
+
+static size_t getClassSize (int sizeClass) noexcept
+{
+    return (size_t) LuaAllocator::minBlockSize << sizeClass;
+}
+
+LuaAllocator::LuaAllocator (size_t size)
+    : arenaSize (size)
+{
+    static_assert (((size_t) minBlockSize << (numSizeClasses - 1)) == (size_t) maxBlockSize,
+                   "size classes must reach the largest block");
+    // touching the arena now keeps page faults off the render thread
+    arena.calloc (arenaSize);
+}
+
+LuaAllocator::~LuaAllocator() { }
+
+int LuaAllocator::getSizeClass (size_t size) noexcept
+{
+    if (size > (size_t) maxBlockSize)
+        return -1;
+    int sizeClass = 0;
+    while (getClassSize (sizeClass) < size)
+        ++sizeClass;
+    return sizeClass;
+}
+
+bool LuaAllocator::owns (const void* ptr) const noexcept
+{
+    auto* const p = static_cast<const char*> (ptr);
+    return p >= arena.get() && p < arena.get() + arenaSize;
+}
+
+void* LuaAllocator::allocate (void* allocator, void* ptr, size_t oldSize, size_t newSize) noexcept
+{
+    return static_cast<LuaAllocator*> (allocator)->reallocate (ptr, oldSize, newSize);
+}
+
+LuaAllocator::Stats LuaAllocator::getStats() const noexcept
+{
+    Stats stats;
+    stats.inUse             = inUse.load (std::memory_order_relaxed);
+    stats.peak              = peak.load (std::memory_order_relaxed);
+    stats.arenaSize         = arenaSize;
+    stats.arenaUsed         = arenaUsed.load (std::memory_order_relaxed);
+    stats.systemAllocations = systemAllocations.load (std::memory_order_relaxed);
+    return stats;
+}
+
+void* LuaAllocator::reallocate (void* ptr, size_t oldSize, size_t newSize) noexcept
+{
+    // with no block, Lua passes the type of object being made as the old size
+    if (ptr == nullptr)
+        oldSize = 0;
+
+    if (newSize == 0)
+    {
+        if (ptr != nullptr)
+        {
+            release (ptr, oldSize);
+            inUse.store (inUse.load (std::memory_order_relaxed) - oldSize, std::memory_order_relaxed);
+        }
+        return nullptr;
+    }
+
+    void* block = nullptr;
+    const auto oldClass = getSizeClass (oldSize);
+    if (ptr != nullptr && owns (ptr) && oldClass >= 0 && newSize <= getClassSize (oldClass))
+    {
+        // still fits, a block freed smaller than its class is only
+        // listed under a smaller class
+        block = ptr;
+    }
+    else
+    {
+        block = acquire (newSize);
+        if (block == nullptr)
+            return nullptr;
+        if (ptr != nullptr)
+        {
+            memcpy (block, ptr, jmin (oldSize, newSize));
+            release (ptr, oldSize);
+        }
+    }
+
+    // only ever changed by the thread using the state, so no read-modify-write
+    const auto total = inUse.load (std::memory_order_relaxed) + newSize - oldSize;
+    inUse.store (total, std::memory_order_relaxed);
+    if (total > peak.load (std::memory_order_relaxed))
+        peak.store (total, std::memory_order_relaxed);
+    return block;
+}
+
+void* LuaAllocator::acquire (size_t size) noexcept
+{
+    const auto sizeClass = getSizeClass (size);
+    if (sizeClass >= 0)
+    {
+        if (auto* block = freeLists [sizeClass])
+        {
+            freeLists [sizeClass] = block->next;
+            return block;
+        }
+
+        const auto classSize = getClassSize (sizeClass);
+        if (classSize <= arenaSize - top)
+        {
+            auto* block = arena.get() + top;
+            top += classSize;
+            arenaUsed.store (top, std::memory_order_relaxed);
+            return block;
+        }
+    }
+
+    systemAllocations.fetch_add (1, std::memory_order_relaxed);
+    return std::malloc (size);
+}
+
+void LuaAllocator::release (void* ptr, size_t size) noexcept
+{
+    if (! owns (ptr))
+    {
+        std::free (ptr);
+        return;
+    }
+
+    const auto sizeClass = jmax (0, getSizeClass (size));
+    auto* block = static_cast<FreeBlock*> (ptr);
+    block->next = freeLists [sizeClass];
+    freeLists [sizeClass] = block;
+}
+
+}
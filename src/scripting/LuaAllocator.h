@@ -0,0 +1,93 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A lua_Alloc that serves a Lua state from an arena allocated up front.
+
+    Blocks are carved from the arena in power of two size classes and freed
+    blocks go on a list for their class, so once a script has warmed up it
+    allocates and frees without a system call. Lua passes the size of every
+    block it frees, so blocks carry no header. Large blocks, and anything
+    asked for once the arena is used up, come from the system allocator and
+    are counted so they can be spotted while profiling.
+
+    The allocator isn't locked: it relies on its state being used by one
+    thread at a time. The figures can be read from any thread.
+ */
+class LuaAllocator
+{
+public:
+    enum
+    {
+        defaultArenaSize    = 4 * 1024 * 1024,
+        minBlockSize        = 16,
+        maxBlockSize        = 64 * 1024
+    };
+
+    struct Stats
+    {
+        size_t inUse            = 0;    ///< bytes Lua has allocated
+        size_t peak             = 0;    ///< most bytes allocated at once
+        size_t arenaSize        = 0;    ///< size of the arena
+        size_t arenaUsed        = 0;    ///< bytes of the arena carved into blocks
+        int systemAllocations   = 0;    ///< blocks that came from the system allocator
+    };
+
+    explicit LuaAllocator (size_t arenaSize = defaultArenaSize);
+    ~LuaAllocator();
+
+    /** The lua_Alloc to pass to lua_newstate along with this allocator */
+    static void* allocate (void* allocator, void* ptr, size_t oldSize, size_t newSize) noexcept;
+
+    /** Returns the current figures */
+    Stats getStats() const noexcept;
+
+    /** Returns the size class of a block, or -1 if it's too large for one */
+    static int getSizeClass (size_t size) noexcept;
+
+    /** Returns true if a block lives in the arena */
+    bool owns (const void* ptr) const noexcept;
+
+private:
+    enum { numSizeClasses = 13 };
+
+    struct FreeBlock { FreeBlock* next; };
+
+    HeapBlock<char> arena;
+    const size_t arenaSize;
+    size_t top = 0;
+    FreeBlock* freeLists [numSizeClasses] {};
+
+    std::atomic<size_t> inUse { 0 }, peak { 0 }, arenaUsed { 0 };
+    std::atomic<int> systemAllocations { 0 };
+
+    void* reallocate (void* ptr, size_t oldSize, size_t newSize) noexcept;
+    void* acquire (size_t size) noexcept;
+    void release (void* ptr, size_t size) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (LuaAllocator)
+};
+
+}
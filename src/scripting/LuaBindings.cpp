@@ -24,7 +24,11 @@
 #include "controllers/GuiController.h"
 
 #include "engine/AudioEngine.h"
+#include "engine/GraphNode.h"
+#include "engine/GraphProcessor.h"
 #include "engine/MidiPipe.h"
+#include "engine/nodes/LuaNode.h"
+#include "engine/RenderInspector.h"
 
 #include "session/CommandManager.h"
 #include "session/MediaManager.h"
@@ -36,6 +40,7 @@
 #include "Globals.h"
 #include "Settings.h"
 
+#include "scripting/LuaDSP.h"
 #include "scripting/LuaIterators.h"
 
 #include "sol/sol.hpp"
@@ -196,7 +201,15 @@ static void openModel (sol::state& lua)
                 self->setName (String::fromUTF8 (name));
             },[](const Session& self) -> std::string {
                 return self.getName().toStdString();
-            })
+            }),
+
+        /// Runs a function making edits, which the engine then takes in one go
+        // @function batch
+        // @param edits Function making the edits
+        "batch", [](Session* self, sol::function edits) {
+            Session::ScopedBatch batch (*self);
+            edits();
+        }
         
        #if 0
         "clear",                    &Session::clear,
@@ -262,6 +275,58 @@ static void openModel (sol::state& lua)
             Node::sanitizeRuntimeProperties (copy, true);
             return copy.toXmlString().toStdString();
         },
+        /// Returns the node's render times in a table with fields last,
+        // average and maximum (milliseconds) and load (fraction of the block).
+        // Times are only measured while profiling is enabled. Lua nodes add
+        // their script's memory in bytes (memory, memorypeak, arena) and
+        // average garbage collection time per block (gc)
+        // @function profile
+        "profile", [](Node* self, sol::this_state s) -> sol::object
+        {
+            GraphNodePtr graphNode = self->getGraphNode();
+            if (graphNode == nullptr)
+                return sol::lua_nil;
+            const auto time = graphNode->getProcessTime();
+            auto table = sol::state_view (s).create_table();
+            table["last"]    = time.lastMs;
+            table["average"] = time.averageMs;
+            table["maximum"] = time.maximumMs;
+            table["load"]    = time.load;
+            if (auto* lua = dynamic_cast<LuaNode*> (graphNode.get()))
+            {
+                const auto script = lua->getScriptProfile();
+                table["memory"]     = (double) script.memory.inUse;
+                table["memorypeak"] = (double) script.memory.peak;
+                table["arena"]      = (double) script.memory.arenaSize;
+                table["gc"]         = script.gc.averageMs;
+            }
+            return table;
+        },
+        "resetprofile", [](Node* self)
+        {
+            if (GraphNodePtr graphNode = self->getGraphNode())
+            {
+                graphNode->resetProcessTime();
+                if (auto* lua = dynamic_cast<LuaNode*> (graphNode.get()))
+                    lua->resetScriptProfile();
+            }
+        },
+        /// Returns a graph's render program as a string, format "json" (the
+        // default) or "dot" for Graphviz. It lists the ops in render order with
+        // their buffers, latency delays and the timings of profiled nodes.
+        // Returns nil for nodes that aren't graphs
+        // @function renderprogram
+        "renderprogram", [](Node* self, sol::optional<std::string> format, sol::this_state s) -> sol::object
+        {
+            GraphNodePtr graphNode = self->getGraphNode();
+            auto* const graph = graphNode != nullptr ? dynamic_cast<GraphProcessor*> (graphNode->getAudioProcessor()) : nullptr;
+            if (graph == nullptr)
+                return sol::lua_nil;
+            const auto info = graph->getRenderProgramInfo();
+            const auto text = format.value_or ("json") == "dot" ? RenderInspector::toDot (info)
+                                                                : RenderInspector::toJSON (info);
+            return sol::make_object (s, text.toStdString());
+        },
         "resetports",           &Node::resetPorts,
         "savestate",            &Node::savePluginState,
         "restoretate",          &Node::restorePluginState,
@@ -301,6 +366,14 @@ static void openModel (sol::state& lua)
         return defaultGraph ? Node::createDefaultGraph (name)
                             : Node::createGraph (name);
     });
+
+    /// Enables or disables render time measurement of every node
+    // @function setprofiling
+    e.set_function ("setprofiling", [](bool enabled) { GraphNode::setProfilingEnabled (enabled); });
+
+    /// Returns true if every node's render time is measured
+    // @function profiling
+    e.set_function ("profiling", []() { return GraphNode::isProfilingEnabled(); });
 }
 
 void openKV (state& lua)
@@ -378,6 +451,7 @@ static void openWorld (state& lua)
 void openDSP (sol::state& lua)
 {
     kv_openlibs (lua.lua_state(), 0);
+    openKernels (lua.lua_state());
 }
 
 void openLibs (sol::state& lua)
@@ -0,0 +1,161 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "scripting/LuaBytecodeCache.h"
+#include "DataPath.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+static int writeChunk (lua_State*, const void* data, size_t size, void* stream)
+{
+    return static_cast<MemoryOutputStream*> (stream)->write (data, size) ? 0 : 1;
+}
+
+LuaBytecodeCache::LuaBytecodeCache()
+    : LuaBytecodeCache (getDefaultDirectory()) { }
+
+LuaBytecodeCache::LuaBytecodeCache (const File& dir)
+    : directory (dir) { }
+
+LuaBytecodeCache::~LuaBytecodeCache() { }
+
+File LuaBytecodeCache::getDefaultDirectory()
+{
+    return DataPath::applicationDataDir().getChildFile ("LuaCache");
+}
+
+String LuaBytecodeCache::getKey (const String& source, const String& chunkName)
+{
+    String text = LUA_RELEASE;
+    text << "\n" << (int) sizeof (lua_Number) << (int) sizeof (lua_Integer) << (int) sizeof (size_t)
+         << "\n" << chunkName << "\n" << source;
+    return MD5 (text.toUTF8()).toHexString();
+}
+
+int LuaBytecodeCache::load (lua_State* L, const String& source, const String& chunkName)
+{
+    const auto key = getKey (source, chunkName);
+    const auto name = chunkName.toRawUTF8();
+
+    MemoryBlock chunk;
+    if (find (key, chunk))
+    {
+        if (luaL_loadbufferx (L, (const char*) chunk.getData(), chunk.getSize(), name, "b") == LUA_OK)
+            return LUA_OK;
+        lua_pop (L, 1);
+    }
+
+    const auto utf8 = source.toRawUTF8();
+    const int status = luaL_loadbufferx (L, utf8, strlen (utf8), name, "t");
+    if (status != LUA_OK)
+        return status;
+
+    MemoryOutputStream dumped;
+    // debug info is kept so errors still have line numbers
+    const int dumpStatus = lua_dump (L, writeChunk, &dumped, 0);
+    if (dumpStatus == 0 && dumped.getDataSize() > 0)
+        store (key, dumped.getMemoryBlock());
+    return status;
+}
+
+bool LuaBytecodeCache::contains (const String& source, const String& chunkName) const
+{
+    const auto key = getKey (source, chunkName);
+    {
+        const ScopedLock sl (lock);
+        if (chunks.contains (key))
+            return true;
+    }
+    return directory != File() && directory.getChildFile (key + ".luac").existsAsFile();
+}
+
+void LuaBytecodeCache::clear()
+{
+    const ScopedLock sl (lock);
+    chunks.clear();
+    if (directory != File())
+        for (const auto& file : directory.findChildFiles (File::findFiles, false, "*.luac"))
+            file.deleteFile();
+}
+
+int LuaBytecodeCache::preload()
+{
+    if (directory == File())
+        return 0;
+
+    int numRead = 0;
+    for (const auto& file : directory.findChildFiles (File::findFiles, false, "*.luac"))
+    {
+        const auto key = file.getFileNameWithoutExtension();
+        {
+            const ScopedLock sl (lock);
+            if (chunks.contains (key))
+                continue;
+        }
+
+        // read outside the lock so scripts loading meanwhile aren't held up
+        MemoryBlock chunk;
+        if (! file.loadFileAsData (chunk) || chunk.getSize() == 0)
+            continue;
+
+        const ScopedLock sl (lock);
+        chunks.set (key, chunk);
+        ++numRead;
+    }
+
+    return numRead;
+}
+
+bool LuaBytecodeCache::find (const String& key, MemoryBlock& chunk)
+{
+    const ScopedLock sl (lock);
+    if (chunks.contains (key))
+    {
+        chunk = chunks [key];
+        return true;
+    }
+
+    if (directory == File())
+        return false;
+    const auto file = directory.getChildFile (key + ".luac");
+    if (! file.existsAsFile() || ! file.loadFileAsData (chunk) || chunk.getSize() == 0)
+        return false;
+
+    chunks.set (key, chunk);
+    return true;
+}
+
+void LuaBytecodeCache::store (const String& key, const MemoryBlock& chunk)
+{
+    const ScopedLock sl (lock);
+    chunks.set (key, chunk);
+    if (directory == File() || directory.createDirectory().failed())
+        return;
+
+    // written whole or not at all, a half written chunk would only be
+    // rejected by Lua anyway
+    const auto file = directory.getChildFile (key + ".luac");
+    TemporaryFile temp (file);
+    if (temp.getFile().replaceWithData (chunk.getData(), chunk.getSize()))
+        temp.overwriteTargetFileWithTemporary();
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+
+struct lua_State;
+
+namespace Element {
+
+/** Keeps compiled Lua chunks so scripts that have been seen before skip the
+    parser.
+
+    Chunks are dumped with lua_dump and keyed by an MD5 of the Lua release,
+    the chunk name and the source, so an edited script or a different Lua
+    simply misses. They're kept in memory and as files in the application
+    data directory. Lua checks a binary chunk's header as it loads, so a
+    stale or damaged entry falls back to compiling the source.
+
+    The cache can be used from any thread. The usual way to get it is via
+    a SharedResourcePointer.
+ */
+class LuaBytecodeCache
+{
+public:
+    /** Creates a cache stored in the default directory */
+    LuaBytecodeCache();
+
+    /** Creates a cache stored in a directory, or only in memory if the
+        directory is File() */
+    explicit LuaBytecodeCache (const File& directory);
+
+    ~LuaBytecodeCache();
+
+    /** Returns "LuaCache" in the application data directory */
+    static File getDefaultDirectory();
+
+    /** Returns the key a chunk is stored under */
+    static String getKey (const String& source, const String& chunkName);
+
+    /** Pushes a script onto the stack of L as a function, the same way
+        luaL_loadbufferx does, using the cached chunk when there's one.
+        Returns a Lua status code. On error the message is pushed instead */
+    int load (lua_State* L, const String& source, const String& chunkName);
+
+    /** Returns true if a chunk is cached for this source */
+    bool contains (const String& source, const String& chunkName) const;
+
+    /** Forgets every chunk and deletes the cache files */
+    void clear();
+
+    /** Reads every cached chunk file into memory, so scripts loaded later
+        don't wait on the disk. Returns the number of chunks read */
+    int preload();
+
+private:
+    const File directory;
+    CriticalSection lock;
+    HashMap<String, MemoryBlock> chunks;
+
+    bool find (const String& key, MemoryBlock& chunk);
+    void store (const String& key, const MemoryBlock& chunk);
+
+    JUCE_DECLARE_NON_COPYABLE (LuaBytecodeCache)
+};
+
+}
@@ -0,0 +1,964 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "scripting/LuaDSP.h"
+
+namespace Element {
+namespace Lua {
+
+//=============================================================================
+/** el.block: functions over whole channels of the block being rendered, so
+    a script's DSP isn't held up by a binding call for every sample */
+struct BlockModule
+{
+    static RenderBlock& get (lua_State* L)
+    {
+        return *static_cast<RenderBlock*> (lua_touserdata (L, lua_upvalueindex (1)));
+    }
+
+    /** Returns a channel argument, or nullptr for none when it's optional */
+    static kv_sample_t* channel (const RenderBlock& block, lua_State* L, int arg, bool optional = false)
+    {
+        if (optional && lua_isnoneornil (L, arg))
+            return nullptr;
+        const auto c = (int) luaL_checkinteger (L, arg);
+        luaL_argcheck (L, c >= 1 && c <= block.numChannels, arg, "channel out of range");
+        return block.channels [c - 1];
+    }
+
+    template<class Fn>
+    static void forChannels (const RenderBlock& block, lua_State* L, int arg, Fn&& fn)
+    {
+        if (auto* data = channel (block, L, arg, true))
+            fn (data);
+        else
+            for (int c = 0; c < block.numChannels; ++c)
+                fn (block.channels[c]);
+    }
+
+    static int numChannelsOf (lua_State* L)
+    {
+        lua_pushinteger (L, get (L).numChannels);
+        return 1;
+    }
+
+    static int length (lua_State* L)
+    {
+        lua_pushinteger (L, get (L).numFrames);
+        return 1;
+    }
+
+    /** clear ([channel]) */
+    static int clear (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        forChannels (block, L, 1, [&block] (kv_sample_t* data) {
+            FloatVectorOperations::clear (data, block.numFrames);
+        });
+        return 0;
+    }
+
+    /** gain (gain, [channel]) */
+    static int gain (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        const auto g = (kv_sample_t) luaL_checknumber (L, 1);
+        forChannels (block, L, 2, [&block, g] (kv_sample_t* data) {
+            FloatVectorOperations::multiply (data, g, block.numFrames);
+        });
+        return 0;
+    }
+
+    /** fade (start gain, end gain, [channel]) */
+    static int fade (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        const auto start = (kv_sample_t) luaL_checknumber (L, 1);
+        const auto end = (kv_sample_t) luaL_checknumber (L, 2);
+        const auto increment = block.numFrames > 0 ? (end - start) / (kv_sample_t) block.numFrames : kv_sample_t();
+        forChannels (block, L, 3, [&block, start, increment] (kv_sample_t* data) {
+            for (int f = 0; f < block.numFrames; ++f)
+                data[f] *= start + increment * (kv_sample_t) f;
+        });
+        return 0;
+    }
+
+    /** copy (dest channel, source channel) */
+    static int copy (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        auto* dst = channel (block, L, 1);
+        auto* src = channel (block, L, 2);
+        if (dst != src)
+            FloatVectorOperations::copy (dst, src, block.numFrames);
+        return 0;
+    }
+
+    /** add (dest channel, source channel, [gain]) */
+    static int add (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        auto* dst = channel (block, L, 1);
+        auto* src = channel (block, L, 2);
+        const auto g = (kv_sample_t) luaL_optnumber (L, 3, 1.0);
+        FloatVectorOperations::addWithMultiply (dst, src, g, block.numFrames);
+        return 0;
+    }
+
+    /** multiply (dest channel, source channel) */
+    static int multiply (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        auto* dst = channel (block, L, 1);
+        auto* src = channel (block, L, 2);
+        FloatVectorOperations::multiply (dst, src, block.numFrames);
+        return 0;
+    }
+
+    /** peak (channel) */
+    static int peak (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            { lua_pushnumber (L, 0.0); return 1; }
+        const auto* data = channel (block, L, 1);
+        const auto range = FloatVectorOperations::findMinAndMax (data, block.numFrames);
+        lua_pushnumber (L, (lua_Number) jmax (std::abs (range.getStart()), std::abs (range.getEnd())));
+        return 1;
+    }
+
+    /** rms (channel) */
+    static int rms (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            { lua_pushnumber (L, 0.0); return 1; }
+        const auto* data = channel (block, L, 1);
+        double sum = 0.0;
+        for (int f = 0; f < block.numFrames; ++f)
+            sum += (double) data[f] * (double) data[f];
+        lua_pushnumber (L, block.numFrames > 0 ? std::sqrt (sum / block.numFrames) : 0.0);
+        return 1;
+    }
+
+    /** read (channel, table): copies a channel into a plain table, which is
+        quicker to index from Lua than the buffer. Returns the table */
+    static int read (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            { lua_settop (L, 2); return 1; }
+        const auto* data = channel (block, L, 1);
+        luaL_checktype (L, 2, LUA_TTABLE);
+        for (int f = 0; f < block.numFrames; ++f)
+        {
+            lua_pushnumber (L, (lua_Number) data[f]);
+            lua_rawseti (L, 2, f + 1);
+        }
+        lua_settop (L, 2);
+        return 1;
+    }
+
+    /** write (channel, table): copies a table filled by read back */
+    static int write (lua_State* L)
+    {
+        const auto& block = get (L);
+        if (block.channels == nullptr)
+            return 0;
+        auto* data = channel (block, L, 1);
+        luaL_checktype (L, 2, LUA_TTABLE);
+        for (int f = 0; f < block.numFrames; ++f)
+        {
+            lua_rawgeti (L, 2, f + 1);
+            data[f] = (kv_sample_t) lua_tonumber (L, -1);
+            lua_pop (L, 1);
+        }
+        return 0;
+    }
+
+    static MidiView* view (const RenderBlock& block, lua_State* L, int arg)
+    {
+        const auto index = (int) luaL_checkinteger (L, arg);
+        if (block.midiViews == nullptr)
+            return nullptr;
+        luaL_argcheck (L, index >= 1 && index <= block.numMidiViews, arg, "MIDI buffer out of range");
+        return block.midiViews + (index - 1);
+    }
+
+    static int nextEvent (lua_State* L)
+    {
+        auto* midi = static_cast<MidiView*> (lua_touserdata (L, 1));
+        auto i = (int) lua_tointeger (L, 2);
+        if (midi == nullptr)
+            return 0;
+
+        while (++i <= midi->numEvents && midi->events[i - 1].size == 0) { }
+        if (i > midi->numEvents)
+            return 0;
+
+        const auto& event = midi->events [i - 1];
+        lua_pushinteger (L, i);
+        lua_pushinteger (L, event.frame);
+        lua_pushinteger (L, event.data[0]);
+        lua_pushinteger (L, event.data[1]);
+        lua_pushinteger (L, event.data[2]);
+        return 5;
+    }
+
+    /** events (buffer): for i, frame, status, data1, data2 in block.events (1) do
+        Iterates a MIDI buffer's short events by value. Nothing is allocated,
+        the index is for rewriting the event with setevent */
+    static int events (lua_State* L)
+    {
+        const auto& block = get (L);
+        lua_pushcfunction (L, nextEvent);
+        lua_pushlightuserdata (L, view (block, L, 1));
+        lua_pushinteger (L, 0);
+        return 3;
+    }
+
+    /** numevents (buffer) */
+    static int numEvents (lua_State* L)
+    {
+        const auto& block = get (L);
+        auto* midi = view (block, L, 1);
+        lua_pushinteger (L, midi != nullptr ? midi->numEvents : 0);
+        return 1;
+    }
+
+    static void checkEvent (lua_State* L, int arg, uint8* data, int& size, int& frame)
+    {
+        frame   = (int) luaL_checkinteger (L, arg);
+        data[0] = (uint8) luaL_checkinteger (L, arg + 1);
+        data[1] = (uint8) luaL_optinteger (L, arg + 2, 0);
+        data[2] = (uint8) luaL_optinteger (L, arg + 3, 0);
+        size = data[0] == 0 ? 0 : MidiMessage::getMessageLengthFromFirstByte (data[0]);
+    }
+
+    /** setevent (buffer, index, frame, status, [data1], [data2]): rewrites an
+        event in place, a status of zero removes it */
+    static int setEvent (lua_State* L)
+    {
+        const auto& block = get (L);
+        auto* midi = view (block, L, 1);
+        if (midi == nullptr)
+            return 0;
+        const auto i = (int) luaL_checkinteger (L, 2);
+        luaL_argcheck (L, i >= 1 && i <= midi->numEvents, 2, "event out of range");
+
+        uint8 data[3];
+        int size = 0, frame = 0;
+        checkEvent (L, 3, data, size, frame);
+        auto& event = midi->events [i - 1];
+        event.frame = frame;
+        event.size = (uint8) jlimit (0, 3, size);
+        memcpy (event.data, data, 3);
+        midi->changed = true;
+        return 0;
+    }
+
+    /** addevent (buffer, frame, status, [data1], [data2]). Returns false if the
+        view is full */
+    static int addEvent (lua_State* L)
+    {
+        const auto& block = get (L);
+        auto* midi = view (block, L, 1);
+        uint8 data[3];
+        int size = 0, frame = 0;
+        checkEvent (L, 2, data, size, frame);
+        const bool added = midi != nullptr && midi->add (data, size, frame);
+        if (added)
+            midi->changed = true;
+        lua_pushboolean (L, added);
+        return 1;
+    }
+
+    /** addevents (buffer, { frame, status, data1, data2, frame, status, ... }):
+        appends events packed four values each. Returns the number added */
+    static int addEvents (lua_State* L)
+    {
+        const auto& block = get (L);
+        auto* midi = view (block, L, 1);
+        luaL_checktype (L, 2, LUA_TTABLE);
+        const auto count = (int) lua_rawlen (L, 2) / 4;
+        int added = 0;
+        for (int e = 0; e < count && midi != nullptr; ++e)
+        {
+            int values[4];
+            for (int v = 0; v < 4; ++v)
+            {
+                lua_rawgeti (L, 2, e * 4 + v + 1);
+                values[v] = (int) lua_tointeger (L, -1);
+                lua_pop (L, 1);
+            }
+
+            const uint8 data[3] = { (uint8) values[1], (uint8) values[2], (uint8) values[3] };
+            const int size = data[0] == 0 ? 0 : MidiMessage::getMessageLengthFromFirstByte (data[0]);
+            if (! midi->add (data, size, values[0]))
+                break;
+            ++added;
+        }
+
+        if (added > 0)
+            midi->changed = true;
+        lua_pushinteger (L, added);
+        return 1;
+    }
+
+    static void open (lua_State* L, RenderBlock& block)
+    {
+        static const luaL_Reg functions[] = {
+            { "channels",   numChannelsOf },
+            { "length",     length },
+            { "clear",      clear },
+            { "gain",       gain },
+            { "fade",       fade },
+            { "copy",       copy },
+            { "add",        add },
+            { "multiply",   multiply },
+            { "peak",       peak },
+            { "rms",        rms },
+            { "read",       read },
+            { "write",      write },
+            { "events",     events },
+            { "numevents",  numEvents },
+            { "setevent",   setEvent },
+            { "addevent",   addEvent },
+            { "addevents",  addEvents },
+            { nullptr,      nullptr }
+        };
+
+        luaL_getsubtable (L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+        lua_newtable (L);
+        lua_pushlightuserdata (L, &block);
+        luaL_setfuncs (L, functions, 1);
+        lua_setfield (L, -2, "el.block");
+        lua_pop (L, 1);
+    }
+};
+
+//=============================================================================
+// el.dsp: kernels that each run over a whole signal in one call. A signal
+// is an el.dsp vector or, while rendering, a channel number of the block.
+
+static const char* const vectorType     = "el.dsp.Vector";
+static const char* const biquadType     = "el.dsp.Biquad";
+static const char* const onePoleType    = "el.dsp.OnePole";
+static const char* const followerType   = "el.dsp.Follower";
+static const char* const fftType        = "el.dsp.FFT";
+static const char* const midiFilterType = "el.dsp.MidiFilter";
+
+struct alignas (16) Vector
+{
+    int size;
+    kv_sample_t* data() noexcept { return reinterpret_cast<kv_sample_t*> (this + 1); }
+};
+
+struct Signal
+{
+    kv_sample_t* data = nullptr;
+    int length = 0;
+};
+
+static RenderBlock* getBlock (lua_State* L)
+{
+    return static_cast<RenderBlock*> (lua_touserdata (L, lua_upvalueindex (1)));
+}
+
+static Signal checkSignal (lua_State* L, int arg)
+{
+    if (auto* vector = static_cast<Vector*> (luaL_testudata (L, arg, vectorType)))
+        return { vector->data(), vector->size };
+
+    const auto c = (int) luaL_checkinteger (L, arg);
+    auto* block = getBlock (L);
+    if (block == nullptr || block->channels == nullptr)
+        return {};
+    luaL_argcheck (L, c >= 1 && c <= block->numChannels, arg, "channel out of range");
+    return { block->channels [c - 1], block->numFrames };
+}
+
+template<class T>
+static T* newObject (lua_State* L, const char* type)
+{
+    auto* object = new (lua_newuserdata (L, sizeof (T))) T();
+    luaL_setmetatable (L, type);
+    return object;
+}
+
+template<class T>
+static T* checkObject (lua_State* L, const char* type)
+{
+    return static_cast<T*> (luaL_checkudata (L, 1, type));
+}
+
+template<class T>
+static int destroyObject (lua_State* L)
+{
+    static_cast<T*> (lua_touserdata (L, 1))->~T();
+    return 0;
+}
+
+static double checkRate (lua_State* L, int arg)
+{
+    const auto rate = luaL_checknumber (L, arg);
+    luaL_argcheck (L, rate > 0.0, arg, "sample rate must be positive");
+    return rate;
+}
+
+//=============================================================================
+/** vector (size, [value]) */
+static int vectorNew (lua_State* L)
+{
+    const auto size = (int) luaL_checkinteger (L, 1);
+    luaL_argcheck (L, size >= 0, 1, "size can't be negative");
+    auto* vector = static_cast<Vector*> (lua_newuserdata (L,
+        sizeof (Vector) + sizeof (kv_sample_t) * (size_t) size));
+    vector->size = size;
+    FloatVectorOperations::fill (vector->data(), (kv_sample_t) luaL_optnumber (L, 2, 0.0), size);
+    luaL_setmetatable (L, vectorType);
+    return 1;
+}
+
+static int vectorIndex (lua_State* L)
+{
+    auto* vector = static_cast<Vector*> (luaL_checkudata (L, 1, vectorType));
+    if (lua_isinteger (L, 2))
+    {
+        const auto i = (int) lua_tointeger (L, 2);
+        if (i >= 1 && i <= vector->size)
+            lua_pushnumber (L, (lua_Number) vector->data() [i - 1]);
+        else
+            lua_pushnil (L);
+        return 1;
+    }
+
+    lua_pushvalue (L, 2);
+    lua_rawget (L, lua_upvalueindex (1));
+    return 1;
+}
+
+static int vectorNewIndex (lua_State* L)
+{
+    auto* vector = static_cast<Vector*> (luaL_checkudata (L, 1, vectorType));
+    const auto i = (int) luaL_checkinteger (L, 2);
+    luaL_argcheck (L, i >= 1 && i <= vector->size, 2, "index out of range");
+    vector->data() [i - 1] = (kv_sample_t) luaL_checknumber (L, 3);
+    return 0;
+}
+
+static int vectorLength (lua_State* L)
+{
+    lua_pushinteger (L, static_cast<Vector*> (luaL_checkudata (L, 1, vectorType))->size);
+    return 1;
+}
+
+/** vector:fill (value) */
+static int vectorFill (lua_State* L)
+{
+    auto* vector = static_cast<Vector*> (luaL_checkudata (L, 1, vectorType));
+    FloatVectorOperations::fill (vector->data(), (kv_sample_t) luaL_checknumber (L, 2), vector->size);
+    return 0;
+}
+
+//=============================================================================
+/** gain (signal, gain) */
+static int gain (lua_State* L)
+{
+    const auto signal = checkSignal (L, 1);
+    FloatVectorOperations::multiply (signal.data, (kv_sample_t) luaL_checknumber (L, 2), signal.length);
+    return 0;
+}
+
+/** mix (dest, source, [gain]): adds source times gain into dest */
+static int mix (lua_State* L)
+{
+    const auto dst = checkSignal (L, 1);
+    const auto src = checkSignal (L, 2);
+    FloatVectorOperations::addWithMultiply (dst.data, src.data, (kv_sample_t) luaL_optnumber (L, 3, 1.0),
+                                            jmin (dst.length, src.length));
+    return 0;
+}
+
+/** copy (dest, source) */
+static int copy (lua_State* L)
+{
+    const auto dst = checkSignal (L, 1);
+    const auto src = checkSignal (L, 2);
+    if (dst.data != src.data)
+        FloatVectorOperations::copy (dst.data, src.data, jmin (dst.length, src.length));
+    return 0;
+}
+
+//=============================================================================
+/** A transposed direct form II biquad with coefficients from the RBJ cookbook */
+struct Biquad
+{
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    double z1 = 0.0, z2 = 0.0;
+
+    void set (double nb0, double nb1, double nb2, double a0, double na1, double na2) noexcept
+    {
+        b0 = nb0 / a0; b1 = nb1 / a0; b2 = nb2 / a0;
+        a1 = na1 / a0; a2 = na2 / a0;
+    }
+
+    void process (kv_sample_t* data, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double x = data[i];
+            const double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            data[i] = (kv_sample_t) y;
+        }
+    }
+};
+
+enum BiquadShape { lowpass, highpass, bandpass, notch, peak, lowshelf, highshelf };
+
+template<int shape>
+static int biquadDesign (lua_State* L)
+{
+    auto* filter = checkObject<Biquad> (L, biquadType);
+    const auto rate = checkRate (L, 2);
+    const auto freq = jlimit (1.0, rate * 0.499, (double) luaL_checknumber (L, 3));
+    const auto q    = jmax (0.001, (double) luaL_optnumber (L, 4, 0.7071));
+    const auto A    = std::pow (10.0, luaL_optnumber (L, 5, 0.0) / 40.0);
+
+    const auto w0 = MathConstants<double>::twoPi * freq / rate;
+    const auto cosw = std::cos (w0);
+    const auto alpha = std::sin (w0) / (2.0 * q);
+    const auto sq = 2.0 * std::sqrt (A) * alpha;
+
+    switch (shape)
+    {
+        case lowpass:   filter->set ((1.0 - cosw) / 2.0, 1.0 - cosw, (1.0 - cosw) / 2.0, 1.0 + alpha, -2.0 * cosw, 1.0 - alpha); break;
+        case highpass:  filter->set ((1.0 + cosw) / 2.0, -(1.0 + cosw), (1.0 + cosw) / 2.0, 1.0 + alpha, -2.0 * cosw, 1.0 - alpha); break;
+        case bandpass:  filter->set (alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * cosw, 1.0 - alpha); break;
+        case notch:     filter->set (1.0, -2.0 * cosw, 1.0, 1.0 + alpha, -2.0 * cosw, 1.0 - alpha); break;
+        case peak:      filter->set (1.0 + alpha * A, -2.0 * cosw, 1.0 - alpha * A, 1.0 + alpha / A, -2.0 * cosw, 1.0 - alpha / A); break;
+        case lowshelf:
+            filter->set (A * ((A + 1.0) - (A - 1.0) * cosw + sq), 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw),
+                         A * ((A + 1.0) - (A - 1.0) * cosw - sq), (A + 1.0) + (A - 1.0) * cosw + sq,
+                         -2.0 * ((A - 1.0) + (A + 1.0) * cosw), (A + 1.0) + (A - 1.0) * cosw - sq);
+            break;
+        case highshelf:
+            filter->set (A * ((A + 1.0) + (A - 1.0) * cosw + sq), -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw),
+                         A * ((A + 1.0) + (A - 1.0) * cosw - sq), (A + 1.0) - (A - 1.0) * cosw + sq,
+                         2.0 * ((A - 1.0) - (A + 1.0) * cosw), (A + 1.0) - (A - 1.0) * cosw - sq);
+            break;
+    }
+
+    return 0;
+}
+
+/** biquad:process (signal) */
+static int biquadProcess (lua_State* L)
+{
+    auto* filter = checkObject<Biquad> (L, biquadType);
+    const auto signal = checkSignal (L, 2);
+    filter->process (signal.data, signal.length);
+    return 0;
+}
+
+static int biquadReset (lua_State* L)
+{
+    auto* filter = checkObject<Biquad> (L, biquadType);
+    filter->z1 = filter->z2 = 0.0;
+    return 0;
+}
+
+//=============================================================================
+struct OnePole
+{
+    double coefficient = 0.0, state = 0.0;
+    bool highpass = false;
+};
+
+template<bool highpass>
+static int onePoleDesign (lua_State* L)
+{
+    auto* filter = checkObject<OnePole> (L, onePoleType);
+    const auto rate = checkRate (L, 2);
+    const auto freq = jlimit (0.0, rate * 0.499, (double) luaL_checknumber (L, 3));
+    filter->coefficient = std::exp (-MathConstants<double>::twoPi * freq / rate);
+    filter->highpass = highpass;
+    return 0;
+}
+
+/** onepole:process (signal) */
+static int onePoleProcess (lua_State* L)
+{
+    auto* filter = checkObject<OnePole> (L, onePoleType);
+    const auto signal = checkSignal (L, 2);
+    const auto a = filter->coefficient;
+    auto y = filter->state;
+    for (int i = 0; i < signal.length; ++i)
+    {
+        const double x = signal.data[i];
+        y = (1.0 - a) * x + a * y;
+        signal.data[i] = (kv_sample_t) (filter->highpass ? x - y : y);
+    }
+    filter->state = y;
+    return 0;
+}
+
+static int onePoleReset (lua_State* L)
+{
+    checkObject<OnePole> (L, onePoleType)->state = 0.0;
+    return 0;
+}
+
+//=============================================================================
+struct Follower
+{
+    double attack = 0.0, release = 0.0, level = 0.0;
+};
+
+/** follower:set (rate, attack ms, release ms) */
+static int followerSet (lua_State* L)
+{
+    auto* follower = checkObject<Follower> (L, followerType);
+    const auto rate = checkRate (L, 2);
+    auto coefficient = [rate] (double ms) {
+        return ms > 0.0 ? std::exp (-1.0 / (ms * 0.001 * rate)) : 0.0;
+    };
+    follower->attack  = coefficient (luaL_checknumber (L, 3));
+    follower->release = coefficient (luaL_checknumber (L, 4));
+    return 0;
+}
+
+/** follower:process (signal, [envelope]): follows the signal's level, writing
+    it to envelope when given. Returns the level at the end */
+static int followerProcess (lua_State* L)
+{
+    auto* follower = checkObject<Follower> (L, followerType);
+    const auto signal = checkSignal (L, 2);
+    const auto out = lua_isnoneornil (L, 3) ? Signal() : checkSignal (L, 3);
+    auto level = follower->level;
+    for (int i = 0; i < signal.length; ++i)
+    {
+        const double x = std::abs ((double) signal.data[i]);
+        const auto a = x > level ? follower->attack : follower->release;
+        level = a * level + (1.0 - a) * x;
+        if (i < out.length)
+            out.data[i] = (kv_sample_t) level;
+    }
+    follower->level = level;
+    lua_pushnumber (L, level);
+    return 1;
+}
+
+static int followerLevel (lua_State* L)
+{
+    lua_pushnumber (L, checkObject<Follower> (L, followerType)->level);
+    return 1;
+}
+
+static int followerReset (lua_State* L)
+{
+    checkObject<Follower> (L, followerType)->level = 0.0;
+    return 0;
+}
+
+//=============================================================================
+struct FFT
+{
+    std::unique_ptr<dsp::FFT> fft;
+    HeapBlock<float> work;
+
+    float* load (const Signal& signal) noexcept
+    {
+        const int size = fft->getSize();
+        const int n = jmin (size, signal.length);
+        for (int i = 0; i < n; ++i)
+            work[i] = (float) signal.data[i];
+        FloatVectorOperations::clear (work.get() + n, size * 2 - n);
+        return work.get();
+    }
+};
+
+/** fft (order): an FFT of 2^order points. Best made outside node_render */
+static int fftNew (lua_State* L)
+{
+    const auto order = (int) luaL_checkinteger (L, 1);
+    luaL_argcheck (L, order >= 1 && order <= 16, 1, "order must be 1 to 16");
+    auto* object = newObject<FFT> (L, fftType);
+    object->fft.reset (new dsp::FFT (order));
+    object->work.calloc (2 * (size_t) object->fft->getSize());
+    return 1;
+}
+
+static int fftSize (lua_State* L)
+{
+    lua_pushinteger (L, checkObject<FFT> (L, fftType)->fft->getSize());
+    return 1;
+}
+
+/** fft:magnitudes (signal, out): writes size / 2 + 1 bin magnitudes */
+static int fftMagnitudes (lua_State* L)
+{
+    auto* object = checkObject<FFT> (L, fftType);
+    auto* work = object->load (checkSignal (L, 2));
+    const auto out = checkSignal (L, 3);
+    object->fft->performFrequencyOnlyForwardTransform (work);
+    const int n = jmin (out.length, object->fft->getSize() / 2 + 1);
+    for (int i = 0; i < n; ++i)
+        out.data[i] = (kv_sample_t) work[i];
+    return 0;
+}
+
+/** fft:forward (signal, real, imag): writes size / 2 + 1 complex bins */
+static int fftForward (lua_State* L)
+{
+    auto* object = checkObject<FFT> (L, fftType);
+    auto* work = object->load (checkSignal (L, 2));
+    const auto re = checkSignal (L, 3);
+    const auto im = checkSignal (L, 4);
+    object->fft->performRealOnlyForwardTransform (work, true);
+    const int n = object->fft->getSize() / 2 + 1;
+    for (int i = 0; i < jmin (n, re.length); ++i)
+        re.data[i] = (kv_sample_t) work[i * 2];
+    for (int i = 0; i < jmin (n, im.length); ++i)
+        im.data[i] = (kv_sample_t) work[i * 2 + 1];
+    return 0;
+}
+
+//=============================================================================
+struct MidiFilter
+{
+    int channel = 0;
+    bool notes = true, controllers = true, pitch = true,
+         programs = true, pressure = true, other = true;
+    MidiBuffer scratch;
+
+    bool passes (const uint8* data, int size) const noexcept
+    {
+        if (size <= 0)
+            return false;
+        const auto status = data[0];
+        if (status >= 0xf0)
+            return other;
+        if (channel > 0 && (status & 0x0f) + 1 != channel)
+            return false;
+        switch (status & 0xf0)
+        {
+            case 0x80: case 0x90:   return notes;
+            case 0xa0: case 0xd0:   return pressure;
+            case 0xb0:              return controllers;
+            case 0xc0:              return programs;
+            case 0xe0:              return pitch;
+            default: break;
+        }
+        return other;
+    }
+};
+
+/** midifilter ({ channel = 0, notes = true, controllers = true, pitch = true,
+    programs = true, pressure = true, other = true }) */
+static int midiFilterNew (lua_State* L)
+{
+    auto* filter = newObject<MidiFilter> (L, midiFilterType);
+    filter->scratch.ensureSize (8192);
+    if (lua_istable (L, 1))
+    {
+        auto flag = [L] (const char* name, bool& value) {
+            if (lua_getfield (L, 1, name) != LUA_TNIL)
+                value = lua_toboolean (L, -1) != 0;
+            lua_pop (L, 1);
+        };
+
+        if (lua_getfield (L, 1, "channel") != LUA_TNIL)
+            filter->channel = jlimit (0, 16, (int) lua_tointeger (L, -1));
+        lua_pop (L, 1);
+        flag ("notes", filter->notes);
+        flag ("controllers", filter->controllers);
+        flag ("pitch", filter->pitch);
+        flag ("programs", filter->programs);
+        flag ("pressure", filter->pressure);
+        flag ("other", filter->other);
+    }
+    return 1;
+}
+
+/** midifilter:process (index): removes the events that don't pass from one
+    of the block's MIDI buffers */
+static int midiFilterProcess (lua_State* L)
+{
+    auto* filter = checkObject<MidiFilter> (L, midiFilterType);
+    const auto index = (int) luaL_checkinteger (L, 2);
+    auto* block = getBlock (L);
+    if (block == nullptr || block->midi == nullptr)
+        return 0;
+    luaL_argcheck (L, index >= 1 && index <= block->numMidiBuffers, 2, "buffer out of range");
+
+    auto* buffer = kv_midi_pipe_get (block->midi, index - 1);
+    filter->scratch.clear();
+    kv_midi_buffer_foreach (buffer, iter)
+    {
+        const auto* data = kv_midi_buffer_iter_data (iter);
+        const auto size  = (int) kv_midi_buffer_iter_size (iter);
+        if (filter->passes (data, size))
+            filter->scratch.addEvent (data, size, (int) kv_midi_buffer_iter_frame (iter));
+    }
+
+    kv_midi_pipe_clear (block->midi, index - 1);
+    MidiBuffer::Iterator iter (filter->scratch);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+    while (iter.getNextEvent (data, size, frame))
+        kv_midi_buffer_insert (buffer, data, size, frame);
+    return 0;
+}
+
+//=============================================================================
+static void newType (lua_State* L, const char* name, const luaL_Reg* methods, const luaL_Reg* meta,
+                     void* block)
+{
+    luaL_newmetatable (L, name);
+    lua_newtable (L);
+    lua_pushlightuserdata (L, block);
+    luaL_setfuncs (L, methods, 1);
+    if (meta == nullptr)
+    {
+        lua_setfield (L, -2, "__index");
+    }
+    else
+    {
+        // meta functions get the methods as an upvalue to look names up in
+        luaL_setfuncs (L, meta, 1);
+    }
+    lua_pop (L, 1);
+}
+
+void openRenderBlock (lua_State* L, RenderBlock& block)
+{
+    BlockModule::open (L, block);
+    openKernels (L, &block);
+}
+
+void openKernels (lua_State* L, RenderBlock* block)
+{
+    static const luaL_Reg vectorMethods[] = {
+        { "fill",       vectorFill },
+        { "size",       vectorLength },
+        { nullptr,      nullptr }
+    };
+    static const luaL_Reg vectorMeta[] = {
+        { "__index",    vectorIndex },
+        { "__newindex", vectorNewIndex },
+        { "__len",      vectorLength },
+        { nullptr,      nullptr }
+    };
+
+    static const luaL_Reg biquadMethods[] = {
+        { "lowpass",    biquadDesign<lowpass> },
+        { "highpass",   biquadDesign<highpass> },
+        { "bandpass",   biquadDesign<bandpass> },
+        { "notch",      biquadDesign<notch> },
+        { "peak",       biquadDesign<peak> },
+        { "lowshelf",   biquadDesign<lowshelf> },
+        { "highshelf",  biquadDesign<highshelf> },
+        { "process",    biquadProcess },
+        { "reset",      biquadReset },
+        { nullptr,      nullptr }
+    };
+
+    static const luaL_Reg onePoleMethods[] = {
+        { "lowpass",    onePoleDesign<false> },
+        { "highpass",   onePoleDesign<true> },
+        { "process",    onePoleProcess },
+        { "reset",      onePoleReset },
+        { nullptr,      nullptr }
+    };
+
+    static const luaL_Reg followerMethods[] = {
+        { "set",        followerSet },
+        { "process",    followerProcess },
+        { "level",      followerLevel },
+        { "reset",      followerReset },
+        { nullptr,      nullptr }
+    };
+
+    static const luaL_Reg fftMethods[] = {
+        { "size",       fftSize },
+        { "magnitudes", fftMagnitudes },
+        { "forward",    fftForward },
+        { nullptr,      nullptr }
+    };
+
+    static const luaL_Reg midiFilterMethods[] = {
+        { "process",    midiFilterProcess },
+        { nullptr,      nullptr }
+    };
+
+    newType (L, vectorType,     vectorMethods,      vectorMeta, block);
+    newType (L, biquadType,     biquadMethods,      nullptr,    block);
+    newType (L, onePoleType,    onePoleMethods,     nullptr,    block);
+    newType (L, followerType,   followerMethods,    nullptr,    block);
+    newType (L, fftType,        fftMethods,         nullptr,    block);
+    newType (L, midiFilterType, midiFilterMethods,  nullptr,    block);
+
+    // objects holding C++ members need destroying
+    luaL_getmetatable (L, fftType);
+    lua_pushcfunction (L, destroyObject<FFT>);
+    lua_setfield (L, -2, "__gc");
+    lua_pop (L, 1);
+    luaL_getmetatable (L, midiFilterType);
+    lua_pushcfunction (L, destroyObject<MidiFilter>);
+    lua_setfield (L, -2, "__gc");
+    lua_pop (L, 1);
+
+    static const luaL_Reg functions[] = {
+        { "vector",     vectorNew },
+        { "gain",       gain },
+        { "mix",        mix },
+        { "copy",       copy },
+        { "biquad",     [](lua_State* L) { newObject<Biquad> (L, biquadType); return 1; } },
+        { "onepole",    [](lua_State* L) { newObject<OnePole> (L, onePoleType); return 1; } },
+        { "follower",   [](lua_State* L) { newObject<Follower> (L, followerType); return 1; } },
+        { "fft",        fftNew },
+        { "midifilter", midiFilterNew },
+        { nullptr,      nullptr }
+    };
+
+    luaL_getsubtable (L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+    lua_newtable (L);
+    lua_pushlightuserdata (L, block);
+    luaL_setfuncs (L, functions, 1);
+    lua_setfield (L, -2, "el.dsp");
+    lua_pop (L, 1);
+}
+
+}}
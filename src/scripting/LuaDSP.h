@@ -0,0 +1,97 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "lua-kv.h"
+
+namespace Element {
+namespace Lua {
+
+/** A MIDI event of up to three bytes, held by value */
+struct MidiEvent
+{
+    int frame;
+    uint8 data[3];
+    uint8 size;     ///< zero once removed
+};
+
+/** The short events of one of a block's MIDI buffers as a flat list, which
+    Lua iterates and rewrites in place without making objects. A view that
+    was changed replaces its buffer's short events once the block is done.
+    Longer events, and any past the capacity, stay in the buffer. */
+struct MidiView
+{
+    MidiEvent* events = nullptr;
+    int numEvents = 0;
+    int capacity = 0;
+    bool changed = false;
+
+    void reset() noexcept
+    {
+        numEvents = 0;
+        changed = false;
+    }
+
+    bool add (const uint8* data, int size, int frame) noexcept
+    {
+        if (size <= 0 || size > 3 || numEvents >= capacity)
+            return false;
+        auto& event = events [numEvents++];
+        event.frame = frame;
+        event.size = (uint8) size;
+        for (int i = 0; i < 3; ++i)
+            event.data[i] = i < size ? data[i] : 0;
+        return true;
+    }
+};
+
+/** The block a Lua node is rendering, as the el.block and el.dsp modules
+    see it. The node fills this in around node_render and clears it after,
+    outside node_render kernels given a channel number do nothing. */
+struct RenderBlock
+{
+    kv_sample_t* const* channels = nullptr;
+    int numChannels = 0;
+    int numFrames = 0;
+    kv_midi_pipe_t* midi = nullptr;
+    int numMidiBuffers = 0;
+    MidiView* midiViews = nullptr;
+    int numMidiViews = 0;
+
+    void clear() noexcept
+    {
+        channels = nullptr;
+        numChannels = numFrames = numMidiBuffers = numMidiViews = 0;
+        midi = nullptr;
+        midiViews = nullptr;
+    }
+};
+
+/** Makes el.block available to require, working on a node's block */
+extern void openRenderBlock (lua_State* L, RenderBlock& block);
+
+/** Makes the el.dsp kernels available to require. Kernels work on el.dsp
+    vectors, and on channels of the block when there is one. The block has
+    to outlive the state */
+extern void openKernels (lua_State* L, RenderBlock* block = nullptr);
+
+}}
@@ -19,6 +19,8 @@
 
 #include "scripting/LuaEngine.h"
 #include "scripting/LuaBindings.h"
+#include "scripting/LuaBytecodeCache.h"
+#include "scripting/LuaScheduler.h"
 #include "sol/sol.hpp"
 
 namespace Element {
@@ -34,10 +36,13 @@ LuaEngine::LuaEngine()
 {
     lua.open_libraries();
     Lua::openLibs (lua);
+    scheduler.reset (new LuaScheduler (lua));
 }
 
 LuaEngine::~LuaEngine()
 {
+    // tasks go before the state they run in
+    scheduler.reset();
     Lua::setWorld (lua, nullptr);
 }
 
@@ -46,9 +51,17 @@ LuaEngine::Environment* LuaEngine::createEnvironment()
     return new Environment (lua);
 }
 
+sol::load_result LuaEngine::load (const String& source, const String& chunkName)
+{
+    SharedResourcePointer<LuaBytecodeCache> cache;
+    const auto status = cache->load (lua, source, chunkName);
+    return sol::load_result (lua, lua_absindex (lua, -1), 1, 1, static_cast<sol::load_status> (status));
+}
+
 void LuaEngine::setWorld (Globals& world)
 {
     Lua::setWorld (lua, &world);
+    scheduler->setWorld (&world);
 }
 
 }
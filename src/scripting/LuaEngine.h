@@ -25,6 +25,7 @@
 namespace Element {
 
 class Globals;
+class LuaScheduler;
 
 class LuaEngine
 {
@@ -48,11 +49,19 @@ public:
 
     Environment* createEnvironment();
     sol::state& getState()                  { return lua; }
+
+    /** Loads a script as a function without running it, skipping the parser
+        when the script is in the bytecode cache */
+    sol::load_result load (const String& source, const String& chunkName);
     const sol::state& getState() const      { return lua; }
 
+    /** Returns the scheduler that runs this engine's tasks */
+    LuaScheduler& getScheduler()            { return *scheduler; }
+
 private:
     friend Globals;
     sol::state lua;
+    std::unique_ptr<LuaScheduler> scheduler;
     void setWorld (Globals&);
 };
 
@@ -0,0 +1,405 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiEngine.h"
+#include "scripting/LuaScheduler.h"
+#include "session/Session.h"
+#include "Globals.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+/** Messages that arrive faster than tasks take them are dropped after this */
+static const int maxPendingMidi = 1024;
+
+//=============================================================================
+/** The element functions tasks are started and wait with. Each has the
+    scheduler as its upvalue */
+struct LuaScheduler::Module
+{
+    static LuaScheduler& get (lua_State* L)
+    {
+        return *static_cast<LuaScheduler*> (lua_touserdata (L, lua_upvalueindex (1)));
+    }
+
+    /** Returns the task running on L, raising an error if there isn't one */
+    static Task& current (lua_State* L, const char* function)
+    {
+        auto* task = get (L).findTask (L);
+        if (task == nullptr || ! lua_isyieldable (L))
+            luaL_error (L, "%s must be called from a task", function);
+        return *task;
+    }
+
+    static double deadline (lua_State* L, int arg)
+    {
+        if (lua_isnoneornil (L, arg))
+            return 0.0;
+        return Time::getMillisecondCounterHiRes() + jmax (0.0, (double) luaL_checknumber (L, arg));
+    }
+
+    static int spawn (lua_State* L)
+    {
+        auto& scheduler = get (L);
+        luaL_checktype (L, 1, LUA_TFUNCTION);
+        const int numArgs = lua_gettop (L) - 1;
+
+        auto* task = scheduler.tasks.add (new Task());
+        task->id = ++scheduler.lastTaskId;
+        task->thread = lua_newthread (L);
+        task->ref = luaL_ref (L, LUA_REGISTRYINDEX);
+        lua_xmove (L, task->thread, numArgs + 1);
+
+        // the task may finish before its first wait
+        const int taskId = task->id;
+        scheduler.resume (task, numArgs);
+        lua_pushinteger (L, taskId);
+        return 1;
+    }
+
+    static int cancel (lua_State* L)
+    {
+        lua_pushboolean (L, get (L).cancel ((int) luaL_checkinteger (L, 1)));
+        return 1;
+    }
+
+    static int sleep (lua_State* L)
+    {
+        auto& task = current (L, "sleep");
+        task.wait = Wait::sleep;
+        task.deadline = Time::getMillisecondCounterHiRes() + jmax (0.0, (double) luaL_checknumber (L, 1));
+        get (L).updateTimer();
+        return lua_yield (L, 0);
+    }
+
+    static int waitmidi (lua_State* L)
+    {
+        auto& task = current (L, "waitmidi");
+        task.wait = Wait::midi;
+        task.deadline = deadline (L, 1);
+        get (L).updateTimer();
+        return lua_yield (L, 0);
+    }
+
+    static int waitosc (lua_State* L)
+    {
+        auto& task = current (L, "waitosc");
+        task.address = String::fromUTF8 (luaL_checkstring (L, 1));
+        task.wait = Wait::osc;
+        task.deadline = deadline (L, 2);
+        get (L).updateTimer();
+        return lua_yield (L, 0);
+    }
+
+    static int writesession (lua_State* L)
+    {
+        auto& scheduler = get (L);
+        auto& task = current (L, "writesession");
+        const auto path = String::fromUTF8 (luaL_checkstring (L, 1));
+
+        SessionPtr session = scheduler.world != nullptr ? scheduler.world->getSession() : nullptr;
+        if (session == nullptr || ! File::isAbsolutePath (path))
+        {
+            lua_pushboolean (L, false);
+            lua_pushstring (L, session == nullptr ? "no session" : "path must be absolute");
+            return 2;
+        }
+
+        session->saveGraphState();
+        task.wait = Wait::session;
+        const int taskId = task.id;
+        WeakReference<LuaScheduler> ref (&scheduler);
+        scheduler.writer.write (session->createSnapshot(), File (path),
+            [ref, taskId] (const File&, const Result& result)
+            {
+                auto* self = ref.get();
+                auto* waiting = self != nullptr ? self->findTask (taskId) : nullptr;
+                if (waiting == nullptr || waiting->wait != Wait::session)
+                    return;
+                lua_pushboolean (waiting->thread, result.wasOk());
+                if (result.failed())
+                    lua_pushstring (waiting->thread, result.getErrorMessage().toRawUTF8());
+                self->resume (waiting, result.failed() ? 2 : 1);
+            });
+
+        return lua_yield (L, 0);
+    }
+
+    static void open (LuaScheduler& scheduler, lua_State* L)
+    {
+        static const luaL_Reg functions[] = {
+            { "spawn",          spawn },
+            { "cancel",         cancel },
+            { "sleep",          sleep },
+            { "waitmidi",       waitmidi },
+            { "waitosc",        waitosc },
+            { "writesession",   writesession },
+            { nullptr, nullptr }
+        };
+
+        if (lua_getglobal (L, "element") != LUA_TTABLE)
+        {
+            lua_pop (L, 1);
+            lua_newtable (L);
+            lua_pushvalue (L, -1);
+            lua_setglobal (L, "element");
+        }
+
+        lua_pushlightuserdata (L, &scheduler);
+        luaL_setfuncs (L, functions, 1);
+        lua_pop (L, 1);
+    }
+};
+
+//=============================================================================
+LuaScheduler::LuaScheduler (sol::state& lua)
+    : L (lua.lua_state())
+{
+    Module::open (*this, L);
+}
+
+LuaScheduler::~LuaScheduler()
+{
+    cancelPendingUpdate();
+    setWorld (nullptr);
+    cancelAll();
+    writer.waitUntilIdle();
+}
+
+void LuaScheduler::setWorld (Globals* newWorld)
+{
+    if (world != nullptr)
+        world->getMidiEngine().removeMidiInputCallback (this);
+    world = newWorld;
+    if (world != nullptr)
+        world->getMidiEngine().addMidiInputCallback (String(), this, false);
+}
+
+bool LuaScheduler::cancel (int taskId)
+{
+    auto* task = findTask (taskId);
+    if (task == nullptr || task->cancelled)
+        return false;
+
+    // a task that's on the stack is dropped once it gives control back
+    if (task->resuming)
+        task->cancelled = true;
+    else
+        remove (task);
+    return true;
+}
+
+void LuaScheduler::cancelAll()
+{
+    for (int i = tasks.size(); --i >= 0;)
+        if (auto* task = tasks [i])
+            cancel (task->id);
+}
+
+void LuaScheduler::deliver (const OSCMessage& message)
+{
+    const auto address = message.getAddressPattern().toString();
+    Array<int> waiting;
+    for (auto* task : tasks)
+        if (task->wait == Wait::osc && ! task->resuming && task->address == address)
+            waiting.add (task->id);
+
+    for (const auto taskId : waiting)
+    {
+        auto* task = findTask (taskId);
+        if (task == nullptr || task->wait != Wait::osc)
+            continue;
+
+        auto* T = task->thread;
+        lua_checkstack (T, message.size() + 1);
+        lua_pushstring (T, address.toRawUTF8());
+        for (const auto& arg : message)
+        {
+            if (arg.isInt32())
+                lua_pushinteger (T, arg.getInt32());
+            else if (arg.isFloat32())
+                lua_pushnumber (T, arg.getFloat32());
+            else if (arg.isString())
+                lua_pushstring (T, arg.getString().toRawUTF8());
+            else if (arg.isBlob())
+                lua_pushlstring (T, static_cast<const char*> (arg.getBlob().getData()), arg.getBlob().getSize());
+            else
+                lua_pushnil (T);
+        }
+
+        resume (task, message.size() + 1);
+    }
+}
+
+void LuaScheduler::post (const MidiMessage& message)
+{
+    if (message.getRawDataSize() > 3)
+        return;
+
+    {
+        const ScopedLock sl (midiLock);
+        if (pendingMidi.size() >= maxPendingMidi)
+            return;
+        pendingMidi.add (message);
+    }
+
+    triggerAsyncUpdate();
+}
+
+//=============================================================================
+LuaScheduler::Task* LuaScheduler::findTask (int taskId) const
+{
+    for (auto* task : tasks)
+        if (task->id == taskId)
+            return task;
+    return nullptr;
+}
+
+LuaScheduler::Task* LuaScheduler::findTask (lua_State* thread) const
+{
+    for (auto* task : tasks)
+        if (task->thread == thread)
+            return task;
+    return nullptr;
+}
+
+void LuaScheduler::resume (Task* task, int numArgs)
+{
+    task->wait = Wait::none;
+    task->deadline = 0.0;
+    task->resuming = true;
+
+    auto* const previous = running;
+    running = task;
+    const int status = lua_resume (task->thread, previous != nullptr ? previous->thread : L, numArgs);
+    running = previous;
+    task->resuming = false;
+
+    if (status == LUA_YIELD && ! task->cancelled)
+    {
+        // a plain coroutine.yield hands the loop back until the next timer
+        if (task->wait == Wait::none)
+        {
+            lua_settop (task->thread, 0);
+            task->wait = Wait::sleep;
+            task->deadline = Time::getMillisecondCounterHiRes();
+        }
+
+        updateTimer();
+        return;
+    }
+
+    if (status != LUA_OK && status != LUA_YIELD)
+    {
+        const char* error = lua_tostring (task->thread, -1);
+        Logger::writeToLog ("[EL] Lua task " + String (task->id) + " failed: "
+            + String::fromUTF8 (error != nullptr ? error : "unknown error"));
+    }
+
+    remove (task);
+}
+
+void LuaScheduler::remove (Task* task)
+{
+    luaL_unref (L, LUA_REGISTRYINDEX, task->ref);
+    tasks.removeObject (task);
+    updateTimer();
+}
+
+void LuaScheduler::updateTimer()
+{
+    double next = 0.0;
+    for (auto* task : tasks)
+        if (task->deadline > 0.0 && (next == 0.0 || task->deadline < next))
+            next = task->deadline;
+
+    if (next == 0.0)
+    {
+        stopTimer();
+        return;
+    }
+
+    const auto delay = roundToInt (next - Time::getMillisecondCounterHiRes());
+    startTimer (jmax (1, delay));
+}
+
+void LuaScheduler::timerCallback()
+{
+    const auto now = Time::getMillisecondCounterHiRes();
+    Array<int> due;
+    for (auto* task : tasks)
+        if (task->deadline > 0.0 && task->deadline <= now && ! task->resuming)
+            due.add (task->id);
+
+    for (const auto taskId : due)
+    {
+        auto* task = findTask (taskId);
+        if (task == nullptr || task->wait == Wait::none || task->deadline <= 0.0)
+            continue;
+
+        // waits that time out return nil
+        int numArgs = 0;
+        if (task->wait != Wait::sleep)
+        {
+            lua_pushnil (task->thread);
+            numArgs = 1;
+        }
+
+        resume (task, numArgs);
+    }
+
+    updateTimer();
+}
+
+void LuaScheduler::handleAsyncUpdate()
+{
+    Array<MidiMessage> messages;
+    {
+        const ScopedLock sl (midiLock);
+        messages.swapWith (pendingMidi);
+    }
+
+    for (const auto& message : messages)
+    {
+        Array<int> waiting;
+        for (auto* task : tasks)
+            if (task->wait == Wait::midi && ! task->resuming)
+                waiting.add (task->id);
+
+        const auto* data = message.getRawData();
+        const int size = message.getRawDataSize();
+        for (const auto taskId : waiting)
+        {
+            auto* task = findTask (taskId);
+            if (task == nullptr || task->wait != Wait::midi)
+                continue;
+
+            for (int i = 0; i < 3; ++i)
+                lua_pushinteger (task->thread, i < size ? (lua_Integer) data[i] : 0);
+            resume (task, 3);
+        }
+    }
+}
+
+void LuaScheduler::handleIncomingMidiMessage (MidiInput*, const MidiMessage& message)
+{
+    post (message);
+}
+
+}
@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "session/SessionWriter.h"
+#include "sol/forward.hpp"
+
+struct lua_State;
+
+namespace Element {
+
+class Globals;
+
+/** Runs Lua functions as tasks on the message thread.
+
+    A task is a coroutine that hands the message loop back whenever it waits,
+    so any number of them can wait on timers, MIDI, OSC or session writes
+    without stalling the GUI or each other. Scripts use it through the
+    element module:
+
+        element.spawn (fn, ...)             starts a task and returns its id
+        element.cancel (id)                 stops a task
+        element.sleep (ms)                  waits for a number of milliseconds
+        element.waitmidi ([ms])             waits for a message from an enabled MIDI
+                                            input, returns its status, data1 and data2
+        element.waitosc (address, [ms])     waits for an OSC message sent to the address,
+                                            returns the address and the message's arguments
+        element.writesession (path)         writes the session in the background,
+                                            returns true, or false and an error
+
+    Waits given a timeout return nil when it runs out. The waiting functions
+    only work inside a task.
+ */
+class LuaScheduler : private Timer,
+                     private AsyncUpdater,
+                     private MidiInputCallback
+{
+public:
+    explicit LuaScheduler (sol::state& lua);
+    ~LuaScheduler();
+
+    /** Sets the world tasks get MIDI from and write sessions of */
+    void setWorld (Globals*);
+
+    /** Returns the number of tasks that haven't finished */
+    int getNumTasks() const noexcept { return tasks.size(); }
+
+    /** Stops a task. It's dropped where it waits and never resumed */
+    bool cancel (int taskId);
+
+    /** Stops every task */
+    void cancelAll();
+
+    /** Resumes the tasks waiting for an OSC message sent to its address.
+        Call this from the message thread */
+    void deliver (const OSCMessage& message);
+
+    /** Queues a MIDI message for the tasks waiting on MIDI. This can be
+        called from any thread */
+    void post (const MidiMessage& message);
+
+private:
+    enum class Wait { none, sleep, midi, osc, session };
+
+    struct Task
+    {
+        int id = 0;
+        int ref = 0;
+        lua_State* thread = nullptr;
+        Wait wait = Wait::none;
+        double deadline = 0.0;
+        String address;
+        bool resuming = false;
+        bool cancelled = false;
+    };
+
+    lua_State* L = nullptr;
+    Globals* world = nullptr;
+    OwnedArray<Task> tasks;
+    Task* running = nullptr;
+    int lastTaskId = 0;
+
+    CriticalSection midiLock;
+    Array<MidiMessage> pendingMidi;
+
+    SessionWriter writer;
+
+    Task* findTask (int taskId) const;
+    Task* findTask (lua_State* thread) const;
+    void resume (Task*, int numArgs);
+    void remove (Task*);
+    void updateTimer();
+
+    void timerCallback() override;
+    void handleAsyncUpdate() override;
+    void handleIncomingMidiMessage (MidiInput*, const MidiMessage&) override;
+
+    struct Module;
+    friend struct Module;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (LuaScheduler)
+    JUCE_DECLARE_NON_COPYABLE (LuaScheduler)
+};
+
+}
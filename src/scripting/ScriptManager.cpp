@@ -1,5 +1,6 @@
 #include "JuceHeader.h"
 #include "scripting/LuaBindings.h"
+#include "scripting/LuaBytecodeCache.h"
 #include "scripting/ScriptDescription.h"
 #include "scripting/ScriptManager.h"
 #include "sol/sol.hpp"
@@ -28,6 +29,7 @@ void ScriptManager::scanDirectory (File dir)
     sol::state lua;
     lua.open_libraries();
     Lua::openLibs (lua);
+    SharedResourcePointer<LuaBytecodeCache> cache;
 
     DBG("[EL] scanning: " << dir.getFullPathName());
     for (DirectoryEntry entry : RangedDirectoryIterator (dir, false, "*.lua"))
@@ -35,7 +37,10 @@ void ScriptManager::scanDirectory (File dir)
         sol::environment env (lua, sol::create, lua.globals());
         try {
             DBG("[EL] checking: " << entry.getFile().getFileName());
-            lua.load_file (entry.getFile().getFullPathName().toStdString(), sol::load_mode::any);
+            const auto file = entry.getFile();
+            if (cache->load (lua, file.loadFileAsString(), "@" + file.getFullPathName()) != LUA_OK)
+                DBG("[EL] " << lua_tostring (lua, -1));
+            lua_pop (lua, 1);
             auto desc = ScriptDescription::parse (entry.getFile());
             DBG("[EL] script: " << desc.name);
         } catch (const std::exception& e) {
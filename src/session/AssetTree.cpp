@@ -17,6 +17,7 @@
 */
 
 #include "session/AssetTree.h"
+#include "FileIndex.h"
 
 namespace Element {
 
@@ -64,8 +65,12 @@ AssetTree::Item::addFile (const File& file, int insertIndex, const bool shouldCo
     if (file.isDirectory())
     {
         Item group (addNewSubGroup (file.getFileNameWithoutExtension(), insertIndex));
-        for (DirectoryIterator iter (file, false, "*", File::findFilesAndDirectories); iter.next();)
-            group.addFile (iter.getFile(), -1, shouldCompile);
+        SharedResourcePointer<FileIndex> index;
+        Array<File> children;
+        index->findFolders (file, children);
+        index->findFiles (file, false, "*", children);
+        for (const auto& child : children)
+            group.addFile (child, -1, shouldCompile);
         
         // xxx ! doesn't work // group.sortAlphabetically (false);
     }
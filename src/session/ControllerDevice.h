@@ -165,6 +165,10 @@ public:
 
     EL_OBJECT_GETTER_AND_SETTER(Name, Tags::name)
     EL_OBJECT_GETTER(InputDevice, "inputDevice")
+    /** The MIDI output mapped values are echoed to, empty for none */
+    EL_OBJECT_GETTER(OutputDevice, "outputDevice")
+    /** The most feedback messages a second the output is sent */
+    inline int getFeedbackBudget() const { return (int) objectData.getProperty ("feedbackBudget", 500); }
     inline String getUuidString() const { return objectData.getProperty(Tags::uuid).toString(); }
 
     inline int getNumControls() const { return getNumChildren(); }
@@ -197,6 +201,16 @@ public:
     ~ControllerMap() noexcept { }
     inline bool isValid() const { return objectData.isValid() && objectData.hasType (Tags::map); }
     inline int getParameterIndex() const  { return (int) objectData.getProperty (Tags::parameter, -1); }
+
+    /** How mapped values reach the parameter: "none", "linear" or "onePole" */
+    inline String getSmoothing() const          { return objectData.getProperty ("smoothing", "none").toString(); }
+    inline void setSmoothing (const String& s)  { objectData.setProperty ("smoothing", s, nullptr); }
+    /** Milliseconds to glide over when smoothing */
+    inline double getSmoothingTime() const      { return (double) objectData.getProperty ("smoothingTime", 20.0); }
+    inline void setSmoothingTime (double ms)    { objectData.setProperty ("smoothingTime", ms, nullptr); }
+    /** True if a controller below 32 is paired with its LSB controller, 32 above it, for 14 bits */
+    inline bool isHighResolution() const        { return (bool) objectData.getProperty ("highResolution", false); }
+    inline void setHighResolution (bool hr)     { objectData.setProperty ("highResolution", hr, nullptr); }
 };
 
 }
@@ -23,21 +23,64 @@ namespace Element {
 
 const int DeviceManager::maxAudioChannels   = 128;
 
-class DeviceManager::Private
+class DeviceManager::Private : private Timer
 {
 public:
-    Private() { }
-    ~Private() { }
+    Private (DeviceManager& d) : owner (d) { }
+    ~Private() { stopTimer(); }
 
+    /** Queues a type to be probed, adding it to the manager first if it was held back */
+    void queue (AudioIODeviceType* type)
+    {
+        if (! pending.contains (type))
+            pending.add (type);
+        startTimer (1);
+    }
+
+    DeviceManager& owner;
     EnginePtr activeEngine;
+    DeviceAggregator aggregator;
+
+    String initialType;
+    OwnedArray<AudioIODeviceType> deferredTypes;
+    Array<AudioIODeviceType*> pending;
+    Array<AudioIODeviceType*> scanned;
    #if KV_JACK_AUDIO
     kv::JackClient jackClient { "Element", 2, "main_in_", 2, "main_out_" };
    #endif
+
+private:
+    void timerCallback() override
+    {
+        // one probe per tick, drivers like ASIO only enumerate on this thread
+        if (pending.isEmpty())
+        {
+            stopTimer();
+            return;
+        }
+
+        auto* type = pending.removeAndReturn (0);
+        const bool wasDeferred = deferredTypes.contains (type);
+        type->scanForDevices();
+        scanned.addIfNotAlreadyThere (type);
+
+        if (wasDeferred)
+        {
+            deferredTypes.removeObject (type, false);
+            owner.addAudioDeviceType (std::unique_ptr<AudioIODeviceType> (type));
+        }
+
+        if (pending.isEmpty())
+        {
+            stopTimer();
+            owner.sendChangeMessage();
+        }
+    }
 };
 
 DeviceManager::DeviceManager()
 {
-    impl = new Private();
+    impl = new Private (*this);
 }
 
 DeviceManager::~DeviceManager()
@@ -53,14 +96,18 @@ void DeviceManager::attach (EnginePtr engine)
 
     EnginePtr old = impl->activeEngine;
 
+    // the engine's callback is always run through the aggregator, which
+    // passes the device straight through when there aren't any slaves
     if (old != nullptr)
     {
-        removeAudioCallback (&old->getAudioIODeviceCallback());
+        removeAudioCallback (&impl->aggregator);
     }
 
+    impl->aggregator.setCallback (engine ? &engine->getAudioIODeviceCallback() : nullptr);
+
     if (engine)
     {
-        addAudioCallback (&engine->getAudioIODeviceCallback());
+        addAudioCallback (&impl->aggregator);
     }
     else
     {
@@ -70,13 +117,94 @@ void DeviceManager::attach (EnginePtr engine)
     impl->activeEngine = engine;
 }
 
+void DeviceManager::setAggregateDevices (const StringArray& names)
+{
+    if (getAggregateDevices() == names)
+        return;
+
+    const bool wasOpen = getCurrentAudioDevice() != nullptr;
+    if (wasOpen)
+        closeAudioDevice();
+    impl->aggregator.setSlaves (getCurrentDeviceTypeObject(), names);
+    if (wasOpen)
+        restartLastAudioDevice();
+}
+
+StringArray DeviceManager::getAggregateDevices() const
+{
+    return impl->aggregator.getSlaveNames();
+}
+
+const DeviceAggregator& DeviceManager::getDeviceAggregator() const
+{
+    return impl->aggregator;
+}
+
 static void addIfNotNull (OwnedArray <AudioIODeviceType>& list, AudioIODeviceType* const device)
 {
     if (device != nullptr)
         list.add (device);
 }
 
+void DeviceManager::setInitialDeviceType (const String& typeName)
+{
+    impl->initialType = typeName;
+}
+
+void DeviceManager::scanDeferredDeviceTypes()
+{
+    for (auto* type : impl->deferredTypes)
+        impl->queue (type);
+}
+
+int DeviceManager::getNumPendingScans() const
+{
+    return impl->pending.size();
+}
+
+bool DeviceManager::scanIfNeeded (AudioIODeviceType& type)
+{
+    if (impl->scanned.contains (&type))
+        return false;
+    type.scanForDevices();
+    impl->scanned.add (&type);
+    impl->pending.removeFirstMatchingValue (&type);
+    return true;
+}
+
+void DeviceManager::rescanInBackground()
+{
+    for (auto* type : getAvailableDeviceTypes())
+        impl->queue (type);
+}
+
 void DeviceManager::createAudioDeviceTypes (OwnedArray <AudioIODeviceType>& list)
+{
+    OwnedArray<AudioIODeviceType> types;
+    createAllAudioDeviceTypes (types);
+
+    const bool holdBack = impl->initialType.isNotEmpty() && [&types, this]() {
+        for (auto* type : types)
+            if (type->getTypeName() == impl->initialType)
+                return true;
+        return false;
+    }();
+
+    while (types.size() > 0)
+    {
+        auto* type = types.removeAndReturn (0);
+        if (holdBack && type->getTypeName() != impl->initialType)
+            impl->deferredTypes.add (type);
+        else
+            list.add (type);
+    }
+
+    // initialise probes these straight away
+    for (auto* type : list)
+        impl->scanned.add (type);
+}
+
+void DeviceManager::createAllAudioDeviceTypes (OwnedArray <AudioIODeviceType>& list)
 {
     #if JUCE_ALSA
     addIfNotNull (list, AudioIODeviceType::createAudioIODeviceType_ALSA());
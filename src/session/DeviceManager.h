@@ -20,6 +20,7 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/DeviceAggregator.h"
 #include "engine/Engine.h"
 
 namespace Element {
@@ -37,6 +38,35 @@ public:
     void selectAudioDriver (const String& name);
     void attach (EnginePtr engine);
 
+    /** Opens more devices of the current type alongside the selected one,
+        their channels after its own. The selected device is restarted if
+        it's running */
+    void setAggregateDevices (const StringArray& names);
+    StringArray getAggregateDevices() const;
+
+    /** Returns what runs the aggregated devices, for its latency and stats */
+    const DeviceAggregator& getDeviceAggregator() const;
+
+    /** Holds back every driver type but this one until scanDeferredDeviceTypes,
+        so opening the last used device only probes its own driver. Call this
+        before initialise */
+    void setInitialDeviceType (const String& typeName);
+
+    /** Adds the driver types held back at startup, probing one per turn of
+        the message loop. Sends a change message once they're all in */
+    void scanDeferredDeviceTypes();
+
+    /** Returns the number of driver types still waiting to be probed */
+    int getNumPendingScans() const;
+
+    /** Probes a driver type unless it was probed this session. Returns true
+        if it had to probe */
+    bool scanIfNeeded (AudioIODeviceType& type);
+
+    /** Probes every driver type again, one per turn of the message loop,
+        so lists refresh without blocking whatever asked for it */
+    void rescanInBackground();
+
    #if KV_JACK_AUDIO
     kv::JackClient& getJackClient();
    #endif
@@ -45,6 +75,7 @@ public:
 
 private:
     friend class World;
+    void createAllAudioDeviceTypes (OwnedArray <AudioIODeviceType>& list);
     class Private;
     Scoped<Private> impl;
 };
@@ -0,0 +1,204 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#include "session/GraphImporter.h"
+#include "session/Node.h"
+#include "session/SessionReader.h"
+
+namespace Element {
+
+static void resetNode (ValueTree& node)
+{
+    Node::sanitizeProperties (node, false);
+    node.setProperty (Tags::uuid, Uuid().toString(), nullptr);
+}
+
+static void resetNodes (ValueTree tree)
+{
+    if (tree.hasType (Tags::node))
+        resetNode (tree);
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+        resetNodes (tree.getChild (i));
+}
+
+static bool looksLikeXml (const MemoryBlock& block)
+{
+    const auto* text = static_cast<const char*> (block.getData());
+    for (size_t i = 0; i < block.getSize(); ++i)
+    {
+        const auto c = text[i];
+        if (CharacterFunctions::isWhitespace (c) || (uint8) c >= 0x80)
+            continue; // a byte order mark is skipped too
+        return c == '<';
+    }
+
+    return false;
+}
+
+//=============================================================================
+GraphImporter::GraphImporter()
+    : Thread ("el.graphImporter")
+{
+    idle.signal();
+}
+
+GraphImporter::~GraphImporter()
+{
+    {
+        const ScopedLock sl (lock);
+        jobs.clearQuick();
+    }
+
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+    masterReference.clear();
+}
+
+void GraphImporter::import (const File& file, Callback callback)
+{
+    {
+        const ScopedLock sl (lock);
+        jobs.add ({ file, callback });
+        idle.reset();
+    }
+
+    if (! isThreadRunning())
+        startThread (3);
+    notify();
+}
+
+bool GraphImporter::isImporting() const
+{
+    const ScopedLock sl (lock);
+    return busy || jobs.size() > 0;
+}
+
+bool GraphImporter::waitUntilIdle (int timeoutMs)
+{
+    return idle.wait (timeoutMs);
+}
+
+ValueTree GraphImporter::read (const File& file, String& error)
+{
+    MemoryBlock block;
+    if (! file.loadFileAsData (block) || block.getSize() <= 0)
+    {
+        error = "Couldn't read " + file.getFileName();
+        return {};
+    }
+
+    ValueTree data;
+    if (looksLikeXml (block))
+    {
+        std::unique_ptr<XmlElement> xml (XmlDocument::parse (block.toString()));
+        if (xml != nullptr)
+            data = ValueTree::fromXml (*xml);
+        if (data.isValid())
+            resetNodes (data);
+    }
+    else
+    {
+        SessionReader reader;
+        reader.onNodeRead = resetNode;
+
+        {
+            // sessions are compressed, graphs might not be
+            MemoryInputStream input (block, false);
+            GZIPDecompressorInputStream gzip (input);
+            data = reader.read (gzip);
+        }
+
+        if (! data.hasType (Tags::session))
+            data = reader.read (block.getData(), block.getSize());
+    }
+
+    ValueTree graph;
+    if (data.hasType (Tags::session))
+    {
+        auto graphs = data.getChildWithName (Tags::graphs);
+        graph = graphs.getChild (graphs.getProperty (Tags::active, 0));
+        graphs.removeChild (graph, nullptr);
+    }
+    else if (data.hasType (Tags::node))
+    {
+        graph = data;
+    }
+    else if (data.isValid())
+    {
+        graph = data.getChildWithName (Tags::node);
+        data.removeChild (graph, nullptr);
+        graph.setProperty (Tags::name, data.hasProperty (Tags::name)
+            ? data.getProperty (Tags::name) : var (file.getFileNameWithoutExtension()), nullptr);
+    }
+
+    if (! Node::isProbablyGraphNode (graph))
+    {
+        error = file.getFileName() + " doesn't hold a graph";
+        return {};
+    }
+
+    return graph;
+}
+
+void GraphImporter::run()
+{
+    for (;;)
+    {
+        Job job;
+        bool haveJob = false;
+
+        {
+            const ScopedLock sl (lock);
+            haveJob = jobs.size() > 0;
+            busy = haveJob;
+            if (haveJob)
+            {
+                job = jobs.removeAndReturn (0);
+            }
+            else
+            {
+                idle.signal();
+                if (threadShouldExit())
+                    break;
+            }
+        }
+
+        if (! haveJob)
+        {
+            wait (-1);
+            continue;
+        }
+
+        String error;
+        const auto graph = read (job.file, error);
+        if (job.callback)
+        {
+            WeakReference<GraphImporter> ref (this);
+            auto callback = job.callback;
+            auto file = job.file;
+            MessageManager::callAsync ([ref, callback, file, graph, error]()
+            {
+                if (ref != nullptr)
+                    callback (file, graph, error);
+            });
+        }
+    }
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Reads graph files for import on a background thread.
+
+    The file is parsed and every node in it gets a new uuid and loses its
+    runtime properties in the same pass, so the graph can be added to the
+    session it's imported into as it is. Binary graphs and sessions are read
+    with a SessionReader that rewrites each node as soon as it's read, XML
+    graphs are rewritten after parsing, still on the importer's thread.
+    Imports that haven't started when this is deleted are dropped.
+ */
+class GraphImporter : private Thread
+{
+public:
+    /** Called on the message thread with the graph read from a file, or an
+        invalid tree and an error */
+    using Callback = std::function<void (const File&, const ValueTree&, const String&)>;
+
+    GraphImporter();
+    ~GraphImporter();
+
+    /** Queues a file to be imported */
+    void import (const File& file, Callback callback);
+
+    /** Returns true while files are waiting or being read */
+    bool isImporting() const;
+
+    /** Blocks until every queued file was read. Callbacks still arrive on
+        the message thread. Returns false if that didn't happen in time */
+    bool waitUntilIdle (int timeoutMs = -1);
+
+    /** Reads a graph from a graph or session file on the calling thread */
+    static ValueTree read (const File& file, String& error);
+
+private:
+    struct Job
+    {
+        File file;
+        Callback callback;
+    };
+
+    CriticalSection lock;
+    Array<Job> jobs;
+    bool busy = false;
+    WaitableEvent idle { true };
+
+    void run() override;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (GraphImporter)
+    JUCE_DECLARE_NON_COPYABLE (GraphImporter)
+};
+
+}
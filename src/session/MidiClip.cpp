@@ -32,6 +32,11 @@ MidiClip::MidiClip()
 
 MidiClip::~MidiClip() { }
 
+NoteSequence MidiClip::getNotes() const
+{
+    return NoteSequence (objectData.getChildWithName ("notes"));
+}
+
 void MidiClip::addNotesTo (MidiMessageSequence& seq) const
 {
     const ValueTree notes (objectData.getChildWithName ("notes"));
@@ -42,8 +47,9 @@ void MidiClip::addNotesTo (MidiMessageSequence& seq) const
         note.getMidi (on, off);
         seq.addEvent(on);
         seq.addEvent(off);
-        seq.updateMatchedPairs();
     }
+
+    seq.updateMatchedPairs();
 }
 
 }
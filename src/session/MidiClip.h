@@ -21,6 +21,7 @@
 #define EL_MIDI_CLIP_H
 
 #include "session/ClipModel.h"
+#include "session/NoteSequence.h"
 
 namespace Element {
     
@@ -30,6 +31,9 @@ public:
     MidiClip();
     ~MidiClip();
     
+    /** Returns the clip's notes */
+    NoteSequence getNotes() const;
+
     void addNotesTo (MidiMessageSequence&) const;
 };
 
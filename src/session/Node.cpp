@@ -19,7 +19,11 @@
 
 #include "session/Node.h"
 #include "session/Session.h"
+#include "session/SessionArchive.h"
+#include "session/SessionIndex.h"
 #include "controllers/GraphManager.h"
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/nodes/SubGraphProcessor.h"
 #include "ScopedFlag.h"
 
 namespace Element {
@@ -263,6 +267,9 @@ void Node::sanitizeProperties (ValueTree node, const bool recursive)
 {
     node.removeProperty (Tags::updater, nullptr);
     node.removeProperty (Tags::object,  nullptr);
+    node.removeProperty (Tags::archive, nullptr);
+    node.removeProperty (Tags::batch,   nullptr);
+    node.removeProperty (Tags::sessionIndex, nullptr);
     
     if (node.hasType (Tags::node))
     {
@@ -318,6 +325,11 @@ bool Node::savePresetTo (const DataPath& path, const String& name) const
     const auto targetFile = path.createNewPresetFile (*this, name);
     data.setProperty (Tags::name, targetFile.getFileNameWithoutExtension(), 0);
     data.setProperty (Tags::type, Tags::node.toString(), 0);
+
+    // a header for the preset index, so it needn't parse the state
+    preset.setProperty (Tags::name, targetFile.getFileNameWithoutExtension(), 0)
+          .setProperty (Tags::format, getFormat().toString(), 0)
+          .setProperty (Tags::identifier, getIdentifier().toString(), 0);
     
     #if EL_SAVE_BINARY_FORMAT
     TemporaryFile tempFile(targetFile);
@@ -397,6 +409,9 @@ void Node::setMissingProperties()
     stabilizeProperty (Tags::bypass, false);
     stabilizeProperty (Tags::persistent, true);
     stabilizePropertyString (Tags::renderMode, "single");
+    stabilizeProperty (Tags::parallelRender, false);
+    stabilizeProperty (Tags::pipelineStages, 1);
+    stabilizeProperty (Tags::inlineSubGraphs, false);
     stabilizeProperty (Tags::keyStart, 0);
     stabilizeProperty (Tags::keyEnd, 127);
     stabilizeProperty (Tags::transpose, 0);
@@ -544,6 +559,13 @@ bool Node::connectionExists (const ValueTree& arcs,
 
 Node Node::getNodeById (const uint32 nodeId) const
 {
+    if (auto* index = SessionIndex::getFor (objectData))
+    {
+        const Node found (index->findNode (objectData, nodeId), false);
+        if (found.isValid())
+            return found;
+    }
+
     const ValueTree nodes = getNodesValueTree();
     Node node (nodes.getChildWithProperty (Tags::id, static_cast<int64> (nodeId)), false);
     return node;
@@ -566,6 +588,15 @@ static Node findNodeRecursive (const Node& node, const Uuid& uuid)
 
 Node Node::getNodeByUuid (const Uuid& uuid, const bool recursive) const
 {
+    // nodes of a session are found through its index, checking they're
+    // actually below this one
+    if (auto* index = SessionIndex::getFor (objectData))
+    {
+        const auto found = index->findNode (objectData, uuid.toString());
+        if (recursive ? found.isAChildOf (objectData) : found.getParent() == getNodesValueTree())
+            return Node (found, false);
+    }
+
     if (! recursive)
     {
         const ValueTree nodes = getNodesValueTree();
@@ -681,6 +712,28 @@ kv::MidiChannels Node::getMidiChannels() const
     return chans;
 }
 
+/** Plugins from outside Element tell the host when they're edited, so their
+    state only needs reading again once they've reported a change */
+static bool reportsStateChanges (AudioProcessor& proc)
+{
+    if (auto* instance = dynamic_cast<AudioPluginInstance*> (&proc))
+    {
+        const auto format = instance->getPluginDescription().pluginFormatName;
+        return format != EL_INTERNAL_FORMAT_NAME && format != "Internal";
+    }
+    return false;
+}
+
+static int64 hashState (const MemoryBlock& state)
+{
+    // 64 bit FNV-1a, cheap next to encoding the state again
+    uint64 hash = 14695981039346656037ULL;
+    const auto* data = static_cast<const uint8*> (state.getData());
+    for (size_t i = 0; i < state.getSize(); ++i)
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    return static_cast<int64> (hash ^ (uint64) state.getSize());
+}
+
 void Node::restorePluginState()
 {
     if (! isValid())
@@ -696,27 +749,23 @@ void Node::restorePluginState()
             if (shouldSetProgram)
                 proc->setCurrentProgram (wantedProgram);
 
-            auto data = getProperty(Tags::state).toString().trim();
-            if (data.isNotEmpty())
+            MemoryBlock state;
+            if (SessionArchive::readState (objectData, Tags::state, state))
             {
-                MemoryBlock state;
-                state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                {
-                    proc->setStateInformation (state.getData(), (int) state.getSize());
-                }
+                proc->setStateInformation (state.getData(), (int) state.getSize());
+                obj->savedStateHash = hashState (state);
             }
             
-            data = getProperty(Tags::programState).toString().trim();
-            if (shouldSetProgram && data.isNotEmpty())
+            if (shouldSetProgram && SessionArchive::readState (objectData, Tags::programState, state))
             {
-                MemoryBlock state; state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                {
-                    proc->setCurrentProgramStateInformation (state.getData(),
-                        (int) state.getSize());
-                }
+                proc->setCurrentProgramStateInformation (state.getData(),
+                    (int) state.getSize());
+                obj->savedProgramStateHash = hashState (state);
             }
+
+            // the model holds what was just restored
+            if (reportsStateChanges (*proc))
+                obj->stateChanged.set (0);
         }
         else
         {
@@ -726,14 +775,9 @@ void Node::restorePluginState()
             if (shouldSetProgram)
                 obj->setCurrentProgram (wantedProgram);
 
-            auto data = getProperty(Tags::state).toString().trim();
-            if (data.isNotEmpty())
-            {
-                MemoryBlock state;
-                state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                    obj->setState (state.getData(), (int) state.getSize());
-            }
+            MemoryBlock state;
+            if (SessionArchive::readState (objectData, Tags::state, state))
+                obj->setState (state.getData(), (int) state.getSize());
         }
 
         if (hasProperty (Tags::bypass))
@@ -777,11 +821,22 @@ void Node::restorePluginState()
 
         obj->setMuted ((bool) getProperty (Tags::mute, obj->isMuted()));
         obj->setMuteInput ((bool) getProperty ("muteInput", obj->isMutingInputs()));
+        obj->setRenderAhead ((bool) getProperty (Tags::renderAhead, false));
 
         if (hasProperty (Tags::transpose))
             obj->setTransposeOffset (getProperty (Tags::transpose));
         
+        obj->setOversamplingMode ((GraphNode::OversamplingMode) (int) getProperty (Tags::oversamplingMode,
+                                                                                 (int) GraphNode::OversampleMinimumPhase));
         obj->setOversamplingFactor (jmax (1, (int) getProperty (Tags::oversamplingFactor, 1)));
+        obj->setLoadPriority ((GraphNode::LoadPriority) jlimit (0, (int) GraphNode::NumLoadPriorities - 1,
+            (int) getProperty (Tags::loadPriority, (int) GraphNode::NormalPriority)));
+
+        if (auto* sub = dynamic_cast<SubGraphProcessor*> (obj->getAudioProcessor()))
+        {
+            sub->setRateDivision ((int) getProperty (Tags::renderDivision, 1));
+            sub->setInnerBlockSize ((int) getProperty (Tags::innerBlockSize, 0));
+        }
     }
 
     // this was originally here to help reduce memory usage
@@ -796,34 +851,83 @@ void Node::restorePluginState()
 }
 
 void Node::savePluginState()
+{
+    writePluginState (false);
+}
+
+void Node::savePluginStateForCopy()
+{
+    writePluginState (true);
+}
+
+void Node::writePluginState (bool forCopy)
 {
     if (! isValid())
         return;
+
+    // copies take the state as it is, in binary, without touching the change
+    // tracking of the node they were copied from
+    const auto stateValue = [forCopy] (const MemoryBlock& state) -> var {
+        return forCopy ? var (state) : var (state.toBase64Encoding());
+    };
     
+    // placeholders still waiting for their plugin keep the saved state as is
     GraphNodePtr obj = getGraphNode();
-    if (obj && obj->isPrepared)
+    if (obj && obj->isPrepared && ! hasProperty (Tags::placeholder))
     {
         MemoryBlock state;
         
         if (auto* proc = obj->getAudioProcessor())
         {
-            proc->getStateInformation (state);
-            if (state.getSize() > 0)
+            // plugins that haven't reported an edit, and whose editor isn't
+            // open, still match the state saved last time
+            const bool mayHaveChanged = obj->hasStateChanged() || ! reportsStateChanges (*proc)
+                || proc->getActiveEditor() != nullptr || ! hasProperty (Tags::state);
+
+            if (forCopy)
             {
-                objectData.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+                proc->getStateInformation (state);
+                if (state.getSize() > 0)
+                    objectData.setProperty (Tags::state, stateValue (state), nullptr);
+
+                state.reset();
+                proc->getCurrentProgramStateInformation (state);
+                if (state.getSize() > 0)
+                    objectData.setProperty (Tags::programState, stateValue (state), nullptr);
             }
-            else
+            else if (mayHaveChanged)
             {
-                const bool clearStateProperty = false;
-                if (clearStateProperty)
-                    objectData.removeProperty (Tags::state, 0);
-            }
+                // cleared first so edits made while reading mark it again
+                obj->stateChanged.set (0);
 
-            state.reset();
-            proc->getCurrentProgramStateInformation (state);
-            if (state.getSize() > 0)
-            {
-                objectData.setProperty (Tags::programState, state.toBase64Encoding(), 0);
+                proc->getStateInformation (state);
+                if (state.getSize() > 0)
+                {
+                    const auto hash = hashState (state);
+                    if (hash != obj->savedStateHash || ! hasProperty (Tags::state))
+                    {
+                        objectData.setProperty (Tags::state, stateValue (state), nullptr);
+                        obj->savedStateHash = hash;
+                    }
+                }
+                else
+                {
+                    const bool clearStateProperty = false;
+                    if (clearStateProperty)
+                        objectData.removeProperty (Tags::state, 0);
+                }
+
+                state.reset();
+                proc->getCurrentProgramStateInformation (state);
+                if (state.getSize() > 0)
+                {
+                    const auto hash = hashState (state);
+                    if (hash != obj->savedProgramStateHash || ! hasProperty (Tags::programState))
+                    {
+                        objectData.setProperty (Tags::programState, stateValue (state), 0);
+                        obj->savedProgramStateHash = hash;
+                    }
+                }
             }
 
             setProperty (Tags::bypass, proc->isSuspended());
@@ -832,8 +936,19 @@ void Node::savePluginState()
         else
         {
             obj->getState (state);
-            if (state.getSize() > 0)
-                objectData.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+            if (state.getSize() > 0 && forCopy)
+            {
+                objectData.setProperty (Tags::state, stateValue (state), nullptr);
+            }
+            else if (state.getSize() > 0)
+            {
+                const auto hash = hashState (state);
+                if (hash != obj->savedStateHash || ! hasProperty (Tags::state))
+                {
+                    objectData.setProperty (Tags::state, stateValue (state), nullptr);
+                    obj->savedStateHash = hash;
+                }
+            }
         }
 
         setProperty (Tags::midiProgram, obj->getMidiProgram());
@@ -841,13 +956,34 @@ void Node::savePluginState()
         setProperty (Tags::midiProgramsEnabled, obj->areMidiProgramsEnabled());
         setProperty (Tags::mute, obj->isMuted());
         setProperty ("muteInput", obj->isMutingInputs());
+        setProperty (Tags::renderAhead, obj->isRenderingAhead());
         String mps; obj->getMidiProgramsState (mps);
         setProperty (Tags::midiProgramsState, mps);
-        setProperty (Tags::oversamplingFactor, obj->getOversamplingFactor());
+        setProperty (Tags::oversamplingFactor, obj->getRequestedOversamplingFactor());
+        setProperty (Tags::oversamplingMode, (int) obj->getOversamplingMode());
+        setProperty (Tags::loadPriority, (int) obj->getLoadPriority());
+        if (auto* sub = dynamic_cast<SubGraphProcessor*> (obj->getAudioProcessor()))
+        {
+            setProperty (Tags::renderDivision, sub->getRateDivision());
+            setProperty (Tags::innerBlockSize, sub->getInnerBlockSize());
+        }
+    }
+
+    // states that were never read back from an archive are decoded now, so
+    // the model holds them once the archive is let go
+    for (const auto& property : { Tags::state, Tags::programState })
+    {
+        const auto chunkProperty = SessionArchive::getChunkProperty (property);
+        if (! objectData.hasProperty (chunkProperty))
+            continue;
+        MemoryBlock state;
+        if (! objectData.hasProperty (property) && SessionArchive::readState (objectData, property, state))
+            objectData.setProperty (property, stateValue (state), nullptr);
+        objectData.removeProperty (chunkProperty, nullptr);
     }
 
     for (int i = 0; i < getNumNodes(); ++i)
-        getNode(i).savePluginState();
+        getNode(i).writePluginState (forCopy);
 }
 
 void Node::setMuted (bool shouldBeMuted)
@@ -866,6 +1002,14 @@ void Node::setMuteInput (bool shouldMuteInputs)
         obj->setMuteInput (isMutingInputs());
 }
 
+void Node::setRenderAhead (bool shouldRenderAhead)
+{
+    if (shouldRenderAhead != isRenderingAhead())
+        setProperty (Tags::renderAhead, shouldRenderAhead);
+    if (auto* obj = getGraphNode())
+        obj->setRenderAhead (isRenderingAhead());
+}
+
 void Node::setCurrentProgram (const int index)
 {
     if (auto* obj = getGraphNode())
@@ -1029,17 +1173,46 @@ NodeObjectSync::~NodeObjectSync()
 void NodeObjectSync::setNode (const Node& n)
 {
     node = n;
+    pending.clearQuick();
     data.removeListener (this);
     data = node.getValueTree();
     data.addListener (this);
 }
 
 void NodeObjectSync::valueTreePropertyChanged (ValueTree& tree, const Identifier& property)
+{
+    if (tree != data || frozen || node.getGraphNode() == nullptr)
+        return;
+
+    if (auto* batch = Session::getBatchFor (data))
+    {
+        pending.addIfNotAlreadyThere (property);
+        WeakReference<NodeObjectSync> sync (this);
+        batch->defer (this, [sync]() {
+            if (auto* self = sync.get())
+                self->applyPending();
+        });
+        return;
+    }
+
+    applyProperty (property);
+}
+
+void NodeObjectSync::applyPending()
+{
+    const auto properties = pending;
+    pending.clearQuick();
+    for (const auto& property : properties)
+        applyProperty (property);
+}
+
+void NodeObjectSync::applyProperty (const Identifier& property)
 {
     GraphNodePtr obj = node.getGraphNode();
-    if (tree != data || frozen || obj == nullptr)
+    if (obj == nullptr)
         return;
-        
+    ValueTree tree (data);
+
     if (property == Tags::midiChannels)
     {
         auto chans = node.getMidiChannels();
@@ -200,6 +200,13 @@ public:
     /** Returns true if this node should be enabled */
     inline const bool isEnabled() const     { return (bool) getProperty (Tags::enabled, true); }
 
+    /** Returns the group of the process this node's plugin runs in, or an
+        empty string if it runs in the engine */
+    String getBridgeGroup() const           { return getProperty (Tags::bridge).toString(); }
+
+    /** Returns true if this node's plugin runs in another process */
+    bool isBridged() const                  { return getBridgeGroup().isNotEmpty(); }
+
     //=========================================================================
     /** Returns the enabled MIDI channels on this Node */
     kv::MidiChannels getMidiChannels() const;
@@ -227,6 +234,12 @@ public:
     /** Change the mute status of inputs on this Node */
     void setMuteInput (bool);
 
+    /** Returns true if this Node renders ahead of the audio thread when it can */
+    bool isRenderingAhead() const { return (bool) getProperty (Tags::renderAhead, false); }
+
+    /** Lets this Node render ahead of the audio thread when nothing live feeds it */
+    void setRenderAhead (bool);
+
     //=========================================================================
     /** Returns the number of connections on this node */
     int getNumConnections() const;
@@ -419,6 +432,11 @@ public:
     //=========================================================================
     /** Saves the node state from GraphNode to state property */
     void savePluginState();
+
+    /** Saves the node state from GraphNode to state property as binary data,
+        for a copy of the model that's restored straight away. Skips encoding
+        as text and leaves the live node's saved state tracking alone */
+    void savePluginStateForCopy();
     
     /** Reads state property and applies to GraphNode */
     void restorePluginState();
@@ -475,11 +493,15 @@ public:
 
 private:
     void setMissingProperties();
+    void writePluginState (bool forCopy);
     void forEach (const ValueTree tree, std::function<void(const ValueTree& tree)>) const;
 };
 
 typedef Node NodeModel;
 
+/** Passes node properties on to the node's GraphNode as they change. While
+    the session is batching edits, changes are collected and each property is
+    applied once when the batch ends */
 class NodeObjectSync final : private ValueTree::Listener
 {
 public:
@@ -495,6 +517,10 @@ private:
     Node node;
     ValueTree data;
     bool frozen = false;
+    Array<Identifier> pending;
+
+    void applyProperty (const Identifier& property);
+    void applyPending();
 
     void valueTreePropertyChanged (ValueTree& tree, const Identifier& property) override;
     void valueTreeChildAdded (ValueTree& parent, ValueTree& child) override;
@@ -502,6 +528,8 @@ private:
     void valueTreeChildOrderChanged (ValueTree& parent, int oldIndex, int newIndex) override;
     void valueTreeParentChanged (ValueTree& tree) override;
     void valueTreeRedirected (ValueTree& tree) override;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (NodeObjectSync)
 };
 
 class PortArray : public Array<Port>
@@ -0,0 +1,803 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/BridgeTransport.h"
+#include "engine/RealtimeThreads.h"
+#include "session/PluginBridge.h"
+#include "session/PluginManager.h"
+
+#define EL_PLUGIN_HOST_DEFAULT_TIMEOUT      20000   // pings between the processes
+#define EL_PLUGIN_HOST_LOAD_TIMEOUT         60000   // plugins can be slow to load
+#define EL_PLUGIN_HOST_REQUEST_TIMEOUT      5000
+
+namespace Element {
+
+/* blocks longer than this are sent in pieces */
+static const int bridgedBlockSize = 2048;
+
+/* share of a block's length the engine waits for the host to render it */
+static const double deadlineFraction = 0.75;
+
+static MemoryBlock toMessage (const ValueTree& tree)
+{
+    MemoryOutputStream stream;
+    tree.writeToStream (stream);
+    return stream.getMemoryBlock();
+}
+
+/* noop. prevent OS error dialogs from the host process */
+static void pluginHostSlaveCrashHandler (void*) { }
+
+//=============================================================================
+/** One host process, on the engine's side. Replies arrive on the connection's
+    thread and wake whoever is waiting for them */
+class PluginHostProcess : public kv::ChildProcessMaster,
+                          public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<PluginHostProcess>;
+
+    explicit PluginHostProcess (const String& g) : group (g) { }
+
+    ~PluginHostProcess()
+    {
+        killSlaveProcess();
+    }
+
+    const String& getGroup() const noexcept { return group; }
+    bool isRunning() const noexcept { return running.get() != 0; }
+
+    bool launch()
+    {
+        if (isRunning())
+            return true;
+
+        killSlaveProcess();
+        running = 1;
+        if (! launchSlaveProcess (File::getSpecialLocation (File::invokedExecutableFile),
+                                  EL_PLUGIN_HOST_PROCESS_ID, EL_PLUGIN_HOST_DEFAULT_TIMEOUT, 0))
+            running = 0;
+        return isRunning();
+    }
+
+    /** Returns an ID for a new plugin in this host */
+    int addPlugin()
+    {
+        ScopedLock sl (lock);
+        ++numPlugins;
+        return ++lastPluginId;
+    }
+
+    /** Unloads a plugin. The process stops with the last one */
+    void removePlugin (int pluginId)
+    {
+        ValueTree message ("unload");
+        message.setProperty ("id", pluginId, nullptr);
+        post (message);
+
+        bool wasLast = false;
+        {
+            ScopedLock sl (lock);
+            numPlugins = jmax (0, numPlugins - 1);
+            wasLast = numPlugins == 0;
+        }
+
+        if (wasLast)
+            stop();
+    }
+
+    /** Stops the process. Its plugins go silent */
+    void stop()
+    {
+        running = 0;
+        killSlaveProcess();
+    }
+
+    /** Sends a message without waiting for anything back */
+    void post (const ValueTree& message)
+    {
+        if (isRunning())
+            sendMessageToSlave (toMessage (message));
+    }
+
+    /** Sends a message and waits for its reply. The reply is invalid if it
+        didn't come in time or the host went away */
+    ValueTree request (ValueTree message, int timeoutMs)
+    {
+        if (! isRunning())
+            return ValueTree();
+
+        Pending pending;
+        {
+            ScopedLock sl (lock);
+            pending.requestId = ++lastRequestId;
+            waiting.add (&pending);
+        }
+
+        message.setProperty ("request", pending.requestId, nullptr);
+        if (sendMessageToSlave (toMessage (message)))
+            pending.done.wait (timeoutMs);
+
+        ScopedLock sl (lock);
+        waiting.removeFirstMatchingValue (&pending);
+        return pending.reply;
+    }
+
+    void handleMessageFromSlave (const MemoryBlock& mb) override
+    {
+        const auto message = ValueTree::readFromData (mb.getData(), mb.getSize());
+        if (! message.hasType ("reply"))
+            return;
+
+        const int requestId = message.getProperty ("request", 0);
+        ScopedLock sl (lock);
+        for (auto* pending : waiting)
+        {
+            if (pending->requestId == requestId)
+            {
+                pending->reply = message;
+                pending->done.signal();
+                break;
+            }
+        }
+    }
+
+    void handleConnectionLost() override
+    {
+        // most likely a plugin crashed
+        running = 0;
+        ScopedLock sl (lock);
+        for (auto* pending : waiting)
+            pending->done.signal();
+    }
+
+private:
+    struct Pending
+    {
+        int requestId = 0;
+        WaitableEvent done;
+        ValueTree reply;
+    };
+
+    const String group;
+    CriticalSection lock;
+    Array<Pending*> waiting;
+    Atomic<int> running { 0 };
+    int lastRequestId = 0;
+    int lastPluginId = 0;
+    int numPlugins = 0;
+};
+
+//=============================================================================
+/** Stands in the graph for a plugin running in a host process */
+class BridgedProcessor : public AudioPluginInstance
+{
+public:
+    BridgedProcessor (PluginHostProcess::Ptr h, int id, const PluginDescription& desc,
+                      const ValueTree& info, std::unique_ptr<BridgeChannel> c)
+        : AudioPluginInstance (createBuses (c->getLayout())),
+          host (h), pluginId (id), description (desc), channel (std::move (c))
+    {
+        latency     = (int) info.getProperty ("latency", 0);
+        tailLength  = (double) info.getProperty ("tail", 0.0);
+        midiIn      = (bool) info.getProperty ("acceptsMidi", false);
+        midiOut     = (bool) info.getProperty ("producesMidi", false);
+        setLatencySamples (latency);
+
+        for (const auto& program : StringArray::fromLines (info.getProperty ("programs").toString()))
+            programs.add (program);
+        programs.removeEmptyStrings (false);
+
+        const auto params = info.getChildWithName ("parameters");
+        for (int i = 0; i < params.getNumChildren(); ++i)
+            addParameter (new BridgedParameter (*this, params.getChild (i)));
+    }
+
+    ~BridgedProcessor()
+    {
+        host->removePlugin (pluginId);
+        channel = nullptr;
+    }
+
+    const String& getGroup() const noexcept { return host->getGroup(); }
+
+    //=========================================================================
+    void fillInPluginDescription (PluginDescription& desc) const override { desc = description; }
+    const String getName() const override { return description.name; }
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
+    {
+        chunkMidi.ensureSize (4096);
+
+        ValueTree message ("prepare");
+        message.setProperty ("id", pluginId, nullptr)
+               .setProperty ("sampleRate", sampleRate, nullptr)
+               .setProperty ("blockSize", jmin (bridgedBlockSize, maximumExpectedSamplesPerBlock), nullptr);
+        const auto reply = host->request (message, EL_PLUGIN_HOST_REQUEST_TIMEOUT);
+        if (reply.isValid())
+            setLatencySamples ((int) reply.getProperty ("latency", getLatencySamples()));
+    }
+
+    void releaseResources() override { }
+
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override
+    {
+        if (channel == nullptr || ! host->isRunning())
+        {
+            buffer.clear();
+            midi.clear();
+            return;
+        }
+
+        if (parametersChanged.exchange (false))
+            for (auto* param : getParameters())
+                if (auto* bridged = dynamic_cast<BridgedParameter*> (param))
+                    if (bridged->changed.exchange (false))
+                        channel->pushParameter (bridged->getParameterIndex(), bridged->getValue());
+
+        AudioPlayHead::CurrentPositionInfo position;
+        position.resetToDefault();
+        if (auto* playHead = getPlayHead())
+            playHead->getCurrentPosition (position);
+
+        const int numSamples = buffer.getNumSamples();
+        if (numSamples <= bridgedBlockSize)
+        {
+            channel->process (buffer, midi, position, getTimeout (numSamples));
+            return;
+        }
+
+        // too long for the channel, send it in pieces
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data = nullptr;
+        int size = 0, frame = 0;
+        bool moreMidi = iter.getNextEvent (data, size, frame);
+        MidiBuffer output;
+
+        for (int start = 0; start < numSamples; start += bridgedBlockSize)
+        {
+            const int length = jmin (bridgedBlockSize, numSamples - start);
+            AudioBuffer<float> chunk (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+
+            chunkMidi.clear();
+            while (moreMidi && frame < start + length)
+            {
+                chunkMidi.addEvent (data, size, frame - start);
+                moreMidi = iter.getNextEvent (data, size, frame);
+            }
+
+            channel->process (chunk, chunkMidi, position, getTimeout (length));
+            output.addEvents (chunkMidi, 0, length, start);
+            position.timeInSamples += length;
+        }
+
+        midi.swapWith (output);
+    }
+
+    bool isBusesLayoutSupported (const BusesLayout& layout) const override
+    {
+        const auto& channels = channel->getLayout();
+        return layout.getMainInputChannels() == channels.numInputs
+            && layout.getMainOutputChannels() == channels.numOutputs;
+    }
+
+    double getTailLengthSeconds() const override    { return tailLength; }
+    bool acceptsMidi() const override               { return midiIn; }
+    bool producesMidi() const override              { return midiOut; }
+
+    // editors can't be shown for another process
+    AudioProcessorEditor* createEditor() override   { return nullptr; }
+    bool hasEditor() const override                 { return false; }
+
+    int getNumPrograms() override                   { return jmax (1, programs.size()); }
+    int getCurrentProgram() override                { return currentProgram; }
+    const String getProgramName (int index) override { return programs [index]; }
+    void changeProgramName (int, const String&) override { }
+
+    void setCurrentProgram (int index) override
+    {
+        currentProgram = index;
+        ValueTree message ("program");
+        message.setProperty ("id", pluginId, nullptr)
+               .setProperty ("index", index, nullptr);
+        const auto reply = host->request (message, EL_PLUGIN_HOST_REQUEST_TIMEOUT);
+        updateParameters (reply);
+    }
+
+    void getStateInformation (MemoryBlock& block) override
+    {
+        ValueTree message ("getState");
+        message.setProperty ("id", pluginId, nullptr);
+        const auto reply = host->request (message, EL_PLUGIN_HOST_REQUEST_TIMEOUT);
+        if (auto* data = reply.getProperty ("data").getBinaryData())
+            block = *data;
+    }
+
+    void setStateInformation (const void* data, int size) override
+    {
+        ValueTree message ("setState");
+        message.setProperty ("id", pluginId, nullptr)
+               .setProperty ("data", var (data, (size_t) size), nullptr);
+        const auto reply = host->request (message, EL_PLUGIN_HOST_REQUEST_TIMEOUT);
+        updateParameters (reply);
+    }
+
+private:
+    /** Shadows a parameter of the hosted plugin. Changes are sent with the
+        next block */
+    struct BridgedParameter : public AudioProcessorParameter
+    {
+        BridgedParameter (BridgedProcessor& p, const ValueTree& info)
+            : processor (p),
+              name (info.getProperty ("name").toString()),
+              label (info.getProperty ("label").toString()),
+              defaultValue ((float) info.getProperty ("default", 0.f)),
+              numSteps ((int) info.getProperty ("steps", AudioProcessor::getDefaultNumParameterSteps())),
+              discrete ((bool) info.getProperty ("discrete", false)),
+              value ((float) info.getProperty ("value", 0.f))
+        { }
+
+        float getValue() const override                 { return value.load(); }
+        void setValue (float newValue) override
+        {
+            value.store (newValue);
+            changed.store (true);
+            processor.parametersChanged.store (true);
+        }
+
+        float getDefaultValue() const override          { return defaultValue; }
+        String getName (int maximumStringLength) const override { return name.substring (0, maximumStringLength); }
+        String getLabel() const override                { return label; }
+        int getNumSteps() const override                { return numSteps; }
+        bool isDiscrete() const override                { return discrete; }
+        String getText (float v, int length) const override { return String (v, 3).substring (0, length); }
+        float getValueForText (const String& text) const override { return text.getFloatValue(); }
+
+        BridgedProcessor& processor;
+        const String name, label;
+        const float defaultValue;
+        const int numSteps;
+        const bool discrete;
+        std::atomic<float> value;
+        std::atomic<bool> changed { false };
+    };
+
+    PluginHostProcess::Ptr host;
+    const int pluginId;
+    const PluginDescription description;
+    std::unique_ptr<BridgeChannel> channel;
+    std::atomic<bool> parametersChanged { false };
+    MidiBuffer chunkMidi;
+    StringArray programs;
+    int currentProgram = 0;
+    int latency = 0;
+    double tailLength = 0.0;
+    bool midiIn = false, midiOut = false;
+
+    static BusesProperties createBuses (const BridgeChannel::Layout& layout)
+    {
+        BusesProperties buses;
+        if (layout.numInputs > 0)
+            buses.addBus (true, "Input", AudioChannelSet::discreteChannels (layout.numInputs), true);
+        if (layout.numOutputs > 0)
+            buses.addBus (false, "Output", AudioChannelSet::discreteChannels (layout.numOutputs), true);
+        return buses;
+    }
+
+    double getTimeout (int numSamples) const
+    {
+        const double rate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+        return 1000.0 * (double) numSamples / rate * deadlineFraction;
+    }
+
+    /** Takes the plugin's parameter values from a reply */
+    void updateParameters (const ValueTree& reply)
+    {
+        auto* values = reply.getProperty ("values").getBinaryData();
+        if (values == nullptr)
+            return;
+
+        const auto& params = getParameters();
+        const int numValues = jmin (params.size(), (int) (values->getSize() / sizeof (float)));
+        const auto* data = static_cast<const float*> (values->getData());
+        for (int i = 0; i < numValues; ++i)
+            if (auto* bridged = dynamic_cast<BridgedParameter*> (params.getUnchecked (i)))
+                bridged->value.store (data[i]);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BridgedProcessor)
+};
+
+//=============================================================================
+/** A plugin living in a host process, and the thread it renders on */
+class HostedPlugin : public Thread,
+                     public AudioPlayHead
+{
+public:
+    HostedPlugin (int id, AudioPluginInstance* p)
+        : Thread ("Bridged Plugin"), pluginId (id), instance (p)
+    {
+        position.resetToDefault();
+        instance->setPlayHead (this);
+    }
+
+    ~HostedPlugin()
+    {
+        stopThread (2000);
+        instance->setPlayHead (nullptr);
+        channel.close();
+    }
+
+    bool attach (const String& name)
+    {
+        if (! channel.open (name))
+            return false;
+
+        const auto& layout = channel.getLayout();
+        buffer.setSize (jmax (1, layout.numInputs, layout.numOutputs), layout.maxBlockSize);
+        midi.ensureSize (4096);
+        startThread (9);
+        return true;
+    }
+
+    void run() override
+    {
+        RealtimeThreads::setCurrentThreadRealtime();
+
+        while (! threadShouldExit())
+        {
+            if (! channel.receive (buffer, midi, position, 100.0))
+                continue;
+
+            int index = 0; float value = 0.f;
+            const auto& params = instance->getParameters();
+            while (channel.popParameter (index, value))
+                if (isPositiveAndBelow (index, params.size()))
+                    params.getUnchecked(index)->setValue (value);
+
+            {
+                const ScopedLock sl (instance->getCallbackLock());
+                if (instance->isSuspended())
+                {
+                    buffer.clear();
+                    midi.clear();
+                }
+                else
+                {
+                    instance->processBlock (buffer, midi);
+                }
+            }
+
+            channel.reply (buffer, midi);
+        }
+    }
+
+    bool getCurrentPosition (CurrentPositionInfo& result) override
+    {
+        result = position;
+        return true;
+    }
+
+    const int pluginId;
+    std::unique_ptr<AudioPluginInstance> instance;
+
+private:
+    BridgeChannel channel;
+    AudioBuffer<float> buffer;
+    MidiBuffer midi;
+    CurrentPositionInfo position;
+};
+
+//=============================================================================
+/** Runs in a host process. Requests arrive on the connection's thread and are
+    handled on the message thread, where plugins expect to be created */
+class PluginHostSlave : public kv::ChildProcessSlave,
+                        private AsyncUpdater
+{
+public:
+    PluginHostSlave()
+    {
+        SystemStats::setApplicationCrashHandler (pluginHostSlaveCrashHandler);
+    }
+
+    ~PluginHostSlave()
+    {
+        cancelPendingUpdate();
+    }
+
+    void handleConnectionMade() override
+    {
+        plugins.reset (new PluginManager());
+        plugins->addDefaultFormats();
+    }
+
+    void handleConnectionLost() override
+    {
+        hosted.clear();
+        plugins = nullptr;
+        exit (0);
+    }
+
+    void handleMessageFromMaster (const MemoryBlock& mb) override
+    {
+        {
+            ScopedLock sl (lock);
+            requests.add (ValueTree::readFromData (mb.getData(), mb.getSize()));
+        }
+
+        triggerAsyncUpdate();
+    }
+
+private:
+    std::unique_ptr<PluginManager> plugins;
+    OwnedArray<HostedPlugin> hosted;
+    CriticalSection lock;
+    Array<ValueTree> requests;
+
+    void handleAsyncUpdate() override
+    {
+        Array<ValueTree> toHandle;
+        {
+            ScopedLock sl (lock);
+            toHandle.swapWith (requests);
+        }
+
+        for (const auto& message : toHandle)
+            handle (message);
+    }
+
+    HostedPlugin* findPlugin (int pluginId) const
+    {
+        for (auto* plugin : hosted)
+            if (plugin->pluginId == pluginId)
+                return plugin;
+        return nullptr;
+    }
+
+    static var getParameterValues (AudioPluginInstance& instance)
+    {
+        MemoryBlock values;
+        for (auto* param : instance.getParameters())
+        {
+            const float value = param->getValue();
+            values.append (&value, sizeof (value));
+        }
+        return var (values);
+    }
+
+    void reply (const ValueTree& message, ValueTree result)
+    {
+        result.setProperty ("request", message.getProperty ("request"), nullptr);
+        sendMessageToMaster (toMessage (result));
+    }
+
+    void handle (const ValueTree& message)
+    {
+        const int pluginId = message.getProperty ("id", 0);
+        auto* plugin = findPlugin (pluginId);
+        ValueTree result ("reply");
+
+        if (message.hasType ("load"))
+        {
+            load (message, result);
+        }
+        else if (message.hasType ("unload"))
+        {
+            hosted.removeObject (plugin);
+            return;
+        }
+        else if (plugin == nullptr)
+        {
+            result.setProperty ("error", "Unknown plugin", nullptr);
+        }
+        else if (message.hasType ("attach"))
+        {
+            const bool ok = plugin->attach (message.getProperty ("channel").toString());
+            result.setProperty ("ok", ok, nullptr);
+            if (! ok)
+                result.setProperty ("error", "Couldn't open the audio channel", nullptr);
+        }
+        else if (message.hasType ("prepare"))
+        {
+            auto& instance = *plugin->instance;
+            const double sampleRate = message.getProperty ("sampleRate", 44100.0);
+            const int blockSize = message.getProperty ("blockSize", 512);
+            {
+                const ScopedLock sl (instance.getCallbackLock());
+                instance.releaseResources();
+                instance.setRateAndBufferSizeDetails (sampleRate, blockSize);
+                instance.prepareToPlay (sampleRate, blockSize);
+            }
+            result.setProperty ("ok", true, nullptr)
+                  .setProperty ("latency", instance.getLatencySamples(), nullptr);
+        }
+        else if (message.hasType ("getState"))
+        {
+            MemoryBlock state;
+            plugin->instance->getStateInformation (state);
+            result.setProperty ("ok", true, nullptr)
+                  .setProperty ("data", var (state), nullptr);
+        }
+        else if (message.hasType ("setState"))
+        {
+            if (auto* data = message.getProperty ("data").getBinaryData())
+                plugin->instance->setStateInformation (data->getData(), (int) data->getSize());
+            result.setProperty ("ok", true, nullptr)
+                  .setProperty ("values", getParameterValues (*plugin->instance), nullptr);
+        }
+        else if (message.hasType ("program"))
+        {
+            plugin->instance->setCurrentProgram (message.getProperty ("index", 0));
+            result.setProperty ("ok", true, nullptr)
+                  .setProperty ("values", getParameterValues (*plugin->instance), nullptr);
+        }
+
+        reply (message, result);
+    }
+
+    void load (const ValueTree& message, ValueTree& result)
+    {
+        PluginDescription desc;
+        std::unique_ptr<XmlElement> xml (XmlDocument::parse (message.getProperty ("description").toString()));
+        if (plugins == nullptr || xml == nullptr || ! desc.loadFromXml (*xml))
+        {
+            result.setProperty ("error", "Invalid plugin description", nullptr);
+            return;
+        }
+
+        String error;
+        std::unique_ptr<AudioPluginInstance> instance (plugins->createAudioPlugin (desc, error));
+        if (instance == nullptr)
+        {
+            result.setProperty ("error", error.isNotEmpty() ? error : String ("Couldn't load the plugin"), nullptr);
+            return;
+        }
+
+        const double sampleRate = message.getProperty ("sampleRate", 44100.0);
+        const int blockSize = jmin (bridgedBlockSize, (int) message.getProperty ("blockSize", 512));
+        instance->enableAllBuses();
+        instance->setRateAndBufferSizeDetails (sampleRate, blockSize);
+        instance->prepareToPlay (sampleRate, blockSize);
+
+        StringArray programs;
+        for (int i = 0; i < instance->getNumPrograms(); ++i)
+            programs.add (instance->getProgramName (i));
+
+        ValueTree params ("parameters");
+        for (auto* param : instance->getParameters())
+        {
+            ValueTree info ("parameter");
+            info.setProperty ("name", param->getName (128), nullptr)
+                .setProperty ("label", param->getLabel(), nullptr)
+                .setProperty ("default", param->getDefaultValue(), nullptr)
+                .setProperty ("value", param->getValue(), nullptr)
+                .setProperty ("steps", param->getNumSteps(), nullptr)
+                .setProperty ("discrete", param->isDiscrete(), nullptr);
+            params.appendChild (info, nullptr);
+        }
+
+        result.setProperty ("ok", true, nullptr)
+              .setProperty ("numInputs", instance->getTotalNumInputChannels(), nullptr)
+              .setProperty ("numOutputs", instance->getTotalNumOutputChannels(), nullptr)
+              .setProperty ("latency", instance->getLatencySamples(), nullptr)
+              .setProperty ("tail", instance->getTailLengthSeconds(), nullptr)
+              .setProperty ("acceptsMidi", instance->acceptsMidi(), nullptr)
+              .setProperty ("producesMidi", instance->producesMidi(), nullptr)
+              .setProperty ("programs", programs.joinIntoString ("\n"), nullptr);
+        result.appendChild (params, nullptr);
+
+        hosted.add (new HostedPlugin ((int) message.getProperty ("id", 0), instance.release()));
+    }
+};
+
+//=============================================================================
+PluginBridge::PluginBridge() { }
+
+PluginBridge::~PluginBridge()
+{
+    shutdown();
+}
+
+AudioPluginInstance* PluginBridge::createInstance (const PluginDescription& desc, const String& group,
+                                                   double sampleRate, int blockSize, String& errorMsg)
+{
+    PluginHostProcess::Ptr host;
+    {
+        ScopedLock sl (lock);
+        for (auto* h : hosts)
+            if (h->getGroup() == group)
+                host = h;
+        if (host == nullptr)
+            host = hosts.add (new PluginHostProcess (group));
+
+        if (! host->launch())
+        {
+            errorMsg = "Couldn't start the plugin host";
+            return nullptr;
+        }
+    }
+
+    const int pluginId = host->addPlugin();
+    std::unique_ptr<XmlElement> xml (desc.createXml());
+
+    ValueTree load ("load");
+    load.setProperty ("id", pluginId, nullptr)
+        .setProperty ("description", xml->createDocument (String(), true, false), nullptr)
+        .setProperty ("sampleRate", sampleRate, nullptr)
+        .setProperty ("blockSize", blockSize, nullptr);
+    const auto info = host->request (load, EL_PLUGIN_HOST_LOAD_TIMEOUT);
+    if (! (bool) info.getProperty ("ok", false))
+    {
+        errorMsg = info.isValid() ? info.getProperty ("error").toString()
+                                  : String ("The plugin host didn't respond");
+        host->removePlugin (pluginId);
+        return nullptr;
+    }
+
+    BridgeChannel::Layout layout;
+    layout.numInputs    = info.getProperty ("numInputs", 0);
+    layout.numOutputs   = info.getProperty ("numOutputs", 0);
+    layout.maxBlockSize = bridgedBlockSize;
+
+    std::unique_ptr<BridgeChannel> channel (new BridgeChannel());
+    bool attached = channel->create (BridgeChannel::createUniqueName(), layout);
+    if (attached)
+    {
+        ValueTree attach ("attach");
+        attach.setProperty ("id", pluginId, nullptr)
+              .setProperty ("channel", channel->getName(), nullptr);
+        attached = (bool) host->request (attach, EL_PLUGIN_HOST_REQUEST_TIMEOUT).getProperty ("ok", false);
+    }
+
+    if (! attached)
+    {
+        errorMsg = "Couldn't open an audio channel to the plugin host";
+        host->removePlugin (pluginId);
+        return nullptr;
+    }
+
+    return new BridgedProcessor (host, pluginId, desc, info, std::move (channel));
+}
+
+void PluginBridge::shutdown()
+{
+    ScopedLock sl (lock);
+    for (auto* host : hosts)
+        host->stop();
+    hosts.clear();
+}
+
+bool PluginBridge::isBridged (const AudioProcessor* processor)
+{
+    return dynamic_cast<const BridgedProcessor*> (processor) != nullptr;
+}
+
+String PluginBridge::getGroup (const AudioProcessor* processor)
+{
+    if (auto* bridged = dynamic_cast<const BridgedProcessor*> (processor))
+        return bridged->getGroup();
+    return String();
+}
+
+kv::ChildProcessSlave* PluginBridge::createHostSlave()
+{
+    return new PluginHostSlave();
+}
+
+}
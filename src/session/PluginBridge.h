@@ -0,0 +1,69 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+#define EL_PLUGIN_HOST_PROCESS_ID       "phelbg"
+
+namespace Element {
+
+class PluginHostProcess;
+
+/** Runs plugins in child processes, so one that crashes or stalls can't take
+    the engine down with it.
+
+    Plugins are grouped by name and every group gets one host process, so
+    several plugins can share the cost of a process. Control messages travel
+    over the child process connection; audio and MIDI go through a
+    BridgeChannel in shared memory. If a host dies its plugins go silent and
+    stay that way until they're loaded again.
+ */
+class PluginBridge
+{
+public:
+    PluginBridge();
+    ~PluginBridge();
+
+    /** Loads a plugin in a group's host, starting it if need be. Blocks until
+        the plugin is ready, so call it from the message thread or a worker */
+    AudioPluginInstance* createInstance (const PluginDescription& desc, const String& group,
+                                         double sampleRate, int blockSize, String& errorMsg);
+
+    /** Stops every host process. Their plugins go silent */
+    void shutdown();
+
+    /** Returns true if the processor is a stand-in for a plugin in another process */
+    static bool isBridged (const AudioProcessor* processor);
+
+    /** Returns the group a bridged processor's host belongs to */
+    static String getGroup (const AudioProcessor* processor);
+
+    /** Creates the object which runs in a host process */
+    static kv::ChildProcessSlave* createHostSlave();
+
+private:
+    CriticalSection lock;
+    ReferenceCountedArray<PluginHostProcess> hosts;
+
+    JUCE_DECLARE_NON_COPYABLE (PluginBridge)
+};
+
+}
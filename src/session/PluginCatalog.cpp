@@ -0,0 +1,388 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/PluginCatalog.h"
+#include "DataPath.h"
+
+#define EL_PLUGIN_CATALOG_FILENAME  "PluginCatalog.bin"
+
+namespace Element {
+
+/* Everything is little endian uint32, laid out as:
+
+   header       see the Header fields below
+   records      numRecords * recordSize
+   blacklist    numBlacklisted string offsets
+   keys         per index, numKeys * { string, first posting, count }
+   postings     record numbers, grouped by key
+   strings      null terminated UTF-8, offset 0 is the empty string
+*/
+namespace Header
+{
+    enum
+    {
+        magic = 0, version, numRecords, numBlacklisted,
+        records, blacklist,
+        keys, numKeys = keys + PluginCatalog::numIndices,
+        postings = numKeys + PluginCatalog::numIndices,
+        strings, stringsSize,
+        size
+    };
+}
+
+namespace Record
+{
+    enum
+    {
+        name = 0, descriptiveName, format, category, manufacturer, version, file,
+        uid, numInputs, numOutputs, flags,
+        fileModTimeLow, fileModTimeHigh, infoUpdateTimeLow, infoUpdateTimeHigh,
+        size
+    };
+
+    enum
+    {
+        isInstrument        = 1 << 0,
+        hasSharedContainer  = 1 << 1
+    };
+}
+
+static const uint32 catalogMagic    = 0x43504c45; // "ELPC"
+static const uint32 catalogVersion  = 1;
+
+struct CaseInsensitiveLess
+{
+    bool operator() (const String& a, const String& b) const { return a.compareIgnoreCase (b) < 0; }
+};
+
+static String getIndexKey (const PluginDescription& desc, int index)
+{
+    switch (index)
+    {
+        case PluginCatalog::byFormat:       return desc.pluginFormatName;
+        case PluginCatalog::byManufacturer: return desc.manufacturerName;
+        case PluginCatalog::byCategory:     return desc.category;
+        default: break;
+    }
+    return String();
+}
+
+/** Collects the strings of a catalog, storing each one once */
+class StringTable
+{
+public:
+    StringTable() { out.writeByte (0); }
+
+    uint32 add (const String& text)
+    {
+        if (text.isEmpty())
+            return 0;
+        if (offsets.contains (text))
+            return offsets [text];
+        const auto offset = (uint32) out.getDataSize();
+        out.writeString (text);
+        offsets.set (text, offset);
+        return offset;
+    }
+
+    MemoryOutputStream out;
+
+private:
+    HashMap<String, uint32> offsets;
+};
+
+//=============================================================================
+
+PluginCatalog::PluginCatalog() { }
+PluginCatalog::~PluginCatalog() { close(); }
+
+File PluginCatalog::getDefaultFile()
+{
+    return DataPath::applicationDataDir().getChildFile (EL_PLUGIN_CATALOG_FILENAME);
+}
+
+bool PluginCatalog::write (const KnownPluginList& list, const File& file)
+{
+    const auto types = list.getTypes();
+    const auto& blacklisted = list.getBlacklistedFiles();
+    StringTable strings;
+
+    MemoryOutputStream records;
+    for (const auto& desc : types)
+    {
+        uint32 record [Record::size];
+        record [Record::name]               = strings.add (desc.name);
+        record [Record::descriptiveName]    = strings.add (desc.descriptiveName);
+        record [Record::format]             = strings.add (desc.pluginFormatName);
+        record [Record::category]           = strings.add (desc.category);
+        record [Record::manufacturer]       = strings.add (desc.manufacturerName);
+        record [Record::version]            = strings.add (desc.version);
+        record [Record::file]               = strings.add (desc.fileOrIdentifier);
+        record [Record::uid]                = (uint32) desc.uid;
+        record [Record::numInputs]          = (uint32) desc.numInputChannels;
+        record [Record::numOutputs]         = (uint32) desc.numOutputChannels;
+        record [Record::flags]              = (desc.isInstrument ? Record::isInstrument : 0)
+                                            | (desc.hasSharedContainer ? Record::hasSharedContainer : 0);
+        const auto modified = (uint64) desc.lastFileModTime.toMilliseconds();
+        const auto updated  = (uint64) desc.lastInfoUpdateTime.toMilliseconds();
+        record [Record::fileModTimeLow]     = (uint32) (modified & 0xffffffff);
+        record [Record::fileModTimeHigh]    = (uint32) (modified >> 32);
+        record [Record::infoUpdateTimeLow]  = (uint32) (updated & 0xffffffff);
+        record [Record::infoUpdateTimeHigh] = (uint32) (updated >> 32);
+
+        for (auto value : record)
+            records.writeInt ((int) value);
+    }
+
+    MemoryOutputStream blacklist;
+    for (const auto& entry : blacklisted)
+        blacklist.writeInt ((int) strings.add (entry));
+
+    MemoryOutputStream keys [numIndices];
+    MemoryOutputStream postings;
+    uint32 numKeys [numIndices];
+    uint32 numPostings = 0;
+
+    for (int index = 0; index < numIndices; ++index)
+    {
+        std::map<String, Array<uint32>, CaseInsensitiveLess> groups;
+        for (int i = 0; i < types.size(); ++i)
+            groups[getIndexKey (types.getReference (i), index)].add ((uint32) i);
+
+        numKeys [index] = (uint32) groups.size();
+        for (const auto& group : groups)
+        {
+            keys[index].writeInt ((int) strings.add (group.first));
+            keys[index].writeInt ((int) numPostings);
+            keys[index].writeInt (group.second.size());
+            for (auto record : group.second)
+                postings.writeInt ((int) record);
+            numPostings += (uint32) group.second.size();
+        }
+    }
+
+    uint32 header [Header::size];
+    uint32 offset = (uint32) sizeof (header);
+    header [Header::magic]          = catalogMagic;
+    header [Header::version]        = catalogVersion;
+    header [Header::numRecords]     = (uint32) types.size();
+    header [Header::numBlacklisted] = (uint32) blacklisted.size();
+    header [Header::records]        = offset;   offset += (uint32) records.getDataSize();
+    header [Header::blacklist]      = offset;   offset += (uint32) blacklist.getDataSize();
+    for (int index = 0; index < numIndices; ++index)
+    {
+        header [Header::keys + index]       = offset;
+        header [Header::numKeys + index]    = numKeys [index];
+        offset += (uint32) keys[index].getDataSize();
+    }
+    header [Header::postings]       = offset;   offset += (uint32) postings.getDataSize();
+    header [Header::strings]        = offset;
+    header [Header::stringsSize]    = (uint32) strings.out.getDataSize();
+
+    file.getParentDirectory().createDirectory();
+    TemporaryFile temp (file);
+    {
+        FileOutputStream out (temp.getFile());
+        if (out.failedToOpen())
+            return false;
+
+        for (auto value : header)
+            out.writeInt ((int) value);
+        out << records << blacklist;
+        for (auto& k : keys)
+            out << k;
+        out << postings << strings.out;
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool PluginCatalog::open (const File& file)
+{
+    close();
+    if (! file.existsAsFile())
+        return false;
+
+    mapped.reset (new MemoryMappedFile (file, MemoryMappedFile::readOnly));
+    data = static_cast<const char*> (mapped->getData());
+    dataSize = mapped->getSize();
+
+    const auto headerSize = (size_t) Header::size * sizeof (uint32);
+    if (data == nullptr || dataSize < headerSize
+        || readInt (Header::magic * sizeof (uint32)) != catalogMagic
+        || readInt (Header::version * sizeof (uint32)) != catalogVersion)
+    {
+        close();
+        return false;
+    }
+
+    auto field = [this] (int name) { return (size_t) readInt ((size_t) name * sizeof (uint32)); };
+    auto fits = [this] (size_t offset, size_t size) { return offset <= dataSize && size <= dataSize - offset; };
+
+    const auto stringsOffset = field (Header::strings);
+    const auto stringsSize   = field (Header::stringsSize);
+    bool valid = fits (field (Header::records), field (Header::numRecords) * Record::size * sizeof (uint32))
+              && fits (field (Header::blacklist), field (Header::numBlacklisted) * sizeof (uint32))
+              && fits (stringsOffset, stringsSize) && stringsSize > 0
+              && data [stringsOffset + stringsSize - 1] == 0;
+
+    for (int index = 0; index < numIndices && valid; ++index)
+        valid = fits (field (Header::keys + index), field (Header::numKeys + index) * 3 * sizeof (uint32));
+
+    if (! valid)
+    {
+        close();
+        return false;
+    }
+
+    numRecords      = (int) field (Header::numRecords);
+    numBlacklisted  = (int) field (Header::numBlacklisted);
+    return true;
+}
+
+void PluginCatalog::close()
+{
+    mapped.reset();
+    data = nullptr;
+    dataSize = 0;
+    numRecords = numBlacklisted = 0;
+}
+
+uint32 PluginCatalog::readInt (size_t offset) const noexcept
+{
+    return offset + sizeof (uint32) <= dataSize
+        ? ByteOrder::littleEndianInt (data + offset) : 0;
+}
+
+String PluginCatalog::readString (uint32 offset) const
+{
+    const auto strings = (size_t) readInt (Header::strings * sizeof (uint32));
+    const auto size    = (size_t) readInt (Header::stringsSize * sizeof (uint32));
+    // the table ends with a null, so any offset inside it is terminated
+    return (size_t) offset < size ? String::fromUTF8 (data + strings + offset) : String();
+}
+
+PluginDescription PluginCatalog::getType (int index) const
+{
+    PluginDescription desc;
+    if (! isPositiveAndBelow (index, numRecords))
+        return desc;
+
+    const auto base = (size_t) readInt (Header::records * sizeof (uint32))
+                    + (size_t) index * Record::size * sizeof (uint32);
+    auto field = [this, base] (int name) { return readInt (base + (size_t) name * sizeof (uint32)); };
+
+    desc.name               = readString (field (Record::name));
+    desc.descriptiveName    = readString (field (Record::descriptiveName));
+    desc.pluginFormatName   = readString (field (Record::format));
+    desc.category           = readString (field (Record::category));
+    desc.manufacturerName   = readString (field (Record::manufacturer));
+    desc.version            = readString (field (Record::version));
+    desc.fileOrIdentifier   = readString (field (Record::file));
+    desc.uid                = (int) field (Record::uid);
+    desc.numInputChannels   = (int) field (Record::numInputs);
+    desc.numOutputChannels  = (int) field (Record::numOutputs);
+    desc.isInstrument       = (field (Record::flags) & Record::isInstrument) != 0;
+    desc.hasSharedContainer = (field (Record::flags) & Record::hasSharedContainer) != 0;
+    desc.lastFileModTime    = Time ((int64) (((uint64) field (Record::fileModTimeHigh) << 32)
+                                             | field (Record::fileModTimeLow)));
+    desc.lastInfoUpdateTime = Time ((int64) (((uint64) field (Record::infoUpdateTimeHigh) << 32)
+                                             | field (Record::infoUpdateTimeLow)));
+    return desc;
+}
+
+StringArray PluginCatalog::getBlacklistedFiles() const
+{
+    StringArray files;
+    const auto base = (size_t) readInt (Header::blacklist * sizeof (uint32));
+    for (int i = 0; i < numBlacklisted; ++i)
+        files.add (readString (readInt (base + (size_t) i * sizeof (uint32))));
+    return files;
+}
+
+int PluginCatalog::getNumKeys (Index index) const noexcept
+{
+    return isOpen() ? (int) readInt ((size_t) (Header::numKeys + index) * sizeof (uint32)) : 0;
+}
+
+size_t PluginCatalog::getKeyOffset (Index index, int key) const noexcept
+{
+    return (size_t) readInt ((size_t) (Header::keys + index) * sizeof (uint32))
+         + (size_t) key * 3 * sizeof (uint32);
+}
+
+StringArray PluginCatalog::getKeys (Index index) const
+{
+    StringArray keys;
+    for (int i = 0; i < getNumKeys (index); ++i)
+        keys.add (readString (readInt (getKeyOffset (index, i))));
+    return keys;
+}
+
+Array<int> PluginCatalog::getTypesFor (Index index, const String& key) const
+{
+    Array<int> found;
+    int low = 0, high = getNumKeys (index);
+
+    while (low < high)
+    {
+        const int mid = (low + high) / 2;
+        const auto offset = getKeyOffset (index, mid);
+        const int cmp = readString (readInt (offset)).compareIgnoreCase (key);
+
+        if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else if (cmp > 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            const auto postings = (size_t) readInt (Header::postings * sizeof (uint32));
+            const auto first    = (size_t) readInt (offset + sizeof (uint32));
+            const auto count    = (int) readInt (offset + 2 * sizeof (uint32));
+            for (int i = 0; i < count; ++i)
+            {
+                const auto record = (int) readInt (postings + (first + (size_t) i) * sizeof (uint32));
+                if (isPositiveAndBelow (record, numRecords))
+                    found.add (record);
+            }
+            break;
+        }
+    }
+
+    return found;
+}
+
+void PluginCatalog::restoreInto (KnownPluginList& list) const
+{
+    list.clear();
+    list.clearBlacklistedFiles();
+    for (int i = 0; i < numRecords; ++i)
+        list.addType (getType (i));
+    for (const auto& file : getBlacklistedFiles())
+        list.addToBlacklist (file);
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A binary snapshot of the known plugins, read through a memory mapped file.
+
+    The file holds fixed size records whose strings live in a shared,
+    de-duplicated table, the blacklist, and prebuilt indices of the records by
+    format, manufacturer and category. Nothing is parsed when it's opened;
+    descriptions are only built for the records asked for. XML remains the
+    format for importing and exporting plugin lists.
+ */
+class PluginCatalog
+{
+public:
+    enum Index
+    {
+        byFormat = 0,
+        byManufacturer,
+        byCategory,
+        numIndices
+    };
+
+    PluginCatalog();
+    ~PluginCatalog();
+
+    /** Returns where the user's catalog is kept */
+    static File getDefaultFile();
+
+    /** Writes a plugin list to a catalog file. The file is replaced in one go,
+        so other processes never see half of it */
+    static bool write (const KnownPluginList& list, const File& file);
+
+    /** Maps a catalog file. Returns false if it's missing or not a valid catalog */
+    bool open (const File& file);
+
+    /** Unmaps the file */
+    void close();
+
+    bool isOpen() const noexcept { return data != nullptr; }
+
+    /** Returns the number of plugin types in the catalog */
+    int getNumTypes() const noexcept { return numRecords; }
+
+    /** Builds the description of one type */
+    PluginDescription getType (int index) const;
+
+    /** Returns the blacklisted files */
+    StringArray getBlacklistedFiles() const;
+
+    /** Returns the keys of an index, sorted case-insensitively */
+    StringArray getKeys (Index index) const;
+
+    /** Returns the types with the given format, manufacturer or category */
+    Array<int> getTypesFor (Index index, const String& key) const;
+
+    /** Replaces the contents of a plugin list with the catalog's */
+    void restoreInto (KnownPluginList& list) const;
+
+private:
+    std::unique_ptr<MemoryMappedFile> mapped;
+    const char* data = nullptr;
+    size_t dataSize = 0;
+    int numRecords = 0;
+    int numBlacklisted = 0;
+
+    uint32 readInt (size_t offset) const noexcept;
+    String readString (uint32 offset) const;
+    int getNumKeys (Index) const noexcept;
+    size_t getKeyOffset (Index, int key) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (PluginCatalog)
+};
+
+}
@@ -0,0 +1,159 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/PluginInstancePool.h"
+
+namespace Element {
+
+const int64 PluginInstancePool::instanceOverhead = 8 * 1024 * 1024;
+
+struct PluginInstancePool::Entry
+{
+    String identifier;
+    std::unique_ptr<AudioPluginInstance> instance;
+    MemoryBlock initialState;
+    int64 cost = 0;
+};
+
+PluginInstancePool::PluginInstancePool() { }
+
+PluginInstancePool::~PluginInstancePool()
+{
+    clear();
+}
+
+AudioPluginInstance* PluginInstancePool::take (const PluginDescription& desc)
+{
+    std::unique_ptr<Entry> entry;
+    {
+        const auto identifier = desc.createIdentifierString();
+        ScopedLock sl (lock);
+        // newest first, it's the one most likely still warm in the caches
+        for (int i = entries.size(); --i >= 0;)
+        {
+            if (entries.getUnchecked(i)->identifier == identifier)
+            {
+                entry.reset (entries.removeAndReturn (i));
+                used -= entry->cost;
+                break;
+            }
+        }
+    }
+
+    if (entry == nullptr)
+        return nullptr;
+
+    auto& instance = *entry->instance;
+    if (entry->initialState.getSize() > 0)
+        instance.setStateInformation (entry->initialState.getData(),
+                                      (int) entry->initialState.getSize());
+    instance.reset();
+    return entry->instance.release();
+}
+
+void PluginInstancePool::park (AudioPluginInstance* instance, const MemoryBlock& initialState)
+{
+    if (instance == nullptr)
+        return;
+
+    std::unique_ptr<Entry> entry (new Entry());
+    entry->instance.reset (instance);
+    entry->identifier = instance->getPluginDescription().createIdentifierString();
+    entry->initialState = initialState;
+    entry->cost = instanceOverhead + (int64) initialState.getSize();
+
+    instance->setPlayHead (nullptr);
+    instance->suspendProcessing (false);
+    prepare (*instance);
+
+    OwnedArray<Entry> evicted;
+    {
+        ScopedLock sl (lock);
+        used += entry->cost;
+        entries.add (entry.release());
+        evict (evicted);
+    }
+}
+
+void PluginInstancePool::setPlayConfig (double newSampleRate, int newBlockSize)
+{
+    ScopedLock sl (lock);
+    if (sampleRate == newSampleRate && blockSize == newBlockSize)
+        return;
+
+    sampleRate = newSampleRate;
+    blockSize  = newBlockSize;
+    for (auto* entry : entries)
+        prepare (*entry->instance);
+}
+
+void PluginInstancePool::setMemoryBudget (int64 bytes)
+{
+    OwnedArray<Entry> evicted;
+    ScopedLock sl (lock);
+    budget = jmax ((int64) 0, bytes);
+    evict (evicted);
+}
+
+int64 PluginInstancePool::getMemoryBudget() const
+{
+    ScopedLock sl (lock);
+    return budget;
+}
+
+int64 PluginInstancePool::getMemoryUsed() const
+{
+    ScopedLock sl (lock);
+    return used;
+}
+
+int PluginInstancePool::size() const
+{
+    ScopedLock sl (lock);
+    return entries.size();
+}
+
+void PluginInstancePool::clear()
+{
+    OwnedArray<Entry> evicted;
+    {
+        ScopedLock sl (lock);
+        evicted.swapWith (entries);
+        used = 0;
+    }
+}
+
+void PluginInstancePool::prepare (AudioPluginInstance& instance)
+{
+    instance.releaseResources();
+    instance.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    instance.prepareToPlay (sampleRate, blockSize);
+}
+
+void PluginInstancePool::evict (OwnedArray<Entry>& evicted)
+{
+    while (used > budget && ! entries.isEmpty())
+    {
+        auto* entry = entries.removeAndReturn (0);
+        used -= entry->cost;
+        evicted.add (entry);
+    }
+}
+
+}
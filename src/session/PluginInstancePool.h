@@ -0,0 +1,87 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Keeps plugin instances that were removed from a graph so the next request
+    for the same plugin doesn't have to load it again.
+
+    Parked instances are kept prepared for the current sample rate and block
+    size, and are put back to the state they had when first created before
+    being handed out. AudioProcessor can't tell how much memory it uses, so
+    each entry is estimated at a fixed overhead plus the size of its state;
+    the oldest entries are destroyed when the total goes over budget.
+ */
+class PluginInstancePool
+{
+public:
+    PluginInstancePool();
+    ~PluginInstancePool();
+
+    /** Cost counted for every instance on top of its state */
+    static const int64 instanceOverhead;
+
+    /** Returns the budget used when none is set in the preferences, in megabytes */
+    static int getDefaultMemoryBudget() { return 256; }
+
+    /** Returns a parked instance of the plugin reset to its initial state, or
+        nullptr if there isn't one. The caller takes ownership */
+    AudioPluginInstance* take (const PluginDescription& desc);
+
+    /** Parks an instance. The pool owns it from here on, and may delete it
+        straight away if it won't fit the budget */
+    void park (AudioPluginInstance* instance, const MemoryBlock& initialState);
+
+    /** Changes the rate and block size parked instances are prepared for */
+    void setPlayConfig (double sampleRate, int blockSize);
+
+    /** Sets the memory budget in bytes. Zero disables parking */
+    void setMemoryBudget (int64 bytes);
+    int64 getMemoryBudget() const;
+
+    /** Returns the estimated memory held by parked instances */
+    int64 getMemoryUsed() const;
+
+    /** Returns the number of parked instances */
+    int size() const;
+
+    /** Deletes every parked instance */
+    void clear();
+
+private:
+    struct Entry;
+    OwnedArray<Entry> entries;  // oldest first
+    CriticalSection lock;
+    double sampleRate = 44100.0;
+    int blockSize = 512;
+    int64 budget = 0;
+    int64 used = 0;
+
+    void prepare (AudioPluginInstance&);
+    void evict (OwnedArray<Entry>& evicted);
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (PluginInstancePool)
+    JUCE_DECLARE_NON_COPYABLE (PluginInstancePool)
+};
+
+}
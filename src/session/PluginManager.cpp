@@ -17,8 +17,15 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "session/PluginBridge.h"
+#include "session/PluginCatalog.h"
+#include "session/PluginInstancePool.h"
 #include "session/PluginManager.h"
+#include "session/SharedPluginList.h"
 #include "session/Node.h"
+#include "engine/InternalFormat.h"
+#include "engine/RealtimeThreads.h"
+#include "engine/nodes/AudioProcessorNode.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/AudioRouterNode.h"
 #include "engine/nodes/LuaNode.h"
@@ -48,196 +55,81 @@ static const char* pluginListKey() { return Settings::pluginListKey; }
 /* noop. prevent OS error dialogs from child process */ 
 static void pluginScannerSlaveCrashHandler (void*) { }
 
-class PluginScannerMaster : public kv::ChildProcessMaster,
-                            public AsyncUpdater
+/** One plugin scanner child process. Its messages and a lost connection
+    arrive on the connection's thread and are queued for the PluginScanner,
+    which reads them on the message thread */
+class PluginScannerMaster : public kv::ChildProcessMaster
 {
 public:
-    explicit PluginScannerMaster (PluginScanner& o) : owner(o) { }
+    PluginScannerMaster() { }
     ~PluginScannerMaster() { }
-    
-    bool startScanning (const StringArray& names = StringArray())
+
+    bool launch()
     {
-        if (isRunning())
-            return true;
-        
-        {
-            ScopedLock sl (lock);
-            slaveState  = "waiting";
-            running     = false;
-            formatNames = names;
-        }
-        
-        const bool res = launchScanner();
-        
+        // the old process first, so its lost connection isn't taken for the new one's
+        killSlaveProcess();
         {
             ScopedLock sl (lock);
-            running = res;
+            messages.clearQuick();
+            connectionLost = false;
         }
-        
-        return res;
+
+        ready = false;
+        work = String();
+        running = launchSlaveProcess (File::getSpecialLocation (File::invokedExecutableFile),
+                                      EL_PLUGIN_SCANNER_PROCESS_ID, EL_PLUGIN_SCANNER_DEFAULT_TIMEOUT, 0);
+        return running;
     }
-    
+
     void handleMessageFromSlave (const MemoryBlock& mb) override
     {
-        const auto data (mb.toString());
-        const auto type (data.upToFirstOccurrenceOf (":", false, false));
-        const auto message (data.fromFirstOccurrenceOf (":", false, false));
-        
-        if (type == "state")
-        {
-            ScopedLock sl (lock);
-            const String lastState = slaveState;
-            slaveState = message;
-            if (lastState != slaveState)
-            {
-                ScopedUnlock sul (lock);
-                triggerAsyncUpdate();
-            }
-        }
-        else if (type == "name")
-        {
-            owner.listeners.call (&PluginScanner::Listener::audioPluginScanStarted, message.trim());
-            ScopedLock sl (lock);
-            pluginBeingScanned = message.trim();
-        }
-        else if (type == "progress")
-        {
-            float newProgress = (float) var (message);
-            owner.listeners.call (&PluginScanner::Listener::audioPluginScanProgress, newProgress);
-            ScopedLock sl (lock);
-            progress = newProgress;
-        }
+        ScopedLock sl (lock);
+        messages.add (mb.toString());
     }
-    
+
     void handleConnectionLost() override
     {
         // this probably will happen when a plugin crashes.
-        {
-            ScopedLock sl (lock);
-            running = false;
-        }
-        
-        triggerAsyncUpdate();
-    }
-    
-    void handleAsyncUpdate() override
-    {
-        const auto state = getSlaveState();
-        if (state == "ready" && isRunning())
-        {
-            String msg = "scan:"; msg << formatNames.joinIntoString(",");
-            MemoryBlock mb (msg.toRawUTF8(), msg.length());
-            sendMessageToSlave (mb);
-        }
-        else if (state == "scanning")
-        {
-            if (! isRunning())
-            {
-                DBG("[EL] a plugin crashed or timed out during scan");
-                updateListAndLaunchSlave();
-            }
-            else
-            {
-                DBG("[EL] scanning... and running....");
-            }
-        }
-		else if (state == "finished")
-		{
-			DBG("[EL] slave finished scanning");
-			{
-				ScopedLock sl(lock);
-				running = false;
-				slaveState = "idle";
-			}
-            owner.listeners.call (&PluginScanner::Listener::audioPluginScanFinished);
-			
-        }
-        else if (state == "waiting")
-        {
-            if (! isRunning())
-            {
-                DBG("[EL] waiting for plugin scanner");
-                updateListAndLaunchSlave();
-            }
-        }
-		else if (slaveState == "quitting")
-		{
-			return;
-		}
-        else
-        {
-            DBG("[EL] invalid slave state: " << state);
-        }
-    }
-    
-    const String getSlaveState() const
-    {
-        ScopedLock sl (lock);
-        return slaveState;
-    }
-    
-    float getProgress() const
-    {
         ScopedLock sl (lock);
-        return progress;
+        connectionLost = true;
     }
-    
-    bool isRunning() const
+
+    /** Takes the messages received since last time. Returns true if the
+        connection was lost after them */
+    bool takeMessages (StringArray& taken)
     {
+        taken.clearQuick();
         ScopedLock sl (lock);
-        return running;
+        taken.swapWith (messages);
+        return connectionLost;
     }
-    
-    bool sendQuitMessage()
+
+    bool send (const String& type, const String& message)
     {
-        if (isRunning())
-            return sendMessageToSlave (MemoryBlock ("quit", 4));
-        return false;
+        String data = type; data << ":" << message;
+        MemoryBlock mb (data.toRawUTF8(), data.getNumBytesAsUTF8());
+        return sendMessageToSlave (mb);
     }
-    
-private:
-    PluginScanner& owner;
 
-    CriticalSection lock;
-    bool running    = false;
-    float progress  = 0.f;
-    String slaveState;
-    StringArray formatNames;
-    StringArray faileFiles;
-    
-    String pluginBeingScanned;
+    // used on the message thread only
+    bool running = false;
+    bool ready = false;
+    String work;                ///< what the slave is busy with, empty when idle
+    double workStarted = 0.0;
 
-    void updateListAndLaunchSlave()
-    {
-        if (auto xml = XmlDocument::parse (PluginScanner::getSlavePluginListFile()))
-            owner.list.recreateFromXml (*xml);
-        
-        const bool res = launchScanner();
-        ScopedLock sl (lock);
-        running = res;
-    }
-    
-    void resetScannerVariables()
-    {
-        ScopedLock sl (lock);
-        pluginBeingScanned = String();
-        progress = -1.f;
-    }
-    
-    bool launchScanner (const int timeout = EL_PLUGIN_SCANNER_DEFAULT_TIMEOUT, const int flags = 0)
-    {
-        resetScannerVariables();
-        return launchSlaveProcess (File::getSpecialLocation (File::invokedExecutableFile),
-                                   EL_PLUGIN_SCANNER_PROCESS_ID, timeout, flags);
-    }
+private:
+    CriticalSection lock;
+    StringArray messages;
+    bool connectionLost = false;
 };
 
+/** Runs in a scanner child process. It lists the plugin files to scan when
+    asked, then scans one file at a time as the master hands them out */
 class PluginScannerSlave : public kv::ChildProcessSlave, public AsyncUpdater
 {
 public:
     PluginScannerSlave()
     {
-        scanFile = PluginScanner::getSlavePluginListFile();
         SystemStats::setApplicationCrashHandler (pluginScannerSlaveCrashHandler);
     }
     
@@ -247,7 +139,6 @@ public:
     {
         const auto data (mb.toString());
         const auto type (data.upToFirstOccurrenceOf (":", false, false));
-        const auto message (data.fromFirstOccurrenceOf (":", false, false));
         
         if (type == "quit")
         {
@@ -255,74 +146,40 @@ public:
             return;
         }
         
-        if (type == "scan")
         {
-            const auto formats (StringArray::fromTokens (message.trim(), ",", "'"));
-            formatsToScan = formats;
-            triggerAsyncUpdate();
+            ScopedLock sl (lock);
+            requests.add (data);
         }
+
+        // plugins expect to be loaded on the message thread
+        triggerAsyncUpdate();
     }
     
     void handleAsyncUpdate() override
     {
-        if (! scanFile.existsAsFile())
+        StringArray toHandle;
         {
-            sendState ("scanning");
-            sendState ("finished");
-            return;
+            ScopedLock sl (lock);
+            toHandle.swapWith (requests);
         }
-        
-        updateScanFileWithSettings();
-        
-        sendState ("scanning");
-        
-        for (const auto& format : formatsToScan)
-            scanFor (format);
-        
-        settings->saveIfNeeded();
-        sendState ("finished");
 
-       #if JUCE_LINUX
-        // workaround to get the background process to quit
-        handleConnectionLost();
-       #endif
-    }
-    
-    void updateScanFileWithSettings()
-    {
-        if (! plugins)
-            return;
-        
-        auto& list = plugins->getKnownPlugins();
-        const auto types = list.getTypes();
-        for (const auto& type : types)
-            pluginList.addType (type);
-        
-        for (const auto& file : list.getBlacklistedFiles())
-            pluginList.addToBlacklist (file);
-        
-        writePluginListNow();
+        for (const auto& data : toHandle)
+        {
+            const auto type (data.upToFirstOccurrenceOf (":", false, false));
+            const auto message (data.fromFirstOccurrenceOf (":", false, false));
+            if (type == "list")
+                listFiles (StringArray::fromTokens (message.trim(), ",", "'"));
+            else if (type == "file")
+                scanFile (message);
+        }
     }
     
     void handleConnectionMade() override
     {
         settings    = new Settings();
         plugins     = new PluginManager();
-        
-        if (! scanFile.existsAsFile())
-            scanFile.create();
-        
-        if (auto xml = XmlDocument::parse (scanFile))
-            pluginList.recreateFromXml (*xml);
-        
-        // This must happen before user settings, PluginManager will delete the deadman file
-        // when restoring user plugins
-        PluginDirectoryScanner::applyBlacklistingsFromDeadMansPedal (
-            pluginList, plugins->getDeadAudioPluginsFile());
-        
         plugins->addDefaultFormats();
         plugins->restoreUserPlugins (*settings);
-        
         sendState (EL_PLUGIN_SCANNER_READY_ID);
     }
     
@@ -330,33 +187,14 @@ public:
     {
         settings    = nullptr;
         plugins     = nullptr;
-        scanner     = nullptr;
         exit (0);
     }
 
 private:
     ScopedPointer<Settings> settings;
     ScopedPointer<PluginManager> plugins;
-    ScopedPointer<PluginDirectoryScanner> scanner;
-    String fileOrIdentifier;
-    KnownPluginList pluginList;
-    StringArray filesToSkip;
-    File scanFile;
-    StringArray formatsToScan;
-    
-    void applyDeadPlugins()
-    {
-        PluginDirectoryScanner::applyBlacklistingsFromDeadMansPedal (
-            pluginList, plugins->getDeadAudioPluginsFile());
-    }
-    
-    bool writePluginListNow()
-    {
-        applyDeadPlugins();
-        if (auto xml = pluginList.createXml())
-            return xml->writeToFile (scanFile, String());
-        return false;
-    }
+    CriticalSection lock;
+    StringArray requests;
     
     bool sendState (const String& state)
     {
@@ -370,48 +208,89 @@ private:
         return sendMessageToMaster (mb);
     }
     
-    bool doNextScan()
+    /** Sends the files in the formats' search paths that are new or changed
+        since the last scan, one "format<tab>file" per line. Files known from
+        before the scan cache existed are sent as unchanged so the master can
+        fingerprint them, and files that are gone are sent as removed */
+    void listFiles (const StringArray& formatNames)
     {
-        const auto nextFile = scanner->getNextPluginFileThatWillBeScanned();
-        sendString ("name", nextFile);
-        for (const auto& file : scanner->getFailedFiles())
-            pluginList.addToBlacklist (file);
+        if (plugins == nullptr || settings == nullptr)
+            return;
+
+        const auto& known = plugins->getKnownPlugins();
+        PluginScanCache cache;
+        cache.load();
+        String files, unchanged, removed;
 
-        if (scanner->scanNextFile (true, fileOrIdentifier))
+        for (const auto& formatName : formatNames)
         {
-            writePluginListNow();
-            return true;
+            auto* format = plugins->getAudioPluginFormat (formatName);
+            if (format == nullptr)
+                continue;
+
+            const auto key = String (settings->lastPluginScanPathPrefix) + format->getName();
+            FileSearchPath path (settings->getUserSettings()->getValue (key));
+            for (const auto& file : format->searchPathsForPlugins (path, true, false))
+            {
+                const auto line = format->getName() + "\t" + file + "\n";
+
+                if (cache.contains (file))
+                {
+                    // a blacklisted plugin gets another chance once it's been updated
+                    if (! cache.isUpToDate (file))
+                        files << line;
+                }
+                else if (known.getBlacklistedFiles().contains (file))
+                {
+                    continue;
+                }
+                else if (known.isListingUpToDate (file, *format))
+                {
+                    unchanged << line;
+                }
+                else
+                {
+                    files << line;
+                }
+            }
+
+            StringArray gone (cache.findRemovedFiles (format->getName()));
+            for (const auto& type : known.getTypesForFormat (*format))
+                if (File::isAbsolutePath (type.fileOrIdentifier) && ! File (type.fileOrIdentifier).exists())
+                    gone.addIfNotAlreadyThere (type.fileOrIdentifier);
+            for (const auto& file : gone)
+                removed << format->getName() << "\t" << file << "\n";
         }
-        
-        return false;
+
+        sendString ("removed", removed);
+        sendString ("unchanged", unchanged);
+        sendString ("files", files);
     }
-    
-    void scanFor (const String& formatName)
+
+    /** Scans one "format<tab>file" and sends back the types found in it */
+    void scanFile (const String& work)
     {
-        if (plugins == nullptr || settings == nullptr)
+        if (plugins == nullptr)
             return;
+
+        const auto formatName = work.upToFirstOccurrenceOf ("\t", false, false);
+        const auto file = work.fromFirstOccurrenceOf ("\t", false, false).trim();
+        sendString ("name", file);
+
+        KnownPluginList found;
+        OwnedArray<PluginDescription> types;
         if (auto* format = plugins->getAudioPluginFormat (formatName))
-            scanFor (*format);
-    }
-    
-    void scanFor (AudioPluginFormat& format)
-    {
-        if (plugins == nullptr || settings == nullptr)
+            found.scanAndAddFile (file, false, types, *format);
+
+        if (types.isEmpty())
+        {
+            sendString ("failed", file);
             return;
-        
-        const auto key = String(settings->lastPluginScanPathPrefix) + format.getName();
-        FileSearchPath path (settings->getUserSettings()->getValue (key));
-        scanner = new PluginDirectoryScanner (pluginList, format, path, true,
-                                              plugins->getDeadAudioPluginsFile(),
-                                              false);
-        
-        while (doNextScan())
-            sendString ("progress", String (scanner->getProgress()));
-        
-        writePluginListNow();
-        #if JUCE_LINUX
-        Thread::sleep (1000);
-        #endif
+        }
+
+        if (auto xml = found.createXml())
+            sendString ("types", xml->createDocument (String(), true, false));
+        sendString ("done", file);
     }
 };
 
@@ -421,20 +300,34 @@ PluginScanner::PluginScanner (KnownPluginList& listToManage) : list(listToManage
 PluginScanner::~PluginScanner()
 {
     listeners.clear();
-    master = nullptr;
+    cancel();
+}
+
+int PluginScanner::getDefaultNumProcesses()
+{
+    return jlimit (1, 8, SystemStats::getNumCpus() / 2);
+}
+
+void PluginScanner::setNumProcesses (int newNumProcesses)
+{
+    numProcesses = jlimit (1, 32, newNumProcesses);
+}
+
+void PluginScanner::setPluginTimeout (int milliseconds)
+{
+    pluginTimeout = jmax (1000, milliseconds);
 }
 
 void PluginScanner::cancel()
 {
-    if (master)
-    {
-        master->cancelPendingUpdate();
-        master->sendQuitMessage();
-		master = nullptr;
-    }
+    stopTimer();
+    for (auto* master : masters)
+        master->send ("quit", String());
+    masters.clear();
+    pending.clearQuick();
 }
 
-bool PluginScanner::isScanning() const { return master && master->isRunning(); }
+bool PluginScanner::isScanning() const { return ! masters.isEmpty(); }
 
 void PluginScanner::scanForAudioPlugins (const juce::String &formatName)
 {
@@ -445,15 +338,237 @@ void PluginScanner::scanForAudioPlugins (const StringArray& formats)
 {
     cancel();
     getSlavePluginListFile().deleteFile();
-	if (master == nullptr)
-		master = new PluginScannerMaster (*this);
-	if (master->isRunning())
-		return;
-    master->startScanning (formats);
+
+    formatsToScan = formats;
+    cache.load();
+    failedIdentifiers.clearQuick();
+    listed = listRequested = false;
+    numListAttempts = numToScan = numScanned = 0;
+
+    for (int i = 0; i < numProcesses; ++i)
+    {
+        std::unique_ptr<PluginScannerMaster> master (new PluginScannerMaster());
+        if (master->launch())
+            masters.add (master.release());
+    }
+
+    if (masters.isEmpty())
+    {
+        DBG("[EL] couldn't launch a plugin scanner");
+        finishScanning();
+        return;
+    }
+
+    startTimer (50);
 }
 
 void PluginScanner::timerCallback()
 {
+    StringArray messages;
+
+    for (auto* master : masters)
+    {
+        const bool lost = master->takeMessages (messages);
+        for (const auto& message : messages)
+            handleMessage (*master, message);
+
+        // a plugin that hangs its scanner is treated like one that crashed it
+        const bool timedOut = master->work.isNotEmpty()
+            && Time::getMillisecondCounterHiRes() - master->workStarted > (double) pluginTimeout;
+        if (lost || timedOut)
+            handleLostScanner (*master);
+    }
+
+    dispatchWork();
+}
+
+void PluginScanner::handleMessage (PluginScannerMaster& master, const String& data)
+{
+    const auto type (data.upToFirstOccurrenceOf (":", false, false));
+    const auto message (data.fromFirstOccurrenceOf (":", false, false));
+
+    if (type == "state")
+    {
+        if (message.trim() == EL_PLUGIN_SCANNER_READY_ID)
+            master.ready = true;
+    }
+    else if (type == "removed")
+    {
+        for (const auto& line : StringArray::fromLines (message))
+        {
+            const auto file = line.fromFirstOccurrenceOf ("\t", false, false);
+            if (file.isEmpty())
+                continue;
+            removeTypesForFile (file);
+            list.removeFromBlacklist (file);
+            cache.remove (file);
+        }
+    }
+    else if (type == "unchanged")
+    {
+        for (const auto& line : StringArray::fromLines (message))
+            if (line.containsChar ('\t'))
+                cache.update (line.upToFirstOccurrenceOf ("\t", false, false),
+                              line.fromFirstOccurrenceOf ("\t", false, false));
+    }
+    else if (type == "files")
+    {
+        for (const auto& line : StringArray::fromLines (message))
+            if (line.containsChar ('\t'))
+                pending.add (line);
+        numToScan = pending.size();
+        listed = true;
+        master.work = String();
+    }
+    else if (type == "name")
+    {
+        listeners.call (&PluginScanner::Listener::audioPluginScanStarted, message.trim());
+    }
+    else if (type == "types")
+    {
+        // merged as they arrive, so finished plugins show up mid-scan
+        KnownPluginList found;
+        if (auto xml = XmlDocument::parse (message))
+            found.recreateFromXml (*xml);
+
+        // a changed file may no longer have all the types it used to
+        removeTypesForFile (master.work.fromFirstOccurrenceOf ("\t", false, false).trim());
+        for (const auto& desc : found.getTypes())
+            list.addType (desc);
+    }
+    else if (type == "failed" || type == "done")
+    {
+        if (type == "failed")
+        {
+            removeTypesForFile (message.trim());
+            list.addToBlacklist (message.trim());
+            failedIdentifiers.addIfNotAlreadyThere (message.trim());
+        }
+        else
+        {
+            list.removeFromBlacklist (message.trim());
+        }
+
+        // failures are remembered too, so they're only retried once they change
+        updateCache (master.work);
+        master.work = String();
+        ++numScanned;
+        listeners.call (&PluginScanner::Listener::audioPluginScanProgress,
+                        (float) numScanned / (float) jmax (1, numToScan));
+    }
+}
+
+void PluginScanner::handleLostScanner (PluginScannerMaster& master)
+{
+    if (master.work == "list")
+    {
+        DBG("[EL] plugin scanner was lost listing files");
+        listRequested = false;
+        if (++numListAttempts >= 2)
+            listed = true;
+    }
+    else if (master.work.isNotEmpty())
+    {
+        // the file being scanned is the one to blame
+        const auto file = master.work.fromFirstOccurrenceOf ("\t", false, false).trim();
+        DBG("[EL] a plugin crashed or timed out during scan: " << file);
+        removeTypesForFile (file);
+        list.addToBlacklist (file);
+        failedIdentifiers.addIfNotAlreadyThere (file);
+        updateCache (master.work);
+        ++numScanned;
+    }
+
+    master.work = String();
+    master.ready = false;
+    if (! listed || ! pending.isEmpty())
+    {
+        master.launch();
+    }
+    else
+    {
+        master.killSlaveProcess();
+        master.running = false;
+    }
+}
+
+void PluginScanner::dispatchWork()
+{
+    bool busy = false, running = false;
+
+    for (auto* master : masters)
+    {
+        running |= master->running;
+        if (master->work.isNotEmpty())
+        {
+            busy = true;
+            continue;
+        }
+
+        if (! master->ready)
+            continue;
+
+        String next;
+        if (! listed)
+        {
+            if (listRequested)
+                continue;
+            if (master->send ("list", formatsToScan.joinIntoString (",")))
+            {
+                listRequested = true;
+                master->work = "list";
+            }
+        }
+        else if (! pending.isEmpty())
+        {
+            next = pending[0];
+            if (master->send ("file", next))
+            {
+                pending.remove (0);
+                master->work = next;
+            }
+        }
+
+        if (master->work.isNotEmpty())
+        {
+            master->workStarted = Time::getMillisecondCounterHiRes();
+            busy = true;
+        }
+    }
+
+    // everything's scanned, or no scanner could be relaunched
+    if ((listed && pending.isEmpty() && ! busy) || ! running)
+        finishScanning();
+}
+
+void PluginScanner::updateCache (const String& work)
+{
+    if (work.containsChar ('\t'))
+        cache.update (work.upToFirstOccurrenceOf ("\t", false, false),
+                      work.fromFirstOccurrenceOf ("\t", false, false).trim());
+}
+
+void PluginScanner::removeTypesForFile (const String& file)
+{
+    if (file.isEmpty())
+        return;
+    for (const auto& type : list.getTypes())
+        if (type.fileOrIdentifier == file)
+            list.removeType (type);
+}
+
+void PluginScanner::finishScanning()
+{
+    cancel();
+    cache.save();
+
+    // the plugin manager restores the whole list from here when it's told
+    const auto& file = getSlavePluginListFile();
+    file.getParentDirectory().createDirectory();
+    if (auto xml = list.createXml())
+        xml->writeToFile (file, String());
+
+    listeners.call (&PluginScanner::Listener::audioPluginScanFinished);
 }
 
 // MARK: Unverified Plugins
@@ -521,6 +636,7 @@ private:
 
     void run() override
     {
+        RealtimeThreads::applyBackgroundAffinity();
         cancelFlag.set (0);
 
         PluginManager pluginManager;
@@ -545,6 +661,172 @@ private:
     }
 };
 
+// MARK: Plugin Instantiator
+
+/** Creates plugins without holding up the message thread for longer than one
+    plugin at a time. Formats whose plugins can be loaded from any thread are
+    created on a worker, the rest are queued and created on the message thread
+    one per callback, so the UI keeps running in between. Results are always
+    delivered on the message thread */
+class PluginInstantiator : private AsyncUpdater,
+                           private Thread
+{
+public:
+    using Callback = PluginManager::PluginCreationCallback;
+
+    PluginInstantiator (AudioPluginFormatManager& f, PluginBridge& b, CriticalSection& l)
+        : Thread ("Plugin Instantiator"), formats (f), bridge (b), creationLock (l) { }
+
+    ~PluginInstantiator()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (10000);
+        cancelPendingUpdate();
+    }
+
+    /** Formats whose plugins may be instantiated off the message thread. LV2
+        puts instantiation in its own threading class, while VST and AU plugins
+        commonly set up their own message loops when created */
+    static bool canCreateOnWorker (const AudioPluginFormat& format)
+    {
+        return format.getName() == "LV2";
+    }
+
+    void create (const PluginDescription& desc, double sampleRate, int blockSize, Callback callback,
+                 const String& bridgeGroup = String())
+    {
+        std::unique_ptr<Job> job (new Job());
+        job->desc = desc;
+        job->sampleRate = sampleRate;
+        job->blockSize = blockSize;
+        job->callback = callback;
+        job->bridgeGroup = bridgeGroup;
+
+        String error;
+        auto* format = formats.findFormatForDescription (desc, error);
+        if (bridgeGroup.isEmpty() && format != nullptr
+            && format->requiresUnblockedMessageThreadDuringCreation (desc))
+        {
+            formats.createPluginInstanceAsync (desc, sampleRate, blockSize,
+                [callback] (std::unique_ptr<AudioPluginInstance> instance, const String& message) {
+                    callback (std::move (instance), message);
+                });
+            return;
+        }
+
+        ScopedLock sl (lock);
+        // bridged plugins only wait on their host process here
+        if (bridgeGroup.isNotEmpty() || (format != nullptr && canCreateOnWorker (*format)))
+        {
+            workerJobs.add (job.release());
+            if (! isThreadRunning())
+                startThread (3);
+            notify();
+        }
+        else
+        {
+            messageThreadJobs.add (job.release());
+            triggerAsyncUpdate();
+        }
+    }
+
+    /** Hands an existing instance to a callback as if it had just been created */
+    void deliver (std::unique_ptr<AudioPluginInstance> instance, Callback callback)
+    {
+        std::unique_ptr<Job> job (new Job());
+        job->instance = std::move (instance);
+        job->callback = callback;
+        ScopedLock sl (lock);
+        finished.add (job.release());
+        triggerAsyncUpdate();
+    }
+
+private:
+    struct Job
+    {
+        PluginDescription desc;
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        Callback callback;
+        String bridgeGroup;
+        std::unique_ptr<AudioPluginInstance> instance;
+        String error;
+    };
+
+    AudioPluginFormatManager& formats;
+    PluginBridge& bridge;
+    CriticalSection& creationLock;
+    CriticalSection lock;
+    OwnedArray<Job> workerJobs, messageThreadJobs, finished;
+
+    void instantiate (Job& job)
+    {
+        if (job.bridgeGroup.isNotEmpty())
+        {
+            job.instance.reset (bridge.createInstance (job.desc, job.bridgeGroup, job.sampleRate,
+                                                       job.blockSize, job.error));
+            return;
+        }
+
+        // never at the same time as another plugin, formats keep module lists
+        // which aren't safe to touch from two threads
+        ScopedLock sl (creationLock);
+        job.instance = formats.createPluginInstance (job.desc, job.sampleRate,
+                                                     job.blockSize, job.error);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            std::unique_ptr<Job> job;
+            {
+                ScopedLock sl (lock);
+                if (! workerJobs.isEmpty())
+                    job.reset (workerJobs.removeAndReturn (0));
+            }
+
+            if (job == nullptr)
+            {
+                wait (-1);
+                continue;
+            }
+
+            instantiate (*job);
+            ScopedLock sl (lock);
+            finished.add (job.release());
+            triggerAsyncUpdate();
+        }
+    }
+
+    void handleAsyncUpdate() override
+    {
+        OwnedArray<Job> toDeliver;
+        std::unique_ptr<Job> next;
+        {
+            ScopedLock sl (lock);
+            toDeliver.swapWith (finished);
+            if (! messageThreadJobs.isEmpty())
+                next.reset (messageThreadJobs.removeAndReturn (0));
+        }
+
+        if (next != nullptr)
+        {
+            instantiate (*next);
+            toDeliver.add (next.release());
+        }
+
+        for (auto* job : toDeliver)
+            job->callback (std::move (job->instance), job->error);
+
+        // one plugin per callback, whatever the UI has queued meanwhile goes first
+        ScopedLock sl (lock);
+        if (! messageThreadJobs.isEmpty() || ! finished.isEmpty())
+            triggerAsyncUpdate();
+    }
+};
+
 // MARK: Plugin Manager
     
 class PluginManager::Private : public PluginScanner::Listener
@@ -588,15 +870,24 @@ private:
 	friend class PluginManager;
 	PluginManager& owner;
 	AudioPluginFormatManager formats;
-	KnownPluginList allPlugins;
+    SharedResourcePointer<SharedPluginList> shared;
+    KnownPluginList& allPlugins { shared->getList() };
 	File deadAudioPlugins;
     UnverifiedPlugins unverified;
 	double sampleRate = 44100.0;
 	int    blockSize = 512;
 	ScopedPointer<PluginScanner> scanner;
+	CriticalSection creationLock;
+	PluginInstancePool pool;
+	PluginBridge bridge;
+	std::unique_ptr<PluginInstantiator> instantiator; // after formats, the pool and the bridge, so it goes first
 
 	void scanAudioPlugins (const StringArray& names)
 	{
+        // another manager in the process is already scanning into the list
+        if (! shared->beginScan (&owner))
+            return;
+
 		if (scanner)
 		{
 			scanner->removeListener (this);
@@ -610,7 +901,7 @@ private:
 				if (formats.getFormat(i)->getName() != "Element" && formats.getFormat(i)->canScanForPlugins())
 					formatsToScan.add(formats.getFormat(i)->getName());
 
-		scanner = new PluginScanner (allPlugins);
+		scanner = owner.createAudioPluginScanner();
 		scanner->addListener (this);
 		scanner->scanForAudioPlugins (formatsToScan);
 	}
@@ -653,10 +944,12 @@ private:
 PluginManager::PluginManager()
 {
     priv = new Private (*this);
+    priv->shared->addManager (this);
 }
 
 PluginManager::~PluginManager()
 {
+    priv->shared->removeManager (this);
     priv = nullptr;
 }
 
@@ -699,6 +992,9 @@ kv::ChildProcessSlave* PluginManager::createAudioPluginScannerSlave()
 PluginScanner* PluginManager::createAudioPluginScanner()
 {
     auto* scanner = new PluginScanner (getKnownPlugins());
+    if (props != nullptr)
+        scanner->setNumProcesses (props->getIntValue (Settings::pluginScanProcessesKey,
+                                                      PluginScanner::getDefaultNumProcesses()));
     return scanner;
 }
 
@@ -714,16 +1010,101 @@ PluginScanner* PluginManager::getBackgroundAudioPluginScanner()
 
 bool PluginManager::isScanningAudioPlugins()
 {
-    return (priv && priv->scanner) ? priv->scanner->isScanning()
-                                   : false;
+    if (! priv)
+        return false;
+    if (priv->scanner)
+        return priv->scanner->isScanning();
+
+    auto* other = priv->shared->getScanningManager();
+    return other != nullptr && other != this && other->isScanningAudioPlugins();
 }
 
 AudioPluginInstance* PluginManager::createAudioPlugin (const PluginDescription& desc, String& errorMsg)
 {
+    if (auto* pooled = priv->pool.take (desc))
+        return pooled;
+
+    ScopedLock sl (priv->creationLock);
     return getAudioPluginFormats().createPluginInstance (
         desc, priv->sampleRate, priv->blockSize, errorMsg).release();
 }
 
+void PluginManager::createAudioPluginAsync (const PluginDescription& desc, PluginCreationCallback callback,
+                                            const String& bridgeGroup)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    if (priv->instantiator == nullptr)
+        priv->instantiator.reset (new PluginInstantiator (getAudioPluginFormats(), priv->bridge,
+                                                          priv->creationLock));
+
+    std::unique_ptr<AudioPluginInstance> pooled (bridgeGroup.isEmpty() ? priv->pool.take (desc) : nullptr);
+    if (pooled != nullptr)
+    {
+        priv->instantiator->deliver (std::move (pooled), callback);
+        return;
+    }
+
+    priv->instantiator->create (desc, priv->sampleRate, priv->blockSize, callback, bridgeGroup);
+}
+
+AudioPluginInstance* PluginManager::createBridgedPlugin (const PluginDescription& desc, const String& group,
+                                                         String& errorMsg)
+{
+    jassert (group.isNotEmpty());
+    return priv->bridge.createInstance (desc, group, priv->sampleRate, priv->blockSize, errorMsg);
+}
+
+void PluginManager::shutdownPluginHosts()
+{
+    priv->bridge.shutdown();
+}
+
+kv::ChildProcessSlave* PluginManager::createPluginHostSlave()
+{
+    return PluginBridge::createHostSlave();
+}
+
+void PluginManager::makeReusable (GraphNode& node)
+{
+    auto* const apNode = dynamic_cast<AudioProcessorNode*> (&node);
+    auto* const instance = dynamic_cast<AudioPluginInstance*> (node.getAudioProcessor());
+    if (apNode == nullptr || instance == nullptr || PluginBridge::isBridged (instance))
+        return;
+
+    // internal processors are cheap to create and some hold on to their graph
+    const auto format = instance->getPluginDescription().pluginFormatName;
+    if (format == EL_INTERNAL_FORMAT_NAME || format == "Internal")
+        return;
+
+    const int defaultBudget = PluginInstancePool::getDefaultMemoryBudget();
+    const int budget = props != nullptr ? props->getIntValue (Settings::pluginPoolBudgetKey, defaultBudget)
+                                        : defaultBudget;
+    priv->pool.setMemoryBudget ((int64) jmax (0, budget) * 1024 * 1024);
+
+    MemoryBlock initialState;
+    instance->getStateInformation (initialState);
+    WeakReference<PluginInstancePool> pool (&priv->pool);
+    apNode->setProcessorReleaser ([pool, initialState] (AudioProcessor* processor)
+    {
+        auto* const released = dynamic_cast<AudioPluginInstance*> (processor);
+        auto* const p = pool.get();
+        if (released != nullptr && p != nullptr && p->getMemoryBudget() > 0)
+            p->park (released, initialState);
+        else
+            delete processor;
+    });
+}
+
+void PluginManager::clearInstancePool()
+{
+    priv->pool.clear();
+}
+
+bool PluginManager::isLazyNodeLoadingEnabled() const
+{
+    return props != nullptr && props->getBoolValue (Settings::lazyNodeLoadingKey, false);
+}
+
 Processor* PluginManager::createPlugin (const PluginDescription &desc, String &errorMsg)
 {
     jassertfalse; // deprecated
@@ -805,19 +1186,34 @@ const File& PluginManager::getDeadAudioPluginsFile() const { return priv->deadAu
 void PluginManager::saveUserPlugins (ApplicationProperties& settings)
 {
     setPropertiesFile (settings.getUserSettings());
-    if (auto elm = priv->allPlugins.createXml())
-    {
-        props->setValue (pluginListKey(), elm.get());
-        props->saveIfNeeded();
-    }
+    writeCatalog();
 }
 
 void PluginManager::restoreUserPlugins (ApplicationProperties& settings)
 {
     setPropertiesFile (settings.getUserSettings());
-    if (props == nullptr) return;
-    if (auto xml = props->getXmlValue (pluginListKey()))
-		restoreUserPlugins (*xml);
+
+    // managers after the first use the list it read, and any scans since
+    if (! priv->shared->needsRestore (PluginCatalog::getDefaultFile()))
+        return;
+
+    PluginCatalog catalog;
+    if (catalog.open (PluginCatalog::getDefaultFile()))
+    {
+        catalog.restoreInto (priv->allPlugins);
+        catalog.close();
+        priv->shared->markRestored (PluginCatalog::getDefaultFile());
+        const bool internalsChanged = scanInternalPlugins();
+        if (priv->updateBlacklistedAudioPlugins() || internalsChanged)
+            writeCatalog();
+    }
+    else if (props != nullptr)
+    {
+        // lists from before the catalog existed are imported once
+        if (auto xml = props->getXmlValue (pluginListKey()))
+            restoreUserPlugins (*xml);
+    }
+
     settings.saveIfNeeded();
 }
 
@@ -829,9 +1225,23 @@ void PluginManager::restoreUserPlugins (const XmlElement& xml)
     if (props == nullptr)
         return;
 
-    if (auto e = priv->allPlugins.createXml())
+    writeCatalog();
+}
+
+void PluginManager::writeCatalog()
+{
+    if (! PluginCatalog::write (priv->allPlugins, PluginCatalog::getDefaultFile()))
     {
-        props->setValue (pluginListKey(), e.get());
+        DBG("[EL] couldn't write the plugin catalog");
+        return;
+    }
+
+    priv->shared->markRestored (PluginCatalog::getDefaultFile());
+
+    // the catalog replaces the list in the settings, which are parsed whole on startup
+    if (props != nullptr && props->containsKey (pluginListKey()))
+    {
+        props->removeValue (pluginListKey());
         props->saveIfNeeded();
     }
 }
@@ -840,6 +1250,7 @@ void PluginManager::setPlayConfig (double sampleRate, int blockSize)
 {
     priv->sampleRate = sampleRate;
     priv->blockSize  = blockSize;
+    priv->pool.setPlayConfig (sampleRate, blockSize);
 }
 
 void PluginManager::scanAudioPlugins (const StringArray& names)
@@ -855,32 +1266,43 @@ void PluginManager::scanAudioPlugins (const StringArray& names)
 
 String PluginManager::getCurrentlyScannedPluginName() const
 {
-	return (priv) ? priv->getScannedPluginName() : String();
+    if (! priv)
+        return String();
+
+    auto* other = priv->shared->getScanningManager();
+    return other != nullptr && other != this ? other->getCurrentlyScannedPluginName()
+                                             : priv->getScannedPluginName();
 }
 
-void PluginManager::scanInternalPlugins()
+bool PluginManager::scanInternalPlugins()
 {
     auto& manager = getAudioPluginFormats();
     for (int i = 0; i < manager.getNumFormats(); ++i)
     {
-        auto* format = manager.getFormat (i);
-        
-        if (format->getName() != "Element")
+        auto* format = dynamic_cast<ElementAudioPluginFormat*> (manager.getFormat (i));
+        if (format == nullptr)
             continue;
         
-        const auto types = priv->allPlugins.getTypesForFormat (*format);
-        for (const auto& t : types)
-            priv->allPlugins.removeType(t);;
-        
-        PluginDirectoryScanner scanner (getKnownPlugins(), *format,
-                                        format->getDefaultLocationsToSearch(),
-                                        true, priv->deadAudioPlugins, false);
-        
-        String name;
-        while (scanner.scanNextFile (true, name)) {}
-        
-        break;
+        // the list was stamped when the types were last registered, a
+        // matching stamp means they're all there and nothing is built
+        const auto version = format->getTypesVersion();
+        const auto current = priv->allPlugins.getTypesForFormat (*format);
+        const auto numIdentifiers = format->searchPathsForPlugins (FileSearchPath(), false, false).size();
+        if (props != nullptr && current.size() == numIdentifiers
+            && props->getValue (Settings::internalPluginsVersionKey) == version)
+            return false;
+
+        for (const auto& t : current)
+            priv->allPlugins.removeType (t);
+        for (const auto* type : format->getTypes())
+            priv->allPlugins.addType (*type);
+
+        if (props != nullptr)
+            props->setValue (Settings::internalPluginsVersionKey, version);
+        return true;
     }
+
+    return false;
 }
 
 void PluginManager::getUnverifiedPlugins (const String& formatName, OwnedArray<PluginDescription>& plugins)
@@ -896,7 +1318,7 @@ void PluginManager::scanFinished()
     if (auto* scanner = getBackgroundAudioPluginScanner())
         scanner->cancel();
     jassert(! isScanningAudioPlugins());
-    sendChangeMessage();
+    priv->shared->endScan (this);
 }
 
 void PluginManager::restoreAudioPlugins (const File& file)
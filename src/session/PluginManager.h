@@ -20,6 +20,7 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "session/PluginScanCache.h"
 
 #define EL_PLUGIN_SCANNER_PROCESS_ID    "pspelbg"
 
@@ -71,6 +72,9 @@ public:
     
     /** creates a child process slave used in start up */
     kv::ChildProcessSlave* createAudioPluginScannerSlave();
+
+    /** Creates the child process object that hosts bridged plugins */
+    kv::ChildProcessSlave* createPluginHostSlave();
     
     /** creates a new plugin scanner for use by a third party, e.g. plugin manager UI */
     PluginScanner* createAudioPluginScanner();
@@ -88,10 +92,12 @@ public:
 	    is not suitable for use in loading plugins */
 	String getCurrentlyScannedPluginName() const;
 
-    /** Looks for new or updated internal/element plugins */
-    void scanInternalPlugins();
+    /** Registers the internal/element plugins. Nothing is done when the
+        known plugins were already stamped with the current table's version.
+        Returns true if the list changed */
+    bool scanInternalPlugins();
     
-    /** Save the known plugins to user settings */
+    /** Save the known plugins to the user's plugin catalog */
     void saveUserPlugins (ApplicationProperties&);
     
     /** Restore user plugins. Will also scan internal plugins so they don't get removed
@@ -103,9 +109,39 @@ public:
     void restoreUserPlugins (const XmlElement& xml);
 
     AudioPluginInstance* createAudioPlugin (const PluginDescription& desc, String& errorMsg);
+
+    /** Called on the message thread with a new plugin instance, or a null one
+        and an error message */
+    using PluginCreationCallback = std::function<void (std::unique_ptr<AudioPluginInstance>, const String&)>;
+
+    /** Instantiates a plugin without blocking the message thread for longer than
+        it takes to create it. The callback is never called from in here. With a
+        bridge group the plugin is loaded in that group's host process */
+    void createAudioPluginAsync (const PluginDescription& desc, PluginCreationCallback callback,
+                                 const String& bridgeGroup = String());
+
+    /** Loads a plugin in the host process of a group, see PluginBridge. Blocks
+        until it's loaded */
+    AudioPluginInstance* createBridgedPlugin (const PluginDescription& desc, const String& group,
+                                              String& errorMsg);
+
+    /** Stops the processes hosting bridged plugins */
+    void shutdownPluginHosts();
     Processor *createPlugin (const PluginDescription& desc, String& errorMsg);
     GraphNode* createGraphNode (const PluginDescription& desc, String& errorMsg);
 
+    /** Has a node park its plugin in the instance pool when it's deleted, to be
+        handed out again the next time the plugin is created. Call this right
+        after creating the node, before any saved state is restored into it */
+    void makeReusable (GraphNode& node);
+
+    /** Deletes the plugins kept for reuse */
+    void clearInstancePool();
+
+    /** Returns true if disabled and bypassed plugins should be left as
+        placeholders when a graph loads, and only created once switched on */
+    bool isLazyNodeLoadingEnabled() const;
+
     /** Set the play config used when instantiating plugins */
     void setPlayConfig (double sampleRate, int blockSize);
 
@@ -131,6 +167,7 @@ private:
     
     friend class PluginScannerMaster;
     void scanFinished();
+    void writeCatalog();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginManager);
 };
@@ -152,7 +189,19 @@ public:
         virtual void audioPluginScanStarted (const String& name) { }
     };
     
+    /** The full list is written here when a scan finishes */
     static const File& getSlavePluginListFile();
+
+    /** Returns the number of scanner processes used by default, half the CPUs up to 8 */
+    static int getDefaultNumProcesses();
+
+    /** Sets how many scanner processes share the files of the next scan */
+    void setNumProcesses (int numProcesses);
+    int getNumProcesses() const noexcept { return numProcesses; }
+
+    /** Sets how long one plugin file may take to scan before its process is
+        killed and the file blacklisted */
+    void setPluginTimeout (int milliseconds);
     
     /** scan for plugins of type */
     void scanForAudioPlugins (const String& formatName);
@@ -178,11 +227,26 @@ public:
 private:
     friend class PluginScannerMaster;
     friend class Timer;
-    ScopedPointer<PluginScannerMaster> master;
+    OwnedArray<PluginScannerMaster> masters;
     ListenerList<Listener> listeners;
     StringArray failedIdentifiers;
     KnownPluginList& list;
+    PluginScanCache cache;
+
+    StringArray formatsToScan;
+    StringArray pending;            ///< "format<tab>file" waiting for a scanner
+    bool listed = false, listRequested = false;
+    int numListAttempts = 0, numToScan = 0, numScanned = 0;
+    int numProcesses = getDefaultNumProcesses();
+    int pluginTimeout = 60000;
+
     void timerCallback() override;
+    void handleMessage (PluginScannerMaster&, const String&);
+    void handleLostScanner (PluginScannerMaster&);
+    void dispatchWork();
+    void updateCache (const String& work);
+    void removeTypesForFile (const String& file);
+    void finishScanning();
 };
 
 }
@@ -0,0 +1,201 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/PluginScanCache.h"
+#include "DataPath.h"
+
+#define EL_PLUGIN_SCAN_CACHE_FILENAME   "PluginScanCache.xml"
+
+namespace Element {
+
+/* How much of each end of a binary goes into its hash. Enough to catch a
+   rebuilt plugin without reading hundreds of megabytes of samples */
+static const int64 hashedBytes = 64 * 1024;
+
+static void hashFileEnds (MemoryOutputStream& out, const File& file)
+{
+    FileInputStream in (file);
+    if (in.failedToOpen())
+        return;
+
+    const auto length = in.getTotalLength();
+    out.writeFromInputStream (in, hashedBytes);
+    if (length > hashedBytes * 2)
+    {
+        in.setPosition (length - hashedBytes);
+        out.writeFromInputStream (in, hashedBytes);
+    }
+}
+
+PluginScanCache::Fingerprint PluginScanCache::Fingerprint::forFile (const String& fileOrIdentifier)
+{
+    Fingerprint fp;
+    if (! File::isAbsolutePath (fileOrIdentifier))
+        return fp;
+
+    const File file (fileOrIdentifier);
+    MemoryOutputStream data;
+
+    if (file.existsAsFile())
+    {
+        fp.size = file.getSize();
+        fp.modified = file.getLastModificationTime().toMilliseconds();
+        data.writeInt64 (fp.size);
+        hashFileEnds (data, file);
+    }
+    else if (file.isDirectory())
+    {
+        // bundles change when anything inside them does
+        Array<File> children;
+        file.findChildFiles (children, File::findFiles, true);
+        StringArray paths;
+        for (const auto& child : children)
+            paths.add (child.getRelativePathFrom (file));
+        paths.sort (false);
+
+        for (const auto& path : paths)
+        {
+            const auto child = file.getChildFile (path);
+            const auto modified = child.getLastModificationTime().toMilliseconds();
+            fp.size += child.getSize();
+            fp.modified = jmax (fp.modified, modified);
+            data << path;
+            data.writeInt64 (child.getSize());
+            data.writeInt64 (modified);
+        }
+    }
+    else
+    {
+        return fp;
+    }
+
+    fp.hash = MD5 (data.getData(), data.getDataSize()).toHexString();
+    return fp;
+}
+
+//=============================================================================
+
+PluginScanCache::PluginScanCache() { }
+PluginScanCache::~PluginScanCache() { }
+
+File PluginScanCache::getDefaultFile()
+{
+    return DataPath::applicationDataDir().getChildFile (EL_PLUGIN_SCAN_CACHE_FILENAME);
+}
+
+bool PluginScanCache::load (const File& file)
+{
+    entries.clear();
+    if (auto xml = XmlDocument::parse (file))
+    {
+        restoreFromXml (*xml);
+        return true;
+    }
+    return false;
+}
+
+bool PluginScanCache::save (const File& file) const
+{
+    file.getParentDirectory().createDirectory();
+    if (auto xml = createXml())
+        return xml->writeToFile (file, String());
+    return false;
+}
+
+bool PluginScanCache::contains (const String& file) const
+{
+    return entries.contains (file);
+}
+
+bool PluginScanCache::isUpToDate (const String& file) const
+{
+    if (! entries.contains (file))
+        return false;
+    const auto current = Fingerprint::forFile (file);
+    return current.isValid() && current == entries [file].fingerprint;
+}
+
+void PluginScanCache::update (const String& format, const String& file)
+{
+    Entry entry;
+    entry.format = format;
+    entry.fingerprint = Fingerprint::forFile (file);
+    if (entry.fingerprint.isValid())
+        entries.set (file, entry);
+}
+
+void PluginScanCache::remove (const String& file)
+{
+    entries.remove (file);
+}
+
+StringArray PluginScanCache::findRemovedFiles (const String& format) const
+{
+    StringArray removed;
+    for (HashMap<String, Entry>::Iterator iter (entries); iter.next();)
+        if (iter.getValue().format == format && ! File (iter.getKey()).exists())
+            removed.add (iter.getKey());
+    return removed;
+}
+
+StringArray PluginScanCache::getFiles (const String& format) const
+{
+    StringArray files;
+    for (HashMap<String, Entry>::Iterator iter (entries); iter.next();)
+        if (iter.getValue().format == format)
+            files.add (iter.getKey());
+    return files;
+}
+
+std::unique_ptr<XmlElement> PluginScanCache::createXml() const
+{
+    std::unique_ptr<XmlElement> xml (new XmlElement ("PLUGINSCANCACHE"));
+    for (HashMap<String, Entry>::Iterator iter (entries); iter.next();)
+    {
+        const auto& entry = iter.getValue();
+        auto* e = xml->createNewChildElement ("FILE");
+        e->setAttribute ("path", iter.getKey());
+        e->setAttribute ("format", entry.format);
+        e->setAttribute ("size", String (entry.fingerprint.size));
+        e->setAttribute ("modified", String (entry.fingerprint.modified));
+        e->setAttribute ("hash", entry.fingerprint.hash);
+    }
+    return xml;
+}
+
+void PluginScanCache::restoreFromXml (const XmlElement& xml)
+{
+    entries.clear();
+    if (! xml.hasTagName ("PLUGINSCANCACHE"))
+        return;
+
+    forEachXmlChildElementWithTagName (xml, e, "FILE")
+    {
+        Entry entry;
+        entry.format = e->getStringAttribute ("format");
+        entry.fingerprint.size = e->getStringAttribute ("size").getLargeIntValue();
+        entry.fingerprint.modified = e->getStringAttribute ("modified").getLargeIntValue();
+        entry.fingerprint.hash = e->getStringAttribute ("hash");
+        const auto path = e->getStringAttribute ("path");
+        if (path.isNotEmpty() && entry.fingerprint.isValid())
+            entries.set (path, entry);
+    }
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Remembers what each plugin binary or bundle looked like when it was last
+    scanned, so a rescan only has to load the ones that changed.
+
+    Entries are keyed on the plugin's path and hold its size, modification time
+    and a hash. Identifiers that aren't files, e.g. LV2 URIs, have no
+    fingerprint and aren't cached.
+ */
+class PluginScanCache
+{
+public:
+    struct Fingerprint
+    {
+        int64 size = 0;
+        int64 modified = 0;     ///< milliseconds since the epoch
+        String hash;
+
+        /** Fingerprints a plugin file, or every file in a bundle. Returns an
+            invalid fingerprint if the identifier isn't an existing file */
+        static Fingerprint forFile (const String& fileOrIdentifier);
+
+        bool isValid() const noexcept { return hash.isNotEmpty(); }
+        bool operator== (const Fingerprint& o) const noexcept
+        {
+            return size == o.size && modified == o.modified && hash == o.hash;
+        }
+        bool operator!= (const Fingerprint& o) const noexcept { return ! operator== (o); }
+    };
+
+    PluginScanCache();
+    ~PluginScanCache();
+
+    /** Returns the file the cache is kept in by default */
+    static File getDefaultFile();
+
+    /** Loads entries from a file, replacing the current ones */
+    bool load (const File& file = getDefaultFile());
+
+    /** Writes the entries to a file */
+    bool save (const File& file = getDefaultFile()) const;
+
+    /** Returns true if the cache has an entry for this file */
+    bool contains (const String& file) const;
+
+    /** Returns true if the file has been fingerprinted and hasn't changed since */
+    bool isUpToDate (const String& file) const;
+
+    /** Records the file as it is now. Does nothing if it can't be fingerprinted */
+    void update (const String& format, const String& file);
+
+    /** Forgets a file */
+    void remove (const String& file);
+
+    /** Returns the cached files of a format that no longer exist */
+    StringArray findRemovedFiles (const String& format) const;
+
+    /** Returns the cached files of a format */
+    StringArray getFiles (const String& format) const;
+
+    void clear() { entries.clear(); }
+    int size() const noexcept { return entries.size(); }
+
+    std::unique_ptr<XmlElement> createXml() const;
+    void restoreFromXml (const XmlElement&);
+
+private:
+    struct Entry
+    {
+        String format;
+        Fingerprint fingerprint;
+    };
+
+    HashMap<String, Entry> entries;
+};
+
+}
@@ -0,0 +1,148 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/Presets.h"
+
+namespace Element {
+
+PresetCollection::PresetCollection (Database& db)
+    : Thread ("el.presets"),
+      database (db)
+{
+    index->addChangeListener (this);
+}
+
+PresetCollection::~PresetCollection()
+{
+    index->removeChangeListener (this);
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+    cancelPendingUpdate();
+}
+
+void PresetCollection::refresh()
+{
+    StringArray filenames; path.findPresetFiles (filenames);
+    Array<File> files;
+    for (const auto& filename : filenames)
+        files.add (File (filename));
+
+    if (database.updateFiles (Database::preset, files))
+        database.save (Database::getDefaultFile());
+}
+
+void PresetCollection::refreshInBackground()
+{
+    // the first listing is done by the index too, which calls back when ready
+    const auto presetsDir = path.getRootDir().getChildFile ("Presets");
+    if (! index->isIndexed (presetsDir))
+    {
+        index->addDirectory (presetsDir);
+        return;
+    }
+
+    StringArray filenames; path.findPresetFiles (filenames);
+    Array<File> files;
+    for (const auto& filename : filenames)
+        files.add (File (filename));
+
+    if (database.removeMissingFiles (Database::preset, files))
+        database.save (Database::getDefaultFile());
+
+    const auto changed = database.findChangedFiles (Database::preset, files);
+    if (changed.isEmpty())
+        return;
+
+    {
+        const ScopedLock sl (lock);
+        toRead.addArray (changed);
+        reading = true;
+    }
+
+    if (! isThreadRunning())
+        startThread (2);
+    notify();
+}
+
+bool PresetCollection::isRefreshing() const
+{
+    const ScopedLock sl (lock);
+    return reading;
+}
+
+void PresetCollection::run()
+{
+    while (! threadShouldExit())
+    {
+        Array<File> files;
+        {
+            const ScopedLock sl (lock);
+            files.swapWith (toRead);
+            busy = files.size() > 0;
+        }
+
+        if (files.isEmpty())
+        {
+            wait (-1);
+            continue;
+        }
+
+        Array<Database::Record> records;
+        for (const auto& file : files)
+        {
+            if (threadShouldExit())
+                return;
+            Database::Record record;
+            Database::readFile (Database::preset, file, record);
+            records.add (record);
+        }
+
+        {
+            const ScopedLock sl (lock);
+            loaded.addArray (records);
+            busy = false;
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void PresetCollection::handleAsyncUpdate()
+{
+    Array<Database::Record> records;
+    {
+        const ScopedLock sl (lock);
+        records.swapWith (loaded);
+        reading = busy || toRead.size() > 0;
+    }
+
+    if (records.isEmpty())
+        return;
+
+    database.update (records);
+    database.save (Database::getDefaultFile());
+}
+
+void PresetCollection::changeListenerCallback (ChangeBroadcaster*)
+{
+    refreshInBackground();
+}
+
+}
@@ -21,6 +21,8 @@
 
 #include "ElementApp.h"
 #include "session/Node.h"
+#include "db/Database.h"
+#include "DataPath.h"
 
 namespace Element {
 
@@ -32,7 +34,16 @@ struct PresetDescription
     File file;
 };
 
-class PresetCollection
+/** The presets in the user's library, as recorded in the catalog.
+
+    Presets are looked up by the plugin they belong to without touching the
+    disk. Refreshing only reads the presets that are new or changed, either
+    here or on a background thread, and the collection refreshes itself in
+    the background whenever the file index sees the library change.
+ */
+class PresetCollection : private Thread,
+                         private AsyncUpdater,
+                         private ChangeListener
 {
 public:
     struct SortByName
@@ -49,20 +60,20 @@ public:
         }
     };
 
-    PresetCollection() { }
-    ~PresetCollection() { }
-
-    inline void clear()
-    {
-        presets.clear();
-    }
+    explicit PresetCollection (Database& db);
+    ~PresetCollection();
 
     inline void getPresetsFor (const Node& node, OwnedArray<PresetDescription>& results) const
     {
         SortByName sorter;
-        for (const auto* const preset : presets)
-            if (preset->identifier == node.getIdentifier().toString() && preset->format == node.getFormat().toString())
-                results.addSorted (sorter, new PresetDescription (*preset));
+        const auto format = node.getFormat().toString();
+        const auto identifier = node.getIdentifier().toString();
+        for (const auto id : database.find (Database::preset, format, identifier))
+        {
+            if (const auto* record = database.getRecord (id))
+                results.addSorted (sorter, new PresetDescription {
+                    record->name, record->identifier, record->format, record->file });
+        }
     }
 
     inline void addPresetFor (const Node& node, const String& name)
@@ -70,38 +81,31 @@ public:
         jassertfalse;
     }
 
-    inline void refresh()
-    {
-        clear();
-        
-        StringArray files; path.findPresetFiles (files);
-        for (const auto& filename : files)
-        {
-            const File file (filename);
-            const Node node (Node::parse (file), false);
-            if (node.isValid())
-            {
-                std::unique_ptr<PresetDescription> item;
-                item.reset (new PresetDescription());
-                item->file          = file;
-                item->name          = node.getName();
-                if (item->name.isEmpty())
-                    item->name = file.getFileNameWithoutExtension();
-                item->format        = node.getFormat();
-                item->identifier    = node.getIdentifier();
-                if (item->format.isEmpty() || item->identifier.isEmpty())
-                    continue;
-
-                presets.add (item.release());
-            }
-        }
+    /** Brings the catalog's presets in line with the presets directory */
+    void refresh();
 
-        presets.minimiseStorageOverheads();
-    }
+    /** Like refresh, but the presets that changed are read on a background
+        thread and recorded once they all have been */
+    void refreshInBackground();
+
+    /** Returns true while presets are being read in the background */
+    bool isRefreshing() const;
 
 private:
+    Database& database;
     DataPath path;
-    OwnedArray<PresetDescription> presets;
+    SharedResourcePointer<FileIndex> index;
+
+    CriticalSection lock;
+    Array<File> toRead;
+    Array<Database::Record> loaded;
+    bool reading = false, busy = false;
+
+    void run() override;
+    void handleAsyncUpdate() override;
+    void changeListenerCallback (ChangeBroadcaster*) override;
+
+    JUCE_DECLARE_NON_COPYABLE (PresetCollection)
 };
 
 }
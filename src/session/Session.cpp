@@ -18,9 +18,12 @@
 */
 
 #include "engine/AudioEngine.h"
+#include "engine/GraphProcessor.h"
 #include "engine/InternalFormat.h"
 #include "engine/Transport.h"
 #include "session/Node.h"
+#include "session/SessionIndex.h"
+#include "session/SessionReader.h"
 #include "MediaManager.h"
 #include "Globals.h"
 
@@ -28,31 +31,18 @@
 
 namespace Element {
 
-    static Node findNodeRecursive (const Node& start, const Uuid& uuid)
-    {
-        if (! uuid.isNull() && uuid == start.getUuid())
-            return start;
-
-        for (int i = start.getNumNodes(); --i >= 0;)
-        {
-            const auto node = findNodeRecursive (start.getNode(i), uuid);
-            if (node.isValid()) return node;
-        }
-
-        return Node();
-    }
-
     class Session::Private
     {
     public:
         Private (Session& s)
-            : session (s)
+            : session (s), index (new SessionIndex())
         { }
 
         ~Private() { }
     private:
         friend class Session;
         Session&                     session;
+        SessionIndex::Ptr            index;
     };
 
     Session::Session()
@@ -117,10 +107,15 @@ namespace Element {
     }
 
     std::unique_ptr<XmlElement> Session::createXml()
+    {
+        return createSnapshot().createXml();
+    }
+
+    ValueTree Session::createSnapshot() const
     {
         ValueTree saveData = objectData.createCopy();
         Node::sanitizeProperties (saveData, true);
-        return saveData.createXml();
+        return saveData;
     }
 
     void Session::setMissingProperties (bool resetExisting)
@@ -145,45 +140,97 @@ namespace Element {
         objectData.getOrCreateChildWithName (Tags::graphs, nullptr);
         objectData.getOrCreateChildWithName (Tags::controllers, nullptr);
         objectData.getOrCreateChildWithName (Tags::maps, nullptr);
+
+        // the tree may have been swapped for a loaded one
+        objectData.setProperty (Tags::sessionIndex, priv->index.get(), nullptr);
+        priv->index->invalidate();
     }
 
     Node Session::findNodeById (const Uuid& uuid)
     {
-        Node node;
+        return Node (priv->index->findNode (objectData, uuid.toString()), false);
+    }
 
-        for (int i = getNumGraphs(); --i >= 0;)
+    ControllerDevice Session::findControllerDeviceById (const Uuid& uuid)
+    {
+        return ControllerDevice (priv->index->findControllerDevice (objectData, uuid.toString()));
+    }
+
+    void Session::notifyChanged()
+    {
+        if (freezeChangeNotification)
         {
-            node = findNodeRecursive (getGraph (i), uuid);
-            if (node.isValid()) break;
+            if (batch != nullptr)
+                batch->changed = true;
+            return;
         }
 
-        return node;
+        sendChangeMessage();
     }
 
-    ControllerDevice Session::findControllerDeviceById (const Uuid& uuid)
+    void Session::Batch::defer (const void* key, std::function<void()> function)
+    {
+        if (keys.contains (key))
+            return;
+        keys.add (key);
+        deferred.add (function);
+    }
+
+    Session::Batch* Session::getBatchFor (const ValueTree& tree)
+    {
+        return dynamic_cast<Batch*> (tree.getRoot().getProperty (Tags::batch).getObject());
+    }
+
+    void Session::beginBatch()
     {
-        ControllerDevice device;
-        const auto controllerId = uuid.toString();
-        for (int i = getNumControllerDevices(); --i >= 0;)
+        if (batchDepth++ > 0)
+            return;
+
+        batch = new Batch();
+        forEach ([this] (const ValueTree& tree)
         {
-            device = getControllerDevice (i);
-            if (device.getUuidString() == controllerId)
-                return device;
-        }
-        return device;
+            if (! tree.hasType (Tags::node))
+                return;
+            GraphNodePtr obj = Node (tree, false).getGraphNode();
+            if (auto* graph = obj != nullptr ? dynamic_cast<GraphProcessor*> (obj->getAudioProcessor()) : nullptr)
+            {
+                graph->beginBatchUpdate();
+                batch->graphs.add (obj);
+            }
+        });
+
+        objectData.setProperty (Tags::batch, batch.get(), nullptr);
     }
 
-    void Session::notifyChanged()
+    void Session::endBatch()
     {
-        if (freezeChangeNotification)
+        jassert (batchDepth > 0);
+        if (batchDepth <= 0 || --batchDepth > 0)
             return;
-        sendChangeMessage();
+
+        Batch::Ptr finished = batch;
+        batch = nullptr;
+        objectData.removeProperty (Tags::batch, nullptr);
+
+        // a deferred sync may defer again, that runs straight away now
+        for (int i = 0; i < finished->deferred.size(); ++i)
+            finished->deferred.getReference (i)();
+        for (auto* obj : finished->graphs)
+            if (auto* graph = dynamic_cast<GraphProcessor*> (obj->getAudioProcessor()))
+                graph->endBatchUpdate();
+
+        if (finished->changed)
+            sendChangeMessage();
     }
     
     void Session::valueTreePropertyChanged (ValueTree& tree, const Identifier& property)
     {
-        if (property == Tags::object ||
-            (tree.hasType(Tags::node) && property == Tags::state))
+        if (property == Tags::uuid || property == Tags::id)
+            priv->index->invalidate();
+
+        if (property == Tags::object || property == Tags::archive || property == Tags::batch ||
+            property == Tags::sessionIndex ||
+            (tree.hasType(Tags::node) && (property == Tags::state || property == Tags::stateChunk)))
         {
             return;
         }
@@ -197,6 +244,8 @@ namespace Element {
 
     void Session::valueTreeChildAdded (ValueTree& parent, ValueTree& child)
     {
+        priv->index->treeAdded (child);
+
         // controller device added
         if (parent.getParent() == objectData && 
             parent.hasType (Tags::controllers) && 
@@ -221,6 +270,8 @@ namespace Element {
 
     void Session::valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int)
     {
+        priv->index->treeRemoved (parent, child);
+
         // controller device removed
         if (parent.getParent() == objectData && 
             parent.hasType (Tags::controllers) && 
@@ -245,7 +296,11 @@ namespace Element {
 
     void Session::valueTreeChildOrderChanged (ValueTree& parent, int, int) {  }
     void Session::valueTreeParentChanged (ValueTree& tree) { }
-    void Session::valueTreeRedirected (ValueTree& tree) { }
+    void Session::valueTreeRedirected (ValueTree& tree)
+    {
+        ignoreUnused (tree);
+        priv->index->invalidate();
+    }
     
     void Session::saveGraphState()
     {
@@ -331,7 +386,8 @@ namespace Element {
         
         {
             GZIPDecompressorInputStream gzip (fi);
-            data = ValueTree::readFromStream (gzip);
+            SessionReader reader;
+            data = reader.read (gzip);
         }
 
         return data;
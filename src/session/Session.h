@@ -55,6 +55,49 @@ namespace Element {
             bool wasFrozen;
         };
 
+        /** Held on the session's root as the batch property while edits are
+            being batched. */
+        class Batch : public ReferenceCountedObject
+        {
+        public:
+            using Ptr = ReferenceCountedObjectPtr<Batch>;
+
+            /** Has a function called when the batch ends. Only the first
+                function deferred for a key is kept, so repeated updates of
+                the same thing are applied once */
+            void defer (const void* key, std::function<void()> function);
+
+        private:
+            friend class Session;
+            ReferenceCountedArray<GraphNode> graphs;
+            Array<const void*> keys;
+            Array<std::function<void()>> deferred;
+            bool changed = false;
+        };
+
+        /** Groups model edits so the engine takes them in one go.
+
+            Notifications are frozen as with ScopedFrozenLock. Rebuilds of the
+            session's graphs are held and syncs deferred with the Batch run
+            when the outermost batch ends, followed by a single change
+            message if anything changed meanwhile.
+         */
+        struct ScopedBatch : public ScopedFrozenLock
+        {
+            ScopedBatch (Session& s) : ScopedFrozenLock (s), owner (s) { owner.beginBatch(); }
+            ~ScopedBatch() { owner.endBatch(); }
+
+        private:
+            Session& owner;
+            JUCE_DECLARE_NON_COPYABLE (ScopedBatch)
+        };
+
+        /** Returns the batch the session a tree belongs to is in, if any */
+        static Batch* getBatchFor (const ValueTree& tree);
+
+        /** Returns true while edits are being batched */
+        inline bool isBatching() const noexcept { return batch != nullptr; }
+
         virtual ~Session();
         
         inline int getNumGraphs() const { return objectData.getChildWithName(Tags::graphs).getNumChildren(); }
@@ -78,6 +121,10 @@ namespace Element {
         inline bool notificationsFrozen()   const { return freezeChangeNotification; }
 
         std::unique_ptr<XmlElement> createXml();
+
+        /** Returns a copy of the session's data without any runtime objects,
+            safe to hand to another thread for saving */
+        ValueTree createSnapshot() const;
         
         void saveGraphState();
         void restoreGraphState();
@@ -156,6 +203,11 @@ namespace Element {
         friend struct ScopedFrozenLock;
         mutable bool freezeChangeNotification = false;
         void notifyChanged();
+
+        Batch::Ptr batch;
+        int batchDepth = 0;
+        void beginBatch();
+        void endBatch();
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Session);
     
@@ -0,0 +1,366 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/SessionArchive.h"
+#include "session/SessionReader.h"
+
+namespace Element {
+
+/* Everything is little endian uint32, laid out as:
+
+   header       see the ArchiveHeader fields below
+   chunks       numChunks * { MD5, offset low, offset high, stored size, size }
+   structure    the session ValueTree, gzipped
+   data         the gzipped state chunks
+*/
+namespace ArchiveHeader
+{
+    enum { magic = 0, version, numChunks, structureSize, size };
+}
+
+namespace ChunkEntry
+{
+    enum { hash = 0, offsetLow = 4, offsetHigh, storedSize, size, numFields };
+}
+
+static const uint32 archiveMagic    = 0x41534c45; // "ELSA"
+static const uint32 archiveVersion  = 1;
+
+static const size_t headerSize = (size_t) ArchiveHeader::size * sizeof (uint32);
+static const size_t entrySize  = (size_t) ChunkEntry::numFields * sizeof (uint32);
+
+static MemoryBlock compress (const void* data, size_t size)
+{
+    MemoryOutputStream out;
+    {
+        GZIPCompressorOutputStream gzip (out, 6);
+        gzip.write (data, size);
+    }
+    return out.getMemoryBlock();
+}
+
+//=============================================================================
+struct ArchiveBuilder
+{
+    struct Entry
+    {
+        MD5 hash;
+        MemoryBlock stored;
+        uint32 size;
+    };
+
+    OwnedArray<Entry> entries;
+    HashMap<String, int> keys;
+
+    /** Moves a node's state property into a chunk */
+    void storeState (ValueTree node, const Identifier& property)
+    {
+        MemoryBlock state;
+        const bool hasState = SessionArchive::readStateValue (node.getProperty (property), state);
+        node.removeProperty (property, nullptr);
+        if (! hasState)
+            return;
+
+        MD5 hash (state.getData(), state.getSize());
+        const auto key = hash.toHexString();
+        if (! keys.contains (key))
+        {
+            keys.set (key, entries.size());
+            entries.add (new Entry { hash, compress (state.getData(), state.getSize()),
+                                     (uint32) state.getSize() });
+        }
+
+        node.setProperty (SessionArchive::getChunkProperty (property), key, nullptr);
+    }
+
+    void storeStates (ValueTree tree)
+    {
+        if (tree.hasType (Tags::node))
+        {
+            storeState (tree, Tags::state);
+            storeState (tree, Tags::programState);
+        }
+
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+            storeStates (tree.getChild (i));
+    }
+};
+
+//=============================================================================
+SessionArchive::SessionArchive() { }
+SessionArchive::~SessionArchive()
+{
+    close();
+}
+
+bool SessionArchive::isArchive (const File& file)
+{
+    FileInputStream in (file);
+    return in.openedOk() && (uint32) in.readInt() == archiveMagic;
+}
+
+Result SessionArchive::write (const ValueTree& session, const File& file)
+{
+    if (! session.isValid())
+        return Result::fail ("Could not create session data");
+
+    ArchiveBuilder builder;
+    ValueTree structure = session.createCopy();
+    builder.storeStates (structure);
+
+    MemoryOutputStream encoded;
+    structure.writeToStream (encoded);
+    const auto structureData = compress (encoded.getData(), encoded.getDataSize());
+    encoded.reset();
+
+    uint32 header [ArchiveHeader::size];
+    header [ArchiveHeader::magic]          = archiveMagic;
+    header [ArchiveHeader::version]        = archiveVersion;
+    header [ArchiveHeader::numChunks]      = (uint32) builder.entries.size();
+    header [ArchiveHeader::structureSize]  = (uint32) structureData.getSize();
+
+    file.getParentDirectory().createDirectory();
+    TemporaryFile temp (file);
+    {
+        FileOutputStream out (temp.getFile());
+        if (out.failedToOpen())
+            return Result::fail ("Error writing session file");
+
+        for (auto value : header)
+            out.writeInt ((int) value);
+
+        uint64 offset = headerSize + entrySize * (size_t) builder.entries.size() + structureData.getSize();
+        for (auto* entry : builder.entries)
+        {
+            const auto hash = entry->hash.getRawChecksumData();
+            out.write (hash.getData(), hash.getSize());
+            out.writeInt ((int) (uint32) (offset & 0xffffffff));
+            out.writeInt ((int) (uint32) (offset >> 32));
+            out.writeInt ((int) (uint32) entry->stored.getSize());
+            out.writeInt ((int) entry->size);
+            offset += entry->stored.getSize();
+        }
+
+        out << structureData;
+        for (auto* entry : builder.entries)
+            out << entry->stored;
+
+        out.flush();
+        if (out.getStatus().failed())
+            return Result::fail ("Error writing session file");
+    }
+
+    return temp.overwriteTargetFileWithTemporary()
+        ? Result::ok() : Result::fail ("Could not replace " + file.getFullPathName());
+}
+
+bool SessionArchive::open (const File& file)
+{
+    close();
+    if (! file.existsAsFile())
+        return false;
+
+    mapped.reset (new MemoryMappedFile (file, MemoryMappedFile::readOnly));
+    data = static_cast<const char*> (mapped->getData());
+    dataSize = mapped->getSize();
+
+    if (data == nullptr || dataSize < headerSize
+        || readInt (ArchiveHeader::magic * sizeof (uint32)) != archiveMagic
+        || readInt (ArchiveHeader::version * sizeof (uint32)) != archiveVersion)
+    {
+        close();
+        return false;
+    }
+
+    auto fits = [this] (uint64 offset, uint64 size) { return offset <= dataSize && size <= dataSize - offset; };
+    const auto count = (size_t) readInt (ArchiveHeader::numChunks * sizeof (uint32));
+    bool valid = fits (headerSize, (uint64) count * entrySize)
+              && fits (headerSize + count * entrySize, readInt (ArchiveHeader::structureSize * sizeof (uint32)));
+
+    for (size_t i = 0; i < count && valid; ++i)
+    {
+        const auto entry = headerSize + i * entrySize;
+        const auto offset = (uint64) readInt (entry + ChunkEntry::offsetLow * sizeof (uint32))
+                          | ((uint64) readInt (entry + ChunkEntry::offsetHigh * sizeof (uint32)) << 32);
+        valid = fits (offset, readInt (entry + ChunkEntry::storedSize * sizeof (uint32)));
+        if (valid)
+            chunks.set (String::toHexString (data + entry, 16, 0), (int) i);
+    }
+
+    if (! valid)
+    {
+        close();
+        return false;
+    }
+
+    numChunks = (int) count;
+    return true;
+}
+
+void SessionArchive::close()
+{
+    mapped.reset();
+    data = nullptr;
+    dataSize = 0;
+    numChunks = 0;
+    chunks.clear();
+    decoded.clear();
+}
+
+ValueTree SessionArchive::readSession() const
+{
+    if (! isOpen())
+        return {};
+
+    const auto offset = headerSize + (size_t) numChunks * entrySize;
+    const auto size = (size_t) readInt (ArchiveHeader::structureSize * sizeof (uint32));
+    MemoryInputStream in (data + offset, size, false);
+    GZIPDecompressorInputStream gzip (in);
+    SessionReader reader;
+    return reader.read (gzip);
+}
+
+bool SessionArchive::readChunk (const String& key, MemoryBlock& state) const
+{
+    if (! isOpen() || ! chunks.contains (key))
+        return false;
+
+    const int index = chunks [key];
+    if (auto* block = decoded [index])
+    {
+        state = *block;
+        return true;
+    }
+
+    return decodeChunk (index, state);
+}
+
+bool SessionArchive::decodeChunk (int index, MemoryBlock& state) const
+{
+    const auto entry = headerSize + (size_t) index * entrySize;
+    const auto offset = (uint64) readInt (entry + ChunkEntry::offsetLow * sizeof (uint32))
+                      | ((uint64) readInt (entry + ChunkEntry::offsetHigh * sizeof (uint32)) << 32);
+    const auto storedSize = (size_t) readInt (entry + ChunkEntry::storedSize * sizeof (uint32));
+    const auto size = (size_t) readInt (entry + ChunkEntry::size * sizeof (uint32));
+
+    MemoryInputStream in (data + offset, storedSize, false);
+    GZIPDecompressorInputStream gzip (in);
+    state.setSize (size);
+    return gzip.read (state.getData(), (int) size) == (int) size;
+}
+
+struct ChunkDecodeJob : public ThreadPoolJob
+{
+    ChunkDecodeJob (std::function<void()> f)
+        : ThreadPoolJob ("el.decodeChunk"), decode (f) { }
+
+    JobStatus runJob() override
+    {
+        decode();
+        return jobHasFinished;
+    }
+
+    std::function<void()> decode;
+};
+
+int SessionArchive::decodeChunks()
+{
+    decoded.clear();
+    if (! isOpen() || numChunks <= 0)
+        return 0;
+
+    OwnedArray<MemoryBlock> blocks;
+    Array<bool> results;
+    for (int i = 0; i < numChunks; ++i)
+    {
+        blocks.add (new MemoryBlock());
+        results.add (false);
+    }
+
+    {
+        // declared first so the pool is done with the jobs before they go
+        OwnedArray<ChunkDecodeJob> jobs;
+        ThreadPool pool (jlimit (1, numChunks, SystemStats::getNumCpus()));
+
+        for (int i = 0; i < numChunks; ++i)
+        {
+            auto* block = blocks.getUnchecked (i);
+            auto* result = results.getRawDataPointer() + i;
+            pool.addJob (jobs.add (new ChunkDecodeJob ([this, i, block, result]() {
+                *result = decodeChunk (i, *block);
+            })), false);
+        }
+
+        for (auto* job : jobs)
+            pool.waitForJobToFinish (job, -1);
+    }
+
+    // chunks that failed are left to be decoded, and fail, on demand
+    int numDecoded = 0;
+    for (int i = 0; i < numChunks; ++i)
+    {
+        if (results.getUnchecked (i))
+            ++numDecoded;
+        else
+            blocks.set (i, nullptr);
+    }
+
+    decoded.swapWith (blocks);
+    return numDecoded;
+}
+
+bool SessionArchive::readState (const ValueTree& node, const Identifier& property, MemoryBlock& state)
+{
+    if (readStateValue (node.getProperty (property), state))
+        return true;
+
+    const auto key = node.getProperty (getChunkProperty (property)).toString();
+    if (key.isEmpty())
+        return false;
+
+    if (auto* archive = dynamic_cast<SessionArchive*> (node.getRoot().getProperty (Tags::archive).getObject()))
+        return archive->readChunk (key, state);
+    return false;
+}
+
+Identifier SessionArchive::getChunkProperty (const Identifier& property)
+{
+    return property == Tags::programState ? Tags::programStateChunk : Tags::stateChunk;
+}
+
+bool SessionArchive::readStateValue (const var& value, MemoryBlock& state)
+{
+    state.reset();
+    if (auto* const block = value.getBinaryData())
+    {
+        state = *block;
+        return state.getSize() > 0;
+    }
+
+    const auto text = value.toString().trim();
+    return text.isNotEmpty() && state.fromBase64Encoding (text) && state.getSize() > 0;
+}
+
+uint32 SessionArchive::readInt (size_t offset) const noexcept
+{
+    return offset + sizeof (uint32) <= dataSize
+        ? ByteOrder::littleEndianInt (data + offset) : 0;
+}
+
+}
@@ -0,0 +1,98 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A session file made of a compressed structure and separate plugin state chunks.
+
+    Plugin states are stored once each as compressed binary, keyed by their
+    MD5, so nodes running the same preset share a chunk. In the structure a
+    node's state property is replaced by the key of its chunk. An opened
+    archive is memory mapped and chunks are decoded when a node asks for its
+    state, unless they were all decoded at once beforehand. Sessions loaded from an archive keep it on their root as the
+    archive property until every state has been read back.
+ */
+class SessionArchive : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<SessionArchive>;
+
+    SessionArchive();
+    ~SessionArchive();
+
+    /** Returns true if the file starts like an archive */
+    static bool isArchive (const File& file);
+
+    /** Writes a session to an archive. The file is replaced in one go, so it's
+        never left half written */
+    static Result write (const ValueTree& session, const File& file);
+
+    /** Maps an archive. Returns false if it's missing or not a valid archive */
+    bool open (const File& file);
+
+    /** Unmaps the file */
+    void close();
+
+    bool isOpen() const noexcept { return data != nullptr; }
+
+    /** Decodes the session structure. Node states are left as chunk keys */
+    ValueTree readSession() const;
+
+    /** Returns the number of distinct state chunks */
+    int getNumChunks() const noexcept { return numChunks; }
+
+    /** Decodes a state chunk */
+    bool readChunk (const String& key, MemoryBlock& state) const;
+
+    /** Decodes every chunk up front, several at a time on background threads,
+        and blocks until they're done. Chunks read afterwards are copied from
+        memory instead of being decoded on the message thread. Returns the
+        number of chunks that decoded */
+    int decodeChunks();
+
+    /** Reads the state or program state of a node, whether it's held in the
+        node or in a chunk of the archive its session was loaded from */
+    static bool readState (const ValueTree& node, const Identifier& property, MemoryBlock& state);
+
+    /** Returns the property holding the chunk key of a state property */
+    static Identifier getChunkProperty (const Identifier& property);
+
+    /** Reads a state property's value, which is base64 text, or binary when
+        it was put there by a copy */
+    static bool readStateValue (const var& value, MemoryBlock& state);
+
+private:
+    std::unique_ptr<MemoryMappedFile> mapped;
+    const char* data = nullptr;
+    size_t dataSize = 0;
+    int numChunks = 0;
+    HashMap<String, int> chunks;
+    OwnedArray<MemoryBlock> decoded;
+
+    uint32 readInt (size_t offset) const noexcept;
+    bool decodeChunk (int index, MemoryBlock& state) const;
+
+    JUCE_DECLARE_NON_COPYABLE (SessionArchive)
+};
+
+}
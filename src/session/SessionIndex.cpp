@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/SessionIndex.h"
+
+namespace Element {
+
+SessionIndex::SessionIndex() { }
+SessionIndex::~SessionIndex() { }
+
+SessionIndex* SessionIndex::getFor (const ValueTree& tree)
+{
+    return dynamic_cast<SessionIndex*> (tree.getRoot().getProperty (Tags::sessionIndex).getObject());
+}
+
+ValueTree SessionIndex::findNode (const ValueTree& tree, const String& uuid)
+{
+    const auto found = lookup (nodes, uuid, tree);
+    return found.getProperty (Tags::uuid).toString() == uuid ? found : ValueTree();
+}
+
+ValueTree SessionIndex::findNode (const ValueTree& graph, uint32 nodeId)
+{
+    const auto found = lookup (nodeIds, getNodeIdKey (graph, static_cast<int64> (nodeId)), graph);
+    return found.getParent().getParent() == graph ? found : ValueTree();
+}
+
+ValueTree SessionIndex::findControllerDevice (const ValueTree& tree, const String& uuid)
+{
+    const auto found = lookup (devices, uuid, tree);
+    return found.getProperty (Tags::uuid).toString() == uuid ? found : ValueTree();
+}
+
+ValueTree SessionIndex::lookup (HashMap<String, ValueTree>& map, const String& key, const ValueTree& tree)
+{
+    if (key.isEmpty())
+        return {};
+
+    const auto root = tree.getRoot();
+    if (stale)
+        rebuild (root);
+
+    const auto found = map [key];
+    return found.isValid() && found.getRoot() == root ? found : ValueTree();
+}
+
+String SessionIndex::getNodeIdKey (const ValueTree& graph, const var& nodeId)
+{
+    const auto graphId = graph.getProperty (Tags::uuid).toString();
+    return graphId.isEmpty() ? String() : graphId + "/" + nodeId.toString();
+}
+
+void SessionIndex::treeAdded (const ValueTree& tree)
+{
+    if (! stale)
+        update (tree.getParent(), tree, true);
+}
+
+void SessionIndex::treeRemoved (const ValueTree& parent, const ValueTree& tree)
+{
+    if (! stale)
+        update (parent, tree, false);
+}
+
+void SessionIndex::update (const ValueTree& parent, const ValueTree& tree, const bool add)
+{
+    auto apply = [&tree, add] (HashMap<String, ValueTree>& map, const String& key)
+    {
+        if (key.isEmpty())
+            return;
+        if (add)
+            map.set (key, tree);
+        else if (map [key] == tree)
+            map.remove (key);
+    };
+
+    if (tree.hasType (Tags::node))
+    {
+        apply (nodes, tree.getProperty (Tags::uuid).toString());
+        if (parent.hasType (Tags::nodes) && tree.hasProperty (Tags::id))
+            apply (nodeIds, getNodeIdKey (parent.getParent(), tree.getProperty (Tags::id)));
+    }
+    else if (tree.hasType (Tags::controller) && parent.hasType (Tags::controllers))
+    {
+        apply (devices, tree.getProperty (Tags::uuid).toString());
+    }
+
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+        update (tree, tree.getChild (i), add);
+}
+
+void SessionIndex::rebuild (const ValueTree& root)
+{
+    nodes.clear();
+    nodeIds.clear();
+    devices.clear();
+    stale = false;
+    treeAdded (root);
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Hash indices over a session's tree, so nodes and controller devices can be
+    found without walking it.
+
+    The session keeps it up to date as its tree changes and holds it on its
+    root as the sessionIndex property, where Node lookups find it. Changes to
+    the IDs themselves mark it stale, it's then rebuilt by the next lookup.
+ */
+class SessionIndex : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<SessionIndex>;
+
+    SessionIndex();
+    ~SessionIndex();
+
+    /** Returns the index of the session a tree belongs to, if any */
+    static SessionIndex* getFor (const ValueTree& tree);
+
+    /** Finds a node anywhere in the session the tree belongs to */
+    ValueTree findNode (const ValueTree& tree, const String& uuid);
+
+    /** Finds a node of a graph by its node ID */
+    ValueTree findNode (const ValueTree& graph, uint32 nodeId);
+
+    /** Finds a controller device in the session the tree belongs to */
+    ValueTree findControllerDevice (const ValueTree& tree, const String& uuid);
+
+    /** Indexes a tree added to the session, and everything in it */
+    void treeAdded (const ValueTree& tree);
+
+    /** Drops a tree removed from the session, and everything in it */
+    void treeRemoved (const ValueTree& parent, const ValueTree& tree);
+
+    /** Marks the index stale */
+    void invalidate() noexcept { stale = true; }
+
+private:
+    HashMap<String, ValueTree> nodes, nodeIds, devices;
+    bool stale = true;
+
+    static String getNodeIdKey (const ValueTree& graph, const var& nodeId);
+    ValueTree lookup (HashMap<String, ValueTree>& map, const String& key, const ValueTree& tree);
+    void rebuild (const ValueTree& root);
+    void update (const ValueTree& parent, const ValueTree& tree, bool add);
+
+    JUCE_DECLARE_NON_COPYABLE (SessionIndex)
+};
+
+}
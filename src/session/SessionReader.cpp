@@ -0,0 +1,270 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/SessionReader.h"
+
+namespace Element {
+
+/* The markers var::writeToStream puts before each value */
+enum
+{
+    varMarker_Int       = 1,
+    varMarker_BoolTrue  = 2,
+    varMarker_BoolFalse = 3,
+    varMarker_Double    = 4,
+    varMarker_String    = 5,
+    varMarker_Int64     = 6,
+    varMarker_Array     = 7,
+    varMarker_Binary    = 8,
+    varMarker_Undefined = 9
+};
+
+SessionReader::SessionReader() { }
+SessionReader::~SessionReader() { }
+
+ValueTree SessionReader::read (InputStream& input)
+{
+    arena.reset();
+    input.readIntoMemoryBlock (arena);
+    auto tree = read (arena.getData(), arena.getSize());
+    arena.reset();
+    return tree;
+}
+
+ValueTree SessionReader::read (const void* data, size_t numBytes)
+{
+    pos = static_cast<const uint8*> (data);
+    end = pos + numBytes;
+    failed = false;
+    auto tree = readTree();
+    pos = end = nullptr;
+    return tree;
+}
+
+//=============================================================================
+ValueTree SessionReader::readTree()
+{
+    const auto type = readName();
+    if (failed || type.isNull())
+        return {};
+
+    ValueTree tree (type);
+    const bool isNode = type == Tags::node;
+
+    const int numProps = readCompressedInt();
+    if (numProps < 0)
+        return tree;
+
+    for (int i = 0; i < numProps && ! failed; ++i)
+    {
+        const auto name = readName();
+        if (name.isNull())
+        {
+            // writeToStream never writes these, readFromStream skips only the name
+            jassertfalse;
+            continue;
+        }
+        tree.setProperty (name, readValue (name, isNode), nullptr);
+    }
+
+    if (isNode && onNodeRead)
+        onNodeRead (tree);
+
+    const int numChildren = readCompressedInt();
+    for (int i = 0; i < numChildren && ! failed; ++i)
+    {
+        auto child = readTree();
+        if (! child.isValid())
+            break;
+        tree.appendChild (child, nullptr);
+    }
+
+    return tree;
+}
+
+var SessionReader::readValue (const Identifier& property, bool inNode)
+{
+    const int numBytes = readCompressedInt();
+    if (numBytes <= 0 || ! canRead ((size_t) numBytes))
+        return {};
+
+    const uint8 marker = *pos++;
+    const auto* const data = pos;
+    const size_t size = (size_t) numBytes - 1;
+    pos += size;
+
+    switch (marker)
+    {
+        case varMarker_Int:
+            return size >= 4 ? var ((int) ByteOrder::littleEndianInt (data)) : var();
+        case varMarker_BoolTrue:    return var (true);
+        case varMarker_BoolFalse:   return var (false);
+        case varMarker_Double:
+        {
+            if (size < 8)
+                return {};
+            const int64 bits = (int64) ByteOrder::littleEndianInt64 (data);
+            double value;
+            memcpy (&value, &bits, sizeof (value));
+            return var (value);
+        }
+        case varMarker_Int64:
+            return size >= 8 ? var ((int64) ByteOrder::littleEndianInt64 (data)) : var();
+        case varMarker_String:
+        {
+            const auto* const text = reinterpret_cast<const char*> (data);
+            const bool terminated = size > 0 && data [size - 1] == 0;
+            const size_t length = terminated ? size - 1 : size;
+
+            // node states go straight to binary, no String is made for them
+            if (inNode && terminated && (property == Tags::state || property == Tags::programState))
+            {
+                MemoryBlock state;
+                if (state.fromBase64Encoding (StringRef (text)))
+                    return var (state);
+            }
+
+            return var (String::fromUTF8 (text, (int) length));
+        }
+        case varMarker_Binary:
+            return var (data, size);
+        case varMarker_Array:
+        {
+            // the elements are written inside the array's bytes
+            const auto* const arrayEnd = pos;
+            pos = data;
+            var array;
+            auto* elements = array.convertToArray();
+            for (int i = readCompressedInt(); --i >= 0 && ! failed && pos < arrayEnd;)
+                elements->add (readValue ({}, false));
+            pos = arrayEnd;
+            return array;
+        }
+        case varMarker_Undefined:   return var::undefined();
+        default: break;
+    }
+
+    return {};
+}
+
+Identifier SessionReader::readName()
+{
+    size_t length = 0;
+    const char* text = readCString (length);
+    if (text == nullptr || length == 0)
+        return {};
+
+    uint32 hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8) text[i]) * 16777619u;
+
+    if (numNames * 2 >= capacity)
+        grow();
+
+    for (int slot = (int) (hash & (uint32) (capacity - 1));; slot = (slot + 1) & (capacity - 1))
+    {
+        auto& name = names.getReference (slot);
+        if (name.identifier.isNull())
+        {
+            name.hash = hash;
+            name.identifier = Identifier (text);
+            ++numNames;
+            return name.identifier;
+        }
+
+        if (name.hash == hash)
+        {
+            const char* interned = name.identifier.getCharPointer().getAddress();
+            if (strncmp (interned, text, length) == 0 && interned [length] == 0)
+                return name.identifier;
+        }
+    }
+}
+
+const char* SessionReader::readCString (size_t& length)
+{
+    const auto* const start = pos;
+    while (pos < end && *pos != 0)
+        ++pos;
+
+    if (pos >= end)
+    {
+        failed = true;
+        return nullptr;
+    }
+
+    length = (size_t) (pos - start);
+    ++pos;
+    return reinterpret_cast<const char*> (start);
+}
+
+int SessionReader::readCompressedInt()
+{
+    if (! canRead (1))
+        return 0;
+
+    const uint8 sizeByte = *pos++;
+    if (sizeByte == 0)
+        return 0;
+
+    const int numBytes = (sizeByte & 0x7f);
+    if (numBytes > 4 || ! canRead ((size_t) numBytes))
+    {
+        failed = true;
+        return 0;
+    }
+
+    uint32 value = 0;
+    for (int i = 0; i < numBytes; ++i)
+        value |= (uint32) pos[i] << (8 * i);
+    pos += numBytes;
+
+    const int num = (int) value;
+    return (sizeByte >> 7) ? -num : num;
+}
+
+bool SessionReader::canRead (size_t numBytes)
+{
+    if (! failed && (size_t) (end - pos) >= numBytes)
+        return true;
+    failed = true;
+    return false;
+}
+
+void SessionReader::grow()
+{
+    const int newCapacity = jmax (256, capacity * 2);
+    Array<Name> table;
+    table.resize (newCapacity);
+
+    for (const auto& name : names)
+    {
+        if (name.identifier.isNull())
+            continue;
+        int slot = (int) (name.hash & (uint32) (newCapacity - 1));
+        while (! table.getReference (slot).identifier.isNull())
+            slot = (slot + 1) & (newCapacity - 1);
+        table.getReference (slot) = name;
+    }
+
+    names.swapWith (table);
+    capacity = newCapacity;
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Reads ValueTrees written by ValueTree::writeToStream, the format of
+    saved sessions, with far fewer allocations than ValueTree::readFromStream.
+
+    The whole stream is read into one block up front and parsed in place, so
+    nothing transient is allocated per property. Property and type names are
+    interned in a table of their own, so repeated names skip both the
+    temporary String and the global pool lookup. Plugin states on nodes are
+    decoded straight from the stream into binary MemoryBlocks, which saves
+    keeping each as a base64 String as big again as the state itself;
+    SessionArchive::readState and var::toString() handle either form.
+ */
+class SessionReader
+{
+public:
+    SessionReader();
+    ~SessionReader();
+
+    /** Reads a tree from the rest of a stream. Returns an invalid tree if
+        the stream doesn't hold one */
+    ValueTree read (InputStream& input);
+
+    /** Reads a tree from a block of memory */
+    ValueTree read (const void* data, size_t numBytes);
+
+    /** Returns the number of distinct names interned so far */
+    int getNumInternedNames() const noexcept { return numNames; }
+
+    /** Called with each node as soon as its properties are read, before its
+        children, so nodes can be rewritten in the same pass */
+    std::function<void (ValueTree&)> onNodeRead;
+
+private:
+    struct Name
+    {
+        uint32 hash = 0;
+        Identifier identifier;
+    };
+
+    Array<Name> names;
+    int numNames = 0, capacity = 0;
+    MemoryBlock arena;
+    const uint8* pos = nullptr;
+    const uint8* end = nullptr;
+    bool failed = false;
+
+    ValueTree readTree();
+    var readValue (const Identifier& property, bool inNode);
+    Identifier readName();
+    const char* readCString (size_t& length);
+    int readCompressedInt();
+    bool canRead (size_t numBytes);
+    void grow();
+
+    JUCE_DECLARE_NON_COPYABLE (SessionReader)
+};
+
+}
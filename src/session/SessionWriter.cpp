@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/SessionArchive.h"
+#include "session/SessionWriter.h"
+
+namespace Element {
+
+SessionWriter::SessionWriter()
+    : Thread ("el.sessionWriter")
+{
+    idle.signal();
+}
+
+SessionWriter::~SessionWriter()
+{
+    // queued snapshots are the user's work, so they're always finished
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+}
+
+void SessionWriter::write (const ValueTree& snapshot, const File& file, Callback callback)
+{
+    {
+        const ScopedLock sl (lock);
+        bool replaced = false;
+        for (auto& job : jobs)
+        {
+            if (job.file == file)
+            {
+                job.data = snapshot;
+                job.callback = callback;
+                replaced = true;
+                break;
+            }
+        }
+
+        if (! replaced)
+            jobs.add ({ snapshot, file, callback });
+        idle.reset();
+    }
+
+    if (! isThreadRunning())
+        startThread (3);
+    notify();
+}
+
+bool SessionWriter::isWriting() const
+{
+    const ScopedLock sl (lock);
+    return busy || jobs.size() > 0;
+}
+
+bool SessionWriter::waitUntilIdle (int timeoutMs)
+{
+    return idle.wait (timeoutMs);
+}
+
+Result SessionWriter::writeSnapshot (const ValueTree& snapshot, const File& file)
+{
+    return SessionArchive::write (snapshot, file);
+}
+
+void SessionWriter::run()
+{
+    for (;;)
+    {
+        Job job;
+        bool haveJob = false;
+
+        {
+            const ScopedLock sl (lock);
+            haveJob = jobs.size() > 0;
+            busy = haveJob;
+            if (haveJob)
+            {
+                job = jobs.removeAndReturn (0);
+            }
+            else
+            {
+                idle.signal();
+                if (threadShouldExit())
+                    break;
+            }
+        }
+
+        if (! haveJob)
+        {
+            wait (-1);
+            continue;
+        }
+
+        const auto result = writeSnapshot (job.data, job.file);
+        job.data = ValueTree();
+
+        if (job.callback)
+        {
+            auto callback = job.callback;
+            auto file = job.file;
+            MessageManager::callAsync ([callback, file, result]() { callback (file, result); });
+        }
+    }
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Writes session snapshots to disk on a background thread.
+
+    A snapshot is a sanitized copy of the session's ValueTree, cheap to take
+    on the message thread. Encoding it as a SessionArchive and writing happen
+    here, into a temporary file that then replaces the target, so a session
+    file is never left half written. A snapshot queued for a file that's still waiting replaces the
+    older one. Writes that are queued are always finished before this is
+    deleted.
+ */
+class SessionWriter : private Thread
+{
+public:
+    /** Called on the message thread once a snapshot has been written */
+    using Callback = std::function<void (const File&, const Result&)>;
+
+    SessionWriter();
+    ~SessionWriter();
+
+    /** Queues a snapshot to be written to a file */
+    void write (const ValueTree& snapshot, const File& file, Callback callback = nullptr);
+
+    /** Returns true while snapshots are waiting or being written */
+    bool isWriting() const;
+
+    /** Blocks until every queued snapshot has been written. Returns false if
+        that didn't happen in time */
+    bool waitUntilIdle (int timeoutMs = -1);
+
+    /** Writes a snapshot straight away, on the calling thread */
+    static Result writeSnapshot (const ValueTree& snapshot, const File& file);
+
+private:
+    struct Job
+    {
+        ValueTree data;
+        File file;
+        Callback callback;
+    };
+
+    CriticalSection lock;
+    Array<Job> jobs;
+    bool busy = false;
+    WaitableEvent idle { true };
+
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (SessionWriter)
+};
+
+}
@@ -0,0 +1,64 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/PluginManager.h"
+#include "session/SharedPluginList.h"
+
+namespace Element {
+
+bool SharedPluginList::needsRestore (const File& catalog) const
+{
+    return ! restored || (catalog.existsAsFile() && catalog.getLastModificationTime() != catalogTime);
+}
+
+void SharedPluginList::markRestored (const File& catalog)
+{
+    restored = true;
+    catalogTime = catalog.getLastModificationTime();
+}
+
+void SharedPluginList::addManager (PluginManager* manager)
+{
+    managers.addIfNotAlreadyThere (manager);
+}
+
+void SharedPluginList::removeManager (PluginManager* manager)
+{
+    managers.removeFirstMatchingValue (manager);
+    if (scanning == manager)
+        scanning = nullptr;
+}
+
+bool SharedPluginList::beginScan (PluginManager* manager)
+{
+    if (scanning != nullptr && scanning != manager)
+        return false;
+    scanning = manager;
+    return true;
+}
+
+void SharedPluginList::endScan (PluginManager* manager)
+{
+    if (scanning == manager)
+        scanning = nullptr;
+    for (auto* other : managers)
+        other->sendChangeMessage();
+}
+
+}
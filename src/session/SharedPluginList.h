@@ -0,0 +1,79 @@
+/*
+This file is part of Element
+Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class PluginManager;
+
+/** The known plugins every PluginManager in a process reads and scans into.
+
+    Each plugin instance a host loads has a world of its own, so without this
+    every one would parse the catalog and keep a copy of it. Managers hold the
+    list through a SharedResourcePointer, so it lives as long as one of them
+    does. The first to restore reads the catalog, the rest use what's there
+    and only read it again if the file was replaced since, e.g. by the app or
+    by a sandboxed host in another process. The catalog itself is memory
+    mapped, so processes reading it share its pages.
+
+    One manager scans at a time. The others see the results as they land and
+    are all told when it's done.
+ */
+class SharedPluginList
+{
+public:
+    SharedPluginList() = default;
+
+    KnownPluginList& getList() noexcept                 { return list; }
+
+    /** Returns true if the list hasn't been restored, or the catalog was
+        replaced after it was */
+    bool needsRestore (const File& catalog) const;
+
+    /** Marks the list as matching the catalog as it is now, after reading or
+        writing it */
+    void markRestored (const File& catalog);
+
+    void addManager (PluginManager* manager);
+    void removeManager (PluginManager* manager);
+    int getNumManagers() const noexcept                 { return managers.size(); }
+
+    /** Lets a manager run the scanner. Returns false if another is scanning */
+    bool beginScan (PluginManager* manager);
+
+    /** Releases the scanner and tells every manager the list changed */
+    void endScan (PluginManager* manager);
+
+    /** Returns the manager running the scanner, if there is one */
+    PluginManager* getScanningManager() const noexcept  { return scanning; }
+
+private:
+    KnownPluginList list;
+    Array<PluginManager*> managers;
+    PluginManager* scanning = nullptr;
+    bool restored = false;
+    Time catalogTime;
+
+    JUCE_DECLARE_NON_COPYABLE (SharedPluginList)
+};
+
+}
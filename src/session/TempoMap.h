@@ -20,14 +20,49 @@
 #ifndef EL_TEMPO_MAP_H
 #define EL_TEMPO_MAP_H
 
+#include "ElementApp.h"
+
 namespace Element {
+
+/** Tempo and time signature changes of a session.
+
+    Children are tempo changes with a beat, bpm and whether to ramp to the
+    next change, and meter changes with a beat, beats per bar and beat type.
+    Beats are quarter notes. A session without one plays at its single tempo
+    and meter */
 class TempoMap :  public ObjectModel
 {
 public:
-    TempoMap ()
-        : ObjectModel ()
+    TempoMap()
+        : ObjectModel ("tempoMap")
+    { }
+
+    explicit TempoMap (const ValueTree& data)
+        : ObjectModel (data)
+    { }
+
+    inline bool isValid() const { return objectData.hasType ("tempoMap"); }
+
+    /** Adds a tempo change */
+    inline ValueTree addTempo (double beat, double bpm, bool rampToNext = false)
     {
+        ValueTree tempo ("tempo");
+        tempo.setProperty ("beat", beat, nullptr)
+             .setProperty ("bpm", bpm, nullptr)
+             .setProperty ("ramp", rampToNext, nullptr);
+        objectData.addChild (tempo, -1, nullptr);
+        return tempo;
+    }
 
+    /** Adds a time signature change, which ought to fall on a bar line */
+    inline ValueTree addMeter (double beat, int beatsPerBar, int beatType)
+    {
+        ValueTree meter ("meter");
+        meter.setProperty ("beat", beat, nullptr)
+             .setProperty ("beatsPerBar", beatsPerBar, nullptr)
+             .setProperty ("beatType", beatType, nullptr);
+        objectData.addChild (meter, -1, nullptr);
+        return meter;
     }
 };
 
@@ -0,0 +1,167 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/Node.h"
+#include "session/SessionArchive.h"
+#include "session/UndoStateStore.h"
+
+namespace Element {
+
+class UndoStateStore::Blob : public ReferenceCountedObject
+{
+public:
+    Blob (const String& k, const MemoryBlock& state)
+        : key (k), size ((int) state.getSize())
+    {
+        MemoryOutputStream out (compressed, false);
+        GZIPCompressorOutputStream gzip (out, 6);
+        gzip.write (state.getData(), state.getSize());
+    }
+
+    bool decode (MemoryBlock& state) const
+    {
+        MemoryInputStream in (compressed, false);
+        GZIPDecompressorInputStream gzip (in);
+        state.setSize ((size_t) size);
+        return gzip.read (state.getData(), size) == size;
+    }
+
+    const String key;
+    const int size;
+    MemoryBlock compressed;
+};
+
+//=============================================================================
+UndoStateStore::Snapshot::Snapshot() { }
+UndoStateStore::Snapshot::Snapshot (const Snapshot&) = default;
+UndoStateStore::Snapshot& UndoStateStore::Snapshot::operator= (const Snapshot&) = default;
+UndoStateStore::Snapshot::~Snapshot() { }
+
+ValueTree UndoStateStore::Snapshot::restore() const
+{
+    if (! isValid())
+        return {};
+
+    ValueTree tree;
+    {
+        MemoryInputStream in (structure, false);
+        GZIPDecompressorInputStream gzip (in);
+        tree = ValueTree::readFromStream (gzip);
+    }
+
+    std::function<void (ValueTree)> restoreStates = [this, &restoreStates] (ValueTree node)
+    {
+        for (const auto* property : { &Tags::state, &Tags::programState })
+        {
+            const auto chunk = SessionArchive::getChunkProperty (*property);
+            const auto key = node.getProperty (chunk).toString();
+            if (key.isEmpty())
+                continue;
+
+            node.removeProperty (chunk, nullptr);
+            MemoryBlock state;
+            for (const auto* blob : states)
+                if (blob->key == key && blob->decode (state))
+                    node.setProperty (*property, state.toBase64Encoding(), nullptr);
+        }
+
+        for (int i = 0; i < node.getNumChildren(); ++i)
+            restoreStates (node.getChild (i));
+    };
+
+    restoreStates (tree);
+    return tree;
+}
+
+int UndoStateStore::Snapshot::getSizeInBytes() const
+{
+    int64 bytes = (int64) structure.getSize();
+    for (const auto* blob : states)
+    {
+        // the store holds a reference of its own
+        const int sharers = jmax (1, blob->getReferenceCount() - 1);
+        bytes += (int64) blob->compressed.getSize() / sharers;
+    }
+    return (int) jmin ((int64) std::numeric_limits<int>::max(), bytes);
+}
+
+//=============================================================================
+UndoStateStore::UndoStateStore() { }
+UndoStateStore::~UndoStateStore() { }
+
+UndoStateStore::Snapshot UndoStateStore::store (const ValueTree& tree)
+{
+    purge();
+
+    Snapshot snapshot;
+    if (! tree.isValid())
+        return snapshot;
+
+    ValueTree copy = tree.createCopy();
+    Node::sanitizeRuntimeProperties (copy, true);
+
+    std::function<void (ValueTree)> storeStates = [this, &storeStates, &snapshot] (ValueTree node)
+    {
+        if (node.hasType (Tags::node))
+        {
+            storeState (node, Tags::state, snapshot);
+            storeState (node, Tags::programState, snapshot);
+        }
+
+        for (int i = 0; i < node.getNumChildren(); ++i)
+            storeStates (node.getChild (i));
+    };
+    storeStates (copy);
+
+    MemoryOutputStream out (snapshot.structure, false);
+    {
+        GZIPCompressorOutputStream gzip (out, 6);
+        copy.writeToStream (gzip);
+    }
+    return snapshot;
+}
+
+UndoStateStore::Blob* UndoStateStore::storeState (ValueTree node, const Identifier& property, Snapshot& snapshot)
+{
+    MemoryBlock state;
+    if (! SessionArchive::readStateValue (node.getProperty (property), state))
+        return nullptr;
+
+    const auto key = MD5 (state.getData(), state.getSize()).toHexString();
+    Blob* blob = nullptr;
+    for (auto* existing : blobs)
+        if (existing->key == key)
+            blob = existing;
+    if (blob == nullptr)
+        blob = blobs.add (new Blob (key, state));
+
+    snapshot.states.addIfNotAlreadyThere (blob);
+    node.removeProperty (property, nullptr);
+    node.setProperty (SessionArchive::getChunkProperty (property), key, nullptr);
+    return blob;
+}
+
+void UndoStateStore::purge()
+{
+    for (int i = blobs.size(); --i >= 0;)
+        if (blobs.getObjectPointerUnchecked (i)->getReferenceCount() <= 1)
+            blobs.remove (i);
+}
+
+}
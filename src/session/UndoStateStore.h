@@ -0,0 +1,81 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Keeps node data for the undo history compactly.
+
+    Plugin states are pulled out of a node's tree and kept once each,
+    compressed and keyed by their MD5, so actions holding the same state share
+    it. The rest of the tree is kept as compressed binary. States no snapshot
+    refers to anymore are dropped the next time something is stored.
+ */
+class UndoStateStore
+{
+public:
+    UndoStateStore();
+    ~UndoStateStore();
+
+    class Blob;
+
+    /** A node tree stored in the undo history */
+    class Snapshot
+    {
+    public:
+        Snapshot();
+        Snapshot (const Snapshot&);
+        Snapshot& operator= (const Snapshot&);
+        ~Snapshot();
+
+        /** Decodes the tree, states included */
+        ValueTree restore() const;
+
+        /** Returns the number of bytes held. Shared states count a share of
+            their size */
+        int getSizeInBytes() const;
+
+        bool isValid() const noexcept { return structure.getSize() > 0; }
+
+    private:
+        friend class UndoStateStore;
+        MemoryBlock structure;
+        ReferenceCountedArray<Blob> states;
+    };
+
+    /** Stores a copy of a tree. Runtime properties are left out */
+    Snapshot store (const ValueTree& tree);
+
+    /** Returns the number of distinct states held */
+    int getNumStates() const noexcept { return blobs.size(); }
+
+    /** Drops states that no snapshot refers to */
+    void purge();
+
+private:
+    ReferenceCountedArray<Blob> blobs;
+    Blob* storeState (ValueTree node, const Identifier& property, Snapshot& snapshot);
+
+    JUCE_DECLARE_NON_COPYABLE (UndoStateStore)
+};
+
+}
@@ -0,0 +1,173 @@
+/*
+    This file is part of Element
+    Copyright (C) 2018-2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "db/Database.h"
+
+namespace Element {
+
+class DatabaseTest : public UnitTestBase
+{
+public:
+    DatabaseTest() : UnitTestBase ("Database", "session", "database") { }
+    virtual ~DatabaseTest() { }
+
+    void runTest() override
+    {
+        testPlugins();
+        testFiles();
+        testPresetHeaders();
+        testPersistence();
+    }
+
+private:
+    static PluginDescription makeType (const String& name, const String& maker, const String& file)
+    {
+        PluginDescription type;
+        type.name = name;
+        type.manufacturerName = maker;
+        type.category = "Effect";
+        type.pluginFormatName = "VST";
+        type.fileOrIdentifier = file;
+        type.uid = name.hashCode();
+        return type;
+    }
+
+    void testPlugins()
+    {
+        beginTest ("plugins");
+        KnownPluginList list;
+        list.addType (makeType ("Super Compressor", "Acme", "/plugins/comp.so"));
+        list.addType (makeType ("Tape Delay", "Acme", "/plugins/delay.so"));
+        list.addType (makeType ("Room Reverb", "Other Audio", "/plugins/verb.so"));
+
+        Database db;
+        expect (db.updatePlugins (list));
+        expectEquals (db.getNumRecords(), 3);
+        expect (! db.updatePlugins (list), "unchanged lists leave the catalog alone");
+
+        auto found = db.search ("comp");
+        expectEquals (found.size(), 1);
+        expectEquals (db.getRecord (found.getFirst())->name, String ("Super Compressor"));
+        expectEquals (db.search ("acme").size(), 2);
+        expectEquals (db.search ("acme del").size(), 1);
+        expectEquals (db.search ("acme verb").size(), 0);
+        expectEquals (db.search ("acme", Database::preset).size(), 0);
+
+        const auto sorted = db.search ("acme");
+        expectEquals (db.getRecord (sorted[0])->name, String ("Super Compressor"));
+        expectEquals (db.getRecord (sorted[1])->name, String ("Tape Delay"));
+
+        const auto narrowed = db.search ("acme ta", sorted);
+        expectEquals (narrowed.size(), 1);
+        expectEquals (db.getRecord (narrowed.getFirst())->name, String ("Tape Delay"));
+        expect (db.search ("acme", sorted) == sorted);
+        expect (db.search ("room", sorted).isEmpty(), "records outside the set aren't found");
+
+        list.removeType (0);
+        expect (db.updatePlugins (list));
+        expectEquals (db.getNumRecords(), 2);
+        expect (db.search ("compressor").isEmpty());
+    }
+
+    void testFiles()
+    {
+        beginTest ("files");
+        TemporaryFile temp;
+        const auto dir = temp.getFile();
+        dir.createDirectory();
+        const auto kick = dir.getChildFile ("Big Kick.wav");
+        const auto snare = dir.getChildFile ("Tight Snare.wav");
+        kick.replaceWithText ("kick");
+        snare.replaceWithText ("snare");
+
+        Database db;
+        expect (db.updateFiles (Database::asset, { kick, snare }));
+        expectEquals (db.find (Database::asset).size(), 2);
+        expect (! db.updateFiles (Database::asset, { kick, snare }));
+        expectEquals (db.search ("snare").size(), 1);
+
+        Database::Record preset;
+        preset.kind = Database::preset;
+        preset.name = "Warm";
+        preset.format = "VST";
+        preset.identifier = "/plugins/comp.so";
+        db.add (preset);
+        expectEquals (db.find (Database::preset, "VST", "/plugins/comp.so").size(), 1);
+        expectEquals (db.find (Database::preset, "VST3", "/plugins/comp.so").size(), 0);
+
+        expect (db.updateFiles (Database::asset, { snare }));
+        expectEquals (db.find (Database::asset).size(), 1);
+        expect (db.search ("kick").isEmpty());
+        dir.deleteRecursively();
+    }
+
+    void testPresetHeaders()
+    {
+        beginTest ("preset headers");
+        TemporaryFile file (".elpreset");
+
+        // the header is enough, the rest of the file isn't looked at
+        file.getFile().replaceWithText (
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<preset name=\"Warm\" format=\"VST\" identifier=\"/plugins/comp.so\">"
+            "<node state=\"not parsed");
+
+        Database::Record record;
+        expect (Database::readFile (Database::preset, file.getFile(), record));
+        expectEquals (record.name, String ("Warm"));
+        expectEquals (record.format, String ("VST"));
+        expectEquals (record.identifier, String ("/plugins/comp.so"));
+        expect (record.modified == file.getFile().getLastModificationTime().toMilliseconds());
+
+        file.getFile().replaceWithText ("not a preset");
+        expect (! Database::readFile (Database::preset, file.getFile(), record));
+        expect (record.identifier.isEmpty());
+        expectEquals (record.name, file.getFile().getFileNameWithoutExtension());
+    }
+
+    void testPersistence()
+    {
+        beginTest ("persistence");
+        TemporaryFile file (".eldb");
+        {
+            Database db;
+            KnownPluginList list;
+            list.addType (makeType ("Tape Delay", "Acme", "/plugins/delay.so"));
+            db.updatePlugins (list);
+            Database::Record asset;
+            asset.name = "Loop";
+            asset.file = File::getSpecialLocation (File::tempDirectory).getChildFile ("loop.wav");
+            asset.modified = 1234;
+            db.add (asset);
+            expect (db.save (file.getFile()));
+        }
+
+        Database db;
+        expect (db.load (file.getFile()));
+        expectEquals (db.getNumRecords(), 2);
+        const auto found = db.search ("loop");
+        expectEquals (found.size(), 1);
+        expect (db.getRecord (found.getFirst())->modified == 1234);
+        expectEquals (db.search ("delay", Database::plugin).size(), 1);
+    }
+};
+
+static DatabaseTest sDatabaseTest;
+
+}
@@ -0,0 +1,95 @@
+/*
+    This file is part of Element
+    Copyright (C) 2018-2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "FileIndex.h"
+
+namespace Element {
+
+class FileIndexTest : public UnitTestBase
+{
+public:
+    FileIndexTest() : UnitTestBase ("File Index", "session", "fileIndex") { }
+    virtual ~FileIndexTest() { }
+
+    void runTest() override
+    {
+        TemporaryFile temp;
+        const auto dir = temp.getFile();
+        dir.getChildFile ("Drums").createDirectory();
+        dir.getChildFile ("kick.wav").replaceWithText ("kick");
+        dir.getChildFile ("notes.txt").replaceWithText ("notes");
+        dir.getChildFile ("Drums/snare.wav").replaceWithText ("snare");
+        dir.getChildFile (".hidden.wav").replaceWithText ("hidden");
+
+        FileIndex index;
+
+        beginTest ("first query scans");
+        expect (! index.isIndexed (dir));
+        Array<File> files;
+        index.findFiles (dir, true, "*.wav;*.aif", files);
+        expect (index.isIndexed (dir));
+        expectEquals (files.size(), 2);
+        expect (files.contains (dir.getChildFile ("Drums/snare.wav")));
+        expect (! files.contains (dir.getChildFile (".hidden.wav")));
+
+        beginTest ("non recursive");
+        files.clearQuick();
+        index.findFiles (dir, false, "*", files);
+        expectEquals (files.size(), 2);
+        Array<File> subdirs;
+        index.findFolders (dir, subdirs);
+        expectEquals (subdirs.size(), 1);
+        expect (subdirs.getFirst() == dir.getChildFile ("Drums"));
+
+        beginTest ("changes are picked up");
+        dir.getChildFile ("Drums/Toms").createDirectory();
+        dir.getChildFile ("Drums/Toms/tom.wav").replaceWithText ("tom");
+        dir.getChildFile ("kick.wav").deleteFile();
+        index.refresh();
+        expect (index.waitUntilIdle (5000));
+        files.clearQuick();
+        index.findFiles (dir, true, "*.wav", files);
+        expectEquals (files.size(), 2);
+        expect (files.contains (dir.getChildFile ("Drums/Toms/tom.wav")));
+        expect (! files.contains (dir.getChildFile ("kick.wav")));
+
+        beginTest ("rescan");
+        dir.getChildFile ("hat.wav").replaceWithText ("hat");
+        index.rescan (dir);
+        files.clearQuick();
+        index.findFiles (dir, false, "*.wav", files);
+        expect (files.contains (dir.getChildFile ("hat.wav")));
+
+        beginTest ("removed directories");
+        dir.getChildFile ("Drums").deleteRecursively();
+        index.rescan (dir);
+        files.clearQuick();
+        index.findFiles (dir, true, "*.wav", files);
+        expectEquals (files.size(), 1);
+        expect (! index.isIndexed (dir.getChildFile ("Drums/Toms")));
+
+        index.removeDirectory (dir);
+        expect (! index.isIndexed (dir));
+        dir.deleteRecursively();
+    }
+};
+
+static FileIndexTest sFileIndexTest;
+
+}
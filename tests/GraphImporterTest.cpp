@@ -0,0 +1,163 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/GraphImporter.h"
+
+namespace Element {
+
+class GraphImporterTest : public UnitTestBase
+{
+public:
+    GraphImporterTest() : UnitTestBase ("Graph Importer", "session", "graphImporter") { }
+    virtual ~GraphImporterTest() { }
+
+    void runTest() override
+    {
+        testFormats();
+        testBackground();
+    }
+
+private:
+    static ValueTree makeGraph()
+    {
+        auto graph = Node::createDefaultGraph ("Imported").getValueTree();
+        for (int i = 0; i < graph.getChildWithName (Tags::nodes).getNumChildren(); ++i)
+            graph.getChildWithName (Tags::nodes).getChild (i).setProperty (Tags::missing, true, nullptr);
+        return graph;
+    }
+
+    static StringArray collectUuids (const ValueTree& tree)
+    {
+        StringArray uuids;
+        if (tree.hasType (Tags::node))
+            uuids.add (tree.getProperty (Tags::uuid).toString());
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+            uuids.addArray (collectUuids (tree.getChild (i)));
+        return uuids;
+    }
+
+    static bool hasRuntimeProperties (const ValueTree& tree)
+    {
+        if (tree.hasProperty (Tags::missing))
+            return true;
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+            if (hasRuntimeProperties (tree.getChild (i)))
+                return true;
+        return false;
+    }
+
+    void checkImport (const ValueTree& original, const ValueTree& imported)
+    {
+        expect (Node::isProbablyGraphNode (imported));
+        expect (! imported.getParent().isValid());
+        expectEquals (imported.getProperty (Tags::name).toString(), String ("Imported"));
+        const auto before = collectUuids (original);
+        const auto after = collectUuids (imported);
+        expectEquals (after.size(), before.size());
+        for (const auto& uuid : after)
+            expect (uuid.isNotEmpty() && ! before.contains (uuid), "every node gets a new uuid");
+        expect (! hasRuntimeProperties (imported));
+    }
+
+    void testFormats()
+    {
+        const auto graph = makeGraph();
+        String error;
+
+        beginTest ("binary");
+        {
+            TemporaryFile file (".elg");
+            {
+                FileOutputStream out (file.getFile());
+                graph.writeToStream (out);
+            }
+            checkImport (graph, GraphImporter::read (file.getFile(), error));
+        }
+
+        beginTest ("xml");
+        {
+            TemporaryFile file (".elg");
+            expect (file.getFile().replaceWithText (graph.toXmlString()));
+            checkImport (graph, GraphImporter::read (file.getFile(), error));
+        }
+
+        beginTest ("session");
+        {
+            TemporaryFile file (".els");
+            ValueTree session (Tags::session);
+            ValueTree graphs (Tags::graphs);
+            graphs.appendChild (graph.createCopy(), nullptr);
+            session.appendChild (graphs, nullptr);
+            {
+                FileOutputStream out (file.getFile());
+                GZIPCompressorOutputStream gzip (out);
+                session.writeToStream (gzip);
+            }
+            checkImport (graph, GraphImporter::read (file.getFile(), error));
+        }
+
+        beginTest ("not a graph");
+        {
+            TemporaryFile file (".elg");
+            expect (file.getFile().replaceWithText ("<notes/>"));
+            error = String();
+            expect (! GraphImporter::read (file.getFile(), error).isValid());
+            expect (error.isNotEmpty());
+        }
+    }
+
+    void testBackground()
+    {
+        beginTest ("background");
+        const auto graph = makeGraph();
+        TemporaryFile file (".elg");
+        {
+            FileOutputStream out (file.getFile());
+            graph.writeToStream (out);
+        }
+
+        GraphImporter importer;
+        ValueTree imported;
+        int numCallbacks = 0;
+        importer.import (file.getFile(), [&] (const File&, const ValueTree& tree, const String&)
+        {
+            imported = tree;
+            ++numCallbacks;
+        });
+
+        expect (importer.waitUntilIdle (10000));
+        MessageManager::getInstance()->runDispatchLoopUntil (50);
+        expectEquals (numCallbacks, 1);
+        checkImport (graph, imported);
+
+        beginTest ("callbacks don't outlive the importer");
+        numCallbacks = 0;
+        {
+            GraphImporter shortLived;
+            shortLived.import (file.getFile(), [&] (const File&, const ValueTree&, const String&) { ++numCallbacks; });
+            shortLived.waitUntilIdle (10000);
+        }
+        MessageManager::getInstance()->runDispatchLoopUntil (50);
+        expectEquals (numCallbacks, 0);
+    }
+};
+
+static GraphImporterTest sGraphImporterTest;
+
+}
@@ -0,0 +1,86 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "gui/Icons.h"
+
+namespace Element {
+
+class IconCacheTest : public UnitTestBase
+{
+public:
+    IconCacheTest() : UnitTestBase ("Icon Cache", "gui", "iconCache") { }
+    virtual ~IconCacheTest() { }
+
+    void runTest() override
+    {
+        const auto& icons = getIcons();
+        icons.clearImageCache();
+
+        beginTest ("icons are cached per size");
+        draw (Icon (icons.fasCog, Colours::white), 16.f);
+        expectEquals (icons.getNumCachedImages(), 1);
+        draw (Icon (icons.fasCog, Colours::red), 16.f);
+        expectEquals (icons.getNumCachedImages(), 1, "the colour is the brush");
+        draw (Icon (icons.fasCog, Colours::white), 32.f);
+        expectEquals (icons.getNumCachedImages(), 2);
+
+        beginTest ("other paths aren't cached");
+        Path other;
+        other.addEllipse (0.f, 0.f, 10.f, 10.f);
+        expect (! icons.contains (&other));
+        expect (icons.contains (&icons.folder));
+        expect (icons.contains (&icons.fasRectangleLandscape));
+        draw (Icon (other, Colours::white), 16.f);
+        expectEquals (icons.getNumCachedImages(), 2);
+
+        beginTest ("cached icons look like filled ones");
+        const auto cached = draw (Icon (icons.fasCircle, Colours::white), 24.f);
+        Image filled (Image::ARGB, 24, 24, true);
+        {
+            Graphics g (filled);
+            g.setColour (Colours::white);
+            const RectanglePlacement placement (RectanglePlacement::centred | RectanglePlacement::onlyReduceInSize);
+            g.fillPath (icons.fasCircle, placement.getTransformToFit (
+                icons.fasCircle.getBounds(), { 0.f, 0.f, 24.f, 24.f }));
+        }
+        int worst = 0;
+        for (int y = 0; y < 24; ++y)
+            for (int x = 0; x < 24; ++x)
+                worst = jmax (worst, std::abs ((int) cached.getPixelAt (x, y).getAlpha()
+                                             - (int) filled.getPixelAt (x, y).getAlpha()));
+        expect (worst < 64, "worst alpha difference " + String (worst));
+
+        beginTest ("clear");
+        icons.clearImageCache();
+        expectEquals (icons.getNumCachedImages(), 0);
+    }
+
+private:
+    static Image draw (const Icon& icon, float size)
+    {
+        Image image (Image::ARGB, (int) size, (int) size, true);
+        Graphics g (image);
+        icon.draw (g, { 0.f, 0.f, size, size }, false);
+        return image;
+    }
+};
+
+static IconCacheTest sIconCacheTest;
+
+}
@@ -20,8 +20,11 @@
 
 #if 1
 
+#include "engine/MidiPipe.h"
 #include "engine/nodes/LuaNode.h"
+#include "scripting/LuaAllocator.h"
 #include "scripting/LuaBindings.h"
+#include "scripting/LuaBytecodeCache.h"
 #include "sol/sol.hpp"
 
 using namespace Element;
@@ -191,6 +194,101 @@ function node_release()
 end
 )";
 
+static const String blockScript = R"(
+local block = require ('el.block')
+local frames = {}
+
+function node_io_ports()
+    return {
+        audio_ins   = 2,
+        audio_outs  = 2,
+        midi_ins    = 0,
+        midi_outs   = 0
+    }
+end
+
+function node_params()
+    return {}
+end
+
+function node_prepare (rate, size)
+end
+
+function node_render (a, m)
+    block.gain (0.5)
+    block.read (2, frames)
+    for i = 1, #frames do
+        frames[i] = frames[i] * 2.0
+    end
+    block.write (2, frames)
+end
+
+function node_release()
+end
+)";
+
+static const String blockCopyScript = R"(
+local block = require ('el.block')
+
+function node_io_ports()
+    return {
+        audio_ins   = 2,
+        audio_outs  = 2,
+        midi_ins    = 0,
+        midi_outs   = 0
+    }
+end
+
+function node_params()
+    return {}
+end
+
+function node_prepare (rate, size)
+end
+
+function node_render (a, m)
+    block.copy (1, 2)
+end
+
+function node_release()
+end
+)";
+
+static const String midiViewScript = R"(
+local block = require ('el.block')
+
+function node_io_ports()
+    return {
+        audio_ins   = 0,
+        audio_outs  = 0,
+        midi_ins    = 1,
+        midi_outs   = 1
+    }
+end
+
+function node_params()
+    return {}
+end
+
+function node_prepare (rate, size)
+end
+
+function node_render (a, m)
+    for i, frame, status, d1, d2 in block.events (1) do
+        local kind = status & 0xf0
+        if kind == 0x90 or kind == 0x80 then
+            block.setevent (1, i, frame, status, d1 + 12, d2)
+        elseif kind == 0xb0 then
+            block.setevent (1, i, frame, 0)
+        end
+    end
+    block.addevents (1, { 5, 0xe0, 0, 64, 6, 0xe0, 0, 65 })
+end
+
+function node_release()
+end
+)";
+
 //=============================================================================
 class LuaUnitTest : public UnitTestBase
 {
@@ -307,6 +405,443 @@ private:
 
 static LuaNodeValidateTest sLuaNodeValidateTest;
 
+//=============================================================================
+class LuaNodeRenderTest : public UnitTestBase
+{
+public:
+    LuaNodeRenderTest() : UnitTestBase ("Lua Node Render", "LuaNode", "render") { }
+    virtual ~LuaNodeRenderTest() { }
+
+    void runTest() override
+    {
+        auto node = std::make_unique<LuaNode>();
+        AudioSampleBuffer audio (2, 256);
+        MidiBuffer midi;
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+
+        beginTest ("block accessors");
+        expect (node->loadScript (blockScript).wasOk());
+        node->prepareToRender (44100.0, 256);
+        for (int i = 0; i < 2; ++i)
+        {
+            fill (audio);
+            node->render (audio, pipe);
+            expectWithinAbsoluteError (audio.getSample (0, 100), 0.5f * 0.25f, 0.0001f);
+            expectWithinAbsoluteError (audio.getSample (1, 100), -0.75f, 0.0001f);
+        }
+
+        beginTest ("reloaded script renders");
+        expect (node->loadScript (blockCopyScript).wasOk());
+        fill (audio);
+        node->render (audio, pipe);
+        expectWithinAbsoluteError (audio.getSample (0, 100), -0.75f, 0.0001f);
+        expectWithinAbsoluteError (audio.getSample (1, 100), -0.75f, 0.0001f);
+
+        beginTest ("compiles in the background");
+        bool called = false;
+        Result asyncResult = Result::fail ("not called");
+        auto onLoaded = [&called, &asyncResult] (const Result& r) { called = true; asyncResult = r; };
+        node->loadScriptAsync (blockScript, false, false, onLoaded);
+        waitFor (called);
+        expect (called && asyncResult.wasOk());
+        expect (! node->isCompiling());
+        fill (audio);
+        node->render (audio, pipe);
+        expectWithinAbsoluteError (audio.getSample (0, 100), 0.5f * 0.25f, 0.0001f);
+
+        beginTest ("failed background compile keeps the old script");
+        called = false;
+        node->loadScriptAsync (globalSyntaxError, false, false, onLoaded);
+        waitFor (called);
+        expect (called && asyncResult.failed());
+        fill (audio);
+        node->render (audio, pipe);
+        expectWithinAbsoluteError (audio.getSample (0, 100), 0.5f * 0.25f, 0.0001f);
+
+        beginTest ("crossfades while rendering");
+        {
+            struct Renderer : public Thread
+            {
+                Renderer (LuaNode& n) : Thread ("renderer"), node (n) { }
+                void run() override
+                {
+                    AudioSampleBuffer buffer (2, 256);
+                    MidiBuffer midiBuffer;
+                    MidiBuffer* midiBuffers[] = { &midiBuffer };
+                    MidiPipe midiPipe (midiBuffers, 1);
+                    while (! threadShouldExit())
+                    {
+                        fill (buffer);
+                        node.render (buffer, midiPipe);
+                        Thread::sleep (1);
+                    }
+                }
+                LuaNode& node;
+            } renderer (*node);
+
+            renderer.startThread();
+            called = false;
+            node->loadScriptAsync (blockCopyScript, true, true, onLoaded);
+            waitFor (called);
+            renderer.stopThread (1000);
+        }
+        expect (called && asyncResult.wasOk());
+        fill (audio);
+        node->render (audio, pipe);
+        expectWithinAbsoluteError (audio.getSample (0, 100), -0.75f, 0.0001f);
+
+        beginTest ("script profile");
+        const auto profile = node->getScriptProfile();
+        expect (profile.memory.inUse > 0);
+        expect (profile.memory.inUse <= profile.memory.arenaSize);
+        expectEquals (profile.memory.systemAllocations, 0);
+
+        node->releaseResources();
+    }
+
+private:
+    void waitFor (const bool& flag)
+    {
+        for (int i = 0; i < 200 && ! flag; ++i)
+            runDispatchLoop (10);
+    }
+
+    static void fill (AudioSampleBuffer& audio)
+    {
+        FloatVectorOperations::fill (audio.getWritePointer (0), 0.25f, audio.getNumSamples());
+        FloatVectorOperations::fill (audio.getWritePointer (1), -0.75f, audio.getNumSamples());
+    }
+};
+
+static LuaNodeRenderTest sLuaNodeRenderTest;
+
+//=============================================================================
+class LuaNodeMidiViewTest : public UnitTestBase
+{
+public:
+    LuaNodeMidiViewTest() : UnitTestBase ("Lua Node MIDI View", "LuaNode", "midiView") { }
+    virtual ~LuaNodeMidiViewTest() { }
+
+    void runTest() override
+    {
+        auto node = std::make_unique<LuaNode>();
+        expect (node->loadScript (midiViewScript).wasOk());
+        node->prepareToRender (44100.0, 256);
+
+        AudioSampleBuffer audio (1, 256);
+        MidiBuffer midi;
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+
+        beginTest ("rewrites, removes and appends in place");
+        for (int block = 0; block < 2; ++block)
+        {
+            midi.clear();
+            midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 10);
+            midi.addEvent (MidiMessage::controllerEvent (1, 7, 90), 11);
+            midi.addEvent (MidiMessage::noteOff (1, 60), 20);
+            node->render (audio, pipe);
+
+            Array<MidiMessage> messages;
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+                messages.add (msg);
+
+            expectEquals (messages.size(), 4);
+            if (messages.size() != 4)
+                continue;
+            expect (messages[0].isPitchWheel() && messages[0].getTimeStamp() == 5.0);
+            expect (messages[1].isPitchWheel() && messages[1].getTimeStamp() == 6.0);
+            expect (messages[2].isNoteOn() && messages[2].getNoteNumber() == 72);
+            expect (messages[3].isNoteOff() && messages[3].getNoteNumber() == 72);
+        }
+
+        node->releaseResources();
+    }
+};
+
+static LuaNodeMidiViewTest sLuaNodeMidiViewTest;
+
+//=============================================================================
+static const String runawayScript = R"(
+function node_io_ports()
+    return {
+        audio_ins  = 1,
+        audio_outs = 1
+    }
+end
+
+function node_render (audio, midi)
+    local x = 0
+    while true do x = x + 1 end
+end
+)";
+
+class LuaNodeBudgetTest : public UnitTestBase
+{
+public:
+    LuaNodeBudgetTest() : UnitTestBase ("Lua Node Budget", "LuaNode", "budget") { }
+    virtual ~LuaNodeBudgetTest() { }
+
+    void runTest() override
+    {
+        auto node = std::make_unique<LuaNode>();
+        node->setRenderBudget (0.0, 100000);
+        expect (node->loadScript (runawayScript).wasOk());
+        node->prepareToRender (44100.0, 256);
+
+        AudioSampleBuffer audio (1, 256);
+        MidiBuffer midi;
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+
+        beginTest ("runaway script is stopped");
+        audio.clear();
+        node->render (audio, pipe);
+        expectEquals (node->getNumOverruns(), 1);
+
+        beginTest ("node is bypassed");
+        MessageManager::getInstance()->runDispatchLoopUntil (50);
+        expect (node->isSuspended());
+
+        beginTest ("loading a script resumes");
+        expect (node->loadScript (runawayScript).wasOk());
+        expect (! node->isSuspended());
+        expect (node->getInstructionBudget() == 100000);
+
+        node->releaseResources();
+    }
+};
+
+static LuaNodeBudgetTest sLuaNodeBudgetTest;
+
+//=============================================================================
+class LuaAllocatorTest : public UnitTestBase
+{
+public:
+    LuaAllocatorTest() : UnitTestBase ("Lua Allocator", "Lua", "allocator") { }
+    virtual ~LuaAllocatorTest() { }
+
+    void runTest() override
+    {
+        beginTest ("size classes");
+        expectEquals (LuaAllocator::getSizeClass (1), 0);
+        expectEquals (LuaAllocator::getSizeClass (16), 0);
+        expectEquals (LuaAllocator::getSizeClass (17), 1);
+        expectEquals (LuaAllocator::getSizeClass (LuaAllocator::maxBlockSize), 12);
+        expectEquals (LuaAllocator::getSizeClass (LuaAllocator::maxBlockSize + 1), -1);
+
+        beginTest ("state runs from the arena");
+        LuaAllocator allocator (1024 * 1024);
+        {
+            sol::state lua (sol::default_at_panic, LuaAllocator::allocate, &allocator);
+            lua.open_libraries (sol::lib::base, sol::lib::string, sol::lib::table);
+            const char* script = R"(
+                local t = {}
+                for i = 1, 1000 do t[i] = tostring (i) .. "x" end
+                t = nil
+            )";
+            lua.script (script);
+            lua.collect_garbage();
+            expectEquals (allocator.getStats().systemAllocations, 0);
+            expect (allocator.getStats().inUse > 0);
+
+            beginTest ("freed blocks are reused");
+            const auto used = allocator.getStats().arenaUsed;
+            lua.script (script);
+            lua.collect_garbage();
+            expect (allocator.getStats().arenaUsed <= used + used / 10);
+        }
+
+        beginTest ("closed state frees everything");
+        expectEquals ((int64) allocator.getStats().inUse, (int64) 0);
+        expect (allocator.getStats().peak > 0);
+
+        beginTest ("large blocks use the system");
+        void* block = LuaAllocator::allocate (&allocator, nullptr, 0, LuaAllocator::maxBlockSize * 2);
+        expect (block != nullptr && ! allocator.owns (block));
+        expectEquals (allocator.getStats().systemAllocations, 1);
+        LuaAllocator::allocate (&allocator, block, LuaAllocator::maxBlockSize * 2, 0);
+    }
+};
+
+static LuaAllocatorTest sLuaAllocatorTest;
+
+//=============================================================================
+class LuaBytecodeCacheTest : public UnitTestBase
+{
+public:
+    LuaBytecodeCacheTest() : UnitTestBase ("Lua Bytecode Cache", "Lua", "bytecode") { }
+    virtual ~LuaBytecodeCacheTest() { }
+
+    void runTest() override
+    {
+        const auto dir = File::createTempFile ("luacache");
+        const String source = "local x = ... or 20; return x + 22";
+
+        beginTest ("compiles and stores a chunk");
+        {
+            LuaBytecodeCache cache (dir);
+            expect (! cache.contains (source, "=test"));
+            expectEquals (run (cache, source), 42);
+            expect (cache.contains (source, "=test"));
+            expect (! cache.contains (source, "=other"));
+            expectEquals (dir.getNumberOfChildFiles (File::findFiles, "*.luac"), 1);
+        }
+
+        beginTest ("loads stored chunks");
+        {
+            LuaBytecodeCache cache (dir);
+            expect (cache.contains (source, "=test"));
+            expectEquals (run (cache, source), 42);
+        }
+
+        beginTest ("damaged chunks fall back to the source");
+        {
+            dir.getChildFile (LuaBytecodeCache::getKey (source, "=test") + ".luac")
+                .replaceWithText ("not bytecode");
+            LuaBytecodeCache cache (dir);
+            expectEquals (run (cache, source), 42);
+        }
+
+        beginTest ("syntax errors are reported");
+        {
+            LuaBytecodeCache cache (dir);
+            sol::state lua;
+            expect (cache.load (lua, "return +", "=test") != LUA_OK);
+            expect (lua_isstring (lua, -1));
+            expect (! cache.contains ("return +", "=test"));
+        }
+
+        beginTest ("clear");
+        {
+            LuaBytecodeCache cache (dir);
+            cache.clear();
+            expect (! cache.contains (source, "=test"));
+            expectEquals (dir.getNumberOfChildFiles (File::findFiles, "*.luac"), 0);
+        }
+
+        dir.deleteRecursively();
+    }
+
+private:
+    static int run (LuaBytecodeCache& cache, const String& source)
+    {
+        sol::state lua;
+        lua.open_libraries (sol::lib::base);
+        if (cache.load (lua, source, "=test") != LUA_OK)
+            return -1;
+        lua_call (lua, 0, 1);
+        const auto result = (int) lua_tointeger (lua, -1);
+        lua_pop (lua, 1);
+        return result;
+    }
+};
+
+static LuaBytecodeCacheTest sLuaBytecodeCacheTest;
+
+//=============================================================================
+class LuaDSPKernelsTest : public UnitTestBase
+{
+public:
+    LuaDSPKernelsTest() : UnitTestBase ("Lua DSP Kernels", "Lua", "kernels") { }
+    virtual ~LuaDSPKernelsTest() { }
+
+    void runTest() override
+    {
+        sol::state lua;
+        lua.open_libraries (sol::lib::base, sol::lib::math, sol::lib::package);
+        Element::Lua::openDSP (lua);
+
+        beginTest ("vectors");
+        expectEquals (run (lua, R"(
+            local v = dsp.vector (8, 2.0)
+            v[3] = 5.0
+            return #v + v[1] + v[3]
+        )"), 8.0 + 2.0 + 5.0);
+
+        beginTest ("gain, mix and copy");
+        expectEquals (run (lua, R"(
+            local a, b = dsp.vector (4, 1.0), dsp.vector (4, 3.0)
+            dsp.gain (a, 0.5)
+            dsp.mix (a, b, 2.0)
+            dsp.copy (b, a)
+            return b[4]
+        )"), 6.5);
+
+        beginTest ("biquad lowpass passes dc");
+        expectWithinAbsoluteError (run (lua, R"(
+            local v = dsp.vector (4096, 1.0)
+            local f = dsp.biquad()
+            f:lowpass (44100, 1000, 0.7071)
+            f:process (v)
+            return v[4096]
+        )"), 1.0, 0.001);
+
+        beginTest ("biquad highpass blocks dc");
+        expectWithinAbsoluteError (run (lua, R"(
+            local v = dsp.vector (4096, 1.0)
+            local f = dsp.biquad()
+            f:highpass (44100, 1000, 0.7071)
+            f:process (v)
+            return v[4096]
+        )"), 0.0, 0.001);
+
+        beginTest ("one pole");
+        expectWithinAbsoluteError (run (lua, R"(
+            local v = dsp.vector (4096, 1.0)
+            local f = dsp.onepole()
+            f:lowpass (44100, 100)
+            f:process (v)
+            return v[4096]
+        )"), 1.0, 0.001);
+
+        beginTest ("envelope follower");
+        expectWithinAbsoluteError (run (lua, R"(
+            local v = dsp.vector (4410, -0.5)
+            local e = dsp.vector (4410)
+            local f = dsp.follower()
+            f:set (44100, 1, 100)
+            return f:process (v, e) + e[4410] - f:level()
+        )"), 0.5, 0.001);
+
+        beginTest ("fft finds a sine");
+        expectEquals (run (lua, R"(
+            local n = 256
+            local v = dsp.vector (n)
+            for i = 1, n do v[i] = math.sin (2 * math.pi * 8 * (i - 1) / n) end
+            local fft = dsp.fft (8)
+            local mags = dsp.vector (n / 2 + 1)
+            fft:magnitudes (v, mags)
+            local best, bin = 0, 0
+            for i = 1, #mags do
+                if mags[i] > best then best, bin = mags[i], i - 1 end
+            end
+            return bin
+        )"), 8.0);
+
+        beginTest ("channels do nothing outside a node");
+        expectEquals (run (lua, R"(
+            dsp.gain (1, 0.5)
+            return 1
+        )"), 1.0);
+    }
+
+private:
+    double run (sol::state& lua, const char* body)
+    {
+        String code = "local dsp = require ('el.dsp')\n";
+        code << body;
+        auto result = lua.safe_script (code.toRawUTF8(), sol::script_pass_on_error);
+        expect (result.valid());
+        return result.valid() ? result.get<double>() : -1.0;
+    }
+};
+
+static LuaDSPKernelsTest sLuaDSPKernelsTest;
+
 class StaticMethodTest : public UnitTestBase
 {
 public:
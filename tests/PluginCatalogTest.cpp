@@ -0,0 +1,184 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/PluginCatalog.h"
+
+namespace Element {
+
+class PluginCatalogTest : public UnitTestBase
+{
+public:
+    PluginCatalogTest() : UnitTestBase ("Plugin Catalog", "session", "pluginCatalog") { }
+    virtual ~PluginCatalogTest() { }
+
+    void runTest() override
+    {
+        testRoundTrip();
+        testIndices();
+        testInvalidFiles();
+        testLargeList();
+    }
+
+private:
+    static PluginDescription makeType (int uid, const String& format, const String& manufacturer,
+                                       const String& category)
+    {
+        PluginDescription desc;
+        desc.name = String ("Plugin ") + String (uid);
+        desc.descriptiveName = desc.name + " (descriptive)";
+        desc.pluginFormatName = format;
+        desc.category = category;
+        desc.manufacturerName = manufacturer;
+        desc.version = "1.0." + String (uid);
+        desc.fileOrIdentifier = "/plugins/" + format + "/" + desc.name;
+        desc.uid = uid;
+        desc.isInstrument = (uid % 2) == 0;
+        desc.hasSharedContainer = (uid % 3) == 0;
+        desc.numInputChannels = uid % 4;
+        desc.numOutputChannels = 2;
+        desc.lastFileModTime = Time (1500000000000 + uid);
+        desc.lastInfoUpdateTime = Time (1600000000000 + uid);
+        return desc;
+    }
+
+    void testRoundTrip()
+    {
+        beginTest ("round trip");
+        KnownPluginList list;
+        list.addType (makeType (1, "VST", "Kushview", "Effect"));
+        list.addType (makeType (2, "VST3", "Acme", "Synth"));
+        list.addToBlacklist ("/plugins/crashy.so");
+
+        TemporaryFile file (".bin");
+        expect (PluginCatalog::write (list, file.getFile()));
+
+        PluginCatalog catalog;
+        expect (catalog.open (file.getFile()));
+        expectEquals (catalog.getNumTypes(), 2);
+
+        const auto expected = makeType (2, "VST3", "Acme", "Synth");
+        bool found = false;
+        for (int i = 0; i < catalog.getNumTypes(); ++i)
+        {
+            const auto type = catalog.getType (i);
+            if (type.uid != 2)
+                continue;
+            found = true;
+            expectEquals (type.name, expected.name);
+            expectEquals (type.descriptiveName, expected.descriptiveName);
+            expectEquals (type.fileOrIdentifier, expected.fileOrIdentifier);
+            expectEquals (type.version, expected.version);
+            expect (type.isInstrument == expected.isInstrument);
+            expect (type.hasSharedContainer == expected.hasSharedContainer);
+            expectEquals (type.numInputChannels, expected.numInputChannels);
+            expect (type.lastFileModTime == expected.lastFileModTime);
+            expect (type.lastInfoUpdateTime == expected.lastInfoUpdateTime);
+        }
+        expect (found);
+        expect (catalog.getBlacklistedFiles() == StringArray ({ "/plugins/crashy.so" }));
+
+        KnownPluginList restored;
+        catalog.restoreInto (restored);
+        expectEquals (restored.getNumTypes(), 2);
+        expect (restored.getBlacklistedFiles().contains ("/plugins/crashy.so"));
+    }
+
+    void testIndices()
+    {
+        beginTest ("indices");
+        KnownPluginList list;
+        list.addType (makeType (1, "VST", "Kushview", "Effect"));
+        list.addType (makeType (2, "VST3", "Acme", "Synth"));
+        list.addType (makeType (3, "VST3", "kushview", "Effect"));
+
+        TemporaryFile file (".bin");
+        expect (PluginCatalog::write (list, file.getFile()));
+        PluginCatalog catalog;
+        expect (catalog.open (file.getFile()));
+
+        expect (catalog.getKeys (PluginCatalog::byFormat) == StringArray ({ "VST", "VST3" }));
+        expectEquals (catalog.getTypesFor (PluginCatalog::byFormat, "VST3").size(), 2);
+        expectEquals (catalog.getTypesFor (PluginCatalog::byManufacturer, "KUSHVIEW").size(), 2,
+                      "keys are matched ignoring case");
+        expectEquals (catalog.getTypesFor (PluginCatalog::byCategory, "Synth").size(), 1);
+        expect (catalog.getTypesFor (PluginCatalog::byCategory, "Drums").isEmpty());
+
+        for (auto index : catalog.getTypesFor (PluginCatalog::byCategory, "Effect"))
+            expectEquals (catalog.getType (index).category, String ("Effect"));
+    }
+
+    void testInvalidFiles()
+    {
+        beginTest ("invalid files");
+        PluginCatalog catalog;
+        TemporaryFile file (".bin");
+        expect (! catalog.open (file.getFile()), "missing files can't be opened");
+
+        file.getFile().replaceWithText ("<?xml version=\"1.0\"?><KNOWNPLUGINS/>");
+        expect (! catalog.open (file.getFile()), "only catalogs can be opened");
+        expect (! catalog.isOpen());
+
+        KnownPluginList list;
+        list.addType (makeType (1, "VST", "Kushview", "Effect"));
+        expect (PluginCatalog::write (list, file.getFile()));
+        MemoryBlock block;
+        file.getFile().loadFileAsData (block);
+        block.setSize (block.getSize() - 4);
+        file.getFile().replaceWithData (block.getData(), block.getSize());
+        expect (! catalog.open (file.getFile()), "truncated catalogs are rejected");
+    }
+
+    void testLargeList()
+    {
+        beginTest ("large list");
+        KnownPluginList list;
+        for (int i = 0; i < 5000; ++i)
+            list.addType (makeType (i, i % 2 == 0 ? "VST" : "VST3",
+                                    String ("Manufacturer ") + String (i % 50),
+                                    String ("Category ") + String (i % 10)));
+
+        TemporaryFile file (".bin");
+        expect (PluginCatalog::write (list, file.getFile()));
+
+        auto start = Time::getMillisecondCounterHiRes();
+        PluginCatalog catalog;
+        expect (catalog.open (file.getFile()));
+        KnownPluginList restored;
+        catalog.restoreInto (restored);
+        const auto catalogMs = Time::getMillisecondCounterHiRes() - start;
+
+        std::unique_ptr<XmlElement> xml (list.createXml());
+        const auto text = xml->createDocument (String());
+        start = Time::getMillisecondCounterHiRes();
+        KnownPluginList fromXml;
+        if (auto parsed = XmlDocument::parse (text))
+            fromXml.recreateFromXml (*parsed);
+        const auto xmlMs = Time::getMillisecondCounterHiRes() - start;
+
+        logMessage ("restore 5000 types: catalog " + String (catalogMs, 2)
+                    + " ms, xml " + String (xmlMs, 2) + " ms");
+        expectEquals (restored.getNumTypes(), list.getNumTypes());
+        expectEquals (catalog.getKeys (PluginCatalog::byManufacturer).size(), 50);
+        expectEquals (catalog.getTypesFor (PluginCatalog::byCategory, "Category 3").size(), 500);
+    }
+};
+
+static PluginCatalogTest sPluginCatalogTest;
+
+}
@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/VolumeProcessor.h"
+#include "session/PluginInstancePool.h"
+
+namespace Element {
+
+class PluginInstancePoolTest : public UnitTestBase
+{
+public:
+    PluginInstancePoolTest() : UnitTestBase ("Plugin Instance Pool", "session", "pluginInstancePool") { }
+    virtual ~PluginInstancePoolTest() { }
+
+    void runTest() override
+    {
+        testReuse();
+        testBudget();
+        testPlayConfig();
+    }
+
+private:
+    static const int64 megabyte = 1024 * 1024;
+
+    static MemoryBlock getState (AudioProcessor& proc)
+    {
+        MemoryBlock block;
+        proc.getStateInformation (block);
+        return block;
+    }
+
+    void testReuse()
+    {
+        beginTest ("reuse");
+        PluginInstancePool pool;
+        pool.setMemoryBudget (64 * megabyte);
+
+        auto* volume = new VolumeProcessor (-60.0, 12.0, true);
+        const auto desc = volume->getPluginDescription();
+        const auto initialState = getState (*volume);
+        const float initialValue = volume->getParameters()[0]->getValue();
+        volume->getParameters()[0]->setValue (initialValue > 0.5f ? 0.f : 1.f);
+
+        expect (pool.take (desc) == nullptr);
+        pool.park (volume, initialState);
+        expectEquals (pool.size(), 1);
+
+        auto mono = VolumeProcessor (-60.0, 12.0, false).getPluginDescription();
+        expect (pool.take (mono) == nullptr, "other plugins aren't handed out");
+
+        std::unique_ptr<AudioPluginInstance> reused (pool.take (desc));
+        expect (reused.get() == volume);
+        expectWithinAbsoluteError (reused->getParameters()[0]->getValue(), initialValue, 0.001f,
+                                   "the initial state is restored");
+        expectEquals (pool.size(), 0);
+        expectEquals (pool.getMemoryUsed(), (int64) 0);
+    }
+
+    void testBudget()
+    {
+        beginTest ("budget");
+        PluginInstancePool pool;
+        pool.setMemoryBudget (PluginInstancePool::instanceOverhead * 2 + megabyte);
+        for (int i = 0; i < 3; ++i)
+        {
+            auto* volume = new VolumeProcessor (-60.0, 12.0, true);
+            pool.park (volume, getState (*volume));
+        }
+        expectEquals (pool.size(), 2, "the oldest instances are deleted");
+        expect (pool.getMemoryUsed() <= pool.getMemoryBudget());
+
+        pool.setMemoryBudget (0);
+        expectEquals (pool.size(), 0);
+        auto* volume = new VolumeProcessor (-60.0, 12.0, true);
+        pool.park (volume, getState (*volume));
+        expectEquals (pool.size(), 0, "nothing is kept without a budget");
+    }
+
+    void testPlayConfig()
+    {
+        beginTest ("play config");
+        PluginInstancePool pool;
+        pool.setMemoryBudget (64 * megabyte);
+        pool.setPlayConfig (48000.0, 256);
+
+        auto* volume = new VolumeProcessor (-60.0, 12.0, true);
+        const auto desc = volume->getPluginDescription();
+        pool.park (volume, getState (*volume));
+        expectEquals (volume->getSampleRate(), 48000.0);
+        expectEquals (volume->getBlockSize(), 256);
+
+        pool.setPlayConfig (96000.0, 128);
+        std::unique_ptr<AudioPluginInstance> reused (pool.take (desc));
+        expectEquals (reused->getSampleRate(), 96000.0, "parked instances follow the device");
+        expectEquals (reused->getBlockSize(), 128);
+    }
+};
+
+static PluginInstancePoolTest sPluginInstancePoolTest;
+
+}
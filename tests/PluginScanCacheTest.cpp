@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/PluginScanCache.h"
+
+namespace Element {
+
+class PluginScanCacheTest : public UnitTestBase
+{
+public:
+    PluginScanCacheTest() : UnitTestBase ("Plugin Scan Cache", "session", "pluginScanCache") { }
+    virtual ~PluginScanCacheTest() { }
+
+    void runTest() override
+    {
+        testFiles();
+        testBundles();
+        testPersistence();
+    }
+
+private:
+    void testFiles()
+    {
+        beginTest ("files");
+        TemporaryFile plugin (".so");
+        plugin.getFile().replaceWithText ("version one");
+
+        PluginScanCache cache;
+        expect (! cache.isUpToDate (plugin.getFile().getFullPathName()));
+        cache.update ("VST", plugin.getFile().getFullPathName());
+        expect (cache.isUpToDate (plugin.getFile().getFullPathName()));
+
+        plugin.getFile().replaceWithText ("version two!");
+        expect (! cache.isUpToDate (plugin.getFile().getFullPathName()), "changed files need a rescan");
+
+        cache.update ("LV2", "urn:not:a:file");
+        expectEquals (cache.size(), 1, "identifiers that aren't files can't be cached");
+
+        const auto path = plugin.getFile().getFullPathName();
+        plugin.getFile().deleteFile();
+        expect (cache.findRemovedFiles ("VST").contains (path));
+        expect (cache.findRemovedFiles ("VST3").isEmpty());
+    }
+
+    void testBundles()
+    {
+        beginTest ("bundles");
+        TemporaryFile bundle (".vst3");
+        const auto dir = bundle.getFile();
+        dir.getChildFile ("Contents/x86_64-linux").createDirectory();
+        dir.getChildFile ("Contents/x86_64-linux/plugin.so").replaceWithText ("binary");
+
+        PluginScanCache cache;
+        cache.update ("VST3", dir.getFullPathName());
+        expect (cache.isUpToDate (dir.getFullPathName()));
+
+        dir.getChildFile ("Contents/Resources").createDirectory();
+        dir.getChildFile ("Contents/Resources/moduleinfo.json").replaceWithText ("{}");
+        expect (! cache.isUpToDate (dir.getFullPathName()), "a new file in a bundle changes it");
+        dir.deleteRecursively();
+    }
+
+    void testPersistence()
+    {
+        beginTest ("persistence");
+        TemporaryFile plugin (".so");
+        plugin.getFile().replaceWithText ("binary");
+        TemporaryFile file (".xml");
+
+        PluginScanCache cache;
+        cache.update ("VST", plugin.getFile().getFullPathName());
+        expect (cache.save (file.getFile()));
+
+        PluginScanCache restored;
+        expect (restored.load (file.getFile()));
+        expectEquals (restored.size(), 1);
+        expect (restored.isUpToDate (plugin.getFile().getFullPathName()));
+        expect (restored.getFiles ("VST").contains (plugin.getFile().getFullPathName()));
+    }
+};
+
+static PluginScanCacheTest sPluginScanCacheTest;
+
+}
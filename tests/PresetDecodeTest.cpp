@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "controllers/PresetsController.h"
+
+using namespace Element;
+
+class PresetDecodeTest : public UnitTestBase
+{
+public:
+    PresetDecodeTest() : UnitTestBase ("Preset Decoding", "session", "presetDecode") { }
+    virtual ~PresetDecodeTest() { }
+
+    void runTest() override
+    {
+        MemoryBlock state, programState;
+        for (int i = 0; i < 256; ++i)
+        {
+            state.append (&i, 1);
+            programState.append (&i, 1);
+        }
+        programState.setSize (64);
+
+        ValueTree preset (Tags::preset);
+        preset.setProperty (Tags::name, "Bright", nullptr);
+        ValueTree node (Tags::node);
+        node.setProperty (Tags::state, state.toBase64Encoding(), nullptr)
+            .setProperty (Tags::programState, programState.toBase64Encoding(), nullptr);
+        preset.addChild (node, -1, nullptr);
+
+        beginTest ("state is decoded to binary");
+        {
+            TemporaryFile file (".elpreset");
+            expect (file.getFile().replaceWithText (preset.toXmlString()));
+            const auto data = PresetsController::decode (file.getFile());
+            expect (data.hasType (Tags::node));
+            expectEquals (data.getProperty (Tags::name).toString(), String ("Bright"));
+
+            const auto* decodedState = data.getProperty (Tags::state).getBinaryData();
+            expect (decodedState != nullptr && *decodedState == state);
+            const auto* decodedProgram = data.getProperty (Tags::programState).getBinaryData();
+            expect (decodedProgram != nullptr && *decodedProgram == programState);
+        }
+
+        beginTest ("unreadable state is dropped");
+        {
+            node.setProperty (Tags::state, String(), nullptr);
+            TemporaryFile file (".elpreset");
+            expect (file.getFile().replaceWithText (preset.toXmlString()));
+            const auto data = PresetsController::decode (file.getFile());
+            expect (data.isValid());
+            expect (! data.hasProperty (Tags::state));
+            expect (data.hasProperty (Tags::programState));
+        }
+
+        beginTest ("not a preset");
+        {
+            TemporaryFile file (".elpreset");
+            expect (file.getFile().replaceWithText ("not a preset"));
+            expect (! PresetsController::decode (file.getFile()).isValid());
+        }
+    }
+};
+
+static PresetDecodeTest sPresetDecodeTest;
@@ -45,6 +45,7 @@ public:
         pgc->setState (block.getData(), (int) block.getSize());
 
         testMidiStream (node, "Renders mappings after load state");
+        testChannelsAndBanks (node);
 
         pgc = nullptr;
         node = nullptr;
@@ -117,6 +118,63 @@ private:
             ++index;
         }
     }
+
+    void testChannelsAndBanks (GraphNodePtr node)
+    {
+        auto* pgc = dynamic_cast<MidiProgramMapNode*> (node.get());
+        pgc->clear();
+        pgc->addProgramEntry ("All", 1, 2);
+        pgc->addProgramEntry ("Bank", 7, 8);
+        pgc->setProgramEntryBank (1, 300);
+
+        OwnedArray<MidiBuffer> buffers;
+        Array<int> channels;
+        buffers.add (new MidiBuffer());
+        channels.add (0);
+        MidiPipe pipe (buffers, channels);
+        AudioSampleBuffer audio (2, 256);
+        auto* midi = pipe.getWriteBuffer (0);
+
+        beginTest ("single channel entries");
+        pgc->addProgramEntry ("Channel 3", 2, 20);
+        pgc->setProgramEntryChannel (2, 3);
+        expectEquals (pgc->getProgramEntry (1).bank, 300);
+        expectEquals (pgc->getProgramEntry (2).channel, 3);
+
+        midi->addEvent (MidiMessage::programChange (1, 2), 10);
+        midi->addEvent (MidiMessage::programChange (3, 2), 20);
+        midi->addEvent (MidiMessage::programChange (3, 1), 30);
+        node->render (audio, pipe);
+        {
+            MidiBuffer::Iterator iter (*midi);
+            MidiMessage msg; int frame = 0;
+            expect (iter.getNextEvent (msg, frame));
+            expectEquals (msg.getProgramChangeNumber(), 2, "unmapped on channel 1");
+            expect (iter.getNextEvent (msg, frame));
+            expectEquals (msg.getProgramChangeNumber(), 20);
+            expect (iter.getNextEvent (msg, frame));
+            expectEquals (msg.getProgramChangeNumber(), 2, "entries for all channels still apply");
+        }
+
+        beginTest ("14 bit bank select");
+        midi->clear();
+        midi->addEvent (MidiMessage::programChange (5, 7), 30);
+        node->render (audio, pipe);
+        {
+            MidiBuffer::Iterator iter (*midi);
+            MidiMessage msg; int frame = 0;
+            expect (iter.getNextEvent (msg, frame));
+            expect (msg.isController() && msg.getControllerNumber() == 0);
+            expectEquals (msg.getControllerValue(), 300 >> 7);
+            expectEquals (msg.getChannel(), 5);
+            expect (iter.getNextEvent (msg, frame));
+            expect (msg.isController() && msg.getControllerNumber() == 32);
+            expectEquals (msg.getControllerValue(), 300 & 0x7f);
+            expect (iter.getNextEvent (msg, frame));
+            expect (msg.isProgramChange() && msg.getProgramChangeNumber() == 8);
+            expectEquals (frame, 30);
+        }
+    }
 };
 
 static ProgramChangeMapTest sProgramChangeMapTest;
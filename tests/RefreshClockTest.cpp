@@ -0,0 +1,77 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "gui/RefreshClock.h"
+
+using namespace Element;
+
+//=============================================================================
+class RefreshClockTest : public UnitTestBase
+{
+public:
+    RefreshClockTest() : UnitTestBase ("Refresh Clock", "gui", "refreshClock") { }
+
+    void runTest() override
+    {
+        SharedResourcePointer<RefreshClock> clock;
+
+        beginTest ("clients refresh at their rate");
+        {
+            Counter counter;
+            counter.startRefresh (20);
+            expectEquals (clock->getNumClients(), 1);
+            MessageManager::getInstance()->runDispatchLoopUntil (500);
+            expect (counter.count >= 6 && counter.count <= 12, String (counter.count));
+
+            counter.stopRefresh();
+            expectEquals (clock->getNumClients(), 0);
+            const int stopped = counter.count;
+            MessageManager::getInstance()->runDispatchLoopUntil (100);
+            expectEquals (counter.count, stopped);
+        }
+
+        beginTest ("hidden components are skipped");
+        {
+            ComponentCounter hidden;
+            hidden.startRefresh (60);
+            MessageManager::getInstance()->runDispatchLoopUntil (200);
+            expectEquals (hidden.count, 0);
+        }
+
+        beginTest ("clients go when deleted");
+        {
+            std::unique_ptr<Counter> counter (new Counter());
+            counter->startRefresh (30);
+            counter.reset();
+            expectEquals (clock->getNumClients(), 0);
+        }
+    }
+
+private:
+    struct Counter : public RefreshClient
+    {
+        int count = 0;
+        void refreshCallback() override { ++count; }
+    };
+
+    struct ComponentCounter : public Component,
+                              public Counter { };
+};
+
+static RefreshClockTest sRefreshClockTest;
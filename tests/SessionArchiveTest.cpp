@@ -0,0 +1,150 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionArchive.h"
+
+namespace Element {
+
+class SessionArchiveTest : public UnitTestBase
+{
+public:
+    SessionArchiveTest() : UnitTestBase ("Session Archive", "session", "sessionArchive") { }
+    virtual ~SessionArchiveTest() { }
+
+    void runTest() override
+    {
+        testRoundTrip();
+        testInvalidFiles();
+    }
+
+private:
+    static MemoryBlock makeState (int seed, int size)
+    {
+        MemoryBlock block ((size_t) size);
+        Random random (seed);
+        for (int i = 0; i < size; ++i)
+            static_cast<uint8*> (block.getData())[i] = (uint8) random.nextInt (256);
+        return block;
+    }
+
+    static ValueTree makeSession()
+    {
+        ValueTree session (Tags::session);
+        ValueTree graphs (Tags::graphs);
+        ValueTree graph (Tags::node);
+        ValueTree nodes (Tags::nodes);
+        graph.addChild (nodes, -1, nullptr);
+        for (int i = 0; i < 4; ++i)
+        {
+            ValueTree node (Tags::node);
+            node.setProperty (Tags::name, String ("Plugin ") + String (i), nullptr);
+            // two pairs of nodes share a preset
+            node.setProperty (Tags::state, makeState (i / 2, 4096).toBase64Encoding(), nullptr);
+            if (i == 0)
+                node.setProperty (Tags::programState, makeState (99, 128).toBase64Encoding(), nullptr);
+            nodes.addChild (node, -1, nullptr);
+        }
+        graphs.addChild (graph, -1, nullptr);
+        session.addChild (graphs, -1, nullptr);
+        return session;
+    }
+
+    static ValueTree findNode (const ValueTree& session, int index)
+    {
+        return session.getChildWithName (Tags::graphs).getChild (0)
+                      .getChildWithName (Tags::nodes).getChild (index);
+    }
+
+    void testRoundTrip()
+    {
+        beginTest ("round trip");
+        TemporaryFile file (".els");
+        const auto session = makeSession();
+        expect (SessionArchive::write (session, file.getFile()).wasOk());
+        expect (SessionArchive::isArchive (file.getFile()));
+        expect (findNode (session, 0).hasProperty (Tags::state), "the written tree is left alone");
+
+        SessionArchive::Ptr archive (new SessionArchive());
+        expect (archive->open (file.getFile()));
+        expectEquals (archive->getNumChunks(), 3, "identical states share a chunk");
+
+        auto loaded = archive->readSession();
+        expect (loaded.hasType (Tags::session));
+        const auto first = findNode (loaded, 0);
+        expect (! first.hasProperty (Tags::state));
+        expect (first.hasProperty (Tags::stateChunk));
+        expectEquals (first.getProperty (Tags::stateChunk).toString(),
+                      findNode (loaded, 1).getProperty (Tags::stateChunk).toString());
+
+        beginTest ("states on demand");
+        MemoryBlock state;
+        expect (! SessionArchive::readState (first, Tags::state, state),
+                "chunks need the archive on the session");
+        loaded.setProperty (Tags::archive, archive.get(), nullptr);
+        for (int i = 0; i < 4; ++i)
+        {
+            expect (SessionArchive::readState (findNode (loaded, i), Tags::state, state));
+            expect (state == makeState (i / 2, 4096));
+        }
+        expect (SessionArchive::readState (first, Tags::programState, state));
+        expect (state == makeState (99, 128));
+        expect (! SessionArchive::readState (findNode (loaded, 1), Tags::programState, state));
+
+        beginTest ("decoded up front");
+        expectEquals (archive->decodeChunks(), 3);
+        for (int i = 0; i < 4; ++i)
+        {
+            expect (SessionArchive::readState (findNode (loaded, i), Tags::state, state));
+            expect (state == makeState (i / 2, 4096));
+        }
+        expect (SessionArchive::readState (first, Tags::programState, state));
+        expect (state == makeState (99, 128));
+
+        beginTest ("inline states");
+        auto inlineNode = findNode (session, 2);
+        expect (SessionArchive::readState (inlineNode, Tags::state, state));
+        expect (state == makeState (1, 4096));
+        loaded.removeProperty (Tags::archive, nullptr);
+    }
+
+    void testInvalidFiles()
+    {
+        beginTest ("invalid files");
+        SessionArchive archive;
+        TemporaryFile file (".els");
+        expect (! archive.open (file.getFile()), "missing files can't be opened");
+        expect (! SessionArchive::isArchive (file.getFile()));
+
+        file.getFile().replaceWithText ("<?xml version=\"1.0\"?><session/>");
+        expect (! SessionArchive::isArchive (file.getFile()), "old sessions aren't archives");
+        expect (! archive.open (file.getFile()));
+
+        expect (SessionArchive::write (makeSession(), file.getFile()).wasOk());
+        MemoryBlock block;
+        file.getFile().loadFileAsData (block);
+        block.setSize (block.getSize() - 64);
+        file.getFile().replaceWithData (block.getData(), block.getSize());
+        expect (! archive.open (file.getFile()), "truncated archives are rejected");
+        expect (! archive.isOpen());
+    }
+};
+
+static SessionArchiveTest sSessionArchiveTest;
+
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2018-2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class SessionBatchTest : public UnitTestBase,
+                         private ChangeListener
+{
+public:
+    SessionBatchTest() : UnitTestBase ("Session Batch", "session", "batch") { }
+    virtual ~SessionBatchTest() { }
+
+    void initialise() override
+    {
+        initializeWorld();
+        session = getWorld().getSession();
+    }
+
+    void shutdown() override
+    {
+        session = nullptr;
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        GraphNodePtr root = GraphNode::createForRoot (new GraphProcessor());
+        auto* graph = dynamic_cast<GraphProcessor*> (root->getAudioProcessor());
+        graph->setPlayConfigDetails (2, 2, 44100.0, 512);
+        graph->prepareToPlay (44100.0, 512);
+        GraphNodePtr obj = graph->addNode (new VolumeProcessor (-60.0, 12.0, true));
+
+        Node model (Tags::node);
+        model.getValueTree().setProperty (Tags::object, root.get(), nullptr);
+        ValueTree nodes (Tags::nodes);
+        model.getValueTree().addChild (nodes, -1, nullptr);
+        ValueTree nodeData (Tags::node);
+        nodeData.setProperty (Tags::object, obj.get(), nullptr);
+        nodes.addChild (nodeData, -1, nullptr);
+        session->addGraph (model, true);
+
+        NodeObjectSync sync;
+        sync.setNode (Node (nodeData, false));
+        session->addChangeListener (this);
+        runDispatchLoop (20);
+        numChanges = 0;
+
+        beginTest ("outside a batch");
+        nodeData.setProperty (Tags::transpose, 3, nullptr);
+        expectEquals (obj->getTransposeOffset(), 3);
+
+        beginTest ("edits are held");
+        {
+            Session::ScopedBatch batch (*session);
+            expect (session->isBatching());
+            expect (session->notificationsFrozen());
+            expect (graph->isBatchUpdating());
+            for (int i = 0; i < 12; ++i)
+                nodeData.setProperty (Tags::transpose, i - 6, nullptr);
+            expectEquals (obj->getTransposeOffset(), 3);
+
+            {
+                Session::ScopedBatch nested (*session);
+                nodeData.setProperty (Tags::transpose, 7, nullptr);
+            }
+
+            expect (session->isBatching(), "batches nest");
+            expectEquals (obj->getTransposeOffset(), 3);
+        }
+
+        beginTest ("applied when the batch ends");
+        expect (! session->isBatching());
+        expect (! session->notificationsFrozen());
+        expect (! graph->isBatchUpdating());
+        expect (! session->getValueTree().hasProperty (Tags::batch));
+        expectEquals (obj->getTransposeOffset(), 7);
+        runDispatchLoop (20);
+        expectEquals (numChanges, 1, "one change message for the whole batch");
+
+        beginTest ("batches without changes");
+        {
+            Session::ScopedBatch batch (*session);
+        }
+        runDispatchLoop (20);
+        expectEquals (numChanges, 1);
+
+        session->removeChangeListener (this);
+        sync.setNode (Node());
+        session->getValueTree().getChildWithName (Tags::graphs).removeChild (model.getValueTree(), nullptr);
+        Node::sanitizeRuntimeProperties (model.getValueTree(), true);
+        obj = nullptr;
+        graph->clear();
+        root = nullptr;
+    }
+
+private:
+    SessionPtr session;
+    int numChanges = 0;
+
+    void changeListenerCallback (ChangeBroadcaster*) override { ++numChanges; }
+};
+
+static SessionBatchTest sSessionBatchTest;
+
+}
@@ -0,0 +1,114 @@
+/*
+    This file is part of Element
+    Copyright (C) 2018-2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionIndex.h"
+
+namespace Element {
+
+class SessionIndexTest : public UnitTestBase
+{
+public:
+    SessionIndexTest() : UnitTestBase ("Session Index", "session", "sessionIndex") { }
+    virtual ~SessionIndexTest() { }
+
+    void initialise() override
+    {
+        initializeWorld();
+        session = getWorld().getSession();
+    }
+
+    void shutdown() override
+    {
+        session = nullptr;
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        auto graph = makeNode (1);
+        ValueTree nodes (Tags::nodes);
+        graph.getValueTree().addChild (nodes, -1, nullptr);
+        Array<Node> added;
+        for (int i = 0; i < 8; ++i)
+        {
+            added.add (makeNode (10 + i));
+            nodes.addChild (added.getLast().getValueTree(), -1, nullptr);
+        }
+
+        beginTest ("detached graphs");
+        expect (SessionIndex::getFor (graph.getValueTree()) == nullptr);
+        expect (graph.getNodeByUuid (added[3].getUuid()) == added[3]);
+        expect (graph.getNodeById (13) == added[3]);
+
+        beginTest ("nodes in the session");
+        session->addGraph (graph, true);
+        expect (SessionIndex::getFor (graph.getValueTree()) != nullptr);
+        expect (session->findNodeById (graph.getUuid()) == graph);
+        expect (session->findNodeById (added[5].getUuid()) == added[5]);
+        expect (graph.getNodeByUuid (added[5].getUuid()) == added[5]);
+        expect (graph.getNodeById (15) == added[5]);
+        expect (! graph.getNodeById (99).isValid());
+
+        beginTest ("added and removed nodes");
+        auto extra = makeNode (30);
+        nodes.addChild (extra.getValueTree(), -1, nullptr);
+        expect (session->findNodeById (extra.getUuid()) == extra);
+        expect (graph.getNodeById (30) == extra);
+        nodes.removeChild (added[2].getValueTree(), nullptr);
+        expect (! session->findNodeById (added[2].getUuid()).isValid());
+        expect (! graph.getNodeById (12).isValid());
+
+        beginTest ("changed IDs");
+        const Uuid uuid;
+        extra.getValueTree().setProperty (Tags::uuid, uuid.toString(), nullptr);
+        expect (session->findNodeById (uuid) == extra);
+        extra.getValueTree().setProperty (Tags::id, 31, nullptr);
+        expect (graph.getNodeById (31) == extra);
+        expect (! graph.getNodeById (30).isValid());
+
+        beginTest ("controller devices");
+        ControllerDevice device ("Index Test");
+        auto controllers = session->getValueTree().getChildWithName (Tags::controllers);
+        controllers.addChild (device.getValueTree(), -1, nullptr);
+        expect (session->findControllerDeviceById (Uuid (device.getUuidString())).getValueTree() == device.getValueTree());
+        controllers.removeChild (device.getValueTree(), nullptr);
+        expect (! session->findControllerDeviceById (Uuid (device.getUuidString())).isValid());
+
+        beginTest ("snapshots leave the index out");
+        expect (! session->createSnapshot().hasProperty (Tags::sessionIndex));
+
+        session->getValueTree().getChildWithName (Tags::graphs).removeChild (graph.getValueTree(), nullptr);
+        expect (! session->findNodeById (added[5].getUuid()).isValid());
+    }
+
+private:
+    SessionPtr session;
+
+    static Node makeNode (int nodeId)
+    {
+        Node node (Tags::node);
+        node.getValueTree().setProperty (Tags::uuid, Uuid().toString(), nullptr)
+                           .setProperty (Tags::id, nodeId, nullptr);
+        return node;
+    }
+};
+
+static SessionIndexTest sSessionIndexTest;
+
+}
@@ -0,0 +1,130 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionArchive.h"
+#include "session/SessionReader.h"
+
+namespace Element {
+
+class SessionReaderTest : public UnitTestBase
+{
+public:
+    SessionReaderTest() : UnitTestBase ("Session Reader", "session", "sessionReader") { }
+    virtual ~SessionReaderTest() { }
+
+    void runTest() override
+    {
+        testValues();
+        testStates();
+        testMalformed();
+    }
+
+private:
+    static MemoryBlock write (const ValueTree& tree)
+    {
+        MemoryOutputStream out;
+        tree.writeToStream (out);
+        return out.getMemoryBlock();
+    }
+
+    void testValues()
+    {
+        beginTest ("reads what ValueTree writes");
+        ValueTree root ("root");
+        root.setProperty ("int", 42, nullptr);
+        root.setProperty ("negative", -70000, nullptr);
+        root.setProperty ("int64", (int64) 1 << 40, nullptr);
+        root.setProperty ("double", 0.25, nullptr);
+        root.setProperty ("yes", true, nullptr);
+        root.setProperty ("no", false, nullptr);
+        root.setProperty ("text", String (CharPointer_UTF8 ("caf\xc3\xa9")), nullptr);
+        root.setProperty ("empty", String(), nullptr);
+        root.setProperty ("binary", var ("abc", 3), nullptr);
+        Array<var> list;
+        list.add (1, "two", 3.0);
+        root.setProperty ("array", list, nullptr);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            ValueTree child ("child");
+            child.setProperty ("index", i, nullptr);
+            child.addChild (ValueTree ("leaf"), -1, nullptr);
+            root.addChild (child, -1, nullptr);
+        }
+
+        const auto data = write (root);
+        SessionReader reader;
+        const auto tree = reader.read (data.getData(), data.getSize());
+        expect (tree.isEquivalentTo (root));
+        expect (tree.getChild (1).getChild (0).hasType ("leaf"));
+
+        // root, child, leaf and 11 property names
+        expectEquals (reader.getNumInternedNames(), 14);
+
+        MemoryInputStream in (data, false);
+        expect (reader.read (in).isEquivalentTo (root), "reading from a stream");
+        expectEquals (reader.getNumInternedNames(), 14);
+    }
+
+    void testStates()
+    {
+        beginTest ("node states are read as binary");
+        MemoryBlock state;
+        for (int i = 0; i < 1000; ++i)
+            state.append (&i, sizeof (int));
+
+        ValueTree node (Tags::node);
+        node.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+        node.setProperty (Tags::name, "not a state", nullptr);
+        ValueTree other ("other");
+        other.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+        node.addChild (other, -1, nullptr);
+
+        const auto data = write (node);
+        SessionReader reader;
+        const auto tree = reader.read (data.getData(), data.getSize());
+        const auto* block = tree.getProperty (Tags::state).getBinaryData();
+        expect (block != nullptr && *block == state);
+        expectEquals (tree.getProperty (Tags::state).toString(), state.toBase64Encoding());
+        expect (tree.getChild (0).getProperty (Tags::state).isString(), "only nodes are decoded");
+
+        MemoryBlock restored;
+        expect (SessionArchive::readState (tree, Tags::state, restored));
+        expect (restored == state);
+    }
+
+    void testMalformed()
+    {
+        beginTest ("malformed data");
+        SessionReader reader;
+        expect (! reader.read (nullptr, 0).isValid());
+
+        ValueTree root ("root");
+        root.setProperty ("text", "some text", nullptr);
+        root.addChild (ValueTree ("child"), -1, nullptr);
+        const auto data = write (root);
+        for (size_t size = 0; size < data.getSize(); ++size)
+            reader.read (data.getData(), size);
+        expect (reader.read (data.getData(), 5).hasType ("root"), "a truncated tree keeps what was read");
+    }
+};
+
+static SessionReaderTest sSessionReaderTest;
+
+}
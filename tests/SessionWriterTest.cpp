@@ -0,0 +1,99 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionArchive.h"
+#include "session/SessionWriter.h"
+
+namespace Element {
+
+class SessionWriterTest : public UnitTestBase
+{
+public:
+    SessionWriterTest() : UnitTestBase ("Session Writer", "session", "sessionWriter") { }
+    virtual ~SessionWriterTest() { }
+
+    void runTest() override
+    {
+        testSnapshot();
+        testBackground();
+    }
+
+private:
+    static ValueTree makeSession (const String& name, int numGraphs)
+    {
+        ValueTree session (Tags::session);
+        session.setProperty (Tags::name, name, nullptr);
+        ValueTree graphs (Tags::graphs);
+        for (int i = 0; i < numGraphs; ++i)
+            graphs.addChild (Node::createDefaultGraph (String ("Graph ") + String (i)).getValueTree(), -1, nullptr);
+        session.addChild (graphs, -1, nullptr);
+        return session;
+    }
+
+    static ValueTree readBack (const File& file)
+    {
+        SessionArchive archive;
+        return archive.open (file) ? archive.readSession() : ValueTree();
+    }
+
+    void testSnapshot()
+    {
+        beginTest ("snapshot");
+        TemporaryFile file (".els");
+        const auto session = makeSession ("Snapshot", 2);
+        expect (SessionWriter::writeSnapshot (session, file.getFile()).wasOk());
+        expect (readBack (file.getFile()).isEquivalentTo (session));
+
+        const auto missing = File::getSpecialLocation (File::tempDirectory)
+            .getNonexistentChildFile ("missing", "")
+            .getChildFile ("session.els");
+        expect (SessionWriter::writeSnapshot (session, missing).failed());
+    }
+
+    void testBackground()
+    {
+        beginTest ("background");
+        TemporaryFile file (".els");
+        SessionWriter writer;
+        expect (! writer.isWriting());
+        expect (writer.waitUntilIdle (0), "an unused writer is idle");
+
+        for (int i = 0; i < 10; ++i)
+            writer.write (makeSession (String ("Session ") + String (i), 4), file.getFile());
+        expect (writer.waitUntilIdle (10000));
+        expect (! writer.isWriting());
+
+        const auto saved = readBack (file.getFile());
+        expectEquals (saved.getProperty (Tags::name).toString(), String ("Session 9"),
+                      "the last snapshot wins");
+        expectEquals (saved.getChildWithName (Tags::graphs).getNumChildren(), 4);
+
+        beginTest ("pending writes finish");
+        TemporaryFile other (".els");
+        {
+            SessionWriter shortLived;
+            shortLived.write (makeSession ("Pending", 8), other.getFile());
+        }
+        expectEquals (readBack (other.getFile()).getProperty (Tags::name).toString(), String ("Pending"));
+    }
+};
+
+static SessionWriterTest sSessionWriterTest;
+
+}
@@ -0,0 +1,136 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "SettingsWriter.h"
+
+namespace Element {
+
+class SettingsWriterTest : public UnitTestBase
+{
+public:
+    SettingsWriterTest() : UnitTestBase ("Settings Writer", "settings", "settingsWriter") { }
+    virtual ~SettingsWriterTest() { }
+
+    void runTest() override
+    {
+        testFormats();
+        testBackground();
+    }
+
+private:
+    static PropertiesFile::Options makeOptions (PropertiesFile::StorageFormat format)
+    {
+        PropertiesFile::Options opts;
+        opts.applicationName = "SettingsWriterTest";
+        opts.storageFormat = format;
+        opts.millisecondsBeforeSaving = -1;
+        return opts;
+    }
+
+    static StringPairArray makeValues (int revision)
+    {
+        StringPairArray values;
+        values.set ("revision", String (revision));
+        values.set ("keymappings", "<KEYMAPPINGS basedOnDefaults=\"1\"/>");
+        return values;
+    }
+
+    void testFormats()
+    {
+        const PropertiesFile::StorageFormat formats[] = {
+            PropertiesFile::storeAsXML,
+            PropertiesFile::storeAsBinary,
+            PropertiesFile::storeAsCompressedBinary
+        };
+
+        beginTest ("formats");
+        for (const auto format : formats)
+        {
+            TemporaryFile file (".conf");
+            const auto opts = makeOptions (format);
+            expect (SettingsWriter::writeProperties (makeValues (1), file.getFile(), opts));
+            PropertiesFile props (file.getFile(), opts);
+            expectEquals (props.getIntValue ("revision"), 1);
+            expect (props.getXmlValue ("keymappings") != nullptr);
+            expect (! file.getFile().getSiblingFile (file.getFile().getFileName() + ".pending").exists());
+        }
+
+        const auto missing = File::getSpecialLocation (File::tempDirectory)
+            .getNonexistentChildFile ("missing", "")
+            .getChildFile ("settings.conf");
+        expect (! SettingsWriter::writeProperties (makeValues (1), missing,
+                                                   makeOptions (PropertiesFile::storeAsXML)));
+    }
+
+    void testBackground()
+    {
+        beginTest ("background");
+        TemporaryFile file (".conf");
+        const auto opts = makeOptions (PropertiesFile::storeAsCompressedBinary);
+        SettingsWriter writer;
+        expect (! writer.isWriting());
+        expect (writer.flush (0), "an unused writer is idle");
+
+        PropertiesFile source (file.getFile(), opts);
+        for (int i = 0; i < 20; ++i)
+        {
+            source.setValue ("revision", i);
+            writer.write (source, opts);
+        }
+        expect (writer.flush (10000));
+        expect (! writer.isWriting());
+        expectEquals (PropertiesFile (file.getFile(), opts).getIntValue ("revision"), 19,
+                      "the last snapshot wins");
+
+        beginTest ("writes are coalesced");
+        TemporaryFile counted (".txt");
+        Atomic<int> numWrites;
+        {
+            const ScopedLock sl (blocker);
+            writer.write (counted.getFile(), [this] (const File&) { const ScopedLock l (blocker); return true; });
+            Thread::sleep (20);
+            for (int i = 0; i < 10; ++i)
+                writer.write (counted.getFile().getSiblingFile ("other"), [&numWrites] (const File&) { ++numWrites; return true; });
+        }
+        expect (writer.flush (10000));
+        expectEquals (numWrites.get(), 1);
+
+        beginTest ("failures");
+        writer.write (counted.getFile(), [] (const File&) { return false; });
+        expect (writer.flush (10000));
+        expectEquals (writer.getNumFailures(), 1);
+
+        beginTest ("pending writes finish");
+        TemporaryFile other (".conf");
+        {
+            SettingsWriter shortLived;
+            auto values = makeValues (42);
+            shortLived.write (other.getFile(), [values, opts] (const File& f) {
+                return SettingsWriter::writeProperties (values, f, opts);
+            });
+        }
+        expectEquals (PropertiesFile (other.getFile(), opts).getIntValue ("revision"), 42);
+    }
+
+    CriticalSection blocker;
+};
+
+static SettingsWriterTest sSettingsWriterTest;
+
+}
@@ -0,0 +1,88 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SharedPluginList.h"
+
+namespace Element {
+
+class SharedPluginListTest : public UnitTestBase
+{
+public:
+    SharedPluginListTest() : UnitTestBase ("Shared Plugin List", "session", "sharedPluginList") { }
+    virtual ~SharedPluginListTest() { }
+
+    void runTest() override
+    {
+        testSharing();
+        testRestoring();
+        testScanning();
+    }
+
+private:
+    void testSharing()
+    {
+        beginTest ("managers share one list");
+        PluginDescription desc;
+        desc.name = "Shared";
+        desc.pluginFormatName = "VST";
+        desc.fileOrIdentifier = "/plugins/shared.so";
+
+        {
+            PluginManager a, b;
+            a.getKnownPlugins().addType (desc);
+            expect (&a.getKnownPlugins() == &b.getKnownPlugins());
+            expectEquals (b.getKnownPlugins().getNumTypes(), 1);
+        }
+
+        beginTest ("the list goes with the last manager");
+        PluginManager c;
+        expectEquals (c.getKnownPlugins().getNumTypes(), 0);
+    }
+
+    void testRestoring()
+    {
+        beginTest ("the catalog is only read again once replaced");
+        SharedPluginList shared;
+        TemporaryFile file (".bin");
+        file.getFile().replaceWithText ("catalog");
+        expect (shared.needsRestore (file.getFile()));
+        shared.markRestored (file.getFile());
+        expect (! shared.needsRestore (file.getFile()));
+        file.getFile().setLastModificationTime (file.getFile().getLastModificationTime() + RelativeTime::seconds (5));
+        expect (shared.needsRestore (file.getFile()));
+    }
+
+    void testScanning()
+    {
+        beginTest ("one manager scans at a time");
+        SharedResourcePointer<SharedPluginList> shared;
+        PluginManager a, b;
+        expect (shared->beginScan (&a));
+        expect (! shared->beginScan (&b));
+        expect (shared->getScanningManager() == &a);
+        shared->endScan (&a);
+        expect (shared->beginScan (&b));
+        shared->endScan (&b);
+        expect (shared->getScanningManager() == nullptr);
+    }
+};
+
+static SharedPluginListTest sSharedPluginListTest;
+
+}
@@ -0,0 +1,78 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "StartupTimeline.h"
+
+using namespace Element;
+
+//=============================================================================
+class StartupTimelineTest : public UnitTestBase
+{
+public:
+    StartupTimelineTest() : UnitTestBase ("Startup Timeline", "app", "startupTimeline") { }
+
+    void runTest() override
+    {
+        beginTest ("phases are timed in order");
+        StartupTimeline timeline;
+        {
+            StartupTimeline::ScopedPhase phase (timeline, "first");
+            Thread::sleep (5);
+        }
+        {
+            StartupTimeline::ScopedPhase phase (timeline, "second");
+        }
+        auto phases = timeline.getPhases();
+        expectEquals (phases.size(), 2);
+        expectEquals (phases[0].name, String ("first"));
+        expect (phases[0].durationMs >= 4.0);
+        expect (phases[1].startMs >= phases[0].startMs + phases[0].durationMs);
+        expect (! phases[1].parallel);
+
+        beginTest ("tasks run alongside and are waited for");
+        Atomic<int> ran;
+        timeline.launch ("slow", [&ran]() { Thread::sleep (30); ran.set (1); });
+        timeline.launch ("fast", [&ran]() { ran += 2; });
+        timeline.waitFor ("slow");
+        expect ((ran.get() & 1) != 0);
+        timeline.waitForAll();
+        expectEquals (ran.get(), 3);
+
+        phases = timeline.getPhases();
+        expectEquals (phases.size(), 4);
+        int numParallel = 0;
+        for (const auto& phase : phases)
+            if (phase.parallel)
+                ++numParallel;
+        expectEquals (numParallel, 2);
+        for (int i = 1; i < phases.size(); ++i)
+            expect (phases[i].startMs >= phases[i - 1].startMs);
+
+        beginTest ("report");
+        const auto report = timeline.toString();
+        expect (report.startsWith ("startup took"));
+        expect (report.contains ("(parallel)"));
+        expect (timeline.getTotalMs() >= 30.0);
+
+        beginTest ("waiting on unknown tasks returns");
+        timeline.waitFor ("missing");
+    }
+};
+
+static StartupTimelineTest sStartupTimelineTest;
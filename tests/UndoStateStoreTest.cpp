@@ -0,0 +1,90 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/UndoStateStore.h"
+
+namespace Element {
+
+class UndoStateStoreTest : public UnitTestBase
+{
+public:
+    UndoStateStoreTest() : UnitTestBase ("Undo State Store", "session", "undoStateStore") { }
+    virtual ~UndoStateStoreTest() { }
+
+    void runTest() override
+    {
+        UndoStateStore store;
+        const auto preset = makeState (1, 16384).toBase64Encoding();
+
+        beginTest ("round trip");
+        auto node = makeNode (preset);
+        auto snapshot = store.store (node);
+        expect (snapshot.isValid());
+        expectEquals (store.getNumStates(), 2);
+        auto restored = snapshot.restore();
+        expect (restored.isEquivalentTo (node));
+        expect (! restored.hasProperty (Tags::stateChunk));
+        expect (snapshot.getSizeInBytes() < preset.length(), "smaller than the node it holds");
+
+        beginTest ("runtime properties are left out");
+        node.setProperty (Tags::placeholder, true, nullptr);
+        expect (! store.store (node).restore().hasProperty (Tags::placeholder));
+
+        beginTest ("states are shared");
+        {
+            auto other = store.store (makeNode (preset));
+            expectEquals (store.getNumStates(), 2);
+            expect (other.getSizeInBytes() < snapshot.getSizeInBytes() * 2);
+            expect (other.restore().isEquivalentTo (makeNode (preset)));
+        }
+
+        beginTest ("unused states are dropped");
+        snapshot = UndoStateStore::Snapshot();
+        store.purge();
+        expectEquals (store.getNumStates(), 0);
+        expect (! snapshot.restore().isValid());
+    }
+
+private:
+    static MemoryBlock makeState (int seed, int size)
+    {
+        MemoryBlock block ((size_t) size);
+        Random random (seed);
+        for (int i = 0; i < size; ++i)
+            static_cast<uint8*> (block.getData())[i] = (uint8) random.nextInt (256);
+        return block;
+    }
+
+    static ValueTree makeNode (const String& preset)
+    {
+        ValueTree node (Tags::node);
+        node.setProperty (Tags::name, "Plugin", nullptr);
+        node.setProperty (Tags::state, preset, nullptr);
+        ValueTree nodes (Tags::nodes);
+        ValueTree child (Tags::node);
+        child.setProperty (Tags::programState, makeState (2, 256).toBase64Encoding(), nullptr);
+        nodes.addChild (child, -1, nullptr);
+        node.addChild (nodes, -1, nullptr);
+        return node;
+    }
+};
+
+static UndoStateStoreTest sUndoStateStoreTest;
+
+}
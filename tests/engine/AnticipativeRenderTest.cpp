@@ -0,0 +1,218 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/AnticipativeRenderer.h"
+
+namespace Element {
+
+class AnticipativeRenderTest : public UnitTestBase
+{
+public:
+    AnticipativeRenderTest() : UnitTestBase ("Anticipative Rendering", "engine", "renderAhead") { }
+    virtual ~AnticipativeRenderTest() { }
+
+    void runTest() override
+    {
+        testProgram();
+        testRenderer();
+    }
+
+private:
+    static constexpr int blockSize = 128;
+
+    void testProgram()
+    {
+        GraphProcessor graph;
+        TestPlayHead playHead;
+        graph.setPlayHead (&playHead);
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr ramp = graph.addNode (new RampProcessor());
+        ramp->getAudioProcessor()->setPlayHead (&playHead);
+        graph.prepareToPlay (44100.0, blockSize);
+        ramp->connectAudioTo (output);
+        graph.handleUpdateNowIfNeeded();
+
+        beginTest ("processed until asked");
+        expect (findOp (graph, ramp, "process"));
+        expect (! findOp (graph, ramp, "ahead"));
+
+        beginTest ("rendered ahead");
+        ramp->setRenderAhead (true);
+        graph.handleUpdateNowIfNeeded();
+        expect (findOp (graph, ramp, "ahead"));
+        playHead.info.isPlaying = true;
+        playHead.info.timeInSamples = 1000;
+        expectEquals (render (graph), 1000.f + (float) (blockSize - 1));
+
+        beginTest ("live inputs keep it on the audio thread");
+        input->connectAudioTo (ramp);
+        graph.handleUpdateNowIfNeeded();
+        expect (! findOp (graph, ramp, "ahead"));
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    void testRenderer()
+    {
+        GraphProcessor graph;
+        TestPlayHead playHead;
+        graph.setPlayHead (&playHead);
+        graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+        GraphNodePtr ramp = graph.addNode (new RampProcessor());
+        ramp->getAudioProcessor()->setPlayHead (&playHead);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        const int capacity = AnticipativeRenderer::numBlocksAhead * blockSize;
+        AudioSampleBuffer audio (2, blockSize);
+        playHead.info.isPlaying = true;
+
+        {
+            AnticipativeRenderer renderer (graph, ramp, 2, 2, blockSize);
+
+            beginTest ("the first block renders in the callback");
+            renderer.read (audio, blockSize);
+            expectEquals (audio.getSample (0, blockSize - 1), (float) (blockSize - 1));
+            expectEquals (renderer.getNumMisses(), 1);
+
+            beginTest ("workers fill the ring");
+            expect (waitUntilAhead (renderer, capacity));
+
+            beginTest ("blocks ahead follow the transport");
+            for (int i = 1; i <= AnticipativeRenderer::numBlocksAhead; ++i)
+            {
+                playHead.info.timeInSamples = i * blockSize;
+                renderer.read (audio, blockSize);
+                expectEquals (audio.getSample (0, 0), (float) (i * blockSize));
+                expectEquals (audio.getSample (1, blockSize - 1), (float) ((i + 1) * blockSize - 1));
+            }
+            expectEquals (renderer.getNumMisses(), 1);
+            expect (waitUntilAhead (renderer, capacity));
+
+            beginTest ("jumps start over");
+            playHead.info.timeInSamples = 10000;
+            renderer.read (audio, blockSize);
+            expectEquals (audio.getSample (0, 0), 10000.f);
+            expectEquals (renderer.getNumMisses(), 2);
+            expect (waitUntilAhead (renderer, capacity));
+
+            beginTest ("retired renderers stop");
+            renderer.setRetired (true);
+            playHead.info.timeInSamples = 10000 + blockSize;
+            renderer.read (audio, blockSize);
+            expectEquals (audio.getSample (0, 0), 10000.f + (float) blockSize);
+            Thread::sleep (20);
+            expectEquals (renderer.getNumSamplesAhead(), capacity - blockSize);
+        }
+
+        beginTest ("the play head is put back");
+        expect (ramp->getAudioProcessor()->getPlayHead() == &playHead);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    static bool waitUntilAhead (AnticipativeRenderer& renderer, const int numSamples)
+    {
+        for (int i = 0; i < 2000 && renderer.getNumSamplesAhead() < numSamples; ++i)
+            Thread::sleep (1);
+        return renderer.getNumSamplesAhead() >= numSamples;
+    }
+
+    /** Returns true if the node renders with an op of the type */
+    static bool findOp (GraphProcessor& graph, const GraphNodePtr& node, const String& type)
+    {
+        if (auto* const ops = graph.getRenderProgramInfo()["ops"].getArray())
+            for (const auto& op : *ops)
+                if (op["op"].toString() == type && (int) op["node"] == (int) node->nodeId)
+                    return true;
+        return false;
+    }
+
+    /** Renders a block, returning the last sample of the first channel */
+    static float render (GraphProcessor& graph)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        audio.clear();
+        graph.processBlock (audio, midi);
+        return audio.getSample (0, blockSize - 1);
+    }
+
+    struct TestPlayHead : public AudioPlayHead
+    {
+        TestPlayHead() { info.resetToDefault(); }
+
+        bool getCurrentPosition (CurrentPositionInfo& result) override
+        {
+            result = info;
+            return true;
+        }
+
+        CurrentPositionInfo info;
+    };
+
+    /** Writes the transport's position into every sample, ignoring its input */
+    class RampProcessor : public BaseProcessor
+    {
+    public:
+        RampProcessor()
+            : BaseProcessor (BusesProperties().withInput ("Main", AudioChannelSet::stereo(), true)
+                                              .withOutput ("Main", AudioChannelSet::stereo(), true)) { }
+
+        const String getName() const override { return "Ramp"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            AudioPlayHead::CurrentPositionInfo pos;
+            pos.resetToDefault();
+            if (auto* playHead = getPlayHead())
+                playHead->getCurrentPosition (pos);
+
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    buffer.setSample (ch, i, (float) (pos.timeInSamples + i));
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+};
+
+static AnticipativeRenderTest sAnticipativeRenderTest;
+
+}
@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/AudioCache.h"
+
+namespace Element {
+
+class AudioCacheTest : public UnitTestBase
+{
+public:
+    AudioCacheTest() : UnitTestBase ("Audio Cache", "engine", "audioCache") { }
+    virtual ~AudioCacheTest() { }
+
+    void runTest() override
+    {
+        AudioFormatManager formats;
+        formats.registerBasicFormats();
+        TemporaryFile first (".wav"), second (".wav");
+        writeConstant (first.getFile(), 0.25f, 4096);
+        writeConstant (second.getFile(), 0.5f, 4096);
+        const int64 entrySize = 2 * 4096 * (int64) sizeof (float);
+
+        AudioCache cache;
+
+        beginTest ("decoded once and shared");
+        auto a = cache.load (first.getFile(), formats, 1 << 20);
+        expect (a != nullptr);
+        expect (cache.load (first.getFile(), formats, 1 << 20) == a);
+        expectEquals (cache.getNumEntries(), 1);
+        expectEquals (cache.getSizeInBytes(), entrySize);
+
+        beginTest ("too long to cache");
+        expect (cache.load (second.getFile(), formats, 1024) == nullptr);
+        expectEquals (cache.getNumEntries(), 1);
+
+        beginTest ("held entries survive the budget");
+        cache.setBudget (0);
+        expectEquals (cache.getNumEntries(), 1);
+        a = nullptr;
+        cache.purge();
+        expectEquals (cache.getNumEntries(), 0);
+        expectEquals (cache.getSizeInBytes(), (int64) 0);
+
+        beginTest ("least recently used is evicted");
+        cache.setBudget (entrySize);
+        cache.load (first.getFile(), formats, 1 << 20);
+        cache.load (second.getFile(), formats, 1 << 20);
+        expectEquals (cache.getNumEntries(), 1);
+        expect (cache.find (first.getFile()) == nullptr);
+        expect (cache.find (second.getFile()) != nullptr);
+
+        beginTest ("changed files are decoded again");
+        auto old = cache.find (second.getFile());
+        second.getFile().setLastModificationTime (Time::getCurrentTime() + RelativeTime::seconds (10));
+        expect (cache.find (second.getFile()) == nullptr);
+        auto fresh = cache.load (second.getFile(), formats, 1 << 20);
+        expect (fresh != nullptr && fresh != old);
+
+        beginTest ("source");
+        CachedAudioSource source (fresh, true);
+        AudioBuffer<float> buffer (2, 1024);
+        source.setNextReadPosition (4096 - 512);
+        source.getNextAudioBlock (AudioSourceChannelInfo (buffer));
+        expectWithinAbsoluteError (buffer.getSample (0, 0), 0.5f, 0.01f);
+        expectWithinAbsoluteError (buffer.getSample (1, 1023), 0.5f, 0.01f);
+        expectEquals (source.getNextReadPosition(), (int64) 512);
+        source.setLooping (false);
+        source.setNextReadPosition (4096 - 512);
+        source.getNextAudioBlock (AudioSourceChannelInfo (buffer));
+        expectEquals (buffer.getSample (0, 1023), 0.f);
+    }
+
+private:
+    static void writeConstant (const File& file, float value, int numFrames)
+    {
+        AudioBuffer<float> buffer (2, numFrames);
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+            FloatVectorOperations::fill (buffer.getWritePointer (c), value, numFrames);
+
+        WavAudioFormat format;
+        file.deleteFile();
+        std::unique_ptr<AudioFormatWriter> writer (format.createWriterFor (
+            new FileOutputStream (file), 44100.0, 2, 16, {}, 0));
+        writer->writeFromAudioSampleBuffer (buffer, 0, numFrames);
+    }
+};
+
+static AudioCacheTest sAudioCacheTest;
+
+}
@@ -0,0 +1,124 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/AudioFilePlayerNode.h"
+
+namespace Element {
+
+class AudioFilePlayerTest : public UnitTestBase
+{
+public:
+    AudioFilePlayerTest() : UnitTestBase ("Audio File Player", "engine", "audioFilePlayer") { }
+    virtual ~AudioFilePlayerTest() { }
+
+    void runTest() override
+    {
+        TemporaryFile wav (".wav");
+        writeConstant (wav.getFile(), 0.5f, 44100 * 2);
+
+        testMode (wav.getFile(), AudioFilePlayerNode::MemoryMapped, "memory mapped");
+        testMode (wav.getFile(), AudioFilePlayerNode::InMemory, "in memory");
+
+        beginTest ("streamed");
+        AudioFilePlayerNode player;
+        player.prepareToPlay (44100.0, 512);
+        open (player, wav.getFile());
+        expect (player.isStreaming());
+
+        beginTest ("midi start plays from its frame");
+        player.setCues ({ 1.0 });
+        expectEquals (player.getCues().size(), 1);
+        expect (player.waitUntilLoaded (5000));
+        player.setRespondToStartStopContinue (true);
+        AudioBuffer<float> buffer (2, 512);
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::midiStart(), 256);
+        player.processBlock (buffer, midi);
+        expectEquals (buffer.getMagnitude (0, 0, 256), 0.f);
+        expectWithinAbsoluteError (buffer.getSample (0, 384), 0.5f, 0.01f);
+        expect (player.getPlayer().isPlaying());
+        player.releaseResources();
+
+        beginTest ("files open without a render thread");
+        AudioFilePlayerNode unprepared;
+        unprepared.openFile (wav.getFile());
+        expect (unprepared.getPlayer().getTotalLength() > 0);
+        unprepared.openFile (File::getCurrentWorkingDirectory().getChildFile ("missing.wav"));
+        expect (unprepared.getAudioFile() == wav.getFile());
+        expect (unprepared.getPlayer().getTotalLength() > 0);
+    }
+
+private:
+    /** Opens a file in the background and swaps it in with a block */
+    void open (AudioFilePlayerNode& player, const File& file)
+    {
+        player.openFile (file);
+        expectEquals (player.getPlayer().getTotalLength(), (int64) 0);
+        expect (player.waitUntilLoaded (5000));
+
+        AudioBuffer<float> buffer (2, 512);
+        MidiBuffer midi;
+        player.processBlock (buffer, midi);
+        expect (player.getPlayer().getTotalLength() > 0);
+    }
+
+    static void writeConstant (const File& file, float value, int numFrames)
+    {
+        AudioBuffer<float> buffer (2, numFrames);
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+            FloatVectorOperations::fill (buffer.getWritePointer (c), value, numFrames);
+
+        WavAudioFormat format;
+        file.deleteFile();
+        std::unique_ptr<AudioFormatWriter> writer (format.createWriterFor (
+            new FileOutputStream (file), 44100.0, 2, 16, {}, 0));
+        writer->writeFromAudioSampleBuffer (buffer, 0, numFrames);
+    }
+
+    void testMode (const File& file, AudioFilePlayerNode::LoadMode mode, const String& name)
+    {
+        beginTest (name);
+        AudioFilePlayerNode player;
+        player.prepareToPlay (44100.0, 512);
+        player.setLoadMode (mode);
+        open (player, file);
+        expect (! player.isStreaming());
+        expect (player.getPlayer().getTotalLength() > 0);
+
+        // there's no read ahead, so audio is there in the first block
+        player.getParameters()[AudioFilePlayerNode::Playing]->setValueNotifyingHost (1.f);
+        AudioBuffer<float> buffer (2, 512);
+        MidiBuffer midi;
+        player.processBlock (buffer, midi);
+        expectWithinAbsoluteError (buffer.getSample (0, 256), 0.5f, 0.01f);
+
+        // and so is audio right after seeking
+        player.getPlayer().setPosition (1.5);
+        player.processBlock (buffer, midi);
+        expectWithinAbsoluteError (buffer.getSample (1, 256), 0.5f, 0.01f);
+        expectWithinAbsoluteError (player.getPlayer().getCurrentPosition(), 1.5 + 512.0 / 44100.0, 0.001);
+
+        player.getParameters()[AudioFilePlayerNode::Playing]->setValueNotifyingHost (0.f);
+        player.releaseResources();
+    }
+};
+
+static AudioFilePlayerTest sAudioFilePlayerTest;
+
+}
@@ -0,0 +1,108 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/AudioMixerProcessor.h"
+
+namespace Element {
+
+class AudioMixerTest : public UnitTestBase
+{
+public:
+    AudioMixerTest() : UnitTestBase ("Audio Mixer", "engine", "audioMixer") { }
+    virtual ~AudioMixerTest() { }
+
+    void runTest() override
+    {
+        for (const int numTracks : { 1, 4, 7 })
+        {
+            beginTest ("sums " + String (numTracks) + " tracks with gains and mutes");
+            AudioMixerProcessor mixer (numTracks, sampleRate, blockSize);
+            mixer.prepareToPlay (sampleRate, blockSize);
+            expectEquals (mixer.getNumTracks(), numTracks);
+
+            for (int t = 0; t < numTracks; ++t)
+                mixer.setTrackGain (t, 0.25f * (float) (t + 1));
+            mixer.setTrackMuted (numTracks - 1, numTracks > 1);
+            expect (mixer.isTrackMuted (numTracks - 1) == (numTracks > 1));
+            expectEquals (mixer.getTrackGain (0), 0.25f);
+
+            // the first block ramps to the new gains
+            AudioBuffer<float> audio;
+            process (mixer, audio, numTracks);
+            process (mixer, audio, numTracks);
+
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int i = 0; i < blockSize; i += 17)
+                {
+                    float expected = 0.f;
+                    for (int t = 0; t < numTracks; ++t)
+                        if (numTracks == 1 || t != numTracks - 1)
+                            expected += getSample (t, c, i) * 0.25f * (float) (t + 1);
+                    expectWithinAbsoluteError (audio.getSample (c, i), expected, 1.0e-5f);
+                }
+            }
+        }
+
+        beginTest ("levels are only measured while metering");
+        {
+            AudioMixerProcessor mixer (2, sampleRate, blockSize);
+            mixer.prepareToPlay (sampleRate, blockSize);
+            auto monitor = mixer.getMonitor (0);
+            AudioBuffer<float> audio;
+
+            for (int i = 0; i < 32; ++i)
+                process (mixer, audio, 2);
+            expectEquals (monitor->getLevel (0), 0.f);
+
+            mixer.beginMetering();
+            for (int i = 0; i < 32; ++i)
+                process (mixer, audio, 2);
+            mixer.endMetering();
+            expectGreaterThan (monitor->getLevel (0), 0.f);
+            expectGreaterThan (mixer.getMonitor()->getLevel (0), 0.f);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 44100.0;
+    static constexpr int blockSize = 256;
+
+    static float getSample (int track, int channel, int frame)
+    {
+        return std::sin ((float) (frame + 1) * 0.01f * (float) (track * 2 + channel + 1));
+    }
+
+    static void process (AudioProcessor& proc, AudioBuffer<float>& audio, int numTracks)
+    {
+        audio.setSize (jmax (2, numTracks * 2), blockSize);
+        for (int t = 0; t < numTracks; ++t)
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < blockSize; ++i)
+                    audio.setSample (t * 2 + c, i, getSample (t, c, i));
+
+        MidiBuffer midi;
+        proc.processBlock (audio, midi);
+    }
+};
+
+static AudioMixerTest sAudioMixerTest;
+
+}
@@ -0,0 +1,84 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/AudioRecorderNode.h"
+
+namespace Element {
+
+class AudioRecorderTest : public UnitTestBase
+{
+public:
+    AudioRecorderTest() : UnitTestBase ("Audio Recorder", "engine", "audioRecorder") { }
+    virtual ~AudioRecorderTest() { }
+
+    void runTest() override
+    {
+        TemporaryFile wav (".wav");
+        AudioRecorderNode recorder (2);
+
+        beginTest ("not prepared");
+        expect (! recorder.startRecording (wav.getFile()));
+        expect (! recorder.isRecording());
+
+        beginTest ("recording");
+        recorder.setPlayConfigDetails (2, 2, 44100.0, 512);
+        recorder.prepareToPlay (44100.0, 512);
+        expect (recorder.startRecording (wav.getFile()));
+        expect (recorder.isRecording());
+
+        AudioBuffer<float> buffer (2, 512);
+        MidiBuffer midi;
+        for (int block = 0; block < 100; ++block)
+        {
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                FloatVectorOperations::fill (buffer.getWritePointer (c), c == 0 ? 0.25f : -0.5f, 512);
+            recorder.processBlock (buffer, midi);
+        }
+
+        // passed through untouched
+        expectEquals (buffer.getSample (0, 10), 0.25f);
+        expectEquals (recorder.getNumOverruns(), 0);
+        recorder.stopRecording();
+        expect (! recorder.isRecording());
+
+        WavAudioFormat format;
+        std::unique_ptr<AudioFormatReader> reader (format.createReaderFor (new FileInputStream (wav.getFile()), true));
+        expect (reader != nullptr);
+        if (reader == nullptr)
+            return;
+        expectEquals ((int) reader->numChannels, 2);
+        expectEquals ((int) reader->lengthInSamples, 100 * 512);
+
+        AudioBuffer<float> recorded (2, 512);
+        reader->read (&recorded, 0, 512, 40000, true, true);
+        expectWithinAbsoluteError (recorded.getSample (0, 100), 0.25f, 0.001f);
+        expectWithinAbsoluteError (recorded.getSample (1, 100), -0.5f, 0.001f);
+
+        beginTest ("new files are named after the time");
+        recorder.setDirectory (wav.getFile().getParentDirectory());
+        expect (recorder.createNewFile().getFileName().startsWith ("Recording "));
+        expect (recorder.createNewFile().hasFileExtension ("wav"));
+        recorder.setFileFormat (AudioRecorderNode::AIFF);
+        expect (recorder.createNewFile().hasFileExtension ("aiff"));
+    }
+};
+
+static AudioRecorderTest sAudioRecorderTest;
+
+}
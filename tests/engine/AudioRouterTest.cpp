@@ -0,0 +1,103 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiPipe.h"
+#include "engine/nodes/AudioRouterNode.h"
+
+namespace Element {
+
+class AudioRouterTest : public UnitTestBase
+{
+public:
+    AudioRouterTest() : UnitTestBase ("Audio Router", "engine", "audioRouter") { }
+    virtual ~AudioRouterTest() { }
+
+    void runTest() override
+    {
+        const int blockSize = 256;
+        AudioRouterNode router (4, 4);
+        router.setFadeLength (0.001);
+        router.prepareToRender (44100.0, blockSize);
+
+        MatrixState state (4, 4);
+        state.set (0, 1, true);
+        state.set (2, 3, true);
+        router.setMatrixState (state);
+
+        beginTest ("patches route audio");
+        AudioSampleBuffer audio (4, blockSize);
+        render (router, audio);
+        expectOutputs (audio, 0.f, 1.f, 0.f, 3.f);
+        expectEquals (router.getNumActivePatches(), 2);
+
+        beginTest ("changes fade");
+        state.set (2, 3, false);
+        state.set (3, 2, true);
+        router.setMatrixState (state);
+        render (router, audio);
+        // 1 ms is 44 frames, the rest of the block is settled
+        expect (audio.getSample (3, 10) > 0.f && audio.getSample (3, 10) < 3.f);
+        expect (audio.getSample (2, 10) > 0.f && audio.getSample (2, 10) < 4.f);
+        expectEquals (audio.getSample (3, blockSize - 1), 0.f);
+        expectEquals (audio.getSample (2, blockSize - 1), 4.f);
+        expectEquals (audio.getSample (1, 0), 1.f, "unchanged patches don't fade");
+
+        beginTest ("faded patches are removed");
+        render (router, audio);
+        expectOutputs (audio, 0.f, 1.f, 4.f, 0.f);
+        expectEquals (router.getNumActivePatches(), 2);
+
+        beginTest ("resizing cuts over");
+        router.setSize (2, 2);
+        MatrixState small (2, 2);
+        small.set (1, 0, true);
+        router.setMatrixState (small);
+        AudioSampleBuffer stereo (2, blockSize);
+        render (router, stereo);
+        expectEquals (stereo.getSample (0, 0), 2.f);
+        expectEquals (stereo.getSample (1, 0), 0.f);
+        expectEquals (router.getNumActivePatches(), 1);
+    }
+
+private:
+    void render (AudioRouterNode& router, AudioSampleBuffer& audio)
+    {
+        // channel N carries N + 1
+        for (int c = 0; c < audio.getNumChannels(); ++c)
+            FloatVectorOperations::fill (audio.getWritePointer (c), (float) (c + 1), audio.getNumSamples());
+        MidiBuffer midi;
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+        router.render (audio, pipe);
+    }
+
+    void expectOutputs (const AudioSampleBuffer& audio, float a, float b, float c, float d)
+    {
+        const float expected[] = { a, b, c, d };
+        for (int ch = 0; ch < 4; ++ch)
+            for (int i = 0; i < audio.getNumSamples(); ++i)
+                if (audio.getSample (ch, i) != expected[ch])
+                    return expectEquals (audio.getSample (ch, i), expected[ch]);
+    }
+};
+
+static AudioRouterTest sAudioRouterTest;
+
+}
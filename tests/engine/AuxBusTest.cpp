@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/AuxBusNodes.h"
+
+namespace Element {
+
+class AuxBusTest : public UnitTestBase
+{
+public:
+    AuxBusTest() : UnitTestBase ("Aux Buses", "engine", "auxBus") { }
+    virtual ~AuxBusTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+
+        // added before the send, so only the bus puts it after
+        auto* const ret = new AuxReturnNode();
+        GraphNodePtr returnNode = graph.addNode (ret);
+        auto* const send = new AuxSendNode();
+        GraphNodePtr sendNode = graph.addNode (send);
+        graph.prepareToPlay (44100.0, blockSize);
+        input->connectAudioTo (sendNode);
+        returnNode->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("sends reach returns without wires");
+        expectEquals (graph.getAuxBuses().getNumBuses(), 1);
+        expectWithinAbsoluteError (settle (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("send level");
+        setDecibels (*send, "send", -6.f);
+        expectWithinAbsoluteError (settle (graph), 0.5f * Decibels::decibelsToGain (-6.f), 1.0e-5f);
+        setDecibels (*send, "send", 0.f);
+
+        beginTest ("post and pre level");
+        setDecibels (*send, "level", -12.f);
+        expectWithinAbsoluteError (settle (graph), 0.5f * Decibels::decibelsToGain (-12.f), 1.0e-5f);
+        *dynamic_cast<AudioParameterBool*> (send->getParameters()[2]) = true;
+        expectWithinAbsoluteError (settle (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("sends of one bus add up");
+        GraphNodePtr second = graph.addNode (new AuxSendNode());
+        input->connectAudioTo (second);
+        graph.handleUpdateNowIfNeeded();
+        expectWithinAbsoluteError (settle (graph), 1.f, 1.0e-6f);
+
+        beginTest ("returns of other buses are silent");
+        ret->setBusName ("Aux 2");
+        graph.handleUpdateNowIfNeeded();
+        expectEquals (graph.getAuxBuses().getNumBuses(), 2);
+        expectEquals (settle (graph), 0.f);
+        ret->setBusName ("Aux 1");
+        graph.handleUpdateNowIfNeeded();
+        expectWithinAbsoluteError (settle (graph), 1.f, 1.0e-6f);
+
+        beginTest ("removed sends stop sending");
+        graph.removeNode (second->nodeId);
+        expectWithinAbsoluteError (settle (graph), 0.5f, 1.0e-6f);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    static void setDecibels (AudioProcessor& proc, const String& id, float db)
+    {
+        for (auto* param : proc.getParameters())
+            if (auto* ranged = dynamic_cast<AudioParameterFloat*> (param))
+                if (ranged->paramID == id)
+                    *ranged = db;
+    }
+
+    /** Renders blocks of 0.5 until ramps finish, returning the last sample
+        of the first channel */
+    static float settle (GraphProcessor& graph)
+    {
+        float last = 0.f;
+        for (int i = 0; i < 8; ++i)
+        {
+            AudioSampleBuffer audio (2, blockSize);
+            MidiBuffer midi;
+            for (int ch = 0; ch < 2; ++ch)
+                FloatVectorOperations::fill (audio.getWritePointer (ch), 0.5f, blockSize);
+            graph.processBlock (audio, midi);
+            last = audio.getSample (0, blockSize - 1);
+        }
+        return last;
+    }
+};
+
+static AuxBusTest sAuxBusTest;
+
+}
@@ -0,0 +1,110 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/PlaceholderProcessor.h"
+
+namespace Element {
+
+class BatchUpdateTest : public UnitTestBase
+{
+public:
+    BatchUpdateTest() : UnitTestBase ("Batch Update", "engine", "batchUpdate") { }
+    virtual ~BatchUpdateTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        graph.prepareToPlay (44100.0, 512);
+        AudioSampleBuffer audio (2, 512);
+        MidiBuffer midi;
+
+        beginTest ("rebuilds are held");
+        graph.beginBatchUpdate();
+        expect (graph.isBatchUpdating());
+        const int builds = graph.getNumRenderBuilds();
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        Array<GraphNodePtr> placeholders;
+        for (int i = 0; i < 4; ++i)
+        {
+            GraphNodePtr placeholder = graph.addNode (new PlaceholderProcessor (2, 2, false, false));
+            input->connectAudioTo (placeholder);
+            placeholder->connectAudioTo (output);
+            placeholders.add (placeholder);
+        }
+        graph.handleUpdateNowIfNeeded();
+        expectEquals (graph.getNumRenderBuilds(), builds);
+
+        beginTest ("one rebuild when released");
+        graph.endBatchUpdate();
+        expect (! graph.isBatchUpdating());
+        expectEquals (graph.getNumRenderBuilds(), builds + 1);
+        audio.clear();
+        graph.processBlock (audio, midi);
+
+        beginTest ("replaced nodes render until the batch ends");
+        graph.beginBatchUpdate();
+        graph.beginBatchUpdate();
+        Array<GraphNodePtr> volumes;
+        for (auto placeholder : placeholders)
+            volumes.add (graph.replaceNode (placeholder.get(), new VolumeProcessor (-60.0, 12.0, true)));
+        expectEquals (graph.getNumRenderBuilds(), builds + 1);
+        for (auto placeholder : placeholders)
+            expect (placeholder->getParentGraph() == &graph);
+        graph.processBlock (audio, midi);
+
+        graph.endBatchUpdate();
+        expectEquals (graph.getNumRenderBuilds(), builds + 1, "holds nest");
+        graph.endBatchUpdate();
+        expectEquals (graph.getNumRenderBuilds(), builds + 2);
+        for (auto placeholder : placeholders)
+            expect (placeholder->getParentGraph() == nullptr);
+        for (auto volume : volumes)
+            expect (volume != nullptr && volume->getParentGraph() == &graph);
+        expectEquals (graph.getNumConnections(), 16);
+        graph.processBlock (audio, midi);
+
+        beginTest ("removed nodes render until the batch ends");
+        graph.beginBatchUpdate();
+        graph.removeNode (volumes[0]->nodeId);
+        graph.removeNode (volumes[1]->nodeId);
+        expectEquals (graph.getNumRenderBuilds(), builds + 2);
+        expect (volumes[0]->getParentGraph() == &graph);
+        graph.processBlock (audio, midi);
+        graph.endBatchUpdate();
+        expectEquals (graph.getNumRenderBuilds(), builds + 3);
+        expect (volumes[0]->getParentGraph() == nullptr);
+        expect (volumes[1]->getParentGraph() == nullptr);
+        expectEquals (graph.getNumConnections(), 8);
+
+        beginTest ("releasing without changes doesn't rebuild");
+        graph.beginBatchUpdate();
+        graph.endBatchUpdate();
+        expectEquals (graph.getNumRenderBuilds(), builds + 3);
+
+        graph.clear();
+    }
+};
+
+static BatchUpdateTest sBatchUpdateTest;
+
+}
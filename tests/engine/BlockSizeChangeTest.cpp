@@ -0,0 +1,130 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class BlockSizeChangeTest : public UnitTestBase
+{
+public:
+    BlockSizeChangeTest() : UnitTestBase ("Block Size Changes", "engine", "blockSizeChange") { }
+    virtual ~BlockSizeChangeTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        Array<PreparingProcessor*> processors;
+        ReferenceCountedArray<GraphNode> nodes;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto* proc = new PreparingProcessor();
+            processors.add (proc);
+            nodes.add (graph.addNode (proc));
+        }
+
+        beginTest ("plugins are each prepared once");
+        graph.prepareToPlay (44100.0, 256);
+        for (auto* node : nodes)
+            input->connectAudioTo (node);
+        for (auto* proc : processors)
+        {
+            expectEquals (proc->numPrepares.load(), 1);
+            expectEquals (proc->preparedSize.load(), 256);
+        }
+
+        beginTest ("smaller blocks keep nodes prepared");
+        graph.setBlockSize (128);
+        expectEquals (graph.getBlockSize(), 128);
+        for (auto* proc : processors)
+        {
+            expectEquals (proc->numPrepares.load(), 1);
+            expectEquals (proc->numReleases.load(), 0);
+        }
+
+        beginTest ("bigger blocks prepare nodes again");
+        graph.setBlockSize (512);
+        for (auto* proc : processors)
+        {
+            expectEquals (proc->numPrepares.load(), 2);
+            expectEquals (proc->numReleases.load(), 1);
+            expectEquals (proc->preparedSize.load(), 512);
+        }
+
+        beginTest ("renders at the new size");
+        AudioSampleBuffer audio (2, 512);
+        audio.clear();
+        MidiBuffer midi;
+        graph.processBlock (audio, midi);
+        for (auto* proc : processors)
+            expectEquals (proc->lastBlockSize.load(), 512);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    class PreparingProcessor : public BaseProcessor
+    {
+    public:
+        PreparingProcessor()
+            : BaseProcessor (BusesProperties().withInput ("Main", AudioChannelSet::stereo(), true)
+                                              .withOutput ("Main", AudioChannelSet::stereo(), true)) { }
+
+        std::atomic<int> numPrepares { 0 };
+        std::atomic<int> numReleases { 0 };
+        std::atomic<int> preparedSize { 0 };
+        std::atomic<int> lastBlockSize { 0 };
+
+        const String getName() const override { return "Preparing"; }
+
+        void prepareToPlay (double, int blockSize) override
+        {
+            ++numPrepares;
+            preparedSize = blockSize;
+        }
+
+        void releaseResources() override { ++numReleases; }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            lastBlockSize = buffer.getNumSamples();
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+};
+
+static BlockSizeChangeTest sBlockSizeChangeTest;
+
+}
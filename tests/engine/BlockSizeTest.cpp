@@ -0,0 +1,88 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class BlockSizeTest : public UnitTestBase
+{
+public:
+    BlockSizeTest() : UnitTestBase ("Variable Block Sizes", "engine", "blockSize") { }
+    virtual ~BlockSizeTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, preparedSize);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr midiIn = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::midiInputNode));
+        GraphNodePtr midiOut = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::midiOutputNode));
+        graph.prepareToPlay (44100.0, preparedSize);
+        input->connectAudioTo (output);
+        graph.addConnection (midiIn->nodeId, midiIn->getMidiOutputPort(),
+                             midiOut->nodeId, midiOut->getMidiInputPort());
+        graph.prepareToPlay (44100.0, preparedSize);
+
+        for (const int numSamples : { 1, 100, preparedSize, preparedSize + 1, preparedSize * 5 + 37 })
+        {
+            beginTest (String ("renders ") + String (numSamples) + " samples");
+            AudioSampleBuffer audio (4, numSamples);
+            for (int c = 0; c < audio.getNumChannels(); ++c)
+                for (int i = 0; i < numSamples; ++i)
+                    audio.setSample (c, i, (float) i / (float) numSamples);
+
+            MidiBuffer midi;
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+            midi.addEvent (MidiMessage::noteOff (1, 60), numSamples - 1);
+
+            graph.processBlock (audio, midi);
+
+            bool passed = true;
+            for (int c = 0; c < 2; ++c)
+                for (int i = 0; i < numSamples; ++i)
+                    if (audio.getSample (c, i) != (float) i / (float) numSamples)
+                        passed = false;
+            expect (passed, "audio should pass through untouched");
+            expectEquals (audio.getMagnitude (2, 0, numSamples), 0.f, "channels past the outputs are silent");
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            Array<int> frames;
+            while (iter.getNextEvent (msg, frame))
+                frames.add (frame);
+            expectEquals (frames.size(), 2);
+            expectEquals (frames.getLast(), numSamples - 1, "MIDI should keep its timing");
+        }
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int preparedSize = 256;
+};
+
+static BlockSizeTest sBlockSizeTest;
+
+}
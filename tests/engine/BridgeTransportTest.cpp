@@ -0,0 +1,196 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/BridgeTransport.h"
+
+namespace Element {
+
+class BridgeTransportTest : public UnitTestBase
+{
+public:
+    BridgeTransportTest() : UnitTestBase ("Bridge Transport", "engine", "bridgeTransport") { }
+    virtual ~BridgeTransportTest() { }
+
+    void runTest() override
+    {
+        testRingBuffer();
+        testRoundTrip();
+        testLateBlocks();
+        testOpenErrors();
+    }
+
+private:
+    /** Plays the host process' side of a channel, halving the audio it gets */
+    struct Renderer : public Thread
+    {
+        Renderer (const String& name) : Thread ("Bridge Renderer")
+        {
+            opened = channel.open (name);
+        }
+
+        ~Renderer() { stopThread (1000); }
+
+        void run() override
+        {
+            AudioBuffer<float> buffer (2, channel.getLayout().maxBlockSize);
+            MidiBuffer midi;
+            AudioPlayHead::CurrentPositionInfo position;
+
+            while (! threadShouldExit())
+            {
+                if (! channel.receive (buffer, midi, position, 50.0))
+                    continue;
+
+                int index = 0; float value = 0.f;
+                while (channel.popParameter (index, value))
+                    lastParameter = index;
+
+                if (delayMs > 0)
+                    Thread::sleep (delayMs);
+
+                lastBpm = position.bpm;
+                numMidiReceived += midi.getNumEvents();
+                buffer.applyGain (0.5f);
+                channel.reply (buffer, midi);
+                ++numBlocks;
+            }
+        }
+
+        BridgeChannel channel;
+        bool opened = false;
+        std::atomic<int> delayMs { 0 };
+        std::atomic<int> numBlocks { 0 };
+        std::atomic<int> numMidiReceived { 0 };
+        std::atomic<int> lastParameter { -1 };
+        std::atomic<double> lastBpm { 0.0 };
+    };
+
+    void testRingBuffer()
+    {
+        beginTest ("ring buffer");
+        HeapBlock<uint8> memory (SharedRingBuffer::getRequiredSize (64), true);
+        SharedRingBuffer::initialise (memory.get(), 64);
+        SharedRingBuffer ring;
+        ring.attach (memory.get());
+
+        const uint8 note[] = { 0x90, 60, 100 };
+        int numWritten = 0;
+        while (ring.write (numWritten, note, sizeof (note)))
+            ++numWritten;
+        expectEquals (numWritten, 64 / 9, "full messages only");
+
+        int32 timestamp = 0;
+        uint8 data[8];
+        uint16 size = 0;
+        for (int i = 0; i < numWritten; ++i)
+        {
+            expect (ring.read (timestamp, data, size, sizeof (data)));
+            expectEquals ((int) timestamp, i);
+            expectEquals ((int) size, 3);
+            expect (ring.write (100 + i, note, sizeof (note)), "space is reused across the wrap");
+        }
+
+        expect (! ring.read (timestamp, data, size, 2), "messages too big are skipped");
+        expectEquals ((int) ring.getNumReady(), 0);
+    }
+
+    void testRoundTrip()
+    {
+        beginTest ("round trip");
+        BridgeChannel::Layout layout;
+        layout.maxBlockSize = 512;
+        BridgeChannel host;
+        expect (host.create (BridgeChannel::createUniqueName(), layout));
+
+        Renderer renderer (host.getName());
+        expect (renderer.opened);
+        expectEquals (renderer.channel.getLayout().maxBlockSize, 512);
+        renderer.startThread();
+
+        AudioBuffer<float> audio (2, 256);
+        MidiBuffer midi;
+        AudioPlayHead::CurrentPositionInfo position;
+        position.resetToDefault();
+        position.bpm = 140.0;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            for (int c = 0; c < 2; ++c)
+                FloatVectorOperations::fill (audio.getWritePointer (c), 1.f, audio.getNumSamples());
+            midi.clear();
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 10);
+            host.pushParameter (3, 0.25f);
+            expect (host.process (audio, midi, position, 1000.0));
+            expectEquals (audio.getSample (1, 100), 0.5f);
+            expectEquals (midi.getNumEvents(), 1, "MIDI comes back");
+        }
+
+        expectEquals (renderer.numBlocks.load(), 8);
+        expectEquals (renderer.lastParameter.load(), 3);
+        expectEquals (renderer.lastBpm.load(), 140.0);
+        expectEquals (host.getNumLateBlocks(), 0);
+    }
+
+    void testLateBlocks()
+    {
+        beginTest ("late blocks");
+        BridgeChannel host;
+        expect (host.create (BridgeChannel::createUniqueName(), BridgeChannel::Layout()));
+        Renderer renderer (host.getName());
+        renderer.startThread();
+        renderer.delayMs = 50;
+
+        AudioBuffer<float> audio (2, 128);
+        MidiBuffer midi;
+        AudioPlayHead::CurrentPositionInfo position;
+        position.resetToDefault();
+
+        audio.clear(); audio.setSample (0, 0, 1.f);
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        expect (! host.process (audio, midi, position, 1.0), "a slow block misses its deadline");
+        expectEquals (audio.getMagnitude (0, 128), 0.f, "and comes back silent");
+
+        midi.addEvent (MidiMessage::noteOff (1, 60), 0);
+        expect (! host.process (audio, midi, position, 1.0), "later blocks are skipped meanwhile");
+        expectEquals (host.getNumLateBlocks(), 2);
+
+        renderer.delayMs = 0;
+        Thread::sleep (100);
+        expect (host.process (audio, midi, position, 1000.0), "things recover");
+        expectEquals (renderer.numMidiReceived.load(), 2, "MIDI sent while skipping isn't lost");
+    }
+
+    void testOpenErrors()
+    {
+        beginTest ("open errors");
+        BridgeChannel channel;
+        expect (! channel.open (BridgeChannel::createUniqueName()), "missing channels can't be opened");
+
+        const auto name = BridgeChannel::createUniqueName();
+        BridgeChannel first, second;
+        expect (first.create (name, BridgeChannel::Layout()));
+        expect (! second.create (name, BridgeChannel::Layout()), "names are unique");
+        first.close();
+        expect (! channel.open (name), "closing removes the name");
+    }
+};
+
+static BridgeTransportTest sBridgeTransportTest;
+
+}
@@ -0,0 +1,83 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/CallbackTracer.h"
+
+namespace Element {
+
+class CallbackTracerTest : public UnitTestBase
+{
+public:
+    CallbackTracerTest() : UnitTestBase ("Callback Tracer", "engine", "callbackTracer") { }
+    virtual ~CallbackTracerTest() { }
+
+    void runTest() override
+    {
+        std::unique_ptr<CallbackTracer> tracer (new CallbackTracer());
+        tracer->prepare (48000.0);
+        const int64 blockTicks = Time::secondsToHighResolutionTicks (480.0 / 48000.0);
+
+        beginTest ("history wraps");
+        const int numBlocks = CallbackTracer::capacity + 10;
+        for (int i = 0; i < numBlocks; ++i)
+            push (*tracer, i, blockTicks * (i + 1), i == numBlocks - 1 ? 20.f : 1.f);
+
+        Array<CallbackTracer::Record> history;
+        tracer->getHistory (history);
+        expectEquals (history.size(), (int) CallbackTracer::capacity);
+        expectEquals (history.getFirst().graphIndex, 10);
+        expectEquals (history.getLast().graphIndex, numBlocks - 1);
+
+        beginTest ("overruns");
+        expect (history.getLast().overrun, "a 20ms render of a 10ms block should overrun");
+        expect (! history.getFirst().overrun);
+        expectEquals (tracer->getNumOverruns(), 1);
+        expect (tracer->checkOverrun());
+        expect (! tracer->checkOverrun(), "overruns are only reported once");
+
+        beginTest ("late callbacks");
+        push (*tracer, numBlocks, blockTicks * (numBlocks + 3), 1.f);
+        tracer->getHistory (history);
+        expect (history.getLast().overrun, "two missed blocks should count as an overrun");
+        expectGreaterThan (history.getLast().jitterMs, 10.f);
+
+        beginTest ("dump");
+        TemporaryFile file (".csv");
+        expect (tracer->writeToFile (file.getFile()));
+        StringArray lines;
+        file.getFile().readLines (lines);
+        lines.removeEmptyStrings();
+        expectEquals (lines.size(), (int) CallbackTracer::capacity + 1);
+    }
+
+private:
+    static void push (CallbackTracer& tracer, int index, int64 startTicks, float totalMs)
+    {
+        CallbackTracer::Record record;
+        record.startTicks = startTicks;
+        record.numSamples = 480;
+        record.totalMs = totalMs;
+        record.graphIndex = index;
+        tracer.push (record);
+    }
+};
+
+static CallbackTracerTest sCallbackTracerTest;
+
+}
@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/AllPassFilterNode.h"
+#include "engine/nodes/CombFilterProcessor.h"
+
+namespace Element {
+
+class CombFilterTest : public UnitTestBase
+{
+public:
+    CombFilterTest() : UnitTestBase ("Comb and All-Pass Filters", "engine", "combFilter") { }
+    virtual ~CombFilterTest() { }
+
+    void runTest() override
+    {
+        beginTest ("comb impulse repeats at its length");
+        {
+            CombFilter comb;
+            comb.prepare (1000, 2, 100);
+            comb.setLength (100.f, false);
+            comb.setSpread (1, 10);
+
+            AudioBuffer<float> audio (2, 512);
+            audio.clear();
+            audio.setSample (0, 0, 1.f);
+            audio.setSample (1, 0, 1.f);
+            comb.processBlock (audio.getArrayOfWritePointers(), 2, 512, 0.f, 0.5f);
+
+            expectEquals (audio.getSample (0, 100), 1.f);
+            expectEquals (audio.getSample (0, 200), 0.5f);
+            expectEquals (audio.getSample (0, 300), 0.25f);
+            expectEquals (audio.getSample (1, 110), 1.f);
+            expectEquals (audio.getSample (1, 220), 0.5f);
+            expectEquals (audio.getMagnitude (0, 0, 100), 0.f);
+        }
+
+        beginTest ("all-pass impulse response");
+        {
+            AllPassFilter allPass;
+            allPass.prepare (1000, 1, 100);
+            allPass.setLength (50.f, false);
+
+            AudioBuffer<float> audio (1, 256);
+            audio.clear();
+            audio.setSample (0, 0, 1.f);
+            allPass.processBlock (audio.getArrayOfWritePointers(), 1, 256);
+
+            expectEquals (audio.getSample (0, 0), -1.f);
+            expectEquals (audio.getSample (0, 50), 1.f);
+            expectEquals (audio.getSample (0, 100), 0.5f);
+            expectEquals (audio.getSample (0, 150), 0.25f);
+        }
+
+        beginTest ("length changes glide without jumping");
+        {
+            CombFilter comb;
+            comb.prepare (1000, 1, 882);
+            comb.setLength (100.f, false);
+
+            AudioBuffer<float> audio (1, 8192);
+            for (int i = 0; i < audio.getNumSamples(); ++i)
+                audio.setSample (0, i, std::sin (MathConstants<float>::twoPi * 100.f * (float) i / 44100.f));
+
+            for (int start = 0; start < audio.getNumSamples(); start += 256)
+            {
+                if (start == 2048)
+                    comb.setLength (400.f);
+                auto* chan = audio.getWritePointer (0, start);
+                comb.processBlock (&chan, 1, 256, 0.f, 0.f);
+            }
+
+            float maxStep = 0.f;
+            for (int i = 101; i < audio.getNumSamples(); ++i)
+                maxStep = jmax (maxStep, std::abs (audio.getSample (0, i) - audio.getSample (0, i - 1)));
+            expectLessThan (maxStep, 0.03f);
+        }
+    }
+};
+
+static CombFilterTest sCombFilterTest;
+
+}
@@ -0,0 +1,138 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/CompressorProcessor.h"
+
+namespace Element {
+
+class CompressorTest : public UnitTestBase,
+                       private CompressorProcessor::Listener
+{
+public:
+    CompressorTest() : UnitTestBase ("Compressor", "engine", "compressor") { }
+    virtual ~CompressorTest() { }
+
+    void runTest() override
+    {
+        Random random (1234);
+        AudioBuffer<float> noise (2, 4096);
+        for (int c = 0; c < noise.getNumChannels(); ++c)
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample (c, i, random.nextFloat() * 2.f - 1.f);
+
+        beginTest ("linked blocks match the per sample detector");
+        {
+            CompressorProcessor comp (2);
+            setParam (comp, "thresh", -20.f);
+            setParam (comp, "ratio", 4.f);
+            comp.prepareToPlay (44100.0, 512);
+
+            LevelDetector detector;
+            GainComputer gainComputer;
+            detector.reset (44100.f);
+            gainComputer.reset();
+            detector.setAttackMs (10.f);
+            detector.setReleaseMs (100.f);
+            gainComputer.setThreshold (-20.f);
+            gainComputer.setRatio (4.f);
+            gainComputer.setKnee (6.f);
+
+            AudioBuffer<float> audio (4, noise.getNumSamples());
+            audio.clear();
+            for (int c = 0; c < 2; ++c)
+                audio.copyFrom (c, 0, noise, c, 0, noise.getNumSamples());
+            process (comp, audio, 300);
+
+            float maxDifference = 0.f;
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+            {
+                const auto mono = (noise.getSample (0, i) + noise.getSample (1, i)) / 2.f;
+                const auto gain = gainComputer.process (detector.process (mono));
+                for (int c = 0; c < 2; ++c)
+                    maxDifference = jmax (maxDifference, std::abs (audio.getSample (c, i) - noise.getSample (c, i) * gain));
+            }
+
+            expectLessThan (maxDifference, 1.0e-5f);
+        }
+
+        beginTest ("lookahead delays the audio and reports it as latency");
+        {
+            CompressorProcessor comp (2);
+            setParam (comp, "lookahead", 5.f);
+            comp.prepareToPlay (44100.0, 512);
+            const int expected = roundToInt (44100.0 * 5.0 / 1000.0);
+            expectEquals (comp.getLatencySamples(), expected);
+
+            AudioBuffer<float> audio (4, 2048);
+            audio.clear();
+            audio.setSample (0, 10, 0.1f);
+            audio.setSample (1, 10, 0.1f);
+            process (comp, audio, 128);
+
+            expectEquals (audio.getSample (0, 10 + expected), 0.1f);
+            expectEquals (audio.getSample (1, 10 + expected), 0.1f);
+            expectEquals (audio.getMagnitude (0, 0, 10 + expected), 0.f);
+        }
+
+        beginTest ("listeners are updated once per interval");
+        {
+            CompressorProcessor comp (2);
+            comp.prepareToPlay (44100.0, 64);
+            comp.addListener (this);
+            numUpdates = 0;
+
+            AudioBuffer<float> audio (4, 44100);
+            audio.clear();
+            process (comp, audio, 64);
+            comp.removeListener (this);
+
+            const int intervals = 1000 / CompressorProcessor::reportIntervalMs;
+            expect (numUpdates >= intervals - 1 && numUpdates <= intervals + 1);
+        }
+    }
+
+private:
+    int numUpdates = 0;
+
+    void updateInGainDB (float) override { ++numUpdates; }
+
+    static void setParam (AudioProcessor& proc, const String& paramID, float value)
+    {
+        for (auto* param : proc.getParameters())
+            if (auto* floatParam = dynamic_cast<AudioParameterFloat*> (param))
+                if (floatParam->paramID == paramID)
+                    *floatParam = value;
+    }
+
+    static void process (AudioProcessor& proc, AudioBuffer<float>& audio, int blockSize)
+    {
+        MidiBuffer midi;
+        for (int start = 0; start < audio.getNumSamples(); start += blockSize)
+        {
+            const int numSamples = jmin (blockSize, audio.getNumSamples() - start);
+            AudioBuffer<float> block (audio.getArrayOfWritePointers(), audio.getNumChannels(), start, numSamples);
+            proc.processBlock (block, midi);
+        }
+    }
+};
+
+static CompressorTest sCompressorTest;
+
+}
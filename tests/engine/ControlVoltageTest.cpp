@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiPipe.h"
+
+namespace Element {
+
+class ControlVoltageTest : public UnitTestBase
+{
+public:
+    ControlVoltageTest() : UnitTestBase ("Control Voltage", "engine", "cv") { }
+    virtual ~ControlVoltageTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (0, 1, 44100.0, blockSize);
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr source = graph.addNode (new CVNode (true));
+        GraphNodePtr vca = graph.addNode (new CVNode (false));
+        expectEquals ((int) source->getNumPorts (PortType::CV, false), 1);
+        expectEquals ((int) vca->getNumPorts (PortType::CV, true), 1);
+
+        expect (graph.connectChannels (PortType::Audio, source->nodeId, 0, vca->nodeId, 0));
+        expect (graph.connectChannels (PortType::Audio, vca->nodeId, 0, output->nodeId, 0));
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("unconnected cv reads zeros");
+        expectEquals (render (graph, blockSize - 1), 0.f);
+
+        beginTest ("cv reaches the node's loop");
+        expect (graph.connectChannels (PortType::CV, source->nodeId, 0, vca->nodeId, 0));
+        graph.handleUpdateNowIfNeeded();
+        expectEquals (render (graph, 0), 0.f);
+        expectEquals (render (graph, 64), 64.f / (float) blockSize);
+        expectEquals (render (graph, blockSize - 1), (float) (blockSize - 1) / (float) blockSize);
+
+        beginTest ("cv is only valid while rendering");
+        expect (vca->getCVInput (0) == nullptr);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int blockSize = 128;
+
+    /** Makes a constant signal and a ramp on its CV output when it's a source,
+        otherwise scales its audio by its CV input */
+    class CVNode : public GraphNode
+    {
+    public:
+        explicit CVNode (bool isSource) : GraphNode (0), source (isSource) { }
+
+        bool wantsMidiPipe() const override { return true; }
+        void prepareToRender (double, int) override { }
+        void releaseResources() override { }
+        void getState (MemoryBlock&) override { }
+        void setState (const void*, int) override { }
+
+        void render (AudioSampleBuffer& audio, MidiPipe&) override
+        {
+            auto* const samples = audio.getWritePointer (0);
+            const int numSamples = audio.getNumSamples();
+
+            if (source)
+            {
+                auto* const cv = getCVOutput (0);
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    samples[i] = 1.f;
+                    cv[i] = (float) i / (float) numSamples;
+                }
+                return;
+            }
+
+            const auto* const cv = getCVInput (0);
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] *= cv[i];
+        }
+
+    protected:
+        void createPorts() override
+        {
+            if (ports.size() > 0)
+                return;
+
+            uint32 index = 0;
+            if (! source)
+                ports.add (PortType::Audio, index++, 0, "audio_in", "Input", true);
+            ports.add (PortType::Audio, index++, 0, "audio_out", "Output", false);
+            ports.add (PortType::CV, index++, 0, source ? "cv_out" : "cv_in",
+                       source ? "CV Out" : "CV In", ! source);
+        }
+
+    private:
+        const bool source;
+    };
+
+    static float render (GraphProcessor& graph, int frame)
+    {
+        AudioSampleBuffer audio (1, blockSize);
+        MidiBuffer midi;
+        audio.clear();
+        graph.processBlock (audio, midi);
+        return audio.getSample (0, frame);
+    }
+};
+
+static ControlVoltageTest sControlVoltageTest;
+
+}
@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/ControllerFeedback.h"
+
+namespace Element {
+
+class ControllerFeedbackTest : public UnitTestBase
+{
+public:
+    ControllerFeedbackTest() : UnitTestBase ("Controller Feedback", "engine", "controllerFeedback") { }
+    virtual ~ControllerFeedbackTest() { }
+
+    void runTest() override
+    {
+        MidiEngine midi;
+        ControllerFeedback feedback (midi);
+        MidiBuffer messages;
+
+        beginTest ("devices without an output");
+        feedback.addDevice ("silent", String(), 100);
+        expect (feedback.addSlot ("silent", false, 1, 7) == nullptr);
+        expect (feedback.addSlot ("unknown", false, 1, 7) == nullptr);
+
+        // the output doesn't have to be open to collect what would be sent
+        feedback.addDevice ("faders", "Element Test Output", 100);
+        auto* volume = feedback.addSlot ("faders", false, 2, 7);
+        auto* pan    = feedback.addSlot ("faders", false, 2, 10);
+        auto* led    = feedback.addSlot ("faders", true, 1, 36);
+        expect (volume != nullptr && pan != nullptr && led != nullptr);
+
+        beginTest ("only changes are sent");
+        feedback.collectChanges ("faders", 1.0, messages);
+        expect (messages.isEmpty(), "nothing has been posted yet");
+
+        volume->post (100);
+        volume->post (64);
+        led->post (127);
+        collect (feedback, messages, 1.0);
+        expectEquals (messages.getNumEvents(), 2, "only the latest value of each slot is sent");
+        expect (hasEvent (messages, MidiMessage::controllerEvent (2, 7, 64)));
+        expect (hasEvent (messages, MidiMessage::noteOn (1, 36, (uint8) 127)));
+
+        collect (feedback, messages, 1.0);
+        expect (messages.isEmpty(), "unchanged values aren't sent again");
+
+        led->post (0);
+        collect (feedback, messages, 1.0);
+        expect (hasEvent (messages, MidiMessage::noteOff (1, 36)));
+
+        beginTest ("echoes are suppressed");
+        pan->markSent (20);
+        pan->post (20);
+        collect (feedback, messages, 1.0);
+        expect (messages.isEmpty(), "the controller already shows the value");
+
+        beginTest ("budget");
+        feedback.addDevice ("faders", "Element Test Output", 20);
+        collect (feedback, messages, 1.0); // spends nothing, banks the credit
+        volume->post (1);
+        pan->post (2);
+        led->post (3);
+        collect (feedback, messages, 0.1);
+        expectEquals (messages.getNumEvents(), 2, "a tenth of a second of 20 per second");
+        expectEquals (feedback.getNumDeferred(), 1);
+        collect (feedback, messages, 0.0);
+        expect (messages.isEmpty(), "no credit left");
+        collect (feedback, messages, 0.05);
+        expectEquals (messages.getNumEvents(), 1, "deferred slots go out on a later flush");
+        expect (hasEvent (messages, MidiMessage::noteOn (1, 36, (uint8) 3)));
+
+        beginTest ("remove");
+        feedback.removeDevice ("faders");
+        expect (feedback.addSlot ("faders", false, 1, 7) == nullptr);
+        feedback.clear();
+    }
+
+private:
+    static void collect (ControllerFeedback& feedback, MidiBuffer& messages, double elapsed)
+    {
+        messages.clear();
+        feedback.collectChanges ("faders", elapsed, messages);
+    }
+
+    static bool hasEvent (const MidiBuffer& buffer, const MidiMessage& expected)
+    {
+        MidiBuffer::Iterator iter (buffer);
+        MidiMessage message;
+        int frame = 0;
+        while (iter.getNextEvent (message, frame))
+            if (message.getRawDataSize() == expected.getRawDataSize()
+                && memcmp (message.getRawData(), expected.getRawData(), (size_t) message.getRawDataSize()) == 0)
+                return true;
+        return false;
+    }
+};
+
+static ControllerFeedbackTest sControllerFeedbackTest;
+
+}
@@ -0,0 +1,167 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/Convolver.h"
+#include "engine/nodes/ConvolutionProcessor.h"
+
+namespace Element {
+
+class ConvolverTest : public UnitTestBase
+{
+public:
+    ConvolverTest() : UnitTestBase ("Convolver", "engine", "convolver") { }
+    virtual ~ConvolverTest() { }
+
+    void runTest() override
+    {
+        testUniform();
+        testTwoStage();
+        testProcessor();
+    }
+
+private:
+    Random random { 1234 };
+
+    void fillRandom (AudioBuffer<float>& buffer)
+    {
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (c, i, random.nextFloat() * 2.f - 1.f);
+    }
+
+    static float directSample (const float* input, const float* impulse, int impulseLength, int index)
+    {
+        double sum = 0.0;
+        for (int k = 0; k < impulseLength && k <= index; ++k)
+            sum += (double) impulse[k] * input[index - k];
+        return (float) sum;
+    }
+
+    void testUniform()
+    {
+        beginTest ("uniform partitions have no latency");
+        AudioBuffer<float> impulse (1, 300);
+        fillRandom (impulse);
+
+        UniformConvolver convolver;
+        convolver.prepare (64, impulse.getReadPointer (0), impulse.getNumSamples());
+        expectEquals (convolver.getNumPartitions(), 5);
+
+        HeapBlock<float> audio (512, true);
+        audio[0] = 1.f;
+        convolver.process (audio, audio, 100);
+        convolver.process (audio + 100, audio + 100, 412);
+        for (int i = 0; i < 300; ++i)
+            expectWithinAbsoluteError (audio[i], impulse.getSample (0, i), 1.0e-4f);
+        for (int i = 300; i < 512; ++i)
+            expectWithinAbsoluteError (audio[i], 0.f, 1.0e-4f);
+    }
+
+    void testTwoStage()
+    {
+        beginTest ("tail on its own thread");
+        AudioBuffer<float> impulse (2, 5000);
+        fillRandom (impulse);
+        impulse.applyGain (0.05f);
+
+        Convolver convolver;
+        convolver.prepare (impulse, 2, 64);
+        expect (convolver.hasTail());
+        expectEquals (convolver.getTailBlockSize(), 512);
+
+        AudioBuffer<float> input (2, 12000);
+        fillRandom (input);
+        AudioBuffer<float> output;
+        output.makeCopyOf (input);
+
+        // uneven blocks cross the head and tail boundaries everywhere
+        for (int offset = 0; offset < output.getNumSamples();)
+        {
+            const int numSamples = jmin (output.getNumSamples() - offset, 1 + random.nextInt (200));
+            float* channels[] = { output.getWritePointer (0, offset), output.getWritePointer (1, offset) };
+            convolver.process (channels, 2, numSamples);
+            offset += numSamples;
+        }
+
+        float maxError = 0.f;
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < output.getNumSamples(); i += 7)
+                maxError = jmax (maxError, std::abs (output.getSample (c, i) - directSample (
+                    input.getReadPointer (c), impulse.getReadPointer (c), impulse.getNumSamples(), i)));
+        expectLessThan (maxError, 1.0e-3f);
+
+        beginTest ("mono responses apply to every channel");
+        AudioBuffer<float> mono (1, 2000);
+        fillRandom (mono);
+        convolver.prepare (mono, 2, 128);
+        AudioBuffer<float> pulse (2, 4096);
+        pulse.clear();
+        pulse.setSample (0, 0, 1.f);
+        pulse.setSample (1, 0, 1.f);
+        convolver.process (pulse.getArrayOfWritePointers(), 2, pulse.getNumSamples());
+        expectWithinAbsoluteError (pulse.getSample (1, 1999), mono.getSample (0, 1999), 1.0e-4f);
+        expectWithinAbsoluteError (pulse.getSample (0, 10), mono.getSample (0, 10), 1.0e-4f);
+    }
+
+    void testProcessor()
+    {
+        beginTest ("impulse responses load through the cache");
+        TemporaryFile file (".wav");
+        {
+            AudioBuffer<float> data (1, 256);
+            data.clear();
+            data.setSample (0, 3, 0.5f);
+            WavAudioFormat format;
+            std::unique_ptr<AudioFormatWriter> writer (format.createWriterFor (
+                new FileOutputStream (file.getFile()), 44100.0, 1, 24, {}, 0));
+            writer->writeFromAudioSampleBuffer (data, 0, data.getNumSamples());
+        }
+
+        ConvolutionProcessor proc;
+        proc.prepareToPlay (44100.0, 256);
+        expect (proc.loadImpulse (file.getFile()));
+        expectEquals (proc.getImpulseLength(), 256);
+        SharedResourcePointer<AudioCache> cache;
+        expect (cache->find (file.getFile()) != nullptr);
+
+        AudioBuffer<float> audio (2, 256);
+        audio.clear();
+        audio.setSample (0, 0, 1.f);
+        MidiBuffer midi;
+        proc.processBlock (audio, midi);
+        expectWithinAbsoluteError (audio.getSample (0, 3), 0.5f, 1.0e-3f);
+        expectWithinAbsoluteError (audio.getSample (0, 0), 0.f, 1.0e-3f);
+
+        beginTest ("state keeps the file");
+        MemoryBlock state;
+        proc.getStateInformation (state);
+        ConvolutionProcessor restored;
+        restored.prepareToPlay (44100.0, 256);
+        restored.setStateInformation (state.getData(), (int) state.getSize());
+        expect (restored.getImpulseFile() == file.getFile());
+        expectEquals (restored.getImpulseLength(), 256);
+        proc.releaseResources();
+        restored.releaseResources();
+    }
+};
+
+static ConvolverTest sConvolverTest;
+
+}
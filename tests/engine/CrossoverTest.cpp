@@ -0,0 +1,109 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/FreqSplitterProcessor.h"
+
+namespace Element {
+
+class CrossoverTest : public UnitTestBase
+{
+public:
+    CrossoverTest() : UnitTestBase ("Crossover", "engine", "crossover") { }
+    virtual ~CrossoverTest() { }
+
+    void runTest() override
+    {
+        for (const int numBands : { 2, 3, 5 })
+        {
+            for (const int slope : { 0, 1 })
+            {
+                beginTest (String (numBands) + " bands sum flat, slope " + String (slope));
+                FreqSplitterProcessor splitter (2, numBands);
+                expectEquals (splitter.getBusCount (false), numBands);
+                expectEquals (splitter.getTotalNumOutputChannels(), numBands * 2);
+                setSlope (splitter, slope);
+
+                AudioBuffer<float> impulse;
+                process (splitter, impulse);
+
+                AudioBuffer<float> sum (1, impulse.getNumSamples());
+                sum.clear();
+                for (int band = 0; band < numBands; ++band)
+                    sum.addFrom (0, 0, impulse, band * 2 + 1, 0, impulse.getNumSamples());
+
+                float worst = 0.0f;
+                for (float freq = 30.0f; freq < 20000.0f; freq *= 1.25f)
+                    worst = jmax (worst, std::abs (getMagnitude (sum, 0, freq) - 1.0f));
+                expectLessThan (worst, 1.0e-3f);
+
+                // low frequencies only reach the bottom band
+                expectWithinAbsoluteError (getMagnitude (impulse, 0, 40.0f), 1.0f, 0.01f);
+                expectLessThan (getMagnitude (impulse, (numBands - 1) * 2, 40.0f), 0.01f);
+            }
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 44100.0;
+
+    static void setSlope (AudioProcessor& proc, int index)
+    {
+        for (auto* param : proc.getParameters())
+            if (auto* choice = dynamic_cast<AudioParameterChoice*> (param))
+                if (choice->paramID == "slope")
+                    *choice = index;
+    }
+
+    static void process (AudioProcessor& proc, AudioBuffer<float>& audio)
+    {
+        const int blockSize = 512;
+        proc.prepareToPlay (sampleRate, blockSize);
+        audio.setSize (proc.getTotalNumOutputChannels(), 16 * blockSize);
+        audio.clear();
+        audio.setSample (0, 0, 1.0f);
+        audio.setSample (1, 0, 1.0f);
+
+        MidiBuffer midi;
+        AudioBuffer<float> block (audio.getNumChannels(), blockSize);
+        for (int start = 0; start < audio.getNumSamples(); start += blockSize)
+        {
+            // only the input channels carry audio in
+            block.clear();
+            for (int c = 0; c < 2; ++c)
+                block.copyFrom (c, 0, audio, c, start, blockSize);
+            proc.processBlock (block, midi);
+            for (int c = 0; c < audio.getNumChannels(); ++c)
+                audio.copyFrom (c, start, block, c, 0, blockSize);
+        }
+    }
+
+    static float getMagnitude (const AudioBuffer<float>& response, int channel, float freq)
+    {
+        std::complex<double> sum;
+        const auto w = MathConstants<double>::twoPi * (double) freq / sampleRate;
+        for (int i = 0; i < response.getNumSamples(); ++i)
+            sum += (double) response.getSample (channel, i) * std::polar (1.0, -w * (double) i);
+        return (float) std::abs (sum);
+    }
+};
+
+static CrossoverTest sCrossoverTest;
+
+}
@@ -0,0 +1,75 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/DelayLine.h"
+
+namespace Element {
+
+class DelayLineTest : public UnitTestBase
+{
+public:
+    DelayLineTest() : UnitTestBase ("Delay Line", "engine", "delayLine") { }
+    virtual ~DelayLineTest() { }
+
+    void runTest() override
+    {
+        for (const int delay : { 0, 1, 37, 256, 1000 })
+        {
+            beginTest ("delay of " + String (delay));
+            testBlocks (delay, { 64, 64, 64, 64 }, 64);
+            testBlocks (delay, { 13, 128, 1, 77, 128, 5 }, 128);
+            testBlocks (delay, { 300, 45, 512 }, 200);
+        }
+    }
+
+private:
+    void testBlocks (const int delay, std::initializer_list<int> blockSizes, const int maxBlockSize)
+    {
+        int total = 0;
+        for (const auto n : blockSizes)
+            total += n;
+
+        HeapBlock<float> input ((size_t) total), output ((size_t) total);
+        Random rand (delay + total);
+        for (int i = 0; i < total; ++i)
+            input[i] = output[i] = rand.nextFloat() * 2.f - 1.f;
+
+        DelayLine<float> line (delay, maxBlockSize);
+        int offset = 0;
+        for (const auto n : blockSizes)
+        {
+            line.process (output + offset, n);
+            offset += n;
+        }
+
+        bool matches = true;
+        for (int i = 0; i < total; ++i)
+        {
+            const float expected = i < delay ? 0.f : input [i - delay];
+            if (output[i] != expected)
+                matches = false;
+        }
+
+        expect (matches, "output should be the input shifted by the delay");
+    }
+};
+
+static DelayLineTest sDelayLineTest;
+
+}
@@ -0,0 +1,96 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/DirectMonitor.h"
+
+using namespace Element;
+
+//=============================================================================
+class DirectMonitorTest : public UnitTestBase
+{
+public:
+    DirectMonitorTest()
+        : UnitTestBase ("Direct Monitor", "engine", "directMonitor") { }
+
+    void runTest() override
+    {
+        AudioSampleBuffer input (2, blockSize), output (2, blockSize);
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < blockSize; ++i)
+                input.setSample (c, i, c == 0 ? 0.5f : -0.25f);
+
+        DirectMonitor monitor;
+        monitor.prepare (48000.0);
+
+        beginTest ("no routes leaves the outputs alone");
+        process (monitor, input, output);
+        expectEquals (output.getMagnitude (0, blockSize), 0.f);
+
+        beginTest ("routes ramp in and then mix at their gain");
+        DirectMonitor::Route route;
+        route.input = 1;
+        route.output = 0;
+        route.gain = 0.5f;
+        monitor.setRoutes ({ route });
+        process (monitor, input, output);
+        expectWithinAbsoluteError (output.getSample (0, 0), 0.f, 0.01f);
+        expectWithinAbsoluteError (output.getSample (0, blockSize - 1), -0.125f, 0.001f);
+        expectEquals (output.getMagnitude (1, 0, blockSize), 0.f);
+        process (monitor, input, output);
+        expectWithinAbsoluteError (output.getSample (0, 0), -0.125f, 0.0001f);
+
+        beginTest ("disabling ramps out");
+        monitor.setEnabled (false);
+        process (monitor, input, output);
+        expectWithinAbsoluteError (output.getSample (0, blockSize - 1), 0.f, 0.001f);
+        process (monitor, input, output);
+        expectEquals (output.getMagnitude (0, blockSize), 0.f);
+        monitor.setEnabled (true);
+
+        beginTest ("high pass takes out DC");
+        route.input = 0;
+        route.gain = 1.f;
+        route.highPassHz = 200.f;
+        monitor.setRoutes ({ route });
+        for (int i = 0; i < 20; ++i)
+            process (monitor, input, output);
+        expect (output.getMagnitude (0, blockSize) < 0.001f);
+
+        beginTest ("routes outside the device are skipped");
+        route.output = 5;
+        route.highPassHz = 0.f;
+        monitor.setRoutes ({ route });
+        process (monitor, input, output);
+        expectEquals (output.getMagnitude (0, blockSize), 0.f);
+        expectEquals (monitor.getRoutes().size(), 1);
+    }
+
+private:
+    enum { blockSize = 256 };
+
+    static void process (DirectMonitor& monitor, const AudioSampleBuffer& input, AudioSampleBuffer& output)
+    {
+        output.clear();
+        monitor.process (input.getArrayOfReadPointers(), input.getNumChannels(),
+                         output.getArrayOfWritePointers(), output.getNumChannels(), output.getNumSamples());
+    }
+};
+
+static DirectMonitorTest sDirectMonitorTest;
@@ -0,0 +1,119 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+/** Nodes at unity gain render straight through their processor until one
+    of their settings changes, which has to be heard on the next block */
+class DirectRenderPathTest : public UnitTestBase
+{
+public:
+    DirectRenderPathTest() : UnitTestBase ("Direct Render Path", "engine", "directRenderPath") { }
+    virtual ~DirectRenderPathTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        graph.prepareToPlay (44100.0, blockSize);
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("unity");
+        for (int i = 0; i < 4; ++i)
+            expectWithinAbsoluteError (render (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("gain changes");
+        volume->setGain (0.5f);
+        render (graph); // ramps
+        expectWithinAbsoluteError (render (graph), 0.25f, 1.0e-6f);
+        volume->setGain (1.f);
+        render (graph);
+        for (int i = 0; i < 4; ++i)
+            expectWithinAbsoluteError (render (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("mute");
+        volume->setMuted (true);
+        render (graph);
+        expectEquals (render (graph), 0.f);
+        volume->setMuted (false);
+        render (graph);
+        expectWithinAbsoluteError (render (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("input gain");
+        volume->setInputGain (0.f);
+        render (graph);
+        expectEquals (render (graph), 0.f);
+        volume->setInputGain (1.f);
+        render (graph);
+        expectWithinAbsoluteError (render (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("metering");
+        volume->addMeterSubscriber();
+        for (int i = 0; i < 200; ++i)
+            render (graph);
+        expect (volume->getOutputPeak (0) > 0.f, "levels weren't measured once subscribed");
+        volume->removeMeterSubscriber();
+        expectWithinAbsoluteError (render (graph), 0.5f, 1.0e-6f);
+
+        beginTest ("disabled");
+        // -6 dB on the processor itself, so passing straight through can be told apart
+        volume->getAudioProcessor()->getParameters()[0]->setValueNotifyingHost (0.75f);
+        for (int i = 0; i < 20; ++i)
+            render (graph);
+        const float processed = 0.5f * Decibels::decibelsToGain (-6.f);
+        expectWithinAbsoluteError (render (graph), processed, 1.0e-4f);
+        volume->setEnabled (false);
+        render (graph);
+        expectWithinAbsoluteError (render (graph), 0.5f, 1.0e-6f);
+        volume->setEnabled (true);
+        graph.handleUpdateNowIfNeeded();
+        for (int i = 0; i < 20; ++i)
+            render (graph);
+        expectWithinAbsoluteError (render (graph), processed, 1.0e-4f);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    /** Renders a block of 0.5 and returns the last sample of the first channel */
+    static float render (GraphProcessor& graph)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        for (int ch = 0; ch < 2; ++ch)
+            FloatVectorOperations::fill (audio.getWritePointer (ch), 0.5f, blockSize);
+        graph.processBlock (audio, midi);
+        return audio.getSample (0, blockSize - 1);
+    }
+};
+
+static DirectRenderPathTest sDirectRenderPathTest;
+
+}
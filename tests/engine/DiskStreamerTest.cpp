@@ -0,0 +1,124 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/DiskStreamer.h"
+
+namespace Element {
+
+class DiskStreamerTest : public UnitTestBase
+{
+public:
+    DiskStreamerTest() : UnitTestBase ("Disk Streamer", "engine", "diskStreamer") { }
+    virtual ~DiskStreamerTest() { }
+
+    void runTest() override
+    {
+        // every sample holds its own position, so reads can be checked
+        AudioBuffer<float> ramp (2, 44100);
+        for (int c = 0; c < ramp.getNumChannels(); ++c)
+            for (int i = 0; i < ramp.getNumSamples(); ++i)
+                ramp.setSample (c, i, (float) i / (float) ramp.getNumSamples());
+
+        DiskStreamer streamer;
+        expect (streamer.getNumThreads() > 0);
+
+        beginTest ("streaming");
+        StreamingAudioSource stream (new MemoryAudioSource (ramp, true, false), true, streamer, 8192, 2);
+        stream.prepareToPlay (512, 44100.0);
+        expectEquals (streamer.getNumStreams(), 1);
+        expect (stream.waitUntilReady (512, 2000));
+
+        AudioBuffer<float> block (2, 512);
+        AudioSourceChannelInfo info (block);
+        stream.getNextAudioBlock (info);
+        expectWithinAbsoluteError (block.getSample (0, 100), 100.f / 44100.f, 0.0001f);
+        expectWithinAbsoluteError (block.getSample (1, 511), 511.f / 44100.f, 0.0001f);
+        expectEquals ((int) stream.getNextReadPosition(), 512);
+
+        beginTest ("seeking");
+        stream.setNextReadPosition (30000);
+        expect (stream.waitUntilReady (512, 2000));
+        stream.getNextAudioBlock (info);
+        expectWithinAbsoluteError (block.getSample (0, 0), 30000.f / 44100.f, 0.0001f);
+
+        beginTest ("health");
+        expect (stream.waitUntilReady (4096, 2000));
+        const auto health = stream.getHealth();
+        expect (health.capacity >= 8192);
+        expect (health.framesAhead >= 4096);
+        expect (health.getFillLevel() > 0.f && health.getFillLevel() <= 1.f);
+        expectEquals (health.numUnderruns, 0);
+        expectEquals (streamer.getHealth().size(), 1);
+
+        beginTest ("the end of a file isn't an underrun");
+        stream.setNextReadPosition (ramp.getNumSamples() + 1000);
+        stream.getNextAudioBlock (info);
+        expectEquals (block.getMagnitude (0, 512), 0.f);
+        expectEquals (stream.getHealth().numUnderruns, 0);
+
+        stream.releaseResources();
+        expectEquals (streamer.getNumStreams(), 0);
+
+        beginTest ("cues play before the buffer fills");
+        auto* slow = new SlowSource (ramp);
+        StreamingAudioSource cued (slow, true, streamer, 8192, 2);
+        cued.setCues ({ 0, 20000 }, 4096);
+        expectEquals (cued.getNumCues(), 2);
+        cued.prepareToPlay (512, 44100.0);
+        expect (cued.waitUntilReady (512, 2000));
+
+        slow->slow = true;
+        cued.setNextReadPosition (20000);
+        cued.getNextAudioBlock (info);
+        expectWithinAbsoluteError (block.getSample (0, 0), 20000.f / 44100.f, 0.0001f);
+        expectWithinAbsoluteError (block.getSample (1, 511), 20511.f / 44100.f, 0.0001f);
+
+        // the frames before a cue are held as well
+        cued.setNextReadPosition (20000 - StreamingAudioSource::cuePreroll);
+        cued.getNextAudioBlock (info);
+        expectWithinAbsoluteError (block.getSample (0, 0), (float) (20000 - StreamingAudioSource::cuePreroll) / 44100.f, 0.0001f);
+        expectEquals (cued.getHealth().numUnderruns, 0);
+
+        slow->slow = false;
+        expect (cued.waitUntilReady (4096, 2000));
+        cued.getNextAudioBlock (info);
+        expectWithinAbsoluteError (block.getSample (0, 0), (float) (20512 - StreamingAudioSource::cuePreroll) / 44100.f, 0.0001f);
+        cued.releaseResources();
+    }
+
+private:
+    /** Takes its time reading once it's told to */
+    struct SlowSource : public MemoryAudioSource
+    {
+        SlowSource (AudioBuffer<float>& audio) : MemoryAudioSource (audio, true, false) { }
+
+        void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+        {
+            if (slow)
+                Thread::sleep (100);
+            MemoryAudioSource::getNextAudioBlock (info);
+        }
+
+        std::atomic<bool> slow { false };
+    };
+};
+
+static DiskStreamerTest sDiskStreamerTest;
+
+}
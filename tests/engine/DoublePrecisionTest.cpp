@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/SampleConversion.h"
+
+namespace Element {
+
+class DoublePrecisionTest : public UnitTestBase
+{
+public:
+    DoublePrecisionTest() : UnitTestBase ("Double Precision Rendering", "engine", "doublePrecision") { }
+    virtual ~DoublePrecisionTest() { }
+
+    void runTest() override
+    {
+        testConversion();
+        testPassThrough (false);
+        testPassThrough (true);
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    void testConversion()
+    {
+        beginTest ("sample conversion");
+        AudioSampleBuffer floats (1, 67);
+        AudioBuffer<double> doubles (1, 67);
+        for (int i = 0; i < floats.getNumSamples(); ++i)
+            floats.setSample (0, i, (float) i / 67.f - 0.5f);
+
+        SampleConversion::convert (floats, doubles, 1, floats.getNumSamples());
+        AudioSampleBuffer roundTrip (1, 67);
+        SampleConversion::convert (doubles, roundTrip, 1, floats.getNumSamples());
+
+        bool identical = true;
+        for (int i = 0; i < floats.getNumSamples(); ++i)
+            if (roundTrip.getSample (0, i) != floats.getSample (0, i)
+                || doubles.getSample (0, i) != (double) floats.getSample (0, i))
+                identical = false;
+        expect (identical, "widening then narrowing should be lossless");
+    }
+
+    void testPassThrough (const bool withFloatNode)
+    {
+        beginTest (withFloatNode ? "converts around single precision nodes" : "renders doubles end to end");
+
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.setProcessingPrecision (AudioProcessor::doublePrecision);
+        expect (graph.isUsingDoublePrecision());
+
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        graph.prepareToPlay (44100.0, blockSize);
+
+        if (withFloatNode)
+        {
+            GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            graph.prepareToPlay (44100.0, blockSize);
+            input->connectAudioTo (volume);
+            volume->connectAudioTo (output);
+        }
+        else
+        {
+            input->connectAudioTo (output);
+        }
+
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioBuffer<double> audio (2, blockSize);
+        MidiBuffer midi;
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                audio.setSample (ch, i, 0.25 + 1.0e-12 * (double) i);
+
+        graph.processBlock (audio, midi);
+
+        bool matches = true;
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const double expected = 0.25 + 1.0e-12 * (double) i;
+                const double error = std::abs (audio.getSample (ch, i) - expected);
+                if (withFloatNode ? error > 1.0e-6 : error != 0.0)
+                    matches = false;
+            }
+        }
+
+        expect (matches, "output should match the input");
+
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static DoublePrecisionTest sDoublePrecisionTest;
+
+}
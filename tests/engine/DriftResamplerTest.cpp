@@ -0,0 +1,104 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/DriftResampler.h"
+
+namespace Element {
+
+class DriftResamplerTest : public UnitTestBase
+{
+public:
+    DriftResamplerTest() : UnitTestBase ("Drift Resampler", "engine", "driftResampler") { }
+    virtual ~DriftResamplerTest() { }
+
+    void runTest() override
+    {
+        beginTest ("silence until the fifo fills");
+        {
+            DriftResampler resampler;
+            resampler.prepare (1, 48000.0, 48000.0, 256, 256);
+            expect (resampler.getLatencySamples() >= 512);
+            AudioBuffer<float> buffer (1, 256);
+            buffer.clear();
+            buffer.setSample (0, 0, 1.f);
+            resampler.push (buffer.getArrayOfReadPointers(), 1, 256, 0.0);
+            buffer.setSample (0, 0, 0.5f);
+            resampler.pull (buffer.getArrayOfWritePointers(), 1, 256, 0.0);
+            expectEquals (buffer.getMagnitude (0, 256), 0.f);
+            expectEquals (resampler.getStats().underruns, 0);
+        }
+
+        beginTest ("a faster source is measured and followed");
+        testDrift (48000.0 * (1.0 + 100.0e-6), 48000.0, 100.0);
+
+        beginTest ("a slower source is measured and followed");
+        testDrift (48000.0 * (1.0 - 50.0e-6), 48000.0, -50.0);
+
+        beginTest ("drift across nominal rates");
+        testDrift (44100.0 * (1.0 + 80.0e-6), 48000.0, 80.0);
+    }
+
+private:
+    /** Runs a source at its actual rate into a destination for a while,
+        the source's blocks landing whenever its clock says they're due */
+    void testDrift (double sourceRate, double destRate, double expectedPpm)
+    {
+        const int sourceBlock = 256, destBlock = 128;
+        const double nominalSource = std::round (sourceRate / 100.0) * 100.0;
+        DriftResampler resampler;
+        resampler.prepare (1, nominalSource, destRate, sourceBlock, destBlock);
+
+        AudioBuffer<float> in (1, sourceBlock), out (1, destBlock);
+        double phase = 0.0, sourceTime = 0.0;
+        const double delta = 440.0 / sourceRate;
+        float peak = 0.f;
+
+        const int numDestBlocks = (int) (60.0 * destRate / destBlock);
+        for (int block = 0; block < numDestBlocks; ++block)
+        {
+            const double now = (block + 1) * destBlock / destRate;
+            while (sourceTime + sourceBlock / sourceRate <= now)
+            {
+                auto* data = in.getWritePointer (0);
+                for (int i = 0; i < sourceBlock; ++i)
+                {
+                    data[i] = (float) std::sin (MathConstants<double>::twoPi * phase);
+                    phase += delta;
+                }
+                sourceTime += sourceBlock / sourceRate;
+                resampler.push (in.getArrayOfReadPointers(), 1, sourceBlock, sourceTime);
+            }
+
+            resampler.pull (out.getArrayOfWritePointers(), 1, destBlock, now);
+            if (block > numDestBlocks / 2)
+                peak = jmax (peak, out.getMagnitude (0, 0, destBlock));
+        }
+
+        const auto stats = resampler.getStats();
+        expectWithinAbsoluteError (stats.driftPpm, expectedPpm, 5.0);
+        expectEquals (stats.overruns, 0);
+        expect (stats.underruns <= 1);
+        expectWithinAbsoluteError (stats.fill, (double) stats.targetFill, (double) sourceBlock);
+        expectWithinAbsoluteError (peak, 1.f, 0.05f);
+    }
+};
+
+static DriftResamplerTest sDriftResamplerTest;
+
+}
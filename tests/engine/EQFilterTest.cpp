@@ -0,0 +1,97 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/EQFilterProcessor.h"
+
+namespace Element {
+
+class EQFilterTest : public UnitTestBase
+{
+public:
+    EQFilterTest() : UnitTestBase ("EQ Filter", "engine", "eqFilter") { }
+    virtual ~EQFilterTest() { }
+
+    void runTest() override
+    {
+        Random random (1234);
+        AudioBuffer<float> noise (3, 2048);
+        for (int c = 0; c < noise.getNumChannels(); ++c)
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample (c, i, random.nextFloat() * 2.f - 1.f);
+
+        for (auto shape : { EQFilter::Bell, EQFilter::LowShelf, EQFilter::HighPass })
+        {
+            beginTest ("channels together match one at a time, shape " + String ((int) shape));
+            EQFilter mono, multi;
+            setup (mono, shape);
+            setup (multi, shape);
+
+            // sweep while processing so the coefficients move
+            mono.setFrequency (4000.f);
+            multi.setFrequency (4000.f);
+            mono.setGain (0.5f);
+            multi.setGain (0.5f);
+
+            AudioBuffer<float> single (1, noise.getNumSamples());
+            single.copyFrom (0, 0, noise, 2, 0, noise.getNumSamples());
+            AudioBuffer<float> all (noise);
+
+            for (int start = 0; start < noise.getNumSamples(); start += 256)
+            {
+                auto* chan = single.getWritePointer (0, start);
+                mono.processBlock (chan, 256);
+
+                float* chans[3];
+                for (int c = 0; c < 3; ++c)
+                    chans[c] = all.getWritePointer (c, start);
+                multi.processBlock (chans, 3, 256);
+            }
+
+            float maxDifference = 0.f;
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                maxDifference = jmax (maxDifference, std::abs (single.getSample (0, i) - all.getSample (2, i)));
+            expectLessThan (maxDifference, 1.0e-5f);
+        }
+
+        beginTest ("a bell at unity gain passes audio through");
+        EQFilter flat;
+        setup (flat, EQFilter::Bell);
+        AudioBuffer<float> audio (noise);
+        flat.processBlock (audio.getArrayOfWritePointers(), 3, audio.getNumSamples());
+        float maxDifference = 0.f;
+        for (int c = 0; c < 3; ++c)
+            for (int i = 0; i < audio.getNumSamples(); ++i)
+                maxDifference = jmax (maxDifference, std::abs (audio.getSample (c, i) - noise.getSample (c, i)));
+        expectLessThan (maxDifference, 1.0e-3f);
+    }
+
+private:
+    static void setup (EQFilter& filter, EQFilter::Shape shape)
+    {
+        filter.setFrequency (1000.f);
+        filter.setQ (0.707f);
+        filter.setGain (1.f);
+        filter.setShape (shape);
+        filter.reset (44100.0);
+    }
+};
+
+static EQFilterTest sEQFilterTest;
+
+}
@@ -0,0 +1,89 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/EngineMetrics.h"
+#include "engine/MetricsServer.h"
+
+using namespace Element;
+
+//=============================================================================
+class EngineMetricsTest : public UnitTestBase
+{
+public:
+    EngineMetricsTest() : UnitTestBase ("Engine Metrics", "engine", "metrics") { }
+
+    void runTest() override
+    {
+        EngineMetrics metrics;
+        metrics.cpuLoad = 0.25;
+        metrics.numOverruns = 3;
+        metrics.profiling = true;
+        EngineMetrics::Graph graph;
+        graph.name = "Main \"A\"";
+        graph.numNodes = 2;
+        graph.memoryBytes = 65536;
+        graph.memoryBudget = 32768;
+        metrics.graphs.add (graph);
+        EngineMetrics::Node node;
+        node.graph = graph.name;
+        node.name = "Synth";
+        node.nodeId = 7;
+        node.time.averageMs = 0.5;
+        node.memory.oversamplingBytes = 4096;
+        metrics.nodes.add (node);
+
+        beginTest ("prometheus text");
+        const auto text = metrics.toPrometheus();
+        expect (text.contains ("# TYPE element_xruns_total counter\nelement_xruns_total 3\n"));
+        expect (text.contains ("element_callback_load 0.25\n"));
+        expect (text.contains ("element_graph_memory_bytes{graph=\"Main \\\"A\\\"\"} 65536\n"));
+        expect (text.contains ("element_node_average_ms{graph=\"Main \\\"A\\\"\",node=\"Synth\",id=\"7\"} 0.5\n"));
+        expect (text.contains ("element_node_memory_bytes{graph=\"Main \\\"A\\\"\",node=\"Synth\",id=\"7\",kind=\"oversampling\"} 4096\n"));
+        expect (text.contains ("element_graph_memory_budget_bytes{graph=\"Main \\\"A\\\"\"} 32768\n"));
+        expect (metrics.graphs.getReference (0).isOverBudget());
+
+        beginTest ("json");
+        const auto json = JSON::parse (metrics.toJSON());
+        expectEquals ((int) json["xruns"], 3);
+        expectEquals (json["graphs"][0]["name"].toString(), graph.name);
+        expectEquals ((int) json["nodes"][0]["id"], 7);
+        expectEquals ((int) json["nodes"][0]["memory"]["total"], 4096);
+
+        beginTest ("node times need profiling");
+        metrics.profiling = false;
+        expect (! metrics.toPrometheus().contains ("element_node_average_ms"));
+        expect (metrics.toPrometheus().contains ("element_node_memory_bytes"));
+
+        beginTest ("websocket handshake");
+        expectEquals (MetricsServer::getWebSocketAccept ("dGhlIHNhbXBsZSBub25jZQ=="),
+                      String ("s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+
+        beginTest ("websocket frames");
+        auto frame = MetricsServer::makeTextFrame ("hello");
+        expectEquals ((int) frame.getSize(), 7);
+        expectEquals ((int) (uint8) frame[0], 0x81);
+        expectEquals ((int) (uint8) frame[1], 5);
+        frame = MetricsServer::makeTextFrame (String::repeatedString ("x", 300));
+        expectEquals ((int) frame.getSize(), 304);
+        expectEquals ((int) (uint8) frame[1], 126);
+        expectEquals (((int) (uint8) frame[2] << 8) | (int) (uint8) frame[3], 300);
+    }
+};
+
+static EngineMetricsTest sEngineMetricsTest;
@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/GainStage.h"
+
+namespace Element {
+
+/** Compares the gain stage kernel against the AudioSampleBuffer calls node
+    processing used to make for every block. */
+class GainStageBenchmark : public UnitTestBase
+{
+public:
+    GainStageBenchmark() : UnitTestBase ("Gain Stage Benchmark", "engine", "gainStage") { }
+    virtual ~GainStageBenchmark() { }
+
+    void runTest() override
+    {
+        testRamps();
+
+        for (const int numChannels : { 1, 2, 8, 32 })
+        {
+            beginTest (String (numChannels) + " channels");
+            benchmark (numChannels, 1.f, 1.f, "unity");
+            benchmark (numChannels, 0.5f, 0.5f, "constant");
+            benchmark (numChannels, 0.5f, 1.f, "ramp");
+        }
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr int numBlocks = 4000;
+
+    void testRamps()
+    {
+        beginTest ("mute state machine");
+        float start = -1.f, end = -1.f;
+        GainStage::getRamp (true, true, false, 0.8f, 0.8f, start, end);
+        expect (start == 0.8f && end == 0.f, "muting should ramp down");
+        GainStage::getRamp (true, true, true, 0.8f, 0.8f, start, end);
+        expect (start == 0.f && end == 0.f, "muted should stay silent");
+        GainStage::getRamp (true, false, true, 0.8f, 0.6f, start, end);
+        expect (start == 0.f && end == 0.6f, "unmuting should ramp up");
+        GainStage::getRamp (false, true, false, 0.8f, 0.6f, start, end);
+        expect (start == 0.8f && end == 0.6f, "other stage should follow the gain");
+
+        beginTest ("ramp matches AudioBuffer");
+        AudioSampleBuffer a (2, blockSize + 1), b (2, blockSize + 1);
+        fill (a);
+        b.makeCopyOf (a);
+        float* chans[2] = { a.getWritePointer (0, 1), a.getWritePointer (1, 1) };
+        GainStage::process (chans, 2, blockSize, 0.1f, 0.9f, nullptr);
+        b.applyGainRamp (1, blockSize, 0.1f, 0.9f);
+        expectLessThan (maxDifference (a, b), 0.0001f);
+    }
+
+    void benchmark (const int numChannels, const float startGain, const float endGain, const String& name)
+    {
+        ScopedNoDenormals noDenormals;
+        AudioSampleBuffer reference (numChannels, blockSize), fused (numChannels, blockSize);
+        fill (reference);
+        fused.makeCopyOf (reference);
+
+        const auto referenceStart = Time::getMillisecondCounterHiRes();
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            if (startGain == endGain)
+                reference.applyGain (0, blockSize, startGain);
+            else
+                reference.applyGainRamp (0, blockSize, startGain, endGain);
+        }
+        const auto referenceTime = Time::getMillisecondCounterHiRes() - referenceStart;
+
+        const auto fusedStart = Time::getMillisecondCounterHiRes();
+        for (int block = 0; block < numBlocks; ++block)
+            GainStage::process (fused.getArrayOfWritePointers(), numChannels, blockSize,
+                                startGain, endGain, nullptr);
+        const auto fusedTime = Time::getMillisecondCounterHiRes() - fusedStart;
+
+        logMessage (name + ": AudioBuffer " + String (referenceTime, 3) + " ms, gain stage "
+            + String (fusedTime, 3) + " ms");
+
+        // both saw the same sequence of gains
+        expectLessThan (maxDifference (reference, fused), 0.0001f);
+    }
+
+    static void fill (AudioSampleBuffer& audio)
+    {
+        Random rand (99);
+        for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+            for (int i = 0; i < audio.getNumSamples(); ++i)
+                audio.setSample (ch, i, rand.nextFloat() * 2.f - 1.f);
+    }
+
+    static float maxDifference (const AudioSampleBuffer& a, const AudioSampleBuffer& b)
+    {
+        float difference = 0.f;
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            for (int i = 0; i < a.getNumSamples(); ++i)
+                difference = jmax (difference, std::abs (a.getSample (ch, i) - b.getSample (ch, i)));
+        return difference;
+    }
+};
+
+static GainStageBenchmark sGainStageBenchmark;
+
+}
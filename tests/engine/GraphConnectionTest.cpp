@@ -0,0 +1,112 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class GraphConnectionTest : public UnitTestBase
+{
+public:
+    GraphConnectionTest() : UnitTestBase ("Graph Connections", "engine", "graphConnections") { }
+    virtual ~GraphConnectionTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+
+        Array<uint32> ids;
+        for (int i = 0; i < 4; ++i)
+            if (auto* node = graph.addNode (new VolumeProcessor (-60.0, 12.0, true)))
+                ids.add (node->nodeId);
+        expectEquals (ids.size(), 4);
+
+        auto outPort = [&graph] (uint32 nodeId, int ch) {
+            return graph.getNodeForId (nodeId)->getPortForChannel (PortType::Audio, ch, false); };
+        auto inPort = [&graph] (uint32 nodeId, int ch) {
+            return graph.getNodeForId (nodeId)->getPortForChannel (PortType::Audio, ch, true); };
+        auto connect = [&] (uint32 src, uint32 dst, int ch) {
+            return graph.addConnection (src, outPort (src, ch), dst, inPort (dst, ch)); };
+        auto between = [&] (uint32 src, int srcCh, uint32 dst, int dstCh) {
+            return graph.getConnectionBetween (src, outPort (src, srcCh), dst, inPort (dst, dstCh)); };
+
+        beginTest ("queries");
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            expect (connect (ids[0], ids[1], ch));
+            expect (connect (ids[1], ids[2], ch));
+            expect (connect (ids[0], ids[3], ch));
+        }
+
+        expect (! connect (ids[0], ids[1], 0), "duplicates should be refused");
+        expect (graph.isConnected (ids[0], ids[1]));
+        expect (! graph.isConnected (ids[1], ids[0]));
+        expect (! graph.isConnected (ids[2], ids[3]));
+        expect (between (ids[1], 1, ids[2], 1) != nullptr);
+        expect (between (ids[1], 0, ids[2], 1) == nullptr);
+
+        beginTest ("removal");
+        expect (graph.removeConnection (ids[1], outPort (ids[1], 0), ids[2], inPort (ids[2], 0)));
+        expect (! graph.removeConnection (ids[1], outPort (ids[1], 0), ids[2], inPort (ids[2], 0)));
+        expect (between (ids[1], 0, ids[2], 0) == nullptr);
+        expect (graph.isConnected (ids[1], ids[2]), "the other channel is still connected");
+        expectEquals (graph.getNumConnections(), 5);
+
+        beginTest ("disconnect node");
+        expect (graph.disconnectNode (ids[0]));
+        expect (! graph.disconnectNode (ids[0]));
+        expect (! graph.isConnected (ids[0], ids[1]));
+        expect (! graph.isConnected (ids[0], ids[3]));
+        expectEquals (graph.getNumConnections(), 1);
+
+        const uint32 lastPort = outPort (ids[1], 1);
+        graph.removeNode (ids[2]);
+        expectEquals (graph.getNumConnections(), 0);
+        expect (! graph.isConnected (ids[1], ids[2]));
+        expect (graph.getConnectionBetween (ids[1], lastPort, ids[2], 1) == nullptr);
+
+        graph.clear();
+
+        beginTest ("routed io channels");
+        GraphProcessor io;
+        io.setPlayConfigDetails (4, 4, 44100.0, 512);
+        GraphNodePtr input = io.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = io.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = io.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        expect (io.connectChannels (PortType::Audio, input->nodeId, 2, volume->nodeId, 0));
+        expect (io.connectChannels (PortType::Audio, volume->nodeId, 1, output->nodeId, 3));
+        expect (io.connectChannels (PortType::Audio, input->nodeId, 0, output->nodeId, 0));
+
+        BigInteger inputs, outputs;
+        io.getRoutedAudioChannels (inputs, outputs);
+        expectEquals (inputs.toString (2), String ("101"));
+        expectEquals (outputs.toString (2), String ("1001"));
+
+        io.clear();
+        io.getRoutedAudioChannels (inputs, outputs);
+        expect (inputs.isZero() && outputs.isZero());
+    }
+};
+
+static GraphConnectionTest sGraphConnectionTest;
+
+}
@@ -79,6 +79,14 @@ public:
             auto ls = graph.getLatencySamples();
             expect (graph.getNumConnections() == 2);
             expect (graph.getLatencySamples() == 100);
+
+            beginTest ("cached programs bring their latency back");
+            graph.disconnectNode (node1->nodeId);
+            runDispatchLoop (15);
+            expect (graph.getLatencySamples() == 0);
+            node1->connectAudioTo (node2);
+            runDispatchLoop (15);
+            expect (graph.getLatencySamples() == 100);
             
             node1 = nullptr; node2 = nullptr;
             graph.releaseResources();
@@ -218,6 +226,34 @@ public:
 
 static EnablementTest sEnablementTest;
 
+/** Test mutes set from other threads still reach listeners */
+class MuteTest : public GraphNodeTest
+{
+public:
+    MuteTest() : GraphNodeTest ("Node Mute", "mute") { }
+    void runTest() override
+    {
+        GraphNodePtr node = graph->addNode (new PlaceholderProcessor (2, 2, false, false));
+        int numChanges = 0;
+        auto connection = node->muteChanged.connect ([&numChanges] (GraphNode*) { ++numChanges; });
+
+        beginTest ("set from any thread");
+        node->setMutedFromAnyThread (true);
+        expect (node->isMuted(), "the render program should see the mute straight away");
+        expectEquals (numChanges, 0);
+        node->setMuted (true);
+        expectEquals (numChanges, 1, "listeners should hear about it when it's set properly");
+        node->setMuted (true);
+        expectEquals (numChanges, 1);
+        node->setMuted (false);
+        expect (! node->isMuted());
+        expectEquals (numChanges, 2);
+        connection.disconnect();
+    }
+};
+
+static MuteTest sMuteTest;
+
 /** Test nodes get the correct type property */
 class GetTypeStringTest : public GraphNodeTest
 {
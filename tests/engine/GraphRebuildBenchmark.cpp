@@ -0,0 +1,196 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class GraphRebuildBenchmark : public UnitTestBase
+{
+public:
+    GraphRebuildBenchmark() : UnitTestBase ("Graph Rebuild Benchmark", "engine", "graphRebuild") { }
+    virtual ~GraphRebuildBenchmark() { }
+
+    void runTest() override
+    {
+        for (const int numNodes : { 16, 64, 256, 512 })
+        {
+            beginTest ("rebuild " + String (numNodes) + " nodes");
+            benchmark (numNodes);
+        }
+
+        beginTest ("wide mix");
+        testWideMix (16);
+
+        beginTest ("revert uses cached program");
+        testRevert();
+    }
+
+private:
+    /** Fans the graph input out to parallel nodes and mixes them back, which
+        keeps many buffers live at once */
+    void testWideMix (const int numBranches)
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        graph.prepareToPlay (44100.0, 512);
+
+        for (int i = 0; i < numBranches; ++i)
+        {
+            GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            graph.prepareToPlay (44100.0, 512);
+            input->connectAudioTo (volume);
+            volume->connectAudioTo (output);
+        }
+
+        graph.prepareToPlay (44100.0, 512);
+
+        AudioSampleBuffer audio (2, 512);
+        MidiBuffer midi;
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < 512; ++i)
+                audio.setSample (ch, i, 0.01f);
+
+        graph.processBlock (audio, midi);
+
+        bool mixed = true;
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < 512; ++i)
+                if (std::abs (audio.getSample (ch, i) - 0.01f * (float) numBranches) > 1.0e-5f)
+                    mixed = false;
+
+        expect (mixed, "output should be the sum of every branch");
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    void testRevert()
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        graph.prepareToPlay (44100.0, 512);
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, 512);
+
+        const auto mix = [&graph, &input, &output] (const bool connected)
+        {
+            const uint32 src = input->getPortForChannel (PortType::Audio, 0, false);
+            const uint32 dst = output->getPortForChannel (PortType::Audio, 0, true);
+            if (connected)
+                graph.addConnection (input->nodeId, src, output->nodeId, dst);
+            else
+                graph.removeConnection (input->nodeId, src, output->nodeId, dst);
+            graph.handleUpdateNowIfNeeded();
+        };
+
+        auto render = [&graph] () -> float
+        {
+            AudioSampleBuffer audio (2, 512);
+            MidiBuffer midi;
+            for (int ch = 0; ch < 2; ++ch)
+                FloatVectorOperations::fill (audio.getWritePointer (ch), 0.25f, 512);
+            graph.processBlock (audio, midi);
+            return audio.getSample (0, 511);
+        };
+
+        expectWithinAbsoluteError (render(), 0.25f, 1.0e-5f);
+
+        mix (true);
+        expectWithinAbsoluteError (render(), 0.5f, 1.0e-5f);
+
+        const auto start = Time::getMillisecondCounterHiRes();
+        mix (false);
+        const auto elapsed = Time::getMillisecondCounterHiRes() - start;
+        logMessage ("revert: " + String (elapsed, 3) + " ms");
+        expectWithinAbsoluteError (render(), 0.25f, 1.0e-5f);
+
+        mix (true);
+        expectWithinAbsoluteError (render(), 0.5f, 1.0e-5f);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    void benchmark (const int numNodes)
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+
+        // nodes are added in reverse so the sort actually has to reorder them
+        Array<uint32> ids;
+        for (int i = 0; i < numNodes; ++i)
+            if (auto* node = graph.addNode (new VolumeProcessor (-60.0, 12.0, true)))
+                ids.insert (0, node->nodeId);
+
+        // a chain with extra skip connections, roughly 4 arcs per node
+        for (int i = 0; i < numNodes - 1; ++i)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                graph.addConnection (ids[i], ch, ids[i + 1], ch);
+                if (i + 4 < numNodes)
+                    graph.addConnection (ids[i], ch, ids[i + 4], ch);
+            }
+        }
+
+        const int numRuns = 10;
+        const auto start = Time::getMillisecondCounterHiRes();
+        for (int i = 0; i < numRuns; ++i)
+            graph.prepareToPlay (44100.0, 512);
+        const auto elapsed = (Time::getMillisecondCounterHiRes() - start) / (double) numRuns;
+
+        logMessage (String (numNodes) + " nodes, " + String (graph.getNumConnections())
+            + " connections: " + String (elapsed, 3) + " ms per rebuild");
+
+        ReferenceCountedArray<GraphNode> ordered;
+        graph.getOrderedNodes (ordered);
+        expectEquals (ordered.size(), numNodes);
+
+        bool inOrder = true;
+        for (int i = 0; i < graph.getNumConnections(); ++i)
+        {
+            const auto* c = graph.getConnection (i);
+            if (ordered.indexOf (graph.getNodeForId (c->sourceNode)) >
+                ordered.indexOf (graph.getNodeForId (c->destNode)))
+                inOrder = false;
+        }
+
+        expect (inOrder, "sources must be ordered before destinations");
+
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static GraphRebuildBenchmark sGraphRebuildBenchmark;
+
+}
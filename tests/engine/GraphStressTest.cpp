@@ -0,0 +1,427 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+//=============================================================================
+// allocations are counted through the global operator new, only on threads
+// that asked for it. Memory taken straight from malloc isn't seen
+namespace {
+thread_local bool countingAllocations = false;
+std::atomic<int> countedAllocations { 0 };
+}
+
+void* operator new (std::size_t size)
+{
+    if (countingAllocations)
+        countedAllocations.fetch_add (1, std::memory_order_relaxed);
+    if (auto* ptr = std::malloc (size > 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)                 { return operator new (size); }
+void operator delete (void* ptr) noexcept               { std::free (ptr); }
+void operator delete[] (void* ptr) noexcept             { std::free (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept  { std::free (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept { std::free (ptr); }
+
+namespace Element {
+
+/** Renders continuously on a simulated audio thread while other threads edit
+    the graphs, change parameters and switch between graphs. Every block is
+    checked against its deadline, for allocations and for torn output: the
+    second channel of every graph is wired straight through and must come out
+    exactly as it went in, whatever happens to the nodes on the first */
+class GraphStressTest : public UnitTestBase
+{
+public:
+    GraphStressTest() : UnitTestBase ("Graph Stress", "engine", "graphStress") { }
+    virtual ~GraphStressTest() { }
+
+    void runTest() override
+    {
+        beginTest ("edits while rendering");
+        testGraphEdits();
+
+        beginTest ("graph switches while rendering");
+        testGraphSwitches();
+    }
+
+private:
+    static constexpr double sampleRate  = 48000.0;
+    static constexpr int blockSize      = 256;
+    static constexpr int maxNodes       = 8;        ///< volume nodes per graph, besides the IO
+    static constexpr int stressMillis   = 1500;
+    static constexpr int warmupBlocks   = 20;       ///< blocks rendered before edits start
+    static constexpr float maxLevel     = 256.f;    ///< more than every path at unity adds up to
+
+    /** A graph being edited, and the IO nodes that are left alone */
+    struct Target
+    {
+        GraphProcessor* graph = nullptr;
+        uint32 input = 0, output = 0;
+    };
+
+    //=========================================================================
+    class RenderThread : public Thread
+    {
+    public:
+        std::function<void (AudioSampleBuffer&, MidiBuffer&)> render;
+        bool checkProbe = true;
+
+        int numBlocks = 0, numMisses = 0, numAllocations = 0, numTorn = 0;
+        double worstMs = 0.0;
+
+        RenderThread() : Thread ("el.stress.render") { }
+
+        bool isWarmedUp() const noexcept { return warmedUp.load(); }
+
+        void run() override
+        {
+            AudioSampleBuffer audio (2, blockSize), input (2, blockSize);
+            MidiBuffer midi;
+            midi.ensureSize (1024);
+            const double periodMs = 1000.0 * (double) blockSize / sampleRate;
+            int block = 0;
+
+            while (! threadShouldExit())
+            {
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    input.setSample (0, i, 0.25f);
+                    input.setSample (1, i, (float) ((block * blockSize + i) % 1000) * 0.001f);
+                }
+
+                audio.makeCopyOf (input, true);
+                midi.clear();
+
+                const bool counting = block >= warmupBlocks;
+                const int allocationsBefore = countedAllocations.load();
+                const auto start = Time::getMillisecondCounterHiRes();
+                countingAllocations = counting;
+                render (audio, midi);
+                countingAllocations = false;
+                const auto elapsed = Time::getMillisecondCounterHiRes() - start;
+
+                if (counting)
+                {
+                    ++numBlocks;
+                    numAllocations += countedAllocations.load() - allocationsBefore;
+                    if (elapsed > periodMs)
+                        ++numMisses;
+                    worstMs = jmax (worstMs, elapsed);
+                    if (! isIntact (input, audio))
+                        ++numTorn;
+                }
+
+                if (++block == warmupBlocks)
+                    warmedUp.store (true);
+
+                // a device would call back once per period
+                const auto remaining = start + periodMs - Time::getMillisecondCounterHiRes();
+                if (remaining >= 1.0)
+                    Thread::sleep ((int) remaining);
+            }
+        }
+
+    private:
+        std::atomic<bool> warmedUp { false };
+
+        bool isIntact (const AudioSampleBuffer& input, const AudioSampleBuffer& output) const
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const float sample = output.getSample (0, i);
+                if (! std::isfinite (sample) || std::abs (sample) > maxLevel)
+                    return false;
+                if (checkProbe && output.getSample (1, i) != input.getSample (1, i))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    //=========================================================================
+    /** Applies random edits to the targets. Structural edits are made holding
+        the message manager lock like any other thread touching a graph;
+        parameters are changed without it */
+    class EditThread : public Thread
+    {
+    public:
+        EditThread (const Array<Target>& t, int64 seed)
+            : Thread ("el.stress.edit"), targets (t), random (seed) { }
+
+        int numEdits = 0;
+
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                edit (targets.getReference (random.nextInt (targets.size())));
+                Thread::sleep (random.nextInt (3));
+            }
+        }
+
+    private:
+        const Array<Target> targets;
+        Random random;
+
+        void edit (const Target& target)
+        {
+            GraphNodePtr changed;
+
+            {
+                const MessageManagerLock mml (this);
+                if (! mml.lockWasGained())
+                    return;
+
+                auto& graph = *target.graph;
+                switch (random.nextInt (5))
+                {
+                    case 0: {
+                        if (graph.getNumNodes() < maxNodes + 2)
+                            graph.addNode (new VolumeProcessor (-60.0, 0.0, false));
+                    } break;
+
+                    case 1: {
+                        if (auto* node = pickVolume (target))
+                            graph.removeNode (node->nodeId);
+                    } break;
+
+                    case 2: {
+                        auto* a = graph.getNode (random.nextInt (jmax (1, graph.getNumNodes())));
+                        auto* b = graph.getNode (random.nextInt (jmax (1, graph.getNumNodes())));
+                        if (a == nullptr || b == nullptr || a == b)
+                            break;
+
+                        // connecting in order of id keeps the graph free of cycles
+                        if (a->nodeId > b->nodeId)
+                            std::swap (a, b);
+                        if (a->nodeId == target.output || b->nodeId == target.input)
+                            break;
+                        graph.addConnection (a->nodeId, a->getPortForChannel (PortType::Audio, 0, false),
+                                             b->nodeId, b->getPortForChannel (PortType::Audio, 0, true));
+                    } break;
+
+                    case 3: {
+                        const int index = random.nextInt (jmax (1, graph.getNumConnections()));
+                        if (const auto* c = graph.getConnection (index))
+                            if (! isProbe (target, *c))
+                                graph.removeConnection (index);
+                    } break;
+
+                    default: {
+                        changed = pickVolume (target);
+                    } break;
+                }
+            }
+
+            if (changed != nullptr)
+            {
+                if (auto* processor = changed->getAudioProcessor())
+                    if (auto* parameter = processor->getParameters()[0])
+                        parameter->setValueNotifyingHost (random.nextFloat());
+
+                // a node removed meanwhile is deleted where the message thread would delete it
+                const MessageManagerLock mml (this);
+                changed = nullptr;
+            }
+
+            ++numEdits;
+        }
+
+        GraphNode* pickVolume (const Target& target)
+        {
+            auto& graph = *target.graph;
+            if (graph.getNumNodes() <= 2)
+                return nullptr;
+            auto* node = graph.getNode (random.nextInt (graph.getNumNodes()));
+            return node != nullptr && node->nodeId != target.input && node->nodeId != target.output
+                ? node : nullptr;
+        }
+
+        static bool isProbe (const Target& target, const GraphProcessor::Connection& c)
+        {
+            auto* input = target.graph->getNodeForId (target.input);
+            return c.sourceNode == target.input && c.destNode == target.output
+                && input != nullptr && c.sourcePort == input->getPortForChannel (PortType::Audio, 1, false);
+        }
+    };
+
+    //=========================================================================
+    static Target createTarget (GraphProcessor& graph)
+    {
+        graph.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        GraphNodePtr input = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 0.0, false));
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        graph.connectChannels (PortType::Audio, input->nodeId, 0, volume->nodeId, 0);
+        graph.connectChannels (PortType::Audio, volume->nodeId, 0, output->nodeId, 0);
+        graph.connectChannels (PortType::Audio, input->nodeId, 1, output->nodeId, 1);
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        Target target;
+        target.graph = &graph;
+        target.input = input->nodeId;
+        target.output = output->nodeId;
+        return target;
+    }
+
+    /** Lets the render thread warm up, then keeps editing for a while. The
+        message loop runs meanwhile to grant locks and rebuild graphs */
+    void stress (RenderThread& renderer, OwnedArray<Thread>& editors)
+    {
+        renderer.startThread (8);
+        for (int i = 0; i < 500 && ! renderer.isWarmedUp(); ++i)
+            runDispatchLoop (10);
+
+        for (auto* editor : editors)
+            editor->startThread();
+        runDispatchLoop (stressMillis);
+
+        for (auto* editor : editors)
+            editor->signalThreadShouldExit();
+        while (editors.size() > 0)
+        {
+            runDispatchLoop (10);
+            if (! editors.getFirst()->isThreadRunning())
+                editors.remove (0);
+        }
+
+        renderer.stopThread (1000);
+    }
+
+    void expectHealthy (const RenderThread& renderer)
+    {
+        logMessage (String (renderer.numBlocks) + " blocks, " + String (renderer.numMisses)
+            + " missed, worst " + String (renderer.worstMs, 3) + " ms");
+        expect (renderer.numBlocks > 0, "nothing rendered");
+        expectEquals (renderer.numAllocations, 0, "render thread allocated");
+        expectEquals (renderer.numTorn, 0, "blocks rendered torn state");
+
+        // a loaded machine misses the odd deadline, a lock held while editing misses many
+        expect (renderer.numMisses <= jmax (1, renderer.numBlocks / 100),
+                String (renderer.numMisses) + " deadlines missed");
+    }
+
+    void expectConsistent (const Target& target)
+    {
+        auto& graph = *target.graph;
+        graph.handleUpdateNowIfNeeded();
+
+        bool connected = true;
+        for (int i = 0; i < graph.getNumConnections(); ++i)
+            if (! graph.isConnectionLegal (graph.getConnection (i)))
+                connected = false;
+        expect (connected, "connections outlived their nodes");
+
+        ReferenceCountedArray<GraphNode> ordered;
+        graph.getOrderedNodes (ordered);
+        expectEquals (ordered.size(), graph.getNumNodes());
+    }
+
+    void testGraphEdits()
+    {
+        GraphProcessor graph;
+        Array<Target> targets;
+        targets.add (createTarget (graph));
+
+        RenderThread renderer;
+        renderer.render = [&graph] (AudioSampleBuffer& audio, MidiBuffer& midi) {
+            graph.processBlock (audio, midi);
+        };
+
+        OwnedArray<Thread> editors;
+        for (int i = 0; i < 2; ++i)
+            editors.add (new EditThread (targets, 1234 + i));
+        stress (renderer, editors);
+
+        expectHealthy (renderer);
+        expectConsistent (targets.getFirst());
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    void testGraphSwitches()
+    {
+        Globals world;
+        world.setEngine (new AudioEngine (world));
+        auto engine = world.getAudioEngine();
+        engine->prepareExternalPlayback (sampleRate, blockSize, 2, 2);
+
+        OwnedArray<RootGraph> graphs;
+        Array<Target> targets;
+        for (int i = 0; i < 2; ++i)
+        {
+            auto* graph = graphs.add (new RootGraph());
+            targets.add (createTarget (*graph));
+            engine->addGraph (graph);
+        }
+        engine->setActiveGraph (0);
+
+        // switching fades between graphs, so only the first channel is checked
+        RenderThread renderer;
+        renderer.checkProbe = false;
+        renderer.render = [engine] (AudioSampleBuffer& audio, MidiBuffer& midi) {
+            engine->processExternalBuffers (audio, midi);
+        };
+
+        struct SwitchThread : public Thread
+        {
+            SwitchThread (AudioEngine& e) : Thread ("el.stress.switch"), engine (e) { }
+            void run() override
+            {
+                Random random (4321);
+                while (! threadShouldExit())
+                {
+                    engine.setActiveGraph (random.nextInt (2));
+                    Thread::sleep (5 + random.nextInt (20));
+                }
+            }
+            AudioEngine& engine;
+        };
+
+        OwnedArray<Thread> editors;
+        editors.add (new EditThread (targets, 5678));
+        editors.add (new SwitchThread (*engine));
+        stress (renderer, editors);
+
+        expectHealthy (renderer);
+        for (const auto& target : targets)
+            expectConsistent (target);
+
+        engine->releaseExternalResources();
+        for (auto* graph : graphs)
+        {
+            engine->removeGraph (graph);
+            graph->clear();
+        }
+
+        graphs.clear();
+        engine = nullptr;
+        world.setEngine (nullptr);
+    }
+};
+
+static GraphStressTest sGraphStressTest;
+
+}
@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class GraphWarmUpTest : public UnitTestBase
+{
+public:
+    GraphWarmUpTest() : UnitTestBase ("Graph Warm Up", "engine", "graphWarmUp") { }
+    virtual ~GraphWarmUpTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        auto* first = new CountingProcessor();
+        auto* second = new CountingProcessor();
+        GraphNodePtr firstNode = graph.addNode (first);
+        GraphNodePtr secondNode = graph.addNode (second);
+        graph.prepareToPlay (44100.0, 512);
+
+        beginTest ("renders every node");
+        graph.warmUp (8);
+        expectEquals (first->numBlocks.load(), 8);
+        expectEquals (second->numBlocks.load(), 8);
+        expectEquals (first->lastBlockSize.load(), 512);
+
+        beginTest ("skips disabled nodes");
+        secondNode->setEnabled (false);
+        graph.warmUp (4);
+        expectEquals (first->numBlocks.load(), 12);
+        expectEquals (second->numBlocks.load(), 8);
+
+        beginTest ("does nothing for zero blocks");
+        graph.warmUp (0);
+        expectEquals (first->numBlocks.load(), 12);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    class CountingProcessor : public BaseProcessor
+    {
+    public:
+        CountingProcessor()
+            : BaseProcessor (BusesProperties().withInput ("Main", AudioChannelSet::stereo(), true)
+                                              .withOutput ("Main", AudioChannelSet::stereo(), true)) { }
+
+        std::atomic<int> numBlocks { 0 };
+        std::atomic<int> lastBlockSize { 0 };
+
+        const String getName() const override { return "Counter"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            ++numBlocks;
+            lastBlockSize = buffer.getNumSamples();
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+};
+
+static GraphWarmUpTest sGraphWarmUpTest;
+
+}
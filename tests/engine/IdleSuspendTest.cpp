@@ -0,0 +1,140 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class IdleSuspendTest : public UnitTestBase
+{
+public:
+    IdleSuspendTest() : UnitTestBase ("Idle Suspension", "engine", "idleSuspend") { }
+    virtual ~IdleSuspendTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+        GraphNodePtr midiIn = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::midiInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        auto* synth = new Instrument();
+        GraphNodePtr node = graph.addNode (synth);
+        graph.prepareToPlay (44100.0, blockSize);
+        graph.addConnection (midiIn->nodeId, midiIn->getMidiOutputPort(), node->nodeId, node->getMidiInputPort());
+        node->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+
+        beginTest ("never suspends when disabled");
+        GraphNode::setIdleSuspendTime (0.0);
+        renderBlocks (graph, audio, midi, 20);
+        expectEquals (synth->numBlocks, 20);
+
+        beginTest ("suspends after the idle time");
+        GraphNode::setIdleSuspendTime ((double) blockSize * 4.0 / 44100.0);
+        synth->numBlocks = 0;
+        renderBlocks (graph, audio, midi, 20);
+        expect (synth->numBlocks > 0 && synth->numBlocks <= 6, String (synth->numBlocks));
+
+        beginTest ("wakes in the block MIDI arrives");
+        synth->numBlocks = 0;
+        audio.clear();
+        midi.clear();
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        graph.processBlock (audio, midi);
+        expectEquals (synth->numBlocks, 1);
+        expect (audio.getMagnitude (0, 0, blockSize) > 0.f, "the note should be heard straight away");
+
+        beginTest ("stays awake while ringing");
+        synth->numBlocks = 0;
+        renderBlocks (graph, audio, midi, 20);
+        expectEquals (synth->numBlocks, 20);
+
+        GraphNode::setIdleSuspendTime (0.0);
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    /** Plays a constant level from note on until note off */
+    class Instrument : public BaseProcessor
+    {
+    public:
+        Instrument()
+            : BaseProcessor (BusesProperties().withOutput ("Main", AudioChannelSet::stereo(), true)) { }
+
+        int numBlocks = 0;
+        bool playing = false;
+
+        const String getName() const override { return "Test Instrument"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midi) override
+        {
+            ++numBlocks;
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                if (msg.isNoteOn())
+                    playing = true;
+                else if (msg.isNoteOff())
+                    playing = false;
+            }
+
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                FloatVectorOperations::fill (buffer.getWritePointer (c), playing ? 0.25f : 0.f,
+                                             buffer.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+
+    static void renderBlocks (GraphProcessor& graph, AudioSampleBuffer& audio, MidiBuffer& midi, int numBlocks)
+    {
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            audio.clear();
+            midi.clear();
+            graph.processBlock (audio, midi);
+        }
+    }
+};
+
+static IdleSuspendTest sIdleSuspendTest;
+
+}
@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/JobService.h"
+
+namespace Element {
+
+class JobServiceTest : public UnitTestBase
+{
+public:
+    JobServiceTest() : UnitTestBase ("Job Service", "engine", "jobService") { }
+    virtual ~JobServiceTest() { }
+
+    void runTest() override
+    {
+        beginTest ("jobs run off the calling thread and respond where drained");
+        {
+            JobService::Client client;
+            Array<int> order;
+            for (int i = 0; i < 4; ++i)
+                expect (client.schedule (new CountingJob (order, i)));
+            expect (client.waitUntilReady (5000));
+            expectEquals (client.getNumWaiting(), 0);
+            expectEquals (numRunOffThread.get(), 4);
+            expect (order.isEmpty());
+
+            expectEquals (client.deliverResponses(), 4);
+            expectEquals (order.size(), 4);
+            for (int i = 0; i < order.size(); ++i)
+                expectEquals (order[i], i);
+            expectEquals (client.deliverResponses(), 0);
+
+            beginTest ("jobs are deleted on the service's thread once delivered");
+            waitForDeletes (4);
+            expectEquals (numDeleted.get(), 4);
+        }
+
+        beginTest ("clients refuse jobs past their limit");
+        {
+            JobService::Client client;
+            Array<int> order;
+            int numScheduled = 0;
+            for (int i = 0; i < (int) JobService::Client::maxPendingJobs + 8; ++i)
+            {
+                std::unique_ptr<CountingJob> job (new CountingJob (order, i));
+                if (client.schedule (job.get()))
+                {
+                    job.release();
+                    ++numScheduled;
+                }
+            }
+
+            expectEquals (numScheduled, (int) JobService::Client::maxPendingJobs);
+            expect (client.waitUntilReady (5000));
+            expectEquals (client.deliverResponses(), numScheduled);
+        }
+
+        beginTest ("deleting a client drops its responses");
+        numDeleted.set (0);
+        {
+            JobService::Client client;
+            Array<int> order;
+            expect (client.schedule (new CountingJob (order, 0)));
+            expect (client.waitUntilReady (5000));
+        }
+        expectEquals (numDeleted.get(), 1);
+    }
+
+private:
+    static Atomic<int> numRunOffThread, numDeleted;
+
+    struct CountingJob : public JobService::Job
+    {
+        CountingJob (Array<int>& o, int i) : order (o), index (i), caller (Thread::getCurrentThreadId()) { }
+        ~CountingJob() { numDeleted += 1; }
+
+        void run() override
+        {
+            if (Thread::getCurrentThreadId() != caller)
+                numRunOffThread += 1;
+        }
+
+        void respond() override { order.add (index); }
+
+        Array<int>& order;
+        const int index;
+        const Thread::ThreadID caller;
+    };
+
+    void waitForDeletes (int count)
+    {
+        for (int i = 0; i < 500 && numDeleted.get() < count; ++i)
+            Thread::sleep (2);
+    }
+};
+
+Atomic<int> JobServiceTest::numRunOffThread;
+Atomic<int> JobServiceTest::numDeleted;
+
+static JobServiceTest sJobServiceTest;
+
+}
@@ -0,0 +1,184 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+#if JLV2_PLUGINHOST_LV2
+
+#include "engine/LV2URIDMap.h"
+#include "engine/LV2Worker.h"
+
+namespace Element {
+
+class LV2WorkerTest : public UnitTestBase
+{
+public:
+    LV2WorkerTest() : UnitTestBase ("LV2 Worker", "engine", "lv2Worker") { }
+    virtual ~LV2WorkerTest() { }
+
+    void runTest() override
+    {
+        testWorker();
+        testURIDMap();
+    }
+
+private:
+    /** Stands in for a plugin's instance, doubling each request in work() */
+    struct FakePlugin
+    {
+        const LV2_Worker_Schedule* schedule = nullptr;
+        Array<int> responses;
+        int numEndRuns = 0;
+        std::atomic<int> working { 0 };
+        std::atomic<bool> overlapped { false };
+
+        static LV2_Worker_Status work (LV2_Handle handle, LV2_Worker_Respond_Function respond,
+                                       LV2_Worker_Respond_Handle respondHandle, uint32_t size, const void* data)
+        {
+            auto& plugin = *static_cast<FakePlugin*> (handle);
+            if (plugin.working.fetch_add (1) != 0)
+                plugin.overlapped = true;
+
+            int value = 0;
+            if (size == sizeof (int))
+                value = *static_cast<const int*> (data) * 2;
+            Thread::sleep (1);
+            plugin.working.fetch_sub (1);
+            return respond (respondHandle, sizeof (int), &value);
+        }
+
+        static LV2_Worker_Status workResponse (LV2_Handle handle, uint32_t size, const void* body)
+        {
+            if (size == sizeof (int))
+                static_cast<FakePlugin*> (handle)->responses.add (*static_cast<const int*> (body));
+            return LV2_WORKER_SUCCESS;
+        }
+
+        static LV2_Worker_Status endRun (LV2_Handle handle)
+        {
+            ++static_cast<FakePlugin*> (handle)->numEndRuns;
+            return LV2_WORKER_SUCCESS;
+        }
+    };
+
+    void testWorker()
+    {
+        beginTest ("instances share the pool");
+        const LV2_Worker_Interface workerInterface { FakePlugin::work, FakePlugin::workResponse, FakePlugin::endRun };
+        FakePlugin plugins [3];
+        OwnedArray<LV2Worker> workers;
+        for (auto& plugin : plugins)
+        {
+            auto* worker = workers.add (new LV2Worker (&workerInterface, &plugin, 1024));
+            plugin.schedule = static_cast<const LV2_Worker_Schedule*> (worker->getFeature()->data);
+        }
+
+        SharedResourcePointer<LV2WorkerPool> pool;
+        expectEquals (pool->getNumWorkers(), 3);
+        expect (pool->getNumThreads() >= 1 && pool->getNumThreads() <= 4);
+
+        beginTest ("requests are worked one at a time per instance");
+        for (int i = 0; i < 20; ++i)
+            for (auto& plugin : plugins)
+                expectEquals ((int) plugin.schedule->schedule_work (plugin.schedule->handle, sizeof (int), &i),
+                              (int) LV2_WORKER_SUCCESS);
+
+        for (auto* worker : workers)
+            expect (worker->waitUntilIdle (5000));
+
+        for (int i = 0; i < workers.size(); ++i)
+        {
+            workers[i]->deliverResponses();
+            auto& plugin = plugins[i];
+            expect (! plugin.overlapped.load());
+            expectEquals (plugin.numEndRuns, 1);
+            expectEquals (plugin.responses.size(), 20);
+            for (int r = 0; r < plugin.responses.size(); ++r)
+                expectEquals (plugin.responses[r], r * 2);
+        }
+
+        beginTest ("requests too big for the ring are refused");
+        HeapBlock<uint8> big (2048, true);
+        expectEquals ((int) plugins[0].schedule->schedule_work (plugins[0].schedule->handle, 2048, big),
+                      (int) LV2_WORKER_ERR_NO_SPACE);
+        expectEquals (workers[0]->getNumWaiting(), 0);
+
+        workers.clear();
+        expectEquals (pool->getNumWorkers(), 0);
+    }
+
+    void testURIDMap()
+    {
+        beginTest ("urid map");
+        LV2URIDMap map (64);
+        const auto first = map.map (LV2_URID__map);
+        expect (first != 0);
+        expectEquals (map.map (LV2_URID__map), first);
+        expectEquals (String (map.unmap (first)), String (LV2_URID__map));
+        expect (map.unmap (first + 100) == nullptr);
+        expectEquals (map.map (nullptr), (uint32) 0);
+
+        auto* feature = static_cast<const LV2_URID_Map*> (map.getMapFeature()->data);
+        expectEquals ((uint32) feature->map (feature->handle, LV2_URID__map), first);
+
+        beginTest ("urid map from many threads");
+        LV2URIDMap shared (1024);
+        OwnedArray<Thread> threads;
+        Array<uint32> urids [4];
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.add (new MapThread (shared, urids [t]));
+            threads.getLast()->startThread();
+        }
+        for (auto* thread : threads)
+            thread->waitForThreadToExit (-1);
+
+        expectEquals (shared.getNumMapped(), 200);
+        for (int t = 1; t < 4; ++t)
+            expect (urids [t] == urids [0]);
+        for (int i = 0; i < 200; ++i)
+            expectEquals (String (shared.unmap (urids[0][i])), uriFor (i));
+
+        beginTest ("urid map refuses new uris once full");
+        LV2URIDMap small (4);
+        for (int i = 0; i < 4; ++i)
+            expect (small.map (uriFor (i).toRawUTF8()) != 0);
+        expectEquals (small.map (uriFor (4).toRawUTF8()), (uint32) 0);
+        expect (small.map (uriFor (0).toRawUTF8()) != 0);
+    }
+
+    static String uriFor (int index) { return "urn:element:test#" + String (index); }
+
+    struct MapThread : public Thread
+    {
+        MapThread (LV2URIDMap& m, Array<uint32>& u) : Thread ("el.test.urid"), map (m), urids (u) { }
+        void run() override
+        {
+            for (int i = 0; i < 200; ++i)
+                urids.add (map.map (uriFor (i).toRawUTF8()));
+        }
+        LV2URIDMap& map;
+        Array<uint32>& urids;
+    };
+};
+
+static LV2WorkerTest sLV2WorkerTest;
+
+}
+
+#endif
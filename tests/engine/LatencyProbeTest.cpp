@@ -0,0 +1,93 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/LatencyProbe.h"
+
+using namespace Element;
+
+//=============================================================================
+class LatencyProbeTest : public UnitTestBase
+{
+public:
+    LatencyProbeTest ()
+        : UnitTestBase ("Latency Probe", "Engine", "latencyProbe") { }
+
+    void runTest() override
+    {
+        beginTest ("loopback");
+        {
+            LatencyProbe::Options options;
+            options.numPings = 3;
+            LatencyProbe probe (options);
+            probe.prepare (48000.0);
+            expectEquals (loopback (probe, 700, 256), 3);
+            expectEquals (probe.getRoundTripSamples(), 700);
+        }
+
+        beginTest ("nothing comes back");
+        {
+            LatencyProbe::Options options;
+            options.numPings = 2;
+            options.timeoutSeconds = 0.05;
+            LatencyProbe probe (options);
+            probe.prepare (48000.0);
+            const int heard = loopback (probe, -1, 256);
+            expect (probe.isFinished());
+            expectEquals (heard, 0);
+            expectEquals (probe.getRoundTripSamples(), -1);
+        }
+
+        beginTest ("midi");
+        {
+            MidiLatencyProbe probe (1);
+            auto ping = probe.createPing (Time::getMillisecondCounterHiRes() - 5.0);
+            probe.handleIncomingMidiMessage (nullptr, MidiMessage::noteOn (1, ping.getNoteNumber() + 1, (uint8) 100));
+            expect (! probe.isFinished());
+            probe.handleIncomingMidiMessage (nullptr, ping);
+            expect (probe.isFinished());
+            expectEquals (probe.getNumPingsHeard(), 1);
+            expectWithinAbsoluteError (probe.getRoundTripMs(), 5.0, 2.0);
+        }
+    }
+
+private:
+    /** Runs the probe with its output fed back to its input a number of samples
+        later, or never when the delay is negative. Returns the impulses heard */
+    static int loopback (LatencyProbe& probe, int delay, int blockSize)
+    {
+        Array<float> sent;
+        HeapBlock<float> input (blockSize), output (blockSize);
+        for (int block = 0; block < 4000 && ! probe.isFinished(); ++block)
+        {
+            const int start = block * blockSize;
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const int from = start + i - delay;
+                input[i] = delay >= 0 && isPositiveAndBelow (from, sent.size()) ? sent [from] : 0.f;
+            }
+
+            probe.process (input, output, blockSize);
+            sent.addArray (output.get(), blockSize);
+        }
+
+        return probe.getNumPingsHeard();
+    }
+};
+
+static LatencyProbeTest sLatencyProbeTest;
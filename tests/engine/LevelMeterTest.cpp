@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/LevelMeter.h"
+
+namespace Element {
+
+class LevelMeterTest : public UnitTestBase
+{
+public:
+    LevelMeterTest() : UnitTestBase ("Level Meter", "engine", "levelMeter") { }
+    virtual ~LevelMeterTest() { }
+
+    void runTest() override
+    {
+        testMeasure();
+        testGainRamp();
+        testWindow();
+    }
+
+private:
+    static constexpr int numSamples = 203;
+
+    void fill (AudioSampleBuffer& audio)
+    {
+        Random rand (4321);
+        for (int i = 0; i < audio.getNumSamples(); ++i)
+            audio.setSample (0, i, rand.nextFloat() * 2.f - 1.f);
+    }
+
+    void testMeasure()
+    {
+        beginTest ("measure matches scalar reference");
+        AudioSampleBuffer audio (1, numSamples + 3);
+        fill (audio);
+
+        // odd offsets exercise the unaligned head and tail
+        for (int offset = 0; offset < 3; ++offset)
+        {
+            const float* samples = audio.getReadPointer (0, offset);
+            float peak = 0.f, sum = 0.f;
+            LevelMeter::measureSamples (samples, numSamples, peak, sum);
+
+            float expectedPeak = 0.f, expectedSum = 0.f;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                expectedPeak = jmax (expectedPeak, std::abs (samples[i]));
+                expectedSum += samples[i] * samples[i];
+            }
+
+            expectEquals (peak, expectedPeak);
+            expectWithinAbsoluteError (sum, expectedSum, 0.001f);
+        }
+    }
+
+    void testGainRamp()
+    {
+        beginTest ("gain ramp matches AudioBuffer");
+        AudioSampleBuffer fused (1, numSamples + 1), reference (1, numSamples + 1);
+        fill (fused);
+        reference.makeCopyOf (fused);
+
+        float peak = 0.f, sum = 0.f;
+        LevelMeter::applyGainRampAndMeasure (fused.getWritePointer (0, 1), numSamples, 0.25f, 1.5f, peak, sum);
+        reference.applyGainRamp (0, 1, numSamples, 0.25f, 1.5f);
+
+        float maxError = 0.f;
+        for (int i = 0; i <= numSamples; ++i)
+            maxError = jmax (maxError, std::abs (fused.getSample (0, i) - reference.getSample (0, i)));
+        expectLessThan (maxError, 0.0001f);
+
+        const float expectedRMS = reference.getRMSLevel (0, 1, numSamples);
+        expectWithinAbsoluteError (std::sqrt (sum / (float) numSamples), expectedRMS, 0.0001f);
+        expectWithinAbsoluteError (peak, reference.getMagnitude (0, 1, numSamples), 0.0001f);
+    }
+
+    void testWindow()
+    {
+        beginTest ("readings are decimated");
+        AudioSampleBuffer audio (2, 64);
+        audio.clear();
+        for (int i = 0; i < 64; ++i)
+            audio.setSample (1, i, 0.5f);
+
+        LevelMeter meter;
+        meter.prepare (2);
+
+        bool due = false;
+        for (int block = 0; block < 3; ++block)
+        {
+            meter.measure (0, audio.getReadPointer (0), 64);
+            meter.measure (1, audio.getReadPointer (1), 64);
+            due = meter.advance (64, 64, 256);
+            expect (! due, "reading should not be due before the window elapses");
+        }
+
+        meter.measure (0, audio.getReadPointer (0), 64);
+        meter.measure (1, audio.getReadPointer (1), 64);
+        due = meter.advance (64, 64, 256);
+        expect (due, "reading should be due once the window elapses");
+        expectEquals (meter.getRMS (0), 0.f);
+        expectWithinAbsoluteError (meter.getRMS (1), 0.5f, 0.0001f);
+        expectEquals (meter.getPeak (1), 0.5f);
+
+        meter.reset();
+        expectEquals (meter.getPeak (1), 0.f);
+        expectEquals (meter.getRMS (1), 0.f);
+    }
+};
+
+static LevelMeterTest sLevelMeterTest;
+
+}
@@ -0,0 +1,90 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/HeapMeter.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class MemoryAccountingTest : public UnitTestBase
+{
+public:
+    MemoryAccountingTest() : UnitTestBase ("Memory Accounting", "engine", "memory") { }
+    virtual ~MemoryAccountingTest() { }
+
+    void runTest() override
+    {
+        testHeapMeter();
+        testNodeMemory();
+    }
+
+private:
+    void testHeapMeter()
+    {
+        beginTest ("heap growth");
+        if (HeapMeter::getAllocatedBytes() < 0)
+        {
+            logMessage ("the heap can't be read on this platform");
+            return;
+        }
+
+        HeapMeter::Scope heap;
+        HeapBlock<char> block ((size_t) 4 * 1024 * 1024, true);
+        expectGreaterOrEqual (heap.getGrowth(), (int64) 4 * 1024 * 1024);
+    }
+
+    void testNodeMemory()
+    {
+        beginTest ("nodes account for their buffers");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, 512);
+
+        auto memory = volume->getMemoryUsage();
+        expectGreaterThan (memory.renderBytes, (int64) 0);
+        expectGreaterThan (memory.midiBytes, (int64) 0);
+        // every factor's filters are kept ready
+        expectGreaterOrEqual (memory.oversamplingBytes, (int64) (22 * 2 * 512 * sizeof (float)));
+        expectEquals (memory.contentBytes, (int64) 0);
+        expectEquals (memory.getTotal(), memory.renderBytes + memory.midiBytes + memory.oversamplingBytes);
+
+        volume->setPluginMemoryBytes (1000);
+        expectEquals (volume->getMemoryUsage().pluginBytes, (int64) 1000);
+
+        beginTest ("render memory follows the block size");
+        graph.releaseResources();
+        graph.prepareToPlay (44100.0, 2048);
+        expectGreaterThan (volume->getMemoryUsage().oversamplingBytes, memory.oversamplingBytes);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static MemoryAccountingTest sMemoryAccountingTest;
+
+}
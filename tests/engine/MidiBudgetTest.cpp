@@ -0,0 +1,137 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiBudget.h"
+
+namespace Element {
+
+class MidiBudgetTest : public UnitTestBase
+{
+public:
+    MidiBudgetTest() : UnitTestBase ("MIDI Budget", "engine", "midiBudget") { }
+    virtual ~MidiBudgetTest() { }
+
+    void runTest() override
+    {
+        const int previous = MidiBudget::getMaxEventsPerBlock();
+        MidiBudget::setMaxEventsPerBlock (64);
+        MidiBudget::resetNumDropped();
+
+        testEventLimit();
+        testByteLimit();
+        testCopy();
+        testMerge();
+
+        MidiBudget::setMaxEventsPerBlock (previous);
+        MidiBudget::resetNumDropped();
+    }
+
+private:
+    void testEventLimit()
+    {
+        beginTest ("events over the budget are dropped and counted");
+        MidiBuffer midi;
+        MidiBudget::reserve (midi);
+        MidiBudget::Writer writer (midi);
+        for (int i = 0; i < 100; ++i)
+            writer.add (MidiMessage::controllerEvent (1, 1, i % 128), i);
+
+        expectEquals (midi.getNumEvents(), 64);
+        expectEquals (MidiBudget::getNumDropped(), (int64) 36);
+        MidiBudget::resetNumDropped();
+    }
+
+    void testByteLimit()
+    {
+        beginTest ("large sysex counts against the byte budget");
+        HeapBlock<uint8> data (2000, true);
+        MidiBuffer midi;
+        MidiBudget::reserve (midi);
+        expect (! MidiBudget::Writer (midi).add (MidiMessage::createSysExMessage (data, 2000), 0));
+        expect (midi.isEmpty());
+        expectEquals (MidiBudget::getNumDropped(), (int64) 1);
+
+        expect (MidiBudget::Writer (midi).add (MidiMessage::createSysExMessage (data, 500), 0));
+        expectEquals (midi.getNumEvents(), 1);
+        MidiBudget::resetNumDropped();
+    }
+
+    void testCopy()
+    {
+        beginTest ("copying counts what the destination holds");
+        MidiBuffer source, dest;
+        for (int i = 0; i < 40; ++i)
+            source.addEvent (MidiMessage::noteOn (1, 60, 1.f), i);
+
+        MidiBudget::copyEvents (dest, source);
+        expectEquals (dest.getNumEvents(), 40);
+        MidiBudget::addEvents (dest, source, 20);
+        expectEquals (dest.getNumEvents(), 60);
+        MidiBudget::addEvents (dest, source, 40);
+        expectEquals (dest.getNumEvents(), 64);
+        expectEquals (MidiBudget::getNumDropped(), (int64) 36);
+        MidiBudget::resetNumDropped();
+    }
+
+    void testMerge()
+    {
+        beginTest ("merging keeps time order and source order");
+        MidiBuffer a, b, c, dest;
+        MidiBudget::reserve (dest);
+        a.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        a.addEvent (MidiMessage::noteOn (1, 61, 1.f), 10);
+        b.addEvent (MidiMessage::noteOn (2, 62, 1.f), 5);
+        b.addEvent (MidiMessage::noteOn (2, 63, 1.f), 10);
+        c.addEvent (MidiMessage::noteOn (3, 64, 1.f), 10);
+        c.addEvent (MidiMessage::noteOn (3, 65, 1.f), 30);
+        dest.addEvent (MidiMessage::noteOff (1, 1), 0);
+
+        const MidiBuffer* sources[] = { &a, &b, &c };
+        MidiBudget::Merger merger (3);
+        merger.merge (dest, sources, 3, 20);
+
+        MidiBuffer::Iterator iter (dest);
+        MidiMessage msg; int frame = 0;
+        Array<int> notes, frames;
+        while (iter.getNextEvent (msg, frame))
+        {
+            notes.add (msg.getNoteNumber());
+            frames.add (frame);
+        }
+
+        expect (notes == Array<int> ({ 60, 62, 61, 63, 64 }));
+        expect (frames == Array<int> ({ 0, 5, 10, 10, 10 }));
+
+        beginTest ("merging stays within budget");
+        MidiBuffer many;
+        for (int i = 0; i < 40; ++i)
+            many.addEvent (MidiMessage::controllerEvent (1, 1, i), i);
+        const MidiBuffer* twice[] = { &many, &many };
+        MidiBudget::Merger pair (2);
+        pair.merge (dest, twice, 2, -1);
+        expectEquals (dest.getNumEvents(), 64);
+        expectEquals (MidiBudget::getNumDropped(), (int64) 16);
+        MidiBudget::resetNumDropped();
+    }
+};
+
+static MidiBudgetTest sMidiBudgetTest;
+
+}
@@ -42,9 +42,53 @@ public:
         testReset();
         testOutputCorrect();
         testProcess();
+        testRender();
     }
 
 private:
+    void testRender()
+    {
+        beginTest ("render()");
+        MidiChannelMap chmap;
+        MidiBuffer midi;
+        const uint8 sysex[] = { 0x7e, 0x7f, 0x06, 0x01 };
+        midi.addEvent (MidiMessage::noteOn (5, 60, 1.f), 0);
+        midi.addEvent (MidiMessage::createSysExMessage (sysex, 4), 1);
+        midi.addEvent (MidiMessage::controllerEvent (2, 7, 100), 2);
+        midi.addEvent (MidiMessage::pitchWheel (5, 9000), 3);
+
+        chmap.render (midi);
+        expect (chmap.isIdentity());
+        expectEquals (channels (midi), String ("5 0 2 5"));
+
+        chmap.set (5, 9);
+        chmap.set (2, 16);
+        expect (! chmap.isIdentity());
+        chmap.render (midi);
+        expectEquals (channels (midi), String ("9 0 16 9"));
+
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        iter.getNextEvent (msg, frame);
+        expect (msg.isNoteOn() && msg.getNoteNumber() == 60);
+        iter.getNextEvent (msg, frame);
+        expect (msg.isSysEx() && msg.getSysExDataSize() == 4);
+        iter.getNextEvent (msg, frame);
+        expect (msg.isController() && msg.getControllerValue() == 100);
+        iter.getNextEvent (msg, frame);
+        expect (msg.isPitchWheel() && msg.getPitchWheelValue() == 9000);
+    }
+
+    static String channels (const MidiBuffer& midi)
+    {
+        StringArray result;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            result.add (String (msg.getChannel()));
+        return result.joinIntoString (" ");
+    }
+
     void testProcess()
     {
         beginTest ("process()");
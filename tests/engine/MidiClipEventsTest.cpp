@@ -0,0 +1,113 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiClipEvents.h"
+
+namespace Element {
+
+class MidiClipEventsTest : public UnitTestBase
+{
+public:
+    MidiClipEventsTest() : UnitTestBase ("MIDI Clip Events", "engine", "midiClipEvents") { }
+    virtual ~MidiClipEventsTest() { }
+
+    void runTest() override
+    {
+        testSeek();
+        testRender();
+        testEdits();
+    }
+
+private:
+    void testSeek()
+    {
+        beginTest ("seek finds the first event at or after a beat");
+        MidiClipEvents::Event events[4];
+        const double beats[] = { 0.0, 1.0, 1.0, 3.0 };
+        for (int i = 0; i < 4; ++i)
+            events[i].beat = beats[i];
+
+        expectEquals (MidiClipEvents::seek (events, 4, -1.0), 0);
+        expectEquals (MidiClipEvents::seek (events, 4, 1.0), 1);
+        expectEquals (MidiClipEvents::seek (events, 4, 2.0), 3);
+        expectEquals (MidiClipEvents::seek (events, 4, 4.0), 4);
+    }
+
+    void testRender()
+    {
+        beginTest ("blocks get the events in their beats");
+        NoteSequence notes;
+        notes.addNote (60, 1.0, 1.0);
+        notes.addNote (64, 2.0, 0.5);
+        MidiClipEvents events (notes);
+        expectEquals (events.getNumEvents(), 4);
+
+        MidiBuffer midi;
+        MidiBudget::Writer writer (midi);
+        expectEquals (events.render (writer, { 0.0, 2.0 }, 100.0), 1);
+        expectEquals (midi.getFirstEventTime(), 100);
+
+        beginTest ("offs come ahead of ons on the same beat");
+        midi.clear();
+        writer.reset (midi);
+        expectEquals (events.render (writer, { 2.0, 3.0 }, 100.0), 3);
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage message; int frame = 0;
+        iter.getNextEvent (message, frame);
+        expect (message.isNoteOff() && message.getNoteNumber() == 60);
+        iter.getNextEvent (message, frame);
+        expect (message.isNoteOn() && message.getNoteNumber() == 64);
+    }
+
+    void testEdits()
+    {
+        NoteSequence notes;
+        auto note = notes.addNote (60, 0.0, 1.0);
+        MidiClipEvents events (notes);
+
+        beginTest ("edits publish once updated");
+        notes.addNote (62, 4.0, 1.0);
+        expectEquals (events.getNumEvents(), 2);
+        events.update();
+        expectEquals (events.getNumEvents(), 4);
+
+        beginTest ("moved notes are resorted");
+        Note::EditDeltas deltas;
+        note.move (deltas, 8.0);
+        note.applyEdits (deltas);
+        events.update();
+        MidiBuffer midi;
+        MidiBudget::Writer writer (midi);
+        expectEquals (events.render (writer, { 0.0, 8.0 }, 10.0), 2);
+
+        beginTest ("removed notes are dropped");
+        notes.removeNote (note);
+        events.update();
+        expectEquals (events.getNumEvents(), 2);
+
+        beginTest ("unrelated properties are ignored");
+        notes.node().getChild (0).setProperty ("eventId", 5, nullptr);
+        events.update();
+        expectEquals (events.getNumEvents(), 2);
+    }
+};
+
+static MidiClipEventsTest sMidiClipEventsTest;
+
+}
@@ -0,0 +1,92 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiClock.h"
+
+namespace Element {
+
+class MidiClockTest : public UnitTestBase,
+                      private MidiClock::Listener
+{
+public:
+    MidiClockTest() : UnitTestBase ("MIDI Clock", "engine", "midiClock") { }
+    virtual ~MidiClockTest() { }
+
+    void runTest() override
+    {
+        MidiClock clock;
+        clock.addListener (this);
+        clock.reset (44100.0, 512);
+
+        beginTest ("locks onto a jittery clock");
+        Random random (1234);
+        const double period = 60.0 / (128.0 * 24.0);
+        double time = 100.0;
+        clock.process (MidiMessage::midiStart());
+
+        for (int i = 0; i < 24 * 16; ++i)
+        {
+            const double jitter = (random.nextDouble() - 0.5) * 0.004;
+            auto msg = MidiMessage::midiClock();
+            msg.setTimeStamp (time + jitter);
+            clock.process (msg);
+            if (i == 24 * 3)
+            {
+                expect (clock.isLocked(), "should lock within a few beats");
+                expectWithinAbsoluteError (clock.getTempo(), 128.0, 2.0);
+            }
+            time += period;
+        }
+
+        expectEquals (numAcquired, 1);
+        expectWithinAbsoluteError (clock.getTempo(), 128.0, 0.25);
+        expect (numTempoChanges < 24, "tempo changes shouldn't be reported every tick");
+
+        beginTest ("beat position between ticks");
+        const double beats = clock.getBeatPosition (time - period * 0.5);
+        expectWithinAbsoluteError (beats, 16.0 - 0.5 / 24.0, 0.1 / 24.0 + 0.004 / period / 24.0);
+
+        beginTest ("song position");
+        clock.process (MidiMessage::songPositionPointer (16));
+        auto msg = MidiMessage::midiClock();
+        msg.setTimeStamp (time);
+        clock.process (msg);
+        expectWithinAbsoluteError (clock.getBeatPosition (time), 4.0, 0.01);
+
+        beginTest ("dropouts");
+        msg.setTimeStamp (time + 2.0);
+        clock.process (msg);
+        expectEquals (numDropped, 1);
+        expect (! clock.isLocked());
+
+        clock.removeListener (this);
+    }
+
+private:
+    int numAcquired = 0, numDropped = 0, numTempoChanges = 0;
+
+    void midiClockSignalAcquired() override         { ++numAcquired; }
+    void midiClockSignalDropped() override          { ++numDropped; }
+    void midiClockTempoChanged (const float) override { ++numTempoChanges; }
+};
+
+static MidiClockTest sMidiClockTest;
+
+}
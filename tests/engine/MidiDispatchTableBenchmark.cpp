@@ -0,0 +1,156 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiDispatchTable.h"
+
+namespace Element {
+
+/** Compares the dispatch table against asking every mapping whether it
+    wants a message, the way controller inputs used to. */
+class MidiDispatchTableBenchmark : public UnitTestBase
+{
+public:
+    MidiDispatchTableBenchmark() : UnitTestBase ("MIDI Dispatch Table Benchmark", "engine", "midiDispatchTable") { }
+    virtual ~MidiDispatchTableBenchmark() { }
+
+    void runTest() override
+    {
+        testBuckets();
+
+        for (const int numMappings : { 1000, 10000 })
+        {
+            beginTest (String (numMappings) + " mappings");
+            benchmark (numMappings);
+        }
+    }
+
+private:
+    static constexpr int numMessages = 20000;
+
+    struct Mapping
+    {
+        using Table = MidiDispatchTable<Mapping>;
+        Table::Key key;
+        int hits = 0;
+
+        Table::Key getDispatchKey() const { return key; }
+
+        bool wants (const MidiMessage& message) const
+        {
+            if (key.channel != 0 && key.channel != message.getChannel())
+                return false;
+            if (key.type == Table::controller)
+                return message.isController() && message.getControllerNumber() == key.number;
+            if (key.type == Table::note)
+                return message.isNoteOnOrOff() && message.getNoteNumber() == key.number;
+            return false;
+        }
+    };
+
+    void testBuckets()
+    {
+        beginTest ("buckets");
+        OwnedArray<Mapping> mappings;
+        auto add = [&mappings] (int type, int channel, int number)
+        {
+            auto* mapping = mappings.add (new Mapping());
+            mapping->key = { type, channel, number };
+        };
+
+        add (Mapping::Table::controller, 1, 7);
+        add (Mapping::Table::controller, 0, 7);
+        add (Mapping::Table::controller, 2, 7);
+        add (Mapping::Table::note, 1, 7);
+        add (-1, 0, 0);
+
+        Mapping::Table table;
+        table.build (mappings);
+        expectEquals (table.size(), 4, "handlers without a key aren't indexed");
+
+        Array<Mapping*> visited;
+        table.dispatch (MidiMessage::controllerEvent (1, 7, 100),
+                        [&visited] (Mapping& m) { visited.add (&m); });
+        expectEquals (visited.size(), 2);
+        expect (visited[0] == mappings[0], "the message's channel comes first");
+        expect (visited[1] == mappings[1], "then the omni mappings");
+
+        visited.clearQuick();
+        table.dispatch (MidiMessage::noteOff (1, 7), [&visited] (Mapping& m) { visited.add (&m); });
+        expect (visited.size() == 1 && visited[0] == mappings[3]);
+
+        visited.clearQuick();
+        table.dispatch (MidiMessage::pitchWheel (1, 0), [&visited] (Mapping& m) { visited.add (&m); });
+        expect (visited.isEmpty());
+    }
+
+    void benchmark (const int numMappings)
+    {
+        Random rand (42);
+        OwnedArray<Mapping> linear, indexed;
+        for (int i = 0; i < numMappings; ++i)
+        {
+            Mapping::Table::Key key;
+            key.type    = rand.nextInt (2);
+            key.channel = rand.nextInt (17);
+            key.number  = rand.nextInt (128);
+            linear.add (new Mapping())->key = key;
+            indexed.add (new Mapping())->key = key;
+        }
+
+        Array<MidiMessage> messages;
+        messages.ensureStorageAllocated (numMessages);
+        for (int i = 0; i < numMessages; ++i)
+            messages.add (rand.nextBool()
+                ? MidiMessage::controllerEvent (1 + rand.nextInt (16), rand.nextInt (128), 64)
+                : MidiMessage::noteOn (1 + rand.nextInt (16), rand.nextInt (128), (uint8) 100));
+
+        Mapping::Table table;
+        table.build (indexed);
+
+        const auto linearStart = Time::getMillisecondCounterHiRes();
+        for (const auto& message : messages)
+            for (auto* mapping : linear)
+                if (mapping->wants (message))
+                    ++mapping->hits;
+        const auto linearTime = Time::getMillisecondCounterHiRes() - linearStart;
+
+        const auto tableStart = Time::getMillisecondCounterHiRes();
+        for (const auto& message : messages)
+            table.dispatch (message, [&message] (Mapping& mapping)
+            {
+                if (mapping.wants (message))
+                    ++mapping.hits;
+            });
+        const auto tableTime = Time::getMillisecondCounterHiRes() - tableStart;
+
+        logMessage (String (numMessages) + " messages: linear " + String (linearTime, 3)
+            + " ms, dispatch table " + String (tableTime, 3) + " ms");
+
+        // both found the same mappings for every message
+        bool same = true;
+        for (int i = 0; i < numMappings; ++i)
+            same = same && linear[i]->hits == indexed[i]->hits;
+        expect (same, "the table should reach the same mappings as a linear scan");
+    }
+};
+
+static MidiDispatchTableBenchmark sMidiDispatchTableBenchmark;
+
+}
@@ -0,0 +1,170 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/MidiFilePlayerNode.h"
+
+namespace Element {
+
+class MidiFilePlayerTest : public UnitTestBase
+{
+public:
+    MidiFilePlayerTest() : UnitTestBase ("MIDI File Player", "engine", "midiFilePlayer") { }
+    virtual ~MidiFilePlayerTest() { }
+
+    void runTest() override
+    {
+        testCompile();
+        testPlayback();
+    }
+
+private:
+    struct TestPlayHead : public AudioPlayHead
+    {
+        TestPlayHead() { info.resetToDefault(); }
+
+        bool getCurrentPosition (CurrentPositionInfo& result) override
+        {
+            result = info;
+            return true;
+        }
+
+        CurrentPositionInfo info;
+    };
+
+    /** Two beats at 120 then 60 bpm, with notes on beats 0 to 1 and 3 to 4
+        in another track */
+    static MidiFile makeFile()
+    {
+        MidiFile file;
+        file.setTicksPerQuarterNote (480);
+
+        MidiMessageSequence tempo;
+        tempo.addEvent (MidiMessage::tempoMetaEvent (500000), 0.0);
+        tempo.addEvent (MidiMessage::tempoMetaEvent (1000000), 960.0);
+        file.addTrack (tempo);
+
+        MidiMessageSequence notes;
+        notes.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0.0);
+        notes.addEvent (MidiMessage::noteOff (1, 60), 480.0);
+        notes.addEvent (MidiMessage::controllerEvent (2, 1, 64), 480.0);
+        notes.addEvent (MidiMessage::noteOn (1, 62, (uint8) 100), 1440.0);
+        notes.addEvent (MidiMessage::noteOff (1, 62), 1920.0);
+        file.addTrack (notes);
+        return file;
+    }
+
+    static Array<MidiMessage> render (MidiFilePlayerNode& node, TestPlayHead& head, int64 frame)
+    {
+        head.info.timeInSamples = frame;
+        AudioBuffer<float> audio (1, 512);
+        MidiBuffer midi;
+        node.processBlock (audio, midi);
+
+        Array<MidiMessage> messages;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int position = 0;
+        while (iter.getNextEvent (msg, position))
+        {
+            msg.setTimeStamp (position);
+            messages.add (msg);
+        }
+        return messages;
+    }
+
+    void testCompile()
+    {
+        beginTest ("tracks merge and events resolve to samples");
+        MidiFileEvents events (makeFile(), 48000.0);
+        expectEquals (events.getNumTracks(), 2);
+        expectEquals (events.size(), 5);
+        expectEquals (events.getLengthInBeats(), 4.0);
+        expectEquals (events.getLengthInFrames(), 144000.0);
+
+        expect (events[1].data[0] == 0x80, "note offs come first on a beat");
+        expectEquals (events[1].frame, 24000.0);
+        expectEquals (events[3].beat, 3.0);
+        expectEquals (events[3].frame, 96000.0, "the second beat at 60 bpm");
+
+        beginTest ("seeking");
+        expectEquals (events.seekFrame (0.0), 0);
+        expectEquals (events.seekFrame (24000.0), 1);
+        expectEquals (events.seekFrame (24001.0), 3);
+        expectEquals (events.seekBeat (3.5), 4);
+        expectEquals (events.seekBeat (5.0), events.size());
+
+        beginTest ("re-timing");
+        MidiFileEvents faster (events, 96000.0);
+        expectEquals (faster.size(), events.size());
+        expectEquals (faster[3].frame, 192000.0);
+    }
+
+    void testPlayback()
+    {
+        TemporaryFile file (".mid");
+        {
+            FileOutputStream out (file.getFile());
+            expect (makeFile().writeTo (out));
+        }
+
+        MidiFilePlayerNode node;
+        node.loadFile (file.getFile());
+        expect (node.getLoadError().isEmpty());
+        expectEquals (node.getNumEvents(), 5);
+
+        TestPlayHead head;
+        head.info.isPlaying = true;
+        node.setPlayHead (&head);
+        node.prepareToPlay (48000.0, 512);
+
+        beginTest ("events play at the sample they're due");
+        auto messages = render (node, head, 23800);
+        expectEquals (messages.size(), 2);
+        expect (messages[0].isNoteOff() && messages[0].getTimeStamp() == 200.0);
+        expect (messages[1].isController());
+
+        beginTest ("jumps seek");
+        messages = render (node, head, 0);
+        expectEquals (messages.size(), 1);
+        expect (messages[0].isNoteOn() && messages[0].getTimeStamp() == 0.0);
+        expectEquals (render (node, head, 512).size(), 0);
+
+        beginTest ("stopping releases notes");
+        head.info.isPlaying = false;
+        messages = render (node, head, 1024);
+        expectEquals (messages.size(), 1);
+        expect (messages[0].isNoteOff() && messages[0].getNoteNumber() == 60);
+
+        beginTest ("session tempo");
+        node.setFollowsFileTempo (false);
+        head.info.isPlaying = true;
+        head.info.bpm = 120.0;
+        head.info.ppqPosition = 3.0 - 1.0 / 128.0;
+        messages = render (node, head, 0);
+        expectEquals (messages.size(), 1);
+        expect (messages[0].isNoteOn() && messages[0].getTimeStamp() == 187.0);
+
+        node.releaseResources();
+        node.setPlayHead (nullptr);
+    }
+};
+
+static MidiFilePlayerTest sMidiFilePlayerTest;
+
+}
@@ -0,0 +1,77 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class MidiFilterSettingsTest : public UnitTestBase
+{
+public:
+    MidiFilterSettingsTest() : UnitTestBase ("MIDI Filter Settings", "engine", "midiFilterSettings") { }
+    virtual ~MidiFilterSettingsTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        GraphNodePtr node = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        if (node == nullptr)
+        {
+            expect (false, "could not create node");
+            return;
+        }
+
+        beginTest ("defaults");
+        {
+            const auto& settings = node->getMidiFilterSettings();
+            expectEquals (settings.transposeOffset, 0);
+            expect (settings.keyRange == Range<int> (0, 127));
+            expect (! settings.programsEnabled);
+        }
+
+        beginTest ("publishes changes");
+        node->setTransposeOffset (7);
+        node->setKeyRange (10, 100);
+        node->setMidiProgramsEnabled (true);
+        {
+            const auto& settings = node->getMidiFilterSettings();
+            expectEquals (settings.transposeOffset, 7);
+            expect (settings.keyRange == Range<int> (10, 100));
+            expect (settings.programsEnabled);
+        }
+
+        beginTest ("reading twice is stable");
+        {
+            const auto& first = node->getMidiFilterSettings();
+            const auto& second = node->getMidiFilterSettings();
+            expect (&first == &second);
+        }
+
+        beginTest ("latest of several writes wins");
+        for (int i = -12; i <= 12; ++i)
+            node->setTransposeOffset (i);
+        expectEquals (node->getMidiFilterSettings().transposeOffset, 12);
+
+        graph.clear();
+    }
+};
+
+static MidiFilterSettingsTest sMidiFilterSettingsTest;
+
+}
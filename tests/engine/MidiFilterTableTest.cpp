@@ -0,0 +1,145 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiFilterTable.h"
+
+namespace Element {
+
+class MidiFilterTableTest : public UnitTestBase
+{
+public:
+    MidiFilterTableTest() : UnitTestBase ("MIDI Filter Table", "engine", "midiFilterTable") { }
+    virtual ~MidiFilterTableTest() { }
+
+    void runTest() override
+    {
+        testPassThrough();
+        testKeyRangeAndTranspose();
+        testChannelsAndPrograms();
+        testVelocityInPlace();
+        testSingleMessages();
+    }
+
+private:
+    static Array<MidiMessage> collect (const MidiBuffer& midi)
+    {
+        Array<MidiMessage> messages;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            messages.add (msg);
+        return messages;
+    }
+
+    void testPassThrough()
+    {
+        beginTest ("defaults pass everything");
+        MidiFilterTable table;
+        expect (! table.isActive());
+        table.compile ({ 0, 127 }, kv::MidiChannels(), 0, false);
+        expect (! table.isActive(), "a full key range doesn't filter");
+    }
+
+    void testKeyRangeAndTranspose()
+    {
+        beginTest ("key range applies before transposing");
+        MidiFilterTable table;
+        table.compile ({ 60, 72 }, kv::MidiChannels(), 12, false);
+        expect (table.isActive() && table.canDropEvents());
+
+        MidiBuffer midi, scratch;
+        midi.addEvent (MidiMessage::noteOn (1, 59, (uint8) 100), 0);
+        midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 1);
+        midi.addEvent (MidiMessage::noteOff (1, 72), 2);
+        midi.addEvent (MidiMessage::controllerEvent (1, 1, 64), 3);
+        expectEquals (table.process (midi, scratch), -1);
+
+        const auto messages = collect (midi);
+        expectEquals (messages.size(), 3);
+        expectEquals (messages[0].getNoteNumber(), 72);
+        expectEquals (messages[1].getNoteNumber(), 84);
+        expect (messages[2].isController());
+    }
+
+    void testChannelsAndPrograms()
+    {
+        beginTest ("channel mask and program changes");
+        kv::MidiChannels channels;
+        channels.setChannel (2);
+        MidiFilterTable table;
+        table.compile ({}, channels, 0, true);
+
+        MidiBuffer midi, scratch;
+        midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0);
+        midi.addEvent (MidiMessage::noteOn (2, 61, (uint8) 100), 1);
+        midi.addEvent (MidiMessage::programChange (2, 7), 2);
+        midi.addEvent (MidiMessage::programChange (1, 9), 3);
+        expectEquals (table.process (midi, scratch), 7);
+
+        const auto messages = collect (midi);
+        expectEquals (messages.size(), 1);
+        expectEquals (messages[0].getChannel(), 2);
+    }
+
+    void testVelocityInPlace()
+    {
+        beginTest ("velocity curves rewrite in place");
+        VelocityCurve curve;
+        curve.setMode (VelocityCurve::Max);
+        MidiFilterTable table;
+        table.compile ({}, kv::MidiChannels(), 0, false, &curve);
+        expect (table.isActive() && ! table.canDropEvents());
+
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 10), 0);
+        midi.addEvent (MidiMessage::noteOn (1, 61, (uint8) 0), 1);
+        table.rewrite (midi);
+
+        const auto messages = collect (midi);
+        expectEquals ((int) messages[0].getVelocity(), 127);
+        expectEquals ((int) messages[1].getVelocity(), 0, "note offs keep their velocity");
+    }
+
+    void testSingleMessages()
+    {
+        beginTest ("single messages filter in place");
+        kv::MidiChannels channels;
+        channels.setChannel (1);
+        MidiFilterTable table;
+        table.compile ({ 60, 72 }, channels, -12, true);
+
+        uint8 note[3] = { 0x90, 64, 100 };
+        expect (table.filterMessage (note, 3));
+        expectEquals ((int) note[1], 52);
+
+        uint8 outOfRange[3] = { 0x90, 59, 100 };
+        expect (! table.filterMessage (outOfRange, 3));
+        uint8 otherChannel[3] = { 0x91, 64, 100 };
+        expect (! table.filterMessage (otherChannel, 3));
+        uint8 program[2] = { 0xc0, 3 };
+        expect (! table.filterMessage (program, 2), "consumed programs are dropped");
+        uint8 clock[1] = { 0xf8 };
+        expect (table.filterMessage (clock, 1), "system messages pass");
+    }
+};
+
+static MidiFilterTableTest sMidiFilterTableTest;
+
+}
@@ -0,0 +1,162 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiInjectionQueue.h"
+
+namespace Element {
+
+class MidiInjectionQueueTest : public UnitTestBase
+{
+public:
+    MidiInjectionQueueTest() : UnitTestBase ("MIDI Injection Queue", "engine", "midiInjectionQueue") { }
+    virtual ~MidiInjectionQueueTest() { }
+
+    void runTest() override
+    {
+        testScheduling();
+        testLimits();
+        testProducers();
+    }
+
+private:
+    static Array<int> frames (const MidiBuffer& midi)
+    {
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        Array<int> result;
+        while (iter.getNextEvent (msg, frame))
+            result.add (frame);
+        return result;
+    }
+
+    void testScheduling()
+    {
+        beginTest ("messages land on their samples");
+        MidiInjectionQueue queue;
+        const auto note = MidiMessage::noteOn (1, 60, 1.f);
+        expect (queue.post (note, MidiInjectionQueue::asSoonAsPossible, 10.0));
+        expect (queue.post (note, 100, 0.0));
+        expect (queue.post (note, 700, 0.0));
+
+        MidiBuffer midi;
+        queue.drain (midi, 512, 44100.0, 10.0);
+        auto result = frames (midi);
+        expectEquals (result.size(), 2);
+        expectEquals (result[0], 100);
+        expectEquals (result[1], 511, "unscheduled messages land by when they were posted");
+        expectEquals (queue.getNumHeld(), 1);
+        expectEquals (queue.getNextBlockPosition(), (int64) 512);
+
+        midi.clear();
+        queue.drain (midi, 512, 44100.0, 10.0);
+        result = frames (midi);
+        expectEquals (result.size(), 1);
+        expectEquals (result[0], 700 - 512);
+        expectEquals (queue.getNumHeld(), 0);
+
+        beginTest ("late messages land at the start");
+        expect (queue.post (note, 10, 0.0));
+        midi.clear();
+        queue.drain (midi, 512, 44100.0, 10.0);
+        expectEquals (frames (midi)[0], 0);
+
+        beginTest ("discard");
+        expect (queue.post (note, 5000, 0.0));
+        expect (queue.post (note, MidiInjectionQueue::asSoonAsPossible, 10.0));
+        midi.clear();
+        queue.drain (midi, 512, 44100.0, 10.0);
+        queue.discard();
+        expectEquals (queue.getNumHeld(), 0);
+        midi.clear();
+        queue.drain (midi, 8192, 44100.0, 10.0);
+        expect (midi.isEmpty());
+    }
+
+    void testLimits()
+    {
+        beginTest ("oversized and overflowing messages are refused");
+        MidiInjectionQueue queue (4);
+        uint8 data [MidiInjectionQueue::maxMessageBytes + 1] = { 0xf0 };
+        expect (! queue.post (data, (int) sizeof (data), MidiInjectionQueue::asSoonAsPossible, 0.0));
+
+        const auto note = MidiMessage::noteOn (1, 60, 1.f);
+        for (int i = 0; i < 4; ++i)
+            expect (queue.post (note, MidiInjectionQueue::asSoonAsPossible, 0.0));
+        expect (! queue.post (note, MidiInjectionQueue::asSoonAsPossible, 0.0));
+
+        MidiBuffer midi;
+        queue.drain (midi, 64, 44100.0, 0.0);
+        expectEquals (midi.getNumEvents(), 4);
+        expect (queue.post (note, MidiInjectionQueue::asSoonAsPossible, 0.0), "room again after draining");
+    }
+
+    void testProducers()
+    {
+        beginTest ("many producers");
+        MidiInjectionQueue queue (1024);   // a drain stays within the default MidiBudget
+        struct Producer : public Thread
+        {
+            Producer (MidiInjectionQueue& q, int c) : Thread ("producer"), queue (q), channel (c) { }
+            void run() override
+            {
+                for (int i = 0; i < 500; ++i)
+                    while (! queue.post (MidiMessage::noteOn (channel, i % 128, (uint8) 1),
+                                         MidiInjectionQueue::asSoonAsPossible, 0.0))
+                        Thread::yield();
+            }
+            MidiInjectionQueue& queue;
+            const int channel;
+        };
+
+        OwnedArray<Producer> producers;
+        for (int i = 1; i <= 4; ++i)
+            producers.add (new Producer (queue, i))->startThread();
+
+        int counts[5] = { 0 };
+        int lastNote[5] = { -1, -1, -1, -1, -1 };
+        bool inOrder = true;
+        auto count = [&]()
+        {
+            MidiBuffer midi;
+            queue.drain (midi, 4096, 44100.0, 0.0);
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                const int channel = msg.getChannel();
+                inOrder &= msg.getNoteNumber() == (lastNote[channel] + 1) % 128;
+                lastNote[channel] = msg.getNoteNumber();
+                ++counts[channel];
+            }
+        };
+
+        for (auto* producer : producers)
+            while (producer->isThreadRunning())
+                count();
+        count();
+
+        for (int i = 1; i <= 4; ++i)
+            expectEquals (counts[i], 500);
+        expect (inOrder, "each producer's messages stay in order");
+    }
+};
+
+static MidiInjectionQueueTest sMidiInjectionQueueTest;
+
+}
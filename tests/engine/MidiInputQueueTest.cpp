@@ -0,0 +1,131 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+class MidiInputQueueTest : public UnitTestBase
+{
+public:
+    MidiInputQueueTest() : UnitTestBase ("MIDI Input Queue", "engine", "midiInputQueue") { }
+    virtual ~MidiInputQueueTest() { }
+
+    void runTest() override
+    {
+        testOffsets();
+        testSysex();
+        testOverflow();
+        testPop();
+    }
+
+private:
+    void testOffsets()
+    {
+        beginTest ("messages land relative to the end of the block");
+        MidiInputQueue queue;
+        expect (queue.push (MidiMessage::noteOn (1, 60, 1.f), 10.0));
+        expect (queue.push (MidiMessage::noteOff (1, 60), 10.004));
+        expect (queue.push (MidiMessage::controllerEvent (1, 7, 100), 9.0));
+
+        MidiBuffer midi;
+        queue.drain (midi, 512, 44100.0, 10.01);
+
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        Array<int> frames;
+        while (iter.getNextEvent (msg, frame))
+            frames.add (frame);
+
+        expectEquals (frames.size(), 3);
+        expectEquals (frames[0], 0, "late messages are clamped to the start");
+        expectEquals (frames[1], 512 - 441);
+        expectEquals (frames[2], 512 - 265);
+
+        midi.clear();
+        queue.drain (midi, 512, 44100.0, 10.02);
+        expect (midi.isEmpty(), "the queue should be empty after draining");
+    }
+
+    void testSysex()
+    {
+        beginTest ("sysex wraps around the ring");
+        MidiInputQueue queue (64);
+        uint8 data[20];
+        for (int i = 0; i < 20; ++i)
+            data[i] = (uint8) i;
+
+        MidiBuffer midi;
+        for (int round = 0; round < 8; ++round)
+        {
+            expect (queue.push (MidiMessage::createSysExMessage (data, 20), 1.0));
+            midi.clear();
+            queue.drain (midi, 64, 44100.0, 1.0);
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            expect (iter.getNextEvent (msg, frame));
+            expect (msg.isSysEx());
+            expectEquals (msg.getSysExDataSize(), 20);
+            expect (memcmp (msg.getSysExData(), data, 20) == 0);
+        }
+    }
+
+    void testOverflow()
+    {
+        beginTest ("full queues drop new messages");
+        MidiInputQueue queue (64);
+        int numPushed = 0;
+        while (queue.push (MidiMessage::noteOn (1, 60, 1.f), 0.0))
+            ++numPushed;
+        expect (numPushed > 0 && numPushed < 64);
+
+        queue.discard();
+        expect (queue.push (MidiMessage::noteOn (1, 60, 1.f), 0.0), "room again after discarding");
+    }
+
+    void testPop()
+    {
+        beginTest ("messages can be taken one at a time");
+        MidiInputQueue queue;
+        double timestamp = 0.0;
+        MidiMessage msg;
+        expect (! queue.peekTimestamp (timestamp));
+        expect (! queue.pop (msg, timestamp));
+
+        expect (queue.push (MidiMessage::noteOn (1, 60, 1.f), 2.0));
+        expect (queue.push (MidiMessage::midiClock(), 2.5));
+
+        expect (queue.peekTimestamp (timestamp));
+        expectEquals (timestamp, 2.0);
+        expect (queue.pop (msg, timestamp));
+        expect (msg.isNoteOn());
+        expectEquals (msg.getTimeStamp(), 2.0);
+
+        expect (queue.pop (msg, timestamp));
+        expect (msg.isMidiClock());
+        expectEquals (timestamp, 2.5);
+        expect (! queue.peekTimestamp (timestamp), "the queue should be empty");
+    }
+};
+
+static MidiInputQueueTest sMidiInputQueueTest;
+
+}
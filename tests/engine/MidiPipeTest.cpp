@@ -0,0 +1,72 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiPipe.h"
+
+namespace Element {
+
+class MidiPipeTest : public UnitTestBase
+{
+public:
+    MidiPipeTest() : UnitTestBase ("MIDI Pipe", "engine", "midiPipe") { }
+    virtual ~MidiPipeTest() { }
+
+    void runTest() override
+    {
+        beginTest ("more ports than the old limit");
+        OwnedArray<MidiBuffer> buffers;
+        Array<MidiPipe::Port> ports;
+        for (int i = 0; i < 64; ++i)
+        {
+            buffers.add (new MidiBuffer());
+            MidiPipe::Port port;
+            port.bufferIndex = 63 - i;
+            port.inputPort = i;
+            ports.add (port);
+        }
+
+        MidiPipe pipe;
+        pipe.setPorts (ports);
+        pipe.bind (buffers);
+        expectEquals (pipe.getNumBuffers(), 64);
+        expect (pipe.getWriteBuffer (0) == buffers[63]);
+        expect (pipe.getReadBuffer (63) == buffers[0]);
+        expectEquals (pipe.getPort (10).inputPort, 10);
+        expectEquals (pipe.getPort (10).outputPort, -1);
+
+        beginTest ("rebinding follows new buffers");
+        OwnedArray<MidiBuffer> other;
+        for (int i = 0; i < 64; ++i)
+            other.add (new MidiBuffer());
+        pipe.bind (other);
+        expect (pipe.getWriteBuffer (0) == other[63]);
+
+        beginTest ("clear");
+        for (auto* buffer : other)
+            buffer->addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        pipe.clear();
+        for (auto* buffer : other)
+            expect (buffer->isEmpty());
+    }
+};
+
+static MidiPipeTest sMidiPipeTest;
+
+}
@@ -0,0 +1,153 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiSequencer.h"
+#include "session/MidiClip.h"
+
+namespace Element {
+
+class MidiSequencerTest : public UnitTestBase
+{
+public:
+    MidiSequencerTest() : UnitTestBase ("MIDI Sequencer", "engine", "midiSequencer") { }
+    virtual ~MidiSequencerTest() { }
+
+    void runTest() override
+    {
+        testPlayback();
+        testJumps();
+        testEdits();
+    }
+
+private:
+    enum { blockSize = 128 };
+
+    // 60 bpm at 16384Hz, so a block is exactly 1/128 of a beat
+    static AudioPlayHead::CurrentPositionInfo at (double beat, bool isPlaying = true)
+    {
+        AudioPlayHead::CurrentPositionInfo position;
+        position.resetToDefault();
+        position.bpm = 60.0;
+        position.ppqPosition = beat;
+        position.isPlaying = isPlaying;
+        return position;
+    }
+
+    static ValueTree addClip (ValueTree& sequence, int trackIndex, double start, double length)
+    {
+        while (sequence.getNumChildren() <= trackIndex)
+            sequence.addChild (ValueTree (Slugs::track), -1, nullptr);
+
+        MidiClip clip;
+        clip.node().setProperty ("start", start, nullptr);
+        clip.node().setProperty ("length", length, nullptr);
+        clip.node().setProperty ("offset", 0.0, nullptr);
+        sequence.getChild (trackIndex).addChild (clip.node(), -1, nullptr);
+        return clip.node();
+    }
+
+    int render (MidiSequencer& sequencer, MidiBuffer& midi, double beat, bool isPlaying = true)
+    {
+        midi.clear();
+        MidiBudget::Writer writer (midi);
+        sequencer.render (writer, at (beat, isPlaying), blockSize);
+        return midi.getNumEvents();
+    }
+
+    void testPlayback()
+    {
+        beginTest ("events land on their sample in the block");
+        ValueTree sequence ("sequence");
+        auto clip = addClip (sequence, 0, 1.0, 2.0);
+        NoteSequence (clip.getChildWithName ("notes")).addNote (60, 1.0 / 512, 0.5);
+        addClip (sequence, 3, 100.0, 1.0);
+
+        MidiSequencer sequencer;
+        sequencer.prepare (16384.0);
+        sequencer.setSequence (sequence);
+        expectEquals (sequencer.getNumTracks(), 2);
+
+        MidiBuffer midi;
+        expectEquals (render (sequencer, midi, 0.0), 0);
+        expectEquals (render (sequencer, midi, 1.0), 1);
+        expectEquals (midi.getFirstEventTime(), 32);
+
+        beginTest ("stopping releases sounding notes");
+        expectEquals (render (sequencer, midi, 1.0 + 1.0 / 128, false), 1);
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage message; int frame = 0;
+        expect (iter.getNextEvent (message, frame) && message.isNoteOff());
+        expectEquals (render (sequencer, midi, 1.0, false), 0);
+        sequencer.release();
+    }
+
+    void testJumps()
+    {
+        ValueTree sequence ("sequence");
+        auto clip = addClip (sequence, 0, 0.0, 1.0);
+        const double start = 1.0 - 1.5 / 128;
+        NoteSequence (clip.getChildWithName ("notes")).addNote (60, start, 2.0);
+
+        MidiSequencer sequencer;
+        sequencer.prepare (16384.0);
+        sequencer.setSequence (sequence);
+        MidiBuffer midi;
+
+        beginTest ("a jump finds the clip by seeking");
+        expectEquals (render (sequencer, midi, start), 1);
+
+        beginTest ("notes are cut where their clip ends");
+        expectEquals (render (sequencer, midi, start + 1.0 / 128), 1);
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage message; int frame = 0;
+        expect (iter.getNextEvent (message, frame) && message.isNoteOff());
+        expectEquals (frame, 64);
+
+        beginTest ("jumping back plays the clip again");
+        expectEquals (render (sequencer, midi, start), 1);
+        expectEquals (render (sequencer, midi, 8.0), 1);
+        sequencer.release();
+    }
+
+    void testEdits()
+    {
+        ValueTree sequence ("sequence");
+        auto clip = addClip (sequence, 0, 0.0, 4.0);
+        MidiSequencer sequencer;
+        sequencer.prepare (16384.0);
+        sequencer.setSequence (sequence);
+        MidiBuffer midi;
+
+        beginTest ("added notes play once published");
+        NoteSequence (clip.getChildWithName ("notes")).addNote (62, 2.0, 1.0);
+        sequencer.update();
+        expectEquals (render (sequencer, midi, 2.0), 1);
+
+        beginTest ("muting a track releases its notes");
+        sequence.getChild (0).setProperty ("mute", true, nullptr);
+        sequencer.update();
+        expectEquals (sequencer.getNumTracks(), 0);
+        expectEquals (render (sequencer, midi, 2.0), 1);
+        sequencer.release();
+    }
+};
+
+static MidiSequencerTest sMidiSequencerTest;
+
+}
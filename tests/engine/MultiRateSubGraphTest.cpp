@@ -0,0 +1,194 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/RateBoundary.h"
+#include "engine/nodes/SubGraphProcessor.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class MultiRateSubGraphTest : public UnitTestBase
+{
+public:
+    MultiRateSubGraphTest() : UnitTestBase ("Multi-Rate Sub Graphs", "engine", "multiRate") { }
+    virtual ~MultiRateSubGraphTest() { }
+
+    void runTest() override
+    {
+        testBuffering();
+        testDecimation();
+        testSubGraph (1, 1024, true);
+        testSubGraph (2, 0, false);
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr double sampleRate = 44100.0;
+
+    void testBuffering()
+    {
+        beginTest ("larger inner blocks delay by their length");
+        RateBoundary boundary;
+        boundary.prepare (1, 1, 100);
+        expectEquals (boundary.getLatencySamples(), 100);
+
+        int numRenders = 0;
+        bool sizesMatch = true;
+        RateBoundary::Renderer render = [&] (AudioSampleBuffer& audio, MidiBuffer&) {
+            ++numRenders;
+            sizesMatch &= audio.getNumSamples() == 100;
+        };
+
+        AudioSampleBuffer audio (1, 37);
+        MidiBuffer midi;
+        int impulseAt = -1, noteAt = -1;
+        for (int block = 0; block < 10; ++block)
+        {
+            audio.clear();
+            midi.clear();
+            if (block == 0)
+            {
+                audio.setSample (0, 10, 1.f);
+                midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 5);
+            }
+
+            boundary.process (audio, midi, render);
+
+            for (int i = 0; i < audio.getNumSamples(); ++i)
+                if (audio.getSample (0, i) > 0.5f)
+                    impulseAt = block * 37 + i;
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+                if (msg.isNoteOn())
+                    noteAt = block * 37 + frame;
+        }
+
+        expectEquals (numRenders, 3);
+        expect (sizesMatch, "the inner graph always gets whole blocks");
+        expectEquals (impulseAt, 110);
+        expectEquals (noteAt, 105);
+    }
+
+    void testDecimation()
+    {
+        beginTest ("divided rates pass the band below the new nyquist");
+        RateBoundary boundary;
+        boundary.prepare (1, 2, 64);
+        expectEquals (boundary.getBlockSize(), 128);
+        expectEquals (boundary.getLatencySamples(), 128 + 4 * (int) RateBoundary::tapsPerDivision);
+
+        bool sizesMatch = true;
+        RateBoundary::Renderer render = [&] (AudioSampleBuffer& audio, MidiBuffer&) {
+            sizesMatch &= audio.getNumSamples() == 64;
+        };
+
+        const int latency = boundary.getLatencySamples();
+        const double frequency = 0.02;
+        auto sine = [frequency] (int frame) { return frame < 0 ? 0.f : (float) std::sin (MathConstants<double>::twoPi * frequency * frame); };
+
+        AudioSampleBuffer audio (1, blockSize);
+        MidiBuffer midi;
+        float error = 0.f;
+        for (int block = 0; block < 8; ++block)
+        {
+            for (int i = 0; i < blockSize; ++i)
+                audio.setSample (0, i, sine (block * blockSize + i));
+            boundary.process (audio, midi, render);
+
+            // once the filters have settled
+            if (block >= 3)
+                for (int i = 0; i < blockSize; ++i)
+                    error = jmax (error, std::abs (audio.getSample (0, i) - sine (block * blockSize + i - latency)));
+        }
+
+        expect (sizesMatch, "the inner graph renders half as many samples");
+        expectLessThan (error, 0.001f);
+    }
+
+    void testSubGraph (int division, int innerBlockSize, bool inlining)
+    {
+        beginTest (String ("sub graph at 1/") + String (division) + " rate, "
+            + String (innerBlockSize > 0 ? innerBlockSize : blockSize / division) + " sample blocks");
+
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        graph.setSubGraphInliningEnabled (inlining);
+
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+
+        auto* sub = new SubGraphProcessor();
+        sub->setRateDivision (division);
+        sub->setInnerBlockSize (innerBlockSize);
+        GraphNodePtr rack = graph.addNode (sub);
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        GraphNodePtr subInput = sub->addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr subOutput = sub->addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = sub->addNode (new VolumeProcessor (-60.0, 12.0, true));
+        subInput->connectAudioTo (volume);
+        volume->connectAudioTo (subOutput);
+
+        input->connectAudioTo (rack);
+        rack->connectAudioTo (output);
+
+        // prepares the sub graph again, with its connections
+        graph.releaseResources();
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        const int expectedBlock = innerBlockSize > 0 ? innerBlockSize : blockSize / division;
+        expectEquals (sub->getRenderSampleRate(), sampleRate / division);
+        expectEquals (sub->getRenderBlockSize(), expectedBlock);
+        expectEquals (volume->getAudioProcessor()->getSampleRate(), sampleRate / division);
+        expectEquals (sub->getSampleRate(), sampleRate, "the graph itself runs at its parent's rate");
+        expectEquals (sub->getLatencySamples(), expectedBlock * division
+            + (division > 1 ? 2 * division * (int) RateBoundary::tapsPerDivision : 0));
+        expectEquals (rack->getLatencySamples(), sub->getLatencySamples());
+
+        // constant input comes through once the latency has passed
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        const int numBlocks = sub->getLatencySamples() / blockSize + 4;
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                FloatVectorOperations::fill (audio.getWritePointer (ch), 0.25f, blockSize);
+            midi.clear();
+            graph.processBlock (audio, midi);
+        }
+
+        for (int ch = 0; ch < 2; ++ch)
+            expectWithinAbsoluteError (audio.getSample (ch, blockSize - 1), 0.25f, 0.001f);
+
+        graph.releaseResources();
+        expectEquals (sub->getRenderBlockSize(), sub->getBlockSize(), "released graphs render at their own size");
+        graph.clear();
+    }
+};
+
+static MultiRateSubGraphTest sMultiRateSubGraphTest;
+
+}
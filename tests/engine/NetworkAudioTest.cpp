@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/NetworkAudio.h"
+
+using namespace Element;
+
+//=============================================================================
+class NetworkAudioTest : public UnitTestBase
+{
+public:
+    NetworkAudioTest()
+        : UnitTestBase ("Network Audio", "engine", "networkAudio") { }
+
+    void runTest() override
+    {
+        beginTest ("packet sizes");
+        expectEquals (NetworkAudioPacket::getMaxFrames (1), 256);
+        expectEquals (NetworkAudioPacket::getMaxFrames (2), 180);
+        expectEquals (NetworkAudioPacket::getMaxFrames (8), 45);
+        expectEquals (NetworkAudioPacket::getSize (2, 64), 32 + 2 * 64 * 4);
+
+        beginTest ("headers round trip");
+        uint8 packet [NetworkAudioPacket::maxSize];
+        zerostruct (packet);
+        NetworkAudioPacket::Header header;
+        header.sequence = 65535;
+        header.timestamp = 0xdeadbeef;
+        header.ssrc = 1234567;
+        header.numChannels = 2;
+        header.numFrames = 64;
+        header.sampleRate = 48000;
+        header.wallClock = NetworkAudioPacket::getWallClock();
+        NetworkAudioPacket::writeHeader (packet, header);
+        expectEquals ((int) packet[0], 0x90);
+        expectEquals ((int) packet[1], (int) NetworkAudioPacket::payloadType);
+
+        NetworkAudioPacket::Header read;
+        const int size = NetworkAudioPacket::getSize (2, 64);
+        expect (NetworkAudioPacket::readHeader (packet, size, read));
+        expectEquals ((int) read.sequence, 65535);
+        expect (read.timestamp == header.timestamp);
+        expect (read.ssrc == header.ssrc);
+        expectEquals (read.numChannels, 2);
+        expectEquals (read.numFrames, 64);
+        expect (read.sampleRate == 48000);
+        expect (read.wallClock == header.wallClock);
+
+        beginTest ("bad packets are rejected");
+        expect (! NetworkAudioPacket::readHeader (packet, size - 1, read));
+        expect (! NetworkAudioPacket::readHeader (packet, NetworkAudioPacket::headerSize - 1, read));
+        packet[1] = 96;
+        expect (! NetworkAudioPacket::readHeader (packet, size, read));
+        header.numChannels = 0;
+        NetworkAudioPacket::writeHeader (packet, header);
+        expect (! NetworkAudioPacket::readHeader (packet, size, read));
+
+        beginTest ("wall clock differences");
+        const uint64 second = (uint64) 1 << 32;
+        const uint64 now = NetworkAudioPacket::getWallClock();
+        expectWithinAbsoluteError (NetworkAudioPacket::getMillisecondsBetween (now, now + second / 2), 500.0, 0.001);
+        expectWithinAbsoluteError (NetworkAudioPacket::getMillisecondsBetween (now + second, now), -1000.0, 0.001);
+    }
+};
+
+static NetworkAudioTest sNetworkAudioTest;
@@ -0,0 +1,133 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/FrozenAudio.h"
+
+namespace Element {
+
+class NodeFreezeTest : public UnitTestBase
+{
+public:
+    NodeFreezeTest() : UnitTestBase ("Node Freeze", "engine", "nodeFreeze") { }
+    virtual ~NodeFreezeTest() { }
+
+    void runTest() override
+    {
+        testPlaybackWraps();
+        testFreezeNode();
+    }
+
+private:
+    void testPlaybackWraps()
+    {
+        beginTest ("playback wraps around");
+        TemporaryFile file (".wav");
+        {
+            AudioSampleBuffer ramp (1, 100);
+            for (int i = 0; i < ramp.getNumSamples(); ++i)
+                ramp.setSample (0, i, (float) i / 100.f);
+
+            WavAudioFormat wav;
+            std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (
+                file.getFile().createOutputStream(), 44100.0, 1, 32, {}, 0));
+            expect (writer != nullptr);
+            writer->writeFromAudioSampleBuffer (ramp, 0, ramp.getNumSamples());
+        }
+
+        auto audio = FrozenAudio::open (file.getFile(), 0);
+        expect (audio != nullptr);
+        if (audio == nullptr)
+            return;
+        expectEquals (audio->getLengthInSamples(), (int64) 100);
+
+        AudioSampleBuffer buffer (2, 20);
+        buffer.clear();
+        audio->read (buffer, 2, 190, 20);
+        expectWithinAbsoluteError (buffer.getSample (0, 0), 0.9f, 0.001f);
+        expectWithinAbsoluteError (buffer.getSample (0, 10), 0.0f, 0.001f);
+        expectWithinAbsoluteError (buffer.getSample (0, 19), 0.09f, 0.001f);
+        expectEquals (buffer.getMagnitude (1, 0, 20), 0.f, "channels beyond the render should be cleared");
+    }
+
+    void testFreezeNode()
+    {
+        beginTest ("freeze and thaw");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        graph.prepareToPlay (44100.0, 512);
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, 512);
+
+        expect (input->freeze (File(), 1.0).failed(), "IO nodes can't be frozen");
+
+        TemporaryFile file (".wav");
+        Result finished = Result::fail ("not finished");
+        auto result = volume->freeze (file.getFile(), 0.1, [&finished] (const Result& r) { finished = r; });
+        expect (result.wasOk(), result.getErrorMessage());
+        expect (volume->isFreezing());
+        expect (! volume->isEnabled(), "the node should be disabled while rendering");
+        waitForFreeze (*volume);
+        expect (finished.wasOk(), finished.getErrorMessage());
+        expect (volume->isFrozen());
+        expect (! volume->isEnabled(), "the processor should be unloaded while frozen");
+        expectEquals (volume->getFrozenAudio()->getLengthInSamples(), (int64) 4410);
+
+        volume->setEnabled (true);
+        expect (! volume->isEnabled(), "enabling a frozen node does nothing");
+
+        graph.prepareToPlay (44100.0, 512);
+        AudioSampleBuffer audio (2, 512);
+        MidiBuffer midi;
+        audio.clear();
+        graph.processBlock (audio, midi);
+
+        volume->unfreeze();
+        expect (! volume->isFrozen());
+        expect (volume->isEnabled());
+
+        beginTest ("cancel a freeze");
+        TemporaryFile longFile (".wav");
+        expect (volume->freeze (longFile.getFile(), 600.0).wasOk());
+        volume->unfreeze();
+        expect (! volume->isFreezing());
+        expect (! volume->isFrozen());
+        expect (volume->isEnabled());
+        runDispatchLoop (40);
+        expect (! volume->isFrozen(), "a cancelled render shouldn't be played");
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    void waitForFreeze (GraphNode& node)
+    {
+        for (int i = 0; i < 250 && node.isFreezing(); ++i)
+            runDispatchLoop (20);
+    }
+};
+
+static NodeFreezeTest sNodeFreezeTest;
+
+}
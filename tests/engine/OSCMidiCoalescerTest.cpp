@@ -0,0 +1,83 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/OSCMidiCoalescer.h"
+
+namespace Element {
+
+class OSCMidiCoalescerTest : public UnitTestBase
+{
+public:
+    OSCMidiCoalescerTest() : UnitTestBase ("OSC MIDI Coalescer", "engine", "oscMidiCoalescer") { }
+    virtual ~OSCMidiCoalescerTest() { }
+
+    void runTest() override
+    {
+        testBundle();
+        testDeduplicating();
+    }
+
+private:
+    void testBundle()
+    {
+        beginTest ("events go out as one bundle");
+        OSCMidiCoalescer coalescer;
+        coalescer.add (MidiMessage::noteOn (1, 60, 1.f), 5.0);
+        coalescer.add (MidiMessage::controllerEvent (1, 7, 10), 5.0);
+        coalescer.add (MidiMessage::controllerEvent (1, 7, 20), 5.01);
+        expectEquals (coalescer.getStartTime(), 5.0);
+
+        const auto bundle = coalescer.createBundle();
+        expectEquals (bundle.size(), 3);
+        expect (bundle[0].isMessage());
+        expectEquals (bundle[0].getMessage().getAddressPattern().toString(), String ("/midi/noteOn"));
+
+        coalescer.clear();
+        expect (coalescer.isEmpty());
+        coalescer.add (MidiMessage::noteOff (1, 60), 6.0);
+        expectEquals (coalescer.getStartTime(), 6.0, "the start time follows the first event after clearing");
+    }
+
+    void testDeduplicating()
+    {
+        beginTest ("latest value wins");
+        OSCMidiCoalescer coalescer;
+        coalescer.setDeduplicating (true);
+        coalescer.add (MidiMessage::controllerEvent (1, 7, 10), 1.0);
+        coalescer.add (MidiMessage::controllerEvent (1, 1, 64), 1.0);
+        coalescer.add (MidiMessage::noteOn (1, 60, 1.f), 1.0);
+        coalescer.add (MidiMessage::noteOn (1, 60, 1.f), 1.0);
+        coalescer.add (MidiMessage::controllerEvent (1, 7, 20), 1.0);
+        coalescer.add (MidiMessage::controllerEvent (2, 7, 30), 1.0);
+        coalescer.add (MidiMessage::pitchWheel (1, 100), 1.0);
+        coalescer.add (MidiMessage::pitchWheel (1, 200), 1.0);
+
+        expectEquals (coalescer.getNumEvents(), 6);
+        expect (coalescer.getEvent (0).isController() && coalescer.getEvent (0).getControllerNumber() == 1);
+        expect (coalescer.getEvent (1).isNoteOn() && coalescer.getEvent (2).isNoteOn(), "notes are always kept");
+        expectEquals (coalescer.getEvent (3).getControllerValue(), 20);
+        expectEquals (coalescer.getEvent (4).getChannel(), 2, "other channels are kept apart");
+        expectEquals (coalescer.getEvent (5).getPitchWheelValue(), 200);
+    }
+};
+
+static OSCMidiCoalescerTest sOSCMidiCoalescerTest;
+
+}
@@ -0,0 +1,68 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/OSCParameterRouter.h"
+
+using namespace Element;
+
+//=============================================================================
+class OSCParameterRouterTest : public UnitTestBase
+{
+public:
+    OSCParameterRouterTest ()
+        : UnitTestBase ("OSC Parameter Router", "engine", "oscParams") { }
+
+    void runTest() override
+    {
+        uint32 nodeId = 0;
+        String parameter;
+
+        beginTest ("parameter addresses");
+        expect (OSCParameterRouter::parseAddress ("/element/param/12/3", nodeId, parameter));
+        expectEquals ((int) nodeId, 12);
+        expectEquals (parameter, String ("3"));
+        expect (OSCParameterRouter::parseAddress ("/element/param/4/cutoff_freq", nodeId, parameter));
+        expectEquals ((int) nodeId, 4);
+        expectEquals (parameter, String ("cutoff_freq"));
+
+        beginTest ("pair addresses");
+        expect (OSCParameterRouter::parseAddress ("/element/param/7", nodeId, parameter));
+        expectEquals ((int) nodeId, 7);
+        expect (parameter.isEmpty());
+
+        beginTest ("other addresses");
+        expect (! OSCParameterRouter::parseAddress ("/element/command", nodeId, parameter));
+        expect (! OSCParameterRouter::parseAddress ("/element/param/", nodeId, parameter));
+        expect (! OSCParameterRouter::parseAddress ("/element/param/x/1", nodeId, parameter));
+        expect (! OSCParameterRouter::parseAddress ("/element/param/1/2/3", nodeId, parameter));
+
+        beginTest ("unresolved addresses are cached once");
+        OSCParameterRouter router;
+        router.oscMessageReceived (OSCMessage ("/element/param/1/0", 0.5f));
+        router.oscMessageReceived (OSCMessage ("/element/param/1/0", 0.25f));
+        router.oscMessageReceived (OSCMessage ("/element/command", String ("quit")));
+        MessageManager::getInstance()->runDispatchLoopUntil (20);
+        expectEquals (router.getNumCachedAddresses(), 1);
+        expectEquals ((int) router.getNumChangesRouted(), 0);
+        router.invalidate();
+        expectEquals (router.getNumCachedAddresses(), 0);
+    }
+};
+
+static OSCParameterRouterTest sOSCParameterRouterTest;
@@ -0,0 +1,77 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/OfflineRenderer.h"
+
+namespace Element {
+
+class OfflineRendererTest : public UnitTestBase
+{
+public:
+    OfflineRendererTest() : UnitTestBase ("Offline Renderer", "engine", "offlineRenderer") { }
+    virtual ~OfflineRendererTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        graph.prepareToPlay (44100.0, 256);
+        input->connectAudioTo (output);
+
+        TemporaryFile file (".wav");
+        OfflineRenderer::Options options;
+        options.blockSize = 256;
+        options.lengthInSamples = 1000;
+        options.file = file.getFile();
+
+        beginTest ("render");
+        double lastProgress = 0.0;
+        OfflineRenderer renderer (graph, options);
+        auto result = renderer.render ([&lastProgress] (double p) { lastProgress = p; return true; });
+        expect (result.wasOk(), result.getErrorMessage());
+        expectEquals (lastProgress, 1.0);
+        expect (! graph.isNonRealtime(), "graph should be realtime again after rendering");
+
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatReader> reader (wav.createReaderFor (
+            file.getFile().createInputStream(), true));
+        expect (reader != nullptr);
+        if (reader != nullptr)
+        {
+            expectEquals (reader->lengthInSamples, options.lengthInSamples);
+            expectEquals ((int) reader->numChannels, options.numChannels);
+        }
+        reader.reset();
+
+        beginTest ("cancel");
+        result = renderer.render ([] (double) { return false; });
+        expect (result.failed());
+        expect (! file.getFile().existsAsFile(), "cancelled renders should be deleted");
+
+        graph.clear();
+    }
+};
+
+static OfflineRendererTest sOfflineRendererTest;
+
+}
@@ -0,0 +1,181 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/OverloadGovernor.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class OverloadGovernorTest : public UnitTestBase
+{
+public:
+    OverloadGovernorTest() : UnitTestBase ("Overload Governor", "engine", "overloadGovernor") { }
+    virtual ~OverloadGovernorTest() { }
+
+    void initialise() override
+    {
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        graph.prepareToPlay (44100.0, blockSize);
+    }
+
+    void shutdown() override
+    {
+        graph.releaseResources();
+        graph.clear();
+        input = output = nullptr;
+    }
+
+    void runTest() override
+    {
+        testShedFades();
+        testGovernor();
+    }
+
+private:
+    static constexpr int blockSize = 512;
+    GraphProcessor graph;
+    GraphNodePtr input, output;
+
+    /** Adds a volume node turned all the way down, so it's silent unless shed */
+    GraphNodePtr addSilentVolume()
+    {
+        GraphNodePtr node = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        node->getAudioProcessor()->getParameters()[0]->setValueNotifyingHost (0.f);
+        return node;
+    }
+
+    void render (AudioSampleBuffer& audio)
+    {
+        MidiBuffer midi;
+        for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+            FloatVectorOperations::fill (audio.getWritePointer (ch), 0.5f, audio.getNumSamples());
+        graph.processBlock (audio, midi);
+    }
+
+    void testShedFades()
+    {
+        beginTest ("shed nodes fade to their inputs and back");
+        GraphNodePtr volume = addSilentVolume();
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        AudioSampleBuffer audio (2, blockSize);
+        for (int i = 0; i < 8; ++i)
+            render (audio);
+        expectEquals (audio.getMagnitude (0, blockSize), 0.f, "the node should be silent");
+
+        volume->setShed (true);
+        render (audio);
+        expectWithinAbsoluteError (audio.getSample (0, 0), 0.f, 0.01f);
+        expectWithinAbsoluteError (audio.getSample (0, blockSize - 1), 0.5f, 0.01f);
+        render (audio);
+        expectEquals (audio.getMagnitude (0, blockSize), 0.5f);
+        expectEquals (audio.getSample (1, 0), 0.5f, "the inputs should pass through once shed");
+
+        volume->setShed (false);
+        render (audio);
+        expectWithinAbsoluteError (audio.getSample (0, 0), 0.5f, 0.01f);
+        expectWithinAbsoluteError (audio.getSample (0, blockSize - 1), 0.f, 0.01f);
+        render (audio);
+        expectEquals (audio.getMagnitude (0, blockSize), 0.f);
+
+        graph.removeNode (volume->nodeId);
+    }
+
+    void testGovernor()
+    {
+        GraphNodePtr low = addSilentVolume();
+        GraphNodePtr normal = addSilentVolume();
+        GraphNodePtr essential = addSilentVolume();
+        low->setLoadPriority (GraphNode::LowPriority);
+        low->setOversamplingFactor (2);
+        essential->setLoadPriority (GraphNode::EssentialPriority);
+        essential->setOversamplingFactor (2);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        ReferenceCountedArray<GraphNode> nodes;
+        nodes.add (low);
+        nodes.add (normal);
+        nodes.add (essential);
+
+        OverloadGovernor::Options options;
+        options.overloadReadings = 2;
+        options.restoreReadings = 3;
+        OverloadGovernor governor (options);
+
+        beginTest ("oversampling is lowered first");
+        expect (! governor.update (0.95, nodes), "a single reading isn't sustained");
+        expect (governor.update (0.95, nodes));
+        expectEquals (low->getOversamplingFactor(), 1);
+        expectEquals (low->getRequestedOversamplingFactor(), 2, "the saved factor should stay");
+        expect (low->isEnabled());
+        expect (! low->isShed());
+
+        beginTest ("then low priority nodes are shed");
+        governor.update (0.95, nodes);
+        expect (governor.update (0.95, nodes));
+        expect (low->isShed());
+        expect (! normal->isShed());
+
+        beginTest ("essential nodes are left alone");
+        governor.update (0.95, nodes);
+        expect (! governor.update (0.95, nodes));
+        expectEquals (governor.getNumActions(), 2);
+        expectEquals (essential->getOversamplingFactor(), 2);
+        expect (! essential->isShed());
+
+        beginTest ("load between the thresholds holds");
+        for (int i = 0; i < 10; ++i)
+            expect (! governor.update (0.7, nodes));
+        expectEquals (governor.getNumActions(), 2);
+
+        beginTest ("load is restored last first");
+        governor.update (0.3, nodes);
+        governor.update (0.3, nodes);
+        expect (governor.update (0.3, nodes));
+        expect (! low->isShed());
+        expectEquals (low->getOversamplingFactor(), 1);
+        governor.update (0.3, nodes);
+        governor.update (0.3, nodes);
+        expect (governor.update (0.3, nodes));
+        expectEquals (low->getOversamplingFactor(), 2);
+        expectEquals (governor.getNumActions(), 0);
+
+        beginTest ("restoring everything");
+        for (int i = 0; i < 4; ++i)
+            governor.update (0.95, nodes);
+        expectEquals (governor.getNumActions(), 2);
+        governor.restoreAll();
+        expect (! low->isShed());
+        expectEquals (low->getOversamplingFactor(), 2);
+
+        for (auto* node : nodes)
+            graph.removeNode (node->nodeId);
+    }
+};
+
+static OverloadGovernorTest sOverloadGovernorTest;
+
+}
@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+
+namespace Element {
+
+/** Compares the latency and CPU cost of the oversampling modes a node can
+    use, and checks the node reports the latency of the mode it's in. */
+class OversamplingBenchmark : public UnitTestBase
+{
+public:
+    OversamplingBenchmark() : UnitTestBase ("Oversampling Benchmark", "engine", "oversampling") { }
+    virtual ~OversamplingBenchmark() { }
+
+    void runTest() override
+    {
+        testNodeLatency();
+
+        for (int osPow = 1; osPow <= 3; ++osPow)
+        {
+            beginTest (String (1 << osPow) + "x");
+            float latencies [GraphNode::NumOversamplingModes];
+            for (int i = 0; i < GraphNode::NumOversamplingModes; ++i)
+                latencies[i] = benchmark (osPow, static_cast<GraphNode::OversamplingMode> (i));
+
+            expectLessThan (latencies [GraphNode::OversampleMinimumPhase], latencies [GraphNode::OversampleLinearPhase]);
+            expectLessOrEqual (latencies [GraphNode::OversampleMinimumPhaseLowOrder], latencies [GraphNode::OversampleMinimumPhase]);
+            expectLessOrEqual (latencies [GraphNode::OversampleLinearPhaseLowOrder], latencies [GraphNode::OversampleLinearPhase]);
+        }
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr int numBlocks = 2000;
+    static constexpr int numChannels = 2;
+    static constexpr double sampleRate = 44100.0;
+
+    void testNodeLatency()
+    {
+        beginTest ("node latency follows the mode");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        GraphNodePtr node = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        node->setOversamplingFactor (2);
+        graph.prepareToPlay (sampleRate, blockSize);
+        expectEquals (node->getOversamplingLatencySamples(), expectedLatency (GraphNode::OversampleMinimumPhase));
+
+        graph.releaseResources();
+        node->setOversamplingMode (GraphNode::OversampleLinearPhase);
+        expectEquals (node->getOversamplingLatencySamples(), expectedLatency (GraphNode::OversampleLinearPhase),
+                      "known before the graph is prepared");
+        graph.prepareToPlay (sampleRate, blockSize);
+        expectEquals (node->getOversamplingLatencySamples(), expectedLatency (GraphNode::OversampleLinearPhase));
+        expectEquals (node->getLatencySamples(), node->getOversamplingLatencySamples());
+
+        graph.releaseResources();
+        node->setOversamplingFactor (1);
+        expectEquals (node->getLatencySamples(), 0, "no latency without oversampling");
+
+        node = nullptr;
+        graph.clear();
+    }
+
+    static int expectedLatency (GraphNode::OversamplingMode mode)
+    {
+        std::unique_ptr<dsp::Oversampling<float>> os (GraphNode::createOversampling (numChannels, 1, mode));
+        return roundFloatToInt (os->getLatencyInSamples());
+    }
+
+    float benchmark (int osPow, GraphNode::OversamplingMode mode)
+    {
+        ScopedNoDenormals noDenormals;
+        std::unique_ptr<dsp::Oversampling<float>> os (GraphNode::createOversampling (numChannels, osPow, mode));
+        os->initProcessing ((size_t) blockSize);
+
+        AudioSampleBuffer audio (numChannels, blockSize);
+        Random rand (99);
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                audio.setSample (ch, i, rand.nextFloat() * 2.f - 1.f);
+
+        const auto start = Time::getMillisecondCounterHiRes();
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            dsp::AudioBlock<float> samples (audio);
+            auto up = os->processSamplesUp (samples);
+            expect (up.getNumSamples() == (size_t) (blockSize << osPow));
+            os->processSamplesDown (samples);
+        }
+        const auto elapsed = Time::getMillisecondCounterHiRes() - start;
+
+        const float latency = os->getLatencyInSamples();
+        logMessage (GraphNode::getOversamplingModeName (mode) + ": latency " + String (latency, 2)
+            + " samples, " + String (elapsed, 3) + " ms for " + String (numBlocks) + " blocks");
+        return latency;
+    }
+};
+
+static OversamplingBenchmark sOversamplingBenchmark;
+
+}
@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+
+namespace Element {
+
+/** Root graphs in parallel mode render as stages of one job on the engine's
+    render pool. Graphs with multi-core rendering on start jobs of their own
+    from inside those stages, on the same pool */
+class ParallelGraphsTest : public UnitTestBase
+{
+public:
+    ParallelGraphsTest() : UnitTestBase ("Parallel Root Graphs", "engine", "parallelGraphs") { }
+    virtual ~ParallelGraphsTest() { }
+
+    void runTest() override
+    {
+        beginTest ("multi-core graphs rendered in parallel");
+        auto& settings = getWorld().getSettings();
+        auto engine = getWorld().getAudioEngine();
+        const int oldNumThreads = settings.getNumRenderThreads();
+        settings.setNumRenderThreads (3);
+        engine->applySettings (settings);
+        engine->prepareExternalPlayback (sampleRate, blockSize, 2, 2);
+
+        OwnedArray<RootGraph> graphs;
+        for (int i = 0; i < 2; ++i)
+        {
+            auto* graph = graphs.add (new RootGraph());
+            graph->setRenderMode (RootGraph::Parallel);
+            build (*graph);
+            graph->setParallelRenderingEnabled (true);
+            engine->addGraph (graph);
+        }
+        engine->setActiveGraph (0);
+        runDispatchLoop (100);
+
+        struct Renderer : public Thread
+        {
+            Renderer (AudioEngine& e) : Thread ("el.test.parallelGraphs"), engine (e) { }
+
+            void run() override
+            {
+                AudioSampleBuffer audio (2, blockSize);
+                MidiBuffer midi;
+                for (int i = 0; i < 500; ++i)
+                {
+                    for (int c = 0; c < 2; ++c)
+                        audio.clear (c, 0, blockSize);
+                    audio.setSample (0, 0, 1.f);
+                    midi.clear();
+                    engine.processExternalBuffers (audio, midi);
+                }
+            }
+
+            AudioEngine& engine;
+        } renderer (*engine);
+
+        // a deadlock leaves the renderer stuck, so it's never waited on forever
+        renderer.startThread();
+        expect (renderer.waitForThreadToExit (10000), "rendering should not deadlock");
+
+        engine->releaseExternalResources();
+        for (auto* graph : graphs)
+        {
+            engine->removeGraph (graph);
+            graph->clear();
+        }
+        graphs.clear();
+
+        settings.setNumRenderThreads (oldNumThreads);
+        engine->applySettings (settings);
+        shutdownWorld();
+    }
+
+private:
+    static constexpr double sampleRate  = 48000.0;
+    static constexpr int blockSize      = 256;
+
+    /** Four volume nodes side by side, so the graph has stages to spread */
+    static void build (GraphProcessor& graph)
+    {
+        graph.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        GraphNodePtr input = graph.addNode (new IOProcessor (IOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode));
+        for (int i = 0; i < 4; ++i)
+        {
+            GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 0.0, false));
+            graph.connectChannels (PortType::Audio, input->nodeId, i % 2, volume->nodeId, 0);
+            graph.connectChannels (PortType::Audio, volume->nodeId, 0, output->nodeId, i % 2);
+        }
+        graph.prepareToPlay (sampleRate, blockSize);
+    }
+};
+
+static ParallelGraphsTest sParallelGraphsTest;
+
+}
@@ -0,0 +1,163 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+
+using namespace Element;
+
+//=============================================================================
+class ParameterDispatchTest : public UnitTestBase
+{
+public:
+    ParameterDispatchTest()
+        : UnitTestBase ("Parameter Dispatch", "engine", "parameterDispatch") { }
+
+    void runTest() override
+    {
+        SharedResourcePointer<ParameterDispatcher> dispatcher;
+
+        beginTest ("many sets deliver one change");
+        {
+            Parameter::Ptr param = new TestParameter (0);
+            Counter counter (param);
+            expectEquals (dispatcher->getNumListeners(), 1);
+
+            Setter setter (*param, 100);
+            setter.startThread();
+            setter.waitForThreadToExit (2000);
+            dispatcher->dispatchPendingChanges();
+            expectEquals (counter.count, 1);
+
+            dispatcher->dispatchPendingChanges();
+            expectEquals (counter.count, 1);
+        }
+        expectEquals (dispatcher->getNumListeners(), 0);
+
+        beginTest ("only changed parameters are delivered");
+        {
+            Parameter::Ptr a = new TestParameter (0);
+            Parameter::Ptr b = new TestParameter (1);
+            Counter first (a), second (a), other (b);
+            a->setValueNotifyingHost (0.25f);
+            dispatcher->dispatchPendingChanges();
+            expectEquals (first.count, 1);
+            expectEquals (second.count, 1);
+            expectEquals (other.count, 0);
+        }
+
+        beginTest ("node parameters share the node's changes");
+        {
+            GraphProcessor graph;
+            graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+            graph.prepareToPlay (44100.0, 512);
+            GraphNodePtr node = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            const auto& params = node->getParameters();
+            expect (params.size() > 0);
+
+            OwnedArray<Counter> counters;
+            for (auto* param : params)
+                counters.add (new Counter (param));
+            params.getFirst()->setValueNotifyingHost (0.5f);
+            dispatcher->dispatchPendingChanges();
+            expectEquals (counters.getFirst()->count, 1);
+            for (int i = 1; i < counters.size(); ++i)
+                expectEquals (counters[i]->count, 0);
+
+            counters.clear();
+            node = nullptr;
+            graph.clear();
+        }
+
+        beginTest ("listeners come and go while another thread sets");
+        {
+            Parameter::Ptr param = new TestParameter (0);
+            Setter setter (*param, -1);
+            setter.startThread();
+
+            for (int i = 0; i < 1000; ++i)
+            {
+                Listener listener;
+                param->addListener (&listener);
+                Thread::yield();
+                param->removeListener (&listener);
+
+                const int heard = listener.count.load();
+                Thread::yield();
+                expectEquals (listener.count.load(), heard);
+            }
+
+            setter.stopThread (2000);
+            expect (setter.numSets > 0);
+        }
+    }
+
+private:
+    class TestParameter : public Parameter
+    {
+    public:
+        explicit TestParameter (int i) : index (i) { }
+        int getPortIndex() const noexcept override                  { return index; }
+        int getParameterIndex() const noexcept override             { return index; }
+        float getValue() const override                             { return value.load(); }
+        void setValue (float newValue) override                     { value.store (newValue); }
+        float getDefaultValue() const override                      { return 0.f; }
+        float getValueForText (const String& text) const override   { return text.getFloatValue(); }
+        String getName (int) const override                         { return "Test"; }
+        String getLabel() const override                            { return {}; }
+
+    private:
+        const int index;
+        std::atomic<float> value { 0.f };
+    };
+
+    struct Counter : public ParameterListener
+    {
+        Counter (Parameter::Ptr p) : ParameterListener (p) { }
+        void handleNewParameterValue() override { ++count; }
+        int count = 0;
+    };
+
+    struct Listener : public Parameter::Listener
+    {
+        void controlValueChanged (int, float) override { ++count; }
+        void controlTouched (int, bool) override { }
+        std::atomic<int> count { 0 };
+    };
+
+    /** Sets a parameter a number of times, or until stopped if negative */
+    struct Setter : public Thread
+    {
+        Setter (Parameter& p, int n) : Thread ("Setter"), param (p), numToSet (n) { }
+
+        void run() override
+        {
+            while (! threadShouldExit() && (numToSet < 0 || numSets < numToSet))
+            {
+                param.setValueNotifyingHost ((float) (numSets % 100) / 100.f);
+                ++numSets;
+            }
+        }
+
+        Parameter& param;
+        const int numToSet;
+        std::atomic<int> numSets { 0 };
+    };
+};
+
+static ParameterDispatchTest sParameterDispatchTest;
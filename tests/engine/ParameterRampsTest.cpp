@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/ParameterRamps.h"
+
+namespace Element {
+
+class ParameterRampsTest : public UnitTestBase
+{
+public:
+    ParameterRampsTest() : UnitTestBase ("Parameter Ramps", "engine", "parameterRamps") { }
+    virtual ~ParameterRampsTest() { }
+
+    void runTest() override
+    {
+        testLinear();
+        testOnePole();
+        testReplaceAndFull();
+    }
+
+private:
+    void testLinear()
+    {
+        beginTest ("linear");
+        ParameterRamps ramps;
+        expect (ramps.start (3, 0.f, 1.f, ParameterRamps::linear, 100));
+        expect (ramps.isActive());
+
+        float value = -1.f;
+        auto set = [&value] (int parameter, float v) { if (parameter == 3) value = v; };
+        ramps.advance (25, set);
+        expectWithinAbsoluteError (value, 0.25f, 0.0001f);
+        ramps.advance (50, set);
+        expectWithinAbsoluteError (value, 0.75f, 0.0001f);
+        ramps.advance (50, set);
+        expectEquals (value, 1.f, "ramps should land on their target");
+        expect (! ramps.isActive());
+    }
+
+    void testOnePole()
+    {
+        beginTest ("one pole");
+        ParameterRamps ramps;
+        expect (ramps.start (0, 1.f, 0.f, ParameterRamps::onePole, 100));
+
+        float value = 1.f;
+        auto set = [&value] (int, float v) { value = v; };
+        ramps.advance (100, set);
+        expectWithinAbsoluteError (value, std::exp (-1.f), 0.001f);
+
+        int numSteps = 0;
+        while (ramps.isActive() && ++numSteps < 1000)
+            ramps.advance (32, set);
+        expect (! ramps.isActive(), "one pole ramps should settle");
+        expectEquals (value, 0.f);
+    }
+
+    void testReplaceAndFull()
+    {
+        beginTest ("replace and full");
+        ParameterRamps ramps;
+        expect (! ramps.start (0, 0.5f, 0.5f, ParameterRamps::linear, 100), "nothing to glide");
+        expect (! ramps.start (0, 0.f, 1.f, ParameterRamps::none, 100));
+        expect (! ramps.start (0, 0.f, 1.f, ParameterRamps::linear, 0));
+
+        expect (ramps.start (0, 0.f, 1.f, ParameterRamps::linear, 100));
+        expect (ramps.start (0, 0.5f, 0.f, ParameterRamps::linear, 100));
+        expectEquals (ramps.size(), 1, "a new ramp replaces the parameter's old one");
+
+        for (int i = 1; i < ParameterRamps::maxRamps; ++i)
+            expect (ramps.start (i, 0.f, 1.f, ParameterRamps::linear, 100));
+        expect (! ramps.start (ParameterRamps::maxRamps, 0.f, 1.f, ParameterRamps::linear, 100));
+
+        ramps.cancel (0);
+        expectEquals (ramps.size(), (int) ParameterRamps::maxRamps - 1);
+        ramps.clear();
+        expect (! ramps.isActive());
+    }
+};
+
+static ParameterRampsTest sParameterRampsTest;
+
+}
@@ -0,0 +1,136 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/ParameterRamps.h"
+
+namespace Element {
+
+class ParameterSplitTest : public UnitTestBase
+{
+public:
+    ParameterSplitTest() : UnitTestBase ("Sample Accurate Parameters", "engine", "parameterSplit") { }
+    virtual ~ParameterSplitTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (0, 1, sampleRate, blockSize);
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        auto* source = new LevelSource();
+        GraphNodePtr node = graph.addNode (source);
+        graph.prepareToPlay (sampleRate, blockSize);
+        node->connectAudioTo (output);
+        graph.prepareToPlay (sampleRate, blockSize);
+        expectEquals (node->getParameters().size(), 1);
+
+        AudioSampleBuffer audio (1, blockSize);
+        MidiBuffer midi;
+
+        beginTest ("unsplit without changes");
+        render (graph, audio, midi);
+        expectEquals (source->numCalls, 1);
+        expectEquals (audio.getSample (0, blockSize - 1), 0.f);
+
+        beginTest ("untimed changes apply at the start");
+        source->numCalls = 0;
+        node->scheduleParameterChange (0, 0.5f);
+        render (graph, audio, midi);
+        expectEquals (source->numCalls, 1);
+        expectWithinAbsoluteError (audio.getSample (0, 0), 0.5f, 0.001f);
+
+        beginTest ("timed changes split the block");
+        source->numCalls = 0;
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+        node->scheduleParameterChange (0, 1.f, now - 128.0 / sampleRate);
+        render (graph, audio, midi);
+        expectEquals (source->numCalls, 2);
+        expectWithinAbsoluteError (audio.getSample (0, 64), 0.5f, 0.001f);
+        expectWithinAbsoluteError (audio.getSample (0, blockSize - 1), 1.f, 0.001f);
+
+        beginTest ("smoothed changes glide");
+        source->numCalls = 0;
+        node->scheduleParameterChange (0, 0.f, 0.0, ParameterRamps::linear, (float) (128.0 / sampleRate));
+        render (graph, audio, midi);
+        expectEquals (source->numCalls, 5, "four steps to the value, then the rest unsplit");
+        expectWithinAbsoluteError (audio.getSample (0, 0), 0.75f, 0.001f);
+        expectWithinAbsoluteError (audio.getSample (0, 40), 0.5f, 0.001f);
+        expectWithinAbsoluteError (audio.getSample (0, blockSize - 1), 0.f, 0.001f);
+
+        source->numCalls = 0;
+        render (graph, audio, midi);
+        expectEquals (source->numCalls, 1, "finished ramps shouldn't split the block");
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr double sampleRate = 44100.0;
+
+    /** Outputs its one parameter as a constant level */
+    class LevelSource : public BaseProcessor
+    {
+    public:
+        LevelSource()
+            : BaseProcessor (BusesProperties().withOutput ("Main", AudioChannelSet::mono(), true))
+        {
+            addParameter (level = new AudioParameterFloat ("level", "Level", 0.f, 1.f, 0.f));
+        }
+
+        int numCalls = 0;
+        AudioParameterFloat* level = nullptr;
+
+        const String getName() const override { return "Level Source"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            ++numCalls;
+            FloatVectorOperations::fill (buffer.getWritePointer (0), level->get(), buffer.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+
+    static void render (GraphProcessor& graph, AudioSampleBuffer& audio, MidiBuffer& midi)
+    {
+        audio.clear();
+        midi.clear();
+        graph.processBlock (audio, midi);
+    }
+};
+
+static ParameterSplitTest sParameterSplitTest;
+
+}
@@ -0,0 +1,130 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class PipelineRenderTest : public UnitTestBase
+{
+public:
+    PipelineRenderTest() : UnitTestBase ("Pipelined Rendering", "engine", "pipeline") { }
+    virtual ~PipelineRenderTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        graph.prepareToPlay (44100.0, blockSize);
+
+        GraphNodePtr last = input;
+        for (int i = 0; i < 4; ++i)
+        {
+            GraphNodePtr half = graph.addNode (new HalfProcessor());
+            last->connectAudioTo (half);
+            last = half;
+        }
+        last->connectAudioTo (output);
+        graph.handleUpdateNowIfNeeded();
+
+        beginTest ("serial");
+        expectEquals (graph.getLatencySamples(), 0);
+        expectWithinAbsoluteError (render (graph, 1.f), 1.f / 16.f, 1.0e-6f);
+
+        beginTest ("a block late per cut");
+        graph.setPipelineStages (3);
+        graph.handleUpdateNowIfNeeded();
+        expectEquals ((int) graph.getRenderProgramInfo()["pipelineStages"], 3);
+        expectEquals (graph.getLatencySamples(), 2 * blockSize);
+        render (graph, 0.f);
+        render (graph, 0.f);
+        expectEquals (render (graph, 1.f), 0.f);
+        expectEquals (render (graph, 0.f), 0.f);
+        expectWithinAbsoluteError (render (graph, 0.f), 1.f / 16.f, 1.0e-6f);
+        expectEquals (render (graph, 0.f), 0.f);
+
+        beginTest ("shorter paths stay lined up");
+        input->connectAudioTo (output);
+        graph.handleUpdateNowIfNeeded();
+        expectEquals ((int) graph.getRenderProgramInfo()["pipelineStages"], 3);
+        render (graph, 0.f);
+        render (graph, 0.f);
+        render (graph, 1.f);
+        expectEquals (render (graph, 0.f), 0.f);
+        expectWithinAbsoluteError (render (graph, 0.f), 1.f + 1.f / 16.f, 1.0e-6f);
+
+        beginTest ("back to serial");
+        graph.setPipelineStages (1);
+        graph.handleUpdateNowIfNeeded();
+        expectEquals (graph.getLatencySamples(), 0);
+        expectWithinAbsoluteError (render (graph, 1.f), 1.f + 1.f / 16.f, 1.0e-6f);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static constexpr int blockSize = 128;
+
+    /** Renders a block filled with the value, returning the last sample of
+        the first channel */
+    static float render (GraphProcessor& graph, const float value)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        for (int ch = 0; ch < 2; ++ch)
+            FloatVectorOperations::fill (audio.getWritePointer (ch), value, blockSize);
+        graph.processBlock (audio, midi);
+        return audio.getSample (0, blockSize - 1);
+    }
+
+    class HalfProcessor : public BaseProcessor
+    {
+    public:
+        HalfProcessor()
+            : BaseProcessor (BusesProperties().withInput ("Main", AudioChannelSet::stereo(), true)
+                                              .withOutput ("Main", AudioChannelSet::stereo(), true)) { }
+
+        const String getName() const override { return "Half"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override { buffer.applyGain (0.5f); }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+};
+
+static PipelineRenderTest sPipelineRenderTest;
+
+}
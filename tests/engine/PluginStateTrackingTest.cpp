@@ -0,0 +1,97 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionArchive.h"
+
+namespace Element {
+
+class PluginStateTrackingTest : public UnitTestBase,
+                                private ValueTree::Listener
+{
+public:
+    PluginStateTrackingTest() : UnitTestBase ("Plugin State Tracking", "engine", "stateTracking") { }
+    virtual ~PluginStateTrackingTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        graph.prepareToPlay (44100.0, 512);
+        auto* volume = new VolumeProcessor (-60.0, 12.0, true);
+        GraphNodePtr obj = graph.addNode (volume);
+
+        Node node (Tags::node);
+        node.getValueTree().setProperty (Tags::object, obj.get(), nullptr);
+        node.getValueTree().addListener (this);
+
+        beginTest ("first save");
+        node.savePluginState();
+        expectEquals (numStateWrites, 1);
+        expect (! obj->hasStateChanged());
+
+        beginTest ("unchanged state isn't written again");
+        node.savePluginState();
+        expectEquals (numStateWrites, 1);
+
+        beginTest ("parameter changes mark the state");
+        auto* param = volume->getParameters().getFirst();
+        param->setValueNotifyingHost (param->getValue() > 0.5f ? 0.1f : 0.9f);
+        expect (obj->hasStateChanged());
+        node.savePluginState();
+        expectEquals (numStateWrites, 2);
+        expect (! obj->hasStateChanged());
+
+        beginTest ("copies take binary state and leave tracking alone");
+        param->setValueNotifyingHost (param->getValue() > 0.5f ? 0.2f : 0.8f);
+        Node copy (node.getValueTree().createCopy());
+        copy.savePluginStateForCopy();
+        expect (copy.getValueTree().getProperty (Tags::state).isBinaryData());
+        expect (obj->hasStateChanged());
+        MemoryBlock copied, live;
+        expect (SessionArchive::readState (copy.getValueTree(), Tags::state, copied));
+        volume->getStateInformation (live);
+        expect (copied == live);
+        node.savePluginState();
+        expectEquals (numStateWrites, 3);
+
+        node.getValueTree().removeListener (this);
+        node.getValueTree().removeProperty (Tags::object, nullptr);
+        obj = nullptr;
+        graph.clear();
+    }
+
+private:
+    int numStateWrites = 0;
+
+    void valueTreePropertyChanged (ValueTree&, const Identifier& property) override
+    {
+        if (property == Tags::state)
+            ++numStateWrites;
+    }
+
+    void valueTreeChildAdded (ValueTree&, ValueTree&) override { }
+    void valueTreeChildRemoved (ValueTree&, ValueTree&, int) override { }
+    void valueTreeChildOrderChanged (ValueTree&, int, int) override { }
+    void valueTreeParentChanged (ValueTree&) override { }
+    void valueTreeRedirected (ValueTree&) override { }
+};
+
+static PluginStateTrackingTest sPluginStateTrackingTest;
+
+}
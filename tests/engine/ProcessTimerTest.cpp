@@ -0,0 +1,100 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/ProcessTimer.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class ProcessTimerTest : public UnitTestBase
+{
+public:
+    ProcessTimerTest() : UnitTestBase ("Process Timer", "engine", "processTimer") { }
+    virtual ~ProcessTimerTest() { }
+
+    void runTest() override
+    {
+        testTimer();
+        testNodeProfiling();
+    }
+
+private:
+    void testTimer()
+    {
+        beginTest ("block times");
+        ProcessTimer timer;
+        timer.prepare (48000.0);
+
+        // a 10ms block that started 10ms ago
+        timer.addBlock (ProcessTimer::now() - Time::getHighResolutionTicksPerSecond() / 100, 480);
+        auto reading = timer.getReading();
+        expectGreaterOrEqual (reading.lastMs, 9.9);
+        expectEquals (reading.averageMs, reading.lastMs);
+        expectEquals (reading.maximumMs, reading.lastMs);
+        expectGreaterOrEqual (reading.load, 0.99, "the block took about as long as its duration");
+
+        timer.addBlock (ProcessTimer::now(), 480);
+        reading = timer.getReading();
+        expect (reading.lastMs < reading.averageMs && reading.averageMs < reading.maximumMs,
+                "a quick block should lower the average but not the maximum");
+
+        timer.reset();
+        timer.addBlock (ProcessTimer::now(), 480);
+        reading = timer.getReading();
+        expectEquals (reading.maximumMs, reading.lastMs);
+    }
+
+    void testNodeProfiling()
+    {
+        beginTest ("nodes are timed while profiled");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        graph.prepareToPlay (44100.0, 512);
+        input->connectAudioTo (volume);
+        volume->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, 512);
+
+        AudioSampleBuffer audio (2, 512);
+        MidiBuffer midi;
+        audio.clear();
+
+        expect (! volume->isProfiling());
+        graph.processBlock (audio, midi);
+        expectEquals (volume->getProcessTime().lastMs, 0.0);
+
+        volume->addProfileSubscriber();
+        expect (volume->isProfiling());
+        graph.processBlock (audio, midi);
+        expectGreaterThan (volume->getProcessTime().lastMs, 0.0);
+        volume->removeProfileSubscriber();
+        expect (! volume->isProfiling());
+
+        graph.releaseResources();
+        graph.clear();
+    }
+};
+
+static ProcessTimerTest sProcessTimerTest;
+
+}
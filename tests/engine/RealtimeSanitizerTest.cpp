@@ -0,0 +1,77 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/RealtimeSanitizer.h"
+
+namespace Element {
+
+class RealtimeSanitizerTest : public UnitTestBase
+{
+public:
+    RealtimeSanitizerTest() : UnitTestBase ("Realtime Sanitizer", "engine", "rtsan") { }
+    virtual ~RealtimeSanitizerTest() { }
+
+    void runTest() override
+    {
+        beginTest ("unmarked threads");
+        expect (! RealtimeSanitizer::isRealtimeThread());
+        int before = RealtimeSanitizer::getNumViolations();
+        std::unique_ptr<MemoryBlock> block (new MemoryBlock (1024));
+        expectEquals (RealtimeSanitizer::getNumViolations(), before);
+
+       #if EL_RTSAN && JUCE_LINUX
+        beginTest ("allocations");
+        {
+            RealtimeSanitizer::ScopedRealtime realtime;
+            expect (RealtimeSanitizer::isRealtimeThread());
+            block.reset();
+        }
+        expect (RealtimeSanitizer::getNumViolations() > before, "freeing on a marked thread wasn't seen");
+
+        beginTest ("locks");
+        CriticalSection lock;
+        before = RealtimeSanitizer::getNumViolations();
+        {
+            RealtimeSanitizer::ScopedRealtime realtime;
+            const ScopedLock sl (lock);
+        }
+        expect (RealtimeSanitizer::getNumViolations() > before, "locking on a marked thread wasn't seen");
+
+        beginTest ("allowed");
+        before = RealtimeSanitizer::getNumViolations();
+        {
+            RealtimeSanitizer::ScopedRealtime realtime;
+            RealtimeSanitizer::ScopedAllow allow;
+            expect (! RealtimeSanitizer::isRealtimeThread());
+            block.reset (new MemoryBlock (1024));
+        }
+        expectEquals (RealtimeSanitizer::getNumViolations(), before);
+       #else
+        beginTest ("disabled");
+        {
+            RealtimeSanitizer::ScopedRealtime realtime;
+            expect (! RealtimeSanitizer::isRealtimeThread(), "nothing is marked without EL_RTSAN");
+        }
+       #endif
+    }
+};
+
+static RealtimeSanitizerTest sRealtimeSanitizerTest;
+
+}
@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/RenderInspector.h"
+
+namespace Element {
+
+class RenderInspectorTest : public UnitTestBase
+{
+public:
+    RenderInspectorTest() : UnitTestBase ("Render Inspector", "engine", "renderInspector") { }
+    virtual ~RenderInspectorTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr latent = graph.addNode (new LatentProcessor());
+        graph.prepareToPlay (44100.0, 256);
+
+        // the dry path gets delayed to line up with the latent one
+        input->connectAudioTo (latent);
+        latent->connectAudioTo (output);
+        input->connectAudioTo (output);
+        graph.handleUpdateNowIfNeeded();
+
+        beginTest ("describes ops in render order");
+        const auto info = graph.getRenderProgramInfo();
+        expectEquals ((int) info["latency"], 100);
+        expect (info["ops"].size() > 0);
+        expectEquals (count (info, "process"), 3);
+        expectEquals (count (info, "delay"), 1);
+        expectEquals (info["order"].size(), 3);
+        expect ((int) info["order"][0] == (int) input->nodeId);
+        expect ((int) info["order"][2] == (int) output->nodeId);
+
+        beginTest ("export formats");
+        const auto json = RenderInspector::toJSON (info);
+        expect (JSON::parse (json)["ops"].size() == info["ops"].size());
+        const auto dot = RenderInspector::toDot (info);
+        expect (dot.startsWith ("digraph"));
+        expect (dot.contains ("Latent"));
+        expect (dot.trimEnd().endsWith ("}"));
+
+        beginTest ("cleared graphs describe nothing");
+        graph.releaseResources();
+        graph.clear();
+        expectEquals (graph.getRenderProgramInfo()["ops"].size(), 0);
+    }
+
+private:
+    static int count (const var& info, const String& type)
+    {
+        int found = 0;
+        if (auto* ops = info["ops"].getArray())
+            for (const auto& op : *ops)
+                if (op["op"].toString() == type)
+                    ++found;
+        return found;
+    }
+
+    class LatentProcessor : public BaseProcessor
+    {
+    public:
+        LatentProcessor()
+            : BaseProcessor (BusesProperties().withInput ("Main", AudioChannelSet::stereo(), true)
+                                              .withOutput ("Main", AudioChannelSet::stereo(), true))
+        {
+            setLatencySamples (100);
+        }
+
+        const String getName() const override { return "Latent"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+        void processBlock (AudioSampleBuffer&, MidiBuffer&) override { }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+};
+
+static RenderInspectorTest sRenderInspectorTest;
+
+}
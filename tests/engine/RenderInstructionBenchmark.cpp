@@ -0,0 +1,177 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/RenderInstruction.h"
+
+namespace Element {
+
+/** Compares the flat instruction array against heap allocated, virtually
+    dispatched ops like the ones rendering sequences used to be made of. */
+class RenderInstructionBenchmark : public UnitTestBase
+{
+public:
+    RenderInstructionBenchmark() : UnitTestBase ("Render Instruction Benchmark", "engine", "renderInstructions") { }
+    virtual ~RenderInstructionBenchmark() { }
+
+    void runTest() override
+    {
+        beginTest ("32 sample blocks");
+        createSequence();
+
+        AudioSampleBuffer virtualAudio (numBuffers, blockSize);
+        AudioSampleBuffer compiledAudio (numBuffers, blockSize);
+        OwnedArray<MidiBuffer> midi;
+        midi.add (new MidiBuffer());
+
+        fillInputs (virtualAudio);
+        fillInputs (compiledAudio);
+
+        // nothing is known to be silent up front
+        HeapBlock<uint8> silence;
+        silence.calloc ((size_t) numBuffers);
+
+        const auto virtualStart = Time::getMillisecondCounterHiRes();
+        for (int block = 0; block < numBlocks; ++block)
+            for (auto* op : virtualOps)
+                op->perform (virtualAudio, blockSize);
+        const auto virtualTime = Time::getMillisecondCounterHiRes() - virtualStart;
+
+        const auto compiledStart = Time::getMillisecondCounterHiRes();
+        for (int block = 0; block < numBlocks; ++block)
+            GraphRender::renderInstructions (code.getData(), code.getData() + numOps,
+                                             compiledAudio, midi, blockSize, silence);
+        const auto compiledTime = Time::getMillisecondCounterHiRes() - compiledStart;
+
+        logMessage ("virtual ops:  " + String (virtualTime, 3) + " ms");
+        logMessage ("instructions: " + String (compiledTime, 3) + " ms");
+
+        bool identical = true;
+        for (int ch = 0; ch < numBuffers; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                if (virtualAudio.getSample (ch, i) != compiledAudio.getSample (ch, i))
+                    identical = false;
+        expect (identical, "compiled output differs");
+
+        testSilenceFlags();
+    }
+
+    void testSilenceFlags()
+    {
+        beginTest ("silence flags");
+        AudioSampleBuffer audio (4, blockSize);
+        OwnedArray<MidiBuffer> midi;
+        audio.clear();
+        audio.setSample (1, 0, 1.f);
+
+        uint8 silence[4] = { 1, 0, 1, 1 };
+        GraphRender::Instruction program[3];
+        program[0].opcode = GraphRender::Instruction::copyAudio;
+        program[0].source = 0; program[0].dest = 3;
+        program[1].opcode = GraphRender::Instruction::addAudio;
+        program[1].source = 1; program[1].dest = 2;
+        program[2].opcode = GraphRender::Instruction::clearAudio;
+        program[2].dest   = 1;
+
+        GraphRender::renderInstructions (program, program + 3, audio, midi, blockSize, silence);
+        expect (silence[3] == 1, "copy of silence should be silent");
+        expect (silence[2] == 0, "adding audio should make a buffer audible");
+        expect (silence[1] == 1, "cleared buffers should be silent");
+        expectEquals (audio.getSample (2, 0), 1.f);
+    }
+
+private:
+    static constexpr int numBuffers = 32;
+    static constexpr int numOps     = 512;
+    static constexpr int numBlocks  = 20000;
+    static constexpr int blockSize  = 32;
+
+    struct VirtualOp
+    {
+        virtual ~VirtualOp() { }
+        virtual void perform (AudioSampleBuffer&, int) = 0;
+    };
+
+    struct ClearOp : public VirtualOp
+    {
+        ClearOp (int d) : dst (d) { }
+        void perform (AudioSampleBuffer& b, int n) override { b.clear (dst, 0, n); }
+        const int dst;
+    };
+
+    struct CopyOp : public VirtualOp
+    {
+        CopyOp (int s, int d) : src (s), dst (d) { }
+        void perform (AudioSampleBuffer& b, int n) override { b.copyFrom (dst, 0, b, src, 0, n); }
+        const int src, dst;
+    };
+
+    struct AddOp : public VirtualOp
+    {
+        AddOp (int s, int d) : src (s), dst (d) { }
+        void perform (AudioSampleBuffer& b, int n) override { b.addFrom (dst, 0, b, src, 0, n); }
+        const int src, dst;
+    };
+
+    OwnedArray<VirtualOp> virtualOps;
+    HeapBlock<GraphRender::Instruction> code;
+
+    void createSequence()
+    {
+        Random rand (1234);
+        virtualOps.clearQuick (true);
+        code.calloc ((size_t) numOps);
+
+        for (int i = 0; i < numOps; ++i)
+        {
+            // buffer 0 is an input that is never written, like the graph's silence buffer
+            const int src = rand.nextInt (numBuffers);
+            const int dst = 1 + rand.nextInt (numBuffers - 1);
+            auto& instruction = code[i];
+            instruction.source = src;
+            instruction.dest   = dst;
+
+            switch (rand.nextInt (4))
+            {
+                case 0:
+                    virtualOps.add (new ClearOp (dst));
+                    instruction.opcode = GraphRender::Instruction::clearAudio;
+                    break;
+                case 1:
+                    virtualOps.add (new CopyOp (src, dst));
+                    instruction.opcode = GraphRender::Instruction::copyAudio;
+                    break;
+                default:
+                    virtualOps.add (new AddOp (src, dst));
+                    instruction.opcode = GraphRender::Instruction::addAudio;
+                    break;
+            }
+        }
+    }
+
+    static void fillInputs (AudioSampleBuffer& audio)
+    {
+        audio.clear();
+        for (int i = 0; i < blockSize; ++i)
+            audio.setSample (0, i, 0.001f * (float) i);
+    }
+};
+
+static RenderInstructionBenchmark sRenderInstructionBenchmark;
+
+}
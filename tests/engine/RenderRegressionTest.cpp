@@ -0,0 +1,76 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/RenderRegression.h"
+
+namespace Element {
+
+class RenderRegressionTest : public UnitTestBase
+{
+public:
+    RenderRegressionTest() : UnitTestBase ("Render Regression", "engine", "renderRegression") { }
+    virtual ~RenderRegressionTest() { }
+
+    void runTest() override
+    {
+        RenderRegression::Options options;
+        options.numBlocks = 64;
+        options.numRuns = 1;
+        RenderRegression regression (options);
+
+        beginTest ("schedulers render the same output");
+        regression.run();
+        expectEquals (regression.getOutcomes().size(),
+                      RenderRegression::getSessionNames().size() * (int) RenderRegression::numSchedulers);
+        for (const auto& outcome : regression.getOutcomes())
+            expect (outcome.hash.isNotEmpty(), outcome.session + " didn't render");
+        const auto nondeterministic = regression.getNondeterministicSessions();
+        expect (nondeterministic.isEmpty(), "differing output: " + nondeterministic.joinIntoString (", "));
+
+        beginTest ("unknown sessions");
+        expect (regression.render ("missing", RenderRegression::serialScheduler).hash.isEmpty());
+
+        beginTest ("baselines");
+        const auto report = JSON::parse (JSON::toString (regression.createReport()));
+        regression.compareWithBaseline (report);
+        expectEquals (regression.getNumChanges(), 0);
+
+        // a baseline twice as fast flags everything measurable
+        if (auto* results = report["results"].getArray())
+            for (auto& result : *results)
+                if (auto* obj = result.getDynamicObject())
+                    obj->setProperty ("msPerBlock", (double) result["msPerBlock"] * 0.5);
+        regression.compareWithBaseline (report);
+        int measured = 0;
+        for (const auto& outcome : regression.getOutcomes())
+            if (outcome.msPerBlock > 0.0)
+                ++measured;
+        expectEquals (regression.getNumSlowdowns(), measured);
+
+        // reports of another block size are not compared
+        if (auto* obj = report.getDynamicObject())
+            obj->setProperty ("blockSize", options.blockSize * 2);
+        regression.compareWithBaseline (report);
+        expectEquals (regression.getNumSlowdowns(), 0);
+    }
+};
+
+static RenderRegressionTest sRenderRegressionTest;
+
+}
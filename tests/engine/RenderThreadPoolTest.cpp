@@ -0,0 +1,270 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/RenderThreadPool.h"
+
+namespace Element {
+
+class RenderThreadPoolTest : public UnitTestBase
+{
+public:
+    RenderThreadPoolTest() : UnitTestBase ("RenderThreadPool", "engine", "renderThreadPool") { }
+    virtual ~RenderThreadPoolTest() { }
+
+    void runTest() override
+    {
+        testSerial();
+        testDependencies();
+        testThreadOptions();
+        testCriticalPath();
+        testNested();
+    }
+
+private:
+    /** A diamond shaped job: 0 -> (1, 2) -> 3, repeated in chains */
+    class DiamondJob : public RenderJob
+    {
+    public:
+        DiamondJob (int numDiamonds)
+        {
+            setNumStages (numDiamonds * 4);
+            for (int d = 0; d < numDiamonds; ++d)
+            {
+                const int base = d * 4;
+                addDependency (base, base + 1);
+                addDependency (base, base + 2);
+                addDependency (base + 1, base + 3);
+                addDependency (base + 2, base + 3);
+                if (d > 0)
+                    addDependency (base - 1, base);
+            }
+
+            order.calloc ((size_t) getNumStages());
+        }
+
+        void reset()
+        {
+            counter.store (0);
+            for (int i = 0; i < getNumStages(); ++i)
+                order[i] = -1;
+        }
+
+        bool isOrderValid() const
+        {
+            for (int i = 0; i < getNumStages(); i += 4)
+            {
+                if (order[i] < 0 || order[i + 1] < 0 || order[i + 2] < 0 || order[i + 3] < 0)
+                    return false;
+                if (order[i] > order[i + 1] || order[i] > order[i + 2])
+                    return false;
+                if (order[i + 1] > order[i + 3] || order[i + 2] > order[i + 3])
+                    return false;
+                if (i > 0 && order[i - 1] > order[i])
+                    return false;
+            }
+            return true;
+        }
+
+    protected:
+        void renderStage (int stage) noexcept override
+        {
+            order[stage] = counter.fetch_add (1);
+        }
+
+    private:
+        std::atomic<int> counter { 0 };
+        HeapBlock<int> order;
+    };
+
+    /** A light stage 0 feeding stage 2, next to a heavy stage 1 alone */
+    class UnevenJob : public RenderJob
+    {
+    public:
+        UnevenJob()
+        {
+            setNumStages (3);
+            addDependency (0, 2);
+            order.ensureStorageAllocated (3);
+        }
+
+        Array<int> order;
+
+    protected:
+        void renderStage (int stage) noexcept override
+        {
+            order.add (stage);
+            if (stage == 1)
+            {
+                const auto until = Time::getMillisecondCounterHiRes() + 2.0;
+                while (Time::getMillisecondCounterHiRes() < until) {}
+            }
+        }
+    };
+
+    /** Independent stages that each render a job of their own on the same
+        pool, the way parallel root graphs render multi-core graph programs */
+    class NestedJob : public RenderJob
+    {
+    public:
+        NestedJob (RenderThreadPool& p, int numStages)
+            : pool (p)
+        {
+            setNumStages (numStages);
+            for (int i = 0; i < numStages; ++i)
+                inner.add (new DiamondJob (4));
+        }
+
+        void reset()
+        {
+            for (auto* job : inner)
+                job->reset();
+        }
+
+        bool isOrderValid() const
+        {
+            for (const auto* job : inner)
+                if (! job->isOrderValid())
+                    return false;
+            return true;
+        }
+
+    protected:
+        void renderStage (int stage) noexcept override
+        {
+            pool.render (*inner.getUnchecked (stage));
+        }
+
+    private:
+        RenderThreadPool& pool;
+        OwnedArray<DiamondJob> inner;
+    };
+
+    void testNested()
+    {
+        beginTest ("nested jobs");
+        RenderThreadPool pool;
+        pool.setNumWorkers (3);
+        NestedJob job (pool, 6);
+
+        struct Renderer : public Thread
+        {
+            Renderer (RenderThreadPool& p, NestedJob& j)
+                : Thread ("el.test.nested"), pool (p), job (j) { }
+
+            void run() override
+            {
+                for (int i = 0; i < 200; ++i)
+                {
+                    job.reset();
+                    pool.render (job);
+                    valid &= job.isOrderValid();
+                }
+            }
+
+            RenderThreadPool& pool;
+            NestedJob& job;
+            bool valid = true;
+        } renderer (pool, job);
+
+        // a deadlock leaves the renderer stuck, so it's never waited on forever
+        renderer.startThread();
+        expect (renderer.waitForThreadToExit (10000), "nested renders should not deadlock");
+        expect (renderer.valid);
+        expect (! pool.isRenderingThread());
+    }
+
+    void testCriticalPath()
+    {
+        beginTest ("critical path first");
+        RenderThreadPool pool;
+        pool.setNumWorkers (0);
+        UnevenJob job;
+
+        // untimed, the longer chain goes first and runs straight through
+        pool.render (job);
+        expectEquals (job.order, Array<int> ({ 0, 2, 1 }));
+        expectGreaterThan (job.getStageCost (1), job.getStageCost (0) + job.getStageCost (2));
+
+        // once timed, the heavy stage is the longest path
+        job.order.clearQuick();
+        pool.render (job);
+        expectEquals (job.order.getFirst(), 1);
+        expectGreaterThan (job.getStagePriority (1), job.getStagePriority (0));
+    }
+
+    void testSerial()
+    {
+        beginTest ("serial");
+        RenderThreadPool pool;
+        pool.setNumWorkers (0);
+        DiamondJob job (8);
+        job.reset();
+        pool.render (job);
+        expect (job.isOrderValid());
+    }
+
+    void testDependencies()
+    {
+        beginTest ("dependencies");
+        RenderThreadPool pool;
+        pool.setNumWorkers (3);
+        expectEquals (pool.getNumWorkers(), 3);
+        DiamondJob job (16);
+
+        for (int i = 0; i < 200; ++i)
+        {
+            job.reset();
+            pool.render (job);
+            expect (job.isOrderValid());
+        }
+
+        expect (! pool.isWorkerThread());
+        pool.setNumWorkers (0);
+        expectEquals (pool.getNumWorkers(), 0);
+    }
+
+    void testThreadOptions()
+    {
+        beginTest ("thread options");
+        RenderThreadPool pool;
+        pool.setNumWorkers (2);
+        pool.setThreadOptions (true, true);
+        expectEquals (pool.getNumWorkers(), 2, "workers should restart with the new options");
+
+        // whether the system allows it depends on privileges, but it
+        // can never be more than the workers there are
+        Thread::sleep (50);
+        expect (pool.getNumRealtimeWorkers() <= 2);
+        expect (pool.getNumPinnedWorkers() <= 2);
+
+        DiamondJob job (4);
+        job.reset();
+        pool.render (job);
+        expect (job.isOrderValid());
+
+        pool.setThreadOptions (false, false);
+        Thread::sleep (50);
+        expectEquals (pool.getNumRealtimeWorkers(), 0);
+        expectEquals (pool.getNumPinnedWorkers(), 0);
+    }
+};
+
+static RenderThreadPoolTest sRenderThreadPoolTest;
+
+}
@@ -0,0 +1,78 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/PlaceholderProcessor.h"
+
+namespace Element {
+
+class ReplaceNodeTest : public UnitTestBase
+{
+public:
+    ReplaceNodeTest() : UnitTestBase ("Replace Node", "engine", "replaceNode") { }
+    virtual ~ReplaceNodeTest() { }
+
+    void runTest() override
+    {
+        beginTest ("placeholder swapped for a processor");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        graph.prepareToPlay (44100.0, 512);
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr placeholder = graph.addNode (new PlaceholderProcessor (2, 2, false, false));
+        input->connectAudioTo (placeholder);
+        placeholder->connectAudioTo (output);
+        expectEquals (graph.getNumConnections(), 4);
+
+        const auto nodeId = placeholder->nodeId;
+        const int index = graph.getNumNodes() - 1;
+        GraphNodePtr volume = graph.replaceNode (placeholder.get(), new VolumeProcessor (-60.0, 12.0, true));
+        expect (volume != nullptr);
+        expect (volume != placeholder);
+        expectEquals (volume->nodeId, nodeId, "the replacement keeps the node ID");
+        expect (graph.getNode (index) == volume.get(), "the replacement keeps the node's place");
+        expect (graph.getNodeForId (nodeId) == volume.get());
+        expect (placeholder->getParentGraph() == nullptr);
+        expectEquals (graph.getNumConnections(), 4, "connections the new ports allow are kept");
+
+        AudioSampleBuffer audio (2, 512);
+        MidiBuffer midi;
+        audio.clear();
+        graph.processBlock (audio, midi);
+
+        beginTest ("connections that no longer fit are dropped");
+        GraphNodePtr mono = graph.replaceNode (volume.get(), new PlaceholderProcessor (1, 1, false, false));
+        expect (mono != nullptr);
+        expectEquals (graph.getNumConnections(), 1);
+        graph.processBlock (audio, midi);
+
+        beginTest ("nodes from other graphs");
+        GraphProcessor other;
+        std::unique_ptr<PlaceholderProcessor> unused (new PlaceholderProcessor());
+        expect (other.replaceNode (mono.get(), unused.get()) == nullptr);
+
+        graph.clear();
+    }
+};
+
+static ReplaceNodeTest sReplaceNodeTest;
+
+}
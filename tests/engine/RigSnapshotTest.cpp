@@ -0,0 +1,208 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/RigSnapshot.h"
+
+using namespace Element;
+
+//=============================================================================
+class RigSnapshotTest : public UnitTestBase
+{
+public:
+    RigSnapshotTest()
+        : UnitTestBase ("Rig Snapshot", "engine", "rigSnapshot") { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, 512);
+        graph.prepareToPlay (44100.0, 512);
+        auto* firstVolume  = new VolumeProcessor (-60.0, 12.0, true);
+        auto* secondVolume = new VolumeProcessor (-60.0, 12.0, true);
+        GraphNodePtr first  = graph.addNode (firstVolume);
+        GraphNodePtr second = graph.addNode (secondVolume);
+
+        beginTest ("capture");
+        setVolume (*firstVolume, 0.25f);
+        setVolume (*secondVolume, 0.75f);
+        first->setGain (0.5f);
+        second->setMuted (true);
+        auto snapshot = RigSnapshot::capture (graph, "Verse");
+        expectEquals (snapshot->getName(), String ("Verse"));
+        expectEquals (snapshot->getNumNodes(), 2);
+        expect (snapshot->getSizeInBytes() > 0);
+
+        beginTest ("recall restores states and settings");
+        setVolume (*firstVolume, 0.9f);
+        setVolume (*secondVolume, 0.1f);
+        first->setGain (1.f);
+        second->setMuted (false);
+        expectEquals (snapshot->recall (graph), 2);
+        expectWithinAbsoluteError (getVolume (*firstVolume), 0.25f, 0.001f);
+        expectWithinAbsoluteError (getVolume (*secondVolume), 0.75f, 0.001f);
+        expectEquals (first->getGain(), 0.5f);
+        expect (second->isMuted());
+
+        beginTest ("recall leaves processors suspended only when bypassed");
+        first->suspendProcessing (true);
+        auto bypassedSnapshot = RigSnapshot::capture (graph, "Bridge");
+        first->suspendProcessing (false);
+        expectEquals (bypassedSnapshot->recall (graph), 2);
+        expect (first->isSuspended());
+        expect (firstVolume->isSuspended());
+        expect (! second->isSuspended());
+        expect (! secondVolume->isSuspended());
+        expectEquals (snapshot->recall (graph), 2);
+        expect (! first->isSuspended());
+        expect (! firstVolume->isSuspended());
+
+        beginTest ("removed nodes are skipped");
+        graph.removeNode (second->nodeId);
+        second = nullptr;
+        setVolume (*firstVolume, 0.9f);
+        auto recall = snapshot->prepare (graph);
+        expectEquals (recall.getNumNodes(), 1);
+        expectEquals (recall.apply(), 1);
+        expectWithinAbsoluteError (getVolume (*firstVolume), 0.25f, 0.001f);
+
+        first = nullptr;
+        graph.clear();
+
+        beginTest ("audio keeps flowing during a slow state load");
+        testSlowStateLoad();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    /** Plays a constant level, taking its time to load a new one */
+    class SlowStateSource : public BaseProcessor
+    {
+    public:
+        SlowStateSource()
+            : BaseProcessor (BusesProperties().withOutput ("Main", AudioChannelSet::stereo(), true)) { }
+
+        std::atomic<float> level { 0.f };
+
+        const String getName() const override { return "Slow State Source"; }
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                FloatVectorOperations::fill (buffer.getWritePointer (c), level.load(),
+                                             buffer.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+
+        void getStateInformation (juce::MemoryBlock& block) override
+        {
+            const float value = level.load();
+            block.replaceWith (&value, sizeof (value));
+        }
+
+        void setStateInformation (const void* data, int size) override
+        {
+            Thread::sleep (200);
+            if (size == (int) sizeof (float))
+                level.store (*static_cast<const float*> (data));
+        }
+
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+
+    /** Renders a graph until told to stop, counting the blocks that came out silent */
+    class RenderThread : public Thread
+    {
+    public:
+        RenderThread (GraphProcessor& g) : Thread ("el.rigSnapshot.render"), graph (g) { }
+
+        std::atomic<int> numBlocks { 0 }, numSilent { 0 };
+
+        void run() override
+        {
+            AudioSampleBuffer audio (2, blockSize);
+            MidiBuffer midi;
+            while (! threadShouldExit())
+            {
+                audio.clear();
+                midi.clear();
+                graph.processBlock (audio, midi);
+                if (audio.getMagnitude (0, 0, blockSize) <= 0.f)
+                    ++numSilent;
+                ++numBlocks;
+                Thread::sleep (1);
+            }
+        }
+
+    private:
+        GraphProcessor& graph;
+    };
+
+    void testSlowStateLoad()
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (0, 2, 44100.0, blockSize);
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        auto* source = new SlowStateSource();
+        GraphNodePtr node = graph.addNode (source);
+        node->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        source->level.store (0.5f);
+        auto snapshot = RigSnapshot::capture (graph, "Chorus");
+        source->level.store (0.25f);
+
+        RenderThread renderer (graph);
+        renderer.startThread();
+        while (renderer.numBlocks.load() < 10)
+            Thread::sleep (1);
+
+        const int blocksBefore = renderer.numBlocks.load();
+        expectEquals (snapshot->recall (graph), 2);
+        const int blocksDuring = renderer.numBlocks.load() - blocksBefore;
+        renderer.stopThread (1000);
+
+        expect (blocksDuring > 10, "the graph should render while the state loads");
+        expectEquals (renderer.numSilent.load(), 0);
+        expectEquals (source->level.load(), 0.5f);
+
+        node = output = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    static void setVolume (AudioProcessor& proc, float value)   { proc.getParameters().getFirst()->setValueNotifyingHost (value); }
+    static float getVolume (AudioProcessor& proc)               { return proc.getParameters().getFirst()->getValue(); }
+};
+
+static RigSnapshotTest sRigSnapshotTest;
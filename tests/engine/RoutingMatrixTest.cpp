@@ -0,0 +1,114 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiPipe.h"
+#include "engine/RoutingMatrix.h"
+#include "engine/nodes/MidiRouterNode.h"
+
+namespace Element {
+
+class RoutingMatrixTest : public UnitTestBase
+{
+public:
+    RoutingMatrixTest() : UnitTestBase ("Routing Matrix", "engine", "routingMatrix") { }
+    virtual ~RoutingMatrixTest() { }
+
+    void runTest() override
+    {
+        testMatrix();
+        testRouter();
+    }
+
+private:
+    void testMatrix()
+    {
+        beginTest ("bits");
+        RoutingMatrix matrix (4, 64);
+        expectEquals ((int64) matrix.getOutputs (0), (int64) 0);
+        matrix.set (1, 0, true);
+        matrix.set (1, 63, true);
+        expect (matrix.get (1, 0) && matrix.get (1, 63));
+        expect (! matrix.get (0, 0) && ! matrix.get (1, 1));
+        expect (matrix.getOutputs (1) == (((uint64) 1 << 63) | 1));
+        matrix.set (1, 0, false);
+        expect (matrix.getOutputs (1) == ((uint64) 1 << 63));
+
+        beginTest ("matrix state");
+        MatrixState state (6, 6);
+        state.set (3, 2, true);
+        state.set (5, 5, true);
+        RoutingMatrix copy (state);
+        expect (copy.sameSizeAs (state));
+        expect (copy.get (3, 2) && copy.get (5, 5));
+        expect (copy.getOutputs (0) == 0);
+
+        state.set (3, 2, false);
+        copy.assign (state);
+        expect (! copy.get (3, 2), "assigning replaces every route");
+    }
+
+    void testRouter()
+    {
+        beginTest ("fan out");
+        MidiRouterNode router (4, 4);
+        MatrixState state (4, 4);
+        state.set (0, 1, true);
+        state.set (0, 2, true);
+        state.set (3, 0, true);
+        router.setMatrixState (state);
+        router.prepareToRender (44100.0, 128);
+
+        OwnedArray<MidiBuffer> buffers;
+        MidiBuffer* pointers[4];
+        for (int i = 0; i < 4; ++i)
+            pointers[i] = buffers.add (new MidiBuffer());
+        buffers[0]->addEvent (MidiMessage::noteOn (1, 60, 1.f), 10);
+        buffers[3]->addEvent (MidiMessage::noteOn (2, 61, 1.f), 20);
+
+        MidiPipe pipe (pointers, 4);
+        AudioSampleBuffer audio (1, 128);
+        router.render (audio, pipe);
+
+        expectEquals (buffers[0]->getNumEvents(), 1);
+        expectEquals (buffers[1]->getNumEvents(), 1);
+        expectEquals (buffers[2]->getNumEvents(), 1);
+        expect (buffers[3]->isEmpty(), "unpatched outputs are silent");
+
+        MidiBuffer::Iterator iter (*buffers[0]);
+        MidiMessage msg; int frame = 0;
+        expect (iter.getNextEvent (msg, frame));
+        expectEquals (msg.getNoteNumber(), 61);
+        expectEquals (frame, 20);
+
+        beginTest ("changes reach the next block");
+        router.setWithoutLocking (3, 0, false);
+        router.setWithoutLocking (3, 3, true);
+        for (auto* buffer : buffers)
+            buffer->clear();
+        buffers[3]->addEvent (MidiMessage::noteOn (2, 61, 1.f), 20);
+        router.render (audio, pipe);
+        expect (buffers[0]->isEmpty());
+        expectEquals (buffers[3]->getNumEvents(), 1);
+    }
+};
+
+static RoutingMatrixTest sRoutingMatrixTest;
+
+}
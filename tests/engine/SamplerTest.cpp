@@ -0,0 +1,143 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/SamplerNode.h"
+
+namespace Element {
+
+class SamplerTest : public UnitTestBase
+{
+public:
+    SamplerTest() : UnitTestBase ("Sampler", "engine", "sampler") { }
+    virtual ~SamplerTest() { }
+
+    void runTest() override
+    {
+        beginTest ("keys");
+        expectEquals (SamplerInstrument::parseKey ("60"), 60);
+        expectEquals (SamplerInstrument::parseKey ("c4"), 60);
+        expectEquals (SamplerInstrument::parseKey ("C#4"), 61);
+        expectEquals (SamplerInstrument::parseKey ("eb3"), 51);
+        expectEquals (SamplerInstrument::parseKey ("a-1"), 9);
+        expectEquals (SamplerInstrument::parseKey ("h4"), -1);
+        expectEquals (SamplerInstrument::parseKey ("200"), -1);
+
+        beginTest ("sfz");
+        const auto dir = File::getSpecialLocation (File::tempDirectory);
+        Array<SamplerInstrument::Region> regions;
+        expect (SamplerInstrument::parseSfz (R"(
+            // a comment
+            <control> default_path=Samples\Piano/
+            <group> lovel=64 volume=-6
+            <region> sample=C 4.wav key=c4 /* inline */ tune=10
+            <region> sample=D4.wav lokey=61 hikey=63 pitch_keycenter=62 hivel=100
+            <group>
+            <region> sample=E4.wav transpose=-12
+        )", dir, regions).wasOk());
+        expectEquals (regions.size(), 3);
+        expect (regions[0].sample == dir.getChildFile ("Samples/Piano/C 4.wav"));
+        expectEquals (regions[0].loKey, 60);
+        expectEquals (regions[0].rootKey, 60);
+        expectEquals (regions[0].loVelocity, 64);
+        expectEquals (regions[0].volumeDb, -6.f);
+        expectEquals (regions[0].tuneCents, 10.0);
+        expectEquals (regions[1].hiKey, 63);
+        expectEquals (regions[1].rootKey, 62);
+        expectEquals (regions[1].hiVelocity, 100);
+        expectEquals (regions[2].loVelocity, 1);
+        expectEquals (regions[2].transpose, -12);
+        expect (SamplerInstrument::parseSfz ("<region sample=x.wav", dir, regions).failed());
+
+        TemporaryFile wav (".wav");
+        writeConstant (wav.getFile(), 0.5f, 44100 * 2);
+
+        beginTest ("only the attack is in memory");
+        SamplerInstrument instrument;
+        expect (instrument.load (wav.getFile(), 0.05).wasOk());
+        expectEquals (instrument.getNumZones(), 1);
+        expect (instrument.getZone(0)->isStreamed());
+        expectEquals (instrument.getMemoryBytes(), (int64) (2 * 2205 * sizeof (float)));
+        expect (instrument.load (dir.getChildFile ("missing.sfz"), 0.05).failed());
+
+        beginTest ("notes stream past the attack");
+        SamplerNode sampler;
+        sampler.setPreloadTime (50);
+        sampler.prepareToPlay (44100.0, 512);
+        sampler.loadInstrument (wav.getFile());
+        expect (sampler.waitUntilLoaded (5000));
+        AudioBuffer<float> buffer (2, 512);
+        MidiBuffer midi;
+        sampler.processBlock (buffer, midi);
+        expectEquals (sampler.getNumZones(), 1);
+
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        float lowest = 1.f;
+        for (int block = 0; block < 40; ++block)
+        {
+            sampler.processBlock (buffer, midi);
+            lowest = jmin (lowest, buffer.getSample (0, 0), buffer.getSample (1, 511));
+            Thread::sleep (2);
+        }
+        expectWithinAbsoluteError (lowest, 0.5f, 0.01f);
+        expectEquals (sampler.getNumActiveVoices(), 1);
+
+        beginTest ("note off releases");
+        midi.addEvent (MidiMessage::noteOff (1, 60), 0);
+        sampler.processBlock (buffer, midi);
+        for (int block = 0; block < 30; ++block)
+            sampler.processBlock (buffer, midi);
+        expectEquals (sampler.getNumActiveVoices(), 0);
+        expectEquals (buffer.getMagnitude (0, 512), 0.f);
+
+        beginTest ("pitch");
+        // an octave up plays the two seconds in one
+        midi.addEvent (MidiMessage::noteOn (1, 72, 1.f), 0);
+        sampler.processBlock (buffer, midi);
+        midi.clear();
+        for (int block = 1; block < 80; ++block)
+        {
+            sampler.processBlock (buffer, midi);
+            Thread::sleep (1);
+        }
+        expectEquals (sampler.getNumActiveVoices(), 1);
+        for (int block = 80; block < 90; ++block)
+            sampler.processBlock (buffer, midi);
+        expectEquals (sampler.getNumActiveVoices(), 0);
+
+        sampler.releaseResources();
+    }
+
+private:
+    static void writeConstant (const File& file, float value, int numFrames)
+    {
+        AudioBuffer<float> buffer (2, numFrames);
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+            FloatVectorOperations::fill (buffer.getWritePointer (c), value, numFrames);
+
+        WavAudioFormat format;
+        file.deleteFile();
+        std::unique_ptr<AudioFormatWriter> writer (format.createWriterFor (
+            new FileOutputStream (file), 44100.0, 2, 16, {}, 0));
+        writer->writeFromAudioSampleBuffer (buffer, 0, numFrames);
+    }
+};
+
+static SamplerTest sSamplerTest;
+
+}
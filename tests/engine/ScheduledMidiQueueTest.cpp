@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/ScheduledMidiQueue.h"
+
+namespace Element {
+
+class ScheduledMidiQueueTest : public UnitTestBase
+{
+public:
+    ScheduledMidiQueueTest() : UnitTestBase ("Scheduled MIDI Queue", "engine", "scheduledMidiQueue") { }
+    virtual ~ScheduledMidiQueueTest() { }
+
+    void runTest() override
+    {
+        testFutureBlocks();
+        testOrdering();
+        testDelay();
+    }
+
+private:
+    static Array<int> getFrames (const MidiBuffer& midi)
+    {
+        Array<int> frames;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            frames.add (frame);
+        return frames;
+    }
+
+    void testFutureBlocks()
+    {
+        beginTest ("messages wait for the block they are due in");
+        const double rate = 1000.0;
+        ScheduledMidiQueue queue;
+        expect (queue.push (MidiMessage::noteOn (1, 60, 1.f), 0.999));
+        expect (queue.push (MidiMessage::noteOff (1, 60), 1.15));
+
+        MidiBuffer midi;
+        queue.render (midi, 100, rate, 1.0);
+        expect (getFrames (midi) == Array<int> { 99 });
+        expectEquals (queue.getNumPending(), 1);
+
+        midi.clear();
+        queue.render (midi, 100, rate, 1.1);
+        expect (midi.isEmpty(), "not due until the next block");
+
+        midi.clear();
+        queue.render (midi, 100, rate, 1.2);
+        expect (getFrames (midi) == Array<int> { 50 });
+        expectEquals (queue.getNumPending(), 0);
+
+        beginTest ("late messages land on the first sample");
+        queue.push (MidiMessage::noteOn (1, 60, 1.f), 0.5);
+        midi.clear();
+        queue.render (midi, 100, rate, 1.3);
+        expect (getFrames (midi) == Array<int> { 0 });
+    }
+
+    void testOrdering()
+    {
+        beginTest ("pending messages are kept in time order");
+        ScheduledMidiQueue queue;
+        queue.push (MidiMessage::noteOn (1, 62, 1.f), 2.08);
+        queue.push (MidiMessage::noteOn (1, 61, 1.f), 2.04);
+        queue.push (MidiMessage::noteOn (1, 60, 1.f), 2.04);
+
+        MidiBuffer midi;
+        queue.render (midi, 100, 1000.0, 2.1);
+
+        Array<int> notes;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            notes.add (msg.getNoteNumber());
+        expect (notes == Array<int> { 61, 60, 62 });
+    }
+
+    void testDelay()
+    {
+        beginTest ("the jitter buffer delays every message");
+        ScheduledMidiQueue queue;
+        queue.setDelay (0.05);
+        queue.push (MidiMessage::noteOn (1, 60, 1.f), 3.0);
+
+        MidiBuffer midi;
+        queue.render (midi, 100, 1000.0, 3.0);
+        expect (midi.isEmpty());
+        queue.render (midi, 100, 1000.0, 3.1);
+        expect (getFrames (midi) == Array<int> { 50 });
+
+        beginTest ("pending overflow drops messages");
+        ScheduledMidiQueue small (16384, 2);
+        for (int i = 0; i < 4; ++i)
+            small.push (MidiMessage::noteOn (1, 60 + i, 1.f), 10.0);
+        midi.clear();
+        small.render (midi, 100, 1000.0, 0.0);
+        expectEquals (small.getNumPending(), 2);
+        expectEquals (small.getNumDropped(), 2);
+    }
+};
+
+static ScheduledMidiQueueTest sScheduledMidiQueueTest;
+
+}
@@ -0,0 +1,102 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/SincResampler.h"
+
+namespace Element {
+
+class SincResamplerTest : public UnitTestBase
+{
+public:
+    SincResamplerTest() : UnitTestBase ("Sinc Resampler", "engine", "sincResampler") { }
+    virtual ~SincResamplerTest() { }
+
+    void runTest() override
+    {
+        const double frequency = 1000.0;
+        AudioBuffer<float> sine (2, 44100);
+        for (int c = 0; c < sine.getNumChannels(); ++c)
+            for (int i = 0; i < sine.getNumSamples(); ++i)
+                sine.setSample (c, i, (float) std::sin (MathConstants<double>::twoPi * frequency * i / 44100.0));
+
+        testConversion (sine, 48000.0, SincResamplingAudioSource::Fast, 1.0e-2f);
+        testConversion (sine, 48000.0, SincResamplingAudioSource::Good, 2.0e-3f);
+        testConversion (sine, 96000.0, SincResamplingAudioSource::Best, 1.0e-3f);
+        testConversion (sine, 22050.0, SincResamplingAudioSource::Good, 2.0e-3f);
+
+        beginTest ("same rate reads straight through");
+        {
+            SincResamplingAudioSource source (new MemoryAudioSource (sine, true), true, 44100.0, 2);
+            source.prepareToPlay (512, 44100.0);
+            AudioBuffer<float> buffer (2, 512);
+            source.getNextAudioBlock (AudioSourceChannelInfo (buffer));
+            expectEquals (buffer.getSample (0, 100), sine.getSample (0, 100));
+            expectEquals (source.getTotalLength(), (int64) sine.getNumSamples());
+        }
+
+        beginTest ("tables are shared by ratio");
+        {
+            SharedResourcePointer<SincResamplingAudioSource::FilterCache> filters;
+            auto a = filters->get (SincResamplingAudioSource::Good, 44100.0 / 48000.0);
+            auto b = filters->get (SincResamplingAudioSource::Good, 44100.0 / 96000.0);
+            auto c = filters->get (SincResamplingAudioSource::Good, 2.0);
+            expect (a == b);
+            expect (a != c);
+            expect (c->numTaps > a->numTaps);
+            expectEquals (c->numTaps % 4, 0);
+        }
+    }
+
+private:
+    void testConversion (AudioBuffer<float>& sine, double sampleRate,
+                         SincResamplingAudioSource::Quality quality, float tolerance)
+    {
+        beginTest (String ("44100 to ") + String (roundToInt (sampleRate)) + ", quality " + String ((int) quality));
+        SincResamplingAudioSource source (new MemoryAudioSource (sine, true),
+                                          true, 44100.0, 2, quality);
+        source.prepareToPlay (512, sampleRate);
+        expectEquals (source.getTotalLength(), (int64) (sine.getNumSamples() * sampleRate / 44100.0));
+
+        // start past the kernel's reach from the file's beginning
+        const int64 start = (int64) sampleRate / 10;
+        source.setNextReadPosition (start);
+        expectEquals (source.getNextReadPosition(), start);
+
+        AudioBuffer<float> buffer (2, 512);
+        float maxError = 0.f;
+        int64 frame = start;
+        for (int block = 0; block < 8; ++block)
+        {
+            source.getNextAudioBlock (AudioSourceChannelInfo (buffer));
+            for (int i = 0; i < buffer.getNumSamples(); ++i, ++frame)
+            {
+                const auto expected = (float) std::sin (MathConstants<double>::twoPi * 1000.0 * frame / sampleRate);
+                maxError = jmax (maxError, std::abs (buffer.getSample (1, i) - expected));
+            }
+        }
+
+        expectLessThan (maxError, tolerance);
+        expectEquals (source.getNextReadPosition(), frame);
+        source.releaseResources();
+    }
+};
+
+static SincResamplerTest sSincResamplerTest;
+
+}
@@ -0,0 +1,175 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/SmoothedParameter.h"
+
+namespace Element {
+
+class SmoothedParameterTest : public UnitTestBase
+{
+public:
+    SmoothedParameterTest() : UnitTestBase ("Smoothed Parameters", "engine", "smoothedParameter") { }
+    virtual ~SmoothedParameterTest() { }
+
+    void runTest() override
+    {
+        testSmoothing();
+        testEngineEvents();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr double sampleRate = 44100.0;
+
+    static float doubled (float value) { return value * 2.f; }
+
+    void testSmoothing()
+    {
+        AudioParameterFloat param ("level", "Level", 0.f, 1.f, 0.f);
+        SmoothedParameter smoothed;
+        smoothed.attach (param);
+        smoothed.prepare (1000.0, 64, 0.016);
+
+        beginTest ("steady values");
+        smoothed.process (64);
+        expect (! smoothed.isSmoothing());
+        expectEquals (smoothed.getCurrentValue(), 0.f);
+
+        beginTest ("parameter changes glide");
+        param = 1.f;
+        const float* values = smoothed.process (64);
+        expect (smoothed.isSmoothing());
+        expectWithinAbsoluteError (values[0], 1.f / 16.f, 1.0e-6f);
+        expectWithinAbsoluteError (values[7], 0.5f, 1.0e-6f);
+        expectEquals (values[15], 1.f);
+        expectEquals (values[63], 1.f);
+        smoothed.process (64);
+        expect (! smoothed.isSmoothing());
+
+        beginTest ("events land on their sample");
+        smoothed.addEvent (0.5f, 40, 0);
+        smoothed.addEvent (0.f, 10, 0);
+        values = smoothed.process (64);
+        expectEquals (values[9], 1.f);
+        expectEquals (values[10], 0.f);
+        expectEquals (values[39], 0.f);
+        expectEquals (values[40], 0.5f);
+        expectEquals (smoothed.getCurrentValue(), 0.5f);
+
+        beginTest ("events ramp over their own time");
+        smoothed.addEvent (1.f, 0, 4);
+        values = smoothed.process (64);
+        expectWithinAbsoluteError (values[1], 0.75f, 1.0e-6f);
+        expectEquals (values[3], 1.f);
+
+        beginTest ("mapped values");
+        param = 0.25f;
+        smoothed.attach (param, doubled);
+        smoothed.process (64);
+        expectEquals (smoothed.getCurrentValue(), 0.5f);
+        expect (! smoothed.isSmoothing(), "attaching jumps to the value");
+    }
+
+    void testEngineEvents()
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (0, 1, sampleRate, blockSize);
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        auto* source = new SmoothedSource();
+        GraphNodePtr node = graph.addNode (source);
+        graph.prepareToPlay (sampleRate, blockSize);
+        node->connectAudioTo (output);
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        AudioSampleBuffer audio (1, blockSize);
+        MidiBuffer midi;
+
+        beginTest ("engine changes become events");
+        node->scheduleParameterChange (0, 0.5f);
+        render (graph, audio, midi);
+        render (graph, audio, midi);
+        source->numCalls = 0;
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+        node->scheduleParameterChange (0, 1.f, now - 128.0 / sampleRate);
+        render (graph, audio, midi);
+        expectEquals (source->numCalls, 1, "the block isn't split");
+        expectWithinAbsoluteError (audio.getSample (0, 64), 0.5f, 0.001f);
+        expectWithinAbsoluteError (audio.getSample (0, blockSize - 1), 1.f, 0.001f);
+        expect (audio.getSample (0, 130) < 1.f, "jumps are smoothed");
+        expectWithinAbsoluteError (source->level->get(), 1.f, 0.001f);
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    /** Outputs its one smoothed parameter as a level */
+    class SmoothedSource : public BaseProcessor
+    {
+    public:
+        SmoothedSource()
+            : BaseProcessor (BusesProperties().withOutput ("Main", AudioChannelSet::mono(), true))
+        {
+            addParameter (level = new AudioParameterFloat ("level", "Level", 0.f, 1.f, 0.f));
+            smoothed.attach (*level);
+            addSmoothedParameter (smoothed);
+        }
+
+        int numCalls = 0;
+        AudioParameterFloat* level = nullptr;
+        SmoothedParameter smoothed;
+
+        const String getName() const override { return "Smoothed Source"; }
+        void prepareToPlay (double rate, int block) override { prepareSmoothedParameters (rate, block, 16.0 / rate); }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            ++numCalls;
+            FloatVectorOperations::copy (buffer.getWritePointer (0), smoothed.process (buffer.getNumSamples()),
+                                         buffer.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (juce::MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+        void fillInPluginDescription (PluginDescription& desc) const override { desc.name = getName(); }
+    };
+
+    static void render (GraphProcessor& graph, AudioSampleBuffer& audio, MidiBuffer& midi)
+    {
+        audio.clear();
+        midi.clear();
+        graph.processBlock (audio, midi);
+    }
+};
+
+static SmoothedParameterTest sSmoothedParameterTest;
+
+}
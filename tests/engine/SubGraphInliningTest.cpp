@@ -0,0 +1,104 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/SubGraphProcessor.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class SubGraphInliningTest : public UnitTestBase
+{
+public:
+    SubGraphInliningTest() : UnitTestBase ("Sub Graph Inlining", "engine", "inlining") { }
+    virtual ~SubGraphInliningTest() { }
+
+    void runTest() override
+    {
+        beginTest ("rack renders as its own program");
+        testPassThrough (false);
+
+        beginTest ("rack renders inlined");
+        testPassThrough (true);
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    void testPassThrough (const bool inlined)
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.setSubGraphInliningEnabled (inlined);
+
+        GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+
+        auto* sub = new SubGraphProcessor();
+        GraphNodePtr rack = graph.addNode (sub);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        GraphNodePtr subInput = sub->addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        GraphNodePtr subOutput = sub->addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        GraphNodePtr volume = sub->addNode (new VolumeProcessor (-60.0, 12.0, true));
+        sub->prepareToPlay (44100.0, blockSize);
+        subInput->connectAudioTo (volume);
+        volume->connectAudioTo (subOutput);
+
+        input->connectAudioTo (rack);
+        rack->connectAudioTo (output);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        expect (render (graph, 0.25f), "rack should pass audio through");
+
+        // a rack with gain applied can't be inlined, the program is rebuilt
+        // with the rack node back in it
+        rack->setGain (0.5f);
+        graph.prepareToPlay (44100.0, blockSize);
+        render (graph, 0.125f);
+        expect (render (graph, 0.125f), "rack gain should be applied");
+
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    static bool render (GraphProcessor& graph, const float expected)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                audio.setSample (ch, i, 0.25f);
+
+        graph.processBlock (audio, midi);
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                if (std::abs (audio.getSample (ch, i) - expected) > 1.0e-5f)
+                    return false;
+        return true;
+    }
+};
+
+static SubGraphInliningTest sSubGraphInliningTest;
+
+}
@@ -0,0 +1,79 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiEngine.h"
+#include "engine/MidiOutputScheduler.h"
+
+using namespace Element;
+
+//=============================================================================
+class SysExTransferTest : public UnitTestBase
+{
+public:
+    SysExTransferTest ()
+        : UnitTestBase ("SysEx Transfer", "MidiOutputScheduler", "sysex") { }
+
+    void runTest() override
+    {
+        beginTest ("parse");
+        const uint8 stream[] = { 0x00, 0xf0, 0x41, 0x10, 0xf7, 0x90, 0xf0, 0x7e, 0x01, 0x02, 0xf7, 0xf0, 0x43 };
+        auto messages = SysExTransfer::parse (stream, sizeof (stream));
+        expectEquals (messages.size(), 2);
+        expectEquals (messages[0].getRawDataSize(), 4);
+        expectEquals (messages[1].getRawDataSize(), 5);
+        expect (messages[1].isSysEx());
+
+        beginTest ("pacing");
+        SysExTransfer::Options options;
+        options.bytesPerSecond = 1000;
+        options.messageGapMs = 5;
+        SysExTransfer::Ptr transfer = new SysExTransfer (messages, options);
+        expectEquals ((int) transfer->getTotalBytes(), 9);
+        expect (transfer->takeDueMessage (100.0) != nullptr);
+        expectEquals ((int) transfer->getBytesSent(), 4);
+        expectEquals (transfer->getNextDueMs(), 109.0);
+        expect (transfer->takeDueMessage (108.0) == nullptr);
+        expect (transfer->takeDueMessage (109.0) != nullptr);
+        expectEquals ((int) transfer->getBytesSent(), 9);
+        expectEquals (transfer->getProgress(), 1.0);
+        expect (transfer->isDone());
+        expect (transfer->takeDueMessage (1000.0) == nullptr);
+
+        beginTest ("cancel");
+        transfer = new SysExTransfer (messages, options);
+        transfer->cancel();
+        expect (transfer->isDone());
+        expect (transfer->takeDueMessage (100.0) == nullptr);
+        expectEquals ((int) transfer->getBytesSent(), 0);
+
+        beginTest ("no output cancels");
+        MidiEngine midi;
+        MidiOutputScheduler scheduler (midi);
+        transfer = scheduler.sendSysEx (messages);
+        bool completed = false;
+        transfer->onComplete = [&completed] (const SysExTransfer&) { completed = true; };
+        for (int i = 0; i < 50 && ! completed; ++i)
+            MessageManager::getInstance()->runDispatchLoopUntil (10);
+        expect (completed);
+        expect (transfer->wasCancelled());
+        expectEquals (scheduler.getNumSysExTransfers(), 0);
+    }
+};
+
+static SysExTransferTest sSysExTransferTest;
@@ -0,0 +1,113 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/TempoTable.h"
+#include "session/TempoMap.h"
+
+namespace Element {
+
+class TempoTableTest : public UnitTestBase
+{
+public:
+    TempoTableTest() : UnitTestBase ("Tempo Table", "engine", "tempoTable") { }
+    virtual ~TempoTableTest() { }
+
+    void runTest() override
+    {
+        testConstant();
+        testChanges();
+        testRamps();
+        testMeters();
+    }
+
+private:
+    void testConstant()
+    {
+        beginTest ("constant tempo");
+        TempoMap map;
+        std::unique_ptr<TempoTable> table (TempoTable::fromTempoMap (map.getValueTree(), 48000.0, 120.0));
+        expectEquals (table->getNumSegments(), 1);
+        expectWithinAbsoluteError (table->beatToFrame (1.0), 24000.0, 1.0e-6);
+        expectWithinAbsoluteError (table->frameToBeat (96000.0), 4.0, 1.0e-9);
+        expectWithinAbsoluteError (table->getTempoAtBeat (100.0), 120.0, 1.0e-9);
+    }
+
+    void testChanges()
+    {
+        beginTest ("tempo changes");
+        TempoMap map;
+        map.addTempo (4.0, 60.0);
+        std::unique_ptr<TempoTable> table (TempoTable::fromTempoMap (map.getValueTree(), 48000.0, 120.0));
+        expectEquals (table->getNumSegments(), 2);
+        expectWithinAbsoluteError (table->beatToFrame (4.0), 96000.0, 1.0e-6);
+        expectWithinAbsoluteError (table->beatToFrame (5.0), 96000.0 + 48000.0, 1.0e-6);
+        expectWithinAbsoluteError (table->frameToBeat (96000.0 + 24000.0), 4.5, 1.0e-9);
+        expectWithinAbsoluteError (table->getTempoAtBeat (3.9), 120.0, 1.0e-9);
+        expectWithinAbsoluteError (table->getTempoAtBeat (4.0), 60.0, 1.0e-9);
+
+        beginTest ("a change on the first beat replaces the session tempo");
+        TempoMap first;
+        first.addTempo (0.0, 90.0);
+        table.reset (TempoTable::fromTempoMap (first.getValueTree(), 48000.0, 120.0));
+        expectEquals (table->getNumSegments(), 1);
+        expectWithinAbsoluteError (table->getTempoAtBeat (0.0), 90.0, 1.0e-9);
+    }
+
+    void testRamps()
+    {
+        beginTest ("ramps");
+        TempoMap map;
+        map.addTempo (0.0, 60.0, true);
+        map.addTempo (4.0, 120.0);
+        std::unique_ptr<TempoTable> table (TempoTable::fromTempoMap (map.getValueTree(), 48000.0, 120.0));
+        expectWithinAbsoluteError (table->getTempoAtBeat (2.0), 90.0, 1.0e-9);
+
+        // 60 bpm rising by 15 each beat takes 60 / 15 ln (120 / 60) seconds
+        const double rampFrames = 48000.0 * 4.0 * std::log (2.0);
+        expectWithinAbsoluteError (table->beatToFrame (4.0), rampFrames, 1.0e-6);
+        expectWithinAbsoluteError (table->beatToFrame (5.0), rampFrames + 24000.0, 1.0e-6);
+
+        beginTest ("round trips");
+        for (double beat = 0.0; beat < 8.0; beat += 0.37)
+            expectWithinAbsoluteError (table->frameToBeat (table->beatToFrame (beat)), beat, 1.0e-9);
+    }
+
+    void testMeters()
+    {
+        beginTest ("positions");
+        TempoMap map;
+        map.addMeter (0.0, 3, 4);
+        map.addTempo (6.0, 60.0);
+        std::unique_ptr<TempoTable> table (TempoTable::fromTempoMap (map.getValueTree(), 48000.0, 120.0));
+
+        AudioPlayHead::CurrentPositionInfo position;
+        position.resetToDefault();
+        table->fillPosition (position, 6 * 24000 + 24000);
+        expectWithinAbsoluteError (position.ppqPosition, 6.5, 1.0e-9);
+        expectWithinAbsoluteError (position.timeInSeconds, 3.5, 1.0e-9);
+        expectWithinAbsoluteError (position.bpm, 60.0, 1.0e-9);
+        expectEquals (position.timeSigNumerator, 3);
+        expectEquals (position.timeSigDenominator, 4);
+        expectWithinAbsoluteError (position.ppqPositionOfLastBarStart, 6.0, 1.0e-9);
+    }
+};
+
+static TempoTableTest sTempoTableTest;
+
+}
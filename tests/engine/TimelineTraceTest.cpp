@@ -0,0 +1,109 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/TimelineTrace.h"
+
+namespace Element {
+
+class TimelineTraceTest : public UnitTestBase
+{
+public:
+    TimelineTraceTest() : UnitTestBase ("Timeline Trace", "engine", "timelineTrace") { }
+    virtual ~TimelineTraceTest() { }
+
+    void runTest() override
+    {
+        beginTest ("disabled");
+        TimelineTrace::setEnabled (false);
+        TimelineTrace::clear();
+        { const TimelineTrace::Zone zone ("ignored"); }
+        expect (count ("ignored") == 0);
+
+        beginTest ("zones");
+        TimelineTrace::setEnabled (true);
+        { const TimelineTrace::Zone zone ("test zone", 7); }
+
+        struct Worker : public Thread
+        {
+            Worker() : Thread ("el.timelineTest") { }
+            void run() override
+            {
+                for (int i = 0; i < 10; ++i)
+                    const TimelineTrace::Zone zone ("worker zone");
+            }
+        } worker;
+        worker.startThread();
+        worker.waitForThreadToExit (-1);
+
+        expectEquals (count ("test zone"), 1);
+        expectEquals (count ("worker zone"), 10);
+        expect (getThreadName ("worker zone") == "el.timelineTest");
+
+        beginTest ("export");
+        TemporaryFile file (".json");
+        expect (TimelineTrace::writeChromeTrace (file.getFile()));
+        const auto json = JSON::parse (file.getFile());
+        const auto* events = json["traceEvents"].getArray();
+        expect (events != nullptr);
+        int numZones = 0;
+        for (const auto& event : *events)
+        {
+            if (event["name"].toString() != "test zone")
+                continue;
+            ++numZones;
+            expectEquals (event["ph"].toString(), String ("X"));
+            expectEquals ((int) event["args"]["id"], 7);
+        }
+        expectEquals (numZones, 1);
+
+        beginTest ("clear");
+        Thread::sleep (1);
+        TimelineTrace::clear();
+        expectEquals (count ("test zone"), 0);
+        TimelineTrace::setEnabled (false);
+    }
+
+private:
+    static int count (const char* name)
+    {
+        Array<TimelineTrace::ThreadEvents> threads;
+        TimelineTrace::getEvents (threads);
+        int numEvents = 0;
+        for (const auto& thread : threads)
+            for (const auto& event : thread.events)
+                if (String (event.name) == name)
+                    ++numEvents;
+        return numEvents;
+    }
+
+    static String getThreadName (const char* name)
+    {
+        Array<TimelineTrace::ThreadEvents> threads;
+        TimelineTrace::getEvents (threads);
+        for (const auto& thread : threads)
+            for (const auto& event : thread.events)
+                if (String (event.name) == name)
+                    return thread.name;
+        return {};
+    }
+};
+
+static TimelineTraceTest sTimelineTraceTest;
+
+}
@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/Transport.h"
+
+namespace Element {
+
+class TransportMonitorTest : public UnitTestBase
+{
+public:
+    TransportMonitorTest() : UnitTestBase ("Transport Monitor", "engine", "transportMonitor") { }
+    virtual ~TransportMonitorTest() { }
+
+    void runTest() override
+    {
+        testSnapshot();
+        testTransport();
+        testConcurrentReads();
+    }
+
+private:
+    using Snapshot = Transport::Monitor::Snapshot;
+
+    void testSnapshot()
+    {
+        beginTest ("bars and beats");
+        Transport::MonitorPtr monitor = new Transport::Monitor();
+        Snapshot snapshot;
+        snapshot.sampleRate     = 48000.0;
+        snapshot.tempo          = 120.0;
+        snapshot.beatsPerBar    = 3;
+        snapshot.positionFrames = 48000 * 4 + 12000;   // 9.5 beats
+        snapshot.playing        = true;
+        monitor->publish (snapshot);
+
+        const auto read = monitor->read();
+        expect (read.playing && ! read.recording);
+        expectEquals (read.positionFrames, snapshot.positionFrames);
+        expectWithinAbsoluteError (read.getPositionBeats(), 9.5, 1.0e-9);
+
+        int bars = 0, beats = 0, sub = 0;
+        monitor->getBarsAndBeats (bars, beats, sub);
+        expectEquals (bars, 3);
+        expectEquals (beats, 0);
+        expectEquals (sub, 2);
+    }
+
+    void testTransport()
+    {
+        beginTest ("transport publishes each block");
+        Transport transport;
+        transport.prepareToPlay (48000.0);
+        transport.requestTempo (90.0);
+        transport.requestPlayState (true);
+        transport.preProcess (512);
+        transport.advance (512);
+        transport.postProcess (512);
+
+        const auto snapshot = transport.getMonitor()->read();
+        expect (snapshot.playing);
+        expectEquals (snapshot.tempo, 90.0);
+        expectEquals (snapshot.sampleRate, 48000.0);
+        expectEquals (snapshot.positionFrames, (int64) 512);
+    }
+
+    void testConcurrentReads()
+    {
+        beginTest ("reads never tear");
+        Transport::MonitorPtr monitor = new Transport::Monitor();
+        struct Publisher : public Thread
+        {
+            Publisher (Transport::Monitor& m) : Thread ("publisher"), monitor (m) { }
+            void run() override
+            {
+                for (int i = 1; i <= 200000; ++i)
+                {
+                    Snapshot snapshot;
+                    snapshot.positionFrames = i;
+                    snapshot.tempo          = (double) i;
+                    snapshot.beatsPerBar    = i;
+                    snapshot.playing        = (i & 1) != 0;
+                    monitor.publish (snapshot);
+                }
+            }
+            Transport::Monitor& monitor;
+        } publisher (*monitor);
+
+        publisher.startThread();
+        bool coherent = true;
+        int64 last = 0;
+        bool forward = true;
+        while (publisher.isThreadRunning())
+        {
+            const auto s = monitor->read();
+            if (s.positionFrames == 0)
+                continue;
+            coherent &= s.tempo == (double) s.positionFrames
+                && s.beatsPerBar == (int) s.positionFrames
+                && s.playing == ((s.positionFrames & 1) != 0);
+            forward &= s.positionFrames >= last;
+            last = s.positionFrames;
+        }
+
+        expect (coherent, "every field of a read came from the same publish");
+        expect (forward, "reads never go back in time");
+        expectEquals (monitor->read().positionFrames, (int64) 200000);
+    }
+};
+
+static TransportMonitorTest sTransportMonitorTest;
+
+}
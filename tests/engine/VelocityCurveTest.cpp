@@ -49,6 +49,22 @@ public:
         expect (62.0  == std::floor (127.f * curve.process (50.f / 127.f)));
         expect (33.0  == std::floor (127.f * curve.process (25.f / 127.f)));
         expect (127.f == std::floor (127.f * curve.process (1.f)));
+
+        beginTest ("MIDI velocities are looked up");
+        curve.setMode (VelocityCurve::Soft_1);
+        expectEquals ((int) curve.process ((uint8) 0), 0);
+        expectEquals ((int) curve.process ((uint8) 100), roundToInt (127.f * curve.process (100.f / 127.f)));
+        expectEquals ((int) curve.process ((uint8) 127), 127);
+
+        beginTest ("custom curves");
+        uint8 values[128];
+        for (int i = 0; i < 128; ++i)
+            values[i] = (uint8) (127 - i);
+        curve.setCustomCurve (values);
+        expect (curve.getMode() == VelocityCurve::Custom);
+        expectEquals ((int) curve.process ((uint8) 1), 126);
+        expectEquals ((int) curve.process ((uint8) 0), 0, "velocity zero is always a note off");
+        expectWithinAbsoluteError (curve.process (27.f / 127.f), 100.f / 127.f, 0.0001f);
     }
 };
 
@@ -0,0 +1,99 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "scripting/LuaScheduler.h"
+#include "sol/sol.hpp"
+
+using namespace Element;
+
+//=============================================================================
+class LuaSchedulerTest : public UnitTestBase
+{
+public:
+    LuaSchedulerTest ()
+        : UnitTestBase ("Lua Scheduler", "Scripting", "scheduler") { }
+
+    void runTest() override
+    {
+        sol::state lua;
+        lua.open_libraries (sol::lib::base, sol::lib::table, sol::lib::coroutine);
+        LuaScheduler scheduler (lua);
+
+        beginTest ("tasks run until they wait");
+        lua.script (R"(
+            order = {}
+            element.spawn (function (name)
+                table.insert (order, name .. "1")
+                element.sleep (20)
+                table.insert (order, name .. "2")
+            end, "a")
+            element.spawn (function()
+                table.insert (order, "b1")
+                element.sleep (1)
+                table.insert (order, "b2")
+            end)
+        )");
+        expectEquals (scheduler.getNumTasks(), 2);
+        expectEquals (order (lua), String ("a1 b1"));
+
+        beginTest ("sleeping tasks resume in turn");
+        MessageManager::getInstance()->runDispatchLoopUntil (100);
+        expectEquals (order (lua), String ("a1 b1 b2 a2"));
+        expectEquals (scheduler.getNumTasks(), 0);
+
+        beginTest ("osc and midi resume waiting tasks");
+        lua.script (R"(
+            osc, midi = {}, {}
+            element.spawn (function() osc = { element.waitosc ("/el/test") } end)
+            element.spawn (function() midi = { element.waitmidi() } end)
+            element.spawn (function() timedout = element.waitmidi (5) == nil end)
+        )");
+        scheduler.deliver (OSCMessage ("/el/other", 1));
+        scheduler.deliver (OSCMessage ("/el/test", 5, String ("x")));
+        expectEquals ((int) lua["osc"][2].get<int>(), 5);
+        expectEquals (String (lua["osc"][3].get<std::string>()), String ("x"));
+        scheduler.post (MidiMessage::noteOn (1, 60, (uint8) 100));
+        MessageManager::getInstance()->runDispatchLoopUntil (50);
+        expectEquals ((int) lua["midi"][1].get<int>(), 0x90);
+        expectEquals ((int) lua["midi"][2].get<int>(), 60);
+        expect (lua["timedout"].get<bool>());
+        expectEquals (scheduler.getNumTasks(), 0);
+
+        beginTest ("waits need a task");
+        expect (! lua.script ("return pcall (element.sleep, 1)").get<bool>());
+
+        beginTest ("cancel");
+        lua.script ("sleeper = element.spawn (function() element.sleep (10000) end)");
+        expectEquals (scheduler.getNumTasks(), 1);
+        expect (lua.script ("return element.cancel (sleeper)").get<bool>());
+        expectEquals (scheduler.getNumTasks(), 0);
+    }
+
+private:
+    static String order (sol::state& lua)
+    {
+        StringArray names;
+        sol::table table = lua["order"];
+        for (size_t i = 1; i <= table.size(); ++i)
+            names.add (table.get<std::string> (i));
+        return names.joinIntoString (" ");
+    }
+};
+
+static LuaSchedulerTest sLuaSchedulerTest;
@@ -0,0 +1,291 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/*  element-bench: renders a graph with no audio device attached and reports
+    how long each block took.
+
+    usage: element-bench [--session file.els] [--chain N] [--width N]
+                         [--blocks N] [--sizes 64,128,256] [--rate 48000]
+                         [--output results.json]
+
+    Without a session a synthetic graph is rendered: N stages of W volume
+    nodes in parallel, each stage feeding the next. Results are written as
+    JSON so runs of different Element versions can be compared.
+*/
+
+#include "ElementApp.h"
+#include "controllers/GraphManager.h"
+#include "engine/AudioEngine.h"
+#include "engine/GraphNode.h"
+#include "engine/InternalFormat.h"
+#include "engine/nodes/VolumeProcessor.h"
+#include "session/PluginManager.h"
+#include "session/Session.h"
+#include "Globals.h"
+#include "Settings.h"
+
+namespace Element {
+
+struct BenchOptions
+{
+    File session;
+    int chain           = 16;
+    int width           = 4;
+    int numBlocks       = 4000;
+    int numWarmup       = 100;
+    double sampleRate   = 48000.0;
+    Array<int> blockSizes { 32, 64, 128, 256, 512, 1024 };
+    File output;
+};
+
+static String getArgValue (const StringArray& args, const String& name)
+{
+    const int index = args.indexOf (name);
+    return isPositiveAndBelow (index + 1, args.size()) ? args [index + 1] : String();
+}
+
+static BenchOptions parseOptions (const StringArray& args)
+{
+    BenchOptions opts;
+    String value;
+
+    if ((value = getArgValue (args, "--session")).isNotEmpty())
+        opts.session = File::getCurrentWorkingDirectory().getChildFile (value);
+    if ((value = getArgValue (args, "--chain")).isNotEmpty())
+        opts.chain = jmax (1, value.getIntValue());
+    if ((value = getArgValue (args, "--width")).isNotEmpty())
+        opts.width = jmax (1, value.getIntValue());
+    if ((value = getArgValue (args, "--blocks")).isNotEmpty())
+        opts.numBlocks = jmax (1, value.getIntValue());
+    if ((value = getArgValue (args, "--rate")).isNotEmpty())
+        opts.sampleRate = jmax (1.0, value.getDoubleValue());
+    if ((value = getArgValue (args, "--output")).isNotEmpty())
+        opts.output = File::getCurrentWorkingDirectory().getChildFile (value);
+
+    if ((value = getArgValue (args, "--sizes")).isNotEmpty())
+    {
+        opts.blockSizes.clearQuick();
+        for (const auto& size : StringArray::fromTokens (value, ",", {}))
+            if (size.getIntValue() > 0)
+                opts.blockSizes.add (size.getIntValue());
+    }
+
+    return opts;
+}
+
+/** Stages of parallel volume nodes, summed into each following stage */
+static void buildSyntheticGraph (GraphProcessor& graph, const BenchOptions& opts)
+{
+    graph.setPlayConfigDetails (2, 2, opts.sampleRate, opts.blockSizes.getFirst());
+    GraphNodePtr input = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+        GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+    GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+        GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+
+    ReferenceCountedArray<GraphNode> previous;
+    previous.add (input);
+
+    for (int stage = 0; stage < opts.chain; ++stage)
+    {
+        ReferenceCountedArray<GraphNode> current;
+        for (int i = 0; i < opts.width; ++i)
+        {
+            GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+            for (auto* source : previous)
+                source->connectAudioTo (volume);
+            current.add (volume);
+        }
+        previous.swapWith (current);
+    }
+
+    for (auto* source : previous)
+        source->connectAudioTo (output);
+}
+
+struct BlockStats
+{
+    int blockSize = 0;
+    double meanNs = 0.0, p50Ns = 0.0, p99Ns = 0.0, p999Ns = 0.0, maxNs = 0.0;
+    double realtimeRatio = 0.0; ///< block duration divided by the mean render time
+
+    var toVar() const
+    {
+        auto* obj = new DynamicObject();
+        obj->setProperty ("blockSize", blockSize);
+        obj->setProperty ("meanNs", meanNs);
+        obj->setProperty ("p50Ns", p50Ns);
+        obj->setProperty ("p99Ns", p99Ns);
+        obj->setProperty ("p999Ns", p999Ns);
+        obj->setProperty ("maxNs", maxNs);
+        obj->setProperty ("realtimeRatio", realtimeRatio);
+        return var (obj);
+    }
+};
+
+static double percentile (const Array<double>& sorted, double fraction)
+{
+    const int index = jlimit (0, sorted.size() - 1, roundToInt (fraction * (sorted.size() - 1)));
+    return sorted [index];
+}
+
+static BlockStats measure (GraphProcessor& graph, int blockSize, const BenchOptions& opts)
+{
+    graph.setPlayConfigDetails (graph.getTotalNumInputChannels(), graph.getTotalNumOutputChannels(),
+                                opts.sampleRate, blockSize);
+    graph.setNonRealtime (false);
+    graph.prepareToPlay (opts.sampleRate, blockSize);
+
+    AudioSampleBuffer audio (jmax (graph.getTotalNumInputChannels(), graph.getTotalNumOutputChannels(), 1), blockSize);
+    MidiBuffer midi;
+    Random random;
+    Array<double> times;
+    times.ensureStorageAllocated (opts.numBlocks);
+
+    const double nsPerTick = 1.0e9 / (double) Time::getHighResolutionTicksPerSecond();
+
+    for (int i = 0; i < opts.numWarmup + opts.numBlocks; ++i)
+    {
+        for (int c = 0; c < audio.getNumChannels(); ++c)
+            for (int s = 0; s < blockSize; ++s)
+                audio.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+        midi.clear();
+
+        const auto start = Time::getHighResolutionTicks();
+        graph.processBlock (audio, midi);
+        const auto elapsed = Time::getHighResolutionTicks() - start;
+
+        if (i >= opts.numWarmup)
+            times.add ((double) elapsed * nsPerTick);
+    }
+
+    graph.releaseResources();
+
+    BlockStats stats;
+    stats.blockSize = blockSize;
+    if (times.isEmpty())
+        return stats;
+
+    double total = 0.0;
+    for (auto t : times)
+        total += t;
+
+    times.sort();
+    stats.meanNs = total / (double) times.size();
+    stats.p50Ns  = percentile (times, 0.5);
+    stats.p99Ns  = percentile (times, 0.99);
+    stats.p999Ns = percentile (times, 0.999);
+    stats.maxNs  = times.getLast();
+    stats.realtimeRatio = stats.meanNs > 0.0
+        ? ((double) blockSize / opts.sampleRate * 1.0e9) / stats.meanNs : 0.0;
+    return stats;
+}
+
+static void setupPlugins (Globals& world)
+{
+    auto& plugins = world.getPluginManager();
+    plugins.addDefaultFormats();
+    plugins.addFormat (new InternalFormat (*world.getAudioEngine(), world.getMidiEngine()));
+    plugins.addFormat (new ElementAudioPluginFormat (world));
+    plugins.restoreUserPlugins (world.getSettings());
+    plugins.scanInternalPlugins();
+}
+
+static int runBenchmark (const StringArray& args)
+{
+    const auto opts = parseOptions (args);
+    if (opts.blockSizes.isEmpty())
+    {
+        std::cerr << "no block sizes to measure" << std::endl;
+        return 1;
+    }
+
+    Globals world;
+    world.setEngine (new AudioEngine (world));
+    setupPlugins (world);
+
+    GraphNodePtr node = GraphNode::createForRoot (new RootGraph());
+    auto* root = dynamic_cast<RootGraph*> (node->getAudioProcessor());
+    std::unique_ptr<RootGraphManager> manager;
+    String source;
+
+    if (opts.session != File())
+    {
+        const auto data = Session::readFromFile (opts.session);
+        const auto graphs = data.getChildWithName (Tags::graphs);
+        const int active = jmax (0, (int) graphs.getProperty (Tags::active, 0));
+        const Node model (graphs.getChild (active), false);
+        if (! model.isValid())
+        {
+            std::cerr << "no graph found in " << opts.session.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        root->setPlayConfigDetails (jmax (2, model.getNumAudioIns()), jmax (2, model.getNumAudioOuts()),
+                                    opts.sampleRate, opts.blockSizes.getFirst());
+        manager.reset (new RootGraphManager (*root, world.getPluginManager()));
+        manager->setNodeModel (model);
+        source = opts.session.getFileName() + ": " + model.getName();
+    }
+    else
+    {
+        buildSyntheticGraph (*root, opts);
+        source = String ("synthetic ") + String (opts.chain) + "x" + String (opts.width);
+    }
+
+    Array<var> results;
+    for (const auto blockSize : opts.blockSizes)
+    {
+        const auto stats = measure (*root, blockSize, opts);
+        std::cerr << source << " @ " << blockSize << ": mean " << stats.meanNs << " ns, p99 "
+                  << stats.p99Ns << " ns, p99.9 " << stats.p999Ns << " ns" << std::endl;
+        results.add (stats.toVar());
+    }
+
+    auto* report = new DynamicObject();
+    report->setProperty ("version", ProjectInfo::versionString);
+    report->setProperty ("source", source);
+    report->setProperty ("numNodes", root->getNumNodes());
+    report->setProperty ("sampleRate", opts.sampleRate);
+    report->setProperty ("numBlocks", opts.numBlocks);
+    report->setProperty ("results", results);
+    const auto json = JSON::toString (var (report));
+
+    manager.reset();
+    root->clear();
+    node = nullptr;
+    world.setEngine (nullptr);
+
+    if (opts.output != File())
+        return opts.output.replaceWithText (json) ? 0 : 1;
+
+    std::cout << json << std::endl;
+    return 0;
+}
+
+}
+
+int main (int argc, char** argv)
+{
+    StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (String::fromUTF8 (argv[i]));
+
+    ScopedJuceInitialiser_GUI juce;
+    return Element::runBenchmark (args);
+}
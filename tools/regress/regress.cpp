@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/*  element-regress: renders the canned regression sessions with every
+    scheduler, checks their outputs match and compares timings against
+    a baseline.
+
+    usage: element-regress [--baseline baseline.json] [--output report.json]
+                           [--update-baseline] [--threshold 0.15]
+                           [--blocks N] [--runs N] [--size 256] [--rate 48000]
+
+    The report is JSON in the same form as the baseline, so a report can be
+    kept as the baseline of later runs. A missing baseline is written,
+    --update-baseline replaces it. Exits non-zero if a session renders
+    differently with another scheduler or than in the baseline, or if any
+    is slower than the threshold allows.
+*/
+
+#include "ElementApp.h"
+#include "engine/RenderRegression.h"
+
+namespace Element {
+
+struct RegressOptions
+{
+    RenderRegression::Options render;
+    File baseline;
+    File output;
+    bool updateBaseline = false;
+};
+
+static String getArgValue (const StringArray& args, const String& name)
+{
+    const int index = args.indexOf (name);
+    return isPositiveAndBelow (index + 1, args.size()) ? args [index + 1] : String();
+}
+
+static RegressOptions parseOptions (const StringArray& args)
+{
+    RegressOptions opts;
+    String value;
+
+    if ((value = getArgValue (args, "--baseline")).isNotEmpty())
+        opts.baseline = File::getCurrentWorkingDirectory().getChildFile (value);
+    if ((value = getArgValue (args, "--output")).isNotEmpty())
+        opts.output = File::getCurrentWorkingDirectory().getChildFile (value);
+    if ((value = getArgValue (args, "--threshold")).isNotEmpty())
+        opts.render.slowdownThreshold = jmax (0.0, value.getDoubleValue());
+    if ((value = getArgValue (args, "--blocks")).isNotEmpty())
+        opts.render.numBlocks = jmax (1, value.getIntValue());
+    if ((value = getArgValue (args, "--runs")).isNotEmpty())
+        opts.render.numRuns = jmax (1, value.getIntValue());
+    if ((value = getArgValue (args, "--size")).isNotEmpty())
+        opts.render.blockSize = jmax (1, value.getIntValue());
+    if ((value = getArgValue (args, "--rate")).isNotEmpty())
+        opts.render.sampleRate = jmax (1.0, value.getDoubleValue());
+    opts.updateBaseline = args.contains ("--update-baseline");
+
+    return opts;
+}
+
+static int runRegression (const StringArray& args)
+{
+    const auto opts = parseOptions (args);
+    RenderRegression regression (opts.render);
+    regression.run();
+
+    const bool haveBaseline = opts.baseline.existsAsFile() && ! opts.updateBaseline;
+    if (haveBaseline)
+        regression.compareWithBaseline (JSON::parse (opts.baseline));
+
+    for (const auto& outcome : regression.getOutcomes())
+    {
+        std::cerr << outcome.session << " (" << RenderRegression::getSchedulerName (outcome.scheduler)
+                  << "): " << outcome.msPerBlock << " ms per block";
+        if (outcome.baselineMs > 0.0)
+            std::cerr << ", baseline " << outcome.baselineMs << " ms";
+        if (outcome.slower)
+            std::cerr << " SLOWER";
+        if (outcome.hasChanged())
+            std::cerr << " CHANGED";
+        std::cerr << std::endl;
+    }
+
+    const auto nondeterministic = regression.getNondeterministicSessions();
+    if (! nondeterministic.isEmpty())
+        std::cerr << "schedulers disagree on: " << nondeterministic.joinIntoString (", ") << std::endl;
+
+    const auto json = JSON::toString (regression.createReport());
+    if (opts.output != File() && ! opts.output.replaceWithText (json))
+        return 1;
+    if (opts.output == File())
+        std::cout << json << std::endl;
+
+    // the first run on a machine records its baseline
+    if (opts.baseline != File() && ! haveBaseline && ! opts.baseline.replaceWithText (json))
+        return 1;
+
+    return nondeterministic.isEmpty() && regression.getNumSlowdowns() == 0
+        && regression.getNumChanges() == 0 ? 0 : 1;
+}
+
+}
+
+int main (int argc, char** argv)
+{
+    StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (String::fromUTF8 (argv[i]));
+
+    ScopedJuceInitialiser_GUI juce;
+    return Element::runRegression (args);
+}
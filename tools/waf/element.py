@@ -3,7 +3,7 @@
 
 import os, platform
 from waflib.Configure import conf
-import juce
+import cross, juce
 
 juce_modules = '''
     jlv2_host juce_audio_basics juce_audio_devices juce_audio_formats
@@ -14,9 +14,15 @@ juce_modules = '''
 
 mingw_libs = '''
     uuid wsock32 wininet version ole32 ws2_32 oleaut32
-    imm32 comdlg32 shlwapi rpcrt4 winmm gdi32
+    imm32 comdlg32 shlwapi rpcrt4 winmm gdi32 opengl32
 '''
 
+@conf
+def link_platform (self):
+    if cross.is_windows (self): return 'WINDOWS'
+    if juce.is_mac(): return 'MACOSX'
+    return 'LINUX'
+
 @conf 
 def check_common (self):
     self.check(lib='curl', mandatory=False)
@@ -45,6 +51,21 @@ def check_common (self):
     self.define('JUCE_PLUGINHOST_VST', bool(self.env.HAVE_VST))
     self.line_just = line_just
 
+    # Ableton Link, header only along with its copy of asio
+    self.env.LINK = False
+    if len(self.options.link) > 0:
+        link_path = os.path.abspath (os.path.expanduser (self.options.link))
+        includes = [ os.path.join (link_path, 'include'),
+                     os.path.join (link_path, 'modules/asio-standalone/asio/include') ]
+        self.check(header_name='ableton/Link.hpp', includes=includes, features='cxx',
+                   defines=['LINK_PLATFORM_%s=1' % self.link_platform()],
+                   mandatory=False, uselib_store="LINK")
+        self.env.LINK = bool(self.env.HAVE_LINK)
+        if self.env.LINK:
+            self.env.append_unique ('CXXFLAGS', ['-I%s' % i for i in includes])
+            self.define('LINK_PLATFORM_%s' % self.link_platform(), 1)
+    self.define('EL_USE_ABLETON_LINK', self.env.LINK)
+
     # LV2 Support
     self.env.LV2 = not bool(self.options.no_lv2)
     if self.env.LV2:
@@ -81,6 +102,8 @@ def check_common (self):
 def check_mingw (self):
     for l in mingw_libs.split():
         self.check_cxx(lib=l, uselib_store=l.upper())
+    self.env.GL = True
+    self.define('EL_USE_OPENGL', self.env.GL)
     self.define('JUCE_PLUGINHOST_VST3', 0)
     self.define('JUCE_PLUGINHOST_VST', bool(self.env.HAVE_VST))
     self.define('JUCE_PLUGINHOST_AU', 0)
@@ -92,6 +115,8 @@ def check_mingw (self):
 def check_mac (self):
     # VST/VST3 OSX Support
     self.define('JUCE_PLUGINHOST_VST3', 1)
+    self.env.GL = True
+    self.define('EL_USE_OPENGL', self.env.GL)
     self.check_cxx(lib='readline', uselib_store='READLINE', mandatory=True)
 
     # JACK OSX
@@ -104,6 +129,7 @@ def check_mac (self):
 def check_linux (self):
     self.check(lib='pthread', mandatory=True)
     self.check(lib='dl', uselib_store='DL', mandatory=True)
+    self.check(lib='rt', uselib_store='RT', mandatory=True)
     self.check_cxx(lib='readline', uselib_store='READLINE', mandatory=False)
     self.check(header_name='curl/curl.h', uselib_store='CURL', mandatory=True)
     self.check(lib='curl', uselib_store='CURL', mandatory=True)
@@ -131,6 +157,11 @@ def check_linux (self):
     self.check_cfg(package='xcomposite', args='--cflags --libs', mandatory=True)
     self.check_cfg(package='xinerama', args='--cflags --libs', mandatory=True)
     self.check_cfg(package='xcursor', args='--cflags --libs', mandatory=True)
+
+    # OpenGL is optional so headless and GL-less machines can still build
+    self.check_cfg(package='gl', uselib_store='GL', args='--cflags --libs', mandatory=False)
+    self.env.GL = bool(self.env.HAVE_GL)
+    self.define('EL_USE_OPENGL', self.env.GL)
     
     if not self.options.no_gtkui:
         self.check_cfg(package='gtk+-2.0', uselib_store='GTK',args='--cflags --libs', mandatory=False)
@@ -140,7 +171,7 @@ def check_linux (self):
 def get_mingw_libs():
     return [ l.upper() for l in mingw_libs.split() ]
 
-def get_juce_library_code (prefix, ext=''):
+def get_juce_library_code (prefix, ext='', opengl=True):
     extension = ext
     if len(ext) <= 0:
         if juce.is_mac():
@@ -149,8 +180,12 @@ def get_juce_library_code (prefix, ext=''):
             extension = '.cpp'
 
     cpp_only = [ 'juce_analytics', 'juce_osc', 'jlv2_host' ]
+    modules = juce_modules.split()
+    if opengl:
+        modules.append ('juce_opengl')
+
     code = []
-    for f in juce_modules.split():
+    for f in modules:
         e = '.cpp' if f in cpp_only else extension
         code.append (prefix + '/include_' + f + e)
     return code